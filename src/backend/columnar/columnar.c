@@ -24,11 +24,14 @@
 #include "citus_version.h"
 
 #include "columnar/columnar.h"
+#include "columnar/columnar_chunk_cache.h"
+#include "columnar/columnar_scan_stats.h"
 #include "columnar/columnar_tableam.h"
 
 /* Default values for option parameters */
 #define DEFAULT_STRIPE_ROW_COUNT 150000
 #define DEFAULT_CHUNK_ROW_COUNT 10000
+#define DEFAULT_STRIPE_MEMORY_LIMIT (256 * 1024) /* kB */
 
 #if HAVE_LIBZSTD
 #define DEFAULT_COMPRESSION_TYPE COMPRESSION_ZSTD
@@ -41,7 +44,15 @@
 int columnar_compression = DEFAULT_COMPRESSION_TYPE;
 int columnar_stripe_row_limit = DEFAULT_STRIPE_ROW_COUNT;
 int columnar_chunk_group_row_limit = DEFAULT_CHUNK_ROW_COUNT;
+int columnar_stripe_memory_limit = DEFAULT_STRIPE_MEMORY_LIMIT;
 int columnar_compression_level = 3;
+int columnar_compression_workers = 0;
+bool columnar_enable_bloom_filter = false;
+bool columnar_enable_chunk_encoding = false;
+bool columnar_enable_vectorized_filter = false;
+int columnar_chunk_cache_size = 0;
+int columnar_stat_scans_max = 1000;
+double columnar_vacuum_compaction_threshold = 0.2;
 
 static const struct config_enum_entry columnar_compression_options[] =
 {
@@ -53,6 +64,7 @@ static const struct config_enum_entry columnar_compression_options[] =
 #if HAVE_LIBZSTD
 	{ "zstd", COMPRESSION_ZSTD, false },
 #endif
+	{ "auto", COMPRESSION_AUTO, false },
 	{ NULL, 0, false }
 };
 
@@ -61,6 +73,8 @@ columnar_init(void)
 {
 	columnar_init_gucs();
 	columnar_tableam_init();
+	ColumnarChunkCacheInit();
+	ColumnarScanStatsInit();
 }
 
 
@@ -92,6 +106,25 @@ columnar_init_gucs()
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("columnar.compression_workers",
+							gettext_noop("Number of threads to be used by zstd to compress "
+										 "each column chunk."),
+							gettext_noop("When set to 0, column chunks are compressed by "
+										 "the backend itself. Otherwise, zstd compresses "
+										 "large column chunks using the given number of "
+										 "threads, if it is built with multithreading "
+										 "support. Has no effect for other compression "
+										 "types."),
+							&columnar_compression_workers,
+							0,
+							0,
+							COMPRESSION_WORKERS_MAX,
+							PGC_USERSET,
+							GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+							NULL,
+							NULL,
+							NULL);
+
 	DefineCustomIntVariable("columnar.stripe_row_limit",
 							"Maximum number of tuples per stripe.",
 							NULL,
@@ -117,6 +150,113 @@ columnar_init_gucs()
 							NULL,
 							NULL,
 							NULL);
+
+	DefineCustomIntVariable("columnar.stripe_memory_limit",
+							gettext_noop("Maximum amount of memory to buffer the rows "
+										 "of a stripe in while writing it."),
+							gettext_noop("When the buffered rows of the stripe being "
+										 "written use more memory than this, the stripe "
+										 "is flushed before it reaches "
+										 "columnar.stripe_row_limit rows. Setting it to "
+										 "0 disables the limit."),
+							&columnar_stripe_memory_limit,
+							DEFAULT_STRIPE_MEMORY_LIMIT,
+							0,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("columnar.enable_bloom_filter",
+							 gettext_noop("Enables building bloom filters for column "
+										  "chunks."),
+							 gettext_noop("When enabled, a bloom filter of the values of "
+										  "each column chunk with a hashable type is "
+										  "stored in the chunk metadata, and is used to "
+										  "skip chunk groups for equality and IN filters. "
+										  "Existing chunks are not changed."),
+							 &columnar_enable_bloom_filter,
+							 false,
+							 PGC_USERSET,
+							 GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("columnar.enable_chunk_encoding",
+							 gettext_noop("Enables dictionary and run-length encoding "
+										  "of column chunks."),
+							 gettext_noop("When enabled, the values of each column chunk "
+										  "are dictionary or run-length encoded before "
+										  "compression if that takes less space. Existing "
+										  "chunks are not changed."),
+							 &columnar_enable_chunk_encoding,
+							 false,
+							 PGC_USERSET,
+							 GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("columnar.enable_vectorized_filter",
+							 gettext_noop("Enables evaluating simple pushed down "
+										  "filters over decompressed column vectors."),
+							 gettext_noop("When enabled, filters in the form of "
+										  "\"column operator constant\" are evaluated "
+										  "for all rows of a chunk group at once, and "
+										  "the rows that don't satisfy them are skipped "
+										  "without forming a tuple."),
+							 &columnar_enable_vectorized_filter,
+							 false,
+							 PGC_USERSET,
+							 GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
+	DefineCustomIntVariable("columnar.chunk_cache_size",
+							gettext_noop("Size of the shared memory cache of "
+										 "decompressed column chunks."),
+							gettext_noop("When set to a positive value, the decompressed "
+										 "values of the compressed column chunks that "
+										 "are read are kept in a cache that is shared by "
+										 "all backends, and least recently used chunks "
+										 "are evicted when it's full. Requires citus or "
+										 "citus_columnar to be in "
+										 "shared_preload_libraries."),
+							&columnar_chunk_cache_size,
+							0,
+							0,
+							MAX_KILOBYTES,
+							PGC_POSTMASTER,
+							GUC_UNIT_KB | GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("columnar.stat_scans_max",
+							gettext_noop("Maximum number of relations whose scan "
+										 "statistics are kept in columnar.stat_scans."),
+							gettext_noop("The scans of the relations that don't fit "
+										 "are not recorded. Setting it to 0 disables "
+										 "the statistics. Requires citus or "
+										 "citus_columnar to be in "
+										 "shared_preload_libraries."),
+							&columnar_stat_scans_max,
+							1000,
+							0,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	DefineCustomRealVariable("columnar.vacuum_compaction_threshold",
+							 gettext_noop("Fraction of deleted rows above which VACUUM "
+										  "rewrites a columnar stripe."),
+							 gettext_noop("VACUUM rewrites the live rows of the stripes "
+										  "in which at least this fraction of the rows "
+										  "are deleted into new stripes, so that the "
+										  "deleted rows are no longer read. Setting it "
+										  "to 0 disables the compaction."),
+							 &columnar_vacuum_compaction_threshold,
+							 0.2,
+							 0.0,
+							 1.0,
+							 PGC_USERSET,
+							 GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 }
 
 
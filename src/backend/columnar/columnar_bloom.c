@@ -0,0 +1,155 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_bloom.c
+ *
+ * This file contains the functions to build and probe the bloom filters
+ * that are stored in the skip list of column chunks.
+ *
+ * A chunk bloom filter is built from the hashes of the values in the chunk,
+ * computed by the hash function of the column type's default hash operator
+ * class. The filter has a power of two number of bits, which lets us fold it
+ * in half as long as it stays sparse, so chunks with few distinct values get
+ * small filters without counting the distinct values up front.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "port/pg_bitutils.h"
+
+#include "pg_version_constants.h"
+
+#if PG_VERSION_NUM >= PG_VERSION_16
+#include "varatt.h"
+#endif
+
+#include "columnar/columnar_bloom.h"
+
+
+/* the serialized bloom filter, stored as the data of a bytea */
+typedef struct ChunkBloomFilterData
+{
+	uint32 hashCount;
+	uint8 bitmap[FLEXIBLE_ARRAY_MEMBER];
+} ChunkBloomFilterData;
+
+/* smallest bloom filter we build, in bits */
+#define CHUNK_BLOOM_FILTER_MIN_BITS 64
+
+/* largest bloom filter we build, in bits */
+#define CHUNK_BLOOM_FILTER_MAX_BITS (1 << 20)
+
+
+static uint32 BloomFilterBitIndex(uint32 hash, uint32 hashIndex, uint32 bitCount);
+
+
+/*
+ * BuildChunkBloomFilter builds a bloom filter for given value hashes and
+ * returns it as a bytea, or returns NULL if there are no hashes.
+ */
+bytea *
+BuildChunkBloomFilter(uint32 *hashArray, uint32 hashCount)
+{
+	if (hashCount == 0)
+	{
+		return NULL;
+	}
+
+	uint64 requiredBitCount = (uint64) hashCount * CHUNK_BLOOM_FILTER_BITS_PER_VALUE;
+	uint32 bitCount = CHUNK_BLOOM_FILTER_MIN_BITS;
+	while (bitCount < requiredBitCount && bitCount < CHUNK_BLOOM_FILTER_MAX_BITS)
+	{
+		bitCount *= 2;
+	}
+
+	uint8 *bitmap = palloc0(bitCount / BITS_PER_BYTE);
+	for (uint32 valueIndex = 0; valueIndex < hashCount; valueIndex++)
+	{
+		for (uint32 hashIndex = 0; hashIndex < CHUNK_BLOOM_FILTER_HASH_COUNT; hashIndex++)
+		{
+			uint32 bitIndex = BloomFilterBitIndex(hashArray[valueIndex], hashIndex,
+												  bitCount);
+			bitmap[bitIndex / BITS_PER_BYTE] |= (1 << (bitIndex % BITS_PER_BYTE));
+		}
+	}
+
+	/*
+	 * If the chunk has many duplicate values, the filter is sparse. Fold it
+	 * in half while at most a quarter of the bits are set, which keeps the
+	 * fraction of set bits below a half. Bit indexes are computed modulo
+	 * the bit count, so bit i of the folded filter is the union of bits i
+	 * and i + bitCount / 2 of the original filter.
+	 */
+	while (bitCount > CHUNK_BLOOM_FILTER_MIN_BITS &&
+		   pg_popcount((char *) bitmap, bitCount / BITS_PER_BYTE) * 4 <= bitCount)
+	{
+		uint32 halfByteCount = bitCount / BITS_PER_BYTE / 2;
+		for (uint32 byteIndex = 0; byteIndex < halfByteCount; byteIndex++)
+		{
+			bitmap[byteIndex] |= bitmap[byteIndex + halfByteCount];
+		}
+
+		bitCount /= 2;
+	}
+
+	uint32 dataSize = offsetof(ChunkBloomFilterData, bitmap) + bitCount / BITS_PER_BYTE;
+	bytea *bloomFilter = palloc0(VARHDRSZ + dataSize);
+	SET_VARSIZE(bloomFilter, VARHDRSZ + dataSize);
+
+	ChunkBloomFilterData *bloomFilterData = (ChunkBloomFilterData *) VARDATA(bloomFilter);
+	bloomFilterData->hashCount = CHUNK_BLOOM_FILTER_HASH_COUNT;
+	memcpy(bloomFilterData->bitmap, bitmap, bitCount / BITS_PER_BYTE); /* IGNORE-BANNED */
+
+	pfree(bitmap);
+
+	return bloomFilter;
+}
+
+
+/*
+ * ChunkBloomFilterMightContain returns false if the chunk that given bloom
+ * filter was built for certainly doesn't have a value with the given hash.
+ */
+bool
+ChunkBloomFilterMightContain(bytea *bloomFilter, uint32 hash)
+{
+	uint32 dataSize = VARSIZE_ANY_EXHDR(bloomFilter);
+	if (dataSize <= offsetof(ChunkBloomFilterData, bitmap))
+	{
+		/* malformed filter, don't skip the chunk */
+		return true;
+	}
+
+	ChunkBloomFilterData *bloomFilterData =
+		(ChunkBloomFilterData *) VARDATA_ANY(bloomFilter);
+	uint32 bitCount = (dataSize - offsetof(ChunkBloomFilterData, bitmap)) *
+					  BITS_PER_BYTE;
+
+	for (uint32 hashIndex = 0; hashIndex < bloomFilterData->hashCount; hashIndex++)
+	{
+		uint32 bitIndex = BloomFilterBitIndex(hash, hashIndex, bitCount);
+		if ((bloomFilterData->bitmap[bitIndex / BITS_PER_BYTE] &
+			 (1 << (bitIndex % BITS_PER_BYTE))) == 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * BloomFilterBitIndex returns the bit that the hashIndex'th hash function
+ * maps the given value hash to, using double hashing.
+ */
+static uint32
+BloomFilterBitIndex(uint32 hash, uint32 hashIndex, uint32 bitCount)
+{
+	uint32 secondHash = murmurhash32(hash) | 1;
+
+	return (hash + hashIndex * secondHash) % bitCount;
+}
@@ -0,0 +1,502 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_chunk_cache.c
+ *
+ * This file contains the shared memory cache of decompressed column chunks.
+ *
+ * The cache memory is divided into fixed size blocks, and the decompressed
+ * values of a column chunk are stored in a chain of blocks. Cached chunks are
+ * found by using a shared hash table, and are kept in a list ordered by their
+ * last access, from which the least recently used ones are evicted when we
+ * need blocks for a new chunk. All accesses are serialized by a single lock,
+ * which is held only while copying a chunk into or out of the cache.
+ *
+ * Since stripe ids are never reused within a storage, a cached chunk never
+ * becomes stale. We still drop the chunks of a storage when it's truncated,
+ * since the stripes they belong to don't exist anymore.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "safe_lib.h"
+
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "lib/ilist.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/hsearch.h"
+
+#include "pg_version_constants.h"
+
+#include "columnar/columnar.h"
+#include "columnar/columnar_chunk_cache.h"
+
+#define CHUNK_CACHE_SHARED_MEM_NAME "Columnar Chunk Cache"
+#define CHUNK_CACHE_HASH_NAME "Columnar Chunk Cache Hash"
+#define CHUNK_CACHE_TRANCHE_NAME "columnar_chunk_cache"
+
+/* size of the blocks that the cache memory is divided into */
+#define CHUNK_CACHE_BLOCK_SIZE 8192
+
+/* a single chunk can't take more than this fraction of the cache */
+#define CHUNK_CACHE_MAX_ENTRY_FRACTION 4
+
+#define INVALID_CHUNK_CACHE_BLOCK (-1)
+
+/* a cached chunk, which is also the entry of the shared hash table */
+typedef struct ColumnarChunkCacheEntry
+{
+	ColumnarChunkCacheKey key; /* hash key, must be first */
+
+	/* position in the LRU list */
+	dlist_node lruNode;
+
+	uint32 valueSize;
+	uint32 blockCount;
+	int32 firstBlock;
+} ColumnarChunkCacheEntry;
+
+typedef struct ColumnarChunkCacheSharedState
+{
+	LWLock *lock;
+
+	/* cached chunks, from the most recently used to the least */
+	dlist_head lruList;
+
+	uint32 blockCount;
+	uint32 freeBlockCount;
+	int32 freeBlockHead;
+
+	uint64 entryCount;
+	uint64 hits;
+	uint64 misses;
+	uint64 evictions;
+} ColumnarChunkCacheSharedState;
+
+/* saved hook values in case of unload */
+#if PG_VERSION_NUM >= PG_VERSION_15
+static shmem_request_hook_type PrevShmemRequestHook = NULL;
+#endif
+static shmem_startup_hook_type PrevShmemStartupHook = NULL;
+
+/* links to the shared memory state, which are NULL if the cache is disabled */
+static ColumnarChunkCacheSharedState *ChunkCacheState = NULL;
+static HTAB *ChunkCacheHash = NULL;
+
+/* NextBlockArray[i] is the block after i-th block in its chain, or in the free list */
+static int32 *NextBlockArray = NULL;
+static char *BlockData = NULL;
+
+static uint32 ChunkCacheBlockCount(void);
+static Size ChunkCacheShmemSize(void);
+static void ColumnarChunkCacheShmemRequest(void);
+static void ColumnarChunkCacheShmemStartup(void);
+static void RemoveChunkCacheEntry(ColumnarChunkCacheEntry *entry);
+
+PG_FUNCTION_INFO_V1(columnar_chunk_cache_stats);
+
+
+/*
+ * ColumnarChunkCacheInit installs the hooks to allocate the shared memory of
+ * the cache, if it's enabled and we are being loaded at postmaster start.
+ */
+void
+ColumnarChunkCacheInit(void)
+{
+	if (!process_shared_preload_libraries_in_progress || ChunkCacheBlockCount() == 0)
+	{
+		return;
+	}
+
+#if PG_VERSION_NUM >= PG_VERSION_15
+	PrevShmemRequestHook = shmem_request_hook;
+	shmem_request_hook = ColumnarChunkCacheShmemRequest;
+#else
+	ColumnarChunkCacheShmemRequest();
+#endif
+
+	PrevShmemStartupHook = shmem_startup_hook;
+	shmem_startup_hook = ColumnarChunkCacheShmemStartup;
+}
+
+
+/*
+ * ColumnarChunkCacheEnabled returns true if the cache is available.
+ */
+bool
+ColumnarChunkCacheEnabled(void)
+{
+	return ChunkCacheState != NULL;
+}
+
+
+/*
+ * ChunkCacheBlockCount returns the number of blocks in the cache.
+ */
+static uint32
+ChunkCacheBlockCount(void)
+{
+	return ((uint64) columnar_chunk_cache_size * 1024) / CHUNK_CACHE_BLOCK_SIZE;
+}
+
+
+/*
+ * ChunkCacheShmemSize returns the size of the shared memory that the cache
+ * needs.
+ */
+static Size
+ChunkCacheShmemSize(void)
+{
+	uint32 blockCount = ChunkCacheBlockCount();
+
+	Size size = MAXALIGN(sizeof(ColumnarChunkCacheSharedState));
+	size = add_size(size, MAXALIGN(mul_size(blockCount, sizeof(int32))));
+	size = add_size(size, mul_size(blockCount, CHUNK_CACHE_BLOCK_SIZE));
+
+	/* each cached chunk takes at least one block */
+	size = add_size(size, hash_estimate_size(blockCount,
+											 sizeof(ColumnarChunkCacheEntry)));
+
+	return size;
+}
+
+
+/*
+ * ColumnarChunkCacheShmemRequest requests the shared memory and the lock
+ * that the cache needs.
+ */
+static void
+ColumnarChunkCacheShmemRequest(void)
+{
+#if PG_VERSION_NUM >= PG_VERSION_15
+	if (PrevShmemRequestHook)
+	{
+		PrevShmemRequestHook();
+	}
+#endif
+
+	RequestAddinShmemSpace(ChunkCacheShmemSize());
+	RequestNamedLWLockTranche(CHUNK_CACHE_TRANCHE_NAME, 1);
+}
+
+
+/*
+ * ColumnarChunkCacheShmemStartup creates or attaches to the shared memory of
+ * the cache.
+ */
+static void
+ColumnarChunkCacheShmemStartup(void)
+{
+	if (PrevShmemStartupHook)
+	{
+		PrevShmemStartupHook();
+	}
+
+	uint32 blockCount = ChunkCacheBlockCount();
+	bool found = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	char *sharedMemory = ShmemInitStruct(CHUNK_CACHE_SHARED_MEM_NAME,
+										 MAXALIGN(sizeof(ColumnarChunkCacheSharedState)) +
+										 MAXALIGN(blockCount * sizeof(int32)) +
+										 (Size) blockCount * CHUNK_CACHE_BLOCK_SIZE,
+										 &found);
+
+	ChunkCacheState = (ColumnarChunkCacheSharedState *) sharedMemory;
+	NextBlockArray = (int32 *) (sharedMemory +
+								MAXALIGN(sizeof(ColumnarChunkCacheSharedState)));
+	BlockData = sharedMemory + MAXALIGN(sizeof(ColumnarChunkCacheSharedState)) +
+				MAXALIGN(blockCount * sizeof(int32));
+
+	if (!found)
+	{
+		ChunkCacheState->lock = &(GetNamedLWLockTranche(CHUNK_CACHE_TRANCHE_NAME))->lock;
+		dlist_init(&ChunkCacheState->lruList);
+		ChunkCacheState->blockCount = blockCount;
+		ChunkCacheState->freeBlockCount = blockCount;
+		ChunkCacheState->freeBlockHead = blockCount > 0 ? 0 : INVALID_CHUNK_CACHE_BLOCK;
+		ChunkCacheState->entryCount = 0;
+		ChunkCacheState->hits = 0;
+		ChunkCacheState->misses = 0;
+		ChunkCacheState->evictions = 0;
+
+		/* initially, all blocks are in the free list */
+		for (uint32 blockIndex = 0; blockIndex < blockCount; blockIndex++)
+		{
+			NextBlockArray[blockIndex] = (blockIndex + 1 < blockCount) ?
+										 (int32) (blockIndex + 1) :
+										 INVALID_CHUNK_CACHE_BLOCK;
+		}
+	}
+
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(ColumnarChunkCacheKey);
+	info.entrysize = sizeof(ColumnarChunkCacheEntry);
+
+	ChunkCacheHash = ShmemInitHash(CHUNK_CACHE_HASH_NAME,
+								   blockCount, blockCount,
+								   &info, HASH_ELEM | HASH_BLOBS);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+/*
+ * ColumnarChunkCacheLookup returns a copy of the decompressed values of the
+ * column chunk with the given key, or NULL if it isn't cached.
+ */
+StringInfo
+ColumnarChunkCacheLookup(ColumnarChunkCacheKey *key)
+{
+	if (!ColumnarChunkCacheEnabled())
+	{
+		return NULL;
+	}
+
+	LWLockAcquire(ChunkCacheState->lock, LW_EXCLUSIVE);
+
+	ColumnarChunkCacheEntry *entry = hash_search(ChunkCacheHash, key, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		ChunkCacheState->misses++;
+		LWLockRelease(ChunkCacheState->lock);
+		return NULL;
+	}
+
+	ChunkCacheState->hits++;
+	dlist_move_head(&ChunkCacheState->lruList, &entry->lruNode);
+
+	/* enlarging also makes room for the terminating null byte */
+	StringInfo valueBuffer = makeStringInfo();
+	enlargeStringInfo(valueBuffer, entry->valueSize);
+
+	uint32 remainingSize = entry->valueSize;
+	int32 blockIndex = entry->firstBlock;
+	while (remainingSize > 0)
+	{
+		uint32 copySize = Min(remainingSize, CHUNK_CACHE_BLOCK_SIZE);
+		char *block = BlockData + (Size) blockIndex * CHUNK_CACHE_BLOCK_SIZE;
+
+		memcpy_s(valueBuffer->data + valueBuffer->len, copySize, block, copySize);
+		valueBuffer->len += copySize;
+		remainingSize -= copySize;
+		blockIndex = NextBlockArray[blockIndex];
+	}
+
+	LWLockRelease(ChunkCacheState->lock);
+
+	valueBuffer->data[valueBuffer->len] = '\0';
+
+	return valueBuffer;
+}
+
+
+/*
+ * ColumnarChunkCacheInsert stores the given decompressed values of the column
+ * chunk with the given key, evicting the least recently used chunks to make
+ * room for it if needed. Chunks that would take a large part of the cache are
+ * not cached.
+ */
+void
+ColumnarChunkCacheInsert(ColumnarChunkCacheKey *key, StringInfo valueBuffer)
+{
+	if (!ColumnarChunkCacheEnabled() || valueBuffer->len == 0)
+	{
+		return;
+	}
+
+	uint32 blockCount = (valueBuffer->len + CHUNK_CACHE_BLOCK_SIZE - 1) /
+						CHUNK_CACHE_BLOCK_SIZE;
+	if (blockCount > ChunkCacheState->blockCount / CHUNK_CACHE_MAX_ENTRY_FRACTION)
+	{
+		return;
+	}
+
+	LWLockAcquire(ChunkCacheState->lock, LW_EXCLUSIVE);
+
+	bool found = false;
+	ColumnarChunkCacheEntry *entry = hash_search(ChunkCacheHash, key, HASH_FIND,
+												 &found);
+	if (found)
+	{
+		/* another backend cached the same chunk in the meantime */
+		LWLockRelease(ChunkCacheState->lock);
+		return;
+	}
+
+	while (ChunkCacheState->freeBlockCount < blockCount)
+	{
+		Assert(!dlist_is_empty(&ChunkCacheState->lruList));
+
+		ColumnarChunkCacheEntry *victim =
+			dlist_tail_element(ColumnarChunkCacheEntry, lruNode,
+							   &ChunkCacheState->lruList);
+		RemoveChunkCacheEntry(victim);
+		ChunkCacheState->evictions++;
+	}
+
+	/*
+	 * The hash table has room for an entry per block, and every cached chunk
+	 * takes at least one block, so the hash table can't be full here.
+	 */
+	entry = hash_search(ChunkCacheHash, key, HASH_ENTER_NULL, &found);
+	if (entry == NULL)
+	{
+		LWLockRelease(ChunkCacheState->lock);
+		return;
+	}
+
+	entry->valueSize = valueBuffer->len;
+	entry->blockCount = blockCount;
+	entry->firstBlock = ChunkCacheState->freeBlockHead;
+
+	uint32 remainingSize = valueBuffer->len;
+	int32 blockIndex = entry->firstBlock;
+	int32 lastBlockIndex = INVALID_CHUNK_CACHE_BLOCK;
+	while (remainingSize > 0)
+	{
+		uint32 copySize = Min(remainingSize, CHUNK_CACHE_BLOCK_SIZE);
+		char *block = BlockData + (Size) blockIndex * CHUNK_CACHE_BLOCK_SIZE;
+
+		memcpy_s(block, CHUNK_CACHE_BLOCK_SIZE,
+				 valueBuffer->data + (valueBuffer->len - remainingSize), copySize);
+		remainingSize -= copySize;
+		lastBlockIndex = blockIndex;
+		blockIndex = NextBlockArray[blockIndex];
+	}
+
+	/* detach the chain of the entry from the rest of the free list */
+	ChunkCacheState->freeBlockHead = blockIndex;
+	ChunkCacheState->freeBlockCount -= blockCount;
+	NextBlockArray[lastBlockIndex] = INVALID_CHUNK_CACHE_BLOCK;
+
+	dlist_push_head(&ChunkCacheState->lruList, &entry->lruNode);
+	ChunkCacheState->entryCount++;
+
+	LWLockRelease(ChunkCacheState->lock);
+}
+
+
+/*
+ * ColumnarChunkCacheInvalidateStorage removes the cached chunks of the
+ * storage with the given id.
+ */
+void
+ColumnarChunkCacheInvalidateStorage(uint64 storageId)
+{
+	if (!ColumnarChunkCacheEnabled())
+	{
+		return;
+	}
+
+	LWLockAcquire(ChunkCacheState->lock, LW_EXCLUSIVE);
+
+	HASH_SEQ_STATUS status;
+	hash_seq_init(&status, ChunkCacheHash);
+
+	ColumnarChunkCacheEntry *entry = NULL;
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		/* removing the entry that was just returned is allowed */
+		if (entry->key.storageId == storageId)
+		{
+			RemoveChunkCacheEntry(entry);
+		}
+	}
+
+	LWLockRelease(ChunkCacheState->lock);
+}
+
+
+/*
+ * RemoveChunkCacheEntry removes the given entry from the cache and returns
+ * its blocks to the free list. The caller should hold the lock in exclusive
+ * mode.
+ */
+static void
+RemoveChunkCacheEntry(ColumnarChunkCacheEntry *entry)
+{
+	int32 lastBlockIndex = entry->firstBlock;
+	while (NextBlockArray[lastBlockIndex] != INVALID_CHUNK_CACHE_BLOCK)
+	{
+		lastBlockIndex = NextBlockArray[lastBlockIndex];
+	}
+
+	NextBlockArray[lastBlockIndex] = ChunkCacheState->freeBlockHead;
+	ChunkCacheState->freeBlockHead = entry->firstBlock;
+	ChunkCacheState->freeBlockCount += entry->blockCount;
+	ChunkCacheState->entryCount--;
+
+	dlist_delete(&entry->lruNode);
+	hash_search(ChunkCacheHash, &entry->key, HASH_REMOVE, NULL);
+}
+
+
+/*
+ * columnar_chunk_cache_stats returns the size, usage and the hit / miss
+ * counters of the shared cache of decompressed column chunks.
+ */
+Datum
+columnar_chunk_cache_stats(PG_FUNCTION_ARGS)
+{
+	const int resultColumnCount = 6;
+
+	TupleDesc tupleDescriptor = CreateTemplateTupleDesc(resultColumnCount);
+
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 1, "cache_size",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 2, "used_size",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 3, "chunk_count",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 4, "hits",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 5, "misses",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 6, "evictions",
+					   INT8OID, -1, 0);
+
+	tupleDescriptor = BlessTupleDesc(tupleDescriptor);
+
+	bool nulls[6] = { false };
+	Datum values[6] = { 0 };
+
+	if (ColumnarChunkCacheEnabled())
+	{
+		LWLockAcquire(ChunkCacheState->lock, LW_SHARED);
+
+		uint64 usedBlockCount = ChunkCacheState->blockCount -
+								ChunkCacheState->freeBlockCount;
+
+		values[0] = Int64GetDatum((int64) ChunkCacheState->blockCount *
+								  CHUNK_CACHE_BLOCK_SIZE);
+		values[1] = Int64GetDatum(usedBlockCount * CHUNK_CACHE_BLOCK_SIZE);
+		values[2] = Int64GetDatum(ChunkCacheState->entryCount);
+		values[3] = Int64GetDatum(ChunkCacheState->hits);
+		values[4] = Int64GetDatum(ChunkCacheState->misses);
+		values[5] = Int64GetDatum(ChunkCacheState->evictions);
+
+		LWLockRelease(ChunkCacheState->lock);
+	}
+	else
+	{
+		for (int columnIndex = 0; columnIndex < resultColumnCount; columnIndex++)
+		{
+			values[columnIndex] = Int64GetDatum(0);
+		}
+	}
+
+	HeapTuple tuple = heap_form_tuple(tupleDescriptor, values, nulls);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
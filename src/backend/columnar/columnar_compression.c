@@ -19,6 +19,7 @@
 #include "citus_version.h"
 #include "pg_version_constants.h"
 
+#include "columnar/columnar.h"
 #include "columnar/columnar_compression.h"
 
 #if HAVE_CITUS_LIBLZ4
@@ -54,6 +55,19 @@ typedef struct ColumnarCompressHeader
 									  len) (((ColumnarCompressHeader *) (ptr))->rawsize = \
 												(len))
 
+#if HAVE_LIBZSTD && ZSTD_VERSION_NUMBER >= 10400
+
+/*
+ * Compression context that we use when columnar.compression_workers is set.
+ * We keep it around for the lifetime of the backend, so that zstd can reuse
+ * its worker threads and buffers across column chunks.
+ */
+static ZSTD_CCtx *ZstdCompressionContext = NULL;
+
+static size_t ZstdCompressWithWorkers(StringInfo inputBuffer, StringInfo outputBuffer,
+									  int compressionLevel, int workerCount);
+#endif
+
 
 /*
  * CompressBuffer compresses the given buffer with the given compression type
@@ -104,11 +118,23 @@ CompressBuffer(StringInfo inputBuffer,
 			resetStringInfo(outputBuffer);
 			enlargeStringInfo(outputBuffer, maximumLength);
 
-			size_t compressedSize = ZSTD_compress(outputBuffer->data,
-												  outputBuffer->maxlen,
-												  inputBuffer->data,
-												  inputBuffer->len,
-												  compressionLevel);
+			size_t compressedSize = 0;
+#if ZSTD_VERSION_NUMBER >= 10400
+			if (columnar_compression_workers > 0)
+			{
+				compressedSize = ZstdCompressWithWorkers(inputBuffer, outputBuffer,
+														 compressionLevel,
+														 columnar_compression_workers);
+			}
+			else
+#endif
+			{
+				compressedSize = ZSTD_compress(outputBuffer->data,
+											   outputBuffer->maxlen,
+											   inputBuffer->data,
+											   inputBuffer->len,
+											   compressionLevel);
+			}
 
 			if (ZSTD_isError(compressedSize))
 			{
@@ -270,3 +296,57 @@ DecompressBuffer(StringInfo buffer,
 		}
 	}
 }
+
+
+#if HAVE_LIBZSTD && ZSTD_VERSION_NUMBER >= 10400
+
+/*
+ * ZstdCompressWithWorkers compresses given buffer into outputBuffer, which
+ * should already be large enough, using zstd's multithreaded compression
+ * with given number of worker threads and returns the compressed size, or
+ * an error code that can be checked with ZSTD_isError.
+ *
+ * zstd splits the input into jobs that are compressed concurrently, and the
+ * call blocks until the whole frame is produced. The worker threads only use
+ * memory that zstd allocates itself, similar to the server-side zstd backup
+ * compression of PostgreSQL. If the library is built without multithreading
+ * support, we silently fall back to single-threaded compression.
+ */
+static size_t
+ZstdCompressWithWorkers(StringInfo inputBuffer, StringInfo outputBuffer,
+						int compressionLevel, int workerCount)
+{
+	if (ZstdCompressionContext == NULL)
+	{
+		ZstdCompressionContext = ZSTD_createCCtx();
+		if (ZstdCompressionContext == NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_OUT_OF_MEMORY),
+							errmsg("out of memory"),
+							errdetail("could not create zstd compression context")));
+		}
+	}
+
+	ZSTD_CCtx *compressionContext = ZstdCompressionContext;
+	ZSTD_CCtx_reset(compressionContext, ZSTD_reset_session_and_parameters);
+
+	size_t result = ZSTD_CCtx_setParameter(compressionContext, ZSTD_c_compressionLevel,
+										   compressionLevel);
+	if (ZSTD_isError(result))
+	{
+		return result;
+	}
+
+	result = ZSTD_CCtx_setParameter(compressionContext, ZSTD_c_nbWorkers, workerCount);
+	if (ZSTD_isError(result))
+	{
+		elog(DEBUG1, "zstd does not support multithreaded compression: %s",
+			 ZSTD_getErrorName(result));
+	}
+
+	return ZSTD_compress2(compressionContext, outputBuffer->data, outputBuffer->maxlen,
+						  inputBuffer->data, inputBuffer->len);
+}
+
+
+#endif
@@ -17,31 +17,46 @@
 #include "miscadmin.h"
 
 #include "access/amapi.h"
+#include "access/htup_details.h"
+#include "access/nbtree.h"
+#include "access/parallel.h"
 #include "access/skey.h"
+#include "access/tableam.h"
+#include "access/xact.h"
+#include "catalog/pg_aggregate.h"
 #include "catalog/pg_am.h"
 #include "catalog/pg_statistic.h"
 #include "commands/defrem.h"
+#include "executor/executor.h"
 #include "nodes/extensible.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/pg_list.h"
 #include "nodes/plannodes.h"
+#include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/plancat.h"
+#include "optimizer/planner.h"
 #include "optimizer/restrictinfo.h"
+#include "optimizer/tlist.h"
 #if PG_VERSION_NUM >= PG_VERSION_16
 #include "parser/parse_relation.h"
 #include "parser/parsetree.h"
 #endif
 #include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/relcache.h"
 #include "utils/ruleutils.h"
 #include "utils/selfuncs.h"
+#include "utils/snapmgr.h"
 #include "utils/spccache.h"
+#include "utils/syscache.h"
 
 #include "citus_version.h"
 
@@ -62,9 +77,84 @@ typedef struct ColumnarScanState
 
 	ExprContext *css_RuntimeContext;
 	List *qual;
+
+	/* shared state of a parallel scan, NULL if this is not a parallel scan */
+	ParallelTableScanDesc parallelScan;
 } ColumnarScanState;
 
 
+/*
+ * ColumnarAggregateType is the type of an aggregate that ColumnarAggregateScan
+ * can compute by using the statistics in the skip lists. We use
+ * COLUMNAR_AGGREGATE_NONE for the entries of custom_scan_tlist that are not
+ * aggregates but columns referenced by the quals.
+ */
+typedef enum ColumnarAggregateType
+{
+	COLUMNAR_AGGREGATE_NONE = 0,
+	COLUMNAR_AGGREGATE_COUNT = 1,
+	COLUMNAR_AGGREGATE_MIN = 2,
+	COLUMNAR_AGGREGATE_MAX = 3
+} ColumnarAggregateType;
+
+/*
+ * ColumnarAggregate is the state of an aggregate computed by
+ * ColumnarAggregateScan.
+ */
+typedef struct ColumnarAggregate
+{
+	ColumnarAggregateType type;
+
+	/* 0-indexed position of the aggregate in the scan tuple */
+	int scanIndex;
+
+	/* 0-indexed attribute number of the aggregated column, for min / max */
+	int columnIndex;
+	FmgrInfo *comparisonFunction;
+	Oid collation;
+	bool typeByValue;
+	int typeLength;
+
+	Datum value;
+	bool isNull;
+} ColumnarAggregate;
+
+/*
+ * ColumnarAggregateScanState represents the state for a columnar aggregate
+ * scan, which computes count(*), min() and max() aggregates by using the
+ * skip lists for the chunk groups that all rows of which satisfy the quals,
+ * and by reading the rest of the chunk groups that are not refuted by the
+ * quals.
+ */
+typedef struct ColumnarAggregateScanState
+{
+	CustomScanState custom_scanstate; /* must be first field */
+
+	List *aggregateList;
+
+	/* quals referencing the scan tuple, and the columns of the relation */
+	ExprState *qual;
+	List *columnQual;
+
+	/*
+	 * scanColumnIndexArray[i] is the 0-indexed attribute number of the column
+	 * that i-th attribute of the scan tuple references, or -1 if it's an
+	 * aggregate.
+	 */
+	int *scanColumnIndexArray;
+	List *projectedColumnList;
+
+	MemoryContext scanContext;
+	ColumnarReadState *readState;
+	bool finished;
+
+	int64 rowCount;
+	int64 chunkGroupsAnswered;
+	int64 chunkGroupsRead;
+	int64 chunkGroupsFiltered;
+} ColumnarAggregateScanState;
+
+
 typedef bool (*PathPredicate)(Path *path);
 
 
@@ -72,6 +162,8 @@ typedef bool (*PathPredicate)(Path *path);
 static void CostColumnarPaths(PlannerInfo *root, RelOptInfo *rel, Oid relationId);
 static void CostColumnarIndexPath(PlannerInfo *root, RelOptInfo *rel, Oid relationId,
 								  IndexPath *indexPath);
+static void CostColumnarBitmapHeapPath(RelOptInfo *rel, Oid relationId,
+									   BitmapHeapPath *bitmapHeapPath);
 static void CostColumnarSeqPath(RelOptInfo *rel, Oid relationId, Path *path);
 static void CostColumnarScan(PlannerInfo *root, RelOptInfo *rel, Oid relationId,
 							 CustomPath *cpath, int numberOfColumnsRead,
@@ -82,16 +174,22 @@ static void AddColumnarScanPaths(PlannerInfo *root, RelOptInfo *rel,
 								 RangeTblEntry *rte);
 static void AddColumnarScanPath(PlannerInfo *root, RelOptInfo *rel,
 								RangeTblEntry *rte, Relids required_relids);
+static void AddColumnarScanPartialPath(PlannerInfo *root, RelOptInfo *rel,
+									   RangeTblEntry *rte, Relation relation);
+static CustomPath * CreateColumnarScanPath(PlannerInfo *root, RelOptInfo *rel,
+										   RangeTblEntry *rte, Relids paramRelids);
 
 /* helper functions to be used when costing paths or altering them */
 static void RemovePathsByPredicate(RelOptInfo *rel, PathPredicate removePathPredicate);
-static bool IsNotIndexPath(Path *path);
+static bool IsNotIndexOrBitmapHeapPath(Path *path);
 static Cost ColumnarIndexScanAdditionalCost(PlannerInfo *root, RelOptInfo *rel,
 											Oid relationId, IndexPath *indexPath);
 static int RelationIdGetNumberOfAttributes(Oid relationId);
 static Cost ColumnarPerStripeScanCost(RelOptInfo *rel, Oid relationId,
 									  int numberOfColumnsRead);
 static uint64 ColumnarTableStripeCount(Oid relationId);
+static int ColumnarParallelWorkers(RelOptInfo *rel, Relation relation);
+static double ColumnarParallelDivisor(Path *path);
 static Path * CreateColumnarSeqScanPath(PlannerInfo *root, RelOptInfo *rel,
 										Oid relationId);
 static void AddColumnarScanPathsRec(PlannerInfo *root, RelOptInfo *rel,
@@ -102,6 +200,9 @@ static void AddColumnarScanPathsRec(PlannerInfo *root, RelOptInfo *rel,
 /* hooks and callbacks */
 static void ColumnarSetRelPathlistHook(PlannerInfo *root, RelOptInfo *rel, Index rti,
 									   RangeTblEntry *rte);
+static void ColumnarCreateUpperPathsHook(PlannerInfo *root, UpperRelationKind stage,
+										 RelOptInfo *input_rel, RelOptInfo *output_rel,
+										 void *extra);
 static void ColumnarGetRelationInfoHook(PlannerInfo *root, Oid relationObjectId,
 										bool inhparent, RelOptInfo *rel);
 static Plan * ColumnarScanPath_PlanCustomPath(PlannerInfo *root,
@@ -122,6 +223,18 @@ static void ColumnarScan_EndCustomScan(CustomScanState *node);
 static void ColumnarScan_ReScanCustomScan(CustomScanState *node);
 static void ColumnarScan_ExplainCustomScan(CustomScanState *node, List *ancestors,
 										   ExplainState *es);
+static void ColumnarExplainScanStats(ColumnarScanStats *scanStats, ExplainState *es);
+static Size ColumnarScan_EstimateDSMCustomScan(CustomScanState *node,
+											   ParallelContext *pcxt);
+static void ColumnarScan_InitializeDSMCustomScan(CustomScanState *node,
+												 ParallelContext *pcxt,
+												 void *coordinate);
+static void ColumnarScan_ReInitializeDSMCustomScan(CustomScanState *node,
+												   ParallelContext *pcxt,
+												   void *coordinate);
+static void ColumnarScan_InitializeWorkerCustomScan(CustomScanState *node,
+													shm_toc *toc,
+													void *coordinate);
 
 /* helper functions to build strings for EXPLAIN */
 static const char * ColumnarPushdownClausesStr(List *context, List *clauses);
@@ -133,6 +246,40 @@ static List * set_deparse_context_planstate(List *dpcontext, Node *node,
 /* other helpers */
 static List * ColumnarVarNeeded(ColumnarScanState *columnarScanState);
 static Bitmapset * ColumnarAttrNeeded(ScanState *ss);
+static TableScanDesc ColumnarBeginParallelScan(ColumnarScanState *columnarScanState,
+											   ParallelTableScanDesc parallelScan);
+
+/* functions for aggregate pushdown */
+static void AddColumnarAggregatePath(PlannerInfo *root, RelOptInfo *input_rel,
+									 RelOptInfo *output_rel,
+									 GroupPathExtraData *extra);
+static ColumnarAggregateType ColumnarAggregateTypeForAggref(Aggref *aggref,
+															Index relid);
+static Plan * ColumnarAggregatePath_PlanCustomPath(PlannerInfo *root,
+												   RelOptInfo *rel,
+												   struct CustomPath *best_path,
+												   List *tlist,
+												   List *clauses,
+												   List *custom_plans);
+static Node * ColumnarAggregateScan_CreateCustomScanState(CustomScan *cscan);
+static void ColumnarAggregateScan_BeginCustomScan(CustomScanState *node,
+												  EState *estate, int eflags);
+static TupleTableSlot * ColumnarAggregateScan_ExecCustomScan(CustomScanState *node);
+static void ColumnarAggregateScan_EndCustomScan(CustomScanState *node);
+static void ColumnarAggregateScan_ReScanCustomScan(CustomScanState *node);
+static void ColumnarAggregateScan_ExplainCustomScan(CustomScanState *node,
+													List *ancestors,
+													ExplainState *es);
+static Node * ScanTupleVarToColumnMutator(Node *node, List *customScanTargetList);
+static TupleTableSlot * ColumnarAggregateScanNext(ColumnarAggregateScanState *state);
+static bool ColumnarAggregateScanRecheck(ColumnarAggregateScanState *state,
+										 TupleTableSlot *slot);
+static bool ColumnarAggregateChunkGroupCallback(StripeSkipList *stripeSkipList,
+												uint32 chunkIndex, bool allRowsMatch,
+												void *callbackState);
+static void AdvanceColumnarAggregate(ColumnarAggregateScanState *state,
+									 ColumnarAggregate *aggregate,
+									 Datum minimumValue, Datum maximumValue);
 #if PG_VERSION_NUM >= PG_VERSION_16
 static Bitmapset * fixup_inherited_columns(Oid parentId, Oid childId, Bitmapset *columns);
 #endif
@@ -140,11 +287,14 @@ static Bitmapset * fixup_inherited_columns(Oid parentId, Oid childId, Bitmapset
 /* saved hook value in case of unload */
 static set_rel_pathlist_hook_type PreviousSetRelPathlistHook = NULL;
 static get_relation_info_hook_type PreviousGetRelationInfoHook = NULL;
+static create_upper_paths_hook_type PreviousCreateUpperPathsHook = NULL;
 
 static bool EnableColumnarCustomScan = true;
 static bool EnableColumnarQualPushdown = true;
 static double ColumnarQualPushdownCorrelationThreshold = 0.9;
 static int ColumnarMaxCustomScanPaths = 64;
+static bool EnableColumnarParallelScan = false;
+static bool EnableColumnarAggregatePushdown = false;
 static int ColumnarPlannerDebugLevel = DEBUG3;
 
 
@@ -168,6 +318,32 @@ const struct CustomExecMethods ColumnarScanExecuteMethods = {
 	.ReScanCustomScan = ColumnarScan_ReScanCustomScan,
 
 	.ExplainCustomScan = ColumnarScan_ExplainCustomScan,
+
+	.EstimateDSMCustomScan = ColumnarScan_EstimateDSMCustomScan,
+	.InitializeDSMCustomScan = ColumnarScan_InitializeDSMCustomScan,
+	.ReInitializeDSMCustomScan = ColumnarScan_ReInitializeDSMCustomScan,
+	.InitializeWorkerCustomScan = ColumnarScan_InitializeWorkerCustomScan,
+};
+
+const struct CustomPathMethods ColumnarAggregatePathMethods = {
+	.CustomName = "ColumnarAggregateScan",
+	.PlanCustomPath = ColumnarAggregatePath_PlanCustomPath,
+};
+
+const struct CustomScanMethods ColumnarAggregateScanMethods = {
+	.CustomName = "ColumnarAggregateScan",
+	.CreateCustomScanState = ColumnarAggregateScan_CreateCustomScanState,
+};
+
+const struct CustomExecMethods ColumnarAggregateExecuteMethods = {
+	.CustomName = "ColumnarAggregateScan",
+
+	.BeginCustomScan = ColumnarAggregateScan_BeginCustomScan,
+	.ExecCustomScan = ColumnarAggregateScan_ExecCustomScan,
+	.EndCustomScan = ColumnarAggregateScan_EndCustomScan,
+	.ReScanCustomScan = ColumnarAggregateScan_ReScanCustomScan,
+
+	.ExplainCustomScan = ColumnarAggregateScan_ExplainCustomScan,
 };
 
 static const struct config_enum_entry debug_level_options[] = {
@@ -198,6 +374,9 @@ columnar_customscan_init()
 	PreviousGetRelationInfoHook = get_relation_info_hook;
 	get_relation_info_hook = ColumnarGetRelationInfoHook;
 
+	PreviousCreateUpperPathsHook = create_upper_paths_hook;
+	create_upper_paths_hook = ColumnarCreateUpperPathsHook;
+
 	/* register customscan specific GUC's */
 	DefineCustomBoolVariable(
 		"columnar.enable_custom_scan",
@@ -245,6 +424,28 @@ columnar_customscan_init()
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
+	DefineCustomBoolVariable(
+		"columnar.enable_parallel_scan",
+		gettext_noop("Enables parallel scans on columnar tables, where parallel "
+					 "workers claim stripes to read. This has no effect unless "
+					 "columnar.enable_custom_scan is true."),
+		NULL,
+		&EnableColumnarParallelScan,
+		false,
+		PGC_USERSET,
+		GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+	DefineCustomBoolVariable(
+		"columnar.enable_aggregate_pushdown",
+		gettext_noop("Enables computing count(*), min() and max() aggregates on "
+					 "columnar tables by using the chunk group statistics. This "
+					 "has no effect unless columnar.enable_custom_scan is true."),
+		NULL,
+		&EnableColumnarAggregatePushdown,
+		false,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
 	DefineCustomEnumVariable(
 		"columnar.planner_debug_level",
 		"Message level for columnar planning information.",
@@ -259,6 +460,7 @@ columnar_customscan_init()
 		NULL);
 
 	RegisterCustomScanMethods(&ColumnarScanScanMethods);
+	RegisterCustomScanMethods(&ColumnarAggregateScanMethods);
 }
 
 
@@ -293,8 +495,20 @@ ColumnarSetRelPathlistHook(PlannerInfo *root, RelOptInfo *rel, Index rti,
 	{
 		if (rte->tablesample != NULL)
 		{
-			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-							errmsg("sample scans not supported on columnar tables")));
+			/* sample scans are the only paths that postgres builds for those */
+			RelationClose(relation);
+			return;
+		}
+
+		RestrictInfo *restrictInfo = NULL;
+		foreach_ptr(restrictInfo, rel->baserestrictinfo)
+		{
+			if (IsA(restrictInfo->clause, CurrentOfExpr))
+			{
+				ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+								errmsg("WHERE CURRENT OF is not supported for "
+									   "columnar tables")));
+			}
 		}
 
 		if (list_length(rel->partial_pathlist) != 0)
@@ -328,8 +542,9 @@ ColumnarSetRelPathlistHook(PlannerInfo *root, RelOptInfo *rel, Index rti,
 
 			/*
 			 * When columnar custom scan is enabled (columnar.enable_custom_scan),
-			 * we only consider ColumnarScanPath's & IndexPath's. For this reason,
-			 * we remove other paths and re-estimate IndexPath costs to make accurate
+			 * we only consider ColumnarScanPath's, IndexPath's and
+			 * BitmapHeapPath's. For this reason, we remove other paths and
+			 * re-estimate the costs of the index paths to make accurate
 			 * comparisons between them.
 			 *
 			 * Even more, we might calculate an equal cost for a
@@ -339,14 +554,45 @@ ColumnarSetRelPathlistHook(PlannerInfo *root, RelOptInfo *rel, Index rti,
 			 * In that case, if we don't remove SeqPath's, we might wrongly choose
 			 * SeqPath thinking that its cost would be equal to ColumnarCustomScan.
 			 */
-			RemovePathsByPredicate(rel, IsNotIndexPath);
+			RemovePathsByPredicate(rel, IsNotIndexOrBitmapHeapPath);
 			AddColumnarScanPaths(root, rel, rte);
+
+			if (EnableColumnarParallelScan)
+			{
+				AddColumnarScanPartialPath(root, rel, rte, relation);
+			}
 		}
 	}
 	RelationClose(relation);
 }
 
 
+/*
+ * ColumnarCreateUpperPathsHook adds a ColumnarAggregateScan path for the
+ * aggregates on a columnar table that can be computed from the chunk group
+ * statistics, if columnar.enable_aggregate_pushdown is set.
+ */
+static void
+ColumnarCreateUpperPathsHook(PlannerInfo *root, UpperRelationKind stage,
+							 RelOptInfo *input_rel, RelOptInfo *output_rel,
+							 void *extra)
+{
+	if (PreviousCreateUpperPathsHook)
+	{
+		PreviousCreateUpperPathsHook(root, stage, input_rel, output_rel, extra);
+	}
+
+	if (stage != UPPERREL_GROUP_AGG || !EnableColumnarCustomScan ||
+		!EnableColumnarAggregatePushdown)
+	{
+		return;
+	}
+
+	AddColumnarAggregatePath(root, input_rel, output_rel,
+							 (GroupPathExtraData *) extra);
+}
+
+
 static void
 ColumnarGetRelationInfoHook(PlannerInfo *root, Oid relationObjectId,
 							bool inhparent, RelOptInfo *rel)
@@ -358,7 +604,11 @@ ColumnarGetRelationInfoHook(PlannerInfo *root, Oid relationObjectId,
 
 	if (IsColumnarTableAmTable(relationObjectId))
 	{
-		/* disable parallel query */
+		/*
+		 * Disable parallel query for the paths that postgres builds. Parallel
+		 * ColumnarScan paths are added separately by ColumnarSetRelPathlistHook
+		 * when columnar.enable_parallel_scan is set.
+		 */
 		rel->rel_parallel_workers = 0;
 
 		/* disable index-only scan */
@@ -394,12 +644,13 @@ RemovePathsByPredicate(RelOptInfo *rel, PathPredicate removePathPredicate)
 
 
 /*
- * IsNotIndexPath returns true if given path is not an IndexPath.
+ * IsNotIndexOrBitmapHeapPath returns true if given path is neither an
+ * IndexPath nor a BitmapHeapPath.
  */
 static bool
-IsNotIndexPath(Path *path)
+IsNotIndexOrBitmapHeapPath(Path *path)
 {
-	return !IsA(path, IndexPath);
+	return !IsA(path, IndexPath) && !IsA(path, BitmapHeapPath);
 }
 
 
@@ -432,15 +683,12 @@ CostColumnarPaths(PlannerInfo *root, RelOptInfo *rel, Oid relationId)
 	{
 		if (IsA(path, IndexPath))
 		{
-			/*
-			 * Since we don't provide implementations for scan_bitmap_next_block
-			 * & scan_bitmap_next_tuple, postgres doesn't generate bitmap index
-			 * scan paths for columnar tables already (see related comments in
-			 * TableAmRoutine). For this reason, we only consider IndexPath's
-			 * here.
-			 */
 			CostColumnarIndexPath(root, rel, relationId, (IndexPath *) path);
 		}
+		else if (IsA(path, BitmapHeapPath))
+		{
+			CostColumnarBitmapHeapPath(rel, relationId, (BitmapHeapPath *) path);
+		}
 		else if (path->pathtype == T_SeqScan)
 		{
 			CostColumnarSeqPath(rel, relationId, path);
@@ -579,6 +827,61 @@ ColumnarIndexScanAdditionalCost(PlannerInfo *root, RelOptInfo *rel,
 }
 
 
+/*
+ * CostColumnarBitmapHeapPath re-costs given bitmap heap path for columnar
+ * table with relationId.
+ *
+ * Bitmap heap scans read the rows in the order of their row numbers, so
+ * unlike index scans, they read each stripe at most once. Assuming that the
+ * rows in the bitmap are spread uniformly over the stripes, we estimate the
+ * number of stripes that contain at least one of them.
+ */
+static void
+CostColumnarBitmapHeapPath(RelOptInfo *rel, Oid relationId,
+						   BitmapHeapPath *bitmapHeapPath)
+{
+	if (!enable_bitmapscan)
+	{
+		/* costs are already set to disable_cost, don't adjust them */
+		return;
+	}
+
+	Cost indexTotalCost = 0;
+	Selectivity indexSelectivity = 0;
+	cost_bitmap_tree_node(bitmapHeapPath->bitmapqual, &indexTotalCost,
+						  &indexSelectivity);
+
+	Relation relation = RelationIdGetRelation(relationId);
+	if (!RelationIsValid(relation))
+	{
+		ereport(ERROR, (errmsg("could not open relation with OID %u", relationId)));
+	}
+
+	uint64 rowCount = ColumnarTableRowCount(relation);
+	RelationClose(relation);
+	double estimatedRows = rowCount * indexSelectivity;
+
+	double stripeCount = Max(ColumnarTableStripeCount(relationId), 1);
+	double estimatedStripeReadCount =
+		stripeCount * (1 - pow(1 - 1 / stripeCount, estimatedRows));
+
+	/* even in the best case, we will read a single stripe */
+	estimatedStripeReadCount = Max(estimatedStripeReadCount, 1.0);
+
+	int numberOfColumnsRead = RelationIdGetNumberOfAttributes(relationId);
+	Cost perStripeCost = ColumnarPerStripeScanCost(rel, relationId, numberOfColumnsRead);
+
+	/* similar to index scans, add our cost to the one estimated by postgres */
+	bitmapHeapPath->path.total_cost += perStripeCost * estimatedStripeReadCount;
+
+	ereport(DEBUG4, (errmsg("re-costing bitmap heap scan for columnar table: "
+							"selectivity = %.10f, estimated stripe read count = "
+							"%.10f, total cost = %.10f", indexSelectivity,
+							estimatedStripeReadCount,
+							bitmapHeapPath->path.total_cost)));
+}
+
+
 /*
  * CostColumnarSeqPath sets costs given seq path for columnar table with
  * relationId.
@@ -1295,13 +1598,140 @@ ContainsExecParams(Node *node, void *notUsed)
 
 /*
  * Create and add a path with the given parameterization paramRelids.
- *
- * XXX: Consider refactoring to be more like postgresGetForeignPaths(). The
- * only differences are param_info and custom_private.
  */
 static void
 AddColumnarScanPath(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
 					Relids paramRelids)
+{
+	CustomPath *cpath = CreateColumnarScanPath(root, rel, rte, paramRelids);
+	add_path(rel, &cpath->path);
+}
+
+
+/*
+ * AddColumnarScanPartialPath adds a parallel-aware ColumnarScan path to
+ * partial pathlist of given rel, if the table is large enough to benefit
+ * from parallelism.
+ *
+ * Stripes are the unit of work for the participants of a parallel columnar
+ * scan, so we never plan for more participants than the number of stripes.
+ */
+static void
+AddColumnarScanPartialPath(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
+						   Relation relation)
+{
+	if (!rel->consider_parallel)
+	{
+		return;
+	}
+
+	RelFileNumber relfilenumber = RelationPhysicalIdentifierNumber_compat(
+		RelationPhysicalIdentifier_compat(relation));
+	if (PendingWritesInCurrentTransaction(relfilenumber))
+	{
+		/*
+		 * Parallel workers cannot see the pending writes of the leader, and
+		 * leader cannot flush them after entering parallel mode.
+		 */
+		return;
+	}
+
+	int parallelWorkers = ColumnarParallelWorkers(rel, relation);
+	if (parallelWorkers <= 0)
+	{
+		return;
+	}
+
+	/* partial paths can only be parameterized by lateral refs */
+	CustomPath *cpath = CreateColumnarScanPath(root, rel, rte, rel->lateral_relids);
+
+	Path *path = &cpath->path;
+	path->parallel_aware = true;
+	path->parallel_safe = true;
+	path->parallel_workers = parallelWorkers;
+
+	/*
+	 * Both reading the stripes and processing the rows are divided among
+	 * the participants.
+	 */
+	double parallelDivisor = ColumnarParallelDivisor(path);
+	path->rows = clamp_row_est(path->rows / parallelDivisor);
+	path->total_cost = path->startup_cost +
+					   (path->total_cost - path->startup_cost) / parallelDivisor;
+
+	ereport(ColumnarPlannerDebugLevel,
+			(errmsg("columnar planner: adding parallel CustomScan path for %s",
+					rte->eref->aliasname),
+			 errdetail("%d parallel workers", parallelWorkers)));
+
+	add_partial_path(rel, path);
+}
+
+
+/*
+ * ColumnarParallelWorkers returns the number of parallel workers to plan for
+ * scanning given columnar table.
+ */
+static int
+ColumnarParallelWorkers(RelOptInfo *rel, Relation relation)
+{
+	uint64 stripeCount = ColumnarTableStripeCount(RelationGetRelid(relation));
+	if (stripeCount <= 1)
+	{
+		return 0;
+	}
+
+	/*
+	 * ColumnarGetRelationInfoHook disables parallel query for this rel, so
+	 * temporarily restore the parallel_workers reloption (if any) to let
+	 * postgres compute the number of workers as it would do for heap tables.
+	 */
+	int savedRelParallelWorkers = rel->rel_parallel_workers;
+	rel->rel_parallel_workers = RelationGetParallelWorkers(relation, -1);
+
+	int parallelWorkers = compute_parallel_worker(rel, rel->pages, -1,
+												  max_parallel_workers_per_gather);
+
+	rel->rel_parallel_workers = savedRelParallelWorkers;
+
+	/* leader participates in the scan too, so don't need a worker for each stripe */
+	return Min(parallelWorkers, (int) Min(stripeCount - 1, (uint64) INT_MAX));
+}
+
+
+/*
+ * ColumnarParallelDivisor estimates the fraction of the work that each
+ * participant of a parallel scan would do. This is the same logic as
+ * get_parallel_divisor(), which is static in costsize.c.
+ */
+static double
+ColumnarParallelDivisor(Path *path)
+{
+	double parallelDivisor = path->parallel_workers;
+
+	if (parallel_leader_participation)
+	{
+		double leaderContribution = 1.0 - (0.3 * path->parallel_workers);
+		if (leaderContribution > 0)
+		{
+			parallelDivisor += leaderContribution;
+		}
+	}
+
+	return parallelDivisor;
+}
+
+
+/*
+ * CreateColumnarScanPath creates a ColumnarScan path with the given
+ * parameterization paramRelids.
+ *
+ * XXX: Consider refactoring to be more like postgresGetForeignPaths(). The
+ * only differences are param_info and custom_private.
+ */
+static CustomPath *
+CreateColumnarScanPath(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
+					   Relids paramRelids)
 {
 	/*
 	 * Must return a CustomPath, not a larger structure containing a
@@ -1432,7 +1862,7 @@ AddColumnarScanPath(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
 					   ParameterizationAsString(root, paramRelids, &buf),
 					   numberOfClausesPushed)));
 
-	add_path(rel, path);
+	return cpath;
 }
 
 
@@ -1830,6 +2260,13 @@ ColumnarAttrNeeded(ScanState *ss)
 	{
 		Var *var = lfirst(lc);
 
+		if (var->varattno == SelfItemPointerAttributeNumber ||
+			var->varattno == TableOidAttributeNumber)
+		{
+			/* scan slots always have tid and table oid of the rows */
+			continue;
+		}
+
 		if (var->varattno < 0)
 		{
 			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
@@ -1971,6 +2408,121 @@ ColumnarScan_ReScanCustomScan(CustomScanState *node)
 }
 
 
+/*
+ * ColumnarScan_EstimateDSMCustomScan returns the size of the shared state
+ * needed for a parallel columnar scan.
+ */
+static Size
+ColumnarScan_EstimateDSMCustomScan(CustomScanState *node, ParallelContext *pcxt)
+{
+	EState *estate = node->ss.ps.state;
+
+	return table_parallelscan_estimate(node->ss.ss_currentRelation,
+									   estate->es_snapshot);
+}
+
+
+/*
+ * ColumnarScan_InitializeDSMCustomScan initializes the shared state of a
+ * parallel columnar scan and begins the scan for the leader.
+ */
+static void
+ColumnarScan_InitializeDSMCustomScan(CustomScanState *node, ParallelContext *pcxt,
+									 void *coordinate)
+{
+	ColumnarScanState *columnarScanState = (ColumnarScanState *) node;
+	EState *estate = node->ss.ps.state;
+	Relation relation = node->ss.ss_currentRelation;
+
+	RelFileNumber relfilenumber = RelationPhysicalIdentifierNumber_compat(
+		RelationPhysicalIdentifier_compat(relation));
+	if (PendingWritesInCurrentTransaction(relfilenumber))
+	{
+		/*
+		 * The planner doesn't generate parallel paths in this case but the
+		 * plan might have been cached before writing into the table.
+		 */
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot perform a parallel scan on columnar table "
+							   "\"%s\" with unflushed data in current transaction",
+							   RelationGetRelationName(relation)),
+						errhint("Try disabling columnar.enable_parallel_scan.")));
+	}
+
+	ParallelTableScanDesc parallelScan = (ParallelTableScanDesc) coordinate;
+	table_parallelscan_initialize(relation, parallelScan, estate->es_snapshot);
+
+	columnarScanState->parallelScan = parallelScan;
+	node->ss.ss_currentScanDesc = ColumnarBeginParallelScan(columnarScanState,
+															parallelScan);
+}
+
+
+/*
+ * ColumnarScan_ReInitializeDSMCustomScan resets the shared state of a
+ * parallel columnar scan before the scan is restarted.
+ */
+static void
+ColumnarScan_ReInitializeDSMCustomScan(CustomScanState *node, ParallelContext *pcxt,
+									   void *coordinate)
+{
+	ColumnarScanState *columnarScanState = (ColumnarScanState *) node;
+
+	table_parallelscan_reinitialize(node->ss.ss_currentRelation,
+									columnarScanState->parallelScan);
+}
+
+
+/*
+ * ColumnarScan_InitializeWorkerCustomScan begins the scan for a parallel
+ * worker by using the shared state initialized by the leader.
+ */
+static void
+ColumnarScan_InitializeWorkerCustomScan(CustomScanState *node, shm_toc *toc,
+										void *coordinate)
+{
+	ColumnarScanState *columnarScanState = (ColumnarScanState *) node;
+
+	ParallelTableScanDesc parallelScan = (ParallelTableScanDesc) coordinate;
+
+	columnarScanState->parallelScan = parallelScan;
+	node->ss.ss_currentScanDesc = ColumnarBeginParallelScan(columnarScanState,
+															parallelScan);
+}
+
+
+/*
+ * ColumnarBeginParallelScan begins a columnar scan that reads the stripes
+ * claimed from given shared state. Similar to table_beginscan_parallel(), we
+ * use the snapshot serialized by the leader.
+ */
+static TableScanDesc
+ColumnarBeginParallelScan(ColumnarScanState *columnarScanState,
+						  ParallelTableScanDesc parallelScan)
+{
+	ScanState *scanState = &columnarScanState->custom_scanstate.ss;
+	Relation relation = scanState->ss_currentRelation;
+
+	Assert(RelationGetRelid(relation) == parallelScan->phs_relid);
+
+	Snapshot snapshot = RestoreSnapshot((char *) parallelScan +
+										parallelScan->phs_snapshot_off);
+	RegisterSnapshot(snapshot);
+
+	/* columnar_endscan unregisters the snapshot */
+	uint32 flags = SO_TEMP_SNAPSHOT;
+
+	Bitmapset *attr_needed = ColumnarAttrNeeded(scanState);
+	TableScanDesc scanDesc = columnar_beginscan_extended(relation, snapshot, 0, NULL,
+														 parallelScan, flags,
+														 attr_needed,
+														 columnarScanState->qual);
+	bms_free(attr_needed);
+
+	return scanDesc;
+}
+
+
 static void
 ColumnarScan_ExplainCustomScan(CustomScanState *node, List *ancestors,
 							   ExplainState *es)
@@ -2004,6 +2556,48 @@ ColumnarScan_ExplainCustomScan(CustomScanState *node, List *ancestors,
 				NULL, ColumnarScanChunkGroupsFiltered(columnarScanDesc), es);
 		}
 	}
+
+	if (es->analyze && es->buffers)
+	{
+		ColumnarScanDesc columnarScanDesc =
+			(ColumnarScanDesc) node->ss.ss_currentScanDesc;
+		ColumnarScanStats *scanStats = columnarScanDesc != NULL ?
+									   ColumnarScanGetScanStats(columnarScanDesc) :
+									   NULL;
+		if (scanStats != NULL)
+		{
+			ColumnarExplainScanStats(scanStats, es);
+		}
+	}
+}
+
+
+/*
+ * ColumnarExplainScanStats shows the counters of the read operation of a
+ * ColumnarScan, which are only collected by the leader for parallel scans.
+ */
+static void
+ColumnarExplainScanStats(ColumnarScanStats *scanStats, ExplainState *es)
+{
+	ExplainPropertyInteger("Columnar Stripes Read", NULL,
+						   scanStats->stripesRead, es);
+	ExplainPropertyInteger("Columnar Stripes Skipped", NULL,
+						   scanStats->stripesSkipped, es);
+	ExplainPropertyInteger("Columnar Chunk Groups Read", NULL,
+						   scanStats->chunkGroupsRead, es);
+	ExplainPropertyInteger("Columnar Chunk Groups Skipped", NULL,
+						   scanStats->chunkGroupsSkipped, es);
+	ExplainPropertyInteger("Columnar Bytes Read", "bytes",
+						   scanStats->bytesRead, es);
+	ExplainPropertyInteger("Columnar Bytes Decompressed", "bytes",
+						   scanStats->bytesDecompressed, es);
+
+	if (es->timing)
+	{
+		ExplainPropertyFloat("Columnar Decompression Time", "ms",
+							 INSTR_TIME_GET_MILLISEC(scanStats->decompressionTime),
+							 3, es);
+	}
 }
 
 
@@ -2127,3 +2721,746 @@ set_deparse_context_planstate(List *dpcontext, Node *node, List *ancestors)
 	PlanState *ps = (PlanState *) node;
 	return set_deparse_context_plan(dpcontext, ps->plan, ancestors);
 }
+
+
+/*
+ * AddColumnarAggregatePath adds a ColumnarAggregateScan path to output_rel if
+ * all the aggregates of the query are count(*), min() or max() aggregates on
+ * a single columnar table that can be computed from the chunk group
+ * statistics.
+ *
+ * Such a path computes the aggregates by using the skip lists for the chunk
+ * groups that all rows of which satisfy the quals; and only reads the chunk
+ * groups that partially match the quals.
+ */
+static void
+AddColumnarAggregatePath(PlannerInfo *root, RelOptInfo *input_rel,
+						 RelOptInfo *output_rel, GroupPathExtraData *extra)
+{
+	Query *parse = root->parse;
+
+	if (output_rel->reloptkind != RELOPT_UPPER_REL ||
+		extra->patype != PARTITIONWISE_AGGREGATE_NONE)
+	{
+		return;
+	}
+
+	if (input_rel->reloptkind != RELOPT_BASEREL ||
+		input_rel->rtekind != RTE_RELATION ||
+		!bms_is_empty(input_rel->lateral_relids) ||
+		IS_DUMMY_REL(input_rel))
+	{
+		return;
+	}
+
+	if (parse->groupClause != NIL || parse->groupingSets != NIL ||
+		root->hasHavingQual || parse->hasWindowFuncs || parse->hasTargetSRFs ||
+		parse->rowMarks != NIL)
+	{
+		return;
+	}
+
+	RangeTblEntry *rte = planner_rt_fetch(input_rel->relid, root);
+	if (rte->inh || rte->tablesample != NULL || !IsColumnarTableAmTable(rte->relid))
+	{
+		return;
+	}
+
+	/*
+	 * We evaluate the quals ourselves for the chunk groups that we read. The
+	 * quals that need to be evaluated in a certain order for security
+	 * reasons, or that depend on exec params are not supported.
+	 */
+	List *clauseList = NIL;
+	RestrictInfo *restrictInfo = NULL;
+	foreach_ptr(restrictInfo, input_rel->baserestrictinfo)
+	{
+		Node *clause = (Node *) restrictInfo->clause;
+		if (restrictInfo->security_level > 0 || contain_subplans(clause) ||
+			ContainsExecParams(clause, NULL))
+		{
+			return;
+		}
+
+		clauseList = lappend(clauseList, clause);
+	}
+
+	/*
+	 * Build the target list of the scan tuples, which consists of the
+	 * aggregates followed by the columns referenced by the quals.
+	 */
+	List *customScanTargetList = NIL;
+	List *aggregateTypeList = NIL;
+
+	int flags = PVC_INCLUDE_AGGREGATES | PVC_INCLUDE_PLACEHOLDERS;
+	List *targetNodeList = pull_var_clause((Node *) output_rel->reltarget->exprs,
+										   flags);
+	Node *targetNode = NULL;
+	foreach_ptr(targetNode, targetNodeList)
+	{
+		if (!IsA(targetNode, Aggref))
+		{
+			return;
+		}
+
+		ColumnarAggregateType aggregateType =
+			ColumnarAggregateTypeForAggref((Aggref *) targetNode, input_rel->relid);
+		if (aggregateType == COLUMNAR_AGGREGATE_NONE)
+		{
+			return;
+		}
+
+		if (tlist_member((Expr *) targetNode, customScanTargetList) != NULL)
+		{
+			continue;
+		}
+
+		TargetEntry *targetEntry =
+			makeTargetEntry((Expr *) targetNode,
+							list_length(customScanTargetList) + 1, NULL, false);
+		customScanTargetList = lappend(customScanTargetList, targetEntry);
+		aggregateTypeList = lappend_int(aggregateTypeList, aggregateType);
+	}
+
+	if (customScanTargetList == NIL)
+	{
+		return;
+	}
+
+	List *clauseVarList = pull_var_clause((Node *) clauseList, 0);
+	Var *clauseVar = NULL;
+	foreach_ptr(clauseVar, clauseVarList)
+	{
+		if (clauseVar->varattno <= 0)
+		{
+			/* system columns and whole-row references are not supported */
+			return;
+		}
+
+		if (tlist_member((Expr *) clauseVar, customScanTargetList) != NULL)
+		{
+			continue;
+		}
+
+		bool resjunk = true;
+		TargetEntry *targetEntry =
+			makeTargetEntry((Expr *) clauseVar, list_length(customScanTargetList) + 1,
+							NULL, resjunk);
+		customScanTargetList = lappend(customScanTargetList, targetEntry);
+		aggregateTypeList = lappend_int(aggregateTypeList, COLUMNAR_AGGREGATE_NONE);
+	}
+
+	/*
+	 * Reading the skip lists is cheap compared to reading the data. When
+	 * there are quals, we might need to read the chunk groups that are not
+	 * refuted by them, which we estimate as a columnar scan would do.
+	 */
+	uint64 stripeCount = ColumnarTableStripeCount(rte->relid);
+	int numberOfColumnsRead = list_length(customScanTargetList);
+	Cost totalCost = stripeCount * cpu_tuple_cost;
+	if (clauseList != NIL)
+	{
+		Selectivity clauseSel = clauselist_selectivity(
+			root, clauseList, input_rel->relid, JOIN_INNER, NULL);
+		double stripesToRead = Max(clauseSel * stripeCount, 1.0);
+
+		totalCost += stripesToRead * ColumnarPerStripeScanCost(input_rel, rte->relid,
+															   numberOfColumnsRead);
+		totalCost += clauseSel * input_rel->tuples * cpu_operator_cost *
+					 list_length(clauseList);
+	}
+
+	CustomPath *cpath = makeNode(CustomPath);
+	cpath->methods = &ColumnarAggregatePathMethods;
+
+	Path *path = &cpath->path;
+	path->pathtype = T_CustomScan;
+	path->parent = output_rel;
+	path->pathtarget = output_rel->reltarget;
+	path->param_info = NULL;
+	path->parallel_aware = false;
+	path->parallel_safe = false;
+	path->parallel_workers = 0;
+	path->rows = 1;
+	path->startup_cost = totalCost;
+	path->total_cost = totalCost;
+	path->pathkeys = NIL;
+
+	cpath->custom_private = list_make4(clauseList, customScanTargetList,
+									   aggregateTypeList,
+									   list_make1_int(input_rel->relid));
+
+	ereport(ColumnarPlannerDebugLevel,
+			(errmsg("adding aggregate pushdown path for columnar table %s",
+					get_rel_name(rte->relid))));
+
+	add_path(output_rel, path);
+}
+
+
+/*
+ * ColumnarAggregateTypeForAggref returns the type of the given aggregate if
+ * it is count(*), or min() / max() on a column of the relation with given
+ * relid that is compared the same way as the values in the skip lists are.
+ * Otherwise, returns COLUMNAR_AGGREGATE_NONE.
+ */
+static ColumnarAggregateType
+ColumnarAggregateTypeForAggref(Aggref *aggref, Index relid)
+{
+	if (aggref->agglevelsup != 0 || aggref->aggfilter != NULL ||
+		aggref->aggdistinct != NIL || aggref->aggorder != NIL ||
+		aggref->aggkind != AGGKIND_NORMAL || aggref->aggsplit != AGGSPLIT_SIMPLE ||
+		aggref->aggvariadic)
+	{
+		return COLUMNAR_AGGREGATE_NONE;
+	}
+
+	if (aggref->aggfnoid == F_COUNT_)
+	{
+		return COLUMNAR_AGGREGATE_COUNT;
+	}
+
+	if (list_length(aggref->args) != 1)
+	{
+		return COLUMNAR_AGGREGATE_NONE;
+	}
+
+	TargetEntry *argument = linitial(aggref->args);
+	Node *argumentExpr = (Node *) argument->expr;
+	while (IsA(argumentExpr, RelabelType))
+	{
+		argumentExpr = (Node *) ((RelabelType *) argumentExpr)->arg;
+	}
+
+	if (!IsA(argumentExpr, Var))
+	{
+		return COLUMNAR_AGGREGATE_NONE;
+	}
+
+	Var *column = (Var *) argumentExpr;
+	if (column->varno != relid || column->varattno <= 0 || column->varlevelsup != 0 ||
+		aggref->inputcollid != column->varcollid)
+	{
+		return COLUMNAR_AGGREGATE_NONE;
+	}
+
+	HeapTuple aggregateTuple = SearchSysCache1(AGGFNOID,
+											   ObjectIdGetDatum(aggref->aggfnoid));
+	if (!HeapTupleIsValid(aggregateTuple))
+	{
+		return COLUMNAR_AGGREGATE_NONE;
+	}
+
+	Oid sortOperator = ((Form_pg_aggregate) GETSTRUCT(aggregateTuple))->aggsortop;
+	ReleaseSysCache(aggregateTuple);
+
+	/* min / max values in the skip lists are built by using the default opclass */
+	Oid operatorClass = GetDefaultOpClass(column->vartype, BTREE_AM_OID);
+	if (!OidIsValid(sortOperator) || !OidIsValid(operatorClass) ||
+		GetFunctionInfoOrNull(column->vartype, BTREE_AM_OID, BTORDER_PROC) == NULL)
+	{
+		return COLUMNAR_AGGREGATE_NONE;
+	}
+
+	int strategy = get_op_opfamily_strategy(sortOperator,
+											get_opclass_family(operatorClass));
+	if (strategy == BTLessStrategyNumber)
+	{
+		return COLUMNAR_AGGREGATE_MIN;
+	}
+	else if (strategy == BTGreaterStrategyNumber)
+	{
+		return COLUMNAR_AGGREGATE_MAX;
+	}
+
+	return COLUMNAR_AGGREGATE_NONE;
+}
+
+
+static Plan *
+ColumnarAggregatePath_PlanCustomPath(PlannerInfo *root,
+									 RelOptInfo *rel,
+									 struct CustomPath *best_path,
+									 List *tlist,
+									 List *clauses,
+									 List *custom_plans)
+{
+	CustomScan *cscan = makeNode(CustomScan);
+
+	cscan->methods = &ColumnarAggregateScanMethods;
+
+	List *clauseList = linitial(best_path->custom_private);
+	List *customScanTargetList = lsecond(best_path->custom_private);
+	List *aggregateTypeList = lthird(best_path->custom_private);
+	Index scanrelid = linitial_int(lfourth(best_path->custom_private));
+
+	/*
+	 * The quals are evaluated by us, so we keep them in custom_exprs rather
+	 * than in the qual of the plan, which would be evaluated on the scan
+	 * tuples, i.e., on the aggregates.
+	 */
+	cscan->custom_exprs = copyObject(clauseList);
+	cscan->custom_scan_tlist = copyObject(customScanTargetList);
+	cscan->custom_private = list_make1(list_copy(aggregateTypeList));
+
+	cscan->scan.plan.qual = NIL;
+	cscan->scan.plan.targetlist = list_copy(tlist);
+	cscan->scan.scanrelid = scanrelid;
+
+#if (PG_VERSION_NUM >= 150000)
+
+	/* necessary to avoid extra Result node in PG15 */
+	cscan->flags = CUSTOMPATH_SUPPORT_PROJECTION;
+#endif
+
+	return (Plan *) cscan;
+}
+
+
+static Node *
+ColumnarAggregateScan_CreateCustomScanState(CustomScan *cscan)
+{
+	ColumnarAggregateScanState *aggregateScanState =
+		(ColumnarAggregateScanState *) newNode(sizeof(ColumnarAggregateScanState),
+											   T_CustomScanState);
+
+	CustomScanState *cscanstate = &aggregateScanState->custom_scanstate;
+	cscanstate->methods = &ColumnarAggregateExecuteMethods;
+
+	return (Node *) cscanstate;
+}
+
+
+/*
+ * ScanTupleVarToColumnMutator replaces the Vars referencing the scan tuple
+ * with the Vars referencing the columns of the relation.
+ */
+static Node *
+ScanTupleVarToColumnMutator(Node *node, List *customScanTargetList)
+{
+	if (node == NULL)
+	{
+		return NULL;
+	}
+
+	if (IsA(node, Var) && ((Var *) node)->varno == INDEX_VAR)
+	{
+		Var *var = (Var *) node;
+		TargetEntry *targetEntry = list_nth(customScanTargetList, var->varattno - 1);
+		return (Node *) copyObject(targetEntry->expr);
+	}
+
+	return expression_tree_mutator(node, ScanTupleVarToColumnMutator,
+								   (void *) customScanTargetList);
+}
+
+
+static void
+ColumnarAggregateScan_BeginCustomScan(CustomScanState *cscanstate, EState *estate,
+									  int eflags)
+{
+	CustomScan *cscan = (CustomScan *) cscanstate->ss.ps.plan;
+	ColumnarAggregateScanState *state = (ColumnarAggregateScanState *) cscanstate;
+	List *aggregateTypeList = linitial(cscan->custom_private);
+
+	state->qual = ExecInitQual(cscan->custom_exprs, &cscanstate->ss.ps);
+
+	/* quals with the Consts substituted for Params are used to filter chunk groups */
+	Node *columnQual = ScanTupleVarToColumnMutator((Node *) cscan->custom_exprs,
+												   cscan->custom_scan_tlist);
+	state->columnQual = (List *) EvalParamsMutator(columnQual,
+												   cscanstate->ss.ps.ps_ExprContext);
+
+	int scanAttributeCount = list_length(cscan->custom_scan_tlist);
+	state->scanColumnIndexArray = palloc(scanAttributeCount * sizeof(int));
+	state->aggregateList = NIL;
+	state->projectedColumnList = NIL;
+
+	for (int scanIndex = 0; scanIndex < scanAttributeCount; scanIndex++)
+	{
+		TargetEntry *targetEntry = list_nth(cscan->custom_scan_tlist, scanIndex);
+		ColumnarAggregateType aggregateType = list_nth_int(aggregateTypeList,
+														   scanIndex);
+
+		state->scanColumnIndexArray[scanIndex] = -1;
+
+		if (aggregateType == COLUMNAR_AGGREGATE_NONE)
+		{
+			Var *column = castNode(Var, targetEntry->expr);
+			state->scanColumnIndexArray[scanIndex] = column->varattno - 1;
+			state->projectedColumnList =
+				list_append_unique_int(state->projectedColumnList, column->varattno);
+			continue;
+		}
+
+		ColumnarAggregate *aggregate = palloc0(sizeof(ColumnarAggregate));
+		aggregate->type = aggregateType;
+		aggregate->scanIndex = scanIndex;
+		aggregate->isNull = true;
+
+		if (aggregateType != COLUMNAR_AGGREGATE_COUNT)
+		{
+			Aggref *aggref = castNode(Aggref, targetEntry->expr);
+			TargetEntry *argument = linitial(aggref->args);
+			Node *argumentExpr = (Node *) argument->expr;
+			while (IsA(argumentExpr, RelabelType))
+			{
+				argumentExpr = (Node *) ((RelabelType *) argumentExpr)->arg;
+			}
+
+			Var *column = castNode(Var, argumentExpr);
+			aggregate->columnIndex = column->varattno - 1;
+			aggregate->comparisonFunction = GetFunctionInfoOrNull(column->vartype,
+																  BTREE_AM_OID,
+																  BTORDER_PROC);
+			aggregate->collation = column->varcollid;
+			get_typlenbyval(column->vartype, &aggregate->typeLength,
+							&aggregate->typeByValue);
+
+			state->projectedColumnList =
+				list_append_unique_int(state->projectedColumnList, column->varattno);
+		}
+
+		state->aggregateList = lappend(state->aggregateList, aggregate);
+	}
+
+	state->scanContext = AllocSetContextCreate(CurrentMemoryContext,
+											   "Columnar Aggregate Scan Context",
+											   ALLOCSET_DEFAULT_SIZES);
+	state->readState = NULL;
+	state->finished = false;
+}
+
+
+/*
+ * ColumnarAggregateChunkGroupCallback is called by the columnar reader for
+ * each chunk group that is not refuted by the quals. If all rows of the chunk
+ * group satisfy the quals and the skip list has the min / max values for the
+ * aggregated columns, we advance the aggregates by using the skip list and
+ * tell the reader to skip the chunk group. Otherwise, the reader reads the
+ * chunk group and we advance the aggregates by using its rows.
+ */
+static bool
+ColumnarAggregateChunkGroupCallback(StripeSkipList *stripeSkipList, uint32 chunkIndex,
+									bool allRowsMatch, void *callbackState)
+{
+	ColumnarAggregateScanState *state = (ColumnarAggregateScanState *) callbackState;
+	uint32 chunkGroupRowCount = stripeSkipList->chunkGroupRowCounts[chunkIndex];
+
+	if (!allRowsMatch)
+	{
+		state->chunkGroupsRead++;
+		return true;
+	}
+
+	ColumnarAggregate *aggregate = NULL;
+	foreach_ptr(aggregate, state->aggregateList)
+	{
+		if (aggregate->type == COLUMNAR_AGGREGATE_COUNT)
+		{
+			continue;
+		}
+
+		/*
+		 * If the column was added after writing the stripe, the skip list
+		 * doesn't have any statistics for it but the rows would have the
+		 * default value of the column.
+		 */
+		ColumnChunkSkipNode *chunkSkipNode =
+			&stripeSkipList->chunkSkipNodeArray[aggregate->columnIndex][chunkIndex];
+		if (chunkSkipNode->rowCount != chunkGroupRowCount)
+		{
+			state->chunkGroupsRead++;
+			return true;
+		}
+	}
+
+	foreach_ptr(aggregate, state->aggregateList)
+	{
+		if (aggregate->type == COLUMNAR_AGGREGATE_COUNT)
+		{
+			continue;
+		}
+
+		/* no min / max values means that all values are NULL */
+		ColumnChunkSkipNode *chunkSkipNode =
+			&stripeSkipList->chunkSkipNodeArray[aggregate->columnIndex][chunkIndex];
+		if (chunkSkipNode->hasMinMax)
+		{
+			AdvanceColumnarAggregate(state, aggregate, chunkSkipNode->minimumValue,
+									 chunkSkipNode->maximumValue);
+		}
+	}
+
+	state->rowCount += chunkGroupRowCount;
+	state->chunkGroupsAnswered++;
+
+	return false;
+}
+
+
+/*
+ * AdvanceColumnarAggregate updates given min / max aggregate with the given
+ * minimum or maximum value respectively.
+ */
+static void
+AdvanceColumnarAggregate(ColumnarAggregateScanState *state,
+						 ColumnarAggregate *aggregate,
+						 Datum minimumValue, Datum maximumValue)
+{
+	Datum value = (aggregate->type == COLUMNAR_AGGREGATE_MIN) ?
+				  minimumValue : maximumValue;
+
+	if (!aggregate->isNull)
+	{
+		Datum comparisonDatum = FunctionCall2Coll(aggregate->comparisonFunction,
+												  aggregate->collation, value,
+												  aggregate->value);
+		int comparison = DatumGetInt32(comparisonDatum);
+
+		if ((aggregate->type == COLUMNAR_AGGREGATE_MIN && comparison >= 0) ||
+			(aggregate->type == COLUMNAR_AGGREGATE_MAX && comparison <= 0))
+		{
+			return;
+		}
+
+		if (!aggregate->typeByValue)
+		{
+			pfree(DatumGetPointer(aggregate->value));
+		}
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(state->scanContext);
+
+	aggregate->value = datumCopy(value, aggregate->typeByValue, aggregate->typeLength);
+	aggregate->isNull = false;
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * ColumnarAggregateScanNext computes the aggregates and returns them in the
+ * scan tuple on the first call, and returns NULL afterwards.
+ */
+static TupleTableSlot *
+ColumnarAggregateScanNext(ColumnarAggregateScanState *state)
+{
+	CustomScanState *node = (CustomScanState *) state;
+	EState *estate = node->ss.ps.state;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	int scanAttributeCount = slot->tts_tupleDescriptor->natts;
+
+	if (state->finished)
+	{
+		return NULL;
+	}
+
+	Relation relation = node->ss.ss_currentRelation;
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+
+	RelFileNumber relfilenumber = RelationPhysicalIdentifierNumber_compat(
+		RelationPhysicalIdentifier_compat(relation));
+	if (PendingWritesInUpperTransactions(relfilenumber, GetCurrentSubTransactionId()))
+	{
+		elog(ERROR,
+			 "cannot read from table when there is unflushed data in upper transactions");
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(state->scanContext);
+
+	Datum *columnValues = palloc0(tupleDescriptor->natts * sizeof(Datum));
+	bool *columnNulls = palloc0(tupleDescriptor->natts * sizeof(bool));
+
+	bool randomAccess = false;
+	state->readState = ColumnarBeginRead(relation, tupleDescriptor,
+										 state->projectedColumnList,
+										 state->columnQual, state->scanContext,
+										 estate->es_snapshot, randomAccess, NULL);
+	ColumnarReadSetChunkGroupCallback(state->readState,
+									  ColumnarAggregateChunkGroupCallback, state);
+
+	MemoryContextSwitchTo(oldContext);
+
+	while (ColumnarReadNextRow(state->readState, columnValues, columnNulls, NULL))
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		ResetExprContext(econtext);
+		oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+		if (state->qual != NULL)
+		{
+			ExecClearTuple(slot);
+			for (int scanIndex = 0; scanIndex < scanAttributeCount; scanIndex++)
+			{
+				int columnIndex = state->scanColumnIndexArray[scanIndex];
+				if (columnIndex < 0)
+				{
+					slot->tts_isnull[scanIndex] = true;
+					continue;
+				}
+
+				slot->tts_values[scanIndex] = columnValues[columnIndex];
+				slot->tts_isnull[scanIndex] = columnNulls[columnIndex];
+			}
+			ExecStoreVirtualTuple(slot);
+
+			econtext->ecxt_scantuple = slot;
+			if (!ExecQual(state->qual, econtext))
+			{
+				MemoryContextSwitchTo(oldContext);
+				continue;
+			}
+		}
+
+		state->rowCount++;
+
+		ColumnarAggregate *aggregate = NULL;
+		foreach_ptr(aggregate, state->aggregateList)
+		{
+			if (aggregate->type != COLUMNAR_AGGREGATE_COUNT &&
+				!columnNulls[aggregate->columnIndex])
+			{
+				Datum value = columnValues[aggregate->columnIndex];
+				AdvanceColumnarAggregate(state, aggregate, value, value);
+			}
+		}
+
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	state->chunkGroupsFiltered = ColumnarReadChunkGroupsFiltered(state->readState);
+	state->finished = true;
+
+	/* the attributes for the columns referenced by the quals are left as NULL */
+	ExecClearTuple(slot);
+	memset(slot->tts_isnull, true, scanAttributeCount * sizeof(bool));
+
+	ColumnarAggregate *aggregate = NULL;
+	foreach_ptr(aggregate, state->aggregateList)
+	{
+		if (aggregate->type == COLUMNAR_AGGREGATE_COUNT)
+		{
+			slot->tts_values[aggregate->scanIndex] = Int64GetDatum(state->rowCount);
+			slot->tts_isnull[aggregate->scanIndex] = false;
+		}
+		else
+		{
+			slot->tts_values[aggregate->scanIndex] = aggregate->value;
+			slot->tts_isnull[aggregate->scanIndex] = aggregate->isNull;
+		}
+	}
+
+	ExecStoreVirtualTuple(slot);
+
+	return slot;
+}
+
+
+/*
+ * ColumnarAggregateScanRecheck -- access method routine to recheck a tuple
+ * in EvalPlanQual
+ */
+static bool
+ColumnarAggregateScanRecheck(ColumnarAggregateScanState *state, TupleTableSlot *slot)
+{
+	return true;
+}
+
+
+static TupleTableSlot *
+ColumnarAggregateScan_ExecCustomScan(CustomScanState *node)
+{
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) ColumnarAggregateScanNext,
+					(ExecScanRecheckMtd) ColumnarAggregateScanRecheck);
+}
+
+
+static void
+ColumnarAggregateScan_EndCustomScan(CustomScanState *node)
+{
+	ColumnarAggregateScanState *state = (ColumnarAggregateScanState *) node;
+
+	ExecFreeExprContext(&node->ss.ps);
+
+	if (node->ss.ps.ps_ResultTupleSlot)
+	{
+		ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	}
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+
+	if (state->readState != NULL)
+	{
+		ColumnarEndRead(state->readState);
+		state->readState = NULL;
+	}
+
+	MemoryContextDelete(state->scanContext);
+}
+
+
+static void
+ColumnarAggregateScan_ReScanCustomScan(CustomScanState *node)
+{
+	ColumnarAggregateScanState *state = (ColumnarAggregateScanState *) node;
+
+	if (state->readState != NULL)
+	{
+		ColumnarEndRead(state->readState);
+		state->readState = NULL;
+	}
+
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	MemoryContextReset(state->scanContext);
+
+	ColumnarAggregate *aggregate = NULL;
+	foreach_ptr(aggregate, state->aggregateList)
+	{
+		aggregate->value = (Datum) 0;
+		aggregate->isNull = true;
+	}
+
+	state->rowCount = 0;
+	state->chunkGroupsAnswered = 0;
+	state->chunkGroupsRead = 0;
+	state->chunkGroupsFiltered = 0;
+	state->finished = false;
+}
+
+
+static void
+ColumnarAggregateScan_ExplainCustomScan(CustomScanState *node, List *ancestors,
+										ExplainState *es)
+{
+	ColumnarAggregateScanState *state = (ColumnarAggregateScanState *) node;
+	CustomScan *cscan = castNode(CustomScan, node->ss.ps.plan);
+
+	List *chunkGroupFilter = cscan->custom_exprs;
+	if (chunkGroupFilter != NIL)
+	{
+		List *context = set_deparse_context_planstate(
+			es->deparse_cxt, (Node *) &node->ss.ps, ancestors);
+
+		const char *pushdownClausesStr = ColumnarPushdownClausesStr(
+			context, chunkGroupFilter);
+		ExplainPropertyText("Columnar Chunk Group Filters",
+							pushdownClausesStr, es);
+	}
+
+	if (state->finished)
+	{
+		ExplainPropertyInteger("Columnar Chunk Groups Answered by Metadata",
+							   NULL, state->chunkGroupsAnswered, es);
+		ExplainPropertyInteger("Columnar Chunk Groups Read",
+							   NULL, state->chunkGroupsRead, es);
+
+		if (chunkGroupFilter != NIL)
+		{
+			ExplainPropertyInteger("Columnar Chunk Groups Removed by Filter",
+								   NULL, state->chunkGroupsFiltered, es);
+		}
+	}
+}
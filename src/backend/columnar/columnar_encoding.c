@@ -0,0 +1,506 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_encoding.c
+ *
+ * This file contains the functions that encode the serialized values of a
+ * column chunk before compression, and decode them when reading the chunk.
+ *
+ * Supported encodings are:
+ *
+ * - Dictionary: distinct values of the chunk are stored once, followed by
+ *   a one byte code for each value that exists in the chunk.
+ * - Run-length: consecutive equal values of the chunk are stored once,
+ *   together with the number of times the value repeats.
+ *
+ * Values are compared by their serialized representations, so encoding a
+ * chunk doesn't require any type specific support.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/tupmacs.h"
+#include "common/hashfn.h"
+#include "lib/stringinfo.h"
+
+#include "pg_version_constants.h"
+
+#if PG_VERSION_NUM >= PG_VERSION_16
+#include "varatt.h"
+#endif
+
+#include "columnar/columnar_encoding.h"
+
+
+/*
+ * ChunkEncodingHeader is stored at the beginning of an encoded value buffer.
+ * count is the number of dictionary entries or the number of runs, depending
+ * on the encoding. The header takes CHUNK_ENCODING_HEADER_SIZE bytes, so the
+ * serialized datums that follow it keep the alignment they would have in an
+ * unencoded value buffer.
+ */
+typedef struct ChunkEncodingHeader
+{
+	uint32 count;
+	uint32 reserved;
+} ChunkEncodingHeader;
+
+#define CHUNK_ENCODING_HEADER_SIZE MAXALIGN(sizeof(ChunkEncodingHeader))
+
+/* number of slots in the open addressing hash table used to build dictionaries */
+#define DICTIONARY_HASH_SLOT_COUNT (CHUNK_DICTIONARY_MAX_ENTRIES * 2)
+
+
+/*
+ * SerializedDatum points to a serialized datum in a value buffer. length
+ * includes the alignment padding that follows the datum.
+ */
+typedef struct SerializedDatum
+{
+	char *data;
+	uint32 length;
+} SerializedDatum;
+
+
+static uint32 ParseSerializedDatums(char *data, uint32 dataLength, uint32 datumCount,
+									bool datumTypeByValue, int datumTypeLength,
+									char datumTypeAlign,
+									SerializedDatum *serializedDatumArray,
+									Datum *datumArray);
+static bool SerializedDatumsEqual(SerializedDatum *left, SerializedDatum *right);
+static bool BuildChunkDictionary(SerializedDatum *serializedDatumArray,
+								 uint32 datumCount, uint32 *entryIndexArray,
+								 uint32 *entryCount, uint8 *codeArray);
+static uint32 CountExistingValues(bool *existsArray, uint32 rowCount);
+static void AppendEncodingHeader(StringInfo encodedBuffer, uint32 count);
+static void AppendAlignmentPadding(StringInfo encodedBuffer);
+
+
+/*
+ * EncodeChunkValues checks whether dictionary or run-length encoding of the
+ * given serialized chunk values would take less space than the unencoded
+ * values. If so, it writes the smallest encoding to encodedBuffer and returns
+ * its type. Otherwise, returns CHUNK_ENCODING_NONE and leaves encodedBuffer
+ * untouched.
+ */
+ChunkEncodingType
+EncodeChunkValues(StringInfo valueBuffer, bool *existsArray, uint32 rowCount,
+				  bool datumTypeByValue, int datumTypeLength, char datumTypeAlign,
+				  StringInfo encodedBuffer)
+{
+	uint32 datumCount = CountExistingValues(existsArray, rowCount);
+	if (datumCount == 0)
+	{
+		return CHUNK_ENCODING_NONE;
+	}
+
+	SerializedDatum *serializedDatumArray = palloc(datumCount * sizeof(SerializedDatum));
+	ParseSerializedDatums(valueBuffer->data, valueBuffer->len, datumCount,
+						  datumTypeByValue, datumTypeLength, datumTypeAlign,
+						  serializedDatumArray, NULL);
+
+	/* compute the size of run-length encoding */
+	uint32 runCount = 0;
+	uint64 runLengthEncodedSize = 0;
+	for (uint32 datumIndex = 0; datumIndex < datumCount; datumIndex++)
+	{
+		if (datumIndex == 0 ||
+			!SerializedDatumsEqual(&serializedDatumArray[datumIndex - 1],
+								   &serializedDatumArray[datumIndex]))
+		{
+			runLengthEncodedSize += serializedDatumArray[datumIndex].length;
+			runCount++;
+		}
+	}
+
+	runLengthEncodedSize += CHUNK_ENCODING_HEADER_SIZE +
+							MAXALIGN(runCount * sizeof(uint32));
+
+	/* compute the size of dictionary encoding, if the chunk has few distinct values */
+	uint32 entryIndexArray[CHUNK_DICTIONARY_MAX_ENTRIES];
+	uint32 entryCount = 0;
+	uint8 *codeArray = palloc(datumCount * sizeof(uint8));
+	uint64 dictionaryEncodedSize = PG_UINT64_MAX;
+
+	if (BuildChunkDictionary(serializedDatumArray, datumCount, entryIndexArray,
+							 &entryCount, codeArray))
+	{
+		dictionaryEncodedSize = CHUNK_ENCODING_HEADER_SIZE + datumCount;
+		for (uint32 entryIndex = 0; entryIndex < entryCount; entryIndex++)
+		{
+			dictionaryEncodedSize +=
+				serializedDatumArray[entryIndexArray[entryIndex]].length;
+		}
+	}
+
+	ChunkEncodingType encodingType = CHUNK_ENCODING_NONE;
+	if (dictionaryEncodedSize < valueBuffer->len &&
+		dictionaryEncodedSize <= runLengthEncodedSize)
+	{
+		encodingType = CHUNK_ENCODING_DICTIONARY;
+
+		resetStringInfo(encodedBuffer);
+		AppendEncodingHeader(encodedBuffer, entryCount);
+
+		for (uint32 entryIndex = 0; entryIndex < entryCount; entryIndex++)
+		{
+			SerializedDatum *entry = &serializedDatumArray[entryIndexArray[entryIndex]];
+			appendBinaryStringInfo(encodedBuffer, entry->data, entry->length);
+		}
+
+		appendBinaryStringInfo(encodedBuffer, (char *) codeArray,
+							   datumCount * sizeof(uint8));
+	}
+	else if (runLengthEncodedSize < valueBuffer->len)
+	{
+		encodingType = CHUNK_ENCODING_RLE;
+
+		resetStringInfo(encodedBuffer);
+		AppendEncodingHeader(encodedBuffer, runCount);
+
+		/* first the run lengths, then the value of each run */
+		uint32 runLength = 0;
+		for (uint32 datumIndex = 0; datumIndex < datumCount; datumIndex++)
+		{
+			runLength++;
+
+			if (datumIndex == datumCount - 1 ||
+				!SerializedDatumsEqual(&serializedDatumArray[datumIndex],
+									   &serializedDatumArray[datumIndex + 1]))
+			{
+				appendBinaryStringInfo(encodedBuffer, (char *) &runLength,
+									   sizeof(uint32));
+				runLength = 0;
+			}
+		}
+
+		AppendAlignmentPadding(encodedBuffer);
+
+		for (uint32 datumIndex = 0; datumIndex < datumCount; datumIndex++)
+		{
+			if (datumIndex == 0 ||
+				!SerializedDatumsEqual(&serializedDatumArray[datumIndex - 1],
+									   &serializedDatumArray[datumIndex]))
+			{
+				SerializedDatum *runValue = &serializedDatumArray[datumIndex];
+				appendBinaryStringInfo(encodedBuffer, runValue->data, runValue->length);
+			}
+		}
+	}
+
+	pfree(serializedDatumArray);
+	pfree(codeArray);
+
+	return encodingType;
+}
+
+
+/*
+ * DecodeChunkValues decodes the given encoded value buffer of a column chunk,
+ * and fills datumArray for the rows that exist. Datums of by-reference types
+ * point into valueBuffer, so valueBuffer should outlive datumArray.
+ *
+ * For dictionary encoded chunks, the function also returns the dictionary,
+ * so that quals can be evaluated once per distinct value of the chunk.
+ * Otherwise, returns NULL.
+ */
+ChunkDictionary *
+DecodeChunkValues(StringInfo valueBuffer, ChunkEncodingType encodingType,
+				  bool *existsArray, uint32 rowCount, bool datumTypeByValue,
+				  int datumTypeLength, char datumTypeAlign, Datum *datumArray)
+{
+	if (valueBuffer->len < CHUNK_ENCODING_HEADER_SIZE)
+	{
+		ereport(ERROR, (errmsg("insufficient data left in datum buffer")));
+	}
+
+	ChunkEncodingHeader *header = (ChunkEncodingHeader *) valueBuffer->data;
+	char *payload = valueBuffer->data + CHUNK_ENCODING_HEADER_SIZE;
+	uint32 payloadLength = valueBuffer->len - CHUNK_ENCODING_HEADER_SIZE;
+	uint32 datumCount = CountExistingValues(existsArray, rowCount);
+
+	switch (encodingType)
+	{
+		case CHUNK_ENCODING_DICTIONARY:
+		{
+			uint32 entryCount = header->count;
+			if (entryCount == 0 || entryCount > CHUNK_DICTIONARY_MAX_ENTRIES)
+			{
+				ereport(ERROR, (errmsg("invalid number of dictionary entries: %u",
+									   entryCount)));
+			}
+
+			Datum *entryArray = palloc(entryCount * sizeof(Datum));
+			uint32 entriesLength = ParseSerializedDatums(payload, payloadLength,
+														 entryCount, datumTypeByValue,
+														 datumTypeLength, datumTypeAlign,
+														 NULL, entryArray);
+			if (payloadLength - entriesLength < datumCount)
+			{
+				ereport(ERROR, (errmsg("insufficient data left in datum buffer")));
+			}
+
+			uint8 *encodedCodeArray = (uint8 *) (payload + entriesLength);
+
+			ChunkDictionary *dictionary = palloc0(sizeof(ChunkDictionary));
+			dictionary->entryCount = entryCount;
+			dictionary->entryArray = entryArray;
+			dictionary->codeArray = palloc0(rowCount * sizeof(uint8));
+
+			uint32 datumIndex = 0;
+			for (uint32 rowIndex = 0; rowIndex < rowCount; rowIndex++)
+			{
+				if (!existsArray[rowIndex])
+				{
+					continue;
+				}
+
+				uint8 code = encodedCodeArray[datumIndex++];
+				if (code >= entryCount)
+				{
+					ereport(ERROR, (errmsg("invalid dictionary code: %u", code)));
+				}
+
+				datumArray[rowIndex] = entryArray[code];
+				dictionary->codeArray[rowIndex] = code;
+			}
+
+			return dictionary;
+		}
+
+		case CHUNK_ENCODING_RLE:
+		{
+			uint32 runCount = header->count;
+			uint32 runLengthArraySize = MAXALIGN(runCount * sizeof(uint32));
+			if (runCount == 0 || payloadLength < runLengthArraySize)
+			{
+				ereport(ERROR, (errmsg("insufficient data left in datum buffer")));
+			}
+
+			uint32 *runLengthArray = (uint32 *) payload;
+			Datum *runValueArray = palloc(runCount * sizeof(Datum));
+			ParseSerializedDatums(payload + runLengthArraySize,
+								  payloadLength - runLengthArraySize, runCount,
+								  datumTypeByValue, datumTypeLength, datumTypeAlign,
+								  NULL, runValueArray);
+
+			uint32 runIndex = 0;
+			uint32 remainingRunLength = runLengthArray[0];
+			for (uint32 rowIndex = 0; rowIndex < rowCount; rowIndex++)
+			{
+				if (!existsArray[rowIndex])
+				{
+					continue;
+				}
+
+				while (remainingRunLength == 0 && runIndex < runCount - 1)
+				{
+					runIndex++;
+					remainingRunLength = runLengthArray[runIndex];
+				}
+
+				if (remainingRunLength == 0)
+				{
+					ereport(ERROR, (errmsg("run-length encoded chunk has fewer values "
+										   "than expected")));
+				}
+
+				datumArray[rowIndex] = runValueArray[runIndex];
+				remainingRunLength--;
+			}
+
+			pfree(runValueArray);
+
+			return NULL;
+		}
+
+		default:
+		{
+			ereport(ERROR, (errmsg("unknown columnar chunk encoding type: %d",
+								   encodingType)));
+		}
+	}
+}
+
+
+/*
+ * ParseSerializedDatums walks over datumCount serialized datums at the given
+ * data, and returns the number of bytes they take. If serializedDatumArray or
+ * datumArray is not NULL, the location or the value of each datum is stored
+ * in the respective array.
+ */
+static uint32
+ParseSerializedDatums(char *data, uint32 dataLength, uint32 datumCount,
+					  bool datumTypeByValue, int datumTypeLength, char datumTypeAlign,
+					  SerializedDatum *serializedDatumArray, Datum *datumArray)
+{
+	uint32 currentDatumDataOffset = 0;
+
+	for (uint32 datumIndex = 0; datumIndex < datumCount; datumIndex++)
+	{
+		if (currentDatumDataOffset >= dataLength)
+		{
+			ereport(ERROR, (errmsg("insufficient data left in datum buffer")));
+		}
+
+		char *currentDatumDataPointer = data + currentDatumDataOffset;
+		Datum datum = fetch_att(currentDatumDataPointer, datumTypeByValue,
+								datumTypeLength);
+
+		uint32 nextDatumDataOffset = att_addlength_datum(currentDatumDataOffset,
+														 datumTypeLength, datum);
+		nextDatumDataOffset = att_align_nominal(nextDatumDataOffset, datumTypeAlign);
+
+		if (nextDatumDataOffset > dataLength)
+		{
+			ereport(ERROR, (errmsg("insufficient data left in datum buffer")));
+		}
+
+		if (serializedDatumArray != NULL)
+		{
+			serializedDatumArray[datumIndex].data = currentDatumDataPointer;
+			serializedDatumArray[datumIndex].length =
+				nextDatumDataOffset - currentDatumDataOffset;
+		}
+
+		if (datumArray != NULL)
+		{
+			datumArray[datumIndex] = datum;
+		}
+
+		currentDatumDataOffset = nextDatumDataOffset;
+	}
+
+	return currentDatumDataOffset;
+}
+
+
+/*
+ * SerializedDatumsEqual returns true if given serialized datums have the same
+ * binary representation. Serialization zeroes the alignment padding, so the
+ * padding doesn't cause false negatives.
+ */
+static bool
+SerializedDatumsEqual(SerializedDatum *left, SerializedDatum *right)
+{
+	return left->length == right->length &&
+		   memcmp(left->data, right->data, left->length) == 0;
+}
+
+
+/*
+ * BuildChunkDictionary assigns a code to each distinct serialized datum in
+ * the given array, in the order of their first appearance. It sets codeArray
+ * to the code of each datum, and entryIndexArray to the index of the first
+ * datum having each code.
+ *
+ * Returns false if the datums have more than CHUNK_DICTIONARY_MAX_ENTRIES
+ * distinct values.
+ */
+static bool
+BuildChunkDictionary(SerializedDatum *serializedDatumArray, uint32 datumCount,
+					 uint32 *entryIndexArray, uint32 *entryCount, uint8 *codeArray)
+{
+	int32 hashSlotArray[DICTIONARY_HASH_SLOT_COUNT];
+	for (uint32 slotIndex = 0; slotIndex < DICTIONARY_HASH_SLOT_COUNT; slotIndex++)
+	{
+		hashSlotArray[slotIndex] = -1;
+	}
+
+	*entryCount = 0;
+
+	for (uint32 datumIndex = 0; datumIndex < datumCount; datumIndex++)
+	{
+		SerializedDatum *serializedDatum = &serializedDatumArray[datumIndex];
+		uint32 slotIndex = hash_bytes((const unsigned char *) serializedDatum->data,
+									  serializedDatum->length) %
+						   DICTIONARY_HASH_SLOT_COUNT;
+
+		while (true)
+		{
+			int32 entryIndex = hashSlotArray[slotIndex];
+			if (entryIndex < 0)
+			{
+				if (*entryCount == CHUNK_DICTIONARY_MAX_ENTRIES)
+				{
+					return false;
+				}
+
+				entryIndex = *entryCount;
+				entryIndexArray[entryIndex] = datumIndex;
+				hashSlotArray[slotIndex] = entryIndex;
+				(*entryCount)++;
+
+				codeArray[datumIndex] = (uint8) entryIndex;
+				break;
+			}
+
+			SerializedDatum *entry = &serializedDatumArray[entryIndexArray[entryIndex]];
+			if (SerializedDatumsEqual(entry, serializedDatum))
+			{
+				codeArray[datumIndex] = (uint8) entryIndex;
+				break;
+			}
+
+			slotIndex = (slotIndex + 1) % DICTIONARY_HASH_SLOT_COUNT;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * CountExistingValues returns the number of rows that have a value.
+ */
+static uint32
+CountExistingValues(bool *existsArray, uint32 rowCount)
+{
+	uint32 datumCount = 0;
+	for (uint32 rowIndex = 0; rowIndex < rowCount; rowIndex++)
+	{
+		if (existsArray[rowIndex])
+		{
+			datumCount++;
+		}
+	}
+
+	return datumCount;
+}
+
+
+/*
+ * AppendEncodingHeader appends a ChunkEncodingHeader with given count to the
+ * encoded buffer, padded to CHUNK_ENCODING_HEADER_SIZE.
+ */
+static void
+AppendEncodingHeader(StringInfo encodedBuffer, uint32 count)
+{
+	ChunkEncodingHeader header = { 0 };
+	header.count = count;
+
+	appendBinaryStringInfo(encodedBuffer, (char *) &header, sizeof(header));
+	AppendAlignmentPadding(encodedBuffer);
+}
+
+
+/*
+ * AppendAlignmentPadding appends zero bytes to the encoded buffer until its
+ * length is MAXALIGN'ed.
+ */
+static void
+AppendAlignmentPadding(StringInfo encodedBuffer)
+{
+	int paddingLength = MAXALIGN(encodedBuffer->len) - encodedBuffer->len;
+	if (paddingLength == 0)
+	{
+		return;
+	}
+
+	enlargeStringInfo(encodedBuffer, paddingLength);
+	memset(encodedBuffer->data + encodedBuffer->len, 0, paddingLength);
+	encodedBuffer->len += paddingLength;
+	encodedBuffer->data[encodedBuffer->len] = '\0';
+}
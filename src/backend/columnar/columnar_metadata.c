@@ -43,6 +43,7 @@
 #include "executor/spi.h"
 #include "lib/stringinfo.h"
 #include "nodes/execnodes.h"
+#include "port/pg_bitutils.h"
 #include "storage/fd.h"
 #include "storage/lmgr.h"
 #include "storage/procarray.h"
@@ -52,6 +53,9 @@
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/typcache.h"
+#include "utils/varlena.h"
 
 #include "citus_version.h"
 #include "pg_version_constants.h"
@@ -99,6 +103,13 @@ typedef enum RowNumberLookupMode
 } RowNumberLookupMode;
 
 static void ParseColumnarRelOptions(List *reloptions, ColumnarOptions *options);
+static List * ParseColumnarSortKey(const char *sortKeyString);
+static void SetColumnarSortKey(Oid regclass, List *columnNameList);
+static void ParseColumnarColumnRelOptions(List *reloptions,
+										  ColumnarColumnOptions *options);
+static void WriteColumnarColumnOptions(Oid regclass, AttrNumber attnum,
+									   ColumnarColumnOptions *options);
+static void DeleteColumnarColumnOptions(Oid regclass);
 static void InsertEmptyStripeMetadataRow(uint64 storageId, uint64 stripeId,
 										 uint32 columnCount, uint32 chunkGroupRowCount,
 										 uint64 firstRowNumber);
@@ -118,25 +129,30 @@ static Oid ColumnarStripePKeyIndexRelationId(void);
 static Oid ColumnarStripeFirstRowNumberIndexRelationId(void);
 static Oid ColumnarOptionsRelationId(void);
 static Oid ColumnarOptionsIndexRegclass(void);
+static Oid ColumnarColumnOptionsRelationId(void);
+static Oid ColumnarColumnOptionsIndexRegclass(void);
 static Oid ColumnarChunkRelationId(void);
+static int ColumnarChunkAttributeCount(void);
 static Oid ColumnarChunkGroupRelationId(void);
 static Oid ColumnarChunkIndexRelationId(void);
 static Oid ColumnarChunkGroupIndexRelationId(void);
+static Oid ColumnarRowMaskRelationId(void);
+static Oid ColumnarRowMaskIndexRelationId(void);
 static Oid ColumnarNamespaceId(void);
 static uint64 LookupStorageId(RelFileLocator relfilelocator);
 static uint64 GetHighestUsedRowNumber(uint64 storageId);
 static void DeleteStorageFromColumnarMetadataTable(Oid metadataTableId,
 												   AttrNumber storageIdAtrrNumber,
 												   Oid storageIdIndexId,
-												   uint64 storageId);
+												   uint64 storageId,
+												   AttrNumber stripeAttrNumber,
+												   uint64 stripeId);
 static ModifyState * StartModifyRelation(Relation rel);
 static void InsertTupleAndEnforceConstraints(ModifyState *state, Datum *values,
 											 bool *nulls);
 static void DeleteTupleAndEnforceConstraints(ModifyState *state, HeapTuple heapTuple);
 static void FinishModifyRelation(ModifyState *state);
 static EState * create_estate_for_relation(Relation rel);
-static bytea * DatumToBytea(Datum value, Form_pg_attribute attrForm);
-static Datum ByteaToDatum(bytea *bytes, Form_pg_attribute attrForm);
 static bool WriteColumnarOptions(Oid regclass, ColumnarOptions *options, bool overwrite);
 static StripeMetadata * StripeMetadataLookupRowNumber(Relation relation, uint64 rowNumber,
 													  Snapshot snapshot,
@@ -171,6 +187,14 @@ typedef struct FormData_columnar_options
 typedef FormData_columnar_options *Form_columnar_options;
 
 
+/* constants for columnar.column_options */
+#define Natts_columnar_column_options 5
+#define Anum_columnar_column_options_regclass 1
+#define Anum_columnar_column_options_attr_num 2
+#define Anum_columnar_column_options_compression 3
+#define Anum_columnar_column_options_compression_level 4
+#define Anum_columnar_column_options_sort_key_position 5
+
 /* constants for columnar.stripe */
 #define Natts_columnar_stripe 9
 #define Anum_columnar_stripe_storageid 1
@@ -191,7 +215,7 @@ typedef FormData_columnar_options *Form_columnar_options;
 #define Anum_columnar_chunkgroup_row_count 4
 
 /* constants for columnar.chunk */
-#define Natts_columnar_chunk 14
+#define Natts_columnar_chunk 16
 #define Anum_columnar_chunk_storageid 1
 #define Anum_columnar_chunk_stripe 2
 #define Anum_columnar_chunk_attr 3
@@ -206,6 +230,15 @@ typedef FormData_columnar_options *Form_columnar_options;
 #define Anum_columnar_chunk_value_compression_level 12
 #define Anum_columnar_chunk_value_decompressed_size 13
 #define Anum_columnar_chunk_value_count 14
+#define Anum_columnar_chunk_value_encoding 15
+#define Anum_columnar_chunk_value_bloom_filter 16
+
+/* constants for columnar.row_mask */
+#define Natts_columnar_row_mask 4
+#define Anum_columnar_row_mask_storageid 1
+#define Anum_columnar_row_mask_stripe 2
+#define Anum_columnar_row_mask_deleted_rows 3
+#define Anum_columnar_row_mask_mask 4
 
 
 /*
@@ -310,6 +343,17 @@ ParseColumnarRelOptions(List *reloptions, ColumnarOptions *options)
 										COMPRESSION_LEVEL_MAX)));
 			}
 		}
+		else if (strcmp(elem->defname, "sort_key") == 0)
+		{
+			/*
+			 * The sort key is stored in the options of its columns, which are
+			 * resolved by SetColumnarRelOptions, so we only validate it here.
+			 */
+			if (elem->arg != NULL)
+			{
+				ParseColumnarSortKey(defGetString(elem));
+			}
+		}
 		else
 		{
 			ereport(ERROR, (errmsg("unrecognized columnar storage parameter \"%s\"",
@@ -319,6 +363,30 @@ ParseColumnarRelOptions(List *reloptions, ColumnarOptions *options)
 }
 
 
+/*
+ * ParseColumnarSortKey returns the list of column names in the given
+ * comma-separated columnar.sort_key value.
+ */
+static List *
+ParseColumnarSortKey(const char *sortKeyString)
+{
+	List *columnNameList = NIL;
+	char *rawString = pstrdup(sortKeyString);
+
+	if (!SplitIdentifierString(rawString, ',', &columnNameList) ||
+		columnNameList == NIL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("invalid sort key for columnar table: %s",
+							   quote_literal_cstr(sortKeyString)),
+						errhint("The sort key must be a comma-separated list of "
+								"column names.")));
+	}
+
+	return columnNameList;
+}
+
+
 /*
  * ExtractColumnarOptions - extract columnar options from inOptions, appending
  * to inoutColumnarOptions. Return the remaining (non-columnar) options.
@@ -352,6 +420,100 @@ ExtractColumnarRelOptions(List *inOptions, List **inoutColumnarOptions)
 }
 
 
+/*
+ * ParseColumnarColumnRelOptions - update the given column 'options' using the
+ * given list of DefElem. Only compression options can be set for a column,
+ * and resetting an option makes the column use the table's option.
+ */
+static void
+ParseColumnarColumnRelOptions(List *reloptions, ColumnarColumnOptions *options)
+{
+	ListCell *lc = NULL;
+
+	foreach(lc, reloptions)
+	{
+		DefElem *elem = castNode(DefElem, lfirst(lc));
+
+		if (elem->defnamespace == NULL ||
+			strcmp(elem->defnamespace, COLUMNAR_RELOPTION_NAMESPACE) != 0)
+		{
+			ereport(ERROR, (errmsg("columnar options must have the prefix \"%s\"",
+								   COLUMNAR_RELOPTION_NAMESPACE)));
+		}
+
+		if (strcmp(elem->defname, "compression") == 0)
+		{
+			options->compressionType = (elem->arg == NULL) ?
+									   COMPRESSION_TYPE_INVALID :
+									   ParseCompressionType(defGetString(elem));
+
+			if (elem->arg != NULL &&
+				options->compressionType == COMPRESSION_TYPE_INVALID)
+			{
+				ereport(ERROR, (errmsg("unknown compression type for columnar table: %s",
+									   quote_identifier(defGetString(elem)))));
+			}
+		}
+		else if (strcmp(elem->defname, "compression_level") == 0)
+		{
+			options->compressionLevel = (elem->arg == NULL) ? 0 : defGetInt64(elem);
+
+			if (elem->arg != NULL &&
+				(options->compressionLevel < COMPRESSION_LEVEL_MIN ||
+				 options->compressionLevel > COMPRESSION_LEVEL_MAX))
+			{
+				ereport(ERROR, (errmsg("compression level out of range"),
+								errhint("compression level must be between %d and %d",
+										COMPRESSION_LEVEL_MIN,
+										COMPRESSION_LEVEL_MAX)));
+			}
+		}
+		else
+		{
+			ereport(ERROR, (errmsg("columnar storage parameter \"%s\" cannot be set "
+								   "for a column", elem->defname),
+							errhint("Only columnar.compression and "
+									"columnar.compression_level can be set for a "
+									"column.")));
+		}
+	}
+}
+
+
+/*
+ * ExtractColumnarColumnRelOptions - extract columnar options from the options
+ * of an ALTER TABLE ... ALTER COLUMN ... SET / RESET command, appending to
+ * inoutColumnarOptions. Return the remaining (non-columnar) options.
+ */
+List *
+ExtractColumnarColumnRelOptions(List *inOptions, List **inoutColumnarOptions)
+{
+	List *otherOptions = NIL;
+
+	ListCell *lc = NULL;
+	foreach(lc, inOptions)
+	{
+		DefElem *elem = castNode(DefElem, lfirst(lc));
+
+		if (elem->defnamespace != NULL &&
+			strcmp(elem->defnamespace, COLUMNAR_RELOPTION_NAMESPACE) == 0)
+		{
+			*inoutColumnarOptions = lappend(*inoutColumnarOptions, elem);
+		}
+		else
+		{
+			otherOptions = lappend(otherOptions, elem);
+		}
+	}
+
+	/* validate options */
+	ColumnarColumnOptions dummy = { 0 };
+	ParseColumnarColumnRelOptions(*inoutColumnarOptions, &dummy);
+
+	return otherOptions;
+}
+
+
 /*
  * SetColumnarRelOptions - apply the list of DefElem options to the
  * relation. If there are duplicates, the last one in the list takes effect.
@@ -380,6 +542,173 @@ SetColumnarRelOptions(RangeVar *rv, List *reloptions)
 	ParseColumnarRelOptions(reloptions, &options);
 
 	SetColumnarOptions(relid, &options);
+
+	/* the last columnar.sort_key in the list takes effect, if any */
+	DefElem *sortKeyElem = NULL;
+	ListCell *lc = NULL;
+	foreach(lc, reloptions)
+	{
+		DefElem *elem = castNode(DefElem, lfirst(lc));
+		if (strcmp(elem->defname, "sort_key") == 0)
+		{
+			sortKeyElem = elem;
+		}
+	}
+
+	if (sortKeyElem != NULL)
+	{
+		List *columnNameList = (sortKeyElem->arg == NULL) ? NIL :
+							   ParseColumnarSortKey(defGetString(sortKeyElem));
+		SetColumnarSortKey(relid, columnNameList);
+	}
+}
+
+
+/*
+ * SetColumnarSortKey makes the given columns the sort key of the relation,
+ * in the given order, by recording their positions in the sort key in the
+ * column options. An empty list removes the sort key.
+ */
+static void
+SetColumnarSortKey(Oid regclass, List *columnNameList)
+{
+	if (ColumnarColumnOptionsRelationId() == InvalidOid)
+	{
+		ereport(ERROR, (errmsg("sort key cannot be set for columnar tables"),
+						errhint("Run ALTER EXTENSION citus_columnar UPDATE to "
+								"enable setting a sort key for columnar tables.")));
+	}
+
+	Relation rel = relation_open(regclass, AccessShareLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(rel);
+	int columnCount = tupleDescriptor->natts;
+	int *sortKeyPositionArray = palloc0(columnCount * sizeof(int));
+
+	int sortKeyPosition = 0;
+	char *columnName = NULL;
+	foreach_ptr(columnName, columnNameList)
+	{
+		AttrNumber attnum = get_attnum(regclass, columnName);
+		if (attnum == InvalidAttrNumber)
+		{
+			ereport(ERROR, (errcode(ERRCODE_UNDEFINED_COLUMN),
+							errmsg("column \"%s\" of relation \"%s\" does not exist",
+								   columnName, RelationGetRelationName(rel))));
+		}
+
+		if (attnum < 0)
+		{
+			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							errmsg("cannot use system column \"%s\" in the sort key",
+								   columnName)));
+		}
+
+		if (sortKeyPositionArray[attnum - 1] != 0)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DUPLICATE_COLUMN),
+							errmsg("column \"%s\" appears twice in the sort key",
+								   columnName)));
+		}
+
+		Oid typeId = TupleDescAttr(tupleDescriptor, attnum - 1)->atttypid;
+		TypeCacheEntry *typeEntry = lookup_type_cache(typeId, TYPECACHE_LT_OPR);
+		if (!OidIsValid(typeEntry->lt_opr))
+		{
+			ereport(ERROR, (errcode(ERRCODE_UNDEFINED_FUNCTION),
+							errmsg("cannot use column \"%s\" in the sort key",
+								   columnName),
+							errdetail("There is no default ordering operator for "
+									  "type %s.", format_type_be(typeId))));
+		}
+
+		sortKeyPosition++;
+		sortKeyPositionArray[attnum - 1] = sortKeyPosition;
+	}
+
+	ColumnarColumnOptions *columnOptionsArray =
+		ReadColumnarColumnOptions(regclass, columnCount);
+	relation_close(rel, NoLock);
+
+	for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		ColumnarColumnOptions options = {
+			.compressionType = COMPRESSION_TYPE_INVALID,
+			.compressionLevel = 0,
+			.sortKeyPosition = 0
+		};
+
+		if (columnOptionsArray != NULL)
+		{
+			options = columnOptionsArray[columnIndex];
+		}
+
+		if (options.sortKeyPosition == sortKeyPositionArray[columnIndex])
+		{
+			continue;
+		}
+
+		options.sortKeyPosition = sortKeyPositionArray[columnIndex];
+		WriteColumnarColumnOptions(regclass, columnIndex + 1, &options);
+	}
+}
+
+
+/*
+ * SetColumnarColumnRelOptions - apply the list of DefElem options to the
+ * given column of the relation. If there are duplicates, the last one in the
+ * list takes effect.
+ */
+void
+SetColumnarColumnRelOptions(RangeVar *rv, const char *columnName, List *reloptions)
+{
+	if (reloptions == NIL)
+	{
+		return;
+	}
+
+	if (ColumnarColumnOptionsRelationId() == InvalidOid)
+	{
+		ereport(ERROR, (errmsg("columnar options cannot be set for columns"),
+						errhint("Run ALTER EXTENSION citus_columnar UPDATE to "
+								"enable setting columnar options for columns.")));
+	}
+
+	Relation rel = relation_openrv(rv, AccessShareLock);
+	Oid relid = RelationGetRelid(rel);
+	TupleDesc tupleDescriptor = RelationGetDescr(rel);
+	AttrNumber attnum = get_attnum(relid, columnName);
+	if (attnum == InvalidAttrNumber)
+	{
+		ereport(ERROR, (errcode(ERRCODE_UNDEFINED_COLUMN),
+						errmsg("column \"%s\" of relation \"%s\" does not exist",
+							   columnName, RelationGetRelationName(rel))));
+	}
+
+	if (attnum < 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot set columnar options for system column \"%s\"",
+							   columnName)));
+	}
+
+	ColumnarColumnOptions *columnOptionsArray =
+		ReadColumnarColumnOptions(relid, tupleDescriptor->natts);
+	relation_close(rel, NoLock);
+
+	ColumnarColumnOptions options = {
+		.compressionType = COMPRESSION_TYPE_INVALID,
+		.compressionLevel = 0,
+		.sortKeyPosition = 0
+	};
+
+	if (columnOptionsArray != NULL)
+	{
+		options = columnOptionsArray[attnum - 1];
+	}
+
+	ParseColumnarColumnRelOptions(reloptions, &options);
+
+	WriteColumnarColumnOptions(relid, attnum, &options);
 }
 
 
@@ -534,6 +863,8 @@ DeleteColumnarTableOptions(Oid regclass, bool missingOk)
 	index_close(index, AccessShareLock);
 	relation_close(columnarOptions, RowExclusiveLock);
 
+	DeleteColumnarColumnOptions(regclass);
+
 	return result;
 }
 
@@ -597,6 +928,221 @@ ReadColumnarOptions(Oid regclass, ColumnarOptions *options)
 }
 
 
+/*
+ * WriteColumnarColumnOptions writes the options of given column to the catalog
+ * table. If the column doesn't override any options of the table, then the
+ * record of the column is removed.
+ */
+static void
+WriteColumnarColumnOptions(Oid regclass, AttrNumber attnum,
+						   ColumnarColumnOptions *options)
+{
+	bool nulls[Natts_columnar_column_options] = { 0 };
+	Datum values[Natts_columnar_column_options] = {
+		ObjectIdGetDatum(regclass),
+		Int32GetDatum(attnum),
+		0, /* to be filled below */
+		Int32GetDatum(options->compressionLevel),
+		Int32GetDatum(options->sortKeyPosition)
+	};
+
+	NameData compressionName = { 0 };
+	if (options->compressionType == COMPRESSION_TYPE_INVALID)
+	{
+		nulls[Anum_columnar_column_options_compression - 1] = true;
+	}
+	else
+	{
+		namestrcpy(&compressionName, CompressionTypeStr(options->compressionType));
+		values[Anum_columnar_column_options_compression - 1] =
+			NameGetDatum(&compressionName);
+	}
+
+	if (options->compressionLevel == 0)
+	{
+		nulls[Anum_columnar_column_options_compression_level - 1] = true;
+	}
+
+	if (options->sortKeyPosition == 0)
+	{
+		nulls[Anum_columnar_column_options_sort_key_position - 1] = true;
+	}
+
+	bool inheritsAllOptions = options->compressionType == COMPRESSION_TYPE_INVALID &&
+							  options->compressionLevel == 0 &&
+							  options->sortKeyPosition == 0;
+
+	Relation columnarColumnOptions = relation_open(ColumnarColumnOptionsRelationId(),
+												   RowExclusiveLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(columnarColumnOptions);
+
+	/* find existing item to perform update if exist */
+	ScanKeyData scanKey[2];
+	ScanKeyInit(&scanKey[0], Anum_columnar_column_options_regclass,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(regclass));
+	ScanKeyInit(&scanKey[1], Anum_columnar_column_options_attr_num,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(attnum));
+
+	Relation index = index_open(ColumnarColumnOptionsIndexRegclass(), AccessShareLock);
+	SysScanDesc scanDescriptor = systable_beginscan_ordered(columnarColumnOptions, index,
+															NULL, 2, scanKey);
+
+	HeapTuple heapTuple = systable_getnext_ordered(scanDescriptor, ForwardScanDirection);
+	if (HeapTupleIsValid(heapTuple) && inheritsAllOptions)
+	{
+		CatalogTupleDelete(columnarColumnOptions, &heapTuple->t_self);
+	}
+	else if (HeapTupleIsValid(heapTuple))
+	{
+		bool update[Natts_columnar_column_options] = { 0 };
+		update[Anum_columnar_column_options_compression - 1] = true;
+		update[Anum_columnar_column_options_compression_level - 1] = true;
+		update[Anum_columnar_column_options_sort_key_position - 1] = true;
+
+		HeapTuple tuple = heap_modify_tuple(heapTuple, tupleDescriptor,
+											values, nulls, update);
+		CatalogTupleUpdate(columnarColumnOptions, &tuple->t_self, tuple);
+	}
+	else if (!inheritsAllOptions)
+	{
+		HeapTuple newTuple = heap_form_tuple(tupleDescriptor, values, nulls);
+		CatalogTupleInsert(columnarColumnOptions, newTuple);
+	}
+
+	CommandCounterIncrement();
+
+	systable_endscan_ordered(scanDescriptor);
+	index_close(index, AccessShareLock);
+	relation_close(columnarColumnOptions, RowExclusiveLock);
+}
+
+
+/*
+ * DeleteColumnarColumnOptions removes the options of all the columns of given
+ * regclass, if any.
+ */
+static void
+DeleteColumnarColumnOptions(Oid regclass)
+{
+	Relation columnarColumnOptions = try_relation_open(ColumnarColumnOptionsRelationId(),
+													   RowExclusiveLock);
+	if (columnarColumnOptions == NULL)
+	{
+		/* extension has been dropped or is not updated yet */
+		return;
+	}
+
+	ScanKeyData scanKey[1];
+	ScanKeyInit(&scanKey[0], Anum_columnar_column_options_regclass,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(regclass));
+
+	Relation index = index_open(ColumnarColumnOptionsIndexRegclass(), AccessShareLock);
+	SysScanDesc scanDescriptor = systable_beginscan_ordered(columnarColumnOptions, index,
+															NULL, 1, scanKey);
+
+	HeapTuple heapTuple = NULL;
+	bool deleted = false;
+	while (HeapTupleIsValid(heapTuple = systable_getnext_ordered(scanDescriptor,
+																 ForwardScanDirection)))
+	{
+		CatalogTupleDelete(columnarColumnOptions, &heapTuple->t_self);
+		deleted = true;
+	}
+
+	if (deleted)
+	{
+		CommandCounterIncrement();
+	}
+
+	systable_endscan_ordered(scanDescriptor);
+	index_close(index, AccessShareLock);
+	relation_close(columnarColumnOptions, RowExclusiveLock);
+}
+
+
+/*
+ * ReadColumnarColumnOptions returns an array of the options of the first
+ * columnCount columns of given regclass, or NULL if none of the columns
+ * override the options of the table or are part of its sort key.
+ */
+ColumnarColumnOptions *
+ReadColumnarColumnOptions(Oid regclass, uint32 columnCount)
+{
+	Relation columnarColumnOptions = try_relation_open(ColumnarColumnOptionsRelationId(),
+													   AccessShareLock);
+	if (columnarColumnOptions == NULL)
+	{
+		/* extension has been dropped or is not updated yet */
+		return NULL;
+	}
+
+	ScanKeyData scanKey[1];
+	ScanKeyInit(&scanKey[0], Anum_columnar_column_options_regclass,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(regclass));
+
+	Relation index = index_open(ColumnarColumnOptionsIndexRegclass(), AccessShareLock);
+	SysScanDesc scanDescriptor = systable_beginscan_ordered(columnarColumnOptions, index,
+															NULL, 1, scanKey);
+
+	ColumnarColumnOptions *columnOptionsArray = NULL;
+	TupleDesc tupleDescriptor = RelationGetDescr(columnarColumnOptions);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext_ordered(scanDescriptor,
+																 ForwardScanDirection)))
+	{
+		Datum datumArray[Natts_columnar_column_options];
+		bool isNullArray[Natts_columnar_column_options];
+
+		heap_deform_tuple(heapTuple, tupleDescriptor, datumArray, isNullArray);
+
+		int32 attnum = DatumGetInt32(
+			datumArray[Anum_columnar_column_options_attr_num - 1]);
+		if (attnum < 1 || (uint32) attnum > columnCount)
+		{
+			continue;
+		}
+
+		if (columnOptionsArray == NULL)
+		{
+			columnOptionsArray = palloc0(columnCount * sizeof(ColumnarColumnOptions));
+			for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+			{
+				columnOptionsArray[columnIndex].compressionType =
+					COMPRESSION_TYPE_INVALID;
+			}
+		}
+
+		ColumnarColumnOptions *columnOptions = &columnOptionsArray[attnum - 1];
+		if (!isNullArray[Anum_columnar_column_options_compression - 1])
+		{
+			Name compressionName = DatumGetName(
+				datumArray[Anum_columnar_column_options_compression - 1]);
+			columnOptions->compressionType = ParseCompressionType(
+				NameStr(*compressionName));
+		}
+
+		if (!isNullArray[Anum_columnar_column_options_compression_level - 1])
+		{
+			columnOptions->compressionLevel = DatumGetInt32(
+				datumArray[Anum_columnar_column_options_compression_level - 1]);
+		}
+
+		if (!isNullArray[Anum_columnar_column_options_sort_key_position - 1])
+		{
+			columnOptions->sortKeyPosition = DatumGetInt32(
+				datumArray[Anum_columnar_column_options_sort_key_position - 1]);
+		}
+	}
+
+	systable_endscan_ordered(scanDescriptor);
+	index_close(index, AccessShareLock);
+	relation_close(columnarColumnOptions, AccessShareLock);
+
+	return columnOptionsArray;
+}
+
+
 /*
  * SaveStripeSkipList saves chunkList for a given stripe as rows
  * of columnar.chunk.
@@ -636,7 +1182,9 @@ SaveStripeSkipList(RelFileLocator relfilelocator, uint64 stripe,
 				Int32GetDatum(chunk->valueCompressionType),
 				Int32GetDatum(chunk->valueCompressionLevel),
 				Int64GetDatum(chunk->decompressedValueSize),
-				Int64GetDatum(chunk->rowCount)
+				Int64GetDatum(chunk->rowCount),
+				Int32GetDatum(chunk->valueEncodingType),
+				0  /* to be filled below */
 			};
 
 			bool nulls[Natts_columnar_chunk] = { false };
@@ -656,6 +1204,16 @@ SaveStripeSkipList(RelFileLocator relfilelocator, uint64 stripe,
 				nulls[Anum_columnar_chunk_maximum_value - 1] = true;
 			}
 
+			if (chunk->bloomFilter != NULL)
+			{
+				values[Anum_columnar_chunk_value_bloom_filter - 1] =
+					PointerGetDatum(chunk->bloomFilter);
+			}
+			else
+			{
+				nulls[Anum_columnar_chunk_value_bloom_filter - 1] = true;
+			}
+
 			InsertTupleAndEnforceConstraints(modifyState, values, nulls);
 		}
 	}
@@ -701,6 +1259,45 @@ SaveChunkGroups(RelFileLocator relfilelocator, uint64 stripe,
 }
 
 
+/*
+ * ColumnarChunkEncodingSupported returns true if columnar.chunk has the
+ * value_encoding column, which is added in citus_columnar 12.2-1. Chunks
+ * shouldn't be encoded until the extension is updated, since we couldn't
+ * record their encodings otherwise.
+ */
+bool
+ColumnarChunkEncodingSupported(void)
+{
+	return ColumnarChunkAttributeCount() >= Anum_columnar_chunk_value_encoding;
+}
+
+
+/*
+ * ColumnarChunkBloomFilterSupported returns true if columnar.chunk has the
+ * value_bloom_filter column, which is added in citus_columnar 12.2-1.
+ */
+bool
+ColumnarChunkBloomFilterSupported(void)
+{
+	return ColumnarChunkAttributeCount() >= Anum_columnar_chunk_value_bloom_filter;
+}
+
+
+/*
+ * ColumnarChunkAttributeCount returns the number of attributes of
+ * columnar.chunk, which depends on the installed citus_columnar version.
+ */
+static int
+ColumnarChunkAttributeCount(void)
+{
+	Relation columnarChunk = table_open(ColumnarChunkRelationId(), AccessShareLock);
+	int attributeCount = RelationGetDescr(columnarChunk)->natts;
+	table_close(columnarChunk, AccessShareLock);
+
+	return attributeCount;
+}
+
+
 /*
  * ReadStripeSkipList fetches chunk metadata for a given stripe.
  */
@@ -790,6 +1387,32 @@ ReadStripeSkipList(RelFileLocator relfilelocator, uint64 stripe,
 		chunk->decompressedValueSize =
 			DatumGetInt64(datumArray[Anum_columnar_chunk_value_decompressed_size - 1]);
 
+		/* value_encoding doesn't exist before citus_columnar 12.2-1 */
+		chunk->valueEncodingType = CHUNK_ENCODING_NONE;
+		if (RelationGetDescr(columnarChunk)->natts >= Anum_columnar_chunk_value_encoding)
+		{
+			chunk->valueEncodingType =
+				DatumGetInt32(datumArray[Anum_columnar_chunk_value_encoding - 1]);
+		}
+
+		/* value_bloom_filter doesn't exist before citus_columnar 12.2-1 */
+		chunk->bloomFilter = NULL;
+		if (RelationGetDescr(columnarChunk)->natts >=
+			Anum_columnar_chunk_value_bloom_filter &&
+			!isNullArray[Anum_columnar_chunk_value_bloom_filter - 1])
+		{
+			chunk->bloomFilter = DatumGetByteaPCopy(
+				datumArray[Anum_columnar_chunk_value_bloom_filter - 1]);
+		}
+
+		if (chunk->valueEncodingType < 0 ||
+			chunk->valueEncodingType >= CHUNK_ENCODING_COUNT)
+		{
+			ereport(ERROR, (errmsg("invalid columnar chunk entry"),
+							errdetail("Unknown value encoding: %d",
+									  chunk->valueEncodingType)));
+		}
+
 		if (isNullArray[Anum_columnar_chunk_minimum_value - 1] ||
 			isNullArray[Anum_columnar_chunk_maximum_value - 1])
 		{
@@ -1202,6 +1825,211 @@ ReadChunkGroupRowCounts(uint64 storageId, uint64 stripe, uint32 chunkGroupCount,
 }
 
 
+/*
+ * ReadStripeRowMask returns the bitmap of the rows of given stripe that are
+ * deleted by the transactions visible to given snapshot, or NULL if none of
+ * the rows of the stripe are deleted.
+ */
+uint8 *
+ReadStripeRowMask(uint64 storageId, uint64 stripeId, uint64 rowCount,
+				  Snapshot snapshot)
+{
+	Oid columnarRowMaskOid = ColumnarRowMaskRelationId();
+	if (!OidIsValid(columnarRowMaskOid))
+	{
+		/* extension is not updated yet, so rows cannot be deleted */
+		return NULL;
+	}
+
+	Relation columnarRowMask = table_open(columnarRowMaskOid, AccessShareLock);
+
+	ScanKeyData scanKey[2];
+	ScanKeyInit(&scanKey[0], Anum_columnar_row_mask_storageid,
+				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(storageId));
+	ScanKeyInit(&scanKey[1], Anum_columnar_row_mask_stripe,
+				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(stripeId));
+
+	Oid indexId = ColumnarRowMaskIndexRelationId();
+	bool indexOk = OidIsValid(indexId);
+	SysScanDesc scanDescriptor =
+		systable_beginscan(columnarRowMask, indexId, indexOk, snapshot, 2, scanKey);
+
+	static bool loggedSlowMetadataAccessWarning = false;
+	if (!indexOk && !loggedSlowMetadataAccessWarning)
+	{
+		ereport(WARNING, (errmsg(SLOW_METADATA_ACCESS_WARNING, "row_mask_pkey")));
+		loggedSlowMetadataAccessWarning = true;
+	}
+
+	uint8 *rowMask = NULL;
+
+	HeapTuple heapTuple = systable_getnext(scanDescriptor);
+	if (HeapTupleIsValid(heapTuple))
+	{
+		Datum datumArray[Natts_columnar_row_mask];
+		bool isNullArray[Natts_columnar_row_mask];
+
+		heap_deform_tuple(heapTuple, RelationGetDescr(columnarRowMask),
+						  datumArray, isNullArray);
+
+		bytea *maskBytes = DatumGetByteaPP(datumArray[Anum_columnar_row_mask_mask - 1]);
+		Size maskSize = COLUMNAR_ROW_MASK_SIZE(rowCount);
+		Size storedMaskSize = VARSIZE_ANY_EXHDR(maskBytes);
+
+		rowMask = palloc0(maskSize);
+		memcpy_s(rowMask, maskSize, VARDATA_ANY(maskBytes),
+				 Min(maskSize, storedMaskSize));
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(columnarRowMask, AccessShareLock);
+
+	return rowMask;
+}
+
+
+/*
+ * SaveStripeRowMask marks the rows in given bitmap as deleted in the
+ * columnar.row_mask record of given stripe, and creates the record if it
+ * doesn't exist yet.
+ *
+ * Callers should make sure that concurrent transactions cannot update the
+ * record of the stripe at the same time, see ColumnarDeleteRow.
+ */
+void
+SaveStripeRowMask(uint64 storageId, uint64 stripeId, uint64 rowCount,
+				  const uint8 *deletedRowMask)
+{
+	Oid columnarRowMaskOid = ColumnarRowMaskRelationId();
+	if (!OidIsValid(columnarRowMaskOid))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot delete rows from columnar tables before "
+							   "updating citus_columnar"),
+						errhint("Run ALTER EXTENSION citus_columnar UPDATE and try "
+								"again.")));
+	}
+
+	Relation columnarRowMask = table_open(columnarRowMaskOid, RowExclusiveLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(columnarRowMask);
+
+	ScanKeyData scanKey[2];
+	ScanKeyInit(&scanKey[0], Anum_columnar_row_mask_storageid,
+				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(storageId));
+	ScanKeyInit(&scanKey[1], Anum_columnar_row_mask_stripe,
+				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(stripeId));
+
+	Relation index = index_open(ColumnarRowMaskIndexRelationId(), AccessShareLock);
+	SysScanDesc scanDescriptor = systable_beginscan_ordered(columnarRowMask, index,
+															SnapshotSelf, 2, scanKey);
+
+	Size maskSize = COLUMNAR_ROW_MASK_SIZE(rowCount);
+	bytea *maskBytes = palloc0(maskSize + VARHDRSZ);
+	SET_VARSIZE(maskBytes, maskSize + VARHDRSZ);
+	uint8 *rowMask = (uint8 *) VARDATA(maskBytes);
+
+	HeapTuple heapTuple = systable_getnext_ordered(scanDescriptor, ForwardScanDirection);
+	if (HeapTupleIsValid(heapTuple))
+	{
+		Datum datumArray[Natts_columnar_row_mask];
+		bool isNullArray[Natts_columnar_row_mask];
+
+		heap_deform_tuple(heapTuple, tupleDescriptor, datumArray, isNullArray);
+
+		bytea *oldMaskBytes =
+			DatumGetByteaPP(datumArray[Anum_columnar_row_mask_mask - 1]);
+		memcpy_s(rowMask, maskSize, VARDATA_ANY(oldMaskBytes),
+				 Min(maskSize, VARSIZE_ANY_EXHDR(oldMaskBytes)));
+	}
+
+	for (Size byteIndex = 0; byteIndex < maskSize; byteIndex++)
+	{
+		rowMask[byteIndex] |= deletedRowMask[byteIndex];
+	}
+
+	uint64 deletedRowCount = pg_popcount((const char *) rowMask, maskSize);
+
+	bool nulls[Natts_columnar_row_mask] = { 0 };
+	Datum values[Natts_columnar_row_mask] = {
+		UInt64GetDatum(storageId),
+		Int64GetDatum(stripeId),
+		Int64GetDatum(deletedRowCount),
+		PointerGetDatum(maskBytes)
+	};
+
+	if (HeapTupleIsValid(heapTuple))
+	{
+		bool update[Natts_columnar_row_mask] = { 0 };
+		update[Anum_columnar_row_mask_deleted_rows - 1] = true;
+		update[Anum_columnar_row_mask_mask - 1] = true;
+
+		HeapTuple tuple = heap_modify_tuple(heapTuple, tupleDescriptor,
+											values, nulls, update);
+		CatalogTupleUpdate(columnarRowMask, &tuple->t_self, tuple);
+	}
+	else
+	{
+		HeapTuple newTuple = heap_form_tuple(tupleDescriptor, values, nulls);
+		CatalogTupleInsert(columnarRowMask, newTuple);
+	}
+
+	CommandCounterIncrement();
+
+	systable_endscan_ordered(scanDescriptor);
+	index_close(index, AccessShareLock);
+	table_close(columnarRowMask, RowExclusiveLock);
+}
+
+
+/*
+ * ColumnarDeletedRowCount returns the number of rows deleted from given
+ * relfilenode by the transactions visible to the transaction snapshot.
+ */
+uint64
+ColumnarDeletedRowCount(RelFileLocator relfilelocator)
+{
+	Oid columnarRowMaskOid = ColumnarRowMaskRelationId();
+	if (!OidIsValid(columnarRowMaskOid))
+	{
+		return 0;
+	}
+
+	uint64 storageId = LookupStorageId(relfilelocator);
+
+	Relation columnarRowMask = table_open(columnarRowMaskOid, AccessShareLock);
+
+	ScanKeyData scanKey[1];
+	ScanKeyInit(&scanKey[0], Anum_columnar_row_mask_storageid,
+				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(storageId));
+
+	Oid indexId = ColumnarRowMaskIndexRelationId();
+	bool indexOk = OidIsValid(indexId);
+	SysScanDesc scanDescriptor =
+		systable_beginscan(columnarRowMask, indexId, indexOk,
+						   GetTransactionSnapshot(), 1, scanKey);
+
+	uint64 deletedRowCount = 0;
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		Datum datumArray[Natts_columnar_row_mask];
+		bool isNullArray[Natts_columnar_row_mask];
+
+		heap_deform_tuple(heapTuple, RelationGetDescr(columnarRowMask),
+						  datumArray, isNullArray);
+
+		deletedRowCount +=
+			DatumGetInt64(datumArray[Anum_columnar_row_mask_deleted_rows - 1]);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(columnarRowMask, AccessShareLock);
+
+	return deletedRowCount;
+}
+
+
 /*
  * InsertEmptyStripeMetadataRow adds a row to columnar.stripe for the empty
  * stripe reservation made for stripeId.
@@ -1284,6 +2112,9 @@ GetHighestUsedAddress(RelFileLocator relfilelocator)
 /*
  * GetHighestUsedAddressAndId returns the highest used address and id for
  * the given relfilenode across all active and inactive transactions.
+ *
+ * The stripes that are removed by VACUUM but that might still be read by
+ * the transactions with older snapshots are considered as used too.
  */
 static void
 GetHighestUsedAddressAndId(uint64 storageId,
@@ -1292,10 +2123,14 @@ GetHighestUsedAddressAndId(uint64 storageId,
 {
 	ListCell *stripeMetadataCell = NULL;
 
-	SnapshotData SnapshotDirty;
-	InitDirtySnapshot(SnapshotDirty);
+	Relation columnarStripes = table_open(ColumnarStripeRelationId(), AccessShareLock);
 
-	List *stripeMetadataList = ReadDataFileStripeList(storageId, &SnapshotDirty);
+	SnapshotData SnapshotNonVacuumable;
+	InitNonVacuumableSnapshot(SnapshotNonVacuumable, GlobalVisTestFor(columnarStripes));
+
+	List *stripeMetadataList = ReadDataFileStripeList(storageId, &SnapshotNonVacuumable);
+
+	table_close(columnarStripes, AccessShareLock);
 
 	*highestUsedId = 0;
 
@@ -1568,31 +2403,90 @@ DeleteMetadataRows(RelFileLocator relfilelocator)
 	DeleteStorageFromColumnarMetadataTable(ColumnarStripeRelationId(),
 										   Anum_columnar_stripe_storageid,
 										   ColumnarStripePKeyIndexRelationId(),
-										   storageId);
+										   storageId, InvalidAttrNumber, 0);
 	DeleteStorageFromColumnarMetadataTable(ColumnarChunkGroupRelationId(),
 										   Anum_columnar_chunkgroup_storageid,
 										   ColumnarChunkGroupIndexRelationId(),
-										   storageId);
+										   storageId, InvalidAttrNumber, 0);
 	DeleteStorageFromColumnarMetadataTable(ColumnarChunkRelationId(),
 										   Anum_columnar_chunk_storageid,
 										   ColumnarChunkIndexRelationId(),
-										   storageId);
+										   storageId, InvalidAttrNumber, 0);
+
+	Oid rowMaskRelationId = ColumnarRowMaskRelationId();
+	if (OidIsValid(rowMaskRelationId))
+	{
+		DeleteStorageFromColumnarMetadataTable(rowMaskRelationId,
+											   Anum_columnar_row_mask_storageid,
+											   ColumnarRowMaskIndexRelationId(),
+											   storageId, InvalidAttrNumber, 0);
+	}
+}
+
+
+/*
+ * DeleteStripeMetadataRows removes the rows of given stripe from columnar
+ * metadata tables. It is used when the rows of the stripe are moved into
+ * other stripes, so the data of the stripe is not read anymore.
+ */
+void
+DeleteStripeMetadataRows(RelFileLocator relfilelocator, uint64 stripeId)
+{
+	uint64 storageId = LookupStorageId(relfilelocator);
+
+	DeleteStorageFromColumnarMetadataTable(ColumnarStripeRelationId(),
+										   Anum_columnar_stripe_storageid,
+										   ColumnarStripePKeyIndexRelationId(),
+										   storageId, Anum_columnar_stripe_stripe,
+										   stripeId);
+	DeleteStorageFromColumnarMetadataTable(ColumnarChunkGroupRelationId(),
+										   Anum_columnar_chunkgroup_storageid,
+										   ColumnarChunkGroupIndexRelationId(),
+										   storageId, Anum_columnar_chunkgroup_stripe,
+										   stripeId);
+	DeleteStorageFromColumnarMetadataTable(ColumnarChunkRelationId(),
+										   Anum_columnar_chunk_storageid,
+										   ColumnarChunkIndexRelationId(),
+										   storageId, Anum_columnar_chunk_stripe,
+										   stripeId);
+
+	Oid rowMaskRelationId = ColumnarRowMaskRelationId();
+	if (OidIsValid(rowMaskRelationId))
+	{
+		DeleteStorageFromColumnarMetadataTable(rowMaskRelationId,
+											   Anum_columnar_row_mask_storageid,
+											   ColumnarRowMaskIndexRelationId(),
+											   storageId, Anum_columnar_row_mask_stripe,
+											   stripeId);
+	}
+
+	CommandCounterIncrement();
 }
 
 
 /*
  * DeleteStorageFromColumnarMetadataTable removes the rows with given
- * storageId from given columnar metadata table.
+ * storageId from given columnar metadata table. If stripeAttrNumber is
+ * valid, then only the rows of given stripe are removed.
  */
 static void
 DeleteStorageFromColumnarMetadataTable(Oid metadataTableId,
 									   AttrNumber storageIdAtrrNumber,
-									   Oid storageIdIndexId, uint64 storageId)
+									   Oid storageIdIndexId, uint64 storageId,
+									   AttrNumber stripeAttrNumber, uint64 stripeId)
 {
-	ScanKeyData scanKey[1];
+	ScanKeyData scanKey[2];
+	int scanKeyCount = 1;
 	ScanKeyInit(&scanKey[0], storageIdAtrrNumber, BTEqualStrategyNumber,
 				F_INT8EQ, Int64GetDatum(storageId));
 
+	if (AttributeNumberIsValid(stripeAttrNumber))
+	{
+		ScanKeyInit(&scanKey[1], stripeAttrNumber, BTEqualStrategyNumber,
+					F_INT8EQ, Int64GetDatum(stripeId));
+		scanKeyCount++;
+	}
+
 	Relation metadataTable = try_relation_open(metadataTableId, AccessShareLock);
 	if (metadataTable == NULL)
 	{
@@ -1602,7 +2496,8 @@ DeleteStorageFromColumnarMetadataTable(Oid metadataTableId,
 
 	bool indexOk = OidIsValid(storageIdIndexId);
 	SysScanDesc scanDescriptor = systable_beginscan(metadataTable, storageIdIndexId,
-													indexOk, NULL, 1, scanKey);
+													indexOk, NULL, scanKeyCount,
+													scanKey);
 
 	static bool loggedSlowMetadataAccessWarning = false;
 	if (!indexOk && !loggedSlowMetadataAccessWarning)
@@ -1750,7 +2645,7 @@ create_estate_for_relation(Relation rel)
  * Since we don't want to limit datum size to RSIZE_MAX unnecessarily,
  * we use memcpy instead of memcpy_s several places in this function.
  */
-static bytea *
+bytea *
 DatumToBytea(Datum value, Form_pg_attribute attrForm)
 {
 	int datumLength = att_addlength_datum(0, attrForm->attlen, value);
@@ -1785,7 +2680,7 @@ DatumToBytea(Datum value, Form_pg_attribute attrForm)
  * ByteaToDatum deserializes a value which was previously serialized using
  * DatumToBytea.
  */
-static Datum
+Datum
 ByteaToDatum(bytea *bytes, Form_pg_attribute attrForm)
 {
 	/*
@@ -1869,6 +2764,27 @@ ColumnarOptionsIndexRegclass(void)
 }
 
 
+/*
+ * ColumnarColumnOptionsRelationId returns relation id of columnar.column_options.
+ */
+static Oid
+ColumnarColumnOptionsRelationId(void)
+{
+	return get_relname_relid("column_options", ColumnarNamespaceId());
+}
+
+
+/*
+ * ColumnarColumnOptionsIndexRegclass returns relation id of
+ * columnar.column_options_pkey.
+ */
+static Oid
+ColumnarColumnOptionsIndexRegclass(void)
+{
+	return get_relname_relid("column_options_pkey", ColumnarNamespaceId());
+}
+
+
 /*
  * ColumnarChunkRelationId returns relation id of columnar.chunk.
  * TODO: should we cache this similar to citus?
@@ -1913,6 +2829,27 @@ ColumnarChunkGroupIndexRelationId(void)
 }
 
 
+/*
+ * ColumnarRowMaskRelationId returns relation id of columnar.row_mask, or
+ * InvalidOid if the extension is not updated yet.
+ */
+static Oid
+ColumnarRowMaskRelationId(void)
+{
+	return get_relname_relid("row_mask", ColumnarNamespaceId());
+}
+
+
+/*
+ * ColumnarRowMaskIndexRelationId returns relation id of columnar.row_mask_pkey.
+ */
+static Oid
+ColumnarRowMaskIndexRelationId(void)
+{
+	return get_relname_relid("row_mask_pkey", ColumnarNamespaceId());
+}
+
+
 /*
  * ColumnarNamespaceId returns namespace id of the schema we store columnar
  * related tables.
@@ -18,22 +18,30 @@
 
 #include "safe_lib.h"
 
+#include "access/hash.h"
 #include "access/nbtree.h"
 #include "access/xact.h"
 #include "catalog/pg_am.h"
+#include "catalog/pg_type.h"
 #include "commands/defrem.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/restrictinfo.h"
+#include "port/pg_bitutils.h"
 #include "storage/fd.h"
+#include "utils/array.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/spccache.h"
 
 #include "columnar/columnar.h"
+#include "columnar/columnar_bloom.h"
+#include "columnar/columnar_chunk_cache.h"
+#include "columnar/columnar_scan_stats.h"
 #include "columnar/columnar_storage.h"
 #include "columnar/columnar_tableam.h"
 #include "columnar/columnar_version_compat.h"
@@ -44,6 +52,47 @@
 	"attempted to read an unexpected stripe while reading columnar " \
 	"table %s, stripe with id=" UINT64_FORMAT " is not flushed"
 
+/*
+ * Number of stripes, and number of chunk groups per stripe, that random
+ * access reads keep decoded besides the ones being read, so that index
+ * scans going back and forth between a few of them don't read and
+ * decompress the same chunks again.
+ */
+#define RECENT_STRIPE_READ_COUNT 4
+#define RECENT_CHUNK_GROUP_READ_COUNT 8
+
+/*
+ * ColumnarVectorQual is a pushed down qual in the form of "Var op Const"
+ * that can be evaluated directly over the deserialized column values of a
+ * chunk group, without forming a tuple for each row.
+ */
+typedef struct ColumnarVectorQual
+{
+	/* 0-indexed attribute number of the Var */
+	int columnIndex;
+
+	/* true if the qual is in the form of "Var op Const" */
+	bool varOnLeft;
+
+	Datum constValue;
+	Oid inputCollation;
+	FmgrInfo operatorFunction;
+} ColumnarVectorQual;
+
+/*
+ * BloomFilterQual is a pushed down qual in the form of "Var = Const" or
+ * "Var = ANY(Const)" that can be checked against the bloom filters of the
+ * column chunks. hashArray contains the hashes of the non-NULL constants.
+ */
+typedef struct BloomFilterQual
+{
+	/* 0-indexed attribute number of the Var */
+	int columnIndex;
+
+	uint32 hashCount;
+	uint32 *hashArray;
+} BloomFilterQual;
+
 typedef struct ChunkGroupReadState
 {
 	int64 currentRow;
@@ -51,6 +100,13 @@ typedef struct ChunkGroupReadState
 	int columnCount;
 	List *projectedColumnList;  /* borrowed reference */
 	ChunkData *chunkGroupData;
+
+	/*
+	 * selectedRowMask[row] is false if the row is deleted or refuted by
+	 * vectorQualList, or NULL if none of the rows of the chunk group are
+	 * deleted and we didn't evaluate any vectorized quals for it.
+	 */
+	bool *selectedRowMask;
 } ChunkGroupReadState;
 
 typedef struct StripeReadState
@@ -66,8 +122,40 @@ typedef struct StripeReadState
 	StripeBuffers *stripeBuffers;   /* allocated in stripeReadContext */
 	List *projectedColumnList;      /* borrowed reference */
 	ChunkGroupReadState *chunkGroupReadState; /* owned */
+
+	/* number of rows in the chunk groups that we finished reading */
+	int64 chunkGroupRowOffset;
+
+	/*
+	 * Offset of the last row that we read within the stripe. This differs
+	 * from currentRow - 1 when some of the chunk groups are filtered out.
+	 */
+	int64 currentRowOffset;
+
+	List *vectorQualList;           /* borrowed reference */
+	MemoryContext vectorQualContext;
+
+	/*
+	 * Chunk groups that ReadStripeRowByRowNumber decoded before the one in
+	 * chunkGroupReadState, the most recently read one first.
+	 */
+	int recentChunkGroupCount;
+	int recentChunkGroupIndexes[RECENT_CHUNK_GROUP_READ_COUNT];
+	ChunkGroupReadState *recentChunkGroupReadStates[RECENT_CHUNK_GROUP_READ_COUNT];
 } StripeReadState;
 
+/*
+ * RecentStripeRead is a stripe that ColumnarReadRowByRowNumber read before
+ * the one that is being read, together with the memory context that the
+ * state of its read is allocated in.
+ */
+typedef struct RecentStripeRead
+{
+	StripeMetadata *stripeMetadata;
+	StripeReadState *stripeReadState;
+	MemoryContext stripeReadContext;
+} RecentStripeRead;
+
 struct ColumnarReadState
 {
 	TupleDesc tupleDescriptor;
@@ -85,9 +173,32 @@ struct ColumnarReadState
 	List *whereClauseList;
 	List *whereClauseVars;
 
+	/*
+	 * List of ColumnarVectorQual's built from whereClauseList if
+	 * columnar.enable_vectorized_filter is set.
+	 */
+	List *vectorQualList;
+	MemoryContext vectorQualContext;
+
 	MemoryContext stripeReadContext;
 	int64 chunkGroupsFiltered;
 
+	/*
+	 * Counters of the read operation, which are not reset on rescans since
+	 * EXPLAIN ANALYZE reports them for all the loops of the scan.
+	 */
+	ColumnarScanStats scanStats;
+
+	/*
+	 * While reading a stripe, we issue prefetch requests for the projected
+	 * columns of the next stripe. We keep the skip list that we read for
+	 * that purpose in prefetchContext, so that we don't need to read it
+	 * again when we start reading the next stripe.
+	 */
+	uint64 prefetchedStripeId;
+	StripeSkipList *prefetchedSkipList;
+	MemoryContext prefetchContext;
+
 	/*
 	 * Memory context guaranteed to be not freed during scan so we can
 	 * safely use for any memory allocations regarding ColumnarReadState
@@ -97,6 +208,34 @@ struct ColumnarReadState
 
 	Snapshot snapshot;
 	bool snapshotRegisteredByUs;
+
+	/*
+	 * Shared state of a parallel scan, or NULL if this is not a parallel scan.
+	 *
+	 * For parallel scans, we also keep track of the last stripe that we
+	 * visited when looking for the stripe claimed from the shared state and
+	 * the index of the stripe that we would visit next.
+	 */
+	ParallelColumnarScanDesc parallelScan;
+	uint64 parallelScanLastRowNumber;
+	uint64 parallelScanNextStripeIndex;
+
+	/*
+	 * For parallel scans, we claim the first stripe to read lazily since the
+	 * shared state might need to be reinitialized before we start reading.
+	 */
+	bool parallelScanAdvancePending;
+
+	/*
+	 * If set, called for each chunk group that is not refuted by the quals
+	 * to decide whether we should read it, see ColumnarChunkGroupCallback.
+	 */
+	ColumnarChunkGroupCallback chunkGroupCallback;
+	void *chunkGroupCallbackState;
+
+	/* stripes read by ColumnarReadRowByRowNumber, the most recent first */
+	int recentStripeReadCount;
+	RecentStripeRead recentStripeReads[RECENT_STRIPE_READ_COUNT];
 };
 
 /* static function declarations */
@@ -104,12 +243,18 @@ static MemoryContext CreateStripeReadMemoryContext(void);
 static bool ColumnarReadIsCurrentStripe(ColumnarReadState *readState,
 										uint64 rowNumber);
 static StripeMetadata * ColumnarReadGetCurrentStripe(ColumnarReadState *readState);
-static void ReadStripeRowByRowNumber(ColumnarReadState *readState,
+static bool SwitchToRecentStripeRead(ColumnarReadState *readState, uint64 rowNumber);
+static void SaveCurrentStripeRead(ColumnarReadState *readState);
+static void ResetRecentStripeReads(ColumnarReadState *readState);
+static bool SwitchToRecentChunkGroupRead(StripeReadState *stripeReadState,
+										 int chunkGroupIndex);
+static void SaveCurrentChunkGroupRead(StripeReadState *stripeReadState);
+static bool ReadStripeRowByRowNumber(ColumnarReadState *readState,
 									 uint64 rowNumber, Datum *columnValues,
 									 bool *columnNulls);
 static bool StripeReadIsCurrentChunkGroup(StripeReadState *stripeReadState,
 										  int chunkGroupIndex);
-static void ReadChunkGroupRowByRowOffset(ChunkGroupReadState *chunkGroupReadState,
+static bool ReadChunkGroupRowByRowOffset(ChunkGroupReadState *chunkGroupReadState,
 										 StripeMetadata *stripeMetadata,
 										 uint64 stripeRowOffset, Datum *columnValues,
 										 bool *columnNulls);
@@ -118,16 +263,29 @@ static bool HasUnreadStripe(ColumnarReadState *readState);
 static StripeReadState * BeginStripeRead(StripeMetadata *stripeMetadata, Relation rel,
 										 TupleDesc tupleDesc, List *projectedColumnList,
 										 List *whereClauseList, List *whereClauseVars,
+										 List *vectorQualList,
+										 MemoryContext vectorQualContext,
+										 StripeSkipList *stripeSkipList,
 										 MemoryContext stripeReadContext,
+										 ColumnarChunkGroupCallback chunkGroupCallback,
+										 void *chunkGroupCallbackState,
+										 ColumnarScanStats *scanStats,
 										 Snapshot snapshot);
 static void AdvanceStripeRead(ColumnarReadState *readState);
+static StripeMetadata * ClaimNextParallelStripe(ColumnarReadState *readState);
 static bool SnapshotMightSeeUnflushedStripes(Snapshot snapshot);
+static void PrefetchNextStripe(ColumnarReadState *readState);
+static StripeSkipList * TakePrefetchedSkipList(ColumnarReadState *readState,
+											   uint64 stripeId);
 static bool ReadStripeNextRow(StripeReadState *stripeReadState, Datum *columnValues,
 							  bool *columnNulls);
-static ChunkGroupReadState * BeginChunkGroupRead(StripeBuffers *stripeBuffers, int
-												 chunkIndex,
+static ChunkGroupReadState * BeginChunkGroupRead(Relation relation,
+												 StripeBuffers *stripeBuffers,
+												 int chunkIndex,
 												 TupleDesc tupleDesc,
 												 List *projectedColumnList,
+												 List *vectorQualList,
+												 MemoryContext vectorQualContext,
 												 MemoryContext cxt);
 static void EndChunkGroupRead(ChunkGroupReadState *chunkGroupReadState);
 static bool ReadChunkGroupNextRow(ChunkGroupReadState *chunkGroupReadState,
@@ -139,15 +297,30 @@ static StripeBuffers * LoadFilteredStripeBuffers(Relation relation,
 												 List *projectedColumnList,
 												 List *whereClauseList,
 												 List *whereClauseVars,
+												 StripeSkipList *stripeSkipList,
+												 bool *deferredColumnMask,
+												 ColumnarChunkGroupCallback
+												 chunkGroupCallback,
+												 void *chunkGroupCallbackState,
 												 int64 *chunkGroupsFiltered,
+												 ColumnarScanStats *scanStats,
 												 Snapshot snapshot);
 static ColumnBuffers * LoadColumnBuffers(Relation relation,
 										 ColumnChunkSkipNode *chunkSkipNodeArray,
 										 uint32 chunkCount, uint64 stripeOffset,
-										 Form_pg_attribute attributeForm);
+										 Form_pg_attribute attributeForm,
+										 bool deferValueRead,
+										 ColumnarScanStats *scanStats);
 static bool * SelectedChunkMask(StripeSkipList *stripeSkipList,
 								List *whereClauseList, List *whereClauseVars,
 								int64 *chunkGroupsFiltered);
+static bool ChunkGroupMatchesAllRows(StripeSkipList *stripeSkipList, uint32 chunkIndex,
+									 TupleDesc tupleDescriptor, List *whereClauseList,
+									 List *whereClauseVars);
+static uint32 ChunkGroupDeletedRowCount(uint8 *deletedRowMask, uint64 firstRowOffset,
+										uint32 rowCount);
+static bool * ChunkGroupLiveRowMask(StripeBuffers *stripeBuffers, int chunkIndex,
+									uint32 chunkGroupRowCount);
 static Node * BuildBaseConstraint(Var *variable);
 static List * GetClauseVars(List *clauses, int natts);
 static OpExpr * MakeOpExpression(Var *variable, int16 strategyNumber);
@@ -158,30 +331,53 @@ static StripeSkipList * SelectedChunkSkipList(StripeSkipList *stripeSkipList,
 											  bool *selectedChunkMask);
 static uint32 StripeSkipListRowCount(StripeSkipList *stripeSkipList);
 static bool * ProjectedColumnMask(uint32 columnCount, List *projectedColumnList);
-static void DeserializeBoolArray(StringInfo boolArrayBuffer, bool *boolArray,
-								 uint32 boolArrayLength);
+static uint32 DeserializeBoolArray(StringInfo boolArrayBuffer, bool *boolArray,
+								   uint32 boolArrayLength);
 static void DeserializeDatumArray(StringInfo datumBuffer, bool *existsArray,
-								  uint32 datumCount, bool datumTypeByValue,
-								  int datumTypeLength, char datumTypeAlign,
-								  Datum *datumArray);
-static ChunkData * DeserializeChunkData(StripeBuffers *stripeBuffers, uint64 chunkIndex,
-										uint32 rowCount, TupleDesc tupleDescriptor,
-										List *projectedColumnList);
+								  uint32 datumCount, uint32 existingDatumCount,
+								  bool datumTypeByValue, int datumTypeLength,
+								  char datumTypeAlign, Datum *datumArray);
+static void DeserializeFixedWidthDatumArray(StringInfo datumBuffer, bool *existsArray,
+											uint32 datumCount,
+											uint32 existingDatumCount,
+											int datumTypeLength, Datum *datumArray);
+static void DeserializeChunkData(Relation relation, StripeBuffers *stripeBuffers,
+								 uint64 chunkIndex, uint32 rowCount,
+								 TupleDesc tupleDescriptor, bool *columnMask,
+								 ChunkData *chunkData);
 static Datum ColumnDefaultValue(TupleConstr *tupleConstraints,
 								Form_pg_attribute attributeForm);
+static bool * VectorQualColumnMask(uint32 columnCount, List *vectorQualList);
+static bool * DeferredColumnMask(uint32 columnCount, List *projectedColumnList,
+								 List *vectorQualList);
+static List * BuildVectorQualList(List *whereClauseList, TupleDesc tupleDescriptor,
+								  List *projectedColumnList);
+static ColumnarVectorQual * BuildVectorQual(Node *clause, TupleDesc tupleDescriptor,
+											bool *projectedColumnMask);
+static List * BuildBloomFilterQualList(List *whereClauseList);
+static BloomFilterQual * BuildBloomFilterQual(Node *clause);
+static bool BloomFilterQualRefutesChunk(BloomFilterQual *bloomFilterQual,
+										bytea *bloomFilter);
+static bool * EvaluateVectorQuals(ChunkData *chunkData, List *vectorQualList,
+								  MemoryContext vectorQualContext);
 
 /*
  * ColumnarBeginRead initializes a columnar read operation. This function returns a
  * read handle that's used during reading rows and finishing the read operation.
  *
  * projectedColumnList is an integer list of attribute numbers (1-indexed).
+ *
+ * If parallelScan is not NULL, then the stripes are distributed among the
+ * participants of the parallel scan by using the given shared state.
  */
 ColumnarReadState *
 ColumnarBeginRead(Relation relation, TupleDesc tupleDescriptor,
 				  List *projectedColumnList, List *whereClauseList,
 				  MemoryContext scanContext, Snapshot snapshot,
-				  bool randomAccess)
+				  bool randomAccess, ParallelColumnarScanDesc parallelScan)
 {
+	Assert(parallelScan == NULL || !randomAccess);
+
 	/*
 	 * We allocate all stripe specific data in the stripeReadContext, and reset
 	 * this memory context before loading a new stripe. This is to avoid memory
@@ -194,7 +390,18 @@ ColumnarBeginRead(Relation relation, TupleDesc tupleDescriptor,
 	readState->projectedColumnList = projectedColumnList;
 	readState->whereClauseList = whereClauseList;
 	readState->whereClauseVars = GetClauseVars(whereClauseList, tupleDescriptor->natts);
+	readState->vectorQualList = BuildVectorQualList(whereClauseList, tupleDescriptor,
+													projectedColumnList);
+	readState->vectorQualContext = AllocSetContextCreate(CurrentMemoryContext,
+														 "Columnar Vector Qual Context",
+														 ALLOCSET_DEFAULT_SIZES);
 	readState->chunkGroupsFiltered = 0;
+	memset(&readState->scanStats, 0, sizeof(ColumnarScanStats));
+	readState->prefetchedStripeId = 0;
+	readState->prefetchedSkipList = NULL;
+	readState->prefetchContext = AllocSetContextCreate(CurrentMemoryContext,
+													   "Columnar Prefetch Context",
+													   ALLOCSET_DEFAULT_SIZES);
 	readState->tupleDescriptor = tupleDescriptor;
 	readState->stripeReadContext = stripeReadContext;
 	readState->stripeReadState = NULL;
@@ -207,6 +414,14 @@ ColumnarBeginRead(Relation relation, TupleDesc tupleDescriptor,
 	readState->snapshot = snapshot;
 	readState->snapshotRegisteredByUs = false;
 
+	readState->parallelScan = parallelScan;
+	readState->parallelScanLastRowNumber = COLUMNAR_INVALID_ROW_NUMBER;
+	readState->parallelScanNextStripeIndex = 0;
+	readState->parallelScanAdvancePending = false;
+	readState->chunkGroupCallback = NULL;
+	readState->chunkGroupCallbackState = NULL;
+	readState->recentStripeReadCount = 0;
+
 	if (!randomAccess)
 	{
 		/*
@@ -231,8 +446,17 @@ ColumnarBeginRead(Relation relation, TupleDesc tupleDescriptor,
 		 *
 		 * For those reasons, we don't call AdvanceStripeRead if we will do
 		 * random access.
+		 *
+		 * For parallel scans, ColumnarReadNextRow claims the first stripe.
 		 */
-		AdvanceStripeRead(readState);
+		if (parallelScan != NULL)
+		{
+			readState->parallelScanAdvancePending = true;
+		}
+		else
+		{
+			AdvanceStripeRead(readState);
+		}
 	}
 
 	return readState;
@@ -324,6 +548,12 @@ bool
 ColumnarReadNextRow(ColumnarReadState *readState, Datum *columnValues, bool *columnNulls,
 					uint64 *rowNumber)
 {
+	if (readState->parallelScanAdvancePending)
+	{
+		readState->parallelScanAdvancePending = false;
+		AdvanceStripeRead(readState);
+	}
+
 	while (true)
 	{
 		if (!StripeReadInProgress(readState))
@@ -333,14 +563,31 @@ ColumnarReadNextRow(ColumnarReadState *readState, Datum *columnValues, bool *col
 				return false;
 			}
 
+			StripeSkipList *stripeSkipList =
+				TakePrefetchedSkipList(readState, readState->currentStripeMetadata->id);
+
 			readState->stripeReadState = BeginStripeRead(readState->currentStripeMetadata,
 														 readState->relation,
 														 readState->tupleDescriptor,
 														 readState->projectedColumnList,
 														 readState->whereClauseList,
 														 readState->whereClauseVars,
+														 readState->vectorQualList,
+														 readState->vectorQualContext,
+														 stripeSkipList,
 														 readState->stripeReadContext,
+														 readState->chunkGroupCallback,
+														 readState->
+														 chunkGroupCallbackState,
+														 &readState->scanStats,
 														 readState->snapshot);
+
+			/*
+			 * Now that we have read the current stripe from disk, ask the
+			 * kernel to start reading the next one while we are decompressing
+			 * and returning the rows of the current stripe.
+			 */
+			PrefetchNextStripe(readState);
 		}
 
 		if (!ReadStripeNextRow(readState->stripeReadState, columnValues, columnNulls))
@@ -352,7 +599,7 @@ ColumnarReadNextRow(ColumnarReadState *readState, Datum *columnValues, bool *col
 		if (rowNumber)
 		{
 			*rowNumber = readState->currentStripeMetadata->firstRowNumber +
-						 readState->stripeReadState->currentRow - 1;
+						 readState->stripeReadState->currentRowOffset;
 		}
 
 		return true;
@@ -393,7 +640,8 @@ ColumnarReadRowByRowNumber(ColumnarReadState *readState,
 						   uint64 rowNumber, Datum *columnValues,
 						   bool *columnNulls)
 {
-	if (!ColumnarReadIsCurrentStripe(readState, rowNumber))
+	if (!ColumnarReadIsCurrentStripe(readState, rowNumber) &&
+		!SwitchToRecentStripeRead(readState, rowNumber))
 	{
 		Relation columnarRelation = readState->relation;
 		Snapshot snapshot = readState->snapshot;
@@ -417,12 +665,14 @@ ColumnarReadRowByRowNumber(ColumnarReadState *readState,
 								   stripeMetadata->id)));
 		}
 
-		/* do the cleanup before reading a new stripe */
-		ColumnarResetRead(readState);
+		/* keep the stripe being read for the next rows, if any */
+		SaveCurrentStripeRead(readState);
 
 		TupleDesc relationTupleDesc = RelationGetDescr(columnarRelation);
 		List *whereClauseList = NIL;
 		List *whereClauseVars = NIL;
+		List *vectorQualList = NIL;
+		StripeSkipList *stripeSkipList = NULL;
 		MemoryContext stripeReadContext = readState->stripeReadContext;
 		readState->stripeReadState = BeginStripeRead(stripeMetadata,
 													 columnarRelation,
@@ -430,15 +680,192 @@ ColumnarReadRowByRowNumber(ColumnarReadState *readState,
 													 readState->projectedColumnList,
 													 whereClauseList,
 													 whereClauseVars,
+													 vectorQualList,
+													 readState->vectorQualContext,
+													 stripeSkipList,
 													 stripeReadContext,
+													 NULL, NULL,
+													 &readState->scanStats,
 													 snapshot);
 
 		readState->currentStripeMetadata = stripeMetadata;
 	}
 
-	ReadStripeRowByRowNumber(readState, rowNumber, columnValues, columnNulls);
+	return ReadStripeRowByRowNumber(readState, rowNumber, columnValues, columnNulls);
+}
 
-	return true;
+
+/*
+ * ColumnarReadSampleStripes returns the flushed stripes that the snapshot of
+ * given read operation sees, in the order of their row numbers, and sets
+ * stripeCount to their number. Sampling scans use these to map the blocks
+ * they sample to the rows that they read by ColumnarReadRowByRowNumber.
+ */
+ColumnarSampleStripe *
+ColumnarReadSampleStripes(ColumnarReadState *readState, uint32 *stripeCount)
+{
+	uint32 sampleStripeCount = 0;
+	uint32 sampleStripeCapacity = 16;
+	ColumnarSampleStripe *sampleStripes =
+		palloc(sampleStripeCapacity * sizeof(ColumnarSampleStripe));
+
+	uint64 precedingRowCount = 0;
+	uint64 precedingChunkGroupCount = 0;
+	uint64 lastRowNumber = COLUMNAR_INVALID_ROW_NUMBER;
+
+	StripeMetadata *stripeMetadata = NULL;
+	while ((stripeMetadata = FindNextStripeByRowNumber(readState->relation,
+													   lastRowNumber,
+													   readState->snapshot)) != NULL)
+	{
+		/*
+		 * As in AdvanceStripeRead, skip the stripes that are not flushed yet,
+		 * which don't have a meaningful row count.
+		 */
+		if (StripeWriteState(stripeMetadata) != STRIPE_WRITE_FLUSHED ||
+			stripeMetadata->rowCount == 0)
+		{
+			lastRowNumber = stripeMetadata->firstRowNumber;
+			continue;
+		}
+
+		lastRowNumber = StripeGetHighestRowNumber(stripeMetadata);
+
+		if (sampleStripeCount == sampleStripeCapacity)
+		{
+			sampleStripeCapacity *= 2;
+			sampleStripes = repalloc(sampleStripes, sampleStripeCapacity *
+									 sizeof(ColumnarSampleStripe));
+		}
+
+		ColumnarSampleStripe *sampleStripe = &sampleStripes[sampleStripeCount++];
+		sampleStripe->firstRowNumber = stripeMetadata->firstRowNumber;
+		sampleStripe->rowCount = stripeMetadata->rowCount;
+		sampleStripe->chunkGroupRowCount = stripeMetadata->chunkGroupRowCount;
+		sampleStripe->precedingRowCount = precedingRowCount;
+		sampleStripe->precedingChunkGroupCount = precedingChunkGroupCount;
+
+		precedingRowCount += stripeMetadata->rowCount;
+		precedingChunkGroupCount += stripeMetadata->chunkCount;
+	}
+
+	*stripeCount = sampleStripeCount;
+	return sampleStripes;
+}
+
+
+/*
+ * SwitchToRecentStripeRead makes the recently read stripe that contains the
+ * row with given rowNumber the stripe being read, and returns true. Returns
+ * false if none of the recently read stripes contain the row.
+ */
+static bool
+SwitchToRecentStripeRead(ColumnarReadState *readState, uint64 rowNumber)
+{
+	for (int stripeIndex = 0; stripeIndex < readState->recentStripeReadCount;
+		 stripeIndex++)
+	{
+		RecentStripeRead recentStripeRead = readState->recentStripeReads[stripeIndex];
+		StripeMetadata *stripeMetadata = recentStripeRead.stripeMetadata;
+		if (rowNumber < stripeMetadata->firstRowNumber ||
+			rowNumber > StripeGetHighestRowNumber(stripeMetadata))
+		{
+			continue;
+		}
+
+		/* remove it from the list, and put the current stripe to the front */
+		for (int shiftIndex = stripeIndex; shiftIndex > 0; shiftIndex--)
+		{
+			readState->recentStripeReads[shiftIndex] =
+				readState->recentStripeReads[shiftIndex - 1];
+		}
+
+		readState->recentStripeReads[0].stripeMetadata =
+			readState->currentStripeMetadata;
+		readState->recentStripeReads[0].stripeReadState = readState->stripeReadState;
+		readState->recentStripeReads[0].stripeReadContext =
+			readState->stripeReadContext;
+
+		/* we only keep stripes in the list when another one is being read */
+		Assert(StripeReadInProgress(readState));
+
+		readState->currentStripeMetadata = recentStripeRead.stripeMetadata;
+		readState->stripeReadState = recentStripeRead.stripeReadState;
+		readState->stripeReadContext = recentStripeRead.stripeReadContext;
+
+		return true;
+	}
+
+	return false;
+}
+
+
+/*
+ * SaveCurrentStripeRead moves the stripe being read, if any, to the front of
+ * the recently read stripes, dropping the least recently read one if there's
+ * no room. Then, stripeReadContext is an empty memory context that can be
+ * used to read another stripe.
+ */
+static void
+SaveCurrentStripeRead(ColumnarReadState *readState)
+{
+	if (!StripeReadInProgress(readState))
+	{
+		return;
+	}
+
+	MemoryContext stripeReadContext = NULL;
+	if (readState->recentStripeReadCount == RECENT_STRIPE_READ_COUNT)
+	{
+		RecentStripeRead *oldestStripeRead =
+			&readState->recentStripeReads[RECENT_STRIPE_READ_COUNT - 1];
+
+		pfree(oldestStripeRead->stripeMetadata);
+		stripeReadContext = oldestStripeRead->stripeReadContext;
+		MemoryContextReset(stripeReadContext);
+
+		readState->recentStripeReadCount--;
+	}
+	else
+	{
+		MemoryContext oldContext = MemoryContextSwitchTo(readState->scanContext);
+		stripeReadContext = CreateStripeReadMemoryContext();
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	for (int shiftIndex = readState->recentStripeReadCount; shiftIndex > 0;
+		 shiftIndex--)
+	{
+		readState->recentStripeReads[shiftIndex] =
+			readState->recentStripeReads[shiftIndex - 1];
+	}
+
+	readState->recentStripeReads[0].stripeMetadata = readState->currentStripeMetadata;
+	readState->recentStripeReads[0].stripeReadState = readState->stripeReadState;
+	readState->recentStripeReads[0].stripeReadContext = readState->stripeReadContext;
+	readState->recentStripeReadCount++;
+
+	readState->currentStripeMetadata = NULL;
+	readState->stripeReadState = NULL;
+	readState->stripeReadContext = stripeReadContext;
+}
+
+
+/*
+ * ResetRecentStripeReads forgets the recently read stripes.
+ */
+static void
+ResetRecentStripeReads(ColumnarReadState *readState)
+{
+	for (int stripeIndex = 0; stripeIndex < readState->recentStripeReadCount;
+		 stripeIndex++)
+	{
+		RecentStripeRead *recentStripeRead = &readState->recentStripeReads[stripeIndex];
+		pfree(recentStripeRead->stripeMetadata);
+		MemoryContextDelete(recentStripeRead->stripeReadContext);
+	}
+
+	readState->recentStripeReadCount = 0;
 }
 
 
@@ -478,10 +905,11 @@ ColumnarReadGetCurrentStripe(ColumnarReadState *readState)
 
 /*
  * ReadStripeRowByRowNumber reads row with rowNumber from given
- * stripeReadState into columnValues and columnNulls.
- * Errors out if no such row exists in the stripe being read.
+ * stripeReadState into columnValues and columnNulls, and returns true.
+ * Returns false if the row is deleted, and errors out if no such row
+ * exists in the stripe being read.
  */
-static void
+static bool
 ReadStripeRowByRowNumber(ColumnarReadState *readState,
 						 uint64 rowNumber, Datum *columnValues,
 						 bool *columnNulls)
@@ -497,26 +925,135 @@ ReadStripeRowByRowNumber(ColumnarReadState *readState,
 
 	/* find the exact chunk group to be read */
 	uint64 stripeRowOffset = rowNumber - stripeMetadata->firstRowNumber;
-	int chunkGroupIndex = stripeRowOffset / stripeMetadata->chunkGroupRowCount;
-	if (!StripeReadIsCurrentChunkGroup(stripeReadState, chunkGroupIndex))
+	uint32 stripeChunkGroupIndex = stripeRowOffset / stripeMetadata->chunkGroupRowCount;
+
+	/*
+	 * The chunk groups whose rows are all deleted are not loaded, so look up
+	 * the position of the chunk group among the loaded ones.
+	 */
+	StripeBuffers *stripeBuffers = stripeReadState->stripeBuffers;
+	int chunkGroupIndex = Min(stripeChunkGroupIndex,
+							  stripeBuffers->selectedChunkGroupCount);
+	while (chunkGroupIndex >= 0 &&
+		   (chunkGroupIndex == stripeBuffers->selectedChunkGroupCount ||
+			stripeBuffers->selectedChunkGroupIndexes[chunkGroupIndex] >
+			stripeChunkGroupIndex))
 	{
-		if (stripeReadState->chunkGroupReadState)
-		{
-			EndChunkGroupRead(stripeReadState->chunkGroupReadState);
-		}
+		chunkGroupIndex--;
+	}
+
+	if (chunkGroupIndex < 0 ||
+		stripeBuffers->selectedChunkGroupIndexes[chunkGroupIndex] !=
+		stripeChunkGroupIndex)
+	{
+		/* all rows of the chunk group are deleted */
+		return false;
+	}
+
+	if (!StripeReadIsCurrentChunkGroup(stripeReadState, chunkGroupIndex) &&
+		!SwitchToRecentChunkGroupRead(stripeReadState, chunkGroupIndex))
+	{
+		/* keep the chunk group being read for the next rows, if any */
+		SaveCurrentChunkGroupRead(stripeReadState);
 
 		stripeReadState->chunkGroupIndex = chunkGroupIndex;
 		stripeReadState->chunkGroupReadState = BeginChunkGroupRead(
+			stripeReadState->relation,
 			stripeReadState->stripeBuffers,
 			stripeReadState->chunkGroupIndex,
 			stripeReadState->tupleDescriptor,
 			stripeReadState->projectedColumnList,
+			stripeReadState->vectorQualList,
+			stripeReadState->vectorQualContext,
 			stripeReadState->stripeReadContext);
 	}
 
-	ReadChunkGroupRowByRowOffset(stripeReadState->chunkGroupReadState,
-								 stripeMetadata, stripeRowOffset,
-								 columnValues, columnNulls);
+	return ReadChunkGroupRowByRowOffset(stripeReadState->chunkGroupReadState,
+										stripeMetadata, stripeRowOffset,
+										columnValues, columnNulls);
+}
+
+
+/*
+ * SwitchToRecentChunkGroupRead makes the recently read chunk group with given
+ * index the chunk group being read, and returns true. Returns false if it's
+ * not among the recently read chunk groups.
+ */
+static bool
+SwitchToRecentChunkGroupRead(StripeReadState *stripeReadState, int chunkGroupIndex)
+{
+	for (int recentIndex = 0; recentIndex < stripeReadState->recentChunkGroupCount;
+		 recentIndex++)
+	{
+		if (stripeReadState->recentChunkGroupIndexes[recentIndex] != chunkGroupIndex)
+		{
+			continue;
+		}
+
+		ChunkGroupReadState *chunkGroupReadState =
+			stripeReadState->recentChunkGroupReadStates[recentIndex];
+
+		/* remove it from the list, and put the current chunk group to the front */
+		for (int shiftIndex = recentIndex; shiftIndex > 0; shiftIndex--)
+		{
+			stripeReadState->recentChunkGroupIndexes[shiftIndex] =
+				stripeReadState->recentChunkGroupIndexes[shiftIndex - 1];
+			stripeReadState->recentChunkGroupReadStates[shiftIndex] =
+				stripeReadState->recentChunkGroupReadStates[shiftIndex - 1];
+		}
+
+		/* we only keep chunk groups in the list when another one is being read */
+		Assert(stripeReadState->chunkGroupReadState != NULL);
+
+		stripeReadState->recentChunkGroupIndexes[0] = stripeReadState->chunkGroupIndex;
+		stripeReadState->recentChunkGroupReadStates[0] =
+			stripeReadState->chunkGroupReadState;
+
+		stripeReadState->chunkGroupIndex = chunkGroupIndex;
+		stripeReadState->chunkGroupReadState = chunkGroupReadState;
+
+		return true;
+	}
+
+	return false;
+}
+
+
+/*
+ * SaveCurrentChunkGroupRead moves the chunk group being read, if any, to the
+ * front of the recently read chunk groups, and finishes the read of the least
+ * recently read one if there's no room.
+ */
+static void
+SaveCurrentChunkGroupRead(StripeReadState *stripeReadState)
+{
+	if (stripeReadState->chunkGroupReadState == NULL)
+	{
+		return;
+	}
+
+	if (stripeReadState->recentChunkGroupCount == RECENT_CHUNK_GROUP_READ_COUNT)
+	{
+		EndChunkGroupRead(
+			stripeReadState->recentChunkGroupReadStates[RECENT_CHUNK_GROUP_READ_COUNT -
+														1]);
+		stripeReadState->recentChunkGroupCount--;
+	}
+
+	for (int shiftIndex = stripeReadState->recentChunkGroupCount; shiftIndex > 0;
+		 shiftIndex--)
+	{
+		stripeReadState->recentChunkGroupIndexes[shiftIndex] =
+			stripeReadState->recentChunkGroupIndexes[shiftIndex - 1];
+		stripeReadState->recentChunkGroupReadStates[shiftIndex] =
+			stripeReadState->recentChunkGroupReadStates[shiftIndex - 1];
+	}
+
+	stripeReadState->recentChunkGroupIndexes[0] = stripeReadState->chunkGroupIndex;
+	stripeReadState->recentChunkGroupReadStates[0] = stripeReadState->chunkGroupReadState;
+	stripeReadState->recentChunkGroupCount++;
+
+	stripeReadState->chunkGroupReadState = NULL;
 }
 
 
@@ -538,10 +1075,11 @@ StripeReadIsCurrentChunkGroup(StripeReadState *stripeReadState, int chunkGroupIn
 
 /*
  * ReadChunkGroupRowByRowOffset reads row with stripeRowOffset from given
- * chunkGroupReadState into columnValues and columnNulls.
- * Errors out if no such row exists in the chunk group being read.
+ * chunkGroupReadState into columnValues and columnNulls, and returns true.
+ * Returns false if the row is deleted, and errors out if no such row exists
+ * in the chunk group being read.
  */
-static void
+static bool
 ReadChunkGroupRowByRowOffset(ChunkGroupReadState *chunkGroupReadState,
 							 StripeMetadata *stripeMetadata,
 							 uint64 stripeRowOffset, Datum *columnValues,
@@ -550,11 +1088,23 @@ ReadChunkGroupRowByRowOffset(ChunkGroupReadState *chunkGroupReadState,
 	/* set the exact row number to be read from given chunk roup */
 	chunkGroupReadState->currentRow = stripeRowOffset %
 									  stripeMetadata->chunkGroupRowCount;
+
+	/* random access reads don't have quals, so only deleted rows are masked */
+	bool *selectedRowMask = chunkGroupReadState->selectedRowMask;
+	if (selectedRowMask != NULL &&
+		chunkGroupReadState->currentRow < chunkGroupReadState->rowCount &&
+		!selectedRowMask[chunkGroupReadState->currentRow])
+	{
+		return false;
+	}
+
 	if (!ReadChunkGroupNextRow(chunkGroupReadState, columnValues, columnNulls))
 	{
 		/* not expected but be on the safe side */
 		ereport(ERROR, (errmsg("could not find the row in stripe")));
 	}
+
+	return true;
 }
 
 
@@ -590,12 +1140,27 @@ ColumnarRescan(ColumnarReadState *readState, List *scanQual)
 
 	ColumnarResetRead(readState);
 
-	/* set currentStripeMetadata for the first stripe to read */
-	AdvanceStripeRead(readState);
+	/*
+	 * Set currentStripeMetadata for the first stripe to read. For parallel
+	 * scans, defer that to ColumnarReadNextRow since the leader reinitializes
+	 * the shared state only after rescanning the plan nodes.
+	 */
+	if (readState->parallelScan != NULL)
+	{
+		readState->currentStripeMetadata = NULL;
+		readState->parallelScanAdvancePending = true;
+	}
+	else
+	{
+		AdvanceStripeRead(readState);
+	}
 
 	readState->chunkGroupsFiltered = 0;
 
 	readState->whereClauseList = copyObject(scanQual);
+	readState->vectorQualList = BuildVectorQualList(readState->whereClauseList,
+													readState->tupleDescriptor,
+													readState->projectedColumnList);
 	MemoryContextSwitchTo(oldContext);
 }
 
@@ -615,7 +1180,12 @@ ColumnarEndRead(ColumnarReadState *readState)
 		UnregisterSnapshot(readState->snapshot);
 	}
 
+	ColumnarScanStatsReport(readState->relation, &readState->scanStats);
+
+	ResetRecentStripeReads(readState);
 	MemoryContextDelete(readState->stripeReadContext);
+	MemoryContextDelete(readState->vectorQualContext);
+	MemoryContextDelete(readState->prefetchContext);
 	if (readState->currentStripeMetadata)
 	{
 		pfree(readState->currentStripeMetadata);
@@ -632,6 +1202,8 @@ ColumnarEndRead(ColumnarReadState *readState)
 void
 ColumnarResetRead(ColumnarReadState *readState)
 {
+	ResetRecentStripeReads(readState);
+
 	if (StripeReadInProgress(readState))
 	{
 		pfree(readState->currentStripeMetadata);
@@ -649,7 +1221,11 @@ ColumnarResetRead(ColumnarReadState *readState)
 static StripeReadState *
 BeginStripeRead(StripeMetadata *stripeMetadata, Relation rel, TupleDesc tupleDesc,
 				List *projectedColumnList, List *whereClauseList, List *whereClauseVars,
-				MemoryContext stripeReadContext, Snapshot snapshot)
+				List *vectorQualList, MemoryContext vectorQualContext,
+				StripeSkipList *stripeSkipList, MemoryContext stripeReadContext,
+				ColumnarChunkGroupCallback chunkGroupCallback,
+				void *chunkGroupCallbackState, ColumnarScanStats *scanStats,
+				Snapshot snapshot)
 {
 	MemoryContext oldContext = MemoryContextSwitchTo(stripeReadContext);
 
@@ -659,8 +1235,19 @@ BeginStripeRead(StripeMetadata *stripeMetadata, Relation rel, TupleDesc tupleDes
 	stripeReadState->tupleDescriptor = tupleDesc;
 	stripeReadState->columnCount = tupleDesc->natts;
 	stripeReadState->chunkGroupReadState = NULL;
+	stripeReadState->recentChunkGroupCount = 0;
 	stripeReadState->projectedColumnList = projectedColumnList;
 	stripeReadState->stripeReadContext = stripeReadContext;
+	stripeReadState->chunkGroupRowOffset = 0;
+	stripeReadState->vectorQualList = vectorQualList;
+	stripeReadState->vectorQualContext = vectorQualContext;
+
+	/*
+	 * Columns that are not referenced by the vectorized quals are read only
+	 * for the chunk groups that have rows satisfying the quals.
+	 */
+	bool *deferredColumnMask = DeferredColumnMask(tupleDesc->natts, projectedColumnList,
+												  vectorQualList);
 
 	stripeReadState->stripeBuffers = LoadFilteredStripeBuffers(rel,
 															   stripeMetadata,
@@ -668,8 +1255,13 @@ BeginStripeRead(StripeMetadata *stripeMetadata, Relation rel, TupleDesc tupleDes
 															   projectedColumnList,
 															   whereClauseList,
 															   whereClauseVars,
+															   stripeSkipList,
+															   deferredColumnMask,
+															   chunkGroupCallback,
+															   chunkGroupCallbackState,
 															   &stripeReadState->
 															   chunkGroupsFiltered,
+															   scanStats,
 															   snapshot);
 
 	stripeReadState->rowCount = stripeReadState->stripeBuffers->rowCount;
@@ -700,6 +1292,23 @@ AdvanceStripeRead(ColumnarReadState *readState)
 		readState->chunkGroupsFiltered +=
 			readState->stripeReadState->chunkGroupsFiltered;
 	}
+	else
+	{
+		/* a parallel scan visits the stripes from the beginning too */
+		readState->parallelScanLastRowNumber = COLUMNAR_INVALID_ROW_NUMBER;
+		readState->parallelScanNextStripeIndex = 0;
+	}
+
+	if (readState->parallelScan != NULL)
+	{
+		readState->currentStripeMetadata = ClaimNextParallelStripe(readState);
+
+		readState->stripeReadState = NULL;
+		MemoryContextReset(readState->stripeReadContext);
+
+		MemoryContextSwitchTo(oldContext);
+		return;
+	}
 
 	readState->currentStripeMetadata = FindNextStripeByRowNumber(readState->relation,
 																 lastReadRowNumber,
@@ -736,23 +1345,85 @@ AdvanceStripeRead(ColumnarReadState *readState)
 
 
 /*
- * SnapshotMightSeeUnflushedStripes returns true if given snapshot is
- * expected to see un-flushed stripes either because of other backends'
- * pending writes or aborted transactions.
+ * ClaimNextParallelStripe claims the next stripe to be read by the current
+ * participant of a parallel scan and returns its metadata, or NULL if all
+ * the stripes are claimed already.
+ *
+ * Stripes are claimed by their indexes, so we visit the stripes that are
+ * claimed by other participants too until reaching to the one that we
+ * claimed. Note that visiting a stripe only requires an index lookup on
+ * columnar.stripe, which is much cheaper than reading the stripe itself.
  */
-static bool
-SnapshotMightSeeUnflushedStripes(Snapshot snapshot)
+static StripeMetadata *
+ClaimNextParallelStripe(ColumnarReadState *readState)
 {
-	if (snapshot == InvalidSnapshot)
-	{
-		return false;
-	}
+	ParallelColumnarScanDesc parallelScan = readState->parallelScan;
 
-	switch (snapshot->snapshot_type)
+	while (true)
 	{
-		case SNAPSHOT_ANY:
-		case SNAPSHOT_DIRTY:
-		case SNAPSHOT_NON_VACUUMABLE:
+		uint64 claimedStripeIndex =
+			pg_atomic_fetch_add_u64(&parallelScan->nextStripeIndex, 1);
+
+		StripeMetadata *stripeMetadata = NULL;
+		while (readState->parallelScanNextStripeIndex <= claimedStripeIndex)
+		{
+			stripeMetadata =
+				FindNextStripeByRowNumber(readState->relation,
+										  readState->parallelScanLastRowNumber,
+										  readState->snapshot);
+			if (stripeMetadata == NULL)
+			{
+				/* no more stripes to claim */
+				return NULL;
+			}
+
+			/*
+			 * Un-flushed stripes don't have a meaningful row count, so we
+			 * continue with next stripe after their first row number, as in
+			 * AdvanceStripeRead.
+			 */
+			readState->parallelScanLastRowNumber =
+				StripeWriteState(stripeMetadata) == STRIPE_WRITE_FLUSHED ?
+				StripeGetHighestRowNumber(stripeMetadata) :
+				stripeMetadata->firstRowNumber;
+			readState->parallelScanNextStripeIndex++;
+		}
+
+		if (StripeWriteState(stripeMetadata) == STRIPE_WRITE_FLUSHED)
+		{
+			return stripeMetadata;
+		}
+
+		if (!SnapshotMightSeeUnflushedStripes(readState->snapshot))
+		{
+			ereport(ERROR, (errmsg(UNEXPECTED_STRIPE_READ_ERR_MSG,
+								   RelationGetRelationName(readState->relation),
+								   stripeMetadata->id)));
+		}
+
+		/* skip the un-flushed stripe that we claimed and claim another one */
+	}
+}
+
+
+/*
+ * SnapshotMightSeeUnflushedStripes returns true if given snapshot is
+ * expected to see un-flushed stripes either because of other backends'
+ * pending writes or aborted transactions.
+ */
+static bool
+SnapshotMightSeeUnflushedStripes(Snapshot snapshot)
+{
+	if (snapshot == InvalidSnapshot)
+	{
+		return false;
+	}
+
+	switch (snapshot->snapshot_type)
+	{
+		case SNAPSHOT_ANY:
+		case SNAPSHOT_DIRTY:
+		case SNAPSHOT_NON_VACUUMABLE:
 		{
 			return true;
 		}
@@ -785,7 +1456,15 @@ ReadStripeNextRow(StripeReadState *stripeReadState, Datum *columnValues,
 	{
 		if (stripeReadState->chunkGroupReadState == NULL)
 		{
+			if (stripeReadState->chunkGroupRowOffset >= stripeReadState->rowCount)
+			{
+				/* vectorized quals refuted the remaining rows of the stripe */
+				stripeReadState->currentRow = stripeReadState->rowCount;
+				return false;
+			}
+
 			stripeReadState->chunkGroupReadState = BeginChunkGroupRead(
+				stripeReadState->relation,
 				stripeReadState->stripeBuffers,
 				stripeReadState->
 				chunkGroupIndex,
@@ -794,6 +1473,10 @@ ReadStripeNextRow(StripeReadState *stripeReadState, Datum *columnValues,
 				stripeReadState->
 				projectedColumnList,
 				stripeReadState->
+				vectorQualList,
+				stripeReadState->
+				vectorQualContext,
+				stripeReadState->
 				stripeReadContext);
 		}
 
@@ -801,13 +1484,28 @@ ReadStripeNextRow(StripeReadState *stripeReadState, Datum *columnValues,
 								   columnNulls))
 		{
 			/* if this chunk group is exhausted, fetch the next one and loop */
+			stripeReadState->chunkGroupRowOffset +=
+				stripeReadState->chunkGroupReadState->rowCount;
 			EndChunkGroupRead(stripeReadState->chunkGroupReadState);
 			stripeReadState->chunkGroupReadState = NULL;
 			stripeReadState->chunkGroupIndex++;
 			continue;
 		}
 
-		stripeReadState->currentRow++;
+		/*
+		 * ReadChunkGroupNextRow might skip the rows refuted by vectorized
+		 * quals, so compute the position of the row within the stripe.
+		 */
+		ChunkGroupReadState *chunkGroupReadState = stripeReadState->chunkGroupReadState;
+		StripeBuffers *stripeBuffers = stripeReadState->stripeBuffers;
+		uint32 chunkGroupIndex =
+			stripeBuffers->selectedChunkGroupIndexes[stripeReadState->chunkGroupIndex];
+
+		stripeReadState->currentRow = stripeReadState->chunkGroupRowOffset +
+									  chunkGroupReadState->currentRow;
+		stripeReadState->currentRowOffset =
+			(int64) chunkGroupIndex * stripeBuffers->chunkGroupRowCount +
+			chunkGroupReadState->currentRow - 1;
 		return true;
 	}
 
@@ -818,10 +1516,17 @@ ReadStripeNextRow(StripeReadState *stripeReadState, Datum *columnValues,
 
 /*
  * BeginChunkGroupRead allocates state for reading a chunk.
+ *
+ * If there are vectorized quals to evaluate, we first deserialize only the
+ * columns that they reference. The remaining projected columns are then
+ * read and deserialized only if any rows of the chunk group satisfy the
+ * quals.
  */
 static ChunkGroupReadState *
-BeginChunkGroupRead(StripeBuffers *stripeBuffers, int chunkIndex, TupleDesc tupleDesc,
-					List *projectedColumnList, MemoryContext cxt)
+BeginChunkGroupRead(Relation relation, StripeBuffers *stripeBuffers, int chunkIndex,
+					TupleDesc tupleDesc, List *projectedColumnList,
+					List *vectorQualList, MemoryContext vectorQualContext,
+					MemoryContext cxt)
 {
 	uint32 chunkGroupRowCount =
 		stripeBuffers->selectedChunkGroupRowCounts[chunkIndex];
@@ -835,10 +1540,73 @@ BeginChunkGroupRead(StripeBuffers *stripeBuffers, int chunkIndex, TupleDesc tupl
 	chunkGroupReadState->columnCount = tupleDesc->natts;
 	chunkGroupReadState->projectedColumnList = projectedColumnList;
 
-	chunkGroupReadState->chunkGroupData = DeserializeChunkData(stripeBuffers, chunkIndex,
-															   chunkGroupRowCount,
-															   tupleDesc,
-															   projectedColumnList);
+	uint32 columnCount = tupleDesc->natts;
+	bool *projectedColumnMask = ProjectedColumnMask(columnCount, projectedColumnList);
+	ChunkData *chunkGroupData = CreateEmptyChunkData(columnCount, projectedColumnMask,
+													 chunkGroupRowCount);
+
+	/* deleted rows are skipped the same way as the rows refuted by quals */
+	bool *liveRowMask = ChunkGroupLiveRowMask(stripeBuffers, chunkIndex,
+											  chunkGroupRowCount);
+	chunkGroupReadState->selectedRowMask = liveRowMask;
+
+	if (vectorQualList == NIL)
+	{
+		DeserializeChunkData(relation, stripeBuffers, chunkIndex, chunkGroupRowCount,
+							 tupleDesc, projectedColumnMask, chunkGroupData);
+	}
+	else
+	{
+		bool *qualColumnMask = VectorQualColumnMask(columnCount, vectorQualList);
+		DeserializeChunkData(relation, stripeBuffers, chunkIndex, chunkGroupRowCount,
+							 tupleDesc, qualColumnMask, chunkGroupData);
+
+		bool *selectedRowMask = EvaluateVectorQuals(chunkGroupData, vectorQualList,
+													vectorQualContext);
+		if (liveRowMask != NULL)
+		{
+			for (uint32 rowIndex = 0; rowIndex < chunkGroupRowCount; rowIndex++)
+			{
+				selectedRowMask[rowIndex] &= liveRowMask[rowIndex];
+			}
+
+			pfree(liveRowMask);
+		}
+
+		chunkGroupReadState->selectedRowMask = selectedRowMask;
+
+		bool hasSelectedRow = false;
+		for (uint32 rowIndex = 0; rowIndex < chunkGroupRowCount; rowIndex++)
+		{
+			if (selectedRowMask[rowIndex])
+			{
+				hasSelectedRow = true;
+				break;
+			}
+		}
+
+		if (hasSelectedRow)
+		{
+			for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+			{
+				projectedColumnMask[columnIndex] &= !qualColumnMask[columnIndex];
+			}
+
+			DeserializeChunkData(relation, stripeBuffers, chunkIndex,
+								 chunkGroupRowCount, tupleDesc, projectedColumnMask,
+								 chunkGroupData);
+		}
+
+		/*
+		 * Otherwise, ReadChunkGroupNextRow skips all the rows of the chunk
+		 * group without looking at the remaining columns.
+		 */
+		pfree(qualColumnMask);
+	}
+
+	chunkGroupReadState->chunkGroupData = chunkGroupData;
+	pfree(projectedColumnMask);
+
 	MemoryContextSwitchTo(oldContext);
 
 	return chunkGroupReadState;
@@ -852,6 +1620,10 @@ static void
 EndChunkGroupRead(ChunkGroupReadState *chunkGroupReadState)
 {
 	FreeChunkData(chunkGroupReadState->chunkGroupData);
+	if (chunkGroupReadState->selectedRowMask != NULL)
+	{
+		pfree(chunkGroupReadState->selectedRowMask);
+	}
 	pfree(chunkGroupReadState);
 }
 
@@ -863,11 +1635,24 @@ EndChunkGroupRead(ChunkGroupReadState *chunkGroupReadState)
  *
  * On entry, all entries in columnNulls should be true; this function only
  * sets non-NULL entries.
+ *
+ * Rows that are refuted by the vectorized quals of the chunk group are
+ * skipped.
  */
 static bool
 ReadChunkGroupNextRow(ChunkGroupReadState *chunkGroupReadState, Datum *columnValues,
 					  bool *columnNulls)
 {
+	bool *selectedRowMask = chunkGroupReadState->selectedRowMask;
+	if (selectedRowMask != NULL)
+	{
+		while (chunkGroupReadState->currentRow < chunkGroupReadState->rowCount &&
+			   !selectedRowMask[chunkGroupReadState->currentRow])
+		{
+			chunkGroupReadState->currentRow++;
+		}
+	}
+
 	if (chunkGroupReadState->currentRow >= chunkGroupReadState->rowCount)
 	{
 		Assert(chunkGroupReadState->currentRow == chunkGroupReadState->rowCount);
@@ -912,6 +1697,33 @@ ColumnarReadChunkGroupsFiltered(ColumnarReadState *state)
 }
 
 
+/*
+ * ColumnarReadScanStats returns the counters of this read operation.
+ */
+ColumnarScanStats *
+ColumnarReadScanStats(ColumnarReadState *state)
+{
+	return &state->scanStats;
+}
+
+
+/*
+ * ColumnarReadSetChunkGroupCallback sets the callback that decides whether
+ * the chunk groups that are not refuted by the quals should be read. This
+ * must be called before reading the first row.
+ */
+void
+ColumnarReadSetChunkGroupCallback(ColumnarReadState *readState,
+								  ColumnarChunkGroupCallback callback,
+								  void *callbackState)
+{
+	Assert(!StripeReadInProgress(readState));
+
+	readState->chunkGroupCallback = callback;
+	readState->chunkGroupCallbackState = callbackState;
+}
+
+
 /*
  * CreateEmptyChunkDataArray creates data buffers to keep deserialized exist and
  * value arrays for requested columns in columnMask.
@@ -925,6 +1737,7 @@ CreateEmptyChunkData(uint32 columnCount, bool *columnMask, uint32 chunkGroupRowC
 	chunkData->existsArray = palloc0(columnCount * sizeof(bool *));
 	chunkData->valueArray = palloc0(columnCount * sizeof(Datum *));
 	chunkData->valueBufferArray = palloc0(columnCount * sizeof(StringInfo));
+	chunkData->dictionaryArray = palloc0(columnCount * sizeof(ChunkDictionary *));
 	chunkData->columnCount = columnCount;
 	chunkData->rowCount = chunkGroupRowCount;
 
@@ -972,10 +1785,19 @@ FreeChunkData(ChunkData *chunkData)
 		{
 			pfree(chunkData->valueArray[columnIndex]);
 		}
+
+		ChunkDictionary *dictionary = chunkData->dictionaryArray[columnIndex];
+		if (dictionary != NULL)
+		{
+			pfree(dictionary->entryArray);
+			pfree(dictionary->codeArray);
+			pfree(dictionary);
+		}
 	}
 
 	pfree(chunkData->existsArray);
 	pfree(chunkData->valueArray);
+	pfree(chunkData->dictionaryArray);
 	pfree(chunkData);
 }
 
@@ -995,7 +1817,10 @@ ColumnarTableRowCount(Relation relation)
 		totalRowCount += stripeMetadata->rowCount;
 	}
 
-	return totalRowCount;
+	uint64 deletedRowCount =
+		ColumnarDeletedRowCount(RelationPhysicalIdentifier_compat(relation));
+
+	return totalRowCount - Min(totalRowCount, deletedRowCount);
 }
 
 
@@ -1003,32 +1828,109 @@ ColumnarTableRowCount(Relation relation)
  * LoadFilteredStripeBuffers reads serialized stripe data from the given file.
  * The function skips over chunks whose rows are refuted by restriction qualifiers,
  * and only loads columns that are projected in the query.
+ *
+ * If stripeSkipList is NULL, the skip list of the stripe is read from the
+ * metadata tables.
+ *
+ * For the columns marked in deferredColumnMask (which might be NULL), only
+ * the "exists" chunks are read here and reading the "values" chunks is left
+ * to DeserializeChunkData.
  */
 static StripeBuffers *
 LoadFilteredStripeBuffers(Relation relation, StripeMetadata *stripeMetadata,
 						  TupleDesc tupleDescriptor, List *projectedColumnList,
 						  List *whereClauseList, List *whereClauseVars,
-						  int64 *chunkGroupsFiltered, Snapshot snapshot)
+						  StripeSkipList *stripeSkipList, bool *deferredColumnMask,
+						  ColumnarChunkGroupCallback chunkGroupCallback,
+						  void *chunkGroupCallbackState,
+						  int64 *chunkGroupsFiltered, ColumnarScanStats *scanStats,
+						  Snapshot snapshot)
 {
 	uint32 columnIndex = 0;
 	uint32 columnCount = tupleDescriptor->natts;
 
 	bool *projectedColumnMask = ProjectedColumnMask(columnCount, projectedColumnList);
 
-	StripeSkipList *stripeSkipList = ReadStripeSkipList(RelationPhysicalIdentifier_compat(
-															relation),
-														stripeMetadata->id,
-														tupleDescriptor,
-														stripeMetadata->chunkCount,
-														snapshot);
+	if (stripeSkipList == NULL)
+	{
+		stripeSkipList = ReadStripeSkipList(RelationPhysicalIdentifier_compat(relation),
+											stripeMetadata->id, tupleDescriptor,
+											stripeMetadata->chunkCount, snapshot);
+	}
 
 	bool *selectedChunkMask = SelectedChunkMask(stripeSkipList, whereClauseList,
 												whereClauseVars, chunkGroupsFiltered);
 
+	uint8 *deletedRowMask = ColumnarReadStripeRowMask(relation, stripeMetadata,
+													  snapshot);
+
+	for (uint32 chunkIndex = 0; chunkIndex < stripeSkipList->chunkCount; chunkIndex++)
+	{
+		if (!selectedChunkMask[chunkIndex])
+		{
+			continue;
+		}
+
+		uint32 deletedRowCount = 0;
+		if (deletedRowMask != NULL)
+		{
+			uint32 chunkGroupRowCount = stripeSkipList->chunkGroupRowCounts[chunkIndex];
+			uint64 firstRowOffset =
+				(uint64) chunkIndex * stripeMetadata->chunkGroupRowCount;
+
+			deletedRowCount = ChunkGroupDeletedRowCount(deletedRowMask, firstRowOffset,
+														chunkGroupRowCount);
+			if (deletedRowCount == chunkGroupRowCount)
+			{
+				/* all rows of the chunk group are deleted */
+				selectedChunkMask[chunkIndex] = false;
+				continue;
+			}
+		}
+
+		if (chunkGroupCallback != NULL)
+		{
+			/* statistics of the chunk group include the deleted rows too */
+			bool allRowsMatch = deletedRowCount == 0 &&
+								ChunkGroupMatchesAllRows(stripeSkipList, chunkIndex,
+														 tupleDescriptor,
+														 whereClauseList,
+														 whereClauseVars);
+			selectedChunkMask[chunkIndex] = chunkGroupCallback(stripeSkipList,
+															   chunkIndex,
+															   allRowsMatch,
+															   chunkGroupCallbackState);
+		}
+	}
+
 	StripeSkipList *selectedChunkSkipList =
 		SelectedChunkSkipList(stripeSkipList, projectedColumnMask,
 							  selectedChunkMask);
 
+	/* the original indexes of the selected chunk groups, to look up the cache */
+	uint32 *selectedChunkGroupIndexes =
+		palloc0(Max(selectedChunkSkipList->chunkCount, 1) * sizeof(uint32));
+	uint32 selectedChunkCount = 0;
+	for (uint32 chunkIndex = 0; chunkIndex < stripeSkipList->chunkCount; chunkIndex++)
+	{
+		if (selectedChunkMask[chunkIndex])
+		{
+			selectedChunkGroupIndexes[selectedChunkCount++] = chunkIndex;
+		}
+	}
+
+	if (selectedChunkCount > 0)
+	{
+		scanStats->stripesRead++;
+	}
+	else
+	{
+		scanStats->stripesSkipped++;
+	}
+
+	scanStats->chunkGroupsRead += selectedChunkCount;
+	scanStats->chunkGroupsSkipped += stripeSkipList->chunkCount - selectedChunkCount;
+
 	/* load column data for projected columns */
 	ColumnBuffers **columnBuffersArray = palloc0(columnCount * sizeof(ColumnBuffers *));
 
@@ -1040,11 +1942,15 @@ LoadFilteredStripeBuffers(Relation relation, StripeMetadata *stripeMetadata,
 				selectedChunkSkipList->chunkSkipNodeArray[columnIndex];
 			Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
 			uint32 chunkCount = selectedChunkSkipList->chunkCount;
+			bool deferValueRead = deferredColumnMask != NULL &&
+								  deferredColumnMask[columnIndex];
 
 			ColumnBuffers *columnBuffers = LoadColumnBuffers(relation, chunkSkipNode,
 															 chunkCount,
 															 stripeMetadata->fileOffset,
-															 attributeForm);
+															 attributeForm,
+															 deferValueRead,
+															 scanStats);
 
 			columnBuffersArray[columnIndex] = columnBuffers;
 		}
@@ -1054,22 +1960,123 @@ LoadFilteredStripeBuffers(Relation relation, StripeMetadata *stripeMetadata,
 	stripeBuffers->columnCount = columnCount;
 	stripeBuffers->rowCount = StripeSkipListRowCount(selectedChunkSkipList);
 	stripeBuffers->columnBuffersArray = columnBuffersArray;
+	stripeBuffers->selectedChunkGroupCount = selectedChunkCount;
 	stripeBuffers->selectedChunkGroupRowCounts =
 		selectedChunkSkipList->chunkGroupRowCounts;
+	stripeBuffers->selectedChunkGroupIndexes = selectedChunkGroupIndexes;
+	stripeBuffers->stripeId = stripeMetadata->id;
+	stripeBuffers->storageId = ColumnarChunkCacheEnabled() ?
+							   ColumnarStorageGetStorageId(relation, false) : 0;
+	stripeBuffers->chunkGroupRowCount = stripeMetadata->chunkGroupRowCount;
+	stripeBuffers->deletedRowMask = deletedRowMask;
+	stripeBuffers->scanStats = scanStats;
 
 	return stripeBuffers;
 }
 
 
+/*
+ * ColumnarReadStripeRowMask returns the bitmap of the rows of given stripe
+ * that are deleted according to given snapshot, including the rows deleted
+ * by current transaction, or NULL if none of its rows are deleted.
+ */
+uint8 *
+ColumnarReadStripeRowMask(Relation relation, StripeMetadata *stripeMetadata,
+						  Snapshot snapshot)
+{
+	if (snapshot != InvalidSnapshot && snapshot->snapshot_type == SNAPSHOT_ANY)
+	{
+		/* similar to heap, SnapshotAny sees the deleted rows too */
+		return NULL;
+	}
+
+	uint64 storageId = ColumnarStorageGetStorageId(relation, false);
+	uint8 *deletedRowMask = ReadStripeRowMask(storageId, stripeMetadata->id,
+											  stripeMetadata->rowCount, snapshot);
+
+	RelFileNumber relfilenumber = RelationPhysicalIdentifierNumber_compat(
+		RelationPhysicalIdentifier_compat(relation));
+	ApplyPendingRowDeletions(relfilenumber, stripeMetadata, snapshot, &deletedRowMask);
+
+	return deletedRowMask;
+}
+
+
+/*
+ * ChunkGroupDeletedRowCount returns the number of deleted rows among the
+ * rowCount rows that start at firstRowOffset in the stripe.
+ */
+static uint32
+ChunkGroupDeletedRowCount(uint8 *deletedRowMask, uint64 firstRowOffset, uint32 rowCount)
+{
+	uint32 deletedRowCount = 0;
+
+	for (uint64 rowOffset = firstRowOffset; rowOffset < firstRowOffset + rowCount;
+		 rowOffset++)
+	{
+		if (COLUMNAR_ROW_MASK_IS_SET(deletedRowMask, rowOffset))
+		{
+			deletedRowCount++;
+		}
+	}
+
+	return deletedRowCount;
+}
+
+
+/*
+ * ChunkGroupLiveRowMask returns an array that is false for the deleted rows
+ * of the chunkIndex'th selected chunk group of given stripe, or NULL if none
+ * of its rows are deleted.
+ */
+static bool *
+ChunkGroupLiveRowMask(StripeBuffers *stripeBuffers, int chunkIndex,
+					  uint32 chunkGroupRowCount)
+{
+	if (stripeBuffers->deletedRowMask == NULL)
+	{
+		return NULL;
+	}
+
+	uint64 firstRowOffset =
+		(uint64) stripeBuffers->selectedChunkGroupIndexes[chunkIndex] *
+		stripeBuffers->chunkGroupRowCount;
+
+	bool *liveRowMask = NULL;
+	for (uint32 rowIndex = 0; rowIndex < chunkGroupRowCount; rowIndex++)
+	{
+		if (!COLUMNAR_ROW_MASK_IS_SET(stripeBuffers->deletedRowMask,
+									  firstRowOffset + rowIndex))
+		{
+			continue;
+		}
+
+		if (liveRowMask == NULL)
+		{
+			liveRowMask = palloc(chunkGroupRowCount * sizeof(bool));
+			memset(liveRowMask, true, chunkGroupRowCount * sizeof(bool));
+		}
+
+		liveRowMask[rowIndex] = false;
+	}
+
+	return liveRowMask;
+}
+
+
 /*
  * LoadColumnBuffers reads serialized column data from the given file. These
  * column data are laid out as sequential chunks in the file; and chunk positions
  * and lengths are retrieved from the column chunk skip node array.
+ *
+ * If deferValueRead is true, "values" chunks are not read but their
+ * positions are recorded, so that they can be read on demand.
  */
 static ColumnBuffers *
 LoadColumnBuffers(Relation relation, ColumnChunkSkipNode *chunkSkipNodeArray,
 				  uint32 chunkCount, uint64 stripeOffset,
-				  Form_pg_attribute attributeForm)
+				  Form_pg_attribute attributeForm, bool deferValueRead,
+				  ColumnarScanStats *scanStats)
 {
 	uint32 chunkIndex = 0;
 	ColumnChunkBuffers **chunkBuffersArray =
@@ -1095,25 +2102,41 @@ LoadColumnBuffers(Relation relation, ColumnChunkSkipNode *chunkSkipNodeArray,
 		rawExistsBuffer->len = chunkSkipNode->existsLength;
 		ColumnarStorageRead(relation, existsOffset, rawExistsBuffer->data,
 							chunkSkipNode->existsLength);
+		scanStats->bytesRead += chunkSkipNode->existsLength;
 
 		chunkBuffersArray[chunkIndex]->existsBuffer = rawExistsBuffer;
 	}
 
-	/* then read "values" chunks, which are also stored sequentially on disk */
+	/*
+	 * Then read "values" chunks, which are also stored sequentially on disk.
+	 * Compressed chunks might be found in the chunk cache, so if it's enabled
+	 * we defer reading them until we know that they're not cached.
+	 */
+	bool chunkCacheEnabled = ColumnarChunkCacheEnabled();
 	for (chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
 	{
 		ColumnChunkSkipNode *chunkSkipNode = &chunkSkipNodeArray[chunkIndex];
 		CompressionType compressionType = chunkSkipNode->valueCompressionType;
 		uint64 valueOffset = stripeOffset + chunkSkipNode->valueChunkOffset;
-		StringInfo rawValueBuffer = makeStringInfo();
+		StringInfo rawValueBuffer = NULL;
 
-		enlargeStringInfo(rawValueBuffer, chunkSkipNode->valueLength);
-		rawValueBuffer->len = chunkSkipNode->valueLength;
-		ColumnarStorageRead(relation, valueOffset, rawValueBuffer->data,
-							chunkSkipNode->valueLength);
+		if (!deferValueRead &&
+			!(chunkCacheEnabled && compressionType != COMPRESSION_NONE))
+		{
+			rawValueBuffer = makeStringInfo();
+			enlargeStringInfo(rawValueBuffer, chunkSkipNode->valueLength);
+			rawValueBuffer->len = chunkSkipNode->valueLength;
+			ColumnarStorageRead(relation, valueOffset, rawValueBuffer->data,
+								chunkSkipNode->valueLength);
+			scanStats->bytesRead += chunkSkipNode->valueLength;
+		}
 
 		chunkBuffersArray[chunkIndex]->valueBuffer = rawValueBuffer;
+		chunkBuffersArray[chunkIndex]->valueOffset = valueOffset;
+		chunkBuffersArray[chunkIndex]->valueLength = chunkSkipNode->valueLength;
 		chunkBuffersArray[chunkIndex]->valueCompressionType = compressionType;
+		chunkBuffersArray[chunkIndex]->valueEncodingType =
+			chunkSkipNode->valueEncodingType;
 		chunkBuffersArray[chunkIndex]->decompressedValueSize =
 			chunkSkipNode->decompressedValueSize;
 	}
@@ -1184,10 +2207,92 @@ SelectedChunkMask(StripeSkipList *stripeSkipList, List *whereClauseList,
 		}
 	}
 
+	/* check equality quals against the bloom filters of remaining chunks */
+	List *bloomFilterQualList = BuildBloomFilterQualList(whereClauseList);
+	BloomFilterQual *bloomFilterQual = NULL;
+	foreach_ptr(bloomFilterQual, bloomFilterQualList)
+	{
+		if (bloomFilterQual->columnIndex >= stripeSkipList->columnCount)
+		{
+			continue;
+		}
+
+		ColumnChunkSkipNode *chunkSkipNodeArray =
+			stripeSkipList->chunkSkipNodeArray[bloomFilterQual->columnIndex];
+		for (chunkIndex = 0; chunkIndex < stripeSkipList->chunkCount; chunkIndex++)
+		{
+			bytea *bloomFilter = chunkSkipNodeArray[chunkIndex].bloomFilter;
+			if (bloomFilter == NULL || !selectedChunkMask[chunkIndex])
+			{
+				continue;
+			}
+
+			if (BloomFilterQualRefutesChunk(bloomFilterQual, bloomFilter))
+			{
+				selectedChunkMask[chunkIndex] = false;
+				*chunkGroupsFiltered += 1;
+			}
+		}
+	}
+
 	return selectedChunkMask;
 }
 
 
+/*
+ * ChunkGroupMatchesAllRows returns true if the min/max values of the columns
+ * in the given chunk group prove that all of its rows satisfy the quals.
+ *
+ * Since min/max values don't tell anything about the NULL values, we can
+ * only prove that for the quals referencing NOT NULL columns.
+ */
+static bool
+ChunkGroupMatchesAllRows(StripeSkipList *stripeSkipList, uint32 chunkIndex,
+						 TupleDesc tupleDescriptor, List *whereClauseList,
+						 List *whereClauseVars)
+{
+	if (whereClauseList == NIL)
+	{
+		return true;
+	}
+
+	List *constraintList = NIL;
+
+	Var *column = NULL;
+	foreach_ptr(column, whereClauseVars)
+	{
+		uint32 columnIndex = column->varattno - 1;
+		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+		if (!attributeForm->attnotnull || columnIndex >= stripeSkipList->columnCount)
+		{
+			return false;
+		}
+
+		ColumnChunkSkipNode *chunkSkipNode =
+			&stripeSkipList->chunkSkipNodeArray[columnIndex][chunkIndex];
+		if (!chunkSkipNode->hasMinMax)
+		{
+			return false;
+		}
+
+		FmgrInfo *comparisonFunction = GetFunctionInfoOrNull(column->vartype,
+															 BTREE_AM_OID,
+															 BTORDER_PROC);
+		if (comparisonFunction == NULL)
+		{
+			return false;
+		}
+
+		Node *constraint = BuildBaseConstraint(column);
+		UpdateConstraint(constraint, chunkSkipNode->minimumValue,
+						 chunkSkipNode->maximumValue);
+		constraintList = lappend(constraintList, constraint);
+	}
+
+	return predicate_implied_by(whereClauseList, constraintList, false);
+}
+
+
 /*
  * GetFunctionInfoOrNull first resolves the operator for the given data type,
  * access method, and support procedure. The function then uses the resolved
@@ -1502,36 +2607,51 @@ ProjectedColumnMask(uint32 columnCount, List *projectedColumnList)
 
 /*
  * DeserializeBoolArray reads an array of bits from the given buffer and stores
- * it in provided bool array.
+ * it in provided bool array. Returns the number of bits that are set.
+ *
+ * We unpack a byte of the buffer at a time, which avoids a branch per bit and
+ * lets the compiler vectorize the stores.
  */
-static void
+static uint32
 DeserializeBoolArray(StringInfo boolArrayBuffer, bool *boolArray,
 					 uint32 boolArrayLength)
 {
-	uint32 boolArrayIndex = 0;
-
 	uint32 maximumBoolCount = boolArrayBuffer->len * 8;
 	if (boolArrayLength > maximumBoolCount)
 	{
 		ereport(ERROR, (errmsg("insufficient data for reading boolean array")));
 	}
 
-	for (boolArrayIndex = 0; boolArrayIndex < boolArrayLength; boolArrayIndex++)
+	const uint8 *bitmap = (const uint8 *) boolArrayBuffer->data;
+	uint32 fullByteCount = boolArrayLength / 8;
+
+	for (uint32 byteIndex = 0; byteIndex < fullByteCount; byteIndex++)
 	{
-		uint32 byteIndex = boolArrayIndex / 8;
-		uint32 bitIndex = boolArrayIndex % 8;
-		uint8 bitmask = (1 << bitIndex);
+		uint8 bits = bitmap[byteIndex];
+		bool *boolArrayPart = boolArray + byteIndex * 8;
+
+		boolArrayPart[0] = (bits & 0x01) != 0;
+		boolArrayPart[1] = (bits & 0x02) != 0;
+		boolArrayPart[2] = (bits & 0x04) != 0;
+		boolArrayPart[3] = (bits & 0x08) != 0;
+		boolArrayPart[4] = (bits & 0x10) != 0;
+		boolArrayPart[5] = (bits & 0x20) != 0;
+		boolArrayPart[6] = (bits & 0x40) != 0;
+		boolArrayPart[7] = (bits & 0x80) != 0;
+	}
 
-		uint8 shiftedBit = (boolArrayBuffer->data[byteIndex] & bitmask);
-		if (shiftedBit == 0)
-		{
-			boolArray[boolArrayIndex] = false;
-		}
-		else
-		{
-			boolArray[boolArrayIndex] = true;
-		}
+	uint32 trueCount = (uint32) pg_popcount((const char *) bitmap, fullByteCount);
+
+	for (uint32 boolArrayIndex = fullByteCount * 8; boolArrayIndex < boolArrayLength;
+		 boolArrayIndex++)
+	{
+		uint8 bitmask = (1 << (boolArrayIndex % 8));
+
+		boolArray[boolArrayIndex] = (bitmap[fullByteCount] & bitmask) != 0;
+		trueCount += boolArray[boolArrayIndex];
 	}
+
+	return trueCount;
 }
 
 
@@ -1539,12 +2659,26 @@ DeserializeBoolArray(StringInfo boolArrayBuffer, bool *boolArray,
  * DeserializeDatumArray reads an array of datums from the given buffer and stores
  * them in provided datumArray. If a value is marked as false in the exists array,
  * the function assumes that the datum isn't in the buffer, and simply skips it.
+ * existingDatumCount is the number of values that are marked as true.
  */
 static void
 DeserializeDatumArray(StringInfo datumBuffer, bool *existsArray, uint32 datumCount,
-					  bool datumTypeByValue, int datumTypeLength,
-					  char datumTypeAlign, Datum *datumArray)
+					  uint32 existingDatumCount, bool datumTypeByValue,
+					  int datumTypeLength, char datumTypeAlign, Datum *datumArray)
 {
+	/*
+	 * Pass-by-value types whose alignment doesn't exceed their length, such
+	 * as int4, int8, float8 and timestamp, are stored back to back.
+	 */
+	if (datumTypeByValue && datumTypeLength > 0 &&
+		att_align_nominal(datumTypeLength, datumTypeAlign) == datumTypeLength)
+	{
+		DeserializeFixedWidthDatumArray(datumBuffer, existsArray, datumCount,
+										existingDatumCount, datumTypeLength,
+										datumArray);
+		return;
+	}
+
 	uint32 datumIndex = 0;
 	uint32 currentDatumDataOffset = 0;
 
@@ -1574,30 +2708,121 @@ DeserializeDatumArray(StringInfo datumBuffer, bool *existsArray, uint32 datumCou
 
 
 /*
- * DeserializeChunkGroupData deserializes requested data chunk for all columns and
- * stores in chunkDataArray. It uncompresses serialized data if necessary. The
- * function also deallocates data buffers used for previous chunk, and compressed
- * data buffers for the current chunk which will not be needed again. If a column
- * data is not present serialized buffer, then default value (or null) is used
- * to fill value array.
+ * DeserializeFixedWidthDatumArray is the fast path of DeserializeDatumArray
+ * for the pass-by-value types that are stored back to back. Since we know
+ * the size of the values up front, we check the buffer length once and use
+ * a loop specialized for the length of the type, which doesn't branch on
+ * the exists array if the chunk has no nulls.
+ *
+ * Like fetch_att, we rely on the buffer being aligned for the type, which
+ * holds since the values are aligned relative to the start of the buffer.
+ */
+static void
+DeserializeFixedWidthDatumArray(StringInfo datumBuffer, bool *existsArray,
+								uint32 datumCount, uint32 existingDatumCount,
+								int datumTypeLength, Datum *datumArray)
+{
+	if ((uint64) existingDatumCount * datumTypeLength > datumBuffer->len)
+	{
+		ereport(ERROR, (errmsg("insufficient data left in datum buffer")));
+	}
+
+	bool hasNulls = existingDatumCount < datumCount;
+	const char *datumData = datumBuffer->data;
+
+/*
+ * DESERIALIZE_FIXED_WIDTH_LOOP reads the values of type valueType into
+ * datumArray using toDatum.
+ */
+#define DESERIALIZE_FIXED_WIDTH_LOOP(valueType, toDatum) \
+	do { \
+		const valueType *values = (const valueType *) datumData; \
+		if (!hasNulls) \
+		{ \
+			for (uint32 datumIndex = 0; datumIndex < datumCount; datumIndex++) \
+			{ \
+				datumArray[datumIndex] = toDatum(values[datumIndex]); \
+			} \
+		} \
+		else \
+		{ \
+			uint32 valueIndex = 0; \
+			for (uint32 datumIndex = 0; datumIndex < datumCount; datumIndex++) \
+			{ \
+				if (existsArray[datumIndex]) \
+				{ \
+					datumArray[datumIndex] = toDatum(values[valueIndex]); \
+					valueIndex++; \
+				} \
+			} \
+		} \
+	} while (0)
+
+	switch (datumTypeLength)
+	{
+		case sizeof(char):
+		{
+			DESERIALIZE_FIXED_WIDTH_LOOP(char, CharGetDatum);
+			break;
+		}
+
+		case sizeof(int16):
+		{
+			DESERIALIZE_FIXED_WIDTH_LOOP(int16, Int16GetDatum);
+			break;
+		}
+
+		case sizeof(int32):
+		{
+			DESERIALIZE_FIXED_WIDTH_LOOP(int32, Int32GetDatum);
+			break;
+		}
+
+#if SIZEOF_DATUM == 8
+		case sizeof(Datum):
+		{
+			DESERIALIZE_FIXED_WIDTH_LOOP(Datum, (Datum));
+			break;
+		}
+#endif
+
+		default:
+		{
+			elog(ERROR, "unsupported byval length: %d", datumTypeLength);
+		}
+	}
+
+#undef DESERIALIZE_FIXED_WIDTH_LOOP
+}
+
+
+/*
+ * DeserializeChunkData deserializes requested data chunk for the columns in
+ * columnMask and stores in chunkData. It uncompresses serialized data if
+ * necessary, and reads the "values" chunks whose read was deferred. If a
+ * column data is not present serialized buffer, then default value (or null)
+ * is used to fill value array.
  */
-static ChunkData *
-DeserializeChunkData(StripeBuffers *stripeBuffers, uint64 chunkIndex,
-					 uint32 rowCount, TupleDesc tupleDescriptor,
-					 List *projectedColumnList)
+static void
+DeserializeChunkData(Relation relation, StripeBuffers *stripeBuffers,
+					 uint64 chunkIndex, uint32 rowCount, TupleDesc tupleDescriptor,
+					 bool *columnMask, ChunkData *chunkData)
 {
+	ColumnarScanStats *scanStats = stripeBuffers->scanStats;
 	int columnIndex = 0;
-	bool *columnMask = ProjectedColumnMask(tupleDescriptor->natts, projectedColumnList);
-	ChunkData *chunkData = CreateEmptyChunkData(tupleDescriptor->natts, columnMask,
-												rowCount);
 
 	for (columnIndex = 0; columnIndex < stripeBuffers->columnCount; columnIndex++)
 	{
+		if (!columnMask[columnIndex])
+		{
+			continue;
+		}
+
 		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
 		ColumnBuffers *columnBuffers = stripeBuffers->columnBuffersArray[columnIndex];
 		bool columnAdded = false;
 
-		if (columnBuffers == NULL && columnMask[columnIndex])
+		if (columnBuffers == NULL)
 		{
 			columnAdded = true;
 		}
@@ -1606,20 +2831,88 @@ DeserializeChunkData(StripeBuffers *stripeBuffers, uint64 chunkIndex,
 		{
 			ColumnChunkBuffers *chunkBuffers =
 				columnBuffers->chunkBuffersArray[chunkIndex];
+			StringInfo valueBuffer = NULL;
+
+			bool useChunkCache = ColumnarChunkCacheEnabled() &&
+								 chunkBuffers->valueCompressionType != COMPRESSION_NONE;
+			ColumnarChunkCacheKey cacheKey = {
+				.storageId = stripeBuffers->storageId,
+				.stripeId = stripeBuffers->stripeId,
+				.columnIndex = columnIndex,
+				.chunkGroupIndex = stripeBuffers->selectedChunkGroupIndexes[chunkIndex]
+			};
+
+			if (useChunkCache)
+			{
+				valueBuffer = ColumnarChunkCacheLookup(&cacheKey);
+			}
 
-			/* decompress and deserialize current chunk's data */
-			StringInfo valueBuffer =
-				DecompressBuffer(chunkBuffers->valueBuffer,
-								 chunkBuffers->valueCompressionType,
-								 chunkBuffers->decompressedValueSize);
+			if (valueBuffer == NULL)
+			{
+				if (chunkBuffers->valueBuffer == NULL)
+				{
+					StringInfo rawValueBuffer = makeStringInfo();
+					enlargeStringInfo(rawValueBuffer, chunkBuffers->valueLength);
+					rawValueBuffer->len = chunkBuffers->valueLength;
+					ColumnarStorageRead(relation, chunkBuffers->valueOffset,
+										rawValueBuffer->data,
+										chunkBuffers->valueLength);
+					scanStats->bytesRead += chunkBuffers->valueLength;
+
+					chunkBuffers->valueBuffer = rawValueBuffer;
+				}
+
+				bool compressed =
+					chunkBuffers->valueCompressionType != COMPRESSION_NONE;
+				instr_time decompressionStart;
+				if (compressed)
+				{
+					INSTR_TIME_SET_CURRENT(decompressionStart);
+				}
+
+				/* decompress current chunk's data */
+				valueBuffer = DecompressBuffer(chunkBuffers->valueBuffer,
+											   chunkBuffers->valueCompressionType,
+											   chunkBuffers->decompressedValueSize);
 
-			DeserializeBoolArray(chunkBuffers->existsBuffer,
-								 chunkData->existsArray[columnIndex],
-								 rowCount);
-			DeserializeDatumArray(valueBuffer, chunkData->existsArray[columnIndex],
-								  rowCount, attributeForm->attbyval,
-								  attributeForm->attlen, attributeForm->attalign,
-								  chunkData->valueArray[columnIndex]);
+				if (compressed)
+				{
+					instr_time decompressionEnd;
+					INSTR_TIME_SET_CURRENT(decompressionEnd);
+					INSTR_TIME_ACCUM_DIFF(scanStats->decompressionTime,
+										  decompressionEnd, decompressionStart);
+					scanStats->bytesDecompressed += valueBuffer->len;
+				}
+
+				if (useChunkCache)
+				{
+					ColumnarChunkCacheInsert(&cacheKey, valueBuffer);
+				}
+			}
+
+			/* deserialize current chunk's data */
+
+			uint32 existingValueCount =
+				DeserializeBoolArray(chunkBuffers->existsBuffer,
+									 chunkData->existsArray[columnIndex],
+									 rowCount);
+			if (chunkBuffers->valueEncodingType == CHUNK_ENCODING_NONE)
+			{
+				DeserializeDatumArray(valueBuffer, chunkData->existsArray[columnIndex],
+									  rowCount, existingValueCount,
+									  attributeForm->attbyval, attributeForm->attlen,
+									  attributeForm->attalign,
+									  chunkData->valueArray[columnIndex]);
+			}
+			else
+			{
+				chunkData->dictionaryArray[columnIndex] =
+					DecodeChunkValues(valueBuffer, chunkBuffers->valueEncodingType,
+									  chunkData->existsArray[columnIndex], rowCount,
+									  attributeForm->attbyval, attributeForm->attlen,
+									  attributeForm->attalign,
+									  chunkData->valueArray[columnIndex]);
+			}
 
 			/* store current chunk's data buffer to be freed at next chunk read */
 			chunkData->valueBufferArray[columnIndex] = valueBuffer;
@@ -1650,8 +2943,6 @@ DeserializeChunkData(StripeBuffers *stripeBuffers, uint64 chunkIndex,
 			}
 		}
 	}
-
-	return chunkData;
 }
 
 
@@ -1692,3 +2983,574 @@ ColumnDefaultValue(TupleConstr *tupleConstraints, Form_pg_attribute attributeFor
 								"does not evaluate to constant value")));
 	}
 }
+
+
+/*
+ * VectorQualColumnMask returns a mask in which the columns referenced by
+ * given vectorized quals are marked as true.
+ */
+static bool *
+VectorQualColumnMask(uint32 columnCount, List *vectorQualList)
+{
+	bool *qualColumnMask = palloc0(columnCount * sizeof(bool));
+
+	ColumnarVectorQual *vectorQual = NULL;
+	foreach_ptr(vectorQual, vectorQualList)
+	{
+		qualColumnMask[vectorQual->columnIndex] = true;
+	}
+
+	return qualColumnMask;
+}
+
+
+/*
+ * DeferredColumnMask returns a mask in which the projected columns that are
+ * not referenced by given vectorized quals are marked as true, or NULL if
+ * there are no vectorized quals. Reading such columns can be deferred until
+ * the quals are evaluated for a chunk group.
+ */
+static bool *
+DeferredColumnMask(uint32 columnCount, List *projectedColumnList, List *vectorQualList)
+{
+	if (vectorQualList == NIL)
+	{
+		return NULL;
+	}
+
+	bool *deferredColumnMask = ProjectedColumnMask(columnCount, projectedColumnList);
+	bool *qualColumnMask = VectorQualColumnMask(columnCount, vectorQualList);
+
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		deferredColumnMask[columnIndex] &= !qualColumnMask[columnIndex];
+	}
+
+	pfree(qualColumnMask);
+
+	return deferredColumnMask;
+}
+
+
+/*
+ * BuildVectorQualList returns a list of ColumnarVectorQual's for the clauses
+ * in whereClauseList that can be evaluated over the column vectors of a
+ * chunk group, if columnar.enable_vectorized_filter is set.
+ *
+ * Note that the clauses that we push down to the reader are still evaluated
+ * by the executor for the rows that we return, so skipping the rows refuted
+ * by a subset of them is always safe.
+ */
+static List *
+BuildVectorQualList(List *whereClauseList, TupleDesc tupleDescriptor,
+					List *projectedColumnList)
+{
+	if (!columnar_enable_vectorized_filter)
+	{
+		return NIL;
+	}
+
+	bool *projectedColumnMask = ProjectedColumnMask(tupleDescriptor->natts,
+													projectedColumnList);
+
+	List *vectorQualList = NIL;
+	Node *clause = NULL;
+	foreach_ptr(clause, whereClauseList)
+	{
+		ColumnarVectorQual *vectorQual = BuildVectorQual(clause, tupleDescriptor,
+														 projectedColumnMask);
+		if (vectorQual != NULL)
+		{
+			vectorQualList = lappend(vectorQualList, vectorQual);
+		}
+	}
+
+	pfree(projectedColumnMask);
+
+	return vectorQualList;
+}
+
+
+/*
+ * BuildVectorQual returns a ColumnarVectorQual for given clause if it is in
+ * the form of "Var op Const" (or "Const op Var"), where Var references to a
+ * projected column, Const is not NULL, and the operator is strict. Otherwise,
+ * returns NULL.
+ */
+static ColumnarVectorQual *
+BuildVectorQual(Node *clause, TupleDesc tupleDescriptor, bool *projectedColumnMask)
+{
+	if (!IsA(clause, OpExpr))
+	{
+		return NULL;
+	}
+
+	OpExpr *opExpr = (OpExpr *) clause;
+	if (list_length(opExpr->args) != 2 || opExpr->opresulttype != BOOLOID)
+	{
+		return NULL;
+	}
+
+	Node *leftOperand = linitial(opExpr->args);
+	Node *rightOperand = lsecond(opExpr->args);
+
+	Var *var = NULL;
+	Const *constant = NULL;
+	bool varOnLeft = false;
+	if (IsA(leftOperand, Var) && IsA(rightOperand, Const))
+	{
+		var = (Var *) leftOperand;
+		constant = (Const *) rightOperand;
+		varOnLeft = true;
+	}
+	else if (IsA(leftOperand, Const) && IsA(rightOperand, Var))
+	{
+		var = (Var *) rightOperand;
+		constant = (Const *) leftOperand;
+		varOnLeft = false;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	if (var->varlevelsup != 0 || var->varattno <= 0 ||
+		var->varattno > tupleDescriptor->natts)
+	{
+		return NULL;
+	}
+
+	int columnIndex = var->varattno - 1;
+	Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+	if (!projectedColumnMask[columnIndex] || attributeForm->attisdropped ||
+		attributeForm->atttypid != var->vartype)
+	{
+		return NULL;
+	}
+
+	/* a strict operator would return NULL for NULL values, refuting the row */
+	if (constant->constisnull || !func_strict(opExpr->opfuncid))
+	{
+		return NULL;
+	}
+
+	ColumnarVectorQual *vectorQual = palloc0(sizeof(ColumnarVectorQual));
+	vectorQual->columnIndex = columnIndex;
+	vectorQual->varOnLeft = varOnLeft;
+	vectorQual->constValue = constant->constvalue;
+	vectorQual->inputCollation = opExpr->inputcollid;
+	fmgr_info(opExpr->opfuncid, &vectorQual->operatorFunction);
+
+	return vectorQual;
+}
+
+
+/*
+ * EvaluateVectorQuals evaluates given vectorized quals over the column
+ * vectors of given chunk group and returns a mask in which the rows that
+ * satisfy all the quals are marked as true. Returns NULL if there are no
+ * quals to evaluate.
+ *
+ * The operators are evaluated in vectorQualContext, which is reset after
+ * processing the chunk group, so that by-reference comparisons don't leak
+ * memory for each row.
+ */
+static bool *
+EvaluateVectorQuals(ChunkData *chunkData, List *vectorQualList,
+					MemoryContext vectorQualContext)
+{
+	if (vectorQualList == NIL)
+	{
+		return NULL;
+	}
+
+	uint32 rowCount = chunkData->rowCount;
+	bool *selectedRowMask = palloc(rowCount * sizeof(bool));
+	memset(selectedRowMask, true, rowCount * sizeof(bool));
+
+	MemoryContext oldContext = MemoryContextSwitchTo(vectorQualContext);
+
+	ColumnarVectorQual *vectorQual = NULL;
+	foreach_ptr(vectorQual, vectorQualList)
+	{
+		bool *existsArray = chunkData->existsArray[vectorQual->columnIndex];
+		Datum *valueArray = chunkData->valueArray[vectorQual->columnIndex];
+		ChunkDictionary *dictionary = chunkData->dictionaryArray[vectorQual->columnIndex];
+
+		int varArgIndex = vectorQual->varOnLeft ? 0 : 1;
+		int constArgIndex = vectorQual->varOnLeft ? 1 : 0;
+
+		LOCAL_FCINFO(fcinfo, 2);
+		InitFunctionCallInfoData(*fcinfo, &vectorQual->operatorFunction, 2,
+								 vectorQual->inputCollation, NULL, NULL);
+		fcinfo->args[constArgIndex].value = vectorQual->constValue;
+		fcinfo->args[constArgIndex].isnull = false;
+		fcinfo->args[varArgIndex].isnull = false;
+
+		if (dictionary != NULL)
+		{
+			/*
+			 * The column is dictionary encoded in this chunk, so evaluate the
+			 * qual once for each dictionary entry and then check the codes.
+			 */
+			bool entryMatches[CHUNK_DICTIONARY_MAX_ENTRIES];
+			for (uint32 entryIndex = 0; entryIndex < dictionary->entryCount; entryIndex++)
+			{
+				fcinfo->args[varArgIndex].value = dictionary->entryArray[entryIndex];
+				fcinfo->isnull = false;
+
+				Datum result = FunctionCallInvoke(fcinfo);
+				entryMatches[entryIndex] = !fcinfo->isnull && DatumGetBool(result);
+			}
+
+			for (uint32 rowIndex = 0; rowIndex < rowCount; rowIndex++)
+			{
+				if (selectedRowMask[rowIndex] &&
+					(!existsArray[rowIndex] ||
+					 !entryMatches[dictionary->codeArray[rowIndex]]))
+				{
+					selectedRowMask[rowIndex] = false;
+				}
+			}
+
+			continue;
+		}
+
+		for (uint32 rowIndex = 0; rowIndex < rowCount; rowIndex++)
+		{
+			if (!selectedRowMask[rowIndex])
+			{
+				continue;
+			}
+
+			if (!existsArray[rowIndex])
+			{
+				/* strict operator returns NULL for a NULL input */
+				selectedRowMask[rowIndex] = false;
+				continue;
+			}
+
+			fcinfo->args[varArgIndex].value = valueArray[rowIndex];
+			fcinfo->isnull = false;
+
+			Datum result = FunctionCallInvoke(fcinfo);
+			if (fcinfo->isnull || !DatumGetBool(result))
+			{
+				selectedRowMask[rowIndex] = false;
+			}
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	MemoryContextReset(vectorQualContext);
+
+	return selectedRowMask;
+}
+
+
+/*
+ * PrefetchNextStripe issues prefetch requests for the chunks of the
+ * projected columns of the stripe that we will read after the current one,
+ * skipping the chunk groups refuted by the pushed down quals.
+ *
+ * We don't prefetch for parallel scans since the next stripe that this
+ * participant would read isn't known until it claims one. Similarly, we
+ * don't prefetch if a chunk group callback is set, since we don't know which
+ * chunk groups it would skip.
+ */
+static void
+PrefetchNextStripe(ColumnarReadState *readState)
+{
+	Relation relation = readState->relation;
+	if (readState->parallelScan != NULL || readState->chunkGroupCallback != NULL ||
+		get_tablespace_io_concurrency(relation->rd_rel->reltablespace) == 0)
+	{
+		return;
+	}
+
+	StripeMetadata *currentStripeMetadata = readState->currentStripeMetadata;
+	uint64 nextRowNumber = StripeGetHighestRowNumber(currentStripeMetadata) + 1;
+
+	/* we don't need the skip list of the previous stripe anymore */
+	MemoryContextReset(readState->prefetchContext);
+	readState->prefetchedSkipList = NULL;
+
+	MemoryContext oldContext = MemoryContextSwitchTo(readState->prefetchContext);
+
+	StripeMetadata *nextStripeMetadata = FindNextStripeByRowNumber(relation,
+																   nextRowNumber,
+																   readState->snapshot);
+	if (nextStripeMetadata == NULL ||
+		StripeWriteState(nextStripeMetadata) != STRIPE_WRITE_FLUSHED)
+	{
+		MemoryContextSwitchTo(oldContext);
+		return;
+	}
+
+	TupleDesc tupleDescriptor = readState->tupleDescriptor;
+	StripeSkipList *stripeSkipList =
+		ReadStripeSkipList(RelationPhysicalIdentifier_compat(relation),
+						   nextStripeMetadata->id, tupleDescriptor,
+						   nextStripeMetadata->chunkCount, readState->snapshot);
+
+	/* don't count filtered chunk groups twice */
+	int64 chunkGroupsFiltered = 0;
+	bool *selectedChunkMask = SelectedChunkMask(stripeSkipList,
+												readState->whereClauseList,
+												readState->whereClauseVars,
+												&chunkGroupsFiltered);
+	bool *projectedColumnMask = ProjectedColumnMask(tupleDescriptor->natts,
+													readState->projectedColumnList);
+
+	uint64 stripeOffset = nextStripeMetadata->fileOffset;
+	for (uint32 columnIndex = 0; columnIndex < nextStripeMetadata->columnCount;
+		 columnIndex++)
+	{
+		if (!projectedColumnMask[columnIndex])
+		{
+			continue;
+		}
+
+		ColumnChunkSkipNode *chunkSkipNodeArray =
+			stripeSkipList->chunkSkipNodeArray[columnIndex];
+		for (uint32 chunkIndex = 0; chunkIndex < stripeSkipList->chunkCount;
+			 chunkIndex++)
+		{
+			if (!selectedChunkMask[chunkIndex])
+			{
+				continue;
+			}
+
+			ColumnChunkSkipNode *chunkSkipNode = &chunkSkipNodeArray[chunkIndex];
+			ColumnarStoragePrefetch(relation,
+									stripeOffset + chunkSkipNode->existsChunkOffset,
+									chunkSkipNode->existsLength);
+			ColumnarStoragePrefetch(relation,
+									stripeOffset + chunkSkipNode->valueChunkOffset,
+									chunkSkipNode->valueLength);
+		}
+	}
+
+	readState->prefetchedStripeId = nextStripeMetadata->id;
+	readState->prefetchedSkipList = stripeSkipList;
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * TakePrefetchedSkipList returns the skip list that PrefetchNextStripe read
+ * for given stripe, or NULL if we didn't prefetch that stripe.
+ *
+ * The skip list stays valid until the next call to PrefetchNextStripe,
+ * which happens only after we are done with loading the stripe.
+ */
+static StripeSkipList *
+TakePrefetchedSkipList(ColumnarReadState *readState, uint64 stripeId)
+{
+	StripeSkipList *stripeSkipList = NULL;
+	if (readState->prefetchedSkipList != NULL &&
+		readState->prefetchedStripeId == stripeId)
+	{
+		stripeSkipList = readState->prefetchedSkipList;
+	}
+
+	readState->prefetchedSkipList = NULL;
+
+	return stripeSkipList;
+}
+
+
+/*
+ * BuildBloomFilterQualList returns a list of BloomFilterQual's for the
+ * clauses in whereClauseList that can be checked against chunk bloom
+ * filters.
+ */
+static List *
+BuildBloomFilterQualList(List *whereClauseList)
+{
+	List *bloomFilterQualList = NIL;
+
+	Node *clause = NULL;
+	foreach_ptr(clause, whereClauseList)
+	{
+		BloomFilterQual *bloomFilterQual = BuildBloomFilterQual(clause);
+		if (bloomFilterQual != NULL)
+		{
+			bloomFilterQualList = lappend(bloomFilterQualList, bloomFilterQual);
+		}
+	}
+
+	return bloomFilterQualList;
+}
+
+
+/*
+ * BuildBloomFilterQual returns a BloomFilterQual for given clause if it is
+ * in the form of "Var = Const" (or "Const = Var"), or "Var = ANY(Const)",
+ * where the operator is the equality operator of the hash operator family
+ * that the writer used to build bloom filters for the column. Otherwise,
+ * returns NULL.
+ *
+ * Hash operator families guarantee that the cross-type members of the
+ * family compute compatible hashes, so we hash the constants using the hash
+ * function for their own types.
+ */
+static BloomFilterQual *
+BuildBloomFilterQual(Node *clause)
+{
+	Oid operatorId = InvalidOid;
+	Oid inputCollation = InvalidOid;
+	Var *var = NULL;
+	Const *constant = NULL;
+	bool constantIsArray = false;
+
+	if (IsA(clause, OpExpr) && list_length(((OpExpr *) clause)->args) == 2)
+	{
+		OpExpr *opExpr = (OpExpr *) clause;
+		Node *leftOperand = linitial(opExpr->args);
+		Node *rightOperand = lsecond(opExpr->args);
+
+		if (IsA(leftOperand, Var) && IsA(rightOperand, Const))
+		{
+			var = (Var *) leftOperand;
+			constant = (Const *) rightOperand;
+		}
+		else if (IsA(leftOperand, Const) && IsA(rightOperand, Var))
+		{
+			var = (Var *) rightOperand;
+			constant = (Const *) leftOperand;
+		}
+		else
+		{
+			return NULL;
+		}
+
+		operatorId = opExpr->opno;
+		inputCollation = opExpr->inputcollid;
+	}
+	else if (IsA(clause, ScalarArrayOpExpr))
+	{
+		ScalarArrayOpExpr *arrayOpExpr = (ScalarArrayOpExpr *) clause;
+		if (!arrayOpExpr->useOr || list_length(arrayOpExpr->args) != 2 ||
+			!IsA(linitial(arrayOpExpr->args), Var) ||
+			!IsA(lsecond(arrayOpExpr->args), Const))
+		{
+			return NULL;
+		}
+
+		var = (Var *) linitial(arrayOpExpr->args);
+		constant = (Const *) lsecond(arrayOpExpr->args);
+		constantIsArray = true;
+
+		operatorId = arrayOpExpr->opno;
+		inputCollation = arrayOpExpr->inputcollid;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	if (var->varlevelsup != 0 || var->varattno <= 0 || constant->constisnull)
+	{
+		return NULL;
+	}
+
+	/* the writer hashes the values using the collation of the column */
+	if (inputCollation != var->varcollid)
+	{
+		return NULL;
+	}
+
+	Oid operatorClassId = GetDefaultOpClass(var->vartype, HASH_AM_OID);
+	if (operatorClassId == InvalidOid)
+	{
+		return NULL;
+	}
+
+	Oid operatorFamilyId = get_opclass_family(operatorClassId);
+	if (get_op_opfamily_strategy(operatorId, operatorFamilyId) != HTEqualStrategyNumber)
+	{
+		return NULL;
+	}
+
+	Oid constantTypeId = constant->consttype;
+	if (constantIsArray)
+	{
+		constantTypeId = get_element_type(constant->consttype);
+		if (constantTypeId == InvalidOid)
+		{
+			return NULL;
+		}
+	}
+
+	Oid hashFunctionId = get_opfamily_proc(operatorFamilyId, constantTypeId,
+										   constantTypeId, HASHSTANDARD_PROC);
+	if (hashFunctionId == InvalidOid)
+	{
+		return NULL;
+	}
+
+	Datum *valueArray = &constant->constvalue;
+	bool *nullArray = NULL;
+	int valueCount = 1;
+
+	if (constantIsArray)
+	{
+		ArrayType *array = DatumGetArrayTypeP(constant->constvalue);
+		int16 typeLength = 0;
+		bool typeByValue = false;
+		char typeAlign = 0;
+
+		get_typlenbyvalalign(constantTypeId, &typeLength, &typeByValue, &typeAlign);
+		deconstruct_array(array, constantTypeId, typeLength, typeByValue, typeAlign,
+						  &valueArray, &nullArray, &valueCount);
+	}
+
+	BloomFilterQual *bloomFilterQual = palloc0(sizeof(BloomFilterQual));
+	bloomFilterQual->columnIndex = var->varattno - 1;
+	bloomFilterQual->hashArray = palloc0(Max(valueCount, 1) * sizeof(uint32));
+
+	for (int valueIndex = 0; valueIndex < valueCount; valueIndex++)
+	{
+		/* NULL elements of the array never satisfy a strict equality */
+		if (nullArray != NULL && nullArray[valueIndex])
+		{
+			continue;
+		}
+
+		Datum hash = OidFunctionCall1Coll(hashFunctionId, inputCollation,
+										  valueArray[valueIndex]);
+		bloomFilterQual->hashArray[bloomFilterQual->hashCount++] = DatumGetUInt32(hash);
+	}
+
+	if (bloomFilterQual->hashCount == 0)
+	{
+		/* leave "Var = ANY('{NULL}')" to the other checks */
+		pfree(bloomFilterQual->hashArray);
+		pfree(bloomFilterQual);
+		return NULL;
+	}
+
+	return bloomFilterQual;
+}
+
+
+/*
+ * BloomFilterQualRefutesChunk returns true if none of the constants of given
+ * qual might be in the chunk that given bloom filter was built for.
+ */
+static bool
+BloomFilterQualRefutesChunk(BloomFilterQual *bloomFilterQual, bytea *bloomFilter)
+{
+	for (uint32 hashIndex = 0; hashIndex < bloomFilterQual->hashCount; hashIndex++)
+	{
+		if (ChunkBloomFilterMightContain(bloomFilter,
+										 bloomFilterQual->hashArray[hashIndex]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
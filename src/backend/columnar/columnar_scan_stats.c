@@ -0,0 +1,375 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_scan_stats.c
+ *
+ * This file contains the cumulative statistics of the scans on columnar
+ * tables, which are kept per relation in a shared hash table.
+ *
+ * Each read operation keeps its own counters, see ColumnarScanStats, and
+ * adds them to the entry of its relation when it finishes. The hash table
+ * has room for columnar.stat_scans_max relations, and the scans of the
+ * relations that don't fit are not recorded.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "nodes/pg_list.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/hsearch.h"
+#include "utils/rel.h"
+
+#include "pg_version_constants.h"
+
+#include "columnar/columnar.h"
+#include "columnar/columnar_scan_stats.h"
+
+#define SCAN_STATS_SHARED_MEM_NAME "Columnar Scan Stats"
+#define SCAN_STATS_HASH_NAME "Columnar Scan Stats Hash"
+#define SCAN_STATS_TRANCHE_NAME "columnar_scan_stats"
+
+#define STAT_SCANS_COLUMN_COUNT 9
+
+typedef struct ColumnarScanStatsKey
+{
+	Oid databaseId;
+	Oid relationId;
+} ColumnarScanStatsKey;
+
+/* entry of the shared hash table */
+typedef struct ColumnarScanStatsEntry
+{
+	ColumnarScanStatsKey key; /* hash key, must be first */
+
+	int64 scans;
+	int64 stripesRead;
+	int64 stripesSkipped;
+	int64 chunkGroupsRead;
+	int64 chunkGroupsSkipped;
+	int64 bytesRead;
+	int64 bytesDecompressed;
+	double decompressionTime; /* in milliseconds */
+} ColumnarScanStatsEntry;
+
+typedef struct ColumnarScanStatsSharedState
+{
+	LWLock *lock;
+} ColumnarScanStatsSharedState;
+
+/* saved hook values in case of unload */
+#if PG_VERSION_NUM >= PG_VERSION_15
+static shmem_request_hook_type PrevShmemRequestHook = NULL;
+#endif
+static shmem_startup_hook_type PrevShmemStartupHook = NULL;
+
+/* links to the shared memory state, which are NULL if the statistics are disabled */
+static ColumnarScanStatsSharedState *ScanStatsState = NULL;
+static HTAB *ScanStatsHash = NULL;
+
+static Size ScanStatsShmemSize(void);
+static void ColumnarScanStatsShmemRequest(void);
+static void ColumnarScanStatsShmemStartup(void);
+
+PG_FUNCTION_INFO_V1(columnar_stat_scans);
+PG_FUNCTION_INFO_V1(columnar_stat_scans_reset);
+
+
+/*
+ * ColumnarScanStatsInit installs the hooks to allocate the shared memory of
+ * the statistics, if they're enabled and we are being loaded at postmaster
+ * start.
+ */
+void
+ColumnarScanStatsInit(void)
+{
+	if (!process_shared_preload_libraries_in_progress || columnar_stat_scans_max == 0)
+	{
+		return;
+	}
+
+#if PG_VERSION_NUM >= PG_VERSION_15
+	PrevShmemRequestHook = shmem_request_hook;
+	shmem_request_hook = ColumnarScanStatsShmemRequest;
+#else
+	ColumnarScanStatsShmemRequest();
+#endif
+
+	PrevShmemStartupHook = shmem_startup_hook;
+	shmem_startup_hook = ColumnarScanStatsShmemStartup;
+}
+
+
+/*
+ * ScanStatsShmemSize returns the size of the shared memory that the
+ * statistics need.
+ */
+static Size
+ScanStatsShmemSize(void)
+{
+	Size size = MAXALIGN(sizeof(ColumnarScanStatsSharedState));
+	size = add_size(size, hash_estimate_size(columnar_stat_scans_max,
+											 sizeof(ColumnarScanStatsEntry)));
+
+	return size;
+}
+
+
+/*
+ * ColumnarScanStatsShmemRequest requests the shared memory and the lock
+ * that the statistics need.
+ */
+static void
+ColumnarScanStatsShmemRequest(void)
+{
+#if PG_VERSION_NUM >= PG_VERSION_15
+	if (PrevShmemRequestHook)
+	{
+		PrevShmemRequestHook();
+	}
+#endif
+
+	RequestAddinShmemSpace(ScanStatsShmemSize());
+	RequestNamedLWLockTranche(SCAN_STATS_TRANCHE_NAME, 1);
+}
+
+
+/*
+ * ColumnarScanStatsShmemStartup creates or attaches to the shared memory of
+ * the statistics.
+ */
+static void
+ColumnarScanStatsShmemStartup(void)
+{
+	if (PrevShmemStartupHook)
+	{
+		PrevShmemStartupHook();
+	}
+
+	bool found = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	ScanStatsState = ShmemInitStruct(SCAN_STATS_SHARED_MEM_NAME,
+									 sizeof(ColumnarScanStatsSharedState), &found);
+	if (!found)
+	{
+		ScanStatsState->lock = &(GetNamedLWLockTranche(SCAN_STATS_TRANCHE_NAME))->lock;
+	}
+
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(ColumnarScanStatsKey);
+	info.entrysize = sizeof(ColumnarScanStatsEntry);
+
+	ScanStatsHash = ShmemInitHash(SCAN_STATS_HASH_NAME,
+								  columnar_stat_scans_max, columnar_stat_scans_max,
+								  &info, HASH_ELEM | HASH_BLOBS);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+/*
+ * ColumnarScanStatsReport adds the counters of a finished read operation to
+ * the statistics of given relation. Read operations that didn't visit any
+ * stripes, such as the ones on empty tables, are not counted.
+ */
+void
+ColumnarScanStatsReport(Relation relation, ColumnarScanStats *scanStats)
+{
+	if (ScanStatsState == NULL ||
+		scanStats->stripesRead + scanStats->stripesSkipped == 0)
+	{
+		return;
+	}
+
+	ColumnarScanStatsKey key = {
+		.databaseId = MyDatabaseId,
+		.relationId = RelationGetRelid(relation)
+	};
+
+	LWLockAcquire(ScanStatsState->lock, LW_EXCLUSIVE);
+
+	bool found = false;
+	ColumnarScanStatsEntry *entry = hash_search(ScanStatsHash, &key, HASH_ENTER_NULL,
+												&found);
+	if (entry == NULL)
+	{
+		/* no room for another relation */
+		LWLockRelease(ScanStatsState->lock);
+		return;
+	}
+
+	if (!found)
+	{
+		memset(((char *) entry) + sizeof(ColumnarScanStatsKey), 0,
+			   sizeof(ColumnarScanStatsEntry) - sizeof(ColumnarScanStatsKey));
+	}
+
+	entry->scans++;
+	entry->stripesRead += scanStats->stripesRead;
+	entry->stripesSkipped += scanStats->stripesSkipped;
+	entry->chunkGroupsRead += scanStats->chunkGroupsRead;
+	entry->chunkGroupsSkipped += scanStats->chunkGroupsSkipped;
+	entry->bytesRead += scanStats->bytesRead;
+	entry->bytesDecompressed += scanStats->bytesDecompressed;
+	entry->decompressionTime += INSTR_TIME_GET_MILLISEC(scanStats->decompressionTime);
+
+	LWLockRelease(ScanStatsState->lock);
+}
+
+
+/*
+ * ColumnarScanStatsRemove removes the statistics of given relation, which
+ * is called when it's dropped to make room for the other relations.
+ */
+void
+ColumnarScanStatsRemove(Oid relationId)
+{
+	if (ScanStatsState == NULL)
+	{
+		return;
+	}
+
+	ColumnarScanStatsKey key = {
+		.databaseId = MyDatabaseId,
+		.relationId = relationId
+	};
+
+	LWLockAcquire(ScanStatsState->lock, LW_EXCLUSIVE);
+	hash_search(ScanStatsHash, &key, HASH_REMOVE, NULL);
+	LWLockRelease(ScanStatsState->lock);
+}
+
+
+/*
+ * columnar_stat_scans returns the cumulative scan statistics of the columnar
+ * tables in the current database.
+ */
+Datum
+columnar_stat_scans(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *functionContext = NULL;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		functionContext = SRF_FIRSTCALL_INIT();
+
+		MemoryContext oldContext =
+			MemoryContextSwitchTo(functionContext->multi_call_memory_ctx);
+
+		TupleDesc tupleDescriptor = NULL;
+		if (get_call_result_type(fcinfo, NULL, &tupleDescriptor) != TYPEFUNC_COMPOSITE)
+		{
+			elog(ERROR, "return type must be a row type");
+		}
+
+		if (tupleDescriptor->natts != STAT_SCANS_COLUMN_COUNT)
+		{
+			elog(ERROR, "return type must have %d columns", STAT_SCANS_COLUMN_COUNT);
+		}
+
+		functionContext->tuple_desc = BlessTupleDesc(tupleDescriptor);
+
+		/* copy the entries so that we don't hold the lock across calls */
+		List *entryList = NIL;
+		if (ScanStatsState != NULL)
+		{
+			LWLockAcquire(ScanStatsState->lock, LW_SHARED);
+
+			HASH_SEQ_STATUS status;
+			hash_seq_init(&status, ScanStatsHash);
+
+			ColumnarScanStatsEntry *entry = NULL;
+			while ((entry = hash_seq_search(&status)) != NULL)
+			{
+				if (entry->key.databaseId != MyDatabaseId)
+				{
+					continue;
+				}
+
+				ColumnarScanStatsEntry *entryCopy = palloc(sizeof(ColumnarScanStatsEntry));
+				*entryCopy = *entry;
+				entryList = lappend(entryList, entryCopy);
+			}
+
+			LWLockRelease(ScanStatsState->lock);
+		}
+
+		functionContext->user_fctx = entryList;
+		functionContext->max_calls = list_length(entryList);
+
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	functionContext = SRF_PERCALL_SETUP();
+
+	if (functionContext->call_cntr < functionContext->max_calls)
+	{
+		List *entryList = (List *) functionContext->user_fctx;
+		ColumnarScanStatsEntry *entry = list_nth(entryList,
+												 functionContext->call_cntr);
+
+		bool nulls[STAT_SCANS_COLUMN_COUNT] = { false };
+		Datum values[STAT_SCANS_COLUMN_COUNT] = {
+			ObjectIdGetDatum(entry->key.relationId),
+			Int64GetDatum(entry->scans),
+			Int64GetDatum(entry->stripesRead),
+			Int64GetDatum(entry->stripesSkipped),
+			Int64GetDatum(entry->chunkGroupsRead),
+			Int64GetDatum(entry->chunkGroupsSkipped),
+			Int64GetDatum(entry->bytesRead),
+			Int64GetDatum(entry->bytesDecompressed),
+			Float8GetDatum(entry->decompressionTime)
+		};
+
+		HeapTuple tuple = heap_form_tuple(functionContext->tuple_desc, values, nulls);
+
+		SRF_RETURN_NEXT(functionContext, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(functionContext);
+}
+
+
+/*
+ * columnar_stat_scans_reset removes the scan statistics of the columnar
+ * tables in the current database.
+ */
+Datum
+columnar_stat_scans_reset(PG_FUNCTION_ARGS)
+{
+	if (ScanStatsState == NULL)
+	{
+		PG_RETURN_VOID();
+	}
+
+	LWLockAcquire(ScanStatsState->lock, LW_EXCLUSIVE);
+
+	HASH_SEQ_STATUS status;
+	hash_seq_init(&status, ScanStatsHash);
+
+	ColumnarScanStatsEntry *entry = NULL;
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		/* removing the entry that was just returned is allowed */
+		if (entry->key.databaseId == MyDatabaseId)
+		{
+			hash_search(ScanStatsHash, &entry->key, HASH_REMOVE, NULL);
+		}
+	}
+
+	LWLockRelease(ScanStatsState->lock);
+
+	PG_RETURN_VOID();
+}
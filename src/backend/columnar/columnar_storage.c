@@ -47,6 +47,7 @@
 #include "pg_version_compat.h"
 
 #include "columnar/columnar.h"
+#include "columnar/columnar_chunk_cache.h"
 #include "columnar/columnar_storage.h"
 
 
@@ -496,6 +497,31 @@ ColumnarStorageRead(Relation rel, uint64 logicalOffset, char *data, uint32 amoun
 }
 
 
+/*
+ * ColumnarStoragePrefetch - issue prefetch requests for the blocks that
+ * cover the given logical range, so that a later ColumnarStorageRead on the
+ * same range is less likely to wait for I/O.
+ */
+void
+ColumnarStoragePrefetch(Relation rel, uint64 logicalOffset, uint32 amount)
+{
+#ifdef USE_PREFETCH
+	if (amount == 0 || !ColumnarLogicalOffsetIsValid(logicalOffset))
+	{
+		return;
+	}
+
+	BlockNumber firstBlockno = LogicalToPhysical(logicalOffset).blockno;
+	BlockNumber lastBlockno = LogicalToPhysical(logicalOffset + amount - 1).blockno;
+
+	for (BlockNumber blockno = firstBlockno; blockno <= lastBlockno; blockno++)
+	{
+		PrefetchBuffer(rel, MAIN_FORKNUM, blockno);
+	}
+#endif
+}
+
+
 /*
  * ColumnarStorageWrite - map the logical offset to a block and offset, then
  * write the buffer across multiple blocks if necessary.
@@ -584,6 +610,9 @@ ColumnarStorageTruncate(Relation rel, uint64 newDataReservation)
 
 	UnlockRelationForExtension(rel, ExclusiveLock);
 
+	/* the truncated stripes might have chunks in the chunk cache */
+	ColumnarChunkCacheInvalidateStorage(metapage.storageId);
+
 	PhysicalAddr final = LogicalToPhysical(newDataReservation - 1);
 	BlockNumber new_rel_pages = final.blockno + 1;
 	Assert(new_rel_pages <= old_rel_pages);
@@ -30,7 +30,9 @@
 #include "commands/vacuum.h"
 #include "executor/executor.h"
 #include "nodes/makefuncs.h"
+#include "nodes/tidbitmap.h"
 #include "optimizer/plancat.h"
+#include "port/pg_bitutils.h"
 #include "storage/bufmgr.h"
 #include "storage/bufpage.h"
 #include "storage/lmgr.h"
@@ -38,6 +40,7 @@
 #include "storage/procarray.h"
 #include "storage/smgr.h"
 #include "tcop/utility.h"
+#include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
@@ -52,6 +55,7 @@
 
 #include "columnar/columnar.h"
 #include "columnar/columnar_customscan.h"
+#include "columnar/columnar_scan_stats.h"
 #include "columnar/columnar_storage.h"
 #include "columnar/columnar_tableam.h"
 #include "columnar/columnar_version_compat.h"
@@ -82,6 +86,37 @@ typedef struct ColumnarScanDescData
 	MemoryContext scanContext;
 	Bitmapset *attr_needed;
 	List *scanQual;
+
+	/*
+	 * For bitmap heap scans, index of the next entry of the current bitmap
+	 * page to read in columnar_scan_bitmap_next_tuple.
+	 */
+	int bitmapTupleIndex;
+
+	/*
+	 * For sample scans and ANALYZE, the stripes that we sample the rows from,
+	 * see ColumnarSampleBeginRead, and the number of blocks of the relation
+	 * that ANALYZE samples the blocks from.
+	 */
+	ColumnarSampleStripe *sampleStripes;
+	uint32 sampleStripeCount;
+	uint64 sampleRowCount;
+	uint64 sampleChunkGroupCount;
+	BlockNumber sampleRelationBlockCount;
+
+	/*
+	 * The sample block being read, which is a chunk group for sample scans,
+	 * and the range of the rows of it that we read next. Rows are identified
+	 * by their indexes in all the rows of sampleStripes, and sampleStripeIndex
+	 * is the stripe that contains the row at sampleRowIndex.
+	 */
+	BlockNumber sampleBlock;
+	uint32 sampleStripeIndex;
+	uint64 sampleRowIndex;
+	uint64 sampleEndRowIndex;
+
+	/* for sample scans, the TID block that we pass to NextSampleTuple */
+	BlockNumber sampleTidBlock;
 } ColumnarScanDescData;
 
 
@@ -103,6 +138,26 @@ typedef struct IndexFetchColumnarData
 	MemoryContext scanContext;
 } IndexFetchColumnarData;
 
+/*
+ * StripeRewriteState is the state of copying the live rows of some stripes
+ * into new stripes and removing the old stripes, see RewriteStripe.
+ */
+typedef struct StripeRewriteState
+{
+	Relation relation;
+	MemoryContext context;
+
+	/* created when the first stripe is rewritten */
+	ColumnarWriteState *writeState;
+	ColumnarReadState *readState;
+	Datum *values;
+	bool *nulls;
+
+	uint64 rewrittenStripeCount;
+	uint64 movedRowCount;
+	uint64 removedRowCount;
+} StripeRewriteState;
+
 static object_access_hook_type PrevObjectAccessHook = NULL;
 static ProcessUtility_hook_type PrevProcessUtilityHook = NULL;
 
@@ -114,7 +169,8 @@ static void ColumnarTableAMObjectAccessHook(ObjectAccessType access, Oid classId
 											Oid objectId, int subId,
 											void *arg);
 static RangeVar * ColumnarProcessAlterTable(AlterTableStmt *alterTableStmt,
-											List **columnarOptions);
+											List **columnarOptions,
+											List **columnarColumnOptions);
 static void ColumnarProcessUtility(PlannedStmt *pstmt,
 								   const char *queryString,
 								   bool readOnlyTree,
@@ -129,11 +185,26 @@ static List * NeededColumnsList(TupleDesc tupdesc, Bitmapset *attr_needed);
 static void LogRelationStats(Relation rel, int elevel);
 static void TruncateColumnar(Relation rel, int elevel);
 static HeapTuple ColumnarSlotCopyHeapTuple(TupleTableSlot *slot);
-static void ColumnarCheckLogicalReplication(Relation rel);
+static void ColumnarCheckLogicalReplication(Relation rel, CmdType operation);
 static Datum * detoast_values(TupleDesc tupleDesc, Datum *orig_values, bool *isnull);
 static ItemPointerData row_number_to_tid(uint64 rowNumber);
 static uint64 tid_to_row_number(ItemPointerData tid);
 static void ErrorIfInvalidRowNumber(uint64 rowNumber);
+static ColumnarReadState * FetchRowVersionReadState(Relation relation,
+													TupleDesc tupleDescriptor);
+static void CleanupFetchRowVersionState(void *arg);
+static TM_Result ColumnarDeleteRow(Relation relation, ItemPointer tid, CommandId cid,
+								   TM_FailureData *tmfd);
+static void ErrorIfRowDeletedConcurrently(Relation relation);
+static void CompactColumnarStripes(Relation rel, int elevel);
+static uint64 MergeSmallColumnarStripes(Relation rel, int elevel);
+static StripeRewriteState * BeginStripeRewrite(Relation rel);
+static void RewriteStripe(StripeRewriteState *rewriteState,
+						  StripeMetadata *stripeMetadata, uint8 *deletedRowMask);
+static void FlushStripeRewrite(StripeRewriteState *rewriteState);
+static void EndStripeRewrite(StripeRewriteState *rewriteState);
+static uint64 StripeDeletedRowCount(StripeMetadata *stripeMetadata,
+									uint8 *deletedRowMask);
 static void ColumnarReportTotalVirtualBlocks(Relation relation, Snapshot snapshot,
 											 int progressArrIndex);
 static BlockNumber ColumnarGetNumberOfVirtualBlocks(Relation relation, Snapshot snapshot);
@@ -152,6 +223,11 @@ static void ColumnarReadMissingRowsIntoIndex(TableScanDesc scan, Relation indexR
 											 ValidateIndexState *state);
 static ItemPointerData TupleSortSkipSmallerItemPointers(Tuplesortstate *tupleSort,
 														ItemPointer targetItemPointer);
+static void ColumnarSampleBeginRead(ColumnarScanDesc scan);
+static void ColumnarSampleEndRead(ColumnarScanDesc scan);
+static void ColumnarSampleSetRowRange(ColumnarScanDesc scan, uint64 rowIndex,
+									  uint64 endRowIndex);
+static uint64 ColumnarSampleNextRowNumber(ColumnarScanDesc scan);
 
 /* functions for CheckCitusColumnarVersion */
 static bool CheckAvailableVersionColumnar(int elevel);
@@ -270,14 +346,16 @@ CreateColumnarScanMemoryContext(void)
 static ColumnarReadState *
 init_columnar_read_state(Relation relation, TupleDesc tupdesc, Bitmapset *attr_needed,
 						 List *scanQual, MemoryContext scanContext, Snapshot snapshot,
-						 bool randomAccess)
+						 bool randomAccess, ParallelTableScanDesc parallelScan)
 {
 	MemoryContext oldContext = MemoryContextSwitchTo(scanContext);
 
 	List *neededColumnList = NeededColumnsList(tupdesc, attr_needed);
 	ColumnarReadState *readState = ColumnarBeginRead(relation, tupdesc, neededColumnList,
 													 scanQual, scanContext, snapshot,
-													 randomAccess);
+													 randomAccess,
+													 (ParallelColumnarScanDesc)
+													 parallelScan);
 
 	MemoryContextSwitchTo(oldContext);
 
@@ -289,6 +367,11 @@ static void
 columnar_endscan(TableScanDesc sscan)
 {
 	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	if (scan->cs_base.rs_flags & (SO_TYPE_SAMPLESCAN | SO_TYPE_ANALYZE))
+	{
+		ColumnarSampleEndRead(scan);
+	}
+
 	if (scan->cs_readState != NULL)
 	{
 		ColumnarEndRead(scan->cs_readState);
@@ -311,9 +394,23 @@ columnar_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 	/* XXX: hack to pass in new quals that aren't actually scan keys */
 	List *scanQual = (List *) key;
 
+	if (scan->cs_base.rs_flags & SO_TYPE_SAMPLESCAN)
+	{
+		ColumnarSampleEndRead(scan);
+	}
+
 	if (scan->cs_readState != NULL)
 	{
-		ColumnarRescan(scan->cs_readState, scanQual);
+		if (scan->cs_base.rs_flags & (SO_TYPE_BITMAPSCAN | SO_TYPE_SAMPLESCAN))
+		{
+			/* random access reads don't have a position to rewind */
+			ColumnarEndRead(scan->cs_readState);
+			scan->cs_readState = NULL;
+		}
+		else
+		{
+			ColumnarRescan(scan->cs_readState, scanQual);
+		}
 	}
 }
 
@@ -333,7 +430,7 @@ columnar_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlo
 			init_columnar_read_state(scan->cs_base.rs_rd, slot->tts_tupleDescriptor,
 									 scan->attr_needed, scan->scanQual,
 									 scan->scanContext, scan->cs_base.rs_snapshot,
-									 randomAccess);
+									 randomAccess, scan->cs_base.rs_parallel);
 	}
 
 	ExecClearTuple(slot);
@@ -412,21 +509,32 @@ ErrorIfInvalidRowNumber(uint64 rowNumber)
 static Size
 columnar_parallelscan_estimate(Relation rel)
 {
-	elog(ERROR, "columnar_parallelscan_estimate not implemented");
+	return sizeof(ParallelColumnarScanDescData);
 }
 
 
 static Size
 columnar_parallelscan_initialize(Relation rel, ParallelTableScanDesc pscan)
 {
-	elog(ERROR, "columnar_parallelscan_initialize not implemented");
+	ParallelColumnarScanDesc parallelScan = (ParallelColumnarScanDesc) pscan;
+
+	parallelScan->base.phs_relid = RelationGetRelid(rel);
+
+	/* columnar doesn't need synchronized scans, stripes are claimed in order */
+	parallelScan->base.phs_syncscan = false;
+
+	pg_atomic_init_u64(&parallelScan->nextStripeIndex, 0);
+
+	return sizeof(ParallelColumnarScanDescData);
 }
 
 
 static void
 columnar_parallelscan_reinitialize(Relation rel, ParallelTableScanDesc pscan)
 {
-	elog(ERROR, "columnar_parallelscan_reinitialize not implemented");
+	ParallelColumnarScanDesc parallelScan = (ParallelColumnarScanDesc) pscan;
+
+	pg_atomic_write_u64(&parallelScan->nextStripeIndex, 0);
 }
 
 
@@ -521,7 +629,7 @@ columnar_index_fetch_tuple(struct IndexFetchTableData *sscan,
 													  slot->tts_tupleDescriptor,
 													  attr_needed, scanQual,
 													  scan->scanContext,
-													  snapshot, randomAccess);
+													  snapshot, randomAccess, NULL);
 	}
 
 	uint64 rowNumber = tid_to_row_number(*tid);
@@ -630,13 +738,145 @@ columnar_index_fetch_tuple(struct IndexFetchTableData *sscan,
 }
 
 
+/*
+ * Read state that columnar_fetch_row_version uses for SnapshotAny. The
+ * executor fetches the old version of each row that it updates or deletes
+ * that way, so we keep the read state during the command to avoid reading
+ * the stripe that contains the rows again for each row.
+ */
+static ColumnarReadState *FetchRowVersionState = NULL;
+static MemoryContext FetchRowVersionContext = NULL;
+static Relation FetchRowVersionRelation = NULL;
+static TupleDesc FetchRowVersionTupleDesc = NULL;
+static CommandId FetchRowVersionCommandId = InvalidCommandId;
+static MemoryContextCallback FetchRowVersionCleanupCallback;
+
+
 static bool
 columnar_fetch_row_version(Relation relation,
 						   ItemPointer tid,
 						   Snapshot snapshot,
 						   TupleTableSlot *slot)
 {
-	elog(ERROR, "columnar_fetch_row_version not implemented");
+	CheckCitusColumnarVersion(ERROR);
+
+	ExecClearTuple(slot);
+
+	uint64 rowNumber = tid_to_row_number(*tid);
+
+	/*
+	 * The executor fetches the rows being updated or deleted with SnapshotAny
+	 * after a scan returned them, and scans flush the pending writes of the
+	 * relation before reading it.
+	 */
+	TupleDesc tupleDescriptor = slot->tts_tupleDescriptor;
+	bool rowFound = false;
+
+	if (snapshot->snapshot_type == SNAPSHOT_ANY)
+	{
+		ColumnarReadState *readState = FetchRowVersionReadState(relation,
+																tupleDescriptor);
+		rowFound = ColumnarReadRowByRowNumber(readState, rowNumber, slot->tts_values,
+											  slot->tts_isnull);
+	}
+	else
+	{
+		MemoryContext scanContext = CreateColumnarScanMemoryContext();
+		Bitmapset *attr_needed = bms_add_range(NULL, 0, tupleDescriptor->natts - 1);
+
+		bool randomAccess = true;
+		ColumnarReadState *readState = init_columnar_read_state(relation,
+																tupleDescriptor,
+																attr_needed, NIL,
+																scanContext, snapshot,
+																randomAccess, NULL);
+
+		/* tid scans might ask for the rows that we didn't flush yet */
+		ColumnarReadFlushPendingWrites(readState);
+
+		rowFound = ColumnarReadRowByRowNumber(readState, rowNumber, slot->tts_values,
+											  slot->tts_isnull);
+
+		ColumnarEndRead(readState);
+		MemoryContextDelete(scanContext);
+	}
+
+	if (!rowFound)
+	{
+		return false;
+	}
+
+	slot->tts_tableOid = RelationGetRelid(relation);
+	slot->tts_tid = *tid;
+	ExecStoreVirtualTuple(slot);
+
+	return true;
+}
+
+
+/*
+ * FetchRowVersionReadState returns the random access read state that
+ * columnar_fetch_row_version uses to read the rows of given relation with
+ * SnapshotAny, and creates it if the existing one doesn't belong to the
+ * relation or to the current command.
+ */
+static ColumnarReadState *
+FetchRowVersionReadState(Relation relation, TupleDesc tupleDescriptor)
+{
+	CommandId currentCommandId = GetCurrentCommandId(false);
+
+	if (FetchRowVersionState != NULL &&
+		FetchRowVersionRelation == relation &&
+		FetchRowVersionTupleDesc == tupleDescriptor &&
+		FetchRowVersionCommandId == currentCommandId)
+	{
+		return FetchRowVersionState;
+	}
+
+	if (FetchRowVersionContext != NULL)
+	{
+		ColumnarEndRead(FetchRowVersionState);
+		MemoryContextDelete(FetchRowVersionContext);
+	}
+
+	MemoryContext fetchContext = AllocSetContextCreate(TopTransactionContext,
+													   "Columnar Fetch Row Version "
+													   "Context",
+													   ALLOCSET_DEFAULT_SIZES);
+
+	FetchRowVersionCleanupCallback.func = &CleanupFetchRowVersionState;
+	FetchRowVersionCleanupCallback.arg = NULL;
+	MemoryContextRegisterResetCallback(fetchContext, &FetchRowVersionCleanupCallback);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(fetchContext);
+	Bitmapset *attr_needed = bms_add_range(NULL, 0, tupleDescriptor->natts - 1);
+	MemoryContextSwitchTo(oldContext);
+
+	bool randomAccess = true;
+	FetchRowVersionState = init_columnar_read_state(relation, tupleDescriptor,
+													attr_needed, NIL, fetchContext,
+													SnapshotAny, randomAccess, NULL);
+	FetchRowVersionContext = fetchContext;
+	FetchRowVersionRelation = relation;
+	FetchRowVersionTupleDesc = tupleDescriptor;
+	FetchRowVersionCommandId = currentCommandId;
+
+	return FetchRowVersionState;
+}
+
+
+/*
+ * CleanupFetchRowVersionState forgets the read state of columnar_fetch_row_version
+ * when its memory context is deleted, e.g. at the end of the transaction.
+ */
+static void
+CleanupFetchRowVersionState(void *arg)
+{
+	FetchRowVersionState = NULL;
+	FetchRowVersionContext = NULL;
+	FetchRowVersionRelation = NULL;
+	FetchRowVersionTupleDesc = NULL;
+	FetchRowVersionCommandId = InvalidCommandId;
 }
 
 
@@ -644,14 +884,15 @@ static void
 columnar_get_latest_tid(TableScanDesc sscan,
 						ItemPointer tid)
 {
-	elog(ERROR, "columnar_get_latest_tid not implemented");
+	/* rows don't have newer versions, so given tid is the latest one */
 }
 
 
 static bool
 columnar_tuple_tid_valid(TableScanDesc scan, ItemPointer tid)
 {
-	elog(ERROR, "columnar_tuple_tid_valid not implemented");
+	return ItemPointerIsValid(tid) &&
+		   tid_to_row_number(*tid) >= COLUMNAR_FIRST_ROW_NUMBER;
 }
 
 
@@ -663,7 +904,20 @@ columnar_tuple_satisfies_snapshot(Relation rel, TupleTableSlot *slot,
 
 	uint64 rowNumber = tid_to_row_number(slot->tts_tid);
 	StripeMetadata *stripeMetadata = FindStripeByRowNumber(rel, rowNumber, snapshot);
-	return stripeMetadata != NULL;
+	if (stripeMetadata == NULL)
+	{
+		return false;
+	}
+
+	if (StripeWriteState(stripeMetadata) != STRIPE_WRITE_FLUSHED)
+	{
+		return true;
+	}
+
+	uint8 *deletedRowMask = ColumnarReadStripeRowMask(rel, stripeMetadata, snapshot);
+	uint64 rowOffset = rowNumber - stripeMetadata->firstRowNumber;
+
+	return deletedRowMask == NULL || !COLUMNAR_ROW_MASK_IS_SET(deletedRowMask, rowOffset);
 }
 
 
@@ -733,7 +987,7 @@ columnar_tuple_insert(Relation relation, TupleTableSlot *slot, CommandId cid,
 	MemoryContext oldContext = MemoryContextSwitchTo(ColumnarWritePerTupleContext(
 														 writeState));
 
-	ColumnarCheckLogicalReplication(relation);
+	ColumnarCheckLogicalReplication(relation, CMD_INSERT);
 
 	slot_getallattrs(slot);
 
@@ -781,7 +1035,7 @@ columnar_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
 															   RelationGetRelid(relation),
 															   GetCurrentSubTransactionId());
 
-	ColumnarCheckLogicalReplication(relation);
+	ColumnarCheckLogicalReplication(relation, CMD_INSERT);
 
 	MemoryContext oldContext = MemoryContextSwitchTo(ColumnarWritePerTupleContext(
 														 writeState));
@@ -811,17 +1065,143 @@ columnar_tuple_delete(Relation relation, ItemPointer tid, CommandId cid,
 					  Snapshot snapshot, Snapshot crosscheck, bool wait,
 					  TM_FailureData *tmfd, bool changingPart)
 {
-	elog(ERROR, "columnar_tuple_delete not implemented");
+	CheckCitusColumnarVersion(ERROR);
+
+	ColumnarCheckLogicalReplication(relation, CMD_DELETE);
+
+	TM_Result result = ColumnarDeleteRow(relation, tid, cid, tmfd);
+	if (result == TM_Deleted && !IsolationUsesXactSnapshot())
+	{
+		ErrorIfRowDeletedConcurrently(relation);
+	}
+	else if (result == TM_Ok)
+	{
+		/* let autovacuum know about the rows that it could compact */
+		pgstat_count_heap_delete(relation);
+	}
+
+	return result;
 }
 
 
+/*
+ * columnar_tuple_update deletes the old version of the row and inserts the
+ * new version as a new row, so the updated rows get new tids.
+ */
 static TM_Result
 columnar_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 					  CommandId cid, Snapshot snapshot, Snapshot crosscheck,
 					  bool wait, TM_FailureData *tmfd,
 					  LockTupleMode *lockmode, TU_UpdateIndexes *update_indexes)
 {
-	elog(ERROR, "columnar_tuple_update not implemented");
+	CheckCitusColumnarVersion(ERROR);
+
+	ColumnarCheckLogicalReplication(relation, CMD_UPDATE);
+
+	TM_Result result = ColumnarDeleteRow(relation, otid, cid, tmfd);
+	if (result == TM_Deleted && !IsolationUsesXactSnapshot())
+	{
+		ErrorIfRowDeletedConcurrently(relation);
+	}
+
+	if (result != TM_Ok)
+	{
+		return result;
+	}
+
+	columnar_tuple_insert(relation, slot, cid, 0, NULL);
+
+	*lockmode = LockTupleExclusive;
+
+#if PG_VERSION_NUM >= PG_VERSION_16
+	*update_indexes = TU_All;
+#else
+	*update_indexes = true;
+#endif
+
+	return TM_Ok;
+}
+
+
+/*
+ * ColumnarDeleteRow marks the row with given tid as deleted by the command
+ * cid of current transaction, and returns TM_Ok. The deleted rows are kept
+ * in memory until the transaction commits, see AddPendingRowDeletion.
+ *
+ * If the row was already deleted by current transaction, then it returns
+ * TM_SelfModified, and if it was deleted by a committed transaction, then
+ * it returns TM_Deleted.
+ *
+ * As rows don't have xmax, we cannot wait for the transactions that deleted
+ * the same row to finish. Instead, transactions that delete rows from a
+ * columnar table are serialized by taking a self-conflicting lock on the
+ * table until the end of the transaction.
+ */
+static TM_Result
+ColumnarDeleteRow(Relation relation, ItemPointer tid, CommandId cid,
+				  TM_FailureData *tmfd)
+{
+	LockRelation(relation, ShareUpdateExclusiveLock);
+
+	uint64 rowNumber = tid_to_row_number(*tid);
+	StripeMetadata *stripeMetadata = FindStripeByRowNumber(relation, rowNumber,
+														   SnapshotSelf);
+	if (stripeMetadata == NULL)
+	{
+		/* stripe was rewritten by a VACUUM that committed after our snapshot */
+		ereport(ERROR, (errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+						errmsg("could not serialize access due to concurrent "
+							   "vacuum of columnar table \"%s\"",
+							   RelationGetRelationName(relation))));
+	}
+
+	if (StripeWriteState(stripeMetadata) != STRIPE_WRITE_FLUSHED)
+	{
+		/* scans flush pending writes before returning any rows */
+		ereport(ERROR, (errmsg("cannot delete a row from stripe " UINT64_FORMAT
+							   " of columnar table %s since the stripe is not "
+							   "flushed", stripeMetadata->id,
+							   RelationGetRelationName(relation))));
+	}
+
+	uint64 rowOffset = rowNumber - stripeMetadata->firstRowNumber;
+	CommandId deletingCid = InvalidCommandId;
+	if (AddPendingRowDeletion(relation, stripeMetadata, rowOffset,
+							  GetCurrentSubTransactionId(), cid, &deletingCid))
+	{
+		return TM_Ok;
+	}
+
+	tmfd->ctid = *tid;
+	tmfd->traversed = false;
+	tmfd->cmax = deletingCid;
+
+	if (deletingCid == InvalidCommandId)
+	{
+		tmfd->xmax = InvalidTransactionId;
+		return TM_Deleted;
+	}
+
+	tmfd->xmax = GetCurrentTransactionId();
+	return TM_SelfModified;
+}
+
+
+/*
+ * ErrorIfRowDeletedConcurrently throws the error that we use instead of
+ * re-checking the latest version of a row under READ COMMITTED. Since
+ * updates don't link the old version of a row to the new one, we cannot
+ * tell whether the row was deleted or updated by the concurrent transaction.
+ */
+static void
+ErrorIfRowDeletedConcurrently(Relation relation)
+{
+	ereport(ERROR, (errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+					errmsg("could not serialize access due to concurrent update "
+						   "of columnar table \"%s\"",
+						   RelationGetRelationName(relation)),
+					errdetail("The row was deleted or updated by a concurrent "
+							  "transaction.")));
 }
 
 
@@ -960,9 +1340,12 @@ columnar_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 	ColumnarOptions columnarOptions = { 0 };
 	ReadColumnarOptions(OldHeap->rd_id, &columnarOptions);
 
+	ColumnarColumnOptions *columnOptions = ReadColumnarColumnOptions(OldHeap->rd_id,
+																	 targetDesc->natts);
 	ColumnarWriteState *writeState = ColumnarBeginWrite(RelationPhysicalIdentifier_compat(
 															NewHeap),
 														columnarOptions,
+														columnOptions,
 														targetDesc);
 
 	/* we need all columns */
@@ -972,32 +1355,79 @@ columnar_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 	/* no quals for table rewrite */
 	List *scanQual = NIL;
 
-	/* use SnapshotAny when re-writing table as heapAM does */
-	Snapshot snapshot = SnapshotAny;
+	/*
+	 * Unlike heapAM, we don't use SnapshotAny here, since it would see the
+	 * deleted rows too. The rows that are visible to the latest snapshot are
+	 * the ones that we need to keep, since concurrent transactions cannot
+	 * modify the table while we hold AccessExclusiveLock on it.
+	 */
+	Snapshot snapshot = RegisterSnapshot(GetLatestSnapshot());
 
 	MemoryContext scanContext = CreateColumnarScanMemoryContext();
 	bool randomAccess = false;
 	ColumnarReadState *readState = init_columnar_read_state(OldHeap, sourceDesc,
 															attr_needed, scanQual,
 															scanContext, snapshot,
-															randomAccess);
+															randomAccess, NULL);
 
 	Datum *values = palloc0(sourceDesc->natts * sizeof(Datum));
 	bool *nulls = palloc0(sourceDesc->natts * sizeof(bool));
 
 	*num_tuples = 0;
 
-	/* we don't need to know rowNumber here */
-	while (ColumnarReadNextRow(readState, values, nulls, NULL))
+	/*
+	 * If the table has a sort key, we sort all of its rows so that the new
+	 * stripes are ordered by the sort key as well, not just their rows.
+	 * The writer sorts each stripe again, but the rows are already sorted.
+	 */
+	Tuplesortstate *tableSortState = ColumnarBeginSortKeySort(sourceDesc, columnOptions,
+															  maintenance_work_mem);
+	if (tableSortState != NULL)
+	{
+		TupleTableSlot *inputSlot = MakeSingleTupleTableSlot(sourceDesc,
+															 &TTSOpsVirtual);
+		TupleTableSlot *outputSlot = MakeSingleTupleTableSlot(sourceDesc,
+															  &TTSOpsMinimalTuple);
+
+		while (ColumnarReadNextRow(readState, inputSlot->tts_values,
+								   inputSlot->tts_isnull, NULL))
+		{
+			ExecStoreVirtualTuple(inputSlot);
+
+			/* tuplesort_puttupleslot copies the slot into sort context */
+			tuplesort_puttupleslot(tableSortState, inputSlot);
+			ExecClearTuple(inputSlot);
+		}
+
+		tuplesort_performsort(tableSortState);
+
+		while (tuplesort_gettupleslot(tableSortState, true, false, outputSlot, NULL))
+		{
+			slot_getallattrs(outputSlot);
+			ColumnarWriteRow(writeState, outputSlot->tts_values, outputSlot->tts_isnull);
+			(*num_tuples)++;
+		}
+
+		tuplesort_end(tableSortState);
+		ExecDropSingleTupleTableSlot(inputSlot);
+		ExecDropSingleTupleTableSlot(outputSlot);
+	}
+	else
 	{
-		ColumnarWriteRow(writeState, values, nulls);
-		(*num_tuples)++;
+		/* we don't need to know rowNumber here */
+		while (ColumnarReadNextRow(readState, values, nulls, NULL))
+		{
+			ColumnarWriteRow(writeState, values, nulls);
+			(*num_tuples)++;
+		}
 	}
 
 	*tups_vacuumed = 0;
 
 	ColumnarEndWrite(writeState);
 	ColumnarEndRead(readState);
+
+	UnregisterSnapshot(snapshot);
 }
 
 
@@ -1047,7 +1477,10 @@ ColumnarTableTupleCount(Relation relation)
 		tupleCount += stripe->rowCount;
 	}
 
-	return tupleCount;
+	uint64 deletedRowCount =
+		ColumnarDeletedRowCount(RelationPhysicalIdentifier_compat(relation));
+
+	return tupleCount - Min(tupleCount, deletedRowCount);
 }
 
 
@@ -1086,9 +1519,12 @@ columnar_vacuum_rel(Relation rel, VacuumParams *params,
 	LogRelationStats(rel, elevel);
 
 	/*
-	 * We don't have updates, deletes, or concurrent updates, so all we
-	 * care for now is truncating the unused space at the end of storage.
+	 * Deleted rows are only masked, so rewrite the stripes that have many
+	 * deleted rows, and then truncate the unused space at the end of
+	 * storage.
 	 */
+	CompactColumnarStripes(rel, elevel);
+
 	if (params->truncate == VACOPTVALUE_ENABLED)
 	{
 		TruncateColumnar(rel, elevel);
@@ -1307,6 +1743,303 @@ LogRelationStats(Relation rel, int elevel)
 }
 
 
+/*
+ * CompactColumnarStripes rewrites the live rows of the stripes in which at
+ * least columnar.vacuum_compaction_threshold of the rows are deleted into
+ * new stripes, and removes the metadata of the old stripes so that deleted
+ * rows are not read anymore.
+ *
+ * The transactions with older snapshots keep reading the old stripes, so
+ * their space is not reused, but it is reclaimed by TruncateColumnar if it
+ * is at the end of the storage, or by VACUUM FULL.
+ *
+ * The moved rows get new row numbers, so we skip the tables with indexes.
+ */
+static void
+CompactColumnarStripes(Relation rel, int elevel)
+{
+	if (columnar_vacuum_compaction_threshold <= 0)
+	{
+		return;
+	}
+
+	List *stripeList = StripesForRelfilelocator(RelationPhysicalIdentifier_compat(rel));
+	StripeRewriteState *rewriteState = BeginStripeRewrite(rel);
+
+	StripeMetadata *stripeMetadata = NULL;
+	foreach_ptr(stripeMetadata, stripeList)
+	{
+		if (StripeWriteState(stripeMetadata) != STRIPE_WRITE_FLUSHED)
+		{
+			continue;
+		}
+
+		uint8 *deletedRowMask = ColumnarReadStripeRowMask(rel, stripeMetadata,
+														  SnapshotSelf);
+		if (deletedRowMask == NULL)
+		{
+			continue;
+		}
+
+		uint64 deletedRowCount = StripeDeletedRowCount(stripeMetadata, deletedRowMask);
+		if (deletedRowCount <
+			columnar_vacuum_compaction_threshold * stripeMetadata->rowCount)
+		{
+			continue;
+		}
+
+		if (RelationGetIndexList(rel) != NIL)
+		{
+			ereport(elevel, (errmsg("\"%s\": skipping compaction of stripes with "
+									"deleted rows since the table has indexes",
+									RelationGetRelationName(rel))));
+			break;
+		}
+
+		RewriteStripe(rewriteState, stripeMetadata, deletedRowMask);
+	}
+
+	if (rewriteState->rewrittenStripeCount > 0)
+	{
+		ereport(elevel, (errmsg("\"%s\": compacted " UINT64_FORMAT " stripes, moved "
+								UINT64_FORMAT " rows and removed " UINT64_FORMAT
+								" deleted rows", RelationGetRelationName(rel),
+								rewriteState->rewrittenStripeCount,
+								rewriteState->movedRowCount,
+								rewriteState->removedRowCount)));
+	}
+
+	EndStripeRewrite(rewriteState);
+}
+
+
+/*
+ * MergeSmallColumnarStripes merges the runs of adjacent stripes that have
+ * fewer live rows than half of the stripe_row_limit of the table into one
+ * stripe per run, and returns the number of stripes that were merged.
+ *
+ * Like CompactColumnarStripes, it only appends new stripes and removes the
+ * metadata of the old ones, so the caller only needs to hold a
+ * ShareUpdateExclusiveLock on the table, which doesn't block the readers
+ * and the writers. The merged rows get new row numbers, so the caller
+ * should make sure that the table doesn't have indexes.
+ */
+static uint64
+MergeSmallColumnarStripes(Relation rel, int elevel)
+{
+	Assert(RelationGetIndexList(rel) == NIL);
+
+	ColumnarOptions columnarOptions = { 0 };
+	ReadColumnarOptions(RelationGetRelid(rel), &columnarOptions);
+
+	uint64 stripeRowLimit = columnarOptions.stripeRowCount;
+	uint64 smallStripeRowLimit = stripeRowLimit / 2;
+
+	List *stripeList = StripesForRelfilelocator(RelationPhysicalIdentifier_compat(rel));
+	StripeRewriteState *rewriteState = BeginStripeRewrite(rel);
+
+	/* run of adjacent small stripes that still fit into a single stripe */
+	List *runStripeList = NIL;
+	List *runRowMaskList = NIL;
+	uint64 runRowCount = 0;
+	uint64 mergedRunCount = 0;
+
+	/* a NULL entry at the end of the list closes the last run */
+	stripeList = lappend(stripeList, NULL);
+
+	StripeMetadata *stripeMetadata = NULL;
+	foreach_ptr(stripeMetadata, stripeList)
+	{
+		uint8 *deletedRowMask = NULL;
+		uint64 liveRowCount = 0;
+		bool isSmallStripe = false;
+
+		if (stripeMetadata != NULL &&
+			StripeWriteState(stripeMetadata) == STRIPE_WRITE_FLUSHED)
+		{
+			deletedRowMask = ColumnarReadStripeRowMask(rel, stripeMetadata,
+													   SnapshotSelf);
+			liveRowCount = stripeMetadata->rowCount -
+						   StripeDeletedRowCount(stripeMetadata, deletedRowMask);
+			isSmallStripe = liveRowCount < smallStripeRowLimit;
+		}
+
+		if (!isSmallStripe || runRowCount + liveRowCount > stripeRowLimit)
+		{
+			if (list_length(runStripeList) > 1)
+			{
+				StripeMetadata *runStripe = NULL;
+				uint8 *runRowMask = NULL;
+				forboth_ptr(runStripe, runStripeList, runRowMask, runRowMaskList)
+				{
+					RewriteStripe(rewriteState, runStripe, runRowMask);
+				}
+
+				/* don't mix the rows of the next run into the same stripe */
+				FlushStripeRewrite(rewriteState);
+				mergedRunCount++;
+			}
+
+			runStripeList = NIL;
+			runRowMaskList = NIL;
+			runRowCount = 0;
+		}
+
+		if (isSmallStripe)
+		{
+			runStripeList = lappend(runStripeList, stripeMetadata);
+			runRowMaskList = lappend(runRowMaskList, deletedRowMask);
+			runRowCount += liveRowCount;
+		}
+	}
+
+	uint64 mergedStripeCount = rewriteState->rewrittenStripeCount;
+	if (mergedStripeCount > 0)
+	{
+		ereport(elevel, (errmsg("\"%s\": merged " UINT64_FORMAT " small stripes "
+								"into " UINT64_FORMAT " stripes, moved "
+								UINT64_FORMAT " rows and removed " UINT64_FORMAT
+								" deleted rows", RelationGetRelationName(rel),
+								mergedStripeCount, mergedRunCount,
+								rewriteState->movedRowCount,
+								rewriteState->removedRowCount)));
+	}
+
+	EndStripeRewrite(rewriteState);
+
+	return mergedStripeCount;
+}
+
+
+/*
+ * BeginStripeRewrite returns the state for rewriting some stripes of given
+ * relation using RewriteStripe. The writer and the reader are created when
+ * the first stripe is rewritten.
+ */
+static StripeRewriteState *
+BeginStripeRewrite(Relation rel)
+{
+	MemoryContext rewriteContext = CreateColumnarScanMemoryContext();
+
+	StripeRewriteState *rewriteState =
+		MemoryContextAllocZero(rewriteContext, sizeof(StripeRewriteState));
+	rewriteState->relation = rel;
+	rewriteState->context = rewriteContext;
+
+	return rewriteState;
+}
+
+
+/*
+ * RewriteStripe appends the rows of given stripe that are not deleted to the
+ * stripes that the rewrite writes, and removes the metadata of the stripe.
+ */
+static void
+RewriteStripe(StripeRewriteState *rewriteState, StripeMetadata *stripeMetadata,
+			  uint8 *deletedRowMask)
+{
+	Relation rel = rewriteState->relation;
+	TupleDesc tupleDescriptor = RelationGetDescr(rel);
+	RelFileLocator relfilelocator = RelationPhysicalIdentifier_compat(rel);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(rewriteState->context);
+
+	if (rewriteState->writeState == NULL)
+	{
+		ColumnarOptions columnarOptions = { 0 };
+		ReadColumnarOptions(RelationGetRelid(rel), &columnarOptions);
+
+		rewriteState->writeState =
+			ColumnarBeginWrite(relfilelocator, columnarOptions,
+							   ReadColumnarColumnOptions(RelationGetRelid(rel),
+														 tupleDescriptor->natts),
+							   tupleDescriptor);
+
+		Bitmapset *attr_needed = bms_add_range(NULL, 0, tupleDescriptor->natts - 1);
+		bool randomAccess = true;
+		rewriteState->readState =
+			init_columnar_read_state(rel, tupleDescriptor, attr_needed, NIL,
+									 rewriteState->context, SnapshotSelf,
+									 randomAccess, NULL);
+
+		rewriteState->values = palloc0(tupleDescriptor->natts * sizeof(Datum));
+		rewriteState->nulls = palloc0(tupleDescriptor->natts * sizeof(bool));
+	}
+
+	uint64 deletedRowCount = 0;
+	for (uint64 rowOffset = 0; rowOffset < stripeMetadata->rowCount; rowOffset++)
+	{
+		if (deletedRowMask != NULL && COLUMNAR_ROW_MASK_IS_SET(deletedRowMask, rowOffset))
+		{
+			deletedRowCount++;
+			continue;
+		}
+
+		ColumnarReadRowByRowNumberOrError(rewriteState->readState,
+										  stripeMetadata->firstRowNumber + rowOffset,
+										  rewriteState->values, rewriteState->nulls);
+		ColumnarWriteRow(rewriteState->writeState, rewriteState->values,
+						 rewriteState->nulls);
+	}
+
+	DeleteStripeMetadataRows(relfilelocator, stripeMetadata->id);
+
+	rewriteState->rewrittenStripeCount++;
+	rewriteState->movedRowCount += stripeMetadata->rowCount - deletedRowCount;
+	rewriteState->removedRowCount += deletedRowCount;
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * FlushStripeRewrite flushes the rows that the rewrite appended so far, so
+ * the rows of the next stripes start a new stripe.
+ */
+static void
+FlushStripeRewrite(StripeRewriteState *rewriteState)
+{
+	if (rewriteState->writeState != NULL)
+	{
+		ColumnarFlushPendingWrites(rewriteState->writeState);
+	}
+}
+
+
+/*
+ * EndStripeRewrite flushes the remaining rows of the rewrite and frees its
+ * state.
+ */
+static void
+EndStripeRewrite(StripeRewriteState *rewriteState)
+{
+	if (rewriteState->writeState != NULL)
+	{
+		ColumnarEndWrite(rewriteState->writeState);
+		ColumnarEndRead(rewriteState->readState);
+	}
+
+	MemoryContextDelete(rewriteState->context);
+}
+
+
+/*
+ * StripeDeletedRowCount returns the number of rows that are marked in given
+ * deleted row mask of the stripe, which might be NULL.
+ */
+static uint64
+StripeDeletedRowCount(StripeMetadata *stripeMetadata, uint8 *deletedRowMask)
+{
+	if (deletedRowMask == NULL)
+	{
+		return 0;
+	}
+
+	return pg_popcount((const char *) deletedRowMask,
+					   COLUMNAR_ROW_MASK_SIZE(stripeMetadata->rowCount));
+}
+
+
 /*
  * TruncateColumnar truncates the unused space at the end of main fork for
  * a columnar table. This unused space can be created by aborted transactions.
@@ -1403,63 +2136,233 @@ ConditionalLockRelationWithTimeout(Relation rel, LOCKMODE lockMode, int timeout,
 	{
 		if (ConditionalLockRelation(rel, lockMode))
 		{
-			break;
+			break;
+		}
+
+		/*
+		 * Check for interrupts while trying to (re-)acquire the lock
+		 */
+		CHECK_FOR_INTERRUPTS();
+
+		if (++lock_retry > (timeout / retryInterval))
+		{
+			return false;
+		}
+
+		pg_usleep(retryInterval * 1000L);
+	}
+
+	return true;
+}
+
+
+/*
+ * columnar_scan_analyze_next_block prepares to read the rows for given block
+ * that acquire_sample_rows() in analyze.c sampled.
+ *
+ * Our access method is not pages based, i.e. tuples are not confined to
+ * pages boundaries. Instead, we split the rows of the table into as many
+ * consecutive ranges as the number of blocks of the relation, and read the
+ * range of given block. Since each block yields its share of the rows, the
+ * row count that acquire_sample_rows() extrapolates is still accurate, while
+ * we only read the chunk groups that the sampled ranges overlap.
+ */
+static bool
+columnar_scan_analyze_next_block(TableScanDesc sscan, BlockNumber blockno,
+								 BufferAccessStrategy bstrategy)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	ColumnarSampleBeginRead(scan);
+
+	BlockNumber blockCount = scan->sampleRelationBlockCount;
+	if (blockno >= blockCount)
+	{
+		/* relation was extended after acquire_sample_rows() checked its size */
+		return false;
+	}
+
+	double rowsPerBlock = (double) scan->sampleRowCount / blockCount;
+	uint64 rowIndex = (uint64) floor(rowsPerBlock * blockno);
+	uint64 endRowIndex = (blockno + 1 == blockCount) ? scan->sampleRowCount :
+						 (uint64) floor(rowsPerBlock * (blockno + 1));
+
+	ColumnarSampleSetRowRange(scan, rowIndex, endRowIndex);
+
+	return true;
+}
+
+
+/*
+ * columnar_scan_analyze_next_tuple reads the next row of the range that
+ * columnar_scan_analyze_next_block chose into the slot. The rows that were
+ * deleted are counted as dead rows.
+ */
+static bool
+columnar_scan_analyze_next_tuple(TableScanDesc sscan, TransactionId OldestXmin,
+								 double *liverows, double *deadrows,
+								 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	while (scan->sampleRowIndex < scan->sampleEndRowIndex)
+	{
+		uint64 rowNumber = ColumnarSampleNextRowNumber(scan);
+
+		ExecClearTuple(slot);
+
+		if (ColumnarReadRowByRowNumber(scan->cs_readState, rowNumber,
+									   slot->tts_values, slot->tts_isnull))
+		{
+			ExecStoreVirtualTuple(slot);
+			slot->tts_tid = row_number_to_tid(rowNumber);
+
+			(*liverows)++;
+			return true;
+		}
+
+		(*deadrows)++;
+	}
+
+	return false;
+}
+
+
+/*
+ * ColumnarSampleBeginRead initializes the random access read state of given
+ * sample or ANALYZE scan, and the stripes to sample the rows from, if not
+ * done already.
+ *
+ * Unlike the other scans, we don't have a slot to take the tuple descriptor
+ * from at this point, but both sample scans and ANALYZE use the tuple
+ * descriptor of the relation for their slots anyway.
+ */
+static void
+ColumnarSampleBeginRead(ColumnarScanDesc scan)
+{
+	if (scan->cs_readState != NULL)
+	{
+		return;
+	}
+
+	Relation relation = scan->cs_base.rs_rd;
+	bool randomAccess = true;
+	scan->cs_readState =
+		init_columnar_read_state(relation, RelationGetDescr(relation),
+								 scan->attr_needed, NIL, scan->scanContext,
+								 scan->cs_base.rs_snapshot, randomAccess, NULL);
+
+	/* we want to sample the rows that we didn't flush yet too */
+	ColumnarReadFlushPendingWrites(scan->cs_readState);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(scan->scanContext);
+	scan->sampleStripes = ColumnarReadSampleStripes(scan->cs_readState,
+													&scan->sampleStripeCount);
+	MemoryContextSwitchTo(oldContext);
+
+	scan->sampleRowCount = 0;
+	scan->sampleChunkGroupCount = 0;
+	if (scan->sampleStripeCount > 0)
+	{
+		ColumnarSampleStripe *lastStripe =
+			&scan->sampleStripes[scan->sampleStripeCount - 1];
+		uint64 lastStripeChunkGroupCount =
+			(lastStripe->rowCount + lastStripe->chunkGroupRowCount - 1) /
+			lastStripe->chunkGroupRowCount;
+
+		scan->sampleRowCount = lastStripe->precedingRowCount + lastStripe->rowCount;
+		scan->sampleChunkGroupCount = lastStripe->precedingChunkGroupCount +
+									  lastStripeChunkGroupCount;
+	}
+
+	scan->sampleRelationBlockCount = RelationGetNumberOfBlocks(relation);
+	scan->sampleBlock = InvalidBlockNumber;
+	scan->sampleStripeIndex = 0;
+	scan->sampleRowIndex = 0;
+	scan->sampleEndRowIndex = 0;
+}
+
+
+/*
+ * ColumnarSampleEndRead frees the stripes that given sample or ANALYZE scan
+ * samples the rows from, so that ColumnarSampleBeginRead initializes them
+ * again, e.g. after a rescan.
+ */
+static void
+ColumnarSampleEndRead(ColumnarScanDesc scan)
+{
+	if (scan->sampleStripes != NULL)
+	{
+		pfree(scan->sampleStripes);
+		scan->sampleStripes = NULL;
+	}
+
+	scan->sampleStripeCount = 0;
+	scan->sampleRowIndex = 0;
+	scan->sampleEndRowIndex = 0;
+}
+
+
+/*
+ * ColumnarSampleSetRowRange sets the range of the rows that given sample or
+ * ANALYZE scan reads next to [rowIndex, endRowIndex), where rows are
+ * identified by their indexes in all the rows of the stripes being sampled.
+ */
+static void
+ColumnarSampleSetRowRange(ColumnarScanDesc scan, uint64 rowIndex, uint64 endRowIndex)
+{
+	scan->sampleRowIndex = rowIndex;
+	scan->sampleEndRowIndex = endRowIndex;
+
+	if (rowIndex >= endRowIndex)
+	{
+		return;
+	}
+
+	/* binary search for the last stripe that starts at or before rowIndex */
+	uint32 lowIndex = 0;
+	uint32 highIndex = scan->sampleStripeCount - 1;
+	while (lowIndex < highIndex)
+	{
+		uint32 middleIndex = lowIndex + (highIndex - lowIndex + 1) / 2;
+		if (scan->sampleStripes[middleIndex].precedingRowCount <= rowIndex)
+		{
+			lowIndex = middleIndex;
 		}
-
-		/*
-		 * Check for interrupts while trying to (re-)acquire the lock
-		 */
-		CHECK_FOR_INTERRUPTS();
-
-		if (++lock_retry > (timeout / retryInterval))
+		else
 		{
-			return false;
+			highIndex = middleIndex - 1;
 		}
-
-		pg_usleep(retryInterval * 1000L);
 	}
 
-	return true;
+	scan->sampleStripeIndex = lowIndex;
 }
 
 
-static bool
-columnar_scan_analyze_next_block(TableScanDesc scan, BlockNumber blockno,
-								 BufferAccessStrategy bstrategy)
+/*
+ * ColumnarSampleNextRowNumber returns the row number of the row at
+ * sampleRowIndex of given scan, and advances sampleRowIndex.
+ */
+static uint64
+ColumnarSampleNextRowNumber(ColumnarScanDesc scan)
 {
-	/*
-	 * Our access method is not pages based, i.e. tuples are not confined
-	 * to pages boundaries. So not much to do here. We return true anyway
-	 * so acquire_sample_rows() in analyze.c would call our
-	 * columnar_scan_analyze_next_tuple() callback.
-	 */
-	return true;
-}
+	ColumnarSampleStripe *sampleStripe = &scan->sampleStripes[scan->sampleStripeIndex];
 
-
-static bool
-columnar_scan_analyze_next_tuple(TableScanDesc scan, TransactionId OldestXmin,
-								 double *liverows, double *deadrows,
-								 TupleTableSlot *slot)
-{
-	/*
-	 * Currently we don't do anything smart to reduce number of rows returned
-	 * for ANALYZE. The TableAM API's ANALYZE functions are designed for page
-	 * based access methods where it chooses random pages, and then reads
-	 * tuples from those pages.
-	 *
-	 * We could do something like that here by choosing sample stripes or chunks,
-	 * but getting that correct might need quite some work. Since columnar_fdw's
-	 * ANALYZE scanned all rows, as a starter we do the same here and scan all
-	 * rows.
-	 */
-	if (columnar_getnextslot(scan, ForwardScanDirection, slot))
+	/* ranges that ANALYZE reads might span several stripes */
+	while (scan->sampleRowIndex >= sampleStripe->precedingRowCount +
+		   sampleStripe->rowCount)
 	{
-		(*liverows)++;
-		return true;
+		scan->sampleStripeIndex++;
+		Assert(scan->sampleStripeIndex < scan->sampleStripeCount);
+
+		sampleStripe = &scan->sampleStripes[scan->sampleStripeIndex];
 	}
 
-	return false;
+	uint64 rowNumber = sampleStripe->firstRowNumber +
+					   (scan->sampleRowIndex - sampleStripe->precedingRowCount);
+	scan->sampleRowIndex++;
+
+	return rowNumber;
 }
 
 
@@ -1663,6 +2566,10 @@ ColumnarReadRowsIntoIndex(TableScanDesc scan, Relation indexRelation,
 
 	BlockNumber lastReportedBlockNumber = InvalidBlockNumber;
 
+	/* stripe of the last row read and the mask of its deleted rows */
+	StripeMetadata *maskStripe = NULL;
+	uint8 *rowMask = NULL;
+
 	ExprContext *econtext = GetPerTupleExprContext(estate);
 	TupleTableSlot *slot = econtext->ecxt_scantuple;
 	while (columnar_getnextslot(scan, ForwardScanDirection, slot))
@@ -1698,8 +2605,32 @@ ColumnarReadRowsIntoIndex(TableScanDesc scan, Relation indexRelation,
 
 		ItemPointerData itemPointerData = slot->tts_tid;
 
-		/* currently, columnar tables can't have dead tuples */
+		/*
+		 * SnapshotAny also returns the rows that were deleted, which we still
+		 * index for the older snapshots but mark as dead so unique checks
+		 * skip them.
+		 */
 		bool tupleIsAlive = true;
+		if (scan->rs_snapshot->snapshot_type == SNAPSHOT_ANY)
+		{
+			uint64 rowNumber = tid_to_row_number(itemPointerData);
+			if (maskStripe == NULL ||
+				rowNumber >= maskStripe->firstRowNumber + maskStripe->rowCount)
+			{
+				maskStripe = FindStripeByRowNumber(scan->rs_rd, rowNumber,
+												   SnapshotSelf);
+				rowMask = maskStripe ? ColumnarReadStripeRowMask(scan->rs_rd,
+																 maskStripe,
+																 SnapshotSelf)
+						  : NULL;
+			}
+
+			tupleIsAlive = rowMask == NULL ||
+						   !COLUMNAR_ROW_MASK_IS_SET(rowMask,
+													 rowNumber -
+													 maskStripe->firstRowNumber);
+		}
+
 		indexCallback(indexRelation, &itemPointerData, indexValues, indexNulls,
 					  tupleIsAlive, indexCallbackState);
 
@@ -1939,18 +2870,227 @@ columnar_estimate_rel_size(Relation rel, int32 *attr_widths,
 }
 
 
+/*
+ * columnar_scan_bitmap_next_block prepares to read the rows of given bitmap
+ * page. Since row numbers map to the TIDs in order, see row_number_to_tid,
+ * bitmap heap scans visit the rows in the order of their row numbers. This
+ * means that we read each stripe, and decompress each chunk group, at most
+ * once.
+ */
+static bool
+columnar_scan_bitmap_next_block(TableScanDesc sscan, TBMIterateResult *tbmres)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	scan->bitmapTupleIndex = 0;
+
+	return true;
+}
+
+
+/*
+ * columnar_scan_bitmap_next_tuple reads the next row of the current bitmap
+ * page into the slot. Returns false if there are no more rows to read in
+ * the page.
+ */
+static bool
+columnar_scan_bitmap_next_tuple(TableScanDesc sscan, TBMIterateResult *tbmres,
+								TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	if (scan->cs_readState == NULL)
+	{
+		bool randomAccess = true;
+		scan->cs_readState =
+			init_columnar_read_state(scan->cs_base.rs_rd, slot->tts_tupleDescriptor,
+									 scan->attr_needed, NIL, scan->scanContext,
+									 scan->cs_base.rs_snapshot, randomAccess, NULL);
+
+		/* the bitmap might point to the rows that we didn't flush yet */
+		ColumnarReadFlushPendingWrites(scan->cs_readState);
+	}
+
+	/* lossy pages don't tell which rows of the page are in the bitmap */
+	bool lossyPage = tbmres->ntuples < 0;
+	int tupleCount = lossyPage ? VALID_ITEMPOINTER_OFFSETS : tbmres->ntuples;
+
+	while (scan->bitmapTupleIndex < tupleCount)
+	{
+		OffsetNumber offset = lossyPage ? FirstOffsetNumber + scan->bitmapTupleIndex :
+							  tbmres->offsets[scan->bitmapTupleIndex];
+		scan->bitmapTupleIndex++;
+
+		uint64 rowNumber = (uint64) tbmres->blockno * VALID_ITEMPOINTER_OFFSETS +
+						   offset - FirstOffsetNumber;
+		if (rowNumber == COLUMNAR_INVALID_ROW_NUMBER ||
+			rowNumber > COLUMNAR_MAX_ROW_NUMBER)
+		{
+			continue;
+		}
+
+		ExecClearTuple(slot);
+
+		if (ColumnarReadRowByRowNumber(scan->cs_readState, rowNumber,
+									   slot->tts_values, slot->tts_isnull))
+		{
+			ExecStoreVirtualTuple(slot);
+			slot->tts_tid = row_number_to_tid(rowNumber);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * columnar_scan_sample_next_block chooses the next block of the sample scan
+ * to read the rows from.
+ *
+ * To let the sampling methods that sample whole blocks, like SYSTEM, avoid
+ * decompressing most of the table, the blocks that we let them choose from
+ * are the chunk groups of the table rather than the TID blocks. The methods
+ * that sample individual rows, like BERNOULLI, then visit all the chunk
+ * groups, see columnar_scan_sample_next_tuple.
+ */
 static bool
-columnar_scan_sample_next_block(TableScanDesc scan, SampleScanState *scanstate)
+columnar_scan_sample_next_block(TableScanDesc sscan, SampleScanState *scanstate)
 {
-	elog(ERROR, "columnar_scan_sample_next_block not implemented");
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	TsmRoutine *tsm = scanstate->tsmroutine;
+
+	ColumnarSampleBeginRead(scan);
+
+	BlockNumber chunkGroupCount = (BlockNumber) Min(scan->sampleChunkGroupCount,
+													MaxBlockNumber);
+	BlockNumber chunkGroupIndex = InvalidBlockNumber;
+	if (tsm->NextSampleBlock)
+	{
+		chunkGroupIndex = tsm->NextSampleBlock(scanstate, chunkGroupCount);
+	}
+	else if (scan->sampleBlock == InvalidBlockNumber)
+	{
+		chunkGroupIndex = chunkGroupCount > 0 ? 0 : InvalidBlockNumber;
+	}
+	else if (scan->sampleBlock + 1 < chunkGroupCount)
+	{
+		chunkGroupIndex = scan->sampleBlock + 1;
+	}
+
+	scan->sampleBlock = chunkGroupIndex;
+
+	if (!BlockNumberIsValid(chunkGroupIndex))
+	{
+		return false;
+	}
+
+	/* sampling methods visit the chunk groups in order, so search forward */
+	uint32 stripeIndex = scan->sampleStripeIndex;
+	if (chunkGroupIndex < scan->sampleStripes[stripeIndex].precedingChunkGroupCount)
+	{
+		stripeIndex = 0;
+	}
+
+	ColumnarSampleStripe *sampleStripe = NULL;
+	while (true)
+	{
+		sampleStripe = &scan->sampleStripes[stripeIndex];
+		if (stripeIndex + 1 == scan->sampleStripeCount ||
+			scan->sampleStripes[stripeIndex + 1].precedingChunkGroupCount >
+			chunkGroupIndex)
+		{
+			break;
+		}
+
+		stripeIndex++;
+	}
+
+	uint64 chunkIndex = chunkGroupIndex - sampleStripe->precedingChunkGroupCount;
+	uint64 chunkFirstRowOffset = chunkIndex * sampleStripe->chunkGroupRowCount;
+	uint64 chunkRowCount = Min(sampleStripe->chunkGroupRowCount,
+							   sampleStripe->rowCount - chunkFirstRowOffset);
+	uint64 rowIndex = sampleStripe->precedingRowCount + chunkFirstRowOffset;
+
+	ColumnarSampleSetRowRange(scan, rowIndex, rowIndex + chunkRowCount);
+
+	uint64 firstRowNumber = sampleStripe->firstRowNumber + chunkFirstRowOffset;
+	scan->sampleTidBlock = firstRowNumber / VALID_ITEMPOINTER_OFFSETS;
+
+	return true;
 }
 
 
+/*
+ * columnar_scan_sample_next_tuple reads the next row of the current chunk
+ * group that the sampling method chooses into the slot.
+ *
+ * We ask the sampling method for the rows of each TID block that the chunk
+ * group overlaps, so the methods that sample individual rows make the same
+ * decision for a row regardless of the chunk group that it belongs to.
+ */
 static bool
-columnar_scan_sample_next_tuple(TableScanDesc scan, SampleScanState *scanstate,
+columnar_scan_sample_next_tuple(TableScanDesc sscan, SampleScanState *scanstate,
 								TupleTableSlot *slot)
 {
-	elog(ERROR, "columnar_scan_sample_next_tuple not implemented");
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	TsmRoutine *tsm = scanstate->tsmroutine;
+
+	/*
+	 * The chunk group being read is in a single stripe. Note that we keep
+	 * asking for the rows of the TID blocks of the chunk group even after
+	 * reading its last row, until the sampling method tells there are no
+	 * more, since it expects to be asked for the rows of each block until
+	 * then.
+	 */
+	ColumnarSampleStripe *sampleStripe = &scan->sampleStripes[scan->sampleStripeIndex];
+	uint64 nextRowNumber = sampleStripe->firstRowNumber +
+						   (scan->sampleRowIndex - sampleStripe->precedingRowCount);
+	uint64 endRowNumber = sampleStripe->firstRowNumber +
+						  (scan->sampleEndRowIndex - sampleStripe->precedingRowCount);
+
+	while (true)
+	{
+		BlockNumber tidBlock = scan->sampleTidBlock;
+		uint64 blockFirstRowNumber = (uint64) tidBlock * VALID_ITEMPOINTER_OFFSETS;
+		if (blockFirstRowNumber >= endRowNumber)
+		{
+			scan->sampleRowIndex = scan->sampleEndRowIndex;
+			return false;
+		}
+
+		uint64 blockRowCount = Min(endRowNumber - blockFirstRowNumber,
+								   VALID_ITEMPOINTER_OFFSETS);
+		OffsetNumber maxOffset = (OffsetNumber) (blockRowCount + FirstOffsetNumber - 1);
+
+		OffsetNumber offset = tsm->NextSampleTuple(scanstate, tidBlock, maxOffset);
+		if (!OffsetNumberIsValid(offset))
+		{
+			scan->sampleTidBlock++;
+			continue;
+		}
+
+		uint64 rowNumber = blockFirstRowNumber + offset - FirstOffsetNumber;
+		if (rowNumber < nextRowNumber)
+		{
+			/* belongs to the previous chunk group, or was read already */
+			continue;
+		}
+
+		scan->sampleRowIndex += rowNumber - nextRowNumber + 1;
+		nextRowNumber = rowNumber + 1;
+
+		ExecClearTuple(slot);
+
+		if (ColumnarReadRowByRowNumber(scan->cs_readState, rowNumber,
+									   slot->tts_values, slot->tts_isnull))
+		{
+			ExecStoreVirtualTuple(slot);
+			slot->tts_tid = row_number_to_tid(rowNumber);
+
+			return true;
+		}
+	}
 }
 
 
@@ -2063,6 +3203,25 @@ ColumnarScanChunkGroupsFiltered(ColumnarScanDesc columnarScanDesc)
 }
 
 
+/*
+ * ColumnarScanGetScanStats returns the counters of the given scan, or NULL
+ * if it didn't start reading yet.
+ */
+ColumnarScanStats *
+ColumnarScanGetScanStats(ColumnarScanDesc columnarScanDesc)
+{
+	ColumnarReadState *readState = columnarScanDesc->cs_readState;
+
+	/* readState is initialized lazily */
+	if (readState == NULL)
+	{
+		return NULL;
+	}
+
+	return ColumnarReadScanStats(readState);
+}
+
+
 /*
  * Implementation of TupleTableSlotOps.copy_heap_tuple for TTSOpsColumnar.
  */
@@ -2109,6 +3268,7 @@ ColumnarTableDropHook(Oid relid)
 
 		DeleteMetadataRows(relfilelocator);
 		DeleteColumnarTableOptions(rel->rd_id, true);
+		ColumnarScanStatsRemove(rel->rd_id);
 
 		MarkRelfilenumberDropped(RelationPhysicalIdentifierNumber_compat(relfilelocator),
 								 GetCurrentSubTransactionId());
@@ -2193,9 +3353,14 @@ ColumnarTableAMObjectAccessHook(ObjectAccessType access, Oid classId, Oid object
 /*
  * ColumnarProcessAlterTable - if modifying a columnar table, extract columnar
  * options and return the table's RangeVar.
+ *
+ * Columnar options of ALTER COLUMN ... SET / RESET commands are appended to
+ * columnarColumnOptions as DefElem's, where defname is the column name and arg
+ * is the list of options.
  */
 static RangeVar *
-ColumnarProcessAlterTable(AlterTableStmt *alterTableStmt, List **columnarOptions)
+ColumnarProcessAlterTable(AlterTableStmt *alterTableStmt, List **columnarOptions,
+						  List **columnarColumnOptions)
 {
 	RangeVar *columnarRangeVar = NULL;
 	Relation rel = relation_openrv_extended(alterTableStmt->relation, AccessShareLock,
@@ -2228,10 +3393,32 @@ ColumnarProcessAlterTable(AlterTableStmt *alterTableStmt, List **columnarOptions
 				columnarRangeVar = alterTableStmt->relation;
 			}
 		}
+		else if (alterTableCmd->subtype == AT_SetOptions ||
+				 alterTableCmd->subtype == AT_ResetOptions)
+		{
+			List *options = castNode(List, alterTableCmd->def);
+			List *columnOptions = NIL;
+
+			alterTableCmd->def = (Node *) ExtractColumnarColumnRelOptions(
+				options, &columnOptions);
+
+			if (columnOptions != NIL)
+			{
+				*columnarColumnOptions =
+					lappend(*columnarColumnOptions,
+							makeDefElem(pstrdup(alterTableCmd->name),
+										(Node *) columnOptions, -1));
+
+				if (destIsColumnar)
+				{
+					columnarRangeVar = alterTableStmt->relation;
+				}
+			}
+		}
 #if PG_VERSION_NUM >= PG_VERSION_15
 		else if (alterTableCmd->subtype == AT_SetAccessMethod)
 		{
-			if (columnarRangeVar || *columnarOptions)
+			if (columnarRangeVar || *columnarOptions || *columnarColumnOptions)
 			{
 				ereport(ERROR, (errmsg(
 									"ALTER TABLE cannot alter the access method after altering storage parameters"),
@@ -2277,6 +3464,7 @@ ColumnarProcessUtility(PlannedStmt *pstmt,
 
 	RangeVar *columnarRangeVar = NULL;
 	List *columnarOptions = NIL;
+	List *columnarColumnOptions = NIL;
 
 	switch (nodeTag(parsetree))
 	{
@@ -2362,7 +3550,8 @@ ColumnarProcessUtility(PlannedStmt *pstmt,
 		{
 			AlterTableStmt *alterTableStmt = castNode(AlterTableStmt, parsetree);
 			columnarRangeVar = ColumnarProcessAlterTable(alterTableStmt,
-														 &columnarOptions);
+														 &columnarOptions,
+														 &columnarColumnOptions);
 			break;
 		}
 
@@ -2372,7 +3561,8 @@ ColumnarProcessUtility(PlannedStmt *pstmt,
 			break;
 	}
 
-	if (columnarOptions != NIL && columnarRangeVar == NULL)
+	if ((columnarOptions != NIL || columnarColumnOptions != NIL) &&
+		columnarRangeVar == NULL)
 	{
 		ereport(ERROR,
 				(errmsg("columnar storage parameters specified on non-columnar table")));
@@ -2395,6 +3585,13 @@ ColumnarProcessUtility(PlannedStmt *pstmt,
 	{
 		SetColumnarRelOptions(columnarRangeVar, columnarOptions);
 	}
+
+	DefElem *columnOptionsElem = NULL;
+	foreach_ptr(columnOptionsElem, columnarColumnOptions)
+	{
+		SetColumnarColumnRelOptions(columnarRangeVar, columnOptionsElem->defname,
+									(List *) columnOptionsElem->arg);
+	}
 }
 
 
@@ -2547,8 +3744,8 @@ static const TableAmRoutine columnar_am_methods = {
 
 	.relation_estimate_size = columnar_estimate_rel_size,
 
-	.scan_bitmap_next_block = NULL,
-	.scan_bitmap_next_tuple = NULL,
+	.scan_bitmap_next_block = columnar_scan_bitmap_next_block,
+	.scan_bitmap_next_tuple = columnar_scan_bitmap_next_tuple,
 	.scan_sample_next_block = columnar_scan_sample_next_block,
 	.scan_sample_next_tuple = columnar_scan_sample_next_tuple
 };
@@ -2621,9 +3818,9 @@ detoast_values(TupleDesc tupleDesc, Datum *orig_values, bool *isnull)
  * identity).
  */
 static void
-ColumnarCheckLogicalReplication(Relation rel)
+ColumnarCheckLogicalReplication(Relation rel, CmdType operation)
 {
-	bool pubActionInsert = false;
+	PublicationActions *pubActions = NULL;
 
 	if (!is_publishable_relation(rel))
 	{
@@ -2631,27 +3828,37 @@ ColumnarCheckLogicalReplication(Relation rel)
 	}
 
 #if PG_VERSION_NUM >= PG_VERSION_15
-	{
-		PublicationDesc pubdesc;
+	PublicationDesc pubdesc;
 
-		RelationBuildPublicationDesc(rel, &pubdesc);
-		pubActionInsert = pubdesc.pubactions.pubinsert;
-	}
+	RelationBuildPublicationDesc(rel, &pubdesc);
+	pubActions = &pubdesc.pubactions;
 #else
 	if (rel->rd_pubactions == NULL)
 	{
 		GetRelationPublicationActions(rel);
 		Assert(rel->rd_pubactions != NULL);
 	}
-	pubActionInsert = rel->rd_pubactions->pubinsert;
+	pubActions = rel->rd_pubactions;
 #endif
 
-	if (pubActionInsert)
+	if (operation == CMD_INSERT && pubActions->pubinsert)
 	{
 		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 						errmsg(
 							"cannot insert into columnar table that is a part of a publication")));
 	}
+	else if (operation == CMD_UPDATE && pubActions->pubupdate)
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg(
+							"cannot update columnar table that is a part of a publication")));
+	}
+	else if (operation == CMD_DELETE && pubActions->pubdelete)
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg(
+							"cannot delete from columnar table that is a part of a publication")));
+	}
 }
 
 
@@ -2761,6 +3968,146 @@ downgrade_columnar_storage(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * columnar_compact_stripes merges the adjacent small stripes of a columnar
+ * table into full-size stripes and returns the number of stripes that were
+ * merged.
+ *
+ * DDL:
+ *   CREATE FUNCTION columnar.compact_stripes(table_name regclass)
+ *     RETURNS bigint
+ *     STRICT
+ *     LANGUAGE c AS 'MODULE_PATHNAME', 'columnar_compact_stripes';
+ */
+PG_FUNCTION_INFO_V1(columnar_compact_stripes);
+Datum
+columnar_compact_stripes(PG_FUNCTION_ARGS)
+{
+	Oid relationId = PG_GETARG_OID(0);
+
+	CheckCitusColumnarVersion(ERROR);
+
+	/* same lock as VACUUM, which doesn't block the readers and the writers */
+	Relation rel = table_open(relationId, ShareUpdateExclusiveLock);
+
+	if (!object_ownercheck(RelationRelationId, relationId, GetUserId()))
+	{
+		aclcheck_error(ACLCHECK_NOT_OWNER, OBJECT_TABLE,
+					   RelationGetRelationName(rel));
+	}
+
+	if (!IsColumnarTableAmTable(relationId))
+	{
+		ereport(ERROR, (errmsg("table %s is not a columnar table",
+							   quote_identifier(RelationGetRelationName(rel)))));
+	}
+
+	if (RELATION_IS_OTHER_TEMP(rel))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot compact temporary tables of other sessions")));
+	}
+
+	if (RelationGetIndexList(rel) != NIL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot compact stripes of columnar table %s since "
+							   "it has indexes",
+							   quote_identifier(RelationGetRelationName(rel))),
+						errdetail("Merging stripes changes the row numbers that "
+								  "the indexes point to."),
+						errhint("Use VACUUM FULL to rewrite the table.")));
+	}
+
+	uint64 mergedStripeCount = MergeSmallColumnarStripes(rel, DEBUG1);
+
+	table_close(rel, NoLock);
+
+	PG_RETURN_INT64(mergedStripeCount);
+}
+
+
+/*
+ * ColumnarTableRelationIdList returns the ids of the columnar tables in the
+ * current database, except for the temporary ones. It returns NIL if the
+ * columnar access method doesn't exist in the database.
+ */
+List *
+ColumnarTableRelationIdList(void)
+{
+	List *relationIdList = NIL;
+
+	Oid columnarAmId = get_table_am_oid(COLUMNAR_AM_NAME, true);
+	if (!OidIsValid(columnarAmId))
+	{
+		return NIL;
+	}
+
+	ScanKeyData scanKey[1];
+	ScanKeyInit(&scanKey[0], Anum_pg_class_relam, BTEqualStrategyNumber,
+				F_OIDEQ, ObjectIdGetDatum(columnarAmId));
+
+	Relation pgClass = table_open(RelationRelationId, AccessShareLock);
+	SysScanDesc scanDescriptor = systable_beginscan(pgClass, InvalidOid, false,
+													NULL, 1, scanKey);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		Form_pg_class classForm = (Form_pg_class) GETSTRUCT(heapTuple);
+		if (classForm->relpersistence == RELPERSISTENCE_TEMP)
+		{
+			continue;
+		}
+
+		relationIdList = lappend_oid(relationIdList, classForm->oid);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgClass, AccessShareLock);
+
+	return relationIdList;
+}
+
+
+/*
+ * ColumnarCompactSmallStripes merges the adjacent small stripes of the
+ * columnar table with given id, like columnar.compact_stripes(), and returns
+ * the number of stripes that were merged. It is meant to be run in the
+ * background, so it skips the table if it cannot lock the table without
+ * waiting, or if the table has indexes.
+ */
+uint64
+ColumnarCompactSmallStripes(Oid relationId)
+{
+	if (!CheckCitusColumnarVersion(DEBUG1) ||
+		!ConditionalLockRelationOid(relationId, ShareUpdateExclusiveLock))
+	{
+		return 0;
+	}
+
+	Relation rel = try_relation_open(relationId, NoLock);
+	if (rel == NULL)
+	{
+		/* the table was dropped before we locked it */
+		UnlockRelationOid(relationId, ShareUpdateExclusiveLock);
+		return 0;
+	}
+
+	uint64 mergedStripeCount = 0;
+	if (rel->rd_tableam == GetColumnarTableAmRoutine() &&
+		!RELATION_IS_OTHER_TEMP(rel) &&
+		RelationGetIndexList(rel) == NIL)
+	{
+		mergedStripeCount = MergeSmallColumnarStripes(rel, DEBUG1);
+	}
+
+	relation_close(rel, NoLock);
+
+	return mergedStripeCount;
+}
+
+
 /*
  * Code to check the Citus Version, helps remove dependency from Citus
  */
@@ -0,0 +1,747 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_transfer.c
+ *
+ * This file contains the functions to copy the stripes of a columnar table
+ * into another columnar table as they are stored, without decompressing and
+ * compressing their data again. They are used to copy and move the shards of
+ * columnar tables between the nodes.
+ *
+ * ColumnarExportStripes serializes each stripe of a table into a buffer that
+ * has the metadata of the stripe, its chunk groups and chunks, the bitmap of
+ * its deleted rows and finally the data of the stripe as it's stored, and
+ * columnar_internal.import_stripe() appends such a stripe to another table
+ * that has the same columns.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/objectaddress.h"
+#include "catalog/pg_type.h"
+#include "libpq/pqformat.h"
+#include "mb/pg_wchar.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/tuplestore.h"
+
+#include "pg_version_compat.h"
+
+#include "columnar/columnar.h"
+#include "columnar/columnar_storage.h"
+
+/* version of the format of the serialized stripes */
+#define COLUMNAR_STRIPE_TRANSFER_VERSION 1
+
+/*
+ * Serialized stripes are sent as bytea values, so we leave some room for
+ * the metadata of the stripe within the maximum size of a bytea.
+ */
+#define COLUMNAR_STRIPE_TRANSFER_MAX_DATA_LENGTH (MaxAllocSize / 2)
+
+/* state of columnar_export_stripes, which returns the stripes in a tuplestore */
+typedef struct ExportStripesState
+{
+	Tuplestorestate *tupleStore;
+	TupleDesc tupleDescriptor;
+} ExportStripesState;
+
+static const char * StripeTransferUnsupportedReason(Relation relation,
+													Snapshot snapshot);
+static bool TypeSupportsStripeTransfer(Oid typeId);
+static void SerializeStripe(Relation relation, StripeMetadata *stripeMetadata,
+							Snapshot snapshot, StringInfo stripeBuffer);
+static void SerializeChunkSkipNode(ColumnChunkSkipNode *chunkSkipNode,
+								   Form_pg_attribute attributeForm,
+								   StringInfo stripeBuffer);
+static void SerializeBytea(bytea *value, StringInfo stripeBuffer);
+static void DeserializeChunkSkipNode(StringInfo stripeBuffer,
+									 ColumnChunkSkipNode *chunkSkipNode,
+									 Form_pg_attribute attributeForm,
+									 uint64 dataLength);
+static bytea * DeserializeBytea(StringInfo stripeBuffer);
+static void ExportStripeIntoTuplestore(StringInfo stripeBuffer, void *callbackState);
+
+PG_FUNCTION_INFO_V1(columnar_export_stripes);
+PG_FUNCTION_INFO_V1(columnar_import_stripe);
+
+
+/*
+ * ColumnarStripeTransferSupported returns true if the stripes of the columnar
+ * table with given id can be exported by ColumnarExportStripes.
+ */
+bool
+ColumnarStripeTransferSupported(Oid relationId)
+{
+	Relation relation = table_open(relationId, AccessShareLock);
+
+	bool supported = IsColumnarTableAmTable(relationId) &&
+					 StripeTransferUnsupportedReason(relation,
+													 GetActiveSnapshot()) == NULL;
+
+	table_close(relation, AccessShareLock);
+
+	return supported;
+}
+
+
+/*
+ * StripeTransferUnsupportedReason returns the reason why the stripes of given
+ * columnar table cannot be copied into another table as they are stored, or
+ * NULL if they can.
+ */
+static const char *
+StripeTransferUnsupportedReason(Relation relation, Snapshot snapshot)
+{
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+
+	for (int columnIndex = 0; columnIndex < tupleDescriptor->natts; columnIndex++)
+	{
+		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+
+		/* the target table doesn't have the dropped columns */
+		if (attributeForm->attisdropped)
+		{
+			return "The table has dropped columns.";
+		}
+
+		if (!TypeSupportsStripeTransfer(attributeForm->atttypid))
+		{
+			return psprintf("The values of column %s may refer to the objects of "
+							"the database by their ids.",
+							quote_identifier(NameStr(attributeForm->attname)));
+		}
+	}
+
+	uint64 lastRowNumber = COLUMNAR_INVALID_ROW_NUMBER;
+	StripeMetadata *stripeMetadata = NULL;
+	while ((stripeMetadata = FindNextStripeByRowNumber(relation, lastRowNumber,
+													   snapshot)) != NULL)
+	{
+		lastRowNumber = stripeMetadata->rowCount == 0 ?
+						stripeMetadata->firstRowNumber :
+						StripeGetHighestRowNumber(stripeMetadata);
+
+		if (StripeWriteState(stripeMetadata) != STRIPE_WRITE_FLUSHED)
+		{
+			continue;
+		}
+
+		/* stripes that were written before ALTER TABLE ... ADD COLUMN */
+		if (stripeMetadata->columnCount != (uint32) tupleDescriptor->natts)
+		{
+			return "Some stripes were written before columns were added to the table.";
+		}
+
+		if (stripeMetadata->dataLength > COLUMNAR_STRIPE_TRANSFER_MAX_DATA_LENGTH)
+		{
+			return "Some stripes are too large.";
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * TypeSupportsStripeTransfer returns true if the stored values of given type
+ * mean the same thing in all the databases, which is true for the built-in
+ * types except for the ones that store the ids of other objects. Values of
+ * user-defined types, such as enums, can be different in each database.
+ */
+static bool
+TypeSupportsStripeTransfer(Oid typeId)
+{
+	Oid elementTypeId = get_element_type(typeId);
+	if (OidIsValid(elementTypeId))
+	{
+		typeId = elementTypeId;
+	}
+
+	if (typeId >= FirstGenbkiObjectId)
+	{
+		return false;
+	}
+
+	switch (typeId)
+	{
+		case REGPROCOID:
+		case REGPROCEDUREOID:
+		case REGOPEROID:
+		case REGOPERATOROID:
+		case REGCLASSOID:
+		case REGCOLLATIONOID:
+		case REGTYPEOID:
+		case REGROLEOID:
+		case REGNAMESPACEOID:
+		case REGCONFIGOID:
+		case REGDICTIONARYOID:
+		case ACLITEMOID:
+		{
+			return false;
+		}
+
+		default:
+		{
+			return true;
+		}
+	}
+}
+
+
+/*
+ * ColumnarExportStripes serializes the stripes of the columnar table with
+ * given id that the active snapshot sees, in the order of their row numbers,
+ * and calls the callback for each of them. The buffer that is passed to the
+ * callback is reset after the callback returns. Returns the number of
+ * exported stripes.
+ */
+uint64
+ColumnarExportStripes(Oid relationId, ColumnarStripeExportCallback callback,
+					  void *callbackState)
+{
+	Relation relation = table_open(relationId, AccessShareLock);
+
+	AclResult aclResult = pg_class_aclcheck(relationId, GetUserId(), ACL_SELECT);
+	if (aclResult != ACLCHECK_OK)
+	{
+		aclcheck_error(aclResult, get_relkind_objtype(relation->rd_rel->relkind),
+					   RelationGetRelationName(relation));
+	}
+
+	if (!IsColumnarTableAmTable(relationId))
+	{
+		ereport(ERROR, (errmsg("table %s is not a columnar table",
+							   quote_identifier(RelationGetRelationName(relation)))));
+	}
+
+	/*
+	 * Flush the pending writes of the current transaction, and make them
+	 * visible to our snapshot as ColumnarReadFlushPendingWrites does.
+	 */
+	RelFileNumber relfilenumber = RelationPhysicalIdentifierNumber_compat(
+		RelationPhysicalIdentifier_compat(relation));
+	FlushWriteStateForRelfilenumber(relfilenumber, GetCurrentSubTransactionId());
+
+	PushCopiedSnapshot(GetActiveSnapshot());
+	UpdateActiveSnapshotCommandId();
+	Snapshot snapshot = RegisterSnapshot(GetActiveSnapshot());
+	PopActiveSnapshot();
+
+	const char *unsupportedReason = StripeTransferUnsupportedReason(relation, snapshot);
+	if (unsupportedReason != NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot export the stripes of columnar table %s",
+							   quote_identifier(RelationGetRelationName(relation))),
+						errdetail_internal("%s", unsupportedReason)));
+	}
+
+	MemoryContext stripeContext = AllocSetContextCreate(CurrentMemoryContext,
+														"Columnar Stripe Export",
+														ALLOCSET_DEFAULT_SIZES);
+	MemoryContext oldContext = MemoryContextSwitchTo(stripeContext);
+
+	uint64 exportedStripeCount = 0;
+	uint64 lastRowNumber = COLUMNAR_INVALID_ROW_NUMBER;
+	StripeMetadata *stripeMetadata = NULL;
+	while ((stripeMetadata = FindNextStripeByRowNumber(relation, lastRowNumber,
+													   snapshot)) != NULL)
+	{
+		if (StripeWriteState(stripeMetadata) != STRIPE_WRITE_FLUSHED ||
+			stripeMetadata->rowCount == 0)
+		{
+			lastRowNumber = stripeMetadata->firstRowNumber;
+			continue;
+		}
+
+		lastRowNumber = StripeGetHighestRowNumber(stripeMetadata);
+
+		StringInfo stripeBuffer = makeStringInfo();
+		SerializeStripe(relation, stripeMetadata, snapshot, stripeBuffer);
+
+		callback(stripeBuffer, callbackState);
+		exportedStripeCount++;
+
+		MemoryContextReset(stripeContext);
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	MemoryContextDelete(stripeContext);
+
+	UnregisterSnapshot(snapshot);
+	table_close(relation, AccessShareLock);
+
+	return exportedStripeCount;
+}
+
+
+/*
+ * SerializeStripe appends the metadata and the data of given stripe to
+ * stripeBuffer in the format that columnar_import_stripe reads.
+ */
+static void
+SerializeStripe(Relation relation, StripeMetadata *stripeMetadata, Snapshot snapshot,
+				StringInfo stripeBuffer)
+{
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+	uint32 columnCount = stripeMetadata->columnCount;
+	uint32 chunkCount = stripeMetadata->chunkCount;
+
+	StripeSkipList *stripeSkipList =
+		ReadStripeSkipList(RelationPhysicalIdentifier_compat(relation),
+						   stripeMetadata->id, tupleDescriptor, chunkCount, snapshot);
+
+	pq_sendint32(stripeBuffer, COLUMNAR_STRIPE_TRANSFER_VERSION);
+	pq_sendint32(stripeBuffer, GetDatabaseEncoding());
+
+	pq_sendint32(stripeBuffer, columnCount);
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		pq_sendint32(stripeBuffer, TupleDescAttr(tupleDescriptor, columnIndex)->atttypid);
+	}
+
+	pq_sendint32(stripeBuffer, chunkCount);
+	pq_sendint32(stripeBuffer, stripeMetadata->chunkGroupRowCount);
+	pq_sendint64(stripeBuffer, stripeMetadata->rowCount);
+	pq_sendint64(stripeBuffer, stripeMetadata->dataLength);
+
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+	{
+		pq_sendint32(stripeBuffer, stripeSkipList->chunkGroupRowCounts[chunkIndex]);
+	}
+
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+
+		for (uint32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+		{
+			SerializeChunkSkipNode(
+				&stripeSkipList->chunkSkipNodeArray[columnIndex][chunkIndex],
+				attributeForm, stripeBuffer);
+		}
+	}
+
+	uint8 *deletedRowMask = ColumnarReadStripeRowMask(relation, stripeMetadata,
+													   snapshot);
+	if (deletedRowMask != NULL)
+	{
+		pq_sendbyte(stripeBuffer, true);
+		pq_sendbytes(stripeBuffer, (const char *) deletedRowMask,
+					 COLUMNAR_ROW_MASK_SIZE(stripeMetadata->rowCount));
+	}
+	else
+	{
+		pq_sendbyte(stripeBuffer, false);
+	}
+
+	/* finally, the data of the stripe as it's stored */
+	enlargeStringInfo(stripeBuffer, stripeMetadata->dataLength);
+	ColumnarStorageRead(relation, stripeMetadata->fileOffset,
+						stripeBuffer->data + stripeBuffer->len,
+						stripeMetadata->dataLength);
+	stripeBuffer->len += stripeMetadata->dataLength;
+	stripeBuffer->data[stripeBuffer->len] = '\0';
+}
+
+
+/*
+ * SerializeChunkSkipNode appends the metadata of given chunk to stripeBuffer.
+ */
+static void
+SerializeChunkSkipNode(ColumnChunkSkipNode *chunkSkipNode,
+					   Form_pg_attribute attributeForm, StringInfo stripeBuffer)
+{
+	pq_sendint64(stripeBuffer, chunkSkipNode->rowCount);
+	pq_sendint64(stripeBuffer, chunkSkipNode->valueChunkOffset);
+	pq_sendint64(stripeBuffer, chunkSkipNode->valueLength);
+	pq_sendint64(stripeBuffer, chunkSkipNode->existsChunkOffset);
+	pq_sendint64(stripeBuffer, chunkSkipNode->existsLength);
+	pq_sendint64(stripeBuffer, chunkSkipNode->decompressedValueSize);
+	pq_sendint32(stripeBuffer, chunkSkipNode->valueCompressionType);
+	pq_sendint32(stripeBuffer, chunkSkipNode->valueCompressionLevel);
+	pq_sendint32(stripeBuffer, chunkSkipNode->valueEncodingType);
+
+	pq_sendbyte(stripeBuffer, chunkSkipNode->hasMinMax);
+	if (chunkSkipNode->hasMinMax)
+	{
+		SerializeBytea(DatumToBytea(chunkSkipNode->minimumValue, attributeForm),
+					   stripeBuffer);
+		SerializeBytea(DatumToBytea(chunkSkipNode->maximumValue, attributeForm),
+					   stripeBuffer);
+	}
+
+	SerializeBytea(chunkSkipNode->bloomFilter, stripeBuffer);
+}
+
+
+/*
+ * SerializeBytea appends the length and the contents of given value to
+ * stripeBuffer, or -1 if the value is NULL.
+ */
+static void
+SerializeBytea(bytea *value, StringInfo stripeBuffer)
+{
+	if (value == NULL)
+	{
+		pq_sendint32(stripeBuffer, -1);
+		return;
+	}
+
+	pq_sendint32(stripeBuffer, VARSIZE_ANY_EXHDR(value));
+	pq_sendbytes(stripeBuffer, VARDATA_ANY(value), VARSIZE_ANY_EXHDR(value));
+}
+
+
+/*
+ * columnar_export_stripes returns the stripes of a columnar table serialized
+ * by ColumnarExportStripes, which columnar_internal.import_stripe() can
+ * append to another table.
+ */
+Datum
+columnar_export_stripes(PG_FUNCTION_ARGS)
+{
+	Oid relationId = PG_GETARG_OID(0);
+	ReturnSetInfo *resultInfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+	if (resultInfo == NULL || !IsA(resultInfo, ReturnSetInfo) ||
+		!(resultInfo->allowedModes & SFRM_Materialize))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("set-valued function called in context that cannot "
+							   "accept a set")));
+	}
+
+	MemoryContext oldContext =
+		MemoryContextSwitchTo(resultInfo->econtext->ecxt_per_query_memory);
+
+	TupleDesc tupleDescriptor = CreateTemplateTupleDesc(1);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 1, "stripe", BYTEAOID, -1, 0);
+
+	Tuplestorestate *tupleStore = tuplestore_begin_heap(true, false, work_mem);
+	resultInfo->returnMode = SFRM_Materialize;
+	resultInfo->setResult = tupleStore;
+	resultInfo->setDesc = tupleDescriptor;
+
+	MemoryContextSwitchTo(oldContext);
+
+	ExportStripesState exportState = {
+		.tupleStore = tupleStore,
+		.tupleDescriptor = tupleDescriptor
+	};
+	ColumnarExportStripes(relationId, ExportStripeIntoTuplestore, &exportState);
+
+	PG_RETURN_NULL();
+}
+
+
+/*
+ * ExportStripeIntoTuplestore is the ColumnarStripeExportCallback of
+ * columnar_export_stripes, which adds the stripe to the result.
+ */
+static void
+ExportStripeIntoTuplestore(StringInfo stripeBuffer, void *callbackState)
+{
+	ExportStripesState *exportState = (ExportStripesState *) callbackState;
+
+	bytea *stripeBytes = palloc(stripeBuffer->len + VARHDRSZ);
+	SET_VARSIZE(stripeBytes, stripeBuffer->len + VARHDRSZ);
+
+	/* stripes can be larger than RSIZE_MAX, so we use memcpy */
+	memcpy(VARDATA(stripeBytes), stripeBuffer->data, stripeBuffer->len); /* IGNORE-BANNED */
+
+	bool nulls[1] = { false };
+	Datum values[1] = { PointerGetDatum(stripeBytes) };
+
+	tuplestore_putvalues(exportState->tupleStore, exportState->tupleDescriptor,
+						 values, nulls);
+}
+
+
+/*
+ * columnar_import_stripe appends a stripe that was serialized by
+ * ColumnarExportStripes to given columnar table, and returns the number of
+ * rows in the stripe. The table must have the same columns as the exported
+ * table, and cannot have indexes since we don't build the index entries of
+ * the imported rows.
+ */
+Datum
+columnar_import_stripe(PG_FUNCTION_ARGS)
+{
+	Oid relationId = PG_GETARG_OID(0);
+	bytea *stripeBytes = PG_GETARG_BYTEA_PP(1);
+
+	Relation relation = table_open(relationId, RowExclusiveLock);
+
+	AclResult aclResult = pg_class_aclcheck(relationId, GetUserId(), ACL_INSERT);
+	if (aclResult != ACLCHECK_OK)
+	{
+		aclcheck_error(aclResult, get_relkind_objtype(relation->rd_rel->relkind),
+					   RelationGetRelationName(relation));
+	}
+
+	if (!IsColumnarTableAmTable(relationId))
+	{
+		ereport(ERROR, (errmsg("table %s is not a columnar table",
+							   quote_identifier(RelationGetRelationName(relation)))));
+	}
+
+	if (RelationGetIndexList(relation) != NIL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot import stripes into columnar table %s since "
+							   "it has indexes",
+							   quote_identifier(RelationGetRelationName(relation)))));
+	}
+
+	StringInfoData stripeBuffer;
+	stripeBuffer.data = VARDATA_ANY(stripeBytes);
+	stripeBuffer.len = VARSIZE_ANY_EXHDR(stripeBytes);
+	stripeBuffer.maxlen = stripeBuffer.len;
+	stripeBuffer.cursor = 0;
+
+	uint32 version = pq_getmsgint(&stripeBuffer, 4);
+	if (version != COLUMNAR_STRIPE_TRANSFER_VERSION)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+						errmsg("unsupported columnar stripe format version %u",
+							   version)));
+	}
+
+	int encoding = pq_getmsgint(&stripeBuffer, 4);
+	if (encoding != GetDatabaseEncoding())
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot import a columnar stripe that was exported "
+							   "from a database with encoding \"%s\"",
+							   pg_encoding_to_char(encoding))));
+	}
+
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+	uint32 columnCount = pq_getmsgint(&stripeBuffer, 4);
+	if (columnCount != (uint32) tupleDescriptor->natts)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DATATYPE_MISMATCH),
+						errmsg("columnar stripe has %u columns, but table %s has %d",
+							   columnCount,
+							   quote_identifier(RelationGetRelationName(relation)),
+							   tupleDescriptor->natts)));
+	}
+
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+		Oid typeId = pq_getmsgint(&stripeBuffer, 4);
+
+		if (attributeForm->attisdropped || attributeForm->atttypid != typeId)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DATATYPE_MISMATCH),
+							errmsg("column %d of columnar stripe has type %s, which "
+								   "doesn't match the column of table %s",
+								   columnIndex + 1, format_type_be(typeId),
+								   quote_identifier(RelationGetRelationName(relation)))));
+		}
+	}
+
+	uint32 chunkCount = pq_getmsgint(&stripeBuffer, 4);
+	uint32 chunkGroupRowCount = pq_getmsgint(&stripeBuffer, 4);
+	uint64 rowCount = pq_getmsgint64(&stripeBuffer);
+	uint64 dataLength = pq_getmsgint64(&stripeBuffer);
+
+	if (chunkGroupRowCount == 0 || chunkGroupRowCount > CHUNK_ROW_COUNT_MAXIMUM ||
+		rowCount > STRIPE_ROW_COUNT_MAXIMUM ||
+		dataLength > COLUMNAR_STRIPE_TRANSFER_MAX_DATA_LENGTH)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+						errmsg("invalid columnar stripe data"),
+						errdetail("Stripe has " UINT64_FORMAT " rows in chunk groups "
+								  "of %u rows, and " UINT64_FORMAT " bytes of data.",
+								  rowCount, chunkGroupRowCount, dataLength)));
+	}
+
+	List *chunkGroupRowCountList = NIL;
+	uint64 chunkGroupRowCountSum = 0;
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+	{
+		uint32 chunkRowCount = pq_getmsgint(&stripeBuffer, 4);
+		if (chunkRowCount == 0 || chunkRowCount > chunkGroupRowCount)
+		{
+			ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+							errmsg("invalid columnar stripe data"),
+							errdetail("Chunk group %u has %u rows.", chunkIndex,
+									  chunkRowCount)));
+		}
+
+		chunkGroupRowCountList = lappend_int(chunkGroupRowCountList, chunkRowCount);
+		chunkGroupRowCountSum += chunkRowCount;
+	}
+
+	if (rowCount == 0 || chunkGroupRowCountSum != rowCount)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+						errmsg("invalid columnar stripe data"),
+						errdetail("Stripe has " UINT64_FORMAT " rows, but its chunk "
+								  "groups have " UINT64_FORMAT " rows.",
+								  rowCount, chunkGroupRowCountSum)));
+	}
+
+	StripeSkipList *stripeSkipList = palloc0(sizeof(StripeSkipList));
+	stripeSkipList->columnCount = columnCount;
+	stripeSkipList->chunkCount = chunkCount;
+	stripeSkipList->chunkSkipNodeArray = palloc0(columnCount *
+												 sizeof(ColumnChunkSkipNode *));
+
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+
+		stripeSkipList->chunkSkipNodeArray[columnIndex] =
+			palloc0(chunkCount * sizeof(ColumnChunkSkipNode));
+
+		for (uint32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+		{
+			DeserializeChunkSkipNode(
+				&stripeBuffer,
+				&stripeSkipList->chunkSkipNodeArray[columnIndex][chunkIndex],
+				attributeForm, dataLength);
+		}
+	}
+
+	const uint8 *deletedRowMask = NULL;
+	if (pq_getmsgbyte(&stripeBuffer))
+	{
+		deletedRowMask = (const uint8 *) pq_getmsgbytes(&stripeBuffer,
+														COLUMNAR_ROW_MASK_SIZE(
+															rowCount));
+	}
+
+	const char *stripeData = pq_getmsgbytes(&stripeBuffer, dataLength);
+	pq_getmsgend(&stripeBuffer);
+
+	/* write the stripe as the writer would, see FlushStripe */
+	EmptyStripeReservation *stripeReservation =
+		ReserveEmptyStripe(relation, columnCount, chunkGroupRowCount, rowCount);
+	StripeMetadata *stripeMetadata =
+		CompleteStripeReservation(relation, stripeReservation->stripeId, dataLength,
+								  rowCount, chunkCount);
+
+	ColumnarStorageWrite(relation, stripeMetadata->fileOffset, (char *) stripeData,
+						 dataLength);
+
+	RelFileLocator relfilelocator = RelationPhysicalIdentifier_compat(relation);
+	SaveChunkGroups(relfilelocator, stripeMetadata->id, chunkGroupRowCountList);
+	SaveStripeSkipList(relfilelocator, stripeMetadata->id, stripeSkipList,
+					   tupleDescriptor);
+
+	if (deletedRowMask != NULL)
+	{
+		SaveStripeRowMask(ColumnarStorageGetStorageId(relation, false),
+						  stripeMetadata->id, rowCount, deletedRowMask);
+	}
+
+	table_close(relation, NoLock);
+
+	PG_RETURN_INT64(rowCount);
+}
+
+
+/*
+ * DeserializeChunkSkipNode reads the metadata of a chunk that was appended to
+ * stripeBuffer by SerializeChunkSkipNode into chunkSkipNode.
+ */
+static void
+DeserializeChunkSkipNode(StringInfo stripeBuffer, ColumnChunkSkipNode *chunkSkipNode,
+						 Form_pg_attribute attributeForm, uint64 dataLength)
+{
+	chunkSkipNode->rowCount = pq_getmsgint64(stripeBuffer);
+	chunkSkipNode->valueChunkOffset = pq_getmsgint64(stripeBuffer);
+	chunkSkipNode->valueLength = pq_getmsgint64(stripeBuffer);
+	chunkSkipNode->existsChunkOffset = pq_getmsgint64(stripeBuffer);
+	chunkSkipNode->existsLength = pq_getmsgint64(stripeBuffer);
+	chunkSkipNode->decompressedValueSize = pq_getmsgint64(stripeBuffer);
+	chunkSkipNode->valueCompressionType = (int32) pq_getmsgint(stripeBuffer, 4);
+	chunkSkipNode->valueCompressionLevel = (int32) pq_getmsgint(stripeBuffer, 4);
+	chunkSkipNode->valueEncodingType = (int32) pq_getmsgint(stripeBuffer, 4);
+
+	/* make sure that the readers don't read past the data of the stripe */
+	if (chunkSkipNode->valueChunkOffset > dataLength ||
+		chunkSkipNode->valueLength > dataLength - chunkSkipNode->valueChunkOffset ||
+		chunkSkipNode->existsChunkOffset > dataLength ||
+		chunkSkipNode->existsLength > dataLength - chunkSkipNode->existsChunkOffset)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+						errmsg("invalid columnar stripe data"),
+						errdetail("Chunk is outside of the data of the stripe.")));
+	}
+
+	if (chunkSkipNode->valueCompressionType < 0 ||
+		chunkSkipNode->valueCompressionType >= COMPRESSION_AUTO ||
+		chunkSkipNode->valueEncodingType < 0 ||
+		chunkSkipNode->valueEncodingType >= CHUNK_ENCODING_COUNT)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+						errmsg("invalid columnar stripe data"),
+						errdetail("Unknown compression type %d or value encoding %d.",
+								  chunkSkipNode->valueCompressionType,
+								  chunkSkipNode->valueEncodingType)));
+	}
+
+	chunkSkipNode->hasMinMax = pq_getmsgbyte(stripeBuffer);
+	if (chunkSkipNode->hasMinMax)
+	{
+		bytea *minimumValue = DeserializeBytea(stripeBuffer);
+		bytea *maximumValue = DeserializeBytea(stripeBuffer);
+
+		if (minimumValue == NULL || maximumValue == NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+							errmsg("invalid columnar stripe data"),
+							errdetail("Chunk doesn't have its minimum or maximum "
+									  "value.")));
+		}
+
+		chunkSkipNode->minimumValue = ByteaToDatum(minimumValue, attributeForm);
+		chunkSkipNode->maximumValue = ByteaToDatum(maximumValue, attributeForm);
+	}
+
+	chunkSkipNode->bloomFilter = DeserializeBytea(stripeBuffer);
+}
+
+
+/*
+ * DeserializeBytea reads a value that was appended to stripeBuffer by
+ * SerializeBytea, and returns NULL if the value was NULL.
+ */
+static bytea *
+DeserializeBytea(StringInfo stripeBuffer)
+{
+	int32 length = (int32) pq_getmsgint(stripeBuffer, 4);
+	if (length < 0)
+	{
+		return NULL;
+	}
+
+	const char *data = pq_getmsgbytes(stripeBuffer, length);
+
+	bytea *value = palloc(length + VARHDRSZ);
+	SET_VARSIZE(value, length + VARHDRSZ);
+	/* minimum and maximum values can be larger than RSIZE_MAX */
+	memcpy(VARDATA(value), data, length); /* IGNORE-BANNED */
+
+	return value;
+}
@@ -19,19 +19,23 @@
 #include "miscadmin.h"
 #include "safe_lib.h"
 
+#include "access/hash.h"
 #include "access/heapam.h"
 #include "access/nbtree.h"
 #include "catalog/pg_am.h"
+#include "executor/tuptable.h"
 #include "storage/fd.h"
 #include "storage/smgr.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/typcache.h"
 
 #include "pg_version_compat.h"
 #include "pg_version_constants.h"
 
 #include "columnar/columnar.h"
+#include "columnar/columnar_bloom.h"
 #include "columnar/columnar_storage.h"
 #include "columnar/columnar_version_compat.h"
 
@@ -42,6 +46,16 @@
 #include "utils/relfilenodemap.h"
 #endif
 
+/*
+ * When the compression type is "auto", we choose a compression type for each
+ * chunk by compressing a sample of AUTO_COMPRESSION_SAMPLE_SIZE bytes from it.
+ * A compression type is preferred over the faster ones only if its output is
+ * smaller than AUTO_COMPRESSION_MIN_SIZE_PERCENT of theirs; similarly, a chunk
+ * is compressed only if that makes it smaller than this percentage.
+ */
+#define AUTO_COMPRESSION_SAMPLE_SIZE (64 * 1024)
+#define AUTO_COMPRESSION_MIN_SIZE_PERCENT 85
+
 struct ColumnarWriteState
 {
 	TupleDesc tupleDescriptor;
@@ -56,6 +70,13 @@ struct ColumnarWriteState
 	ColumnarOptions options;
 	ChunkData *chunkData;
 
+	/*
+	 * Compression type and level to be used for each column, which are
+	 * either the options of the column or the options of the table.
+	 */
+	CompressionType *compressionTypeArray;
+	int *compressionLevelArray;
+
 	List *chunkGroupRowCounts;
 
 	/*
@@ -65,14 +86,52 @@ struct ColumnarWriteState
 	 * deallocated when memory context is reset.
 	 */
 	StringInfo compressionBuffer;
+
+	/*
+	 * encodingBuffer is used as temporary storage for encoded value buffers
+	 * if chunkEncodingEnabled is true. Like compressionBuffer, it lives in
+	 * stripeWriteContext.
+	 */
+	StringInfo encodingBuffer;
+	bool chunkEncodingEnabled;
+
+	/*
+	 * If bloom filters are enabled, bloomHashFunctionArray[column] is the
+	 * hash function of the default hash operator class of the column type,
+	 * or NULL if the type isn't hashable. chunkHashArray[column] keeps the
+	 * hashes of the values in the current chunk, which are turned into the
+	 * bloom filter of the chunk when it is serialized.
+	 */
+	FmgrInfo **bloomHashFunctionArray;
+	uint32 **chunkHashArray;
+	uint32 *chunkHashCountArray;
+
+	/*
+	 * If the table has a sort key, sortKeyColumnOptions holds the options of
+	 * its columns. Unless the table has indexes, the rows of each stripe are
+	 * then collected in stripeSortState and serialized in sort key order when
+	 * the stripe is flushed. sortInputSlot and sortOutputSlot pass the rows to
+	 * and from the sort, and sortedRowCount is the number of collected rows.
+	 */
+	ColumnarColumnOptions *sortKeyColumnOptions;
+	Tuplesortstate *stripeSortState;
+	TupleTableSlot *sortInputSlot;
+	TupleTableSlot *sortOutputSlot;
+	uint64 sortedRowCount;
 };
 
+static CompressionType ChooseChunkCompressionType(StringInfo valueBuffer,
+												  int compressionLevel,
+												  StringInfo compressionBuffer);
 static StripeBuffers * CreateEmptyStripeBuffers(uint32 stripeMaxRowCount,
 												uint32 chunkRowCount,
 												uint32 columnCount);
 static StripeSkipList * CreateEmptyStripeSkipList(uint32 stripeMaxRowCount,
 												  uint32 chunkRowCount,
 												  uint32 columnCount);
+static void AppendStripeRow(ColumnarWriteState *writeState, Datum *columnValues,
+							bool *columnNulls);
+static void AppendSortedStripeRows(ColumnarWriteState *writeState);
 static void FlushStripe(ColumnarWriteState *writeState);
 static StringInfo SerializeBoolArray(bool *boolArray, uint32 boolArrayLength);
 static void SerializeSingleDatum(StringInfo datumBuffer, Datum datum,
@@ -84,6 +143,7 @@ static void UpdateChunkSkipNodeMinMax(ColumnChunkSkipNode *chunkSkipNode,
 									  Datum columnValue, bool columnTypeByValue,
 									  int columnTypeLength, Oid columnCollation,
 									  FmgrInfo *comparisonFunction);
+static bool StripeMemoryLimitExceeded(ColumnarWriteState *writeState);
 static Datum DatumCopy(Datum datum, bool datumTypeByValue, int datumTypeLength);
 static StringInfo CopyStringInfo(StringInfo sourceString);
 
@@ -91,30 +151,77 @@ static StringInfo CopyStringInfo(StringInfo sourceString);
  * ColumnarBeginWrite initializes a columnar data load operation and returns a table
  * handle. This handle should be used for adding the row values and finishing the
  * data load operation.
+ *
+ * columnOptions is either NULL or an array of the options of the columns that
+ * override the options of the table, as returned by ReadColumnarColumnOptions.
  */
 ColumnarWriteState *
 ColumnarBeginWrite(RelFileLocator relfilelocator,
 				   ColumnarOptions options,
+				   ColumnarColumnOptions *columnOptions,
 				   TupleDesc tupleDescriptor)
 {
-	/* get comparison function pointers for each of the columns */
+	/* get comparison and hash function pointers for each of the columns */
 	uint32 columnCount = tupleDescriptor->natts;
+	CompressionType *compressionTypeArray = palloc(columnCount * sizeof(CompressionType));
+	int *compressionLevelArray = palloc(columnCount * sizeof(int));
 	FmgrInfo **comparisonFunctionArray = palloc0(columnCount * sizeof(FmgrInfo *));
+	FmgrInfo **bloomHashFunctionArray = palloc0(columnCount * sizeof(FmgrInfo *));
+	uint32 **chunkHashArray = palloc0(columnCount * sizeof(uint32 *));
+	bool hasSortKey = false;
+	bool bloomFilterEnabled = columnar_enable_bloom_filter &&
+							  ColumnarChunkBloomFilterSupported();
 	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
 	{
 		FmgrInfo *comparisonFunction = NULL;
+		FmgrInfo *bloomHashFunction = NULL;
 		FormData_pg_attribute *attributeForm = TupleDescAttr(tupleDescriptor,
 															 columnIndex);
 
+		compressionTypeArray[columnIndex] = options.compressionType;
+		compressionLevelArray[columnIndex] = options.compressionLevel;
+		if (columnOptions != NULL)
+		{
+			if (columnOptions[columnIndex].compressionType != COMPRESSION_TYPE_INVALID)
+			{
+				compressionTypeArray[columnIndex] =
+					columnOptions[columnIndex].compressionType;
+			}
+
+			if (columnOptions[columnIndex].compressionLevel != 0)
+			{
+				compressionLevelArray[columnIndex] =
+					columnOptions[columnIndex].compressionLevel;
+			}
+
+			if (columnOptions[columnIndex].sortKeyPosition != 0 &&
+				!attributeForm->attisdropped)
+			{
+				hasSortKey = true;
+			}
+		}
+
 		if (!attributeForm->attisdropped)
 		{
 			Oid typeId = attributeForm->atttypid;
 
 			comparisonFunction = GetFunctionInfoOrNull(typeId, BTREE_AM_OID,
 													   BTORDER_PROC);
+
+			if (bloomFilterEnabled)
+			{
+				bloomHashFunction = GetFunctionInfoOrNull(typeId, HASH_AM_OID,
+														  HASHSTANDARD_PROC);
+			}
 		}
 
 		comparisonFunctionArray[columnIndex] = comparisonFunction;
+		bloomHashFunctionArray[columnIndex] = bloomHashFunction;
+
+		if (bloomHashFunction != NULL)
+		{
+			chunkHashArray[columnIndex] = palloc(options.chunkRowCount * sizeof(uint32));
+		}
 	}
 
 	/*
@@ -135,18 +242,39 @@ ColumnarBeginWrite(RelFileLocator relfilelocator,
 	ColumnarWriteState *writeState = palloc0(sizeof(ColumnarWriteState));
 	writeState->relfilelocator = relfilelocator;
 	writeState->options = options;
+	writeState->compressionTypeArray = compressionTypeArray;
+	writeState->compressionLevelArray = compressionLevelArray;
 	writeState->tupleDescriptor = CreateTupleDescCopy(tupleDescriptor);
 	writeState->comparisonFunctionArray = comparisonFunctionArray;
+	writeState->bloomHashFunctionArray = bloomHashFunctionArray;
+	writeState->chunkHashArray = chunkHashArray;
+	writeState->chunkHashCountArray = palloc0(columnCount * sizeof(uint32));
 	writeState->stripeBuffers = NULL;
 	writeState->stripeSkipList = NULL;
 	writeState->emptyStripeReservation = NULL;
 	writeState->stripeWriteContext = stripeWriteContext;
 	writeState->chunkData = chunkData;
 	writeState->compressionBuffer = NULL;
+	writeState->encodingBuffer = NULL;
+	writeState->chunkEncodingEnabled = false;
 	writeState->perTupleContext = AllocSetContextCreate(CurrentMemoryContext,
 														"Columnar per tuple context",
 														ALLOCSET_DEFAULT_SIZES);
 
+	if (hasSortKey)
+	{
+		writeState->sortKeyColumnOptions =
+			palloc(columnCount * sizeof(ColumnarColumnOptions));
+		memcpy_s(writeState->sortKeyColumnOptions,
+				 columnCount * sizeof(ColumnarColumnOptions),
+				 columnOptions, columnCount * sizeof(ColumnarColumnOptions));
+
+		writeState->sortInputSlot =
+			MakeSingleTupleTableSlot(writeState->tupleDescriptor, &TTSOpsVirtual);
+		writeState->sortOutputSlot =
+			MakeSingleTupleTableSlot(writeState->tupleDescriptor, &TTSOpsMinimalTuple);
+	}
+
 	return writeState;
 }
 
@@ -159,6 +287,9 @@ ColumnarBeginWrite(RelFileLocator relfilelocator,
  * rowChunkCount insertion. Then, if row count exceeds stripeMaxRowCount, we flush
  * the stripe, and add its metadata to the table footer.
  *
+ * If the rows of the stripe are sorted by the sort key of the table, the row
+ * is only added to the sort, and it is serialized when the stripe is flushed.
+ *
  * Returns the "row number" assigned to written row.
  */
 uint64
@@ -182,6 +313,9 @@ ColumnarWriteRow(ColumnarWriteState *writeState, Datum *columnValues, bool *colu
 		writeState->stripeBuffers = stripeBuffers;
 		writeState->stripeSkipList = stripeSkipList;
 		writeState->compressionBuffer = makeStringInfo();
+		writeState->encodingBuffer = makeStringInfo();
+		writeState->chunkEncodingEnabled = columnar_enable_chunk_encoding &&
+										   ColumnarChunkEncodingSupported();
 
 		Oid relationId = RelidByRelfilenumber(RelationTablespace_compat(
 												  writeState->relfilelocator),
@@ -191,6 +325,19 @@ ColumnarWriteRow(ColumnarWriteState *writeState, Datum *columnValues, bool *colu
 		writeState->emptyStripeReservation =
 			ReserveEmptyStripe(relation, columnCount, chunkRowCount,
 							   options->stripeRowCount);
+
+		/*
+		 * Sorting the stripe changes the row numbers of the rows, so we cannot
+		 * sort it if the row numbers that we return are stored in indexes.
+		 */
+		if (writeState->sortKeyColumnOptions != NULL && !relation->rd_rel->relhasindex)
+		{
+			writeState->stripeSortState =
+				ColumnarBeginSortKeySort(writeState->tupleDescriptor,
+										 writeState->sortKeyColumnOptions, work_mem);
+			writeState->sortedRowCount = 0;
+		}
+
 		relation_close(relation, NoLock);
 
 		/*
@@ -203,6 +350,91 @@ ColumnarWriteRow(ColumnarWriteState *writeState, Datum *columnValues, bool *colu
 		}
 	}
 
+	uint64 stripeRowIndex = 0;
+	if (writeState->stripeSortState != NULL)
+	{
+		TupleTableSlot *slot = writeState->sortInputSlot;
+
+		ExecClearTuple(slot);
+		for (columnIndex = 0; columnIndex < columnCount; columnIndex++)
+		{
+			slot->tts_values[columnIndex] = columnValues[columnIndex];
+			slot->tts_isnull[columnIndex] = columnNulls[columnIndex];
+		}
+		ExecStoreVirtualTuple(slot);
+
+		/* tuplesort_puttupleslot copies the slot into sort context */
+		tuplesort_puttupleslot(writeState->stripeSortState, slot);
+		ExecClearTuple(slot);
+
+		stripeRowIndex = writeState->sortedRowCount;
+		writeState->sortedRowCount++;
+	}
+	else
+	{
+		stripeRowIndex = stripeBuffers->rowCount;
+		AppendStripeRow(writeState, columnValues, columnNulls);
+	}
+
+	uint64 writtenRowNumber = writeState->emptyStripeReservation->stripeFirstRowNumber +
+							  stripeRowIndex;
+	if (stripeRowIndex + 1 >= options->stripeRowCount)
+	{
+		ColumnarFlushPendingWrites(writeState);
+	}
+	else if (StripeMemoryLimitExceeded(writeState))
+	{
+		elog(DEBUG1, "Flushing Stripe early since its buffers exceed "
+					 "columnar.stripe_memory_limit");
+
+		ColumnarFlushPendingWrites(writeState);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return writtenRowNumber;
+}
+
+
+/*
+ * StripeMemoryLimitExceeded returns true if the buffers of the stripe being
+ * written, including the rows that are collected to be sorted, use more
+ * memory than columnar.stripe_memory_limit.
+ *
+ * Flushing the stripe then makes it have fewer rows than the stripe row
+ * limit, and its last chunk group have fewer rows than the chunk group row
+ * limit. That doesn't matter for the readers, since they rely on the row
+ * counts recorded in the metadata of the stripe anyway, as for the last
+ * stripe of a write.
+ */
+static bool
+StripeMemoryLimitExceeded(ColumnarWriteState *writeState)
+{
+	if (columnar_stripe_memory_limit == 0)
+	{
+		return false;
+	}
+
+	Size stripeMemory = MemoryContextMemAllocated(writeState->stripeWriteContext, true);
+	return stripeMemory > (Size) columnar_stripe_memory_limit * 1024;
+}
+
+
+/*
+ * AppendStripeRow serializes the given row into the buffers of the current
+ * stripe and updates the skip nodes of its chunk. The chunk is serialized
+ * when its last row is appended.
+ */
+static void
+AppendStripeRow(ColumnarWriteState *writeState, Datum *columnValues, bool *columnNulls)
+{
+	uint32 columnIndex = 0;
+	StripeBuffers *stripeBuffers = writeState->stripeBuffers;
+	StripeSkipList *stripeSkipList = writeState->stripeSkipList;
+	uint32 columnCount = writeState->tupleDescriptor->natts;
+	const uint32 chunkRowCount = writeState->options.chunkRowCount;
+	ChunkData *chunkData = writeState->chunkData;
+
 	uint32 chunkIndex = stripeBuffers->rowCount / chunkRowCount;
 	uint32 chunkRowIndex = stripeBuffers->rowCount % chunkRowCount;
 
@@ -236,6 +468,22 @@ ColumnarWriteRow(ColumnarWriteState *writeState, Datum *columnValues, bool *colu
 			UpdateChunkSkipNodeMinMax(chunkSkipNode, columnValues[columnIndex],
 									  columnTypeByValue, columnTypeLength,
 									  columnCollation, comparisonFunction);
+
+			FmgrInfo *bloomHashFunction = writeState->bloomHashFunctionArray[columnIndex];
+			if (bloomHashFunction != NULL)
+			{
+				/* hash functions might allocate memory, e.g. for collations */
+				MemoryContext hashContext =
+					MemoryContextSwitchTo(writeState->perTupleContext);
+				Datum hash = FunctionCall1Coll(bloomHashFunction, columnCollation,
+											   columnValues[columnIndex]);
+				MemoryContextSwitchTo(hashContext);
+
+				uint32 *chunkHashCount = &writeState->chunkHashCountArray[columnIndex];
+				writeState->chunkHashArray[columnIndex][*chunkHashCount] =
+					DatumGetUInt32(hash);
+				(*chunkHashCount)++;
+			}
 		}
 
 		chunkSkipNode->rowCount++;
@@ -249,17 +497,7 @@ ColumnarWriteRow(ColumnarWriteState *writeState, Datum *columnValues, bool *colu
 		SerializeChunkData(writeState, chunkIndex, chunkRowCount);
 	}
 
-	uint64 writtenRowNumber = writeState->emptyStripeReservation->stripeFirstRowNumber +
-							  stripeBuffers->rowCount;
 	stripeBuffers->rowCount++;
-	if (stripeBuffers->rowCount >= options->stripeRowCount)
-	{
-		ColumnarFlushPendingWrites(writeState);
-	}
-
-	MemoryContextSwitchTo(oldContext);
-
-	return writtenRowNumber;
 }
 
 
@@ -273,6 +511,12 @@ ColumnarEndWrite(ColumnarWriteState *writeState)
 	ColumnarFlushPendingWrites(writeState);
 
 	MemoryContextDelete(writeState->stripeWriteContext);
+	if (writeState->sortKeyColumnOptions != NULL)
+	{
+		ExecDropSingleTupleTableSlot(writeState->sortInputSlot);
+		ExecDropSingleTupleTableSlot(writeState->sortOutputSlot);
+	}
+
 	pfree(writeState->comparisonFunctionArray);
 	FreeChunkData(writeState->chunkData);
 	pfree(writeState);
@@ -287,6 +531,11 @@ ColumnarFlushPendingWrites(ColumnarWriteState *writeState)
 	{
 		MemoryContext oldContext = MemoryContextSwitchTo(writeState->stripeWriteContext);
 
+		if (writeState->stripeSortState != NULL)
+		{
+			AppendSortedStripeRows(writeState);
+		}
+
 		FlushStripe(writeState);
 		MemoryContextReset(writeState->stripeWriteContext);
 
@@ -299,6 +548,93 @@ ColumnarFlushPendingWrites(ColumnarWriteState *writeState)
 }
 
 
+/*
+ * AppendSortedStripeRows sorts the rows that were collected for the current
+ * stripe and appends them to the stripe in sort key order.
+ */
+static void
+AppendSortedStripeRows(ColumnarWriteState *writeState)
+{
+	Tuplesortstate *sortState = writeState->stripeSortState;
+	TupleTableSlot *slot = writeState->sortOutputSlot;
+
+	tuplesort_performsort(sortState);
+
+	while (tuplesort_gettupleslot(sortState, true, false, slot, NULL))
+	{
+		slot_getallattrs(slot);
+		AppendStripeRow(writeState, slot->tts_values, slot->tts_isnull);
+	}
+
+	ExecClearTuple(slot);
+	tuplesort_end(sortState);
+
+	writeState->stripeSortState = NULL;
+	writeState->sortedRowCount = 0;
+}
+
+
+/*
+ * ColumnarBeginSortKeySort begins a sort of rows with given tuple descriptor
+ * by the sort key recorded in given column options, or returns NULL if there
+ * is no sort key. NULLs are sorted after the other values of a column.
+ */
+Tuplesortstate *
+ColumnarBeginSortKeySort(TupleDesc tupleDescriptor, ColumnarColumnOptions *columnOptions,
+						 int workMem)
+{
+	if (columnOptions == NULL)
+	{
+		return NULL;
+	}
+
+	int columnCount = tupleDescriptor->natts;
+	AttrNumber *sortColumnArray = palloc0(columnCount * sizeof(AttrNumber));
+	Oid *sortOperatorArray = palloc0(columnCount * sizeof(Oid));
+	Oid *sortCollationArray = palloc0(columnCount * sizeof(Oid));
+	bool *nullsFirstArray = palloc0(columnCount * sizeof(bool));
+	int sortKeyCount = 0;
+
+	/* positions have gaps if some columns of the sort key were dropped */
+	for (int sortKeyPosition = 1; sortKeyPosition <= columnCount; sortKeyPosition++)
+	{
+		for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+		{
+			Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor,
+															columnIndex);
+			if (columnOptions[columnIndex].sortKeyPosition != sortKeyPosition ||
+				attributeForm->attisdropped)
+			{
+				continue;
+			}
+
+			/* the type might have been changed after the sort key was set */
+			TypeCacheEntry *typeEntry = lookup_type_cache(attributeForm->atttypid,
+														  TYPECACHE_LT_OPR);
+			if (!OidIsValid(typeEntry->lt_opr))
+			{
+				continue;
+			}
+
+			sortColumnArray[sortKeyCount] = attributeForm->attnum;
+			sortOperatorArray[sortKeyCount] = typeEntry->lt_opr;
+			sortCollationArray[sortKeyCount] = attributeForm->attcollation;
+			nullsFirstArray[sortKeyCount] = false;
+			sortKeyCount++;
+		}
+	}
+
+	if (sortKeyCount == 0)
+	{
+		return NULL;
+	}
+
+	return tuplesort_begin_heap(tupleDescriptor, sortKeyCount, sortColumnArray,
+								sortOperatorArray, sortCollationArray, nullsFirstArray,
+								workMem, NULL, false);
+}
+
+
 /*
  * ColumnarWritePerTupleContext
  *
@@ -335,6 +671,7 @@ CreateEmptyStripeBuffers(uint32 stripeMaxRowCount, uint32 chunkRowCount,
 			chunkBuffersArray[chunkIndex]->existsBuffer = NULL;
 			chunkBuffersArray[chunkIndex]->valueBuffer = NULL;
 			chunkBuffersArray[chunkIndex]->valueCompressionType = COMPRESSION_NONE;
+			chunkBuffersArray[chunkIndex]->valueEncodingType = CHUNK_ENCODING_NONE;
 		}
 
 		columnBuffersArray[columnIndex] = palloc0(sizeof(ColumnBuffers));
@@ -448,7 +785,8 @@ FlushStripe(ColumnarWriteState *writeState)
 			chunkSkipNode->valueChunkOffset = stripeSize;
 			chunkSkipNode->valueLength = valueBufferSize;
 			chunkSkipNode->valueCompressionType = valueCompressionType;
-			chunkSkipNode->valueCompressionLevel = writeState->options.compressionLevel;
+			chunkSkipNode->valueCompressionLevel = chunkBuffers->valueCompressionLevel;
+			chunkSkipNode->valueEncodingType = chunkBuffers->valueEncodingType;
 			chunkSkipNode->decompressedValueSize = chunkBuffers->decompressedValueSize;
 
 			stripeSize += valueBufferSize;
@@ -591,8 +929,6 @@ SerializeChunkData(ColumnarWriteState *writeState, uint32 chunkIndex, uint32 row
 	uint32 columnIndex = 0;
 	StripeBuffers *stripeBuffers = writeState->stripeBuffers;
 	ChunkData *chunkData = writeState->chunkData;
-	CompressionType requestedCompressionType = writeState->options.compressionType;
-	int compressionLevel = writeState->options.compressionLevel;
 	const uint32 columnCount = stripeBuffers->columnCount;
 	StringInfo compressionBuffer = writeState->compressionBuffer;
 
@@ -609,6 +945,22 @@ SerializeChunkData(ColumnarWriteState *writeState, uint32 chunkIndex, uint32 row
 			SerializeBoolArray(chunkData->existsArray[columnIndex], rowCount);
 	}
 
+	/* build bloom filters from the hashes of the values */
+	for (columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		if (writeState->bloomHashFunctionArray[columnIndex] == NULL)
+		{
+			continue;
+		}
+
+		ColumnChunkSkipNode *chunkSkipNode =
+			&writeState->stripeSkipList->chunkSkipNodeArray[columnIndex][chunkIndex];
+		chunkSkipNode->bloomFilter =
+			BuildChunkBloomFilter(writeState->chunkHashArray[columnIndex],
+								  writeState->chunkHashCountArray[columnIndex]);
+		writeState->chunkHashCountArray[columnIndex] = 0;
+	}
+
 	/*
 	 * check and compress value buffers, if a value buffer is not compressable
 	 * then keep it as uncompressed, store compression information.
@@ -618,14 +970,43 @@ SerializeChunkData(ColumnarWriteState *writeState, uint32 chunkIndex, uint32 row
 		ColumnBuffers *columnBuffers = stripeBuffers->columnBuffersArray[columnIndex];
 		ColumnChunkBuffers *chunkBuffers = columnBuffers->chunkBuffersArray[chunkIndex];
 		CompressionType actualCompressionType = COMPRESSION_NONE;
+		ChunkEncodingType encodingType = CHUNK_ENCODING_NONE;
+		CompressionType requestedCompressionType =
+			writeState->compressionTypeArray[columnIndex];
+		int compressionLevel = writeState->compressionLevelArray[columnIndex];
 
 		StringInfo serializedValueBuffer = chunkData->valueBufferArray[columnIndex];
 
 		Assert(requestedCompressionType >= 0 &&
 			   requestedCompressionType < COMPRESSION_COUNT);
 
-		chunkBuffers->decompressedValueSize =
-			chunkData->valueBufferArray[columnIndex]->len;
+		/* encode the values if that makes them smaller */
+		if (writeState->chunkEncodingEnabled)
+		{
+			Form_pg_attribute attributeForm =
+				TupleDescAttr(writeState->tupleDescriptor, columnIndex);
+
+			encodingType = EncodeChunkValues(serializedValueBuffer,
+											 chunkData->existsArray[columnIndex],
+											 rowCount, attributeForm->attbyval,
+											 attributeForm->attlen,
+											 attributeForm->attalign,
+											 writeState->encodingBuffer);
+			if (encodingType != CHUNK_ENCODING_NONE)
+			{
+				serializedValueBuffer = writeState->encodingBuffer;
+			}
+		}
+
+		chunkBuffers->valueEncodingType = encodingType;
+		chunkBuffers->decompressedValueSize = serializedValueBuffer->len;
+
+		if (requestedCompressionType == COMPRESSION_AUTO)
+		{
+			requestedCompressionType =
+				ChooseChunkCompressionType(serializedValueBuffer, compressionLevel,
+										   compressionBuffer);
+		}
 
 		/*
 		 * if serializedValueBuffer is be compressed, update serializedValueBuffer
@@ -642,6 +1023,7 @@ SerializeChunkData(ColumnarWriteState *writeState, uint32 chunkIndex, uint32 row
 
 		/* store (compressed) value buffer */
 		chunkBuffers->valueCompressionType = actualCompressionType;
+		chunkBuffers->valueCompressionLevel = compressionLevel;
 		chunkBuffers->valueBuffer = CopyStringInfo(serializedValueBuffer);
 
 		/* valueBuffer needs to be reset for next chunk's data */
@@ -650,6 +1032,77 @@ SerializeChunkData(ColumnarWriteState *writeState, uint32 chunkIndex, uint32 row
 }
 
 
+/*
+ * ChooseChunkCompressionType picks the compression type to be used for given
+ * value buffer when the requested compression type is "auto".
+ *
+ * We compress a sample from the beginning of the buffer with each of the
+ * available compression types, and prefer lz4 for its speed unless zstd
+ * produces notably smaller output. pglz is only considered if neither of them
+ * is available. If the sample doesn't compress well, the chunk is not
+ * compressed at all.
+ */
+static CompressionType
+ChooseChunkCompressionType(StringInfo valueBuffer, int compressionLevel,
+						   StringInfo compressionBuffer)
+{
+	StringInfoData sampleBuffer = { 0 };
+	sampleBuffer.data = valueBuffer->data;
+	sampleBuffer.len = Min(valueBuffer->len, AUTO_COMPRESSION_SAMPLE_SIZE);
+	sampleBuffer.maxlen = sampleBuffer.len;
+
+	CompressionType chosenCompressionType = COMPRESSION_NONE;
+	int chosenSize = sampleBuffer.len;
+
+	if (sampleBuffer.len == 0)
+	{
+		return COMPRESSION_NONE;
+	}
+
+#if HAVE_CITUS_LIBLZ4
+	if (CompressBuffer(&sampleBuffer, compressionBuffer, COMPRESSION_LZ4,
+					   compressionLevel) &&
+		compressionBuffer->len < chosenSize)
+	{
+		chosenCompressionType = COMPRESSION_LZ4;
+		chosenSize = compressionBuffer->len;
+	}
+#endif
+
+#if HAVE_LIBZSTD
+	if (CompressBuffer(&sampleBuffer, compressionBuffer, COMPRESSION_ZSTD,
+					   compressionLevel) &&
+		compressionBuffer->len * 100 <
+		(int64) chosenSize * AUTO_COMPRESSION_MIN_SIZE_PERCENT)
+	{
+		chosenCompressionType = COMPRESSION_ZSTD;
+		chosenSize = compressionBuffer->len;
+	}
+#endif
+
+#if !HAVE_CITUS_LIBLZ4 && !HAVE_LIBZSTD
+	if (CompressBuffer(&sampleBuffer, compressionBuffer, COMPRESSION_PG_LZ,
+					   compressionLevel) &&
+		compressionBuffer->len < chosenSize)
+	{
+		chosenCompressionType = COMPRESSION_PG_LZ;
+		chosenSize = compressionBuffer->len;
+	}
+#endif
+
+	/* decompression costs are not worth it if we don't save enough space */
+	if ((int64) chosenSize * 100 >=
+		(int64) sampleBuffer.len * AUTO_COMPRESSION_MIN_SIZE_PERCENT)
+	{
+		chosenCompressionType = COMPRESSION_NONE;
+	}
+
+	resetStringInfo(compressionBuffer);
+
+	return chosenCompressionType;
+}
+
+
 /*
  * UpdateChunkSkipNodeMinMax takes the given column value, and checks if this
  * value falls outside the range of minimum/maximum values of the given column
@@ -771,5 +1224,6 @@ CopyStringInfo(StringInfo sourceString)
 bool
 ContainsPendingWrites(ColumnarWriteState *state)
 {
-	return state->stripeBuffers != NULL && state->stripeBuffers->rowCount != 0;
+	return state->stripeBuffers != NULL &&
+		   (state->stripeBuffers->rowCount != 0 || state->sortedRowCount != 0);
 }
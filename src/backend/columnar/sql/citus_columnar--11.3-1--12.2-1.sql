@@ -1 +1,119 @@
 -- citus_columnar--11.3-1--12.2-1
+
+-- encoding that was applied to the values of the chunk before compression
+ALTER TABLE columnar_internal.chunk ADD COLUMN value_encoding int NOT NULL DEFAULT 0;
+
+-- bloom filter of the non-NULL values of the chunk
+ALTER TABLE columnar_internal.chunk ADD COLUMN value_bloom_filter bytea;
+
+-- per-column compression settings that override the table's options, set using
+-- ALTER TABLE ... ALTER COLUMN ... SET (columnar.compression = ...), and the
+-- positions of the columns in the sort key set using columnar.sort_key
+CREATE TABLE columnar_internal.column_options (
+    regclass regclass NOT NULL,
+    attr_num int NOT NULL,
+    compression name,
+    compression_level int,
+    sort_key_position int,
+    PRIMARY KEY (regclass, attr_num)
+) WITH (user_catalog_table = true);
+
+COMMENT ON TABLE columnar_internal.column_options
+  IS 'columnar table specific column options, maintained by ALTER TABLE ... ALTER COLUMN ... SET';
+
+CREATE VIEW columnar.column_options WITH (security_barrier) AS
+  SELECT o.regclass AS relation, a.attname AS column_name,
+         o.compression, o.compression_level, o.sort_key_position
+    FROM columnar_internal.column_options o, pg_class c, pg_attribute a
+    WHERE o.regclass = c.oid AND a.attrelid = c.oid AND a.attnum = o.attr_num
+      AND NOT a.attisdropped AND pg_has_role(c.relowner, 'USAGE');
+COMMENT ON VIEW columnar.column_options
+  IS 'Columnar column options for tables on which the current user has ownership privileges.';
+GRANT SELECT ON columnar.column_options TO PUBLIC;
+
+-- size, usage and hit / miss counters of the shared cache of decompressed
+-- column chunks, which is enabled by columnar.chunk_cache_size
+CREATE FUNCTION columnar_internal.chunk_cache_stats(
+    OUT cache_size bigint,
+    OUT used_size bigint,
+    OUT chunk_count bigint,
+    OUT hits bigint,
+    OUT misses bigint,
+    OUT evictions bigint)
+  LANGUAGE C STRICT
+  AS 'MODULE_PATHNAME', 'columnar_chunk_cache_stats';
+
+CREATE VIEW columnar.chunk_cache_stats AS
+  SELECT * FROM columnar_internal.chunk_cache_stats();
+COMMENT ON VIEW columnar.chunk_cache_stats
+  IS 'Statistics of the shared cache of decompressed columnar chunks.';
+GRANT SELECT ON columnar.chunk_cache_stats TO PUBLIC;
+
+-- bitmap of the rows of a stripe that were removed by DELETE or UPDATE, bit
+-- N being set if the row at offset N of the stripe is deleted
+CREATE TABLE columnar_internal.row_mask (
+    storage_id bigint NOT NULL,
+    stripe_num bigint NOT NULL,
+    deleted_rows bigint NOT NULL,
+    mask bytea NOT NULL,
+    PRIMARY KEY (storage_id, stripe_num)
+) WITH (user_catalog_table = true);
+
+COMMENT ON TABLE columnar_internal.row_mask
+  IS 'Columnar per stripe bitmap of deleted rows';
+
+-- merges the adjacent small stripes of a columnar table into full-size ones,
+-- which citus.columnar_stripe_compaction_interval also does in the background
+CREATE FUNCTION columnar.compact_stripes(table_name regclass)
+  RETURNS bigint
+  LANGUAGE C STRICT
+  AS 'MODULE_PATHNAME', 'columnar_compact_stripes';
+COMMENT ON FUNCTION columnar.compact_stripes(regclass)
+  IS 'merge the small stripes of a columnar table';
+
+-- cumulative per relation statistics of the scans on columnar tables, which
+-- are kept for up to columnar.stat_scans_max relations
+CREATE FUNCTION columnar_internal.stat_scans(
+    OUT relid oid,
+    OUT scans bigint,
+    OUT stripes_read bigint,
+    OUT stripes_skipped bigint,
+    OUT chunk_groups_read bigint,
+    OUT chunk_groups_skipped bigint,
+    OUT bytes_read bigint,
+    OUT bytes_decompressed bigint,
+    OUT decompression_time double precision)
+  RETURNS SETOF record
+  LANGUAGE C STRICT
+  AS 'MODULE_PATHNAME', 'columnar_stat_scans';
+
+CREATE VIEW columnar.stat_scans AS
+  SELECT s.relid::regclass AS relation, s.scans, s.stripes_read, s.stripes_skipped,
+         s.chunk_groups_read, s.chunk_groups_skipped, s.bytes_read,
+         s.bytes_decompressed, s.decompression_time
+    FROM columnar_internal.stat_scans() s, pg_class c
+    WHERE s.relid = c.oid;
+COMMENT ON VIEW columnar.stat_scans
+  IS 'Cumulative statistics of the scans on columnar tables in the current database.';
+GRANT SELECT ON columnar.stat_scans TO PUBLIC;
+
+CREATE FUNCTION columnar.stat_scans_reset()
+  RETURNS void
+  LANGUAGE C STRICT
+  AS 'MODULE_PATHNAME', 'columnar_stat_scans_reset';
+COMMENT ON FUNCTION columnar.stat_scans_reset()
+  IS 'reset the scan statistics of the columnar tables in the current database';
+REVOKE ALL ON FUNCTION columnar.stat_scans_reset() FROM PUBLIC;
+
+-- exports the stripes of a columnar table without decompressing them, and
+-- appends an exported stripe to another columnar table, which citus uses to
+-- copy and move the shards of columnar tables between the nodes
+CREATE FUNCTION columnar_internal.export_stripes(table_name regclass)
+  RETURNS SETOF bytea
+  LANGUAGE C STRICT
+  AS 'MODULE_PATHNAME', 'columnar_export_stripes';
+
+CREATE FUNCTION columnar_internal.import_stripe(table_name regclass, stripe bytea)
+  RETURNS bigint
+  LANGUAGE C STRICT
+  AS 'MODULE_PATHNAME', 'columnar_import_stripe';
@@ -1 +1,50 @@
 -- citus_columnar--12.2-1--11.3-1
+
+-- older versions cannot read dictionary or run-length encoded chunks
+DO $proc$
+BEGIN
+  IF EXISTS (SELECT 1 FROM columnar_internal.chunk WHERE value_encoding <> 0) THEN
+    RAISE EXCEPTION 'cannot downgrade citus_columnar when there are encoded columnar chunks'
+      USING HINT = 'Rewrite the columnar tables with columnar.enable_chunk_encoding '
+                   'disabled, e.g. using VACUUM FULL, before downgrading.';
+  END IF;
+END$proc$;
+
+-- "auto" is not a known compression type for older versions
+DO $proc$
+BEGIN
+  IF EXISTS (SELECT 1 FROM columnar_internal.options WHERE compression = 'auto') THEN
+    RAISE EXCEPTION 'cannot downgrade citus_columnar when there are columnar tables using auto compression'
+      USING HINT = 'Change columnar.compression option of those tables before downgrading.';
+  END IF;
+END$proc$;
+
+-- older versions would return the rows that were deleted by a DELETE or UPDATE
+DO $proc$
+BEGIN
+  IF EXISTS (SELECT 1 FROM columnar_internal.row_mask) THEN
+    RAISE EXCEPTION 'cannot downgrade citus_columnar when there are columnar tables with deleted rows'
+      USING HINT = 'Rewrite the columnar tables that have deleted rows, e.g. using VACUUM FULL, before downgrading.';
+  END IF;
+END$proc$;
+
+ALTER TABLE columnar_internal.chunk DROP COLUMN value_encoding;
+
+ALTER TABLE columnar_internal.chunk DROP COLUMN value_bloom_filter;
+
+DROP VIEW columnar.column_options;
+DROP TABLE columnar_internal.column_options;
+
+DROP VIEW columnar.chunk_cache_stats;
+DROP FUNCTION columnar_internal.chunk_cache_stats();
+
+DROP TABLE columnar_internal.row_mask;
+
+DROP FUNCTION columnar.compact_stripes(regclass);
+
+DROP VIEW columnar.stat_scans;
+DROP FUNCTION columnar_internal.stat_scans();
+DROP FUNCTION columnar.stat_scans_reset();
+
+DROP FUNCTION columnar_internal.export_stripes(regclass);
+DROP FUNCTION columnar_internal.import_stripe(regclass, bytea);
@@ -43,6 +43,7 @@
 
 #include "columnar/columnar.h"
 #include "columnar/columnar_customscan.h"
+#include "columnar/columnar_storage.h"
 #include "columnar/columnar_tableam.h"
 #include "columnar/columnar_version_compat.h"
 
@@ -70,6 +71,48 @@ typedef struct SubXidWriteState
 } SubXidWriteState;
 
 
+/*
+ * Each member of the rowMaskStack in StripeRowMaskEntry. This means that the
+ * command cid of subtransaction subXid deleted the rows of the stripe that
+ * are set in rowMask.
+ */
+typedef struct SubXidRowMask
+{
+	SubTransactionId subXid;
+	CommandId cid;
+	uint8 *rowMask;
+
+	struct SubXidRowMask *next;
+} SubXidRowMask;
+
+
+/*
+ * An entry in rowMaskMap of WriteStateMapEntry. This keeps the rows of a
+ * stripe that are deleted in the current transaction. They are written to
+ * columnar.row_mask when the transaction commits.
+ */
+typedef struct StripeRowMaskEntry
+{
+	/* key of the entry */
+	uint64 stripeId;
+
+	uint64 storageId;
+	uint64 rowCount;
+
+	/*
+	 * Rows deleted by the transactions that committed before we started
+	 * deleting rows from the stripe, or NULL if there were none.
+	 */
+	uint8 *committedRowMask;
+
+	/* union of the row masks in rowMaskStack */
+	uint8 *pendingRowMask;
+
+	/* stack of SubXidRowMask where first element is top of the stack */
+	SubXidRowMask *rowMaskStack;
+} StripeRowMaskEntry;
+
+
 /*
  * An entry in WriteStateMap.
  */
@@ -93,6 +136,12 @@ typedef struct WriteStateMapEntry
 	 * the stack, and forward writes to that.
 	 */
 	SubXidWriteState *writeStateStack;
+
+	/*
+	 * Mapping from stripe id to StripeRowMaskEntry for the stripes from which
+	 * we deleted rows, or NULL if we didn't delete any rows.
+	 */
+	HTAB *rowMaskMap;
 } WriteStateMapEntry;
 
 
@@ -110,10 +159,17 @@ CleanupWriteStateMap(void *arg)
 }
 
 
-ColumnarWriteState *
-columnar_init_write_state(Relation relation, TupleDesc tupdesc,
-						  Oid tupSlotRelationId,
-						  SubTransactionId currentSubXid)
+static WriteStateMapEntry * GetWriteStateMapEntry(Relation relation);
+static void PopRowMasks(WriteStateMapEntry *entry, SubTransactionId currentSubXid,
+						SubTransactionId parentSubXid, bool commit);
+
+
+/*
+ * GetWriteStateMapEntry returns the entry of given relation in WriteStateMap,
+ * and creates it if needed.
+ */
+static WriteStateMapEntry *
+GetWriteStateMapEntry(Relation relation)
 {
 	bool found;
 
@@ -153,11 +209,23 @@ columnar_init_write_state(Relation relation, TupleDesc tupdesc,
 	if (!found)
 	{
 		hashEntry->writeStateStack = NULL;
+		hashEntry->rowMaskMap = NULL;
 		hashEntry->dropped = false;
 	}
 
 	Assert(!hashEntry->dropped);
 
+	return hashEntry;
+}
+
+
+ColumnarWriteState *
+columnar_init_write_state(Relation relation, TupleDesc tupdesc,
+						  Oid tupSlotRelationId,
+						  SubTransactionId currentSubXid)
+{
+	WriteStateMapEntry *hashEntry = GetWriteStateMapEntry(relation);
+
 	/*
 	 * If top of stack belongs to the current subtransaction, return its
 	 * writeState, ...
@@ -194,6 +262,9 @@ columnar_init_write_state(Relation relation, TupleDesc tupdesc,
 	stackEntry->writeState = ColumnarBeginWrite(RelationPhysicalIdentifier_compat(
 													relation),
 												columnarOptions,
+												ReadColumnarColumnOptions(
+													tupSlotRelationId,
+													tupdesc->natts),
 												tupdesc);
 	stackEntry->subXid = currentSubXid;
 	stackEntry->next = hashEntry->writeStateStack;
@@ -255,6 +326,11 @@ PopWriteStateForAllRels(SubTransactionId currentSubXid, SubTransactionId parentS
 	hash_seq_init(&status, WriteStateMap);
 	while ((entry = hash_seq_search(&status)) != 0)
 	{
+		if (entry->rowMaskMap != NULL)
+		{
+			PopRowMasks(entry, currentSubXid, parentSubXid, commit);
+		}
+
 		if (entry->writeStateStack == NULL)
 		{
 			continue;
@@ -301,6 +377,91 @@ PopWriteStateForAllRels(SubTransactionId currentSubXid, SubTransactionId parentS
 }
 
 
+/*
+ * PopRowMasks pops the row masks of current subtransaction for all stripes of
+ * given entry, and depending on "commit" either discards them or passes them
+ * to the parent subtransaction. When the top level transaction commits, the
+ * deleted rows are written to columnar.row_mask unless the table has been
+ * dropped.
+ */
+static void
+PopRowMasks(WriteStateMapEntry *entry, SubTransactionId currentSubXid,
+			SubTransactionId parentSubXid, bool commit)
+{
+	HASH_SEQ_STATUS status;
+	StripeRowMaskEntry *stripeEntry;
+
+	bool topLevelCommit = commit && parentSubXid == InvalidSubTransactionId;
+
+	hash_seq_init(&status, entry->rowMaskMap);
+	while ((stripeEntry = hash_seq_search(&status)) != 0)
+	{
+		if (topLevelCommit)
+		{
+			if (!entry->dropped)
+			{
+				SaveStripeRowMask(stripeEntry->storageId, stripeEntry->stripeId,
+								  stripeEntry->rowCount, stripeEntry->pendingRowMask);
+			}
+
+			continue;
+		}
+
+		if (commit)
+		{
+			/* elevate the deletions to the upper subtransaction */
+			for (SubXidRowMask *rowMask = stripeEntry->rowMaskStack; rowMask != NULL;
+				 rowMask = rowMask->next)
+			{
+				if (rowMask->subXid == currentSubXid)
+				{
+					rowMask->subXid = parentSubXid;
+				}
+			}
+
+			continue;
+		}
+
+		/* abort the deletions and recompute the union of remaining ones */
+		bool poppedAny = false;
+		while (stripeEntry->rowMaskStack != NULL &&
+			   stripeEntry->rowMaskStack->subXid == currentSubXid)
+		{
+			stripeEntry->rowMaskStack = stripeEntry->rowMaskStack->next;
+			poppedAny = true;
+		}
+
+		if (!poppedAny)
+		{
+			continue;
+		}
+
+		if (stripeEntry->rowMaskStack == NULL)
+		{
+			hash_search(entry->rowMaskMap, &stripeEntry->stripeId, HASH_REMOVE, NULL);
+			continue;
+		}
+
+		Size maskSize = COLUMNAR_ROW_MASK_SIZE(stripeEntry->rowCount);
+		memset(stripeEntry->pendingRowMask, 0, maskSize);
+
+		for (SubXidRowMask *rowMask = stripeEntry->rowMaskStack; rowMask != NULL;
+			 rowMask = rowMask->next)
+		{
+			for (Size byteIndex = 0; byteIndex < maskSize; byteIndex++)
+			{
+				stripeEntry->pendingRowMask[byteIndex] |= rowMask->rowMask[byteIndex];
+			}
+		}
+	}
+
+	if (topLevelCommit || hash_get_num_entries(entry->rowMaskMap) == 0)
+	{
+		entry->rowMaskMap = NULL;
+	}
+}
+
+
 /*
  * Called when current subtransaction is committed.
  */
@@ -392,6 +553,193 @@ PendingWritesInUpperTransactions(RelFileNumber relfilenumber,
 }
 
 
+/*
+ * Returns true if there are any pending writes for given relfilenode in
+ * current transaction, including its subtransactions.
+ */
+bool
+PendingWritesInCurrentTransaction(RelFileNumber relfilenumber)
+{
+	if (WriteStateMap == NULL)
+	{
+		return false;
+	}
+
+	WriteStateMapEntry *entry = hash_search(WriteStateMap, &relfilenumber, HASH_FIND,
+											NULL);
+	if (entry == NULL || entry->dropped)
+	{
+		return false;
+	}
+
+	SubXidWriteState *stackEntry = entry->writeStateStack;
+	while (stackEntry != NULL)
+	{
+		if (ContainsPendingWrites(stackEntry->writeState))
+		{
+			return true;
+		}
+
+		stackEntry = stackEntry->next;
+	}
+
+	/* rows deleted by current transaction are not written until commit */
+	return entry->rowMaskMap != NULL;
+}
+
+
+/*
+ * AddPendingRowDeletion marks the row at rowOffset of given stripe as deleted
+ * by the command cid of the subtransaction currentSubXid, and returns true.
+ *
+ * If the row was already deleted, then returns false and sets deletingCid to
+ * the command that deleted the row in current transaction, or to
+ * InvalidCommandId if the row was deleted by a committed transaction.
+ *
+ * Callers should hold a lock that prevents concurrent transactions from
+ * deleting rows from the relation until the end of the transaction.
+ */
+bool
+AddPendingRowDeletion(Relation relation, StripeMetadata *stripeMetadata,
+					  uint64 rowOffset, SubTransactionId currentSubXid,
+					  CommandId cid, CommandId *deletingCid)
+{
+	Assert(rowOffset < stripeMetadata->rowCount);
+
+	WriteStateMapEntry *hashEntry = GetWriteStateMapEntry(relation);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(WriteStateContext);
+
+	if (hashEntry->rowMaskMap == NULL)
+	{
+		HASHCTL info;
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(uint64);
+		info.entrysize = sizeof(StripeRowMaskEntry);
+		info.hcxt = WriteStateContext;
+
+		hashEntry->rowMaskMap = hash_create("columnar row mask map", 16, &info,
+											HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	bool found = false;
+	StripeRowMaskEntry *stripeEntry = hash_search(hashEntry->rowMaskMap,
+												  &stripeMetadata->id,
+												  HASH_ENTER, &found);
+	if (!found)
+	{
+		stripeEntry->storageId = ColumnarStorageGetStorageId(relation, false);
+		stripeEntry->rowCount = stripeMetadata->rowCount;
+		stripeEntry->committedRowMask =
+			ReadStripeRowMask(stripeEntry->storageId, stripeMetadata->id,
+							  stripeMetadata->rowCount, SnapshotSelf);
+		stripeEntry->pendingRowMask =
+			palloc0(COLUMNAR_ROW_MASK_SIZE(stripeMetadata->rowCount));
+		stripeEntry->rowMaskStack = NULL;
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	if (stripeEntry->committedRowMask != NULL &&
+		COLUMNAR_ROW_MASK_IS_SET(stripeEntry->committedRowMask, rowOffset))
+	{
+		*deletingCid = InvalidCommandId;
+		return false;
+	}
+
+	if (COLUMNAR_ROW_MASK_IS_SET(stripeEntry->pendingRowMask, rowOffset))
+	{
+		for (SubXidRowMask *rowMask = stripeEntry->rowMaskStack; rowMask != NULL;
+			 rowMask = rowMask->next)
+		{
+			if (COLUMNAR_ROW_MASK_IS_SET(rowMask->rowMask, rowOffset))
+			{
+				*deletingCid = rowMask->cid;
+				break;
+			}
+		}
+
+		return false;
+	}
+
+	SubXidRowMask *stackHead = stripeEntry->rowMaskStack;
+	if (stackHead == NULL || stackHead->subXid != currentSubXid ||
+		stackHead->cid != cid)
+	{
+		stackHead = MemoryContextAllocZero(WriteStateContext, sizeof(SubXidRowMask));
+		stackHead->subXid = currentSubXid;
+		stackHead->cid = cid;
+		stackHead->rowMask =
+			MemoryContextAllocZero(WriteStateContext,
+								   COLUMNAR_ROW_MASK_SIZE(stripeEntry->rowCount));
+		stackHead->next = stripeEntry->rowMaskStack;
+		stripeEntry->rowMaskStack = stackHead;
+	}
+
+	COLUMNAR_ROW_MASK_SET(stackHead->rowMask, rowOffset);
+	COLUMNAR_ROW_MASK_SET(stripeEntry->pendingRowMask, rowOffset);
+
+	return true;
+}
+
+
+/*
+ * ApplyPendingRowDeletions marks the rows of given stripe that are deleted by
+ * current transaction and that are visible to given snapshot as deleted in
+ * rowMask. If rowMask is NULL and any rows need to be marked, then it is
+ * allocated in current memory context.
+ *
+ * For MVCC snapshots, the deletions done by the commands that started after
+ * the snapshot was taken are not visible, similar to heap tables.
+ */
+void
+ApplyPendingRowDeletions(RelFileNumber relfilenumber, StripeMetadata *stripeMetadata,
+						 Snapshot snapshot, uint8 **rowMask)
+{
+	if (WriteStateMap == NULL)
+	{
+		return;
+	}
+
+	WriteStateMapEntry *entry = hash_search(WriteStateMap, &relfilenumber, HASH_FIND,
+											NULL);
+	if (entry == NULL || entry->dropped || entry->rowMaskMap == NULL)
+	{
+		return;
+	}
+
+	StripeRowMaskEntry *stripeEntry = hash_search(entry->rowMaskMap,
+												  &stripeMetadata->id,
+												  HASH_FIND, NULL);
+	if (stripeEntry == NULL)
+	{
+		return;
+	}
+
+	bool isMVCCSnapshot = snapshot != InvalidSnapshot && IsMVCCSnapshot(snapshot);
+	Size maskSize = COLUMNAR_ROW_MASK_SIZE(stripeEntry->rowCount);
+
+	for (SubXidRowMask *stackEntry = stripeEntry->rowMaskStack; stackEntry != NULL;
+		 stackEntry = stackEntry->next)
+	{
+		if (isMVCCSnapshot && stackEntry->cid >= snapshot->curcid)
+		{
+			continue;
+		}
+
+		if (*rowMask == NULL)
+		{
+			*rowMask = palloc0(maskSize);
+		}
+
+		for (Size byteIndex = 0; byteIndex < maskSize; byteIndex++)
+		{
+			(*rowMask)[byteIndex] |= stackEntry->rowMask[byteIndex];
+		}
+	}
+}
+
+
 /*
  * GetWriteContextForDebug exposes WriteStateContext for debugging
  * purposes.
@@ -18,16 +18,54 @@
 #include "catalog/pg_publication.h"
 #include "commands/extension.h"
 #include "common/hashfn.h"
+#include "utils/builtins.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/typcache.h"
 
+#include "pg_version_constants.h"
+
 PG_MODULE_MAGIC;
 
 extern void _PG_output_plugin_init(OutputPluginCallbacks *cb);
 static LogicalDecodeChangeCB ouputPluginChangeCB;
 
+typedef struct
+{
+	uint64 shardId;
+	Oid distributedTableId;
+	bool isReferenceTable;
+	bool isNull;
+
+	/*
+	 * Cached mapping from the attributes of the distributed table to the
+	 * attributes of the shard, built on the first change after a relcache
+	 * invalidation of either relation. attributeMap is NULL if the schemas
+	 * match and tuples can be published as is.
+	 */
+	bool attributeMapValid;
+	Oid shardRelationId;
+	int sourceNatts;
+	int targetNatts;
+	AttrNumber *attributeMap;
+
+	/*
+	 * Cached union of the actions that the publications of the replication slot
+	 * publish for the distributed table, such that changes which would be
+	 * discarded by the output plugin are not translated in the first place.
+	 */
+	bool publicationActionsValid;
+	PublicationActions publicationActions;
+} ShardIdHashEntry;
+
 static void InitShardToDistributedTableMap(void);
+static void ResetShardToDistributedTableMap(void *arg);
+static void InvalidateCdcShardCacheCallback(Datum argument, Oid relationId);
+static List * GetCdcPublicationNames(LogicalDecodingContext *ctx);
+static bool IsChangePublishedForCdc(LogicalDecodingContext *ctx, ShardIdHashEntry *entry,
+									ReorderBufferChange *change);
 
 static void PublishDistributedTableChanges(LogicalDecodingContext *ctx,
 										   ReorderBufferTXN *txn,
@@ -39,23 +77,29 @@ static bool replication_origin_filter_cb(LogicalDecodingContext *ctx, RepOriginI
 										 origin_id);
 
 static void TranslateChangesIfSchemaChanged(Relation relation, Relation targetRelation,
-											ReorderBufferChange *change);
+											ReorderBufferChange *change,
+											AttrNumber *attributeMap);
 
 static void TranslateAndPublishRelationForCDC(LogicalDecodingContext *ctx,
 											  ReorderBufferTXN *txn,
 											  Relation relation,
-											  ReorderBufferChange *change, Oid shardId,
-											  Oid targetRelationid);
+											  ReorderBufferChange *change,
+											  ShardIdHashEntry *entry);
+static AttrNumber * GetAttributeMapForCdc(ShardIdHashEntry *entry,
+										  Relation sourceRelation,
+										  Relation targetRelation);
 
-typedef struct
-{
-	uint64 shardId;
-	Oid distributedTableId;
-	bool isReferenceTable;
-	bool isNull;
-} ShardIdHashEntry;
 
 static HTAB *shardToDistributedTableMap = NULL;
+static MemoryContext shardToDistributedTableMapContext = NULL;
+static bool shardCacheCallbackRegistered = false;
+
+/*
+ * Publication names of the replication slot, parsed from the options of the
+ * pgoutput plugin on first use. cdcPublicationNamesParsed is false until then.
+ */
+static List *cdcPublicationNames = NIL;
+static bool cdcPublicationNamesParsed = false;
 
 static void cdc_change_cb(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 						  Relation relation, ReorderBufferChange *change);
@@ -193,6 +237,74 @@ InitShardToDistributedTableMap()
 	int hashFlags = (HASH_ELEM | HASH_CONTEXT | HASH_FUNCTION);
 	shardToDistributedTableMap = hash_create("CDC Decoder translation hash table", 1024,
 											 &info, hashFlags);
+	shardToDistributedTableMapContext = CurrentMemoryContext;
+
+	/* forget about the hash table when the decoding context goes away */
+	MemoryContextCallback *resetCallback =
+		MemoryContextAllocZero(CurrentMemoryContext, sizeof(MemoryContextCallback));
+	resetCallback->func = ResetShardToDistributedTableMap;
+	MemoryContextRegisterResetCallback(CurrentMemoryContext, resetCallback);
+
+	if (!shardCacheCallbackRegistered)
+	{
+		CacheRegisterRelcacheCallback(InvalidateCdcShardCacheCallback, (Datum) 0);
+		shardCacheCallbackRegistered = true;
+	}
+}
+
+
+/*
+ * ResetShardToDistributedTableMap is called when the memory context of the
+ * hash table is reset or deleted, such that the relcache callback no longer
+ * accesses it.
+ */
+static void
+ResetShardToDistributedTableMap(void *arg)
+{
+	shardToDistributedTableMap = NULL;
+	shardToDistributedTableMapContext = NULL;
+	cdcPublicationNames = NIL;
+	cdcPublicationNamesParsed = false;
+}
+
+
+/*
+ * InvalidateCdcShardCacheCallback discards the cached attribute maps and
+ * publication actions of the shards that belong to the given relation, or of
+ * all shards when the whole relcache is invalidated. Publication changes also
+ * invalidate the relcache entries of the published relations. The cached
+ * state is rebuilt on the next change.
+ */
+static void
+InvalidateCdcShardCacheCallback(Datum argument, Oid relationId)
+{
+	if (shardToDistributedTableMap == NULL)
+	{
+		return;
+	}
+
+	HASH_SEQ_STATUS status;
+	ShardIdHashEntry *entry = NULL;
+
+	hash_seq_init(&status, shardToDistributedTableMap);
+	while ((entry = (ShardIdHashEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (relationId != InvalidOid &&
+			entry->shardRelationId != relationId &&
+			entry->distributedTableId != relationId)
+		{
+			continue;
+		}
+
+		if (entry->attributeMap != NULL)
+		{
+			pfree(entry->attributeMap);
+			entry->attributeMap = NULL;
+		}
+
+		entry->attributeMapValid = false;
+		entry->publicationActionsValid = false;
+	}
 }
 
 
@@ -205,29 +317,34 @@ AddShardIdToHashTable(uint64 shardId, ShardIdHashEntry *entry)
 	entry->shardId = shardId;
 	entry->distributedTableId = CdcLookupShardRelationFromCatalog(shardId, true);
 	entry->isReferenceTable = CdcIsReferenceTableViaCatalog(entry->distributedTableId);
+	entry->attributeMapValid = false;
+	entry->shardRelationId = InvalidOid;
+	entry->sourceNatts = 0;
+	entry->targetNatts = 0;
+	entry->attributeMap = NULL;
+	entry->publicationActionsValid = false;
+	memset(&entry->publicationActions, 0, sizeof(PublicationActions));
 	return entry->distributedTableId;
 }
 
 
-static Oid
-LookupDistributedTableIdForShardId(uint64 shardId, bool *isReferenceTable)
+/*
+ * LookupDistributedTableEntryForShardId returns the hash table entry for the
+ * given shard, looking up the distributed table in the catalog on first use.
+ */
+static ShardIdHashEntry *
+LookupDistributedTableEntryForShardId(uint64 shardId)
 {
 	bool found;
-	Oid distributedTableId = InvalidOid;
 	ShardIdHashEntry *entry = (ShardIdHashEntry *) hash_search(shardToDistributedTableMap,
 															   &shardId,
 															   HASH_ENTER,
 															   &found);
-	if (found)
-	{
-		distributedTableId = entry->distributedTableId;
-	}
-	else
+	if (!found)
 	{
-		distributedTableId = AddShardIdToHashTable(shardId, entry);
+		AddShardIdToHashTable(shardId, entry);
 	}
-	*isReferenceTable = entry->isReferenceTable;
-	return distributedTableId;
+	return entry;
 }
 
 
@@ -253,17 +370,21 @@ replication_origin_filter_cb(LogicalDecodingContext *ctx, RepOriginId origin_id)
  */
 static void
 TranslateAndPublishRelationForCDC(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
-								  Relation relation, ReorderBufferChange *change, Oid
-								  shardId, Oid targetRelationid)
+								  Relation relation, ReorderBufferChange *change,
+								  ShardIdHashEntry *entry)
 {
 	/* Get the distributed table's relation for this shard.*/
-	Relation targetRelation = RelationIdGetRelation(targetRelationid);
+	Relation targetRelation = RelationIdGetRelation(entry->distributedTableId);
 
 	/*
-	 * Check if there has been a schema change (such as a dropped column), by comparing
-	 * the number of attributes in the shard table and the shell table.
+	 * Check if there has been a schema change (such as a dropped column), using the
+	 * attribute map that is cached for the shard until either relation changes.
 	 */
-	TranslateChangesIfSchemaChanged(relation, targetRelation, change);
+	AttrNumber *attributeMap = GetAttributeMapForCdc(entry, relation, targetRelation);
+	if (attributeMap != NULL)
+	{
+		TranslateChangesIfSchemaChanged(relation, targetRelation, change, attributeMap);
+	}
 
 	/*
 	 * Publish the change to the shard table as the change in the distributed table,
@@ -302,37 +423,191 @@ PublishDistributedTableChanges(LogicalDecodingContext *ctx, ReorderBufferTXN *tx
 		return;
 	}
 
-	bool isReferenceTable = false;
-	Oid distRelationId = LookupDistributedTableIdForShardId(shardId, &isReferenceTable);
-	if (distRelationId == InvalidOid)
+	ShardIdHashEntry *entry = LookupDistributedTableEntryForShardId(shardId);
+	if (entry->distributedTableId == InvalidOid)
 	{
 		ouputPluginChangeCB(ctx, txn, relation, change);
 		return;
 	}
 
 	/* Publish changes for reference table only from the coordinator node. */
-	if (isReferenceTable && !CdcIsCoordinator())
+	if (entry->isReferenceTable && !CdcIsCoordinator())
+	{
+		return;
+	}
+
+	/*
+	 * Skip changes that the publications do not publish for the distributed table.
+	 * Row filters and column lists of the publications are applied by the output
+	 * plugin, since the change is published for the distributed table.
+	 */
+	if (!IsChangePublishedForCdc(ctx, entry, change))
 	{
 		return;
 	}
 
 	/* translate and publish from shard relation to distributed table relation for CDC. */
-	TranslateAndPublishRelationForCDC(ctx, txn, relation, change, shardId,
-									  distRelationId);
+	TranslateAndPublishRelationForCDC(ctx, txn, relation, change, entry);
+}
+
+
+/*
+ * GetCdcPublicationNames returns the names of the publications that the
+ * replication slot is decoded for, or NIL if the base decoder does not take
+ * publication names.
+ */
+static List *
+GetCdcPublicationNames(LogicalDecodingContext *ctx)
+{
+	if (cdcPublicationNamesParsed)
+	{
+		return cdcPublicationNames;
+	}
+
+	/* only pgoutput filters changes by publication */
+	if (strcmp(DECODER, "pgoutput") != 0)
+	{
+		cdcPublicationNamesParsed = true;
+		return NIL;
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(shardToDistributedTableMapContext);
+
+	ListCell *optionCell = NULL;
+	foreach(optionCell, ctx->output_plugin_options)
+	{
+		DefElem *option = (DefElem *) lfirst(optionCell);
+
+		if (strcmp(option->defname, "publication_names") != 0 || option->arg == NULL)
+		{
+			continue;
+		}
+
+		/* pgoutput errors out on invalid publication names, so we do not filter */
+		char *publicationNames = pstrdup(strVal(option->arg));
+		if (!SplitIdentifierString(publicationNames, ',', &cdcPublicationNames))
+		{
+			cdcPublicationNames = NIL;
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	cdcPublicationNamesParsed = true;
+	return cdcPublicationNames;
+}
+
+
+/*
+ * IsChangePublishedForCdc returns whether any of the publications of the
+ * replication slot publishes the action of the change for the distributed
+ * table of the shard. The union of the published actions is cached in the
+ * hash table entry until the distributed table is invalidated.
+ */
+static bool
+IsChangePublishedForCdc(LogicalDecodingContext *ctx, ShardIdHashEntry *entry,
+						ReorderBufferChange *change)
+{
+	List *publicationNames = GetCdcPublicationNames(ctx);
+	if (publicationNames == NIL)
+	{
+		return true;
+	}
+
+	if (!entry->publicationActionsValid)
+	{
+		Oid distributedTableId = entry->distributedTableId;
+		PublicationActions *publicationActions = &entry->publicationActions;
+
+		memset(publicationActions, 0, sizeof(PublicationActions));
+
+		/*
+		 * Partitions may be published via their ancestors, which we leave to
+		 * the output plugin to figure out.
+		 */
+		if (get_rel_relispartition(distributedTableId))
+		{
+			publicationActions->pubinsert = true;
+			publicationActions->pubupdate = true;
+			publicationActions->pubdelete = true;
+		}
+		else
+		{
+			List *relationPublications = GetRelationPublications(distributedTableId);
+#if PG_VERSION_NUM >= PG_VERSION_15
+			List *schemaPublications =
+				GetSchemaPublications(get_rel_namespace(distributedTableId));
+#endif
+
+			ListCell *publicationNameCell = NULL;
+			foreach(publicationNameCell, publicationNames)
+			{
+				char *publicationName = (char *) lfirst(publicationNameCell);
+				bool missingOk = true;
+				Publication *publication = GetPublicationByName(publicationName,
+																missingOk);
+				if (publication == NULL)
+				{
+					continue;
+				}
+
+				bool isPublished = publication->alltables ||
+								   list_member_oid(relationPublications,
+												   publication->oid);
+#if PG_VERSION_NUM >= PG_VERSION_15
+				isPublished = isPublished ||
+							  list_member_oid(schemaPublications, publication->oid);
+#endif
+
+				if (isPublished)
+				{
+					publicationActions->pubinsert |= publication->pubactions.pubinsert;
+					publicationActions->pubupdate |= publication->pubactions.pubupdate;
+					publicationActions->pubdelete |= publication->pubactions.pubdelete;
+				}
+			}
+		}
+
+		entry->publicationActionsValid = true;
+	}
+
+	switch (change->action)
+	{
+		case REORDER_BUFFER_CHANGE_INSERT:
+		{
+			return entry->publicationActions.pubinsert;
+		}
+
+		case REORDER_BUFFER_CHANGE_UPDATE:
+		{
+			return entry->publicationActions.pubupdate;
+		}
+
+		case REORDER_BUFFER_CHANGE_DELETE:
+		{
+			return entry->publicationActions.pubdelete;
+		}
+
+		default:
+		{
+			return true;
+		}
+	}
 }
 
 
 /*
  * GetTupleForTargetSchemaForCdc returns a heap tuple with the data from sourceRelationTuple
  * to match the schema in targetRelDesc. Either or both source and target relations may have
- * dropped columns. This function handles it by adding NULL values for dropped columns in
- * target relation and skipping dropped columns in source relation. It returns a heap tuple
- * adjusted to the current schema of the target relation.
+ * dropped columns, which is handled by attributeMap: for every attribute of the target
+ * relation it holds the attribute number of the source relation to copy, or 0 to add a
+ * NULL value. It returns a heap tuple adjusted to the current schema of the target relation.
  */
 static HeapTuple
 GetTupleForTargetSchemaForCdc(HeapTuple sourceRelationTuple,
 							  TupleDesc sourceRelDesc,
-							  TupleDesc targetRelDesc)
+							  TupleDesc targetRelDesc,
+							  AttrNumber *attributeMap)
 {
 	/* Allocate memory for sourceValues and sourceNulls arrays. */
 	Datum *sourceValues = (Datum *) palloc0(sourceRelDesc->natts * sizeof(Datum));
@@ -342,54 +617,34 @@ GetTupleForTargetSchemaForCdc(HeapTuple sourceRelationTuple,
 	heap_deform_tuple(sourceRelationTuple, sourceRelDesc, sourceValues,
 					  sourceNulls);
 
-	/* This is the next field to Read in the source relation */
-	uint32 sourceIndex = 0;
-	uint32 targetIndex = 0;
-
-	/* Allocate memory for sourceValues and sourceNulls arrays. */
+	/* Allocate memory for targetValues and targetNulls arrays. */
 	Datum *targetValues = (Datum *) palloc0(targetRelDesc->natts * sizeof(Datum));
 	bool *targetNulls = (bool *) palloc0(targetRelDesc->natts * sizeof(bool));
 
-	/* Loop through all source and target attributes one by one and handle any dropped attributes.*/
-	while (targetIndex < targetRelDesc->natts)
+	for (int targetIndex = 0; targetIndex < targetRelDesc->natts; targetIndex++)
 	{
-		/* If this target attribute has been dropped, add a NULL attribute in targetValues and continue.*/
-		if (TupleDescAttr(targetRelDesc, targetIndex)->attisdropped)
+		AttrNumber sourceAttrNumber = attributeMap[targetIndex];
+		if (sourceAttrNumber == InvalidAttrNumber)
 		{
-			Datum nullDatum = (Datum) 0;
-			targetValues[targetIndex] = nullDatum;
+			targetValues[targetIndex] = (Datum) 0;
 			targetNulls[targetIndex] = true;
-			targetIndex++;
-		}
-
-		/* If this source attribute has been dropped, just skip this source attribute.*/
-		else if (TupleDescAttr(sourceRelDesc, sourceIndex)->attisdropped)
-		{
-			sourceIndex++;
-			continue;
-		}
-
-		/* If both source and target attributes are not dropped, add the attribute field to targetValues. */
-		else if (sourceIndex < sourceRelDesc->natts)
-		{
-			targetValues[targetIndex] = sourceValues[sourceIndex];
-			targetNulls[targetIndex] = sourceNulls[sourceIndex];
-			sourceIndex++;
-			targetIndex++;
 		}
 		else
 		{
-			/* If there are no more source fields, add a NULL field in targetValues. */
-			Datum nullDatum = (Datum) 0;
-			targetValues[targetIndex] = nullDatum;
-			targetNulls[targetIndex] = true;
-			targetIndex++;
+			targetValues[targetIndex] = sourceValues[sourceAttrNumber - 1];
+			targetNulls[targetIndex] = sourceNulls[sourceAttrNumber - 1];
 		}
 	}
 
 	/* Form a new tuple from the target values created by the above loop. */
 	HeapTuple targetRelationTuple = heap_form_tuple(targetRelDesc, targetValues,
 													targetNulls);
+
+	pfree(sourceValues);
+	pfree(sourceNulls);
+	pfree(targetValues);
+	pfree(targetNulls);
+
 	return targetRelationTuple;
 }
 
@@ -418,23 +673,92 @@ HasSchemaChanged(TupleDesc sourceRelationDesc, TupleDesc targetRelationDesc)
 }
 
 
+/*
+ * GetAttributeMapForCdc returns the mapping from the attributes of the target
+ * relation to the attributes of the source relation, or NULL if the schemas
+ * match. The mapping is computed once and kept in the hash table entry of the
+ * shard until a relcache invalidation of the shard or the distributed table,
+ * such that changes to the same shard do not compare the tuple descriptors
+ * over and over again.
+ */
+static AttrNumber *
+GetAttributeMapForCdc(ShardIdHashEntry *entry, Relation sourceRelation,
+					  Relation targetRelation)
+{
+	TupleDesc sourceRelDesc = RelationGetDescr(sourceRelation);
+	TupleDesc targetRelDesc = RelationGetDescr(targetRelation);
+
+	if (entry->attributeMapValid &&
+		entry->shardRelationId == RelationGetRelid(sourceRelation) &&
+		entry->sourceNatts == sourceRelDesc->natts &&
+		entry->targetNatts == targetRelDesc->natts)
+	{
+		return entry->attributeMap;
+	}
+
+	if (entry->attributeMap != NULL)
+	{
+		pfree(entry->attributeMap);
+		entry->attributeMap = NULL;
+	}
+
+	entry->shardRelationId = RelationGetRelid(sourceRelation);
+	entry->sourceNatts = sourceRelDesc->natts;
+	entry->targetNatts = targetRelDesc->natts;
+	entry->attributeMapValid = true;
+
+	/* if there are no changes between source and target relations, no map is needed */
+	if (!HasSchemaChanged(sourceRelDesc, targetRelDesc))
+	{
+		return NULL;
+	}
+
+	AttrNumber *attributeMap =
+		MemoryContextAllocZero(shardToDistributedTableMapContext,
+							   targetRelDesc->natts * sizeof(AttrNumber));
+
+	/*
+	 * Loop through all target attributes and match them to the next source
+	 * attribute that has not been dropped. Dropped target attributes and target
+	 * attributes without a source attribute are left as InvalidAttrNumber.
+	 */
+	int sourceIndex = 0;
+	for (int targetIndex = 0; targetIndex < targetRelDesc->natts; targetIndex++)
+	{
+		if (TupleDescAttr(targetRelDesc, targetIndex)->attisdropped)
+		{
+			continue;
+		}
+
+		while (sourceIndex < sourceRelDesc->natts &&
+			   TupleDescAttr(sourceRelDesc, sourceIndex)->attisdropped)
+		{
+			sourceIndex++;
+		}
+
+		if (sourceIndex < sourceRelDesc->natts)
+		{
+			attributeMap[targetIndex] = sourceIndex + 1;
+			sourceIndex++;
+		}
+	}
+
+	entry->attributeMap = attributeMap;
+	return attributeMap;
+}
+
+
 /*
  * TranslateChangesIfSchemaChanged translates the tuples ReorderBufferChange
- * if there is a schema change between source and target relations.
+ * using the attribute map of a schema change between source and target relations.
  */
 static void
 TranslateChangesIfSchemaChanged(Relation sourceRelation, Relation targetRelation,
-								ReorderBufferChange *change)
+								ReorderBufferChange *change, AttrNumber *attributeMap)
 {
 	TupleDesc sourceRelationDesc = RelationGetDescr(sourceRelation);
 	TupleDesc targetRelationDesc = RelationGetDescr(targetRelation);
 
-	/* if there are no changes between source and target relations, return. */
-	if (!HasSchemaChanged(sourceRelationDesc, targetRelationDesc))
-	{
-		return;
-	}
-
 	/* Check the ReorderBufferChange's action type and handle them accordingly.*/
 	switch (change->action)
 	{
@@ -443,7 +767,8 @@ TranslateChangesIfSchemaChanged(Relation sourceRelation, Relation targetRelation
 			/* For insert action, only new tuple should always be translated*/
 			HeapTuple sourceRelationNewTuple = &(change->data.tp.newtuple->tuple);
 			HeapTuple targetRelationNewTuple = GetTupleForTargetSchemaForCdc(
-				sourceRelationNewTuple, sourceRelationDesc, targetRelationDesc);
+				sourceRelationNewTuple, sourceRelationDesc, targetRelationDesc,
+				attributeMap);
 			change->data.tp.newtuple->tuple = *targetRelationNewTuple;
 			break;
 		}
@@ -459,7 +784,8 @@ TranslateChangesIfSchemaChanged(Relation sourceRelation, Relation targetRelation
 			/* Get the new tuple from the ReorderBufferChange, and translate it to target relation. */
 			HeapTuple sourceRelationNewTuple = &(change->data.tp.newtuple->tuple);
 			HeapTuple targetRelationNewTuple = GetTupleForTargetSchemaForCdc(
-				sourceRelationNewTuple, sourceRelationDesc, targetRelationDesc);
+				sourceRelationNewTuple, sourceRelationDesc, targetRelationDesc,
+				attributeMap);
 			change->data.tp.newtuple->tuple = *targetRelationNewTuple;
 
 			/*
@@ -473,7 +799,8 @@ TranslateChangesIfSchemaChanged(Relation sourceRelation, Relation targetRelation
 				HeapTuple targetRelationOldTuple = GetTupleForTargetSchemaForCdc(
 					sourceRelationOldTuple,
 					sourceRelationDesc,
-					targetRelationDesc);
+					targetRelationDesc,
+					attributeMap);
 
 				change->data.tp.oldtuple->tuple = *targetRelationOldTuple;
 			}
@@ -487,7 +814,8 @@ TranslateChangesIfSchemaChanged(Relation sourceRelation, Relation targetRelation
 			HeapTuple targetRelationOldTuple = GetTupleForTargetSchemaForCdc(
 				sourceRelationOldTuple,
 				sourceRelationDesc,
-				targetRelationDesc);
+				targetRelationDesc,
+				attributeMap);
 
 			change->data.tp.oldtuple->tuple = *targetRelationOldTuple;
 			break;
@@ -90,8 +90,10 @@ static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 static LogicalClockShmemData *LogicalClockShmem = NULL;
 static void AdjustLocalClock(ClusterClock *remoteClock);
 static void GetNextNodeClockValue(ClusterClock *nextClusterClockValue);
-static ClusterClock * GetHighestClockInTransaction(List *nodeConnectionList);
+static ClusterClock * GetHighestClockInTransaction(List *nodeConnectionList,
+												   List **nodeClockList);
 static void AdjustClocksToTransactionHighest(List *nodeConnectionList,
+											 List *nodeClockList,
 											 ClusterClock *transactionClockValue);
 static void InitClockAtFirstUse(void);
 static void IncrementClusterClock(ClusterClock *clusterClock);
@@ -322,9 +324,12 @@ AdjustLocalClock(ClusterClock *remoteClock)
  * current transaction and polls the logical clock value of all the nodes. Returns the
  * highest logical clock value of all the nodes in the current distributed transaction,
  * which may be used as commit order for individual objects in the transaction.
+ *
+ * The clock value of each node is returned in nodeClockList, in the order of
+ * nodeConnectionList.
  */
 static ClusterClock *
-GetHighestClockInTransaction(List *nodeConnectionList)
+GetHighestClockInTransaction(List *nodeConnectionList, List **nodeClockList)
 {
 	MultiConnection *connection = NULL;
 
@@ -373,6 +378,7 @@ GetHighestClockInTransaction(List *nodeConnectionList)
 								nodeClockValue->counter)));
 
 		globalClockValue = LargerClock(globalClockValue, nodeClockValue);
+		*nodeClockList = lappend(*nodeClockList, nodeClockValue);
 
 		PQclear(result);
 		ForgetResults(connection);
@@ -388,12 +394,29 @@ GetHighestClockInTransaction(List *nodeConnectionList)
 /*
  * AdjustClocksToTransactionHighest Sets the clock value of all the nodes, participated
  * in the PREPARE of the transaction, to the highest clock value of all the nodes.
+ *
+ * Nodes that returned the highest clock value already moved to it, so only the
+ * nodes behind the highest clock are sent the adjustment. For a transaction
+ * that involves a single remote node with a clock ahead of the local one, this
+ * saves the second round trip altogether.
  */
 static void
-AdjustClocksToTransactionHighest(List *nodeConnectionList,
+AdjustClocksToTransactionHighest(List *nodeConnectionList, List *nodeClockList,
 								 ClusterClock *transactionClockValue)
 {
 	StringInfo queryToSend = makeStringInfo();
+	List *laggingConnectionList = NIL;
+
+	MultiConnection *connection = NULL;
+	ClusterClock *nodeClockValue = NULL;
+	forboth_ptr(connection, nodeConnectionList, nodeClockValue, nodeClockList)
+	{
+		if (nodeClockValue == NULL ||
+			cluster_clock_cmp_internal(nodeClockValue, transactionClockValue) < 0)
+		{
+			laggingConnectionList = lappend(laggingConnectionList, connection);
+		}
+	}
 
 	/* Set the clock value on participating worker nodes */
 	appendStringInfo(queryToSend,
@@ -401,7 +424,7 @@ AdjustClocksToTransactionHighest(List *nodeConnectionList,
 					 "('(%lu, %u)'::pg_catalog.cluster_clock);",
 					 transactionClockValue->logical, transactionClockValue->counter);
 
-	ExecuteRemoteCommandInConnectionList(nodeConnectionList, queryToSend->data);
+	ExecuteRemoteCommandInConnectionList(laggingConnectionList, queryToSend->data);
 	AdjustLocalClock(transactionClockValue);
 }
 
@@ -453,11 +476,13 @@ PrepareAndSetTransactionClock(void)
 	}
 
 	/* Pick the highest logical clock value among all transaction-nodes */
+	List *nodeClockList = NIL;
 	ClusterClock *transactionClockValue =
-		GetHighestClockInTransaction(transactionNodeList);
+		GetHighestClockInTransaction(transactionNodeList, &nodeClockList);
 
 	/* Adjust all the nodes with the new clock value */
-	AdjustClocksToTransactionHighest(transactionNodeList, transactionClockValue);
+	AdjustClocksToTransactionHighest(transactionNodeList, nodeClockList,
+									 transactionClockValue);
 
 	return transactionClockValue;
 }
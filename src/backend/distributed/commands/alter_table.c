@@ -64,6 +64,7 @@
 #include "distributed/reference_table_utils.h"
 #include "distributed/relation_access_tracking.h"
 #include "distributed/replication_origin_session_utils.h"
+#include "distributed/shard_rebalancer.h"
 #include "distributed/shard_utils.h"
 #include "distributed/shared_library_init.h"
 #include "distributed/tenant_schema_metadata.h"
@@ -226,6 +227,7 @@ static TableConversionReturn * CopyTableConversionReturnIntoCurrentContext(
 
 PG_FUNCTION_INFO_V1(undistribute_table);
 PG_FUNCTION_INFO_V1(alter_distributed_table);
+PG_FUNCTION_INFO_V1(alter_distributed_table_concurrently);
 PG_FUNCTION_INFO_V1(alter_table_set_access_method);
 PG_FUNCTION_INFO_V1(worker_change_sequence_dependency);
 
@@ -321,6 +323,150 @@ alter_distributed_table(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * alter_distributed_table_concurrently increases the shard count of a hash
+ * distributed table and its co-located tables without blocking writes for
+ * the duration of a rewrite. Instead of creating a new table and copying
+ * the data via INSERT .. SELECT, it splits each shard into equal hash ranges
+ * on the node of the shard, such that each split copies the data of a shard
+ * via logical replication and blocks writes only to switch over. Each split
+ * runs in a transaction of its own, like the moves of the rebalancer.
+ *
+ * Only increasing the shard count to a multiple of the current one is
+ * supported, since the new shards need to cover the ranges of the old ones.
+ */
+Datum
+alter_distributed_table_concurrently(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+
+	PreventInTransactionBlock(true, "alter_distributed_table_concurrently");
+
+	Oid relationId = PG_GETARG_OID(0);
+	int shardCount = PG_GETARG_INT32(1);
+	Oid shardTransferModeOid = PG_GETARG_OID(2);
+
+	EnsureTableOwner(relationId);
+
+	if (!IsCitusTableType(relationId, HASH_DISTRIBUTED))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("alter_distributed_table_concurrently is only "
+							   "supported for hash distributed tables")));
+	}
+
+	if (shardCount < 1 || shardCount > MAX_SHARD_COUNT)
+	{
+		ereport(ERROR, (errmsg("%d is outside the valid range for "
+							   "parameter \"shard_count\" (1 .. %d)",
+							   shardCount, MAX_SHARD_COUNT)));
+	}
+
+	/* prevent concurrent moves and rebalances of the co-located shards */
+	AcquireRebalanceColocationLock(relationId, "alter_distributed_table_concurrently");
+
+	List *shardIntervalList = LoadShardIntervalList(relationId);
+	int currentShardCount = list_length(shardIntervalList);
+
+	if (shardCount <= currentShardCount || shardCount % currentShardCount != 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("shard count of %s can only be increased to a multiple "
+							   "of its current shard count %d concurrently",
+							   generate_qualified_relation_name(relationId),
+							   currentShardCount),
+						errhint("Use alter_distributed_table to change the shard "
+								"count to other values.")));
+	}
+
+	int splitCount = shardCount / currentShardCount;
+	List *colocatedTableList = ColocatedTableList(relationId);
+
+	if (list_length(colocatedTableList) > 1)
+	{
+		ereport(NOTICE, (errmsg("changing the shard count of %d co-located tables",
+								list_length(colocatedTableList))));
+	}
+
+	/* read the metadata we need before splitting, which invalidates it */
+	CitusTableCacheEntry *cacheEntry = GetCitusTableCacheEntry(relationId);
+	uint32 colocationId = cacheEntry->colocationId;
+	Oid distributionColumnType = cacheEntry->partitionColumn->vartype;
+	Oid distributionColumnCollation = cacheEntry->partitionColumn->varcollid;
+	int replicationFactor = TableShardReplicationFactor(relationId);
+
+	Datum transferModeLabelDatum = DirectFunctionCall1(enum_out, shardTransferModeOid);
+	char *transferModeLabel = DatumGetCString(transferModeLabelDatum);
+	List *splitCommandList = NIL;
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		int32 minValue = DatumGetInt32(shardInterval->minValue);
+		int32 maxValue = DatumGetInt32(shardInterval->maxValue);
+		int64 rangeSize = (int64) maxValue - (int64) minValue + 1;
+
+		ShardPlacement *placement = ActiveShardPlacement(shardInterval->shardId, false);
+
+		StringInfo splitPoints = makeStringInfo();
+		StringInfo nodeIds = makeStringInfo();
+
+		for (int splitIndex = 0; splitIndex < splitCount; splitIndex++)
+		{
+			if (splitIndex > 0)
+			{
+				appendStringInfoString(nodeIds, ",");
+			}
+
+			appendStringInfo(nodeIds, "%u", placement->nodeId);
+
+			if (splitIndex < splitCount - 1)
+			{
+				int64 splitPoint = minValue + rangeSize * (splitIndex + 1) / splitCount - 1;
+
+				appendStringInfo(splitPoints, "%s'" INT64_FORMAT "'",
+								 splitIndex > 0 ? "," : "", splitPoint);
+			}
+		}
+
+		splitCommandList = lappend(splitCommandList, psprintf(
+									   "SELECT pg_catalog.citus_split_shard_by_split_points("
+									   UINT64_FORMAT ", ARRAY[%s], ARRAY[%s], %s)",
+									   shardInterval->shardId, splitPoints->data,
+									   nodeIds->data,
+									   quote_literal_cstr(transferModeLabel)));
+	}
+
+	char *splitCommand = NULL;
+	foreach_ptr(splitCommand, splitCommandList)
+	{
+		ExecuteRebalancerCommandInSeparateTransaction(splitCommand);
+	}
+
+	/*
+	 * The tables now have more shards than their co-location group says, so
+	 * move them into a new group with the new shard count. The shards of
+	 * tables created later with the new count and default co-location are
+	 * then created with the same hash ranges.
+	 */
+	uint32 newColocationId = CreateColocationGroup(shardCount, replicationFactor,
+												   distributionColumnType,
+												   distributionColumnCollation);
+
+	Oid colocatedTableId = InvalidOid;
+	foreach_oid(colocatedTableId, colocatedTableList)
+	{
+		bool localOnly = false;
+		UpdateRelationColocationGroup(colocatedTableId, newColocationId, localOnly);
+	}
+
+	DeleteColocationGroupIfNoTablesBelong(colocationId);
+
+	PG_RETURN_VOID();
+}
+
+
 /*
  * alter_table_set_access_method gets a distributed table and an access
  * method and changes table's access method into that.
@@ -15,14 +15,21 @@
 #include "funcapi.h"
 #include "miscadmin.h"
 
+#include "access/xact.h"
 #include "catalog/pg_proc.h"
+#include "catalog/pg_type.h"
 #include "commands/defrem.h"
+#include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/parsenodes.h"
 #include "nodes/primnodes.h"
 #include "optimizer/clauses.h"
 #include "tcop/dest.h"
+#include "utils/acl.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
 #include "utils/lsyscache.h"
+#include "utils/regproc.h"
 #include "utils/syscache.h"
 
 #include "pg_version_constants.h"
@@ -37,6 +44,7 @@
 #include "distributed/connection_management.h"
 #include "distributed/deparse_shard_query.h"
 #include "distributed/function_call_delegation.h"
+#include "distributed/listutils.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/metadata_utility.h"
 #include "distributed/multi_executor.h"
@@ -50,9 +58,31 @@
 #include "distributed/worker_manager.h"
 
 
+/*
+ * ProcedureBatchNode keeps the CALL commands of a procedure batch that are
+ * sent to the same node.
+ */
+typedef struct ProcedureBatchNode
+{
+	int32 groupId;
+	ShardPlacement *placement;
+	StringInfo callCommands;
+} ProcedureBatchNode;
+
+
+static ShardPlacement * ProcedureBatchPlacement(DistObjectCacheEntry *procedure,
+												CitusTableCacheEntry *distTable,
+												Oid argumentType, char *argumentText);
+static void AppendProcedureBatchCall(StringInfo callCommands, Oid procedureId,
+									 Oid *argumentTypes, int argumentCount,
+									 Datum *argumentArray, bool *argumentNulls);
+
+
 /* global variable tracking whether we are in a delegated procedure call */
 bool InDelegatedProcedureCall = false;
 
+PG_FUNCTION_INFO_V1(citus_call_procedure_batch);
+
 
 /*
  * CallDistributedProcedureRemotely calls a stored procedure on the worker if possible.
@@ -86,7 +116,7 @@ CallDistributedProcedureRemotely(CallStmt *callStmt, DestReceiver *dest)
 		return false;
 	}
 
-	Oid colocatedRelationId = ColocatedTableId(procedure->colocationId);
+	Oid colocatedRelationId = DistributedFunctionColocatedTableId(procedure);
 	if (colocatedRelationId == InvalidOid)
 	{
 		ereport(DEBUG1, (errmsg("stored procedure does not have co-located tables")));
@@ -225,3 +255,300 @@ CallDistributedProcedureRemotely(CallStmt *callStmt, DestReceiver *dest)
 
 	return true;
 }
+
+
+/*
+ * citus_call_procedure_batch calls a distributed procedure once for every row
+ * of a text array, where each row holds the arguments of a call. Rather than
+ * delegating every call separately, the calls are grouped by the node that
+ * stores the shard of their distribution argument, and each node runs its
+ * calls in a single command, such that the batch needs one round trip per
+ * node.
+ *
+ * The calls on a node run in a single transaction on that node, which means
+ * the procedure cannot commit or roll back. Any OUT arguments are discarded.
+ * The function returns the number of calls.
+ */
+Datum
+citus_call_procedure_batch(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	Oid procedureId = PG_GETARG_OID(0);
+	ArrayType *callArguments = PG_GETARG_ARRAYTYPE_P(1);
+
+	PreventInTransactionBlock(true, "citus_call_procedure_batch");
+
+	if (get_func_prokind(procedureId) != PROKIND_PROCEDURE)
+	{
+		ereport(ERROR, (errmsg("%s is not a procedure",
+							   format_procedure(procedureId))));
+	}
+
+	AclResult aclResult = object_aclcheck(ProcedureRelationId, procedureId,
+										  GetUserId(), ACL_EXECUTE);
+	if (aclResult != ACLCHECK_OK)
+	{
+		aclcheck_error(aclResult, OBJECT_PROCEDURE, get_func_name(procedureId));
+	}
+
+	DistObjectCacheEntry *procedure = LookupDistObjectCacheEntry(ProcedureRelationId,
+																 procedureId, 0);
+	if (procedure == NULL || !procedure->isDistributed)
+	{
+		ereport(ERROR, (errmsg("procedure %s is not distributed",
+							   format_procedure(procedureId)),
+						errhint("Use create_distributed_function() to distribute "
+								"the procedure.")));
+	}
+
+	Oid colocatedRelationId = DistributedFunctionColocatedTableId(procedure);
+	if (colocatedRelationId == InvalidOid)
+	{
+		ereport(ERROR, (errmsg("procedure %s does not have co-located tables",
+							   format_procedure(procedureId))));
+	}
+
+	Oid *argumentTypes = NULL;
+	int argumentCount = 0;
+	get_func_signature(procedureId, &argumentTypes, &argumentCount);
+
+	CitusTableCacheEntry *distTable = GetCitusTableCacheEntry(colocatedRelationId);
+
+	/* calls of procedures co-located with a single shard do not need routing */
+	bool routeByDistributionArgument =
+		IsCitusTableTypeCacheEntry(distTable, HASH_DISTRIBUTED);
+	if (routeByDistributionArgument &&
+		(procedure->distributionArgIndex < 0 ||
+		 procedure->distributionArgIndex >= argumentCount))
+	{
+		ereport(ERROR, (errmsg("cannot call procedure with invalid "
+							   "distribution_argument_index")));
+	}
+
+	int callArgumentsDimensions = ARR_NDIM(callArguments);
+	if (callArgumentsDimensions == 0)
+	{
+		PG_RETURN_INT64(0);
+	}
+	else if (argumentCount == 0)
+	{
+		ereport(ERROR, (errmsg("procedure %s does not have arguments",
+							   format_procedure(procedureId))));
+	}
+	else if (callArgumentsDimensions == 1 && argumentCount != 1)
+	{
+		ereport(ERROR, (errmsg("call arguments must be a two-dimensional array "
+							   "for a procedure with %d arguments", argumentCount)));
+	}
+	else if (callArgumentsDimensions == 2 &&
+			 ARR_DIMS(callArguments)[1] != argumentCount)
+	{
+		ereport(ERROR, (errmsg("every row of the call arguments must have %d "
+							   "elements", argumentCount)));
+	}
+	else if (callArgumentsDimensions > 2)
+	{
+		ereport(ERROR, (errmsg("call arguments must be a two-dimensional array")));
+	}
+
+	Datum *argumentArray = NULL;
+	bool *argumentNulls = NULL;
+	int elementCount = 0;
+	deconstruct_array(callArguments, TEXTOID, -1, false, TYPALIGN_INT,
+					  &argumentArray, &argumentNulls, &elementCount);
+
+	int callCount = elementCount / argumentCount;
+	int distributionArgIndex = procedure->distributionArgIndex;
+	List *batchNodeList = NIL;
+
+	for (int callIndex = 0; callIndex < callCount; callIndex++)
+	{
+		Datum *callArgumentArray = argumentArray + callIndex * argumentCount;
+		bool *callArgumentNulls = argumentNulls + callIndex * argumentCount;
+
+		ShardPlacement *placement = NULL;
+		if (!routeByDistributionArgument)
+		{
+			placement = ProcedureBatchPlacement(procedure, distTable, InvalidOid,
+												NULL);
+		}
+		else if (callArgumentNulls[distributionArgIndex])
+		{
+			ereport(ERROR, (errmsg("distribution argument of call %d cannot be NULL",
+								   callIndex + 1)));
+		}
+		else
+		{
+			char *distributionArgText =
+				TextDatumGetCString(callArgumentArray[distributionArgIndex]);
+			placement = ProcedureBatchPlacement(procedure, distTable,
+												argumentTypes[distributionArgIndex],
+												distributionArgText);
+		}
+
+		if (placement == NULL)
+		{
+			ereport(ERROR, (errmsg("could not find a placement for call %d",
+								   callIndex + 1)));
+		}
+
+		ProcedureBatchNode *batchNode = NULL;
+		ProcedureBatchNode *existingBatchNode = NULL;
+		foreach_ptr(existingBatchNode, batchNodeList)
+		{
+			if (existingBatchNode->groupId == placement->groupId)
+			{
+				batchNode = existingBatchNode;
+				break;
+			}
+		}
+
+		if (batchNode == NULL)
+		{
+			WorkerNode *workerNode = FindWorkerNode(placement->nodeName,
+													placement->nodePort);
+			if (workerNode == NULL ||
+				(workerNode->groupId != GetLocalGroupId() &&
+				 (!workerNode->hasMetadata || !workerNode->metadataSynced)))
+			{
+				ereport(ERROR, (errmsg("node %s:%d does not have metadata",
+									   placement->nodeName, placement->nodePort)));
+			}
+
+			batchNode = palloc0(sizeof(ProcedureBatchNode));
+			batchNode->groupId = placement->groupId;
+			batchNode->placement = placement;
+			batchNode->callCommands = makeStringInfo();
+
+			batchNodeList = lappend(batchNodeList, batchNode);
+		}
+
+		AppendProcedureBatchCall(batchNode->callCommands, procedureId, argumentTypes,
+								 argumentCount, callArgumentArray, callArgumentNulls);
+	}
+
+	List *taskList = NIL;
+	ProcedureBatchNode *batchNode = NULL;
+	foreach_ptr(batchNode, batchNodeList)
+	{
+		Task *task = CitusMakeNode(Task);
+
+		task->jobId = INVALID_JOB_ID;
+		task->taskId = list_length(taskList) + 1;
+		task->taskType = DDL_TASK;
+		SetTaskQueryString(task, batchNode->callCommands->data);
+		task->replicationModel = REPLICATION_MODEL_INVALID;
+		task->dependentTaskList = NIL;
+		task->anchorShardId = batchNode->placement->shardId;
+		task->relationShardList = NIL;
+		task->taskPlacementList = list_make1(batchNode->placement);
+
+		taskList = lappend(taskList, task);
+	}
+
+	/* as with a delegated CALL, the nodes run the calls in their own transaction */
+	TransactionProperties xactProperties = {
+		.errorOnAnyFailure = true,
+		.useRemoteTransactionBlocks = TRANSACTION_BLOCKS_DISALLOWED,
+		.requires2PC = false
+	};
+
+	EnableWorkerMessagePropagation();
+
+	bool localExecutionSupported = true;
+	ExecutionParams *executionParams = CreateBasicExecutionParams(
+		ROW_MODIFY_NONE, taskList, MaxAdaptiveExecutorPoolSize,
+		localExecutionSupported);
+	executionParams->xactProperties = xactProperties;
+	executionParams->isUtilityCommand = true;
+	ExecuteTaskListExtended(executionParams);
+
+	DisableWorkerMessagePropagation();
+
+	PG_RETURN_INT64(callCount);
+}
+
+
+/*
+ * ProcedureBatchPlacement returns the placement on which a call of a procedure
+ * in a batch runs, given the text of its distribution argument. The argument
+ * is ignored for procedures that are co-located with a single shard.
+ */
+static ShardPlacement *
+ProcedureBatchPlacement(DistObjectCacheEntry *procedure,
+						CitusTableCacheEntry *distTable, Oid argumentType,
+						char *argumentText)
+{
+	if (IsCitusTableTypeCacheEntry(distTable, REFERENCE_TABLE))
+	{
+		return ShardPlacementForFunctionColocatedWithReferenceTable(distTable);
+	}
+	else if (IsCitusTableTypeCacheEntry(distTable, SINGLE_SHARD_DISTRIBUTED))
+	{
+		return ShardPlacementForFunctionColocatedWithSingleShardTable(distTable);
+	}
+
+	Oid inputFunctionId = InvalidOid;
+	Oid typeIOParam = InvalidOid;
+	getTypeInputInfo(argumentType, &inputFunctionId, &typeIOParam);
+
+	Datum argumentValue = OidInputFunctionCall(inputFunctionId, argumentText,
+											   typeIOParam, -1);
+	Const *argumentConst = makeConst(argumentType, -1, InvalidOid,
+									 get_typlen(argumentType), argumentValue, false,
+									 get_typbyval(argumentType));
+
+	/* only the distribution argument is inspected */
+	List *argumentList = NIL;
+	for (int argumentIndex = 0; argumentIndex < procedure->distributionArgIndex;
+		 argumentIndex++)
+	{
+		argumentList = lappend(argumentList, NULL);
+	}
+	argumentList = lappend(argumentList, argumentConst);
+
+	return ShardPlacementForFunctionColocatedWithDistTable(procedure, argumentList,
+														   distTable->partitionColumn,
+														   distTable, NULL);
+}
+
+
+/*
+ * AppendProcedureBatchCall appends a CALL command with the given text
+ * arguments, cast to the argument types of the procedure, to callCommands.
+ */
+static void
+AppendProcedureBatchCall(StringInfo callCommands, Oid procedureId,
+						 Oid *argumentTypes, int argumentCount,
+						 Datum *argumentArray, bool *argumentNulls)
+{
+	char *schemaName = get_namespace_name(get_func_namespace(procedureId));
+	char *procedureName = get_func_name(procedureId);
+
+	appendStringInfo(callCommands, "CALL %s(",
+					 quote_qualified_identifier(schemaName, procedureName));
+
+	for (int argumentIndex = 0; argumentIndex < argumentCount; argumentIndex++)
+	{
+		if (argumentIndex > 0)
+		{
+			appendStringInfoString(callCommands, ", ");
+		}
+
+		if (argumentNulls[argumentIndex])
+		{
+			appendStringInfoString(callCommands, "NULL");
+		}
+		else
+		{
+			char *argumentText = TextDatumGetCString(argumentArray[argumentIndex]);
+			appendStringInfoString(callCommands, quote_literal_cstr(argumentText));
+		}
+
+		appendStringInfo(callCommands, "::%s",
+						 format_type_be_qualified(argumentTypes[argumentIndex]));
+	}
+
+	appendStringInfoString(callCommands, ");");
+}
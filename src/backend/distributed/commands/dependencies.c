@@ -237,6 +237,12 @@ EnsureRequiredObjectSetExistOnAllNodes(const ObjectAddress *target,
 	{
 		SendCommandListToRemoteNodesWithMetadata(ddlCommands);
 	}
+	else if (EnableDDLCommandBatching)
+	{
+		SendCommandListToWorkerListOutsideTransaction(remoteNodeList,
+													  CitusExtensionOwnerName(),
+													  ddlCommands);
+	}
 	else
 	{
 		WorkerNode *workerNode = NULL;
@@ -33,6 +33,7 @@
 
 #include "pg_version_constants.h"
 
+#include "distributed/async_reference_table.h"
 #include "distributed/colocation_utils.h"
 #include "distributed/commands.h"
 #include "distributed/commands/sequence.h"
@@ -243,6 +244,23 @@ ErrorIfUnsupportedForeignConstraintExists(Relation relation, char referencingDis
 									referencedTableName)));
 		}
 
+		/*
+		 * The placements of asynchronously replicated reference tables apply
+		 * the modifications of the primary placement without checking foreign
+		 * keys.
+		 */
+		if (IsAsyncReferenceTable(referencingTableId) ||
+			IsAsyncReferenceTable(referencedTableId))
+		{
+			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							errmsg("cannot create foreign key constraint"),
+							errdetail("Foreign keys from or to asynchronously "
+									  "replicated reference tables are not "
+									  "supported."),
+							errhint("Use citus_set_reference_table_async() to "
+									"replicate the table synchronously first.")));
+		}
+
 		/* set referenced table related variables here if table is referencing itself */
 		char referencedDistMethod = 0;
 		char referencedReplicationModel = REPLICATION_MODEL_INVALID;
@@ -40,6 +40,7 @@
 #include "distributed/deparse_shard_query.h"
 #include "distributed/deparser.h"
 #include "distributed/distributed_planner.h"
+#include "distributed/hash_helpers.h"
 #include "distributed/listutils.h"
 #include "distributed/local_executor.h"
 #include "distributed/metadata_cache.h"
@@ -58,6 +59,25 @@
 #endif
 
 
+/*
+ * NodeIndexBuildEntry is used to count the number of shard indexes that are
+ * built on a node group.
+ */
+typedef struct NodeIndexBuildEntry
+{
+	int32 groupId;
+	int shardCount;
+} NodeIndexBuildEntry;
+
+
+/*
+ * IndexBuildProcessesPerNode is the number of processes that CREATE INDEX on a
+ * distributed table may use per node, split between concurrent shard index
+ * builds and the parallel workers of each build. 0 disables the scheduling.
+ */
+int IndexBuildProcessesPerNode = 0;
+
+
 /* Local functions forward declarations for helper functions */
 static void ErrorIfCreateIndexHasTooManyColumns(IndexStmt *createIndexStatement);
 static int GetNumberOfIndexParameters(IndexStmt *createIndexStatement);
@@ -73,6 +93,7 @@ static DDLJob * GenerateCreateIndexDDLJob(IndexStmt *createIndexStatement,
 										  const char *createIndexCommand);
 static Oid CreateIndexStmtGetRelationId(IndexStmt *createIndexStatement);
 static List * CreateIndexTaskList(IndexStmt *indexStmt);
+static void AssignIndexBuildParallelWorkers(List *taskList);
 static List * CreateReindexTaskList(Oid relationId, ReindexStmt *reindexStmt);
 static void RangeVarCallbackForDropIndex(const RangeVar *rel, Oid relOid, Oid oldRelOid,
 										 void *arg);
@@ -495,6 +516,20 @@ GenerateCreateIndexDDLJob(IndexStmt *createIndexStatement, const char *createInd
 	ddlJob->taskList = CreateIndexTaskList(createIndexStatement);
 	ddlJob->warnForPartialFailure = true;
 
+	if (IndexBuildProcessesPerNode > 0)
+	{
+		ddlJob->poolSize = IndexBuildProcessesPerNode;
+
+		/*
+		 * CREATE INDEX CONCURRENTLY cannot run in a transaction block, so we
+		 * cannot set max_parallel_maintenance_workers for it.
+		 */
+		if (!createIndexStatement->concurrent)
+		{
+			AssignIndexBuildParallelWorkers(ddlJob->taskList);
+		}
+	}
+
 	return ddlJob;
 }
 
@@ -958,6 +993,94 @@ CreateIndexTaskList(IndexStmt *indexStmt)
 }
 
 
+/*
+ * AssignIndexBuildParallelWorkers sets max_parallel_maintenance_workers for
+ * each of the given index build tasks, such that the concurrent builds on a
+ * node together with their parallel workers use at most
+ * citus.index_build_processes_per_node processes on that node.
+ *
+ * A node that builds fewer shard indexes than the number of processes cannot
+ * use all of them by building indexes concurrently, so each build gets the
+ * remaining processes as parallel workers. Tasks that have a placement on
+ * the local node are left as is, since SET LOCAL would change the setting
+ * for the rest of the coordinated transaction.
+ */
+static void
+AssignIndexBuildParallelWorkers(List *taskList)
+{
+	int32 localGroupId = GetLocalGroupId();
+	HTAB *nodeIndexBuildHash = CreateSimpleHash(int32, NodeIndexBuildEntry);
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		ShardPlacement *placement = NULL;
+		foreach_ptr(placement, task->taskPlacementList)
+		{
+			bool found = false;
+			NodeIndexBuildEntry *nodeEntry =
+				hash_search(nodeIndexBuildHash, &placement->groupId, HASH_ENTER,
+							&found);
+			if (!found)
+			{
+				nodeEntry->shardCount = 0;
+			}
+
+			nodeEntry->shardCount++;
+		}
+	}
+
+	foreach_ptr(task, taskList)
+	{
+		int parallelWorkers = IndexBuildProcessesPerNode - 1;
+		bool hasLocalPlacement = false;
+
+		ShardPlacement *placement = NULL;
+		foreach_ptr(placement, task->taskPlacementList)
+		{
+			if (placement->groupId == localGroupId)
+			{
+				hasLocalPlacement = true;
+				break;
+			}
+
+			/* in sequential mode, a node builds one index at a time */
+			if (MultiShardConnectionType == SEQUENTIAL_CONNECTION)
+			{
+				continue;
+			}
+
+			bool found = false;
+			NodeIndexBuildEntry *nodeEntry =
+				hash_search(nodeIndexBuildHash, &placement->groupId, HASH_FIND,
+							&found);
+			Assert(found);
+
+			int concurrentBuilds = Min(nodeEntry->shardCount,
+									   IndexBuildProcessesPerNode);
+			int nodeParallelWorkers =
+				IndexBuildProcessesPerNode / concurrentBuilds - 1;
+
+			parallelWorkers = Min(parallelWorkers, nodeParallelWorkers);
+		}
+
+		if (hasLocalPlacement)
+		{
+			continue;
+		}
+
+		char *setWorkersCommand =
+			psprintf("SET LOCAL max_parallel_maintenance_workers TO %d",
+					 parallelWorkers);
+
+		SetTaskQueryStringList(task, list_make2(setWorkersCommand,
+												TaskQueryString(task)));
+	}
+
+	hash_destroy(nodeIndexBuildHash);
+}
+
+
 /*
  * CreateReindexTaskList builds a list of tasks to execute a REINDEX command
  * against a specified distributed table.
@@ -68,25 +68,32 @@
 #include "foreign/foreign.h"
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
+#include "mb/pg_wchar.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
 #include "parser/parse_func.h"
 #include "parser/parse_type.h"
+#include "rewrite/rewriteHandler.h"
 #include "tcop/cmdtag.h"
 #include "tsearch/ts_locale.h"
 #include "utils/builtins.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
+#include "utils/typcache.h"
 
 #include "pg_version_constants.h"
 
+#include "distributed/async_reference_table.h"
 #include "distributed/citus_safe_lib.h"
 #include "distributed/commands/multi_copy.h"
 #include "distributed/commands/utility_hook.h"
 #include "distributed/coordinator_protocol.h"
 #include "distributed/hash_helpers.h"
+#include "distributed/ingestion_progress.h"
 #include "distributed/intermediate_results.h"
 #include "distributed/listutils.h"
 #include "distributed/local_executor.h"
@@ -99,13 +106,17 @@
 #include "distributed/multi_physical_planner.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/placement_connection.h"
+#include "distributed/query_result_cache.h"
 #include "distributed/relation_access_tracking.h"
 #include "distributed/remote_commands.h"
 #include "distributed/remote_transaction.h"
 #include "distributed/replication_origin_session_utils.h"
 #include "distributed/resource_lock.h"
+#include "distributed/result_compression.h"
+#include "distributed/shard_column_statistics.h"
 #include "distributed/shard_pruning.h"
 #include "distributed/shared_connection_stats.h"
+#include "distributed/subplan_execution.h"
 #include "distributed/transmit.h"
 #include "distributed/version_compat.h"
 #include "distributed/worker_protocol.h"
@@ -121,6 +132,9 @@ static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 /* if true, skip validation of JSONB columns during COPY */
 bool SkipJsonbValidationInCopy = true;
 
+/* if true, only check the JSON syntax of JSONB columns during COPY */
+bool ValidateJsonbSyntaxOnlyInCopy = false;
+
 /* custom Citus option for appending to a shard */
 #define APPEND_TO_SHARD_OPTION "append_to_shard"
 
@@ -133,6 +147,21 @@ bool SkipJsonbValidationInCopy = true;
  */
 int CopySwitchOverThresholdBytes = 4 * 1024 * 1024;
 
+/*
+ * If true, composite types whose attributes all have binary send/receive
+ * functions are transferred in binary format as well.
+ */
+bool EnableBinaryProtocolForCompositeTypes = false;
+
+/* whether and how COPY .. TO STDOUT reads the shards in parallel */
+int ParallelCopyTo = PARALLEL_COPY_TO_OFF;
+
+/*
+ * If true, a COPY into a distributed table that waits for a connection to
+ * flush keeps sending the pending data of its other connections meanwhile.
+ */
+bool EnableConcurrentCopyFlush = false;
+
 #define FILE_IS_OPEN(x) (x > -1)
 
 typedef struct CopyShardState CopyShardState;
@@ -222,6 +251,24 @@ struct CopyShardState
 };
 
 
+/*
+ * BinaryCopyFormatTypeCacheEntry caches whether a type can be transferred
+ * in binary format, such that we do not need to look up the I/O functions
+ * of the (element, base and attribute) types for every task.
+ */
+typedef struct BinaryCopyFormatTypeCacheEntry
+{
+	/* hash key */
+	Oid typeId;
+
+	/* whether the type and all types it contains have binary I/O functions */
+	bool binaryFormatSupported;
+
+	/* whether the type is or contains a composite type */
+	bool containsRowType;
+} BinaryCopyFormatTypeCacheEntry;
+
+
 /*
  * Represents the state for allowing copy via local
  * execution.
@@ -234,13 +281,48 @@ typedef enum LocalCopyStatus
 } LocalCopyStatus;
 
 
+/*
+ * ShardCopyToState represents a shard that COPY .. TO STDOUT reads in
+ * parallel with other shards.
+ */
+typedef struct ShardCopyToState
+{
+	ShardInterval *shardInterval;
+	ShardPlacement *shardPlacement;
+	char *copyCommand;
+
+	/* connection over which the shard is copied, NULL if not started yet */
+	MultiConnection *connection;
+} ShardCopyToState;
+
+
+/* cache of BinaryCopyFormatTypeCacheEntry, keyed by type OID */
+static HTAB *BinaryCopyFormatTypeCache = NULL;
+static bool BinaryCopyFormatTypeCacheValid = false;
+static bool BinaryCopyFormatTypeCacheCallbacksRegistered = false;
+
+
 /* Local functions forward declarations */
 static void CopyToExistingShards(CopyStmt *copyStatement,
 								 QueryCompletion *completionTag);
+static bool CanCopyFromInParallel(CopyStmt *copyStatement,
+								  CitusCopyDestReceiver *copyDest);
+static uint64 CopyInputToDestination(CopyStmt *copyStatement,
+									 Relation distributedRelation,
+									 CitusCopyDestReceiver *copyDest,
+									 TupleTableSlot *tupleTableSlot,
+									 uint64 skipRowCount);
 static bool IsCopyInBinaryFormat(CopyStmt *copyStatement);
 static List * FindJsonbInputColumns(TupleDesc tupleDescriptor,
 									List *inputColumnNameList);
 static List * RemoveOptionFromList(List *optionList, char *optionName);
+static bool TypeSupportsBinaryFormat(Oid typeId, bool *containsRowType);
+static bool CompositeTypeSupportsBinaryFormat(Oid typeId, bool *containsRowType);
+static void InitializeBinaryCopyFormatTypeCache(void);
+static void InvalidateBinaryCopyFormatTypeCacheCallback(Datum argument, int cacheId,
+														uint32 hashValue);
+static void InvalidateBinaryCopyFormatTypeCacheRelcacheCallback(Datum argument,
+																Oid relationId);
 static bool BinaryOutputFunctionDefined(Oid typeId);
 static bool BinaryInputFunctionDefined(Oid typeId);
 static void SendCopyBinaryHeaders(CopyOutState copyOutState, int64 shardId,
@@ -250,7 +332,8 @@ static void SendCopyBinaryFooters(CopyOutState copyOutState, int64 shardId,
 static StringInfo ConstructCopyStatement(CopyStmt *copyStatement, int64 shardId);
 static void SendCopyDataToAll(StringInfo dataBuffer, int64 shardId, List *connectionList);
 static void SendCopyDataToPlacement(StringInfo dataBuffer, int64 shardId,
-									MultiConnection *connection);
+									MultiConnection *connection,
+									HTAB *connectionStateHash);
 static uint32 AvailableColumnCount(TupleDesc tupleDescriptor);
 
 static Oid TypeForColumnName(Oid relationId, TupleDesc tupleDescriptor, char *columnName);
@@ -262,6 +345,7 @@ static CopyCoercionData * ColumnCoercionPaths(TupleDesc destTupleDescriptor,
 static FmgrInfo * TypeOutputFunctions(uint32 columnCount, Oid *typeIdArray,
 									  bool binaryFormat);
 static bool CopyStatementHasFormat(CopyStmt *copyStatement, char *formatName);
+static ResultCompressionType CopyResultStatementCompression(CopyStmt *copyStatement);
 static void CitusCopyFrom(CopyStmt *copyStatement, QueryCompletion *completionTag);
 static void EnsureCopyCanRunOnRelation(Oid relationId);
 static HTAB * CreateConnectionStateHash(MemoryContext memoryContext);
@@ -299,8 +383,16 @@ static void ShutdownCopyConnectionState(CopyConnectionState *connectionState,
 										CitusCopyDestReceiver *copyDest);
 static SelectStmt * CitusCopySelect(CopyStmt *copyStatement);
 static void CitusCopyTo(CopyStmt *copyStatement, QueryCompletion *completionTag);
-static int64 ForwardCopyDataFromConnection(CopyOutState copyOutState,
-										   MultiConnection *connection);
+static int64 CopyShardsToClientInParallel(List *shardIntervalList,
+										  List *copyCommandList, bool ordered);
+static int ShardCopyToCountOnNode(List *shardStateList, int32 nodeId);
+static void SendShardCopyTo(ShardCopyToState *shardState);
+static void WaitForShardCopyToStart(MultiConnection *connection);
+static bool ForwardAvailableCopyData(MultiConnection *connection, int64 *tuplesSent);
+static WaitEventSet * BuildShardCopyToWaitEventSet(List *shardStateList);
+static void ForwardCopyData(char *copyData, int copyDataLength);
+static void FinishCopyOutFromConnection(MultiConnection *connection);
+static int64 ForwardCopyDataFromConnection(MultiConnection *connection);
 
 /* Private functions copied and adapted from copy.c in PostgreSQL */
 static void SendCopyBegin(CopyOutState cstate);
@@ -310,11 +402,13 @@ static void CopySendString(CopyOutState outputState, const char *str);
 static void CopySendChar(CopyOutState outputState, char c);
 static void CopySendInt32(CopyOutState outputState, int32 val);
 static void CopySendInt16(CopyOutState outputState, int16 val);
-static void CopySendEndOfRow(CopyOutState cstate, bool includeEndOfLine);
 static void CopyAttributeOutText(CopyOutState outputState, char *string);
 static inline void CopyFlushOutput(CopyOutState outputState, char *start, char *pointer);
 static bool CitusSendTupleToPlacements(TupleTableSlot *slot,
 									   CitusCopyDestReceiver *copyDest);
+static void SendCopyRowsToPlacements(CitusCopyDestReceiver *copyDest,
+									 CopyShardState *shardState, Datum *columnValues,
+									 bool *columnNulls, StringInfo rowData);
 static void AddPlacementStateToCopyConnectionStateBuffer(CopyConnectionState *
 														 connectionState,
 														 CopyPlacementState *
@@ -324,8 +418,6 @@ static void RemovePlacementStateFromCopyConnectionStateBuffer(CopyConnectionStat
 															  CopyPlacementState *
 															  placementState);
 static uint64 ProcessAppendToShardOption(Oid relationId, CopyStmt *copyStatement);
-static uint64 ShardIdForTuple(CitusCopyDestReceiver *copyDest, Datum *columnValues,
-							  bool *columnNulls);
 
 /* CitusCopyDestReceiver functions */
 static void CitusCopyDestReceiverStartup(DestReceiver *copyDest, int operation,
@@ -449,11 +541,8 @@ CopyToExistingShards(CopyStmt *copyStatement, QueryCompletion *completionTag)
 	List *columnNameList = NIL;
 	int partitionColumnIndex = INVALID_PARTITION_COLUMN_INDEX;
 
-	bool isInputFormatBinary = IsCopyInBinaryFormat(copyStatement);
 	uint64 processedRowCount = 0;
 
-	ErrorContextCallback errorCallback;
-
 	/* allocate column values and nulls arrays */
 	Relation distributedRelation = table_open(tableId, RowExclusiveLock);
 	TupleDesc tupleDescriptor = RelationGetDescr(distributedRelation);
@@ -492,8 +581,6 @@ CopyToExistingShards(CopyStmt *copyStatement, QueryCompletion *completionTag)
 	}
 
 	EState *executorState = CreateExecutorState();
-	MemoryContext executorTupleContext = GetPerTupleMemoryContext(executorState);
-	ExprContext *executorExpressionContext = GetPerTupleExprContext(executorState);
 
 	/* set up the destination for the COPY */
 	const bool publishableData = true;
@@ -509,9 +596,150 @@ CopyToExistingShards(CopyStmt *copyStatement, QueryCompletion *completionTag)
 		copyDest->appendShardId = appendShardId;
 	}
 
+	/* if the COPY continues a resumable bulk load, skip the committed rows */
+	IngestionProgress *ingestionProgress = ProcessIngestionOptions(tableId,
+																   copyStatement);
+	uint64 skipRowCount = 0;
+	if (ingestionProgress != NULL)
+	{
+		skipRowCount = (uint64) ingestionProgress->skipRowCount;
+	}
+
 	DestReceiver *dest = (DestReceiver *) copyDest;
 	dest->rStartup(dest, 0, tupleDescriptor);
 
+	/*
+	 * Parse the input in parallel workers if possible, or otherwise ourselves.
+	 * The workers parse blocks of lines in any order, so they cannot tell
+	 * which rows to skip.
+	 */
+	if (skipRowCount > 0 || !CanCopyFromInParallel(copyStatement, copyDest) ||
+		!ParallelCopyFrom(copyDest, copyStatement, &processedRowCount))
+	{
+		processedRowCount = CopyInputToDestination(copyStatement, distributedRelation,
+												   copyDest, tupleTableSlot,
+												   skipRowCount);
+	}
+
+	/* finish the COPY commands */
+	dest->rShutdown(dest);
+	dest->rDestroy(dest);
+
+	if (ingestionProgress != NULL)
+	{
+		RecordIngestionProgress(tableId, ingestionProgress, processedRowCount);
+	}
+
+	ExecDropSingleTupleTableSlot(tupleTableSlot);
+	FreeExecutorState(executorState);
+	table_close(distributedRelation, NoLock);
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (completionTag != NULL)
+	{
+		CompleteCopyQueryTagCompat(completionTag, processedRowCount);
+	}
+}
+
+
+/*
+ * CopyInputToDestination parses the rows of the input of the given COPY
+ * command and sends them to the copy destination through the given slot,
+ * whose values and nulls arrays the rows are parsed into. The first
+ * skipRowCount rows are parsed but not sent. It returns the number of rows
+ * that were sent.
+ */
+static uint64
+CopyInputToDestination(CopyStmt *copyStatement, Relation distributedRelation,
+					   CitusCopyDestReceiver *copyDest, TupleTableSlot *tupleTableSlot,
+					   uint64 skipRowCount)
+{
+	DestReceiver *dest = (DestReceiver *) copyDest;
+	EState *executorState = copyDest->executorState;
+	MemoryContext executorTupleContext = GetPerTupleMemoryContext(executorState);
+	ExprContext *executorExpressionContext = GetPerTupleExprContext(executorState);
+	Datum *columnValues = tupleTableSlot->tts_values;
+	bool *columnNulls = tupleTableSlot->tts_isnull;
+	bool isInputFormatBinary = IsCopyInBinaryFormat(copyStatement);
+	uint64 processedRowCount = 0;
+
+	ErrorContextCallback errorCallback;
+
+	Relation copiedDistributedRelation =
+		CopyFromParseRelation(distributedRelation, copyStatement->attlist,
+							  isInputFormatBinary, copyDest);
+
+	/* initialize copy state to read from COPY data source */
+	CopyFromState copyState = BeginCopyFrom(NULL,
+											copiedDistributedRelation,
+											NULL,
+											copyStatement->filename,
+											copyStatement->is_program,
+											NULL,
+											copyStatement->attlist,
+											copyStatement->options);
+
+	/* set up callback to identify error line number */
+	errorCallback.callback = CopyFromErrorCallback;
+	errorCallback.arg = (void *) copyState;
+	errorCallback.previous = error_context_stack;
+	error_context_stack = &errorCallback;
+
+	while (true)
+	{
+		ResetPerTupleExprContext(executorState);
+
+		MemoryContext oldContext = MemoryContextSwitchTo(executorTupleContext);
+
+		/* parse a row from the input */
+		bool nextRowFound = NextCopyFrom(copyState, executorExpressionContext,
+										 columnValues, columnNulls);
+
+		if (!nextRowFound)
+		{
+			MemoryContextSwitchTo(oldContext);
+			break;
+		}
+
+		CHECK_FOR_INTERRUPTS();
+
+		MemoryContextSwitchTo(oldContext);
+
+		if (skipRowCount > 0)
+		{
+			skipRowCount--;
+			continue;
+		}
+
+		dest->receiveSlot(tupleTableSlot, dest);
+
+		++processedRowCount;
+
+		pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED, processedRowCount);
+	}
+
+	EndCopyFrom(copyState);
+
+	/* all lines have been copied, stop showing line number in errors */
+	error_context_stack = errorCallback.previous;
+
+	return processedRowCount;
+}
+
+
+/*
+ * CopyFromParseRelation returns a copy of the given distributed relation that
+ * BeginCopyFrom can use to parse the input of COPY .. FROM, where attlist is
+ * the column list of the COPY command. It also adjusts the output functions of
+ * the copy destination to the way in which the input is parsed.
+ */
+Relation
+CopyFromParseRelation(Relation distributedRelation, List *attlist,
+					  bool isInputFormatBinary, CitusCopyDestReceiver *copyDest)
+{
+	TupleDesc tupleDescriptor = RelationGetDescr(distributedRelation);
+
 	/*
 	 * Below, we change a few fields in the Relation to control the behaviour
 	 * of BeginCopyFrom. However, we obviously should not do this in relcache
@@ -538,7 +766,7 @@ CopyToExistingShards(CopyStmt *copyStatement, QueryCompletion *completionTag)
 	 * Postgres will treat those tables as regular relations and will not open its
 	 * partitions.
 	 */
-	if (PartitionedTable(tableId))
+	if (PartitionedTable(RelationGetRelid(distributedRelation)))
 	{
 		copiedDistributedRelationTuple->relkind = RELKIND_RELATION;
 	}
@@ -553,16 +781,26 @@ CopyToExistingShards(CopyStmt *copyStatement, QueryCompletion *completionTag)
 	 * The main downside of enabling this optimisation is that it defers validation
 	 * until the object is parsed by the worker, which is unable to give an accurate
 	 * line number.
+	 *
+	 * When validating only the syntax, we parse the column as JSON instead, which
+	 * checks the syntax without building a JSONB value that we would have to
+	 * convert back to text to send it. The few values that are valid JSON but
+	 * not valid JSONB, such as strings containing \u0000, are still rejected by
+	 * the worker.
 	 */
-	if (SkipJsonbValidationInCopy && !isInputFormatBinary)
+	bool validateJsonbSyntaxOnly = !SkipJsonbValidationInCopy &&
+								   ValidateJsonbSyntaxOnlyInCopy;
+
+	if ((SkipJsonbValidationInCopy || validateJsonbSyntaxOnly) && !isInputFormatBinary)
 	{
 		CopyOutState copyOutState = copyDest->copyOutState;
+		int partitionColumnIndex = copyDest->partitionColumnIndex;
 		ListCell *jsonbColumnIndexCell = NULL;
 
 		/* get the column indices for all JSONB columns that appear in the input */
 		List *jsonbColumnIndexList = FindJsonbInputColumns(
 			copiedDistributedRelation->rd_att,
-			copyStatement->attlist);
+			attlist);
 
 		foreach(jsonbColumnIndexCell, jsonbColumnIndexList)
 		{
@@ -580,11 +818,12 @@ CopyToExistingShards(CopyStmt *copyStatement, QueryCompletion *completionTag)
 				continue;
 			}
 
-			ereport(DEBUG1, (errmsg("parsing JSONB column %s as text",
-									NameStr(currentColumn->attname))));
+			ereport(DEBUG1, (errmsg("parsing JSONB column %s as %s",
+									NameStr(currentColumn->attname),
+									validateJsonbSyntaxOnly ? "json" : "text")));
 
-			/* parse the column as text instead of JSONB */
-			currentColumn->atttypid = TEXTOID;
+			/* parse the column as text or JSON instead of JSONB */
+			currentColumn->atttypid = validateJsonbSyntaxOnly ? JSONOID : TEXTOID;
 
 			if (copyOutState->binary)
 			{
@@ -609,68 +848,81 @@ CopyToExistingShards(CopyStmt *copyStatement, QueryCompletion *completionTag)
 		}
 	}
 
-	/* initialize copy state to read from COPY data source */
-	CopyFromState copyState = BeginCopyFrom(NULL,
-											copiedDistributedRelation,
-											NULL,
-											copyStatement->filename,
-											copyStatement->is_program,
-											NULL,
-											copyStatement->attlist,
-											copyStatement->options);
+	return copiedDistributedRelation;
+}
 
-	/* set up callback to identify error line number */
-	errorCallback.callback = CopyFromErrorCallback;
-	errorCallback.arg = (void *) copyState;
-	errorCallback.previous = error_context_stack;
-	error_context_stack = &errorCallback;
 
-	while (true)
-	{
-		ResetPerTupleExprContext(executorState);
+/*
+ * CanCopyFromInParallel returns whether the input of the given COPY command
+ * can be parsed by parallel workers, see parallel_copy_from.c.
+ */
+static bool
+CanCopyFromInParallel(CopyStmt *copyStatement, CitusCopyDestReceiver *copyDest)
+{
+	Relation distributedRelation = copyDest->distributedRelation;
+	TupleDesc tupleDescriptor = RelationGetDescr(distributedRelation);
 
-		MemoryContext oldContext = MemoryContextSwitchTo(executorTupleContext);
+	if (ParallelCopyFromWorkers <= 0 || copyStatement->filename != NULL ||
+		IsInParallelMode())
+	{
+		return false;
+	}
 
-		/* parse a row from the input */
-		bool nextRowFound = NextCopyFrom(copyState, executorExpressionContext,
-										 columnValues, columnNulls);
+	/* the leader splits the input into lines without converting it */
+	if (pg_get_client_encoding() != GetDatabaseEncoding())
+	{
+		return false;
+	}
 
-		if (!nextRowFound)
+	DefElem *option = NULL;
+	foreach_ptr(option, copyStatement->options)
+	{
+		/* only lines in text format can be split without parsing them */
+		if (strcmp(option->defname, "format") == 0 &&
+			strcmp(defGetString(option), "text") != 0)
 		{
-			MemoryContextSwitchTo(oldContext);
-			break;
+			return false;
 		}
 
-		CHECK_FOR_INTERRUPTS();
-
-		MemoryContextSwitchTo(oldContext);
-
-		dest->receiveSlot(tupleTableSlot, dest);
-
-		++processedRowCount;
-
-		pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED, processedRowCount);
+		if (strcmp(option->defname, "header") == 0 ||
+			strcmp(option->defname, "encoding") == 0)
+		{
+			return false;
+		}
 	}
 
-	EndCopyFrom(copyState);
-
-	/* all lines have been copied, stop showing line number in errors */
-	error_context_stack = errorCallback.previous;
+	/* local copy needs the tuples, which stay in the parallel workers */
+	if (copyDest->shouldUseLocalCopy &&
+		ShardIntervalListHasLocalPlacements(
+			LoadShardIntervalList(copyDest->distributedRelationId)))
+	{
+		return false;
+	}
 
-	/* finish the COPY commands */
-	dest->rShutdown(dest);
-	dest->rDestroy(dest);
+	/* parallel workers cannot evaluate volatile defaults, such as nextval() */
+	List *attnumList = CopyGetAttnums(tupleDescriptor, distributedRelation,
+									  copyStatement->attlist);
 
-	ExecDropSingleTupleTableSlot(tupleTableSlot);
-	FreeExecutorState(executorState);
-	table_close(distributedRelation, NoLock);
+	for (int columnIndex = 0; columnIndex < tupleDescriptor->natts; columnIndex++)
+	{
+		Form_pg_attribute column = TupleDescAttr(tupleDescriptor, columnIndex);
+		AttrNumber attributeNumber = column->attnum;
 
-	CHECK_FOR_INTERRUPTS();
+		if (column->attisdropped || column->attgenerated ||
+			list_member_int(attnumList, attributeNumber))
+		{
+			continue;
+		}
 
-	if (completionTag != NULL)
-	{
-		CompleteCopyQueryTagCompat(completionTag, processedRowCount);
+		Node *defaultExpression = build_column_default(distributedRelation,
+													   attributeNumber);
+		if (defaultExpression != NULL && contain_volatile_functions(defaultExpression))
+		{
+			return false;
+		}
 	}
+
+	return true;
 }
 
 
@@ -842,11 +1094,57 @@ CanUseBinaryCopyFormatForTargetList(List *targetEntryList)
 
 /*
  * CanUseBinaryCopyFormatForType determines whether it is safe to use the
- * binary copy format for the given type. See contents of the function for
- * details of when it's safe to use binary copy.
+ * binary copy format for the given type. The answer is cached per type and
+ * the cache is invalidated whenever pg_type or a relation (which might be
+ * the relation of a composite type) changes. See TypeSupportsBinaryFormat
+ * for details of when it's safe to use binary copy.
+ *
+ * The nodes in a cluster run the same version of Postgres and, since Citus
+ * propagates types and extensions, have the same types with the same I/O
+ * functions. Hence looking at the local catalogs is sufficient.
  */
 bool
 CanUseBinaryCopyFormatForType(Oid typeId)
+{
+	bool found = false;
+
+	InitializeBinaryCopyFormatTypeCache();
+
+	BinaryCopyFormatTypeCacheEntry *cacheEntry =
+		hash_search(BinaryCopyFormatTypeCache, &typeId, HASH_FIND, &found);
+	if (!found)
+	{
+		/*
+		 * Looking up the types might process invalidations, so we only add
+		 * the entry once we know the answer.
+		 */
+		bool containsRowType = false;
+		bool binaryFormatSupported = TypeSupportsBinaryFormat(typeId, &containsRowType);
+
+		InitializeBinaryCopyFormatTypeCache();
+
+		cacheEntry = hash_search(BinaryCopyFormatTypeCache, &typeId, HASH_ENTER,
+								 &found);
+		cacheEntry->binaryFormatSupported = binaryFormatSupported;
+		cacheEntry->containsRowType = containsRowType;
+	}
+
+	if (cacheEntry->containsRowType && !EnableBinaryProtocolForCompositeTypes)
+	{
+		return false;
+	}
+
+	return cacheEntry->binaryFormatSupported;
+}
+
+
+/*
+ * TypeSupportsBinaryFormat determines whether the given type and all types
+ * that it wraps have binary input and output functions. It sets
+ * containsRowType to true if the given type is or contains a composite type.
+ */
+static bool
+TypeSupportsBinaryFormat(Oid typeId, bool *containsRowType)
 {
 	if (!BinaryOutputFunctionDefined(typeId))
 	{
@@ -858,32 +1156,24 @@ CanUseBinaryCopyFormatForType(Oid typeId)
 		return false;
 	}
 
+	/*
+	 * For domains, make sure that the underlying type can be binary copied.
+	 */
+	Oid baseTypeId = getBaseType(typeId);
+	if (typeId != baseTypeId)
+	{
+		return TypeSupportsBinaryFormat(baseTypeId, containsRowType);
+	}
+
 	/*
 	 * A row type can contain any types, possibly types that don't have
 	 * the binary input and output functions defined.
 	 */
 	if (type_is_rowtype(typeId))
 	{
-		/*
-		 * TODO: Inspect the types inside the record and check if all of them
-		 * can be binary encoded. If so, it's safe to use binary encoding.
-		 *
-		 * IMPORTANT: When implementing this todo keep the following in mind:
-		 *
-		 * In PG versions before PG14 the record_recv function would error out
-		 * more than necessary.
-		 *
-		 * It errors out when any of the columns in the row have a type oid
-		 * that doesn't match with the oid in the received data. This happens
-		 * pretty much always for non built in types, because their oids differ
-		 * between postgres intallations. So for those Postgres versions we
-		 * would need a check like the following for each column:
-		 *
-		 * if (columnType >= FirstNormalObjectId) {
-		 *     return false
-		 * }
-		 */
-		return false;
+		*containsRowType = true;
+
+		return CompositeTypeSupportsBinaryFormat(typeId, containsRowType);
 	}
 
 	HeapTuple typeTup = typeidType(typeId);
@@ -898,25 +1188,121 @@ CanUseBinaryCopyFormatForType(Oid typeId)
 	 */
 	if (elementType != InvalidOid)
 	{
-		if (!CanUseBinaryCopyFormatForType(elementType))
+		if (!TypeSupportsBinaryFormat(elementType, containsRowType))
 		{
 			return false;
 		}
 	}
 
-	/*
-	 * For domains, make sure that the underlying type can be binary copied.
-	 */
-	Oid baseTypeId = getBaseType(typeId);
-	if (typeId != baseTypeId)
+	return true;
+}
+
+
+/*
+ * CompositeTypeSupportsBinaryFormat determines whether all attributes of the
+ * given composite type can be binary encoded.
+ *
+ * Since PG14, record_recv and array_recv no longer error out when the type
+ * OIDs in the received data differ from the local ones, which is usually the
+ * case for user-defined types, so only the attribute types matter. Anonymous
+ * records cannot be inspected, so we use the text format for them.
+ */
+static bool
+CompositeTypeSupportsBinaryFormat(Oid typeId, bool *containsRowType)
+{
+	if (typeId == RECORDOID)
+	{
+		return false;
+	}
+
+	bool binaryFormatSupported = true;
+	TupleDesc tupleDescriptor = lookup_rowtype_tupdesc(typeId, -1);
+
+	for (int columnIndex = 0; columnIndex < tupleDescriptor->natts; columnIndex++)
 	{
-		if (!CanUseBinaryCopyFormatForType(baseTypeId))
+		Form_pg_attribute attribute = TupleDescAttr(tupleDescriptor, columnIndex);
+
+		if (attribute->attisdropped)
 		{
-			return false;
+			continue;
+		}
+
+		if (!TypeSupportsBinaryFormat(attribute->atttypid, containsRowType))
+		{
+			binaryFormatSupported = false;
+			break;
 		}
 	}
 
-	return true;
+	ReleaseTupleDesc(tupleDescriptor);
+
+	return binaryFormatSupported;
+}
+
+
+/*
+ * InitializeBinaryCopyFormatTypeCache (re)creates the binary copy format type
+ * cache if it was invalidated and registers the invalidation callbacks on
+ * first use.
+ */
+static void
+InitializeBinaryCopyFormatTypeCache(void)
+{
+	if (!BinaryCopyFormatTypeCacheCallbacksRegistered)
+	{
+		CacheRegisterSyscacheCallback(TYPEOID,
+									  InvalidateBinaryCopyFormatTypeCacheCallback,
+									  (Datum) 0);
+		CacheRegisterRelcacheCallback(InvalidateBinaryCopyFormatTypeCacheRelcacheCallback,
+									  (Datum) 0);
+		BinaryCopyFormatTypeCacheCallbacksRegistered = true;
+	}
+
+	if (BinaryCopyFormatTypeCacheValid)
+	{
+		return;
+	}
+
+	if (BinaryCopyFormatTypeCache != NULL)
+	{
+		hash_destroy(BinaryCopyFormatTypeCache);
+	}
+
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(Oid);
+	info.entrysize = sizeof(BinaryCopyFormatTypeCacheEntry);
+	info.hcxt = CacheMemoryContext;
+	int hashFlags = (HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	BinaryCopyFormatTypeCache = hash_create("Binary Copy Format Type Cache", 32,
+											&info, hashFlags);
+	BinaryCopyFormatTypeCacheValid = true;
+}
+
+
+/*
+ * InvalidateBinaryCopyFormatTypeCacheCallback marks the binary copy format
+ * type cache as invalid when a type is created, altered or dropped, which
+ * includes the types of an extension that is created or updated.
+ */
+static void
+InvalidateBinaryCopyFormatTypeCacheCallback(Datum argument, int cacheId,
+											uint32 hashValue)
+{
+	BinaryCopyFormatTypeCacheValid = false;
+}
+
+
+/*
+ * InvalidateBinaryCopyFormatTypeCacheRelcacheCallback marks the binary copy
+ * format type cache as invalid when a relation changes, since adding or
+ * altering an attribute of a composite type only changes its relation.
+ */
+static void
+InvalidateBinaryCopyFormatTypeCacheRelcacheCallback(Datum argument, Oid relationId)
+{
+	BinaryCopyFormatTypeCacheValid = false;
 }
 
 
@@ -1095,19 +1481,46 @@ SendCopyDataToAll(StringInfo dataBuffer, int64 shardId, List *connectionList)
 	foreach(connectionCell, connectionList)
 	{
 		MultiConnection *connection = (MultiConnection *) lfirst(connectionCell);
-		SendCopyDataToPlacement(dataBuffer, shardId, connection);
+		SendCopyDataToPlacement(dataBuffer, shardId, connection, NULL);
 	}
 }
 
 
 /*
  * SendCopyDataToPlacement sends serialized COPY data to a specific shard placement
- * over the given connection.
+ * over the given connection. When the connection needs to be flushed and
+ * citus.enable_concurrent_copy_flush is on, the other connections in
+ * connectionStateHash are flushed while waiting for it, if it is not NULL.
  */
 static void
-SendCopyDataToPlacement(StringInfo dataBuffer, int64 shardId, MultiConnection *connection)
+SendCopyDataToPlacement(StringInfo dataBuffer, int64 shardId, MultiConnection *connection,
+						HTAB *connectionStateHash)
 {
-	if (!PutRemoteCopyData(connection, dataBuffer->data, dataBuffer->len))
+	bool success = false;
+
+	if (EnableConcurrentCopyFlush && connectionStateHash != NULL)
+	{
+		success = QueueRemoteCopyData(connection, dataBuffer->data, dataBuffer->len);
+
+		if (success && RemoteCopyFlushThresholdReached(connection))
+		{
+			List *connectionList = NIL;
+
+			CopyConnectionState *connectionState = NULL;
+			foreach_ptr(connectionState, ConnectionStateList(connectionStateHash))
+			{
+				connectionList = lappend(connectionList, connectionState->connection);
+			}
+
+			success = FlushRemoteCopyData(connection, connectionList);
+		}
+	}
+	else
+	{
+		success = PutRemoteCopyData(connection, dataBuffer->data, dataBuffer->len);
+	}
+
+	if (!success)
 	{
 		ereport(ERROR, (errcode(ERRCODE_IO_ERROR),
 						errmsg("failed to COPY to shard " INT64_FORMAT " on %s:%d",
@@ -1729,32 +2142,6 @@ CopySendInt16(CopyOutState outputState, int16 val)
 }
 
 
-/* Send the row to the appropriate destination */
-static void
-CopySendEndOfRow(CopyOutState cstate, bool includeEndOfLine)
-{
-	StringInfo	fe_msgbuf = cstate->fe_msgbuf;
-
-	switch (cstate->copy_dest)
-	{
-		case COPY_FRONTEND:
-			/* The FE/BE protocol uses \n as newline for all platforms */
-			if (!cstate->binary && includeEndOfLine)
-				CopySendChar(cstate, '\n');
-
-			/* Dump the accumulated row as one CopyData message */
-			(void) pq_putmessage('d', fe_msgbuf->data, fe_msgbuf->len);
-			break;
-		case COPY_FILE:
-		case COPY_CALLBACK:
-			Assert(false);		/* Not yet supported. */
-			break;
-	}
-
-	resetStringInfo(fe_msgbuf);
-}
-
-
 /*
  * Send text representation of one column, with conversion and escaping.
  *
@@ -1991,9 +2378,6 @@ CitusCopyDestReceiverStartup(DestReceiver *dest, int operation,
 
 	ListCell *columnNameCell = NULL;
 
-	const char *delimiterCharacter = "\t";
-	const char *nullPrintCharacter = "\\N";
-
 	/* look up table properties */
 	Relation distributedRelation = table_open(tableId, RowExclusiveLock);
 	CitusTableCacheEntry *cacheEntry = GetCitusTableCacheEntry(tableId);
@@ -2052,53 +2436,10 @@ CitusCopyDestReceiverStartup(DestReceiver *dest, int operation,
 	Use2PCForCoordinatedTransaction();
 
 	/* define how tuples will be serialised */
-	CopyOutState copyOutState = (CopyOutState) palloc0(sizeof(CopyOutStateData));
-	copyOutState->delim = (char *) delimiterCharacter;
-	copyOutState->null_print = (char *) nullPrintCharacter;
-	copyOutState->null_print_client = (char *) nullPrintCharacter;
-	copyOutState->binary = CanUseBinaryCopyFormat(inputTupleDescriptor);
-	copyOutState->fe_msgbuf = makeStringInfo();
-	copyOutState->rowcontext = GetPerTupleMemoryContext(copyDest->executorState);
-	copyDest->copyOutState = copyOutState;
-	copyDest->multiShardCopy = false;
-
-	/* prepare functions to call on received tuples */
-	{
-		TupleDesc destTupleDescriptor = distributedRelation->rd_att;
-		int columnCount = inputTupleDescriptor->natts;
-		Oid *finalTypeArray = palloc0(columnCount * sizeof(Oid));
+	InitializeCopyRowSerialization(copyDest, inputTupleDescriptor);
 
-		/*
-		 * To ensure the proper co-location and distribution of the target table,
-		 * the entire process of repartitioning intermediate files requires the
-		 * destReceiver to be created on the target rather than the source.
-		 *
-		 * Within this specific code path, it is assumed that the employed model
-		 * is for insert-select. Consequently, it validates the column types of
-		 * destTupleDescriptor(target) during the intermediate result generation
-		 * process. However, this approach varies significantly for MERGE operations,
-		 * where the source tuple(s) can have arbitrary types and are not required to
-		 * align with the target column names.
-		 *
-		 * Despite this minor setback, a significant portion of the code responsible
-		 * for repartitioning intermediate files can be reused for the MERGE
-		 * operation. By leveraging the ability to perform actual coercion during
-		 * the writing process to the target table, we can bypass this specific route.
-		 */
-		if (copyDest->skipCoercions)
-		{
-			copyDest->columnOutputFunctions =
-				ColumnOutputFunctions(inputTupleDescriptor, copyOutState->binary);
-		}
-		else
-		{
-			copyDest->columnCoercionPaths =
-				ColumnCoercionPaths(destTupleDescriptor, inputTupleDescriptor,
-									tableId, columnNameList, finalTypeArray);
-			copyDest->columnOutputFunctions =
-				TypeOutputFunctions(columnCount, finalTypeArray, copyOutState->binary);
-		}
-	}
+	CopyOutState copyOutState = copyDest->copyOutState;
+	copyDest->multiShardCopy = false;
 
 	/* wrap the column names as Values */
 	foreach(columnNameCell, columnNameList)
@@ -2160,6 +2501,8 @@ CitusCopyDestReceiverStartup(DestReceiver *dest, int operation,
 	copyDest->connectionStateHash = CreateConnectionStateHash(TopTransactionContext);
 
 	RecordRelationAccessIfNonDistTable(tableId, PLACEMENT_ACCESS_DML);
+	QueryResultCacheRecordRelationModification(tableId);
+	InvalidateReusableSubPlanResults(tableId);
 
 	/*
 	 * Colocated intermediate results do not honor citus.max_shared_pool_size,
@@ -2218,6 +2561,70 @@ CitusCopyDestReceiverStartup(DestReceiver *dest, int operation,
 }
 
 
+/*
+ * InitializeCopyRowSerialization defines how the copy destination serialises
+ * tuples with the given descriptor for the COPY commands on the shards. The
+ * relation of the copy destination needs to be open.
+ */
+void
+InitializeCopyRowSerialization(CitusCopyDestReceiver *copyDest,
+							   TupleDesc inputTupleDescriptor)
+{
+	Oid tableId = copyDest->distributedRelationId;
+	List *columnNameList = copyDest->columnNameList;
+
+	const char *delimiterCharacter = "\t";
+	const char *nullPrintCharacter = "\\N";
+
+	CopyOutState copyOutState = (CopyOutState) palloc0(sizeof(CopyOutStateData));
+	copyOutState->delim = (char *) delimiterCharacter;
+	copyOutState->null_print = (char *) nullPrintCharacter;
+	copyOutState->null_print_client = (char *) nullPrintCharacter;
+	copyOutState->binary = CanUseBinaryCopyFormat(inputTupleDescriptor);
+	copyOutState->fe_msgbuf = makeStringInfo();
+	copyOutState->rowcontext = GetPerTupleMemoryContext(copyDest->executorState);
+	copyDest->copyOutState = copyOutState;
+
+	/* prepare functions to call on received tuples */
+	{
+		TupleDesc destTupleDescriptor = copyDest->distributedRelation->rd_att;
+		int columnCount = inputTupleDescriptor->natts;
+		Oid *finalTypeArray = palloc0(columnCount * sizeof(Oid));
+
+		/*
+		 * To ensure the proper co-location and distribution of the target table,
+		 * the entire process of repartitioning intermediate files requires the
+		 * destReceiver to be created on the target rather than the source.
+		 *
+		 * Within this specific code path, it is assumed that the employed model
+		 * is for insert-select. Consequently, it validates the column types of
+		 * destTupleDescriptor(target) during the intermediate result generation
+		 * process. However, this approach varies significantly for MERGE operations,
+		 * where the source tuple(s) can have arbitrary types and are not required to
+		 * align with the target column names.
+		 *
+		 * Despite this minor setback, a significant portion of the code responsible
+		 * for repartitioning intermediate files can be reused for the MERGE
+		 * operation. By leveraging the ability to perform actual coercion during
+		 * the writing process to the target table, we can bypass this specific route.
+		 */
+		if (copyDest->skipCoercions)
+		{
+			copyDest->columnOutputFunctions =
+				ColumnOutputFunctions(inputTupleDescriptor, copyOutState->binary);
+		}
+		else
+		{
+			copyDest->columnCoercionPaths =
+				ColumnCoercionPaths(destTupleDescriptor, inputTupleDescriptor,
+									tableId, columnNameList, finalTypeArray);
+			copyDest->columnOutputFunctions =
+				TypeOutputFunctions(columnCount, finalTypeArray, copyOutState->binary);
+		}
+	}
+}
+
+
 /*
  * CitusCopyDestReceiverReceive implements the receiveSlot function of
  * CitusCopyDestReceiver. It takes a TupleTableSlot and sends the contents to
@@ -2257,13 +2664,6 @@ CitusCopyDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 static bool
 CitusSendTupleToPlacements(TupleTableSlot *slot, CitusCopyDestReceiver *copyDest)
 {
-	TupleDesc tupleDescriptor = copyDest->tupleDescriptor;
-	CopyStmt *copyStatement = copyDest->copyStatement;
-
-	CopyOutState copyOutState = copyDest->copyOutState;
-	FmgrInfo *columnOutputFunctions = copyDest->columnOutputFunctions;
-	CopyCoercionData *columnCoercionPaths = copyDest->columnCoercionPaths;
-	ListCell *placementStateCell = NULL;
 	bool cachedShardStateFound = false;
 	bool firstTupleInShard = false;
 
@@ -2295,6 +2695,12 @@ CitusSendTupleToPlacements(TupleTableSlot *slot, CitusCopyDestReceiver *copyDest
 	if (!cachedShardStateFound)
 	{
 		firstTupleInShard = true;
+
+		/* the statistics of the shard no longer cover all of its rows */
+		if (!isColocatedIntermediateResult)
+		{
+			InvalidateShardColumnStatistics(shardId);
+		}
 	}
 
 	if (firstTupleInShard && !copyDest->multiShardCopy &&
@@ -2328,6 +2734,43 @@ CitusSendTupleToPlacements(TupleTableSlot *slot, CitusCopyDestReceiver *copyDest
 		WriteTupleToLocalShard(slot, copyDest, shardId, shardState->copyOutState);
 	}
 
+	SendCopyRowsToPlacements(copyDest, shardState, columnValues, columnNulls, NULL);
+
+	MemoryContextSwitchTo(oldContext);
+
+	copyDest->tuplesSent++;
+
+	/*
+	 * Release per tuple memory allocated in this function. If we're writing
+	 * the results of an INSERT ... SELECT then the SELECT execution will use
+	 * its own executor state and reset the per tuple expression context
+	 * separately.
+	 */
+	ResetPerTupleExprContext(executorState);
+
+	return true;
+}
+
+
+/*
+ * SendCopyRowsToPlacements sends a row to the placements of the given shard,
+ * or buffers it for the placements whose connection currently copies into
+ * another placement. When rowData is NULL, the row is serialised from the
+ * given column values, otherwise rowData holds one or more rows that were
+ * already serialised for the COPY commands on the shard.
+ */
+static void
+SendCopyRowsToPlacements(CitusCopyDestReceiver *copyDest, CopyShardState *shardState,
+						 Datum *columnValues, bool *columnNulls, StringInfo rowData)
+{
+	TupleDesc tupleDescriptor = copyDest->tupleDescriptor;
+	CopyStmt *copyStatement = copyDest->copyStatement;
+	CopyOutState copyOutState = copyDest->copyOutState;
+	FmgrInfo *columnOutputFunctions = copyDest->columnOutputFunctions;
+	CopyCoercionData *columnCoercionPaths = copyDest->columnCoercionPaths;
+	int64 shardId = shardState->shardId;
+	ListCell *placementStateCell = NULL;
+
 	foreach(placementStateCell, shardState->placementStateList)
 	{
 		CopyPlacementState *currentPlacementState = lfirst(placementStateCell);
@@ -2363,7 +2806,8 @@ CitusSendTupleToPlacements(TupleTableSlot *slot, CitusCopyDestReceiver *copyDest
 
 			/* send previously buffered tuples */
 			SendCopyDataToPlacement(currentPlacementState->data, shardId,
-									connectionState->connection);
+									connectionState->connection,
+									copyDest->connectionStateHash);
 			resetStringInfo(currentPlacementState->data);
 
 			/* additionaly, we need to send the current tuple too */
@@ -2372,11 +2816,16 @@ CitusSendTupleToPlacements(TupleTableSlot *slot, CitusCopyDestReceiver *copyDest
 		else if (currentPlacementState != activePlacementState)
 		{
 			/* buffer data */
-			StringInfo copyBuffer = copyOutState->fe_msgbuf;
-			resetStringInfo(copyBuffer);
-			AppendCopyRowData(columnValues, columnNulls, tupleDescriptor,
-							  copyOutState, columnOutputFunctions,
-							  columnCoercionPaths);
+			StringInfo copyBuffer = rowData;
+			if (copyBuffer == NULL)
+			{
+				copyBuffer = copyOutState->fe_msgbuf;
+				resetStringInfo(copyBuffer);
+				AppendCopyRowData(columnValues, columnNulls, tupleDescriptor,
+								  copyOutState, columnOutputFunctions,
+								  columnCoercionPaths);
+			}
+
 			appendBinaryStringInfo(currentPlacementState->data, copyBuffer->data,
 								   copyBuffer->len);
 		}
@@ -2388,27 +2837,55 @@ CitusSendTupleToPlacements(TupleTableSlot *slot, CitusCopyDestReceiver *copyDest
 
 		if (sendTupleOverConnection)
 		{
-			resetStringInfo(copyOutState->fe_msgbuf);
-			AppendCopyRowData(columnValues, columnNulls, tupleDescriptor,
-							  copyOutState, columnOutputFunctions, columnCoercionPaths);
-			SendCopyDataToPlacement(copyOutState->fe_msgbuf, shardId,
-									connectionState->connection);
+			StringInfo copyBuffer = rowData;
+			if (copyBuffer == NULL)
+			{
+				copyBuffer = copyOutState->fe_msgbuf;
+				resetStringInfo(copyBuffer);
+				AppendCopyRowData(columnValues, columnNulls, tupleDescriptor,
+								  copyOutState, columnOutputFunctions,
+								  columnCoercionPaths);
+			}
+
+			SendCopyDataToPlacement(copyBuffer, shardId, connectionState->connection,
+									copyDest->connectionStateHash);
 		}
 	}
+}
+
+
+/*
+ * CitusCopyDestReceiverSendRows sends rows that were already serialised for
+ * the COPY commands on the shards to the placements of the given shard, and
+ * counts them as sent. It is used when the rows are parsed and routed by
+ * parallel workers, which is why it neither copies into local placements nor
+ * records the accesses of the COPY. The caller takes care of those upfront.
+ */
+void
+CitusCopyDestReceiverSendRows(CitusCopyDestReceiver *copyDest, uint64 shardId,
+							  StringInfo rowData, int64 rowCount)
+{
+	bool cachedShardStateFound = false;
+	const bool isColocatedIntermediateResult = false;
+
+	/* connections hash is kept in memory context */
+	MemoryContext oldContext = MemoryContextSwitchTo(copyDest->memoryContext);
+
+	CopyShardState *shardState = GetShardState(shardId, copyDest->shardStateHash,
+											   copyDest->connectionStateHash,
+											   &cachedShardStateFound,
+											   copyDest->shouldUseLocalCopy,
+											   copyDest->copyOutState,
+											   isColocatedIntermediateResult,
+											   copyDest->isPublishable);
 
-	MemoryContextSwitchTo(oldContext);
+	Assert(!copyDest->shouldUseLocalCopy || !shardState->containsLocalPlacement);
 
-	copyDest->tuplesSent++;
+	SendCopyRowsToPlacements(copyDest, shardState, NULL, NULL, rowData);
 
-	/*
-	 * Release per tuple memory allocated in this function. If we're writing
-	 * the results of an INSERT ... SELECT then the SELECT execution will use
-	 * its own executor state and reset the per tuple expression context
-	 * separately.
-	 */
-	ResetPerTupleExprContext(executorState);
+	MemoryContextSwitchTo(oldContext);
 
-	return true;
+	copyDest->tuplesSent += rowCount;
 }
 
 
@@ -2495,13 +2972,13 @@ ProcessAppendToShardOption(Oid relationId, CopyStmt *copyStatement)
 
 /*
  * ContainsLocalPlacement returns true if the current node has
- * a local placement for the given shard id.
+ * a local placement for the given shard id that is written to.
  */
 static bool
 ContainsLocalPlacement(int64 shardId)
 {
 	ListCell *placementCell = NULL;
-	List *activePlacementList = ActiveShardPlacementList(shardId);
+	List *activePlacementList = WritableShardPlacementList(shardId);
 	int32 localGroupId = GetLocalGroupId();
 
 	foreach(placementCell, activePlacementList)
@@ -2520,7 +2997,7 @@ ContainsLocalPlacement(int64 shardId)
 /*
  * ShardIdForTuple returns id of the shard to which the given tuple belongs to.
  */
-static uint64
+uint64
 ShardIdForTuple(CitusCopyDestReceiver *copyDest, Datum *columnValues, bool *columnNulls)
 {
 	int partitionColumnIndex = copyDest->partitionColumnIndex;
@@ -2737,7 +3214,8 @@ ShutdownCopyConnectionState(CopyConnectionState *connectionState,
 		StartPlacementStateCopyCommand(placementState, copyStatement,
 									   copyOutState);
 		SendCopyDataToPlacement(placementState->data, shardId,
-								connectionState->connection);
+								connectionState->connection,
+								copyDest->connectionStateHash);
 		EndPlacementStateCopyCommand(placementState, copyOutState);
 		if (!copyDest->isPublishable)
 		{
@@ -2823,6 +3301,26 @@ CopyStatementHasFormat(CopyStmt *copyStatement, char *formatName)
 }
 
 
+/*
+ * CopyResultStatementCompression returns the compression that the client
+ * asked for in the options of a COPY ... WITH (format result) statement.
+ */
+static ResultCompressionType
+CopyResultStatementCompression(CopyStmt *copyStatement)
+{
+	DefElem *defel = NULL;
+	foreach_ptr(defel, copyStatement->options)
+	{
+		if (strncmp(defel->defname, "compression", NAMEDATALEN) == 0)
+		{
+			return ResultCompressionTypeFromName(defGetString(defel));
+		}
+	}
+
+	return RESULT_COMPRESSION_NONE;
+}
+
+
 /*
  * ProcessCopyStmt handles Citus specific concerns for COPY like supporting
  * COPYing from distributed tables and preventing unsupported actions. The
@@ -2841,13 +3339,16 @@ ProcessCopyStmt(CopyStmt *copyStatement, QueryCompletion *completionTag, const
 	{
 		const char *resultId = copyStatement->relation->relname;
 
+		ResultCompressionType compressionType =
+			CopyResultStatementCompression(copyStatement);
+
 		if (copyStatement->is_from)
 		{
-			ReceiveQueryResultViaCopy(resultId);
+			ReceiveQueryResultViaCopy(resultId, compressionType);
 		}
 		else
 		{
-			SendQueryResultViaCopy(resultId);
+			SendQueryResultViaCopy(resultId, compressionType);
 		}
 
 		return NULL;
@@ -2980,6 +3481,10 @@ CitusCopySelect(CopyStmt *copyStatement)
 /*
  * CitusCopyTo runs a COPY .. TO STDOUT command on each shard to do a full
  * table dump.
+ *
+ * When citus.parallel_copy_to is set, we run the commands of several shards
+ * at a time, and either send the shards to the client in order or forward
+ * rows of any shard as they arrive.
  */
 static void
 CitusCopyTo(CopyStmt *copyStatement, QueryCompletion *completionTag)
@@ -3001,6 +3506,50 @@ CitusCopyTo(CopyStmt *copyStatement, QueryCompletion *completionTag)
 
 	List *shardIntervalList = LoadShardIntervalList(relationId);
 
+	/*
+	 * We only read shards in parallel outside of transaction blocks, since the
+	 * shards need separate connections, while modified placements need to be
+	 * read over the connection that modified them.
+	 */
+	if (ParallelCopyTo != PARALLEL_COPY_TO_OFF && list_length(shardIntervalList) > 1 &&
+		!IsMultiStatementTransaction())
+	{
+		bool hasHeader = false;
+		List *copyCommandList = NIL;
+
+		DefElem *option = NULL;
+		foreach_ptr(option, copyStatement->options)
+		{
+			if (strcmp(option->defname, "header") == 0)
+			{
+				hasHeader = true;
+			}
+		}
+
+		foreach(shardIntervalCell, shardIntervalList)
+		{
+			ShardInterval *shardInterval = lfirst(shardIntervalCell);
+			StringInfo copyCommand = ConstructCopyStatement(copyStatement,
+															shardInterval->shardId);
+
+			copyCommandList = lappend(copyCommandList, copyCommand->data);
+
+			if (shardIntervalCell == list_head(shardIntervalList))
+			{
+				/* remove header after the first shard */
+				copyStatement->options =
+					RemoveOptionFromList(copyStatement->options, "header");
+			}
+		}
+
+		/* the header of the first shard needs to come first */
+		bool ordered = (ParallelCopyTo == PARALLEL_COPY_TO_ORDERED || hasHeader);
+
+		tuplesSent = CopyShardsToClientInParallel(shardIntervalList, copyCommandList,
+												  ordered);
+		shardIntervalList = NIL;
+	}
+
 	foreach(shardIntervalCell, shardIntervalList)
 	{
 		ShardInterval *shardInterval = lfirst(shardIntervalCell);
@@ -3056,7 +3605,7 @@ CitusCopyTo(CopyStmt *copyStatement, QueryCompletion *completionTag)
 
 			PQclear(result);
 
-			tuplesSent += ForwardCopyDataFromConnection(copyOutState, connection);
+			tuplesSent += ForwardCopyDataFromConnection(connection);
 
 			break;
 		}
@@ -3081,37 +3630,343 @@ CitusCopyTo(CopyStmt *copyStatement, QueryCompletion *completionTag)
 
 
 /*
- * ForwardCopyDataFromConnection forwards copy data received over the given connection
- * to the client or file descriptor.
+ * CopyShardsToClientInParallel runs the given COPY .. TO STDOUT commands on
+ * the shards in parallel and forwards their output to the client. When ordered
+ * is set, the output of a shard is only forwarded after the output of the
+ * preceding shards, while up to citus.max_adaptive_executor_pool_size shards
+ * already run ahead. Otherwise, up to citus.max_adaptive_executor_pool_size
+ * shards run on each worker node, and rows are forwarded as they arrive. The
+ * function returns the number of rows sent.
  */
 static int64
-ForwardCopyDataFromConnection(CopyOutState copyOutState, MultiConnection *connection)
+CopyShardsToClientInParallel(List *shardIntervalList, List *copyCommandList,
+							 bool ordered)
 {
-	char *receiveBuffer = NULL;
-	const int useAsync = 0;
-	bool raiseErrors = true;
+	int shardCount = list_length(shardIntervalList);
+	int maxShardsInFlight = Max(MaxAdaptiveExecutorPoolSize, 1);
+	ShardCopyToState *shardStates = palloc0(shardCount * sizeof(ShardCopyToState));
+	List *pendingShardStateList = NIL;
 	int64 tuplesSent = 0;
 
-	/* receive copy data message in a synchronous manner */
+	for (int shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardCopyToState *shardState = &shardStates[shardIndex];
+		ShardInterval *shardInterval = list_nth(shardIntervalList, shardIndex);
+		List *shardPlacementList = ActiveShardPlacementList(shardInterval->shardId);
+
+		if (shardPlacementList == NIL)
+		{
+			ereport(ERROR, (errmsg("could not find any active placements for shard "
+								   UINT64_FORMAT, shardInterval->shardId)));
+		}
+
+		shardState->shardInterval = shardInterval;
+		shardState->shardPlacement = linitial(shardPlacementList);
+		shardState->copyCommand = list_nth(copyCommandList, shardIndex);
+
+		pendingShardStateList = lappend(pendingShardStateList, shardState);
+	}
+
+	if (ordered)
+	{
+		int nextShardIndex = 0;
+
+		for (int shardIndex = 0; shardIndex < shardCount; shardIndex++)
+		{
+			while (nextShardIndex < shardCount &&
+				   nextShardIndex < shardIndex + maxShardsInFlight)
+			{
+				SendShardCopyTo(&shardStates[nextShardIndex]);
+				nextShardIndex++;
+			}
+
+			MultiConnection *connection = shardStates[shardIndex].connection;
+
+			WaitForShardCopyToStart(connection);
+
+			tuplesSent += ForwardCopyDataFromConnection(connection);
+			UnclaimConnection(connection);
+		}
+
+		return tuplesSent;
+	}
+
+	List *activeShardStateList = NIL;
+	WaitEventSet *waitEventSet = NULL;
+	WaitEvent *events = palloc0((shardCount + 2) * sizeof(WaitEvent));
+
+	while (pendingShardStateList != NIL || activeShardStateList != NIL)
+	{
+		List *startedShardStateList = NIL;
+		ListCell *shardStateCell = NULL;
+
+		foreach(shardStateCell, pendingShardStateList)
+		{
+			ShardCopyToState *shardState = lfirst(shardStateCell);
+			int32 nodeId = shardState->shardPlacement->nodeId;
+
+			if (ShardCopyToCountOnNode(activeShardStateList, nodeId) >=
+				maxShardsInFlight)
+			{
+				continue;
+			}
+
+			SendShardCopyTo(shardState);
+
+			activeShardStateList = lappend(activeShardStateList, shardState);
+			startedShardStateList = lappend(startedShardStateList, shardState);
+			pendingShardStateList = foreach_delete_current(pendingShardStateList,
+														   shardStateCell);
+		}
+
+		/* the workers run all the started commands while we wait for each */
+		ShardCopyToState *shardState = NULL;
+		foreach_ptr(shardState, startedShardStateList)
+		{
+			WaitForShardCopyToStart(shardState->connection);
+
+			/*
+			 * libpq might already have received (all) the copy data while we
+			 * waited for the COPY to start, in which case the socket does not
+			 * become readable anymore.
+			 */
+			if (ForwardAvailableCopyData(shardState->connection, &tuplesSent))
+			{
+				UnclaimConnection(shardState->connection);
+				activeShardStateList = list_delete_ptr(activeShardStateList,
+													   shardState);
+			}
+		}
+
+		if (startedShardStateList != NIL && waitEventSet != NULL)
+		{
+			FreeWaitEventSet(waitEventSet);
+			waitEventSet = NULL;
+		}
+
+		if (activeShardStateList == NIL)
+		{
+			/* all shards that we started were already done */
+			continue;
+		}
+
+		if (waitEventSet == NULL)
+		{
+			waitEventSet = BuildShardCopyToWaitEventSet(activeShardStateList);
+		}
+
+		int eventCount = WaitEventSetWait(waitEventSet, -1, events, shardCount + 2,
+										  PG_WAIT_EXTENSION);
+
+		for (int eventIndex = 0; eventIndex < eventCount; eventIndex++)
+		{
+			WaitEvent *event = &events[eventIndex];
+
+			if (event->events & WL_POSTMASTER_DEATH)
+			{
+				ereport(ERROR, (errmsg("postmaster was shut down, exiting")));
+			}
+
+			if (event->events & WL_LATCH_SET)
+			{
+				ResetLatch(MyLatch);
+				CHECK_FOR_INTERRUPTS();
+				continue;
+			}
+
+			shardState = (ShardCopyToState *) event->user_data;
+
+			if (ForwardAvailableCopyData(shardState->connection, &tuplesSent))
+			{
+				UnclaimConnection(shardState->connection);
+				activeShardStateList = list_delete_ptr(activeShardStateList,
+													   shardState);
+
+				/* the other events in this batch do not use the wait event set */
+				if (waitEventSet != NULL)
+				{
+					FreeWaitEventSet(waitEventSet);
+					waitEventSet = NULL;
+				}
+			}
+		}
+	}
+
+	if (waitEventSet != NULL)
+	{
+		FreeWaitEventSet(waitEventSet);
+	}
+
+	return tuplesSent;
+}
+
+
+/*
+ * ShardCopyToCountOnNode returns the number of shards in the given list that
+ * are copied from the given node.
+ */
+static int
+ShardCopyToCountOnNode(List *shardStateList, int32 nodeId)
+{
+	int shardCount = 0;
+
+	ShardCopyToState *shardState = NULL;
+	foreach_ptr(shardState, shardStateList)
+	{
+		if (shardState->shardPlacement->nodeId == nodeId)
+		{
+			shardCount++;
+		}
+	}
+
+	return shardCount;
+}
+
+
+/*
+ * SendShardCopyTo opens a connection to the placement of the shard and sends
+ * its COPY .. TO STDOUT command, without waiting for the command to start.
+ */
+static void
+SendShardCopyTo(ShardCopyToState *shardState)
+{
+	MultiConnection *connection = GetPlacementConnection(0, shardState->shardPlacement,
+														 NULL);
+
+	if (PQstatus(connection->pgConn) != CONNECTION_OK)
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
+	/* make sure the following shards use other connections */
+	ClaimConnectionExclusively(connection);
+	MarkRemoteTransactionCritical(connection);
+	RemoteTransactionBeginIfNecessary(connection);
+
+	if (!SendRemoteCommand(connection, shardState->copyCommand))
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
+	shardState->connection = connection;
+}
+
+
+/*
+ * WaitForShardCopyToStart waits for the COPY .. TO STDOUT command that was
+ * sent over the connection to start sending copy data.
+ */
+static void
+WaitForShardCopyToStart(MultiConnection *connection)
+{
+	const bool raiseErrors = true;
+
+	PGresult *result = GetRemoteCommandResult(connection, raiseErrors);
+	if (PQresultStatus(result) != PGRES_COPY_OUT)
+	{
+		ReportResultError(connection, result, ERROR);
+	}
+
+	PQclear(result);
+}
+
+
+/*
+ * ForwardAvailableCopyData forwards the copy data that the connection has
+ * received so far to the client, without blocking. It returns true once the
+ * copy is done.
+ */
+static bool
+ForwardAvailableCopyData(MultiConnection *connection, int64 *tuplesSent)
+{
+	char *receiveBuffer = NULL;
+	const int useAsync = 1;
+
+	if (PQconsumeInput(connection->pgConn) == 0)
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
 	int receiveLength = PQgetCopyData(connection->pgConn, &receiveBuffer, useAsync);
 	while (receiveLength > 0)
 	{
-		bool includeEndOfLine = false;
-
-		CopySendData(copyOutState, receiveBuffer, receiveLength);
-		CopySendEndOfRow(copyOutState, includeEndOfLine);
-		tuplesSent++;
+		ForwardCopyData(receiveBuffer, receiveLength);
+		(*tuplesSent)++;
 
 		PQfreemem(receiveBuffer);
 
 		receiveLength = PQgetCopyData(connection->pgConn, &receiveBuffer, useAsync);
 	}
 
-	if (receiveLength != -1)
+	if (receiveLength == 0)
+	{
+		/* we cannot read more data without blocking */
+		return false;
+	}
+	else if (receiveLength != -1)
 	{
 		ReportConnectionError(connection, ERROR);
 	}
 
+	FinishCopyOutFromConnection(connection);
+
+	return true;
+}
+
+
+/*
+ * BuildShardCopyToWaitEventSet creates a WaitEventSet to wait for copy data
+ * on the connections of the given shards.
+ */
+static WaitEventSet *
+BuildShardCopyToWaitEventSet(List *shardStateList)
+{
+	WaitEventSet *waitEventSet =
+		CreateWaitEventSet(CurrentMemoryContext, list_length(shardStateList) + 2);
+
+	ShardCopyToState *shardState = NULL;
+	foreach_ptr(shardState, shardStateList)
+	{
+		MultiConnection *connection = shardState->connection;
+		int sock = PQsocket(connection->pgConn);
+
+		int waitEventSetIndex =
+			CitusAddWaitEventSetToSet(waitEventSet, WL_SOCKET_READABLE, sock,
+									  NULL, (void *) shardState);
+		if (waitEventSetIndex == WAIT_EVENT_SET_INDEX_FAILED)
+		{
+			ReportConnectionError(connection, ERROR);
+		}
+	}
+
+	AddWaitEventToSet(waitEventSet, WL_POSTMASTER_DEATH, PGINVALID_SOCKET, NULL, NULL);
+	AddWaitEventToSet(waitEventSet, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch, NULL);
+
+	return waitEventSet;
+}
+
+
+/*
+ * ForwardCopyData sends a CopyData message that we received from a worker to
+ * the client as is, without copying it into the COPY buffer first.
+ */
+static void
+ForwardCopyData(char *copyData, int copyDataLength)
+{
+	(void) pq_putmessage('d', copyData, copyDataLength);
+}
+
+
+/*
+ * FinishCopyOutFromConnection consumes the result of a COPY .. TO STDOUT
+ * command after the copy data was received, and errors out if the command
+ * failed.
+ */
+static void
+FinishCopyOutFromConnection(MultiConnection *connection)
+{
+	bool raiseErrors = true;
+
 	PGresult *result = GetRemoteCommandResult(connection, raiseErrors);
 	if (!IsResponseOK(result))
 	{
@@ -3120,6 +3975,38 @@ ForwardCopyDataFromConnection(CopyOutState copyOutState, MultiConnection *connec
 
 	PQclear(result);
 	ClearResults(connection, raiseErrors);
+}
+
+
+/*
+ * ForwardCopyDataFromConnection forwards copy data received over the given connection
+ * to the client or file descriptor.
+ */
+static int64
+ForwardCopyDataFromConnection(MultiConnection *connection)
+{
+	char *receiveBuffer = NULL;
+	const int useAsync = 0;
+	int64 tuplesSent = 0;
+
+	/* receive copy data message in a synchronous manner */
+	int receiveLength = PQgetCopyData(connection->pgConn, &receiveBuffer, useAsync);
+	while (receiveLength > 0)
+	{
+		ForwardCopyData(receiveBuffer, receiveLength);
+		tuplesSent++;
+
+		PQfreemem(receiveBuffer);
+
+		receiveLength = PQgetCopyData(connection->pgConn, &receiveBuffer, useAsync);
+	}
+
+	if (receiveLength != -1)
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
+	FinishCopyOutFromConnection(connection);
 
 	return tuplesSent;
 }
@@ -3393,7 +4280,8 @@ InitializeCopyShardState(CopyShardState *shardState,
 	/* release active placement list at the end of this function */
 	MemoryContext oldContext = MemoryContextSwitchTo(localContext);
 
-	List *activePlacementList = ActiveShardPlacementList(shardId);
+	/* asynchronously replicated reference tables only copy to their primary */
+	List *activePlacementList = WritableShardPlacementList(shardId);
 
 	MemoryContextSwitchTo(oldContext);
 
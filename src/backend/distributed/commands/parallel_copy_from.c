@@ -0,0 +1,937 @@
+/*-------------------------------------------------------------------------
+ *
+ * parallel_copy_from.c
+ *   Parsing the input of COPY .. FROM STDIN into a distributed table in
+ *   parallel workers.
+ *
+ *   COPY into a distributed table parses every row, finds its shard and
+ *   serialises it for the COPY command on the shard, which makes a single
+ *   COPY stream CPU bound on the coordinator. When
+ *   citus.parallel_copy_from_workers is set, the backend instead reads the
+ *   input from the client and splits it into blocks of whole lines, which it
+ *   hands out to parallel workers over shared memory queues. The workers
+ *   parse the rows of their blocks and send the serialised rows of each shard
+ *   back to the backend, which only forwards them to the shard placements.
+ *   The connections to the workers, and thereby the distributed transaction,
+ *   stay with the backend.
+ *
+ *   Since lines are split without parsing them, only the text format is
+ *   supported, the order of rows in a shard is only preserved per block, and
+ *   the line numbers in errors refer to the input of the parallel worker that
+ *   reports them.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "pgstat.h"
+
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "commands/copy.h"
+#include "commands/progress.h"
+#include "executor/executor.h"
+#include "libpq/libpq.h"
+#include "libpq/pqformat.h"
+#include "nodes/makefuncs.h"
+#include "storage/latch.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+
+#include "pg_version_compat.h"
+
+#include "distributed/citus_safe_lib.h"
+#include "distributed/commands/multi_copy.h"
+#include "distributed/hash_helpers.h"
+#include "distributed/listutils.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/multi_executor.h"
+#include "distributed/relation_access_tracking.h"
+#include "distributed/shard_column_statistics.h"
+
+
+/* keys of the shared memory of the parallel workers */
+#define PARALLEL_COPY_FROM_KEY_SHARED UINT64CONST(0xC17C0F0000000001)
+#define PARALLEL_COPY_FROM_KEY_ARGUMENTS UINT64CONST(0xC17C0F0000000002)
+#define PARALLEL_COPY_FROM_KEY_INPUT_QUEUES UINT64CONST(0xC17C0F0000000003)
+#define PARALLEL_COPY_FROM_KEY_OUTPUT_QUEUES UINT64CONST(0xC17C0F0000000004)
+#define PARALLEL_COPY_FROM_KEY_COUNT 4
+
+/* size of the queues between the backend and each parallel worker */
+#define PARALLEL_COPY_FROM_QUEUE_SIZE (1024 * 1024)
+
+/* input is handed out to the workers in blocks of at least this many bytes */
+#define PARALLEL_COPY_FROM_BLOCK_SIZE (64 * 1024)
+
+/* workers send the rows of a shard once they serialised this many bytes */
+#define PARALLEL_COPY_FROM_FLUSH_SIZE (64 * 1024)
+
+
+/*
+ * ParallelCopyFromShared is the fixed size part of the shared memory of the
+ * parallel workers.
+ */
+typedef struct ParallelCopyFromShared
+{
+	Oid relationId;
+	int partitionColumnIndex;
+	uint64 appendShardId;
+} ParallelCopyFromShared;
+
+
+/*
+ * ParallelCopyFromRowsHeader precedes the serialised rows of a shard that a
+ * parallel worker sends to the backend.
+ */
+typedef struct ParallelCopyFromRowsHeader
+{
+	uint64 shardId;
+	int64 rowCount;
+} ParallelCopyFromRowsHeader;
+
+
+/* hash entry in a parallel worker for the rows of a shard that were not sent yet */
+typedef struct ParallelCopyFromShardRows
+{
+	uint64 shardId;
+	StringInfo rowData;
+	int64 rowCount;
+} ParallelCopyFromShardRows;
+
+
+/* state of the backend while parallel workers parse the input */
+typedef struct ParallelCopyFromState
+{
+	CitusCopyDestReceiver *copyDest;
+
+	int workerCount;
+	shm_mq_handle **inputQueues;
+	shm_mq_handle **outputQueues;
+
+	/* whether a worker detached from its output queue */
+	bool *workerDone;
+	int activeWorkerCount;
+
+	/* worker that receives the next block of input */
+	int nextWorkerIndex;
+
+	uint64 processedRowCount;
+} ParallelCopyFromState;
+
+
+/* GUC, number of parallel workers that parse COPY .. FROM STDIN, 0 disables */
+int ParallelCopyFromWorkers = 0;
+
+
+/* input queue of a parallel worker, and the rest of the last block it received */
+static shm_mq_handle *ParallelCopyFromInputQueue = NULL;
+static char *ParallelCopyFromInputData = NULL;
+static Size ParallelCopyFromInputLength = 0;
+
+
+/* local function declarations */
+static char * ParallelCopyFromArguments(CitusCopyDestReceiver *copyDest,
+										CopyStmt *copyStatement);
+static void PrepareParallelCopyFromAccesses(CitusCopyDestReceiver *copyDest);
+static void SendCopyInResponse(int columnCount);
+static void ReadCopyInputIntoBlocks(ParallelCopyFromState *state);
+static int ReceiveCopyDataMessage(StringInfo message);
+static int EndOfCopyMarkerOffset(const char *data, int length);
+static int LastLineEndOffset(const char *data, int length);
+static void SendBlockToWorker(ParallelCopyFromState *state, char *data, int length);
+static bool ForwardRowsFromWorkers(ParallelCopyFromState *state);
+static void WaitForParallelCopyFromWorkers(void);
+static int ReadParallelCopyFromInput(void *outbuf, int minread, int maxread);
+static void SendShardRowsToBackend(shm_mq_handle *outputQueue,
+								   ParallelCopyFromShardRows *shardRows);
+
+
+/*
+ * ParallelCopyFrom reads the input of the given COPY .. FROM STDIN command
+ * from the client and lets up to citus.parallel_copy_from_workers parallel
+ * workers parse it, while forwarding the rows that they serialise to the copy
+ * destination, which needs to be started. It returns false without reading
+ * any input if no parallel worker could be launched, and otherwise sets
+ * processedRowCount to the number of rows copied.
+ */
+bool
+ParallelCopyFrom(CitusCopyDestReceiver *copyDest, CopyStmt *copyStatement,
+				 uint64 *processedRowCount)
+{
+	Relation distributedRelation = copyDest->distributedRelation;
+	int workerCount = ParallelCopyFromWorkers;
+	char *arguments = ParallelCopyFromArguments(copyDest, copyStatement);
+
+	/* catalogs cannot be written and GUCs cannot be changed in parallel mode */
+	PrepareParallelCopyFromAccesses(copyDest);
+
+	EnterParallelMode();
+
+	ParallelContext *parallelContext =
+		CreateParallelContext("citus", "ParallelCopyFromWorkerMain", workerCount);
+
+	Size queueSpaceSize = mul_size(PARALLEL_COPY_FROM_QUEUE_SIZE, workerCount);
+
+	shm_toc_estimate_chunk(&parallelContext->estimator, sizeof(ParallelCopyFromShared));
+	shm_toc_estimate_chunk(&parallelContext->estimator, strlen(arguments) + 1);
+	shm_toc_estimate_chunk(&parallelContext->estimator, queueSpaceSize);
+	shm_toc_estimate_chunk(&parallelContext->estimator, queueSpaceSize);
+	shm_toc_estimate_keys(&parallelContext->estimator, PARALLEL_COPY_FROM_KEY_COUNT);
+
+	InitializeParallelDSM(parallelContext);
+
+	/* without a dynamic shared memory segment, we cannot launch workers */
+	if (parallelContext->seg == NULL)
+	{
+		DestroyParallelContext(parallelContext);
+		ExitParallelMode();
+
+		return false;
+	}
+
+	shm_toc *toc = parallelContext->toc;
+
+	ParallelCopyFromShared *shared =
+		shm_toc_allocate(toc, sizeof(ParallelCopyFromShared));
+	shared->relationId = RelationGetRelid(distributedRelation);
+	shared->partitionColumnIndex = copyDest->partitionColumnIndex;
+	shared->appendShardId = copyDest->appendShardId;
+	shm_toc_insert(toc, PARALLEL_COPY_FROM_KEY_SHARED, shared);
+
+	char *sharedArguments = shm_toc_allocate(toc, strlen(arguments) + 1);
+	strcpy_s(sharedArguments, strlen(arguments) + 1, arguments);
+	shm_toc_insert(toc, PARALLEL_COPY_FROM_KEY_ARGUMENTS, sharedArguments);
+
+	char *inputQueueSpace = shm_toc_allocate(toc, queueSpaceSize);
+	shm_toc_insert(toc, PARALLEL_COPY_FROM_KEY_INPUT_QUEUES, inputQueueSpace);
+
+	char *outputQueueSpace = shm_toc_allocate(toc, queueSpaceSize);
+	shm_toc_insert(toc, PARALLEL_COPY_FROM_KEY_OUTPUT_QUEUES, outputQueueSpace);
+
+	ParallelCopyFromState state = { 0 };
+	state.copyDest = copyDest;
+	state.inputQueues = palloc0(workerCount * sizeof(shm_mq_handle *));
+	state.outputQueues = palloc0(workerCount * sizeof(shm_mq_handle *));
+	state.workerDone = palloc0(workerCount * sizeof(bool));
+
+	for (int workerIndex = 0; workerIndex < workerCount; workerIndex++)
+	{
+		Size queueOffset = mul_size(PARALLEL_COPY_FROM_QUEUE_SIZE, workerIndex);
+
+		shm_mq *inputQueue = shm_mq_create(inputQueueSpace + queueOffset,
+										   PARALLEL_COPY_FROM_QUEUE_SIZE);
+		shm_mq_set_sender(inputQueue, MyProc);
+		state.inputQueues[workerIndex] =
+			shm_mq_attach(inputQueue, parallelContext->seg, NULL);
+
+		shm_mq *outputQueue = shm_mq_create(outputQueueSpace + queueOffset,
+											PARALLEL_COPY_FROM_QUEUE_SIZE);
+		shm_mq_set_receiver(outputQueue, MyProc);
+		state.outputQueues[workerIndex] =
+			shm_mq_attach(outputQueue, parallelContext->seg, NULL);
+	}
+
+	LaunchParallelWorkers(parallelContext);
+
+	if (parallelContext->nworkers_launched == 0)
+	{
+		DestroyParallelContext(parallelContext);
+		ExitParallelMode();
+
+		return false;
+	}
+
+	ereport(DEBUG1, (errmsg("parsing COPY input in %d parallel workers",
+							parallelContext->nworkers_launched)));
+
+	/* only hand out input to the workers that were launched */
+	state.workerCount = parallelContext->nworkers_launched;
+	state.activeWorkerCount = state.workerCount;
+
+	for (int workerIndex = 0; workerIndex < state.workerCount; workerIndex++)
+	{
+		BackgroundWorkerHandle *workerHandle =
+			parallelContext->worker[workerIndex].bgwhandle;
+
+		shm_mq_set_handle(state.inputQueues[workerIndex], workerHandle);
+		shm_mq_set_handle(state.outputQueues[workerIndex], workerHandle);
+	}
+
+	List *attnumList = CopyGetAttnums(RelationGetDescr(distributedRelation),
+									  distributedRelation, copyStatement->attlist);
+
+	SendCopyInResponse(list_length(attnumList));
+
+	ReadCopyInputIntoBlocks(&state);
+
+	/* the workers see the end of their input once we detach */
+	for (int workerIndex = 0; workerIndex < state.workerCount; workerIndex++)
+	{
+		shm_mq_detach(state.inputQueues[workerIndex]);
+	}
+
+	while (state.activeWorkerCount > 0)
+	{
+		if (!ForwardRowsFromWorkers(&state))
+		{
+			WaitForParallelCopyFromWorkers();
+		}
+	}
+
+	WaitForParallelWorkersToFinish(parallelContext);
+	DestroyParallelContext(parallelContext);
+	ExitParallelMode();
+
+	*processedRowCount = state.processedRowCount;
+
+	return true;
+}
+
+
+/*
+ * ParallelCopyFromArguments serialises the column names of the copy
+ * destination, and the column list and options of the COPY command, which the
+ * parallel workers need to parse and serialise the rows in the same way.
+ */
+static char *
+ParallelCopyFromArguments(CitusCopyDestReceiver *copyDest, CopyStmt *copyStatement)
+{
+	List *columnNameList = NIL;
+	List *optionList = NIL;
+
+	char *columnName = NULL;
+	foreach_ptr(columnName, copyDest->columnNameList)
+	{
+		columnNameList = lappend(columnNameList, makeString(columnName));
+	}
+
+	/* options of the text format have single values, pass them as strings */
+	DefElem *option = NULL;
+	foreach_ptr(option, copyStatement->options)
+	{
+		optionList = lappend(optionList, makeString(option->defname));
+		optionList = lappend(optionList, makeString(defGetString(option)));
+	}
+
+	return nodeToString(list_make3(columnNameList, copyStatement->attlist, optionList));
+}
+
+
+/*
+ * PrepareParallelCopyFromAccesses does the bookkeeping that the copy
+ * destination otherwise does when it first sees the rows of a shard, since
+ * the statistics of the shards cannot be invalidated and the multi-shard
+ * modify mode cannot be switched while the parallel workers run. We do not
+ * know upfront which shards the input covers, and assume that it covers all.
+ */
+static void
+PrepareParallelCopyFromAccesses(CitusCopyDestReceiver *copyDest)
+{
+	Oid relationId = copyDest->distributedRelationId;
+	List *shardIntervalList = LoadShardIntervalList(relationId);
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		InvalidateShardColumnStatistics(shardInterval->shardId);
+	}
+
+	if (list_length(shardIntervalList) > 1)
+	{
+		copyDest->multiShardCopy = true;
+
+		if (MultiShardConnectionType != SEQUENTIAL_CONNECTION)
+		{
+			RecordParallelModifyAccess(relationId);
+		}
+	}
+}
+
+
+/*
+ * SendCopyInResponse tells the client to start sending the input of a COPY
+ * in text format with the given number of columns.
+ */
+static void
+SendCopyInResponse(int columnCount)
+{
+	StringInfoData message;
+
+	pq_beginmessage(&message, 'G');
+	pq_sendbyte(&message, 0);   /* overall format */
+	pq_sendint16(&message, columnCount);
+	for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		pq_sendint16(&message, 0);  /* per-column formats */
+	}
+	pq_endmessage(&message);
+	pq_flush();
+}
+
+
+/*
+ * ReadCopyInputIntoBlocks reads the input of the COPY from the client until it
+ * is done, and hands it out to the parallel workers in blocks of whole lines.
+ * Everything after an end-of-copy marker (\.) is discarded, like COPY does.
+ */
+static void
+ReadCopyInputIntoBlocks(ParallelCopyFromState *state)
+{
+	StringInfo block = makeStringInfo();
+	StringInfo message = makeStringInfo();
+	bool endOfCopyMarkerFound = false;
+
+	while (ReceiveCopyDataMessage(message) == 'd')
+	{
+		if (endOfCopyMarkerFound)
+		{
+			continue;
+		}
+
+		appendBinaryStringInfo(block, message->data, message->len);
+
+		if (block->len < PARALLEL_COPY_FROM_BLOCK_SIZE)
+		{
+			continue;
+		}
+
+		int blockLength = LastLineEndOffset(block->data, block->len) + 1;
+		if (blockLength == 0)
+		{
+			/* wait for the end of a line longer than a block */
+			continue;
+		}
+
+		int endOfCopyMarkerOffset = EndOfCopyMarkerOffset(block->data, blockLength);
+		if (endOfCopyMarkerOffset >= 0)
+		{
+			endOfCopyMarkerFound = true;
+			blockLength = endOfCopyMarkerOffset;
+		}
+
+		if (blockLength > 0)
+		{
+			SendBlockToWorker(state, block->data, blockLength);
+		}
+
+		/* keep the incomplete line at the end of the block for the next one */
+		int remainingLength = block->len - blockLength;
+
+		if (endOfCopyMarkerFound)
+		{
+			remainingLength = 0;
+		}
+		else if (remainingLength > 0)
+		{
+			memmove_s(block->data, block->maxlen, block->data + blockLength,
+					  remainingLength);
+		}
+
+		block->len = remainingLength;
+		block->data[block->len] = '\0';
+
+		/* forward the rows that are ready while the client sends more input */
+		ForwardRowsFromWorkers(state);
+	}
+
+	if (!endOfCopyMarkerFound && block->len > 0)
+	{
+		int blockLength = block->len;
+		int endOfCopyMarkerOffset = EndOfCopyMarkerOffset(block->data, blockLength);
+		if (endOfCopyMarkerOffset >= 0)
+		{
+			blockLength = endOfCopyMarkerOffset;
+		}
+
+		if (blockLength > 0)
+		{
+			SendBlockToWorker(state, block->data, blockLength);
+		}
+	}
+}
+
+
+/*
+ * ReceiveCopyDataMessage receives the next COPY message from the client into
+ * the given buffer, and returns 'd' for CopyData or 'c' for CopyDone. It
+ * errors out when the client fails the COPY, similar to CopyGetData in
+ * copyfromparse.c.
+ */
+static int
+ReceiveCopyDataMessage(StringInfo message)
+{
+	while (true)
+	{
+		int maxMessageLength = 0;
+
+		resetStringInfo(message);
+
+		HOLD_CANCEL_INTERRUPTS();
+		pq_startmsgread();
+
+		int messageType = pq_getbyte();
+		if (messageType == EOF)
+		{
+			ereport(ERROR, (errcode(ERRCODE_CONNECTION_FAILURE),
+							errmsg("unexpected EOF on client connection with an "
+								   "open transaction")));
+		}
+
+		switch (messageType)
+		{
+			case 'd':   /* CopyData */
+			{
+				maxMessageLength = PQ_LARGE_MAX_MESSAGE_LENGTH;
+				break;
+			}
+
+			case 'c':   /* CopyDone */
+			case 'f':   /* CopyFail */
+			case 'H':   /* Flush */
+			case 'S':   /* Sync */
+			{
+				maxMessageLength = PQ_SMALL_MAX_MESSAGE_LENGTH;
+				break;
+			}
+
+			default:
+			{
+				ereport(ERROR, (errcode(ERRCODE_PROTOCOL_VIOLATION),
+								errmsg("unexpected message type 0x%02X during COPY "
+									   "from stdin", messageType)));
+			}
+		}
+
+		if (pq_getmessage(message, maxMessageLength))
+		{
+			ereport(ERROR, (errcode(ERRCODE_CONNECTION_FAILURE),
+							errmsg("unexpected EOF on client connection with an "
+								   "open transaction")));
+		}
+
+		RESUME_CANCEL_INTERRUPTS();
+
+		if (messageType == 'f')
+		{
+			ereport(ERROR, (errcode(ERRCODE_QUERY_CANCELED),
+							errmsg("COPY from stdin failed: %s",
+								   pq_getmsgstring(message))));
+		}
+
+		/* ignore Flush and Sync, which some client libraries send during COPY */
+		if (messageType == 'd' || messageType == 'c')
+		{
+			return messageType;
+		}
+	}
+}
+
+
+/*
+ * EndOfCopyMarkerOffset returns the offset of the first line in the given
+ * data that consists of an end-of-copy marker, or -1 if there is none.
+ */
+static int
+EndOfCopyMarkerOffset(const char *data, int length)
+{
+	int lineOffset = 0;
+
+	while (lineOffset < length)
+	{
+		const char *line = data + lineOffset;
+		const char *lineEnd = memchr(line, '\n', length - lineOffset);
+		int lineLength = (lineEnd != NULL) ? lineEnd - line : length - lineOffset;
+
+		if (lineLength >= 2 && line[0] == '\\' && line[1] == '.' &&
+			(lineLength == 2 || (lineLength == 3 && line[2] == '\r')))
+		{
+			return lineOffset;
+		}
+
+		lineOffset += lineLength + 1;
+	}
+
+	return -1;
+}
+
+
+/*
+ * LastLineEndOffset returns the offset of the last newline in the given data,
+ * or -1 if there is none.
+ */
+static int
+LastLineEndOffset(const char *data, int length)
+{
+	for (int offset = length - 1; offset >= 0; offset--)
+	{
+		if (data[offset] == '\n')
+		{
+			return offset;
+		}
+	}
+
+	return -1;
+}
+
+
+/*
+ * SendBlockToWorker sends a block of input to the next parallel worker in
+ * turn. While the worker is busy, we forward the rows of the workers to the
+ * shards, such that neither side waits for the other.
+ */
+static void
+SendBlockToWorker(ParallelCopyFromState *state, char *data, int length)
+{
+	int workerIndex = state->nextWorkerIndex;
+	const bool noWait = true;
+	const bool forceFlush = true;
+
+	state->nextWorkerIndex = (workerIndex + 1) % state->workerCount;
+
+	while (true)
+	{
+		shm_mq_result result = shm_mq_send_compat(state->inputQueues[workerIndex],
+												  length, data, noWait, forceFlush);
+		if (result == SHM_MQ_SUCCESS)
+		{
+			break;
+		}
+		else if (result == SHM_MQ_DETACHED)
+		{
+			ereport(ERROR, (errmsg("parallel worker for COPY exited unexpectedly")));
+		}
+
+		if (!ForwardRowsFromWorkers(state))
+		{
+			WaitForParallelCopyFromWorkers();
+		}
+	}
+}
+
+
+/*
+ * ForwardRowsFromWorkers forwards the rows that the parallel workers sent so
+ * far to the copy destination, without blocking. It returns whether there
+ * was anything to forward, or a worker was done.
+ */
+static bool
+ForwardRowsFromWorkers(ParallelCopyFromState *state)
+{
+	CitusCopyDestReceiver *copyDest = state->copyDest;
+	const bool noWait = true;
+	bool progress = false;
+
+	for (int workerIndex = 0; workerIndex < state->workerCount; workerIndex++)
+	{
+		if (state->workerDone[workerIndex])
+		{
+			continue;
+		}
+
+		while (true)
+		{
+			Size messageLength = 0;
+			void *messageData = NULL;
+
+			shm_mq_result result = shm_mq_receive(state->outputQueues[workerIndex],
+												  &messageLength, &messageData,
+												  noWait);
+			if (result == SHM_MQ_WOULD_BLOCK)
+			{
+				break;
+			}
+			else if (result == SHM_MQ_DETACHED)
+			{
+				/* errors of the worker are reported via its error queue */
+				state->workerDone[workerIndex] = true;
+				state->activeWorkerCount--;
+				progress = true;
+				break;
+			}
+
+			ParallelCopyFromRowsHeader header = { 0 };
+
+			if (messageLength < sizeof(ParallelCopyFromRowsHeader))
+			{
+				ereport(ERROR, (errmsg("invalid message from parallel worker for "
+									   "COPY")));
+			}
+
+			memcpy_s(&header, sizeof(header), messageData, sizeof(header));
+
+			StringInfoData rowData = { 0 };
+			rowData.data = (char *) messageData + sizeof(header);
+			rowData.len = messageLength - sizeof(header);
+			rowData.maxlen = rowData.len;
+
+			CitusCopyDestReceiverSendRows(copyDest, header.shardId, &rowData,
+										  header.rowCount);
+
+			state->processedRowCount += header.rowCount;
+			pgstat_progress_update_param(PROGRESS_COPY_TUPLES_PROCESSED,
+										 state->processedRowCount);
+
+			progress = true;
+		}
+	}
+
+	return progress;
+}
+
+
+/*
+ * WaitForParallelCopyFromWorkers waits until a parallel worker reads from or
+ * writes to one of the queues, which sets our latch.
+ */
+static void
+WaitForParallelCopyFromWorkers(void)
+{
+	(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+					 PG_WAIT_EXTENSION);
+	ResetLatch(MyLatch);
+
+	/* also reports the errors of the parallel workers */
+	CHECK_FOR_INTERRUPTS();
+}
+
+
+/*
+ * ParallelCopyFromWorkerMain is the entry point of the parallel workers that
+ * parse the input of COPY .. FROM STDIN. A worker parses the blocks of input
+ * that it receives, finds the shards of the rows, and sends the serialised
+ * rows of each shard back to the backend until its input ends.
+ */
+void
+ParallelCopyFromWorkerMain(dsm_segment *segment, shm_toc *toc)
+{
+	ParallelCopyFromShared *shared =
+		shm_toc_lookup(toc, PARALLEL_COPY_FROM_KEY_SHARED, false);
+	char *arguments = shm_toc_lookup(toc, PARALLEL_COPY_FROM_KEY_ARGUMENTS, false);
+	char *inputQueueSpace = shm_toc_lookup(toc, PARALLEL_COPY_FROM_KEY_INPUT_QUEUES,
+										   false);
+	char *outputQueueSpace = shm_toc_lookup(toc, PARALLEL_COPY_FROM_KEY_OUTPUT_QUEUES,
+											false);
+	Size queueOffset = mul_size(PARALLEL_COPY_FROM_QUEUE_SIZE, ParallelWorkerNumber);
+
+	shm_mq *inputQueue = (shm_mq *) (inputQueueSpace + queueOffset);
+	shm_mq_set_receiver(inputQueue, MyProc);
+	ParallelCopyFromInputQueue = shm_mq_attach(inputQueue, segment, NULL);
+
+	shm_mq *outputQueue = (shm_mq *) (outputQueueSpace + queueOffset);
+	shm_mq_set_sender(outputQueue, MyProc);
+	shm_mq_handle *outputQueueHandle = shm_mq_attach(outputQueue, segment, NULL);
+
+	List *argumentList = (List *) stringToNode(arguments);
+	List *columnNameList = NIL;
+	List *attlist = lsecond(argumentList);
+	List *optionList = NIL;
+
+	String *columnName = NULL;
+	foreach_ptr(columnName, (List *) linitial(argumentList))
+	{
+		columnNameList = lappend(columnNameList, strVal(columnName));
+	}
+
+	List *optionStringList = lthird(argumentList);
+	for (int optionIndex = 0; optionIndex < list_length(optionStringList);
+		 optionIndex += 2)
+	{
+		char *optionName = strVal(list_nth(optionStringList, optionIndex));
+		String *optionValue = list_nth(optionStringList, optionIndex + 1);
+
+		optionList = lappend(optionList,
+							 makeDefElem(optionName, (Node *) optionValue, -1));
+	}
+
+	Relation distributedRelation = table_open(shared->relationId, AccessShareLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(distributedRelation);
+	uint32 columnCount = tupleDescriptor->natts;
+	Datum *columnValues = palloc0(columnCount * sizeof(Datum));
+	bool *columnNulls = palloc0(columnCount * sizeof(bool));
+
+	EState *executorState = CreateExecutorState();
+	MemoryContext executorTupleContext = GetPerTupleMemoryContext(executorState);
+	ExprContext *executorExpressionContext = GetPerTupleExprContext(executorState);
+
+	/* serialise the rows in the same way as the copy destination of the backend */
+	const bool publishableData = true;
+	CitusCopyDestReceiver *copyDest =
+		CreateCitusCopyDestReceiver(shared->relationId, columnNameList,
+									shared->partitionColumnIndex, executorState, NULL,
+									publishableData);
+	copyDest->distributedRelation = distributedRelation;
+	copyDest->tupleDescriptor = tupleDescriptor;
+	copyDest->appendShardId = shared->appendShardId;
+
+	InitializeCopyRowSerialization(copyDest, tupleDescriptor);
+
+	CopyOutState copyOutState = copyDest->copyOutState;
+	const bool isInputFormatBinary = false;
+	Relation parseRelation = CopyFromParseRelation(distributedRelation, attlist,
+												   isInputFormatBinary, copyDest);
+
+	CopyFromState copyState = BeginCopyFrom(NULL, parseRelation, NULL, NULL, false,
+											ReadParallelCopyFromInput, attlist,
+											optionList);
+
+	ErrorContextCallback errorCallback;
+	errorCallback.callback = CopyFromErrorCallback;
+	errorCallback.arg = (void *) copyState;
+	errorCallback.previous = error_context_stack;
+	error_context_stack = &errorCallback;
+
+	HTAB *shardRowsHash = CreateSimpleHash(uint64, ParallelCopyFromShardRows);
+
+	while (true)
+	{
+		ResetPerTupleExprContext(executorState);
+
+		MemoryContext oldContext = MemoryContextSwitchTo(executorTupleContext);
+
+		bool nextRowFound = NextCopyFrom(copyState, executorExpressionContext,
+										 columnValues, columnNulls);
+		if (!nextRowFound)
+		{
+			MemoryContextSwitchTo(oldContext);
+			break;
+		}
+
+		uint64 shardId = ShardIdForTuple(copyDest, columnValues, columnNulls);
+
+		resetStringInfo(copyOutState->fe_msgbuf);
+		AppendCopyRowData(columnValues, columnNulls, tupleDescriptor, copyOutState,
+						  copyDest->columnOutputFunctions,
+						  copyDest->columnCoercionPaths);
+
+		MemoryContextSwitchTo(oldContext);
+
+		bool found = false;
+		ParallelCopyFromShardRows *shardRows =
+			hash_search(shardRowsHash, &shardId, HASH_ENTER, &found);
+		if (!found)
+		{
+			shardRows->rowData = makeStringInfo();
+			shardRows->rowCount = 0;
+		}
+
+		appendBinaryStringInfo(shardRows->rowData, copyOutState->fe_msgbuf->data,
+							   copyOutState->fe_msgbuf->len);
+		shardRows->rowCount++;
+
+		if (shardRows->rowData->len >= PARALLEL_COPY_FROM_FLUSH_SIZE)
+		{
+			SendShardRowsToBackend(outputQueueHandle, shardRows);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	EndCopyFrom(copyState);
+
+	error_context_stack = errorCallback.previous;
+
+	HASH_SEQ_STATUS status;
+	hash_seq_init(&status, shardRowsHash);
+
+	ParallelCopyFromShardRows *shardRows = NULL;
+	while ((shardRows = hash_seq_search(&status)) != NULL)
+	{
+		if (shardRows->rowCount > 0)
+		{
+			SendShardRowsToBackend(outputQueueHandle, shardRows);
+		}
+	}
+
+	shm_mq_detach(outputQueueHandle);
+
+	FreeExecutorState(executorState);
+	table_close(distributedRelation, AccessShareLock);
+}
+
+
+/*
+ * ReadParallelCopyFromInput is the data source of the COPY in a parallel
+ * worker, which reads the blocks of input it receives from the backend. It
+ * returns fewer than minread bytes only when the backend detached from the
+ * queue at the end of the input.
+ */
+static int
+ReadParallelCopyFromInput(void *outbuf, int minread, int maxread)
+{
+	char *outputBuffer = (char *) outbuf;
+	int bytesRead = 0;
+	const bool noWait = false;
+
+	while (bytesRead < minread)
+	{
+		if (ParallelCopyFromInputLength == 0)
+		{
+			Size blockLength = 0;
+			void *blockData = NULL;
+
+			shm_mq_result result = shm_mq_receive(ParallelCopyFromInputQueue,
+												  &blockLength, &blockData, noWait);
+			if (result == SHM_MQ_DETACHED)
+			{
+				break;
+			}
+
+			/* the block stays valid until we receive the next one */
+			ParallelCopyFromInputData = (char *) blockData;
+			ParallelCopyFromInputLength = blockLength;
+			continue;
+		}
+
+		int copyLength = Min(maxread - bytesRead, (int) ParallelCopyFromInputLength);
+
+		memcpy_s(outputBuffer + bytesRead, maxread - bytesRead,
+				 ParallelCopyFromInputData, copyLength);
+
+		ParallelCopyFromInputData += copyLength;
+		ParallelCopyFromInputLength -= copyLength;
+		bytesRead += copyLength;
+	}
+
+	return bytesRead;
+}
+
+
+/*
+ * SendShardRowsToBackend sends the rows of a shard that a parallel worker
+ * serialised to the backend, and resets them.
+ */
+static void
+SendShardRowsToBackend(shm_mq_handle *outputQueue, ParallelCopyFromShardRows *shardRows)
+{
+	ParallelCopyFromRowsHeader header = { 0 };
+	shm_mq_iovec messageParts[2];
+	const bool noWait = false;
+	const bool forceFlush = true;
+
+	header.shardId = shardRows->shardId;
+	header.rowCount = shardRows->rowCount;
+
+	messageParts[0].data = (char *) &header;
+	messageParts[0].len = sizeof(header);
+	messageParts[1].data = shardRows->rowData->data;
+	messageParts[1].len = shardRows->rowData->len;
+
+	shm_mq_result result = shm_mq_sendv_compat(outputQueue, messageParts, 2, noWait,
+											   forceFlush);
+	if (result != SHM_MQ_SUCCESS)
+	{
+		ereport(ERROR, (errmsg("could not send rows to the backend that runs the "
+							   "COPY")));
+	}
+
+	resetStringInfo(shardRows->rowData);
+	shardRows->rowCount = 0;
+}
@@ -23,12 +23,16 @@
 #include "distributed/backend_data.h"
 #include "distributed/colocation_utils.h"
 #include "distributed/commands.h"
+#include "distributed/coordinator_protocol.h"
 #include "distributed/listutils.h"
 #include "distributed/metadata/distobject.h"
 #include "distributed/metadata_sync.h"
 #include "distributed/multi_partitioning_utils.h"
+#include "distributed/reference_table_utils.h"
 #include "distributed/shard_transfer.h"
 #include "distributed/tenant_schema_metadata.h"
+#include "distributed/utils/array_type.h"
+#include "distributed/worker_manager.h"
 #include "distributed/worker_shard_visibility.h"
 
 
@@ -71,6 +75,7 @@ PG_FUNCTION_INFO_V1(citus_schema_distribute);
 PG_FUNCTION_INFO_V1(citus_schema_undistribute);
 PG_FUNCTION_INFO_V1(citus_schema_move);
 PG_FUNCTION_INFO_V1(citus_schema_move_with_nodeid);
+PG_FUNCTION_INFO_V1(citus_schema_move_batch);
 
 /*
  * ShouldUseSchemaBasedSharding returns true if schema given name should be
@@ -823,6 +828,86 @@ citus_schema_move_with_nodeid(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * citus_schema_move_batch moves the shards of the given distributed tenant
+ * schemas to the given node. The schemas need to be on the same node, and are
+ * moved together in a single shard transfer, which is much cheaper than
+ * moving many small schemas one at a time with citus_schema_move().
+ * Schemas that are already on the target node are skipped.
+ */
+Datum
+citus_schema_move_batch(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+
+	List *referenceTableIdList = NIL;
+	if (HasNodesWithMissingReferenceTables(&referenceTableIdList))
+	{
+		ereport(ERROR, (errmsg("there are missing reference tables on some nodes"),
+						errhint("Copy reference tables first with "
+								"replicate_reference_tables() or use "
+								"citus_rebalance_start() that will do it automatically."
+								)));
+	}
+
+	ArrayType *schemaIdArray = PG_GETARG_ARRAYTYPE_P(0);
+	char *targetNodeName = text_to_cstring(PG_GETARG_TEXT_P(1));
+	int32 targetNodePort = PG_GETARG_INT32(2);
+	char shardReplicationMode = LookupShardTransferMode(PG_GETARG_OID(3));
+
+	WorkerNode *targetNode = FindWorkerNodeOrError(targetNodeName, targetNodePort);
+
+	Datum *schemaIdDatumArray = DeconstructArrayObject(schemaIdArray);
+	int schemaIdCount = ArrayObjectCount(schemaIdArray);
+
+	WorkerNode *sourceNode = NULL;
+	List *anchorShardList = NIL;
+
+	for (int schemaIndex = 0; schemaIndex < schemaIdCount; schemaIndex++)
+	{
+		Oid schemaId = DatumGetObjectId(schemaIdDatumArray[schemaIndex]);
+		CitusMoveSchemaParams *params = CreateCitusMoveSchemaParams(schemaId);
+
+		if (params->sourceNodeId == targetNode->nodeId)
+		{
+			continue;
+		}
+
+		if (sourceNode == NULL)
+		{
+			bool missingOk = false;
+			sourceNode = FindNodeWithNodeId(params->sourceNodeId, missingOk);
+		}
+		else if (sourceNode->nodeId != params->sourceNodeId)
+		{
+			ereport(ERROR, (errmsg("cannot move distributed schemas from different "
+								   "nodes together"),
+							errdetail("Distributed schema %s is on %s:%d, but "
+									  "previous schemas are on %s:%d.",
+									  get_namespace_name(schemaId),
+									  params->sourceNodeName, params->sourceNodePort,
+									  sourceNode->workerName, sourceNode->workerPort),
+							errhint("Move the schemas of each node in a separate "
+									"call.")));
+		}
+
+		ShardInterval *anchorShard = LoadShardInterval(params->anchorShardId);
+		anchorShardList = lappend(anchorShardList, anchorShard);
+	}
+
+	if (anchorShardList == NIL)
+	{
+		PG_RETURN_VOID();
+	}
+
+	MoveShardGroupsToNode(anchorShardList, sourceNode, targetNode,
+						  shardReplicationMode);
+
+	PG_RETURN_VOID();
+}
+
+
 /*
  * CreateCitusMoveSchemaParams is a helper function for
  * citus_schema_move() and citus_schema_move_with_nodeid()
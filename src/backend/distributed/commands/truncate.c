@@ -35,6 +35,7 @@
 #include "distributed/metadata_sync.h"
 #include "distributed/multi_executor.h"
 #include "distributed/multi_join_order.h"
+#include "distributed/placement_connection.h"
 #include "distributed/reference_table_utils.h"
 #include "distributed/resource_lock.h"
 #include "distributed/transaction_management.h"
@@ -42,11 +43,30 @@
 #include "distributed/worker_transaction.h"
 
 
+/*
+ * TruncateShardBatch is a set of shards of a relation that are truncated by
+ * a single command on the placement groups in groupIdList.
+ */
+typedef struct TruncateShardBatch
+{
+	List *groupIdList;
+	List *placementList;
+	List *shardIntervalList;
+
+	/* false for shards that need to be truncated by a command of their own */
+	bool acceptsMoreShards;
+} TruncateShardBatch;
+
+
 /* Local functions forward declarations for unsupported command checks */
 static void ErrorIfUnsupportedTruncateStmt(TruncateStmt *truncateStatement);
 static void ExecuteTruncateStmtSequentialIfNecessary(TruncateStmt *command);
 static void EnsurePartitionTableNotReplicatedForTruncate(TruncateStmt *truncateStatement);
 static List * TruncateTaskList(Oid relationId);
+static bool CanTruncateShardInBatch(List *placementList, int32 localGroupId);
+static TruncateShardBatch * FindTruncateShardBatch(List *shardBatchList,
+												   List *groupIdList);
+static Task * TruncateShardBatchTask(Oid relationId, TruncateShardBatch *shardBatch);
 
 
 /* exports for SQL callable functions */
@@ -115,6 +135,13 @@ citus_truncate_trigger(PG_FUNCTION_ARGS)
  * distributed table. This is handled separately from other DDL commands
  * because we handle it via the TRUNCATE trigger, which is called whenever
  * a truncate cascades.
+ *
+ * Shards whose placements are on the same remote nodes are truncated by a
+ * single TRUNCATE command, such that truncating a table with many shards
+ * takes one round trip per node rather than one per shard. Shards with a
+ * local placement, or with a placement that was already accessed in the
+ * transaction, get a task of their own, since the executor might need to
+ * use a particular connection (or local execution) for each of them.
  */
 static List *
 TruncateTaskList(Oid relationId)
@@ -125,17 +152,126 @@ TruncateTaskList(Oid relationId)
 	/* enumerate the tasks when putting them to the taskList */
 	int taskId = 1;
 
-	Oid schemaId = get_rel_namespace(relationId);
-	char *schemaName = get_namespace_name(schemaId);
-	char *relationName = get_rel_name(relationId);
-
 	List *shardIntervalList = LoadShardIntervalList(relationId);
 
 	/* lock metadata before getting placement lists */
 	LockShardListMetadata(shardIntervalList, ShareLock);
 
+	int32 localGroupId = GetLocalGroupId();
+	List *shardBatchList = NIL;
+
 	ShardInterval *shardInterval = NULL;
 	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		List *placementList = ActiveShardPlacementList(shardInterval->shardId);
+		List *sortedPlacementList = SortList(placementList,
+											 CompareShardPlacementsByGroupId);
+		List *groupIdList = NIL;
+
+		ShardPlacement *placement = NULL;
+		foreach_ptr(placement, sortedPlacementList)
+		{
+			groupIdList = lappend_int(groupIdList, placement->groupId);
+		}
+
+		bool canBatch = CanTruncateShardInBatch(sortedPlacementList, localGroupId);
+		TruncateShardBatch *shardBatch = NULL;
+
+		if (canBatch)
+		{
+			shardBatch = FindTruncateShardBatch(shardBatchList, groupIdList);
+		}
+
+		if (shardBatch == NULL)
+		{
+			shardBatch = palloc0(sizeof(TruncateShardBatch));
+			shardBatch->groupIdList = groupIdList;
+			shardBatch->placementList = placementList;
+			shardBatch->acceptsMoreShards = canBatch;
+
+			shardBatchList = lappend(shardBatchList, shardBatch);
+		}
+
+		shardBatch->shardIntervalList = lappend(shardBatch->shardIntervalList,
+												shardInterval);
+	}
+
+	TruncateShardBatch *shardBatch = NULL;
+	foreach_ptr(shardBatch, shardBatchList)
+	{
+		Task *task = TruncateShardBatchTask(relationId, shardBatch);
+		task->taskId = taskId++;
+
+		taskList = lappend(taskList, task);
+	}
+
+	return taskList;
+}
+
+
+/*
+ * CanTruncateShardInBatch returns whether a shard with the given placements
+ * can be truncated by the same command as other shards on the same nodes.
+ */
+static bool
+CanTruncateShardInBatch(List *placementList, int32 localGroupId)
+{
+	ShardPlacement *placement = NULL;
+	foreach_ptr(placement, placementList)
+	{
+		if (placement->groupId == localGroupId ||
+			PlacementAccessedInTransaction(placement))
+		{
+			return false;
+		}
+	}
+
+	return placementList != NIL;
+}
+
+
+/*
+ * FindTruncateShardBatch returns the batch of the shards that have placements
+ * on exactly the given groups, or NULL if there is no such batch that accepts
+ * more shards.
+ */
+static TruncateShardBatch *
+FindTruncateShardBatch(List *shardBatchList, List *groupIdList)
+{
+	TruncateShardBatch *shardBatch = NULL;
+	foreach_ptr(shardBatch, shardBatchList)
+	{
+		if (shardBatch->acceptsMoreShards &&
+			equal(shardBatch->groupIdList, groupIdList))
+		{
+			return shardBatch;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * TruncateShardBatchTask returns a DDL task that truncates all shards in the
+ * given batch with a single TRUNCATE command. The first shard is the anchor
+ * shard of the task and the others are added to its relationShardList, such
+ * that the executor records DDL accesses to all of their placements.
+ */
+static Task *
+TruncateShardBatchTask(Oid relationId, TruncateShardBatch *shardBatch)
+{
+	Oid schemaId = get_rel_namespace(relationId);
+	char *schemaName = get_namespace_name(schemaId);
+	char *relationName = get_rel_name(relationId);
+
+	ShardInterval *anchorShardInterval = linitial(shardBatch->shardIntervalList);
+	List *relationShardList = NIL;
+	StringInfo shardQueryString = makeStringInfo();
+	appendStringInfoString(shardQueryString, "TRUNCATE TABLE ");
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardBatch->shardIntervalList)
 	{
 		uint64 shardId = shardInterval->shardId;
 		char *shardRelationName = pstrdup(relationName);
@@ -145,23 +281,33 @@ TruncateTaskList(Oid relationId)
 
 		char *quotedShardName = quote_qualified_identifier(schemaName, shardRelationName);
 
-		StringInfo shardQueryString = makeStringInfo();
-		appendStringInfo(shardQueryString, "TRUNCATE TABLE %s CASCADE", quotedShardName);
+		if (shardInterval != anchorShardInterval)
+		{
+			appendStringInfoString(shardQueryString, ", ");
 
-		Task *task = CitusMakeNode(Task);
-		task->jobId = INVALID_JOB_ID;
-		task->taskId = taskId++;
-		task->taskType = DDL_TASK;
-		SetTaskQueryString(task, shardQueryString->data);
-		task->dependentTaskList = NULL;
-		task->replicationModel = REPLICATION_MODEL_INVALID;
-		task->anchorShardId = shardId;
-		task->taskPlacementList = ActiveShardPlacementList(shardId);
+			RelationShard *relationShard = CitusMakeNode(RelationShard);
+			relationShard->relationId = relationId;
+			relationShard->shardId = shardId;
 
-		taskList = lappend(taskList, task);
+			relationShardList = lappend(relationShardList, relationShard);
+		}
+
+		appendStringInfoString(shardQueryString, quotedShardName);
 	}
 
-	return taskList;
+	appendStringInfoString(shardQueryString, " CASCADE");
+
+	Task *task = CitusMakeNode(Task);
+	task->jobId = INVALID_JOB_ID;
+	task->taskType = DDL_TASK;
+	SetTaskQueryString(task, shardQueryString->data);
+	task->dependentTaskList = NULL;
+	task->replicationModel = REPLICATION_MODEL_INVALID;
+	task->anchorShardId = anchorShardInterval->shardId;
+	task->taskPlacementList = shardBatch->placementList;
+	task->relationShardList = relationShardList;
+
+	return task;
 }
 
 
@@ -35,6 +35,7 @@
 #include "catalog/catalog.h"
 #include "catalog/dependency.h"
 #include "catalog/pg_authid.h"
+#include "catalog/pg_class.h"
 #include "catalog/pg_database.h"
 #include "commands/dbcommands.h"
 #include "commands/defrem.h"
@@ -68,19 +69,24 @@
 #include "distributed/deparser.h"
 #include "distributed/executor_util.h"
 #include "distributed/foreign_key_relationship.h"
+#include "distributed/insert_buffer.h"
 #include "distributed/listutils.h"
 #include "distributed/local_executor.h"
 #include "distributed/maintenanced.h"
 #include "distributed/metadata/distobject.h"
+#include "distributed/metadata_cache.h"
 #include "distributed/metadata_sync.h"
 #include "distributed/multi_executor.h"
 #include "distributed/multi_explain.h"
 #include "distributed/multi_logical_replication.h"
 #include "distributed/multi_partitioning_utils.h"
 #include "distributed/multi_physical_planner.h"
+#include "distributed/placement_connection.h"
 #include "distributed/reference_table_utils.h"
+#include "distributed/relay_utility.h"
 #include "distributed/remote_commands.h"
 #include "distributed/resource_lock.h"
+#include "distributed/shared_placement_cache.h"
 #include "distributed/string_utils.h"
 #include "distributed/transaction_management.h"
 #include "distributed/version_compat.h"
@@ -89,12 +95,25 @@
 
 bool EnableDDLPropagation = true; /* ddl propagation is enabled */
 int CreateObjectPropagationMode = CREATE_OBJECT_PROPAGATION_IMMEDIATE;
+int ShardDDLBatchSize = 1; /* number of shard DDL tasks on a node to batch */
 PropSetCmdBehavior PropagateSetCommands = PROPSETCMD_NONE; /* SET prop off */
 static bool shouldInvalidateForeignKeyGraph = false;
 static int activeAlterTables = 0;
 static int activeDropSchemaOrDBs = 0;
 static bool ConstraintDropped = false;
 
+/*
+ * ShardDDLTaskBatch is a task of a DDL job whose query string is extended with
+ * the commands of other tasks on the placement groups in groupIdList.
+ */
+typedef struct ShardDDLTaskBatch
+{
+	List *groupIdList;
+	Task *task;
+	List *queryStringList;
+	int taskCount;
+} ShardDDLTaskBatch;
+
 ProcessUtility_hook_type PrevProcessUtility = NULL;
 int UtilityHookLevel = 0;
 
@@ -107,6 +126,7 @@ static void citus_ProcessUtilityInternal(PlannedStmt *pstmt,
 										 struct QueryEnvironment *queryEnv,
 										 DestReceiver *dest,
 										 QueryCompletion *completionTag);
+static void ExecuteDDLJobTaskList(DDLJob *ddlJob, bool localExecutionSupported);
 static void set_indexsafe_procflags(void);
 static char * CurrentSearchPath(void);
 static void IncrementUtilityHookCountersIfNecessary(Node *parsetree);
@@ -114,6 +134,11 @@ static void PostStandardProcessUtility(Node *parsetree);
 static void DecrementUtilityHookCountersIfNecessary(Node *parsetree);
 static bool IsDropSchemaOrDB(Node *parsetree);
 static bool ShouldCheckUndistributeCitusLocalTables(void);
+static bool IsLocalOnlyUtilityStmt(Node *parsetree);
+static List * BatchShardDDLTaskListPerNode(List *taskList);
+static bool CanExecuteShardDDLTaskInBatch(Task *task, int32 localGroupId);
+static ShardDDLTaskBatch * FindShardDDLTaskBatch(List *taskBatchList,
+												 List *groupIdList);
 
 
 /*
@@ -171,6 +196,44 @@ citus_ProcessUtility(PlannedStmt *pstmt,
 		{
 			SaveBeginCommandProperties(transactionStmt);
 		}
+
+		/*
+		 * Send the buffered INSERTs and DDL commands before a savepoint is
+		 * created, such that their errors abort the transaction rather than
+		 * the subtransaction. On COMMIT, they are sent by the pre-commit
+		 * callback.
+		 */
+		if (transactionStmt->kind == TRANS_STMT_SAVEPOINT)
+		{
+			FlushBufferedInserts();
+			FlushBufferedDDLPropagation();
+		}
+
+		/*
+		 * A prepared transaction may have modified the metadata, and since
+		 * its commit callbacks do not run, backends do not rebuild their
+		 * metadata cache entries incrementally during and after the commit.
+		 */
+		if (transactionStmt->kind == TRANS_STMT_COMMIT_PREPARED)
+		{
+			BeginPreparedTransactionCommit();
+
+			PG_TRY();
+			{
+				PrevProcessUtility(pstmt, queryString, false, context,
+								   params, queryEnv, dest, completionTag);
+
+				EndPreparedTransactionCommit();
+			}
+			PG_CATCH();
+			{
+				EndPreparedTransactionCommit();
+				PG_RE_THROW();
+			}
+			PG_END_TRY();
+
+			return;
+		}
 	}
 
 	if (IsA(parsetree, TransactionStmt) ||
@@ -198,6 +261,30 @@ citus_ProcessUtility(PlannedStmt *pstmt,
 		return;
 	}
 
+	/*
+	 * Utility commands might read or modify the tables of buffered INSERTs.
+	 * Commands such as SET ROLE also change the user that the placement
+	 * connections are opened for, so we send the buffer even before the
+	 * local-only commands below.
+	 */
+	FlushBufferedInserts();
+
+	if (IsLocalOnlyUtilityStmt(parsetree))
+	{
+		/*
+		 * Commands such as SHOW, non-propagated SET and CREATE TEMP TABLE
+		 * cannot affect distributed objects, so skip copying the statement,
+		 * resolving its object addresses and the post-processing steps.
+		 */
+		ereport(DEBUG4, (errmsg("skipping distributed processing of local-only "
+								"utility statement")));
+
+		PrevProcessUtility(pstmt, queryString, false, context,
+						   params, queryEnv, dest, completionTag);
+
+		return;
+	}
+
 	bool isCreateAlterExtensionUpdateCitusStmt = IsCreateAlterExtensionUpdateCitusStmt(
 		parsetree);
 
@@ -1018,6 +1105,58 @@ UndistributeDisconnectedCitusLocalTables(void)
 }
 
 
+/*
+ * IsLocalOnlyUtilityStmt returns true if the given utility statement cannot
+ * affect distributed objects and does not need to be propagated, such that
+ * citus_ProcessUtility can pass it to standard_ProcessUtility directly.
+ *
+ * We keep this list intentionally short and only cover common statements that
+ * we can classify without catalog lookups.
+ */
+static bool
+IsLocalOnlyUtilityStmt(Node *parsetree)
+{
+	switch (nodeTag(parsetree))
+	{
+		case T_VariableShowStmt:
+		case T_CheckPointStmt:
+		case T_LoadStmt:
+		{
+			return true;
+		}
+
+		case T_VariableSetStmt:
+		{
+			/* SET LOCAL and the like are propagated in multi-statement transactions */
+			VariableSetStmt *setStmt = (VariableSetStmt *) parsetree;
+
+			return !(IsMultiStatementTransaction() &&
+					 ShouldPropagateSetCommand(setStmt));
+		}
+
+		case T_CreateStmt:
+		{
+			/*
+			 * Temporary tables are never added to metadata and Postgres does
+			 * not allow them to have foreign keys to or be partitions of
+			 * permanent tables. We still go through the regular path for
+			 * INHERITS since inheriting a distributed table is an error.
+			 */
+			CreateStmt *createStmt = (CreateStmt *) parsetree;
+
+			return createStmt->relation->relpersistence == RELPERSISTENCE_TEMP &&
+				   createStmt->inhRelations == NIL &&
+				   createStmt->partbound == NULL;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+
 /*
  * ShouldCheckUndistributeCitusLocalTables returns true if we might need to check
  * citus local tables for undistributing automatically.
@@ -1158,7 +1297,7 @@ ExecuteDistributedDDLJob(DDLJob *ddlJob)
 	{
 		if (shouldSyncMetadata)
 		{
-			SendCommandToRemoteNodesWithMetadata(DISABLE_DDL_PROPAGATION);
+			List *commandList = list_make1(DISABLE_DDL_PROPAGATION);
 
 			char *currentSearchPath = CurrentSearchPath();
 
@@ -1168,18 +1307,31 @@ ExecuteDistributedDDLJob(DDLJob *ddlJob)
 			 */
 			if (currentSearchPath != NULL)
 			{
-				SendCommandToRemoteNodesWithMetadata(
-					psprintf("SET LOCAL search_path TO %s;", currentSearchPath));
+				commandList = lappend(commandList,
+									  psprintf("SET LOCAL search_path TO %s",
+											   currentSearchPath));
 			}
 
 			if (ddlJob->metadataSyncCommand != NULL)
 			{
-				SendCommandToRemoteNodesWithMetadata(
-					(char *) ddlJob->metadataSyncCommand);
+				commandList = lappend(commandList, (char *) ddlJob->metadataSyncCommand);
+			}
+
+			/*
+			 * In transaction blocks with many DDL commands, such as migrations,
+			 * we can send the commands of all of them in a single round trip.
+			 */
+			if (ShouldBufferDDLPropagation())
+			{
+				BufferCommandListForRemoteNodesWithMetadata(commandList);
+			}
+			else
+			{
+				SendCommandListToRemoteNodesWithMetadata(commandList);
 			}
 		}
 
-		ExecuteUtilityTaskList(ddlJob->taskList, localExecutionSupported);
+		ExecuteDDLJobTaskList(ddlJob, localExecutionSupported);
 	}
 	else
 	{
@@ -1245,7 +1397,7 @@ ExecuteDistributedDDLJob(DDLJob *ddlJob)
 
 		PG_TRY();
 		{
-			ExecuteUtilityTaskList(ddlJob->taskList, localExecutionSupported);
+			ExecuteDDLJobTaskList(ddlJob, localExecutionSupported);
 
 			if (shouldSyncMetadata)
 			{
@@ -1307,6 +1459,182 @@ ExecuteDistributedDDLJob(DDLJob *ddlJob)
 }
 
 
+/*
+ * ExecuteDDLJobTaskList executes the tasks of the given DDL job, using the
+ * pool size of the job if it specifies one.
+ */
+static void
+ExecuteDDLJobTaskList(DDLJob *ddlJob, bool localExecutionSupported)
+{
+	List *taskList = ddlJob->taskList;
+
+	/* commands that cannot run in a transaction block cannot be combined either */
+	if (ShardDDLBatchSize > 1 && !TaskListCannotBeExecutedInTransaction(taskList))
+	{
+		taskList = BatchShardDDLTaskListPerNode(taskList);
+	}
+
+	if (ddlJob->poolSize > 0)
+	{
+		ExecuteUtilityTaskListExtended(taskList, ddlJob->poolSize,
+									   localExecutionSupported);
+	}
+	else
+	{
+		ExecuteUtilityTaskList(taskList, localExecutionSupported);
+	}
+}
+
+
+/*
+ * BatchShardDDLTaskListPerNode combines the shard DDL tasks whose placements
+ * are on the same remote groups into tasks that send the commands of up to
+ * citus.shard_ddl_batch_size shards in a single query string. For instance,
+ * an ALTER TABLE on a table with many shards then takes a round trip per
+ * batch rather than one per shard, and the nodes still run their batches in
+ * parallel.
+ *
+ * The first task of a batch is extended with the commands of the others, and
+ * their shards are added to its relationShardList, such that the executor
+ * records DDL accesses to all of their placements. As for TRUNCATE, tasks on
+ * the local group or with placements that were already accessed in the
+ * transaction are left alone.
+ */
+static List *
+BatchShardDDLTaskListPerNode(List *taskList)
+{
+	List *batchedTaskList = NIL;
+	List *taskBatchList = NIL;
+	int32 localGroupId = GetLocalGroupId();
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		if (!CanExecuteShardDDLTaskInBatch(task, localGroupId))
+		{
+			batchedTaskList = lappend(batchedTaskList, task);
+			continue;
+		}
+
+		List *sortedPlacementList = SortList(task->taskPlacementList,
+											 CompareShardPlacementsByGroupId);
+		List *groupIdList = NIL;
+
+		ShardPlacement *placement = NULL;
+		foreach_ptr(placement, sortedPlacementList)
+		{
+			groupIdList = lappend_int(groupIdList, placement->groupId);
+		}
+
+		ShardDDLTaskBatch *taskBatch = FindShardDDLTaskBatch(taskBatchList,
+															 groupIdList);
+		if (taskBatch == NULL)
+		{
+			/* the first task of the batch is turned into the batch */
+			taskBatch = palloc0(sizeof(ShardDDLTaskBatch));
+			taskBatch->groupIdList = groupIdList;
+			taskBatch->task = task;
+
+			taskBatchList = lappend(taskBatchList, taskBatch);
+			batchedTaskList = lappend(batchedTaskList, task);
+		}
+		else
+		{
+			Task *batchTask = taskBatch->task;
+
+			RelationShard *relationShard = CitusMakeNode(RelationShard);
+			relationShard->relationId = RelationIdForShard(task->anchorShardId);
+			relationShard->shardId = task->anchorShardId;
+
+			batchTask->relationShardList = lappend(batchTask->relationShardList,
+												   relationShard);
+			batchTask->relationShardList = list_concat(batchTask->relationShardList,
+													   task->relationShardList);
+		}
+
+		taskBatch->queryStringList = lappend(taskBatch->queryStringList,
+											 TaskQueryString(task));
+		taskBatch->taskCount++;
+	}
+
+	/* send the commands of each batch as a single query string */
+	ShardDDLTaskBatch *taskBatch = NULL;
+	foreach_ptr(taskBatch, taskBatchList)
+	{
+		if (taskBatch->taskCount > 1)
+		{
+			SetTaskQueryString(taskBatch->task,
+							   StringJoin(taskBatch->queryStringList, ';'));
+		}
+	}
+
+	return batchedTaskList;
+}
+
+
+/*
+ * CanExecuteShardDDLTaskInBatch returns whether the given task is a shard DDL
+ * task that can be combined with the tasks of other shards on the same nodes.
+ */
+static bool
+CanExecuteShardDDLTaskInBatch(Task *task, int32 localGroupId)
+{
+	if (task->taskType != DDL_TASK || task->anchorShardId == INVALID_SHARD_ID ||
+		GetTaskQueryType(task) != TASK_QUERY_TEXT || task->taskPlacementList == NIL)
+	{
+		return false;
+	}
+
+	ShardPlacement *placement = NULL;
+	foreach_ptr(placement, task->taskPlacementList)
+	{
+		if (placement->groupId == localGroupId ||
+			PlacementAccessedInTransaction(placement))
+		{
+			return false;
+		}
+
+		/* inter-shard commands also access the placements of the other shard */
+		RelationShard *relationShard = NULL;
+		foreach_ptr(relationShard, task->relationShardList)
+		{
+			ShardPlacement *relationShardPlacement =
+				ActiveShardPlacementOnGroup(placement->groupId, relationShard->shardId);
+
+			if (relationShardPlacement != NULL &&
+				PlacementAccessedInTransaction(relationShardPlacement))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * FindShardDDLTaskBatch returns the batch of the tasks that have placements
+ * on exactly the given groups, or NULL if there is no such batch that accepts
+ * more tasks.
+ */
+static ShardDDLTaskBatch *
+FindShardDDLTaskBatch(List *taskBatchList, List *groupIdList)
+{
+	ShardDDLTaskBatch *taskBatch = NULL;
+	foreach_ptr(taskBatch, taskBatchList)
+	{
+		if (taskBatch->taskCount < ShardDDLBatchSize &&
+			equal(taskBatch->groupIdList, groupIdList))
+		{
+			return taskBatch;
+		}
+	}
+
+	return NULL;
+}
+
+
 /*
  * set_indexsafe_procflags sets PROC_IN_SAFE_IC flag in MyProc->statusFlags.
  *
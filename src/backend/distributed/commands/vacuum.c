@@ -11,24 +11,33 @@
 #include "postgres.h"
 
 #include "access/xact.h"
+#include "catalog/pg_type.h"
 #include "commands/defrem.h"
 #include "commands/vacuum.h"
 #include "postmaster/bgworker_internals.h"
 #include "storage/lmgr.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
+#include "utils/tuplestore.h"
 
 #include "pg_version_constants.h"
 
 #include "distributed/adaptive_executor.h"
+#include "distributed/citus_safe_lib.h"
 #include "distributed/commands.h"
 #include "distributed/commands/utility_hook.h"
 #include "distributed/deparse_shard_query.h"
+#include "distributed/distributed_table_statistics.h"
+#include "distributed/hash_helpers.h"
 #include "distributed/listutils.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/metadata_sync.h"
+#include "distributed/multi_executor.h"
+#include "distributed/multi_partitioning_utils.h"
+#include "distributed/multi_physical_planner.h"
 #include "distributed/resource_lock.h"
 #include "distributed/transaction_management.h"
+#include "distributed/tuple_destination.h"
 #include "distributed/version_compat.h"
 
 
@@ -48,10 +57,48 @@ typedef struct CitusVacuumParams
 #endif
 } CitusVacuumParams;
 
+/*
+ * ShardDeadTupleCount is the number of dead tuples of a shard reported by
+ * the statistics collector of the node of its placement.
+ */
+typedef struct ShardDeadTupleCount
+{
+	uint64 shardId;
+	int64 deadTupleCount;
+} ShardDeadTupleCount;
+
+/*
+ * VacuumTaskOrder pairs a vacuum task with the number of dead tuples of its
+ * shard to sort the tasks.
+ */
+typedef struct VacuumTaskOrder
+{
+	Task *task;
+	int64 deadTupleCount;
+} VacuumTaskOrder;
+
+
+/*
+ * VacuumProcessesPerNode is the number of connections per node over which
+ * the shards of Citus tables are vacuumed and analyzed. 0 uses
+ * citus.max_adaptive_executor_pool_size connections.
+ */
+int VacuumProcessesPerNode = 0;
+
+/*
+ * VacuumShardsByDeadTuples makes VACUUM of Citus tables vacuum the shards
+ * with the most dead tuples first, across all tables of the command.
+ */
+bool VacuumShardsByDeadTuples = false;
+
 /* Local functions forward declarations for processing distributed table commands */
 static bool IsDistributedVacuumStmt(List *vacuumRelationIdList);
 static List * VacuumTaskList(Oid relationId, CitusVacuumParams vacuumParams,
 							 List *vacuumColumnList);
+static void ExecuteVacuumTaskList(List *taskList);
+static List * SortVacuumTasksByDeadTuples(List *taskList);
+static HTAB * ShardDeadTupleCountHash(List *taskList);
+static int CompareVacuumTaskOrder(const void *leftElement, const void *rightElement);
 static char * DeparseVacuumStmtPrefix(CitusVacuumParams vacuumParams);
 static char * DeparseVacuumColumnNames(List *columnNameList);
 static List * VacuumColumnList(VacuumStmt *vacuumStmt, int relationIndex);
@@ -186,6 +233,15 @@ ExecuteVacuumOnDistributedTables(VacuumStmt *vacuumStmt, List *relationIdList,
 {
 	int relationIndex = 0;
 
+	/*
+	 * To vacuum the shards with the most dead tuples first, we vacuum the
+	 * shards of all tables of the command in a single execution.
+	 */
+	bool orderByDeadTuples = VacuumShardsByDeadTuples &&
+							 (vacuumParams.options & VACOPT_VACUUM);
+	List *citusRelationIdList = NIL;
+	List *combinedTaskList = NIL;
+
 	Oid relationId = InvalidOid;
 	foreach_oid(relationId, relationIdList)
 	{
@@ -194,12 +250,197 @@ ExecuteVacuumOnDistributedTables(VacuumStmt *vacuumStmt, List *relationIdList,
 			List *vacuumColumnList = VacuumColumnList(vacuumStmt, relationIndex);
 			List *taskList = VacuumTaskList(relationId, vacuumParams, vacuumColumnList);
 
-			/* local execution is not implemented for VACUUM commands */
-			bool localExecutionSupported = false;
-			ExecuteUtilityTaskList(taskList, localExecutionSupported);
+			citusRelationIdList = lappend_oid(citusRelationIdList, relationId);
+
+			if (orderByDeadTuples)
+			{
+				combinedTaskList = list_concat(combinedTaskList, taskList);
+			}
+			else
+			{
+				ExecuteVacuumTaskList(taskList);
+			}
 		}
 		relationIndex++;
 	}
+
+	if (orderByDeadTuples && combinedTaskList != NIL)
+	{
+		ExecuteVacuumTaskList(SortVacuumTasksByDeadTuples(combinedTaskList));
+	}
+
+	if ((vacuumParams.options & VACOPT_ANALYZE) && EnableDistributedAnalyze)
+	{
+		foreach_oid(relationId, citusRelationIdList)
+		{
+			if (!PartitionedTable(relationId))
+			{
+				/* the shards are analyzed now, merge their statistics */
+				UpdateDistributedTableStatistics(relationId);
+			}
+		}
+	}
+}
+
+
+/*
+ * ExecuteVacuumTaskList executes the given vacuum tasks over at most
+ * citus.vacuum_processes_per_node connections per node.
+ */
+static void
+ExecuteVacuumTaskList(List *taskList)
+{
+	int poolSize = VacuumProcessesPerNode > 0 ? VacuumProcessesPerNode :
+				   MaxAdaptiveExecutorPoolSize;
+
+	/* local execution is not implemented for VACUUM commands */
+	bool localExecutionSupported = false;
+	ExecuteUtilityTaskListExtended(taskList, poolSize, localExecutionSupported);
+}
+
+
+/*
+ * SortVacuumTasksByDeadTuples returns the given vacuum tasks ordered by the
+ * number of dead tuples of their shards, highest first. The executor assigns
+ * the tasks of a node to its connections in list order, so the shards that
+ * need vacuuming the most are vacuumed first.
+ */
+static List *
+SortVacuumTasksByDeadTuples(List *taskList)
+{
+	HTAB *deadTupleCountHash = ShardDeadTupleCountHash(taskList);
+	int taskCount = list_length(taskList);
+	VacuumTaskOrder *taskOrderArray = palloc0(taskCount * sizeof(VacuumTaskOrder));
+	int taskIndex = 0;
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		bool found = false;
+		ShardDeadTupleCount *shardDeadTupleCount =
+			hash_search(deadTupleCountHash, &task->anchorShardId, HASH_FIND, &found);
+
+		taskOrderArray[taskIndex].task = task;
+		taskOrderArray[taskIndex].deadTupleCount =
+			found ? shardDeadTupleCount->deadTupleCount : 0;
+		taskIndex++;
+	}
+
+	SafeQsort(taskOrderArray, taskCount, sizeof(VacuumTaskOrder),
+			  CompareVacuumTaskOrder);
+
+	List *sortedTaskList = NIL;
+	for (taskIndex = 0; taskIndex < taskCount; taskIndex++)
+	{
+		task = taskOrderArray[taskIndex].task;
+
+		/* the tasks of different tables are executed together */
+		task->taskId = taskIndex + 1;
+
+		sortedTaskList = lappend(sortedTaskList, task);
+	}
+
+	hash_destroy(deadTupleCountHash);
+	pfree(taskOrderArray);
+
+	return sortedTaskList;
+}
+
+
+/*
+ * ShardDeadTupleCountHash returns a hash from shard ID to the number of dead
+ * tuples of the shards of the given tasks, as reported by the statistics
+ * collectors of the nodes.
+ */
+static HTAB *
+ShardDeadTupleCountHash(List *taskList)
+{
+	List *deadTupleTaskList = NIL;
+	uint32 taskId = 1;
+
+	Task *vacuumTask = NULL;
+	foreach_ptr(vacuumTask, taskList)
+	{
+		uint64 shardId = vacuumTask->anchorShardId;
+		ShardInterval *shardInterval = LoadShardInterval(shardId);
+		char *qualifiedShardName = ConstructQualifiedShardName(shardInterval);
+		StringInfo queryString = makeStringInfo();
+
+		appendStringInfo(queryString,
+						 "SELECT " UINT64_FORMAT "::bigint, "
+						 "pg_catalog.pg_stat_get_dead_tuples(%s::regclass)",
+						 shardId, quote_literal_cstr(qualifiedShardName));
+
+		Task *task = CreateBasicTask(INVALID_JOB_ID, taskId++, READ_TASK,
+									 queryString->data);
+		task->anchorShardId = shardId;
+		task->taskPlacementList = vacuumTask->taskPlacementList;
+
+		deadTupleTaskList = lappend(deadTupleTaskList, task);
+	}
+
+	TupleDesc tupleDescriptor = CreateTemplateTupleDesc(2);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 1, "shardid", INT8OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 2, "n_dead_tup", INT8OID, -1, 0);
+
+	Tuplestorestate *tupleStore = tuplestore_begin_heap(false, false, work_mem);
+	TupleDestination *tupleDest = CreateTupleStoreTupleDest(tupleStore,
+															tupleDescriptor);
+	bool expectResults = true;
+
+	ExecuteTaskListIntoTupleDest(ROW_MODIFY_READONLY, deadTupleTaskList, tupleDest,
+								 expectResults);
+
+	HTAB *deadTupleCountHash = CreateSimpleHashWithName(uint64, ShardDeadTupleCount,
+														"Shard Dead Tuple Counts");
+	TupleTableSlot *slot = MakeSingleTupleTableSlot(tupleDescriptor,
+													&TTSOpsMinimalTuple);
+
+	while (tuplestore_gettupleslot(tupleStore, true, false, slot))
+	{
+		slot_getallattrs(slot);
+
+		if (slot->tts_isnull[0] || slot->tts_isnull[1])
+		{
+			continue;
+		}
+
+		uint64 shardId = DatumGetInt64(slot->tts_values[0]);
+		ShardDeadTupleCount *shardDeadTupleCount =
+			hash_search(deadTupleCountHash, &shardId, HASH_ENTER, NULL);
+
+		/* with multiple placements, a placement of the shard reported its count */
+		shardDeadTupleCount->deadTupleCount = DatumGetInt64(slot->tts_values[1]);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	tuplestore_end(tupleStore);
+
+	return deadTupleCountHash;
+}
+
+
+/*
+ * CompareVacuumTaskOrder orders vacuum tasks by the number of dead tuples of
+ * their shards, highest first, and by shard ID for equal counts.
+ */
+static int
+CompareVacuumTaskOrder(const void *leftElement, const void *rightElement)
+{
+	const VacuumTaskOrder *left = (const VacuumTaskOrder *) leftElement;
+	const VacuumTaskOrder *right = (const VacuumTaskOrder *) rightElement;
+
+	if (left->deadTupleCount != right->deadTupleCount)
+	{
+		return (left->deadTupleCount > right->deadTupleCount) ? -1 : 1;
+	}
+
+	if (left->task->anchorShardId != right->task->anchorShardId)
+	{
+		return (left->task->anchorShardId < right->task->anchorShardId) ? -1 : 1;
+	}
+
+	return 0;
 }
 
 
@@ -10,6 +10,9 @@
 
 #include "postgres.h"
 
+#include <netdb.h>
+#include <sys/socket.h>
+
 #include "access/transam.h"
 #include "access/xact.h"
 #include "mb/pg_wchar.h"
@@ -39,6 +42,9 @@ bool checkAtBootPassed = false;
 
 char *LocalHostName = "localhost";
 
+/* GUC, whether to resolve node host names once per connection parameters entry */
+bool CacheNodeAddresses = false;
+
 /* represents a list of libpq parameter settings */
 typedef struct ConnParamsInfo
 {
@@ -56,6 +62,7 @@ static ConnParamsInfo ConnParams;
 
 /* helper functions for processing connection info */
 static ConnectionHashKey * GetEffectiveConnKey(ConnectionHashKey *key);
+static char * ResolveNodeAddress(const char *hostname, MemoryContext context);
 static Size CalculateMaxSize(void);
 static int uri_prefix_length(const char *connstr);
 
@@ -395,6 +402,7 @@ GetConnParams(ConnectionHashKey *key, char ***keywords, char ***values,
 		}
 	}
 
+	bool gotHostaddrParam = false;
 	for (PQconninfoOption *option = optionArray; option->keyword != NULL; option++)
 	{
 		if (option->val == NULL || option->val[0] == '\0')
@@ -402,6 +410,11 @@ GetConnParams(ConnectionHashKey *key, char ***keywords, char ***values,
 			continue;
 		}
 
+		if (strcmp(option->keyword, "hostaddr") == 0)
+		{
+			gotHostaddrParam = true;
+		}
+
 		connKeywords[authParamsIdx] = MemoryContextStrdup(context, option->keyword);
 		connValues[authParamsIdx] = MemoryContextStrdup(context, option->val);
 
@@ -416,6 +429,23 @@ GetConnParams(ConnectionHashKey *key, char ***keywords, char ***values,
 		authParamsIdx++;
 	}
 
+	/*
+	 * libpq resolves the host name of every new connection synchronously. When
+	 * we cache the address, we pass it as hostaddr, and libpq only uses the
+	 * host name for authentication and for verifying the server certificate.
+	 */
+	if (CacheNodeAddresses && !gotHostParamFromGlobalParams && !gotHostaddrParam)
+	{
+		char *nodeAddress = ResolveNodeAddress(effectiveKey->hostname, context);
+		if (nodeAddress != NULL)
+		{
+			connKeywords[authParamsIdx] = MemoryContextStrdup(context, "hostaddr");
+			connValues[authParamsIdx] = nodeAddress;
+
+			authParamsIdx++;
+		}
+	}
+
 	PQconninfoFree(optionArray);
 
 	/* final step: add terminal NULL, required by libpq */
@@ -442,6 +472,47 @@ GetConnParam(const char *keyword)
 }
 
 
+/*
+ * ResolveNodeAddress returns the first address that the given host name
+ * resolves to in numeric form, allocated in the given context. It returns
+ * NULL for Unix-domain socket directories and for host names that do not
+ * resolve, in which case libpq resolves the name and reports any error.
+ */
+static char *
+ResolveNodeAddress(const char *hostname, MemoryContext context)
+{
+	struct addrinfo hints;
+	struct addrinfo *addressList = NULL;
+	char nodeAddress[NI_MAXHOST];
+
+	if (hostname[0] == '\0' || is_absolute_path(hostname))
+	{
+		return NULL;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(hostname, NULL, &hints, &addressList) != 0 || addressList == NULL)
+	{
+		return NULL;
+	}
+
+	int nameResult = getnameinfo(addressList->ai_addr, addressList->ai_addrlen,
+								 nodeAddress, sizeof(nodeAddress), NULL, 0,
+								 NI_NUMERICHOST);
+	freeaddrinfo(addressList);
+
+	if (nameResult != 0)
+	{
+		return NULL;
+	}
+
+	return MemoryContextStrdup(context, nodeAddress);
+}
+
+
 /*
  * GetEffectiveConnKey checks whether there is any pooler configuration for the
  * provided key (host/port combination). If a corresponding row is found in the
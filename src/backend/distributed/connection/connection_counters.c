@@ -0,0 +1,420 @@
+/*-------------------------------------------------------------------------
+ *
+ * connection_counters.c
+ *   Keeps cumulative counters of the traffic over the connections to each
+ *   node across backends, such as the number of commands and the bytes that
+ *   were sent and received, and the time spent establishing connections and
+ *   waiting for results.
+ *
+ *   Backends count on the MultiConnection itself, which costs no more than
+ *   a few additions, and add the counters of the connection to the shared
+ *   counters of the node at the end of the transaction or when the
+ *   connection is closed. The shared counters are atomics, such that
+ *   flushing only takes the lock of the hash in shared mode once the node
+ *   has an entry.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/timestamp.h"
+
+#include "pg_version_constants.h"
+
+#include "distributed/connection_counters.h"
+#include "distributed/connection_management.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/tuplestore.h"
+#include "distributed/worker_manager.h"
+
+
+#define CONNECTION_COUNTERS_COLUMNS 11
+
+
+/*
+ * The data structure used to store the lock of the hash in shared memory.
+ */
+typedef struct ConnectionCountersSharedData
+{
+	int connectionCountersHashTrancheId;
+	char *connectionCountersHashTrancheName;
+
+	LWLock connectionCountersHashLock;
+
+	/* time of the last citus_stat_connections_reset() */
+	pg_atomic_uint64 statsReset;
+} ConnectionCountersSharedData;
+
+
+typedef struct ConnectionCountersHashKey
+{
+	/* like the shared connection stats, we use "hostname/port" over nodeId */
+	char hostname[MAX_NODE_LENGTH];
+	int32 port;
+} ConnectionCountersHashKey;
+
+/* hash entry for the counters of a node, in the order of ConnectionCounters */
+typedef struct ConnectionCountersHashEntry
+{
+	ConnectionCountersHashKey key;
+
+	pg_atomic_uint64 commandsSent;
+	pg_atomic_uint64 bytesSent;
+	pg_atomic_uint64 copyBytesSent;
+	pg_atomic_uint64 bytesReceived;
+	pg_atomic_uint64 connectionsEstablished;
+	pg_atomic_uint64 connectionEstablishmentTime;
+	pg_atomic_uint64 connectionFailures;
+	pg_atomic_uint64 waitTime;
+} ConnectionCountersHashEntry;
+
+
+/* the following two structs are used for accessing shared memory */
+static HTAB *ConnectionCountersHash = NULL;
+static ConnectionCountersSharedData *ConnectionCountersSharedState = NULL;
+
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+/* local function declarations */
+static void InitConnectionCountersHashKey(ConnectionCountersHashKey *key,
+										  const char *hostname, int port);
+static void InitConnectionCountersHashEntry(ConnectionCountersHashEntry *entry);
+static void AddConnectionCounters(ConnectionCountersHashEntry *entry,
+								  ConnectionCounters *counters);
+static bool ConnectionCountersAreZero(ConnectionCounters *counters);
+
+
+PG_FUNCTION_INFO_V1(citus_connection_counters);
+PG_FUNCTION_INFO_V1(citus_connection_counters_reset);
+
+
+/*
+ * citus_connection_counters returns the cumulative counters of the
+ * connections from this node to each of the other nodes. Times are returned
+ * in milliseconds.
+ */
+Datum
+citus_connection_counters(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	Datum values[CONNECTION_COUNTERS_COLUMNS];
+	bool isNulls[CONNECTION_COUNTERS_COLUMNS];
+
+	TimestampTz statsReset =
+		(TimestampTz) pg_atomic_read_u64(&ConnectionCountersSharedState->statsReset);
+
+	LWLockAcquire(&ConnectionCountersSharedState->connectionCountersHashLock,
+				  LW_SHARED);
+
+	HASH_SEQ_STATUS status;
+	ConnectionCountersHashEntry *entry = NULL;
+
+	hash_seq_init(&status, ConnectionCountersHash);
+	while ((entry = (ConnectionCountersHashEntry *) hash_seq_search(&status)) != NULL)
+	{
+		memset(values, 0, sizeof(values));
+		memset(isNulls, false, sizeof(isNulls));
+
+		values[0] = PointerGetDatum(cstring_to_text(entry->key.hostname));
+		values[1] = Int32GetDatum(entry->key.port);
+		values[2] = Int64GetDatum(pg_atomic_read_u64(&entry->commandsSent));
+		values[3] = Int64GetDatum(pg_atomic_read_u64(&entry->bytesSent));
+		values[4] = Int64GetDatum(pg_atomic_read_u64(&entry->copyBytesSent));
+		values[5] = Int64GetDatum(pg_atomic_read_u64(&entry->bytesReceived));
+		values[6] = Int64GetDatum(pg_atomic_read_u64(&entry->connectionsEstablished));
+		values[7] = Float8GetDatum(
+			pg_atomic_read_u64(&entry->connectionEstablishmentTime) / 1000.0);
+		values[8] = Int64GetDatum(pg_atomic_read_u64(&entry->connectionFailures));
+		values[9] = Float8GetDatum(pg_atomic_read_u64(&entry->waitTime) / 1000.0);
+		values[10] = TimestampTzGetDatum(statsReset);
+		isNulls[10] = (statsReset == 0);
+
+		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+	}
+
+	LWLockRelease(&ConnectionCountersSharedState->connectionCountersHashLock);
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * citus_connection_counters_reset removes the counters of all nodes on this
+ * node and records the time of the reset.
+ */
+Datum
+citus_connection_counters_reset(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	LWLockAcquire(&ConnectionCountersSharedState->connectionCountersHashLock,
+				  LW_EXCLUSIVE);
+
+	HASH_SEQ_STATUS status;
+	ConnectionCountersHashEntry *entry = NULL;
+
+	hash_seq_init(&status, ConnectionCountersHash);
+	while ((entry = (ConnectionCountersHashEntry *) hash_seq_search(&status)) != NULL)
+	{
+		hash_search(ConnectionCountersHash, &entry->key, HASH_REMOVE, NULL);
+	}
+
+	pg_atomic_write_u64(&ConnectionCountersSharedState->statsReset,
+						(uint64) GetCurrentTimestamp());
+
+	LWLockRelease(&ConnectionCountersSharedState->connectionCountersHashLock);
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * FlushConnectionCounters adds the counters of the given connection to the
+ * shared counters of its node and zeroes them.
+ */
+void
+FlushConnectionCounters(MultiConnection *connection)
+{
+	ConnectionCounters *counters = &connection->counters;
+	ConnectionCountersHashKey key;
+
+	if (ConnectionCountersAreZero(counters))
+	{
+		return;
+	}
+
+	InitConnectionCountersHashKey(&key, connection->hostname, connection->port);
+
+	/* the counters are atomics, so existing entries only need a shared lock */
+	LWLockAcquire(&ConnectionCountersSharedState->connectionCountersHashLock,
+				  LW_SHARED);
+
+	bool entryFound = false;
+	ConnectionCountersHashEntry *entry =
+		hash_search(ConnectionCountersHash, &key, HASH_FIND, &entryFound);
+
+	if (!entryFound)
+	{
+		LWLockRelease(&ConnectionCountersSharedState->connectionCountersHashLock);
+		LWLockAcquire(&ConnectionCountersSharedState->connectionCountersHashLock,
+					  LW_EXCLUSIVE);
+
+		entry = hash_search(ConnectionCountersHash, &key, HASH_ENTER_NULL,
+							&entryFound);
+
+		/* we track at most citus.max_worker_nodes_tracked nodes */
+		if (entry == NULL)
+		{
+			LWLockRelease(&ConnectionCountersSharedState->connectionCountersHashLock);
+
+			ereport(DEBUG4, (errmsg("no space to track the connection counters of "
+									"node %s:%d", connection->hostname,
+									connection->port)));
+
+			memset(counters, 0, sizeof(ConnectionCounters));
+			return;
+		}
+
+		if (!entryFound)
+		{
+			InitConnectionCountersHashEntry(entry);
+		}
+	}
+
+	AddConnectionCounters(entry, counters);
+
+	LWLockRelease(&ConnectionCountersSharedState->connectionCountersHashLock);
+
+	memset(counters, 0, sizeof(ConnectionCounters));
+}
+
+
+/*
+ * AddConnectionCounters adds the given counters to the shared counters in
+ * the entry.
+ */
+static void
+AddConnectionCounters(ConnectionCountersHashEntry *entry, ConnectionCounters *counters)
+{
+	pg_atomic_fetch_add_u64(&entry->commandsSent, counters->commandsSent);
+	pg_atomic_fetch_add_u64(&entry->bytesSent, counters->bytesSent);
+	pg_atomic_fetch_add_u64(&entry->copyBytesSent, counters->copyBytesSent);
+	pg_atomic_fetch_add_u64(&entry->bytesReceived, counters->bytesReceived);
+	pg_atomic_fetch_add_u64(&entry->connectionsEstablished,
+							counters->connectionsEstablished);
+	pg_atomic_fetch_add_u64(&entry->connectionEstablishmentTime,
+							counters->connectionEstablishmentTime);
+	pg_atomic_fetch_add_u64(&entry->connectionFailures, counters->connectionFailures);
+	pg_atomic_fetch_add_u64(&entry->waitTime, counters->waitTime);
+}
+
+
+/*
+ * ConnectionCountersAreZero returns whether nothing was counted on a
+ * connection since the last flush.
+ */
+static bool
+ConnectionCountersAreZero(ConnectionCounters *counters)
+{
+	return counters->commandsSent == 0 &&
+		   counters->bytesSent == 0 &&
+		   counters->copyBytesSent == 0 &&
+		   counters->bytesReceived == 0 &&
+		   counters->connectionsEstablished == 0 &&
+		   counters->connectionEstablishmentTime == 0 &&
+		   counters->connectionFailures == 0 &&
+		   counters->waitTime == 0;
+}
+
+
+/*
+ * InitConnectionCountersHashEntry initializes the counters of a new entry.
+ */
+static void
+InitConnectionCountersHashEntry(ConnectionCountersHashEntry *entry)
+{
+	pg_atomic_init_u64(&entry->commandsSent, 0);
+	pg_atomic_init_u64(&entry->bytesSent, 0);
+	pg_atomic_init_u64(&entry->copyBytesSent, 0);
+	pg_atomic_init_u64(&entry->bytesReceived, 0);
+	pg_atomic_init_u64(&entry->connectionsEstablished, 0);
+	pg_atomic_init_u64(&entry->connectionEstablishmentTime, 0);
+	pg_atomic_init_u64(&entry->connectionFailures, 0);
+	pg_atomic_init_u64(&entry->waitTime, 0);
+}
+
+
+/*
+ * InitConnectionCountersHashKey fills the hash key for the given node. The
+ * key is zeroed first, since it is hashed and compared as a blob.
+ */
+static void
+InitConnectionCountersHashKey(ConnectionCountersHashKey *key, const char *hostname,
+							  int port)
+{
+	if (strlen(hostname) > MAX_NODE_LENGTH)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("hostname exceeds the maximum length of %d",
+							   MAX_NODE_LENGTH)));
+	}
+
+	memset(key, 0, sizeof(ConnectionCountersHashKey));
+	strlcpy(key->hostname, hostname, MAX_NODE_LENGTH);
+	key->port = port;
+}
+
+
+/*
+ * InitializeConnectionCounters requests the necessary shared memory from
+ * Postgres and sets up the shared memory startup hook.
+ */
+void
+InitializeConnectionCounters(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(ConnectionCountersShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = ConnectionCountersShmemInit;
+}
+
+
+/*
+ * ConnectionCountersShmemSize returns the size that should be allocated on
+ * the shared memory for the connection counters.
+ */
+size_t
+ConnectionCountersShmemSize(void)
+{
+	Size size = 0;
+
+	size = add_size(size, sizeof(ConnectionCountersSharedData));
+
+	Size hashSize = hash_estimate_size(MaxWorkerNodesTracked,
+									   sizeof(ConnectionCountersHashEntry));
+
+	size = add_size(size, hashSize);
+
+	return size;
+}
+
+
+/*
+ * ConnectionCountersShmemInit initializes the shared memory used for keeping
+ * the connection counters across backends.
+ */
+void
+ConnectionCountersShmemInit(void)
+{
+	bool alreadyInitialized = false;
+	HASHCTL info;
+
+	/* create (hostname, port) -> [counters] */
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(ConnectionCountersHashKey);
+	info.entrysize = sizeof(ConnectionCountersHashEntry);
+	uint32 hashFlags = (HASH_ELEM | HASH_BLOBS);
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	ConnectionCountersSharedState =
+		(ConnectionCountersSharedData *) ShmemInitStruct(
+			"Connection Counters Data",
+			sizeof(ConnectionCountersSharedData),
+			&alreadyInitialized);
+
+	if (!alreadyInitialized)
+	{
+		ConnectionCountersSharedState->connectionCountersHashTrancheId =
+			LWLockNewTrancheId();
+		ConnectionCountersSharedState->connectionCountersHashTrancheName =
+			"Connection Counters Hash Tranche";
+		LWLockRegisterTranche(
+			ConnectionCountersSharedState->connectionCountersHashTrancheId,
+			ConnectionCountersSharedState->connectionCountersHashTrancheName);
+
+		LWLockInitialize(&ConnectionCountersSharedState->connectionCountersHashLock,
+						 ConnectionCountersSharedState->connectionCountersHashTrancheId);
+
+		pg_atomic_init_u64(&ConnectionCountersSharedState->statsReset, 0);
+	}
+
+	/* allocate hash table */
+	ConnectionCountersHash =
+		ShmemInitHash("Connection Counters Hash", MaxWorkerNodesTracked,
+					  MaxWorkerNodesTracked, &info, hashFlags);
+
+	LWLockRelease(AddinShmemInitLock);
+
+	Assert(ConnectionCountersHash != NULL);
+	Assert(ConnectionCountersSharedState->connectionCountersHashTrancheId != 0);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
@@ -27,6 +27,8 @@
 
 #include "distributed/backend_data.h"
 #include "distributed/cancel_utils.h"
+#include "distributed/citus_wait_events.h"
+#include "distributed/connection_counters.h"
 #include "distributed/connection_management.h"
 #include "distributed/error_codes.h"
 #include "distributed/errormessage.h"
@@ -35,13 +37,17 @@
 #include "distributed/log_utils.h"
 #include "distributed/memutils.h"
 #include "distributed/metadata_cache.h"
+#include "distributed/node_latency_stats.h"
 #include "distributed/placement_connection.h"
+#include "distributed/remote_command_trace.h"
 #include "distributed/remote_commands.h"
+#include "distributed/remote_prepared_statements.h"
 #include "distributed/run_from_same_connection.h"
 #include "distributed/shared_connection_stats.h"
 #include "distributed/time_constants.h"
 #include "distributed/version_compat.h"
 #include "distributed/worker_log_messages.h"
+#include "distributed/worker_manager.h"
 
 
 int NodeConnectionTimeout = 30000;
@@ -90,6 +96,11 @@ static void CloseNotReadyMultiConnectionStates(List *connectionStates);
 static uint32 MultiConnectionStateEventMask(MultiConnectionPollState *connectionState);
 static void CitusPQFinish(MultiConnection *connection);
 static ConnParamsHashEntry * FindOrCreateConnParamsEntry(ConnectionHashKey *key);
+static int CachedNodeConnectionCount(const char *hostname, int port);
+
+
+PG_FUNCTION_INFO_V1(citus_warm_connections);
+
 
 /*
  * Initialize per-backend connection management infrastructure.
@@ -639,6 +650,140 @@ ConnectionAvailableToNode(char *hostName, int nodePort, const char *userName,
 }
 
 
+/*
+ * citus_warm_connections opens the connections that the session caches to the
+ * other nodes right away, and returns the number of connections it opened.
+ * Connection poolers can call it when they open a session, such that the first
+ * distributed statement of a client does not wait for worker connections.
+ */
+Datum
+citus_warm_connections(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	List *workerNodeList = ActivePrimaryRemoteNodeList(NoLock);
+	int connectionCount = WarmNodeConnections(workerNodeList);
+
+	PG_RETURN_INT32(connectionCount);
+}
+
+
+/*
+ * WarmNodeConnections opens connections as the current user to each of the
+ * given nodes until the session has citus.max_cached_conns_per_worker
+ * connections to it, which are then cached at the end of the transaction.
+ * The connections are established in parallel. Connections that cannot be
+ * established are closed with a warning, and we do not wait for slots of
+ * citus.max_shared_pool_size. It returns the number of connections that were
+ * established.
+ */
+int
+WarmNodeConnections(List *workerNodeList)
+{
+	List *connectionList = NIL;
+
+	/* connections of internal backends are never cached */
+	if (IsCitusInternalBackend() || IsRebalancerInternalBackend())
+	{
+		return 0;
+	}
+
+	WorkerNode *workerNode = NULL;
+	foreach_ptr(workerNode, workerNodeList)
+	{
+		int connectionCount = CachedNodeConnectionCount(workerNode->workerName,
+														workerNode->workerPort);
+
+		for (; connectionCount < MaxCachedConnectionsPerWorker; connectionCount++)
+		{
+			int connectionFlags = FORCE_NEW_CONNECTION | OPTIONAL_CONNECTION;
+			MultiConnection *connection = StartNodeConnection(connectionFlags,
+															  workerNode->workerName,
+															  workerNode->workerPort);
+			if (connection == NULL)
+			{
+				/* the node has no shared connection slots left */
+				break;
+			}
+
+			connectionList = lappend(connectionList, connection);
+		}
+	}
+
+	FinishConnectionListEstablishment(connectionList);
+
+	int establishedConnectionCount = 0;
+
+	MultiConnection *connection = NULL;
+	foreach_ptr(connection, connectionList)
+	{
+		if (PQstatus(connection->pgConn) != CONNECTION_OK)
+		{
+			ReportConnectionError(connection, WARNING);
+			CloseConnection(connection);
+			continue;
+		}
+
+		MarkConnectionConnected(connection);
+		establishedConnectionCount++;
+
+		if (EnableNodeLatencyFeedback)
+		{
+			instr_time establishmentTime = connection->connectionEstablishmentEnd;
+			INSTR_TIME_SUBTRACT(establishmentTime,
+								connection->connectionEstablishmentStart);
+
+			RecordNodeLatencies(connection->hostname, connection->port, 0, 0,
+								INSTR_TIME_GET_MICROSEC(establishmentTime), 1);
+		}
+	}
+
+	return establishedConnectionCount;
+}
+
+
+/*
+ * CachedNodeConnectionCount returns the number of connections that the
+ * session has to the given node as the current user, which are kept at the
+ * end of the transaction unless there are too many of them.
+ */
+static int
+CachedNodeConnectionCount(const char *hostname, int port)
+{
+	ConnectionHashKey key;
+	bool found = false;
+	int connectionCount = 0;
+
+	strlcpy(key.hostname, hostname, MAX_NODE_LENGTH);
+	key.port = port;
+	strlcpy(key.user, CurrentUserName(), NAMEDATALEN);
+	strlcpy(key.database, CurrentDatabaseName(), NAMEDATALEN);
+	key.replicationConnParam = false;
+
+	ConnectionHashEntry *entry =
+		(ConnectionHashEntry *) hash_search(ConnectionHash, &key, HASH_FIND, &found);
+
+	if (!found || !entry->isValid)
+	{
+		return 0;
+	}
+
+	dlist_iter iter;
+	dlist_foreach(iter, entry->connections)
+	{
+		MultiConnection *connection =
+			dlist_container(MultiConnection, connectionNode, iter.cur);
+
+		if (!connection->forceCloseAtTransactionEnd)
+		{
+			connectionCount++;
+		}
+	}
+
+	return connectionCount;
+}
+
+
 /*
  * CloseNodeConnectionsAfterTransaction sets the forceClose flag of the connections
  * to a particular node as true such that the connections are no longer cached. This
@@ -768,10 +913,13 @@ ShutdownConnection(MultiConnection *connection)
 {
 	/*
 	 * Only cancel statement if there's currently one running, and the
-	 * connection is in an OK state.
+	 * connection is in an OK state. A COMMIT PREPARED that we stopped waiting
+	 * for is not cancelled, since that would leave the prepared transaction
+	 * and its locks in place until recovery.
 	 */
 	if (PQstatus(connection->pgConn) == CONNECTION_OK &&
-		PQtransactionStatus(connection->pgConn) == PQTRANS_ACTIVE)
+		PQtransactionStatus(connection->pgConn) == PQTRANS_ACTIVE &&
+		connection->remoteTransaction.transactionState != REMOTE_TRANS_2PC_COMMITTING)
 	{
 		SendCancelationRequest(connection);
 	}
@@ -1015,7 +1163,7 @@ FinishConnectionListEstablishment(List *multiConnectionList)
 		}
 
 		int eventCount = WaitEventSetWait(waitEventSet, timeout, events, waitCount,
-										  WAIT_EVENT_CLIENT_READ);
+										  WAIT_EVENT_CITUS_CONNECTION_ESTABLISH);
 
 		for (int eventIndex = 0; eventIndex < eventCount; eventIndex++)
 		{
@@ -1184,10 +1332,22 @@ CitusPQFinish(MultiConnection *connection)
 {
 	if (connection->pgConn != NULL)
 	{
+		/* the connection was closed before we could use it */
+		if (INSTR_TIME_IS_ZERO(connection->connectionEstablishmentEnd))
+		{
+			connection->counters.connectionFailures++;
+		}
+
 		PQfinish(connection->pgConn);
 		connection->pgConn = NULL;
 	}
 
+	ReleaseRemoteCommandTrace(connection);
+	FlushConnectionCounters(connection);
+
+	/* the prepared statements are gone with the remote session */
+	ReleaseRemotePreparedStatements(connection);
+
 	/* behave idempotently, there is no gurantee that CitusPQFinish() is called once */
 	if (connection->initializationState >= POOL_STATE_COUNTER_INCREMENTED)
 	{
@@ -1440,6 +1600,8 @@ AfterXactHostConnectionHandling(ConnectionHashEntry *entry, bool isCommit)
 					(errmsg("connection claimed exclusively at transaction commit")));
 		}
 
+		FinishRemoteCommandTrace(connection);
+		FlushConnectionCounters(connection);
 
 		if (ShouldShutdownConnection(connection, cachedConnectionCount))
 		{
@@ -1477,6 +1639,7 @@ AfterXactHostConnectionHandling(ConnectionHashEntry *entry, bool isCommit)
  * - Connection is not in OK state
  * - Connection has a replication origin setup
  * - A transaction is still in progress (usually because we are cancelling a distributed transaction)
+ * - The connection is still in pipeline mode (because an error interrupted the pipeline)
  * - A connection reached its maximum lifetime
  */
 static bool
@@ -1494,6 +1657,7 @@ ShouldShutdownConnection(MultiConnection *connection, const int cachedConnection
 		   connection->forceCloseAtTransactionEnd ||
 		   PQstatus(connection->pgConn) != CONNECTION_OK ||
 		   !RemoteTransactionIdle(connection) ||
+		   PQpipelineStatus(connection->pgConn) != PQ_PIPELINE_OFF ||
 		   connection->requiresReplication ||
 		   connection->isReplicationOriginSessionSetup ||
 		   (MaxCachedConnectionLifetime >= 0 &&
@@ -1590,6 +1754,13 @@ MarkConnectionConnected(MultiConnection *connection)
 	if (INSTR_TIME_IS_ZERO(connection->connectionEstablishmentEnd))
 	{
 		INSTR_TIME_SET_CURRENT(connection->connectionEstablishmentEnd);
+
+		instr_time establishmentTime = connection->connectionEstablishmentEnd;
+		INSTR_TIME_SUBTRACT(establishmentTime, connection->connectionEstablishmentStart);
+
+		connection->counters.connectionsEstablished++;
+		connection->counters.connectionEstablishmentTime +=
+			INSTR_TIME_GET_MICROSEC(establishmentTime);
 	}
 }
 
@@ -0,0 +1,533 @@
+/*-------------------------------------------------------------------------
+ *
+ * node_latency_stats.c
+ *   Keeps track of the recent task execution and connection establishment
+ *   times per worker node across backends. The adaptive executor uses them
+ *   to decide how many connections to open to a node right away, instead of
+ *   learning the latencies of the node anew in every execution.
+ *
+ *   The latencies are kept as exponentially weighted moving averages, such
+ *   that they follow changes in the load of the nodes while we only need a
+ *   few bytes per node.
+ *
+ *   When citus.node_health_check_interval is set, the maintenance daemon also
+ *   probes the nodes periodically and records the round trip time, the
+ *   replication lag and the outcome of the probes here. Router queries can
+ *   then read from the placements on healthy nodes first, see
+ *   NodeIsDegraded.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <math.h>
+
+#include "miscadmin.h"
+
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+
+#include "pg_version_constants.h"
+
+#include "distributed/metadata_cache.h"
+#include "distributed/node_latency_stats.h"
+#include "distributed/tuplestore.h"
+#include "distributed/worker_manager.h"
+
+
+/*
+ * Weight of a single sample in the moving averages. With 0.1, the samples
+ * of the last ~20 tasks make up almost 90% of the average.
+ */
+#define NODE_LATENCY_SAMPLE_WEIGHT 0.1
+
+#define NODE_LATENCIES_COLUMNS 10
+
+/*
+ * A node is degraded when more than this fraction of its recent probes
+ * failed, in addition to when its last probe failed.
+ */
+#define NODE_DEGRADED_PROBE_ERROR_RATE 0.25
+
+
+/*
+ * The data structure used to store the lock of the hash in shared memory.
+ */
+typedef struct NodeLatencyStatsSharedData
+{
+	int nodeLatencyHashTrancheId;
+	char *nodeLatencyHashTrancheName;
+
+	LWLock nodeLatencyHashLock;
+} NodeLatencyStatsSharedData;
+
+
+typedef struct NodeLatencyHashKey
+{
+	/* like the shared connection stats, we use "hostname/port" over nodeId */
+	char hostname[MAX_NODE_LENGTH];
+	int32 port;
+} NodeLatencyHashKey;
+
+/* hash entry for per worker latencies */
+typedef struct NodeLatencyHashEntry
+{
+	NodeLatencyHashKey key;
+
+	/* moving averages in microseconds, valid once the counts are non-zero */
+	double taskExecutionTime;
+	uint64 taskCount;
+	double connectionEstablishmentTime;
+	uint64 connectionCount;
+
+	/* outcome of the health probes, valid once the counts are non-zero */
+	double probeErrorRate;
+	bool lastProbeFailed;
+	uint64 probeCount;
+	double probeRoundTripTime;
+	double replicationLag;
+	uint64 successfulProbeCount;
+} NodeLatencyHashEntry;
+
+
+/* GUC, whether executions use and update the latencies of the nodes */
+bool EnableNodeLatencyFeedback = false;
+
+/* GUC, whether router queries prefer the placements on healthy nodes */
+bool AvoidDegradedNodes = false;
+
+/* GUC, round trip time or replication lag in milliseconds of degraded nodes */
+int DegradedNodeThreshold = 1000;
+
+
+/* the following two structs are used for accessing shared memory */
+static HTAB *NodeLatencyHash = NULL;
+static NodeLatencyStatsSharedData *NodeLatencyStatsSharedState = NULL;
+
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+/* local function declarations */
+static void InitNodeLatencyHashKey(NodeLatencyHashKey *key, const char *hostname,
+								   int port);
+static void InitNodeLatencyHashEntry(NodeLatencyHashEntry *entry);
+static bool NodeLatencyEntryIsDegraded(NodeLatencyHashEntry *entry);
+static double UpdateMovingAverage(double average, uint64 averageSampleCount,
+								  double sampleAverage, int sampleCount);
+
+
+PG_FUNCTION_INFO_V1(citus_node_latencies);
+
+
+/*
+ * citus_node_latencies returns the recent average task execution and
+ * connection establishment times of the nodes in milliseconds, along with the
+ * numbers of tasks and connections they were measured on, and the outcome of
+ * the health probes of the nodes.
+ */
+Datum
+citus_node_latencies(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	Datum values[NODE_LATENCIES_COLUMNS];
+	bool isNulls[NODE_LATENCIES_COLUMNS];
+
+	LWLockAcquire(&NodeLatencyStatsSharedState->nodeLatencyHashLock, LW_SHARED);
+
+	HASH_SEQ_STATUS status;
+	NodeLatencyHashEntry *entry = NULL;
+
+	hash_seq_init(&status, NodeLatencyHash);
+	while ((entry = (NodeLatencyHashEntry *) hash_seq_search(&status)) != NULL)
+	{
+		memset(values, 0, sizeof(values));
+		memset(isNulls, false, sizeof(isNulls));
+
+		values[0] = PointerGetDatum(cstring_to_text(entry->key.hostname));
+		values[1] = Int32GetDatum(entry->key.port);
+		values[2] = Float8GetDatum(entry->taskExecutionTime / 1000.0);
+		isNulls[2] = (entry->taskCount == 0);
+		values[3] = Int64GetDatum(entry->taskCount);
+		values[4] = Float8GetDatum(entry->connectionEstablishmentTime / 1000.0);
+		isNulls[4] = (entry->connectionCount == 0);
+		values[5] = Int64GetDatum(entry->connectionCount);
+		values[6] = Float8GetDatum(entry->probeRoundTripTime / 1000.0);
+		isNulls[6] = (entry->successfulProbeCount == 0);
+		values[7] = Float8GetDatum(entry->replicationLag);
+		isNulls[7] = (entry->successfulProbeCount == 0);
+		values[8] = Float8GetDatum(entry->probeErrorRate);
+		isNulls[8] = (entry->probeCount == 0);
+		values[9] = BoolGetDatum(NodeLatencyEntryIsDegraded(entry));
+
+		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+	}
+
+	LWLockRelease(&NodeLatencyStatsSharedState->nodeLatencyHashLock);
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * RecordNodeLatencies adds the total task execution and connection
+ * establishment times of the given numbers of tasks and connections on a node
+ * to the moving averages of the node.
+ */
+void
+RecordNodeLatencies(const char *hostname, int port, uint64 totalTaskExecutionTime,
+					int taskCount, uint64 totalConnectionEstablishmentTime,
+					int connectionCount)
+{
+	NodeLatencyHashKey key;
+
+	if (taskCount == 0 && connectionCount == 0)
+	{
+		return;
+	}
+
+	InitNodeLatencyHashKey(&key, hostname, port);
+
+	LWLockAcquire(&NodeLatencyStatsSharedState->nodeLatencyHashLock, LW_EXCLUSIVE);
+
+	bool entryFound = false;
+	NodeLatencyHashEntry *entry =
+		hash_search(NodeLatencyHash, &key, HASH_ENTER_NULL, &entryFound);
+
+	/* we track at most citus.max_worker_nodes_tracked nodes */
+	if (entry == NULL)
+	{
+		LWLockRelease(&NodeLatencyStatsSharedState->nodeLatencyHashLock);
+
+		ereport(DEBUG4, (errmsg("no space to track the latencies of node %s:%d",
+								hostname, port)));
+		return;
+	}
+
+	if (!entryFound)
+	{
+		InitNodeLatencyHashEntry(entry);
+	}
+
+	if (taskCount > 0)
+	{
+		entry->taskExecutionTime =
+			UpdateMovingAverage(entry->taskExecutionTime, entry->taskCount,
+								(double) totalTaskExecutionTime / taskCount,
+								taskCount);
+		entry->taskCount += taskCount;
+	}
+
+	if (connectionCount > 0)
+	{
+		entry->connectionEstablishmentTime =
+			UpdateMovingAverage(entry->connectionEstablishmentTime,
+								entry->connectionCount,
+								(double) totalConnectionEstablishmentTime /
+								connectionCount,
+								connectionCount);
+		entry->connectionCount += connectionCount;
+	}
+
+	LWLockRelease(&NodeLatencyStatsSharedState->nodeLatencyHashLock);
+}
+
+
+/*
+ * GetNodeLatencies copies the recent average latencies of the given node into
+ * latencies and returns true, or returns false if we did not see both a task
+ * execution and a connection establishment on the node yet.
+ */
+bool
+GetNodeLatencies(const char *hostname, int port, NodeLatencies *latencies)
+{
+	NodeLatencyHashKey key;
+	bool latenciesFound = false;
+
+	InitNodeLatencyHashKey(&key, hostname, port);
+
+	LWLockAcquire(&NodeLatencyStatsSharedState->nodeLatencyHashLock, LW_SHARED);
+
+	bool entryFound = false;
+	NodeLatencyHashEntry *entry =
+		hash_search(NodeLatencyHash, &key, HASH_FIND, &entryFound);
+
+	if (entryFound && entry->taskCount > 0 && entry->connectionCount > 0)
+	{
+		latencies->taskExecutionTime = entry->taskExecutionTime;
+		latencies->connectionEstablishmentTime = entry->connectionEstablishmentTime;
+		latenciesFound = true;
+	}
+
+	LWLockRelease(&NodeLatencyStatsSharedState->nodeLatencyHashLock);
+
+	return latenciesFound;
+}
+
+
+/*
+ * RecordNodeProbe adds the outcome of a health probe of a node to its moving
+ * averages. The round trip time is in microseconds and the replication lag
+ * in milliseconds, both are only used when the probe succeeded.
+ */
+void
+RecordNodeProbe(const char *hostname, int port, bool probeSucceeded,
+				uint64 roundTripTime, double replicationLag)
+{
+	NodeLatencyHashKey key;
+
+	InitNodeLatencyHashKey(&key, hostname, port);
+
+	LWLockAcquire(&NodeLatencyStatsSharedState->nodeLatencyHashLock, LW_EXCLUSIVE);
+
+	bool entryFound = false;
+	NodeLatencyHashEntry *entry =
+		hash_search(NodeLatencyHash, &key, HASH_ENTER_NULL, &entryFound);
+
+	/* we track at most citus.max_worker_nodes_tracked nodes */
+	if (entry == NULL)
+	{
+		LWLockRelease(&NodeLatencyStatsSharedState->nodeLatencyHashLock);
+
+		ereport(DEBUG4, (errmsg("no space to track the health of node %s:%d",
+								hostname, port)));
+		return;
+	}
+
+	if (!entryFound)
+	{
+		InitNodeLatencyHashEntry(entry);
+	}
+
+	entry->probeErrorRate = UpdateMovingAverage(entry->probeErrorRate,
+												entry->probeCount,
+												probeSucceeded ? 0.0 : 1.0, 1);
+	entry->lastProbeFailed = !probeSucceeded;
+
+	entry->probeCount++;
+
+	if (probeSucceeded)
+	{
+		entry->probeRoundTripTime =
+			UpdateMovingAverage(entry->probeRoundTripTime,
+								entry->successfulProbeCount,
+								(double) roundTripTime, 1);
+		entry->replicationLag = replicationLag;
+		entry->successfulProbeCount++;
+	}
+
+	LWLockRelease(&NodeLatencyStatsSharedState->nodeLatencyHashLock);
+}
+
+
+/*
+ * NodeIsDegraded returns whether the health probes of the given node recently
+ * failed, or showed a round trip time or replication lag above
+ * citus.degraded_node_threshold. Nodes that were not probed are not degraded.
+ */
+bool
+NodeIsDegraded(const char *hostname, int port)
+{
+	NodeLatencyHashKey key;
+
+	InitNodeLatencyHashKey(&key, hostname, port);
+
+	LWLockAcquire(&NodeLatencyStatsSharedState->nodeLatencyHashLock, LW_SHARED);
+
+	bool entryFound = false;
+	NodeLatencyHashEntry *entry =
+		hash_search(NodeLatencyHash, &key, HASH_FIND, &entryFound);
+
+	bool nodeIsDegraded = entryFound && NodeLatencyEntryIsDegraded(entry);
+
+	LWLockRelease(&NodeLatencyStatsSharedState->nodeLatencyHashLock);
+
+	return nodeIsDegraded;
+}
+
+
+/*
+ * NodeLatencyEntryIsDegraded implements NodeIsDegraded for the given entry.
+ * The caller should hold the lock.
+ */
+static bool
+NodeLatencyEntryIsDegraded(NodeLatencyHashEntry *entry)
+{
+	if (entry->probeCount == 0)
+	{
+		return false;
+	}
+
+	if (entry->lastProbeFailed ||
+		entry->probeErrorRate > NODE_DEGRADED_PROBE_ERROR_RATE)
+	{
+		return true;
+	}
+
+	return entry->probeRoundTripTime / 1000.0 > DegradedNodeThreshold ||
+		   entry->replicationLag > DegradedNodeThreshold;
+}
+
+
+/*
+ * InitNodeLatencyHashEntry initializes the latencies of a new entry.
+ */
+static void
+InitNodeLatencyHashEntry(NodeLatencyHashEntry *entry)
+{
+	entry->taskExecutionTime = 0.0;
+	entry->taskCount = 0;
+	entry->connectionEstablishmentTime = 0.0;
+	entry->connectionCount = 0;
+	entry->probeErrorRate = 0.0;
+	entry->lastProbeFailed = false;
+	entry->probeCount = 0;
+	entry->probeRoundTripTime = 0.0;
+	entry->replicationLag = 0.0;
+	entry->successfulProbeCount = 0;
+}
+
+
+/*
+ * InitNodeLatencyHashKey fills the hash key for the given node. The key is
+ * zeroed first, since it is hashed and compared as a blob.
+ */
+static void
+InitNodeLatencyHashKey(NodeLatencyHashKey *key, const char *hostname, int port)
+{
+	if (strlen(hostname) > MAX_NODE_LENGTH)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("hostname exceeds the maximum length of %d",
+							   MAX_NODE_LENGTH)));
+	}
+
+	memset(key, 0, sizeof(NodeLatencyHashKey));
+	strlcpy(key->hostname, hostname, MAX_NODE_LENGTH);
+	key->port = port;
+}
+
+
+/*
+ * UpdateMovingAverage returns the moving average after adding sampleCount
+ * samples with the given average. The first samples simply make up the
+ * average.
+ */
+static double
+UpdateMovingAverage(double average, uint64 averageSampleCount, double sampleAverage,
+					int sampleCount)
+{
+	if (averageSampleCount == 0)
+	{
+		return sampleAverage;
+	}
+
+	/* the weight of sampleCount samples that are added one by one */
+	double sampleWeight = 1.0 - pow(1.0 - NODE_LATENCY_SAMPLE_WEIGHT, sampleCount);
+
+	return average + sampleWeight * (sampleAverage - average);
+}
+
+
+/*
+ * InitializeNodeLatencyStats requests the necessary shared memory from
+ * Postgres and sets up the shared memory startup hook.
+ */
+void
+InitializeNodeLatencyStats(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(NodeLatencyStatsShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = NodeLatencyStatsShmemInit;
+}
+
+
+/*
+ * NodeLatencyStatsShmemSize returns the size that should be allocated on the
+ * shared memory for the node latencies.
+ */
+size_t
+NodeLatencyStatsShmemSize(void)
+{
+	Size size = 0;
+
+	size = add_size(size, sizeof(NodeLatencyStatsSharedData));
+
+	Size hashSize = hash_estimate_size(MaxWorkerNodesTracked,
+									   sizeof(NodeLatencyHashEntry));
+
+	size = add_size(size, hashSize);
+
+	return size;
+}
+
+
+/*
+ * NodeLatencyStatsShmemInit initializes the shared memory used for keeping
+ * track of the node latencies across backends.
+ */
+void
+NodeLatencyStatsShmemInit(void)
+{
+	bool alreadyInitialized = false;
+	HASHCTL info;
+
+	/* create (hostname, port) -> [latencies] */
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(NodeLatencyHashKey);
+	info.entrysize = sizeof(NodeLatencyHashEntry);
+	uint32 hashFlags = (HASH_ELEM | HASH_BLOBS);
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	NodeLatencyStatsSharedState =
+		(NodeLatencyStatsSharedData *) ShmemInitStruct(
+			"Node Latency Stats Data",
+			sizeof(NodeLatencyStatsSharedData),
+			&alreadyInitialized);
+
+	if (!alreadyInitialized)
+	{
+		NodeLatencyStatsSharedState->nodeLatencyHashTrancheId = LWLockNewTrancheId();
+		NodeLatencyStatsSharedState->nodeLatencyHashTrancheName =
+			"Node Latency Tracking Hash Tranche";
+		LWLockRegisterTranche(NodeLatencyStatsSharedState->nodeLatencyHashTrancheId,
+							  NodeLatencyStatsSharedState->nodeLatencyHashTrancheName);
+
+		LWLockInitialize(&NodeLatencyStatsSharedState->nodeLatencyHashLock,
+						 NodeLatencyStatsSharedState->nodeLatencyHashTrancheId);
+	}
+
+	/* allocate hash table */
+	NodeLatencyHash =
+		ShmemInitHash("Node Latency Stats Hash", MaxWorkerNodesTracked,
+					  MaxWorkerNodesTracked, &info, hashFlags);
+
+	LWLockRelease(AddinShmemInitLock);
+
+	Assert(NodeLatencyHash != NULL);
+	Assert(NodeLatencyStatsSharedState->nodeLatencyHashTrancheId != 0);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
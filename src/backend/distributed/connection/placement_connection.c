@@ -872,6 +872,49 @@ ConnectionModifiedPlacement(MultiConnection *connection)
 }
 
 
+/*
+ * PlacementAccessedInTransaction returns true if the placement, or a placement
+ * that is co-located with it, has already been accessed over a connection in
+ * the current transaction. Unlike GetConnectionIfPlacementAccessedInXact, it
+ * does not record the placement in the connection hashes.
+ */
+bool
+PlacementAccessedInTransaction(ShardPlacement *placement)
+{
+	ConnectionPlacementHashKey connKey;
+	bool found = false;
+
+	connKey.placementId = placement->placementId;
+
+	ConnectionPlacementHashEntry *placementEntry =
+		hash_search(ConnectionPlacementHash, &connKey, HASH_FIND, &found);
+	if (found && placementEntry->primaryConnection != NULL &&
+		placementEntry->primaryConnection->connection != NULL)
+	{
+		return true;
+	}
+
+	if (placement->partitionMethod == DISTRIBUTE_BY_HASH ||
+		placement->partitionMethod == DISTRIBUTE_BY_NONE)
+	{
+		ColocatedPlacementsHashKey coloKey;
+
+		coloKey.nodeId = placement->nodeId;
+		coloKey.colocationGroupId = placement->colocationGroupId;
+		coloKey.representativeValue = placement->representativeValue;
+
+		ColocatedPlacementsHashEntry *colocatedEntry =
+			hash_search(ColocatedPlacementsHash, &coloKey, HASH_FIND, &found);
+		if (found && colocatedEntry->primaryConnection->connection != NULL)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
 /*
  * AssociatePlacementWithShard records shard->placement relation in
  * ConnectionShardHash.
@@ -0,0 +1,387 @@
+/*-------------------------------------------------------------------------
+ *
+ * remote_command_trace.c
+ *   Keeps a sample of the commands sent to remote nodes, with their node,
+ *   duration and bytes, in a ring buffer in shared memory. Unlike
+ *   citus.log_remote_commands, this does not write to the server log and
+ *   can be left on in production at a low sample rate.
+ *
+ *   A command is sampled when it is sent, based on
+ *   citus.remote_command_trace_sample_rate, and recorded once its last
+ *   result was read from the connection. A sampled command that is still
+ *   in flight when the next command is sent over the connection, as in
+ *   pipelines and COPY, or at the end of the transaction, is recorded at
+ *   that point.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "pgstat.h"
+
+#include "mb/pg_wchar.h"
+#include "portability/instr_time.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+#include "pg_version_constants.h"
+
+#if PG_VERSION_NUM >= PG_VERSION_15
+#include "common/pg_prng.h"
+#endif
+
+#include "distributed/citus_safe_lib.h"
+#include "distributed/connection_management.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/remote_command_trace.h"
+#include "distributed/tuplestore.h"
+
+
+/* number of traces kept in shared memory */
+#define REMOTE_COMMAND_TRACE_COUNT 1024
+
+#define REMOTE_COMMAND_TRACES_COLUMNS 10
+
+
+/*
+ * The data structure used to store the ring buffer of the traces in shared
+ * memory. nextTraceIndex wraps around, the oldest trace is overwritten
+ * first.
+ */
+typedef struct RemoteCommandTraceSharedData
+{
+	int traceTrancheId;
+	char *traceTrancheName;
+
+	LWLock traceLock;
+
+	uint64 nextTraceIndex;
+	RemoteCommandTrace traces[REMOTE_COMMAND_TRACE_COUNT];
+} RemoteCommandTraceSharedData;
+
+
+/*
+ * PendingRemoteCommandTrace is the trace of a sampled command in flight on a
+ * connection, which is allocated on the first sampled command of the
+ * connection.
+ */
+typedef struct PendingRemoteCommandTrace
+{
+	/* whether a sampled command is in flight */
+	bool active;
+
+	instr_time startTime;
+	uint64 bytesReceivedAtStart;
+	RemoteCommandTrace trace;
+} PendingRemoteCommandTrace;
+
+
+/* GUC, fraction of the remote commands that are traced */
+double RemoteCommandTraceSampleRate = 0.0;
+
+
+static RemoteCommandTraceSharedData *RemoteCommandTraceSharedState = NULL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+/* local function declarations */
+static bool ShouldSampleRemoteCommand(void);
+static void RecordRemoteCommandTrace(RemoteCommandTrace *trace);
+
+
+PG_FUNCTION_INFO_V1(citus_remote_command_traces);
+
+
+/*
+ * citus_remote_command_traces returns the sampled remote command traces,
+ * oldest first.
+ */
+Datum
+citus_remote_command_traces(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	Datum values[REMOTE_COMMAND_TRACES_COLUMNS];
+	bool isNulls[REMOTE_COMMAND_TRACES_COLUMNS];
+
+	/* copy the traces, so we do not hold the lock while building tuples */
+	RemoteCommandTrace *traces = palloc(sizeof(RemoteCommandTrace) *
+										REMOTE_COMMAND_TRACE_COUNT);
+
+	LWLockAcquire(&RemoteCommandTraceSharedState->traceLock, LW_SHARED);
+
+	uint64 nextTraceIndex = RemoteCommandTraceSharedState->nextTraceIndex;
+	memcpy_s(traces, sizeof(RemoteCommandTrace) * REMOTE_COMMAND_TRACE_COUNT,
+			 RemoteCommandTraceSharedState->traces,
+			 sizeof(RemoteCommandTrace) * REMOTE_COMMAND_TRACE_COUNT);
+
+	LWLockRelease(&RemoteCommandTraceSharedState->traceLock);
+
+	for (int traceNumber = 0; traceNumber < REMOTE_COMMAND_TRACE_COUNT; traceNumber++)
+	{
+		RemoteCommandTrace *trace =
+			&traces[(nextTraceIndex + traceNumber) % REMOTE_COMMAND_TRACE_COUNT];
+
+		if (!trace->valid)
+		{
+			continue;
+		}
+
+		memset(values, 0, sizeof(values));
+		memset(isNulls, false, sizeof(isNulls));
+
+		values[0] = TimestampTzGetDatum(trace->startTime);
+		values[1] = Int32GetDatum(trace->pid);
+		values[2] = Int64GetDatum(trace->queryId);
+		values[3] = PointerGetDatum(cstring_to_text(trace->nodeName));
+		values[4] = Int32GetDatum(trace->nodePort);
+		values[5] = Int64GetDatum(trace->connectionId);
+		values[6] = Float8GetDatum(trace->duration);
+		values[7] = Int64GetDatum(trace->bytesSent);
+		values[8] = Int64GetDatum(trace->bytesReceived);
+		values[9] = PointerGetDatum(cstring_to_text(trace->command));
+		isNulls[9] = (trace->command[0] == '\0');
+
+		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+	}
+
+	pfree(traces);
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * StartRemoteCommandTrace is called when a command is sent over the given
+ * connection and starts tracing it, with a probability of
+ * citus.remote_command_trace_sample_rate. The command may be NULL for
+ * prepared statements that are executed by name.
+ */
+void
+StartRemoteCommandTrace(MultiConnection *connection, const char *command,
+						uint64 bytesSent)
+{
+	/* a sampled command that is still in flight is done by now */
+	FinishRemoteCommandTrace(connection);
+
+	if (!ShouldSampleRemoteCommand())
+	{
+		return;
+	}
+
+	if (connection->pendingCommandTrace == NULL)
+	{
+		connection->pendingCommandTrace =
+			MemoryContextAllocZero(ConnectionContext, sizeof(PendingRemoteCommandTrace));
+	}
+
+	PendingRemoteCommandTrace *pendingTrace = connection->pendingCommandTrace;
+	RemoteCommandTrace *trace = &pendingTrace->trace;
+
+	pendingTrace->active = true;
+	INSTR_TIME_SET_CURRENT(pendingTrace->startTime);
+	pendingTrace->bytesReceivedAtStart = connection->counters.bytesReceived;
+
+	trace->startTime = GetCurrentTimestamp();
+	trace->pid = MyProcPid;
+	trace->queryId = pgstat_get_my_query_id();
+	strlcpy(trace->nodeName, connection->hostname, MAX_NODE_LENGTH);
+	trace->nodePort = connection->port;
+	trace->connectionId = connection->connectionId;
+	trace->bytesSent = bytesSent;
+
+	/* truncate the command without splitting a multibyte character */
+	int commandLength = 0;
+	if (command != NULL)
+	{
+		commandLength = pg_mbcliplen(command,
+									 strnlen(command, REMOTE_COMMAND_TRACE_COMMAND_LENGTH),
+									 REMOTE_COMMAND_TRACE_COMMAND_LENGTH - 1);
+		memcpy_s(trace->command, sizeof(trace->command), command, commandLength);
+	}
+
+	trace->command[commandLength] = '\0';
+}
+
+
+/*
+ * FinishRemoteCommandTrace records the sampled command in flight on the
+ * given connection, if any, in the ring buffer.
+ */
+void
+FinishRemoteCommandTrace(MultiConnection *connection)
+{
+	PendingRemoteCommandTrace *pendingTrace = connection->pendingCommandTrace;
+	if (pendingTrace == NULL || !pendingTrace->active)
+	{
+		return;
+	}
+
+	instr_time duration;
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, pendingTrace->startTime);
+
+	/* the counters of the connection are zeroed when they are flushed */
+	uint64 bytesReceived = connection->counters.bytesReceived;
+	if (bytesReceived >= pendingTrace->bytesReceivedAtStart)
+	{
+		bytesReceived -= pendingTrace->bytesReceivedAtStart;
+	}
+
+	pendingTrace->trace.duration = INSTR_TIME_GET_MILLISEC(duration);
+	pendingTrace->trace.bytesReceived = bytesReceived;
+	pendingTrace->active = false;
+
+	RecordRemoteCommandTrace(&pendingTrace->trace);
+}
+
+
+/*
+ * ReleaseRemoteCommandTrace records the sampled command in flight on the
+ * given connection, if any, and frees the trace of the connection.
+ */
+void
+ReleaseRemoteCommandTrace(MultiConnection *connection)
+{
+	if (connection->pendingCommandTrace == NULL)
+	{
+		return;
+	}
+
+	FinishRemoteCommandTrace(connection);
+
+	pfree(connection->pendingCommandTrace);
+	connection->pendingCommandTrace = NULL;
+}
+
+
+/*
+ * ShouldSampleRemoteCommand returns whether a remote command should be
+ * traced, with a probability of citus.remote_command_trace_sample_rate.
+ */
+static bool
+ShouldSampleRemoteCommand(void)
+{
+	if (RemoteCommandTraceSampleRate <= 0.0)
+	{
+		return false;
+	}
+
+	if (RemoteCommandTraceSampleRate >= 1.0)
+	{
+		return true;
+	}
+
+#if PG_VERSION_NUM >= PG_VERSION_15
+	double randomValue = pg_prng_double(&pg_global_prng_state);
+#else
+
+	/* Generate a random double between 0 and 1 */
+	double randomValue = (double) random() / MAX_RANDOM_VALUE;
+#endif
+
+	return randomValue < RemoteCommandTraceSampleRate;
+}
+
+
+/*
+ * RecordRemoteCommandTrace adds a copy of the given trace to the ring buffer,
+ * overwriting the oldest trace.
+ */
+static void
+RecordRemoteCommandTrace(RemoteCommandTrace *trace)
+{
+	LWLockAcquire(&RemoteCommandTraceSharedState->traceLock, LW_EXCLUSIVE);
+
+	uint64 traceIndex = RemoteCommandTraceSharedState->nextTraceIndex;
+	RemoteCommandTraceSharedState->traces[traceIndex] = *trace;
+	RemoteCommandTraceSharedState->traces[traceIndex].valid = true;
+	RemoteCommandTraceSharedState->nextTraceIndex =
+		(traceIndex + 1) % REMOTE_COMMAND_TRACE_COUNT;
+
+	LWLockRelease(&RemoteCommandTraceSharedState->traceLock);
+}
+
+
+/*
+ * InitializeRemoteCommandTraces requests the necessary shared memory from
+ * Postgres and sets up the shared memory startup hook.
+ */
+void
+InitializeRemoteCommandTraces(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(RemoteCommandTraceShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = RemoteCommandTraceShmemInit;
+}
+
+
+/*
+ * RemoteCommandTraceShmemSize returns the size that should be allocated on
+ * the shared memory for the remote command traces.
+ */
+size_t
+RemoteCommandTraceShmemSize(void)
+{
+	return sizeof(RemoteCommandTraceSharedData);
+}
+
+
+/*
+ * RemoteCommandTraceShmemInit initializes the ring buffer of the remote
+ * command traces in shared memory.
+ */
+void
+RemoteCommandTraceShmemInit(void)
+{
+	bool alreadyInitialized = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	RemoteCommandTraceSharedState =
+		(RemoteCommandTraceSharedData *) ShmemInitStruct(
+			"Remote Command Trace Data",
+			sizeof(RemoteCommandTraceSharedData),
+			&alreadyInitialized);
+
+	if (!alreadyInitialized)
+	{
+		memset(RemoteCommandTraceSharedState, 0, sizeof(RemoteCommandTraceSharedData));
+
+		RemoteCommandTraceSharedState->traceTrancheId = LWLockNewTrancheId();
+		RemoteCommandTraceSharedState->traceTrancheName =
+			"Remote Command Trace Tranche";
+		LWLockRegisterTranche(RemoteCommandTraceSharedState->traceTrancheId,
+							  RemoteCommandTraceSharedState->traceTrancheName);
+
+		LWLockInitialize(&RemoteCommandTraceSharedState->traceLock,
+						 RemoteCommandTraceSharedState->traceTrancheId);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
@@ -19,12 +19,15 @@
 #include "utils/builtins.h"
 #include "utils/fmgrprotos.h"
 #include "utils/palloc.h"
+#include "utils/timestamp.h"
 
 #include "distributed/cancel_utils.h"
+#include "distributed/citus_wait_events.h"
 #include "distributed/connection_management.h"
 #include "distributed/errormessage.h"
 #include "distributed/listutils.h"
 #include "distributed/log_utils.h"
+#include "distributed/remote_command_trace.h"
 #include "distributed/remote_commands.h"
 
 
@@ -42,7 +45,8 @@ char *GrepRemoteCommands = "";
 
 static bool ClearResultsInternal(MultiConnection *connection, bool raiseErrors,
 								 bool discardWarnings);
-static bool FinishConnectionIO(MultiConnection *connection, bool raiseInterrupts);
+static bool FinishConnectionIO(MultiConnection *connection, bool raiseInterrupts,
+							   uint32 waitEventInfo);
 static WaitEventSet * BuildWaitEventSet(MultiConnection **allConnections,
 										int totalConnectionCount,
 										int pendingConnectionsStartIndex);
@@ -116,6 +120,7 @@ ClearResultsDiscardWarnings(MultiConnection *connection, bool raiseErrors)
 static bool
 ClearResultsInternal(MultiConnection *connection, bool raiseErrors, bool discardWarnings)
 {
+	PGconn *pgConn = connection->pgConn;
 	bool success = true;
 
 	while (true)
@@ -123,14 +128,43 @@ ClearResultsInternal(MultiConnection *connection, bool raiseErrors, bool discard
 		PGresult *result = GetRemoteCommandResult(connection, raiseErrors);
 		if (result == NULL)
 		{
-			break;
+			/*
+			 * In pipeline mode, NULL only ends the results of one of the
+			 * queries in the pipeline. We continue until the results of
+			 * all of them are consumed and pipeline mode can be left,
+			 * unless waiting for the results fails or is interrupted.
+			 */
+			if (PQpipelineStatus(pgConn) == PQ_PIPELINE_OFF ||
+				PQstatus(pgConn) != CONNECTION_OK ||
+				PQexitPipelineMode(pgConn) == 1)
+			{
+				break;
+			}
+
+			if (PQisBusy(pgConn) &&
+				!FinishConnectionIO(connection, raiseErrors,
+									WAIT_EVENT_CITUS_REMOTE_RESULT))
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		ExecStatusType resultStatus = PQresultStatus(result);
+		if (resultStatus == PGRES_PIPELINE_SYNC ||
+			resultStatus == PGRES_PIPELINE_ABORTED)
+		{
+			/* an aborted query follows a failed one, which we already reported */
+			PQclear(result);
+			continue;
 		}
 
 		/*
 		 * End any pending copy operation. Transaction will be marked
 		 * as failed by the following part.
 		 */
-		if (PQresultStatus(result) == PGRES_COPY_IN)
+		if (resultStatus == PGRES_COPY_IN)
 		{
 			PQputCopyEnd(connection->pgConn, NULL);
 		}
@@ -146,8 +180,12 @@ ClearResultsInternal(MultiConnection *connection, bool raiseErrors, bool discard
 
 			success = false;
 
-			/* an error happened, there is nothing we can do more */
-			if (PQresultStatus(result) == PGRES_FATAL_ERROR)
+			/*
+			 * An error happened, there is nothing we can do more, unless the
+			 * rest of the pipeline needs to be consumed.
+			 */
+			if (resultStatus == PGRES_FATAL_ERROR &&
+				PQpipelineStatus(pgConn) == PQ_PIPELINE_OFF)
 			{
 				PQclear(result);
 
@@ -179,6 +217,12 @@ ClearResultsIfReady(MultiConnection *connection)
 
 	Assert(PQisnonblocking(pgConn));
 
+	if (PQpipelineStatus(pgConn) != PQ_PIPELINE_OFF)
+	{
+		/* the rest of an interrupted pipeline might not be received yet */
+		return false;
+	}
+
 	while (true)
 	{
 		/*
@@ -536,6 +580,8 @@ SendRemoteCommandParams(MultiConnection *connection, const char *command,
 
 	Assert(PQisnonblocking(pgConn));
 
+	CountRemoteCommand(connection, command, parameterCount, parameterValues, NULL);
+
 	int rc = PQsendQueryParams(pgConn, command, parameterCount, parameterTypes,
 							   parameterValues, NULL, NULL, binaryResults ? 1 : 0);
 
@@ -543,6 +589,50 @@ SendRemoteCommandParams(MultiConnection *connection, const char *command,
 }
 
 
+/*
+ * SendRemoteCommandBinaryParams is like SendRemoteCommandParams, except that
+ * the parameter values are sent in binary format with the given lengths,
+ * which avoids escaping large bytea values in text format.
+ */
+int
+SendRemoteCommandBinaryParams(MultiConnection *connection, const char *command,
+							  int parameterCount, const Oid *parameterTypes,
+							  const char *const *parameterValues,
+							  const int *parameterLengths)
+{
+	PGconn *pgConn = connection->pgConn;
+
+	LogRemoteCommand(connection, command);
+
+	/*
+	 * Don't try to send command if connection is entirely gone
+	 * (PQisnonblocking() would crash).
+	 */
+	if (!pgConn || PQstatus(pgConn) != CONNECTION_OK)
+	{
+		return 0;
+	}
+
+	Assert(PQisnonblocking(pgConn));
+
+	int *parameterFormats = palloc(parameterCount * sizeof(int));
+	for (int parameterIndex = 0; parameterIndex < parameterCount; parameterIndex++)
+	{
+		parameterFormats[parameterIndex] = 1;
+	}
+
+	CountRemoteCommand(connection, command, parameterCount, parameterValues,
+					   parameterLengths);
+
+	int rc = PQsendQueryParams(pgConn, command, parameterCount, parameterTypes,
+							   parameterValues, parameterLengths, parameterFormats, 0);
+
+	pfree(parameterFormats);
+
+	return rc;
+}
+
+
 /*
  * SendRemoteCommand is a PQsendQuery wrapper that logs remote commands, and
  * accepts a MultiConnection instead of a plain PGconn. It makes sure it can
@@ -568,12 +658,44 @@ SendRemoteCommand(MultiConnection *connection, const char *command)
 
 	Assert(PQisnonblocking(pgConn));
 
+	CountRemoteCommand(connection, command, 0, NULL, NULL);
+
 	int rc = PQsendQuery(pgConn, command);
 
 	return rc;
 }
 
 
+/*
+ * CountRemoteCommand adds a command with the given parameters to the
+ * counters of the connection. Parameters without lengths are in text format.
+ */
+void
+CountRemoteCommand(MultiConnection *connection, const char *command,
+				   int parameterCount, const char *const *parameterValues,
+				   const int *parameterLengths)
+{
+	uint64 commandBytes = (command != NULL) ? strlen(command) : 0;
+
+	for (int parameterIndex = 0; parameterIndex < parameterCount; parameterIndex++)
+	{
+		if (parameterValues[parameterIndex] == NULL)
+		{
+			continue;
+		}
+
+		commandBytes += (parameterLengths != NULL) ?
+						parameterLengths[parameterIndex] :
+						strlen(parameterValues[parameterIndex]);
+	}
+
+	connection->counters.commandsSent++;
+	connection->counters.bytesSent += commandBytes;
+
+	StartRemoteCommandTrace(connection, command, commandBytes);
+}
+
+
 /*
  * ExecuteRemoteCommandAndCheckResult executes the given command in the remote node and
  * checks if the result is equal to the expected result. If the result is equal to the
@@ -674,10 +796,17 @@ GetRemoteCommandResult(MultiConnection *connection, bool raiseInterrupts)
 	 */
 	if (!PQisBusy(pgConn))
 	{
-		return PQgetResult(connection->pgConn);
+		PGresult *result = PQgetResult(connection->pgConn);
+		if (result == NULL)
+		{
+			FinishRemoteCommandTrace(connection);
+		}
+
+		return result;
 	}
 
-	if (!FinishConnectionIO(connection, raiseInterrupts))
+	if (!FinishConnectionIO(connection, raiseInterrupts,
+							WAIT_EVENT_CITUS_REMOTE_RESULT))
 	{
 		/* some error(s) happened while doing the I/O, signal the callers */
 		if (PQstatus(pgConn) == CONNECTION_BAD)
@@ -692,6 +821,10 @@ GetRemoteCommandResult(MultiConnection *connection, bool raiseInterrupts)
 	Assert(!PQisBusy(pgConn));
 
 	PGresult *result = PQgetResult(connection->pgConn);
+	if (result == NULL)
+	{
+		FinishRemoteCommandTrace(connection);
+	}
 
 	return result;
 }
@@ -706,18 +839,9 @@ GetRemoteCommandResult(MultiConnection *connection, bool raiseInterrupts)
 bool
 PutRemoteCopyData(MultiConnection *connection, const char *buffer, int nbytes)
 {
-	PGconn *pgConn = connection->pgConn;
 	bool allowInterrupts = true;
 
-	if (PQstatus(pgConn) != CONNECTION_OK)
-	{
-		return false;
-	}
-
-	Assert(PQisnonblocking(pgConn));
-
-	int copyState = PQputCopyData(pgConn, buffer, nbytes);
-	if (copyState <= 0)
+	if (!QueueRemoteCopyData(connection, buffer, nbytes))
 	{
 		return false;
 	}
@@ -733,18 +857,261 @@ PutRemoteCopyData(MultiConnection *connection, const char *buffer, int nbytes)
 	 * throughput get worse at 4MB and lower due to the number of CPU
 	 * cycles spent in networking system calls.
 	 */
-
-	connection->copyBytesWrittenSinceLastFlush += nbytes;
-	if (connection->copyBytesWrittenSinceLastFlush > RemoteCopyFlushThreshold)
+	if (RemoteCopyFlushThresholdReached(connection))
 	{
 		connection->copyBytesWrittenSinceLastFlush = 0;
-		return FinishConnectionIO(connection, allowInterrupts);
+		return FinishConnectionIO(connection, allowInterrupts,
+								  WAIT_EVENT_CITUS_COPY_FLUSH);
+	}
+
+	return true;
+}
+
+
+/*
+ * QueueRemoteCopyData is a wrapper around PQputCopyData() that keeps track of
+ * the bytes written since the last flush, but leaves providing back pressure
+ * to the caller.
+ *
+ * Returns false if PQputCopyData() failed, true otherwise.
+ */
+bool
+QueueRemoteCopyData(MultiConnection *connection, const char *buffer, int nbytes)
+{
+	PGconn *pgConn = connection->pgConn;
+
+	if (PQstatus(pgConn) != CONNECTION_OK)
+	{
+		return false;
+	}
+
+	Assert(PQisnonblocking(pgConn));
+
+	int copyState = PQputCopyData(pgConn, buffer, nbytes);
+	if (copyState <= 0)
+	{
+		return false;
 	}
 
+	connection->copyBytesWrittenSinceLastFlush += nbytes;
+	connection->counters.copyBytesSent += nbytes;
+
 	return true;
 }
 
 
+/*
+ * RemoteCopyFlushThresholdReached returns whether more than
+ * citus.remote_copy_flush_threshold bytes of COPY data were written to the
+ * connection since it was last flushed.
+ */
+bool
+RemoteCopyFlushThresholdReached(MultiConnection *connection)
+{
+	return connection->copyBytesWrittenSinceLastFlush > RemoteCopyFlushThreshold;
+}
+
+
+/*
+ * FlushRemoteCopyData provides back pressure for the COPY data queued on the
+ * given connection, like PutRemoteCopyData() does once
+ * citus.remote_copy_flush_threshold is reached. While it waits for the socket
+ * of the connection to become writable, it also sends the pending COPY data of
+ * the other connections in connectionList whenever their sockets are
+ * writable, such that a slow node does not keep the other nodes idle.
+ *
+ * Returns false if sending the data of the given connection failed. Failures of
+ * the other connections are reported when their COPY ends.
+ */
+bool
+FlushRemoteCopyData(MultiConnection *connection, List *connectionList)
+{
+	PGconn *pgConn = connection->pgConn;
+
+	if (PQstatus(pgConn) != CONNECTION_OK)
+	{
+		return false;
+	}
+
+	Assert(PQisnonblocking(pgConn));
+
+	CHECK_FOR_INTERRUPTS();
+
+	connection->copyBytesWrittenSinceLastFlush = 0;
+
+	int sendStatus = PQflush(pgConn);
+	if (sendStatus != 1)
+	{
+		return sendStatus == 0;
+	}
+
+	/* the given connection is the first one, followed by the others with pending data */
+	int maxConnectionCount = Min(list_length(connectionList) + 1, FD_SETSIZE - 3);
+	MultiConnection **allConnections =
+		palloc(maxConnectionCount * sizeof(MultiConnection *));
+	WaitEvent *events = palloc((maxConnectionCount + 2) * sizeof(WaitEvent));
+	bool *connectionReady = palloc0(maxConnectionCount * sizeof(bool));
+	int totalConnectionCount = 0;
+	int pendingConnectionsStartIndex = 0;
+	bool connectionFlushed = false;
+	bool success = true;
+	WaitEventSet *volatile waitEventSet = NULL;
+
+	allConnections[totalConnectionCount++] = connection;
+
+	MultiConnection *otherConnection = NULL;
+	foreach_ptr(otherConnection, connectionList)
+	{
+		if (totalConnectionCount == maxConnectionCount)
+		{
+			break;
+		}
+
+		if (otherConnection == connection ||
+			PQstatus(otherConnection->pgConn) != CONNECTION_OK)
+		{
+			continue;
+		}
+
+		int otherSendStatus = PQflush(otherConnection->pgConn);
+		if (otherSendStatus == 0)
+		{
+			otherConnection->copyBytesWrittenSinceLastFlush = 0;
+		}
+		else if (otherSendStatus == 1)
+		{
+			allConnections[totalConnectionCount++] = otherConnection;
+		}
+	}
+
+	PG_TRY();
+	{
+		bool rebuildWaitEventSet = true;
+
+		while (!connectionFlushed)
+		{
+			int pendingConnectionCount = totalConnectionCount -
+										 pendingConnectionsStartIndex;
+
+			/* rebuild the WaitEventSet whenever connections are flushed */
+			if (rebuildWaitEventSet)
+			{
+				if (waitEventSet != NULL)
+				{
+					FreeWaitEventSet(waitEventSet);
+				}
+
+				waitEventSet = BuildWaitEventSet(allConnections, totalConnectionCount,
+												 pendingConnectionsStartIndex);
+
+				rebuildWaitEventSet = false;
+			}
+
+			int eventCount = WaitEventSetWait(waitEventSet, -1, events,
+											  pendingConnectionCount + 2,
+											  WAIT_EVENT_CITUS_COPY_FLUSH);
+
+			for (int eventIndex = 0; eventIndex < eventCount; eventIndex++)
+			{
+				WaitEvent *event = &events[eventIndex];
+				bool connectionIsReady = false;
+
+				if (event->events & WL_POSTMASTER_DEATH)
+				{
+					ereport(ERROR, (errmsg("postmaster was shut down, exiting")));
+				}
+
+				if (event->events & WL_LATCH_SET)
+				{
+					ResetLatch(MyLatch);
+					CHECK_FOR_INTERRUPTS();
+					continue;
+				}
+
+				MultiConnection *eventConnection = (MultiConnection *) event->user_data;
+				bool sendFailed = false;
+
+				if (event->events & WL_SOCKET_WRITEABLE)
+				{
+					int eventSendStatus = PQflush(eventConnection->pgConn);
+					if (eventSendStatus == -1)
+					{
+						connectionIsReady = true;
+						sendFailed = true;
+					}
+					else if (eventSendStatus == 0)
+					{
+						eventConnection->copyBytesWrittenSinceLastFlush = 0;
+						connectionIsReady = true;
+					}
+				}
+
+				/* consume notices and errors, and notice closed connections */
+				if (!connectionIsReady && (event->events & WL_SOCKET_READABLE) &&
+					PQconsumeInput(eventConnection->pgConn) == 0)
+				{
+					connectionIsReady = true;
+					sendFailed = true;
+				}
+
+				if (connectionIsReady)
+				{
+					/* see WaitForAllConnections() for how the arrays are arranged */
+					int connectionIndex = event->pos + pendingConnectionsStartIndex;
+
+					connectionReady[connectionIndex] = true;
+					rebuildWaitEventSet = true;
+
+					if (eventConnection == connection)
+					{
+						connectionFlushed = true;
+						success = !sendFailed;
+					}
+				}
+			}
+
+			/* move flushed connections to the front of the array */
+			for (int connectionIndex = pendingConnectionsStartIndex;
+				 connectionIndex < totalConnectionCount; connectionIndex++)
+			{
+				if (connectionReady[connectionIndex])
+				{
+					allConnections[connectionIndex] =
+						allConnections[pendingConnectionsStartIndex];
+					pendingConnectionsStartIndex++;
+					connectionReady[connectionIndex] = false;
+				}
+			}
+		}
+
+		FreeWaitEventSet(waitEventSet);
+		waitEventSet = NULL;
+
+		pfree(allConnections);
+		pfree(events);
+		pfree(connectionReady);
+	}
+	PG_CATCH();
+	{
+		/* make sure the epoll file descriptor is always closed */
+		if (waitEventSet != NULL)
+		{
+			FreeWaitEventSet(waitEventSet);
+			waitEventSet = NULL;
+		}
+
+		pfree(allConnections);
+		pfree(events);
+		pfree(connectionReady);
+
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	return success;
+}
+
+
 /*
  * PutRemoteCopyEnd is a wrapper around PQputCopyEnd() that handles
  * interrupts.
@@ -774,7 +1141,7 @@ PutRemoteCopyEnd(MultiConnection *connection, const char *errormsg)
 
 	connection->copyBytesWrittenSinceLastFlush = 0;
 
-	return FinishConnectionIO(connection, allowInterrupts);
+	return FinishConnectionIO(connection, allowInterrupts, WAIT_EVENT_CITUS_COPY_FLUSH);
 }
 
 
@@ -788,7 +1155,8 @@ PutRemoteCopyEnd(MultiConnection *connection, const char *errormsg)
  * Returns true if IO was successfully completed, false otherwise.
  */
 static bool
-FinishConnectionIO(MultiConnection *connection, bool raiseInterrupts)
+FinishConnectionIO(MultiConnection *connection, bool raiseInterrupts,
+				   uint32 waitEventInfo)
 {
 	PGconn *pgConn = connection->pgConn;
 	int sock = PQsocket(pgConn);
@@ -835,7 +1203,17 @@ FinishConnectionIO(MultiConnection *connection, bool raiseInterrupts)
 			return true;
 		}
 
-		int rc = WaitLatchOrSocket(MyLatch, waitFlags, sock, 0, PG_WAIT_EXTENSION);
+		instr_time waitStart;
+		instr_time waitDuration;
+
+		INSTR_TIME_SET_CURRENT(waitStart);
+
+		int rc = WaitLatchOrSocket(MyLatch, waitFlags, sock, 0, waitEventInfo);
+
+		INSTR_TIME_SET_CURRENT(waitDuration);
+		INSTR_TIME_SUBTRACT(waitDuration, waitStart);
+		connection->counters.waitTime += INSTR_TIME_GET_MICROSEC(waitDuration);
+
 		if (rc & WL_POSTMASTER_DEATH)
 		{
 			ereport(ERROR, (errmsg("postmaster was shut down, exiting")));
@@ -875,6 +1253,22 @@ FinishConnectionIO(MultiConnection *connection, bool raiseInterrupts)
 void
 WaitForAllConnections(List *connectionList, bool raiseInterrupts)
 {
+	long timeoutMs = -1;
+
+	WaitForAllConnectionsWithTimeout(connectionList, raiseInterrupts, timeoutMs);
+}
+
+
+/*
+ * WaitForAllConnectionsWithTimeout is like WaitForAllConnections, but stops
+ * waiting after timeoutMs milliseconds, unless timeoutMs is -1. Afterwards, the
+ * caller can use PQisBusy to find the connections that are still busy.
+ */
+void
+WaitForAllConnectionsWithTimeout(List *connectionList, bool raiseInterrupts,
+								 long timeoutMs)
+{
+	TimestampTz waitStartTime = GetCurrentTimestamp();
 	int totalConnectionCount = list_length(connectionList);
 	int pendingConnectionsStartIndex = 0;
 	int connectionIndex = 0;
@@ -921,6 +1315,19 @@ WaitForAllConnections(List *connectionList, bool raiseInterrupts)
 			int pendingConnectionCount = totalConnectionCount -
 										 pendingConnectionsStartIndex;
 
+			if (timeoutMs >= 0)
+			{
+				long waitedMs = TimestampDifferenceMilliseconds(waitStartTime,
+																GetCurrentTimestamp());
+				if (waitedMs >= timeoutMs)
+				{
+					/* leave the remaining connections to the caller */
+					break;
+				}
+
+				timeout = timeoutMs - waitedMs;
+			}
+
 			/* rebuild the WaitEventSet whenever connections are ready */
 			if (rebuildWaitEventSet)
 			{
@@ -938,7 +1345,7 @@ WaitForAllConnections(List *connectionList, bool raiseInterrupts)
 			/* wait for I/O events */
 			int eventCount = WaitEventSetWait(waitEventSet, timeout, events,
 											  pendingConnectionCount,
-											  WAIT_EVENT_CLIENT_READ);
+											  WAIT_EVENT_CITUS_REMOTE_RESULT);
 
 			/* process I/O events */
 			for (; eventIndex < eventCount; eventIndex++)
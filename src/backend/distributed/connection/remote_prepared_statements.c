@@ -0,0 +1,360 @@
+/*-------------------------------------------------------------------------
+ *
+ * remote_prepared_statements.c
+ *   Prepare the parameterized commands that are sent to remote nodes, such
+ *   that the remote nodes don't need to parse them on every execution.
+ *
+ * A command is sent along with its parameters when it comes from a generic
+ * plan on this node, which is by nature executed repeatedly. Therefore, when
+ * citus.max_prepared_statements_per_connection allows, we prepare such a
+ * command on the connection the first time it is sent over it, and execute
+ * the prepared statement afterwards.
+ *
+ * The prepared statements are tracked per connection and are gone when the
+ * connection is closed. The remote nodes revalidate the prepared statements
+ * on DDL by themselves. Still, a prepared statement cannot change its result
+ * type, so we prepare the statements again after the metadata of a Citus table
+ * is invalidated on this node, as happens on DDL.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "libpq-fe.h"
+
+#include "common/hashfn.h"
+#include "lib/stringinfo.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+#include "distributed/citus_safe_lib.h"
+#include "distributed/connection_management.h"
+#include "distributed/remote_commands.h"
+#include "distributed/remote_prepared_statements.h"
+
+
+/* prefix of the names of the statements that we prepare on remote nodes */
+#define PREPARED_STATEMENT_NAME_PREFIX "citus_prepared_statement_"
+
+
+/*
+ * RemotePreparedStatement represents a statement that is prepared on a
+ * connection.
+ */
+typedef struct RemotePreparedStatement
+{
+	/* hash key, must be first */
+	char *command;
+
+	char statementName[NAMEDATALEN];
+	int parameterCount;
+	Oid *parameterTypes;
+
+	/* whether the statement is prepared on the remote node */
+	bool isPrepared;
+
+	/* value of PreparedStatementInvalidationCounter when it was prepared */
+	uint64 invalidationCounter;
+} RemotePreparedStatement;
+
+
+/* GUC, the number of statements that can be prepared on a connection */
+int MaxPreparedStatementsPerConnection = 0;
+
+/* incremented whenever the prepared statements should be prepared again */
+static uint64 PreparedStatementInvalidationCounter = 0;
+
+
+static RemotePreparedStatement * GetRemotePreparedStatement(MultiConnection *connection,
+															const char *command);
+static bool PrepareRemoteStatement(MultiConnection *connection,
+								   RemotePreparedStatement *preparedStatement,
+								   int parameterCount, const Oid *parameterTypes);
+static bool ParameterTypesMatch(RemotePreparedStatement *preparedStatement,
+								int parameterCount, const Oid *parameterTypes);
+static uint32 CommandHash(const void *key, Size keysize);
+static int CommandCompare(const void *leftKey, const void *rightKey, Size keysize);
+
+
+/*
+ * SendRemoteCommandParamsPrepared is like SendRemoteCommandParams, except that
+ * it executes the command as a statement that is prepared on the connection,
+ * if there is room to prepare it.
+ *
+ * Preparing the statement requires a round trip, during which we block. If the
+ * remote node fails to prepare the statement, we error out.
+ */
+int
+SendRemoteCommandParamsPrepared(MultiConnection *connection, const char *command,
+								int parameterCount, const Oid *parameterTypes,
+								const char *const *parameterValues, bool binaryResults)
+{
+	PGconn *pgConn = connection->pgConn;
+
+	if (MaxPreparedStatementsPerConnection == 0 || !pgConn ||
+		PQstatus(pgConn) != CONNECTION_OK)
+	{
+		return SendRemoteCommandParams(connection, command, parameterCount,
+									   parameterTypes, parameterValues, binaryResults);
+	}
+
+	RemotePreparedStatement *preparedStatement =
+		GetRemotePreparedStatement(connection, command);
+	if (preparedStatement == NULL)
+	{
+		/* there is no room to prepare another statement */
+		return SendRemoteCommandParams(connection, command, parameterCount,
+									   parameterTypes, parameterValues, binaryResults);
+	}
+
+	if (!preparedStatement->isPrepared ||
+		preparedStatement->invalidationCounter != PreparedStatementInvalidationCounter ||
+		!ParameterTypesMatch(preparedStatement, parameterCount, parameterTypes))
+	{
+		if (!PrepareRemoteStatement(connection, preparedStatement, parameterCount,
+									parameterTypes))
+		{
+			return 0;
+		}
+	}
+
+	LogRemoteCommand(connection, command);
+
+	Assert(PQisnonblocking(pgConn));
+
+	/* only the parameters are sent, the command was sent when preparing */
+	CountRemoteCommand(connection, NULL, parameterCount, parameterValues, NULL);
+
+	int rc = PQsendQueryPrepared(pgConn, preparedStatement->statementName,
+								 parameterCount, parameterValues, NULL, NULL,
+								 binaryResults ? 1 : 0);
+
+	return rc;
+}
+
+
+/*
+ * GetRemotePreparedStatement returns the prepared statement of given command on
+ * the connection. If the command was not sent over the connection before, it
+ * adds an entry that is yet to be prepared, unless the connection already has
+ * as many prepared statements as allowed, in which case it returns NULL.
+ */
+static RemotePreparedStatement *
+GetRemotePreparedStatement(MultiConnection *connection, const char *command)
+{
+	if (connection->preparedStatementHash == NULL)
+	{
+		connection->preparedStatementContext =
+			AllocSetContextCreate(ConnectionContext, "Remote Prepared Statements",
+								  ALLOCSET_SMALL_SIZES);
+
+		HASHCTL info;
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(char *);
+		info.entrysize = sizeof(RemotePreparedStatement);
+		info.hash = CommandHash;
+		info.match = CommandCompare;
+		info.hcxt = connection->preparedStatementContext;
+		int hashFlags = (HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+
+		connection->preparedStatementHash =
+			hash_create("Remote Prepared Statement Hash", 32, &info, hashFlags);
+	}
+
+	HTAB *preparedStatementHash = connection->preparedStatementHash;
+	bool found = false;
+
+	RemotePreparedStatement *preparedStatement =
+		hash_search(preparedStatementHash, &command, HASH_FIND, &found);
+	if (found)
+	{
+		return preparedStatement;
+	}
+
+	if (hash_get_num_entries(preparedStatementHash) >=
+		MaxPreparedStatementsPerConnection)
+	{
+		return NULL;
+	}
+
+	MemoryContext oldContext =
+		MemoryContextSwitchTo(connection->preparedStatementContext);
+
+	char *commandCopy = pstrdup(command);
+
+	preparedStatement = hash_search(preparedStatementHash, &commandCopy, HASH_ENTER,
+									&found);
+	Assert(!found);
+
+	/* entries are never removed, so the number of entries gives a unique name */
+	SafeSnprintf(preparedStatement->statementName, NAMEDATALEN, "%s" INT64_FORMAT,
+				 PREPARED_STATEMENT_NAME_PREFIX,
+				 (int64) hash_get_num_entries(preparedStatementHash));
+
+	preparedStatement->parameterCount = 0;
+	preparedStatement->parameterTypes = NULL;
+	preparedStatement->isPrepared = false;
+	preparedStatement->invalidationCounter = 0;
+
+	MemoryContextSwitchTo(oldContext);
+
+	return preparedStatement;
+}
+
+
+/*
+ * PrepareRemoteStatement prepares the statement on the connection with given
+ * parameter types and waits for the remote node to do so. If the statement was
+ * prepared before, it is deallocated first. Returns false if the connection
+ * failed.
+ */
+static bool
+PrepareRemoteStatement(MultiConnection *connection,
+					   RemotePreparedStatement *preparedStatement,
+					   int parameterCount, const Oid *parameterTypes)
+{
+	bool raiseInterrupts = true;
+	PGconn *pgConn = connection->pgConn;
+
+	if (preparedStatement->isPrepared)
+	{
+		StringInfo deallocateCommand = makeStringInfo();
+		appendStringInfo(deallocateCommand, "DEALLOCATE %s",
+						 preparedStatement->statementName);
+
+		ExecuteCriticalRemoteCommand(connection, deallocateCommand->data);
+
+		preparedStatement->isPrepared = false;
+	}
+
+	MemoryContext oldContext =
+		MemoryContextSwitchTo(connection->preparedStatementContext);
+
+	if (preparedStatement->parameterTypes != NULL)
+	{
+		pfree(preparedStatement->parameterTypes);
+	}
+
+	preparedStatement->parameterCount = parameterCount;
+	preparedStatement->parameterTypes = palloc0(Max(parameterCount, 1) * sizeof(Oid));
+	for (int parameterIndex = 0; parameterIndex < parameterCount; parameterIndex++)
+	{
+		preparedStatement->parameterTypes[parameterIndex] =
+			parameterTypes[parameterIndex];
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	CountRemoteCommand(connection, preparedStatement->command, 0, NULL, NULL);
+
+	if (!PQsendPrepare(pgConn, preparedStatement->statementName,
+					   preparedStatement->command, preparedStatement->parameterCount,
+					   preparedStatement->parameterTypes))
+	{
+		return false;
+	}
+
+	PGresult *result = GetRemoteCommandResult(connection, raiseInterrupts);
+	if (result == NULL || PQstatus(pgConn) == CONNECTION_BAD)
+	{
+		PQclear(result);
+		return false;
+	}
+
+	if (!IsResponseOK(result))
+	{
+		ReportResultError(connection, result, ERROR);
+	}
+
+	PQclear(result);
+	ForgetResults(connection);
+
+	preparedStatement->isPrepared = true;
+	preparedStatement->invalidationCounter = PreparedStatementInvalidationCounter;
+
+	return true;
+}
+
+
+/*
+ * ParameterTypesMatch returns whether the statement was prepared with given
+ * parameter types.
+ */
+static bool
+ParameterTypesMatch(RemotePreparedStatement *preparedStatement, int parameterCount,
+					const Oid *parameterTypes)
+{
+	if (preparedStatement->parameterCount != parameterCount)
+	{
+		return false;
+	}
+
+	for (int parameterIndex = 0; parameterIndex < parameterCount; parameterIndex++)
+	{
+		if (preparedStatement->parameterTypes[parameterIndex] !=
+			parameterTypes[parameterIndex])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * ReleaseRemotePreparedStatements forgets the statements that were prepared on
+ * the connection, which is called when the connection is closed.
+ */
+void
+ReleaseRemotePreparedStatements(MultiConnection *connection)
+{
+	if (connection->preparedStatementContext != NULL)
+	{
+		MemoryContextDelete(connection->preparedStatementContext);
+	}
+
+	connection->preparedStatementContext = NULL;
+	connection->preparedStatementHash = NULL;
+}
+
+
+/*
+ * InvalidateRemotePreparedStatements makes sure that the statements that were
+ * prepared on the connections are prepared again before they are executed,
+ * which is called when the metadata of a Citus table is invalidated.
+ */
+void
+InvalidateRemotePreparedStatements(void)
+{
+	PreparedStatementInvalidationCounter++;
+}
+
+
+/*
+ * CommandHash is the hash function for the commands of prepared statements.
+ */
+static uint32
+CommandHash(const void *key, Size keysize)
+{
+	const char *command = *(const char **) key;
+
+	return hash_bytes((const unsigned char *) command, strlen(command));
+}
+
+
+/*
+ * CommandCompare is the comparison function for the commands of prepared
+ * statements.
+ */
+static int
+CommandCompare(const void *leftKey, const void *rightKey, Size keysize)
+{
+	const char *leftCommand = *(const char **) leftKey;
+	const char *rightCommand = *(const char **) rightKey;
+
+	return strcmp(leftCommand, rightCommand);
+}
@@ -21,13 +21,16 @@
 #include "catalog/pg_authid.h"
 #include "commands/dbcommands.h"
 #include "common/hashfn.h"
+#include "port/atomics.h"
 #include "storage/ipc.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
 
 #include "pg_version_constants.h"
 
 #include "distributed/backend_data.h"
 #include "distributed/cancel_utils.h"
+#include "distributed/citus_wait_events.h"
 #include "distributed/connection_management.h"
 #include "distributed/listutils.h"
 #include "distributed/locally_reserved_shared_connections.h"
@@ -46,8 +49,8 @@
 /*
  * The data structure used to store data in shared memory. This data structure is only
  * used for storing the lock. The actual statistics about the connections are stored
- * in the hashmap, which is allocated separately, as Postgres provides different APIs
- * for allocating hashmaps in the shared memory.
+ * in the slots, which the hashmap maps the nodes to. Both are allocated separately,
+ * as Postgres provides different APIs for allocating hashmaps in the shared memory.
  */
 typedef struct ConnectionStatsSharedData
 {
@@ -76,14 +79,47 @@ typedef struct SharedConnStatsHashKey
 	Oid databaseOid;
 } SharedConnStatsHashKey;
 
-/* hash entry for per worker stats */
+/*
+ * SharedConnStatsSlot holds the connection counter of a node in a fixed array
+ * in shared memory. Opening and closing connections happens at a high rate,
+ * so backends cache the slot of a node and update its counter with atomic
+ * operations, instead of taking the lock exclusively.
+ *
+ * The state combines the generation of the slot in its upper 32 bits with the
+ * connection count in its lower 32 bits. When all slots are taken, slots
+ * without connections are reassigned to other nodes, which increments their
+ * generation, such that the backends that cached them notice that the slot
+ * no longer belongs to their node in the same compare-and-swap.
+ */
+typedef struct SharedConnStatsSlot
+{
+	pg_atomic_uint64 state;
+
+	/* whether a hash entry points to the slot, protected by the lock */
+	bool inUse;
+} SharedConnStatsSlot;
+
+#define SLOT_STATE_GENERATION(state) ((uint32) ((state) >> 32))
+#define SLOT_STATE_COUNT(state) ((uint32) ((state) & PG_UINT32_MAX))
+#define SLOT_STATE(generation, count) (((uint64) (generation) << 32) | (count))
+
+/* hash entry for per worker stats, which only maps the node to its slot */
 typedef struct SharedConnStatsHashEntry
 {
 	SharedConnStatsHashKey key;
 
-	int connectionCount;
+	int slotIndex;
 } SharedConnStatsHashEntry;
 
+/* backend-local cache entry for the slot of a node */
+typedef struct SharedConnStatsSlotCacheEntry
+{
+	SharedConnStatsHashKey key;
+
+	int slotIndex;
+	uint32 generation;
+} SharedConnStatsSlotCacheEntry;
+
 
 /*
  * Controlled via a GUC, never access directly, use GetMaxSharedPoolSize().
@@ -104,11 +140,28 @@ int LocalSharedPoolSize = 0;
 /* number of connections reserved for Citus */
 int MaxClientConnections = ALLOW_ALL_EXTERNAL_CONNECTIONS;
 
+/*
+ * Controlled via a GUC, the priority of the executions of the current
+ * session when they compete for the connections of the shared pool.
+ */
+int ExecutionPriority = EXECUTION_PRIORITY_NORMAL;
 
-/* the following two structs are used for accessing shared memory */
+/*
+ * Controlled via a GUC, the number of connections per node that each
+ * execution priority leaves for the executions with higher priorities.
+ * "0" means all executions can use the whole shared pool.
+ */
+int SharedPoolPriorityReserve = 0;
+
+
+/* the following three structs are used for accessing shared memory */
 static HTAB *SharedConnStatsHash = NULL;
+static SharedConnStatsSlot *SharedConnStatsSlots = NULL;
 static ConnectionStatsSharedData *ConnectionStatsSharedState = NULL;
 
+/* slots of the nodes that the current backend connected to */
+static HTAB *SharedConnStatsSlotCache = NULL;
+
 
 static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 
@@ -118,7 +171,15 @@ static void StoreAllRemoteConnectionStats(Tuplestorestate *tupleStore, TupleDesc
 										  tupleDescriptor);
 static void LockConnectionSharedMemory(LWLockMode lockMode);
 static void UnLockConnectionSharedMemory(void);
+static SharedConnStatsSlot * GetSharedConnectionSlot(SharedConnStatsHashKey *connKey,
+													 bool assignSlot,
+													 uint32 *generation);
+static void ForgetSharedConnectionSlot(SharedConnStatsHashKey *connKey);
+static int AssignSharedConnectionSlot(SharedConnStatsHashKey *connKey);
+static int FindFreeSharedConnectionSlot(void);
+static void ReleaseIdleSharedConnectionSlots(void);
 static bool ShouldWaitForConnection(int currentConnectionCount);
+static int PriorityConnectionLimit(int poolSize);
 static uint32 SharedConnectionHashHash(const void *key, Size keysize);
 static int SharedConnectionHashCompare(const void *a, const void *b, Size keysize);
 
@@ -176,10 +237,18 @@ StoreAllRemoteConnectionStats(Tuplestorestate *tupleStore, TupleDesc tupleDescri
 			continue;
 		}
 
+		SharedConnStatsSlot *slot = &SharedConnStatsSlots[connectionEntry->slotIndex];
+		uint32 connectionCount = SLOT_STATE_COUNT(pg_atomic_read_u64(&slot->state));
+		if (connectionCount == 0)
+		{
+			/* slots stay assigned to nodes without connections */
+			continue;
+		}
+
 		values[0] = PointerGetDatum(cstring_to_text(connectionEntry->key.hostname));
 		values[1] = Int32GetDatum(connectionEntry->key.port);
 		values[2] = PointerGetDatum(cstring_to_text(databaseName));
-		values[3] = Int32GetDatum(connectionEntry->connectionCount);
+		values[3] = Int32GetDatum(connectionCount);
 
 		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
 	}
@@ -284,7 +353,6 @@ TryToIncrementSharedConnectionCounter(const char *hostname, int port)
 		return true;
 	}
 
-	bool counterIncremented = false;
 	SharedConnStatsHashKey connKey;
 
 	strlcpy(connKey.hostname, hostname, MAX_NODE_LENGTH);
@@ -336,78 +404,94 @@ TryToIncrementSharedConnectionCounter(const char *hostname, int port)
 		activeBackendCount = GetExternalClientBackendCount();
 	}
 
-	LockConnectionSharedMemory(LW_EXCLUSIVE);
-
 	/*
-	 * As the hash map is allocated in shared memory, it doesn't rely on palloc for
-	 * memory allocation, so we could get NULL via HASH_ENTER_NULL when there is no
-	 * space in the shared memory. That's why we prefer continuing the execution
-	 * instead of throwing an error.
-	 */
-	bool entryFound = false;
-	SharedConnStatsHashEntry *connectionEntry =
-		hash_search(SharedConnStatsHash, &connKey, HASH_ENTER_NULL, &entryFound);
-
-	/*
-	 * It is possible to throw an error at this point, but that doesn't help us in anyway.
-	 * Instead, we try our best, let the connection establishment continue by-passing the
-	 * connection throttling.
+	 * For local nodes, solely relying on citus.max_shared_pool_size or
+	 * max_connections might not be sufficient. The former gives us
+	 * a preview of the future (e.g., we let the new connections to establish,
+	 * but they are not established yet). The latter gives us the close to
+	 * precise view of the past (e.g., the active number of client backends).
+	 *
+	 * Overall, we want to limit both of the metrics. The former limit typically
+	 * kicks in under regular loads, where the load of the database increases in
+	 * a reasonable pace. The latter limit typically kicks in when the database
+	 * is issued lots of concurrent sessions at the same time, such as benchmarks.
 	 */
-	if (!connectionEntry)
+	int connectionLimit = 0;
+	bool backendLimitReached = false;
+	if (connectionToLocalNode)
 	{
-		UnLockConnectionSharedMemory();
-		return true;
+		connectionLimit = PriorityConnectionLimit(GetLocalSharedPoolSize());
+		backendLimitReached = (activeBackendCount + 1 > connectionLimit);
 	}
-
-	if (!entryFound)
+	else
 	{
-		/* we successfully allocated the entry for the first time, so initialize it */
-		connectionEntry->connectionCount = 1;
-
-		counterIncremented = true;
+		connectionLimit = PriorityConnectionLimit(GetMaxSharedPoolSize());
 	}
-	else if (connectionToLocalNode)
+
+	while (true)
 	{
+		uint32 generation = 0;
+		bool assignSlot = true;
+		SharedConnStatsSlot *slot = GetSharedConnectionSlot(&connKey, assignSlot,
+															&generation);
+
 		/*
-		 * For local nodes, solely relying on citus.max_shared_pool_size or
-		 * max_connections might not be sufficient. The former gives us
-		 * a preview of the future (e.g., we let the new connections to establish,
-		 * but they are not established yet). The latter gives us the close to
-		 * precise view of the past (e.g., the active number of client backends).
-		 *
-		 * Overall, we want to limit both of the metrics. The former limit typically
-		 * kicks in under regular loads, where the load of the database increases in
-		 * a reasonable pace. The latter limit typically kicks in when the database
-		 * is issued lots of concurrent sessions at the same time, such as benchmarks.
+		 * It is possible to throw an error when all slots are taken, but that
+		 * doesn't help us in anyway. Instead, we try our best, let the connection
+		 * establishment continue by-passing the connection throttling.
 		 */
-		if (activeBackendCount + 1 > GetLocalSharedPoolSize())
+		if (slot == NULL)
 		{
-			counterIncremented = false;
+			return true;
 		}
-		else if (connectionEntry->connectionCount + 1 > GetLocalSharedPoolSize())
-		{
-			counterIncremented = false;
-		}
-		else
+
+		uint64 state = pg_atomic_read_u64(&slot->state);
+		while (SLOT_STATE_GENERATION(state) == generation)
 		{
-			connectionEntry->connectionCount++;
-			counterIncremented = true;
+			uint32 connectionCount = SLOT_STATE_COUNT(state);
+
+			/* the first connection to a node is always allowed */
+			if (connectionCount > 0 &&
+				(backendLimitReached || connectionCount + 1 > connectionLimit))
+			{
+				/* there is no space left for this connection */
+				return false;
+			}
+
+			/* on failure, state is set to the current state of the slot */
+			if (pg_atomic_compare_exchange_u64(&slot->state, &state,
+											   SLOT_STATE(generation,
+														  connectionCount + 1)))
+			{
+				return true;
+			}
 		}
+
+		/* the slot was reassigned to another node, find the new one */
+		ForgetSharedConnectionSlot(&connKey);
 	}
-	else if (connectionEntry->connectionCount + 1 > GetMaxSharedPoolSize())
-	{
-		/* there is no space left for this connection */
-		counterIncremented = false;
-	}
-	else
-	{
-		connectionEntry->connectionCount++;
-		counterIncremented = true;
-	}
+}
 
-	UnLockConnectionSharedMemory();
 
-	return counterIncremented;
+/*
+ * PriorityConnectionLimit returns the number of connections of a pool with the
+ * given size that the executions of the current session can use. Each
+ * priority below high leaves citus.shared_pool_priority_reserve connections
+ * to the executions with a higher priority, such that latency-critical
+ * queries still find connections while large analytic queries use the rest
+ * of the pool, and lower priority executions are the ones that wait for
+ * connections first.
+ *
+ * We never go below a single connection, which the executions could always
+ * get when the node has no connections at all.
+ */
+static int
+PriorityConnectionLimit(int poolSize)
+{
+	int64 reservedConnectionCount =
+		(int64) SharedPoolPriorityReserve * (EXECUTION_PRIORITY_HIGH - ExecutionPriority);
+
+	return (int) Max(poolSize - reservedConnectionCount, 1);
 }
 
 
@@ -437,41 +521,41 @@ IncrementSharedConnectionCounter(const char *hostname, int port)
 	connKey.port = port;
 	connKey.databaseOid = MyDatabaseId;
 
-	LockConnectionSharedMemory(LW_EXCLUSIVE);
-
-	/*
-	 * As the hash map is allocated in shared memory, it doesn't rely on palloc for
-	 * memory allocation, so we could get NULL via HASH_ENTER_NULL. That's why we prefer
-	 * continuing the execution instead of throwing an error.
-	 */
-	bool entryFound = false;
-	SharedConnStatsHashEntry *connectionEntry =
-		hash_search(SharedConnStatsHash, &connKey, HASH_ENTER_NULL, &entryFound);
-
-	/*
-	 * It is possible to throw an error at this point, but that doesn't help us in anyway.
-	 * Instead, we try our best, let the connection establishment continue by-passing the
-	 * connection throttling.
-	 */
-	if (!connectionEntry)
+	while (true)
 	{
-		UnLockConnectionSharedMemory();
+		uint32 generation = 0;
+		bool assignSlot = true;
+		SharedConnStatsSlot *slot = GetSharedConnectionSlot(&connKey, assignSlot,
+															&generation);
 
-		ereport(DEBUG4, (errmsg("No entry found for node %s:%d while incrementing "
-								"connection counter", hostname, port)));
-
-		return;
-	}
+		/*
+		 * It is possible to throw an error at this point, but that doesn't help us
+		 * in anyway. Instead, we try our best, let the connection establishment
+		 * continue by-passing the connection throttling.
+		 */
+		if (slot == NULL)
+		{
+			ereport(DEBUG4, (errmsg("No slot found for node %s:%d while incrementing "
+									"connection counter", hostname, port)));
 
-	if (!entryFound)
-	{
-		/* we successfully allocated the entry for the first time, so initialize it */
-		connectionEntry->connectionCount = 0;
-	}
+			return;
+		}
 
-	connectionEntry->connectionCount += 1;
+		uint64 state = pg_atomic_read_u64(&slot->state);
+		while (SLOT_STATE_GENERATION(state) == generation)
+		{
+			uint32 connectionCount = SLOT_STATE_COUNT(state);
+
+			if (pg_atomic_compare_exchange_u64(&slot->state, &state,
+											   SLOT_STATE(generation,
+														  connectionCount + 1)))
+			{
+				return;
+			}
+		}
 
-	UnLockConnectionSharedMemory();
+		ForgetSharedConnectionSlot(&connKey);
+	}
 }
 
 
@@ -505,46 +589,245 @@ DecrementSharedConnectionCounter(const char *hostname, int port)
 	connKey.port = port;
 	connKey.databaseOid = MyDatabaseId;
 
-	LockConnectionSharedMemory(LW_EXCLUSIVE);
+	while (true)
+	{
+		uint32 generation = 0;
+		bool assignSlot = false;
+		SharedConnStatsSlot *slot = GetSharedConnectionSlot(&connKey, assignSlot,
+															&generation);
 
-	bool entryFound = false;
+		/* this worker node is removed or updated, no need to care */
+		if (slot == NULL)
+		{
+			ereport(DEBUG4, (errmsg("No slot found for node %s:%d while decrementing "
+									"connection counter", hostname, port)));
+			break;
+		}
+
+		uint64 state = pg_atomic_read_u64(&slot->state);
+		while (SLOT_STATE_GENERATION(state) == generation)
+		{
+			uint32 connectionCount = SLOT_STATE_COUNT(state);
+
+			/*
+			 * We should never go below 0. Slots are only reassigned when they
+			 * have no connections, so a reassigned slot tells us the same.
+			 */
+			if (connectionCount == 0 ||
+				pg_atomic_compare_exchange_u64(&slot->state, &state,
+											   SLOT_STATE(generation,
+														  connectionCount - 1)))
+			{
+				break;
+			}
+		}
+
+		if (SLOT_STATE_GENERATION(state) == generation)
+		{
+			break;
+		}
+
+		ForgetSharedConnectionSlot(&connKey);
+	}
+
+	/* wake up any waiters in case any backend is waiting for this node */
+	WakeupWaiterBackendsForSharedConnection();
+}
+
+
+/*
+ * GetSharedConnectionSlot returns the slot that holds the connection counter
+ * of the given node, along with the generation of the slot at the time it
+ * was assigned to the node. The slot is cached by the backend, such that we
+ * only take the lock the first time. When the node has no slot yet and
+ * assignSlot is set, we assign one. Otherwise, or if all slots are taken by
+ * nodes with connections, we return NULL.
+ */
+static SharedConnStatsSlot *
+GetSharedConnectionSlot(SharedConnStatsHashKey *connKey, bool assignSlot,
+						uint32 *generation)
+{
+	if (SharedConnStatsSlotCache == NULL)
+	{
+		HASHCTL info;
+
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(SharedConnStatsHashKey);
+		info.entrysize = sizeof(SharedConnStatsSlotCacheEntry);
+		info.hash = SharedConnectionHashHash;
+		info.match = SharedConnectionHashCompare;
+		info.hcxt = TopMemoryContext;
+		uint32 hashFlags = (HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+
+		SharedConnStatsSlotCache = hash_create("Shared Conn. Stats Slot Cache", 32,
+											   &info, hashFlags);
+	}
+
+	bool cacheEntryFound = false;
+	SharedConnStatsSlotCacheEntry *cacheEntry =
+		hash_search(SharedConnStatsSlotCache, connKey, HASH_FIND, &cacheEntryFound);
+	if (cacheEntryFound)
+	{
+		*generation = cacheEntry->generation;
+		return &SharedConnStatsSlots[cacheEntry->slotIndex];
+	}
+
+	/*
+	 * Slots are only reassigned under the exclusive lock, so the generation
+	 * that we read under the lock belongs to the node.
+	 */
+	LockConnectionSharedMemory(LW_SHARED);
+
+	int slotIndex = -1;
 	SharedConnStatsHashEntry *connectionEntry =
-		hash_search(SharedConnStatsHash, &connKey, HASH_FIND, &entryFound);
+		hash_search(SharedConnStatsHash, connKey, HASH_FIND, NULL);
+	if (connectionEntry != NULL)
+	{
+		slotIndex = connectionEntry->slotIndex;
+		*generation =
+			SLOT_STATE_GENERATION(pg_atomic_read_u64(&SharedConnStatsSlots[slotIndex].
+													 state));
+	}
 
-	/* this worker node is removed or updated, no need to care */
-	if (!entryFound)
+	UnLockConnectionSharedMemory();
+
+	if (slotIndex < 0 && assignSlot)
 	{
+		LockConnectionSharedMemory(LW_EXCLUSIVE);
+
+		slotIndex = AssignSharedConnectionSlot(connKey);
+		if (slotIndex >= 0)
+		{
+			*generation =
+				SLOT_STATE_GENERATION(pg_atomic_read_u64(&SharedConnStatsSlots[slotIndex].
+														 state));
+		}
+
 		UnLockConnectionSharedMemory();
+	}
+
+	if (slotIndex < 0)
+	{
+		return NULL;
+	}
 
-		/* wake up any waiters in case any backend is waiting for this node */
-		WakeupWaiterBackendsForSharedConnection();
+	cacheEntry = hash_search(SharedConnStatsSlotCache, connKey, HASH_ENTER, NULL);
+	cacheEntry->slotIndex = slotIndex;
+	cacheEntry->generation = *generation;
 
-		ereport(DEBUG4, (errmsg("No entry found for node %s:%d while decrementing "
-								"connection counter", hostname, port)));
+	return &SharedConnStatsSlots[slotIndex];
+}
 
-		return;
+
+/*
+ * ForgetSharedConnectionSlot removes the slot of the given node from the cache
+ * of the backend, after the slot was reassigned to another node.
+ */
+static void
+ForgetSharedConnectionSlot(SharedConnStatsHashKey *connKey)
+{
+	hash_search(SharedConnStatsSlotCache, connKey, HASH_REMOVE, NULL);
+}
+
+
+/*
+ * AssignSharedConnectionSlot assigns a free slot to the given node and returns
+ * its index, or -1 if all slots are taken by nodes with connections. The
+ * caller should hold the lock exclusively.
+ */
+static int
+AssignSharedConnectionSlot(SharedConnStatsHashKey *connKey)
+{
+	bool entryFound = false;
+	SharedConnStatsHashEntry *connectionEntry =
+		hash_search(SharedConnStatsHash, connKey, HASH_FIND, &entryFound);
+	if (entryFound)
+	{
+		/* another backend assigned a slot while we did not hold the lock */
+		return connectionEntry->slotIndex;
+	}
+
+	int slotIndex = FindFreeSharedConnectionSlot();
+	if (slotIndex < 0)
+	{
+		ReleaseIdleSharedConnectionSlots();
+
+		slotIndex = FindFreeSharedConnectionSlot();
+		if (slotIndex < 0)
+		{
+			return -1;
+		}
+	}
+
+	/*
+	 * As the hash map is allocated in shared memory, it doesn't rely on palloc for
+	 * memory allocation, so we could get NULL via HASH_ENTER_NULL when there is no
+	 * space in the shared memory. That's why we prefer continuing the execution
+	 * instead of throwing an error.
+	 */
+	connectionEntry = hash_search(SharedConnStatsHash, connKey, HASH_ENTER_NULL,
+								  &entryFound);
+	if (connectionEntry == NULL)
+	{
+		return -1;
 	}
 
-	/* we should never go below 0 */
-	Assert(connectionEntry->connectionCount > 0);
+	connectionEntry->slotIndex = slotIndex;
+	SharedConnStatsSlots[slotIndex].inUse = true;
+
+	return slotIndex;
+}
 
-	connectionEntry->connectionCount -= 1;
 
-	if (connectionEntry->connectionCount == 0)
+/*
+ * FindFreeSharedConnectionSlot returns the index of a slot that is not
+ * assigned to any node, or -1. The caller should hold the lock exclusively.
+ */
+static int
+FindFreeSharedConnectionSlot(void)
+{
+	for (int slotIndex = 0; slotIndex < MaxWorkerNodesTracked; slotIndex++)
 	{
-		/*
-		 * We don't have to remove at this point as the node might be still active
-		 * and will have new connections open to it. Still, this seems like a convenient
-		 * place to remove the entry, as connectionCount == 0 implies that the server is
-		 * not busy, and given the default value of MaxCachedConnectionsPerWorker = 1,
-		 * we're unlikely to trigger this often.
-		 */
-		hash_search(SharedConnStatsHash, &connKey, HASH_REMOVE, &entryFound);
+		if (!SharedConnStatsSlots[slotIndex].inUse)
+		{
+			return slotIndex;
+		}
 	}
 
-	UnLockConnectionSharedMemory();
+	return -1;
+}
 
-	WakeupWaiterBackendsForSharedConnection();
+
+/*
+ * ReleaseIdleSharedConnectionSlots releases the slots of the nodes that have
+ * no connections, which typically belong to nodes that were removed or
+ * updated. Incrementing the generation makes the compare-and-swap of the
+ * backends that cached the slot fail, so they look up the node again. The
+ * caller should hold the lock exclusively.
+ */
+static void
+ReleaseIdleSharedConnectionSlots(void)
+{
+	HASH_SEQ_STATUS status;
+	SharedConnStatsHashEntry *connectionEntry = NULL;
+
+	hash_seq_init(&status, SharedConnStatsHash);
+	while ((connectionEntry = (SharedConnStatsHashEntry *) hash_seq_search(&status)) != 0)
+	{
+		SharedConnStatsSlot *slot = &SharedConnStatsSlots[connectionEntry->slotIndex];
+		uint64 state = pg_atomic_read_u64(&slot->state);
+
+		if (SLOT_STATE_COUNT(state) != 0 ||
+			!pg_atomic_compare_exchange_u64(&slot->state, &state,
+											SLOT_STATE(SLOT_STATE_GENERATION(state) + 1,
+													   0)))
+		{
+			continue;
+		}
+
+		slot->inUse = false;
+		hash_search(SharedConnStatsHash, &connectionEntry->key, HASH_REMOVE, NULL);
+	}
 }
 
 
@@ -603,7 +886,7 @@ void
 WaitForSharedConnection(void)
 {
 	ConditionVariableSleep(&ConnectionStatsSharedState->waitersConditionVariable,
-						   PG_WAIT_EXTENSION);
+						   WAIT_EVENT_CITUS_SHARED_CONNECTION_SLOT);
 }
 
 
@@ -644,6 +927,7 @@ SharedConnectionStatsShmemSize(void)
 									   sizeof(SharedConnStatsHashEntry));
 
 	size = add_size(size, hashSize);
+	size = add_size(size, mul_size(MaxWorkerNodesTracked, sizeof(SharedConnStatsSlot)));
 
 	return size;
 }
@@ -657,9 +941,10 @@ void
 SharedConnectionStatsShmemInit(void)
 {
 	bool alreadyInitialized = false;
+	bool slotsAlreadyInitialized = false;
 	HASHCTL info;
 
-	/* create (hostname, port, database) -> [counter] */
+	/* create (hostname, port, database) -> [slot] */
 	memset(&info, 0, sizeof(info));
 	info.keysize = sizeof(SharedConnStatsHashKey);
 	info.entrysize = sizeof(SharedConnStatsHashEntry);
@@ -699,6 +984,22 @@ SharedConnectionStatsShmemInit(void)
 		ShmemInitHash("Shared Conn. Stats Hash", MaxWorkerNodesTracked,
 					  MaxWorkerNodesTracked, &info, hashFlags);
 
+	/* allocate the counters that the hash table points to */
+	SharedConnStatsSlots =
+		(SharedConnStatsSlot *) ShmemInitStruct("Shared Conn. Stats Slots",
+												mul_size(MaxWorkerNodesTracked,
+														 sizeof(SharedConnStatsSlot)),
+												&slotsAlreadyInitialized);
+
+	if (!slotsAlreadyInitialized)
+	{
+		for (int slotIndex = 0; slotIndex < MaxWorkerNodesTracked; slotIndex++)
+		{
+			pg_atomic_init_u64(&SharedConnStatsSlots[slotIndex].state, 0);
+			SharedConnStatsSlots[slotIndex].inUse = false;
+		}
+	}
+
 	LWLockRelease(AddinShmemInitLock);
 
 	Assert(SharedConnStatsHash != NULL);
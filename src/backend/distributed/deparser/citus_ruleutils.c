@@ -253,6 +253,21 @@ pg_get_sequencedef_string(Oid sequenceRelationId)
 {
 	Form_pg_sequence pgSequenceForm = pg_get_sequencedef(sequenceRelationId);
 
+	return pg_get_sequencedef_string_with_cache(sequenceRelationId,
+												pgSequenceForm->seqcache);
+}
+
+
+/*
+ * pg_get_sequencedef_string_with_cache returns the definition of a given
+ * sequence like pg_get_sequencedef_string, but with the given number of
+ * values for each backend to cache.
+ */
+char *
+pg_get_sequencedef_string_with_cache(Oid sequenceRelationId, int64 cacheSize)
+{
+	Form_pg_sequence pgSequenceForm = pg_get_sequencedef(sequenceRelationId);
+
 	/* build our DDL command */
 	char *qualifiedSequenceName = generate_qualified_relation_name(sequenceRelationId);
 	char *typeName = format_type_be(pgSequenceForm->seqtypid);
@@ -266,7 +281,7 @@ pg_get_sequencedef_string(Oid sequenceRelationId)
 								 typeName,
 								 pgSequenceForm->seqincrement, pgSequenceForm->seqmin,
 								 pgSequenceForm->seqmax, pgSequenceForm->seqstart,
-								 pgSequenceForm->seqcache,
+								 cacheSize,
 								 pgSequenceForm->seqcycle ? "" : "NO ");
 
 	return sequenceDef;
@@ -54,6 +54,7 @@
 #include "distributed/citus_nodefuncs.h"
 #include "distributed/citus_ruleutils.h"
 #include "distributed/namespace_utils.h"
+#include "distributed/planning_times.h"
 #include "executor/spi.h"
 #include "foreign/foreign.h"
 #include "funcapi.h"
@@ -463,7 +464,11 @@ static char *generate_function_name(Oid funcid, int nargs,
 void
 pg_get_query_def(Query *query, StringInfo buffer)
 {
+	DistributedPlanningPhase previousPhase = BeginPlanningPhase(PLANNING_PHASE_DEPARSE);
+
 	get_query_def(query, buffer, NIL, NULL, 0, WRAP_COLUMN_DEFAULT, 0);
+
+	EndPlanningPhase(previousPhase);
 }
 
 /*
@@ -1920,8 +1925,12 @@ void
 deparse_shard_query(Query *query, Oid distrelid, int64 shardid,
 					StringInfo buffer)
 {
+	DistributedPlanningPhase previousPhase = BeginPlanningPhase(PLANNING_PHASE_DEPARSE);
+
 	get_query_def_extended(query, buffer, NIL, distrelid, shardid, NULL, 0,
 						   WRAP_COLUMN_DEFAULT, 0);
+
+	EndPlanningPhase(previousPhase);
 }
 
 
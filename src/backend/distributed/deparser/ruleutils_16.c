@@ -55,6 +55,7 @@
 #include "distributed/citus_ruleutils.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/namespace_utils.h"
+#include "distributed/planning_times.h"
 #include "executor/spi.h"
 #include "foreign/foreign.h"
 #include "funcapi.h"
@@ -493,7 +494,11 @@ static List *get_insert_column_names_list(List *targetList, StringInfo buf, depa
 void
 pg_get_query_def(Query *query, StringInfo buffer)
 {
+	DistributedPlanningPhase previousPhase = BeginPlanningPhase(PLANNING_PHASE_DEPARSE);
+
 	get_query_def(query, buffer, NIL, NULL, false, 0, WRAP_COLUMN_DEFAULT, 0);
+
+	EndPlanningPhase(previousPhase);
 }
 
 /*
@@ -2006,9 +2011,13 @@ void
 deparse_shard_query(Query *query, Oid distrelid, int64 shardid,
 					StringInfo buffer)
 {
+	DistributedPlanningPhase previousPhase = BeginPlanningPhase(PLANNING_PHASE_DEPARSE);
+
 	get_query_def_extended(query, buffer, NIL, distrelid, shardid, NULL,
 	                       false,
 						   0, WRAP_COLUMN_DEFAULT, 0);
+
+	EndPlanningPhase(previousPhase);
 }
 
 /* ----------
@@ -136,6 +136,8 @@
 #include "commands/dbcommands.h"
 #include "commands/schemacmds.h"
 #include "lib/ilist.h"
+#include "libpq/pqformat.h"
+#include "optimizer/optimizer.h"
 #include "portability/instr_time.h"
 #include "storage/fd.h"
 #include "storage/latch.h"
@@ -146,15 +148,19 @@
 #include "utils/timestamp.h"
 
 #include "distributed/adaptive_executor.h"
+#include "distributed/async_reference_table.h"
 #include "distributed/backend_data.h"
 #include "distributed/cancel_utils.h"
 #include "distributed/citus_custom_scan.h"
 #include "distributed/citus_safe_lib.h"
+#include "distributed/citus_wait_events.h"
 #include "distributed/commands/multi_copy.h"
 #include "distributed/connection_management.h"
 #include "distributed/deparse_shard_query.h"
 #include "distributed/distributed_execution_locks.h"
+#include "distributed/executor_memory_budget.h"
 #include "distributed/executor_util.h"
+#include "distributed/hash_helpers.h"
 #include "distributed/intermediate_result_pruning.h"
 #include "distributed/listutils.h"
 #include "distributed/local_executor.h"
@@ -163,15 +169,23 @@
 #include "distributed/multi_partitioning_utils.h"
 #include "distributed/multi_physical_planner.h"
 #include "distributed/multi_server_executor.h"
+#include "distributed/node_latency_stats.h"
 #include "distributed/param_utils.h"
 #include "distributed/placement_access.h"
 #include "distributed/placement_connection.h"
+#include "distributed/query_result_cache.h"
 #include "distributed/relation_access_tracking.h"
+#include "distributed/remote_command_trace.h"
 #include "distributed/remote_commands.h"
+#include "distributed/remote_prepared_statements.h"
+#include "distributed/repartition_executor.h"
 #include "distributed/repartition_join_execution.h"
 #include "distributed/resource_lock.h"
+#include "distributed/router_proxy.h"
+#include "distributed/shard_column_statistics.h"
 #include "distributed/shared_connection_stats.h"
 #include "distributed/subplan_execution.h"
+#include "distributed/task_execution_trace.h"
 #include "distributed/transaction_identifier.h"
 #include "distributed/transaction_management.h"
 #include "distributed/tuple_destination.h"
@@ -180,6 +194,40 @@
 
 #define SLOW_START_DISABLED 0
 
+/* number of rows per result in chunked rows mode */
+#define TASK_RESULT_CHUNK_ROW_COUNT 1024
+
+/* number of rows after which a streaming execution returns them to the client */
+#define STREAMED_RESULT_BATCH_ROW_COUNT 1024
+
+/*
+ * Number of recent durations of hedgeable reads we keep to compute the delay
+ * after which we hedge, and how many we need before we start hedging.
+ */
+#define HEDGED_READ_SAMPLE_COUNT 100
+#define HEDGED_READ_MIN_SAMPLE_COUNT 10
+
+/*
+ * Rough estimate of the memory of the coordinator for executing a task, for
+ * the task state, the connection buffers and the current PGresult.
+ */
+#define TASK_EXECUTION_MEMORY_ESTIMATE (8 * 1024)
+
+/* command used to receive the rows of a task in binary COPY data messages */
+#define COPY_TASK_RESULT_COMMAND "COPY (%s) TO STDOUT WITH (FORMAT binary)"
+
+/* signature at the start of the binary COPY format */
+#define BINARY_COPY_SIGNATURE "PGCOPY\n\377\r\n\0"
+#define BINARY_COPY_SIGNATURE_LENGTH 11
+
+/* results that carry rows, depending on the row mode */
+#ifdef LIBPQ_HAS_CHUNK_MODE
+#define IsRowResultStatus(status) \
+	((status) == PGRES_SINGLE_TUPLE || (status) == PGRES_TUPLES_CHUNK)
+#else
+#define IsRowResultStatus(status) ((status) == PGRES_SINGLE_TUPLE)
+#endif
+
 
 /*
  * DistributedExecution represents the execution of a distributed query
@@ -202,6 +250,16 @@ typedef struct DistributedExecution
 	List *remoteTaskList;
 	List *localTaskList;
 
+	/*
+	 * Whether the local tasks run in between waiting for the remote tasks,
+	 * the number of tasks of localTaskList that ran so far, and the plan and
+	 * the parameters that they run with.
+	 */
+	bool interleaveLocalExecution;
+	int executedLocalTaskCount;
+	DistributedPlan *localExecutionPlan;
+	ParamListInfo localExecutionParamListInfo;
+
 	/*
 	 * If a task specific destination is not provided for a task, then use
 	 * defaultTupleDest.
@@ -289,6 +347,38 @@ typedef struct DistributedExecution
 	 */
 	uint64 rowsProcessed;
 
+	/*
+	 * The number of rows after which the remaining tasks do not need to finish,
+	 * since the combine query only uses that many rows, or 0 if all tasks need
+	 * to finish.
+	 */
+	uint64 rowLimit;
+
+	/*
+	 * Whether the execution returns to the combine query whenever tasks
+	 * finish, such that it consumes their rows while the other tasks are
+	 * still running, and whether it did so the last time it ran.
+	 */
+	bool combineIncrementally;
+	bool suspended;
+
+	/*
+	 * Whether the execution also returns to the combine query once it
+	 * received a batch of rows, such that they can be sent to the client
+	 * before the tasks finish.
+	 */
+	bool streamResults;
+
+	/*
+	 * The single read task of the execution that is also sent to another
+	 * placement if it did not respond hedgingDelay milliseconds after
+	 * hedgingStartTime, or NULL if we do not hedge. hedgingDelay is -1 when
+	 * there are not enough recent durations to decide on the delay.
+	 */
+	struct ShardCommandExecution *hedgeableShardCommandExecution;
+	long hedgingDelay;
+	instr_time hedgingStartTime;
+
 	/*
 	 * The following fields are used while receiving results from remote nodes.
 	 * We store this information here to avoid re-allocating it every time.
@@ -314,9 +404,55 @@ typedef struct DistributedExecution
 	 * fail, such as CREATE INDEX CONCURRENTLY.
 	 */
 	bool localExecutionSupported;
+
+	/*
+	 * Whether a task only starts once the tasks in its dependentTaskList that
+	 * are part of the execution finished, see SetUpTaskDependencies.
+	 */
+	bool respectTaskDependencies;
+
+	/*
+	 * The expected size of the results of the tasks that the execution keeps
+	 * in memory, and the memory that the execution reserved from
+	 * citus.max_executor_memory, if any.
+	 */
+	uint64 estimatedTupleStoreSize;
+	ExecutorMemoryReservation *memoryReservation;
+
+	/*
+	 * Whether the remote task executions are sampled into the task execution
+	 * traces, and the query ID to record in them.
+	 */
+	bool sampleTaskExecutionTraces;
+	uint64 queryId;
 } DistributedExecution;
 
 
+/*
+ * TaskDependencyKey identifies a task when resolving the dependencies of the
+ * tasks of an execution. Like in the DAG execution, tasks are identified by
+ * their job and task IDs rather than by pointer.
+ */
+typedef struct TaskDependencyKey
+{
+	uint64 jobId;
+	uint32 taskId;
+
+	/*
+	 * The padding field is needed to make sure the struct contains no
+	 * automatic padding, which is not allowed for hashmap keys.
+	 */
+	uint32 padding;
+} TaskDependencyKey;
+
+/* entry of the hash that maps tasks of an execution to their executions */
+typedef struct TaskDependencyHashEntry
+{
+	TaskDependencyKey key;
+	struct ShardCommandExecution *shardCommandExecution;
+} TaskDependencyHashEntry;
+
+
 /*
  * WorkerPoolFailureState indicates the current state of the
  * pool.
@@ -436,6 +572,16 @@ typedef struct WorkerPool
 	/* execution statistics per pool, in microseconds */
 	uint64 totalTaskExecutionTime;
 	int totalExecutedTasks;
+	uint64 totalConnectionEstablishmentTime;
+	int establishedConnectionCount;
+
+	/*
+	 * Latencies of the node in earlier executions, which we look up once the
+	 * pool needs connections, valid if hasNodeLatencies is set.
+	 */
+	bool nodeLatenciesChecked;
+	bool hasNodeLatencies;
+	NodeLatencies nodeLatencies;
 } WorkerPool;
 
 struct TaskPlacementExecution;
@@ -472,6 +618,12 @@ typedef struct WorkerSession
 	/* task the worker should work on or NULL */
 	struct TaskPlacementExecution *currentTask;
 
+	/*
+	 * Tasks that were sent in the same pipeline as currentTask and whose
+	 * results we read after the results of currentTask, in order.
+	 */
+	dlist_head pipelinedTaskQueue;
+
 	/*
 	 * The number of commands sent to the worker over the session. Excludes
 	 * distributed transaction related commands such as BEGIN/COMMIT etc.
@@ -502,6 +654,45 @@ int ExecutorSlowStartInterval = 10;
 bool EnableCostBasedConnectionEstablishment = true;
 bool PreventIncompleteConnectionEstablishment = true;
 
+/* GUC, number of tasks that can be sent over a connection before reading results */
+int ExecutorPipelineDepth = 1;
+
+/* GUC, whether the rows of SELECT tasks are received in batches */
+bool EnableBatchedTaskResults = false;
+
+/* GUC, whether to stop executing tasks once the LIMIT of the query is reached */
+bool EnableLimitEarlyTermination = false;
+
+/* GUC, whether the combine query consumes the task results as the tasks finish */
+bool EnableIncrementalCombine = false;
+
+/* GUC, whether the rows of simple SELECTs are returned as they arrive */
+bool EnableResultStreaming = false;
+
+/* GUC, whether local tasks run while waiting for the remote tasks */
+bool EnableInterleavedLocalExecution = false;
+
+/* GUC, whether idle pools take over the tasks that are queued in other pools */
+bool EnableTaskStealing = false;
+
+/*
+ * GUC, percentile of the recent durations of single-shard reads on replicated
+ * shards after which the read is also sent to another placement, or 0 to
+ * disable hedging.
+ */
+double HedgedReadPercentile = 0.0;
+
+/* recent durations of hedgeable reads in milliseconds, used as a ring buffer */
+static double HedgedReadDurations[HEDGED_READ_SAMPLE_COUNT];
+static int HedgedReadDurationCount = 0;
+static int NextHedgedReadDurationIndex = 0;
+
+/*
+ * Total time this backend spent waiting for events on the connections of
+ * distributed executions, in milliseconds. Used by citus_stat_statements.
+ */
+static double RemoteWaitTime = 0.0;
+
 
 /*
  * TaskExecutionState indicates whether or not a command on a shard
@@ -559,6 +750,22 @@ typedef struct ShardCommandExecution
 	 */
 	bool gotResults;
 
+	/*
+	 * For hedgeable reads, whether the task was also sent to another
+	 * placement, and the placement execution that responded first, whose
+	 * rows we use.
+	 */
+	bool hedged;
+	struct TaskPlacementExecution *resultPlacementExecution;
+
+	/*
+	 * When the execution respects task dependencies, the number of tasks that
+	 * need to finish before this one starts, and the executions of the tasks
+	 * that wait for this one.
+	 */
+	int unfinishedDependencyCount;
+	List *waitingShardCommandExecutions;
+
 	TaskExecutionState executionState;
 
 	/*
@@ -603,6 +810,12 @@ typedef struct TaskPlacementExecution
 	 */
 	uint32 queryIndex;
 
+	/* whether the rows of the query are received via binary COPY */
+	bool copyResults;
+
+	/* whether we received the header of the binary COPY data */
+	bool copyHeaderReceived;
+
 	/* worker pool on which the placement needs to be executed */
 	WorkerPool *workerPool;
 
@@ -621,12 +834,26 @@ typedef struct TaskPlacementExecution
 	/* membership in ready-to-start task queue of worker */
 	dlist_node workerReadyQueueNode;
 
+	/* membership in the queue of pipelined tasks of the assigned session */
+	dlist_node sessionPipelineQueueNode;
+
 	/* index in array of placement executions in a ShardCommandExecution */
 	int placementExecutionIndex;
 
 	/* execution time statistics for this placement execution */
 	instr_time startTime;
 	instr_time endTime;
+
+	/*
+	 * Timings and sizes of the remote execution for the task execution traces.
+	 * readyTime is when the placement execution could start, sendEndTime when
+	 * its first query was sent and firstResultTime when results arrived first.
+	 */
+	instr_time readyTime;
+	instr_time sendEndTime;
+	instr_time firstResultTime;
+	uint64 bytesReceived;
+	uint64 rowsReceived;
 } TaskPlacementExecution;
 
 
@@ -648,10 +875,45 @@ static TransactionProperties DecideTransactionPropertiesForTaskList(RowModifyLev
 																	exludeFromTransaction);
 static void StartDistributedExecution(DistributedExecution *execution);
 static void RunLocalExecution(CitusScanState *scanState, DistributedExecution *execution);
+static bool ShouldRunInterleavedLocalTask(DistributedExecution *execution);
+static void RunInterleavedLocalTask(DistributedExecution *execution);
 static void RunDistributedExecution(DistributedExecution *execution);
+static void ResumeDistributedExecution(DistributedExecution *execution);
+static void ProcessDistributedExecutionEvents(DistributedExecution *execution);
+static bool ShouldCombineTaskResultsIncrementally(CitusScanState *scanState,
+												  DistributedExecution *execution);
+static bool ShouldStreamTaskResults(CitusScanState *scanState);
+static bool IsHedgeableReadTask(DistributedExecution *execution,
+								ShardCommandExecution *shardCommandExecution);
+static long HedgedReadDelay(void);
+static void RecordHedgedReadDuration(DistributedExecution *execution);
+static void HedgeSlowReadTask(DistributedExecution *execution);
+static void CancelHedgedPlacementExecutions(DistributedExecution *execution);
+static void SetUpTaskDependencies(DistributedExecution *execution,
+								  List *shardCommandExecutionList);
+static void AddTaskDependencies(HTAB *taskDependencyHash,
+								ShardCommandExecution *shardCommandExecution,
+								List *dependentTaskList);
+static void ScheduleWaitingShardCommandExecutions(ShardCommandExecution *
+												  shardCommandExecution);
+static void ShardCommandExecutionReady(ShardCommandExecution *shardCommandExecution);
+static uint64 ExecutionMemoryUsage(DistributedExecution *execution,
+								   uint64 tupleStoreSize);
+static QueryResultCacheRequest * QueryResultCacheRequestForScan(CitusScanState *scanState,
+															   List *taskList,
+															   ParamListInfo
+															   paramListInfo);
+static bool HasActivePlacementExecution(ShardCommandExecution *shardCommandExecution);
+static int CompareDurations(const void *leftElement, const void *rightElement);
+static void CompleteAdaptiveExecutor(CitusScanState *scanState,
+									 DistributedExecution *execution,
+									 List *taskTupleStoreList);
 static void SequentialRunDistributedExecution(DistributedExecution *execution);
 static void FinishDistributedExecution(DistributedExecution *execution);
 static void CleanUpSessions(DistributedExecution *execution);
+static uint64 CombineQueryRowLimit(DistributedPlan *distributedPlan);
+static bool ExecutionReachedRowLimit(DistributedExecution *execution);
+static void CancelRemainingTasks(DistributedExecution *execution);
 
 static bool DistributedExecutionModifiesDatabase(DistributedExecution *execution);
 static void AssignTasksToConnectionsOrWorkerPool(DistributedExecution *execution);
@@ -670,12 +932,15 @@ static bool UsingExistingSessionsCheaperThanEstablishingNewConnections(int
 																	   workerPool);
 static double AvgTaskExecutionTimeApproximation(WorkerPool *workerPool);
 static double AvgConnectionEstablishmentTime(WorkerPool *workerPool);
+static void ApplyNodeLatencies(WorkerPool *workerPool);
+static void RecordWorkerPoolLatencies(DistributedExecution *execution);
 static void OpenNewConnections(WorkerPool *workerPool, int newConnectionCount,
 							   TransactionProperties *transactionProperties);
 static void CheckConnectionTimeout(WorkerPool *workerPool);
 static void MarkEstablishingSessionsTimedOut(WorkerPool *workerPool);
 static int UsableConnectionCount(WorkerPool *workerPool);
 static long NextEventTimeout(DistributedExecution *execution);
+static uint32 ExecutionWaitEvent(DistributedExecution *execution);
 static WaitEventSet * BuildWaitEventSet(List *sessionList);
 static void FreeExecutionWaitEvents(DistributedExecution *execution);
 static void AddSessionToWaitEventSet(WorkerSession *session,
@@ -684,10 +949,21 @@ static void RebuildWaitEventSetFlags(WaitEventSet *waitEventSet, List *sessionLi
 static TaskPlacementExecution * PopPlacementExecution(WorkerSession *session);
 static TaskPlacementExecution * PopAssignedPlacementExecution(WorkerSession *session);
 static TaskPlacementExecution * PopUnassignedPlacementExecution(WorkerPool *workerPool);
+static TaskPlacementExecution * StealPlacementExecution(WorkerPool *workerPool);
+static TaskPlacementExecution * ReadyUnassignedPlacementExecution(
+	ShardCommandExecution *shardCommandExecution);
 static bool StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 											 WorkerSession *session);
+static bool SendPlacementExecution(TaskPlacementExecution *placementExecution,
+								   WorkerSession *session);
+static bool CanPipelinePlacementExecution(TaskPlacementExecution *placementExecution);
+static TaskPlacementExecution * PopPipelinablePlacementExecution(WorkerSession *session);
+static bool StartNextPipelinedPlacementExecution(WorkerSession *session);
 static bool SendNextQuery(TaskPlacementExecution *placementExecution,
 						  WorkerSession *session);
+static bool CanReceiveTaskResultsViaCopy(TaskPlacementExecution *placementExecution,
+										 ParamListInfo paramListInfo);
+static int SetResultRowMode(PGconn *pgConn);
 static void ConnectionStateMachine(WorkerSession *session);
 static bool HasUnfinishedTaskForSession(WorkerSession *session);
 static void HandleMultiConnectionSuccess(WorkerSession *session);
@@ -698,10 +974,18 @@ static void TransactionStateMachine(WorkerSession *session);
 static void UpdateConnectionWaitFlags(WorkerSession *session, int waitFlags);
 static bool CheckConnectionReady(WorkerSession *session);
 static bool ReceiveResults(WorkerSession *session, bool storeRows);
+static bool ReceiveCopyResults(WorkerSession *session, bool storeRows,
+							   MemoryContext rowContext);
+static void StoreCopyDataRows(WorkerSession *session, char *copyData, int copyDataLength,
+							  MemoryContext rowContext);
+static void EnsureColumnArraySize(DistributedExecution *execution, uint32 columnCount);
 static void WorkerSessionFailed(WorkerSession *session);
 static void WorkerPoolFailed(WorkerPool *workerPool);
 static void PlacementExecutionDone(TaskPlacementExecution *placementExecution,
 								   bool succeeded);
+static void CountPlacementExecutionWaitTime(MultiConnection *connection,
+											TaskPlacementExecution *placementExecution);
+static void TracePlacementExecution(TaskPlacementExecution *placementExecution);
 static void ScheduleNextPlacementExecution(TaskPlacementExecution *placementExecution,
 										   bool succeeded);
 static bool CanFailoverPlacementExecutionToLocalExecution(TaskPlacementExecution *
@@ -761,7 +1045,7 @@ AdaptiveExecutorPreExecutorRun(CitusScanState *scanState)
 	 */
 	LockPartitionsForDistributedPlan(distributedPlan);
 
-	ExecuteSubPlans(distributedPlan);
+	scanState->subPlanPrunedTaskList = ExecuteSubPlansAndPruneTasks(distributedPlan);
 
 	scanState->finishedPreScan = true;
 }
@@ -791,12 +1075,45 @@ AdaptiveExecutor(CitusScanState *scanState)
 	/* we should only call this once before the scan finished */
 	Assert(!scanState->finishedRemoteScan);
 
+	/* the tasks of subplans may already have run along with other subplans */
+	Tuplestorestate *prefetchedResult =
+		TakePrefetchedSubPlanResult(distributedPlan->planId);
+	if (prefetchedResult != NULL)
+	{
+		scanState->tuplestorestate = prefetchedResult;
+
+		return resultSlot;
+	}
+
 	MemoryContext localContext = AllocSetContextCreate(CurrentMemoryContext,
 													   "AdaptiveExecutor",
 													   ALLOCSET_DEFAULT_SIZES);
 	MemoryContext oldContext = MemoryContextSwitchTo(localContext);
 
 
+	/*
+	 * Skip the tasks on shards that cannot match the results of the subplans,
+	 * except in EXPLAIN ANALYZE, which shows the tasks of the worker job.
+	 */
+	if (scanState->subPlanPrunedTaskList != NIL &&
+		!RequestedForExplainAnalyze(scanState))
+	{
+		taskList = scanState->subPlanPrunedTaskList;
+	}
+
+	/*
+	 * When the groups or window functions are evaluated on the workers, we
+	 * first repartition the results of the tasks and then execute the tasks
+	 * that evaluate them over each partition.
+	 */
+	if (distributedPlan->repartitionedAggregateQuery != NULL)
+	{
+		/* intermediate results require a distributed transaction */
+		UseCoordinatedTransaction();
+
+		taskList = RepartitionedAggregateTaskList(distributedPlan, taskList);
+	}
+
 	/* Reset Task fields that are only valid for a single execution */
 	ResetExplainAnalyzeData(taskList);
 
@@ -804,24 +1121,71 @@ AdaptiveExecutor(CitusScanState *scanState)
 		tuplestore_begin_heap(randomAccess, interTransactions, work_mem);
 
 	TupleDesc tupleDescriptor = ScanStateGetTupleDescriptor(scanState);
-	TupleDestination *defaultTupleDest =
-		CreateTupleStoreTupleDest(scanState->tuplestorestate, tupleDescriptor);
+	TupleDestination *defaultTupleDest = NULL;
+	List *taskTupleStoreList = NIL;
 
-	bool localExecutionSupported = true;
+	QueryResultCacheRequest *cacheRequest =
+		QueryResultCacheRequestForScan(scanState, taskList, paramListInfo);
+	if (cacheRequest != NULL &&
+		LookupQueryResultCache(cacheRequest, scanState->tuplestorestate,
+							   tupleDescriptor))
+	{
+		MemoryContextSwitchTo(oldContext);
 
-	if (RequestedForExplainAnalyze(scanState))
+		return resultSlot;
+	}
+
+	if (distributedPlan->mergeSortedTaskResults)
 	{
 		/*
-		 * We use multiple queries per task in EXPLAIN ANALYZE which need to
-		 * be part of the same transaction.
+		 * Keep the sorted results of the tasks apart, such that we can merge
+		 * them into the tuple store of the scan when the execution finished.
+		 * The tuple stores of the tasks share work_mem.
 		 */
-		UseCoordinatedTransaction();
+		int taskWorkMem = Max(work_mem / Max(list_length(taskList), 1), 64);
+
+		for (int taskIndex = 0; taskIndex < list_length(taskList); taskIndex++)
+		{
+			Tuplestorestate *taskTupleStore =
+				tuplestore_begin_heap(false, interTransactions, taskWorkMem);
+			taskTupleStoreList = lappend(taskTupleStoreList, taskTupleStore);
+		}
+
+		defaultTupleDest = CreateTaskTupleStoresTupleDest(taskList, taskTupleStoreList,
+														  tupleDescriptor);
+	}
+	else
+	{
+		defaultTupleDest =
+			CreateTupleStoreTupleDest(scanState->tuplestorestate, tupleDescriptor);
+	}
+
+	/* read-only router queries may use the connections of a router proxy */
+	if (ShouldExecuteViaRouterProxy(scanState, taskList, paramListInfo) &&
+		ExecuteTaskViaRouterProxy((Task *) linitial(taskList), defaultTupleDest,
+								  tupleDescriptor))
+	{
+		if (cacheRequest != NULL)
+		{
+			StoreQueryResultCache(cacheRequest, scanState->tuplestorestate,
+								  tupleDescriptor);
+		}
+
+		MemoryContextSwitchTo(oldContext);
+
+		return resultSlot;
+	}
+
+	bool localExecutionSupported = true;
+
+	if (RequestedForExplainAnalyze(scanState))
+	{
 		taskList = ExplainAnalyzeTaskList(taskList, defaultTupleDest, tupleDescriptor,
 										  paramListInfo);
 
 		/*
-		 * Multiple queries per task is not supported with local execution. See the Assert in
-		 * TupleDestDestReceiverReceive.
+		 * The EXPLAIN ANALYZE output is received along with the results of the
+		 * remote executions, the local executor does not produce it.
 		 */
 		localExecutionSupported = false;
 	}
@@ -868,6 +1232,25 @@ AdaptiveExecutor(CitusScanState *scanState)
 		jobIdList,
 		localExecutionSupported);
 
+	execution->sampleTaskExecutionTraces = ShouldSampleTaskExecutionTraces();
+	execution->queryId =
+		scanState->customScanState.ss.ps.state->es_plannedstmt->queryId;
+
+	/* the results of the tasks take the memory of at most work_mem */
+	Plan *plan = scanState->customScanState.ss.ps.plan;
+	execution->estimatedTupleStoreSize =
+		(uint64) Max(plan->plan_rows * plan->plan_width, 0.0);
+
+	/*
+	 * Closing the connections of the tasks that are still running is only
+	 * safe when they are not part of a remote transaction block.
+	 */
+	if (xactProperties.useRemoteTransactionBlocks != TRANSACTION_BLOCKS_REQUIRED &&
+		!RequestedForExplainAnalyze(scanState) && !hasDependentJobs)
+	{
+		execution->rowLimit = CombineQueryRowLimit(distributedPlan);
+	}
+
 	/*
 	 * Make sure that we acquire the appropriate locks even if the local tasks
 	 * are going to be executed with local execution.
@@ -880,27 +1263,55 @@ AdaptiveExecutor(CitusScanState *scanState)
 	}
 	else
 	{
+		/* results are only cached once the tuple store holds all of them */
+		execution->combineIncrementally =
+			cacheRequest == NULL &&
+			ShouldCombineTaskResultsIncrementally(scanState, execution);
+		execution->streamResults =
+			execution->combineIncrementally && ShouldStreamTaskResults(scanState);
+
+		/*
+		 * The combine query may consume the rows of suspended executions, so
+		 * we keep the rows of the local tasks for the end in that case.
+		 */
+		if (EnableInterleavedLocalExecution && !execution->combineIncrementally)
+		{
+			execution->interleaveLocalExecution = true;
+			execution->localExecutionPlan = distributedPlan;
+			execution->localExecutionParamListInfo = executorState->es_param_list_info;
+		}
+
+		if (execution->combineIncrementally)
+		{
+			/* the execution continues after we return */
+			TransactionProperties *executionXactProperties =
+				palloc(sizeof(TransactionProperties));
+			*executionXactProperties = xactProperties;
+			execution->transactionProperties = executionXactProperties;
+		}
+
 		RunDistributedExecution(execution);
-	}
 
-	/* execute tasks local to the node (if any) */
-	if (list_length(execution->localTaskList) > 0)
-	{
-		/* now execute the local tasks */
-		RunLocalExecution(scanState, execution);
-	}
+		if (execution->suspended)
+		{
+			/*
+			 * The combine query consumes the rows of the tasks that finished
+			 * and calls ContinueAdaptiveExecutor for the next ones.
+			 */
+			scanState->incrementalExecution = execution;
 
-	CmdType commandType = job->jobQuery->commandType;
-	if (commandType != CMD_SELECT)
-	{
-		executorState->es_processed = execution->rowsProcessed;
+			MemoryContextSwitchTo(oldContext);
+
+			return resultSlot;
+		}
 	}
 
-	FinishDistributedExecution(execution);
+	CompleteAdaptiveExecutor(scanState, execution, taskTupleStoreList);
 
-	if (SortReturning && distributedPlan->expectResults && commandType != CMD_SELECT)
+	if (cacheRequest != NULL)
 	{
-		SortTupleStore(scanState);
+		StoreQueryResultCache(cacheRequest, scanState->tuplestorestate,
+							  tupleDescriptor);
 	}
 
 	MemoryContextSwitchTo(oldContext);
@@ -910,115 +1321,415 @@ AdaptiveExecutor(CitusScanState *scanState)
 
 
 /*
- * RunLocalExecution runs the localTaskList in the execution, fills the tuplestore
- * and sets the es_processed if necessary.
- *
- * It also sorts the tuplestore if there are no remote tasks remaining.
+ * QueryResultCacheRequestForScan returns the request for caching the result
+ * of the scan, or NULL if it cannot be cached. We only cache the results of
+ * single read-only tasks on reference tables whose query does not depend on
+ * anything other than the tables and the parameters.
  */
-static void
-RunLocalExecution(CitusScanState *scanState, DistributedExecution *execution)
+static QueryResultCacheRequest *
+QueryResultCacheRequestForScan(CitusScanState *scanState, List *taskList,
+							   ParamListInfo paramListInfo)
 {
-	EState *estate = ScanStateGetExecutorState(scanState);
-	bool isUtilityCommand = false;
-	uint64 rowsProcessed = ExecuteLocalTaskListExtended(execution->localTaskList,
-														estate->es_param_list_info,
-														scanState->distributedPlan,
-														execution->defaultTupleDest,
-														isUtilityCommand);
+	DistributedPlan *distributedPlan = scanState->distributedPlan;
+	Job *job = distributedPlan->workerJob;
 
-	execution->rowsProcessed += rowsProcessed;
-}
+	if (!EnableQueryResultCache)
+	{
+		return NULL;
+	}
 
+	if (distributedPlan->modLevel != ROW_MODIFY_READONLY ||
+		list_length(taskList) != 1 ||
+		((Task *) linitial(taskList))->taskType != READ_TASK ||
+		distributedPlan->subPlanList != NIL ||
+		distributedPlan->repartitionedAggregateQuery != NULL ||
+		distributedPlan->mergeSortedTaskResults ||
+		job->dependentJobList != NIL ||
+		RequestedForExplainAnalyze(scanState))
+	{
+		return NULL;
+	}
 
-/*
- * ExecuteUtilityTaskList is a wrapper around executing task
- * list for utility commands.
- */
-uint64
-ExecuteUtilityTaskList(List *utilityTaskList, bool localExecutionSupported)
-{
-	RowModifyLevel modLevel = ROW_MODIFY_NONE;
-	ExecutionParams *executionParams = CreateBasicExecutionParams(
-		modLevel, utilityTaskList, MaxAdaptiveExecutorPoolSize, localExecutionSupported
-		);
-	executionParams->xactProperties =
-		DecideTransactionPropertiesForTaskList(modLevel, utilityTaskList, false);
-	executionParams->isUtilityCommand = true;
+	/* the results of functions such as now() or random() change */
+	if (job->jobQuery == NULL || contain_mutable_functions((Node *) job->jobQuery))
+	{
+		return NULL;
+	}
 
-	return ExecuteTaskListExtended(executionParams);
+	return CreateQueryResultCacheRequest((Task *) linitial(taskList), paramListInfo);
 }
 
 
 /*
- * ExecuteUtilityTaskListExtended is a wrapper around executing task
- * list for utility commands.
+ * ContinueAdaptiveExecutor is called via CitusExecScan once the combine query
+ * consumed the rows of the tasks that finished so far in an execution that
+ * combines the task results incrementally. It discards those rows and fills
+ * the tuple store with the rows of the tasks that finish next, or completes
+ * the execution when all the tasks finished.
  */
-uint64
-ExecuteUtilityTaskListExtended(List *utilityTaskList, int poolSize,
-							   bool localExecutionSupported)
+void
+ContinueAdaptiveExecutor(CitusScanState *scanState)
 {
-	RowModifyLevel modLevel = ROW_MODIFY_NONE;
-	ExecutionParams *executionParams = CreateBasicExecutionParams(
-		modLevel, utilityTaskList, poolSize, localExecutionSupported
-		);
+	DistributedExecution *execution = scanState->incrementalExecution;
 
-	bool excludeFromXact = false;
-	executionParams->xactProperties =
-		DecideTransactionPropertiesForTaskList(modLevel, utilityTaskList,
-											   excludeFromXact);
-	executionParams->isUtilityCommand = true;
+	Assert(execution != NULL && execution->suspended);
 
-	return ExecuteTaskListExtended(executionParams);
-}
+	MemoryContext oldContext =
+		MemoryContextSwitchTo(GetMemoryChunkContext(execution));
 
+	tuplestore_clear(scanState->tuplestorestate);
+	scanState->discardedTaskResults = true;
 
-/*
- * ExecuteTaskList is a proxy to ExecuteTaskListExtended
- * with defaults for some of the arguments.
- */
-uint64
-ExecuteTaskList(RowModifyLevel modLevel, List *taskList)
-{
-	bool localExecutionSupported = true;
-	ExecutionParams *executionParams = CreateBasicExecutionParams(
-		modLevel, taskList, MaxAdaptiveExecutorPoolSize, localExecutionSupported
-		);
+	ResumeDistributedExecution(execution);
 
-	bool excludeFromXact = false;
-	executionParams->xactProperties = DecideTransactionPropertiesForTaskList(
-		modLevel, taskList, excludeFromXact);
+	if (!execution->suspended)
+	{
+		scanState->incrementalExecution = NULL;
 
-	return ExecuteTaskListExtended(executionParams);
+		CompleteAdaptiveExecutor(scanState, execution, NIL);
+	}
+
+	MemoryContextSwitchTo(oldContext);
 }
 
 
 /*
- * ExecuteTaskListOutsideTransaction is a proxy to ExecuteTaskListExtended
- * with defaults for some of the arguments.
+ * StopAdaptiveExecutor is called via CitusEndScan when the scan ends before
+ * the combine query consumed the rows of all the tasks of an execution that
+ * combines the task results incrementally, e.g. when the client closes a
+ * portal early. It cancels the tasks that are still running and finishes
+ * the execution.
  */
-uint64
-ExecuteTaskListOutsideTransaction(RowModifyLevel modLevel, List *taskList,
-								  int targetPoolSize, List *jobIdList)
+void
+StopAdaptiveExecutor(CitusScanState *scanState)
 {
-	/*
-	 * As we are going to run the tasks outside transaction, we shouldn't use local execution.
-	 * However, there is some problem when using local execution related to
-	 * repartition joins, when we solve that problem, we can execute the tasks
-	 * coming to this path with local execution. See PR:3711
-	 */
-	bool localExecutionSupported = false;
-	ExecutionParams *executionParams = CreateBasicExecutionParams(
-		modLevel, taskList, targetPoolSize, localExecutionSupported
-		);
+	DistributedExecution *execution = scanState->incrementalExecution;
 
-	executionParams->xactProperties = DecideTransactionPropertiesForTaskList(
-		modLevel, taskList, true);
-	return ExecuteTaskListExtended(executionParams);
+	Assert(execution != NULL && execution->suspended);
+
+	MemoryContext oldContext =
+		MemoryContextSwitchTo(GetMemoryChunkContext(execution));
+
+	scanState->incrementalExecution = NULL;
+
+	CancelRemainingTasks(execution);
+	CleanUpSessions(execution);
+	FinishDistributedExecution(execution);
+
+	MemoryContextSwitchTo(oldContext);
 }
 
 
 /*
- * CreateDefaultExecutionParams returns execution params based on given (possibly null)
+ * CompleteAdaptiveExecutor runs the local tasks once the remote tasks of the
+ * execution finished and finalizes the results in the tuple store.
+ */
+static void
+CompleteAdaptiveExecutor(CitusScanState *scanState, DistributedExecution *execution,
+						 List *taskTupleStoreList)
+{
+	DistributedPlan *distributedPlan = scanState->distributedPlan;
+	EState *executorState = ScanStateGetExecutorState(scanState);
+
+	/* execute tasks local to the node (if any) */
+	if (list_length(execution->localTaskList) > 0)
+	{
+		/* now execute the local tasks */
+		RunLocalExecution(scanState, execution);
+	}
+
+	CmdType commandType = distributedPlan->workerJob->jobQuery->commandType;
+	if (commandType != CMD_SELECT)
+	{
+		executorState->es_processed = execution->rowsProcessed;
+	}
+
+	FinishDistributedExecution(execution);
+
+	if (distributedPlan->mergeSortedTaskResults)
+	{
+		MergeSortedTaskResults(scanState, taskTupleStoreList);
+	}
+
+	if (SortReturning && distributedPlan->expectResults && commandType != CMD_SELECT)
+	{
+		SortTupleStore(scanState);
+	}
+}
+
+
+/*
+ * ShouldCombineTaskResultsIncrementally returns whether the combine query can
+ * consume the rows of the tasks as they finish, rather than once all the
+ * tasks finished. The node above the scan needs to read all the rows at once,
+ * since the rows it has read are discarded.
+ */
+static bool
+ShouldCombineTaskResultsIncrementally(CitusScanState *scanState,
+									  DistributedExecution *execution)
+{
+	DistributedPlan *distributedPlan = scanState->distributedPlan;
+	bool streamResults = ShouldStreamTaskResults(scanState);
+
+	if (!streamResults &&
+		(!EnableIncrementalCombine || !distributedPlan->incrementalCombineSupported))
+	{
+		return false;
+	}
+
+	if (distributedPlan->modLevel != ROW_MODIFY_READONLY ||
+		distributedPlan->mergeSortedTaskResults ||
+		distributedPlan->workerJob->dependentJobList != NIL ||
+		RequestedForExplainAnalyze(scanState))
+	{
+		return false;
+	}
+
+	/*
+	 * The connections stay claimed by the execution while the combine query
+	 * runs. If the combine query fails, only aborting the whole transaction
+	 * cleans them up, whereas ROLLBACK TO SAVEPOINT would find them busy.
+	 */
+	if (execution->transactionProperties->useRemoteTransactionBlocks ==
+		TRANSACTION_BLOCKS_REQUIRED ||
+		IsMultiStatementTransaction() ||
+		GetCurrentTransactionNestLevel() > 1)
+	{
+		return false;
+	}
+
+	/*
+	 * With a single remote task there is nothing to interleave, unless we
+	 * return its rows while they arrive.
+	 */
+	if (streamResults)
+	{
+		return list_length(execution->remoteTaskList) > 0;
+	}
+
+	return list_length(execution->remoteTaskList) > 1;
+}
+
+
+/*
+ * ShouldStreamTaskResults returns whether the rows of the tasks can be
+ * returned as they arrive, rather than once the tasks finished. That is the
+ * case when the scan is the top node of a plan that only scans forward in a
+ * top-level statement, such that the rows we return go straight to the
+ * client and are never read again.
+ */
+static bool
+ShouldStreamTaskResults(CitusScanState *scanState)
+{
+	if (!EnableResultStreaming)
+	{
+		return false;
+	}
+
+	EState *executorState = ScanStateGetExecutorState(scanState);
+	Plan *scanPlan = scanState->customScanState.ss.ps.plan;
+
+	if (executorState->es_plannedstmt == NULL ||
+		executorState->es_plannedstmt->planTree != scanPlan)
+	{
+		/* the combine query does more than returning the rows */
+		return false;
+	}
+
+	if (executorState->es_top_eflags &
+		(EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK | EXEC_FLAG_REWIND))
+	{
+		/* the rows that we return are discarded, so we cannot read them again */
+		return false;
+	}
+
+	/*
+	 * In a function, other queries could run in between fetching the rows,
+	 * while the connections are still claimed by the execution.
+	 */
+	if (MaybeExecutingUDF())
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * RunLocalExecution runs the tasks in localTaskList that did not run in between
+ * the remote tasks, fills the tuplestore and sets the es_processed if
+ * necessary.
+ *
+ * It also sorts the tuplestore if there are no remote tasks remaining.
+ */
+static void
+RunLocalExecution(CitusScanState *scanState, DistributedExecution *execution)
+{
+	EState *estate = ScanStateGetExecutorState(scanState);
+	bool isUtilityCommand = false;
+	List *remainingLocalTaskList =
+		list_copy_tail(execution->localTaskList, execution->executedLocalTaskCount);
+	uint64 rowsProcessed = ExecuteLocalTaskListExtended(remainingLocalTaskList,
+														estate->es_param_list_info,
+														scanState->distributedPlan,
+														execution->defaultTupleDest,
+														isUtilityCommand);
+
+	execution->rowsProcessed += rowsProcessed;
+}
+
+
+/*
+ * ShouldRunInterleavedLocalTask returns whether the execution should run one of
+ * its local tasks in between waiting for the remote tasks. We only do so once
+ * the connections are established, since establishing them does not progress
+ * while a local task runs, whereas the workers keep executing the tasks that
+ * were sent to them.
+ */
+static bool
+ShouldRunInterleavedLocalTask(DistributedExecution *execution)
+{
+	return execution->interleaveLocalExecution &&
+		   execution->executedLocalTaskCount < list_length(execution->localTaskList) &&
+		   !HasIncompleteConnectionEstablishment(execution);
+}
+
+
+/*
+ * RunInterleavedLocalTask runs the next local task of the execution that did
+ * not run yet.
+ */
+static void
+RunInterleavedLocalTask(DistributedExecution *execution)
+{
+	Task *task = list_nth(execution->localTaskList, execution->executedLocalTaskCount);
+	bool isUtilityCommand = false;
+
+	execution->executedLocalTaskCount++;
+
+	execution->rowsProcessed +=
+		ExecuteLocalTaskListExtended(list_make1(task),
+									 execution->localExecutionParamListInfo,
+									 execution->localExecutionPlan,
+									 execution->defaultTupleDest,
+									 isUtilityCommand);
+}
+
+
+/*
+ * ExecuteUtilityTaskList is a wrapper around executing task
+ * list for utility commands.
+ */
+uint64
+ExecuteUtilityTaskList(List *utilityTaskList, bool localExecutionSupported)
+{
+	RowModifyLevel modLevel = ROW_MODIFY_NONE;
+	ExecutionParams *executionParams = CreateBasicExecutionParams(
+		modLevel, utilityTaskList, MaxAdaptiveExecutorPoolSize, localExecutionSupported
+		);
+	executionParams->xactProperties =
+		DecideTransactionPropertiesForTaskList(modLevel, utilityTaskList, false);
+	executionParams->isUtilityCommand = true;
+
+	return ExecuteTaskListExtended(executionParams);
+}
+
+
+/*
+ * ExecuteUtilityTaskListExtended is a wrapper around executing task
+ * list for utility commands.
+ */
+uint64
+ExecuteUtilityTaskListExtended(List *utilityTaskList, int poolSize,
+							   bool localExecutionSupported)
+{
+	RowModifyLevel modLevel = ROW_MODIFY_NONE;
+	ExecutionParams *executionParams = CreateBasicExecutionParams(
+		modLevel, utilityTaskList, poolSize, localExecutionSupported
+		);
+
+	bool excludeFromXact = false;
+	executionParams->xactProperties =
+		DecideTransactionPropertiesForTaskList(modLevel, utilityTaskList,
+											   excludeFromXact);
+	executionParams->isUtilityCommand = true;
+
+	return ExecuteTaskListExtended(executionParams);
+}
+
+
+/*
+ * ExecuteTaskList is a proxy to ExecuteTaskListExtended
+ * with defaults for some of the arguments.
+ */
+uint64
+ExecuteTaskList(RowModifyLevel modLevel, List *taskList)
+{
+	bool localExecutionSupported = true;
+	ExecutionParams *executionParams = CreateBasicExecutionParams(
+		modLevel, taskList, MaxAdaptiveExecutorPoolSize, localExecutionSupported
+		);
+
+	bool excludeFromXact = false;
+	executionParams->xactProperties = DecideTransactionPropertiesForTaskList(
+		modLevel, taskList, excludeFromXact);
+
+	return ExecuteTaskListExtended(executionParams);
+}
+
+
+/*
+ * ExecuteTaskListRespectingDependencies is a proxy to ExecuteTaskListExtended
+ * that executes the given tasks in a single execution, in which every task
+ * starts as soon as the tasks it depends on finished. Since local tasks are
+ * only executed after all remote tasks, none of the tasks may access the
+ * local node.
+ */
+uint64
+ExecuteTaskListRespectingDependencies(RowModifyLevel modLevel, List *taskList)
+{
+	bool localExecutionSupported = false;
+	ExecutionParams *executionParams = CreateBasicExecutionParams(
+		modLevel, taskList, MaxAdaptiveExecutorPoolSize, localExecutionSupported
+		);
+
+	bool excludeFromXact = false;
+	executionParams->xactProperties = DecideTransactionPropertiesForTaskList(
+		modLevel, taskList, excludeFromXact);
+	executionParams->respectTaskDependencies = true;
+
+	return ExecuteTaskListExtended(executionParams);
+}
+
+
+/*
+ * ExecuteTaskListOutsideTransaction is a proxy to ExecuteTaskListExtended
+ * with defaults for some of the arguments.
+ */
+uint64
+ExecuteTaskListOutsideTransaction(RowModifyLevel modLevel, List *taskList,
+								  int targetPoolSize, List *jobIdList)
+{
+	/*
+	 * As we are going to run the tasks outside transaction, we shouldn't use local execution.
+	 * However, there is some problem when using local execution related to
+	 * repartition joins, when we solve that problem, we can execute the tasks
+	 * coming to this path with local execution. See PR:3711
+	 */
+	bool localExecutionSupported = false;
+	ExecutionParams *executionParams = CreateBasicExecutionParams(
+		modLevel, taskList, targetPoolSize, localExecutionSupported
+		);
+
+	executionParams->xactProperties = DecideTransactionPropertiesForTaskList(
+		modLevel, taskList, true);
+	return ExecuteTaskListExtended(executionParams);
+}
+
+
+/*
+ * CreateDefaultExecutionParams returns execution params based on given (possibly null)
  * bind params (presumably from executor state) with defaults for some of the arguments.
  */
 static ExecutionParams *
@@ -1116,6 +1827,11 @@ ExecuteTaskListExtended(ExecutionParams *executionParams)
 	 */
 	EnsureCompatibleLocalExecutionState(execution->remoteTaskList);
 
+	/* local tasks run after the remote ones, so none of them can be waited for */
+	Assert(!executionParams->respectTaskDependencies ||
+		   execution->localTaskList == NIL);
+	execution->respectTaskDependencies = executionParams->respectTaskDependencies;
+
 	/* run the remote execution */
 	StartDistributedExecution(execution);
 	RunDistributedExecution(execution);
@@ -1176,6 +1892,12 @@ CreateDistributedExecution(RowModifyLevel modLevel, List *taskList,
 	DistributedExecution *execution =
 		(DistributedExecution *) palloc0(sizeof(DistributedExecution));
 
+	/* asynchronously replicated reference tables are only written to one placement */
+	if (modLevel > ROW_MODIFY_READONLY)
+	{
+		taskList = ExcludeAsyncReplicaPlacements(taskList);
+	}
+
 	execution->modLevel = modLevel;
 	execution->remoteAndLocalTaskList = taskList;
 	execution->transactionProperties = xactProperties;
@@ -1337,6 +2059,10 @@ StartDistributedExecution(DistributedExecution *execution)
 {
 	TransactionProperties *xactProperties = execution->transactionProperties;
 
+	/* wait until the coordinator has the memory for the execution */
+	execution->memoryReservation = ReserveExecutorMemory(
+		ExecutionMemoryUsage(execution, execution->estimatedTupleStoreSize));
+
 	if (xactProperties->useRemoteTransactionBlocks == TRANSACTION_BLOCKS_REQUIRED)
 	{
 		UseCoordinatedTransaction();
@@ -1361,6 +2087,19 @@ StartDistributedExecution(DistributedExecution *execution)
 	AcquireExecutorShardLocksForExecution(execution->modLevel,
 										  execution->remoteAndLocalTaskList);
 
+	/* the statistics of modified shards no longer cover all of their rows */
+	if (execution->modLevel > ROW_MODIFY_READONLY)
+	{
+		InvalidateShardColumnStatisticsForTaskList(execution->remoteAndLocalTaskList);
+	}
+
+	/* cached results of queries on the modified tables become invalid */
+	if (DistributedExecutionModifiesDatabase(execution))
+	{
+		QueryResultCacheRecordTaskListModifications(execution->remoteAndLocalTaskList);
+		InvalidateReusableSubPlanResultsForTaskList(execution->remoteAndLocalTaskList);
+	}
+
 	/*
 	 * We should not record parallel access if the target pool size is less than 2.
 	 * The reason is that we define parallel access as at least two connections
@@ -1414,26 +2153,72 @@ FinishDistributedExecution(DistributedExecution *execution)
 		/* prevent copying shards in same transaction */
 		XactModificationLevel = XACT_MODIFICATION_DATA;
 	}
+
+	if (EnableNodeLatencyFeedback)
+	{
+		RecordWorkerPoolLatencies(execution);
+	}
+
+	ReleaseExecutorMemory(execution->memoryReservation);
 }
 
 
 /*
- * AssignTasksToConnectionsOrWorkerPool goes through the list of tasks to determine whether any
- * task placements need to be assigned to particular connections because of preceding
- * operations in the transaction. It then adds those connections to the pool and adds
- * the task placement executions to the assigned task queue of the connection.
+ * ExecutionMemoryUsage returns the memory of the coordinator that the given
+ * execution uses when its tuple stores hold the given number of bytes. Since
+ * tuple stores spill to disk once they exceed work_mem, it counts at most
+ * work_mem for them.
  */
-static void
-AssignTasksToConnectionsOrWorkerPool(DistributedExecution *execution)
+static uint64
+ExecutionMemoryUsage(DistributedExecution *execution, uint64 tupleStoreSize)
 {
-	RowModifyLevel modLevel = execution->modLevel;
-	List *taskList = execution->remoteTaskList;
+	uint64 workMemBytes = (uint64) work_mem * 1024;
+	uint64 taskCount = list_length(execution->remoteAndLocalTaskList);
 
-	Task *task = NULL;
-	foreach_ptr(task, taskList)
-	{
-		bool placementExecutionReady = true;
-		int placementExecutionIndex = 0;
+	return taskCount * TASK_EXECUTION_MEMORY_ESTIMATE + Min(tupleStoreSize, workMemBytes);
+}
+
+
+/*
+ * RecordWorkerPoolLatencies adds the task execution and connection
+ * establishment times of the worker pools of the execution to the latencies
+ * of their nodes, such that later executions can open the right number of
+ * connections right away.
+ */
+static void
+RecordWorkerPoolLatencies(DistributedExecution *execution)
+{
+	WorkerPool *workerPool = NULL;
+	foreach_ptr(workerPool, execution->workerList)
+	{
+		RecordNodeLatencies(workerPool->nodeName, workerPool->nodePort,
+							workerPool->totalTaskExecutionTime,
+							workerPool->totalExecutedTasks,
+							workerPool->totalConnectionEstablishmentTime,
+							workerPool->establishedConnectionCount);
+	}
+}
+
+
+/*
+ * AssignTasksToConnectionsOrWorkerPool goes through the list of tasks to determine whether any
+ * task placements need to be assigned to particular connections because of preceding
+ * operations in the transaction. It then adds those connections to the pool and adds
+ * the task placement executions to the assigned task queue of the connection.
+ */
+static void
+AssignTasksToConnectionsOrWorkerPool(DistributedExecution *execution)
+{
+	RowModifyLevel modLevel = execution->modLevel;
+	List *taskList = execution->remoteTaskList;
+	List *shardCommandExecutionList = NIL;
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		/* with dependencies, tasks become ready in SetUpTaskDependencies */
+		bool placementExecutionReady = !execution->respectTaskDependencies;
+		int placementExecutionIndex = 0;
 		int placementExecutionCount = list_length(task->taskPlacementList);
 
 		/*
@@ -1480,6 +2265,7 @@ AssignTasksToConnectionsOrWorkerPool(DistributedExecution *execution)
 			if (placementExecutionReady)
 			{
 				placementExecution->executionState = PLACEMENT_EXECUTION_READY;
+				INSTR_TIME_SET_CURRENT(placementExecution->readyTime);
 			}
 			else
 			{
@@ -1575,6 +2361,22 @@ AssignTasksToConnectionsOrWorkerPool(DistributedExecution *execution)
 				placementExecutionReady = false;
 			}
 		}
+
+		if (IsHedgeableReadTask(execution, shardCommandExecution))
+		{
+			execution->hedgeableShardCommandExecution = shardCommandExecution;
+		}
+
+		if (execution->respectTaskDependencies)
+		{
+			shardCommandExecutionList = lappend(shardCommandExecutionList,
+												shardCommandExecution);
+		}
+	}
+
+	if (execution->respectTaskDependencies)
+	{
+		SetUpTaskDependencies(execution, shardCommandExecutionList);
 	}
 
 	/*
@@ -1792,6 +2594,7 @@ FindOrCreateWorkerSession(WorkerPool *workerPool, MultiConnection *connection)
 
 	dlist_init(&session->pendingTaskQueue);
 	dlist_init(&session->readyTaskQueue);
+	dlist_init(&session->pipelinedTaskQueue);
 
 	if (connection->connectionState == MULTI_CONNECTION_CONNECTED)
 	{
@@ -1885,6 +2688,12 @@ SequentialRunDistributedExecution(DistributedExecution *execution)
 			break;
 		}
 
+		if (ExecutionReachedRowLimit(execution))
+		{
+			/* the combine query does not need the rows of the remaining tasks */
+			break;
+		}
+
 		/* simply call the regular execution function */
 		RunDistributedExecution(execution);
 	}
@@ -1901,12 +2710,37 @@ SequentialRunDistributedExecution(DistributedExecution *execution)
  * that modified them. Then, it creates a wait event set to listen for events on
  * any of the connections and runs the connection state machine when a connection
  * has an event.
+ *
+ * When the task results are combined incrementally, the function returns once
+ * some of the tasks finished and sets execution->suspended.
  */
 void
 RunDistributedExecution(DistributedExecution *execution)
 {
 	AssignTasksToConnectionsOrWorkerPool(execution);
 
+	if (execution->hedgeableShardCommandExecution != NULL)
+	{
+		INSTR_TIME_SET_CURRENT(execution->hedgingStartTime);
+		execution->hedgingDelay = HedgedReadDelay();
+	}
+
+	ResumeDistributedExecution(execution);
+}
+
+
+/*
+ * ResumeDistributedExecution runs the connection state machines of an
+ * execution whose tasks are assigned until all the tasks are finished, or
+ * until some of the tasks finished if the task results are combined
+ * incrementally. In the latter case, execution->suspended is set and the
+ * function is called again to continue the execution.
+ */
+static void
+ResumeDistributedExecution(DistributedExecution *execution)
+{
+	execution->suspended = false;
+
 	PG_TRY();
 	{
 		/* Preemptively step state machines in case of immediate errors */
@@ -1916,87 +2750,15 @@ RunDistributedExecution(DistributedExecution *execution)
 			ConnectionStateMachine(session);
 		}
 
-		bool cancellationReceived = false;
+		ProcessDistributedExecutionEvents(execution);
 
-		/* always (re)build the wait event set the first time */
-		execution->rebuildWaitEventSet = true;
+		FreeExecutionWaitEvents(execution);
 
-		/*
-		 * Iterate until all the tasks are finished. Once all the tasks
-		 * are finished, ensure that all the connection initializations
-		 * are also finished. Otherwise, those connections are terminated
-		 * abruptly before they are established (or failed). Instead, we let
-		 * the ConnectionStateMachine() to properly handle them.
-		 *
-		 * Note that we could have the connections that are not established
-		 * as a side effect of slow-start algorithm. At the time the algorithm
-		 * decides to establish new connections, the execution might have tasks
-		 * to finish. But, the execution might finish before the new connections
-		 * are established.
-		 *
-		 * Note that the rules explained above could be overriden by any
-		 * cancellation to the query. In that case, we terminate the execution
-		 * irrespective of the current status of the tasks or the connections.
-		 */
-		while (!cancellationReceived &&
-			   (execution->unfinishedTaskCount > 0 ||
-				HasIncompleteConnectionEstablishment(execution)))
+		if (!execution->suspended)
 		{
-			WorkerPool *workerPool = NULL;
-			foreach_ptr(workerPool, execution->workerList)
-			{
-				ManageWorkerPool(workerPool);
-			}
-
-			bool skipWaitEvents = false;
-			if (execution->remoteTaskList == NIL)
-			{
-				/*
-				 * All the tasks are failed over to the local execution, no need
-				 * to wait for any connection activity.
-				 */
-				continue;
-			}
-			else if (execution->rebuildWaitEventSet)
-			{
-				RebuildWaitEventSet(execution);
-
-				skipWaitEvents =
-					ProcessSessionsWithFailedWaitEventSetOperations(execution);
-			}
-			else if (execution->waitFlagsChanged)
-			{
-				RebuildWaitEventSetFlags(execution->waitEventSet, execution->sessionList);
-				execution->waitFlagsChanged = false;
-
-				skipWaitEvents =
-					ProcessSessionsWithFailedWaitEventSetOperations(execution);
-			}
-
-			if (skipWaitEvents)
-			{
-				/*
-				 * Some operation on the wait event set is failed, retry
-				 * as we already removed the problematic connections.
-				 */
-				execution->rebuildWaitEventSet = true;
-
-				continue;
-			}
-
-			/* wait for I/O events */
-			long timeout = NextEventTimeout(execution);
-			int eventCount =
-				WaitEventSetWait(execution->waitEventSet, timeout, execution->events,
-								 execution->eventSetSize, WAIT_EVENT_CLIENT_READ);
-
-			ProcessWaitEvents(execution, execution->events, eventCount,
-							  &cancellationReceived);
+			CancelHedgedPlacementExecutions(execution);
+			CleanUpSessions(execution);
 		}
-
-		FreeExecutionWaitEvents(execution);
-
-		CleanUpSessions(execution);
 	}
 	PG_CATCH();
 	{
@@ -2014,6 +2776,161 @@ RunDistributedExecution(DistributedExecution *execution)
 }
 
 
+/*
+ * ProcessDistributedExecutionEvents waits for and processes the events on the
+ * connections of the execution until all the tasks are finished, or until a
+ * task finished if the task results are combined incrementally.
+ */
+static void
+ProcessDistributedExecutionEvents(DistributedExecution *execution)
+{
+	int initialUnfinishedTaskCount = execution->unfinishedTaskCount;
+	uint64 initialRowsProcessed = execution->rowsProcessed;
+	bool cancellationReceived = false;
+
+	/* always (re)build the wait event set the first time */
+	execution->rebuildWaitEventSet = true;
+
+	/*
+	 * Iterate until all the tasks are finished. Once all the tasks
+	 * are finished, ensure that all the connection initializations
+	 * are also finished. Otherwise, those connections are terminated
+	 * abruptly before they are established (or failed). Instead, we let
+	 * the ConnectionStateMachine() to properly handle them.
+	 *
+	 * Note that we could have the connections that are not established
+	 * as a side effect of slow-start algorithm. At the time the algorithm
+	 * decides to establish new connections, the execution might have tasks
+	 * to finish. But, the execution might finish before the new connections
+	 * are established.
+	 *
+	 * Note that the rules explained above could be overriden by any
+	 * cancellation to the query. In that case, we terminate the execution
+	 * irrespective of the current status of the tasks or the connections.
+	 */
+	while (!cancellationReceived &&
+		   (execution->unfinishedTaskCount > 0 ||
+			HasIncompleteConnectionEstablishment(execution)))
+	{
+		WorkerPool *workerPool = NULL;
+		foreach_ptr(workerPool, execution->workerList)
+		{
+			ManageWorkerPool(workerPool);
+		}
+
+		bool skipWaitEvents = false;
+		if (execution->remoteTaskList == NIL)
+		{
+			/*
+			 * All the tasks are failed over to the local execution, no need
+			 * to wait for any connection activity.
+			 */
+			continue;
+		}
+		else if (execution->rebuildWaitEventSet)
+		{
+			RebuildWaitEventSet(execution);
+
+			skipWaitEvents =
+				ProcessSessionsWithFailedWaitEventSetOperations(execution);
+		}
+		else if (execution->waitFlagsChanged)
+		{
+			RebuildWaitEventSetFlags(execution->waitEventSet, execution->sessionList);
+			execution->waitFlagsChanged = false;
+
+			skipWaitEvents =
+				ProcessSessionsWithFailedWaitEventSetOperations(execution);
+		}
+
+		if (skipWaitEvents)
+		{
+			/*
+			 * Some operation on the wait event set is failed, retry
+			 * as we already removed the problematic connections.
+			 */
+			execution->rebuildWaitEventSet = true;
+
+			continue;
+		}
+
+		/* wait for I/O events, or only poll if a local task can run instead */
+		bool runLocalTask = ShouldRunInterleavedLocalTask(execution);
+		long timeout = runLocalTask ? 0 : NextEventTimeout(execution);
+		instr_time waitStartTime;
+		instr_time waitEndTime;
+
+		INSTR_TIME_SET_CURRENT(waitStartTime);
+		int eventCount =
+			WaitEventSetWait(execution->waitEventSet, timeout, execution->events,
+							 execution->eventSetSize, ExecutionWaitEvent(execution));
+		INSTR_TIME_SET_CURRENT(waitEndTime);
+
+		INSTR_TIME_SUBTRACT(waitEndTime, waitStartTime);
+		RemoteWaitTime += INSTR_TIME_GET_MILLISEC(waitEndTime);
+
+		ProcessWaitEvents(execution, execution->events, eventCount,
+						  &cancellationReceived);
+
+		if (runLocalTask && eventCount == 0)
+		{
+			/* the remote tasks are busy on the workers, use the time */
+			RunInterleavedLocalTask(execution);
+		}
+
+		if (execution->memoryReservation != NULL &&
+			execution->defaultTupleDest != NULL &&
+			execution->defaultTupleDest->tupleDestinationStats != NULL)
+		{
+			/* account for results that are larger than estimated */
+			TupleDestinationStats *tupleDestinationStats =
+				execution->defaultTupleDest->tupleDestinationStats;
+
+			UpdateExecutorMemoryReservation(
+				execution->memoryReservation,
+				ExecutionMemoryUsage(execution,
+									 tupleDestinationStats->totalTupleStoreSize));
+		}
+
+		if (execution->hedgeableShardCommandExecution != NULL)
+		{
+			HedgeSlowReadTask(execution);
+		}
+
+		if (execution->unfinishedTaskCount > 0 &&
+			ExecutionReachedRowLimit(execution))
+		{
+			/* the combine query does not need the rows of the remaining tasks */
+			CancelRemainingTasks(execution);
+			break;
+		}
+
+		if (execution->combineIncrementally &&
+			execution->unfinishedTaskCount > 0 &&
+			execution->unfinishedTaskCount < initialUnfinishedTaskCount)
+		{
+			/* let the combine query consume the rows of the finished tasks */
+			execution->suspended = true;
+			break;
+		}
+
+		if (execution->streamResults &&
+			execution->unfinishedTaskCount > 0 &&
+			execution->rowsProcessed - initialRowsProcessed >=
+			STREAMED_RESULT_BATCH_ROW_COUNT)
+		{
+			/*
+			 * Return the rows to the client. We stop reading from the
+			 * connections until they are sent, which makes the workers
+			 * wait once the socket buffers are full.
+			 */
+			execution->suspended = true;
+			break;
+		}
+	}
+}
+
+
 /*
  * ProcessSessionsWithFailedWaitEventSetOperations goes over the session list
  * and processes sessions with failed wait event set operations.
@@ -2240,6 +3157,12 @@ ManageWorkerPool(WorkerPool *workerPool)
 		return;
 	}
 
+	if (EnableNodeLatencyFeedback && !workerPool->nodeLatenciesChecked &&
+		workerPool->readyTaskCount > 0)
+	{
+		ApplyNodeLatencies(workerPool);
+	}
+
 	/* we wait until a slow start interval has passed before expanding the pool */
 	if (ShouldWaitForSlowStart(workerPool))
 	{
@@ -2485,14 +3408,17 @@ CalculateNewConnectionCount(WorkerPool *workerPool)
  * new connections based on the current execution's stats.
  *
  * The function returns false if the current execution has not established any connections
- * or finished any tasks (e.g., no stats to act on).
+ * or finished any tasks (e.g., no stats to act on), unless we have the latencies
+ * of the node in earlier executions via citus.enable_node_latency_feedback.
  */
 static bool
 UsingExistingSessionsCheaperThanEstablishingNewConnections(int readyTaskCount,
 														   WorkerPool *workerPool)
 {
 	int activeConnectionCount = workerPool->activeConnectionCount;
-	if (workerPool->totalExecutedTasks < 1 || activeConnectionCount < 1)
+	bool hasExecutionStats = workerPool->totalExecutedTasks >= 1;
+	if ((!hasExecutionStats && !workerPool->hasNodeLatencies) ||
+		activeConnectionCount < 1)
 	{
 		/*
 		 * The pool has not finished any connection establishment or
@@ -2501,8 +3427,22 @@ UsingExistingSessionsCheaperThanEstablishingNewConnections(int readyTaskCount,
 		return false;
 	}
 
-	double avgTaskExecutionTime = AvgTaskExecutionTimeApproximation(workerPool);
-	double avgConnectionEstablishmentTime = AvgConnectionEstablishmentTime(workerPool);
+	double avgTaskExecutionTime = 0;
+	double avgConnectionEstablishmentTime = 0;
+
+	if (hasExecutionStats)
+	{
+		avgTaskExecutionTime = AvgTaskExecutionTimeApproximation(workerPool);
+		avgConnectionEstablishmentTime = AvgConnectionEstablishmentTime(workerPool);
+	}
+	else
+	{
+		/* before the first task finishes, rely on the latencies of earlier executions */
+		NodeLatencies *nodeLatencies = &workerPool->nodeLatencies;
+
+		avgTaskExecutionTime = nodeLatencies->taskExecutionTime;
+		avgConnectionEstablishmentTime = nodeLatencies->connectionEstablishmentTime;
+	}
 
 	/* we assume that we are halfway through the execution */
 	double remainingTimeForActiveTaskExecutionsToFinish = avgTaskExecutionTime / 2;
@@ -2614,6 +3554,54 @@ AvgConnectionEstablishmentTime(WorkerPool *workerPool)
 }
 
 
+/*
+ * ApplyNodeLatencies looks up the latencies of the node of the pool in earlier
+ * executions and, if there are any, lets the pool open as many connections at
+ * once as the ready tasks call for. Opening a connection pays off as long as
+ * the tasks that run over it take longer than establishing it, so we aim for
+ * each connection to run (connection time + task time) / task time tasks,
+ * instead of ramping up through the slow start.
+ */
+static void
+ApplyNodeLatencies(WorkerPool *workerPool)
+{
+	DistributedExecution *execution = workerPool->distributedExecution;
+
+	workerPool->nodeLatenciesChecked = true;
+	workerPool->hasNodeLatencies =
+		GetNodeLatencies(workerPool->nodeName, workerPool->nodePort,
+						 &workerPool->nodeLatencies);
+	if (!workerPool->hasNodeLatencies)
+	{
+		return;
+	}
+
+	double taskExecutionTime = workerPool->nodeLatencies.taskExecutionTime;
+	double connectionEstablishmentTime =
+		workerPool->nodeLatencies.connectionEstablishmentTime;
+	if (taskExecutionTime <= 0)
+	{
+		return;
+	}
+
+	double connectionCount = floor(workerPool->readyTaskCount * taskExecutionTime /
+								   (connectionEstablishmentTime + taskExecutionTime));
+	int targetConnectionCount = (int) Min(connectionCount,
+										  (double) execution->targetPoolSize);
+
+	if (targetConnectionCount > (int) workerPool->maxNewConnectionsPerCycle)
+	{
+		workerPool->maxNewConnectionsPerCycle = targetConnectionCount;
+	}
+
+	ereport(DEBUG4, (errmsg("opening up to %d connections at once to %s:%d based "
+							"on task time %.0f and connection time %.0f "
+							"microseconds", workerPool->maxNewConnectionsPerCycle,
+							workerPool->nodeName, workerPool->nodePort,
+							taskExecutionTime, connectionEstablishmentTime)));
+}
+
+
 /*
  * OpenNewConnections opens the given amount of connections for the given workerPool.
  */
@@ -2898,6 +3886,36 @@ UsableConnectionCount(WorkerPool *workerPool)
 }
 
 
+/*
+ * ExecutionWaitEvent returns the wait event to report while the execution
+ * waits for I/O. Sessions wait for connections to be established or for
+ * results at the same time, so we only report connection establishment when
+ * no session is running a task yet.
+ */
+static uint32
+ExecutionWaitEvent(DistributedExecution *execution)
+{
+	bool establishingConnection = false;
+
+	WorkerSession *session = NULL;
+	foreach_ptr(session, execution->sessionList)
+	{
+		if (session->currentTask != NULL)
+		{
+			return WAIT_EVENT_CITUS_REMOTE_RESULT;
+		}
+
+		if (session->connection->connectionState == MULTI_CONNECTION_CONNECTING)
+		{
+			establishingConnection = true;
+		}
+	}
+
+	return establishingConnection ? WAIT_EVENT_CITUS_CONNECTION_ESTABLISH :
+		   WAIT_EVENT_CITUS_REMOTE_RESULT;
+}
+
+
 /*
  * NextEventTimeout finds the earliest time at which we need to interrupt
  * WaitEventSetWait because of a timeout and returns the number of milliseconds
@@ -2964,6 +3982,24 @@ NextEventTimeout(DistributedExecution *execution)
 		}
 	}
 
+	ShardCommandExecution *hedgeableShardCommandExecution =
+		execution->hedgeableShardCommandExecution;
+	if (hedgeableShardCommandExecution != NULL &&
+		!hedgeableShardCommandExecution->hedged &&
+		hedgeableShardCommandExecution->resultPlacementExecution == NULL &&
+		execution->hedgingDelay >= 0)
+	{
+		/* wake up when the read should be hedged */
+		long timeUntilHedgingMs = execution->hedgingDelay -
+								  MillisecondsBetweenTimestamps(
+			execution->hedgingStartTime, now);
+
+		if (timeUntilHedgingMs < eventTimeout)
+		{
+			eventTimeout = timeUntilHedgingMs;
+		}
+	}
+
 	return Max(1, eventTimeout);
 }
 
@@ -2993,6 +4029,18 @@ MicrosecondsBetweenTimestamps(instr_time startTime, instr_time endTime)
 }
 
 
+/*
+ * GetRemoteWaitTime returns the total time in milliseconds that the backend
+ * spent waiting for remote nodes during distributed executions. Callers
+ * measure the wait time of a query by taking the difference between calls.
+ */
+double
+GetRemoteWaitTime(void)
+{
+	return RemoteWaitTime;
+}
+
+
 /*
  * ConnectionStateMachine opens a connection and descends into the transaction
  * state machine when ready.
@@ -3335,6 +4383,11 @@ HandleMultiConnectionSuccess(WorkerSession *session)
 	workerPool->activeConnectionCount++;
 	workerPool->idleConnectionCount++;
 	session->sessionHasActiveConnection = true;
+
+	workerPool->totalConnectionEstablishmentTime +=
+		MicrosecondsBetweenTimestamps(connection->connectionEstablishmentStart,
+									  connection->connectionEstablishmentEnd);
+	workerPool->establishedConnectionCount++;
 }
 
 
@@ -3487,6 +4540,25 @@ TransactionStateMachine(WorkerSession *session)
 				PGresult *result = PQgetResult(connection->pgConn);
 				if (result != NULL)
 				{
+					if (PQresultStatus(result) == PGRES_PIPELINE_SYNC)
+					{
+						/* all tasks in the pipeline finished */
+						PQclear(result);
+
+						if (PQexitPipelineMode(connection->pgConn) == 0)
+						{
+							connection->connectionState = MULTI_CONNECTION_LOST;
+							return;
+						}
+
+						/* wake up WaitEventSetWait */
+						UpdateConnectionWaitFlags(session,
+												  WL_SOCKET_READABLE |
+												  WL_SOCKET_WRITEABLE);
+
+						break;
+					}
+
 					if (!IsResponseOK(result))
 					{
 						/* query failures are always hard errors */
@@ -3516,6 +4588,7 @@ TransactionStateMachine(WorkerSession *session)
 					session->currentTask = NULL;
 
 					PlacementExecutionDone(placementExecution, succeeded);
+					CountPlacementExecutionWaitTime(connection, placementExecution);
 
 					/* connection is ready to use for executing commands */
 					workerPool->idleConnectionCount++;
@@ -3609,6 +4682,20 @@ TransactionStateMachine(WorkerSession *session)
 					 */
 					storeRows = false;
 				}
+				else if (shardCommandExecution ==
+						 execution->hedgeableShardCommandExecution)
+				{
+					if (shardCommandExecution->resultPlacementExecution == NULL &&
+						!PQisBusy(connection->pgConn))
+					{
+						/* the placement execution that responds first provides the rows */
+						shardCommandExecution->resultPlacementExecution =
+							placementExecution;
+					}
+
+					storeRows = shardCommandExecution->resultPlacementExecution ==
+								placementExecution;
+				}
 
 				bool fetchDone = ReceiveResults(session, storeRows);
 				if (!fetchDone)
@@ -3643,6 +4730,23 @@ TransactionStateMachine(WorkerSession *session)
 				}
 
 				shardCommandExecution->gotResults = true;
+
+				/* if more tasks were sent in the pipeline, read the next results */
+				if (!dlist_is_empty(&session->pipelinedTaskQueue))
+				{
+					bool nextTaskStarted = StartNextPipelinedPlacementExecution(session);
+					if (!nextTaskStarted)
+					{
+						/* no need to continue, connection is lost */
+						Assert(session->connection->connectionState ==
+							   MULTI_CONNECTION_LOST);
+
+						return;
+					}
+
+					break;
+				}
+
 				transaction->transactionState = REMOTE_TRANS_CLEARING_RESULTS;
 				break;
 			}
@@ -3776,6 +4880,12 @@ PopPlacementExecution(WorkerSession *session)
 
 		/* no more assigned tasks, pick an unassigned task */
 		placementExecution = PopUnassignedPlacementExecution(workerPool);
+
+		if (placementExecution == NULL && EnableTaskStealing)
+		{
+			/* take over a task that is still waiting in another pool */
+			placementExecution = StealPlacementExecution(workerPool);
+		}
 	}
 
 	return placementExecution;
@@ -3829,23 +4939,215 @@ PopUnassignedPlacementExecution(WorkerPool *workerPool)
 
 
 /*
- * StartPlacementExecutionOnSession gets a TaskPlacementExecution and
- * WorkerSession, the task's query is sent to the worker via the session.
- *
- * The function does some bookkeeping such as associating the placement
- * accesses with the connection and updating session's local variables. For
- * details read the comments in the function.
+ * StealPlacementExecution finds a task that can be executed on any placement,
+ * has a placement on the node of the given worker pool, and is waiting in
+ * the ready queue of another pool. The placement execution on the given pool
+ * takes the place of the waiting one, which becomes the next placement to
+ * try in case of failure. The function returns the placement execution that
+ * is now ready on the given pool, or NULL if there is no such task.
  *
- * The function returns true if the query is successfully sent over the
- * connection, otherwise false.
+ * This evens out the load when the tasks of reads on replicated shards or
+ * reference tables were assigned to a node that is slow, since the pools of
+ * the other nodes take over the tasks once they are idle. We start from the
+ * last task, since the other pool executes its tasks from the first one.
  */
-static bool
-StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
-								 WorkerSession *session)
+static TaskPlacementExecution *
+StealPlacementExecution(WorkerPool *workerPool)
 {
-	WorkerPool *workerPool = session->workerPool;
-	DistributedExecution *execution = workerPool->distributedExecution;
-	MultiConnection *connection = session->connection;
+	dlist_iter iter;
+
+	dlist_reverse_foreach(iter, &workerPool->pendingTaskQueue)
+	{
+		TaskPlacementExecution *placementExecution =
+			dlist_container(TaskPlacementExecution, workerPendingQueueNode, iter.cur);
+		ShardCommandExecution *shardCommandExecution =
+			placementExecution->shardCommandExecution;
+
+		if (shardCommandExecution->executionOrder != EXECUTION_ORDER_ANY ||
+			shardCommandExecution->executionState != TASK_EXECUTION_NOT_FINISHED ||
+			placementExecution->executionState != PLACEMENT_EXECUTION_NOT_READY)
+		{
+			continue;
+		}
+
+		/*
+		 * Tasks with their own tuple destination (i.e. EXPLAIN ANALYZE) refer
+		 * to the placement by the index of its execution, which we swap below.
+		 */
+		if (shardCommandExecution->task->tupleDest != NULL)
+		{
+			continue;
+		}
+
+		TaskPlacementExecution *waitingPlacementExecution =
+			ReadyUnassignedPlacementExecution(shardCommandExecution);
+		if (waitingPlacementExecution == NULL ||
+			waitingPlacementExecution->workerPool == workerPool)
+		{
+			continue;
+		}
+
+		WorkerPool *waitingWorkerPool = waitingPlacementExecution->workerPool;
+
+		/* move the waiting placement execution to the pending queue of its pool */
+		dlist_delete(&waitingPlacementExecution->workerReadyQueueNode);
+		waitingWorkerPool->readyTaskCount--;
+		dlist_push_tail(&waitingWorkerPool->pendingTaskQueue,
+						&waitingPlacementExecution->workerPendingQueueNode);
+		waitingPlacementExecution->executionState = PLACEMENT_EXECUTION_NOT_READY;
+
+		dlist_delete(&placementExecution->workerPendingQueueNode);
+		placementExecution->executionState = PLACEMENT_EXECUTION_READY;
+
+		/*
+		 * Swap the placement executions, such that we fail over to the waiting
+		 * one before the ones that come after it.
+		 */
+		int waitingIndex = waitingPlacementExecution->placementExecutionIndex;
+		int stolenIndex = placementExecution->placementExecutionIndex;
+
+		shardCommandExecution->placementExecutions[waitingIndex] = placementExecution;
+		placementExecution->placementExecutionIndex = waitingIndex;
+		shardCommandExecution->placementExecutions[stolenIndex] =
+			waitingPlacementExecution;
+		waitingPlacementExecution->placementExecutionIndex = stolenIndex;
+
+		ereport(DEBUG4, (errmsg("task %d is taken over by %s:%d from %s:%d",
+								shardCommandExecution->task->taskId,
+								workerPool->nodeName, workerPool->nodePort,
+								waitingWorkerPool->nodeName,
+								waitingWorkerPool->nodePort)));
+
+		return placementExecution;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * ReadyUnassignedPlacementExecution returns the placement execution of the
+ * given shard command execution that is waiting in the ready queue of its
+ * worker pool, or NULL if there is none.
+ */
+static TaskPlacementExecution *
+ReadyUnassignedPlacementExecution(ShardCommandExecution *shardCommandExecution)
+{
+	for (int placementExecutionIndex = 0;
+		 placementExecutionIndex < shardCommandExecution->placementExecutionCount;
+		 placementExecutionIndex++)
+	{
+		TaskPlacementExecution *placementExecution =
+			shardCommandExecution->placementExecutions[placementExecutionIndex];
+
+		if (placementExecution->executionState == PLACEMENT_EXECUTION_READY &&
+			placementExecution->assignedSession == NULL)
+		{
+			return placementExecution;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * StartPlacementExecutionOnSession gets a TaskPlacementExecution and
+ * WorkerSession, the task's query is sent to the worker via the session.
+ *
+ * When citus.executor_pipeline_depth allows, other tasks that are ready to
+ * run on the session are sent along in a libpq pipeline, such that the worker
+ * does not wait for a round trip between the tasks. Their results are read
+ * in order once the results of the given task are in.
+ *
+ * The function returns true if the queries are successfully sent over the
+ * connection, otherwise false.
+ */
+static bool
+StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
+								 WorkerSession *session)
+{
+	WorkerPool *workerPool = session->workerPool;
+	MultiConnection *connection = session->connection;
+
+	if (session->commandsSent == 0)
+	{
+		/* first time we send a command, consider the connection used (not unused) */
+		workerPool->unusedConnectionCount--;
+	}
+
+	/* connection is going to be in use */
+	workerPool->idleConnectionCount--;
+	session->currentTask = placementExecution;
+
+	if (CanPipelinePlacementExecution(placementExecution))
+	{
+		int pipelinedTaskCount = 1;
+
+		while (pipelinedTaskCount < ExecutorPipelineDepth)
+		{
+			TaskPlacementExecution *pipelinedPlacementExecution =
+				PopPipelinablePlacementExecution(session);
+			if (pipelinedPlacementExecution == NULL)
+			{
+				break;
+			}
+
+			dlist_push_tail(&session->pipelinedTaskQueue,
+							&pipelinedPlacementExecution->sessionPipelineQueueNode);
+			pipelinedTaskCount++;
+		}
+	}
+
+	/* only use a pipeline when there is more than one task to send */
+	bool pipelineTasks = !dlist_is_empty(&session->pipelinedTaskQueue);
+	if (pipelineTasks && PQenterPipelineMode(connection->pgConn) == 0)
+	{
+		connection->connectionState = MULTI_CONNECTION_LOST;
+		return false;
+	}
+
+	bool querySent = SendPlacementExecution(placementExecution, session);
+
+	dlist_iter iter;
+	dlist_foreach(iter, &session->pipelinedTaskQueue)
+	{
+		if (!querySent)
+		{
+			break;
+		}
+
+		TaskPlacementExecution *pipelinedPlacementExecution =
+			dlist_container(TaskPlacementExecution, sessionPipelineQueueNode, iter.cur);
+
+		querySent = SendPlacementExecution(pipelinedPlacementExecution, session);
+	}
+
+	if (querySent && pipelineTasks && PQpipelineSync(connection->pgConn) == 0)
+	{
+		connection->connectionState = MULTI_CONNECTION_LOST;
+		return false;
+	}
+
+	return querySent;
+}
+
+
+/*
+ * SendPlacementExecution sends the (first) query of the given placement
+ * execution over the session.
+ *
+ * The function does some bookkeeping such as associating the placement
+ * accesses with the connection and updating session's local variables. For
+ * details read the comments in the function.
+ */
+static bool
+SendPlacementExecution(TaskPlacementExecution *placementExecution,
+					   WorkerSession *session)
+{
+	WorkerPool *workerPool = session->workerPool;
+	DistributedExecution *execution = workerPool->distributedExecution;
+	MultiConnection *connection = session->connection;
 	ShardCommandExecution *shardCommandExecution =
 		placementExecution->shardCommandExecution;
 	Task *task = shardCommandExecution->task;
@@ -3862,15 +5164,6 @@ StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 		AssignPlacementListToConnection(placementAccessList, connection);
 	}
 
-	if (session->commandsSent == 0)
-	{
-		/* first time we send a command, consider the connection used (not unused) */
-		workerPool->unusedConnectionCount--;
-	}
-
-	/* connection is going to be in use */
-	workerPool->idleConnectionCount--;
-	session->currentTask = placementExecution;
 	placementExecution->executionState = PLACEMENT_EXECUTION_RUNNING;
 
 	Assert(INSTR_TIME_IS_ZERO(placementExecution->startTime));
@@ -3887,6 +5180,8 @@ StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 	bool querySent = SendNextQuery(placementExecution, session);
 	if (querySent)
 	{
+		INSTR_TIME_SET_CURRENT(placementExecution->sendEndTime);
+
 		session->commandsSent++;
 
 		if (workerPool->poolToLocalNode)
@@ -3905,6 +5200,116 @@ StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 }
 
 
+/*
+ * CanPipelinePlacementExecution returns whether the given placement execution
+ * can be sent in a pipeline along with other tasks.
+ *
+ * The pipeline uses the extended query protocol, which does not allow several
+ * statements in one query string. Hence, we only pipeline tasks that consist
+ * of a single SELECT.
+ */
+static bool
+CanPipelinePlacementExecution(TaskPlacementExecution *placementExecution)
+{
+	Task *task = placementExecution->shardCommandExecution->task;
+
+	if (ExecutorPipelineDepth <= 1 || UseConnectionPerPlacement())
+	{
+		return false;
+	}
+
+	return task->taskType == READ_TASK && task->queryCount == 1;
+}
+
+
+/*
+ * PopPipelinablePlacementExecution returns the next assigned or unassigned
+ * placement execution for the given session, in the same order as
+ * PopPlacementExecution, if it can be sent in a pipeline. Otherwise, it
+ * returns NULL and leaves the placement execution in its queue.
+ */
+static TaskPlacementExecution *
+PopPipelinablePlacementExecution(WorkerSession *session)
+{
+	WorkerPool *workerPool = session->workerPool;
+	dlist_head *sessionReadyTaskQueue = &(session->readyTaskQueue);
+	dlist_head *poolReadyTaskQueue = &(workerPool->readyTaskQueue);
+
+	if (!dlist_is_empty(sessionReadyTaskQueue))
+	{
+		TaskPlacementExecution *placementExecution =
+			dlist_container(TaskPlacementExecution, sessionReadyQueueNode,
+							dlist_head_node(sessionReadyTaskQueue));
+		if (!CanPipelinePlacementExecution(placementExecution))
+		{
+			return NULL;
+		}
+
+		return PopAssignedPlacementExecution(session);
+	}
+
+	if (!dlist_is_empty(poolReadyTaskQueue))
+	{
+		TaskPlacementExecution *placementExecution =
+			dlist_container(TaskPlacementExecution, workerReadyQueueNode,
+							dlist_head_node(poolReadyTaskQueue));
+		if (!CanPipelinePlacementExecution(placementExecution))
+		{
+			return NULL;
+		}
+
+		return PopUnassignedPlacementExecution(workerPool);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * StartNextPipelinedPlacementExecution finishes the current task of the
+ * session, whose results are all read, and makes the next task in the
+ * pipeline the current one.
+ *
+ * The function returns false if the connection is lost.
+ */
+static bool
+StartNextPipelinedPlacementExecution(WorkerSession *session)
+{
+	MultiConnection *connection = session->connection;
+	TaskPlacementExecution *finishedPlacementExecution = session->currentTask;
+	bool succeeded = true;
+
+	dlist_node *pipelinedTaskNode = dlist_pop_head_node(&session->pipelinedTaskQueue);
+	session->currentTask = dlist_container(TaskPlacementExecution,
+										   sessionPipelineQueueNode,
+										   pipelinedTaskNode);
+
+	/*
+	 * Once we finished a task on a connection, we no longer
+	 * allow that connection to fail.
+	 */
+	MarkRemoteTransactionCritical(connection);
+
+	PlacementExecutionDone(finishedPlacementExecution, succeeded);
+	CountPlacementExecutionWaitTime(connection, finishedPlacementExecution);
+
+	/*
+	 * In a pipeline, the row mode needs to be set for each query before
+	 * reading its results.
+	 */
+	if (SetResultRowMode(connection->pgConn) == 0)
+	{
+		connection->connectionState = MULTI_CONNECTION_LOST;
+		return false;
+	}
+
+	/* the results might already be buffered, wake up WaitEventSetWait */
+	UpdateConnectionWaitFlags(session, WL_SOCKET_READABLE | WL_SOCKET_WRITEABLE);
+
+	return true;
+}
+
+
 /*
  * SendNextQuery sends the next query for placementExecution on the given
  * session.
@@ -3923,11 +5328,23 @@ SendNextQuery(TaskPlacementExecution *placementExecution,
 	ParamListInfo paramListInfo = execution->paramListInfo;
 	int querySent = 0;
 	uint32 queryIndex = placementExecution->queryIndex;
+	bool pipelineMode = PQpipelineStatus(connection->pgConn) != PQ_PIPELINE_OFF;
 
 	Assert(queryIndex < task->queryCount);
 	char *queryString = TaskQueryStringAtIndex(task, queryIndex);
 
-	if (paramListInfo != NULL && !task->parametersInQueryStringResolved)
+	/* libpq does not allow COPY in a pipeline */
+	placementExecution->copyResults =
+		!pipelineMode && CanReceiveTaskResultsViaCopy(placementExecution, paramListInfo);
+	placementExecution->copyHeaderReceived = false;
+
+	if (placementExecution->copyResults)
+	{
+		char *copyCommand = psprintf(COPY_TASK_RESULT_COMMAND, queryString);
+
+		querySent = SendRemoteCommand(connection, copyCommand);
+	}
+	else if (paramListInfo != NULL && !task->parametersInQueryStringResolved)
 	{
 		int parameterCount = paramListInfo->numParams;
 		Oid *parameterTypes = NULL;
@@ -3938,9 +5355,20 @@ SendNextQuery(TaskPlacementExecution *placementExecution,
 
 		ExtractParametersForRemoteExecution(paramListInfo, &parameterTypes,
 											&parameterValues);
-		querySent = SendRemoteCommandParams(connection, queryString, parameterCount,
-											parameterTypes, parameterValues,
-											binaryResults);
+
+		if (pipelineMode)
+		{
+			/* preparing the statement would require a round trip in the pipeline */
+			querySent = SendRemoteCommandParams(connection, queryString,
+												parameterCount, parameterTypes,
+												parameterValues, binaryResults);
+		}
+		else
+		{
+			querySent = SendRemoteCommandParamsPrepared(connection, queryString,
+														parameterCount, parameterTypes,
+														parameterValues, binaryResults);
+		}
 	}
 	else
 	{
@@ -3955,8 +5383,11 @@ SendNextQuery(TaskPlacementExecution *placementExecution,
 		 * strange/incorrectly with select statements. In
 		 * isolation_select_vs_all.spec, when doing an s1-router-select in one
 		 * session blocked an s2-ddl-create-index-concurrently in another.
+		 *
+		 * In a pipeline, we always need SendRemoteCommandParams since libpq
+		 * only allows the extended query protocol there.
 		 */
-		if (!binaryResults)
+		if (!binaryResults && !pipelineMode)
 		{
 			querySent = SendRemoteCommand(connection, queryString);
 		}
@@ -3973,7 +5404,16 @@ SendNextQuery(TaskPlacementExecution *placementExecution,
 		return false;
 	}
 
-	int singleRowMode = PQsetSingleRowMode(connection->pgConn);
+	if (session->currentTask != placementExecution)
+	{
+		/*
+		 * The task is sent in a pipeline after the current task, we set
+		 * the row mode once we start reading its results.
+		 */
+		return true;
+	}
+
+	int singleRowMode = SetResultRowMode(connection->pgConn);
 	if (singleRowMode == 0)
 	{
 		connection->connectionState = MULTI_CONNECTION_LOST;
@@ -3984,6 +5424,68 @@ SendNextQuery(TaskPlacementExecution *placementExecution,
 }
 
 
+/*
+ * CanReceiveTaskResultsViaCopy returns whether the rows of the given placement
+ * execution should be received via binary COPY, which avoids creating a libpq
+ * result for every row in single-row mode.
+ *
+ * When libpq supports chunked rows mode, we use that instead, since it gives
+ * the same benefit without rewriting the query.
+ */
+static bool
+CanReceiveTaskResultsViaCopy(TaskPlacementExecution *placementExecution,
+							 ParamListInfo paramListInfo)
+{
+#ifdef LIBPQ_HAS_CHUNK_MODE
+	return false;
+#else
+	ShardCommandExecution *shardCommandExecution =
+		placementExecution->shardCommandExecution;
+	Task *task = shardCommandExecution->task;
+
+	if (!EnableBatchedTaskResults)
+	{
+		return false;
+	}
+
+	/* COPY does not accept parameters */
+	if (paramListInfo != NULL && !task->parametersInQueryStringResolved)
+	{
+		return false;
+	}
+
+	/* only wrap plain SELECTs of single-query tasks */
+	if (task->taskType != READ_TASK || task->queryCount != 1 ||
+		task->relationRowLockList != NIL)
+	{
+		return false;
+	}
+
+	/* binary COPY requires binary input functions for all the columns */
+	return shardCommandExecution->binaryResults;
+#endif
+}
+
+
+/*
+ * SetResultRowMode makes libpq return the rows of the query whose results are
+ * about to be read in chunks when citus.enable_batched_task_results is on and
+ * libpq supports it, and one row at a time otherwise. It returns 0 on failure.
+ */
+static int
+SetResultRowMode(PGconn *pgConn)
+{
+#ifdef LIBPQ_HAS_CHUNK_MODE
+	if (EnableBatchedTaskResults)
+	{
+		return PQsetChunkedRowsMode(pgConn, TASK_RESULT_CHUNK_ROW_COUNT);
+	}
+#endif
+
+	return PQsetSingleRowMode(pgConn);
+}
+
+
 /*
  * ReceiveResults reads the result of a command or query and writes returned
  * rows to the tuple store of the scan state. It returns whether fetching results
@@ -4020,9 +5522,16 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 		uint32 columnIndex = 0;
 		uint32 rowsProcessed = 0;
 
+		if (INSTR_TIME_IS_ZERO(placementExecution->firstResultTime))
+		{
+			INSTR_TIME_SET_CURRENT(placementExecution->firstResultTime);
+		}
+
 		PGresult *result = PQgetResult(connection->pgConn);
 		if (result == NULL)
 		{
+			FinishRemoteCommandTrace(connection);
+
 			/* no more results, break out of loop and free allocated memory */
 			fetchDone = true;
 			break;
@@ -4034,8 +5543,12 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 			char *currentAffectedTupleString = PQcmdTuples(result);
 			int64 currentAffectedTupleCount = 0;
 
-			/* if there are multiple replicas, make sure to consider only one */
-			if (storeRows && *currentAffectedTupleString != '\0')
+			/*
+			 * If there are multiple replicas, make sure to consider only one.
+			 * Rows received via COPY are already counted one by one.
+			 */
+			if (storeRows && !placementExecution->copyResults &&
+				*currentAffectedTupleString != '\0')
 			{
 				currentAffectedTupleCount = pg_strtoint64(currentAffectedTupleString);
 				Assert(currentAffectedTupleCount >= 0);
@@ -4061,8 +5574,30 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 			placementExecution->queryIndex++;
 			continue;
 		}
-		else if (resultStatus != PGRES_SINGLE_TUPLE)
+		else if (resultStatus == PGRES_COPY_OUT)
+		{
+			PQclear(result);
+
+			bool copyDone = ReceiveCopyResults(session, storeRows, rowContext);
+			if (!copyDone)
+			{
+				/* wait for more COPY data */
+				break;
+			}
+
+			/* the command result of the COPY follows */
+			continue;
+		}
+		else if (!IsRowResultStatus(resultStatus))
 		{
+			if (shardCommandExecution->resultPlacementExecution != NULL &&
+				shardCommandExecution->resultPlacementExecution != placementExecution)
+			{
+				/* we already use the rows of another placement of a hedged read */
+				PQclear(result);
+				continue;
+			}
+
 			/* query failures are always hard errors */
 			ReportResultError(connection, result, ERROR);
 		}
@@ -4093,38 +5628,16 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 		rowsProcessed = PQntuples(result);
 		uint32 columnCount = PQnfields(result);
 		uint32 expectedColumnCount = tupleDescriptor->natts;
-
-		if (columnCount != expectedColumnCount)
-		{
-			ereport(ERROR, (errmsg("unexpected number of columns from worker: %d, "
-								   "expected %d",
-								   columnCount, expectedColumnCount)));
-		}
-
-		if (columnCount > execution->allocatedColumnCount)
-		{
-			pfree(execution->columnArray);
-			int oldColumnCount = execution->allocatedColumnCount;
-			execution->allocatedColumnCount = columnCount;
-			execution->columnArray = palloc0(execution->allocatedColumnCount *
-											 sizeof(void *));
-			if (EnableBinaryProtocol)
-			{
-				/*
-				 * Using repalloc here, to not throw away any previously
-				 * created StringInfos.
-				 */
-				execution->stringInfoDataArray = repalloc(
-					execution->stringInfoDataArray,
-					execution->allocatedColumnCount *
-					sizeof(StringInfoData));
-				for (int i = oldColumnCount; i < columnCount; i++)
-				{
-					initStringInfo(&execution->stringInfoDataArray[i]);
-				}
-			}
+
+		if (columnCount != expectedColumnCount)
+		{
+			ereport(ERROR, (errmsg("unexpected number of columns from worker: %d, "
+								   "expected %d",
+								   columnCount, expectedColumnCount)));
 		}
 
+		EnsureColumnArraySize(execution, columnCount);
+
 		void **columnArray = execution->columnArray;
 		StringInfoData *stringInfoDataArray = execution->stringInfoDataArray;
 		bool binaryResults = shardCommandExecution->binaryResults;
@@ -4206,6 +5719,9 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 			MemoryContextReset(rowContext);
 
 			execution->rowsProcessed++;
+			placementExecution->rowsReceived++;
+			placementExecution->bytesReceived += tupleLibpqSize;
+			session->connection->counters.bytesReceived += tupleLibpqSize;
 		}
 
 		PQclear(result);
@@ -4218,6 +5734,191 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 }
 
 
+/*
+ * ReceiveCopyResults reads the binary COPY data of the current task of the
+ * session and writes the rows to its tuple destination. It returns true once
+ * all COPY data is received, and false if it needs to wait for more data.
+ */
+static bool
+ReceiveCopyResults(WorkerSession *session, bool storeRows, MemoryContext rowContext)
+{
+	MultiConnection *connection = session->connection;
+
+	while (true)
+	{
+		char *copyData = NULL;
+		int copyDataLength = PQgetCopyData(connection->pgConn, &copyData, true);
+		if (copyDataLength == 0)
+		{
+			/* no complete COPY data message is buffered yet */
+			return false;
+		}
+		else if (copyDataLength == -1)
+		{
+			/* COPY is done */
+			return true;
+		}
+		else if (copyDataLength == -2)
+		{
+			ReportConnectionError(connection, ERROR);
+		}
+
+		if (storeRows)
+		{
+			StoreCopyDataRows(session, copyData, copyDataLength, rowContext);
+		}
+
+		PQfreemem(copyData);
+	}
+}
+
+
+/*
+ * StoreCopyDataRows parses the rows in a binary COPY data message of the
+ * current task of the session and writes them to its tuple destination.
+ */
+static void
+StoreCopyDataRows(WorkerSession *session, char *copyData, int copyDataLength,
+				  MemoryContext rowContext)
+{
+	DistributedExecution *execution = session->workerPool->distributedExecution;
+	TaskPlacementExecution *placementExecution = session->currentTask;
+	ShardCommandExecution *shardCommandExecution =
+		placementExecution->shardCommandExecution;
+	Task *task = shardCommandExecution->task;
+	TupleDestination *tupleDest = task->tupleDest ?
+								  task->tupleDest :
+								  execution->defaultTupleDest;
+	uint32 queryIndex = placementExecution->queryIndex;
+	TupleDesc tupleDescriptor = tupleDest->tupleDescForQuery(tupleDest, queryIndex);
+	AttInMetadata *attInMetadata =
+		shardCommandExecution->attributeInputMetadata[queryIndex];
+	int expectedColumnCount = tupleDescriptor->natts;
+
+	StringInfoData copyDataMessage;
+	copyDataMessage.data = copyData;
+	copyDataMessage.len = copyDataLength;
+	copyDataMessage.maxlen = copyDataLength;
+	copyDataMessage.cursor = 0;
+
+	if (!placementExecution->copyHeaderReceived)
+	{
+		const char *signature = pq_getmsgbytes(&copyDataMessage,
+											   BINARY_COPY_SIGNATURE_LENGTH);
+		if (memcmp(signature, BINARY_COPY_SIGNATURE,
+				   BINARY_COPY_SIGNATURE_LENGTH) != 0)
+		{
+			ereport(ERROR, (errmsg("unexpected COPY data from worker")));
+		}
+
+		/* skip the flags field and the header extension */
+		pq_getmsgint(&copyDataMessage, 4);
+		int headerExtensionLength = pq_getmsgint(&copyDataMessage, 4);
+		pq_getmsgbytes(&copyDataMessage, headerExtensionLength);
+
+		placementExecution->copyHeaderReceived = true;
+	}
+
+	EnsureColumnArraySize(execution, expectedColumnCount);
+
+	void **columnArray = execution->columnArray;
+	StringInfoData *stringInfoDataArray = execution->stringInfoDataArray;
+
+	while (copyDataMessage.cursor < copyDataMessage.len)
+	{
+		int16 columnCount = (int16) pq_getmsgint(&copyDataMessage, 2);
+		if (columnCount == -1)
+		{
+			/* end of the COPY data */
+			break;
+		}
+
+		if (columnCount != expectedColumnCount)
+		{
+			ereport(ERROR, (errmsg("unexpected number of columns from worker: %d, "
+								   "expected %d",
+								   columnCount, expectedColumnCount)));
+		}
+
+		uint64 tupleLibpqSize = 0;
+
+		/* same as in ReceiveResults, protect against leaks while parsing a tuple */
+		MemoryContext oldContext = MemoryContextSwitchTo(rowContext);
+
+		for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+		{
+			int valueLength = pq_getmsgint(&copyDataMessage, 4);
+			if (valueLength == -1)
+			{
+				columnArray[columnIndex] = NULL;
+				continue;
+			}
+
+			const char *value = pq_getmsgbytes(&copyDataMessage, valueLength);
+
+			resetStringInfo(&stringInfoDataArray[columnIndex]);
+			appendBinaryStringInfo(&stringInfoDataArray[columnIndex], value,
+								   valueLength);
+			columnArray[columnIndex] = &stringInfoDataArray[columnIndex];
+
+			tupleLibpqSize += valueLength;
+		}
+
+		HeapTuple heapTuple = BuildTupleFromBytes(attInMetadata,
+												  (fmStringInfo *) columnArray);
+
+		MemoryContextSwitchTo(oldContext);
+
+		tupleDest->putTuple(tupleDest, task,
+							placementExecution->placementExecutionIndex, queryIndex,
+							heapTuple, tupleLibpqSize);
+
+		MemoryContextReset(rowContext);
+
+		execution->rowsProcessed++;
+		placementExecution->rowsReceived++;
+		placementExecution->bytesReceived += tupleLibpqSize;
+		session->connection->counters.bytesReceived += tupleLibpqSize;
+	}
+}
+
+
+/*
+ * EnsureColumnArraySize makes sure the column arrays of the execution that
+ * are used to build tuples from the received rows fit the given number of
+ * columns.
+ */
+static void
+EnsureColumnArraySize(DistributedExecution *execution, uint32 columnCount)
+{
+	if (columnCount <= execution->allocatedColumnCount)
+	{
+		return;
+	}
+
+	pfree(execution->columnArray);
+	int oldColumnCount = execution->allocatedColumnCount;
+	execution->allocatedColumnCount = columnCount;
+	execution->columnArray = palloc0(execution->allocatedColumnCount *
+									 sizeof(void *));
+	if (EnableBinaryProtocol)
+	{
+		/*
+		 * Using repalloc here, to not throw away any previously
+		 * created StringInfos.
+		 */
+		execution->stringInfoDataArray = repalloc(
+			execution->stringInfoDataArray,
+			execution->allocatedColumnCount *
+			sizeof(StringInfoData));
+		for (int i = oldColumnCount; i < columnCount; i++)
+		{
+			initStringInfo(&execution->stringInfoDataArray[i]);
+		}
+	}
+}
+
+
 /*
  * WorkerPoolFailed marks a worker pool and all the placement executions scheduled
  * on it as failed.
@@ -4317,6 +6018,14 @@ WorkerSessionFailed(WorkerSession *session)
 		PlacementExecutionDone(placementExecution, succeeded);
 	}
 
+	dlist_foreach(iter, &session->pipelinedTaskQueue)
+	{
+		placementExecution =
+			dlist_container(TaskPlacementExecution, sessionPipelineQueueNode, iter.cur);
+
+		PlacementExecutionDone(placementExecution, succeeded);
+	}
+
 	dlist_foreach(iter, &session->pendingTaskQueue)
 	{
 		placementExecution =
@@ -4335,6 +6044,28 @@ WorkerSessionFailed(WorkerSession *session)
 }
 
 
+/*
+ * CountPlacementExecutionWaitTime adds the time between sending the command
+ * of a finished placement execution and receiving its results to the wait
+ * time of the connection. The adaptive executor waits for all connections at
+ * once, so this is the closest to the time spent waiting on the connection.
+ */
+static void
+CountPlacementExecutionWaitTime(MultiConnection *connection,
+								TaskPlacementExecution *placementExecution)
+{
+	/* hedged and failed placement executions do not record their end */
+	if (INSTR_TIME_IS_ZERO(placementExecution->endTime))
+	{
+		return;
+	}
+
+	connection->counters.waitTime +=
+		MicrosecondsBetweenTimestamps(placementExecution->startTime,
+									  placementExecution->endTime);
+}
+
+
 /*
  * PlacementExecutionDone marks the given placement execution as done when
  * the results have been received or a failure occurred and sets the succeeded
@@ -4360,6 +6091,25 @@ PlacementExecutionDone(TaskPlacementExecution *placementExecution, bool succeede
 		return;
 	}
 
+	if (shardCommandExecution->hedged &&
+		shardCommandExecution->resultPlacementExecution != NULL &&
+		shardCommandExecution->resultPlacementExecution != placementExecution)
+	{
+		/*
+		 * Another placement execution of a hedged read responded first, the
+		 * task is done once that one is.
+		 */
+		placementExecution->executionState = PLACEMENT_EXECUTION_FAILED;
+		return;
+	}
+
+	if (!succeeded && shardCommandExecution->resultPlacementExecution ==
+		placementExecution)
+	{
+		/* use the rows of the placement execution that takes over */
+		shardCommandExecution->resultPlacementExecution = NULL;
+	}
+
 	if (succeeded)
 	{
 		/* mark the placement execution as finished */
@@ -4373,6 +6123,8 @@ PlacementExecutionDone(TaskPlacementExecution *placementExecution, bool succeede
 		workerPool->totalTaskExecutionTime += durationMicrosecs;
 		workerPool->totalExecutedTasks += 1;
 
+		TracePlacementExecution(placementExecution);
+
 		if (IsLoggableLevel(DEBUG4))
 		{
 			ereport(DEBUG4, (errmsg("task execution (%d) for placement (%ld) on anchor "
@@ -4427,6 +6179,17 @@ PlacementExecutionDone(TaskPlacementExecution *placementExecution, bool succeede
 	if (newExecutionState == TASK_EXECUTION_FINISHED)
 	{
 		execution->unfinishedTaskCount--;
+
+		if (shardCommandExecution == execution->hedgeableShardCommandExecution)
+		{
+			RecordHedgedReadDuration(execution);
+		}
+
+		if (execution->respectTaskDependencies)
+		{
+			ScheduleWaitingShardCommandExecutions(shardCommandExecution);
+		}
+
 		return;
 	}
 	else if (newExecutionState == TASK_EXECUTION_FAILOVER_TO_LOCAL_EXECUTION)
@@ -4463,12 +6226,85 @@ PlacementExecutionDone(TaskPlacementExecution *placementExecution, bool succeede
 		execution->failed = true;
 		return;
 	}
+	else if (shardCommandExecution->hedged &&
+			 HasActivePlacementExecution(shardCommandExecution))
+	{
+		/* the other placement execution of the hedged read may still succeed */
+	}
 	else if (!failedPlacementExecutionIsOnPendingQueue)
 	{
 		ScheduleNextPlacementExecution(placementExecution, succeeded);
 	}
 }
 
+/*
+ * TracePlacementExecution records the timings of a placement execution that
+ * finished successfully into the trace of its task when EXPLAIN ANALYZE asked
+ * for one, and into the shared task execution traces when the execution is
+ * sampled.
+ */
+static void
+TracePlacementExecution(TaskPlacementExecution *placementExecution)
+{
+	WorkerPool *workerPool = placementExecution->workerPool;
+	DistributedExecution *execution = workerPool->distributedExecution;
+	Task *task = placementExecution->shardCommandExecution->task;
+	TaskExecutionTrace trace;
+
+	if (task->executionTrace == NULL && !execution->sampleTaskExecutionTraces)
+	{
+		return;
+	}
+
+	instr_time readyTime = placementExecution->readyTime;
+	if (INSTR_TIME_IS_ZERO(readyTime))
+	{
+		readyTime = placementExecution->startTime;
+	}
+
+	instr_time firstResultTime = placementExecution->firstResultTime;
+	if (INSTR_TIME_IS_ZERO(firstResultTime))
+	{
+		firstResultTime = placementExecution->endTime;
+	}
+
+	uint64 totalMicrosecs = MicrosecondsBetweenTimestamps(readyTime,
+														  placementExecution->endTime);
+
+	memset(&trace, 0, sizeof(TaskExecutionTrace));
+	trace.valid = true;
+	trace.startTime = GetCurrentTimestamp() - (TimestampTz) totalMicrosecs;
+	trace.queryId = execution->queryId;
+	trace.taskId = task->taskId;
+	trace.anchorShardId = task->anchorShardId;
+	strlcpy(trace.nodeName, workerPool->nodeName, MAX_NODE_LENGTH);
+	trace.nodePort = workerPool->nodePort;
+	trace.connectionAcquireTime =
+		MicrosecondsBetweenTimestamps(readyTime, placementExecution->startTime) /
+		1000.0;
+	trace.sendTime =
+		MicrosecondsBetweenTimestamps(placementExecution->startTime,
+									  placementExecution->sendEndTime) / 1000.0;
+	trace.firstByteTime =
+		MicrosecondsBetweenTimestamps(placementExecution->startTime,
+									  firstResultTime) / 1000.0;
+	trace.receiveTime =
+		MicrosecondsBetweenTimestamps(firstResultTime,
+									  placementExecution->endTime) / 1000.0;
+	trace.bytesReceived = placementExecution->bytesReceived;
+	trace.rowsReceived = placementExecution->rowsReceived;
+
+	if (task->executionTrace != NULL)
+	{
+		*task->executionTrace = trace;
+	}
+
+	if (execution->sampleTaskExecutionTraces)
+	{
+		RecordTaskExecutionTrace(&trace);
+	}
+}
+
 
 /*
  * CanFailoverPlacementExecutionToLocalExecution returns true if the input
@@ -4531,52 +6367,193 @@ CanFailoverPlacementExecutionToLocalExecution(TaskPlacementExecution *placementE
 
 
 /*
- * ScheduleNextPlacementExecution is triggered if the query needs to be
- * executed on any or all placements in order and there is a placement on
- * which the execution has not happened yet. If so make that placement
- * ready-to-start by adding it to the appropriate queue.
+ * ScheduleNextPlacementExecution is triggered if the query needs to be
+ * executed on any or all placements in order and there is a placement on
+ * which the execution has not happened yet. If so make that placement
+ * ready-to-start by adding it to the appropriate queue.
+ */
+static void
+ScheduleNextPlacementExecution(TaskPlacementExecution *placementExecution, bool succeeded)
+{
+	ShardCommandExecution *shardCommandExecution =
+		placementExecution->shardCommandExecution;
+	PlacementExecutionOrder executionOrder = shardCommandExecution->executionOrder;
+
+	if ((executionOrder == EXECUTION_ORDER_ANY && !succeeded) ||
+		executionOrder == EXECUTION_ORDER_SEQUENTIAL)
+	{
+		TaskPlacementExecution *nextPlacementExecution = NULL;
+		int nextPlacementExecutionIndex = placementExecution->placementExecutionIndex;
+
+		/* find a placement execution that is not yet marked as failed */
+		do {
+			nextPlacementExecutionIndex++;
+
+			/*
+			 * If all tasks failed then we should already have errored out.
+			 * Still, be defensive and throw error instead of crashes.
+			 */
+			int placementExecutionCount = shardCommandExecution->placementExecutionCount;
+			if (nextPlacementExecutionIndex >= placementExecutionCount)
+			{
+				WorkerPool *workerPool = placementExecution->workerPool;
+				ereport(ERROR, (errmsg("execution cannot recover from multiple "
+									   "connection failures. Last node failed "
+									   "%s:%d", workerPool->nodeName,
+									   workerPool->nodePort)));
+			}
+
+			/* get the next placement in the planning order */
+			nextPlacementExecution =
+				shardCommandExecution->placementExecutions[nextPlacementExecutionIndex];
+
+			if (nextPlacementExecution->executionState == PLACEMENT_EXECUTION_NOT_READY)
+			{
+				/* move the placement execution to the ready queue */
+				PlacementExecutionReady(nextPlacementExecution);
+			}
+		} while (nextPlacementExecution->executionState == PLACEMENT_EXECUTION_FAILED);
+	}
+}
+
+
+/*
+ * SetUpTaskDependencies records which of the given executions of the tasks of
+ * the execution wait for which others, and makes the ones that do not wait
+ * for any task ready. The dependencies on tasks that are not part of the
+ * execution, such as merge tasks, which are not executed themselves, are
+ * replaced by the dependencies of those tasks. Any other task that a task
+ * depends on is expected to have finished before the execution.
+ */
+static void
+SetUpTaskDependencies(DistributedExecution *execution, List *shardCommandExecutionList)
+{
+	assert_valid_hash_key3(TaskDependencyKey, jobId, taskId, padding);
+	HTAB *taskDependencyHash = CreateSimpleHashWithNameAndSize(
+		TaskDependencyKey, TaskDependencyHashEntry, "TaskDependencyHash",
+		Max(list_length(shardCommandExecutionList), 1));
+
+	ShardCommandExecution *shardCommandExecution = NULL;
+	foreach_ptr(shardCommandExecution, shardCommandExecutionList)
+	{
+		Task *task = shardCommandExecution->task;
+		TaskDependencyKey taskKey = { task->jobId, task->taskId, 0 };
+		bool found = false;
+
+		TaskDependencyHashEntry *entry =
+			hash_search(taskDependencyHash, &taskKey, HASH_ENTER, &found);
+		entry->shardCommandExecution = shardCommandExecution;
+	}
+
+	foreach_ptr(shardCommandExecution, shardCommandExecutionList)
+	{
+		AddTaskDependencies(taskDependencyHash, shardCommandExecution,
+							shardCommandExecution->task->dependentTaskList);
+	}
+
+	foreach_ptr(shardCommandExecution, shardCommandExecutionList)
+	{
+		if (shardCommandExecution->unfinishedDependencyCount == 0)
+		{
+			ShardCommandExecutionReady(shardCommandExecution);
+		}
+	}
+
+	hash_destroy(taskDependencyHash);
+}
+
+
+/*
+ * AddTaskDependencies makes the given execution wait for the executions of
+ * the tasks in dependentTaskList, looking through the tasks that are not part
+ * of the execution.
+ */
+static void
+AddTaskDependencies(HTAB *taskDependencyHash,
+					ShardCommandExecution *shardCommandExecution,
+					List *dependentTaskList)
+{
+	Task *dependentTask = NULL;
+	foreach_ptr(dependentTask, dependentTaskList)
+	{
+		TaskDependencyKey taskKey = { dependentTask->jobId, dependentTask->taskId, 0 };
+		bool found = false;
+
+		TaskDependencyHashEntry *entry =
+			hash_search(taskDependencyHash, &taskKey, HASH_FIND, &found);
+		if (!found)
+		{
+			AddTaskDependencies(taskDependencyHash, shardCommandExecution,
+								dependentTask->dependentTaskList);
+			continue;
+		}
+
+		ShardCommandExecution *dependentShardCommandExecution =
+			entry->shardCommandExecution;
+
+		/* tasks may depend on the same task via multiple merge tasks */
+		if (list_member_ptr(dependentShardCommandExecution->waitingShardCommandExecutions,
+							shardCommandExecution))
+		{
+			continue;
+		}
+
+		dependentShardCommandExecution->waitingShardCommandExecutions =
+			lappend(dependentShardCommandExecution->waitingShardCommandExecutions,
+					shardCommandExecution);
+		shardCommandExecution->unfinishedDependencyCount++;
+	}
+}
+
+
+/*
+ * ScheduleWaitingShardCommandExecutions is called when the given task finished
+ * and makes the tasks that only waited for it ready.
  */
 static void
-ScheduleNextPlacementExecution(TaskPlacementExecution *placementExecution, bool succeeded)
+ScheduleWaitingShardCommandExecutions(ShardCommandExecution *shardCommandExecution)
 {
-	ShardCommandExecution *shardCommandExecution =
-		placementExecution->shardCommandExecution;
-	PlacementExecutionOrder executionOrder = shardCommandExecution->executionOrder;
-
-	if ((executionOrder == EXECUTION_ORDER_ANY && !succeeded) ||
-		executionOrder == EXECUTION_ORDER_SEQUENTIAL)
+	ShardCommandExecution *waitingShardCommandExecution = NULL;
+	foreach_ptr(waitingShardCommandExecution,
+				shardCommandExecution->waitingShardCommandExecutions)
 	{
-		TaskPlacementExecution *nextPlacementExecution = NULL;
+		Assert(waitingShardCommandExecution->unfinishedDependencyCount > 0);
 
-		/* find a placement execution that is not yet marked as failed */
-		do {
-			int nextPlacementExecutionIndex =
-				placementExecution->placementExecutionIndex + 1;
+		waitingShardCommandExecution->unfinishedDependencyCount--;
 
-			/*
-			 * If all tasks failed then we should already have errored out.
-			 * Still, be defensive and throw error instead of crashes.
-			 */
-			int placementExecutionCount = shardCommandExecution->placementExecutionCount;
-			if (nextPlacementExecutionIndex >= placementExecutionCount)
-			{
-				WorkerPool *workerPool = placementExecution->workerPool;
-				ereport(ERROR, (errmsg("execution cannot recover from multiple "
-									   "connection failures. Last node failed "
-									   "%s:%d", workerPool->nodeName,
-									   workerPool->nodePort)));
-			}
+		if (waitingShardCommandExecution->unfinishedDependencyCount == 0)
+		{
+			ShardCommandExecutionReady(waitingShardCommandExecution);
+		}
+	}
+}
 
-			/* get the next placement in the planning order */
-			nextPlacementExecution =
-				shardCommandExecution->placementExecutions[nextPlacementExecutionIndex];
 
-			if (nextPlacementExecution->executionState == PLACEMENT_EXECUTION_NOT_READY)
-			{
-				/* move the placement execution to the ready queue */
-				PlacementExecutionReady(nextPlacementExecution);
-			}
-		} while (nextPlacementExecution->executionState == PLACEMENT_EXECUTION_FAILED);
+/*
+ * ShardCommandExecutionReady makes the placement executions of the given task
+ * ready once the tasks it depends on finished. Like for tasks without
+ * dependencies, all placements are ready at once for commands that run on
+ * all placements in parallel, and otherwise only the first one.
+ */
+static void
+ShardCommandExecutionReady(ShardCommandExecution *shardCommandExecution)
+{
+	for (int placementExecutionIndex = 0;
+		 placementExecutionIndex < shardCommandExecution->placementExecutionCount;
+		 placementExecutionIndex++)
+	{
+		TaskPlacementExecution *placementExecution =
+			shardCommandExecution->placementExecutions[placementExecutionIndex];
+
+		if (placementExecution->executionState == PLACEMENT_EXECUTION_NOT_READY)
+		{
+			PlacementExecutionReady(placementExecution);
+		}
+
+		if (shardCommandExecution->executionOrder != EXECUTION_ORDER_PARALLEL)
+		{
+			break;
+		}
 	}
 }
 
@@ -4599,6 +6576,8 @@ PlacementExecutionReady(TaskPlacementExecution *placementExecution)
 
 		if (placementExecution->executionState == PLACEMENT_EXECUTION_NOT_READY)
 		{
+			INSTR_TIME_SET_CURRENT(placementExecution->readyTime);
+
 			/* remove from not-ready task queue */
 			dlist_delete(&placementExecution->sessionPendingQueueNode);
 
@@ -4621,6 +6600,8 @@ PlacementExecutionReady(TaskPlacementExecution *placementExecution)
 	{
 		if (placementExecution->executionState == PLACEMENT_EXECUTION_NOT_READY)
 		{
+			INSTR_TIME_SET_CURRENT(placementExecution->readyTime);
+
 			/* remove from not-ready task queue */
 			dlist_delete(&placementExecution->workerPendingQueueNode);
 
@@ -4985,6 +6966,348 @@ CleanUpSessions(DistributedExecution *execution)
 }
 
 
+/*
+ * CombineQueryRowLimit returns the number of rows that the combine query of
+ * the given plan reads from the results of the tasks at most, if it is a
+ * simple LIMIT (and OFFSET) over the rows without ordering, grouping or
+ * aggregation. Any rows satisfy such a query, so the remaining tasks do not
+ * need to finish once we received that many rows. Otherwise, the function
+ * returns 0.
+ */
+static uint64
+CombineQueryRowLimit(DistributedPlan *distributedPlan)
+{
+	Query *combineQuery = distributedPlan->combineQuery;
+
+	if (!EnableLimitEarlyTermination || combineQuery == NULL ||
+		combineQuery->commandType != CMD_SELECT)
+	{
+		return 0;
+	}
+
+	if (combineQuery->sortClause != NIL || combineQuery->groupClause != NIL ||
+		combineQuery->distinctClause != NIL || combineQuery->hasAggs ||
+		combineQuery->hasWindowFuncs || combineQuery->hasTargetSRFs ||
+		combineQuery->havingQual != NULL || combineQuery->setOperations != NULL ||
+		(combineQuery->jointree != NULL && combineQuery->jointree->quals != NULL))
+	{
+		return 0;
+	}
+
+	Node *limitCount = combineQuery->limitCount;
+	if (limitCount == NULL || !IsA(limitCount, Const) ||
+		((Const *) limitCount)->constisnull)
+	{
+		return 0;
+	}
+
+	int64 rowLimit = DatumGetInt64(((Const *) limitCount)->constvalue);
+
+	Node *limitOffset = combineQuery->limitOffset;
+	if (limitOffset != NULL)
+	{
+		if (!IsA(limitOffset, Const))
+		{
+			return 0;
+		}
+
+		if (!((Const *) limitOffset)->constisnull)
+		{
+			int64 rowOffset = DatumGetInt64(((Const *) limitOffset)->constvalue);
+
+			if (rowOffset < 0 || rowOffset > PG_INT64_MAX - rowLimit)
+			{
+				return 0;
+			}
+
+			rowLimit += rowOffset;
+		}
+	}
+
+	/* a limit of 0 also requires no rows, but we do not bother */
+	if (rowLimit <= 0)
+	{
+		return 0;
+	}
+
+	return (uint64) rowLimit;
+}
+
+
+/*
+ * ExecutionReachedRowLimit returns true if the execution received the number
+ * of rows that the combine query needs.
+ */
+static bool
+ExecutionReachedRowLimit(DistributedExecution *execution)
+{
+	return execution->rowLimit > 0 && execution->rowsProcessed >= execution->rowLimit;
+}
+
+
+/*
+ * CancelRemainingTasks stops the execution of the tasks that have not
+ * finished yet. The commands that are still running are cancelled and their
+ * connections are closed, such that subsequent executions do not wait for
+ * their results. The remaining tasks are simply not executed.
+ *
+ * The caller should make sure that the connections are not in a remote
+ * transaction block.
+ */
+static void
+CancelRemainingTasks(DistributedExecution *execution)
+{
+	WorkerSession *session = NULL;
+	foreach_ptr(session, execution->sessionList)
+	{
+		MultiConnection *connection = session->connection;
+
+		if (session->currentTask != NULL ||
+			connection->connectionState == MULTI_CONNECTION_CONNECTING)
+		{
+			ShutdownConnection(connection);
+
+			/* CleanUpSessions closes failed connections */
+			connection->connectionState = MULTI_CONNECTION_FAILED;
+		}
+	}
+
+	ereport(DEBUG4, (errmsg("cancelled %d tasks after receiving " UINT64_FORMAT
+							" rows", execution->unfinishedTaskCount,
+							execution->rowsProcessed)));
+
+	execution->unfinishedTaskCount = 0;
+}
+
+
+/*
+ * IsHedgeableReadTask returns whether the given task of the execution may be
+ * sent to a second placement when the first one is slow to respond. We only
+ * hedge executions of a single read task with multiple placements outside of
+ * a remote transaction block, such that cancelling the slower placement does
+ * not affect anything but the task itself.
+ */
+static bool
+IsHedgeableReadTask(DistributedExecution *execution,
+					ShardCommandExecution *shardCommandExecution)
+{
+	Task *task = shardCommandExecution->task;
+
+	if (HedgedReadPercentile <= 0.0)
+	{
+		return false;
+	}
+
+	if (list_length(execution->remoteTaskList) != 1 ||
+		shardCommandExecution->executionOrder != EXECUTION_ORDER_ANY ||
+		shardCommandExecution->placementExecutionCount < 2)
+	{
+		return false;
+	}
+
+	/* EXPLAIN ANALYZE and multi-query tasks need the results of every query */
+	if (task->tupleDest != NULL || task->queryCount != 1)
+	{
+		return false;
+	}
+
+	return execution->transactionProperties->useRemoteTransactionBlocks ==
+		   TRANSACTION_BLOCKS_DISALLOWED;
+}
+
+
+/*
+ * HedgedReadDelay returns the number of milliseconds after which a hedgeable
+ * read is sent to another placement, which is the citus.hedged_read_percentile
+ * percentile of the recent durations of hedgeable reads in this backend, or
+ * -1 if we did not see enough reads yet.
+ */
+static long
+HedgedReadDelay(void)
+{
+	double sortedDurations[HEDGED_READ_SAMPLE_COUNT];
+	int durationCount = HedgedReadDurationCount;
+
+	if (durationCount < HEDGED_READ_MIN_SAMPLE_COUNT)
+	{
+		return -1;
+	}
+
+	for (int durationIndex = 0; durationIndex < durationCount; durationIndex++)
+	{
+		sortedDurations[durationIndex] = HedgedReadDurations[durationIndex];
+	}
+
+	SafeQsort(sortedDurations, durationCount, sizeof(double), CompareDurations);
+
+	int percentileIndex = (int) ceil(HedgedReadPercentile / 100.0 * durationCount) - 1;
+	percentileIndex = Max(0, Min(percentileIndex, durationCount - 1));
+
+	return (long) ceil(sortedDurations[percentileIndex]);
+}
+
+
+/*
+ * RecordHedgedReadDuration adds the time the hedgeable read of the execution
+ * took to the recent durations, replacing the oldest one if needed.
+ */
+static void
+RecordHedgedReadDuration(DistributedExecution *execution)
+{
+	instr_time duration;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, execution->hedgingStartTime);
+
+	HedgedReadDurations[NextHedgedReadDurationIndex] = INSTR_TIME_GET_MILLISEC(duration);
+	NextHedgedReadDurationIndex =
+		(NextHedgedReadDurationIndex + 1) % HEDGED_READ_SAMPLE_COUNT;
+
+	if (HedgedReadDurationCount < HEDGED_READ_SAMPLE_COUNT)
+	{
+		HedgedReadDurationCount++;
+	}
+}
+
+
+/*
+ * HedgeSlowReadTask sends the hedgeable read of the execution to another
+ * placement if none of its placements responded within the hedging delay.
+ * Whichever placement responds first provides the rows, the other one is
+ * cancelled once the task is finished.
+ */
+static void
+HedgeSlowReadTask(DistributedExecution *execution)
+{
+	ShardCommandExecution *shardCommandExecution =
+		execution->hedgeableShardCommandExecution;
+
+	if (shardCommandExecution->hedged ||
+		shardCommandExecution->resultPlacementExecution != NULL ||
+		shardCommandExecution->executionState != TASK_EXECUTION_NOT_FINISHED ||
+		execution->hedgingDelay < 0)
+	{
+		return;
+	}
+
+	instr_time now;
+	INSTR_TIME_SET_CURRENT(now);
+
+	if (MillisecondsBetweenTimestamps(execution->hedgingStartTime, now) <
+		execution->hedgingDelay)
+	{
+		return;
+	}
+
+	for (int placementExecutionIndex = 0;
+		 placementExecutionIndex < shardCommandExecution->placementExecutionCount;
+		 placementExecutionIndex++)
+	{
+		TaskPlacementExecution *placementExecution =
+			shardCommandExecution->placementExecutions[placementExecutionIndex];
+		WorkerPool *workerPool = placementExecution->workerPool;
+
+		if (placementExecution->executionState != PLACEMENT_EXECUTION_NOT_READY ||
+			placementExecution->assignedSession != NULL ||
+			workerPool->failureState != WORKER_POOL_NOT_FAILED)
+		{
+			continue;
+		}
+
+		PlacementExecutionReady(placementExecution);
+		shardCommandExecution->hedged = true;
+
+		ereport(DEBUG4, (errmsg("hedging task %d on %s:%d after %ld ms",
+								shardCommandExecution->task->taskId,
+								workerPool->nodeName, workerPool->nodePort,
+								execution->hedgingDelay)));
+		break;
+	}
+}
+
+
+/*
+ * HasActivePlacementExecution returns whether any placement execution of the
+ * given task is ready or running.
+ */
+static bool
+HasActivePlacementExecution(ShardCommandExecution *shardCommandExecution)
+{
+	for (int placementExecutionIndex = 0;
+		 placementExecutionIndex < shardCommandExecution->placementExecutionCount;
+		 placementExecutionIndex++)
+	{
+		TaskPlacementExecution *placementExecution =
+			shardCommandExecution->placementExecutions[placementExecutionIndex];
+		TaskPlacementExecutionState executionState = placementExecution->executionState;
+
+		if (executionState == PLACEMENT_EXECUTION_READY ||
+			executionState == PLACEMENT_EXECUTION_RUNNING)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * CancelHedgedPlacementExecutions shuts down the connections that are still
+ * running the hedged read after another placement provided the rows. Since
+ * hedged reads do not run in a remote transaction block, the connections can
+ * simply be closed by CleanUpSessions.
+ */
+static void
+CancelHedgedPlacementExecutions(DistributedExecution *execution)
+{
+	ShardCommandExecution *shardCommandExecution =
+		execution->hedgeableShardCommandExecution;
+
+	if (shardCommandExecution == NULL || !shardCommandExecution->hedged)
+	{
+		return;
+	}
+
+	WorkerSession *session = NULL;
+	foreach_ptr(session, execution->sessionList)
+	{
+		MultiConnection *connection = session->connection;
+
+		if (session->currentTask != NULL)
+		{
+			ShutdownConnection(connection);
+
+			/* CleanUpSessions closes failed connections */
+			connection->connectionState = MULTI_CONNECTION_FAILED;
+		}
+	}
+}
+
+
+/*
+ * CompareDurations is a comparison function for sorting durations in
+ * ascending order.
+ */
+static int
+CompareDurations(const void *leftElement, const void *rightElement)
+{
+	double leftDuration = *((const double *) leftElement);
+	double rightDuration = *((const double *) rightElement);
+
+	if (leftDuration < rightDuration)
+	{
+		return -1;
+	}
+	else if (leftDuration > rightDuration)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+
 /*
  * UnclaimAllSessionConnections unclaims all of the connections for the given
  * sessionList.
@@ -0,0 +1,431 @@
+/*-------------------------------------------------------------------------
+ *
+ * bulk_insert_select.c
+ *
+ * The rows of an INSERT ... SELECT on a shard, such as the tasks of a
+ * co-located INSERT ... SELECT between distributed tables, are by default
+ * inserted one by one by the ModifyTable node of postgres, which writes a
+ * WAL record for each row and goes through the free space map and the
+ * shared buffers for every one of them.
+ *
+ * When citus.enable_bulk_insert_select is enabled, we replace the
+ * ModifyTable node of such plans with a custom scan that buffers the rows of
+ * the SELECT and inserts them in batches with table_multi_insert() and a
+ * bulk insert state, the way COPY does. This way the rows of each page are
+ * WAL-logged together and bulk writes use a ring buffer rather than
+ * evicting the whole shared buffer pool.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/htup_details.h"
+#include "access/tableam.h"
+#include "executor/executor.h"
+#include "nodes/makefuncs.h"
+#include "parser/parsetree.h"
+#include "utils/rel.h"
+
+#include "pg_version_compat.h"
+
+#include "distributed/bulk_insert_select.h"
+#include "distributed/listutils.h"
+#include "distributed/worker_shard_visibility.h"
+
+
+/* limits on the rows buffered before they are inserted, same as COPY */
+#define BULK_INSERT_MAX_BUFFERED_TUPLES 1000
+#define BULK_INSERT_MAX_BUFFERED_BYTES 65535
+
+
+/*
+ * BulkInsertSelectScanState is the state of a custom scan that inserts the
+ * rows of its SELECT into the result relation of the query.
+ */
+typedef struct BulkInsertSelectScanState
+{
+	CustomScanState customScanState;
+
+	/* relation that the rows are inserted into */
+	ResultRelInfo *resultRelInfo;
+
+	/* state of the bulk insert, NULL for EXPLAIN without ANALYZE */
+	BulkInsertState bulkInsertState;
+
+	/* position of the SELECT column for each attribute of the relation */
+	int *selectColumnIndexes;
+
+	/* rows that are not yet inserted */
+	TupleTableSlot **bufferedSlots;
+	int bufferedTupleCount;
+	Size bufferedBytes;
+
+	/* whether all the rows of the SELECT are inserted */
+	bool finished;
+} BulkInsertSelectScanState;
+
+
+/* GUC, determining whether the rows of INSERT ... SELECT on shards are bulk inserted */
+bool EnableBulkInsertSelect = false;
+
+
+static bool BulkInsertSupportedRelation(Oid relationId);
+static Node * BulkInsertSelectCreateScan(CustomScan *scan);
+static void BulkInsertSelectBeginScan(CustomScanState *node, EState *estate,
+									  int eflags);
+static TupleTableSlot * BulkInsertSelectExecScan(CustomScanState *node);
+static void FlushBufferedRows(BulkInsertSelectScanState *scanState);
+static void BulkInsertSelectEndScan(CustomScanState *node);
+static void BulkInsertSelectReScan(CustomScanState *node);
+
+
+CustomScanMethods BulkInsertSelectCustomScanMethods = {
+	"Citus Bulk Insert",
+	BulkInsertSelectCreateScan
+};
+
+static CustomExecMethods BulkInsertSelectCustomExecMethods = {
+	.CustomName = "BulkInsertSelectScan",
+	.BeginCustomScan = BulkInsertSelectBeginScan,
+	.ExecCustomScan = BulkInsertSelectExecScan,
+	.EndCustomScan = BulkInsertSelectEndScan,
+	.ReScanCustomScan = BulkInsertSelectReScan
+};
+
+
+/*
+ * BulkInsertSelectPlan replaces the ModifyTable node of a plan for an
+ * INSERT ... SELECT into a shard with a custom scan that bulk inserts the rows
+ * of the SELECT, when citus.enable_bulk_insert_select is enabled and we can
+ * do so without skipping any of the work that ModifyTable does. Otherwise,
+ * the plan is returned as is.
+ */
+PlannedStmt *
+BulkInsertSelectPlan(PlannedStmt *plan)
+{
+	if (!EnableBulkInsertSelect || plan->commandType != CMD_INSERT ||
+		plan->hasReturning || !IsA(plan->planTree, ModifyTable))
+	{
+		return plan;
+	}
+
+	ModifyTable *modifyTable = (ModifyTable *) plan->planTree;
+	Plan *selectPlan = outerPlan(modifyTable);
+
+	if (modifyTable->operation != CMD_INSERT ||
+		list_length(modifyTable->resultRelations) != 1 ||
+		modifyTable->onConflictAction != ONCONFLICT_NONE ||
+		modifyTable->withCheckOptionLists != NIL ||
+		modifyTable->returningLists != NIL ||
+		modifyTable->plan.initPlan != NIL ||
+		selectPlan == NULL)
+	{
+		return plan;
+	}
+
+	/* a single row INSERT ... VALUES has nothing to buffer */
+	if (IsA(selectPlan, Result) && outerPlan(selectPlan) == NULL)
+	{
+		return plan;
+	}
+
+	Index resultRelationIndex = linitial_int(modifyTable->resultRelations);
+	RangeTblEntry *resultRte = rt_fetch(resultRelationIndex, plan->rtable);
+
+	if (!BulkInsertSupportedRelation(resultRte->relid))
+	{
+		return plan;
+	}
+
+	CustomScan *customScan = makeNode(CustomScan);
+	customScan->methods = &BulkInsertSelectCustomScanMethods;
+	customScan->custom_plans = list_make1(selectPlan);
+	customScan->custom_private = list_make1(makeInteger(resultRelationIndex));
+	customScan->scan.plan.startup_cost = modifyTable->plan.startup_cost;
+	customScan->scan.plan.total_cost = modifyTable->plan.total_cost;
+	customScan->scan.plan.plan_rows = modifyTable->plan.plan_rows;
+
+	plan->planTree = (Plan *) customScan;
+
+	return plan;
+}
+
+
+/*
+ * BulkInsertSupportedRelation returns whether the rows of an INSERT into the
+ * given relation can be bulk inserted. We only do so for shards that are
+ * regular tables without triggers, including the ones of foreign keys and
+ * deferrable constraints, row level security, generated columns or a
+ * partition constraint, such that checking the constraints and inserting the
+ * index entries is all that is left to do.
+ */
+static bool
+BulkInsertSupportedRelation(Oid relationId)
+{
+	/* the planner already locked the relation */
+	Relation relation = table_open(relationId, NoLock);
+	TupleConstr *constraints = RelationGetDescr(relation)->constr;
+
+	bool supported = relation->rd_rel->relkind == RELKIND_RELATION &&
+					 !relation->rd_rel->relispartition &&
+					 !relation->rd_rel->relrowsecurity &&
+					 relation->trigdesc == NULL &&
+					 (constraints == NULL || !constraints->has_generated_stored);
+
+	table_close(relation, NoLock);
+
+	return supported && RelationIsAKnownShard(relationId);
+}
+
+
+/*
+ * BulkInsertSelectCreateScan creates the scan state for a bulk insert scan.
+ */
+static Node *
+BulkInsertSelectCreateScan(CustomScan *scan)
+{
+	BulkInsertSelectScanState *scanState = palloc0(sizeof(BulkInsertSelectScanState));
+
+	scanState->customScanState.ss.ps.type = T_CustomScanState;
+	scanState->customScanState.methods = &BulkInsertSelectCustomExecMethods;
+
+	return (Node *) scanState;
+}
+
+
+/*
+ * BulkInsertSelectBeginScan initializes the SELECT and opens the result
+ * relation along with its indexes, as ModifyTable would.
+ */
+static void
+BulkInsertSelectBeginScan(CustomScanState *node, EState *estate, int eflags)
+{
+	BulkInsertSelectScanState *scanState = (BulkInsertSelectScanState *) node;
+	CustomScan *customScan = (CustomScan *) node->ss.ps.plan;
+	Plan *selectPlan = (Plan *) linitial(customScan->custom_plans);
+	Index resultRelationIndex = intVal(linitial(customScan->custom_private));
+
+	node->custom_ps = list_make1(ExecInitNode(selectPlan, estate, eflags));
+
+	ResultRelInfo *resultRelInfo = makeNode(ResultRelInfo);
+	ExecInitResultRelation(estate, resultRelInfo, resultRelationIndex);
+	ExecOpenIndices(resultRelInfo, false);
+	scanState->resultRelInfo = resultRelInfo;
+
+	if (eflags & EXEC_FLAG_EXPLAIN_ONLY)
+	{
+		return;
+	}
+
+	/*
+	 * The planner expands the target list of an INSERT to all the attributes
+	 * of the relation in order, so the non-junk columns of the SELECT are the
+	 * values of the new row.
+	 */
+	TupleDesc tupleDescriptor = RelationGetDescr(resultRelInfo->ri_RelationDesc);
+	int columnCount = 0;
+
+	scanState->selectColumnIndexes = palloc0(tupleDescriptor->natts * sizeof(int));
+
+	TargetEntry *targetEntry = NULL;
+	foreach_ptr(targetEntry, selectPlan->targetlist)
+	{
+		if (targetEntry->resjunk)
+		{
+			continue;
+		}
+
+		if (columnCount < tupleDescriptor->natts)
+		{
+			scanState->selectColumnIndexes[columnCount] = targetEntry->resno - 1;
+		}
+
+		columnCount++;
+	}
+
+	if (columnCount != tupleDescriptor->natts)
+	{
+		ereport(ERROR, (errmsg("unexpected target list for a bulk insert into %s",
+							   RelationGetRelationName(
+								   resultRelInfo->ri_RelationDesc))));
+	}
+
+	scanState->bufferedSlots =
+		palloc0(BULK_INSERT_MAX_BUFFERED_TUPLES * sizeof(TupleTableSlot *));
+	scanState->bulkInsertState = GetBulkInsertState();
+}
+
+
+/*
+ * BulkInsertSelectExecScan inserts all the rows of the SELECT on the first
+ * call. It does not return any rows, but adds the inserted rows to the
+ * processed row count of the query.
+ */
+static TupleTableSlot *
+BulkInsertSelectExecScan(CustomScanState *node)
+{
+	BulkInsertSelectScanState *scanState = (BulkInsertSelectScanState *) node;
+
+	if (scanState->finished)
+	{
+		return NULL;
+	}
+
+	EState *estate = node->ss.ps.state;
+	PlanState *selectPlanState = (PlanState *) linitial(node->custom_ps);
+	ResultRelInfo *resultRelInfo = scanState->resultRelInfo;
+	Relation relation = resultRelInfo->ri_RelationDesc;
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+
+	for (;;)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		TupleTableSlot *selectSlot = ExecProcNode(selectPlanState);
+		if (TupIsNull(selectSlot))
+		{
+			break;
+		}
+
+		slot_getallattrs(selectSlot);
+
+		int slotIndex = scanState->bufferedTupleCount;
+		TupleTableSlot *slot = scanState->bufferedSlots[slotIndex];
+		if (slot == NULL)
+		{
+			slot = table_slot_create(relation, &estate->es_tupleTable);
+			scanState->bufferedSlots[slotIndex] = slot;
+		}
+
+		ExecClearTuple(slot);
+
+		for (int columnIndex = 0; columnIndex < tupleDescriptor->natts; columnIndex++)
+		{
+			int selectColumnIndex = scanState->selectColumnIndexes[columnIndex];
+
+			slot->tts_values[columnIndex] = selectSlot->tts_values[selectColumnIndex];
+			slot->tts_isnull[columnIndex] = selectSlot->tts_isnull[selectColumnIndex];
+		}
+
+		ExecStoreVirtualTuple(slot);
+
+		scanState->bufferedBytes += heap_compute_data_size(tupleDescriptor,
+														   slot->tts_values,
+														   slot->tts_isnull);
+
+		/* the values still point into the SELECT slot, which the next row reuses */
+		ExecMaterializeSlot(slot);
+
+		if (tupleDescriptor->constr != NULL)
+		{
+			ExecConstraints(resultRelInfo, slot, estate);
+		}
+
+		ResetPerTupleExprContext(estate);
+
+		scanState->bufferedTupleCount++;
+
+		if (scanState->bufferedTupleCount >= BULK_INSERT_MAX_BUFFERED_TUPLES ||
+			scanState->bufferedBytes >= BULK_INSERT_MAX_BUFFERED_BYTES)
+		{
+			FlushBufferedRows(scanState);
+		}
+	}
+
+	FlushBufferedRows(scanState);
+
+	scanState->finished = true;
+
+	return NULL;
+}
+
+
+/*
+ * FlushBufferedRows inserts the buffered rows into the relation and inserts
+ * their index entries, similar to CopyMultiInsertBufferFlush() in COPY.
+ */
+static void
+FlushBufferedRows(BulkInsertSelectScanState *scanState)
+{
+	int tupleCount = scanState->bufferedTupleCount;
+	if (tupleCount == 0)
+	{
+		return;
+	}
+
+	EState *estate = scanState->customScanState.ss.ps.state;
+	ResultRelInfo *resultRelInfo = scanState->resultRelInfo;
+	int insertOptions = 0;
+
+	MemoryContext oldContext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+	table_multi_insert(resultRelInfo->ri_RelationDesc, scanState->bufferedSlots,
+					   tupleCount, estate->es_output_cid, insertOptions,
+					   scanState->bulkInsertState);
+
+	MemoryContextSwitchTo(oldContext);
+
+	for (int slotIndex = 0; slotIndex < tupleCount; slotIndex++)
+	{
+		TupleTableSlot *slot = scanState->bufferedSlots[slotIndex];
+
+		if (resultRelInfo->ri_NumIndices > 0)
+		{
+			List *recheckIndexes =
+				ExecInsertIndexTuples_compat(resultRelInfo, slot, estate,
+											 false /* update */,
+											 false /* noDupErr */,
+											 NULL /* specConflict */,
+											 NIL /* arbiterIndexes */,
+											 false /* onlySummarizing */);
+			list_free(recheckIndexes);
+		}
+
+		ExecClearTuple(slot);
+		ResetPerTupleExprContext(estate);
+	}
+
+	estate->es_processed += tupleCount;
+
+	scanState->bufferedTupleCount = 0;
+	scanState->bufferedBytes = 0;
+}
+
+
+/*
+ * BulkInsertSelectEndScan releases the bulk insert state and ends the SELECT.
+ * The executor closes the result relation and its indexes.
+ */
+static void
+BulkInsertSelectEndScan(CustomScanState *node)
+{
+	BulkInsertSelectScanState *scanState = (BulkInsertSelectScanState *) node;
+
+	if (scanState->bulkInsertState != NULL)
+	{
+		int insertOptions = 0;
+
+		table_finish_bulk_insert(scanState->resultRelInfo->ri_RelationDesc,
+								 insertOptions);
+		FreeBulkInsertState(scanState->bulkInsertState);
+		scanState->bulkInsertState = NULL;
+	}
+
+	ExecEndNode((PlanState *) linitial(node->custom_ps));
+}
+
+
+/*
+ * BulkInsertSelectReScan is not expected to be called, since the custom scan
+ * is always at the top of the plan of an INSERT.
+ */
+static void
+BulkInsertSelectReScan(CustomScanState *node)
+{
+	ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					errmsg("rescan is not supported for bulk inserts")));
+}
@@ -11,47 +11,82 @@
 
 #include "miscadmin.h"
 
+#include "catalog/pg_namespace.h"
 #include "commands/copy.h"
 #include "executor/executor.h"
+#include "lib/binaryheap.h"
 #include "nodes/makefuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/optimizer.h"
+#include "optimizer/tlist.h"
+#include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/sortsupport.h"
 
 #include "pg_version_constants.h"
 
+#include "distributed/adaptive_executor.h"
 #include "distributed/backend_data.h"
+#include "distributed/bulk_insert_select.h"
 #include "distributed/citus_clauses.h"
 #include "distributed/citus_custom_scan.h"
 #include "distributed/citus_nodefuncs.h"
 #include "distributed/citus_ruleutils.h"
 #include "distributed/colocation_utils.h"
+#include "distributed/combine_query_planner.h"
 #include "distributed/connection_management.h"
 #include "distributed/deparse_shard_query.h"
 #include "distributed/distributed_execution_locks.h"
 #include "distributed/function_call_delegation.h"
+#include "distributed/insert_buffer.h"
 #include "distributed/insert_select_executor.h"
 #include "distributed/insert_select_planner.h"
+#include "distributed/intermediate_results.h"
 #include "distributed/listutils.h"
 #include "distributed/local_executor.h"
 #include "distributed/local_plan_cache.h"
 #include "distributed/merge_executor.h"
 #include "distributed/merge_planner.h"
+#include "distributed/metadata_cache.h"
 #include "distributed/multi_executor.h"
+#include "distributed/multi_explain.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/multi_server_executor.h"
+#include "distributed/placement_connection.h"
 #include "distributed/query_stats.h"
+#include "distributed/shard_pruning.h"
+#include "distributed/shard_query_cache.h"
 #include "distributed/shard_utils.h"
 #include "distributed/subplan_execution.h"
+#include "distributed/tdigest_extension.h"
 #include "distributed/worker_log_messages.h"
 #include "distributed/worker_protocol.h"
 
 
+/*
+ * SortedMergeState holds the current row of each task and the sort keys by
+ * which MergeSortedTaskResults merges the task results.
+ */
+typedef struct SortedMergeState
+{
+	TupleTableSlot **taskSlots;
+	SortSupport sortKeys;
+	int sortKeyCount;
+} SortedMergeState;
+
+
 extern AllowedDistributionColumn AllowedDistributionColumnValue;
 
+/* GUCs, determining whether the partial aggregates of a node are merged on the node */
+bool EnableAggregateCombinePerNode = false;
+bool EnableTDigestCombinePerNode = false;
+
+/* GUC, determining whether the tasks of a multi-shard SELECT are grouped per node */
+bool EnableShardTaskGrouping = false;
+
 /* functions for creating custom scan nodes */
 static Node * AdaptiveExecutorCreateScan(CustomScan *scan);
 static Node * NonPushableInsertSelectCreateScan(CustomScan *scan);
@@ -64,8 +99,22 @@ static void CitusBeginReadOnlyScan(CustomScanState *node, EState *estate, int ef
 static void CitusBeginModifyScan(CustomScanState *node, EState *estate, int eflags);
 static void CitusPreExecScan(CitusScanState *scanState);
 static bool ModifyJobNeedsEvaluation(Job *workerJob);
-static void RegenerateTaskForFasthPathQuery(Job *workerJob);
+static void RegenerateTaskForFasthPathQuery(Job *workerJob,
+											 DistributedPlan *shardQueryCachePlan);
 static void RegenerateTaskListForInsert(Job *workerJob);
+static Const * EvaluateDistributionKeyParam(Query *jobQuery, PlanState *planState);
+static List * PruneTaskListByParameters(Job *workerJob, PlanState *planState);
+static List * CombineTaskListPerNode(DistributedPlan *distributedPlan, List *taskList);
+static bool NodeAggregateCombineClauses(DistributedPlan *distributedPlan,
+										StringInfo selectClause,
+										StringInfo groupByClause);
+static bool NodeCombineClauses(Query *workerQuery, bool builtinAggregatesAllowed,
+							   StringInfo selectClause, StringInfo groupByClause);
+static char * BuiltinAggregateCombineFunction(Oid aggregateId);
+static bool CombineQueryAggregatesColumns(Query *combineQuery, Query *workerQuery);
+static bool CanCombineTaskOnNode(Task *task, int32 localGroupId);
+static Task * CombineNodeTasks(List *nodeTaskList, int columnCount,
+							   char *selectClause, char *groupByClause);
 static DistributedPlan * CopyDistributedPlanWithoutCache(
 	DistributedPlan *originalDistributedPlan);
 static void CitusEndScan(CustomScanState *node);
@@ -74,6 +123,7 @@ static void EnsureForceDelegationDistributionKey(Job *job);
 static void EnsureAnchorShardsInJobExist(Job *job);
 static bool AnchorShardsInTaskListExist(List *taskList);
 static void TryToRerouteFastPathModifyQuery(Job *job);
+static int CompareTaskSlots(Datum leftTaskIndex, Datum rightTaskIndex, void *arg);
 
 
 /* create custom scan methods for all executors */
@@ -163,6 +213,7 @@ RegisterCitusCustomScanMethods(void)
 	RegisterCustomScanMethods(&NonPushableInsertSelectCustomScanMethods);
 	RegisterCustomScanMethods(&DelayedErrorCustomScanMethods);
 	RegisterCustomScanMethods(&NonPushableMergeCommandCustomScanMethods);
+	RegisterCustomScanMethods(&BulkInsertSelectCustomScanMethods);
 }
 
 
@@ -203,6 +254,14 @@ CitusBeginScan(CustomScanState *node, EState *estate, int eflags)
 	node->ss.ps.qual = ExecInitQual(node->ss.ps.plan->qual, (PlanState *) node);
 
 	DistributedPlan *distributedPlan = scanState->distributedPlan;
+
+	/* the planning times of a plan are counted in the stats of its first execution */
+	scanState->firstExecution = distributedPlan->numberOfTimesExecuted == 0;
+
+	INSTR_TIME_SET_CURRENT(scanState->executionStartTime);
+	scanState->remoteWaitTimeAtStart = GetRemoteWaitTime();
+	GetIntermediateResultStats(&scanState->intermediateResultStatsAtStart);
+
 	if (distributedPlan->modifyQueryViaCoordinatorOrRepartition != NULL)
 	{
 		/*
@@ -231,6 +290,14 @@ CitusBeginScan(CustomScanState *node, EState *estate, int eflags)
 		EnsureForceDelegationDistributionKey(workerJob);
 	}
 
+	/* trace the tasks to find the slowest one if the plan may be logged */
+	scanState->logDistributedPlan = (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0 &&
+									ShouldLogDistributedPlan();
+	if (scanState->logDistributedPlan && scanState->distributedPlan->workerJob != NULL)
+	{
+		TraceTasksForDistributedPlanLog(scanState->distributedPlan->workerJob->taskList);
+	}
+
 	/*
 	 * In case of a prepared statement, we will see this distributed plan again
 	 * on the next execution with a higher usage counter.
@@ -254,6 +321,11 @@ CitusPreExecScan(CitusScanState *scanState)
  * On the first call, it executes the distributed query and writes the
  * results to a tuple store. The postgres executor calls this function
  * repeatedly to read tuples from the tuple store.
+ *
+ * When the task results are combined incrementally, the tuple store only
+ * holds the rows of the tasks that finished (or, when streaming the results,
+ * the rows that arrived) since it was last read, and the execution continues
+ * once those are consumed.
  */
 TupleTableSlot *
 CitusExecScan(CustomScanState *node)
@@ -262,12 +334,38 @@ CitusExecScan(CustomScanState *node)
 
 	if (!scanState->finishedRemoteScan)
 	{
-		AdaptiveExecutor(scanState);
+		if (ShouldBufferInsert(scanState))
+		{
+			BufferInsert(scanState);
+		}
+		else
+		{
+			/* the INSERT might conflict with the buffered ones */
+			FlushBufferedInserts();
+
+			if (ShouldExecuteMultiRowInsertViaCopy(scanState))
+			{
+				ExecuteMultiRowInsertViaCopy(scanState);
+			}
+			else
+			{
+				AdaptiveExecutor(scanState);
+			}
+		}
 
 		scanState->finishedRemoteScan = true;
 	}
 
-	return ReturnTupleFromTuplestore(scanState);
+	TupleTableSlot *resultSlot = ReturnTupleFromTuplestore(scanState);
+
+	while (TupIsNull(resultSlot) && scanState->incrementalExecution != NULL)
+	{
+		ContinueAdaptiveExecutor(scanState);
+
+		resultSlot = ReturnTupleFromTuplestore(scanState);
+	}
+
+	return resultSlot;
 }
 
 
@@ -284,10 +382,56 @@ CitusBeginReadOnlyScan(CustomScanState *node, EState *estate, int eflags)
 
 	if (!originalDistributedPlan->workerJob->deferredPruning)
 	{
+		Job *originalWorkerJob = originalDistributedPlan->workerJob;
+		List *taskList = originalWorkerJob->taskList;
+
+		/*
+		 * In generic multi-shard plans, skip the tasks on shards that the
+		 * parameter values exclude.
+		 */
+		if (originalWorkerJob->parameterPruningClauseList != NIL)
+		{
+			PlanState *planState = &(scanState->customScanState.ss.ps);
+			taskList = PruneTaskListByParameters(originalWorkerJob, planState);
+		}
+
+		/*
+		 * Run the tasks of each node as a single task, which may merge the
+		 * partial aggregates of the shards on that node. This depends on the
+		 * connections that the transaction already used, hence we do it for
+		 * every execution.
+		 */
+		if (EnableAggregateCombinePerNode || EnableTDigestCombinePerNode ||
+			EnableShardTaskGrouping)
+		{
+			taskList = CombineTaskListPerNode(originalDistributedPlan, taskList);
+		}
+
+		/*
+		 * We only replace the task list, hence shallow copies of the plan and
+		 * the job suffice.
+		 */
+		if (taskList != originalWorkerJob->taskList)
+		{
+			DistributedPlan *currentPlan = palloc(sizeof(DistributedPlan));
+			*currentPlan = *originalDistributedPlan;
+
+			Job *currentJob = palloc(sizeof(Job));
+			*currentJob = *originalWorkerJob;
+			currentJob->taskList = taskList;
+
+			currentPlan->workerJob = currentJob;
+			scanState->distributedPlan = currentPlan;
+		}
+
 		/*
 		 * For SELECT queries that have already been pruned we can proceed straight
-		 * to execution, since none of the prepared statement logic applies.
+		 * to execution, since none of the prepared statement logic applies. We
+		 * only cache the local plans of the tasks, which are reused along with
+		 * the tasks across executions.
 		 */
+		CacheLocalPlansForJob(scanState->distributedPlan->workerJob,
+							  originalDistributedPlan, estate->es_param_list_info);
 		return;
 	}
 
@@ -311,39 +455,51 @@ CitusBeginReadOnlyScan(CustomScanState *node, EState *estate, int eflags)
 	 */
 	Assert(currentPlan->fastPathRouterPlan || !EnableFastPathRouterPlanner);
 
-	/*
-	 * Evaluate parameters, because the parameters are only available on the
-	 * coordinator and are required for pruning.
-	 *
-	 * We don't evaluate functions for read-only queries on the coordinator
-	 * at the moment. Most function calls would be in a context where they
-	 * should be re-evaluated for every row in case of volatile functions.
-	 *
-	 * TODO: evaluate stable functions
-	 */
-	ExecuteCoordinatorEvaluableExpressions(jobQuery, planState);
-
-	/* job query no longer has parameters, so we should not send any */
-	workerJob->parametersInJobQueryResolved = true;
-
-	/* parameters are filled in, so we can generate a task for this execution */
-	RegenerateTaskForFasthPathQuery(workerJob);
-
-	if (IsLocalPlanCachingSupported(workerJob, originalDistributedPlan))
+	Const *distributionKeyValue = NULL;
+	if (IsShardQueryCachingSupported(workerJob, originalDistributedPlan))
 	{
-		Task *task = linitial(workerJob->taskList);
+		distributionKeyValue = EvaluateDistributionKeyParam(jobQuery, planState);
+	}
 
+	DistributedPlan *shardQueryCachePlan = NULL;
+	if (distributionKeyValue != NULL)
+	{
+		/*
+		 * Only the distribution key is needed for pruning. The parameters stay
+		 * in the job query and are sent along with the shard query, such that
+		 * the shard query that an earlier execution deparsed can be reused.
+		 */
+		workerJob->partitionKeyValue = distributionKeyValue;
+		shardQueryCachePlan = originalDistributedPlan;
+	}
+	else
+	{
 		/*
-		 * We are going to execute this task locally. If it's not already in
-		 * the cache, create a local plan now and add it to the cache. During
-		 * execution, we will get the plan from the cache.
+		 * Evaluate parameters, because the parameters are only available on the
+		 * coordinator and are required for pruning.
+		 *
+		 * We don't evaluate functions for read-only queries on the coordinator
+		 * at the moment. Most function calls would be in a context where they
+		 * should be re-evaluated for every row in case of volatile functions.
 		 *
-		 * The plan will be cached across executions when originalDistributedPlan
-		 * represents a prepared statement.
+		 * TODO: evaluate stable functions
 		 */
-		CacheLocalPlanForShardQuery(task, originalDistributedPlan,
-									estate->es_param_list_info);
+		ExecuteCoordinatorEvaluableExpressions(jobQuery, planState);
+
+		/* job query no longer has parameters, so we should not send any */
+		workerJob->parametersInJobQueryResolved = true;
 	}
+
+	/* parameters are filled in, so we can generate a task for this execution */
+	RegenerateTaskForFasthPathQuery(workerJob, shardQueryCachePlan);
+
+	/*
+	 * If we are going to execute the task locally and it's not already in the
+	 * cache, create a local plan now and add it to the cache. During execution,
+	 * we will get the plan from the cache.
+	 */
+	CacheLocalPlansForJob(workerJob, originalDistributedPlan,
+						  estate->es_param_list_info);
 }
 
 
@@ -376,6 +532,22 @@ CitusBeginModifyScan(CustomScanState *node, EState *estate, int eflags)
 
 	Query *jobQuery = workerJob->jobQuery;
 
+	DistributedPlan *shardQueryCachePlan = NULL;
+	if (IsShardQueryCachingSupported(workerJob, originalDistributedPlan))
+	{
+		Const *distributionKeyValue = EvaluateDistributionKeyParam(jobQuery, planState);
+		if (distributionKeyValue != NULL)
+		{
+			/*
+			 * The query doesn't have functions to evaluate, so knowing the value
+			 * of the distribution column is enough to prune. The parameters are
+			 * sent along with the cached shard query instead of being evaluated.
+			 */
+			workerJob->partitionKeyValue = distributionKeyValue;
+			shardQueryCachePlan = originalDistributedPlan;
+		}
+	}
+
 	if (ModifyJobNeedsEvaluation(workerJob))
 	{
 		ExecuteCoordinatorEvaluableExpressions(jobQuery, planState);
@@ -406,7 +578,7 @@ CitusBeginModifyScan(CustomScanState *node, EState *estate, int eflags)
 		}
 		else
 		{
-			RegenerateTaskForFasthPathQuery(workerJob);
+			RegenerateTaskForFasthPathQuery(workerJob, shardQueryCachePlan);
 		}
 	}
 	else if (workerJob->requiresCoordinatorEvaluation)
@@ -452,26 +624,18 @@ CitusBeginModifyScan(CustomScanState *node, EState *estate, int eflags)
 	 * Now that we have populated the task placements we can determine whether
 	 * any of them are local to this node and cache a plan if needed.
 	 */
-	if (IsLocalPlanCachingSupported(workerJob, originalDistributedPlan))
-	{
-		Task *task = linitial(workerJob->taskList);
-
-		/*
-		 * We are going to execute this task locally. If it's not already in
-		 * the cache, create a local plan now and add it to the cache. During
-		 * execution, we will get the plan from the cache.
-		 *
-		 * WARNING: In this function we'll use the original plan with the original
-		 * query tree, meaning parameters and function calls are back and we'll
-		 * redo evaluation in the local (Postgres) executor. The reason we do this
-		 * is that we only need to cache one generic plan per shard.
-		 *
-		 * The plan will be cached across executions when originalDistributedPlan
-		 * represents a prepared statement.
-		 */
-		CacheLocalPlanForShardQuery(task, originalDistributedPlan,
-									estate->es_param_list_info);
-	}
+	/*
+	 * If we are going to execute the tasks locally and they're not already in
+	 * the cache, create local plans now and add them to the cache. During
+	 * execution, we will get the plans from the cache.
+	 *
+	 * WARNING: For deferred pruning, we'll use the original plan with the original
+	 * query tree, meaning parameters and function calls are back and we'll
+	 * redo evaluation in the local (Postgres) executor. The reason we do this
+	 * is that we only need to cache one generic plan per shard.
+	 */
+	CacheLocalPlansForJob(workerJob, originalDistributedPlan,
+						  estate->es_param_list_info);
 
 	MemoryContextSwitchTo(oldContext);
 }
@@ -492,7 +656,7 @@ TryToRerouteFastPathModifyQuery(Job *job)
 	}
 	else
 	{
-		RegenerateTaskForFasthPathQuery(job);
+		RegenerateTaskForFasthPathQuery(job, NULL);
 		RebuildQueryStrings(job);
 	}
 }
@@ -568,21 +732,25 @@ ModifyJobNeedsEvaluation(Job *workerJob)
  * executions of a prepared statement. Instead we create a deep copy that we only
  * use for the current execution.
  *
- * We also exclude localPlannedStatements from the copyObject call for performance
- * reasons, as they are immutable, so no need to have a deep copy.
+ * We also exclude localPlannedStatements and cachedShardQueries from the copyObject
+ * call for performance reasons, as they are immutable, so no need to have a deep copy.
  */
 static DistributedPlan *
 CopyDistributedPlanWithoutCache(DistributedPlan *originalDistributedPlan)
 {
 	List *localPlannedStatements =
 		originalDistributedPlan->workerJob->localPlannedStatements;
+	List *cachedShardQueries = originalDistributedPlan->workerJob->cachedShardQueries;
 	originalDistributedPlan->workerJob->localPlannedStatements = NIL;
+	originalDistributedPlan->workerJob->cachedShardQueries = NIL;
 
 	DistributedPlan *distributedPlan = copyObject(originalDistributedPlan);
 
-	/* set back the immutable field */
+	/* set back the immutable fields */
 	originalDistributedPlan->workerJob->localPlannedStatements = localPlannedStatements;
 	distributedPlan->workerJob->localPlannedStatements = localPlannedStatements;
+	originalDistributedPlan->workerJob->cachedShardQueries = cachedShardQueries;
+	distributedPlan->workerJob->cachedShardQueries = cachedShardQueries;
 
 	return distributedPlan;
 }
@@ -626,14 +794,19 @@ RegenerateTaskListForInsert(Job *workerJob)
 /*
  * RegenerateTaskForFasthPathQuery does the shard pruning for
  * UPDATE/DELETE/SELECT fast path router queries and rebuilds the query strings.
+ *
+ * If the value of the distribution column is already known, it is used for
+ * pruning. If shardQueryCachePlan is not NULL, the query string of the shard
+ * is taken from its shard query cache instead of deparsing the job query.
  */
 static void
-RegenerateTaskForFasthPathQuery(Job *workerJob)
+RegenerateTaskForFasthPathQuery(Job *workerJob, DistributedPlan *shardQueryCachePlan)
 {
 	bool isMultiShardQuery = false;
 	List *shardIntervalList =
 		TargetShardIntervalForFastPathQuery(workerJob->jobQuery,
-											&isMultiShardQuery, NULL,
+											&isMultiShardQuery,
+											workerJob->partitionKeyValue,
 											&workerJob->partitionKeyValue);
 
 	/*
@@ -669,12 +842,549 @@ RegenerateTaskForFasthPathQuery(Job *workerJob)
 		shardId = GetAnchorShardId(shardIntervalList);
 	}
 
+	char *shardQueryString = NULL;
+	if (shardQueryCachePlan != NULL && shardsPresent)
+	{
+		shardQueryString = GetOrCacheShardQueryString(shardQueryCachePlan, shardId,
+													  relationShardList);
+	}
+
 	bool isLocalTableModification = false;
 	GenerateSingleShardRouterTaskList(workerJob,
 									  relationShardList,
 									  placementList,
 									  shardId,
-									  isLocalTableModification);
+									  isLocalTableModification,
+									  shardQueryString);
+}
+
+
+/*
+ * EvaluateDistributionKeyParam returns the value of the parameter that the
+ * distribution column of given fast path query is compared to, or NULL if
+ * there is no such parameter or its value is NULL.
+ */
+static Const *
+EvaluateDistributionKeyParam(Query *jobQuery, PlanState *planState)
+{
+	Node *distributionKeyValue = NULL;
+	if (!FastPathRouterQuery(jobQuery, &distributionKeyValue) ||
+		distributionKeyValue == NULL || !IsA(distributionKeyValue, Param))
+	{
+		return NULL;
+	}
+
+	CoordinatorEvaluationContext coordinatorEvaluationContext = {
+		.planState = planState,
+		.evaluationMode = EVALUATE_PARAMS
+	};
+
+	Node *evaluatedValue = PartiallyEvaluateExpression(distributionKeyValue,
+													   &coordinatorEvaluationContext);
+	if (!IsA(evaluatedValue, Const) || ((Const *) evaluatedValue)->constisnull)
+	{
+		return NULL;
+	}
+
+	return (Const *) evaluatedValue;
+}
+
+
+/*
+ * PruneTaskListByParameters returns the tasks of the given job of a generic
+ * plan that access the shards of its parameter pruning relation that remain
+ * after pruning by the restrictions with the current parameter values. If no
+ * task can be skipped, it returns the task list of the job. We always keep at
+ * least one task, such that the query still returns e.g. the result of an
+ * aggregate over no rows.
+ */
+static List *
+PruneTaskListByParameters(Job *workerJob, PlanState *planState)
+{
+	Oid relationId = workerJob->parameterPruningRelationId;
+	List *taskList = workerJob->taskList;
+
+	CoordinatorEvaluationContext coordinatorEvaluationContext = {
+		.planState = planState,
+		.evaluationMode = EVALUATE_PARAMS
+	};
+
+	Node *clauses = copyObject((Node *) workerJob->parameterPruningClauseList);
+	clauses = PartiallyEvaluateExpression(clauses, &coordinatorEvaluationContext);
+	clauses = eval_const_expressions(NULL, clauses);
+
+	List *prunedShardList = PruneShards(relationId, 1, (List *) clauses, NULL);
+	List *remainingTaskList = NIL;
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		bool taskMatches = true;
+
+		RelationShard *relationShard = NULL;
+		foreach_ptr(relationShard, task->relationShardList)
+		{
+			if (relationShard->relationId != relationId)
+			{
+				continue;
+			}
+
+			taskMatches = false;
+
+			ShardInterval *shardInterval = NULL;
+			foreach_ptr(shardInterval, prunedShardList)
+			{
+				if (shardInterval->shardId == relationShard->shardId)
+				{
+					taskMatches = true;
+					break;
+				}
+			}
+
+			break;
+		}
+
+		if (taskMatches)
+		{
+			remainingTaskList = lappend(remainingTaskList, task);
+		}
+	}
+
+	if (list_length(remainingTaskList) == list_length(taskList))
+	{
+		return taskList;
+	}
+
+	if (remainingTaskList == NIL)
+	{
+		remainingTaskList = list_make1(linitial(taskList));
+	}
+
+	return remainingTaskList;
+}
+
+
+/*
+ * CombineTaskListPerNode replaces the tasks of a multi-shard SELECT on the
+ * same node with a single task that runs the queries of the shard tasks in a
+ * UNION ALL, such that the executor runs and the coordinator merges a task
+ * per node rather than one per shard.
+ *
+ * When the combine query merges the partial aggregates of the tasks, the task
+ * of a node merges the partial aggregates of each group of its shards first,
+ * such that the coordinator receives a row per node and group rather than one
+ * per shard and group. With citus.enable_tdigest_combine_per_node, only
+ * partial tdigests are merged, and with citus.enable_aggregate_combine_per_node
+ * also the partial results of the built-in aggregates that the coordinator
+ * merges with the same or another built-in aggregate, such as counts and sums.
+ * Otherwise, with citus.enable_shard_task_grouping, the task of a node returns
+ * the rows of all of its shards, unless the coordinator relies on the order
+ * of the rows of each task.
+ *
+ * The combined task accesses all of its shards over a single connection,
+ * hence tasks on the local node, and tasks whose placements were already
+ * accessed in the transaction, are left alone. If no tasks can be combined,
+ * it returns the given task list.
+ */
+static List *
+CombineTaskListPerNode(DistributedPlan *distributedPlan, List *taskList)
+{
+	Job *workerJob = distributedPlan->workerJob;
+	Query *workerQuery = workerJob->jobQuery;
+
+	if (list_length(taskList) <= 1 || workerJob->dependentJobList != NIL ||
+		distributedPlan->subPlanList != NIL ||
+		distributedPlan->repartitionedAggregateQuery != NULL ||
+		!workerJob->parametersInJobQueryResolved ||
+		workerJob->requiresCoordinatorEvaluation)
+	{
+		return taskList;
+	}
+
+	StringInfo selectClause = makeStringInfo();
+	StringInfo groupByClause = makeStringInfo();
+	bool mergeAggregates =
+		(EnableAggregateCombinePerNode || EnableTDigestCombinePerNode) &&
+		NodeAggregateCombineClauses(distributedPlan, selectClause, groupByClause);
+
+	/* sorted task results would lose their order, and FOR UPDATE cannot be in a UNION */
+	if (!mergeAggregates &&
+		(!EnableShardTaskGrouping || workerQuery->sortClause != NIL ||
+		 workerQuery->rowMarks != NIL))
+	{
+		return taskList;
+	}
+
+	int columnCount = list_length(workerQuery->targetList);
+	int32 localGroupId = GetLocalGroupId();
+	List *nodeTaskListList = NIL;
+	List *combinedTaskList = NIL;
+	int mergedTaskCount = 0;
+	int mergingNodeCount = 0;
+
+	/* group the tasks by the node of their placement */
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		if (!CanCombineTaskOnNode(task, localGroupId))
+		{
+			combinedTaskList = lappend(combinedTaskList, task);
+			continue;
+		}
+
+		ShardPlacement *placement = linitial(task->taskPlacementList);
+		bool nodeFound = false;
+
+		ListCell *nodeTaskListCell = NULL;
+		foreach(nodeTaskListCell, nodeTaskListList)
+		{
+			List *nodeTaskList = lfirst(nodeTaskListCell);
+			Task *nodeTask = linitial(nodeTaskList);
+			ShardPlacement *nodePlacement = linitial(nodeTask->taskPlacementList);
+
+			if (nodePlacement->groupId == placement->groupId)
+			{
+				lfirst(nodeTaskListCell) = lappend(nodeTaskList, task);
+				nodeFound = true;
+				break;
+			}
+		}
+
+		if (!nodeFound)
+		{
+			nodeTaskListList = lappend(nodeTaskListList, list_make1(task));
+		}
+	}
+
+	List *nodeTaskList = NIL;
+	foreach_ptr(nodeTaskList, nodeTaskListList)
+	{
+		if (list_length(nodeTaskList) == 1)
+		{
+			combinedTaskList = lappend(combinedTaskList, linitial(nodeTaskList));
+			continue;
+		}
+
+		Task *combinedTask = CombineNodeTasks(nodeTaskList, columnCount,
+											  mergeAggregates ? selectClause->data : NULL,
+											  groupByClause->data);
+		combinedTaskList = lappend(combinedTaskList, combinedTask);
+		mergedTaskCount += list_length(nodeTaskList);
+		mergingNodeCount++;
+	}
+
+	if (mergingNodeCount == 0)
+	{
+		return taskList;
+	}
+
+	if (mergeAggregates)
+	{
+		ereport(DEBUG1, (errmsg("merging the partial aggregates of %d tasks on %d "
+								"nodes", mergedTaskCount, mergingNodeCount)));
+	}
+	else
+	{
+		ereport(DEBUG1, (errmsg("grouping %d tasks on %d nodes into a task per node",
+								mergedTaskCount, mergingNodeCount)));
+	}
+
+	return combinedTaskList;
+}
+
+
+/*
+ * NodeAggregateCombineClauses builds the SELECT and GROUP BY clauses of a
+ * query that merges the partial aggregates of the tasks of the given plan on a
+ * node, if the combine query merges the partial aggregates of whole groups
+ * that the task results consist of. Otherwise, it returns false.
+ */
+static bool
+NodeAggregateCombineClauses(DistributedPlan *distributedPlan, StringInfo selectClause,
+							StringInfo groupByClause)
+{
+	Query *workerQuery = distributedPlan->workerJob->jobQuery;
+	Query *combineQuery = distributedPlan->combineQuery;
+
+	if (combineQuery == NULL || !combineQuery->hasAggs)
+	{
+		return false;
+	}
+
+	/* the task results have to be the partial aggregates of whole groups */
+	if (!workerQuery->hasAggs || workerQuery->havingQual != NULL ||
+		workerQuery->groupingSets != NIL || workerQuery->hasWindowFuncs ||
+		workerQuery->distinctClause != NIL || workerQuery->sortClause != NIL ||
+		workerQuery->limitCount != NULL || workerQuery->limitOffset != NULL ||
+		workerQuery->setOperations != NULL)
+	{
+		return false;
+	}
+
+	return NodeCombineClauses(workerQuery, EnableAggregateCombinePerNode, selectClause,
+							  groupByClause) &&
+		   CombineQueryAggregatesColumns(combineQuery, workerQuery);
+}
+
+
+/*
+ * NodeCombineClauses builds the SELECT and GROUP BY clauses of a query that
+ * merges the partial aggregates in the results of the given worker query, whose
+ * columns are named column_1, column_2 and so on. Partial tdigests are merged
+ * with tdigest(tdigest) and, if builtinAggregatesAllowed, the partial results
+ * of built-in aggregates with BuiltinAggregateCombineFunction. It returns false
+ * if the results have columns other than group keys and partial aggregates
+ * that can be merged, or no partial aggregates.
+ */
+static bool
+NodeCombineClauses(Query *workerQuery, bool builtinAggregatesAllowed,
+				   StringInfo selectClause, StringInfo groupByClause)
+{
+	char *tdigestFunctionName = NULL;
+	Oid tdigestAggregateId = InvalidOid;
+	Oid tdigestValueAggregateId = InvalidOid;
+	bool hasAggregates = false;
+	int columnNumber = 1;
+
+	TargetEntry *targetEntry = NULL;
+	foreach_ptr(targetEntry, workerQuery->targetList)
+	{
+		Node *expression = (Node *) targetEntry->expr;
+
+		if (targetEntry->resjunk)
+		{
+			return false;
+		}
+
+		if (columnNumber > 1)
+		{
+			appendStringInfoString(selectClause, ", ");
+		}
+
+		if (IsA(expression, Aggref))
+		{
+			Oid aggregateId = ((Aggref *) expression)->aggfnoid;
+
+			if (get_func_namespace(aggregateId) == PG_CATALOG_NAMESPACE)
+			{
+				if (!builtinAggregatesAllowed)
+				{
+					return false;
+				}
+
+				char *combineFunctionName = BuiltinAggregateCombineFunction(aggregateId);
+				if (combineFunctionName == NULL)
+				{
+					return false;
+				}
+
+				/* e.g. the sum of counts is numeric, the count itself bigint */
+				appendStringInfo(selectClause, "%s(column_%d)::%s", combineFunctionName,
+								 columnNumber,
+								 format_type_be_qualified(exprType(expression)));
+			}
+			else
+			{
+				if (tdigestFunctionName == NULL)
+				{
+					Oid tdigestSchemaId = TDigestExtensionSchema();
+					if (!OidIsValid(tdigestSchemaId))
+					{
+						return false;
+					}
+
+					tdigestFunctionName =
+						quote_qualified_identifier(get_namespace_name(tdigestSchemaId),
+												   "tdigest");
+					tdigestAggregateId = TDigestExtensionAggTDigest1();
+					tdigestValueAggregateId = TDigestExtensionAggTDigest2();
+				}
+
+				/* tdigest(tdigest) and tdigest(value, compression) return partial tdigests */
+				if (aggregateId != tdigestAggregateId &&
+					aggregateId != tdigestValueAggregateId)
+				{
+					return false;
+				}
+
+				appendStringInfo(selectClause, "%s(column_%d)", tdigestFunctionName,
+								 columnNumber);
+			}
+
+			hasAggregates = true;
+		}
+		else if (targetEntry->ressortgroupref != 0 &&
+				 get_sortgroupref_clause_noerr(targetEntry->ressortgroupref,
+											   workerQuery->groupClause) != NULL &&
+				 !contain_agg_clause(expression))
+		{
+			appendStringInfo(selectClause, "column_%d", columnNumber);
+			appendStringInfo(groupByClause, "%s%d",
+							 groupByClause->len == 0 ? " GROUP BY " : ", ",
+							 columnNumber);
+		}
+		else
+		{
+			return false;
+		}
+
+		columnNumber++;
+	}
+
+	return hasAggregates;
+}
+
+
+/*
+ * BuiltinAggregateCombineFunction returns the name of the aggregate that
+ * merges the partial results of the given built-in aggregate, the same way as
+ * the combine query does, or NULL if we do not merge it on the nodes.
+ */
+static char *
+BuiltinAggregateCombineFunction(Oid aggregateId)
+{
+	char *aggregateName = get_func_name(aggregateId);
+
+	if (strcmp(aggregateName, "count") == 0 || strcmp(aggregateName, "sum") == 0)
+	{
+		return "pg_catalog.sum";
+	}
+	else if (strcmp(aggregateName, "min") == 0 || strcmp(aggregateName, "max") == 0 ||
+			 strcmp(aggregateName, "bool_and") == 0 ||
+			 strcmp(aggregateName, "bool_or") == 0 ||
+			 strcmp(aggregateName, "bit_and") == 0 ||
+			 strcmp(aggregateName, "bit_or") == 0)
+	{
+		return psprintf("pg_catalog.%s", aggregateName);
+	}
+	else if (strcmp(aggregateName, "every") == 0)
+	{
+		return "pg_catalog.bool_and";
+	}
+
+	return NULL;
+}
+
+
+/*
+ * CombineQueryAggregatesColumns returns whether the combine query only refers
+ * to the partial aggregates in the results of the worker query within
+ * aggregates, such that merging them on the nodes first does not change what
+ * the combine query computes.
+ */
+static bool
+CombineQueryAggregatesColumns(Query *combineQuery, Query *workerQuery)
+{
+	List *expressionList = list_make2(combineQuery->targetList,
+									  combineQuery->havingQual);
+
+	/* aggregates are returned as a whole, hence we only get the columns outside them */
+	List *columnList = pull_var_clause((Node *) expressionList,
+									   PVC_INCLUDE_AGGREGATES |
+									   PVC_RECURSE_WINDOWFUNCS);
+
+	Node *expression = NULL;
+	foreach_ptr(expression, columnList)
+	{
+		if (!IsA(expression, Var))
+		{
+			continue;
+		}
+
+		Var *column = (Var *) expression;
+		if (column->varattno <= 0 ||
+			column->varattno > list_length(workerQuery->targetList))
+		{
+			return false;
+		}
+
+		TargetEntry *workerTargetEntry = list_nth(workerQuery->targetList,
+												  column->varattno - 1);
+		if (IsA(workerTargetEntry->expr, Aggref))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * CanCombineTaskOnNode returns whether the given task of a multi-shard SELECT
+ * can be combined with the other tasks on the node of its placement.
+ */
+static bool
+CanCombineTaskOnNode(Task *task, int32 localGroupId)
+{
+	if (task->taskType != READ_TASK || list_length(task->taskPlacementList) != 1 ||
+		task->dependentTaskList != NIL)
+	{
+		return false;
+	}
+
+	ShardPlacement *placement = linitial(task->taskPlacementList);
+	if (placement->groupId == localGroupId ||
+		PlacementAccessedInTransaction(placement))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * CombineNodeTasks returns a task that runs the queries of the given tasks on
+ * the same node in a UNION ALL. If selectClause is not NULL, it merges their
+ * partial aggregates with the given SELECT and GROUP BY clauses.
+ */
+static Task *
+CombineNodeTasks(List *nodeTaskList, int columnCount, char *selectClause,
+				 char *groupByClause)
+{
+	Task *combinedTask = copyObject((Task *) linitial(nodeTaskList));
+	StringInfo queryString = makeStringInfo();
+
+	if (selectClause != NULL)
+	{
+		appendStringInfo(queryString, "SELECT %s FROM (", selectClause);
+	}
+
+	combinedTask->relationShardList = NIL;
+
+	Task *task = NULL;
+	foreach_ptr(task, nodeTaskList)
+	{
+		if (task != linitial(nodeTaskList))
+		{
+			appendStringInfoString(queryString, " UNION ALL ");
+		}
+
+		appendStringInfo(queryString, "(%s)", TaskQueryString(task));
+
+		/* the executor locks and records accesses to all shards of the task */
+		combinedTask->relationShardList =
+			list_concat(combinedTask->relationShardList,
+						copyObject(task->relationShardList));
+	}
+
+	if (selectClause != NULL)
+	{
+		appendStringInfoString(queryString, ") node_partials (");
+
+		for (int columnNumber = 1; columnNumber <= columnCount; columnNumber++)
+		{
+			appendStringInfo(queryString, "%scolumn_%d", columnNumber > 1 ? ", " : "",
+							 columnNumber);
+		}
+
+		appendStringInfo(queryString, ")%s", groupByClause);
+	}
+
+	SetTaskQueryString(combinedTask, queryString->data);
+
+	return combinedTask;
 }
 
 
@@ -777,6 +1487,12 @@ CitusEndScan(CustomScanState *node)
 	Const *partitionKeyConst = NULL;
 	char *partitionKeyString = NULL;
 
+	/* cancel the tasks whose rows the combine query no longer reads */
+	if (scanState->incrementalExecution != NULL)
+	{
+		StopAdaptiveExecutor(scanState);
+	}
+
 	/* stop propagating notices */
 	DisableWorkerMessagePropagation();
 
@@ -803,8 +1519,37 @@ CitusEndScan(CustomScanState *node)
 											   partitionKeyConst->consttype);
 		}
 
+		double *planningPhaseTimes = NULL;
+		if (scanState->firstExecution)
+		{
+			planningPhaseTimes = scanState->distributedPlan->planningPhaseTimes;
+		}
+
+		instr_time executionTime;
+		INSTR_TIME_SET_CURRENT(executionTime);
+		INSTR_TIME_SUBTRACT(executionTime, scanState->executionStartTime);
+
+		double remoteWaitTime = GetRemoteWaitTime() - scanState->remoteWaitTimeAtStart;
+
+		IntermediateResultStats intermediateResultStats;
+		GetIntermediateResultStats(&intermediateResultStats);
+		SubtractIntermediateResultStats(&intermediateResultStats,
+										&scanState->intermediateResultStatsAtStart);
+
 		/* queries without partition key are also recorded */
-		CitusQueryStatsExecutorsEntry(queryId, executorType, partitionKeyString);
+		CitusQueryStatsExecutorsEntry(queryId, executorType, partitionKeyString,
+									  planningPhaseTimes,
+									  INSTR_TIME_GET_MILLISEC(executionTime),
+									  remoteWaitTime, &intermediateResultStats);
+	}
+
+	if (scanState->logDistributedPlan)
+	{
+		instr_time executionTime;
+		INSTR_TIME_SET_CURRENT(executionTime);
+		INSTR_TIME_SUBTRACT(executionTime, scanState->executionStartTime);
+
+		LogDistributedPlanIfSlow(scanState, INSTR_TIME_GET_MILLISEC(executionTime));
 	}
 
 	if (scanState->tuplestorestate)
@@ -829,6 +1574,13 @@ CitusReScan(CustomScanState *node)
 	ExecScanReScan(&node->ss);
 
 	CitusScanState *scanState = (CitusScanState *) node;
+	if (scanState->discardedTaskResults)
+	{
+		ereport(ERROR, (errmsg("cannot rescan a distributed query whose task "
+							   "results were combined incrementally"),
+						errhint("Set citus.enable_incremental_combine to off.")));
+	}
+
 	if (scanState->tuplestorestate)
 	{
 		tuplestore_rescan(scanState->tuplestorestate);
@@ -858,6 +1610,134 @@ ScanStateGetExecutorState(CitusScanState *scanState)
 }
 
 
+/*
+ * MergeSortedTaskResults merges the given tuple stores, which hold the results
+ * of the tasks in the order of the task list, into the tuple store of the scan
+ * by the ORDER BY of the worker query. Since each task returns its rows in
+ * that order, the combine query can rely on the merged order rather than
+ * sorting all the rows on the coordinator.
+ */
+void
+MergeSortedTaskResults(CitusScanState *scanState, List *taskTupleStoreList)
+{
+	Query *workerQuery = scanState->distributedPlan->workerJob->jobQuery;
+	TupleDesc tupleDescriptor = ScanStateGetTupleDescriptor(scanState);
+	int taskCount = list_length(taskTupleStoreList);
+
+	/* merge by the sort keys up to the first one the workers do not return */
+	SortedMergeState mergeState = { 0 };
+	mergeState.sortKeys = palloc0(list_length(workerQuery->sortClause) *
+								  sizeof(SortSupportData));
+
+	SortGroupClause *sortClause = NULL;
+	foreach_ptr(sortClause, workerQuery->sortClause)
+	{
+		AttrNumber columnId = WorkerSortColumnId(workerQuery->targetList, sortClause);
+		if (columnId == InvalidAttrNumber)
+		{
+			break;
+		}
+
+		Form_pg_attribute sortColumn = TupleDescAttr(tupleDescriptor, columnId - 1);
+
+		SortSupport sortKey = &mergeState.sortKeys[mergeState.sortKeyCount];
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = sortColumn->attcollation;
+		sortKey->ssup_nulls_first = sortClause->nulls_first;
+		sortKey->ssup_attno = columnId;
+		sortKey->abbreviate = false;
+
+		PrepareSortSupportFromOrderingOp(sortClause->sortop, sortKey);
+
+		mergeState.sortKeyCount++;
+	}
+
+	/* read the first row of each task into the heap */
+	mergeState.taskSlots = palloc0(taskCount * sizeof(TupleTableSlot *));
+	binaryheap *mergeHeap = binaryheap_allocate(Max(taskCount, 1), CompareTaskSlots,
+												&mergeState);
+
+	for (int taskIndex = 0; taskIndex < taskCount; taskIndex++)
+	{
+		Tuplestorestate *taskTupleStore = list_nth(taskTupleStoreList, taskIndex);
+		TupleTableSlot *taskSlot = MakeSingleTupleTableSlot(tupleDescriptor,
+															&TTSOpsMinimalTuple);
+		mergeState.taskSlots[taskIndex] = taskSlot;
+
+		if (tuplestore_gettupleslot(taskTupleStore, true, false, taskSlot))
+		{
+			binaryheap_add_unordered(mergeHeap, Int32GetDatum(taskIndex));
+		}
+	}
+
+	binaryheap_build(mergeHeap);
+
+	/* repeatedly move the smallest current row to the tuple store of the scan */
+	while (!binaryheap_empty(mergeHeap))
+	{
+		int taskIndex = DatumGetInt32(binaryheap_first(mergeHeap));
+		Tuplestorestate *taskTupleStore = list_nth(taskTupleStoreList, taskIndex);
+		TupleTableSlot *taskSlot = mergeState.taskSlots[taskIndex];
+
+		tuplestore_puttupleslot(scanState->tuplestorestate, taskSlot);
+
+		if (tuplestore_gettupleslot(taskTupleStore, true, false, taskSlot))
+		{
+			binaryheap_replace_first(mergeHeap, Int32GetDatum(taskIndex));
+		}
+		else
+		{
+			binaryheap_remove_first(mergeHeap);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	for (int taskIndex = 0; taskIndex < taskCount; taskIndex++)
+	{
+		ExecDropSingleTupleTableSlot(mergeState.taskSlots[taskIndex]);
+		tuplestore_end(list_nth(taskTupleStoreList, taskIndex));
+	}
+
+	binaryheap_free(mergeHeap);
+}
+
+
+/*
+ * CompareTaskSlots compares the current rows of two tasks by the sort keys of
+ * the merge. Since binaryheap is a max-heap, the result is inverted such that
+ * the smallest row comes first.
+ */
+static int
+CompareTaskSlots(Datum leftTaskIndex, Datum rightTaskIndex, void *arg)
+{
+	SortedMergeState *mergeState = (SortedMergeState *) arg;
+	TupleTableSlot *leftSlot = mergeState->taskSlots[DatumGetInt32(leftTaskIndex)];
+	TupleTableSlot *rightSlot = mergeState->taskSlots[DatumGetInt32(rightTaskIndex)];
+
+	for (int sortKeyIndex = 0; sortKeyIndex < mergeState->sortKeyCount; sortKeyIndex++)
+	{
+		SortSupport sortKey = &mergeState->sortKeys[sortKeyIndex];
+		AttrNumber columnId = sortKey->ssup_attno;
+		bool leftIsNull = false;
+		bool rightIsNull = false;
+
+		Datum leftDatum = slot_getattr(leftSlot, columnId, &leftIsNull);
+		Datum rightDatum = slot_getattr(rightSlot, columnId, &rightIsNull);
+
+		int compareResult = ApplySortComparator(leftDatum, leftIsNull,
+												rightDatum, rightIsNull, sortKey);
+		if (compareResult != 0)
+		{
+			INVERT_COMPARE_RESULT(compareResult);
+			return compareResult;
+		}
+	}
+
+	return 0;
+}
+
+
 /*
  * FetchCitusCustomScanIfExists traverses a given plan and returns a Citus CustomScan
  * if it has any.
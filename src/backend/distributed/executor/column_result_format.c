@@ -0,0 +1,857 @@
+/*-------------------------------------------------------------------------
+ *
+ * column_result_format.c
+ *	  Column-oriented, compressed format for intermediate result files.
+ *
+ *	  When citus.intermediate_result_format is set to columnar, intermediate
+ *	  results are written in stripes of up to COLUMN_RESULT_STRIPE_ROW_COUNT
+ *	  rows instead of as COPY data. Within a stripe, the values of a column
+ *	  are stored together in a chunk, which is compressed in frames of up to
+ *	  RESULT_COMPRESSION_FRAME_SIZE bytes using the compression that is set
+ *	  in citus.intermediate_result_compression. A file looks as follows:
+ *
+ *	  signature, format version, compression, column count
+ *	  per column: type, whether values are in binary format, name
+ *	  per stripe: row count, per column: chunk length, chunk
+ *	  a row count of 0 to mark the end of the file
+ *
+ *	  Integers are in network byte order, and values are stored as in binary
+ *	  COPY as a length (-1 for NULL) followed by the binary or the text
+ *	  representation of the value.
+ *
+ *	  Since chunks start with their length, read_intermediate_result skips
+ *	  the chunks of the columns that it does not need without decompressing
+ *	  them. If the column definition list has fewer columns than the file,
+ *	  its columns are looked up by name, such that only those are read.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/transam.h"
+#include "libpq/pqformat.h"
+#include "port/pg_bswap.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+#include "distributed/citus_safe_lib.h"
+#include "distributed/column_result_format.h"
+#include "distributed/commands/multi_copy.h"
+
+
+#define COLUMN_RESULT_SIGNATURE_LENGTH 11
+#define COLUMN_RESULT_FORMAT_VERSION 1
+
+/* a stripe ends when it has this many rows or this many bytes of values */
+#define COLUMN_RESULT_STRIPE_ROW_COUNT 10000
+#define COLUMN_RESULT_STRIPE_SIZE (1024 * 1024)
+
+
+/* a column of the tuples that a ColumnResultWriter writes */
+typedef struct ColumnResultWriterColumn
+{
+	int attributeIndex;
+	Oid typeId;
+	bool binary;
+	FmgrInfo outputFunction;
+
+	/* encoded values of the current stripe */
+	StringInfo data;
+} ColumnResultWriterColumn;
+
+
+struct ColumnResultWriter
+{
+	TupleDesc tupleDescriptor;
+	ResultCompressionType compressionType;
+
+	int columnCount;
+	ColumnResultWriterColumn *columns;
+
+	/* number of rows and bytes of values in the current stripe */
+	int stripeRowCount;
+	int stripeSize;
+
+	StringInfo compressedFrame;
+};
+
+
+/* a column-oriented result that is read from a file or from memory */
+typedef struct ColumnResultSource
+{
+	/* name of the file, or of the file that the result would be in */
+	const char *fileName;
+
+	/* the opened file, or NULL when reading from resultData */
+	FILE *file;
+	StringInfo resultData;
+} ColumnResultSource;
+
+
+/* a column as described in the header of a file */
+typedef struct ColumnResultFileColumn
+{
+	Oid typeId;
+	bool binary;
+	char *columnName;
+} ColumnResultFileColumn;
+
+
+/*
+ * The signature contains "\377" and "\0", so a text or csv COPY file cannot
+ * start with it, and it differs from the signature of binary COPY files.
+ */
+static const char ColumnResultSignature[COLUMN_RESULT_SIGNATURE_LENGTH] =
+	"CITUSCOL\n\377";
+
+
+/* GUC, format in which intermediate results are written */
+int IntermediateResultFormat = INTERMEDIATE_RESULT_FORMAT_COPY;
+
+
+/* local function declarations */
+static void AppendColumnResultString(StringInfo output, const char *string);
+static void AppendColumnChunk(ColumnResultWriter *writer, StringInfo columnData,
+							  StringInfo output);
+static int * MapResultColumns(ColumnResultFileColumn *fileColumns, int fileColumnCount,
+							  TupleDesc tupleDescriptor);
+static int FindResultColumnByName(ColumnResultFileColumn *fileColumns,
+								  int fileColumnCount, const char *columnName);
+static void ReadColumnResultIntoTupleStore(ColumnResultSource *source,
+										   TupleDesc tupleDescriptor,
+										   Tuplestorestate *tupleStore);
+static StringInfo ReadColumnChunk(ColumnResultSource *source, uint32 chunkLength,
+								  ResultCompressionType compressionType,
+								  StringInfo compressedFrame);
+static void ReadColumnResultData(ColumnResultSource *source, char *data, uint32 length);
+static void SkipColumnResultData(ColumnResultSource *source, uint32 length);
+static uint32 ReadColumnResultInt32(ColumnResultSource *source);
+static char * ReadColumnResultString(ColumnResultSource *source);
+static void ErrorCorruptColumnResultFile(const char *fileName) pg_attribute_noreturn();
+
+
+/*
+ * CreateColumnResultWriter creates a writer that encodes tuples with the given
+ * descriptor in stripes, whose column chunks it compresses with the given
+ * compression.
+ */
+ColumnResultWriter *
+CreateColumnResultWriter(TupleDesc tupleDescriptor, ResultCompressionType compressionType)
+{
+	ColumnResultWriter *writer = palloc0(sizeof(ColumnResultWriter));
+	writer->tupleDescriptor = tupleDescriptor;
+	writer->compressionType = compressionType;
+	writer->columns = palloc0(tupleDescriptor->natts * sizeof(ColumnResultWriterColumn));
+	writer->compressedFrame = makeStringInfo();
+
+	for (int attributeIndex = 0; attributeIndex < tupleDescriptor->natts;
+		 attributeIndex++)
+	{
+		Form_pg_attribute attribute = TupleDescAttr(tupleDescriptor, attributeIndex);
+		Oid outputFunctionId = InvalidOid;
+		bool typeVarLength = false;
+
+		if (attribute->attisdropped)
+		{
+			continue;
+		}
+
+		ColumnResultWriterColumn *column = &writer->columns[writer->columnCount];
+		column->attributeIndex = attributeIndex;
+		column->typeId = attribute->atttypid;
+		column->binary = CanUseBinaryCopyFormatForType(attribute->atttypid);
+		column->data = makeStringInfo();
+
+		if (column->binary)
+		{
+			getTypeBinaryOutputInfo(column->typeId, &outputFunctionId, &typeVarLength);
+		}
+		else
+		{
+			getTypeOutputInfo(column->typeId, &outputFunctionId, &typeVarLength);
+		}
+
+		fmgr_info(outputFunctionId, &column->outputFunction);
+
+		writer->columnCount++;
+	}
+
+	return writer;
+}
+
+
+/*
+ * ColumnResultWriterAppendHeader appends the header of a file, which describes
+ * the columns of the writer, to output.
+ */
+void
+ColumnResultWriterAppendHeader(ColumnResultWriter *writer, StringInfo output)
+{
+	appendBinaryStringInfo(output, ColumnResultSignature,
+						   COLUMN_RESULT_SIGNATURE_LENGTH);
+	pq_sendint32(output, COLUMN_RESULT_FORMAT_VERSION);
+	AppendColumnResultString(output, ResultCompressionName(writer->compressionType));
+	pq_sendint32(output, writer->columnCount);
+
+	for (int columnIndex = 0; columnIndex < writer->columnCount; columnIndex++)
+	{
+		ColumnResultWriterColumn *column = &writer->columns[columnIndex];
+		Form_pg_attribute attribute = TupleDescAttr(writer->tupleDescriptor,
+													column->attributeIndex);
+
+		pq_sendint32(output, column->typeId);
+		pq_sendbyte(output, column->binary ? 1 : 0);
+		AppendColumnResultString(output, NameStr(attribute->attname));
+	}
+}
+
+
+/*
+ * ColumnResultWriterAddRow adds a row to the current stripe and returns
+ * whether the stripe is full, in which case the caller should append it to
+ * the output.
+ */
+bool
+ColumnResultWriterAddRow(ColumnResultWriter *writer, Datum *columnValues,
+						 bool *columnNulls)
+{
+	for (int columnIndex = 0; columnIndex < writer->columnCount; columnIndex++)
+	{
+		ColumnResultWriterColumn *column = &writer->columns[columnIndex];
+		int attributeIndex = column->attributeIndex;
+		StringInfo columnData = column->data;
+		int previousLength = columnData->len;
+
+		if (columnNulls[attributeIndex])
+		{
+			pq_sendint32(columnData, -1);
+		}
+		else if (column->binary)
+		{
+			bytea *valueBytes = SendFunctionCall(&column->outputFunction,
+												 columnValues[attributeIndex]);
+			int valueLength = VARSIZE(valueBytes) - VARHDRSZ;
+
+			pq_sendint32(columnData, valueLength);
+			pq_sendbytes(columnData, VARDATA(valueBytes), valueLength);
+		}
+		else
+		{
+			char *valueString = OutputFunctionCall(&column->outputFunction,
+												   columnValues[attributeIndex]);
+			int valueLength = strlen(valueString);
+
+			pq_sendint32(columnData, valueLength);
+			pq_sendbytes(columnData, valueString, valueLength);
+		}
+
+		writer->stripeSize += columnData->len - previousLength;
+	}
+
+	writer->stripeRowCount++;
+
+	return writer->stripeRowCount >= COLUMN_RESULT_STRIPE_ROW_COUNT ||
+		   writer->stripeSize >= COLUMN_RESULT_STRIPE_SIZE;
+}
+
+
+/*
+ * ColumnResultWriterAppendStripe appends the rows of the current stripe to
+ * output and starts a new stripe. It appends nothing if the stripe is empty.
+ */
+void
+ColumnResultWriterAppendStripe(ColumnResultWriter *writer, StringInfo output)
+{
+	if (writer->stripeRowCount == 0)
+	{
+		return;
+	}
+
+	pq_sendint32(output, writer->stripeRowCount);
+
+	for (int columnIndex = 0; columnIndex < writer->columnCount; columnIndex++)
+	{
+		ColumnResultWriterColumn *column = &writer->columns[columnIndex];
+
+		AppendColumnChunk(writer, column->data, output);
+		resetStringInfo(column->data);
+	}
+
+	writer->stripeRowCount = 0;
+	writer->stripeSize = 0;
+}
+
+
+/*
+ * ColumnResultWriterAppendFooter appends the end of file marker to output.
+ */
+void
+ColumnResultWriterAppendFooter(ColumnResultWriter *writer, StringInfo output)
+{
+	Assert(writer->stripeRowCount == 0);
+
+	pq_sendint32(output, 0);
+}
+
+
+/*
+ * AppendColumnResultString appends a string to output, preceded by its length.
+ */
+static void
+AppendColumnResultString(StringInfo output, const char *string)
+{
+	int stringLength = strlen(string);
+
+	pq_sendint32(output, stringLength);
+	pq_sendbytes(output, string, stringLength);
+}
+
+
+/*
+ * AppendColumnChunk appends the values of a column in the current stripe to
+ * output, preceded by the length of the chunk. The values are compressed in
+ * frames, each of which is preceded by its length.
+ */
+static void
+AppendColumnChunk(ColumnResultWriter *writer, StringInfo columnData, StringInfo output)
+{
+	StringInfo compressedFrame = writer->compressedFrame;
+
+	if (writer->compressionType == RESULT_COMPRESSION_NONE)
+	{
+		pq_sendint32(output, columnData->len);
+		appendBinaryStringInfo(output, columnData->data, columnData->len);
+		return;
+	}
+
+	/* the chunk length is filled in once we know the length of the frames */
+	int chunkLengthOffset = output->len;
+	pq_sendint32(output, 0);
+
+	for (int offset = 0; offset < columnData->len;
+		 offset += RESULT_COMPRESSION_FRAME_SIZE)
+	{
+		int frameLength = Min(columnData->len - offset, RESULT_COMPRESSION_FRAME_SIZE);
+
+		CompressResultFrame(writer->compressionType, columnData->data + offset,
+							frameLength, compressedFrame);
+
+		pq_sendint32(output, compressedFrame->len);
+		appendBinaryStringInfo(output, compressedFrame->data, compressedFrame->len);
+	}
+
+	uint32 chunkLength = pg_hton32(output->len - chunkLengthOffset - sizeof(uint32));
+	memcpy_s(output->data + chunkLengthOffset, sizeof(uint32), &chunkLength,
+			 sizeof(uint32));
+}
+
+
+/*
+ * IsColumnResultFile returns whether the given intermediate result file is in
+ * the column-oriented format.
+ */
+bool
+IsColumnResultFile(const char *fileName)
+{
+	char signature[COLUMN_RESULT_SIGNATURE_LENGTH];
+
+	FILE *file = AllocateFile(fileName, PG_BINARY_R);
+	if (file == NULL)
+	{
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("could not open file \"%s\": %m", fileName)));
+	}
+
+	size_t bytesRead = fread(signature, 1, COLUMN_RESULT_SIGNATURE_LENGTH, file);
+
+	FreeFile(file);
+
+	return bytesRead == COLUMN_RESULT_SIGNATURE_LENGTH &&
+		   memcmp(signature, ColumnResultSignature,
+				  COLUMN_RESULT_SIGNATURE_LENGTH) == 0;
+}
+
+
+/*
+ * IsColumnResultData returns whether the given intermediate result data is in
+ * the column-oriented format.
+ */
+bool
+IsColumnResultData(StringInfo resultData)
+{
+	return resultData->len >= COLUMN_RESULT_SIGNATURE_LENGTH &&
+		   memcmp(resultData->data, ColumnResultSignature,
+				  COLUMN_RESULT_SIGNATURE_LENGTH) == 0;
+}
+
+
+/*
+ * ReadColumnResultFileIntoTupleStore reads the columns of the given column-
+ * oriented result file that appear in the tuple descriptor and stores the
+ * rows in the tuple store.
+ */
+void
+ReadColumnResultFileIntoTupleStore(const char *fileName, TupleDesc tupleDescriptor,
+								   Tuplestorestate *tupleStore)
+{
+	ColumnResultSource source = { fileName, NULL, NULL };
+
+	source.file = AllocateFile(fileName, PG_BINARY_R);
+	if (source.file == NULL)
+	{
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("could not open file \"%s\": %m", fileName)));
+	}
+
+	ReadColumnResultIntoTupleStore(&source, tupleDescriptor, tupleStore);
+
+	FreeFile(source.file);
+}
+
+
+/*
+ * ReadColumnResultDataIntoTupleStore is the same as
+ * ReadColumnResultFileIntoTupleStore for a column-oriented result that is in
+ * memory. The file name is only used in error messages.
+ */
+void
+ReadColumnResultDataIntoTupleStore(const char *fileName, StringInfo resultData,
+								   TupleDesc tupleDescriptor,
+								   Tuplestorestate *tupleStore)
+{
+	ColumnResultSource source = { fileName, NULL, resultData };
+
+	resultData->cursor = 0;
+
+	ReadColumnResultIntoTupleStore(&source, tupleDescriptor, tupleStore);
+}
+
+
+/*
+ * ReadColumnResultIntoTupleStore reads a column-oriented result from the
+ * given source into the tuple store.
+ */
+static void
+ReadColumnResultIntoTupleStore(ColumnResultSource *source, TupleDesc tupleDescriptor,
+							   Tuplestorestate *tupleStore)
+{
+	const char *fileName = source->fileName;
+	char signature[COLUMN_RESULT_SIGNATURE_LENGTH];
+	int columnCount = tupleDescriptor->natts;
+
+	ReadColumnResultData(source, signature, COLUMN_RESULT_SIGNATURE_LENGTH);
+	if (memcmp(signature, ColumnResultSignature, COLUMN_RESULT_SIGNATURE_LENGTH) != 0)
+	{
+		ErrorCorruptColumnResultFile(fileName);
+	}
+
+	uint32 formatVersion = ReadColumnResultInt32(source);
+	if (formatVersion != COLUMN_RESULT_FORMAT_VERSION)
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("intermediate result file \"%s\" has unsupported "
+							   "format version %u", fileName, formatVersion)));
+	}
+
+	char *compressionName = ReadColumnResultString(source);
+	ResultCompressionType compressionType =
+		ResultCompressionTypeFromName(compressionName);
+
+	uint32 fileColumnCountValue = ReadColumnResultInt32(source);
+	if (fileColumnCountValue > MaxTupleAttributeNumber)
+	{
+		ErrorCorruptColumnResultFile(fileName);
+	}
+
+	int fileColumnCount = (int) fileColumnCountValue;
+
+	ColumnResultFileColumn *fileColumns =
+		palloc0(Max(fileColumnCount, 1) * sizeof(ColumnResultFileColumn));
+
+	for (int fileColumnIndex = 0; fileColumnIndex < fileColumnCount; fileColumnIndex++)
+	{
+		ColumnResultFileColumn *fileColumn = &fileColumns[fileColumnIndex];
+		char binaryFlag = 0;
+
+		fileColumn->typeId = ReadColumnResultInt32(source);
+		ReadColumnResultData(source, &binaryFlag, sizeof(binaryFlag));
+		fileColumn->binary = (binaryFlag != 0);
+		fileColumn->columnName = ReadColumnResultString(source);
+	}
+
+	int *fileColumnIndexes = MapResultColumns(fileColumns, fileColumnCount,
+											  tupleDescriptor);
+
+	FmgrInfo *inputFunctions = palloc0(Max(columnCount, 1) * sizeof(FmgrInfo));
+	Oid *typeIOParams = palloc0(Max(columnCount, 1) * sizeof(Oid));
+	bool *fileColumnNeeded = palloc0(Max(fileColumnCount, 1) * sizeof(bool));
+
+	for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		Form_pg_attribute attribute = TupleDescAttr(tupleDescriptor, columnIndex);
+		int fileColumnIndex = fileColumnIndexes[columnIndex];
+		Oid inputFunctionId = InvalidOid;
+
+		if (fileColumns[fileColumnIndex].binary)
+		{
+			getTypeBinaryInputInfo(attribute->atttypid, &inputFunctionId,
+								   &typeIOParams[columnIndex]);
+		}
+		else
+		{
+			getTypeInputInfo(attribute->atttypid, &inputFunctionId,
+							 &typeIOParams[columnIndex]);
+		}
+
+		fmgr_info(inputFunctionId, &inputFunctions[columnIndex]);
+		fileColumnNeeded[fileColumnIndex] = true;
+	}
+
+	Datum *columnValues = palloc0(Max(columnCount, 1) * sizeof(Datum));
+	bool *columnNulls = palloc0(Max(columnCount, 1) * sizeof(bool));
+	StringInfo *chunks = palloc0(Max(fileColumnCount, 1) * sizeof(StringInfo));
+	StringInfo compressedFrame = makeStringInfo();
+	StringInfo valueData = makeStringInfo();
+
+	MemoryContext stripeContext = AllocSetContextCreate(CurrentMemoryContext,
+														"Column Result Stripe Context",
+														ALLOCSET_DEFAULT_SIZES);
+
+	while (true)
+	{
+		uint32 rowCount = ReadColumnResultInt32(source);
+		if (rowCount == 0)
+		{
+			break;
+		}
+
+		MemoryContext oldContext = MemoryContextSwitchTo(stripeContext);
+
+		for (int fileColumnIndex = 0; fileColumnIndex < fileColumnCount;
+			 fileColumnIndex++)
+		{
+			uint32 chunkLength = ReadColumnResultInt32(source);
+
+			if (!fileColumnNeeded[fileColumnIndex])
+			{
+				/* skip the chunks of columns that we do not return */
+				SkipColumnResultData(source, chunkLength);
+				continue;
+			}
+
+			chunks[fileColumnIndex] = ReadColumnChunk(source, chunkLength,
+													  compressionType, compressedFrame);
+		}
+
+		for (uint32 rowIndex = 0; rowIndex < rowCount; rowIndex++)
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+			{
+				Form_pg_attribute attribute = TupleDescAttr(tupleDescriptor,
+															columnIndex);
+				int fileColumnIndex = fileColumnIndexes[columnIndex];
+				StringInfo chunk = chunks[fileColumnIndex];
+
+				int valueLength = pq_getmsgint(chunk, sizeof(int32));
+				if (valueLength == -1)
+				{
+					columnValues[columnIndex] = (Datum) 0;
+					columnNulls[columnIndex] = true;
+					continue;
+				}
+
+				resetStringInfo(valueData);
+				appendBinaryStringInfo(valueData, pq_getmsgbytes(chunk, valueLength),
+									   valueLength);
+
+				if (fileColumns[fileColumnIndex].binary)
+				{
+					columnValues[columnIndex] =
+						ReceiveFunctionCall(&inputFunctions[columnIndex], valueData,
+											typeIOParams[columnIndex],
+											attribute->atttypmod);
+				}
+				else
+				{
+					columnValues[columnIndex] =
+						InputFunctionCall(&inputFunctions[columnIndex], valueData->data,
+										  typeIOParams[columnIndex],
+										  attribute->atttypmod);
+				}
+
+				columnNulls[columnIndex] = false;
+			}
+
+			tuplestore_putvalues(tupleStore, tupleDescriptor, columnValues, columnNulls);
+		}
+
+		MemoryContextSwitchTo(oldContext);
+		MemoryContextReset(stripeContext);
+	}
+
+	MemoryContextDelete(stripeContext);
+}
+
+
+/*
+ * MapResultColumns returns for each column in the tuple descriptor the index
+ * of the column in the file that it reads. When the tuple descriptor has as
+ * many columns as the file, columns are matched by position as with COPY.
+ * When it has fewer columns, they are matched by name.
+ */
+static int *
+MapResultColumns(ColumnResultFileColumn *fileColumns, int fileColumnCount,
+				 TupleDesc tupleDescriptor)
+{
+	int columnCount = tupleDescriptor->natts;
+	int *fileColumnIndexes = palloc0(Max(columnCount, 1) * sizeof(int));
+	bool *fileColumnUsed = palloc0(Max(fileColumnCount, 1) * sizeof(bool));
+
+	if (columnCount > fileColumnCount)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DATATYPE_MISMATCH),
+						errmsg("column definition list has %d columns, but the "
+							   "intermediate result has %d columns",
+							   columnCount, fileColumnCount)));
+	}
+
+	for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		Form_pg_attribute attribute = TupleDescAttr(tupleDescriptor, columnIndex);
+		char *columnName = NameStr(attribute->attname);
+		int fileColumnIndex = columnIndex;
+
+		if (columnCount < fileColumnCount)
+		{
+			fileColumnIndex = FindResultColumnByName(fileColumns, fileColumnCount,
+													 columnName);
+			if (fileColumnIndex < 0)
+			{
+				ereport(ERROR, (errcode(ERRCODE_UNDEFINED_COLUMN),
+								errmsg("column \"%s\" does not exist in the "
+									   "intermediate result", columnName)));
+			}
+		}
+
+		if (fileColumnUsed[fileColumnIndex])
+		{
+			ereport(ERROR, (errcode(ERRCODE_DUPLICATE_COLUMN),
+							errmsg("column \"%s\" of the intermediate result is "
+								   "specified more than once", columnName)));
+		}
+
+		/*
+		 * Other types may have different OIDs on different nodes, so we can
+		 * only check that the types of built-in types match.
+		 */
+		ColumnResultFileColumn *fileColumn = &fileColumns[fileColumnIndex];
+		if (fileColumn->binary && fileColumn->typeId != attribute->atttypid &&
+			fileColumn->typeId < FirstNormalObjectId &&
+			attribute->atttypid < FirstNormalObjectId)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DATATYPE_MISMATCH),
+							errmsg("column \"%s\" has type %s in the column definition "
+								   "list, but type %s in the intermediate result",
+								   columnName, format_type_be(attribute->atttypid),
+								   format_type_be(fileColumn->typeId))));
+		}
+
+		fileColumnIndexes[columnIndex] = fileColumnIndex;
+		fileColumnUsed[fileColumnIndex] = true;
+	}
+
+	return fileColumnIndexes;
+}
+
+
+/*
+ * FindResultColumnByName returns the index of the only column in the file
+ * with the given name, or -1 if there is no such column.
+ */
+static int
+FindResultColumnByName(ColumnResultFileColumn *fileColumns, int fileColumnCount,
+					   const char *columnName)
+{
+	int matchingColumnIndex = -1;
+
+	for (int fileColumnIndex = 0; fileColumnIndex < fileColumnCount; fileColumnIndex++)
+	{
+		if (strcmp(fileColumns[fileColumnIndex].columnName, columnName) != 0)
+		{
+			continue;
+		}
+
+		if (matchingColumnIndex >= 0)
+		{
+			ereport(ERROR, (errcode(ERRCODE_AMBIGUOUS_COLUMN),
+							errmsg("column reference \"%s\" is ambiguous in the "
+								   "intermediate result", columnName)));
+		}
+
+		matchingColumnIndex = fileColumnIndex;
+	}
+
+	return matchingColumnIndex;
+}
+
+
+/*
+ * ReadColumnChunk reads a column chunk of the given length and returns its
+ * decompressed values.
+ */
+static StringInfo
+ReadColumnChunk(ColumnResultSource *source, uint32 chunkLength,
+				ResultCompressionType compressionType, StringInfo compressedFrame)
+{
+	StringInfo chunk = makeStringInfo();
+
+	if (compressionType == RESULT_COMPRESSION_NONE)
+	{
+		enlargeStringInfo(chunk, chunkLength);
+		ReadColumnResultData(source, chunk->data, chunkLength);
+		chunk->len = chunkLength;
+		chunk->data[chunk->len] = '\0';
+
+		return chunk;
+	}
+
+	uint64 bytesRead = 0;
+	while (bytesRead < chunkLength)
+	{
+		uint32 frameLength = ReadColumnResultInt32(source);
+
+		bytesRead += sizeof(uint32) + (uint64) frameLength;
+		if (bytesRead > chunkLength)
+		{
+			ErrorCorruptColumnResultFile(source->fileName);
+		}
+
+		resetStringInfo(compressedFrame);
+		enlargeStringInfo(compressedFrame, frameLength);
+		ReadColumnResultData(source, compressedFrame->data, frameLength);
+		compressedFrame->len = frameLength;
+
+		DecompressResultFrame(compressionType, compressedFrame->data, frameLength,
+							  chunk);
+	}
+
+	return chunk;
+}
+
+
+/*
+ * ReadColumnResultData reads the given number of bytes from the source, and
+ * errors out if the result ends before that.
+ */
+static void
+ReadColumnResultData(ColumnResultSource *source, char *data, uint32 length)
+{
+	if (source->file == NULL)
+	{
+		StringInfo resultData = source->resultData;
+
+		if ((uint32) (resultData->len - resultData->cursor) < length)
+		{
+			ErrorCorruptColumnResultFile(source->fileName);
+		}
+
+		if (length > 0)
+		{
+			memcpy_s(data, length, resultData->data + resultData->cursor, length);
+		}
+
+		resultData->cursor += length;
+	}
+	else if (fread(data, 1, length, source->file) != length)
+	{
+		if (ferror(source->file))
+		{
+			ereport(ERROR, (errcode_for_file_access(),
+							errmsg("could not read file \"%s\": %m",
+								   source->fileName)));
+		}
+
+		ErrorCorruptColumnResultFile(source->fileName);
+	}
+}
+
+
+/*
+ * SkipColumnResultData skips the given number of bytes of the source.
+ */
+static void
+SkipColumnResultData(ColumnResultSource *source, uint32 length)
+{
+	if (source->file == NULL)
+	{
+		StringInfo resultData = source->resultData;
+
+		if ((uint32) (resultData->len - resultData->cursor) < length)
+		{
+			ErrorCorruptColumnResultFile(source->fileName);
+		}
+
+		resultData->cursor += length;
+	}
+	else if (fseeko(source->file, length, SEEK_CUR) != 0)
+	{
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("could not seek in file \"%s\": %m",
+							   source->fileName)));
+	}
+}
+
+
+/*
+ * ReadColumnResultInt32 reads an integer in network byte order from the file.
+ */
+static uint32
+ReadColumnResultInt32(ColumnResultSource *source)
+{
+	uint32 value = 0;
+
+	ReadColumnResultData(source, (char *) &value, sizeof(value));
+
+	return pg_ntoh32(value);
+}
+
+
+/*
+ * ReadColumnResultString reads a string that is preceded by its length from
+ * the file.
+ */
+static char *
+ReadColumnResultString(ColumnResultSource *source)
+{
+	uint32 stringLength = ReadColumnResultInt32(source);
+	if (stringLength > NAMEDATALEN)
+	{
+		ErrorCorruptColumnResultFile(source->fileName);
+	}
+
+	char *string = palloc0(stringLength + 1);
+	ReadColumnResultData(source, string, stringLength);
+
+	return string;
+}
+
+
+/*
+ * ErrorCorruptColumnResultFile errors out for a column-oriented result file
+ * that ends too early or has invalid contents.
+ */
+static void
+ErrorCorruptColumnResultFile(const char *fileName)
+{
+	ereport(ERROR, (errcode(ERRCODE_DATA_CORRUPTED),
+					errmsg("invalid column-oriented intermediate result file "
+						   "\"%s\"", fileName)));
+}
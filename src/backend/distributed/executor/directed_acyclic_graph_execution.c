@@ -15,6 +15,7 @@
 #include "distributed/directed_acyclic_graph_execution.h"
 #include "distributed/hash_helpers.h"
 #include "distributed/listutils.h"
+#include "distributed/local_executor.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/multi_physical_planner.h"
 #include "distributed/multi_server_executor.h"
@@ -46,6 +47,10 @@ static void AddCompletedTasks(List *curCompletedTasks, HTAB *completedTasks);
 static List * FindExecutableTasks(List *allTasks, HTAB *completedTasks);
 static List * RemoveMergeTasks(List *taskList);
 static bool IsTaskAlreadyCompleted(Task *task, HTAB *completedTasks);
+static bool ExecuteTasksPipelined(List *allTasks, HTAB *completedTasks);
+
+/* GUC, whether tasks start as soon as their own dependencies finished */
+bool EnableRepartitionJoinPipelining = false;
 
 /*
  * ExecuteTasksInDependencyOrder executes the given tasks except the excluded
@@ -62,6 +67,13 @@ ExecuteTasksInDependencyOrder(List *allTasks, List *excludedTasks, List *jobIds)
 	/* We only execute depended jobs' tasks, therefore to not execute */
 	/* top level tasks, we add them to the completedTasks. */
 	AddCompletedTasks(excludedTasks, completedTasks);
+
+	if (EnableRepartitionJoinPipelining &&
+		ExecuteTasksPipelined(allTasks, completedTasks))
+	{
+		return;
+	}
+
 	while (true)
 	{
 		List *curTasks = FindExecutableTasks(allTasks, completedTasks);
@@ -83,6 +95,48 @@ ExecuteTasksInDependencyOrder(List *allTasks, List *excludedTasks, List *jobIds)
 }
 
 
+/*
+ * ExecuteTasksPipelined executes all tasks that are not completed yet in a
+ * single execution, in which each task starts as soon as its own dependencies
+ * finished rather than after all tasks of the previous wave. This avoids
+ * waiting for the slowest map task before any fetch starts. Returns false
+ * without executing anything if some task accesses the local node, since the
+ * local tasks of an execution only run after its remote tasks.
+ */
+static bool
+ExecuteTasksPipelined(List *allTasks, HTAB *completedTasks)
+{
+	List *remainingTasks = NIL;
+
+	Task *task = NULL;
+	foreach_ptr(task, allTasks)
+	{
+		TaskHashKey taskKey = { task->jobId, task->taskId };
+		bool found = false;
+
+		hash_search(completedTasks, &taskKey, HASH_FIND, &found);
+		if (!found)
+		{
+			remainingTasks = lappend(remainingTasks, task);
+		}
+	}
+
+	/* merge tasks do not need to be executed, their dependencies are followed */
+	List *executableTasks = RemoveMergeTasks(remainingTasks);
+	if (AnyTaskAccessesLocalNode(executableTasks))
+	{
+		return false;
+	}
+
+	if (list_length(executableTasks) > 0)
+	{
+		ExecuteTaskListRespectingDependencies(ROW_MODIFY_NONE, executableTasks);
+	}
+
+	return true;
+}
+
+
 /*
  * FindExecutableTasks finds the tasks that can be executed currently,
  * which means that all of their dependencies are executed. If a task
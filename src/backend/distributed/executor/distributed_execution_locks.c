@@ -20,6 +20,10 @@
 #include "distributed/transaction_management.h"
 
 
+static void LockPartitionsForPlanRelation(DistributedPlan *plan, Oid relationId,
+										  LOCKMODE lockMode);
+
+
 /*
  * AcquireExecutorShardLocksForExecution acquires advisory lock on shard IDs
  * to prevent unsafe concurrent modifications of shards.
@@ -445,9 +449,11 @@ LockPartitionRelations(Oid relationId, LOCKMODE lockMode)
 
 
 /*
- * LockPartitionsForDistributedPlan ensures commands take locks on all partitions
+ * LockPartitionsForDistributedPlan ensures commands take locks on the partitions
  * of a distributed table that appears in the query. We do this primarily out of
- * consistency with PostgreSQL locking.
+ * consistency with PostgreSQL locking, which only locks the partitions that
+ * remain after pruning. Hence, for the tables whose partitions the planner
+ * pruned, we only lock the remaining partitions.
  */
 void
 LockPartitionsForDistributedPlan(DistributedPlan *plan)
@@ -456,7 +462,7 @@ LockPartitionsForDistributedPlan(DistributedPlan *plan)
 	{
 		Oid targetRelationId = plan->targetRelationId;
 
-		LockPartitionsInRelationList(list_make1_oid(targetRelationId), RowExclusiveLock);
+		LockPartitionsForPlanRelation(plan, targetRelationId, RowExclusiveLock);
 	}
 
 	/*
@@ -464,5 +470,44 @@ LockPartitionsForDistributedPlan(DistributedPlan *plan)
 	 * DML case this also includes the target relation, but since we already
 	 * have a stronger lock this doesn't do any harm.
 	 */
-	LockPartitionsInRelationList(plan->relationIdList, AccessShareLock);
+	Oid relationId = InvalidOid;
+	foreach_oid(relationId, plan->relationIdList)
+	{
+		LockPartitionsForPlanRelation(plan, relationId, AccessShareLock);
+	}
+}
+
+
+/*
+ * LockPartitionsForPlanRelation acquires relation locks on the partitions of
+ * the given relation that remain after the partition pruning of the given
+ * distributed plan, or on all of its partitions if the plan did not prune
+ * them. It does nothing for non-partitioned tables.
+ */
+static void
+LockPartitionsForPlanRelation(DistributedPlan *plan, Oid relationId,
+							  LOCKMODE lockMode)
+{
+	int prunedRelationIndex = 0;
+	Oid prunedRelationId = InvalidOid;
+	foreach_oid(prunedRelationId, plan->prunedRelationIdList)
+	{
+		if (prunedRelationId == relationId)
+		{
+			List *remainingPartitionList =
+				list_nth(plan->remainingPartitionListList, prunedRelationIndex);
+
+			Oid partitionRelationId = InvalidOid;
+			foreach_oid(partitionRelationId, remainingPartitionList)
+			{
+				LockRelationOid(partitionRelationId, lockMode);
+			}
+
+			return;
+		}
+
+		prunedRelationIndex++;
+	}
+
+	LockPartitionsInRelationList(list_make1_oid(relationId), lockMode);
 }
@@ -20,6 +20,7 @@
 #include "access/htup_details.h"
 #include "access/tupdesc.h"
 #include "catalog/pg_type.h"
+#include "executor/executor.h"
 #include "tcop/pquery.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
@@ -27,6 +28,7 @@
 
 #include "pg_version_constants.h"
 
+#include "distributed/citus_safe_lib.h"
 #include "distributed/deparse_shard_query.h"
 #include "distributed/intermediate_results.h"
 #include "distributed/listutils.h"
@@ -37,6 +39,7 @@
 #include "distributed/transaction_management.h"
 #include "distributed/tuple_destination.h"
 #include "distributed/tuplestore.h"
+#include "distributed/worker_manager.h"
 #include "distributed/worker_protocol.h"
 
 
@@ -61,12 +64,23 @@ typedef struct PartitioningTupleDest
 } PartitioningTupleDest;
 
 
+/* number of concurrent fetch_intermediate_results() calls per pair of nodes */
+int FragmentFetchStreams = 1;
+
+
 /* forward declarations of local functions */
 static List * WrapTasksForPartitioning(const char *resultIdPrefix,
 									   List *selectTaskList,
 									   int partitionColumnIndex,
 									   CitusTableCacheEntry *targetRelation,
-									   bool binaryFormat);
+									   bool binaryFormat,
+									   bool allowNullPartitionColumnValues,
+									   WorkerNode **shardNodeArray);
+static char * PartitionNodesForTask(Task *selectTask, WorkerNode **shardNodeArray,
+									int shardCount);
+static void CreateIntermediateResultsDirectoriesOnNodes(const char *resultIdPrefix,
+														List *nodeList);
+static void ErrorIfNotRepartitionableTarget(CitusTableCacheEntry *targetRelation);
 static List * ExecutePartitionTaskList(List *partitionTaskList,
 									   CitusTableCacheEntry *targetRelation);
 static PartitioningTupleDest * CreatePartitioningTupleDest(
@@ -85,11 +99,16 @@ static DistributedResultFragment * TupleToDistributedResultFragment(HeapTuple he
 static void ExecuteSelectTasksIntoTupleDest(List *taskList,
 											TupleDestination *tupleDestination,
 											bool errorOnAnyFailure);
+static List ** FragmentResultIdsByShard(List *fragmentList,
+										CitusTableCacheEntry *targetRelation);
 static List ** ColocateFragmentsWithRelation(List *fragmentList,
 											 CitusTableCacheEntry *targetRelation);
 static List * ColocationTransfers(List *fragmentList,
 								  CitusTableCacheEntry *targetRelation);
 static List * FragmentTransferTaskList(List *fragmentListTransfers);
+static List * SplitFragmentsTransfer(NodeToNodeFragmentsTransfer *fragmentsTransfer,
+									 int streamCount);
+static int CompareFragmentsByRowCount(const void *leftElement, const void *rightElement);
 static void ExecuteFetchTaskList(List *fetchTaskList);
 
 
@@ -105,13 +124,14 @@ static void ExecuteFetchTaskList(List *fetchTaskList);
  * correspond to targetRelation->sortedShardIntervalArray[shardIndex].
  *
  * partitionColumnIndex determines the column in the selectTaskList to use for
- * partitioning.
+ * partitioning. If allowNullPartitionColumnValues is true, rows with a NULL
+ * value in that column go to the first shard, otherwise they raise an error.
  */
 List **
 RedistributeTaskListResults(const char *resultIdPrefix, List *selectTaskList,
 							int partitionColumnIndex,
 							CitusTableCacheEntry *targetRelation,
-							bool binaryFormat)
+							bool binaryFormat, bool allowNullPartitionColumnValues)
 {
 	/*
 	 * Make sure that this transaction has a distributed transaction ID.
@@ -123,11 +143,247 @@ RedistributeTaskListResults(const char *resultIdPrefix, List *selectTaskList,
 
 	List *fragmentList = PartitionTasklistResults(resultIdPrefix, selectTaskList,
 												  partitionColumnIndex,
-												  targetRelation, binaryFormat);
+												  targetRelation, binaryFormat,
+												  allowNullPartitionColumnValues);
 	return ColocateFragmentsWithRelation(fragmentList, targetRelation);
 }
 
 
+/*
+ * PartitionTasklistResultsByShard partitions the results of the given task list
+ * like RedistributeTaskListResults, but leaves the fragments on the nodes where
+ * they were written. Instead, fragmentFetchQueries[shardIndex] is set to the
+ * list of queries which fetch the fragments of the shard from the other nodes,
+ * so a task on the shard's placement can fetch its own fragments before reading
+ * them. The fetch queries do not return any rows.
+ *
+ * The shards of targetRelation must have a single placement.
+ */
+List **
+PartitionTasklistResultsByShard(const char *resultIdPrefix, List *selectTaskList,
+								int partitionColumnIndex,
+								CitusTableCacheEntry *targetRelation,
+								bool binaryFormat, bool allowNullPartitionColumnValues,
+								List ***fragmentFetchQueries)
+{
+	/* intermediate results are stored in a directory of the distributed transaction */
+	UseCoordinatedTransaction();
+
+	List *fragmentList = PartitionTasklistResults(resultIdPrefix, selectTaskList,
+												  partitionColumnIndex,
+												  targetRelation, binaryFormat,
+												  allowNullPartitionColumnValues);
+
+	int shardCount = targetRelation->shardIntervalArrayLength;
+	List **shardTransferLists = palloc0(shardCount * sizeof(List *));
+
+	DistributedResultFragment *fragment = NULL;
+	foreach_ptr(fragment, fragmentList)
+	{
+		int shardIndex = fragment->targetShardIndex;
+		bool missingOk = false;
+		ShardPlacement *placement =
+			ActiveShardPlacement(fragment->targetShardId, missingOk);
+
+		if (placement->nodeId == fragment->nodeId)
+		{
+			continue;
+		}
+
+		/* the fragments of a shard come from a few nodes, so a list suffices */
+		NodeToNodeFragmentsTransfer *fragmentsTransfer = NULL;
+		NodeToNodeFragmentsTransfer *existingTransfer = NULL;
+		foreach_ptr(existingTransfer, shardTransferLists[shardIndex])
+		{
+			if (existingTransfer->nodes.sourceNodeId == fragment->nodeId)
+			{
+				fragmentsTransfer = existingTransfer;
+				break;
+			}
+		}
+
+		if (fragmentsTransfer == NULL)
+		{
+			fragmentsTransfer = palloc0(sizeof(NodeToNodeFragmentsTransfer));
+			fragmentsTransfer->nodes.sourceNodeId = fragment->nodeId;
+			fragmentsTransfer->nodes.targetNodeId = placement->nodeId;
+
+			shardTransferLists[shardIndex] =
+				lappend(shardTransferLists[shardIndex], fragmentsTransfer);
+		}
+
+		fragmentsTransfer->fragmentList =
+			lappend(fragmentsTransfer->fragmentList, fragment);
+	}
+
+	List **shardFetchQueryLists = palloc0(shardCount * sizeof(List *));
+
+	for (int shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		NodeToNodeFragmentsTransfer *fragmentsTransfer = NULL;
+		foreach_ptr(fragmentsTransfer, shardTransferLists[shardIndex])
+		{
+			StringInfo fetchQuery = makeStringInfo();
+
+			/* filter out the byte count, such that the task only returns its own rows */
+			appendStringInfo(fetchQuery,
+							 "SELECT bytes FROM (%s) fetched_fragments WHERE bytes < 0",
+							 QueryStringForFragmentsTransfer(fragmentsTransfer));
+
+			shardFetchQueryLists[shardIndex] =
+				lappend(shardFetchQueryLists[shardIndex], fetchQuery->data);
+		}
+	}
+
+	*fragmentFetchQueries = shardFetchQueryLists;
+
+	return FragmentResultIdsByShard(fragmentList, targetRelation);
+}
+
+
+/*
+ * PushTasklistResultsToShards partitions the results of the given task list
+ * like RedistributeTaskListResults, but each task pushes the partitions of
+ * its result to the nodes of the target shards while it executes, by calling
+ * worker_push_partition_query_result(). Hence, the partitions are neither
+ * written to files on the source nodes nor fetched in a separate phase.
+ *
+ * returnValue[shardIndex] is the list of result ids for
+ * targetRelation->sortedShardIntervalArray[shardIndex], all of which are on
+ * the node of the shard. The shards of targetRelation must have a single
+ * placement.
+ */
+List **
+PushTasklistResultsToShards(const char *resultIdPrefix, List *selectTaskList,
+							int partitionColumnIndex,
+							CitusTableCacheEntry *targetRelation,
+							bool binaryFormat, bool allowNullPartitionColumnValues)
+{
+	ErrorIfNotRepartitionableTarget(targetRelation);
+
+	/* intermediate results are stored in a directory of the distributed transaction */
+	UseCoordinatedTransaction();
+
+	int shardCount = targetRelation->shardIntervalArrayLength;
+	WorkerNode **shardNodeArray = palloc0(shardCount * sizeof(WorkerNode *));
+	List *targetNodeList = NIL;
+
+	for (int shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardInterval *shardInterval =
+			targetRelation->sortedShardIntervalArray[shardIndex];
+		bool missingOk = false;
+		ShardPlacement *placement =
+			ActiveShardPlacement(shardInterval->shardId, missingOk);
+
+		WorkerNode *targetNode = NULL;
+		WorkerNode *existingNode = NULL;
+		foreach_ptr(existingNode, targetNodeList)
+		{
+			if (existingNode->nodeId == placement->nodeId)
+			{
+				targetNode = existingNode;
+				break;
+			}
+		}
+
+		if (targetNode == NULL)
+		{
+			targetNode = LookupNodeByNodeIdOrError(placement->nodeId);
+			targetNodeList = lappend(targetNodeList, targetNode);
+		}
+
+		shardNodeArray[shardIndex] = targetNode;
+	}
+
+	CreateIntermediateResultsDirectoriesOnNodes(resultIdPrefix, targetNodeList);
+
+	List *pushTaskList = WrapTasksForPartitioning(resultIdPrefix, selectTaskList,
+												  partitionColumnIndex, targetRelation,
+												  binaryFormat,
+												  allowNullPartitionColumnValues,
+												  shardNodeArray);
+	List *fragmentList = ExecutePartitionTaskList(pushTaskList, targetRelation);
+
+	return FragmentResultIdsByShard(fragmentList, targetRelation);
+}
+
+
+/*
+ * CreateIntermediateResultsDirectoriesOnNodes makes sure that the intermediate
+ * result directory of the distributed transaction exists on the given nodes
+ * until the end of the transaction.
+ *
+ * The results that worker_push_partition_query_result() pushes to a node are
+ * received in a transaction that ends before the distributed transaction, and
+ * a directory created by that transaction would be removed at its end. We
+ * therefore broadcast an empty result to the nodes over the connections of the
+ * distributed transaction first, which creates the directory that the pushed
+ * results are then written to.
+ */
+static void
+CreateIntermediateResultsDirectoriesOnNodes(const char *resultIdPrefix,
+											List *nodeList)
+{
+	List *remoteNodeList = NIL;
+	int32 localGroupId = GetLocalGroupId();
+
+	WorkerNode *workerNode = NULL;
+	foreach_ptr(workerNode, nodeList)
+	{
+		if (workerNode->groupId == localGroupId)
+		{
+			/* this backend stays in the distributed transaction until its end */
+			CreateIntermediateResultsDirectory();
+			continue;
+		}
+
+		remoteNodeList = lappend(remoteNodeList, workerNode);
+	}
+
+	if (remoteNodeList == NIL)
+	{
+		return;
+	}
+
+	StringInfo resultId = makeStringInfo();
+	appendStringInfo(resultId, "%s_directory", resultIdPrefix);
+
+	TupleDesc tupleDescriptor = CreateTemplateTupleDesc(1);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 1, "directory", INT4OID, -1, 0);
+
+	EState *executorState = CreateExecutorState();
+	bool writeLocalFile = false;
+	DestReceiver *resultDest = CreateRemoteFileDestReceiver(resultId->data,
+															executorState,
+															remoteNodeList,
+															writeLocalFile);
+
+	resultDest->rStartup(resultDest, CMD_SELECT, tupleDescriptor);
+	resultDest->rShutdown(resultDest);
+	resultDest->rDestroy(resultDest);
+
+	FreeExecutorState(executorState);
+}
+
+
+/*
+ * ErrorIfNotRepartitionableTarget errors out if results cannot be partitioned
+ * by the distribution of the given relation.
+ */
+static void
+ErrorIfNotRepartitionableTarget(CitusTableCacheEntry *targetRelation)
+{
+	if (!IsCitusTableTypeCacheEntry(targetRelation, HASH_DISTRIBUTED) &&
+		!IsCitusTableTypeCacheEntry(targetRelation, RANGE_DISTRIBUTED))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("repartitioning results of a tasklist is only supported "
+							   "when target relation is hash or range partitioned.")));
+	}
+}
+
+
 /*
  * PartitionTasklistResults executes the given task list, and partitions results
  * of each task based on targetRelation's distribution method and intervals.
@@ -140,21 +396,16 @@ RedistributeTaskListResults(const char *resultIdPrefix, List *selectTaskList,
  * fragments.
  *
  * partitionColumnIndex determines the column in the selectTaskList to use for
- * partitioning.
+ * partitioning. If allowNullPartitionColumnValues is true, rows with a NULL
+ * value in that column go to the first partition.
  */
 List *
 PartitionTasklistResults(const char *resultIdPrefix, List *selectTaskList,
 						 int partitionColumnIndex,
 						 CitusTableCacheEntry *targetRelation,
-						 bool binaryFormat)
+						 bool binaryFormat, bool allowNullPartitionColumnValues)
 {
-	if (!IsCitusTableTypeCacheEntry(targetRelation, HASH_DISTRIBUTED) &&
-		!IsCitusTableTypeCacheEntry(targetRelation, RANGE_DISTRIBUTED))
-	{
-		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-						errmsg("repartitioning results of a tasklist is only supported "
-							   "when target relation is hash or range partitioned.")));
-	}
+	ErrorIfNotRepartitionableTarget(targetRelation);
 
 	/*
 	 * Make sure that this transaction has a distributed transaction ID.
@@ -164,9 +415,12 @@ PartitionTasklistResults(const char *resultIdPrefix, List *selectTaskList,
 	 */
 	UseCoordinatedTransaction();
 
+	WorkerNode **shardNodeArray = NULL;
 	selectTaskList = WrapTasksForPartitioning(resultIdPrefix, selectTaskList,
 											  partitionColumnIndex, targetRelation,
-											  binaryFormat);
+											  binaryFormat,
+											  allowNullPartitionColumnValues,
+											  shardNodeArray);
 	return ExecutePartitionTaskList(selectTaskList, targetRelation);
 }
 
@@ -175,12 +429,17 @@ PartitionTasklistResults(const char *resultIdPrefix, List *selectTaskList,
  * WrapTasksForPartitioning wraps the query for each of the tasks by a call
  * to worker_partition_query_result(). Target list of the wrapped query should
  * match the tuple descriptor in ExecutePartitionTaskList().
+ *
+ * If shardNodeArray is given, the queries are wrapped by a call to
+ * worker_push_partition_query_result() instead, which pushes the partition of
+ * shardIntervalArray[shardIndex] to shardNodeArray[shardIndex].
  */
 static List *
 WrapTasksForPartitioning(const char *resultIdPrefix, List *selectTaskList,
 						 int partitionColumnIndex,
 						 CitusTableCacheEntry *targetRelation,
-						 bool binaryFormat)
+						 bool binaryFormat, bool allowNullPartitionColumnValues,
+						 WorkerNode **shardNodeArray)
 {
 	List *wrappedTaskList = NIL;
 	ShardInterval **shardIntervalArray = targetRelation->sortedShardIntervalArray;
@@ -216,19 +475,41 @@ WrapTasksForPartitioning(const char *resultIdPrefix, List *selectTaskList,
 		Task *wrappedSelectTask = copyObject(selectTask);
 
 		StringInfo wrappedQuery = makeStringInfo();
-		appendStringInfo(wrappedQuery,
-						 "SELECT partition_index"
-						 ", %s || '_' || partition_index::text "
-						 ", rows_written "
-						 "FROM worker_partition_query_result"
-						 "(%s,%s,%d,%s,%s,%s,%s) WHERE rows_written > 0",
-						 quote_literal_cstr(taskPrefix),
-						 quote_literal_cstr(taskPrefix),
-						 quote_literal_cstr(TaskQueryString(selectTask)),
-						 partitionColumnIndex,
-						 quote_literal_cstr(partitionMethodString),
-						 minValuesString->data, maxValuesString->data,
-						 binaryFormatString);
+		if (shardNodeArray != NULL)
+		{
+			appendStringInfo(wrappedQuery,
+							 "SELECT partition_index, result_id, rows_written "
+							 "FROM worker_push_partition_query_result"
+							 "(%s,%s,%d,%s,%s,%s,%s,%s%s)",
+							 quote_literal_cstr(taskPrefix),
+							 quote_literal_cstr(TaskQueryString(selectTask)),
+							 partitionColumnIndex,
+							 quote_literal_cstr(partitionMethodString),
+							 minValuesString->data, maxValuesString->data,
+							 PartitionNodesForTask(selectTask, shardNodeArray,
+												   shardCount),
+							 binaryFormatString,
+							 allowNullPartitionColumnValues ?
+							 ",allow_null_partition_column := true" : "");
+		}
+		else
+		{
+			appendStringInfo(wrappedQuery,
+							 "SELECT partition_index"
+							 ", %s || '_' || partition_index::text "
+							 ", rows_written "
+							 "FROM worker_partition_query_result"
+							 "(%s,%s,%d,%s,%s,%s,%s%s) WHERE rows_written > 0",
+							 quote_literal_cstr(taskPrefix),
+							 quote_literal_cstr(taskPrefix),
+							 quote_literal_cstr(TaskQueryString(selectTask)),
+							 partitionColumnIndex,
+							 quote_literal_cstr(partitionMethodString),
+							 minValuesString->data, maxValuesString->data,
+							 binaryFormatString,
+							 allowNullPartitionColumnValues ?
+							 ",allow_null_partition_column := true" : "");
+		}
 
 		SetTaskQueryString(wrappedSelectTask, wrappedQuery->data);
 		wrappedTaskList = lappend(wrappedTaskList, wrappedSelectTask);
@@ -238,6 +519,60 @@ WrapTasksForPartitioning(const char *resultIdPrefix, List *selectTaskList,
 }
 
 
+/*
+ * PartitionNodesForTask returns the node names and node ports arguments of
+ * worker_push_partition_query_result() for the given task. Partitions whose
+ * shard is on the node of the task are written locally, which we can only do
+ * when the task has a single placement, since it would otherwise be unknown
+ * on which of them it runs.
+ */
+static char *
+PartitionNodesForTask(Task *selectTask, WorkerNode **shardNodeArray, int shardCount)
+{
+	StringInfo nodeNamesString = makeStringInfo();
+	StringInfo nodePortsString = makeStringInfo();
+	ShardPlacement *taskPlacement = NULL;
+
+	if (list_length(selectTask->taskPlacementList) == 1)
+	{
+		taskPlacement = linitial(selectTask->taskPlacementList);
+	}
+
+	appendStringInfoString(nodeNamesString, "ARRAY[");
+	appendStringInfoString(nodePortsString, "ARRAY[");
+
+	for (int shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		WorkerNode *targetNode = shardNodeArray[shardIndex];
+
+		if (shardIndex > 0)
+		{
+			appendStringInfoString(nodeNamesString, ",");
+			appendStringInfoString(nodePortsString, ",");
+		}
+
+		if (taskPlacement != NULL && taskPlacement->nodeId == targetNode->nodeId)
+		{
+			appendStringInfoString(nodeNamesString, "NULL");
+		}
+		else
+		{
+			appendStringInfoString(nodeNamesString,
+								   quote_literal_cstr(targetNode->workerName));
+		}
+
+		appendStringInfo(nodePortsString, "%d", targetNode->workerPort);
+	}
+
+	appendStringInfoString(nodeNamesString, "]::text[]");
+	appendStringInfoString(nodePortsString, "]::int[]");
+
+	appendStringInfo(nodeNamesString, ",%s", nodePortsString->data);
+
+	return nodeNamesString->data;
+}
+
+
 /*
  * CreatePartitioningTupleDest creates a TupleDestination which consumes results of
  * tasks constructed in WrapTasksForPartitioning.
@@ -486,6 +821,18 @@ ColocateFragmentsWithRelation(List *fragmentList, CitusTableCacheEntry *targetRe
 
 	ExecuteFetchTaskList(fragmentTransferTaskList);
 
+	return FragmentResultIdsByShard(fragmentList, targetRelation);
+}
+
+
+/*
+ * FragmentResultIdsByShard groups the result ids of the given fragments by the
+ * shard of targetRelation that they belong to. returnValue[shardIndex] is the
+ * list of result ids for targetRelation->sortedShardIntervalArray[shardIndex].
+ */
+static List **
+FragmentResultIdsByShard(List *fragmentList, CitusTableCacheEntry *targetRelation)
+{
 	int shardCount = targetRelation->shardIntervalArrayLength;
 	List **shardResultIdList = palloc0(shardCount * sizeof(List *));
 
@@ -569,14 +916,26 @@ ColocationTransfers(List *fragmentList, CitusTableCacheEntry *targetRelation)
  * FragmentTransferTaskList returns a list of tasks which performs the given list of
  * transfers. Each of the transfers are done by a SQL call to fetch_intermediate_results.
  * See QueryStringForFragmentsTransfer for how the query is constructed.
+ *
+ * When citus.fragment_fetch_streams is above 1, the fragments of a transfer are
+ * spread over multiple tasks, which the executor runs over separate connections
+ * to the target node.
  */
 static List *
 FragmentTransferTaskList(List *fragmentListTransfers)
 {
 	List *fetchTaskList = NIL;
+	List *streamTransferList = NIL;
 
 	NodeToNodeFragmentsTransfer *fragmentsTransfer = NULL;
 	foreach_ptr(fragmentsTransfer, fragmentListTransfers)
+	{
+		streamTransferList = list_concat(streamTransferList,
+										 SplitFragmentsTransfer(fragmentsTransfer,
+																FragmentFetchStreams));
+	}
+
+	foreach_ptr(fragmentsTransfer, streamTransferList)
 	{
 		uint32 targetNodeId = fragmentsTransfer->nodes.targetNodeId;
 
@@ -600,6 +959,99 @@ FragmentTransferTaskList(List *fragmentListTransfers)
 }
 
 
+/*
+ * SplitFragmentsTransfer splits the fragments of the given transfer over at
+ * most streamCount transfers between the same pair of nodes. Fragments are
+ * assigned largest first to the transfer with the fewest rows, such that the
+ * streams finish at roughly the same time.
+ */
+static List *
+SplitFragmentsTransfer(NodeToNodeFragmentsTransfer *fragmentsTransfer, int streamCount)
+{
+	int fragmentCount = list_length(fragmentsTransfer->fragmentList);
+
+	streamCount = Min(streamCount, fragmentCount);
+	if (streamCount <= 1)
+	{
+		return list_make1(fragmentsTransfer);
+	}
+
+	DistributedResultFragment **fragmentArray =
+		palloc0(fragmentCount * sizeof(DistributedResultFragment *));
+	int fragmentIndex = 0;
+
+	DistributedResultFragment *fragment = NULL;
+	foreach_ptr(fragment, fragmentsTransfer->fragmentList)
+	{
+		fragmentArray[fragmentIndex++] = fragment;
+	}
+
+	SafeQsort(fragmentArray, fragmentCount, sizeof(DistributedResultFragment *),
+			  CompareFragmentsByRowCount);
+
+	NodeToNodeFragmentsTransfer **streamArray =
+		palloc0(streamCount * sizeof(NodeToNodeFragmentsTransfer *));
+	int64 *streamRowCounts = palloc0(streamCount * sizeof(int64));
+
+	for (int streamIndex = 0; streamIndex < streamCount; streamIndex++)
+	{
+		streamArray[streamIndex] = palloc0(sizeof(NodeToNodeFragmentsTransfer));
+		streamArray[streamIndex]->nodes = fragmentsTransfer->nodes;
+	}
+
+	for (fragmentIndex = 0; fragmentIndex < fragmentCount; fragmentIndex++)
+	{
+		int smallestStreamIndex = 0;
+
+		for (int streamIndex = 1; streamIndex < streamCount; streamIndex++)
+		{
+			if (streamRowCounts[streamIndex] < streamRowCounts[smallestStreamIndex])
+			{
+				smallestStreamIndex = streamIndex;
+			}
+		}
+
+		fragment = fragmentArray[fragmentIndex];
+
+		NodeToNodeFragmentsTransfer *stream = streamArray[smallestStreamIndex];
+		stream->fragmentList = lappend(stream->fragmentList, fragment);
+
+		/* count empty fragments as a row, they still take a COPY */
+		streamRowCounts[smallestStreamIndex] += Max(fragment->rowCount, 1);
+	}
+
+	List *streamList = NIL;
+
+	for (int streamIndex = 0; streamIndex < streamCount; streamIndex++)
+	{
+		streamList = lappend(streamList, streamArray[streamIndex]);
+	}
+
+	return streamList;
+}
+
+
+/*
+ * CompareFragmentsByRowCount orders fragments by descending row count, and
+ * by result ID for fragments of the same size.
+ */
+static int
+CompareFragmentsByRowCount(const void *leftElement, const void *rightElement)
+{
+	DistributedResultFragment *leftFragment =
+		*((DistributedResultFragment **) leftElement);
+	DistributedResultFragment *rightFragment =
+		*((DistributedResultFragment **) rightElement);
+
+	if (leftFragment->rowCount != rightFragment->rowCount)
+	{
+		return (leftFragment->rowCount > rightFragment->rowCount) ? -1 : 1;
+	}
+
+	return strcmp(leftFragment->resultId, rightFragment->resultId);
+}
+
+
 /*
  * QueryStringForFragmentsTransfer returns a query which fetches distributed
  * result fragments from source node to target node. See the structure of
@@ -0,0 +1,315 @@
+/*-------------------------------------------------------------------------
+ *
+ * executor_memory_budget.c
+ *   Admission control for distributed executions based on the memory of
+ *   the coordinator that they use for the task results, the connections and
+ *   the state of the tasks.
+ *
+ *   Each execution reserves its estimated memory from a budget that is
+ *   shared by all backends, citus.max_executor_memory, before it starts, and
+ *   grows the reservation when the results of its tasks turn out larger than
+ *   estimated. New executions wait for running ones to release their memory
+ *   when the budget is exhausted, for up to
+ *   citus.executor_memory_wait_timeout.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "pgstat.h"
+
+#include "port/atomics.h"
+#include "storage/condition_variable.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+#include "pg_version_constants.h"
+
+#include "distributed/citus_wait_events.h"
+#include "distributed/executor_memory_budget.h"
+
+
+/*
+ * The data structure used to keep track of the reserved memory in shared
+ * memory.
+ */
+typedef struct ExecutorMemoryBudgetSharedData
+{
+	/* memory reserved by the executions of all backends, in bytes */
+	pg_atomic_uint64 reservedMemory;
+
+	/* executions that wait for memory sleep on this */
+	ConditionVariable waitersConditionVariable;
+} ExecutorMemoryBudgetSharedData;
+
+
+/* GUC, memory of the coordinator for distributed executions in kB, -1 disables */
+int MaxExecutorMemory = -1;
+
+/* GUC, how long (in ms) executions wait for memory before they error out */
+int ExecutorMemoryWaitTimeout = 10000;
+
+
+static ExecutorMemoryBudgetSharedData *ExecutorMemoryBudgetSharedState = NULL;
+
+/* memory reserved by the executions of this backend, in bytes */
+static uint64 BackendReservedExecutorMemory = 0;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+/* local function declarations */
+static bool TryToReserveExecutorMemory(uint64 bytes, uint64 budget);
+static void WaitForExecutorMemory(uint64 bytes, uint64 budget);
+static void ReleaseExecutorMemoryCallback(void *arg);
+
+
+/*
+ * ReserveExecutorMemory reserves the given estimated memory of an execution
+ * from citus.max_executor_memory, and waits for other executions to release
+ * their memory if the budget does not suffice. It returns NULL when there is
+ * no budget.
+ *
+ * The reservation is allocated in the CurrentMemoryContext, which should be
+ * the one of the execution, and is released at the latest when that context
+ * is reset.
+ */
+ExecutorMemoryReservation *
+ReserveExecutorMemory(uint64 estimatedBytes)
+{
+	if (MaxExecutorMemory < 0)
+	{
+		return NULL;
+	}
+
+	uint64 budget = (uint64) MaxExecutorMemory * 1024;
+
+	/* allocate up front, such that we do not fail while holding memory */
+	ExecutorMemoryReservation *reservation =
+		palloc0(sizeof(ExecutorMemoryReservation));
+
+	if (!TryToReserveExecutorMemory(estimatedBytes, budget))
+	{
+		WaitForExecutorMemory(estimatedBytes, budget);
+	}
+
+	reservation->reservedBytes = estimatedBytes;
+	BackendReservedExecutorMemory += estimatedBytes;
+
+	reservation->releaseCallback.func = ReleaseExecutorMemoryCallback;
+	reservation->releaseCallback.arg = reservation;
+	MemoryContextRegisterResetCallback(CurrentMemoryContext,
+									   &reservation->releaseCallback);
+
+	return reservation;
+}
+
+
+/*
+ * TryToReserveExecutorMemory adds the given memory to the reserved memory if
+ * it fits into the budget and returns true, or returns false otherwise.
+ *
+ * We always admit an execution when no memory is reserved, since it would
+ * never fit otherwise, and when the backend already reserved memory, since
+ * the execution would otherwise wait for the backend itself, for instance
+ * when a suspended execution returns its rows to a cursor.
+ */
+static bool
+TryToReserveExecutorMemory(uint64 bytes, uint64 budget)
+{
+	uint64 reservedMemory =
+		pg_atomic_read_u64(&ExecutorMemoryBudgetSharedState->reservedMemory);
+
+	while (true)
+	{
+		if (reservedMemory > 0 && BackendReservedExecutorMemory == 0 &&
+			reservedMemory + bytes > budget)
+		{
+			return false;
+		}
+
+		/* on failure, reservedMemory is set to the current value */
+		if (pg_atomic_compare_exchange_u64(
+				&ExecutorMemoryBudgetSharedState->reservedMemory,
+				&reservedMemory, reservedMemory + bytes))
+		{
+			return true;
+		}
+	}
+}
+
+
+/*
+ * WaitForExecutorMemory waits until the given memory fits into the budget and
+ * reserves it, or errors out after citus.executor_memory_wait_timeout.
+ */
+static void
+WaitForExecutorMemory(uint64 bytes, uint64 budget)
+{
+	TimestampTz waitStartTime = GetCurrentTimestamp();
+
+	while (!TryToReserveExecutorMemory(bytes, budget))
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		long waitedMilliseconds =
+			TimestampDifferenceMilliseconds(waitStartTime, GetCurrentTimestamp());
+
+		if (waitedMilliseconds >= ExecutorMemoryWaitTimeout)
+		{
+			ConditionVariableCancelSleep();
+
+			uint64 reservedMemory =
+				pg_atomic_read_u64(&ExecutorMemoryBudgetSharedState->reservedMemory);
+
+			ereport(ERROR, (errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
+							errmsg("could not reserve " UINT64_FORMAT " kB of memory "
+								   "for the distributed execution",
+								   bytes / 1024),
+							errdetail("Distributed executions use " UINT64_FORMAT
+									  " kB of citus.max_executor_memory "
+									  "(currently %d kB).",
+									  reservedMemory / 1024, MaxExecutorMemory),
+							errhint("Retry the query later, or increase "
+									"citus.max_executor_memory or "
+									"citus.executor_memory_wait_timeout.")));
+		}
+
+		ConditionVariableTimedSleep(
+			&ExecutorMemoryBudgetSharedState->waitersConditionVariable,
+			ExecutorMemoryWaitTimeout - waitedMilliseconds,
+			WAIT_EVENT_CITUS_EXECUTOR_MEMORY);
+	}
+
+	ConditionVariableCancelSleep();
+}
+
+
+/*
+ * UpdateExecutorMemoryReservation grows the reservation of an execution when
+ * it uses more memory than it reserved. We do not wait for the budget here,
+ * since the execution already holds its connections and results and waiting
+ * would only make things worse. Instead, new executions wait longer.
+ */
+void
+UpdateExecutorMemoryReservation(ExecutorMemoryReservation *reservation,
+								uint64 usedBytes)
+{
+	if (reservation == NULL || reservation->released ||
+		usedBytes <= reservation->reservedBytes)
+	{
+		return;
+	}
+
+	uint64 additionalBytes = usedBytes - reservation->reservedBytes;
+
+	pg_atomic_fetch_add_u64(&ExecutorMemoryBudgetSharedState->reservedMemory,
+							additionalBytes);
+	BackendReservedExecutorMemory += additionalBytes;
+	reservation->reservedBytes = usedBytes;
+}
+
+
+/*
+ * ReleaseExecutorMemory gives the memory of the reservation back to the
+ * budget and wakes up the executions that wait for memory.
+ */
+void
+ReleaseExecutorMemory(ExecutorMemoryReservation *reservation)
+{
+	if (reservation == NULL || reservation->released)
+	{
+		return;
+	}
+
+	pg_atomic_fetch_sub_u64(&ExecutorMemoryBudgetSharedState->reservedMemory,
+							reservation->reservedBytes);
+	BackendReservedExecutorMemory -= reservation->reservedBytes;
+	reservation->released = true;
+
+	ConditionVariableBroadcast(
+		&ExecutorMemoryBudgetSharedState->waitersConditionVariable);
+}
+
+
+/*
+ * ReleaseExecutorMemoryCallback releases the memory of a reservation when
+ * its memory context is reset, e.g. when the execution failed.
+ */
+static void
+ReleaseExecutorMemoryCallback(void *arg)
+{
+	ReleaseExecutorMemory((ExecutorMemoryReservation *) arg);
+}
+
+
+/*
+ * InitializeExecutorMemoryBudget requests the necessary shared memory from
+ * Postgres and sets up the shared memory startup hook.
+ */
+void
+InitializeExecutorMemoryBudget(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(ExecutorMemoryBudgetShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = ExecutorMemoryBudgetShmemInit;
+}
+
+
+/*
+ * ExecutorMemoryBudgetShmemSize returns the size that should be allocated on
+ * the shared memory for the memory budget.
+ */
+size_t
+ExecutorMemoryBudgetShmemSize(void)
+{
+	return sizeof(ExecutorMemoryBudgetSharedData);
+}
+
+
+/*
+ * ExecutorMemoryBudgetShmemInit initializes the shared memory used for
+ * keeping track of the memory that executions reserved across backends.
+ */
+void
+ExecutorMemoryBudgetShmemInit(void)
+{
+	bool alreadyInitialized = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	ExecutorMemoryBudgetSharedState =
+		(ExecutorMemoryBudgetSharedData *) ShmemInitStruct(
+			"Executor Memory Budget Data",
+			sizeof(ExecutorMemoryBudgetSharedData),
+			&alreadyInitialized);
+
+	if (!alreadyInitialized)
+	{
+		pg_atomic_init_u64(&ExecutorMemoryBudgetSharedState->reservedMemory, 0);
+		ConditionVariableInit(&ExecutorMemoryBudgetSharedState->waitersConditionVariable);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
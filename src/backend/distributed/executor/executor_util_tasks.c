@@ -238,6 +238,8 @@ ReadOnlyTask(TaskType taskType)
 bool
 ModifiedTableReplicated(List *taskList)
 {
+	Oid previousRelationId = InvalidOid;
+
 	Task *task = NULL;
 	foreach_ptr(task, taskList)
 	{
@@ -253,7 +255,18 @@ ModifiedTableReplicated(List *taskList)
 			return true;
 		}
 
+		/*
+		 * SingleReplicatedTable goes over the placements of all shards, so
+		 * check each table once rather than for each of its tasks.
+		 */
 		Oid relationId = RelationIdForShard(shardId);
+		if (relationId == previousRelationId)
+		{
+			continue;
+		}
+
+		previousRelationId = relationId;
+
 		if (!SingleReplicatedTable(relationId))
 		{
 			return true;
@@ -0,0 +1,305 @@
+/*-------------------------------------------------------------------------
+ *
+ * insert_buffer.c
+ *   Buffering of router INSERTs in transaction blocks.
+ *
+ *   Applications often load data through many single-row INSERTs in a
+ *   transaction block, each of which costs a round trip to a worker. When
+ *   citus.max_buffered_insert_rows is set, we do not send such INSERTs right
+ *   away, but keep their shard commands until a statement might observe or
+ *   conflict with them, until the transaction commits, or until the buffer is
+ *   full. The buffered commands of a shard are then sent in a single query
+ *   string, such that a flush costs one round trip per shard.
+ *
+ *   Since the commands are sent later, errors such as unique violations are
+ *   reported by the statement that flushes the buffer, or by the COMMIT.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/xact.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+#include "distributed/adaptive_executor.h"
+#include "distributed/deparse_shard_query.h"
+#include "distributed/distributed_planner.h"
+#include "distributed/hash_helpers.h"
+#include "distributed/insert_buffer.h"
+#include "distributed/insert_select_planner.h"
+#include "distributed/listutils.h"
+#include "distributed/local_executor.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/multi_explain.h"
+#include "distributed/multi_router_planner.h"
+#include "distributed/transaction_management.h"
+
+
+/* hash entry to collect the buffered commands of a shard */
+typedef struct ShardBufferedInserts
+{
+	uint64 shardId;
+	Task *task;
+	List *queryStringList;
+} ShardBufferedInserts;
+
+
+/* GUC, maximum number of rows to buffer before flushing, 0 disables buffering */
+int MaxBufferedInsertRows = 0;
+
+
+/* buffered tasks in the order of the INSERTs, allocated in BufferedInsertContext */
+static List *BufferedInsertTaskList = NIL;
+static int BufferedInsertRowCount = 0;
+static RowModifyLevel BufferedInsertModLevel = ROW_MODIFY_NONE;
+static MemoryContext BufferedInsertContext = NULL;
+
+
+/* local function declarations */
+static bool InsertBufferingAllowed(void);
+static bool IsBufferableInsertJob(DistributedPlan *distributedPlan);
+
+
+/*
+ * IsBufferableInsertPlan returns whether the given plan is an INSERT that
+ * might be buffered, such that the executor does not need to flush the buffer
+ * before running it.
+ */
+bool
+IsBufferableInsertPlan(PlannedStmt *plannedStmt)
+{
+	if (!InsertBufferingAllowed() || plannedStmt->commandType != CMD_INSERT)
+	{
+		return false;
+	}
+
+	CustomScan *customScan = FetchCitusCustomScanIfExists(plannedStmt->planTree);
+	if (customScan == NULL)
+	{
+		return false;
+	}
+
+	return IsBufferableInsertJob(GetDistributedPlan(customScan));
+}
+
+
+/*
+ * ShouldBufferInsert returns whether the INSERT of the given scan state should
+ * be added to the buffer instead of being executed.
+ *
+ * We only buffer INSERTs into a single remote shard placement, since the
+ * commands of local placements do not need a round trip and we do not want
+ * to keep track of replicas here. The commands are sent as a query string, so
+ * the parameters need to be part of the query string as well.
+ */
+bool
+ShouldBufferInsert(CitusScanState *scanState)
+{
+	DistributedPlan *distributedPlan = scanState->distributedPlan;
+
+	if (!InsertBufferingAllowed() || !IsBufferableInsertJob(distributedPlan) ||
+		RequestedForExplainAnalyze(scanState))
+	{
+		return false;
+	}
+
+	List *taskList = distributedPlan->workerJob->taskList;
+	if (list_length(taskList) != 1)
+	{
+		return false;
+	}
+
+	Task *task = (Task *) linitial(taskList);
+	if (list_length(task->taskPlacementList) != 1 || TaskAccessesLocalNode(task))
+	{
+		return false;
+	}
+
+	EState *executorState = ScanStateGetExecutorState(scanState);
+	if (executorState->es_param_list_info != NULL &&
+		!task->parametersInQueryStringResolved)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * BufferInsert adds the task of the INSERT of the given scan state to the
+ * buffer, reports its rows as processed, and flushes the buffer when it holds
+ * citus.max_buffered_insert_rows rows.
+ */
+void
+BufferInsert(CitusScanState *scanState)
+{
+	DistributedPlan *distributedPlan = scanState->distributedPlan;
+	Task *task = (Task *) linitial(distributedPlan->workerJob->taskList);
+	EState *executorState = ScanStateGetExecutorState(scanState);
+
+	/* make sure the shard command is deparsed before we copy the task */
+	TaskQueryString(task);
+
+	if (BufferedInsertContext == NULL)
+	{
+		BufferedInsertContext = AllocSetContextCreate(TopTransactionContext,
+													  "Buffered Inserts",
+													  ALLOCSET_DEFAULT_SIZES);
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(BufferedInsertContext);
+
+	BufferedInsertTaskList = lappend(BufferedInsertTaskList, copyObject(task));
+
+	MemoryContextSwitchTo(oldContext);
+
+	int rowCount = Max(list_length(task->rowValuesLists), 1);
+
+	BufferedInsertRowCount += rowCount;
+	BufferedInsertModLevel = Max(BufferedInsertModLevel, distributedPlan->modLevel);
+
+	executorState->es_processed += rowCount;
+
+	if (BufferedInsertRowCount >= MaxBufferedInsertRows)
+	{
+		FlushBufferedInserts();
+	}
+}
+
+
+/*
+ * HasBufferedInserts returns whether there are INSERTs in the buffer.
+ */
+bool
+HasBufferedInserts(void)
+{
+	return BufferedInsertTaskList != NIL;
+}
+
+
+/*
+ * FlushBufferedInserts sends the buffered INSERTs to the workers, combining
+ * the commands of each shard into a single query string. The shards are
+ * modified in the order in which they were first inserted into.
+ */
+void
+FlushBufferedInserts(void)
+{
+	if (BufferedInsertTaskList == NIL)
+	{
+		return;
+	}
+
+	/* detach the buffer first, such that the execution does not flush it again */
+	List *bufferedTaskList = BufferedInsertTaskList;
+	RowModifyLevel modLevel = BufferedInsertModLevel;
+	MemoryContext bufferedInsertContext = BufferedInsertContext;
+
+	ResetBufferedInserts();
+
+	HTAB *shardInsertsHash = CreateSimpleHash(uint64, ShardBufferedInserts);
+	List *taskList = NIL;
+
+	Task *bufferedTask = NULL;
+	foreach_ptr(bufferedTask, bufferedTaskList)
+	{
+		bool found = false;
+		ShardBufferedInserts *shardInserts =
+			hash_search(shardInsertsHash, &bufferedTask->anchorShardId, HASH_ENTER,
+						&found);
+
+		if (!found)
+		{
+			shardInserts->task = bufferedTask;
+			shardInserts->queryStringList = NIL;
+
+			taskList = lappend(taskList, bufferedTask);
+		}
+
+		shardInserts->queryStringList = lappend(shardInserts->queryStringList,
+												TaskQueryString(bufferedTask));
+	}
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		ShardBufferedInserts *shardInserts =
+			hash_search(shardInsertsHash, &task->anchorShardId, HASH_FIND, NULL);
+
+		if (list_length(shardInserts->queryStringList) > 1)
+		{
+			SetTaskQueryString(task, StringJoin(shardInserts->queryStringList, ';'));
+		}
+	}
+
+	ExecuteTaskList(modLevel, taskList);
+
+	hash_destroy(shardInsertsHash);
+	MemoryContextDelete(bufferedInsertContext);
+}
+
+
+/*
+ * ResetBufferedInserts forgets about the buffered INSERTs. It is called when
+ * the transaction ends, at which point their memory is freed along with the
+ * transaction memory.
+ */
+void
+ResetBufferedInserts(void)
+{
+	BufferedInsertTaskList = NIL;
+	BufferedInsertRowCount = 0;
+	BufferedInsertModLevel = ROW_MODIFY_NONE;
+	BufferedInsertContext = NULL;
+}
+
+
+/*
+ * InsertBufferingAllowed returns whether INSERTs may be buffered in the
+ * current transaction. We do not buffer in subtransactions, since the
+ * buffered commands of a subtransaction that is rolled back would have to be
+ * removed from the buffer.
+ */
+static bool
+InsertBufferingAllowed(void)
+{
+	return MaxBufferedInsertRows > 0 && IsMultiStatementTransaction() &&
+		   GetCurrentTransactionNestLevel() == 1;
+}
+
+
+/*
+ * IsBufferableInsertJob returns whether the given distributed plan is a plain
+ * router INSERT into a distributed table, which does not return anything
+ * that would be affected by buffering.
+ */
+static bool
+IsBufferableInsertJob(DistributedPlan *distributedPlan)
+{
+	Job *workerJob = distributedPlan->workerJob;
+
+	if (workerJob == NULL || workerJob->jobQuery == NULL ||
+		distributedPlan->modifyQueryViaCoordinatorOrRepartition != NULL ||
+		distributedPlan->subPlanList != NIL)
+	{
+		return false;
+	}
+
+	Query *jobQuery = workerJob->jobQuery;
+	if (jobQuery->commandType != CMD_INSERT || jobQuery->returningList != NIL ||
+		jobQuery->onConflict != NULL || jobQuery->cteList != NIL ||
+		CheckInsertSelectQuery(jobQuery))
+	{
+		return false;
+	}
+
+	Oid targetRelationId = ExtractFirstCitusTableId(jobQuery);
+
+	return IsCitusTableType(targetRelationId, HASH_DISTRIBUTED) ||
+		   IsCitusTableType(targetRelationId, SINGLE_SHARD_DISTRIBUTED);
+}
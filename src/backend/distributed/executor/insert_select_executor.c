@@ -2,7 +2,8 @@
  *
  * insert_select_executor.c
  *
- * Executor logic for INSERT..SELECT.
+ * Executor logic for INSERT..SELECT, and for multi-row INSERTs that are
+ * executed via COPY.
  *
  * Copyright (c) Citus Data, Inc.
  *-------------------------------------------------------------------------
@@ -18,6 +19,7 @@
 #include "nodes/nodeFuncs.h"
 #include "nodes/parsenodes.h"
 #include "nodes/plannodes.h"
+#include "optimizer/clauses.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_relation.h"
 #include "parser/parsetree.h"
@@ -29,6 +31,7 @@
 #include "utils/snapmgr.h"
 
 #include "distributed/adaptive_executor.h"
+#include "distributed/citus_custom_scan.h"
 #include "distributed/citus_ruleutils.h"
 #include "distributed/commands/multi_copy.h"
 #include "distributed/deparse_shard_query.h"
@@ -42,6 +45,7 @@
 #include "distributed/merge_planner.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/multi_executor.h"
+#include "distributed/multi_explain.h"
 #include "distributed/multi_partitioning_utils.h"
 #include "distributed/multi_physical_planner.h"
 #include "distributed/multi_router_planner.h"
@@ -56,6 +60,10 @@
 
 /* Config variables managed via guc.c */
 bool EnableRepartitionedInsertSelect = true;
+bool EnableRepartitionedInsertSelectPush = false;
+
+/* number of rows from which multi-row INSERTs are executed via COPY, -1 disables */
+int MultiRowInsertCopyThreshold = -1;
 
 
 static void ExecutePlanIntoRelation(Oid targetRelationId, List *insertTargetList,
@@ -66,6 +74,8 @@ static HTAB * ExecutePlanIntoColocatedIntermediateResults(Oid targetRelationId,
 														  EState *executorState,
 														  char *intermediateResultIdPrefix);
 static int PartitionColumnIndexFromColumnList(Oid relationId, List *columnNameList);
+static bool CanPushRepartitionedResults(CitusTableCacheEntry *targetRelation);
+static Datum EvaluateInsertValue(Expr *valueExpr, ExprContext *econtext, bool *isNull);
 static void WrapTaskListForProjection(List *taskList, List *projectedTargetEntries);
 
 
@@ -172,11 +182,28 @@ NonPushableInsertSelectExecScan(CustomScanState *node)
 				WrapTaskListForProjection(distSelectTaskList, projectedTargetEntries);
 			}
 
-			List **redistributedResults = RedistributeTaskListResults(distResultPrefix,
-																	  distSelectTaskList,
-																	  distributionColumnIndex,
-																	  targetRelation,
-																	  binaryFormat);
+			List **redistributedResults = NULL;
+			if (CanPushRepartitionedResults(targetRelation))
+			{
+				ereport(DEBUG1, (errmsg("pushing SELECT results to the nodes of the "
+										"target shards")));
+
+				redistributedResults = PushTasklistResultsToShards(distResultPrefix,
+																   distSelectTaskList,
+																   distributionColumnIndex,
+																   targetRelation,
+																   binaryFormat,
+																   false);
+			}
+			else
+			{
+				redistributedResults = RedistributeTaskListResults(distResultPrefix,
+																   distSelectTaskList,
+																   distributionColumnIndex,
+																   targetRelation,
+																   binaryFormat,
+																   false);
+			}
 
 			/*
 			 * At this point select query has been executed on workers and results
@@ -365,6 +392,148 @@ ExecutePlanIntoRelation(Oid targetRelationId, List *insertTargetList,
 }
 
 
+/*
+ * ShouldExecuteMultiRowInsertViaCopy returns whether the multi-row INSERT of the
+ * given scan should copy its rows into the shards rather than send an INSERT
+ * with a VALUES list per shard, which are expensive to deparse and parse for
+ * many rows. COPY cannot return rows or resolve conflicts, so INSERTs with
+ * RETURNING or ON CONFLICT keep using INSERT.
+ */
+bool
+ShouldExecuteMultiRowInsertViaCopy(CitusScanState *scanState)
+{
+	DistributedPlan *distributedPlan = scanState->distributedPlan;
+	Job *workerJob = distributedPlan->workerJob;
+
+	if (MultiRowInsertCopyThreshold < 0 || workerJob == NULL ||
+		workerJob->jobQuery == NULL)
+	{
+		return false;
+	}
+
+	Query *jobQuery = workerJob->jobQuery;
+	if (jobQuery->commandType != CMD_INSERT ||
+		jobQuery->returningList != NIL ||
+		jobQuery->onConflict != NULL ||
+		jobQuery->cteList != NIL ||
+		distributedPlan->subPlanList != NIL ||
+		RequestedForExplainAnalyze(scanState))
+	{
+		return false;
+	}
+
+	RangeTblEntry *valuesRTE = ExtractDistributedInsertValuesRTE(jobQuery);
+	if (valuesRTE == NULL ||
+		list_length(valuesRTE->values_lists) < MultiRowInsertCopyThreshold ||
+		contain_subplans((Node *) valuesRTE->values_lists))
+	{
+		return false;
+	}
+
+	/* COPY into append- or range-distributed tables behaves differently */
+	Oid targetRelationId = ExtractFirstCitusTableId(jobQuery);
+	return IsCitusTableType(targetRelationId, HASH_DISTRIBUTED) ||
+		   IsCitusTableType(targetRelationId, SINGLE_SHARD_DISTRIBUTED) ||
+		   IsCitusTableType(targetRelationId, REFERENCE_TABLE);
+}
+
+
+/*
+ * ExecuteMultiRowInsertViaCopy inserts the rows of the multi-row INSERT of the
+ * given scan into the target table via the COPY logic, which groups the rows by
+ * shard and sends them in binary format where possible.
+ *
+ * The planner normalized the INSERT such that the entries of the target list
+ * and the columns of the VALUES rows line up, and the values that require
+ * evaluation on the coordinator are evaluated by now.
+ */
+void
+ExecuteMultiRowInsertViaCopy(CitusScanState *scanState)
+{
+	EState *executorState = ScanStateGetExecutorState(scanState);
+	Query *jobQuery = scanState->distributedPlan->workerJob->jobQuery;
+	RangeTblEntry *valuesRTE = ExtractDistributedInsertValuesRTE(jobQuery);
+	Oid targetRelationId = ExtractFirstCitusTableId(jobQuery);
+	List *insertTargetList = jobQuery->targetList;
+
+	/* Get column name list and partition column index for the target table */
+	List *columnNameList = BuildColumnNameListFromTargetList(targetRelationId,
+															 insertTargetList);
+	int partitionColumnIndex = PartitionColumnIndexFromColumnList(targetRelationId,
+																  columnNameList);
+
+	/* set up a DestReceiver that copies into the distributed table */
+	const bool publishableData = true;
+	CitusCopyDestReceiver *copyDest = CreateCitusCopyDestReceiver(targetRelationId,
+																  columnNameList,
+																  partitionColumnIndex,
+																  executorState, NULL,
+																  publishableData);
+	DestReceiver *destReceiver = (DestReceiver *) copyDest;
+
+	TupleDesc tupleDescriptor = ExecTypeFromTL(insertTargetList);
+	TupleTableSlot *slot = MakeSingleTupleTableSlot(tupleDescriptor, &TTSOpsVirtual);
+	ExprContext *econtext = GetPerTupleExprContext(executorState);
+
+	destReceiver->rStartup(destReceiver, CMD_INSERT, tupleDescriptor);
+
+	List *rowValues = NIL;
+	foreach_ptr(rowValues, valuesRTE->values_lists)
+	{
+		ResetExprContext(econtext);
+		ExecClearTuple(slot);
+
+		int columnIndex = 0;
+		Expr *valueExpr = NULL;
+		foreach_ptr(valueExpr, rowValues)
+		{
+			slot->tts_values[columnIndex] =
+				EvaluateInsertValue(valueExpr, econtext, &slot->tts_isnull[columnIndex]);
+			columnIndex++;
+		}
+
+		ExecStoreVirtualTuple(slot);
+
+		destReceiver->receiveSlot(slot, destReceiver);
+	}
+
+	destReceiver->rShutdown(destReceiver);
+
+	executorState->es_processed = copyDest->tuplesSent;
+
+	destReceiver->rDestroy(destReceiver);
+	ExecDropSingleTupleTableSlot(slot);
+
+	XactModificationLevel = XACT_MODIFICATION_DATA;
+}
+
+
+/*
+ * EvaluateInsertValue returns the value of an expression in the VALUES list of
+ * an INSERT. Most values are constants, others, such as casts of constants,
+ * are evaluated in the per-tuple memory of the given expression context.
+ */
+static Datum
+EvaluateInsertValue(Expr *valueExpr, ExprContext *econtext, bool *isNull)
+{
+	if (IsA(valueExpr, Const))
+	{
+		Const *valueConst = (Const *) valueExpr;
+
+		*isNull = valueConst->constisnull;
+		return valueConst->constvalue;
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	ExprState *valueState = ExecInitExpr(valueExpr, NULL);
+
+	MemoryContextSwitchTo(oldContext);
+
+	return ExecEvalExprSwitchContext(valueState, econtext, isNull);
+}
+
+
 /*
  * BuildColumnNameListForCopyStatement build the column name list given the insert
  * target list.
@@ -471,3 +640,33 @@ WrapTaskListForProjection(List *taskList, List *projectedTargetEntries)
 		SetTaskQueryString(task, wrappedQuery->data);
 	}
 }
+
+
+/*
+ * CanPushRepartitionedResults returns whether the SELECT tasks of a repartitioned
+ * INSERT..SELECT can push their results to the nodes of the target shards,
+ * rather than writing them to local files that are then fetched. The results
+ * are pushed to a single node per shard, so the shards must not be replicated.
+ */
+static bool
+CanPushRepartitionedResults(CitusTableCacheEntry *targetRelation)
+{
+	if (!EnableRepartitionedInsertSelectPush)
+	{
+		return false;
+	}
+
+	int shardCount = targetRelation->shardIntervalArrayLength;
+	for (int shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardInterval *shardInterval =
+			targetRelation->sortedShardIntervalArray[shardIndex];
+
+		if (list_length(ActiveShardPlacementList(shardInterval->shardId)) != 1)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
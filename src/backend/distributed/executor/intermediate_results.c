@@ -23,6 +23,7 @@
 #include "nodes/makefuncs.h"
 #include "nodes/parsenodes.h"
 #include "nodes/primnodes.h"
+#include "portability/instr_time.h"
 #include "storage/fd.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
@@ -30,15 +31,19 @@
 #include "utils/memutils.h"
 #include "utils/syscache.h"
 
+#include "distributed/citus_wait_events.h"
+#include "distributed/column_result_format.h"
 #include "distributed/commands/multi_copy.h"
 #include "distributed/connection_management.h"
 #include "distributed/error_codes.h"
 #include "distributed/intermediate_results.h"
 #include "distributed/listutils.h"
+#include "distributed/memory_intermediate_results.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/metadata_utility.h"
 #include "distributed/multi_executor.h"
 #include "distributed/remote_commands.h"
+#include "distributed/result_compression.h"
 #include "distributed/transaction_identifier.h"
 #include "distributed/transmit.h"
 #include "distributed/tuplestore.h"
@@ -50,6 +55,12 @@
 
 static List *CreatedResultsDirectories = NIL;
 
+/* config variable managed via guc.c */
+int IntermediateResultBroadcastFanout = 0;
+
+/* statistics of the intermediate results created by this backend */
+static IntermediateResultStats BackendIntermediateResultStats;
+
 
 /* CopyDestReceiver can be used to stream results into a distributed table */
 typedef struct RemoteFileDestReceiver
@@ -72,14 +83,30 @@ typedef struct RemoteFileDestReceiver
 	List *initialNodeList;
 	List *connectionList;
 
+	/* worker nodes that fetch the result from other workers once it is sent */
+	List *forwardNodeList;
+
 	/* whether to write to a local file */
 	bool writeLocalFile;
 	FileCompat fileCompat;
+	bool localFileOpened;
+
+	/* local result data that is kept in memory while it is small enough */
+	StringInfo localResultData;
+	int64 localResultLimit;
 
 	/* state on how to copy out data types */
 	CopyOutState copyOutState;
 	FmgrInfo *columnOutputFunctions;
 
+	/* compression of the data sent to the nodes, and the data to compress next */
+	ResultCompressionType compressionType;
+	StringInfo uncompressedData;
+	StringInfo compressedFrame;
+
+	/* encodes the result in stripes when using the column-oriented format */
+	ColumnResultWriter *columnResultWriter;
+
 	/* statistics */
 	uint64 tuplesSent;
 	uint64 bytesSent;
@@ -98,22 +125,43 @@ typedef enum CopyStatus
 static void RemoteFileDestReceiverStartup(DestReceiver *dest, int operation,
 										  TupleDesc inputTupleDescriptor);
 static void PrepareIntermediateResultBroadcast(RemoteFileDestReceiver *resultDest);
-static StringInfo ConstructCopyResultStatement(const char *resultId);
+static void OpenLocalResultFile(RemoteFileDestReceiver *resultDest);
+static void WriteToLocalResult(RemoteFileDestReceiver *resultDest,
+							   StringInfo resultData);
+static void FinishLocalResult(RemoteFileDestReceiver *resultDest);
+static void WriteIntermediateResultFile(const char *fileName, StringInfo resultData);
+static StringInfo ConstructCopyResultStatement(const char *resultId,
+											   ResultCompressionType compressionType);
 static bool RemoteFileDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest);
+static void BroadcastResultData(RemoteFileDestReceiver *resultDest,
+								StringInfo dataBuffer);
+static void BroadcastCompressedResultData(RemoteFileDestReceiver *resultDest);
 static void BroadcastCopyData(StringInfo dataBuffer, List *connectionList);
+static void ForwardIntermediateResult(RemoteFileDestReceiver *resultDest,
+									  List *sourceNodeList);
 static void SendCopyDataOverConnection(StringInfo dataBuffer,
 									   MultiConnection *connection);
 static void RemoteFileDestReceiverShutdown(DestReceiver *destReceiver);
+static void RemoteFileDestReceiverShutdownInternal(RemoteFileDestReceiver *resultDest);
 static void RemoteFileDestReceiverDestroy(DestReceiver *destReceiver);
+static void AddIntermediateResultReceiverTime(instr_time startTime);
 
 static char * IntermediateResultsDirectory(void);
 static void ReadIntermediateResultsIntoFuncOutput(FunctionCallInfo fcinfo,
 												  char *copyFormat,
 												  Datum *resultIdArray,
 												  int resultCount);
-static uint64 FetchRemoteIntermediateResult(MultiConnection *connection, char *resultId);
+static int64 LocalIntermediateResultSize(const char *resultId);
+static uint64 FetchRemoteIntermediateResults(MultiConnection *connection,
+											 List *resultIdList);
+static uint64 ReceiveRemoteIntermediateResult(MultiConnection *connection,
+											  char *resultId,
+											  ResultCompressionType compressionType,
+											  StringInfo decompressedData);
 static CopyStatus CopyDataFromConnection(MultiConnection *connection,
 										 FileCompat *fileCompat,
+										 ResultCompressionType compressionType,
+										 StringInfo decompressedData,
 										 uint64 *bytesReceived);
 
 /* exports for SQL callable functions */
@@ -232,6 +280,7 @@ CreateRemoteFileDestReceiver(const char *resultId, EState *executorState,
 	resultDest->initialNodeList = initialNodeList;
 	resultDest->memoryContext = CurrentMemoryContext;
 	resultDest->writeLocalFile = writeLocalFile;
+	resultDest->compressionType = IntermediateResultCompression;
 
 	return (DestReceiver *) resultDest;
 }
@@ -248,6 +297,49 @@ RemoteFileDestReceiverBytesSent(DestReceiver *destReceiver)
 }
 
 
+/*
+ * GetIntermediateResultStats copies the statistics of the intermediate
+ * results that this backend created so far into stats. Callers take the
+ * difference of two calls to get the statistics of a single query.
+ */
+void
+GetIntermediateResultStats(IntermediateResultStats *stats)
+{
+	*stats = BackendIntermediateResultStats;
+}
+
+
+/*
+ * SubtractIntermediateResultStats subtracts statsAtStart from stats.
+ */
+void
+SubtractIntermediateResultStats(IntermediateResultStats *stats,
+								IntermediateResultStats *statsAtStart)
+{
+	stats->resultCount -= statsAtStart->resultCount;
+	stats->bytesWritten -= statsAtStart->bytesWritten;
+	stats->bytesBroadcast -= statsAtStart->bytesBroadcast;
+	stats->receivingNodeCount -= statsAtStart->receivingNodeCount;
+	stats->receiverTime -= statsAtStart->receiverTime;
+}
+
+
+/*
+ * AddIntermediateResultReceiverTime adds the time since startTime to the
+ * time spent in the RemoteFileDestReceiver.
+ */
+static void
+AddIntermediateResultReceiverTime(instr_time startTime)
+{
+	instr_time duration;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, startTime);
+
+	BackendIntermediateResultStats.receiverTime += INSTR_TIME_GET_MILLISEC(duration);
+}
+
+
 /*
  * RemoteFileDestReceiverStartup implements the rStartup interface of
  * RemoteFileDestReceiver. It opens connections to the nodes in initialNodeList,
@@ -258,6 +350,9 @@ RemoteFileDestReceiverStartup(DestReceiver *dest, int operation,
 							  TupleDesc inputTupleDescriptor)
 {
 	RemoteFileDestReceiver *resultDest = (RemoteFileDestReceiver *) dest;
+	instr_time startTime;
+
+	INSTR_TIME_SET_CURRENT(startTime);
 
 	const char *delimiterCharacter = "\t";
 	const char *nullPrintCharacter = "\\N";
@@ -276,6 +371,22 @@ RemoteFileDestReceiverStartup(DestReceiver *dest, int operation,
 
 	resultDest->columnOutputFunctions = ColumnOutputFunctions(inputTupleDescriptor,
 															  copyOutState->binary);
+
+	if (IntermediateResultFormat == INTERMEDIATE_RESULT_FORMAT_COLUMNAR)
+	{
+		/* the writer compresses the column chunks, so we send them as they are */
+		resultDest->columnResultWriter =
+			CreateColumnResultWriter(inputTupleDescriptor, resultDest->compressionType);
+		resultDest->compressionType = RESULT_COMPRESSION_NONE;
+	}
+
+	if (resultDest->compressionType != RESULT_COMPRESSION_NONE)
+	{
+		resultDest->uncompressedData = makeStringInfo();
+		resultDest->compressedFrame = makeStringInfo();
+	}
+
+	AddIntermediateResultReceiverTime(startTime);
 }
 
 
@@ -292,17 +403,34 @@ PrepareIntermediateResultBroadcast(RemoteFileDestReceiver *resultDest)
 	List *connectionList = NIL;
 	CopyOutState copyOutState = resultDest->copyOutState;
 
-	if (resultDest->writeLocalFile)
+	if (IntermediateResultBroadcastFanout > 0 &&
+		list_length(initialNodeList) > IntermediateResultBroadcastFanout)
 	{
-		const int fileFlags = (O_APPEND | O_CREAT | O_RDWR | O_TRUNC | PG_BINARY);
-
-		/* make sure the directory exists */
-		CreateIntermediateResultsDirectory();
+		/*
+		 * Only send the result to the first nodes, the other nodes fetch it
+		 * from the nodes that have it once it is complete.
+		 */
+		resultDest->forwardNodeList =
+			list_copy_tail(initialNodeList, IntermediateResultBroadcastFanout);
+		initialNodeList = list_truncate(list_copy(initialNodeList),
+										IntermediateResultBroadcastFanout);
+	}
 
-		const char *fileName = QueryResultFileName(resultId);
+	if (resultDest->writeLocalFile)
+	{
+		resultDest->localResultLimit = MemoryIntermediateResultLimit();
 
-		resultDest->fileCompat = FileCompatFromFileStart(FileOpenForTransmit(fileName,
-																			 fileFlags));
+		if (resultDest->localResultLimit >= 0)
+		{
+			/* keep the result in memory until it becomes too large */
+			MemoryContext oldContext = MemoryContextSwitchTo(resultDest->memoryContext);
+			resultDest->localResultData = makeStringInfo();
+			MemoryContextSwitchTo(oldContext);
+		}
+		else
+		{
+			OpenLocalResultFile(resultDest);
+		}
 	}
 
 	WorkerNode *workerNode = NULL;
@@ -328,7 +456,8 @@ PrepareIntermediateResultBroadcast(RemoteFileDestReceiver *resultDest)
 	MultiConnection *connection = NULL;
 	foreach_ptr(connection, connectionList)
 	{
-		StringInfo copyCommand = ConstructCopyResultStatement(resultId);
+		StringInfo copyCommand = ConstructCopyResultStatement(resultId,
+															  resultDest->compressionType);
 
 		bool querySent = SendRemoteCommand(connection, copyCommand->data);
 		if (!querySent)
@@ -350,20 +479,33 @@ PrepareIntermediateResultBroadcast(RemoteFileDestReceiver *resultDest)
 		PQclear(result);
 	}
 
-	if (copyOutState->binary)
+	resultDest->connectionList = connectionList;
+
+	if (resultDest->columnResultWriter != NULL)
+	{
+		/* send the header that describes the columns */
+		resetStringInfo(copyOutState->fe_msgbuf);
+		ColumnResultWriterAppendHeader(resultDest->columnResultWriter,
+									   copyOutState->fe_msgbuf);
+		BroadcastResultData(resultDest, copyOutState->fe_msgbuf);
+
+		if (resultDest->writeLocalFile)
+		{
+			WriteToLocalResult(resultDest, copyOutState->fe_msgbuf);
+		}
+	}
+	else if (copyOutState->binary)
 	{
 		/* send headers when using binary encoding */
 		resetStringInfo(copyOutState->fe_msgbuf);
 		AppendCopyBinaryHeaders(copyOutState);
-		BroadcastCopyData(copyOutState->fe_msgbuf, connectionList);
+		BroadcastResultData(resultDest, copyOutState->fe_msgbuf);
 
 		if (resultDest->writeLocalFile)
 		{
-			WriteToLocalFile(copyOutState->fe_msgbuf, &resultDest->fileCompat);
+			WriteToLocalResult(resultDest, copyOutState->fe_msgbuf);
 		}
 	}
-
-	resultDest->connectionList = connectionList;
 }
 
 
@@ -372,13 +514,21 @@ PrepareIntermediateResultBroadcast(RemoteFileDestReceiver *resultDest)
  * for copying into a result file.
  */
 static StringInfo
-ConstructCopyResultStatement(const char *resultId)
+ConstructCopyResultStatement(const char *resultId, ResultCompressionType compressionType)
 {
 	StringInfo command = makeStringInfo();
 
-	appendStringInfo(command, "COPY \"%s\" FROM STDIN WITH (format result)",
+	appendStringInfo(command, "COPY \"%s\" FROM STDIN WITH (format result",
 					 resultId);
 
+	if (compressionType != RESULT_COMPRESSION_NONE)
+	{
+		appendStringInfo(command, ", compression '%s'",
+						 ResultCompressionName(compressionType));
+	}
+
+	appendStringInfoString(command, ")");
+
 	return command;
 }
 
@@ -392,6 +542,9 @@ static bool
 RemoteFileDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 {
 	RemoteFileDestReceiver *resultDest = (RemoteFileDestReceiver *) dest;
+	instr_time startTime;
+
+	INSTR_TIME_SET_CURRENT(startTime);
 
 	if (resultDest->tuplesSent == 0)
 	{
@@ -404,7 +557,6 @@ RemoteFileDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 
 	TupleDesc tupleDescriptor = resultDest->tupleDescriptor;
 
-	List *connectionList = resultDest->connectionList;
 	CopyOutState copyOutState = resultDest->copyOutState;
 	FmgrInfo *columnOutputFunctions = resultDest->columnOutputFunctions;
 
@@ -421,17 +573,33 @@ RemoteFileDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 
 	resetStringInfo(copyData);
 
-	/* construct row in COPY format */
-	AppendCopyRowData(columnValues, columnNulls, tupleDescriptor,
-					  copyOutState, columnOutputFunctions, NULL);
-
-	/* send row to nodes */
-	BroadcastCopyData(copyData, connectionList);
+	if (resultDest->columnResultWriter != NULL)
+	{
+		/* add the row to the current stripe, which we send once it is full */
+		bool stripeFull = ColumnResultWriterAddRow(resultDest->columnResultWriter,
+												   columnValues, columnNulls);
+		if (stripeFull)
+		{
+			ColumnResultWriterAppendStripe(resultDest->columnResultWriter, copyData);
+		}
+	}
+	else
+	{
+		/* construct row in COPY format */
+		AppendCopyRowData(columnValues, columnNulls, tupleDescriptor,
+						  copyOutState, columnOutputFunctions, NULL);
+	}
 
-	/* write to local file (if applicable) */
-	if (resultDest->writeLocalFile)
+	if (copyData->len > 0)
 	{
-		WriteToLocalFile(copyOutState->fe_msgbuf, &resultDest->fileCompat);
+		/* send row to nodes */
+		BroadcastResultData(resultDest, copyData);
+
+		/* write to local file (if applicable) */
+		if (resultDest->writeLocalFile)
+		{
+			WriteToLocalResult(resultDest, copyOutState->fe_msgbuf);
+		}
 	}
 
 	MemoryContextSwitchTo(oldContext);
@@ -441,6 +609,8 @@ RemoteFileDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 
 	ResetPerTupleExprContext(executorState);
 
+	AddIntermediateResultReceiverTime(startTime);
+
 	return true;
 }
 
@@ -471,7 +641,29 @@ static void
 RemoteFileDestReceiverShutdown(DestReceiver *destReceiver)
 {
 	RemoteFileDestReceiver *resultDest = (RemoteFileDestReceiver *) destReceiver;
+	instr_time startTime;
+
+	INSTR_TIME_SET_CURRENT(startTime);
+
+	RemoteFileDestReceiverShutdownInternal(resultDest);
+
+	BackendIntermediateResultStats.resultCount++;
+	BackendIntermediateResultStats.bytesWritten += resultDest->bytesSent;
+	BackendIntermediateResultStats.receivingNodeCount +=
+		list_length(resultDest->initialNodeList);
+
+	AddIntermediateResultReceiverTime(startTime);
+}
 
+
+/*
+ * RemoteFileDestReceiverShutdownInternal ends the COPY on all the open
+ * connections, lets the remaining nodes fetch the result and finishes the
+ * local result.
+ */
+static void
+RemoteFileDestReceiverShutdownInternal(RemoteFileDestReceiver *resultDest)
+{
 	if (resultDest->tuplesSent == 0)
 	{
 		/*
@@ -486,29 +678,287 @@ RemoteFileDestReceiverShutdown(DestReceiver *destReceiver)
 	List *connectionList = resultDest->connectionList;
 	CopyOutState copyOutState = resultDest->copyOutState;
 
-	if (copyOutState->binary)
+	if (resultDest->columnResultWriter != NULL)
+	{
+		/* send the last stripe and the end of file marker */
+		resetStringInfo(copyOutState->fe_msgbuf);
+		ColumnResultWriterAppendStripe(resultDest->columnResultWriter,
+									   copyOutState->fe_msgbuf);
+		ColumnResultWriterAppendFooter(resultDest->columnResultWriter,
+									   copyOutState->fe_msgbuf);
+		BroadcastResultData(resultDest, copyOutState->fe_msgbuf);
+
+		if (resultDest->writeLocalFile)
+		{
+			WriteToLocalResult(resultDest, copyOutState->fe_msgbuf);
+		}
+
+		resultDest->bytesSent += copyOutState->fe_msgbuf->len;
+	}
+	else if (copyOutState->binary)
 	{
 		/* send footers when using binary encoding */
 		resetStringInfo(copyOutState->fe_msgbuf);
 		AppendCopyBinaryFooters(copyOutState);
-		BroadcastCopyData(copyOutState->fe_msgbuf, connectionList);
+		BroadcastResultData(resultDest, copyOutState->fe_msgbuf);
 
 		if (resultDest->writeLocalFile)
 		{
-			WriteToLocalFile(copyOutState->fe_msgbuf, &resultDest->fileCompat);
+			WriteToLocalResult(resultDest, copyOutState->fe_msgbuf);
 		}
 	}
 
+	if (resultDest->compressionType != RESULT_COMPRESSION_NONE &&
+		resultDest->uncompressedData->len > 0)
+	{
+		BroadcastCompressedResultData(resultDest);
+	}
+
 	/* close the COPY input */
 	EndRemoteCopy(0, connectionList);
 
+	if (resultDest->forwardNodeList != NIL)
+	{
+		int sourceNodeCount = list_length(resultDest->initialNodeList) -
+							  list_length(resultDest->forwardNodeList);
+		List *sourceNodeList = list_truncate(list_copy(resultDest->initialNodeList),
+											 sourceNodeCount);
+
+		ForwardIntermediateResult(resultDest, sourceNodeList);
+	}
+
 	if (resultDest->writeLocalFile)
+	{
+		FinishLocalResult(resultDest);
+	}
+}
+
+
+/*
+ * ForwardIntermediateResult lets the nodes in the forwardNodeList of the
+ * destination fetch the result from the nodes in sourceNodeList, which have
+ * the complete result. This happens in rounds in which every node that has
+ * the result serves up to citus.intermediate_result_broadcast_fanout nodes,
+ * such that the number of nodes that have the result grows geometrically
+ * while the coordinator only sends the result to the first nodes.
+ *
+ * The nodes fetch the result using fetch_intermediate_results over the
+ * connections of the coordinated transaction, which makes them join the
+ * distributed transaction on the source node and write the result in the
+ * same directory as the result that is sent by the coordinator.
+ */
+static void
+ForwardIntermediateResult(RemoteFileDestReceiver *resultDest, List *sourceNodeList)
+{
+	int fanout = IntermediateResultBroadcastFanout;
+	List *remainingNodeList = resultDest->forwardNodeList;
+	const char *quotedResultId = quote_literal_cstr(resultDest->resultId);
+
+	while (remainingNodeList != NIL)
+	{
+		List *connectionList = NIL;
+		List *commandList = NIL;
+		List *targetNodeList = NIL;
+
+		WorkerNode *sourceNode = NULL;
+		foreach_ptr(sourceNode, sourceNodeList)
+		{
+			for (int targetIndex = 0; targetIndex < fanout &&
+				 remainingNodeList != NIL; targetIndex++)
+			{
+				WorkerNode *targetNode = (WorkerNode *) linitial(remainingNodeList);
+				remainingNodeList = list_delete_first(remainingNodeList);
+
+				int flags = 0;
+				MultiConnection *connection = StartNodeConnection(flags,
+																  targetNode->workerName,
+																  targetNode->workerPort);
+				ClaimConnectionExclusively(connection);
+				MarkRemoteTransactionCritical(connection);
+
+				StringInfo fetchCommand = makeStringInfo();
+				appendStringInfo(fetchCommand,
+								 "SELECT fetch_intermediate_results(ARRAY[%s]::text[], "
+								 "%s, %d)", quotedResultId,
+								 quote_literal_cstr(sourceNode->workerName),
+								 sourceNode->workerPort);
+
+				connectionList = lappend(connectionList, connection);
+				commandList = lappend(commandList, fetchCommand->data);
+				targetNodeList = lappend(targetNodeList, targetNode);
+			}
+		}
+
+		FinishConnectionListEstablishment(connectionList);
+
+		/* must open transaction blocks to use intermediate results */
+		RemoteTransactionsBeginIfNecessary(connectionList);
+
+		MultiConnection *connection = NULL;
+		char *fetchCommand = NULL;
+		forboth_ptr(connection, connectionList, fetchCommand, commandList)
+		{
+			if (!SendRemoteCommand(connection, fetchCommand))
+			{
+				ReportConnectionError(connection, ERROR);
+			}
+		}
+
+		foreach_ptr(connection, connectionList)
+		{
+			bool raiseInterrupts = true;
+
+			PGresult *result = GetRemoteCommandResult(connection, raiseInterrupts);
+			if (!IsResponseOK(result))
+			{
+				ReportResultError(connection, result, ERROR);
+			}
+
+			PQclear(result);
+			ForgetResults(connection);
+			UnclaimConnection(connection);
+		}
+
+		/* the nodes that fetched the result can serve it in the next round */
+		sourceNodeList = list_concat(sourceNodeList, targetNodeList);
+	}
+}
+
+
+/*
+ * OpenLocalResultFile creates the local file of the intermediate result.
+ */
+static void
+OpenLocalResultFile(RemoteFileDestReceiver *resultDest)
+{
+	const int fileFlags = (O_APPEND | O_CREAT | O_RDWR | O_TRUNC | PG_BINARY);
+
+	/* make sure the directory exists */
+	CreateIntermediateResultsDirectory();
+
+	const char *fileName = QueryResultFileName(resultDest->resultId);
+
+	/* an earlier result with the same name may be in memory */
+	RemoveMemoryIntermediateResult(fileName);
+
+	resultDest->fileCompat = FileCompatFromFileStart(FileOpenForTransmit(fileName,
+																		 fileFlags));
+	resultDest->localFileOpened = true;
+}
+
+
+/*
+ * WriteToLocalResult appends data to the local intermediate result. The data
+ * is kept in memory until the result exceeds
+ * citus.intermediate_result_memory_threshold, after which the result is written
+ * to the local file.
+ */
+static void
+WriteToLocalResult(RemoteFileDestReceiver *resultDest, StringInfo resultData)
+{
+	StringInfo localResultData = resultDest->localResultData;
+
+	if (localResultData != NULL &&
+		(int64) localResultData->len + resultData->len > resultDest->localResultLimit)
+	{
+		/* the result no longer fits in memory, move it to the file */
+		OpenLocalResultFile(resultDest);
+		WriteToLocalFile(localResultData, &resultDest->fileCompat);
+
+		pfree(localResultData->data);
+		pfree(localResultData);
+		resultDest->localResultData = NULL;
+	}
+
+	if (resultDest->localResultData != NULL)
+	{
+		appendBinaryStringInfo(resultDest->localResultData, resultData->data,
+							   resultData->len);
+	}
+	else
+	{
+		WriteToLocalFile(resultData, &resultDest->fileCompat);
+	}
+}
+
+
+/*
+ * FinishLocalResult stores the local intermediate result in memory if it is
+ * still small enough, and otherwise closes its file.
+ */
+static void
+FinishLocalResult(RemoteFileDestReceiver *resultDest)
+{
+	if (resultDest->localResultData != NULL)
+	{
+		const char *fileName = QueryResultFileName(resultDest->resultId);
+
+		if (!StoreMemoryIntermediateResult(fileName, resultDest->localResultData))
+		{
+			/* there is no room in memory, write the result to the file */
+			OpenLocalResultFile(resultDest);
+			WriteToLocalFile(resultDest->localResultData, &resultDest->fileCompat);
+		}
+	}
+
+	if (resultDest->localFileOpened)
 	{
 		FileClose(resultDest->fileCompat.fd);
+		resultDest->localFileOpened = false;
+	}
+}
+
+
+/*
+ * BroadcastResultData sends result data to the nodes of the destination. With
+ * compression, the data is buffered until it fills a frame.
+ */
+static void
+BroadcastResultData(RemoteFileDestReceiver *resultDest, StringInfo dataBuffer)
+{
+	if (resultDest->compressionType == RESULT_COMPRESSION_NONE ||
+		resultDest->connectionList == NIL)
+	{
+		BroadcastCopyData(dataBuffer, resultDest->connectionList);
+		return;
+	}
+
+	appendBinaryStringInfo(resultDest->uncompressedData, dataBuffer->data,
+						   dataBuffer->len);
+
+	if (resultDest->uncompressedData->len >= RESULT_COMPRESSION_FRAME_SIZE)
+	{
+		BroadcastCompressedResultData(resultDest);
 	}
 }
 
 
+/*
+ * BroadcastCompressedResultData compresses the buffered result data into
+ * frames, sends them to the nodes of the destination and empties the buffer.
+ */
+static void
+BroadcastCompressedResultData(RemoteFileDestReceiver *resultDest)
+{
+	StringInfo uncompressedData = resultDest->uncompressedData;
+	StringInfo compressedFrame = resultDest->compressedFrame;
+
+	for (int offset = 0; offset < uncompressedData->len;
+		 offset += RESULT_COMPRESSION_FRAME_SIZE)
+	{
+		int frameLength = Min(uncompressedData->len - offset,
+							  RESULT_COMPRESSION_FRAME_SIZE);
+
+		CompressResultFrame(resultDest->compressionType,
+							uncompressedData->data + offset, frameLength,
+							compressedFrame);
+		BroadcastCopyData(compressedFrame, resultDest->connectionList);
+	}
+
+	resetStringInfo(uncompressedData);
+}
+
+
 /*
  * BroadcastCopyData sends copy data to all connections in a list.
  */
@@ -520,6 +970,9 @@ BroadcastCopyData(StringInfo dataBuffer, List *connectionList)
 	{
 		SendCopyDataOverConnection(dataBuffer, connection);
 	}
+
+	BackendIntermediateResultStats.bytesBroadcast +=
+		(uint64) dataBuffer->len * list_length(connectionList);
 }
 
 
@@ -563,14 +1016,22 @@ RemoteFileDestReceiverDestroy(DestReceiver *destReceiver)
 /*
  * SendQueryResultViaCopy is called when a COPY "resultid" TO STDOUT
  * WITH (format result) command is received from the client. The
- * contents of the file are sent directly to the client.
+ * contents of the file are sent directly to the client, in compressed
+ * frames if the client asked for a compression.
  */
 void
-SendQueryResultViaCopy(const char *resultId)
+SendQueryResultViaCopy(const char *resultId, ResultCompressionType compressionType)
 {
 	const char *resultFileName = QueryResultFileName(resultId);
 
-	SendRegularFile(resultFileName);
+	StringInfo resultData = FetchMemoryIntermediateResult(resultFileName);
+	if (resultData != NULL)
+	{
+		SendRegularBuffer(resultData, compressionType);
+		return;
+	}
+
+	SendRegularFile(resultFileName, compressionType);
 }
 
 
@@ -578,19 +1039,54 @@ SendQueryResultViaCopy(const char *resultId)
  * ReceiveQueryResultViaCopy is called when a COPY "resultid" FROM
  * STDIN WITH (format result) command is received from the client.
  * The command is followed by the raw copy data stream, which is
- * redirected to a file.
+ * redirected to a file after decompressing it if the client uses a
+ * compression. Results of at most citus.intermediate_result_memory_threshold
+ * are kept in memory instead.
  *
  * File names are automatically prefixed with the user OID. Users
  * are only allowed to read query results from their own directory.
  */
 void
-ReceiveQueryResultViaCopy(const char *resultId)
+ReceiveQueryResultViaCopy(const char *resultId, ResultCompressionType compressionType)
 {
 	CreateIntermediateResultsDirectory();
 
 	const char *resultFileName = QueryResultFileName(resultId);
+	int64 memoryLimit = MemoryIntermediateResultLimit();
+
+	/* an earlier result with the same name may be in memory */
+	RemoveMemoryIntermediateResult(resultFileName);
 
-	RedirectCopyDataToRegularFile(resultFileName);
+	if (memoryLimit < 0)
+	{
+		RedirectCopyDataToRegularFile(resultFileName, compressionType);
+		return;
+	}
+
+	StringInfo resultData = RedirectCopyDataToBufferOrFile(resultFileName,
+														   compressionType,
+														   memoryLimit);
+	if (resultData != NULL && !StoreMemoryIntermediateResult(resultFileName, resultData))
+	{
+		/* there is no room in memory, write the result to the file */
+		WriteIntermediateResultFile(resultFileName, resultData);
+	}
+}
+
+
+/*
+ * WriteIntermediateResultFile writes the given result data to a new file.
+ */
+static void
+WriteIntermediateResultFile(const char *fileName, StringInfo resultData)
+{
+	const int fileFlags = (O_APPEND | O_CREAT | O_RDWR | O_TRUNC | PG_BINARY);
+	File fileDesc = FileOpenForTransmit(fileName, fileFlags);
+	FileCompat fileCompat = FileCompatFromFileStart(fileDesc);
+
+	WriteToLocalFile(resultData, &fileCompat);
+
+	FileClose(fileDesc);
 }
 
 
@@ -711,6 +1207,9 @@ IntermediateResultsDirectory(void)
 void
 RemoveIntermediateResultsDirectories(void)
 {
+	/* results in memory have the same lifetime as the directories */
+	RemoveMemoryIntermediateResults();
+
 	char *directoryElement = NULL;
 	foreach_ptr(directoryElement, CreatedResultsDirectories)
 	{
@@ -751,8 +1250,8 @@ RemoveIntermediateResultsDirectories(void)
 
 
 /*
- * IntermediateResultSize returns the file size of the intermediate result
- * or -1 if the file does not exist.
+ * IntermediateResultSize returns the size of the intermediate result in
+ * memory or of its file, or -1 if the result does not exist.
  */
 int64
 IntermediateResultSize(const char *resultId)
@@ -760,6 +1259,13 @@ IntermediateResultSize(const char *resultId)
 	struct stat fileStat;
 
 	char *resultFileName = QueryResultFileName(resultId);
+
+	int64 memoryResultSize = MemoryIntermediateResultSize(resultFileName);
+	if (memoryResultSize >= 0)
+	{
+		return memoryResultSize;
+	}
+
 	int statOK = stat(resultFileName, &fileStat);
 	if (statOK < 0)
 	{
@@ -778,7 +1284,8 @@ IntermediateResultSize(const char *resultId)
  * SELECT * FROM read_intermediate_result('foo', 'csv') AS (a int, b int)
  *
  * The file is read from the directory returned by IntermediateResultsDirectory,
- * which includes the user ID.
+ * which includes the user ID. Files in the column-oriented format describe
+ * their own encoding, so the format argument is ignored for them.
  *
  * read_intermediate_result is a volatile function because it cannot be
  * evaluated until execution time, but for distributed planning purposes we can
@@ -848,6 +1355,25 @@ ReadIntermediateResultsIntoFuncOutput(FunctionCallInfo fcinfo, char *copyFormat,
 		char *resultFileName = QueryResultFileName(resultId);
 		struct stat fileStat;
 
+		StringInfo resultData = FetchMemoryIntermediateResult(resultFileName);
+		if (resultData != NULL)
+		{
+			if (IsColumnResultData(resultData))
+			{
+				ReadColumnResultDataIntoTupleStore(resultFileName, resultData,
+												   tupleDescriptor, tupleStore);
+			}
+			else
+			{
+				ReadBufferIntoTupleStore(resultData, copyFormat, tupleDescriptor,
+										 tupleStore);
+			}
+
+			pfree(resultData->data);
+			pfree(resultData);
+			continue;
+		}
+
 		int statOK = stat(resultFileName, &fileStat);
 		if (statOK != 0)
 		{
@@ -872,6 +1398,11 @@ ReadIntermediateResultsIntoFuncOutput(FunctionCallInfo fcinfo, char *copyFormat,
 									 "error in a parallel process within the same "
 									 "distributed transaction", resultId)));
 		}
+		else if (IsColumnResultFile(resultFileName))
+		{
+			ReadColumnResultFileIntoTupleStore(resultFileName, tupleDescriptor,
+											   tupleStore);
+		}
 		else
 		{
 			ReadFileIntoTupleStore(resultFileName, copyFormat, tupleDescriptor,
@@ -935,11 +1466,26 @@ fetch_intermediate_results(PG_FUNCTION_ARGS)
 
 	CreateIntermediateResultsDirectory();
 
+	List *remoteResultIdList = NIL;
+
 	for (resultIndex = 0; resultIndex < resultCount; resultIndex++)
 	{
 		char *resultId = TextDatumGetCString(resultIdArray[resultIndex]);
 
-		totalBytesWritten += FetchRemoteIntermediateResult(connection, resultId);
+		int64 localResultSize = LocalIntermediateResultSize(resultId);
+		if (localResultSize >= 0)
+		{
+			totalBytesWritten += localResultSize;
+			continue;
+		}
+
+		remoteResultIdList = lappend(remoteResultIdList, resultId);
+	}
+
+	if (remoteResultIdList != NIL)
+	{
+		totalBytesWritten += FetchRemoteIntermediateResults(connection,
+															remoteResultIdList);
 	}
 
 	ExecuteCriticalRemoteCommand(connection, "END");
@@ -951,14 +1497,21 @@ fetch_intermediate_results(PG_FUNCTION_ARGS)
 
 
 /*
- * FetchRemoteIntermediateResult fetches a remote intermediate result over
- * the given connection.
+ * LocalIntermediateResultSize returns the size of the intermediate result with
+ * the given ID if it already exists on this node, or -1 if it does not.
  */
-static uint64
-FetchRemoteIntermediateResult(MultiConnection *connection, char *resultId)
+static int64
+LocalIntermediateResultSize(const char *resultId)
 {
 	char *localPath = QueryResultFileName(resultId);
 
+	int64 memoryResultSize = MemoryIntermediateResultSize(localPath);
+	if (memoryResultSize >= 0)
+	{
+		/* the result is in memory, for the same reason as below */
+		return memoryResultSize;
+	}
+
 	struct stat fileStat;
 	int statOK = stat(localPath, &fileStat);
 	if (statOK == 0)
@@ -970,23 +1523,83 @@ FetchRemoteIntermediateResult(MultiConnection *connection, char *resultId)
 		return fileStat.st_size;
 	}
 
-	uint64 totalBytesWritten = 0;
+	return -1;
+}
 
-	StringInfo copyCommand = makeStringInfo();
-	const int fileFlags = (O_APPEND | O_CREAT | O_RDWR | O_TRUNC | PG_BINARY);
 
-	PGconn *pgConn = connection->pgConn;
-	int socket = PQsocket(pgConn);
+/*
+ * FetchRemoteIntermediateResults fetches a list of remote intermediate results
+ * over the given connection.
+ *
+ * All COPY commands are sent in a single multi-statement query, such that the
+ * remote node streams the results back-to-back and fetching many small
+ * results does not cost a round trip per result.
+ */
+static uint64
+FetchRemoteIntermediateResults(MultiConnection *connection, List *resultIdList)
+{
+	ResultCompressionType compressionType = IntermediateResultCompression;
+	StringInfo decompressedData = NULL;
+	StringInfo copyCommands = makeStringInfo();
+	uint64 totalBytesWritten = 0;
 	bool raiseErrors = true;
 
-	appendStringInfo(copyCommand, "COPY \"%s\" TO STDOUT WITH (format result)",
-					 resultId);
+	if (compressionType != RESULT_COMPRESSION_NONE)
+	{
+		decompressedData = makeStringInfo();
+	}
+
+	char *resultId = NULL;
+	foreach_ptr(resultId, resultIdList)
+	{
+		appendStringInfo(copyCommands, "COPY \"%s\" TO STDOUT WITH (format result",
+						 resultId);
+
+		if (compressionType != RESULT_COMPRESSION_NONE)
+		{
+			appendStringInfo(copyCommands, ", compression '%s'",
+							 ResultCompressionName(compressionType));
+		}
 
-	if (!SendRemoteCommand(connection, copyCommand->data))
+		appendStringInfoString(copyCommands, ");");
+	}
+
+	if (!SendRemoteCommand(connection, copyCommands->data))
 	{
 		ReportConnectionError(connection, ERROR);
 	}
 
+	foreach_ptr(resultId, resultIdList)
+	{
+		totalBytesWritten += ReceiveRemoteIntermediateResult(connection, resultId,
+															 compressionType,
+															 decompressedData);
+	}
+
+	ClearResults(connection, raiseErrors);
+
+	return totalBytesWritten;
+}
+
+
+/*
+ * ReceiveRemoteIntermediateResult receives the output of the next COPY command
+ * on the given connection into a local intermediate result file.
+ */
+static uint64
+ReceiveRemoteIntermediateResult(MultiConnection *connection, char *resultId,
+								ResultCompressionType compressionType,
+								StringInfo decompressedData)
+{
+	char *localPath = QueryResultFileName(resultId);
+	uint64 totalBytesWritten = 0;
+
+	const int fileFlags = (O_APPEND | O_CREAT | O_RDWR | O_TRUNC | PG_BINARY);
+
+	PGconn *pgConn = connection->pgConn;
+	int socket = PQsocket(pgConn);
+	bool raiseErrors = true;
+
 	PGresult *result = GetRemoteCommandResult(connection, raiseErrors);
 	if (PQresultStatus(result) != PGRES_COPY_OUT)
 	{
@@ -1003,6 +1616,7 @@ FetchRemoteIntermediateResult(MultiConnection *connection, char *resultId)
 		int waitFlags = WL_SOCKET_READABLE | WL_POSTMASTER_DEATH;
 
 		CopyStatus copyStatus = CopyDataFromConnection(connection, &fileCompat,
+													   compressionType, decompressedData,
 													   &totalBytesWritten);
 		if (copyStatus == CLIENT_COPY_FAILED)
 		{
@@ -1016,7 +1630,8 @@ FetchRemoteIntermediateResult(MultiConnection *connection, char *resultId)
 
 		Assert(copyStatus == CLIENT_COPY_MORE);
 
-		int rc = WaitLatchOrSocket(MyLatch, waitFlags, socket, 0, PG_WAIT_EXTENSION);
+		int rc = WaitLatchOrSocket(MyLatch, waitFlags, socket, 0,
+								   WAIT_EVENT_CITUS_INTERMEDIATE_RESULT_FETCH);
 		if (rc & WL_POSTMASTER_DEATH)
 		{
 			ereport(ERROR, (errmsg("postmaster was shut down, exiting")));
@@ -1031,19 +1646,19 @@ FetchRemoteIntermediateResult(MultiConnection *connection, char *resultId)
 
 	FileClose(fileDesc);
 
-	ClearResults(connection, raiseErrors);
-
 	return totalBytesWritten;
 }
 
 
 /*
  * CopyDataFromConnection reads a row of copy data from connection and writes it
- * to the given file.
+ * to the given file. With compression, each copy data message is a frame that
+ * is decompressed into decompressedData first.
  */
 static CopyStatus
 CopyDataFromConnection(MultiConnection *connection, FileCompat *fileCompat,
-					   uint64 *bytesReceived)
+					   ResultCompressionType compressionType,
+					   StringInfo decompressedData, uint64 *bytesReceived)
 {
 	/*
 	 * Consume input to handle the case where previous copy operation might have
@@ -1061,18 +1676,32 @@ CopyDataFromConnection(MultiConnection *connection, FileCompat *fileCompat,
 	int receiveLength = PQgetCopyData(connection->pgConn, &receiveBuffer, asynchronous);
 	while (receiveLength > 0)
 	{
+		char *fileData = receiveBuffer;
+		int fileDataLength = receiveLength;
+
+		if (compressionType != RESULT_COMPRESSION_NONE)
+		{
+			resetStringInfo(decompressedData);
+			DecompressResultFrame(compressionType, receiveBuffer, receiveLength,
+								  decompressedData);
+
+			fileData = decompressedData->data;
+			fileDataLength = decompressedData->len;
+		}
+
 		/* received copy data; append these data to file */
 		errno = 0;
 
-		int bytesWritten = FileWriteCompat(fileCompat, receiveBuffer,
-										   receiveLength, PG_WAIT_IO);
-		if (bytesWritten != receiveLength)
+		int bytesWritten = FileWriteCompat(fileCompat, fileData,
+										   fileDataLength, PG_WAIT_IO);
+		if (bytesWritten != fileDataLength)
 		{
 			ereport(ERROR, (errcode_for_file_access(),
 							errmsg("could not append to file: %m")));
 		}
 
-		*bytesReceived += receiveLength;
+		*bytesReceived += fileDataLength;
+		connection->counters.bytesReceived += receiveLength;
 		PQfreemem(receiveBuffer);
 		receiveLength = PQgetCopyData(connection->pgConn, &receiveBuffer, asynchronous);
 	}
@@ -1102,7 +1731,15 @@ CopyDataFromConnection(MultiConnection *connection, FileCompat *fileCompat,
 		}
 
 		PQclear(result);
-		ForgetResults(connection);
+
+		/*
+		 * The COPY commands of the other results in the same query may still
+		 * be pending, those are consumed by the caller.
+		 */
+		if (copyStatus == CLIENT_COPY_FAILED)
+		{
+			ForgetResults(connection);
+		}
 
 		return copyStatus;
 	}
@@ -0,0 +1,494 @@
+/*-------------------------------------------------------------------------
+ *
+ * memory_intermediate_results.c
+ *   Keeps small intermediate results in dynamic shared memory instead of
+ *   in files.
+ *
+ *   When citus.intermediate_result_memory_threshold is set, intermediate
+ *   results of at most that size are stored in a dynamic shared memory
+ *   segment instead of in the file that QueryResultFileName returns. The
+ *   segment is registered in a shared hash under that file name, such that
+ *   the other backends of the distributed transaction can read the result
+ *   from memory. Larger results, and results that do not fit in the hash,
+ *   are written to files as before.
+ *
+ *   The backend that stores a result keeps the segment mapped until the
+ *   end of its transaction, when it removes the result together with the
+ *   intermediate result directories. It removes the hash entry before it
+ *   detaches, so a backend that finds the entry while holding the lock can
+ *   always attach to the segment.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+#include "pg_version_constants.h"
+
+#include "distributed/citus_safe_lib.h"
+#include "distributed/listutils.h"
+#include "distributed/memory_intermediate_results.h"
+
+
+/* maximum number of results that are kept in memory at the same time */
+#define MAX_MEMORY_INTERMEDIATE_RESULTS 1024
+
+/* results with longer file names are always written to files */
+#define MEMORY_INTERMEDIATE_RESULT_NAME_LENGTH 256
+
+
+/*
+ * The data structure used to store the lock of the hash in shared memory.
+ */
+typedef struct MemoryIntermediateResultsSharedData
+{
+	int resultHashTrancheId;
+	char *resultHashTrancheName;
+
+	LWLock resultHashLock;
+} MemoryIntermediateResultsSharedData;
+
+
+typedef struct MemoryIntermediateResultHashKey
+{
+	char fileName[MEMORY_INTERMEDIATE_RESULT_NAME_LENGTH];
+} MemoryIntermediateResultHashKey;
+
+
+/* hash entry of an intermediate result that is kept in memory */
+typedef struct MemoryIntermediateResultHashEntry
+{
+	MemoryIntermediateResultHashKey key;
+
+	dsm_handle segmentHandle;
+	int64 resultSize;
+	int ownerPid;
+} MemoryIntermediateResultHashEntry;
+
+
+/* an intermediate result that this backend stored in memory */
+typedef struct OwnedMemoryIntermediateResult
+{
+	MemoryIntermediateResultHashKey key;
+	dsm_segment *segment;
+} OwnedMemoryIntermediateResult;
+
+
+/* GUC, results of at most this many kilobytes are kept in memory */
+int IntermediateResultMemoryThreshold = 0;
+
+/* the results that this backend stored in the current transaction */
+static List *OwnedMemoryIntermediateResults = NIL;
+
+static MemoryIntermediateResultsSharedData *MemoryIntermediateResultsSharedState = NULL;
+static HTAB *MemoryIntermediateResultHash = NULL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+/* local function declarations */
+static bool BuildMemoryIntermediateResultKey(const char *fileName,
+											 MemoryIntermediateResultHashKey *key);
+static void ReleaseOwnedMemoryIntermediateResult(OwnedMemoryIntermediateResult *result);
+
+
+/*
+ * InitializeMemoryIntermediateResults requests the necessary shared memory
+ * from Postgres and sets up the shared memory startup hook.
+ */
+void
+InitializeMemoryIntermediateResults(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(MemoryIntermediateResultsShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = MemoryIntermediateResultsShmemInit;
+}
+
+
+/*
+ * MemoryIntermediateResultsShmemSize returns the size that should be allocated
+ * on the shared memory for the hash of intermediate results in memory.
+ */
+size_t
+MemoryIntermediateResultsShmemSize(void)
+{
+	Size size = 0;
+
+	size = add_size(size, sizeof(MemoryIntermediateResultsSharedData));
+
+	Size hashSize = hash_estimate_size(MAX_MEMORY_INTERMEDIATE_RESULTS,
+									   sizeof(MemoryIntermediateResultHashEntry));
+
+	size = add_size(size, hashSize);
+
+	return size;
+}
+
+
+/*
+ * MemoryIntermediateResultsShmemInit initializes the shared memory used for
+ * finding the intermediate results that are kept in memory.
+ */
+void
+MemoryIntermediateResultsShmemInit(void)
+{
+	bool alreadyInitialized = false;
+	HASHCTL info;
+
+	/* create file name -> segment */
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(MemoryIntermediateResultHashKey);
+	info.entrysize = sizeof(MemoryIntermediateResultHashEntry);
+	uint32 hashFlags = (HASH_ELEM | HASH_BLOBS);
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	MemoryIntermediateResultsSharedState =
+		(MemoryIntermediateResultsSharedData *) ShmemInitStruct(
+			"Memory Intermediate Results Data",
+			sizeof(MemoryIntermediateResultsSharedData),
+			&alreadyInitialized);
+
+	if (!alreadyInitialized)
+	{
+		MemoryIntermediateResultsSharedState->resultHashTrancheId =
+			LWLockNewTrancheId();
+		MemoryIntermediateResultsSharedState->resultHashTrancheName =
+			"Memory Intermediate Results Hash Tranche";
+		LWLockRegisterTranche(MemoryIntermediateResultsSharedState->resultHashTrancheId,
+							  MemoryIntermediateResultsSharedState->
+							  resultHashTrancheName);
+
+		LWLockInitialize(&MemoryIntermediateResultsSharedState->resultHashLock,
+						 MemoryIntermediateResultsSharedState->resultHashTrancheId);
+	}
+
+	/* allocate hash table */
+	MemoryIntermediateResultHash =
+		ShmemInitHash("Memory Intermediate Results Hash",
+					  MAX_MEMORY_INTERMEDIATE_RESULTS,
+					  MAX_MEMORY_INTERMEDIATE_RESULTS, &info, hashFlags);
+
+	LWLockRelease(AddinShmemInitLock);
+
+	Assert(MemoryIntermediateResultHash != NULL);
+	Assert(MemoryIntermediateResultsSharedState->resultHashTrancheId != 0);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
+
+
+/*
+ * MemoryIntermediateResultLimit returns the number of bytes up to which an
+ * intermediate result may be kept in memory, or -1 if results are always
+ * written to files.
+ */
+int64
+MemoryIntermediateResultLimit(void)
+{
+	if (IntermediateResultMemoryThreshold <= 0)
+	{
+		return -1;
+	}
+
+	return (int64) IntermediateResultMemoryThreshold * 1024;
+}
+
+
+/*
+ * StoreMemoryIntermediateResult copies the given result data into a dynamic
+ * shared memory segment and registers it under the given file name. It
+ * returns false if the result should be written to the file instead.
+ */
+bool
+StoreMemoryIntermediateResult(const char *fileName, StringInfo resultData)
+{
+	MemoryIntermediateResultHashKey key;
+
+	if (resultData->len > MemoryIntermediateResultLimit() ||
+		!BuildMemoryIntermediateResultKey(fileName, &key))
+	{
+		return false;
+	}
+
+	/* a result with the same name replaces the earlier one */
+	RemoveMemoryIntermediateResult(fileName);
+
+	dsm_segment *segment = dsm_create(Max(resultData->len, 1),
+									  DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (segment == NULL)
+	{
+		return false;
+	}
+
+	if (resultData->len > 0)
+	{
+		memcpy_s(dsm_segment_address(segment), resultData->len, resultData->data,
+				 resultData->len);
+	}
+
+	/* keep the segment until the end of the transaction, not the portal */
+	dsm_pin_mapping(segment);
+
+	LWLockAcquire(&MemoryIntermediateResultsSharedState->resultHashLock, LW_EXCLUSIVE);
+
+	bool found = false;
+	MemoryIntermediateResultHashEntry *resultEntry =
+		hash_search(MemoryIntermediateResultHash, &key, HASH_ENTER_NULL, &found);
+	if (resultEntry == NULL)
+	{
+		/* too many results in memory, use a file */
+		LWLockRelease(&MemoryIntermediateResultsSharedState->resultHashLock);
+		dsm_detach(segment);
+
+		return false;
+	}
+
+	resultEntry->segmentHandle = dsm_segment_handle(segment);
+	resultEntry->resultSize = resultData->len;
+	resultEntry->ownerPid = MyProcPid;
+
+	LWLockRelease(&MemoryIntermediateResultsSharedState->resultHashLock);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(TopTransactionContext);
+
+	OwnedMemoryIntermediateResult *ownedResult =
+		palloc0(sizeof(OwnedMemoryIntermediateResult));
+	ownedResult->key = key;
+	ownedResult->segment = segment;
+
+	OwnedMemoryIntermediateResults = lappend(OwnedMemoryIntermediateResults,
+											 ownedResult);
+
+	MemoryContextSwitchTo(oldContext);
+
+	return true;
+}
+
+
+/*
+ * FetchMemoryIntermediateResult returns a copy of the intermediate result
+ * that is kept in memory under the given file name, or NULL if there is no
+ * such result.
+ */
+StringInfo
+FetchMemoryIntermediateResult(const char *fileName)
+{
+	MemoryIntermediateResultHashKey key;
+	StringInfo resultData = NULL;
+
+	if (MemoryIntermediateResultHash == NULL ||
+		!BuildMemoryIntermediateResultKey(fileName, &key))
+	{
+		return NULL;
+	}
+
+	LWLockAcquire(&MemoryIntermediateResultsSharedState->resultHashLock, LW_SHARED);
+
+	bool found = false;
+	MemoryIntermediateResultHashEntry *resultEntry =
+		hash_search(MemoryIntermediateResultHash, &key, HASH_FIND, &found);
+	if (found)
+	{
+		/* the owner removes the entry before it detaches, so the segment exists */
+		dsm_handle segmentHandle = resultEntry->segmentHandle;
+		dsm_segment *segment = dsm_find_mapping(segmentHandle);
+		bool attached = false;
+
+		if (segment == NULL)
+		{
+			segment = dsm_attach(segmentHandle);
+			attached = true;
+		}
+
+		if (segment != NULL)
+		{
+			int resultSize = (int) resultEntry->resultSize;
+
+			resultData = makeStringInfo();
+			enlargeStringInfo(resultData, resultSize);
+
+			if (resultSize > 0)
+			{
+				memcpy_s(resultData->data, resultSize, dsm_segment_address(segment),
+						 resultSize);
+			}
+
+			resultData->len = resultSize;
+			resultData->data[resultSize] = '\0';
+
+			if (attached)
+			{
+				dsm_detach(segment);
+			}
+		}
+	}
+
+	LWLockRelease(&MemoryIntermediateResultsSharedState->resultHashLock);
+
+	return resultData;
+}
+
+
+/*
+ * MemoryIntermediateResultSize returns the size of the intermediate result
+ * that is kept in memory under the given file name, or -1 if there is no
+ * such result.
+ */
+int64
+MemoryIntermediateResultSize(const char *fileName)
+{
+	MemoryIntermediateResultHashKey key;
+	int64 resultSize = -1;
+
+	if (MemoryIntermediateResultHash == NULL ||
+		!BuildMemoryIntermediateResultKey(fileName, &key))
+	{
+		return -1;
+	}
+
+	LWLockAcquire(&MemoryIntermediateResultsSharedState->resultHashLock, LW_SHARED);
+
+	bool found = false;
+	MemoryIntermediateResultHashEntry *resultEntry =
+		hash_search(MemoryIntermediateResultHash, &key, HASH_FIND, &found);
+	if (found)
+	{
+		resultSize = resultEntry->resultSize;
+	}
+
+	LWLockRelease(&MemoryIntermediateResultsSharedState->resultHashLock);
+
+	return resultSize;
+}
+
+
+/*
+ * RemoveMemoryIntermediateResult removes the result with the given file name
+ * from memory, e.g. because the result is now written to the file. Another
+ * backend of the distributed transaction may have stored an earlier result
+ * with the same name, in which case we only remove its hash entry, and the
+ * other backend detaches from the segment when its transaction ends.
+ */
+void
+RemoveMemoryIntermediateResult(const char *fileName)
+{
+	MemoryIntermediateResultHashKey key;
+
+	if (MemoryIntermediateResultHash == NULL ||
+		!BuildMemoryIntermediateResultKey(fileName, &key))
+	{
+		return;
+	}
+
+	OwnedMemoryIntermediateResult *ownedResult = NULL;
+	foreach_ptr(ownedResult, OwnedMemoryIntermediateResults)
+	{
+		if (memcmp(&ownedResult->key, &key, sizeof(key)) == 0)
+		{
+			ReleaseOwnedMemoryIntermediateResult(ownedResult);
+
+			OwnedMemoryIntermediateResults =
+				list_delete_ptr(OwnedMemoryIntermediateResults, ownedResult);
+			pfree(ownedResult);
+			return;
+		}
+	}
+
+	LWLockAcquire(&MemoryIntermediateResultsSharedState->resultHashLock, LW_EXCLUSIVE);
+
+	hash_search(MemoryIntermediateResultHash, &key, HASH_REMOVE, NULL);
+
+	LWLockRelease(&MemoryIntermediateResultsSharedState->resultHashLock);
+}
+
+
+/*
+ * RemoveMemoryIntermediateResults removes all results that this backend
+ * stored in memory during the current transaction.
+ */
+void
+RemoveMemoryIntermediateResults(void)
+{
+	OwnedMemoryIntermediateResult *ownedResult = NULL;
+	foreach_ptr(ownedResult, OwnedMemoryIntermediateResults)
+	{
+		ReleaseOwnedMemoryIntermediateResult(ownedResult);
+	}
+
+	/* cleanup */
+	list_free_deep(OwnedMemoryIntermediateResults);
+
+	OwnedMemoryIntermediateResults = NIL;
+}
+
+
+/*
+ * BuildMemoryIntermediateResultKey builds the hash key for the given file name
+ * and returns false if the name is too long to be a key.
+ */
+static bool
+BuildMemoryIntermediateResultKey(const char *fileName,
+								 MemoryIntermediateResultHashKey *key)
+{
+	if (strlen(fileName) >= MEMORY_INTERMEDIATE_RESULT_NAME_LENGTH)
+	{
+		return false;
+	}
+
+	memset(key, 0, sizeof(MemoryIntermediateResultHashKey));
+	strlcpy(key->fileName, fileName, MEMORY_INTERMEDIATE_RESULT_NAME_LENGTH);
+
+	return true;
+}
+
+
+/*
+ * ReleaseOwnedMemoryIntermediateResult removes the hash entry of a result that
+ * this backend stored, unless another backend replaced it since, and then
+ * detaches from the segment, which destroys it once no one reads it.
+ */
+static void
+ReleaseOwnedMemoryIntermediateResult(OwnedMemoryIntermediateResult *ownedResult)
+{
+	dsm_handle segmentHandle = dsm_segment_handle(ownedResult->segment);
+
+	LWLockAcquire(&MemoryIntermediateResultsSharedState->resultHashLock, LW_EXCLUSIVE);
+
+	bool found = false;
+	MemoryIntermediateResultHashEntry *resultEntry =
+		hash_search(MemoryIntermediateResultHash, &ownedResult->key, HASH_FIND,
+					&found);
+	if (found && resultEntry->segmentHandle == segmentHandle)
+	{
+		hash_search(MemoryIntermediateResultHash, &ownedResult->key, HASH_REMOVE,
+					NULL);
+	}
+
+	LWLockRelease(&MemoryIntermediateResultsSharedState->resultHashLock);
+
+	dsm_detach(ownedResult->segment);
+}
@@ -16,19 +16,27 @@
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 
+#include "distributed/deparse_shard_query.h"
 #include "distributed/distributed_execution_locks.h"
 #include "distributed/insert_select_executor.h"
 #include "distributed/intermediate_results.h"
 #include "distributed/listutils.h"
 #include "distributed/merge_executor.h"
 #include "distributed/merge_planner.h"
+#include "distributed/metadata_utility.h"
 #include "distributed/multi_executor.h"
 #include "distributed/multi_partitioning_utils.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/repartition_executor.h"
 #include "distributed/subplan_execution.h"
 
+/* config variable */
+bool EnableMergeFragmentFetchPipelining = false;
+
 static void ExecuteSourceAtWorkerAndRepartition(CitusScanState *scanState);
+static bool CanPipelineFragmentFetches(CitusTableCacheEntry *targetRelation,
+									   ParamListInfo paramListInfo);
+static void PrependFragmentFetchQueries(List *taskList, List **fragmentFetchQueries);
 static void ExecuteSourceAtCoordAndRedistribution(CitusScanState *scanState);
 static HTAB * ExecuteMergeSourcePlanIntoColocatedIntermediateResults(Oid targetRelationId,
 																	 Query *mergeQuery,
@@ -146,8 +154,7 @@ ExecuteSourceAtWorkerAndRepartition(CitusScanState *scanState)
 					 distSourceJob->jobId);
 	char *distResultPrefix = distResultPrefixString->data;
 	CitusTableCacheEntry *targetRelation = GetCitusTableCacheEntry(targetRelationId);
-
-	ereport(DEBUG1, (errmsg("Redistributing source result rows across nodes")));
+	ParamListInfo paramListInfo = executorState->es_param_list_info;
 
 	/*
 	 * partitionColumnIndex determines the column in the selectTaskList to
@@ -155,16 +162,40 @@ ExecuteSourceAtWorkerAndRepartition(CitusScanState *scanState)
 	 * the result data with the target.
 	 */
 	int partitionColumnIndex = distributedPlan->sourceResultRepartitionColumnIndex;
+	List **redistributedResults = NULL;
+	List **fragmentFetchQueries = NULL;
 
-	/*
-	 * Below call partitions the results using shard ranges and partition method of
-	 * targetRelation, and then colocates the result files with shards. These
-	 * transfers are done by calls to fetch_intermediate_results() between nodes.
-	 */
-	List **redistributedResults =
-		RedistributeTaskListResults(distResultPrefix,
-									distSourceTaskList, partitionColumnIndex,
-									targetRelation, binaryFormat);
+	if (CanPipelineFragmentFetches(targetRelation, paramListInfo))
+	{
+		ereport(DEBUG1, (errmsg("Partitioning source result rows for the target "
+								"shards")));
+
+		/*
+		 * Partition the results like below, but let each MERGE task fetch
+		 * the fragments of its own shard, such that the MERGE on a shard can
+		 * start as soon as its fragments arrive rather than after all of the
+		 * fragments of all shards are transferred.
+		 */
+		redistributedResults =
+			PartitionTasklistResultsByShard(distResultPrefix, distSourceTaskList,
+											partitionColumnIndex, targetRelation,
+											binaryFormat, false,
+											&fragmentFetchQueries);
+	}
+	else
+	{
+		ereport(DEBUG1, (errmsg("Redistributing source result rows across nodes")));
+
+		/*
+		 * Below call partitions the results using shard ranges and partition method
+		 * of targetRelation, and then colocates the result files with shards. These
+		 * transfers are done by calls to fetch_intermediate_results() between nodes.
+		 */
+		redistributedResults =
+			RedistributeTaskListResults(distResultPrefix,
+										distSourceTaskList, partitionColumnIndex,
+										targetRelation, binaryFormat, false);
+	}
 
 	ereport(DEBUG1, (errmsg("Executing final MERGE on workers using "
 							"intermediate results")));
@@ -181,9 +212,13 @@ ExecuteSourceAtWorkerAndRepartition(CitusScanState *scanState)
 												 redistributedResults,
 												 binaryFormat);
 
+	if (fragmentFetchQueries != NULL)
+	{
+		PrependFragmentFetchQueries(taskList, fragmentFetchQueries);
+	}
+
 	scanState->tuplestorestate =
 		tuplestore_begin_heap(randomAccess, interTransactions, work_mem);
-	ParamListInfo paramListInfo = executorState->es_param_list_info;
 	TupleDesc tupleDescriptor = ScanStateGetTupleDescriptor(scanState);
 	TupleDestination *tupleDest =
 		CreateTupleStoreTupleDest(scanState->tuplestorestate,
@@ -197,6 +232,70 @@ ExecuteSourceAtWorkerAndRepartition(CitusScanState *scanState)
 }
 
 
+/*
+ * CanPipelineFragmentFetches returns whether the MERGE tasks on the shards of the
+ * target relation can fetch the source result fragments of their shard
+ * themselves. The fetch queries are sent as separate queries of the tasks,
+ * which cannot carry the parameters of the MERGE, and a fetch on one placement
+ * of a replicated shard would clash with the fragments written on another.
+ */
+static bool
+CanPipelineFragmentFetches(CitusTableCacheEntry *targetRelation,
+						   ParamListInfo paramListInfo)
+{
+	if (!EnableMergeFragmentFetchPipelining)
+	{
+		return false;
+	}
+
+	if (paramListInfo != NULL && paramListInfo->numParams > 0)
+	{
+		return false;
+	}
+
+	int shardCount = targetRelation->shardIntervalArrayLength;
+	for (int shardIndex = 0; shardIndex < shardCount; shardIndex++)
+	{
+		ShardInterval *shardInterval =
+			targetRelation->sortedShardIntervalArray[shardIndex];
+
+		if (list_length(ActiveShardPlacementList(shardInterval->shardId)) != 1)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * PrependFragmentFetchQueries makes each MERGE task run the queries that fetch
+ * the source result fragments of its shard to the node of the shard, as
+ * returned by PartitionTasklistResultsByShard, before the MERGE itself.
+ */
+static void
+PrependFragmentFetchQueries(List *taskList, List **fragmentFetchQueries)
+{
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		ShardInterval *shardInterval = LoadShardInterval(task->anchorShardId);
+		List *fetchQueryList = fragmentFetchQueries[shardInterval->shardIndex];
+
+		if (fetchQueryList == NIL)
+		{
+			/* all fragments were written on the node of the shard */
+			continue;
+		}
+
+		List *queryStringList = lappend(list_copy(fetchQueryList),
+										TaskQueryString(task));
+		SetTaskQueryStringList(task, queryStringList);
+	}
+}
+
+
 /*
  * ExecuteSourceAtCoordAndRedistribution Executes the plan that necessitates evaluation
  * at the coordinator and redistributes the resulting rows to intermediate files,
@@ -35,12 +35,14 @@
 
 #include "distributed/backend_data.h"
 #include "distributed/citus_custom_scan.h"
+#include "distributed/citus_safe_lib.h"
 #include "distributed/combine_query_planner.h"
 #include "distributed/commands/multi_copy.h"
 #include "distributed/commands/utility_hook.h"
 #include "distributed/coordinator_protocol.h"
 #include "distributed/distributed_planner.h"
 #include "distributed/function_call_delegation.h"
+#include "distributed/insert_buffer.h"
 #include "distributed/insert_select_executor.h"
 #include "distributed/insert_select_planner.h"
 #include "distributed/listutils.h"
@@ -54,6 +56,7 @@
 #include "distributed/version_compat.h"
 #include "distributed/worker_protocol.h"
 #include "distributed/worker_shard_visibility.h"
+#include "distributed/worker_transaction.h"
 
 
 /*
@@ -92,8 +95,17 @@ bool SortReturning = false;
  */
 int ExecutorLevel = 0;
 
+/* COPY data that ReadFromIntermediateResultBufferCallback reads from */
+static StringInfo IntermediateResultBuffer = NULL;
+
 
 /* local function forward declarations */
+static void ReadCopyDataIntoTupleStore(char *fileName,
+									   copy_data_source_cb dataSourceCallback,
+									   char *copyFormat, TupleDesc tupleDescriptor,
+									   Tuplestorestate *tupstore);
+static int ReadFromIntermediateResultBufferCallback(void *outBuf, int minRead,
+													int maxRead);
 static Relation StubRelation(TupleDesc tupleDescriptor);
 static char * GetObjectTypeString(ObjectType objType);
 static bool AlterTableConstraintCheck(QueryDesc *queryDesc);
@@ -115,6 +127,15 @@ CitusExecutorStart(QueryDesc *queryDesc, int eflags)
 {
 	PlannedStmt *plannedStmt = queryDesc->plannedstmt;
 
+	/* statements other than buffered INSERTs might observe the buffered rows */
+	if (HasBufferedInserts() && !IsBufferableInsertPlan(plannedStmt))
+	{
+		FlushBufferedInserts();
+	}
+
+	/* statements might observe the effects of buffered DDL commands on other nodes */
+	FlushBufferedDDLPropagation();
+
 	/*
 	 * We cannot modify XactReadOnly on Windows because it is not
 	 * declared with PGDLLIMPORT.
@@ -433,6 +454,61 @@ ReturnTupleFromTuplestore(CitusScanState *scanState)
 void
 ReadFileIntoTupleStore(char *fileName, char *copyFormat, TupleDesc tupleDescriptor,
 					   Tuplestorestate *tupstore)
+{
+	ReadCopyDataIntoTupleStore(fileName, NULL, copyFormat, tupleDescriptor, tupstore);
+}
+
+
+/*
+ * ReadBufferIntoTupleStore is the same as ReadFileIntoTupleStore for COPY data
+ * that is in memory.
+ */
+void
+ReadBufferIntoTupleStore(StringInfo copyData, char *copyFormat,
+						 TupleDesc tupleDescriptor, Tuplestorestate *tupstore)
+{
+	/*
+	 * The copy callback does not take arguments, so it reads from a global
+	 * variable.
+	 */
+	IntermediateResultBuffer = copyData;
+	IntermediateResultBuffer->cursor = 0;
+
+	ReadCopyDataIntoTupleStore(NULL, ReadFromIntermediateResultBufferCallback,
+							   copyFormat, tupleDescriptor, tupstore);
+
+	IntermediateResultBuffer = NULL;
+}
+
+
+/*
+ * ReadFromIntermediateResultBufferCallback is the copy callback of
+ * ReadBufferIntoTupleStore. It copies up to maxRead bytes of the buffer.
+ */
+static int
+ReadFromIntermediateResultBufferCallback(void *outBuf, int minRead, int maxRead)
+{
+	StringInfo copyData = IntermediateResultBuffer;
+	int bytesRead = Min(maxRead, copyData->len - copyData->cursor);
+
+	if (bytesRead > 0)
+	{
+		memcpy_s(outBuf, maxRead, copyData->data + copyData->cursor, bytesRead);
+		copyData->cursor += bytesRead;
+	}
+
+	return bytesRead;
+}
+
+
+/*
+ * ReadCopyDataIntoTupleStore parses the records in the given file, or the COPY
+ * data that the callback returns, and stores them in a tuple store.
+ */
+static void
+ReadCopyDataIntoTupleStore(char *fileName, copy_data_source_cb dataSourceCallback,
+						   char *copyFormat, TupleDesc tupleDescriptor,
+						   Tuplestorestate *tupstore)
 {
 	/*
 	 * Trick BeginCopyFrom into using our tuple descriptor by pretending it belongs
@@ -456,7 +532,7 @@ ReadFileIntoTupleStore(char *fileName, char *copyFormat, TupleDesc tupleDescript
 	copyOptions = lappend(copyOptions, copyOption);
 
 	CopyFromState copyState = BeginCopyFrom(NULL, stubRelation, NULL,
-											fileName, false, NULL,
+											fileName, false, dataSourceCallback,
 											NULL, copyOptions);
 
 	while (true)
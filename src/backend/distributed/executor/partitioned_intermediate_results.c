@@ -25,14 +25,20 @@
 #include "nodes/primnodes.h"
 #include "tcop/pquery.h"
 #include "tcop/tcopprot.h"
+#include "utils/builtins.h"
 #include "utils/typcache.h"
 
+#include "distributed/commands/multi_copy.h"
+#include "distributed/connection_management.h"
 #include "distributed/intermediate_results.h"
+#include "distributed/listutils.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/metadata_utility.h"
 #include "distributed/multi_executor.h"
 #include "distributed/pg_dist_shard.h"
 #include "distributed/remote_commands.h"
+#include "distributed/result_compression.h"
+#include "distributed/transaction_management.h"
 #include "distributed/tuplestore.h"
 #include "distributed/utils/array_type.h"
 #include "distributed/utils/function.h"
@@ -96,7 +102,96 @@ typedef struct PartitionedResultDestReceiver
 	bool allowNullPartitionColumnValues;
 } PartitionedResultDestReceiver;
 
+
+/*
+ * Number of bytes of a partition that we buffer before pushing them to the
+ * node of the partition as a separate intermediate result.
+ */
+#define PUSHED_RESULT_CHUNK_SIZE (1024 * 1024)
+
+
+/* node to which partitions are pushed, partitions share its connection */
+typedef struct PushedResultNode
+{
+	char *nodeName;
+	int nodePort;
+
+	/* opened when the first chunk is pushed to the node */
+	MultiConnection *connection;
+} PushedResultNode;
+
+
+/* an intermediate result that holds a chunk of a pushed partition */
+typedef struct PushedResultChunk
+{
+	char *resultId;
+	uint64 rowCount;
+	uint64 byteCount;
+} PushedResultChunk;
+
+
+/*
+ * PushedResultDestReceiver is used for streaming the tuples of a partition to
+ * a remote node, where they are stored as intermediate results.
+ */
+typedef struct PushedResultDestReceiver
+{
+	/* public DestReceiver interface */
+	DestReceiver pub;
+
+	/* chunks of the partition are named <resultIdPrefix>_<chunk index> */
+	char *resultIdPrefix;
+
+	/* node to push the chunks to */
+	PushedResultNode *node;
+
+	/* descriptor of the tuples that are pushed */
+	TupleDesc tupleDescriptor;
+
+	/* context for per-tuple memory allocation */
+	MemoryContext tupleContext;
+
+	/* MemoryContext for DestReceiver session */
+	MemoryContext memoryContext;
+
+	bool binaryCopyFormat;
+	ResultCompressionType compressionType;
+
+	/* state on how to copy out data types */
+	CopyOutState copyOutState;
+	FmgrInfo *columnOutputFunctions;
+
+	/* number of rows in the chunk that is being buffered */
+	uint64 chunkRowCount;
+
+	/* chunks that were pushed, as PushedResultChunk pointers */
+	List *chunkList;
+} PushedResultDestReceiver;
+
+
 static Portal StartPortalForQueryExecution(const char *queryString);
+static char PartitionMethodForQueryResult(Oid partitionMethodOid);
+static CitusTableCacheEntry * QueryResultShardSearchInfo(TupleDesc tupleDescriptor,
+														 int partitionColumnIndex,
+														 char partitionMethod,
+														 ArrayType *minValuesArray,
+														 ArrayType *maxValuesArray);
+static PushedResultNode * GetPushedResultNode(List **nodeList, char *nodeName,
+											  int nodePort);
+static MultiConnection * PushedResultNodeConnection(PushedResultNode *node);
+static void EndPushedResultNodeTransactions(List *nodeList);
+static DestReceiver * CreatePushedResultDestReceiver(char *resultIdPrefix,
+													 PushedResultNode *node,
+													 MemoryContext tupleContext,
+													 bool binaryCopyFormat);
+static void PushedResultDestReceiverStartup(DestReceiver *dest, int operation,
+											TupleDesc inputTupleDescriptor);
+static bool PushedResultDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest);
+static void PushResultChunk(PushedResultDestReceiver *resultDest);
+static void PushResultData(MultiConnection *connection, const char *resultId,
+						   StringInfo resultData, ResultCompressionType compressionType);
+static void PushedResultDestReceiverShutdown(DestReceiver *dest);
+static void PushedResultDestReceiverDestroy(DestReceiver *dest);
 static void PartitionedResultDestReceiverStartup(DestReceiver *dest, int operation,
 												 TupleDesc inputTupleDescriptor);
 static bool PartitionedResultDestReceiverReceive(TupleTableSlot *slot,
@@ -106,6 +201,7 @@ static void PartitionedResultDestReceiverDestroy(DestReceiver *copyDest);
 
 /* exports for SQL callable functions */
 PG_FUNCTION_INFO_V1(worker_partition_query_result);
+PG_FUNCTION_INFO_V1(worker_push_partition_query_result);
 
 
 /*
@@ -130,13 +226,7 @@ worker_partition_query_result(PG_FUNCTION_ARGS)
 
 	int partitionColumnIndex = PG_GETARG_INT32(2);
 	Oid partitionMethodOid = PG_GETARG_OID(3);
-
-	char partitionMethod = LookupDistributionMethod(partitionMethodOid);
-	if (partitionMethod != DISTRIBUTE_BY_HASH && partitionMethod != DISTRIBUTE_BY_RANGE)
-	{
-		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-						errmsg("only hash and range partitiong schemes are supported")));
-	}
+	char partitionMethod = PartitionMethodForQueryResult(partitionMethodOid);
 
 	ArrayType *minValuesArray = PG_GETARG_ARRAYTYPE_P(4);
 	int32 minValuesCount = ArrayObjectCount(minValuesArray);
@@ -182,32 +272,9 @@ worker_partition_query_result(PG_FUNCTION_ARGS)
 	/* start execution early in order to extract the tuple descriptor */
 	Portal portal = StartPortalForQueryExecution(queryString);
 
-	/* extract the partition column */
-	TupleDesc tupleDescriptor = portal->tupDesc;
-	if (tupleDescriptor == NULL)
-	{
-		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-						errmsg("query must generate a set of rows")));
-	}
-
-	if (partitionColumnIndex < 0 || partitionColumnIndex >= tupleDescriptor->natts)
-	{
-		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-						errmsg("partition column index must be between 0 and %d",
-							   tupleDescriptor->natts - 1)));
-	}
-
-	FormData_pg_attribute *partitionColumnAttr = TupleDescAttr(tupleDescriptor,
-															   partitionColumnIndex);
-	Var *partitionColumn = makeVar(partitionColumnIndex, partitionColumnIndex,
-								   partitionColumnAttr->atttypid,
-								   partitionColumnAttr->atttypmod,
-								   partitionColumnAttr->attcollation, 0);
-
-	/* construct an artificial CitusTableCacheEntry for shard pruning */
 	CitusTableCacheEntry *shardSearchInfo =
-		QueryTupleShardSearchInfo(minValuesArray, maxValuesArray,
-								  partitionMethod, partitionColumn);
+		QueryResultShardSearchInfo(portal->tupDesc, partitionColumnIndex,
+								   partitionMethod, minValuesArray, maxValuesArray);
 
 	/* prepare the output destination */
 	EState *estate = CreateExecutorState();
@@ -278,6 +345,222 @@ worker_partition_query_result(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * worker_push_partition_query_result executes a query and partitions its
+ * results like worker_partition_query_result, but pushes the partitions to
+ * the nodes given by partition_node_names and partition_node_ports, where
+ * they are stored as intermediate results of the distributed transaction.
+ * Partitions whose node name is NULL are written into local files instead.
+ *
+ * A partition is pushed in chunks of PUSHED_RESULT_CHUNK_SIZE bytes, each of
+ * which becomes a separate result, and a row is returned for every result
+ * that was written. The pushes happen in transactions that end when this
+ * function returns, so the intermediate result directories on the nodes must
+ * already have been created by the distributed transaction, otherwise the
+ * results would be removed together with the directory.
+ */
+Datum
+worker_push_partition_query_result(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	ReturnSetInfo *resultInfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+	text *resultIdPrefixText = PG_GETARG_TEXT_P(0);
+	char *resultIdPrefixString = text_to_cstring(resultIdPrefixText);
+
+	/* verify that resultIdPrefix doesn't contain invalid characters */
+	QueryResultFileName(resultIdPrefixString);
+
+	text *queryText = PG_GETARG_TEXT_P(1);
+	char *queryString = text_to_cstring(queryText);
+
+	int partitionColumnIndex = PG_GETARG_INT32(2);
+	Oid partitionMethodOid = PG_GETARG_OID(3);
+	char partitionMethod = PartitionMethodForQueryResult(partitionMethodOid);
+
+	ArrayType *minValuesArray = PG_GETARG_ARRAYTYPE_P(4);
+	int32 minValuesCount = ArrayObjectCount(minValuesArray);
+
+	ArrayType *maxValuesArray = PG_GETARG_ARRAYTYPE_P(5);
+	int32 maxValuesCount = ArrayObjectCount(maxValuesArray);
+
+	ArrayType *nodeNamesArray = PG_GETARG_ARRAYTYPE_P(6);
+	int32 nodeNamesCount = ArrayObjectCount(nodeNamesArray);
+
+	ArrayType *nodePortsArray = PG_GETARG_ARRAYTYPE_P(7);
+	int32 nodePortsCount = ArrayObjectCount(nodePortsArray);
+
+	bool binaryCopy = PG_GETARG_BOOL(8);
+	bool allowNullPartitionColumnValues = PG_GETARG_BOOL(9);
+
+	if (!IsMultiStatementTransaction())
+	{
+		ereport(ERROR, (errmsg("worker_push_partition_query_result can only be used "
+							   "in a transaction block")));
+	}
+
+	/* the pushed results are stored in the directory of the distributed transaction */
+	EnsureDistributedTransactionId();
+
+	CreateIntermediateResultsDirectory();
+
+	if (minValuesCount != maxValuesCount)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg(
+					 "min values and max values must have the same number of elements")));
+	}
+
+	if (nodeNamesCount != minValuesCount || nodePortsCount != minValuesCount)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("node names and node ports must have an element for "
+							   "each partition")));
+	}
+
+	int partitionCount = minValuesCount;
+	if (partitionCount == 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("number of partitions cannot be 0")));
+	}
+
+	Datum *nodeNameDatums = NULL;
+	bool *nodeNameNulls = NULL;
+	int nodeNameDatumCount = 0;
+	deconstruct_array(nodeNamesArray, TEXTOID, -1, false, 'i', &nodeNameDatums,
+					  &nodeNameNulls, &nodeNameDatumCount);
+
+	Datum *nodePortDatums = NULL;
+	bool *nodePortNulls = NULL;
+	int nodePortDatumCount = 0;
+	deconstruct_array(nodePortsArray, INT4OID, sizeof(int32), true, 'i',
+					  &nodePortDatums, &nodePortNulls, &nodePortDatumCount);
+
+	/* start execution early in order to extract the tuple descriptor */
+	Portal portal = StartPortalForQueryExecution(queryString);
+
+	CitusTableCacheEntry *shardSearchInfo =
+		QueryResultShardSearchInfo(portal->tupDesc, partitionColumnIndex,
+								   partitionMethod, minValuesArray, maxValuesArray);
+
+	/* prepare the output destination */
+	EState *estate = CreateExecutorState();
+	MemoryContext tupleContext = GetPerTupleMemoryContext(estate);
+
+	/* create all dest receivers, partitions on the same node share a connection */
+	List *nodeList = NIL;
+	DestReceiver **dests = palloc0(partitionCount * sizeof(DestReceiver *));
+	for (int partitionIndex = 0; partitionIndex < partitionCount; partitionIndex++)
+	{
+		StringInfo resultId = makeStringInfo();
+		appendStringInfo(resultId, "%s_%d", resultIdPrefixString, partitionIndex);
+
+		if (nodeNameNulls[partitionIndex])
+		{
+			char *filePath = QueryResultFileName(resultId->data);
+			dests[partitionIndex] = CreateFileDestReceiver(filePath, tupleContext,
+														   binaryCopy);
+			continue;
+		}
+
+		if (nodePortNulls[partitionIndex])
+		{
+			ereport(ERROR, (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+							errmsg("node port of partition %d cannot be NULL",
+								   partitionIndex)));
+		}
+
+		char *nodeName = TextDatumGetCString(nodeNameDatums[partitionIndex]);
+		int nodePort = DatumGetInt32(nodePortDatums[partitionIndex]);
+		PushedResultNode *node = GetPushedResultNode(&nodeList, nodeName, nodePort);
+
+		dests[partitionIndex] = CreatePushedResultDestReceiver(resultId->data, node,
+															   tupleContext,
+															   binaryCopy);
+	}
+
+	const bool lazyStartup = true;
+
+	DestReceiver *dest = CreatePartitionedResultDestReceiver(
+		partitionColumnIndex,
+		partitionCount,
+		shardSearchInfo,
+		dests,
+		lazyStartup,
+		allowNullPartitionColumnValues);
+
+	/* execute the query */
+	PortalRun(portal, FETCH_ALL, false, true, dest, dest, NULL);
+
+	/* the results are complete, end the transactions on the nodes */
+	EndPushedResultNodeTransactions(nodeList);
+
+	/* construct the output result */
+	TupleDesc returnTupleDesc = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &returnTupleDesc);
+	resultInfo->returnMode = SFRM_Materialize;
+	resultInfo->setResult = tupleStore;
+	resultInfo->setDesc = returnTupleDesc;
+
+	for (int partitionIndex = 0; partitionIndex < partitionCount; partitionIndex++)
+	{
+		Datum values[4];
+		bool nulls[4];
+
+		memset(values, 0, sizeof(values));
+		memset(nulls, 0, sizeof(nulls));
+
+		values[0] = Int32GetDatum(partitionIndex);
+
+		if (nodeNameNulls[partitionIndex])
+		{
+			uint64 recordsWritten = 0;
+			uint64 bytesWritten = 0;
+
+			FileDestReceiverStats(dests[partitionIndex], &recordsWritten,
+								  &bytesWritten);
+			if (recordsWritten == 0)
+			{
+				continue;
+			}
+
+			StringInfo resultId = makeStringInfo();
+			appendStringInfo(resultId, "%s_%d", resultIdPrefixString, partitionIndex);
+
+			values[1] = CStringGetTextDatum(resultId->data);
+			values[2] = UInt64GetDatum(recordsWritten);
+			values[3] = UInt64GetDatum(bytesWritten);
+
+			tuplestore_putvalues(tupleStore, returnTupleDesc, values, nulls);
+			continue;
+		}
+
+		PushedResultDestReceiver *pushedDest =
+			(PushedResultDestReceiver *) dests[partitionIndex];
+
+		PushedResultChunk *chunk = NULL;
+		foreach_ptr(chunk, pushedDest->chunkList)
+		{
+			values[1] = CStringGetTextDatum(chunk->resultId);
+			values[2] = UInt64GetDatum(chunk->rowCount);
+			values[3] = UInt64GetDatum(chunk->byteCount);
+
+			tuplestore_putvalues(tupleStore, returnTupleDesc, values, nulls);
+		}
+	}
+
+	PortalDrop(portal, false);
+	FreeExecutorState(estate);
+
+	dest->rDestroy(dest);
+
+	PG_RETURN_DATUM(0);
+}
+
+
 /*
  * StartPortalForQueryExecution creates and starts a portal which can be
  * used for running the given query.
@@ -304,6 +587,61 @@ StartPortalForQueryExecution(const char *queryString)
 }
 
 
+/*
+ * PartitionMethodForQueryResult returns the partition method for the given
+ * citus.distribution_type value, and errors out if query results cannot be
+ * partitioned by it.
+ */
+static char
+PartitionMethodForQueryResult(Oid partitionMethodOid)
+{
+	char partitionMethod = LookupDistributionMethod(partitionMethodOid);
+	if (partitionMethod != DISTRIBUTE_BY_HASH && partitionMethod != DISTRIBUTE_BY_RANGE)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("only hash and range partitiong schemes are supported")));
+	}
+
+	return partitionMethod;
+}
+
+
+/*
+ * QueryResultShardSearchInfo checks that the partition column index is valid
+ * for the tuples of a query and returns an artificial CitusTableCacheEntry for
+ * finding the partition of a tuple, see QueryTupleShardSearchInfo.
+ */
+static CitusTableCacheEntry *
+QueryResultShardSearchInfo(TupleDesc tupleDescriptor, int partitionColumnIndex,
+						   char partitionMethod, ArrayType *minValuesArray,
+						   ArrayType *maxValuesArray)
+{
+	if (tupleDescriptor == NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("query must generate a set of rows")));
+	}
+
+	if (partitionColumnIndex < 0 || partitionColumnIndex >= tupleDescriptor->natts)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("partition column index must be between 0 and %d",
+							   tupleDescriptor->natts - 1)));
+	}
+
+	FormData_pg_attribute *partitionColumnAttr = TupleDescAttr(tupleDescriptor,
+															   partitionColumnIndex);
+	Var *partitionColumn = makeVar(partitionColumnIndex, partitionColumnIndex,
+								   partitionColumnAttr->atttypid,
+								   partitionColumnAttr->atttypmod,
+								   partitionColumnAttr->attcollation, 0);
+
+	/* construct an artificial CitusTableCacheEntry for shard pruning */
+	return QueryTupleShardSearchInfo(minValuesArray, maxValuesArray,
+									 partitionMethod, partitionColumn);
+}
+
+
 /*
  * QueryTupleShardSearchInfo returns a CitusTableCacheEntry which has enough
  * information so that FindShardInterval() can find the shard corresponding
@@ -391,6 +729,19 @@ QueryTupleShardSearchInfo(ArrayType *minValuesArray, ArrayType *maxValuesArray,
 
 	result->shardIntervalArrayLength = partitionCount;
 
+	/*
+	 * Repartitioning usually uses the shard ranges of a hash distributed
+	 * table, in which case we find the partition of a row by computing the
+	 * index of its range rather than by a binary search, which would call
+	 * the comparison function several times per row.
+	 */
+	if (partitionMethod == DISTRIBUTE_BY_HASH && !result->hasUninitializedShardInterval)
+	{
+		result->hasUniformHashDistribution =
+			HasUniformHashDistribution(result->sortedShardIntervalArray,
+									   partitionCount);
+	}
+
 	return result;
 }
 
@@ -568,3 +919,362 @@ PartitionedResultDestReceiverDestroy(DestReceiver *dest)
 		}
 	}
 }
+
+
+/*
+ * GetPushedResultNode returns the node with the given name and port from the
+ * given list, and adds it to the list if it is not there yet.
+ */
+static PushedResultNode *
+GetPushedResultNode(List **nodeList, char *nodeName, int nodePort)
+{
+	PushedResultNode *node = NULL;
+	foreach_ptr(node, *nodeList)
+	{
+		if (node->nodePort == nodePort && strcmp(node->nodeName, nodeName) == 0)
+		{
+			return node;
+		}
+	}
+
+	node = palloc0(sizeof(PushedResultNode));
+	node->nodeName = nodeName;
+	node->nodePort = nodePort;
+
+	*nodeList = lappend(*nodeList, node);
+
+	return node;
+}
+
+
+/*
+ * PushedResultNodeConnection returns the connection over which results are
+ * pushed to the given node, and opens it on first use.
+ *
+ * Like fetch_intermediate_results, we use a new connection with a transaction
+ * in the same distributed transaction, such that the results are written to
+ * its intermediate result directory. The transaction ends before the
+ * distributed transaction does, so the results are written to files rather
+ * than kept in memory, which would be released at the end of the transaction.
+ */
+static MultiConnection *
+PushedResultNodeConnection(PushedResultNode *node)
+{
+	if (node->connection != NULL)
+	{
+		return node->connection;
+	}
+
+	int connectionFlags = FORCE_NEW_CONNECTION;
+	MultiConnection *connection = GetNodeConnection(connectionFlags, node->nodeName,
+													node->nodePort);
+
+	if (PQstatus(connection->pgConn) != CONNECTION_OK)
+	{
+		ereport(ERROR, (errmsg("cannot connect to %s:%d to push intermediate results",
+							   node->nodeName, node->nodePort)));
+	}
+
+	StringInfo beginCommand = BeginAndSetDistributedTransactionIdCommand();
+	appendStringInfoString(beginCommand,
+						   "SET LOCAL citus.intermediate_result_memory_threshold TO 0;");
+	ExecuteCriticalRemoteCommand(connection, beginCommand->data);
+
+	node->connection = connection;
+
+	return connection;
+}
+
+
+/*
+ * EndPushedResultNodeTransactions ends the transactions in which results were
+ * pushed to the given nodes and closes their connections.
+ */
+static void
+EndPushedResultNodeTransactions(List *nodeList)
+{
+	PushedResultNode *node = NULL;
+	foreach_ptr(node, nodeList)
+	{
+		if (node->connection == NULL)
+		{
+			continue;
+		}
+
+		ExecuteCriticalRemoteCommand(node->connection, "END");
+
+		CloseConnection(node->connection);
+		node->connection = NULL;
+	}
+}
+
+
+/*
+ * CreatePushedResultDestReceiver creates a DestReceiver that pushes the tuples
+ * it receives to the given node in chunks named <resultIdPrefix>_<chunk index>.
+ */
+static DestReceiver *
+CreatePushedResultDestReceiver(char *resultIdPrefix, PushedResultNode *node,
+							   MemoryContext tupleContext, bool binaryCopyFormat)
+{
+	PushedResultDestReceiver *resultDest =
+		palloc0(sizeof(PushedResultDestReceiver));
+
+	/* set up the DestReceiver function pointers */
+	resultDest->pub.receiveSlot = PushedResultDestReceiverReceive;
+	resultDest->pub.rStartup = PushedResultDestReceiverStartup;
+	resultDest->pub.rShutdown = PushedResultDestReceiverShutdown;
+	resultDest->pub.rDestroy = PushedResultDestReceiverDestroy;
+	resultDest->pub.mydest = DestCopyOut;
+
+	/* set up output parameters */
+	resultDest->resultIdPrefix = pstrdup(resultIdPrefix);
+	resultDest->node = node;
+	resultDest->tupleContext = tupleContext;
+	resultDest->memoryContext = CurrentMemoryContext;
+	resultDest->binaryCopyFormat = binaryCopyFormat;
+	resultDest->compressionType = IntermediateResultCompression;
+
+	return (DestReceiver *) resultDest;
+}
+
+
+/*
+ * PushedResultDestReceiverStartup implements the rStartup interface of
+ * PushedResultDestReceiver. It sets up the CopyOutState, the connection is
+ * only opened once there is a chunk to push.
+ */
+static void
+PushedResultDestReceiverStartup(DestReceiver *dest, int operation,
+								TupleDesc inputTupleDescriptor)
+{
+	PushedResultDestReceiver *resultDest = (PushedResultDestReceiver *) dest;
+
+	const char *delimiterCharacter = "\t";
+	const char *nullPrintCharacter = "\\N";
+
+	/* use the memory context that was in place when the DestReceiver was created */
+	MemoryContext oldContext = MemoryContextSwitchTo(resultDest->memoryContext);
+
+	resultDest->tupleDescriptor = inputTupleDescriptor;
+
+	/* define how tuples will be serialised */
+	CopyOutState copyOutState = (CopyOutState) palloc0(sizeof(CopyOutStateData));
+	copyOutState->delim = (char *) delimiterCharacter;
+	copyOutState->null_print = (char *) nullPrintCharacter;
+	copyOutState->null_print_client = (char *) nullPrintCharacter;
+	copyOutState->binary = resultDest->binaryCopyFormat;
+	copyOutState->fe_msgbuf = makeStringInfo();
+	copyOutState->rowcontext = resultDest->tupleContext;
+	resultDest->copyOutState = copyOutState;
+
+	resultDest->columnOutputFunctions = ColumnOutputFunctions(inputTupleDescriptor,
+															  copyOutState->binary);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * PushedResultDestReceiverReceive implements the receiveSlot function of
+ * PushedResultDestReceiver. It appends the tuple to the current chunk and
+ * pushes the chunk once it is large enough.
+ */
+static bool
+PushedResultDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
+{
+	PushedResultDestReceiver *resultDest = (PushedResultDestReceiver *) dest;
+
+	TupleDesc tupleDescriptor = resultDest->tupleDescriptor;
+	CopyOutState copyOutState = resultDest->copyOutState;
+	FmgrInfo *columnOutputFunctions = resultDest->columnOutputFunctions;
+
+	if (resultDest->chunkRowCount == 0 && copyOutState->binary)
+	{
+		/* every chunk is a separate result, which starts with the headers */
+		AppendCopyBinaryHeaders(copyOutState);
+	}
+
+	MemoryContext executorTupleContext = resultDest->tupleContext;
+	MemoryContext oldContext = MemoryContextSwitchTo(executorTupleContext);
+
+	slot_getallattrs(slot);
+
+	Datum *columnValues = slot->tts_values;
+	bool *columnNulls = slot->tts_isnull;
+
+	/* construct row in COPY format */
+	AppendCopyRowData(columnValues, columnNulls, tupleDescriptor,
+					  copyOutState, columnOutputFunctions, NULL);
+
+	MemoryContextSwitchTo(oldContext);
+
+	resultDest->chunkRowCount++;
+
+	if (copyOutState->fe_msgbuf->len >= PUSHED_RESULT_CHUNK_SIZE)
+	{
+		PushResultChunk(resultDest);
+	}
+
+	MemoryContextReset(executorTupleContext);
+
+	return true;
+}
+
+
+/*
+ * PushResultChunk pushes the buffered rows to the node of the partition as a
+ * new intermediate result.
+ */
+static void
+PushResultChunk(PushedResultDestReceiver *resultDest)
+{
+	CopyOutState copyOutState = resultDest->copyOutState;
+	StringInfo chunkData = copyOutState->fe_msgbuf;
+
+	MemoryContext oldContext = MemoryContextSwitchTo(resultDest->memoryContext);
+
+	if (copyOutState->binary)
+	{
+		/* write footers when using binary encoding */
+		AppendCopyBinaryFooters(copyOutState);
+	}
+
+	PushedResultChunk *chunk = palloc0(sizeof(PushedResultChunk));
+	chunk->resultId = psprintf("%s_%d", resultDest->resultIdPrefix,
+							   list_length(resultDest->chunkList));
+	chunk->rowCount = resultDest->chunkRowCount;
+	chunk->byteCount = chunkData->len;
+
+	MultiConnection *connection = PushedResultNodeConnection(resultDest->node);
+	PushResultData(connection, chunk->resultId, chunkData,
+				   resultDest->compressionType);
+
+	resultDest->chunkList = lappend(resultDest->chunkList, chunk);
+	resultDest->chunkRowCount = 0;
+	resetStringInfo(chunkData);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * PushResultData stores the given data as an intermediate result on the other
+ * side of the connection, in the same way as the broadcast of a result.
+ */
+static void
+PushResultData(MultiConnection *connection, const char *resultId,
+			   StringInfo resultData, ResultCompressionType compressionType)
+{
+	bool raiseInterrupts = true;
+	StringInfo copyCommand = makeStringInfo();
+
+	appendStringInfo(copyCommand, "COPY \"%s\" FROM STDIN WITH (format result",
+					 resultId);
+
+	if (compressionType != RESULT_COMPRESSION_NONE)
+	{
+		appendStringInfo(copyCommand, ", compression '%s'",
+						 ResultCompressionName(compressionType));
+	}
+
+	appendStringInfoString(copyCommand, ")");
+
+	if (!SendRemoteCommand(connection, copyCommand->data))
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
+	PGresult *result = GetRemoteCommandResult(connection, raiseInterrupts);
+	if (PQresultStatus(result) != PGRES_COPY_IN)
+	{
+		ReportResultError(connection, result, ERROR);
+	}
+
+	PQclear(result);
+
+	if (compressionType == RESULT_COMPRESSION_NONE)
+	{
+		if (!PutRemoteCopyData(connection, resultData->data, resultData->len))
+		{
+			ReportConnectionError(connection, ERROR);
+		}
+	}
+	else
+	{
+		/* each frame is sent as a separate COPY data message */
+		StringInfo frame = makeStringInfo();
+
+		for (int offset = 0; offset < resultData->len;
+			 offset += RESULT_COMPRESSION_FRAME_SIZE)
+		{
+			int frameLength = Min(resultData->len - offset,
+								  RESULT_COMPRESSION_FRAME_SIZE);
+
+			CompressResultFrame(compressionType, resultData->data + offset,
+								frameLength, frame);
+
+			if (!PutRemoteCopyData(connection, frame->data, frame->len))
+			{
+				ReportConnectionError(connection, ERROR);
+			}
+		}
+
+		pfree(frame->data);
+		pfree(frame);
+	}
+
+	if (!PutRemoteCopyEnd(connection, NULL))
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
+	result = GetRemoteCommandResult(connection, raiseInterrupts);
+	if (PQresultStatus(result) != PGRES_COMMAND_OK)
+	{
+		ReportResultError(connection, result, ERROR);
+	}
+
+	PQclear(result);
+	ClearResults(connection, raiseInterrupts);
+}
+
+
+/*
+ * PushedResultDestReceiverShutdown implements the rShutdown interface of
+ * PushedResultDestReceiver by pushing the last chunk.
+ */
+static void
+PushedResultDestReceiverShutdown(DestReceiver *dest)
+{
+	PushedResultDestReceiver *resultDest = (PushedResultDestReceiver *) dest;
+
+	if (resultDest->chunkRowCount > 0)
+	{
+		PushResultChunk(resultDest);
+	}
+}
+
+
+/*
+ * PushedResultDestReceiverDestroy implements the rDestroy interface of
+ * PushedResultDestReceiver. The chunk list is kept, since the caller reports
+ * the chunks after the execution.
+ */
+static void
+PushedResultDestReceiverDestroy(DestReceiver *dest)
+{
+	PushedResultDestReceiver *resultDest = (PushedResultDestReceiver *) dest;
+
+	if (resultDest->copyOutState)
+	{
+		pfree(resultDest->copyOutState);
+		resultDest->copyOutState = NULL;
+	}
+
+	if (resultDest->columnOutputFunctions)
+	{
+		pfree(resultDest->columnOutputFunctions);
+		resultDest->columnOutputFunctions = NULL;
+	}
+}
@@ -0,0 +1,768 @@
+/*-------------------------------------------------------------------------
+ *
+ * query_result_cache.c
+ *   Shared memory cache for the results of read-only queries on reference
+ *   tables. Applications often run the same small queries on reference
+ *   tables many times a second, and each of them otherwise requires a round
+ *   trip to a worker or a local execution of the query.
+ *
+ *   A result is valid until the next modification of one of the reference
+ *   tables that the query reads. To detect those, we keep a modification
+ *   counter per table in shared memory, which transactions that modified a
+ *   table increment when they commit. Cached results remember the counters
+ *   of their tables as they were before the query ran. The counters are
+ *   indexed by a hash of the relation, so different tables may share a
+ *   counter, which only causes some unnecessary invalidations.
+ *
+ *   Only modifications made via the Citus executor on this node increment the
+ *   counters, so the cache does not notice modifications made on other nodes.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "miscadmin.h"
+
+#include "access/htup_details.h"
+#include "access/xact.h"
+#include "common/hashfn.h"
+#include "executor/tuptable.h"
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+#include "pg_version_constants.h"
+
+#include "distributed/citus_safe_lib.h"
+#include "distributed/deparse_shard_query.h"
+#include "distributed/listutils.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/query_result_cache.h"
+
+
+/* number of bytes for the key and the tuples of a single cached result */
+#define QUERY_RESULT_CACHE_ENTRY_DATA_SIZE (16 * 1024)
+
+/* number of modification counters that the tables map onto */
+#define QUERY_RESULT_CACHE_COUNTER_COUNT 1024
+
+
+/*
+ * QueryResultCacheEntry is a cached result in shared memory. The data
+ * contains the key string followed by the tuples of the result, each of
+ * which starts at a MAXALIGN'ed offset relative to the first tuple.
+ */
+typedef struct QueryResultCacheEntry
+{
+	bool valid;
+	uint64 keyHash;
+	int keyLength;
+
+	int relationCount;
+	int counterIndexes[QUERY_RESULT_CACHE_MAX_RELATIONS];
+	uint64 modificationCounts[QUERY_RESULT_CACHE_MAX_RELATIONS];
+
+	uint64 tupleCount;
+	int tupleDataLength;
+	char data[QUERY_RESULT_CACHE_ENTRY_DATA_SIZE];
+} QueryResultCacheEntry;
+
+
+/* hash entry that maps the hash of a key string to a cached result */
+typedef struct QueryResultCacheHashEntry
+{
+	uint64 keyHash;
+	int entryIndex;
+} QueryResultCacheHashEntry;
+
+
+/*
+ * The data structure used to store the cache in shared memory. The hash and
+ * the entries are protected by the lock, the counters are atomic.
+ */
+typedef struct QueryResultCacheSharedData
+{
+	int queryResultCacheTrancheId;
+	char *queryResultCacheTrancheName;
+
+	LWLock queryResultCacheLock;
+
+	/* next entry to replace once all entries are used, guarded by the lock */
+	int nextVictimIndex;
+
+	pg_atomic_uint64 modificationCounters[QUERY_RESULT_CACHE_COUNTER_COUNT];
+
+	QueryResultCacheEntry entries[FLEXIBLE_ARRAY_MEMBER];
+} QueryResultCacheSharedData;
+
+
+/* GUC, whether read-only queries on reference tables use the cache */
+bool EnableQueryResultCache = false;
+
+/* GUC, size of the cache in kilobytes, 0 means no shared memory is used */
+int QueryResultCacheSize = 0;
+
+
+/* the following two structs are used for accessing shared memory */
+static HTAB *QueryResultCacheHash = NULL;
+static QueryResultCacheSharedData *QueryResultCacheSharedState = NULL;
+
+/*
+ * Modification counters of the tables that the current transaction modified,
+ * which we increment when the transaction commits. Allocated in the
+ * TopTransactionContext.
+ */
+static List *ModifiedCounterIndexList = NIL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+/* local function declarations */
+static int QueryResultCacheEntryCount(void);
+static int ModificationCounterIndex(Oid relationId);
+static char * QueryResultCacheKeyString(Task *task, ParamListInfo paramListInfo,
+										int *keyLength);
+static bool CacheEntryMatchesRequest(QueryResultCacheEntry *cacheEntry,
+									 QueryResultCacheRequest *request);
+static bool ModificationCountsChanged(QueryResultCacheRequest *request);
+
+
+/*
+ * CreateQueryResultCacheRequest returns the request for looking up or adding
+ * the result of the given read-only task, or NULL if the result of the task
+ * cannot be cached. That is the case when the task reads other tables than
+ * reference tables, or reference tables that the current transaction
+ * modified. Since another transaction may have cached a result that our
+ * snapshot does not see yet, we also do not use the cache in transactions
+ * that use a single snapshot.
+ */
+QueryResultCacheRequest *
+CreateQueryResultCacheRequest(Task *task, ParamListInfo paramListInfo)
+{
+	if (!EnableQueryResultCache || QueryResultCacheSharedState == NULL)
+	{
+		return NULL;
+	}
+
+	if (IsolationUsesXactSnapshot())
+	{
+		return NULL;
+	}
+
+	/* dynamic parameters may not be known up front */
+	if (paramListInfo != NULL && paramListInfo->paramFetch != NULL)
+	{
+		return NULL;
+	}
+
+	QueryResultCacheRequest *request = palloc0(sizeof(QueryResultCacheRequest));
+	List *relationIdList = NIL;
+
+	RelationShard *relationShard = NULL;
+	foreach_ptr(relationShard, task->relationShardList)
+	{
+		Oid relationId = relationShard->relationId;
+
+		if (list_member_oid(relationIdList, relationId))
+		{
+			continue;
+		}
+
+		if (!IsCitusTableType(relationId, REFERENCE_TABLE) ||
+			request->relationCount >= QUERY_RESULT_CACHE_MAX_RELATIONS)
+		{
+			return NULL;
+		}
+
+		int counterIndex = ModificationCounterIndex(relationId);
+		if (list_member_int(ModifiedCounterIndexList, counterIndex))
+		{
+			return NULL;
+		}
+
+		request->counterIndexes[request->relationCount] = counterIndex;
+		request->relationCount++;
+
+		relationIdList = lappend_oid(relationIdList, relationId);
+	}
+
+	if (request->relationCount == 0)
+	{
+		return NULL;
+	}
+
+	request->keyString = QueryResultCacheKeyString(task, paramListInfo,
+												   &request->keyLength);
+	if (request->keyLength > QUERY_RESULT_CACHE_ENTRY_DATA_SIZE)
+	{
+		return NULL;
+	}
+
+	request->keyHash = DatumGetUInt64(
+		hash_any_extended((unsigned char *) request->keyString,
+						  request->keyLength, 0));
+
+	for (int relationIndex = 0; relationIndex < request->relationCount;
+		 relationIndex++)
+	{
+		int counterIndex = request->counterIndexes[relationIndex];
+
+		request->modificationCounts[relationIndex] = pg_atomic_read_u64(
+			&QueryResultCacheSharedState->modificationCounters[counterIndex]);
+	}
+
+	return request;
+}
+
+
+/*
+ * QueryResultCacheKeyString returns the string that identifies the result of
+ * the given task, which consists of the database, the user, the query and
+ * the values of the parameters.
+ */
+static char *
+QueryResultCacheKeyString(Task *task, ParamListInfo paramListInfo, int *keyLength)
+{
+	StringInfo keyString = makeStringInfo();
+
+	appendStringInfo(keyString, "%u %u\n%s", MyDatabaseId, GetUserId(),
+					 TaskQueryString(task));
+
+	int parameterCount = paramListInfo != NULL ? paramListInfo->numParams : 0;
+
+	for (int parameterIndex = 0; parameterIndex < parameterCount; parameterIndex++)
+	{
+		ParamExternData *parameterData = &paramListInfo->params[parameterIndex];
+
+		if (parameterData->ptype == InvalidOid || parameterData->isnull)
+		{
+			appendStringInfo(keyString, "\n$%d %u NULL", parameterIndex + 1,
+							 parameterData->ptype);
+			continue;
+		}
+
+		Oid typeOutputFunctionId = InvalidOid;
+		bool variableLengthType = false;
+
+		getTypeOutputInfo(parameterData->ptype, &typeOutputFunctionId,
+						  &variableLengthType);
+		char *parameterValue = OidOutputFunctionCall(typeOutputFunctionId,
+													 parameterData->value);
+
+		/* include the length, since values may contain any character */
+		appendStringInfo(keyString, "\n$%d %u %zu %s", parameterIndex + 1,
+						 parameterData->ptype, strlen(parameterValue),
+						 parameterValue);
+	}
+
+	*keyLength = keyString->len;
+
+	return keyString->data;
+}
+
+
+/*
+ * LookupQueryResultCache adds the tuples of the cached result of the given
+ * request to the tuple store and returns true, or returns false if there is
+ * no valid cached result.
+ */
+bool
+LookupQueryResultCache(QueryResultCacheRequest *request, Tuplestorestate *tupleStore,
+					   TupleDesc tupleDesc)
+{
+	char *tupleData = NULL;
+	uint64 tupleCount = 0;
+	bool resultFound = false;
+
+	LWLockAcquire(&QueryResultCacheSharedState->queryResultCacheLock, LW_SHARED);
+
+	bool hashEntryFound = false;
+	QueryResultCacheHashEntry *hashEntry =
+		hash_search(QueryResultCacheHash, &request->keyHash, HASH_FIND, &hashEntryFound);
+
+	if (hashEntryFound)
+	{
+		QueryResultCacheEntry *cacheEntry =
+			&QueryResultCacheSharedState->entries[hashEntry->entryIndex];
+
+		if (CacheEntryMatchesRequest(cacheEntry, request))
+		{
+			int tupleDataLength = cacheEntry->tupleDataLength;
+
+			tupleData = palloc(Max(tupleDataLength, 1));
+			memcpy_s(tupleData, Max(tupleDataLength, 1),
+					 cacheEntry->data + MAXALIGN(cacheEntry->keyLength),
+					 tupleDataLength);
+			tupleCount = cacheEntry->tupleCount;
+			resultFound = true;
+		}
+	}
+
+	LWLockRelease(&QueryResultCacheSharedState->queryResultCacheLock);
+
+	if (!resultFound)
+	{
+		return false;
+	}
+
+	TupleTableSlot *slot = MakeSingleTupleTableSlot(tupleDesc, &TTSOpsMinimalTuple);
+	int tupleOffset = 0;
+
+	for (uint64 tupleIndex = 0; tupleIndex < tupleCount; tupleIndex++)
+	{
+		MinimalTuple tuple = (MinimalTuple) (tupleData + tupleOffset);
+
+		ExecStoreMinimalTuple(tuple, slot, false);
+		tuplestore_puttupleslot(tupleStore, slot);
+
+		tupleOffset += MAXALIGN(tuple->t_len);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	pfree(tupleData);
+
+	ereport(DEBUG4, (errmsg("using the cached result of the query")));
+
+	return true;
+}
+
+
+/*
+ * CacheEntryMatchesRequest returns whether the given cache entry holds the
+ * result of the query of the given request, and none of the tables of the
+ * query were modified since the result was cached.
+ */
+static bool
+CacheEntryMatchesRequest(QueryResultCacheEntry *cacheEntry,
+						 QueryResultCacheRequest *request)
+{
+	if (!cacheEntry->valid || cacheEntry->keyHash != request->keyHash ||
+		cacheEntry->keyLength != request->keyLength ||
+		cacheEntry->relationCount != request->relationCount)
+	{
+		return false;
+	}
+
+	/* different keys may have the same hash */
+	if (memcmp(cacheEntry->data, request->keyString, request->keyLength) != 0)
+	{
+		return false;
+	}
+
+	for (int relationIndex = 0; relationIndex < request->relationCount;
+		 relationIndex++)
+	{
+		if (cacheEntry->counterIndexes[relationIndex] !=
+			request->counterIndexes[relationIndex] ||
+			cacheEntry->modificationCounts[relationIndex] !=
+			request->modificationCounts[relationIndex])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * StoreQueryResultCache adds the tuples in the given tuple store to the cache
+ * as the result of the given request, unless they do not fit into an entry
+ * or one of the tables was modified since the request was created. It
+ * rewinds the tuple store afterwards.
+ */
+void
+StoreQueryResultCache(QueryResultCacheRequest *request, Tuplestorestate *tupleStore,
+					  TupleDesc tupleDesc)
+{
+	int maxTupleDataLength =
+		QUERY_RESULT_CACHE_ENTRY_DATA_SIZE - MAXALIGN(request->keyLength);
+	StringInfo tupleData = makeStringInfo();
+	uint64 tupleCount = 0;
+	bool resultFits = true;
+
+	TupleTableSlot *slot = MakeSingleTupleTableSlot(tupleDesc, &TTSOpsMinimalTuple);
+
+	while (tuplestore_gettupleslot(tupleStore, true, false, slot))
+	{
+		bool shouldFree = false;
+		MinimalTuple tuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+
+		/* toasted values refer to the tables, which may change */
+		if ((tuple->t_infomask & HEAP_HASEXTERNAL) != 0 ||
+			tupleData->len + (int) MAXALIGN(tuple->t_len) > maxTupleDataLength)
+		{
+			resultFits = false;
+			break;
+		}
+
+		appendBinaryStringInfo(tupleData, (char *) tuple, tuple->t_len);
+
+		/* the data of the StringInfo itself is MAXALIGN'ed */
+		while (tupleData->len % MAXIMUM_ALIGNOF != 0)
+		{
+			appendStringInfoChar(tupleData, '\0');
+		}
+
+		if (shouldFree)
+		{
+			heap_free_minimal_tuple(tuple);
+		}
+
+		tupleCount++;
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	tuplestore_rescan(tupleStore);
+
+	if (!resultFits || ModificationCountsChanged(request))
+	{
+		return;
+	}
+
+	LWLockAcquire(&QueryResultCacheSharedState->queryResultCacheLock, LW_EXCLUSIVE);
+
+	bool hashEntryFound = false;
+	QueryResultCacheHashEntry *hashEntry =
+		hash_search(QueryResultCacheHash, &request->keyHash, HASH_FIND, &hashEntryFound);
+
+	if (!hashEntryFound)
+	{
+		/* replace the entries in a round-robin fashion */
+		int entryIndex = QueryResultCacheSharedState->nextVictimIndex;
+		QueryResultCacheEntry *victimEntry =
+			&QueryResultCacheSharedState->entries[entryIndex];
+
+		QueryResultCacheSharedState->nextVictimIndex =
+			(entryIndex + 1) % QueryResultCacheEntryCount();
+
+		if (victimEntry->valid)
+		{
+			hash_search(QueryResultCacheHash, &victimEntry->keyHash, HASH_REMOVE, NULL);
+			victimEntry->valid = false;
+		}
+
+		hashEntry = hash_search(QueryResultCacheHash, &request->keyHash,
+								HASH_ENTER_NULL, &hashEntryFound);
+		if (hashEntry == NULL)
+		{
+			LWLockRelease(&QueryResultCacheSharedState->queryResultCacheLock);
+			return;
+		}
+
+		hashEntry->entryIndex = entryIndex;
+	}
+
+	QueryResultCacheEntry *cacheEntry =
+		&QueryResultCacheSharedState->entries[hashEntry->entryIndex];
+
+	cacheEntry->keyHash = request->keyHash;
+	cacheEntry->keyLength = request->keyLength;
+	memcpy_s(cacheEntry->data, QUERY_RESULT_CACHE_ENTRY_DATA_SIZE,
+			 request->keyString, request->keyLength);
+
+	cacheEntry->relationCount = request->relationCount;
+	for (int relationIndex = 0; relationIndex < request->relationCount;
+		 relationIndex++)
+	{
+		cacheEntry->counterIndexes[relationIndex] =
+			request->counterIndexes[relationIndex];
+		cacheEntry->modificationCounts[relationIndex] =
+			request->modificationCounts[relationIndex];
+	}
+
+	cacheEntry->tupleCount = tupleCount;
+	cacheEntry->tupleDataLength = tupleData->len;
+	if (tupleData->len > 0)
+	{
+		memcpy_s(cacheEntry->data + MAXALIGN(request->keyLength), maxTupleDataLength,
+				 tupleData->data, tupleData->len);
+	}
+
+	cacheEntry->valid = true;
+
+	LWLockRelease(&QueryResultCacheSharedState->queryResultCacheLock);
+}
+
+
+/*
+ * ModificationCountsChanged returns whether one of the tables of the given
+ * request was modified since the request was created.
+ */
+static bool
+ModificationCountsChanged(QueryResultCacheRequest *request)
+{
+	for (int relationIndex = 0; relationIndex < request->relationCount;
+		 relationIndex++)
+	{
+		int counterIndex = request->counterIndexes[relationIndex];
+		uint64 modificationCount = pg_atomic_read_u64(
+			&QueryResultCacheSharedState->modificationCounters[counterIndex]);
+
+		if (modificationCount != request->modificationCounts[relationIndex])
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * QueryResultCacheRecordTaskListModifications records that the current
+ * transaction modifies the reference tables that the given tasks write into
+ * or change the schema of.
+ */
+void
+QueryResultCacheRecordTaskListModifications(List *taskList)
+{
+	if (QueryResultCacheSharedState == NULL)
+	{
+		return;
+	}
+
+	Oid lastRelationId = InvalidOid;
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		/* the tasks of DDL commands only have an anchor shard */
+		if (task->relationShardList == NIL && task->anchorShardId != INVALID_SHARD_ID)
+		{
+			bool missingOk = true;
+			Oid relationId = LookupShardRelationFromCatalog(task->anchorShardId,
+															missingOk);
+			if (OidIsValid(relationId) && relationId != lastRelationId)
+			{
+				QueryResultCacheRecordRelationModification(relationId);
+				lastRelationId = relationId;
+			}
+		}
+
+		RelationShard *relationShard = NULL;
+		foreach_ptr(relationShard, task->relationShardList)
+		{
+			if (relationShard->relationId == lastRelationId)
+			{
+				continue;
+			}
+
+			QueryResultCacheRecordRelationModification(relationShard->relationId);
+			lastRelationId = relationShard->relationId;
+		}
+	}
+}
+
+
+/*
+ * QueryResultCacheRecordRelationModification records that the current
+ * transaction modifies the given table, if it is a reference table. The
+ * cached results that read the table become invalid when the transaction
+ * commits, and the transaction itself no longer uses the cache for them.
+ */
+void
+QueryResultCacheRecordRelationModification(Oid relationId)
+{
+	if (QueryResultCacheSharedState == NULL ||
+		!IsCitusTableType(relationId, REFERENCE_TABLE))
+	{
+		return;
+	}
+
+	int counterIndex = ModificationCounterIndex(relationId);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(TopTransactionContext);
+
+	ModifiedCounterIndexList = list_append_unique_int(ModifiedCounterIndexList,
+													  counterIndex);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * QueryResultCacheTransactionCommitted increments the modification counters
+ * of the tables that the transaction modified, once the modifications are
+ * visible to other transactions. Results that were computed before are then
+ * no longer valid, since their counters were read before the query ran.
+ */
+void
+QueryResultCacheTransactionCommitted(void)
+{
+	int counterIndex = 0;
+	foreach_int(counterIndex, ModifiedCounterIndexList)
+	{
+		pg_atomic_fetch_add_u64(
+			&QueryResultCacheSharedState->modificationCounters[counterIndex], 1);
+	}
+
+	ModifiedCounterIndexList = NIL;
+}
+
+
+/*
+ * ResetQueryResultCacheModifications forgets the modifications of the
+ * current transaction, which is called when the transaction aborts.
+ */
+void
+ResetQueryResultCacheModifications(void)
+{
+	ModifiedCounterIndexList = NIL;
+}
+
+
+/*
+ * ModificationCounterIndex returns the index of the modification counter of
+ * the given table.
+ */
+static int
+ModificationCounterIndex(Oid relationId)
+{
+	uint32 relationHash = hash_combine(hash_uint32(MyDatabaseId),
+									   hash_uint32(relationId));
+
+	return relationHash % QUERY_RESULT_CACHE_COUNTER_COUNT;
+}
+
+
+/*
+ * QueryResultCacheEntryCount returns the number of results that fit into the
+ * cache of size citus.query_result_cache_size.
+ */
+static int
+QueryResultCacheEntryCount(void)
+{
+	return (int) (((Size) QueryResultCacheSize * 1024) / sizeof(QueryResultCacheEntry));
+}
+
+
+/*
+ * InitializeQueryResultCache requests the necessary shared memory from
+ * Postgres and sets up the shared memory startup hook.
+ */
+void
+InitializeQueryResultCache(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(QueryResultCacheShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = QueryResultCacheShmemInit;
+}
+
+
+/*
+ * QueryResultCacheShmemSize returns the size that should be allocated on the
+ * shared memory for the cache, which is 0 when the cache is disabled.
+ */
+size_t
+QueryResultCacheShmemSize(void)
+{
+	int entryCount = QueryResultCacheEntryCount();
+	Size size = 0;
+
+	if (entryCount == 0)
+	{
+		return size;
+	}
+
+	size = add_size(size, offsetof(QueryResultCacheSharedData, entries));
+	size = add_size(size, mul_size(entryCount, sizeof(QueryResultCacheEntry)));
+
+	Size hashSize = hash_estimate_size(entryCount, sizeof(QueryResultCacheHashEntry));
+
+	size = add_size(size, hashSize);
+
+	return size;
+}
+
+
+/*
+ * QueryResultCacheShmemInit initializes the shared memory used for caching
+ * query results across backends.
+ */
+void
+QueryResultCacheShmemInit(void)
+{
+	int entryCount = QueryResultCacheEntryCount();
+
+	if (entryCount > 0)
+	{
+		bool alreadyInitialized = false;
+		HASHCTL info;
+
+		/* create key hash -> entry index */
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(uint64);
+		info.entrysize = sizeof(QueryResultCacheHashEntry);
+		uint32 hashFlags = (HASH_ELEM | HASH_BLOBS);
+
+		LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+		QueryResultCacheSharedState =
+			(QueryResultCacheSharedData *) ShmemInitStruct(
+				"Query Result Cache Data",
+				add_size(offsetof(QueryResultCacheSharedData, entries),
+						 mul_size(entryCount, sizeof(QueryResultCacheEntry))),
+				&alreadyInitialized);
+
+		if (!alreadyInitialized)
+		{
+			QueryResultCacheSharedState->queryResultCacheTrancheId =
+				LWLockNewTrancheId();
+			QueryResultCacheSharedState->queryResultCacheTrancheName =
+				"Query Result Cache Tranche";
+			LWLockRegisterTranche(
+				QueryResultCacheSharedState->queryResultCacheTrancheId,
+				QueryResultCacheSharedState->queryResultCacheTrancheName);
+
+			LWLockInitialize(&QueryResultCacheSharedState->queryResultCacheLock,
+							 QueryResultCacheSharedState->queryResultCacheTrancheId);
+
+			QueryResultCacheSharedState->nextVictimIndex = 0;
+
+			for (int counterIndex = 0; counterIndex < QUERY_RESULT_CACHE_COUNTER_COUNT;
+				 counterIndex++)
+			{
+				pg_atomic_init_u64(
+					&QueryResultCacheSharedState->modificationCounters[counterIndex], 0);
+			}
+
+			for (int entryIndex = 0; entryIndex < entryCount; entryIndex++)
+			{
+				QueryResultCacheSharedState->entries[entryIndex].valid = false;
+			}
+		}
+
+		/* allocate hash table */
+		QueryResultCacheHash =
+			ShmemInitHash("Query Result Cache Hash", entryCount, entryCount, &info,
+						  hashFlags);
+
+		LWLockRelease(AddinShmemInitLock);
+
+		Assert(QueryResultCacheHash != NULL);
+		Assert(QueryResultCacheSharedState->queryResultCacheTrancheId != 0);
+	}
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
@@ -19,11 +19,13 @@
 
 #include "access/hash.h"
 #include "catalog/pg_authid.h"
+#include "port/pg_bitutils.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/spin.h"
 #include "tcop/utility.h"
 #include "utils/builtins.h"
+#include "utils/float.h"
 
 #include "pg_version_constants.h"
 
@@ -32,18 +34,43 @@
 #include "distributed/hash_helpers.h"
 #include "distributed/multi_executor.h"
 #include "distributed/multi_server_executor.h"
+#include "distributed/planning_times.h"
 #include "distributed/query_stats.h"
 #include "distributed/tuplestore.h"
 #include "distributed/version_compat.h"
 
 #define CITUS_STATS_DUMP_FILE "pg_stat/citus_query_stats.stat"
-#define CITUS_STAT_STATEMENTS_COLS 6
+#define CITUS_STAT_STATEMENTS_COLS (7 + PLANNING_PHASE_COUNT)
 #define CITUS_STAT_STATAMENTS_QUERY_ID 0
 #define CITUS_STAT_STATAMENTS_USER_ID 1
 #define CITUS_STAT_STATAMENTS_DB_ID 2
 #define CITUS_STAT_STATAMENTS_EXECUTOR_TYPE 3
 #define CITUS_STAT_STATAMENTS_PARTITION_KEY 4
 #define CITUS_STAT_STATAMENTS_CALLS 5
+#define CITUS_STAT_STATAMENTS_PLANS 6
+#define CITUS_STAT_STATAMENTS_PLANNING_PHASE_TIMES 7
+
+#define CITUS_QUERY_STATS_HISTOGRAMS_COLS 9
+#define CITUS_QUERY_STATS_HISTOGRAMS_METRIC 5
+#define CITUS_QUERY_STATS_HISTOGRAMS_LOWER_BOUND 6
+#define CITUS_QUERY_STATS_HISTOGRAMS_UPPER_BOUND 7
+#define CITUS_QUERY_STATS_HISTOGRAMS_COUNT 8
+
+#define CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_COLS 10
+#define CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_COUNT 5
+#define CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_BYTES_WRITTEN 6
+#define CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_BYTES_BROADCAST 7
+#define CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_RECEIVING_NODES 8
+#define CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_TIME 9
+
+/*
+ * Latency histograms use power-of-two buckets in microseconds: the first
+ * bucket counts durations below 2^HISTOGRAM_FIRST_BUCKET_BITS us (32us),
+ * bucket i counts durations in [2^(i+4), 2^(i+5)) us and the last bucket
+ * counts everything from 2^27 us (~134s) upwards.
+ */
+#define HISTOGRAM_BUCKET_COUNT 24
+#define HISTOGRAM_FIRST_BUCKET_BITS 5
 
 
 #define USAGE_DECREASE_FACTOR (0.99)    /* decreased every CitusQueryStatsEntryDealloc */
@@ -53,7 +80,7 @@
 
 #define MAX_KEY_LENGTH NAMEDATALEN
 
-static const uint32 CITUS_QUERY_STATS_FILE_HEADER = 0x0d756e0f;
+static const uint32 CITUS_QUERY_STATS_FILE_HEADER = 0x0d756e12;
 
 /* time interval in seconds for maintenance daemon to call CitusQueryStatsSynchronizeEntries */
 int StatStatementsPurgeInterval = 10;
@@ -77,6 +104,27 @@ typedef struct QueryStatsHashKey
 	char partitionKey[MAX_KEY_LENGTH];
 } QueryStatsHashKey;
 
+/*
+ * QueryStatsHistogramType enumerates the durations for which a latency
+ * histogram is kept per query.
+ */
+typedef enum QueryStatsHistogramType
+{
+	HISTOGRAM_TOTAL_TIME = 0,
+	HISTOGRAM_PLANNING_TIME,
+	HISTOGRAM_REMOTE_WAIT_TIME,
+
+	/* number of histograms, must be the last entry */
+	HISTOGRAM_TYPE_COUNT
+} QueryStatsHistogramType;
+
+/* names of the histograms, as shown in citus_stat_statements_histograms */
+static const char *const QueryStatsHistogramNames[HISTOGRAM_TYPE_COUNT] = {
+	"total_time",
+	"planning_time",
+	"remote_wait_time"
+};
+
 /*
  * Statistics per query and executor type
  */
@@ -84,6 +132,10 @@ typedef struct queryStatsEntry
 {
 	QueryStatsHashKey key;   /* hash key of entry - MUST BE FIRST */
 	int64 calls;       /* # of times executed */
+	int64 plans;       /* # of plans whose planning times are counted */
+	double planningPhaseTimes[PLANNING_PHASE_COUNT]; /* total ms per planning phase */
+	uint32 histograms[HISTOGRAM_TYPE_COUNT][HISTOGRAM_BUCKET_COUNT]; /* # per bucket */
+	IntermediateResultStats intermediateResultStats; /* totals over all calls */
 	double usage;      /* hashtable usage factor */
 	slock_t mutex;     /* protects the counters only */
 } QueryStatsEntry;
@@ -116,9 +168,13 @@ static HTAB *queryStatsHash = NULL;
 
 Datum citus_query_stats_reset(PG_FUNCTION_ARGS);
 Datum citus_query_stats(PG_FUNCTION_ARGS);
+Datum citus_query_stats_histograms(PG_FUNCTION_ARGS);
+Datum citus_query_stats_intermediate_results(PG_FUNCTION_ARGS);
 
 PG_FUNCTION_INFO_V1(citus_stat_statements_reset);
 PG_FUNCTION_INFO_V1(citus_query_stats);
+PG_FUNCTION_INFO_V1(citus_query_stats_histograms);
+PG_FUNCTION_INFO_V1(citus_query_stats_intermediate_results);
 PG_FUNCTION_INFO_V1(citus_executor_name);
 
 
@@ -132,6 +188,9 @@ static void CitusQueryStatsEntryDealloc(void);
 static void CitusQueryStatsEntryReset(void);
 static uint32 CitusQuerysStatsHashFn(const void *key, Size keysize);
 static int CitusQuerysStatsMatchFn(const void *key1, const void *key2, Size keysize);
+static int QueryStatsHistogramBucket(double milliseconds);
+static double QueryStatsHistogramBucketLowerBound(int bucket);
+static double QueryStatsHistogramBucketUpperBound(int bucket);
 
 static HTAB * BuildExistingQueryIdHash(void);
 static int GetPGStatStatementsMax(void);
@@ -257,6 +316,14 @@ CitusQueryStatsShmemStartup(void)
 
 		/* copy in the actual stats */
 		entry->calls = temp.calls;
+		entry->plans = temp.plans;
+		for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+		{
+			entry->planningPhaseTimes[phase] = temp.planningPhaseTimes[phase];
+		}
+		memcpy_s(entry->histograms, sizeof(entry->histograms), temp.histograms,
+				 sizeof(temp.histograms));
+		entry->intermediateResultStats = temp.intermediateResultStats;
 		entry->usage = temp.usage;
 
 		/* don't initialize spinlock, already done */
@@ -392,13 +459,21 @@ CitusQueryStatsSharedMemSize(void)
 
 /*
  * CitusQueryStatsExecutorsEntry is the function to update statistics
- * for a given query id.
+ * for a given query id. If planningPhaseTimes is not NULL, the durations
+ * of the planning phases of the executed plan are added to the entry.
+ * The execution time and the time spent waiting for remote nodes, in
+ * milliseconds, are counted in the latency histograms of the entry, and the
+ * statistics of the intermediate results the execution created are added to
+ * the totals of the entry.
  */
 void
 CitusQueryStatsExecutorsEntry(uint64 queryId, MultiExecutorType executorType,
-							  char *partitionKey)
+							  char *partitionKey, double *planningPhaseTimes,
+							  double executionTime, double remoteWaitTime,
+							  IntermediateResultStats *intermediateResultStats)
 {
 	QueryStatsHashKey key;
+	double planningTime = 0.0;
 
 	/* Safety check... */
 	if (!queryStats || !queryStatsHash)
@@ -440,6 +515,18 @@ CitusQueryStatsExecutorsEntry(uint64 queryId, MultiExecutorType executorType,
 		entry = CitusQueryStatsEntryAlloc(&key, false);
 	}
 
+	if (planningPhaseTimes != NULL)
+	{
+		for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+		{
+			planningTime += planningPhaseTimes[phase];
+		}
+	}
+
+	int totalTimeBucket = QueryStatsHistogramBucket(planningTime + executionTime);
+	int planningTimeBucket = QueryStatsHistogramBucket(planningTime);
+	int remoteWaitTimeBucket = QueryStatsHistogramBucket(remoteWaitTime);
+
 	/*
 	 * Grab the spinlock while updating the counters (see comment about
 	 * locking rules at the head of the pg_stat_statements file)
@@ -456,6 +543,33 @@ CitusQueryStatsExecutorsEntry(uint64 queryId, MultiExecutorType executorType,
 
 	e->calls += 1;
 
+	if (planningPhaseTimes != NULL)
+	{
+		e->plans += 1;
+		for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+		{
+			e->planningPhaseTimes[phase] += planningPhaseTimes[phase];
+		}
+
+		e->histograms[HISTOGRAM_PLANNING_TIME][planningTimeBucket] += 1;
+	}
+
+	e->histograms[HISTOGRAM_TOTAL_TIME][totalTimeBucket] += 1;
+	e->histograms[HISTOGRAM_REMOTE_WAIT_TIME][remoteWaitTimeBucket] += 1;
+
+	if (intermediateResultStats != NULL)
+	{
+		e->intermediateResultStats.resultCount += intermediateResultStats->resultCount;
+		e->intermediateResultStats.bytesWritten +=
+			intermediateResultStats->bytesWritten;
+		e->intermediateResultStats.bytesBroadcast +=
+			intermediateResultStats->bytesBroadcast;
+		e->intermediateResultStats.receivingNodeCount +=
+			intermediateResultStats->receivingNodeCount;
+		e->intermediateResultStats.receiverTime +=
+			intermediateResultStats->receiverTime;
+	}
+
 	SpinLockRelease(&e->mutex);
 
 	LWLockRelease(queryStats->lock);
@@ -494,6 +608,13 @@ CitusQueryStatsEntryAlloc(QueryStatsHashKey *key, bool sticky)
 	}
 
 	entry->calls = 0;
+	entry->plans = 0;
+	for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+	{
+		entry->planningPhaseTimes[phase] = 0.0;
+	}
+	memset(entry->histograms, 0, sizeof(entry->histograms));
+	memset(&entry->intermediateResultStats, 0, sizeof(entry->intermediateResultStats));
 	entry->usage = (0.0);
 
 	return entry;
@@ -648,6 +769,63 @@ CitusQuerysStatsMatchFn(const void *key1, const void *key2, Size keysize)
 }
 
 
+/*
+ * QueryStatsHistogramBucket returns the index of the latency histogram bucket
+ * that counts the given duration in milliseconds.
+ */
+static int
+QueryStatsHistogramBucket(double milliseconds)
+{
+	uint64 microseconds = 0;
+	if (milliseconds > 0.0)
+	{
+		microseconds = (uint64) (milliseconds * 1000.0);
+	}
+
+	if (microseconds < (UINT64CONST(1) << HISTOGRAM_FIRST_BUCKET_BITS))
+	{
+		return 0;
+	}
+
+	int bucket = pg_leftmost_one_pos64(microseconds) - HISTOGRAM_FIRST_BUCKET_BITS + 1;
+
+	return Min(bucket, HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+
+/*
+ * QueryStatsHistogramBucketLowerBound returns the smallest duration in
+ * milliseconds that is counted in the given bucket.
+ */
+static double
+QueryStatsHistogramBucketLowerBound(int bucket)
+{
+	if (bucket == 0)
+	{
+		return 0.0;
+	}
+
+	return (UINT64CONST(1) << (bucket + HISTOGRAM_FIRST_BUCKET_BITS - 1)) / 1000.0;
+}
+
+
+/*
+ * QueryStatsHistogramBucketUpperBound returns the duration in milliseconds
+ * from which on durations are counted in the next bucket, or infinity for
+ * the last bucket.
+ */
+static double
+QueryStatsHistogramBucketUpperBound(int bucket)
+{
+	if (bucket == HISTOGRAM_BUCKET_COUNT - 1)
+	{
+		return get_float8_infinity();
+	}
+
+	return (UINT64CONST(1) << (bucket + HISTOGRAM_FIRST_BUCKET_BITS)) / 1000.0;
+}
+
+
 /*
  * Reset statistics.
  */
@@ -704,6 +882,7 @@ citus_query_stats(PG_FUNCTION_ARGS)
 		MultiExecutorType executorType = MULTI_EXECUTOR_INVALID_FIRST;
 		char partitionKey[MAX_KEY_LENGTH];
 		int64 calls = 0;
+		double planningPhaseTimes[PLANNING_PHASE_COUNT];
 
 		memset(values, 0, sizeof(values));
 		memset(nulls, 0, sizeof(nulls));
@@ -733,6 +912,11 @@ citus_query_stats(PG_FUNCTION_ARGS)
 		}
 
 		calls = entry->calls;
+		int64 plans = entry->plans;
+		for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+		{
+			planningPhaseTimes[phase] = entry->planningPhaseTimes[phase];
+		}
 
 		SpinLockRelease(&entry->mutex);
 
@@ -753,6 +937,228 @@ citus_query_stats(PG_FUNCTION_ARGS)
 		}
 
 		values[CITUS_STAT_STATAMENTS_CALLS] = Int64GetDatumFast(calls);
+		values[CITUS_STAT_STATAMENTS_PLANS] = Int64GetDatumFast(plans);
+
+		for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+		{
+			values[CITUS_STAT_STATAMENTS_PLANNING_PHASE_TIMES + phase] =
+				Float8GetDatumFast(planningPhaseTimes[phase]);
+		}
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	LWLockRelease(queryStats->lock);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+
+/*
+ * citus_query_stats_histograms returns the non-empty buckets of the latency
+ * histograms of the query stats kept in memory.
+ */
+Datum
+citus_query_stats_histograms(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupdesc;
+	HASH_SEQ_STATUS hash_seq;
+	QueryStatsEntry *entry;
+	Oid currentUserId = GetUserId();
+	bool canSeeStats = superuser();
+
+	if (!queryStats)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("citus_query_stats_histograms: shared memory not initialized")));
+	}
+
+	if (is_member_of_role(GetUserId(), ROLE_PG_READ_ALL_STATS))
+	{
+		canSeeStats = true;
+	}
+
+	Tuplestorestate *tupstore = SetupTuplestore(fcinfo, &tupdesc);
+
+	/* exclusive lock on queryStats->lock is acquired and released inside the function */
+	CitusQueryStatsSynchronizeEntries();
+
+	LWLockAcquire(queryStats->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, queryStatsHash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		/* following vars are to keep data for processing after spinlock release */
+		QueryStatsHashKey key;
+		uint32 histograms[HISTOGRAM_TYPE_COUNT][HISTOGRAM_BUCKET_COUNT];
+
+		SpinLockAcquire(&entry->mutex);
+
+		/*
+		 * Skip entry if unexecuted (ie, it's a pending "sticky" entry) or
+		 * the user does not have permission to view it.
+		 */
+		if (entry->calls == 0 || !(currentUserId == entry->key.userid || canSeeStats))
+		{
+			SpinLockRelease(&entry->mutex);
+			continue;
+		}
+
+		memcpy_s(&key, sizeof(key), &entry->key, sizeof(entry->key));
+		memcpy_s(histograms, sizeof(histograms), entry->histograms,
+				 sizeof(entry->histograms));
+
+		SpinLockRelease(&entry->mutex);
+
+		for (int histogram = 0; histogram < HISTOGRAM_TYPE_COUNT; histogram++)
+		{
+			for (int bucket = 0; bucket < HISTOGRAM_BUCKET_COUNT; bucket++)
+			{
+				Datum values[CITUS_QUERY_STATS_HISTOGRAMS_COLS];
+				bool nulls[CITUS_QUERY_STATS_HISTOGRAMS_COLS];
+
+				if (histograms[histogram][bucket] == 0)
+				{
+					continue;
+				}
+
+				memset(values, 0, sizeof(values));
+				memset(nulls, 0, sizeof(nulls));
+
+				values[CITUS_STAT_STATAMENTS_QUERY_ID] = UInt64GetDatum(key.queryid);
+				values[CITUS_STAT_STATAMENTS_USER_ID] = ObjectIdGetDatum(key.userid);
+				values[CITUS_STAT_STATAMENTS_DB_ID] = ObjectIdGetDatum(key.dbid);
+				values[CITUS_STAT_STATAMENTS_EXECUTOR_TYPE] = UInt32GetDatum(
+					(uint32) key.executorType);
+
+				if (key.partitionKey[0] != '\0')
+				{
+					values[CITUS_STAT_STATAMENTS_PARTITION_KEY] = CStringGetTextDatum(
+						key.partitionKey);
+				}
+				else
+				{
+					nulls[CITUS_STAT_STATAMENTS_PARTITION_KEY] = true;
+				}
+
+				values[CITUS_QUERY_STATS_HISTOGRAMS_METRIC] = CStringGetTextDatum(
+					QueryStatsHistogramNames[histogram]);
+				values[CITUS_QUERY_STATS_HISTOGRAMS_LOWER_BOUND] = Float8GetDatumFast(
+					QueryStatsHistogramBucketLowerBound(bucket));
+				values[CITUS_QUERY_STATS_HISTOGRAMS_UPPER_BOUND] = Float8GetDatumFast(
+					QueryStatsHistogramBucketUpperBound(bucket));
+				values[CITUS_QUERY_STATS_HISTOGRAMS_COUNT] = Int64GetDatumFast(
+					(int64) histograms[histogram][bucket]);
+
+				tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+			}
+		}
+	}
+
+	LWLockRelease(queryStats->lock);
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+
+/*
+ * citus_query_stats_intermediate_results returns the totals of the
+ * intermediate results created by the queries in the query stats kept in
+ * memory, for the queries that created any.
+ */
+Datum
+citus_query_stats_intermediate_results(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupdesc;
+	HASH_SEQ_STATUS hash_seq;
+	QueryStatsEntry *entry;
+	Oid currentUserId = GetUserId();
+	bool canSeeStats = superuser();
+
+	if (!queryStats)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("citus_query_stats_intermediate_results: shared memory not "
+						"initialized")));
+	}
+
+	if (is_member_of_role(GetUserId(), ROLE_PG_READ_ALL_STATS))
+	{
+		canSeeStats = true;
+	}
+
+	Tuplestorestate *tupstore = SetupTuplestore(fcinfo, &tupdesc);
+
+	/* exclusive lock on queryStats->lock is acquired and released inside the function */
+	CitusQueryStatsSynchronizeEntries();
+
+	LWLockAcquire(queryStats->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, queryStatsHash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		Datum values[CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_COLS];
+		bool nulls[CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_COLS];
+
+		/* following vars are to keep data for processing after spinlock release */
+		QueryStatsHashKey key;
+
+		SpinLockAcquire(&entry->mutex);
+
+		/*
+		 * Skip entry if unexecuted (ie, it's a pending "sticky" entry), if
+		 * the user does not have permission to view it, or if the query did
+		 * not create intermediate results.
+		 */
+		if (entry->calls == 0 || !(currentUserId == entry->key.userid || canSeeStats) ||
+			entry->intermediateResultStats.resultCount == 0)
+		{
+			SpinLockRelease(&entry->mutex);
+			continue;
+		}
+
+		memcpy_s(&key, sizeof(key), &entry->key, sizeof(entry->key));
+		IntermediateResultStats stats = entry->intermediateResultStats;
+
+		SpinLockRelease(&entry->mutex);
+
+		memset(values, 0, sizeof(values));
+		memset(nulls, 0, sizeof(nulls));
+
+		values[CITUS_STAT_STATAMENTS_QUERY_ID] = UInt64GetDatum(key.queryid);
+		values[CITUS_STAT_STATAMENTS_USER_ID] = ObjectIdGetDatum(key.userid);
+		values[CITUS_STAT_STATAMENTS_DB_ID] = ObjectIdGetDatum(key.dbid);
+		values[CITUS_STAT_STATAMENTS_EXECUTOR_TYPE] = UInt32GetDatum(
+			(uint32) key.executorType);
+
+		if (key.partitionKey[0] != '\0')
+		{
+			values[CITUS_STAT_STATAMENTS_PARTITION_KEY] = CStringGetTextDatum(
+				key.partitionKey);
+		}
+		else
+		{
+			nulls[CITUS_STAT_STATAMENTS_PARTITION_KEY] = true;
+		}
+
+		values[CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_COUNT] = Int64GetDatumFast(
+			(int64) stats.resultCount);
+		values[CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_BYTES_WRITTEN] = Int64GetDatumFast(
+			(int64) stats.bytesWritten);
+		values[CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_BYTES_BROADCAST] =
+			Int64GetDatumFast((int64) stats.bytesBroadcast);
+		values[CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_RECEIVING_NODES] =
+			Int64GetDatumFast((int64) stats.receivingNodeCount);
+		values[CITUS_QUERY_STATS_INTERMEDIATE_RESULTS_TIME] = Float8GetDatumFast(
+			stats.receiverTime);
 
 		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
 	}
@@ -17,8 +17,11 @@
 #include "nodes/parsenodes.h"
 
 #include "distributed/citus_custom_scan.h"
+#include "distributed/citus_ruleutils.h"
+#include "distributed/commands/multi_copy.h"
 #include "distributed/intermediate_results.h"
 #include "distributed/listutils.h"
+#include "distributed/metadata_cache.h"
 #include "distributed/multi_physical_planner.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/recursive_planning.h"
@@ -300,3 +303,80 @@ GenerateTaskListWithRedistributedResults(Query *modifyQueryViaCoordinatorOrRepar
 
 	return taskList;
 }
+
+
+/*
+ * RepartitionedAggregateTaskList executes the given tasks of a plan whose
+ * groups are finalized on the workers, repartitions their results by the group
+ * key across the shards of the anchor relation, and returns the list of tasks
+ * that finalize the groups of each partition on the nodes of the shard.
+ */
+List *
+RepartitionedAggregateTaskList(DistributedPlan *distributedPlan, List *taskList)
+{
+	Query *aggregateQuery = copyObject(distributedPlan->repartitionedAggregateQuery);
+	List *taskTargetList = distributedPlan->workerJob->jobQuery->targetList;
+	CitusTableCacheEntry *targetRelation =
+		GetCitusTableCacheEntry(distributedPlan->repartitionedAggregateRelationId);
+	bool useBinaryFormat = CanUseBinaryCopyFormatForTargetList(taskTargetList);
+	List *aggregateTaskList = NIL;
+	uint32 taskIdIndex = 1;
+
+	/* the job id tells apart the results of queries executed recursively */
+	StringInfo resultIdPrefix = makeStringInfo();
+	appendStringInfo(resultIdPrefix, "repartitioned_aggregate_" UINT64_FORMAT,
+					 distributedPlan->workerJob->jobId);
+
+	/* NULL is a group too, its rows go to the first shard */
+	bool allowNullPartitionColumnValues = true;
+	List **redistributedResults =
+		RedistributeTaskListResults(resultIdPrefix->data, taskList,
+									distributedPlan->repartitionedAggregateColumnIndex,
+									targetRelation, useBinaryFormat,
+									allowNullPartitionColumnValues);
+
+	/* the finalizing query reads the partitions instead of the task results */
+	RangeTblEntry *resultRte = (RangeTblEntry *) linitial(aggregateQuery->rtable);
+	resultRte->rtekind = RTE_SUBQUERY;
+	resultRte->functions = NIL;
+	resultRte->alias = makeAlias("intermediate_result", NIL);
+	resultRte->eref->aliasname = resultRte->alias->aliasname;
+
+	int shardCount = targetRelation->shardIntervalArrayLength;
+	for (int shardOffset = 0; shardOffset < shardCount; shardOffset++)
+	{
+		ShardInterval *shardInterval =
+			targetRelation->sortedShardIntervalArray[shardOffset];
+		List *resultIdList = redistributedResults[shardInterval->shardIndex];
+		uint64 shardId = shardInterval->shardId;
+		StringInfo queryString = makeStringInfo();
+
+		/* skip empty tasks */
+		if (resultIdList == NIL)
+		{
+			continue;
+		}
+
+		/* sort result ids for consistent test output */
+		List *sortedResultIds = SortList(resultIdList, pg_qsort_strcmp);
+
+		resultRte->subquery =
+			BuildReadIntermediateResultsArrayQuery(taskTargetList,
+												   resultRte->eref->colnames,
+												   sortedResultIds, useBinaryFormat);
+
+		pg_get_query_def(aggregateQuery, queryString);
+		ereport(DEBUG2, (errmsg("distributed statement: %s", queryString->data)));
+
+		Task *aggregateTask = CreateBasicTask(INVALID_JOB_ID, taskIdIndex, READ_TASK,
+											  queryString->data);
+		aggregateTask->anchorShardId = shardId;
+		aggregateTask->taskPlacementList = ActiveShardPlacementList(shardId);
+
+		aggregateTaskList = lappend(aggregateTaskList, aggregateTask);
+
+		taskIdIndex++;
+	}
+
+	return aggregateTaskList;
+}
@@ -15,6 +15,11 @@
  *  adaptive executor logic.
  *
  *
+ * With citus.enable_skew_aware_repartition_joins, the map tasks are executed
+ * first and the number of rows they write to each bucket is collected. The
+ * tasks that join the buckets are then placed on the nodes by their size, such
+ * that hot buckets do not end up on the same node.
+ *
  * Repartition queries do not begin a transaction even if we are in
  * a transaction block. As we don't begin a transaction, they won't see the
  * DDLs that happened earlier in the transaction because we don't have that
@@ -28,9 +33,12 @@
 #include "miscadmin.h"
 
 #include "access/hash.h"
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
 #include "utils/builtins.h"
 
 #include "distributed/adaptive_executor.h"
+#include "distributed/citus_safe_lib.h"
 #include "distributed/directed_acyclic_graph_execution.h"
 #include "distributed/hash_helpers.h"
 #include "distributed/listutils.h"
@@ -42,12 +50,71 @@
 #include "distributed/task_execution_utils.h"
 #include "distributed/transaction_management.h"
 #include "distributed/transmit.h"
+#include "distributed/tuple_destination.h"
 #include "distributed/worker_manager.h"
 #include "distributed/worker_transaction.h"
 
 
+/* key of the hash of bucket sizes, a bucket is a partition of a map job */
+typedef struct BucketSizeHashKey
+{
+	uint64 jobId;
+	uint32 partitionId;
+
+	/*
+	 * The padding field is needed to make sure the struct contains no
+	 * automatic padding, which is not allowed for hashmap keys.
+	 */
+	uint32 padding;
+} BucketSizeHashKey;
+
+typedef struct BucketSizeHashEntry
+{
+	BucketSizeHashKey key;
+	int64 rowCount;
+} BucketSizeHashEntry;
+
+
+/*
+ * BucketSizeTupleDest is a TupleDestination which adds the rows_written
+ * reported by map tasks to the bucket sizes.
+ */
+typedef struct BucketSizeTupleDest
+{
+	TupleDestination pub;
+
+	TupleDesc tupleDesc;
+	HTAB *bucketSizeHash;
+} BucketSizeTupleDest;
+
+
+/* a top level task together with the number of rows in its buckets */
+typedef struct RepartitionTaskSize
+{
+	Task *task;
+	int64 rowCount;
+} RepartitionTaskSize;
+
+
+/* GUC, whether repartition join tasks are placed by the size of their buckets */
+bool EnableSkewAwareRepartitionJoins = false;
+
+
 static List * ExtractJobsInJobTree(Job *job);
 static void TraverseJobTree(Job *curJob, List **jobs);
+static List * LeafMapTaskList(List *allTasks);
+static List * MovableRepartitionTaskList(List *topLevelTasks);
+static HTAB * ExecuteMapTasksIntoBucketSizes(List *mapTaskList);
+static void BucketSizeTupleDestPutTuple(TupleDestination *self, Task *task,
+										int placementIndex, int queryNumber,
+										HeapTuple heapTuple, uint64 tupleLibpqSize);
+static TupleDesc BucketSizeTupleDestTupleDescForQuery(TupleDestination *self,
+													  int queryNumber);
+static void PlaceRepartitionTasksByBucketSize(List *taskList, HTAB *bucketSizeHash);
+static int64 RepartitionTaskRowCount(Task *task, HTAB *bucketSizeHash);
+static void SetRepartitionTaskPlacement(Task *task, WorkerNode *workerNode);
+static int CompareRepartitionTaskSizes(const void *leftElement,
+									   const void *rightElement);
 
 
 /*
@@ -60,8 +127,25 @@ ExecuteDependentTasks(List *topLevelTasks, Job *topLevelJob)
 {
 	List *allTasks = CreateTaskListForJobTree(topLevelTasks);
 	List *jobIds = ExtractJobsInJobTree(topLevelJob);
+	List *excludedTasks = topLevelTasks;
+
+	if (EnableSkewAwareRepartitionJoins)
+	{
+		List *mapTaskList = LeafMapTaskList(allTasks);
+		List *movableTaskList = MovableRepartitionTaskList(topLevelTasks);
+
+		if (mapTaskList != NIL && list_length(movableTaskList) > 1)
+		{
+			HTAB *bucketSizeHash = ExecuteMapTasksIntoBucketSizes(mapTaskList);
+
+			PlaceRepartitionTasksByBucketSize(movableTaskList, bucketSizeHash);
+
+			/* the map tasks already finished, skip them below */
+			excludedTasks = list_concat(list_copy(topLevelTasks), mapTaskList);
+		}
+	}
 
-	ExecuteTasksInDependencyOrder(allTasks, topLevelTasks, jobIds);
+	ExecuteTasksInDependencyOrder(allTasks, excludedTasks, jobIds);
 
 	return jobIds;
 }
@@ -98,3 +182,323 @@ TraverseJobTree(Job *curJob, List **jobIds)
 		TraverseJobTree(childJob, jobIds);
 	}
 }
+
+
+/*
+ * LeafMapTaskList returns the map tasks in the given task list, or NIL if some
+ * map task depends on other tasks. The bucket sizes of nested repartitions are
+ * only known after their own merge phase, so those are left alone.
+ */
+static List *
+LeafMapTaskList(List *allTasks)
+{
+	List *mapTaskList = NIL;
+
+	Task *task = NULL;
+	foreach_ptr(task, allTasks)
+	{
+		if (task->taskType != MAP_TASK)
+		{
+			continue;
+		}
+
+		if (task->dependentTaskList != NIL)
+		{
+			return NIL;
+		}
+
+		mapTaskList = lappend(mapTaskList, task);
+	}
+
+	return mapTaskList;
+}
+
+
+/*
+ * MovableRepartitionTaskList returns the top level tasks which may be executed
+ * on any node. Those are the tasks of dual repartition joins, which only read
+ * the buckets fetched to their own node. Tasks that read a shard, that have
+ * replicas, or whose buckets are shared with other tasks stay where the
+ * planner put them.
+ */
+static List *
+MovableRepartitionTaskList(List *topLevelTasks)
+{
+	List *movableTaskList = NIL;
+	List *seenMergeTaskList = NIL;
+	List *sharedMergeTaskList = NIL;
+
+	Task *task = NULL;
+	foreach_ptr(task, topLevelTasks)
+	{
+		Task *dependentTask = NULL;
+		foreach_ptr(dependentTask, task->dependentTaskList)
+		{
+			if (list_member_ptr(seenMergeTaskList, dependentTask))
+			{
+				sharedMergeTaskList = lappend(sharedMergeTaskList, dependentTask);
+			}
+
+			seenMergeTaskList = lappend(seenMergeTaskList, dependentTask);
+		}
+	}
+
+	foreach_ptr(task, topLevelTasks)
+	{
+		bool movable = task->anchorShardId == INVALID_SHARD_ID &&
+					   list_length(task->taskPlacementList) == 1 &&
+					   task->dependentTaskList != NIL;
+
+		Task *dependentTask = NULL;
+		foreach_ptr(dependentTask, task->dependentTaskList)
+		{
+			if (dependentTask->taskType != MERGE_TASK ||
+				list_member_ptr(sharedMergeTaskList, dependentTask))
+			{
+				movable = false;
+			}
+		}
+
+		if (movable)
+		{
+			movableTaskList = lappend(movableTaskList, task);
+		}
+	}
+
+	return movableTaskList;
+}
+
+
+/*
+ * ExecuteMapTasksIntoBucketSizes executes the given map tasks and returns a
+ * hash of the number of rows they wrote into each bucket.
+ *
+ * The tasks may be part of a cached plan, so we execute copies of them that
+ * carry our tuple destination.
+ */
+static HTAB *
+ExecuteMapTasksIntoBucketSizes(List *mapTaskList)
+{
+	assert_valid_hash_key3(BucketSizeHashKey, jobId, partitionId, padding);
+	HTAB *bucketSizeHash = CreateSimpleHash(BucketSizeHashKey, BucketSizeHashEntry);
+
+	int columnCount = 3;
+	TupleDesc tupleDesc = CreateTemplateTupleDesc(columnCount);
+	TupleDescInitEntry(tupleDesc, (AttrNumber) 1, "partition_index", INT4OID, -1, 0);
+	TupleDescInitEntry(tupleDesc, (AttrNumber) 2, "result_id", TEXTOID, -1, 0);
+	TupleDescInitEntry(tupleDesc, (AttrNumber) 3, "rows_written", INT8OID, -1, 0);
+
+	BucketSizeTupleDest *tupleDest = palloc0(sizeof(BucketSizeTupleDest));
+	tupleDest->pub.putTuple = BucketSizeTupleDestPutTuple;
+	tupleDest->pub.tupleDescForQuery = BucketSizeTupleDestTupleDescForQuery;
+	tupleDest->tupleDesc = tupleDesc;
+	tupleDest->bucketSizeHash = bucketSizeHash;
+
+	List *taskCopyList = NIL;
+
+	Task *mapTask = NULL;
+	foreach_ptr(mapTask, mapTaskList)
+	{
+		Task *taskCopy = palloc(sizeof(Task));
+		*taskCopy = *mapTask;
+		taskCopy->tupleDest = (TupleDestination *) tupleDest;
+
+		taskCopyList = lappend(taskCopyList, taskCopy);
+	}
+
+	ExecuteTaskList(ROW_MODIFY_NONE, taskCopyList);
+
+	return bucketSizeHash;
+}
+
+
+/*
+ * BucketSizeTupleDestPutTuple implements TupleDestination->putTuple for
+ * BucketSizeTupleDest.
+ */
+static void
+BucketSizeTupleDestPutTuple(TupleDestination *self, Task *task,
+							int placementIndex, int queryNumber,
+							HeapTuple heapTuple, uint64 tupleLibpqSize)
+{
+	BucketSizeTupleDest *tupleDest = (BucketSizeTupleDest *) self;
+	bool isNull = false;
+
+	Datum partitionIndexDatum = heap_getattr(heapTuple, 1, tupleDest->tupleDesc,
+											 &isNull);
+	Datum rowsWrittenDatum = heap_getattr(heapTuple, 3, tupleDest->tupleDesc,
+										  &isNull);
+
+	BucketSizeHashKey bucketKey = {
+		.jobId = task->jobId,
+		.partitionId = DatumGetInt32(partitionIndexDatum)
+	};
+	bool found = false;
+
+	BucketSizeHashEntry *bucketEntry =
+		hash_search(tupleDest->bucketSizeHash, &bucketKey, HASH_ENTER, &found);
+	if (!found)
+	{
+		bucketEntry->rowCount = 0;
+	}
+
+	bucketEntry->rowCount += DatumGetInt64(rowsWrittenDatum);
+}
+
+
+/*
+ * BucketSizeTupleDestTupleDescForQuery implements TupleDestination->tupleDescForQuery
+ * for BucketSizeTupleDest.
+ */
+static TupleDesc
+BucketSizeTupleDestTupleDescForQuery(TupleDestination *self, int queryNumber)
+{
+	Assert(queryNumber == 0);
+
+	BucketSizeTupleDest *tupleDest = (BucketSizeTupleDest *) self;
+
+	return tupleDest->tupleDesc;
+}
+
+
+/*
+ * PlaceRepartitionTasksByBucketSize assigns the given tasks to the nodes by the
+ * number of rows in their buckets. The largest task goes first to the node with
+ * the fewest rows assigned so far, which spreads hot buckets over the nodes.
+ */
+static void
+PlaceRepartitionTasksByBucketSize(List *taskList, HTAB *bucketSizeHash)
+{
+	List *workerNodeList = SortList(ActiveReadableNodeList(), CompareWorkerNodes);
+	int workerNodeCount = list_length(workerNodeList);
+	int taskCount = list_length(taskList);
+
+	if (workerNodeCount == 0)
+	{
+		return;
+	}
+
+	RepartitionTaskSize *taskSizeArray = palloc0(taskCount * sizeof(RepartitionTaskSize));
+	int64 *nodeRowCounts = palloc0(workerNodeCount * sizeof(int64));
+	int64 totalRowCount = 0;
+	int taskIndex = 0;
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		RepartitionTaskSize *taskSize = &taskSizeArray[taskIndex++];
+
+		taskSize->task = task;
+		taskSize->rowCount = RepartitionTaskRowCount(task, bucketSizeHash);
+		totalRowCount += taskSize->rowCount;
+	}
+
+	SafeQsort(taskSizeArray, taskCount, sizeof(RepartitionTaskSize),
+			  CompareRepartitionTaskSizes);
+
+	for (taskIndex = 0; taskIndex < taskCount; taskIndex++)
+	{
+		RepartitionTaskSize *taskSize = &taskSizeArray[taskIndex];
+		int smallestNodeIndex = 0;
+
+		for (int nodeIndex = 1; nodeIndex < workerNodeCount; nodeIndex++)
+		{
+			if (nodeRowCounts[nodeIndex] < nodeRowCounts[smallestNodeIndex])
+			{
+				smallestNodeIndex = nodeIndex;
+			}
+		}
+
+		WorkerNode *workerNode = list_nth(workerNodeList, smallestNodeIndex);
+		SetRepartitionTaskPlacement(taskSize->task, workerNode);
+
+		nodeRowCounts[smallestNodeIndex] += taskSize->rowCount;
+
+		ereport(DEBUG2, (errmsg("assigned repartition join task %u with "
+								INT64_FORMAT " rows to node %s:%u",
+								taskSize->task->taskId, taskSize->rowCount,
+								workerNode->workerName, workerNode->workerPort)));
+	}
+
+	if (taskCount > 0 && totalRowCount > 0)
+	{
+		ereport(DEBUG1, (errmsg("placed %d repartition join tasks by the size of "
+								"their buckets", taskCount)));
+	}
+}
+
+
+/*
+ * RepartitionTaskRowCount returns the total number of rows in the buckets
+ * read by the given task.
+ */
+static int64
+RepartitionTaskRowCount(Task *task, HTAB *bucketSizeHash)
+{
+	int64 rowCount = 0;
+
+	Task *mergeTask = NULL;
+	foreach_ptr(mergeTask, task->dependentTaskList)
+	{
+		BucketSizeHashKey bucketKey = {
+			.jobId = mergeTask->jobId,
+			.partitionId = mergeTask->partitionId
+		};
+		bool found = false;
+
+		BucketSizeHashEntry *bucketEntry =
+			hash_search(bucketSizeHash, &bucketKey, HASH_FIND, &found);
+		if (found)
+		{
+			rowCount += bucketEntry->rowCount;
+		}
+	}
+
+	return rowCount;
+}
+
+
+/*
+ * SetRepartitionTaskPlacement places the given task on the given node, together
+ * with the merge tasks it depends on and the fetch tasks that bring the buckets
+ * of those merge tasks to the node.
+ */
+static void
+SetRepartitionTaskPlacement(Task *task, WorkerNode *workerNode)
+{
+	ShardPlacement *taskPlacement = CitusMakeNode(ShardPlacement);
+	SetPlacementNodeMetadata(taskPlacement, workerNode);
+
+	task->taskPlacementList = list_make1(taskPlacement);
+
+	Task *mergeTask = NULL;
+	foreach_ptr(mergeTask, task->dependentTaskList)
+	{
+		mergeTask->taskPlacementList = list_copy(task->taskPlacementList);
+
+		Task *fetchTask = NULL;
+		foreach_ptr(fetchTask, mergeTask->dependentTaskList)
+		{
+			fetchTask->taskPlacementList = mergeTask->taskPlacementList;
+		}
+	}
+}
+
+
+/*
+ * CompareRepartitionTaskSizes orders tasks by descending row count, and by
+ * task ID for tasks of the same size.
+ */
+static int
+CompareRepartitionTaskSizes(const void *leftElement, const void *rightElement)
+{
+	const RepartitionTaskSize *leftTaskSize = (const RepartitionTaskSize *) leftElement;
+	const RepartitionTaskSize *rightTaskSize = (const RepartitionTaskSize *) rightElement;
+
+	if (leftTaskSize->rowCount != rightTaskSize->rowCount)
+	{
+		return (leftTaskSize->rowCount > rightTaskSize->rowCount) ? -1 : 1;
+	}
+
+	return CompareTasksByTaskId(&leftTaskSize->task, &rightTaskSize->task);
+}
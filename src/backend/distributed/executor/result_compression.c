@@ -0,0 +1,298 @@
+/*-------------------------------------------------------------------------
+ *
+ * result_compression.c
+ *	  Compression of intermediate results that are transferred between
+ *	  nodes.
+ *
+ *	  When citus.intermediate_result_compression is set, the node that
+ *	  broadcasts or fetches an intermediate result asks the other node to
+ *	  use the given compression in its COPY ... WITH (format result)
+ *	  command. The result data is then sent in frames of up to
+ *	  RESULT_COMPRESSION_FRAME_SIZE bytes, each of which is compressed
+ *	  separately and sent as a single COPY data message, such that the
+ *	  receiver can decompress a message at a time. A frame starts with the
+ *	  uncompressed and the compressed length in network byte order.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "port/pg_bswap.h"
+#include "utils/memutils.h"
+
+#include "citus_version.h"
+
+#include "distributed/citus_safe_lib.h"
+#include "distributed/result_compression.h"
+
+#if HAVE_CITUS_LIBLZ4
+#include <lz4.h>
+#endif
+
+#if HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
+
+/* frames start with the uncompressed and the compressed length */
+#define RESULT_FRAME_HEADER_SIZE ((int) (2 * sizeof(uint32)))
+
+/* results are compressed on the fly, so we prefer speed over ratio */
+#define RESULT_COMPRESSION_ZSTD_LEVEL 1
+
+
+/* GUC, compression to use for the intermediate results that we transfer */
+int IntermediateResultCompression = RESULT_COMPRESSION_NONE;
+
+
+/* local function declarations */
+static int CompressedLengthBound(ResultCompressionType compressionType, int length);
+static void ErrorUnsupportedResultCompression(const char *compressionName)
+pg_attribute_noreturn();
+
+
+/*
+ * ResultCompressionName returns the name of the given compression as used in
+ * COPY ... WITH (format result, compression '...') commands.
+ */
+const char *
+ResultCompressionName(ResultCompressionType compressionType)
+{
+	switch (compressionType)
+	{
+		case RESULT_COMPRESSION_LZ4:
+		{
+			return "lz4";
+		}
+
+		case RESULT_COMPRESSION_ZSTD:
+		{
+			return "zstd";
+		}
+
+		default:
+		{
+			return "none";
+		}
+	}
+}
+
+
+/*
+ * ResultCompressionTypeFromName returns the compression with the given name,
+ * and errors out if this build does not support it.
+ */
+ResultCompressionType
+ResultCompressionTypeFromName(const char *compressionName)
+{
+	if (strcmp(compressionName, "none") == 0)
+	{
+		return RESULT_COMPRESSION_NONE;
+	}
+#if HAVE_CITUS_LIBLZ4
+	else if (strcmp(compressionName, "lz4") == 0)
+	{
+		return RESULT_COMPRESSION_LZ4;
+	}
+#endif
+#if HAVE_LIBZSTD
+	else if (strcmp(compressionName, "zstd") == 0)
+	{
+		return RESULT_COMPRESSION_ZSTD;
+	}
+#endif
+
+	ErrorUnsupportedResultCompression(compressionName);
+
+	/* keep the compiler quiet */
+	return RESULT_COMPRESSION_NONE;
+}
+
+
+/*
+ * CompressResultFrame compresses the given data into frame, after resetting
+ * it.
+ */
+void
+CompressResultFrame(ResultCompressionType compressionType, const char *data,
+					int length, StringInfo frame)
+{
+	Assert(length > 0 && length <= RESULT_COMPRESSION_FRAME_SIZE);
+
+	int maxCompressedLength = CompressedLengthBound(compressionType, length);
+
+	resetStringInfo(frame);
+	enlargeStringInfo(frame, RESULT_FRAME_HEADER_SIZE + maxCompressedLength);
+
+	char *compressedData = frame->data + RESULT_FRAME_HEADER_SIZE;
+	int compressedLength = 0;
+
+	switch (compressionType)
+	{
+#if HAVE_CITUS_LIBLZ4
+		case RESULT_COMPRESSION_LZ4:
+		{
+			compressedLength = LZ4_compress_default(data, compressedData, length,
+													maxCompressedLength);
+			break;
+		}
+#endif
+
+#if HAVE_LIBZSTD
+		case RESULT_COMPRESSION_ZSTD:
+		{
+			size_t zstdLength = ZSTD_compress(compressedData, maxCompressedLength, data,
+											  length, RESULT_COMPRESSION_ZSTD_LEVEL);
+			if (!ZSTD_isError(zstdLength))
+			{
+				compressedLength = (int) zstdLength;
+			}
+			break;
+		}
+#endif
+
+		default:
+		{
+			ErrorUnsupportedResultCompression(ResultCompressionName(compressionType));
+		}
+	}
+
+	if (compressedLength <= 0)
+	{
+		ereport(ERROR, (errmsg("could not compress intermediate result data using %s",
+							   ResultCompressionName(compressionType))));
+	}
+
+	uint32 frameHeader[2] = { pg_hton32(length), pg_hton32(compressedLength) };
+	memcpy_s(frame->data, RESULT_FRAME_HEADER_SIZE, frameHeader,
+			 RESULT_FRAME_HEADER_SIZE);
+
+	frame->len = RESULT_FRAME_HEADER_SIZE + compressedLength;
+	frame->data[frame->len] = '\0';
+}
+
+
+/*
+ * DecompressResultFrame decompresses the given frame and appends the result
+ * data to data.
+ */
+void
+DecompressResultFrame(ResultCompressionType compressionType, const char *frame,
+					  int frameLength, StringInfo data)
+{
+	uint32 frameHeader[2] = { 0, 0 };
+
+	if (frameLength < RESULT_FRAME_HEADER_SIZE)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DATA_CORRUPTED),
+						errmsg("compressed intermediate result frame is too short")));
+	}
+
+	memcpy_s(frameHeader, RESULT_FRAME_HEADER_SIZE, frame, RESULT_FRAME_HEADER_SIZE);
+
+	uint32 rawLength = pg_ntoh32(frameHeader[0]);
+	uint32 compressedLength = pg_ntoh32(frameHeader[1]);
+	const char *compressedData = frame + RESULT_FRAME_HEADER_SIZE;
+
+	if (compressedLength != (uint32) (frameLength - RESULT_FRAME_HEADER_SIZE) ||
+		rawLength > RESULT_COMPRESSION_FRAME_SIZE)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DATA_CORRUPTED),
+						errmsg("invalid compressed intermediate result frame")));
+	}
+
+	enlargeStringInfo(data, rawLength);
+
+	char *rawData = data->data + data->len;
+	bool decompressed = false;
+
+	switch (compressionType)
+	{
+#if HAVE_CITUS_LIBLZ4
+		case RESULT_COMPRESSION_LZ4:
+		{
+			int lz4Length = LZ4_decompress_safe(compressedData, rawData,
+												compressedLength, rawLength);
+			decompressed = (lz4Length == (int) rawLength);
+			break;
+		}
+#endif
+
+#if HAVE_LIBZSTD
+		case RESULT_COMPRESSION_ZSTD:
+		{
+			size_t zstdLength = ZSTD_decompress(rawData, rawLength, compressedData,
+												compressedLength);
+			decompressed = (!ZSTD_isError(zstdLength) && zstdLength == rawLength);
+			break;
+		}
+#endif
+
+		default:
+		{
+			ErrorUnsupportedResultCompression(ResultCompressionName(compressionType));
+		}
+	}
+
+	if (!decompressed)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DATA_CORRUPTED),
+						errmsg("could not decompress intermediate result data using %s",
+							   ResultCompressionName(compressionType))));
+	}
+
+	data->len += rawLength;
+	data->data[data->len] = '\0';
+}
+
+
+/*
+ * CompressedLengthBound returns the maximum length of the given number of
+ * bytes after compressing them.
+ */
+static int
+CompressedLengthBound(ResultCompressionType compressionType, int length)
+{
+	switch (compressionType)
+	{
+#if HAVE_CITUS_LIBLZ4
+		case RESULT_COMPRESSION_LZ4:
+		{
+			return LZ4_compressBound(length);
+		}
+#endif
+
+#if HAVE_LIBZSTD
+		case RESULT_COMPRESSION_ZSTD:
+		{
+			return (int) ZSTD_compressBound(length);
+		}
+#endif
+
+		default:
+		{
+			ErrorUnsupportedResultCompression(ResultCompressionName(compressionType));
+		}
+	}
+
+	/* keep the compiler quiet */
+	return 0;
+}
+
+
+/*
+ * ErrorUnsupportedResultCompression errors out for a compression that this
+ * build does not support.
+ */
+static void
+ErrorUnsupportedResultCompression(const char *compressionName)
+{
+	ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					errmsg("compression \"%s\" is not supported for intermediate "
+						   "results", compressionName),
+					errhint("Set citus.intermediate_result_compression to a "
+							"compression that all nodes support.")));
+}
@@ -0,0 +1,986 @@
+/*-------------------------------------------------------------------------
+ *
+ * router_proxy.c
+ *   Execution of read-only router queries through background workers that
+ *   share their worker connections across backends.
+ *
+ *   With many client connections on the coordinator, every backend needs its
+ *   own connections to the workers, which soon exhausts
+ *   citus.max_shared_pool_size and makes backends wait for each other. When
+ *   citus.router_proxy_workers is set, the maintenance daemon of each
+ *   database keeps that many router proxies running. A backend that executes
+ *   a read-only router query outside of a transaction block hands the shard
+ *   query to an idle router proxy instead of connecting to the worker itself.
+ *   The proxy runs the query over the connections that it keeps to the
+ *   workers, as the user of the backend, and streams the rows back over a
+ *   shared memory queue. The client connections therefore share
+ *   citus.router_proxy_workers connections per worker and user.
+ *
+ *   A proxy executes one query at a time. When no proxy is idle, the backend
+ *   executes the query itself, such that the proxies never add waiting time.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "libpq-fe.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+
+#include "access/xact.h"
+#include "libpq/pqformat.h"
+#include "postmaster/bgworker.h"
+#include "postmaster/interrupt.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/shmem.h"
+#include "tcop/tcopprot.h"
+#include "utils/memutils.h"
+
+#include "pg_version_compat.h"
+#include "pg_version_constants.h"
+
+#include "distributed/citus_safe_lib.h"
+#include "distributed/connection_management.h"
+#include "distributed/deparse_shard_query.h"
+#include "distributed/listutils.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/multi_explain.h"
+#include "distributed/remote_commands.h"
+#include "distributed/router_proxy.h"
+#include "distributed/transaction_management.h"
+
+
+/* keys and size of the shared memory of a request */
+#define ROUTER_PROXY_MAGIC 0x52505859
+#define ROUTER_PROXY_KEY_REQUEST 1
+#define ROUTER_PROXY_KEY_QUERY 2
+#define ROUTER_PROXY_KEY_QUEUE 3
+#define ROUTER_PROXY_QUEUE_SIZE (64 * 1024)
+
+/* types of the messages that a proxy sends to the backend */
+#define ROUTER_PROXY_MESSAGE_ROW 'D'
+#define ROUTER_PROXY_MESSAGE_COMPLETE 'C'
+#define ROUTER_PROXY_MESSAGE_ERROR 'E'
+
+/* interval in milliseconds at which a waiting backend checks its proxy */
+#define ROUTER_PROXY_ALIVE_CHECK_INTERVAL 1000
+
+
+/*
+ * RouterProxySlot describes a running router proxy in shared memory. The pid
+ * is 0 when the slot is free.
+ */
+typedef struct RouterProxySlot
+{
+	pid_t pid;
+	Oid databaseId;
+	Latch *latch;
+
+	/* request that the proxy executes, DSM_HANDLE_INVALID while it is idle */
+	dsm_handle requestHandle;
+} RouterProxySlot;
+
+
+typedef struct RouterProxySharedData
+{
+	int trancheId;
+	char *trancheName;
+	LWLock lock;
+
+	int slotCount;
+	RouterProxySlot slots[FLEXIBLE_ARRAY_MEMBER];
+} RouterProxySharedData;
+
+
+/* RouterProxyRequest is the fixed size part of the shared memory of a request */
+typedef struct RouterProxyRequest
+{
+	char nodeName[MAX_NODE_LENGTH];
+	int32 nodePort;
+	char userName[NAMEDATALEN];
+} RouterProxyRequest;
+
+
+/* GUC, number of router proxies per database */
+int RouterProxyWorkerCount = 0;
+
+
+static RouterProxySharedData *RouterProxyShared = NULL;
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+/* handles of the router proxies that the maintenance daemon started */
+static BackgroundWorkerHandle *RouterProxyHandles[MAX_ROUTER_PROXY_WORKERS];
+
+/* memory of the current request in a router proxy, survives aborts */
+static MemoryContext RouterProxyRequestContext = NULL;
+
+
+/* local function declarations */
+static int ClaimRouterProxy(dsm_handle requestHandle, pid_t *proxyPid);
+static bool RouterProxyAlive(int slotIndex, pid_t proxyPid);
+static void ReceiveRouterProxyResults(shm_mq_handle *queueHandle, int slotIndex,
+									  pid_t proxyPid, Task *task,
+									  ShardPlacement *placement,
+									  TupleDestination *tupleDest,
+									  TupleDesc tupleDescriptor);
+static BackgroundWorkerHandle * StartRouterProxyWorker(Oid extensionOwner);
+static int RegisterRouterProxy(void);
+static void RouterProxyShmemExit(int code, Datum arg);
+static dsm_handle PendingRouterProxyRequest(int slotIndex);
+static void FinishRouterProxyRequest(int slotIndex);
+static void ExecuteRouterProxyRequest(dsm_handle requestHandle);
+static void RunRouterProxyQuery(shm_mq_handle *queueHandle,
+								RouterProxyRequest *request, const char *queryString);
+static bool SendRouterProxyRow(shm_mq_handle *queueHandle, PGresult *result,
+							   StringInfo message);
+static void SendRouterProxyError(shm_mq_handle *queueHandle, int sqlerrcode,
+								 const char *errorMessage, const char *errorDetail,
+								 const char *errorHint);
+
+
+/*
+ * ShouldExecuteViaRouterProxy returns whether the given task list of the scan
+ * is a read-only router query that a router proxy can execute. The proxy
+ * connections are not part of the transaction of the backend, so we only
+ * consider statements outside of transaction blocks that did not open any
+ * connections yet.
+ */
+bool
+ShouldExecuteViaRouterProxy(CitusScanState *scanState, List *taskList,
+							ParamListInfo paramListInfo)
+{
+	DistributedPlan *distributedPlan = scanState->distributedPlan;
+	Job *job = distributedPlan->workerJob;
+
+	if (RouterProxyWorkerCount == 0)
+	{
+		return false;
+	}
+
+	if (distributedPlan->modLevel != ROW_MODIFY_READONLY ||
+		list_length(taskList) != 1 ||
+		distributedPlan->subPlanList != NIL ||
+		distributedPlan->combineQuery != NULL ||
+		distributedPlan->mergeSortedTaskResults ||
+		job->dependentJobList != NIL ||
+		RequestedForExplainAnalyze(scanState))
+	{
+		return false;
+	}
+
+	if (IsMultiStatementTransaction() || InCoordinatedTransaction())
+	{
+		return false;
+	}
+
+	Task *task = (Task *) linitial(taskList);
+	if (task->taskType != READ_TASK ||
+		list_length(task->taskPlacementList) != 1 ||
+		GetTaskQueryType(task) == TASK_QUERY_TEXT_LIST)
+	{
+		return false;
+	}
+
+	/* proxies only get the query string */
+	if (paramListInfo != NULL && !task->parametersInQueryStringResolved)
+	{
+		return false;
+	}
+
+	/* local placements do not need a connection in the first place */
+	ShardPlacement *placement = (ShardPlacement *) linitial(task->taskPlacementList);
+	if (placement->groupId == GetLocalGroupId())
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * ExecuteTaskViaRouterProxy hands the given task to an idle router proxy of
+ * the database and writes the rows that the proxy sends to the given tuple
+ * destination. It returns false without executing the task if no proxy is
+ * idle.
+ */
+bool
+ExecuteTaskViaRouterProxy(Task *task, TupleDestination *tupleDest,
+						  TupleDesc tupleDescriptor)
+{
+	ShardPlacement *placement = (ShardPlacement *) linitial(task->taskPlacementList);
+	const char *queryString = TaskQueryString(task);
+	Size queryLength = strlen(queryString) + 1;
+
+	shm_toc_estimator estimator;
+	shm_toc_initialize_estimator(&estimator);
+	shm_toc_estimate_chunk(&estimator, sizeof(RouterProxyRequest));
+	shm_toc_estimate_chunk(&estimator, queryLength);
+	shm_toc_estimate_chunk(&estimator, ROUTER_PROXY_QUEUE_SIZE);
+	shm_toc_estimate_keys(&estimator, 3);
+	Size segmentSize = shm_toc_estimate(&estimator);
+
+	dsm_segment *segment = dsm_create(segmentSize, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (segment == NULL)
+	{
+		return false;
+	}
+
+	shm_toc *toc = shm_toc_create(ROUTER_PROXY_MAGIC, dsm_segment_address(segment),
+								  segmentSize);
+
+	RouterProxyRequest *request = shm_toc_allocate(toc, sizeof(RouterProxyRequest));
+	strlcpy(request->nodeName, placement->nodeName, MAX_NODE_LENGTH);
+	request->nodePort = placement->nodePort;
+	strlcpy(request->userName, CurrentUserName(), NAMEDATALEN);
+	shm_toc_insert(toc, ROUTER_PROXY_KEY_REQUEST, request);
+
+	char *sharedQueryString = shm_toc_allocate(toc, queryLength);
+	strlcpy(sharedQueryString, queryString, queryLength);
+	shm_toc_insert(toc, ROUTER_PROXY_KEY_QUERY, sharedQueryString);
+
+	shm_mq *queue = shm_mq_create(shm_toc_allocate(toc, ROUTER_PROXY_QUEUE_SIZE),
+								  ROUTER_PROXY_QUEUE_SIZE);
+	shm_toc_insert(toc, ROUTER_PROXY_KEY_QUEUE, queue);
+	shm_mq_set_receiver(queue, MyProc);
+	shm_mq_handle *queueHandle = shm_mq_attach(queue, segment, NULL);
+
+	pid_t proxyPid = 0;
+	int slotIndex = ClaimRouterProxy(dsm_segment_handle(segment), &proxyPid);
+	if (slotIndex < 0)
+	{
+		dsm_detach(segment);
+		return false;
+	}
+
+	ReceiveRouterProxyResults(queueHandle, slotIndex, proxyPid, task, placement,
+							  tupleDest, tupleDescriptor);
+
+	dsm_detach(segment);
+
+	return true;
+}
+
+
+/*
+ * ClaimRouterProxy assigns the given request to an idle router proxy of the
+ * database and wakes it up. It returns the slot of the proxy, or -1 if no
+ * proxy is idle.
+ */
+static int
+ClaimRouterProxy(dsm_handle requestHandle, pid_t *proxyPid)
+{
+	Latch *proxyLatch = NULL;
+	int claimedSlotIndex = -1;
+
+	LWLockAcquire(&RouterProxyShared->lock, LW_EXCLUSIVE);
+
+	for (int slotIndex = 0; slotIndex < RouterProxyShared->slotCount; slotIndex++)
+	{
+		RouterProxySlot *slot = &RouterProxyShared->slots[slotIndex];
+
+		if (slot->pid != 0 && slot->databaseId == MyDatabaseId &&
+			slot->requestHandle == DSM_HANDLE_INVALID)
+		{
+			slot->requestHandle = requestHandle;
+
+			*proxyPid = slot->pid;
+			proxyLatch = slot->latch;
+			claimedSlotIndex = slotIndex;
+			break;
+		}
+	}
+
+	LWLockRelease(&RouterProxyShared->lock);
+
+	if (proxyLatch != NULL)
+	{
+		SetLatch(proxyLatch);
+	}
+
+	return claimedSlotIndex;
+}
+
+
+/*
+ * RouterProxyAlive returns whether the router proxy with the given pid still
+ * runs in the given slot.
+ */
+static bool
+RouterProxyAlive(int slotIndex, pid_t proxyPid)
+{
+	LWLockAcquire(&RouterProxyShared->lock, LW_SHARED);
+	bool proxyAlive = RouterProxyShared->slots[slotIndex].pid == proxyPid;
+	LWLockRelease(&RouterProxyShared->lock);
+
+	return proxyAlive;
+}
+
+
+/*
+ * ReceiveRouterProxyResults reads the messages that the router proxy sends
+ * for the given task until the query completes, and writes the rows to the
+ * tuple destination. Errors of the query are rethrown.
+ */
+static void
+ReceiveRouterProxyResults(shm_mq_handle *queueHandle, int slotIndex, pid_t proxyPid,
+						  Task *task, ShardPlacement *placement,
+						  TupleDestination *tupleDest, TupleDesc tupleDescriptor)
+{
+	AttInMetadata *attInMetadata = TupleDescGetAttInMetadata(tupleDescriptor);
+	int columnCount = tupleDescriptor->natts;
+	char **columnValues = palloc0(columnCount * sizeof(char *));
+
+	MemoryContext rowContext = AllocSetContextCreate(CurrentMemoryContext,
+													 "RouterProxyRowContext",
+													 ALLOCSET_DEFAULT_SIZES);
+
+	while (true)
+	{
+		Size messageLength = 0;
+		void *messageData = NULL;
+		bool noWait = true;
+
+		shm_mq_result result = shm_mq_receive(queueHandle, &messageLength,
+											  &messageData, noWait);
+		if (result == SHM_MQ_WOULD_BLOCK)
+		{
+			if (!RouterProxyAlive(slotIndex, proxyPid))
+			{
+				ereport(ERROR, (errmsg("router proxy exited before completing the "
+									   "query")));
+			}
+
+			(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+							 ROUTER_PROXY_ALIVE_CHECK_INTERVAL, PG_WAIT_EXTENSION);
+			ResetLatch(MyLatch);
+
+			CHECK_FOR_INTERRUPTS();
+			continue;
+		}
+		else if (result == SHM_MQ_DETACHED)
+		{
+			ereport(ERROR, (errmsg("router proxy exited before completing the query")));
+		}
+
+		StringInfoData message;
+		message.data = messageData;
+		message.len = messageLength;
+		message.maxlen = messageLength;
+		message.cursor = 0;
+
+		char messageType = pq_getmsgbyte(&message);
+		if (messageType == ROUTER_PROXY_MESSAGE_ROW)
+		{
+			MemoryContext oldContext = MemoryContextSwitchTo(rowContext);
+			uint64 tupleSize = 0;
+
+			if (pq_getmsgint(&message, 2) != columnCount)
+			{
+				ereport(ERROR, (errmsg("unexpected number of columns from router "
+									   "proxy")));
+			}
+
+			for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+			{
+				int valueLength = pq_getmsgint(&message, 4);
+				if (valueLength < 0)
+				{
+					columnValues[columnIndex] = NULL;
+					continue;
+				}
+
+				columnValues[columnIndex] =
+					pnstrdup(pq_getmsgbytes(&message, valueLength), valueLength);
+				tupleSize += valueLength;
+			}
+
+			HeapTuple heapTuple = BuildTupleFromCStrings(attInMetadata, columnValues);
+
+			MemoryContextSwitchTo(oldContext);
+
+			tupleDest->putTuple(tupleDest, task, 0, 0, heapTuple, tupleSize);
+
+			MemoryContextReset(rowContext);
+		}
+		else if (messageType == ROUTER_PROXY_MESSAGE_COMPLETE)
+		{
+			break;
+		}
+		else if (messageType == ROUTER_PROXY_MESSAGE_ERROR)
+		{
+			int sqlerrcode = pq_getmsgint(&message, 4);
+			const char *errorMessage = pq_getmsgrawstring(&message);
+			const char *errorDetail = pq_getmsgrawstring(&message);
+			const char *errorHint = pq_getmsgrawstring(&message);
+
+			ereport(ERROR, (errcode(sqlerrcode),
+							errmsg("%s", errorMessage),
+							errorDetail[0] != '\0' ? errdetail("%s", errorDetail) : 0,
+							errorHint[0] != '\0' ? errhint("%s", errorHint) : 0,
+							errcontext("while executing command on %s:%d",
+									   placement->nodeName, placement->nodePort)));
+		}
+		else
+		{
+			ereport(ERROR, (errmsg("unexpected message type %d from router proxy",
+								   messageType)));
+		}
+	}
+
+	MemoryContextDelete(rowContext);
+}
+
+
+/*
+ * MaintainRouterProxyWorkers is called by the maintenance daemon to keep
+ * citus.router_proxy_workers router proxies running for its database, and to
+ * stop the proxies beyond that number.
+ */
+void
+MaintainRouterProxyWorkers(Oid extensionOwner)
+{
+	for (int proxyIndex = 0; proxyIndex < MAX_ROUTER_PROXY_WORKERS; proxyIndex++)
+	{
+		BackgroundWorkerHandle *handle = RouterProxyHandles[proxyIndex];
+		pid_t proxyPid = 0;
+		bool proxyRunning = handle != NULL &&
+							GetBackgroundWorkerPid(handle, &proxyPid) != BGWH_STOPPED;
+
+		if (proxyRunning)
+		{
+			if (proxyIndex >= RouterProxyWorkerCount)
+			{
+				TerminateBackgroundWorker(handle);
+			}
+
+			continue;
+		}
+
+		if (handle != NULL)
+		{
+			pfree(handle);
+			RouterProxyHandles[proxyIndex] = NULL;
+		}
+
+		if (proxyIndex < RouterProxyWorkerCount)
+		{
+			RouterProxyHandles[proxyIndex] = StartRouterProxyWorker(extensionOwner);
+		}
+	}
+}
+
+
+/*
+ * StopRouterProxyWorkers stops the router proxies that the maintenance daemon
+ * started, when the maintenance daemon exits.
+ */
+void
+StopRouterProxyWorkers(void)
+{
+	for (int proxyIndex = 0; proxyIndex < MAX_ROUTER_PROXY_WORKERS; proxyIndex++)
+	{
+		if (RouterProxyHandles[proxyIndex] != NULL)
+		{
+			TerminateBackgroundWorker(RouterProxyHandles[proxyIndex]);
+		}
+	}
+}
+
+
+/*
+ * StartRouterProxyWorker registers a router proxy for the current database
+ * that connects as the extension owner, and returns its handle or NULL if no
+ * background worker slot is available.
+ */
+static BackgroundWorkerHandle *
+StartRouterProxyWorker(Oid extensionOwner)
+{
+	BackgroundWorker worker;
+	BackgroundWorkerHandle *handle = NULL;
+
+	memset(&worker, 0, sizeof(worker));
+	SafeSnprintf(worker.bgw_name, BGW_MAXLEN, "Citus Router Proxy: %u/%u",
+				 MyDatabaseId, extensionOwner);
+	SafeSnprintf(worker.bgw_type, BGW_MAXLEN, "Citus Router Proxy");
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+
+	/* the maintenance daemon restarts proxies that exit */
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	strcpy_s(worker.bgw_library_name, sizeof(worker.bgw_library_name), "citus");
+	strcpy_s(worker.bgw_function_name, sizeof(worker.bgw_function_name),
+			 "RouterProxyWorkerMain");
+	worker.bgw_main_arg = ObjectIdGetDatum(MyDatabaseId);
+	memcpy_s(worker.bgw_extra, sizeof(worker.bgw_extra), &extensionOwner,
+			 sizeof(Oid));
+	worker.bgw_notify_pid = MyProcPid;
+
+	MemoryContext oldContext = MemoryContextSwitchTo(TopMemoryContext);
+	bool registered = RegisterDynamicBackgroundWorker(&worker, &handle);
+	MemoryContextSwitchTo(oldContext);
+
+	return registered ? handle : NULL;
+}
+
+
+/*
+ * RouterProxyWorkerMain is the main function of a router proxy. It waits for
+ * backends to assign requests to its slot and executes them one at a time.
+ */
+void
+RouterProxyWorkerMain(Datum mainArg)
+{
+	Oid databaseId = DatumGetObjectId(mainArg);
+	Oid extensionOwner = InvalidOid;
+
+	memcpy_s(&extensionOwner, sizeof(Oid), MyBgworkerEntry->bgw_extra, sizeof(Oid));
+
+	pqsignal(SIGTERM, die);
+	pqsignal(SIGHUP, SignalHandlerForConfigReload);
+	BackgroundWorkerUnblockSignals();
+
+	BackgroundWorkerInitializeConnectionByOid(databaseId, extensionOwner, 0);
+
+	int slotIndex = RegisterRouterProxy();
+	if (slotIndex < 0)
+	{
+		ereport(LOG, (errmsg("no free slot for a router proxy of database %u",
+							 databaseId)));
+		proc_exit(0);
+	}
+
+	on_shmem_exit(RouterProxyShmemExit, Int32GetDatum(slotIndex));
+
+	RouterProxyRequestContext = AllocSetContextCreate(TopMemoryContext,
+													  "Router Proxy Request",
+													  ALLOCSET_DEFAULT_SIZES);
+
+	while (true)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (ConfigReloadPending)
+		{
+			ConfigReloadPending = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		dsm_handle requestHandle = PendingRouterProxyRequest(slotIndex);
+		if (requestHandle != DSM_HANDLE_INVALID)
+		{
+			MemoryContext oldContext = MemoryContextSwitchTo(RouterProxyRequestContext);
+
+			ExecuteRouterProxyRequest(requestHandle);
+
+			MemoryContextSwitchTo(oldContext);
+			MemoryContextReset(RouterProxyRequestContext);
+
+			FinishRouterProxyRequest(slotIndex);
+			continue;
+		}
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+						 PG_WAIT_EXTENSION);
+		ResetLatch(MyLatch);
+	}
+}
+
+
+/*
+ * RegisterRouterProxy takes a free slot for the current process and returns
+ * its index, or -1 if all slots are taken.
+ */
+static int
+RegisterRouterProxy(void)
+{
+	int registeredSlotIndex = -1;
+
+	LWLockAcquire(&RouterProxyShared->lock, LW_EXCLUSIVE);
+
+	for (int slotIndex = 0; slotIndex < RouterProxyShared->slotCount; slotIndex++)
+	{
+		RouterProxySlot *slot = &RouterProxyShared->slots[slotIndex];
+
+		if (slot->pid == 0)
+		{
+			slot->pid = MyProcPid;
+			slot->databaseId = MyDatabaseId;
+			slot->latch = MyLatch;
+			slot->requestHandle = DSM_HANDLE_INVALID;
+
+			registeredSlotIndex = slotIndex;
+			break;
+		}
+	}
+
+	LWLockRelease(&RouterProxyShared->lock);
+
+	return registeredSlotIndex;
+}
+
+
+/*
+ * RouterProxyShmemExit frees the slot of an exiting router proxy. Backends
+ * that wait for its results notice that the pid of the slot changed.
+ */
+static void
+RouterProxyShmemExit(int code, Datum arg)
+{
+	int slotIndex = DatumGetInt32(arg);
+
+	LWLockAcquire(&RouterProxyShared->lock, LW_EXCLUSIVE);
+
+	RouterProxySlot *slot = &RouterProxyShared->slots[slotIndex];
+	if (slot->pid == MyProcPid)
+	{
+		slot->pid = 0;
+		slot->databaseId = InvalidOid;
+		slot->latch = NULL;
+		slot->requestHandle = DSM_HANDLE_INVALID;
+	}
+
+	LWLockRelease(&RouterProxyShared->lock);
+}
+
+
+/*
+ * PendingRouterProxyRequest returns the request that a backend assigned to
+ * the given slot, or DSM_HANDLE_INVALID.
+ */
+static dsm_handle
+PendingRouterProxyRequest(int slotIndex)
+{
+	LWLockAcquire(&RouterProxyShared->lock, LW_SHARED);
+	dsm_handle requestHandle = RouterProxyShared->slots[slotIndex].requestHandle;
+	LWLockRelease(&RouterProxyShared->lock);
+
+	return requestHandle;
+}
+
+
+/*
+ * FinishRouterProxyRequest marks the router proxy of the given slot as idle.
+ */
+static void
+FinishRouterProxyRequest(int slotIndex)
+{
+	LWLockAcquire(&RouterProxyShared->lock, LW_EXCLUSIVE);
+	RouterProxyShared->slots[slotIndex].requestHandle = DSM_HANDLE_INVALID;
+	LWLockRelease(&RouterProxyShared->lock);
+}
+
+
+/*
+ * ExecuteRouterProxyRequest executes the request in the given shared memory
+ * segment and sends the results, or the error, to the backend. The segment
+ * is mapped outside of a transaction, such that it stays mapped when the
+ * transaction of the query aborts.
+ */
+static void
+ExecuteRouterProxyRequest(dsm_handle requestHandle)
+{
+	dsm_segment *segment = dsm_attach(requestHandle);
+	if (segment == NULL)
+	{
+		/* the backend already gave up on the request */
+		return;
+	}
+
+	shm_toc *toc = shm_toc_attach(ROUTER_PROXY_MAGIC, dsm_segment_address(segment));
+	if (toc == NULL)
+	{
+		dsm_detach(segment);
+		return;
+	}
+
+	RouterProxyRequest *request = shm_toc_lookup(toc, ROUTER_PROXY_KEY_REQUEST, false);
+	char *queryString = shm_toc_lookup(toc, ROUTER_PROXY_KEY_QUERY, false);
+	shm_mq *queue = shm_toc_lookup(toc, ROUTER_PROXY_KEY_QUEUE, false);
+
+	shm_mq_set_sender(queue, MyProc);
+	shm_mq_handle *queueHandle = shm_mq_attach(queue, segment, NULL);
+
+	PG_TRY();
+	{
+		StartTransactionCommand();
+
+		RunRouterProxyQuery(queueHandle, request, queryString);
+
+		CommitTransactionCommand();
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(RouterProxyRequestContext);
+
+		ErrorData *errorData = CopyErrorData();
+		FlushErrorState();
+
+		AbortCurrentTransaction();
+
+		SendRouterProxyError(queueHandle, errorData->sqlerrcode, errorData->message,
+							 errorData->detail, errorData->hint);
+	}
+	PG_END_TRY();
+
+	dsm_detach(segment);
+}
+
+
+/*
+ * RunRouterProxyQuery runs the given query on the node of the request as the
+ * user of the request, and streams the rows to the backend. When the backend
+ * goes away, the query is cancelled.
+ */
+static void
+RunRouterProxyQuery(shm_mq_handle *queueHandle, RouterProxyRequest *request,
+					const char *queryString)
+{
+	int connectionFlags = 0;
+	MultiConnection *connection =
+		GetNodeUserDatabaseConnection(connectionFlags, request->nodeName,
+									  request->nodePort, request->userName, NULL);
+	if (PQstatus(connection->pgConn) != CONNECTION_OK)
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
+	if (!SendRemoteCommand(connection, queryString))
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
+	/* stream the rows instead of collecting the whole result in the proxy */
+	(void) PQsetSingleRowMode(connection->pgConn);
+
+	StringInfo message = makeStringInfo();
+	PGresult *errorResult = NULL;
+	bool backendDetached = false;
+	bool raiseInterrupts = true;
+
+	PGresult *result = NULL;
+	while ((result = GetRemoteCommandResult(connection, raiseInterrupts)) != NULL)
+	{
+		ExecStatusType resultStatus = PQresultStatus(result);
+
+		if (!IsResponseOK(result))
+		{
+			if (errorResult == NULL)
+			{
+				errorResult = result;
+				continue;
+			}
+		}
+		else if (!backendDetached && PQntuples(result) > 0)
+		{
+			Assert(resultStatus == PGRES_SINGLE_TUPLE ||
+				   resultStatus == PGRES_TUPLES_OK);
+
+			if (!SendRouterProxyRow(queueHandle, result, message))
+			{
+				/* no one waits for the rows anymore */
+				backendDetached = true;
+				SendCancelationRequest(connection);
+			}
+		}
+
+		PQclear(result);
+	}
+
+	if (errorResult != NULL)
+	{
+		char *errorMessage = PQresultErrorField(errorResult, PG_DIAG_MESSAGE_PRIMARY);
+		char *errorDetail = PQresultErrorField(errorResult, PG_DIAG_MESSAGE_DETAIL);
+		char *errorHint = PQresultErrorField(errorResult, PG_DIAG_MESSAGE_HINT);
+		char *sqlStateString = PQresultErrorField(errorResult, PG_DIAG_SQLSTATE);
+		int sqlerrcode = ERRCODE_CONNECTION_FAILURE;
+
+		if (sqlStateString != NULL)
+		{
+			sqlerrcode = MAKE_SQLSTATE(sqlStateString[0], sqlStateString[1],
+									   sqlStateString[2], sqlStateString[3],
+									   sqlStateString[4]);
+		}
+
+		if (errorMessage == NULL)
+		{
+			errorMessage = pchomp(PQerrorMessage(connection->pgConn));
+		}
+
+		if (!backendDetached)
+		{
+			SendRouterProxyError(queueHandle, sqlerrcode, errorMessage, errorDetail,
+								 errorHint);
+		}
+
+		PQclear(errorResult);
+		return;
+	}
+
+	if (!backendDetached)
+	{
+		char messageType = ROUTER_PROXY_MESSAGE_COMPLETE;
+
+		(void) shm_mq_send_compat(queueHandle, sizeof(char), &messageType, false,
+								  true);
+	}
+}
+
+
+/*
+ * SendRouterProxyRow sends the rows of the given result to the backend, and
+ * returns false if the backend detached from the queue.
+ */
+static bool
+SendRouterProxyRow(shm_mq_handle *queueHandle, PGresult *result, StringInfo message)
+{
+	int rowCount = PQntuples(result);
+	int columnCount = PQnfields(result);
+
+	for (int rowIndex = 0; rowIndex < rowCount; rowIndex++)
+	{
+		resetStringInfo(message);
+		pq_sendbyte(message, ROUTER_PROXY_MESSAGE_ROW);
+		pq_sendint16(message, columnCount);
+
+		for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+		{
+			if (PQgetisnull(result, rowIndex, columnIndex))
+			{
+				pq_sendint32(message, -1);
+				continue;
+			}
+
+			int valueLength = PQgetlength(result, rowIndex, columnIndex);
+
+			pq_sendint32(message, valueLength);
+			appendBinaryStringInfo(message, PQgetvalue(result, rowIndex, columnIndex),
+								   valueLength);
+		}
+
+		shm_mq_result sendResult = shm_mq_send_compat(queueHandle, message->len,
+													  message->data, false, true);
+		if (sendResult != SHM_MQ_SUCCESS)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * SendRouterProxyError sends the given error to the backend, which rethrows
+ * it.
+ */
+static void
+SendRouterProxyError(shm_mq_handle *queueHandle, int sqlerrcode,
+					 const char *errorMessage, const char *errorDetail,
+					 const char *errorHint)
+{
+	StringInfoData message;
+	initStringInfo(&message);
+
+	pq_sendbyte(&message, ROUTER_PROXY_MESSAGE_ERROR);
+	pq_sendint32(&message, sqlerrcode);
+	appendStringInfoString(&message, errorMessage != NULL ? errorMessage : "");
+	appendStringInfoChar(&message, '\0');
+	appendStringInfoString(&message, errorDetail != NULL ? errorDetail : "");
+	appendStringInfoChar(&message, '\0');
+	appendStringInfoString(&message, errorHint != NULL ? errorHint : "");
+	appendStringInfoChar(&message, '\0');
+
+	(void) shm_mq_send_compat(queueHandle, message.len, message.data, false, true);
+
+	pfree(message.data);
+}
+
+
+/*
+ * InitializeRouterProxy requests the necessary shared memory from Postgres
+ * and sets up the shared memory startup hook.
+ */
+void
+InitializeRouterProxy(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(RouterProxyShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = RouterProxyShmemInit;
+}
+
+
+/*
+ * RouterProxyShmemSize returns the size of the router proxy slots. There
+ * cannot be more proxies than background workers.
+ */
+size_t
+RouterProxyShmemSize(void)
+{
+	Size size = offsetof(RouterProxySharedData, slots);
+
+	size = add_size(size, mul_size(max_worker_processes, sizeof(RouterProxySlot)));
+
+	return size;
+}
+
+
+/*
+ * RouterProxyShmemInit initializes the router proxy slots in shared memory.
+ */
+void
+RouterProxyShmemInit(void)
+{
+	bool alreadyInitialized = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	RouterProxyShared = (RouterProxySharedData *) ShmemInitStruct("Router Proxy Data",
+																  RouterProxyShmemSize(),
+																  &alreadyInitialized);
+
+	if (!alreadyInitialized)
+	{
+		RouterProxyShared->trancheId = LWLockNewTrancheId();
+		RouterProxyShared->trancheName = "Router Proxy Tranche";
+		LWLockRegisterTranche(RouterProxyShared->trancheId,
+							  RouterProxyShared->trancheName);
+		LWLockInitialize(&RouterProxyShared->lock, RouterProxyShared->trancheId);
+
+		RouterProxyShared->slotCount = max_worker_processes;
+		for (int slotIndex = 0; slotIndex < max_worker_processes; slotIndex++)
+		{
+			RouterProxySlot *slot = &RouterProxyShared->slots[slotIndex];
+
+			slot->pid = 0;
+			slot->databaseId = InvalidOid;
+			slot->latch = NULL;
+			slot->requestHandle = DSM_HANDLE_INVALID;
+		}
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
@@ -10,17 +10,27 @@
 
 #include "postgres.h"
 
+#include "fmgr.h"
+
+#include "access/xact.h"
 #include "executor/executor.h"
+#include "miscadmin.h"
 #include "utils/datetime.h"
+#include "utils/memutils.h"
 
+#include "distributed/citus_custom_scan.h"
+#include "distributed/distributed_planner.h"
 #include "distributed/intermediate_result_pruning.h"
 #include "distributed/intermediate_results.h"
 #include "distributed/listutils.h"
+#include "distributed/metadata_cache.h"
 #include "distributed/multi_executor.h"
 #include "distributed/multi_physical_planner.h"
 #include "distributed/recursive_planning.h"
+#include "distributed/shardinterval_utils.h"
 #include "distributed/subplan_execution.h"
 #include "distributed/transaction_management.h"
+#include "distributed/tuple_destination.h"
 #include "distributed/worker_manager.h"
 
 #define SECOND_TO_MILLI_SECOND 1000
@@ -30,6 +40,137 @@ int MaxIntermediateResult = 1048576; /* maximum size in KB the intermediate resu
 /* when this is true, we enforce intermediate result size limit in all executors */
 int SubPlanLevel = 0;
 
+/* GUC, whether the tasks of independent subplans run in a single execution */
+bool EnableParallelSubPlanExecution = false;
+
+/* GUC, whether subplans reuse the results of earlier subplans with the same query */
+bool EnableSubPlanResultReuse = false;
+
+
+/*
+ * ReusableSubPlanResult is an intermediate result that a subplan wrote in
+ * the current transaction, and that later subplans with the same query can
+ * reuse instead of executing the query again, until one of the tables that
+ * the query reads is modified.
+ */
+typedef struct ReusableSubPlanResult
+{
+	char *resultId;
+
+	/* the nodes that received the result, as in IntermediateResultsHashEntry */
+	List *nodeIdList;
+	bool writeLocalFile;
+
+	List *relationIdList;
+} ReusableSubPlanResult;
+
+/* results that later subplans can reuse, allocated in the TopTransactionContext */
+static List *ReusableSubPlanResultList = NIL;
+
+
+/*
+ * PrefetchedSubPlanResult holds the rows that the tasks of a subplan returned
+ * when they ran along with the tasks of other subplans, until the Citus scan
+ * of the subplan picks them up.
+ */
+typedef struct PrefetchedSubPlanResult
+{
+	/* planId of the distributed plan of the subplan */
+	uint64 planId;
+
+	Tuplestorestate *tupleStore;
+} PrefetchedSubPlanResult;
+
+/* results of the subplans of the current ExecuteSubPlans that ran in advance */
+static List *PrefetchedSubPlanResultList = NIL;
+
+
+/*
+ * TaskPruningDestReceiver passes the rows of a subplan to the receiver that
+ * writes the intermediate result, and records the shards of the table that
+ * the first column of the rows hash to.
+ */
+typedef struct TaskPruningDestReceiver
+{
+	/* public DestReceiver interface */
+	DestReceiver pub;
+
+	/* receiver that writes the intermediate result */
+	DestReceiver *resultDest;
+
+	CitusTableCacheEntry *cacheEntry;
+	Oid partitionColumnCollation;
+
+	/* whether any row hashed to the shard, indexed by shard index */
+	bool *shardMatched;
+	int matchedShardCount;
+
+	/* IDs of the shards that any row hashed to, set when the receiver shuts down */
+	List *matchedShardIdList;
+} TaskPruningDestReceiver;
+
+
+/*
+ * ResultSlicingDestReceiver passes each row of a subplan only to the receivers
+ * that write the intermediate result to the nodes whose tasks access the shard
+ * of the table that a column of the row hashes to, and all rows to the
+ * receiver that writes the local file, if any.
+ */
+typedef struct ResultSlicingDestReceiver
+{
+	/* public DestReceiver interface */
+	DestReceiver pub;
+
+	CitusTableCacheEntry *cacheEntry;
+	Oid partitionColumnCollation;
+	AttrNumber attributeNumber;
+
+	/* receivers that write the result to a single node each */
+	List *nodeDestList;
+
+	/* receiver that writes the local file, or NULL */
+	DestReceiver *localDest;
+
+	/* receivers that the rows of a shard are passed to, indexed by shard index */
+	List **shardDestLists;
+} ResultSlicingDestReceiver;
+
+
+static List * ExecuteSubPlansInternal(DistributedPlan *distributedPlan,
+									  bool pruneTasks);
+static List * ExecuteSubPlanList(uint64 planId, List *subPlanList, List *taskList,
+								 HTAB *intermediateResultsHash, bool pruneTasks);
+static void PrefetchIndependentSubPlanResults(List *subPlanList,
+											  HTAB *intermediateResultsHash,
+											  bool pruneTasks);
+static bool SubPlanResultIsReusable(DistributedSubPlan *subPlan,
+									HTAB *intermediateResultsHash, bool pruneTasks);
+static void RememberReusableSubPlanResult(DistributedSubPlan *subPlan,
+										  IntermediateResultsHashEntry *entry);
+static void ForgetReusableSubPlanResult(char *resultId);
+static bool SubPlanListIsReadOnly(List *subPlanList);
+static CustomScan * PrefetchableSubPlanScan(DistributedSubPlan *subPlan);
+static DestReceiver * CreateTaskPruningDestReceiver(DestReceiver *resultDest,
+													Oid relationId);
+static void TaskPruningDestReceiverStartup(DestReceiver *dest, int operation,
+										   TupleDesc inputTupleDescriptor);
+static bool TaskPruningDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest);
+static void TaskPruningDestReceiverShutdown(DestReceiver *dest);
+static void TaskPruningDestReceiverDestroy(DestReceiver *dest);
+static List * PruneTaskListByMatchedShards(List *taskList, List *pruningDestList);
+static bool TaskMatchesShards(Task *task, TaskPruningDestReceiver *pruningDest);
+static DestReceiver * CreateResultSlicingDestReceiver(char *resultId, EState *estate,
+													  List *remoteWorkerNodeList,
+													  bool writeLocalFile,
+													  DistributedSubPlan *subPlan,
+													  List *taskList);
+static void ResultSlicingDestReceiverStartup(DestReceiver *dest, int operation,
+											 TupleDesc inputTupleDescriptor);
+static bool ResultSlicingDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest);
+static void ResultSlicingDestReceiverShutdown(DestReceiver *dest);
+static void ResultSlicingDestReceiverDestroy(DestReceiver *dest);
+static uint64 ResultSlicingDestReceiverBytesSent(DestReceiver *dest);
+
 
 /*
  * ExecuteSubPlans executes a list of subplans from a distributed plan
@@ -37,14 +178,51 @@ int SubPlanLevel = 0;
  */
 void
 ExecuteSubPlans(DistributedPlan *distributedPlan)
+{
+	bool pruneTasks = false;
+
+	ExecuteSubPlansInternal(distributedPlan, pruneTasks);
+}
+
+
+/*
+ * ExecuteSubPlansAndPruneTasks executes the subplans of a distributed plan
+ * like ExecuteSubPlans, and returns the tasks of the worker job that remain
+ * after skipping the tasks on shards that cannot match the results of the
+ * subplans marked by MarkSubPlansForTaskPruning. If no subplan is marked, or
+ * no task can be skipped, it returns NIL.
+ */
+List *
+ExecuteSubPlansAndPruneTasks(DistributedPlan *distributedPlan)
+{
+	bool pruneTasks = EnableSubPlanTaskPruning &&
+					  distributedPlan->workerJob != NULL;
+
+	return ExecuteSubPlansInternal(distributedPlan, pruneTasks);
+}
+
+
+/*
+ * ExecuteSubPlansInternal executes the subplans and, if pruneTasks is true,
+ * returns the pruned task list of the worker job, or NIL.
+ */
+static List *
+ExecuteSubPlansInternal(DistributedPlan *distributedPlan, bool pruneTasks)
 {
 	uint64 planId = distributedPlan->planId;
 	List *subPlanList = distributedPlan->subPlanList;
+	List *taskList = NIL;
+	List *pruningDestList = NIL;
 
 	if (subPlanList == NIL)
 	{
 		/* no subplans to execute */
-		return;
+		return NIL;
+	}
+
+	if (distributedPlan->workerJob != NULL)
+	{
+		taskList = distributedPlan->workerJob->taskList;
 	}
 
 	HTAB *intermediateResultsHash = MakeIntermediateResultHTAB();
@@ -58,28 +236,119 @@ ExecuteSubPlans(DistributedPlan *distributedPlan)
 	 */
 	UseCoordinatedTransaction();
 
+	/* subplans may (indirectly) run other queries with subplans */
+	List *outerPrefetchedSubPlanResultList = PrefetchedSubPlanResultList;
+	PrefetchedSubPlanResultList = NIL;
+
+	PG_TRY();
+	{
+		if (EnableParallelSubPlanExecution)
+		{
+			PrefetchIndependentSubPlanResults(subPlanList, intermediateResultsHash,
+											  pruneTasks);
+		}
+
+		pruningDestList = ExecuteSubPlanList(planId, subPlanList, taskList,
+											 intermediateResultsHash, pruneTasks);
+	}
+	PG_CATCH();
+	{
+		/* the prefetched results are freed along with the failed execution */
+		PrefetchedSubPlanResultList = outerPrefetchedSubPlanResultList;
+
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	PrefetchedSubPlanResultList = outerPrefetchedSubPlanResultList;
+
+	if (pruningDestList == NIL)
+	{
+		return NIL;
+	}
+
+	return PruneTaskListByMatchedShards(distributedPlan->workerJob->taskList,
+										pruningDestList);
+}
+
+
+/*
+ * ExecuteSubPlanList executes the subplans in order, writing their results
+ * into intermediate results, and returns the task pruning receivers of the
+ * subplans that are marked for task pruning if pruneTasks is true. The results
+ * of subplans that are marked for result slicing are split across the nodes
+ * of the given tasks of the distributed plan.
+ */
+static List *
+ExecuteSubPlanList(uint64 planId, List *subPlanList, List *taskList,
+				   HTAB *intermediateResultsHash, bool pruneTasks)
+{
+	List *pruningDestList = NIL;
+
 	DistributedSubPlan *subPlan = NULL;
 	foreach_ptr(subPlan, subPlanList)
 	{
 		PlannedStmt *plannedStmt = subPlan->plan;
-		uint32 subPlanId = subPlan->subPlanId;
 		ParamListInfo params = NULL;
-		char *resultId = GenerateResultId(planId, subPlanId);
+		char *resultId = SubPlanResultId(planId, subPlan);
+
+		if (SubPlanResultIsReusable(subPlan, intermediateResultsHash, pruneTasks))
+		{
+			ereport(DEBUG1, (errmsg("reusing intermediate result %s of an earlier "
+									"subplan", resultId)));
+
+			subPlan->durationMillisecs = 0;
+			subPlan->bytesSentPerWorker = 0;
+			subPlan->remoteWorkerCount = 0;
+			subPlan->writeLocalFile = false;
+
+			continue;
+		}
+
 		List *remoteWorkerNodeList =
 			FindAllWorkerNodesUsingSubplan(intermediateResultsHash, resultId);
 
 		IntermediateResultsHashEntry *entry =
 			SearchIntermediateResult(intermediateResultsHash, resultId);
 
+		/* the result is about to be overwritten */
+		ForgetReusableSubPlanResult(resultId);
+
 		SubPlanLevel++;
 		EState *estate = CreateExecutorState();
-		DestReceiver *copyDest =
-			CreateRemoteFileDestReceiver(resultId, estate, remoteWorkerNodeList,
-										 entry->writeLocalFile);
+		DestReceiver *copyDest = NULL;
+
+		/* other queries that use the result need all of its rows */
+		if (EnableSubPlanResultSlicing &&
+			OidIsValid(subPlan->resultSlicingRelationId) &&
+			entry->remoteAccessCount == 1 && list_length(remoteWorkerNodeList) > 1)
+		{
+			copyDest = CreateResultSlicingDestReceiver(resultId, estate,
+													   remoteWorkerNodeList,
+													   entry->writeLocalFile, subPlan,
+													   taskList);
+		}
+
+		bool resultSliced = copyDest != NULL;
+		if (!resultSliced)
+		{
+			copyDest = CreateRemoteFileDestReceiver(resultId, estate,
+													remoteWorkerNodeList,
+													entry->writeLocalFile);
+		}
+
+		DestReceiver *subPlanDest = copyDest;
+
+		if (pruneTasks && OidIsValid(subPlan->taskPruningRelationId))
+		{
+			subPlanDest = CreateTaskPruningDestReceiver(copyDest,
+														subPlan->taskPruningRelationId);
+			pruningDestList = lappend(pruningDestList, subPlanDest);
+		}
 
 		TimestampTz startTimestamp = GetCurrentTimestamp();
 
-		ExecutePlanIntoDestReceiver(plannedStmt, params, copyDest);
+		ExecutePlanIntoDestReceiver(plannedStmt, params, subPlanDest);
 
 		/*
 		 * EXPLAIN ANALYZE instrumentations. Calculating these are very light-weight,
@@ -93,11 +362,868 @@ ExecuteSubPlans(DistributedPlan *distributedPlan)
 		subPlan->durationMillisecs = durationSeconds * SECOND_TO_MILLI_SECOND;
 		subPlan->durationMillisecs += durationMicrosecs * MICRO_TO_MILLI_SECOND;
 
-		subPlan->bytesSentPerWorker = RemoteFileDestReceiverBytesSent(copyDest);
+		if (resultSliced)
+		{
+			subPlan->bytesSentPerWorker = ResultSlicingDestReceiverBytesSent(copyDest);
+		}
+		else
+		{
+			subPlan->bytesSentPerWorker = RemoteFileDestReceiverBytesSent(copyDest);
+		}
+
 		subPlan->remoteWorkerCount = list_length(remoteWorkerNodeList);
 		subPlan->writeLocalFile = entry->writeLocalFile;
 
 		SubPlanLevel--;
 		FreeExecutorState(estate);
+
+		/* a later subplan may need the rows that were not sent to the nodes */
+		if (!resultSliced)
+		{
+			RememberReusableSubPlanResult(subPlan, entry);
+		}
+	}
+
+	return pruningDestList;
+}
+
+
+/*
+ * SubPlanResultIsReusable returns whether an earlier subplan in the current
+ * transaction already wrote the result of the given subplan to all the nodes
+ * that need it, and none of the tables that it read was modified since.
+ */
+static bool
+SubPlanResultIsReusable(DistributedSubPlan *subPlan, HTAB *intermediateResultsHash,
+						bool pruneTasks)
+{
+	char *resultId = subPlan->reusableResultId;
+
+	if (!EnableSubPlanResultReuse || resultId == NULL)
+	{
+		return false;
+	}
+
+	/* task pruning needs the rows of the subplan */
+	if (pruneTasks && OidIsValid(subPlan->taskPruningRelationId))
+	{
+		return false;
+	}
+
+	IntermediateResultsHashEntry *entry =
+		SearchIntermediateResult(intermediateResultsHash, resultId);
+
+	ReusableSubPlanResult *reusableResult = NULL;
+	foreach_ptr(reusableResult, ReusableSubPlanResultList)
+	{
+		if (strcmp(reusableResult->resultId, resultId) != 0)
+		{
+			continue;
+		}
+
+		if (entry->writeLocalFile && !reusableResult->writeLocalFile)
+		{
+			return false;
+		}
+
+		int nodeId = 0;
+		foreach_int(nodeId, entry->nodeIdList)
+		{
+			if (!list_member_int(reusableResult->nodeIdList, nodeId))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+
+/*
+ * RememberReusableSubPlanResult remembers the intermediate result that the
+ * given subplan wrote to the nodes in the given entry, such that later
+ * subplans with the same query in the current transaction can reuse it.
+ *
+ * In read committed transactions, every statement sees the modifications
+ * that other transactions committed in the meantime, which a reused result
+ * would miss. We therefore only reuse results in transactions that use a
+ * single snapshot. We also only notice modifications of Citus tables.
+ */
+static void
+RememberReusableSubPlanResult(DistributedSubPlan *subPlan,
+							  IntermediateResultsHashEntry *entry)
+{
+	if (!EnableSubPlanResultReuse || subPlan->reusableResultId == NULL ||
+		!IsolationUsesXactSnapshot())
+	{
+		return;
+	}
+
+	Oid relationId = InvalidOid;
+	foreach_oid(relationId, subPlan->relationIdList)
+	{
+		if (!IsCitusTable(relationId))
+		{
+			return;
+		}
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(TopTransactionContext);
+
+	ReusableSubPlanResult *reusableResult = palloc0(sizeof(ReusableSubPlanResult));
+	reusableResult->resultId = pstrdup(subPlan->reusableResultId);
+	reusableResult->nodeIdList = list_copy(entry->nodeIdList);
+	reusableResult->writeLocalFile = entry->writeLocalFile;
+	reusableResult->relationIdList = list_copy(subPlan->relationIdList);
+
+	ReusableSubPlanResultList = lappend(ReusableSubPlanResultList, reusableResult);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * ForgetReusableSubPlanResult forgets the reusable result with the given ID.
+ */
+static void
+ForgetReusableSubPlanResult(char *resultId)
+{
+	ListCell *resultCell = NULL;
+	foreach(resultCell, ReusableSubPlanResultList)
+	{
+		ReusableSubPlanResult *reusableResult = lfirst(resultCell);
+
+		if (strcmp(reusableResult->resultId, resultId) == 0)
+		{
+			ReusableSubPlanResultList =
+				foreach_delete_current(ReusableSubPlanResultList, resultCell);
+		}
+	}
+}
+
+
+/*
+ * InvalidateReusableSubPlanResults forgets the reusable results that read the
+ * given table, which the current transaction modifies.
+ */
+void
+InvalidateReusableSubPlanResults(Oid relationId)
+{
+	ListCell *resultCell = NULL;
+	foreach(resultCell, ReusableSubPlanResultList)
+	{
+		ReusableSubPlanResult *reusableResult = lfirst(resultCell);
+
+		if (list_member_oid(reusableResult->relationIdList, relationId))
+		{
+			ReusableSubPlanResultList =
+				foreach_delete_current(ReusableSubPlanResultList, resultCell);
+		}
+	}
+}
+
+
+/*
+ * InvalidateReusableSubPlanResultsForTaskList forgets the reusable results
+ * that read the tables that the given tasks write into or change the schema
+ * of.
+ */
+void
+InvalidateReusableSubPlanResultsForTaskList(List *taskList)
+{
+	if (ReusableSubPlanResultList == NIL)
+	{
+		return;
+	}
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		/* the tasks of DDL commands only have an anchor shard */
+		if (task->relationShardList == NIL && task->anchorShardId != INVALID_SHARD_ID)
+		{
+			bool missingOk = true;
+			Oid relationId = LookupShardRelationFromCatalog(task->anchorShardId,
+															missingOk);
+			if (OidIsValid(relationId))
+			{
+				InvalidateReusableSubPlanResults(relationId);
+			}
+		}
+
+		RelationShard *relationShard = NULL;
+		foreach_ptr(relationShard, task->relationShardList)
+		{
+			InvalidateReusableSubPlanResults(relationShard->relationId);
+		}
+
+		if (ReusableSubPlanResultList == NIL)
+		{
+			return;
+		}
+	}
+}
+
+
+/*
+ * ResetReusableSubPlanResults forgets all reusable results, which is called
+ * when the transaction ends, or a subtransaction aborts since results may
+ * then be incomplete or reflect modifications that were rolled back.
+ */
+void
+ResetReusableSubPlanResults(void)
+{
+	ReusableSubPlanResultList = NIL;
+}
+
+
+/*
+ * PrefetchIndependentSubPlanResults runs the tasks of the subplans that do
+ * not use the results of other subplans in a single distributed execution,
+ * such that they run concurrently rather than one after the other. The rows
+ * of each subplan are kept in a tuple store that the Citus scan of the
+ * subplan returns instead of executing its tasks, see
+ * TakePrefetchedSubPlanResult. The rest of the subplan, i.e. its combine
+ * query and writing its intermediate result, still runs in order. Subplans
+ * whose results are reused do not run at all.
+ */
+static void
+PrefetchIndependentSubPlanResults(List *subPlanList, HTAB *intermediateResultsHash,
+								  bool pruneTasks)
+{
+	List *prefetchTaskList = NIL;
+	List *prefetchedResultList = NIL;
+	bool randomAccess = true;
+	bool interTransactions = false;
+
+	/* reads must not observe the modifications of earlier subplans, or miss them */
+	if (list_length(subPlanList) < 2 || !SubPlanListIsReadOnly(subPlanList))
+	{
+		return;
+	}
+
+	DistributedSubPlan *subPlan = NULL;
+	foreach_ptr(subPlan, subPlanList)
+	{
+		if (SubPlanResultIsReusable(subPlan, intermediateResultsHash, pruneTasks))
+		{
+			continue;
+		}
+
+		CustomScan *customScan = PrefetchableSubPlanScan(subPlan);
+		if (customScan == NULL)
+		{
+			continue;
+		}
+
+		DistributedPlan *distributedPlan = GetDistributedPlan(customScan);
+		TupleDesc tupleDescriptor = ExecTypeFromTL(customScan->custom_scan_tlist);
+
+		PrefetchedSubPlanResult *prefetchedResult =
+			palloc0(sizeof(PrefetchedSubPlanResult));
+		prefetchedResult->planId = distributedPlan->planId;
+		prefetchedResult->tupleStore =
+			tuplestore_begin_heap(randomAccess, interTransactions, work_mem);
+
+		TupleDestination *tupleDest =
+			CreateTupleStoreTupleDest(prefetchedResult->tupleStore, tupleDescriptor);
+
+		/*
+		 * The tasks belong to the (possibly cached) plan of the subplan, so we
+		 * only set the destination of their rows on shallow copies.
+		 */
+		Task *task = NULL;
+		foreach_ptr(task, distributedPlan->workerJob->taskList)
+		{
+			Task *prefetchTask = palloc(sizeof(Task));
+			*prefetchTask = *task;
+			prefetchTask->tupleDest = tupleDest;
+
+			prefetchTaskList = lappend(prefetchTaskList, prefetchTask);
+		}
+
+		prefetchedResultList = lappend(prefetchedResultList, prefetchedResult);
 	}
+
+	if (list_length(prefetchedResultList) < 2)
+	{
+		/* a single subplan does not benefit from running in advance */
+		PrefetchedSubPlanResult *prefetchedResult = NULL;
+		foreach_ptr(prefetchedResult, prefetchedResultList)
+		{
+			tuplestore_end(prefetchedResult->tupleStore);
+		}
+
+		return;
+	}
+
+	ereport(DEBUG1, (errmsg("executing the tasks of %d subplans in parallel",
+							list_length(prefetchedResultList))));
+
+	/* enforce citus.max_intermediate_result_size like for the subplans */
+	SubPlanLevel++;
+
+	bool expectResults = true;
+	ExecuteTaskListIntoTupleDest(ROW_MODIFY_READONLY, prefetchTaskList,
+								 CreateTupleDestNone(), expectResults);
+
+	SubPlanLevel--;
+
+	PrefetchedSubPlanResultList = prefetchedResultList;
+}
+
+
+/*
+ * SubPlanListIsReadOnly returns whether none of the subplans modifies data or
+ * locks rows.
+ */
+static bool
+SubPlanListIsReadOnly(List *subPlanList)
+{
+	DistributedSubPlan *subPlan = NULL;
+	foreach_ptr(subPlan, subPlanList)
+	{
+		PlannedStmt *plannedStmt = subPlan->plan;
+
+		if (plannedStmt->commandType != CMD_SELECT || plannedStmt->hasModifyingCTE ||
+			plannedStmt->rowMarks != NIL)
+		{
+			return false;
+		}
+
+		CustomScan *customScan = FetchCitusCustomScanIfExists(plannedStmt->planTree);
+		if (customScan != NULL &&
+			GetDistributedPlan(customScan)->modLevel != ROW_MODIFY_READONLY)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * PrefetchableSubPlanScan returns the Citus scan of the given subplan if its
+ * tasks can run before the subplans that precede it, or NULL otherwise. That
+ * requires a plain router or multi-shard plan that does not use the results
+ * of other subplans, and whose tasks are fully known at planning time.
+ */
+static CustomScan *
+PrefetchableSubPlanScan(DistributedSubPlan *subPlan)
+{
+	CustomScan *customScan = FetchCitusCustomScanIfExists(subPlan->plan->planTree);
+	if (customScan == NULL)
+	{
+		return NULL;
+	}
+
+	DistributedPlan *distributedPlan = GetDistributedPlan(customScan);
+	Job *workerJob = distributedPlan->workerJob;
+
+	if (workerJob == NULL || workerJob->taskList == NIL ||
+		workerJob->deferredPruning || workerJob->dependentJobList != NIL ||
+		workerJob->parameterPruningClauseList != NIL)
+	{
+		return NULL;
+	}
+
+	if (distributedPlan->subPlanList != NIL ||
+		distributedPlan->usedSubPlanNodeList != NIL ||
+		distributedPlan->repartitionedAggregateQuery != NULL ||
+		distributedPlan->mergeSortedTaskResults)
+	{
+		return NULL;
+	}
+
+	return customScan;
+}
+
+
+/*
+ * TakePrefetchedSubPlanResult returns the rows of the tasks of the subplan
+ * with the given distributed plan if they ran in advance, and forgets about
+ * them, such that they are returned only once. Otherwise, it returns NULL.
+ */
+Tuplestorestate *
+TakePrefetchedSubPlanResult(uint64 planId)
+{
+	PrefetchedSubPlanResult *prefetchedResult = NULL;
+	foreach_ptr(prefetchedResult, PrefetchedSubPlanResultList)
+	{
+		if (prefetchedResult->planId == planId)
+		{
+			PrefetchedSubPlanResultList =
+				list_delete_ptr(PrefetchedSubPlanResultList, prefetchedResult);
+
+			return prefetchedResult->tupleStore;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * CreateTaskPruningDestReceiver creates a DestReceiver that passes the rows
+ * to the given receiver and records the shards of the given hash distributed
+ * table that the first column of the rows hashes to.
+ */
+static DestReceiver *
+CreateTaskPruningDestReceiver(DestReceiver *resultDest, Oid relationId)
+{
+	TaskPruningDestReceiver *pruningDest =
+		(TaskPruningDestReceiver *) palloc0(sizeof(TaskPruningDestReceiver));
+
+	pruningDest->pub.receiveSlot = TaskPruningDestReceiverReceive;
+	pruningDest->pub.rStartup = TaskPruningDestReceiverStartup;
+	pruningDest->pub.rShutdown = TaskPruningDestReceiverShutdown;
+	pruningDest->pub.rDestroy = TaskPruningDestReceiverDestroy;
+	pruningDest->pub.mydest = DestCopyOut;
+
+	pruningDest->resultDest = resultDest;
+	pruningDest->cacheEntry = GetCitusTableCacheEntry(relationId);
+	pruningDest->partitionColumnCollation =
+		pruningDest->cacheEntry->partitionColumn->varcollid;
+	pruningDest->shardMatched =
+		palloc0(pruningDest->cacheEntry->shardIntervalArrayLength * sizeof(bool));
+
+	return (DestReceiver *) pruningDest;
+}
+
+
+/*
+ * TaskPruningDestReceiverStartup starts up the receiver of the intermediate
+ * result.
+ */
+static void
+TaskPruningDestReceiverStartup(DestReceiver *dest, int operation,
+							   TupleDesc inputTupleDescriptor)
+{
+	TaskPruningDestReceiver *pruningDest = (TaskPruningDestReceiver *) dest;
+	DestReceiver *resultDest = pruningDest->resultDest;
+
+	resultDest->rStartup(resultDest, operation, inputTupleDescriptor);
+}
+
+
+/*
+ * TaskPruningDestReceiverReceive records the shard that the first column of
+ * the row hashes to, and passes the row to the receiver of the intermediate
+ * result.
+ */
+static bool
+TaskPruningDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
+{
+	TaskPruningDestReceiver *pruningDest = (TaskPruningDestReceiver *) dest;
+	CitusTableCacheEntry *cacheEntry = pruningDest->cacheEntry;
+	DestReceiver *resultDest = pruningDest->resultDest;
+
+	/* once all shards matched, there is nothing left to prune */
+	if (pruningDest->matchedShardCount < cacheEntry->shardIntervalArrayLength)
+	{
+		bool isNull = false;
+		Datum value = slot_getattr(slot, 1, &isNull);
+
+		/* NULLs never match the IN filter */
+		if (!isNull)
+		{
+			Datum hashedValue = FunctionCall1Coll(cacheEntry->hashFunction,
+												  pruningDest->partitionColumnCollation,
+												  value);
+			int shardIndex = FindShardIntervalIndex(hashedValue, cacheEntry);
+
+			if (shardIndex != INVALID_SHARD_INDEX &&
+				!pruningDest->shardMatched[shardIndex])
+			{
+				pruningDest->shardMatched[shardIndex] = true;
+				pruningDest->matchedShardCount++;
+			}
+		}
+	}
+
+	return resultDest->receiveSlot(slot, resultDest);
+}
+
+
+/*
+ * TaskPruningDestReceiverShutdown shuts down the receiver of the intermediate
+ * result and collects the IDs of the shards that the rows hashed to.
+ */
+static void
+TaskPruningDestReceiverShutdown(DestReceiver *dest)
+{
+	TaskPruningDestReceiver *pruningDest = (TaskPruningDestReceiver *) dest;
+	CitusTableCacheEntry *cacheEntry = pruningDest->cacheEntry;
+	DestReceiver *resultDest = pruningDest->resultDest;
+
+	resultDest->rShutdown(resultDest);
+
+	for (int shardIndex = 0; shardIndex < cacheEntry->shardIntervalArrayLength;
+		 shardIndex++)
+	{
+		if (pruningDest->shardMatched[shardIndex])
+		{
+			uint64 *shardId = palloc(sizeof(uint64));
+			*shardId = cacheEntry->sortedShardIntervalArray[shardIndex]->shardId;
+
+			pruningDest->matchedShardIdList =
+				lappend(pruningDest->matchedShardIdList, shardId);
+		}
+	}
+}
+
+
+/*
+ * TaskPruningDestReceiverDestroy frees the receiver along with the receiver
+ * of the intermediate result.
+ */
+static void
+TaskPruningDestReceiverDestroy(DestReceiver *dest)
+{
+	TaskPruningDestReceiver *pruningDest = (TaskPruningDestReceiver *) dest;
+	DestReceiver *resultDest = pruningDest->resultDest;
+
+	resultDest->rDestroy(resultDest);
+	pfree(pruningDest->shardMatched);
+	pfree(pruningDest);
+}
+
+
+/*
+ * PruneTaskListByMatchedShards returns the tasks that only access shards
+ * that the results of the subplans hashed to. If no task can be skipped, it
+ * returns NIL. We always keep at least one task, such that the query still
+ * returns e.g. the result of an aggregate over no rows.
+ */
+static List *
+PruneTaskListByMatchedShards(List *taskList, List *pruningDestList)
+{
+	List *remainingTaskList = NIL;
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		bool taskMatches = true;
+
+		TaskPruningDestReceiver *pruningDest = NULL;
+		foreach_ptr(pruningDest, pruningDestList)
+		{
+			if (!TaskMatchesShards(task, pruningDest))
+			{
+				taskMatches = false;
+				break;
+			}
+		}
+
+		if (taskMatches)
+		{
+			remainingTaskList = lappend(remainingTaskList, task);
+		}
+	}
+
+	if (list_length(remainingTaskList) == list_length(taskList))
+	{
+		return NIL;
+	}
+
+	if (remainingTaskList == NIL)
+	{
+		remainingTaskList = list_make1(linitial(taskList));
+	}
+
+	return remainingTaskList;
+}
+
+
+/*
+ * TaskMatchesShards returns false if the task accesses a shard of the table
+ * of the given receiver that none of the rows hashed to.
+ */
+static bool
+TaskMatchesShards(Task *task, TaskPruningDestReceiver *pruningDest)
+{
+	Oid relationId = pruningDest->cacheEntry->relationId;
+
+	RelationShard *relationShard = NULL;
+	foreach_ptr(relationShard, task->relationShardList)
+	{
+		if (relationShard->relationId != relationId)
+		{
+			continue;
+		}
+
+		bool shardMatched = false;
+
+		uint64 *matchedShardId = NULL;
+		foreach_ptr(matchedShardId, pruningDest->matchedShardIdList)
+		{
+			if (*matchedShardId == relationShard->shardId)
+			{
+				shardMatched = true;
+				break;
+			}
+		}
+
+		if (!shardMatched)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * CreateResultSlicingDestReceiver creates a DestReceiver that writes the
+ * intermediate result to each of the given nodes separately, such that each
+ * node only receives the rows whose column that the subplan is marked with
+ * hashes to a shard of the table that the tasks on the node access. The
+ * local file, if any, gets all rows. If a task does not access a shard of the
+ * table, the function returns NULL.
+ */
+static DestReceiver *
+CreateResultSlicingDestReceiver(char *resultId, EState *estate,
+								List *remoteWorkerNodeList, bool writeLocalFile,
+								DistributedSubPlan *subPlan, List *taskList)
+{
+	Oid relationId = subPlan->resultSlicingRelationId;
+	CitusTableCacheEntry *cacheEntry = GetCitusTableCacheEntry(relationId);
+	int shardCount = cacheEntry->shardIntervalArrayLength;
+	List *nodeDestList = NIL;
+
+	if (taskList == NIL || shardCount == 0)
+	{
+		return NULL;
+	}
+
+	List **shardDestLists = palloc0(shardCount * sizeof(List *));
+
+	WorkerNode *workerNode = NULL;
+	foreach_ptr(workerNode, remoteWorkerNodeList)
+	{
+		bool writeNodeLocalFile = false;
+		DestReceiver *nodeDest =
+			CreateRemoteFileDestReceiver(resultId, estate, list_make1(workerNode),
+										 writeNodeLocalFile);
+
+		nodeDestList = lappend(nodeDestList, nodeDest);
+	}
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		bool taskAccessesTable = false;
+
+		RelationShard *relationShard = NULL;
+		foreach_ptr(relationShard, task->relationShardList)
+		{
+			if (relationShard->relationId != relationId)
+			{
+				continue;
+			}
+
+			ShardInterval *shardInterval = LoadShardInterval(relationShard->shardId);
+			int shardIndex = shardInterval->shardIndex;
+
+			taskAccessesTable = true;
+
+			ShardPlacement *placement = NULL;
+			foreach_ptr(placement, task->taskPlacementList)
+			{
+				DestReceiver *nodeDest = NULL;
+				forboth_ptr(workerNode, remoteWorkerNodeList, nodeDest, nodeDestList)
+				{
+					if (workerNode->nodeId == placement->nodeId)
+					{
+						shardDestLists[shardIndex] =
+							list_append_unique_ptr(shardDestLists[shardIndex], nodeDest);
+					}
+				}
+			}
+		}
+
+		if (!taskAccessesTable)
+		{
+			/* the task needs all rows of the result */
+			DestReceiver *nodeDest = NULL;
+			foreach_ptr(nodeDest, nodeDestList)
+			{
+				nodeDest->rDestroy(nodeDest);
+			}
+
+			pfree(shardDestLists);
+
+			return NULL;
+		}
+	}
+
+	ResultSlicingDestReceiver *slicingDest =
+		(ResultSlicingDestReceiver *) palloc0(sizeof(ResultSlicingDestReceiver));
+
+	slicingDest->pub.receiveSlot = ResultSlicingDestReceiverReceive;
+	slicingDest->pub.rStartup = ResultSlicingDestReceiverStartup;
+	slicingDest->pub.rShutdown = ResultSlicingDestReceiverShutdown;
+	slicingDest->pub.rDestroy = ResultSlicingDestReceiverDestroy;
+	slicingDest->pub.mydest = DestCopyOut;
+
+	slicingDest->cacheEntry = cacheEntry;
+	slicingDest->partitionColumnCollation = cacheEntry->partitionColumn->varcollid;
+	slicingDest->attributeNumber = subPlan->resultSlicingAttributeNumber;
+	slicingDest->nodeDestList = nodeDestList;
+	slicingDest->shardDestLists = shardDestLists;
+
+	if (writeLocalFile)
+	{
+		List *localNodeList = NIL;
+		slicingDest->localDest =
+			CreateRemoteFileDestReceiver(resultId, estate, localNodeList,
+										 writeLocalFile);
+	}
+
+	ereport(DEBUG1, (errmsg("Subplan %s only sends each node the rows that hash "
+							"to its shards", resultId)));
+
+	return (DestReceiver *) slicingDest;
+}
+
+
+/*
+ * ResultSlicingDestReceiverStartup starts up the receivers of all nodes, such
+ * that nodes without any rows still get an empty intermediate result.
+ */
+static void
+ResultSlicingDestReceiverStartup(DestReceiver *dest, int operation,
+								 TupleDesc inputTupleDescriptor)
+{
+	ResultSlicingDestReceiver *slicingDest = (ResultSlicingDestReceiver *) dest;
+
+	DestReceiver *nodeDest = NULL;
+	foreach_ptr(nodeDest, slicingDest->nodeDestList)
+	{
+		nodeDest->rStartup(nodeDest, operation, inputTupleDescriptor);
+	}
+
+	if (slicingDest->localDest != NULL)
+	{
+		DestReceiver *localDest = slicingDest->localDest;
+		localDest->rStartup(localDest, operation, inputTupleDescriptor);
+	}
+}
+
+
+/*
+ * ResultSlicingDestReceiverReceive passes the row to the receivers of the
+ * nodes of the shard that its column hashes to, and to the local file.
+ */
+static bool
+ResultSlicingDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
+{
+	ResultSlicingDestReceiver *slicingDest = (ResultSlicingDestReceiver *) dest;
+	CitusTableCacheEntry *cacheEntry = slicingDest->cacheEntry;
+
+	if (slicingDest->localDest != NULL)
+	{
+		DestReceiver *localDest = slicingDest->localDest;
+		localDest->receiveSlot(slot, localDest);
+	}
+
+	bool isNull = false;
+	Datum value = slot_getattr(slot, slicingDest->attributeNumber, &isNull);
+
+	/* NULLs never equal the distribution column */
+	if (isNull)
+	{
+		return true;
+	}
+
+	Datum hashedValue = FunctionCall1Coll(cacheEntry->hashFunction,
+										  slicingDest->partitionColumnCollation,
+										  value);
+	int shardIndex = FindShardIntervalIndex(hashedValue, cacheEntry);
+	if (shardIndex == INVALID_SHARD_INDEX)
+	{
+		return true;
+	}
+
+	DestReceiver *nodeDest = NULL;
+	foreach_ptr(nodeDest, slicingDest->shardDestLists[shardIndex])
+	{
+		nodeDest->receiveSlot(slot, nodeDest);
+	}
+
+	return true;
+}
+
+
+/*
+ * ResultSlicingDestReceiverShutdown shuts down the receivers of all nodes and
+ * of the local file.
+ */
+static void
+ResultSlicingDestReceiverShutdown(DestReceiver *dest)
+{
+	ResultSlicingDestReceiver *slicingDest = (ResultSlicingDestReceiver *) dest;
+
+	DestReceiver *nodeDest = NULL;
+	foreach_ptr(nodeDest, slicingDest->nodeDestList)
+	{
+		nodeDest->rShutdown(nodeDest);
+	}
+
+	if (slicingDest->localDest != NULL)
+	{
+		DestReceiver *localDest = slicingDest->localDest;
+		localDest->rShutdown(localDest);
+	}
+}
+
+
+/*
+ * ResultSlicingDestReceiverDestroy frees the receiver along with the receivers
+ * of the nodes and of the local file.
+ */
+static void
+ResultSlicingDestReceiverDestroy(DestReceiver *dest)
+{
+	ResultSlicingDestReceiver *slicingDest = (ResultSlicingDestReceiver *) dest;
+
+	DestReceiver *nodeDest = NULL;
+	foreach_ptr(nodeDest, slicingDest->nodeDestList)
+	{
+		nodeDest->rDestroy(nodeDest);
+	}
+
+	if (slicingDest->localDest != NULL)
+	{
+		DestReceiver *localDest = slicingDest->localDest;
+		localDest->rDestroy(localDest);
+	}
+
+	pfree(slicingDest->shardDestLists);
+	pfree(slicingDest);
+}
+
+
+/*
+ * ResultSlicingDestReceiverBytesSent returns the average number of bytes that
+ * were sent to a node.
+ */
+static uint64
+ResultSlicingDestReceiverBytesSent(DestReceiver *dest)
+{
+	ResultSlicingDestReceiver *slicingDest = (ResultSlicingDestReceiver *) dest;
+	uint64 bytesSent = 0;
+
+	DestReceiver *nodeDest = NULL;
+	foreach_ptr(nodeDest, slicingDest->nodeDestList)
+	{
+		bytesSent += RemoteFileDestReceiverBytesSent(nodeDest);
+	}
+
+	return bytesSent / list_length(slicingDest->nodeDestList);
 }
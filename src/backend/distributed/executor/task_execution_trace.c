@@ -0,0 +1,252 @@
+/*-------------------------------------------------------------------------
+ *
+ * task_execution_trace.c
+ *   Keeps the timings of a sample of the remote task executions in a ring
+ *   buffer in shared memory, to find out where the time of the slow tasks
+ *   of multi-shard queries goes in production.
+ *
+ *   The adaptive executor decides per execution whether its tasks are
+ *   sampled, based on citus.task_execution_trace_sample_rate, and records a
+ *   TaskExecutionTrace for every task that finished on a remote placement.
+ *   The ring buffer only keeps the most recent traces, so the overhead is a
+ *   few clock reads per task and a short lock per sampled task.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/timestamp.h"
+
+#include "pg_version_constants.h"
+
+#if PG_VERSION_NUM >= PG_VERSION_15
+#include "common/pg_prng.h"
+#endif
+
+#include "distributed/citus_safe_lib.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/task_execution_trace.h"
+#include "distributed/tuplestore.h"
+
+
+/* number of traces kept in shared memory */
+#define TASK_EXECUTION_TRACE_COUNT 1024
+
+#define TASK_EXECUTION_TRACES_COLUMNS 12
+
+
+/*
+ * The data structure used to store the ring buffer of the traces in shared
+ * memory. nextTraceIndex wraps around, the oldest trace is overwritten
+ * first.
+ */
+typedef struct TaskExecutionTraceSharedData
+{
+	int traceTrancheId;
+	char *traceTrancheName;
+
+	LWLock traceLock;
+
+	uint64 nextTraceIndex;
+	TaskExecutionTrace traces[TASK_EXECUTION_TRACE_COUNT];
+} TaskExecutionTraceSharedData;
+
+
+/* GUC, fraction of the executions of which the tasks are traced */
+double TaskExecutionTraceSampleRate = 0.0;
+
+
+static TaskExecutionTraceSharedData *TaskExecutionTraceSharedState = NULL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+PG_FUNCTION_INFO_V1(citus_task_execution_traces);
+
+
+/*
+ * citus_task_execution_traces returns the sampled task execution traces,
+ * oldest first.
+ */
+Datum
+citus_task_execution_traces(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	Datum values[TASK_EXECUTION_TRACES_COLUMNS];
+	bool isNulls[TASK_EXECUTION_TRACES_COLUMNS];
+
+	/* copy the traces, so we do not hold the lock while building tuples */
+	TaskExecutionTrace *traces = palloc(sizeof(TaskExecutionTrace) *
+										TASK_EXECUTION_TRACE_COUNT);
+
+	LWLockAcquire(&TaskExecutionTraceSharedState->traceLock, LW_SHARED);
+
+	uint64 nextTraceIndex = TaskExecutionTraceSharedState->nextTraceIndex;
+	memcpy_s(traces, sizeof(TaskExecutionTrace) * TASK_EXECUTION_TRACE_COUNT,
+			 TaskExecutionTraceSharedState->traces,
+			 sizeof(TaskExecutionTrace) * TASK_EXECUTION_TRACE_COUNT);
+
+	LWLockRelease(&TaskExecutionTraceSharedState->traceLock);
+
+	for (int traceNumber = 0; traceNumber < TASK_EXECUTION_TRACE_COUNT; traceNumber++)
+	{
+		TaskExecutionTrace *trace =
+			&traces[(nextTraceIndex + traceNumber) % TASK_EXECUTION_TRACE_COUNT];
+
+		if (!trace->valid)
+		{
+			continue;
+		}
+
+		memset(values, 0, sizeof(values));
+		memset(isNulls, false, sizeof(isNulls));
+
+		values[0] = TimestampTzGetDatum(trace->startTime);
+		values[1] = Int64GetDatum(trace->queryId);
+		values[2] = Int32GetDatum(trace->taskId);
+		values[3] = Int64GetDatum(trace->anchorShardId);
+		values[4] = PointerGetDatum(cstring_to_text(trace->nodeName));
+		values[5] = Int32GetDatum(trace->nodePort);
+		values[6] = Float8GetDatum(trace->connectionAcquireTime);
+		values[7] = Float8GetDatum(trace->sendTime);
+		values[8] = Float8GetDatum(trace->firstByteTime);
+		values[9] = Float8GetDatum(trace->receiveTime);
+		values[10] = Int64GetDatum(trace->bytesReceived);
+		values[11] = Int64GetDatum(trace->rowsReceived);
+
+		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+	}
+
+	pfree(traces);
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * ShouldSampleTaskExecutionTraces returns whether the tasks of a new
+ * execution should be traced, with a probability of
+ * citus.task_execution_trace_sample_rate.
+ */
+bool
+ShouldSampleTaskExecutionTraces(void)
+{
+	if (TaskExecutionTraceSampleRate <= 0.0)
+	{
+		return false;
+	}
+
+#if PG_VERSION_NUM >= PG_VERSION_15
+	double randomValue = pg_prng_double(&pg_global_prng_state);
+#else
+
+	/* Generate a random double between 0 and 1 */
+	double randomValue = (double) random() / MAX_RANDOM_VALUE;
+#endif
+
+	return randomValue < TaskExecutionTraceSampleRate;
+}
+
+
+/*
+ * RecordTaskExecutionTrace adds a copy of the given trace to the ring buffer,
+ * overwriting the oldest trace.
+ */
+void
+RecordTaskExecutionTrace(TaskExecutionTrace *trace)
+{
+	LWLockAcquire(&TaskExecutionTraceSharedState->traceLock, LW_EXCLUSIVE);
+
+	uint64 traceIndex = TaskExecutionTraceSharedState->nextTraceIndex;
+	TaskExecutionTraceSharedState->traces[traceIndex] = *trace;
+	TaskExecutionTraceSharedState->traces[traceIndex].valid = true;
+	TaskExecutionTraceSharedState->nextTraceIndex =
+		(traceIndex + 1) % TASK_EXECUTION_TRACE_COUNT;
+
+	LWLockRelease(&TaskExecutionTraceSharedState->traceLock);
+}
+
+
+/*
+ * InitializeTaskExecutionTraces requests the necessary shared memory from
+ * Postgres and sets up the shared memory startup hook.
+ */
+void
+InitializeTaskExecutionTraces(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(TaskExecutionTraceShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = TaskExecutionTraceShmemInit;
+}
+
+
+/*
+ * TaskExecutionTraceShmemSize returns the size that should be allocated on
+ * the shared memory for the task execution traces.
+ */
+size_t
+TaskExecutionTraceShmemSize(void)
+{
+	return sizeof(TaskExecutionTraceSharedData);
+}
+
+
+/*
+ * TaskExecutionTraceShmemInit initializes the ring buffer of the task
+ * execution traces in shared memory.
+ */
+void
+TaskExecutionTraceShmemInit(void)
+{
+	bool alreadyInitialized = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	TaskExecutionTraceSharedState =
+		(TaskExecutionTraceSharedData *) ShmemInitStruct(
+			"Task Execution Trace Data",
+			sizeof(TaskExecutionTraceSharedData),
+			&alreadyInitialized);
+
+	if (!alreadyInitialized)
+	{
+		memset(TaskExecutionTraceSharedState, 0, sizeof(TaskExecutionTraceSharedData));
+
+		TaskExecutionTraceSharedState->traceTrancheId = LWLockNewTrancheId();
+		TaskExecutionTraceSharedState->traceTrancheName =
+			"Task Execution Trace Tranche";
+		LWLockRegisterTranche(TaskExecutionTraceSharedState->traceTrancheId,
+							  TaskExecutionTraceSharedState->traceTrancheName);
+
+		LWLockInitialize(&TaskExecutionTraceSharedState->traceLock,
+						 TaskExecutionTraceSharedState->traceTrancheId);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
@@ -22,6 +22,7 @@
 #include "libpq/pqformat.h"
 #include "storage/fd.h"
 
+#include "distributed/citus_safe_lib.h"
 #include "distributed/listutils.h"
 #include "distributed/relay_utility.h"
 #include "distributed/transmit.h"
@@ -37,20 +38,55 @@ static void SendCopyDone(void);
 static void SendCopyData(StringInfo fileBuffer);
 static bool ReceiveCopyData(StringInfo copyData);
 static void FreeStringInfo(StringInfo stringInfo);
+static FileCompat OpenReceivedFile(const char *filename);
+static void AppendToReceivedFile(FileCompat *fileCompat, StringInfo fileData);
 
 
 /*
  * RedirectCopyDataToRegularFile receives data from stdin using the standard copy
  * protocol. The function then creates or truncates a file with the given
- * filename, and appends received data to this file.
+ * filename, and appends received data to this file. When a compression is
+ * given, each copy data message is a compressed frame that is decompressed
+ * before it is appended.
  */
 void
-RedirectCopyDataToRegularFile(const char *filename)
+RedirectCopyDataToRegularFile(const char *filename,
+							  ResultCompressionType compressionType)
+{
+	int64 memoryLimit = -1;
+
+	(void) RedirectCopyDataToBufferOrFile(filename, compressionType, memoryLimit);
+}
+
+
+/*
+ * RedirectCopyDataToBufferOrFile receives data from stdin like
+ * RedirectCopyDataToRegularFile, but keeps the data in memory as long as it
+ * is at most memoryLimit bytes. It returns the received data in that case.
+ * Otherwise, it writes all data to the file with the given filename and
+ * returns NULL. A negative memoryLimit means that the data is always written
+ * to the file.
+ */
+StringInfo
+RedirectCopyDataToBufferOrFile(const char *filename,
+							   ResultCompressionType compressionType,
+							   int64 memoryLimit)
 {
 	StringInfo copyData = makeStringInfo();
-	const int fileFlags = (O_APPEND | O_CREAT | O_RDWR | O_TRUNC | PG_BINARY);
-	File fileDesc = FileOpenForTransmit(filename, fileFlags);
-	FileCompat fileCompat = FileCompatFromFileStart(fileDesc);
+	StringInfo fileData = copyData;
+	StringInfo memoryData = NULL;
+	FileCompat fileCompat;
+
+	memset_struct_0(fileCompat);
+
+	if (memoryLimit >= 0)
+	{
+		memoryData = makeStringInfo();
+	}
+	else
+	{
+		fileCompat = OpenReceivedFile(filename);
+	}
 
 	SendCopyInStart();
 
@@ -60,13 +96,36 @@ RedirectCopyDataToRegularFile(const char *filename)
 		/* if received data has contents, append to regular file */
 		if (copyData->len > 0)
 		{
-			int appended = FileWriteCompat(&fileCompat, copyData->data,
-										   copyData->len, PG_WAIT_IO);
+			if (compressionType != RESULT_COMPRESSION_NONE)
+			{
+				if (fileData == copyData)
+				{
+					fileData = makeStringInfo();
+				}
+
+				resetStringInfo(fileData);
+				DecompressResultFrame(compressionType, copyData->data, copyData->len,
+									  fileData);
+			}
 
-			if (appended != copyData->len)
+			if (memoryData != NULL &&
+				(int64) memoryData->len + fileData->len > memoryLimit)
 			{
-				ereport(ERROR, (errcode_for_file_access(),
-								errmsg("could not append to received file: %m")));
+				/* the data no longer fits in memory, move it to the file */
+				fileCompat = OpenReceivedFile(filename);
+				AppendToReceivedFile(&fileCompat, memoryData);
+
+				FreeStringInfo(memoryData);
+				memoryData = NULL;
+			}
+
+			if (memoryData != NULL)
+			{
+				appendBinaryStringInfo(memoryData, fileData->data, fileData->len);
+			}
+			else
+			{
+				AppendToReceivedFile(&fileCompat, fileData);
 			}
 		}
 
@@ -74,20 +133,65 @@ RedirectCopyDataToRegularFile(const char *filename)
 		copyDone = ReceiveCopyData(copyData);
 	}
 
+	if (fileData != copyData)
+	{
+		FreeStringInfo(fileData);
+	}
+
 	FreeStringInfo(copyData);
-	FileClose(fileDesc);
+
+	if (memoryData == NULL)
+	{
+		FileClose(fileCompat.fd);
+	}
+
+	return memoryData;
+}
+
+
+/*
+ * OpenReceivedFile creates or truncates the file with the given filename for
+ * appending received data to it.
+ */
+static FileCompat
+OpenReceivedFile(const char *filename)
+{
+	const int fileFlags = (O_APPEND | O_CREAT | O_RDWR | O_TRUNC | PG_BINARY);
+	File fileDesc = FileOpenForTransmit(filename, fileFlags);
+
+	return FileCompatFromFileStart(fileDesc);
+}
+
+
+/*
+ * AppendToReceivedFile appends the given data to a file opened by
+ * OpenReceivedFile.
+ */
+static void
+AppendToReceivedFile(FileCompat *fileCompat, StringInfo fileData)
+{
+	int appended = FileWriteCompat(fileCompat, fileData->data, fileData->len,
+								   PG_WAIT_IO);
+
+	if (appended != fileData->len)
+	{
+		ereport(ERROR, (errcode_for_file_access(),
+						errmsg("could not append to received file: %m")));
+	}
 }
 
 
 /*
  * SendRegularFile reads data from the given file, and sends these data to
  * stdout using the standard copy protocol. After all file data are sent, the
- * function ends the copy protocol and closes the file.
+ * function ends the copy protocol and closes the file. When a compression is
+ * given, each buffer is sent as a compressed frame.
  */
 void
-SendRegularFile(const char *filename)
+SendRegularFile(const char *filename, ResultCompressionType compressionType)
 {
-	const uint32 fileBufferSize = 32768; /* 32 KB */
+	uint32 fileBufferSize = 32768; /* 32 KB */
+	StringInfo frameBuffer = NULL;
 	const int fileFlags = (O_RDONLY | PG_BINARY);
 	const int fileMode = 0;
 
@@ -98,7 +202,14 @@ SendRegularFile(const char *filename)
 	/*
 	 * We read file's contents into buffers of 32 KB. This buffer size is twice
 	 * as large as Hadoop's default buffer size, and may later be configurable.
+	 * Compressed frames are larger to get a better compression ratio.
 	 */
+	if (compressionType != RESULT_COMPRESSION_NONE)
+	{
+		fileBufferSize = RESULT_COMPRESSION_FRAME_SIZE;
+		frameBuffer = makeStringInfo();
+	}
+
 	StringInfo fileBuffer = makeStringInfo();
 	enlargeStringInfo(fileBuffer, fileBufferSize);
 
@@ -110,7 +221,16 @@ SendRegularFile(const char *filename)
 	{
 		fileBuffer->len = readBytes;
 
-		SendCopyData(fileBuffer);
+		if (frameBuffer != NULL)
+		{
+			CompressResultFrame(compressionType, fileBuffer->data, fileBuffer->len,
+								frameBuffer);
+			SendCopyData(frameBuffer);
+		}
+		else
+		{
+			SendCopyData(fileBuffer);
+		}
 
 		resetStringInfo(fileBuffer);
 		readBytes = FileReadCompat(&fileCompat, fileBuffer->data, fileBufferSize,
@@ -119,11 +239,62 @@ SendRegularFile(const char *filename)
 
 	SendCopyDone();
 
+	if (frameBuffer != NULL)
+	{
+		FreeStringInfo(frameBuffer);
+	}
+
 	FreeStringInfo(fileBuffer);
 	FileClose(fileDesc);
 }
 
 
+/*
+ * SendRegularBuffer sends the given data to stdout using the standard copy
+ * protocol, in the same way as SendRegularFile sends the contents of a file.
+ */
+void
+SendRegularBuffer(StringInfo data, ResultCompressionType compressionType)
+{
+	int bufferSize = 32768; /* 32 KB, as in SendRegularFile */
+	StringInfo frameBuffer = NULL;
+
+	if (compressionType != RESULT_COMPRESSION_NONE)
+	{
+		bufferSize = RESULT_COMPRESSION_FRAME_SIZE;
+		frameBuffer = makeStringInfo();
+	}
+
+	StringInfoData dataBuffer = { NULL, 0, 0, 0 };
+
+	SendCopyOutStart();
+
+	for (int offset = 0; offset < data->len; offset += bufferSize)
+	{
+		dataBuffer.data = data->data + offset;
+		dataBuffer.len = Min(data->len - offset, bufferSize);
+
+		if (frameBuffer != NULL)
+		{
+			CompressResultFrame(compressionType, dataBuffer.data, dataBuffer.len,
+								frameBuffer);
+			SendCopyData(frameBuffer);
+		}
+		else
+		{
+			SendCopyData(&dataBuffer);
+		}
+	}
+
+	SendCopyDone();
+
+	if (frameBuffer != NULL)
+	{
+		FreeStringInfo(frameBuffer);
+	}
+}
+
+
 /* Helper function that deallocates string info object. */
 static void
 FreeStringInfo(StringInfo stringInfo)
@@ -10,6 +10,8 @@
 
 #include "access/htup_details.h"
 
+#include "distributed/hash_helpers.h"
+#include "distributed/listutils.h"
 #include "distributed/multi_server_executor.h"
 #include "distributed/subplan_execution.h"
 #include "distributed/tuple_destination.h"
@@ -30,6 +32,29 @@ typedef struct TupleStoreTupleDestination
 	TupleDesc tupleDesc;
 } TupleStoreTupleDestination;
 
+/*
+ * TaskTupleStoresTupleDestination is internal representation of a
+ * TupleDestination which forwards the tuples of each task to a separate
+ * tuple store.
+ */
+typedef struct TaskTupleStoresTupleDestination
+{
+	TupleDestination pub;
+
+	/* tuple store destinations of the tasks, keyed by task id */
+	HTAB *taskTupleDestHash;
+
+	/* how does tuples look like? */
+	TupleDesc tupleDesc;
+} TaskTupleStoresTupleDestination;
+
+/* entry of the taskTupleDestHash of a TaskTupleStoresTupleDestination */
+typedef struct TaskTupleDestHashEntry
+{
+	uint32 taskId;
+	TupleDestination *tupleDest;
+} TaskTupleDestHashEntry;
+
 /*
  * TupleDestDestReceiver is internal representation of a DestReceiver which
  * forards tuples to a tuple destination.
@@ -45,14 +70,33 @@ typedef struct TupleDestDestReceiver
 } TupleDestDestReceiver;
 
 
+/* when enabled, TupleDestDestReceiver hands slots to tuple destinations */
+bool EnableLocalExecutionSlotTuples = true;
+
+
 /* forward declarations for local functions */
 static void TupleStoreTupleDestPutTuple(TupleDestination *self, Task *task,
 										int placementIndex, int queryNumber,
 										HeapTuple heapTuple, uint64 tupleLibpqSize);
+static void TupleStoreTupleDestPutSlot(TupleDestination *self, Task *task,
+									   int placementIndex, int queryNumber,
+									   TupleTableSlot *slot);
+static void RecordTupleStoreTupleSize(TupleDestination *self, uint64 tupleSize,
+									  uint64 tupleStoreSize);
+static uint64 SlotTupleSize(TupleTableSlot *slot);
 static void EnsureIntermediateSizeLimitNotExceeded(TupleDestinationStats *
 												   tupleDestinationStats);
 static TupleDesc TupleStoreTupleDestTupleDescForQuery(TupleDestination *self, int
 													  queryNumber);
+static void TaskTupleStoresTupleDestPutTuple(TupleDestination *self, Task *task,
+											 int placementIndex, int queryNumber,
+											 HeapTuple heapTuple,
+											 uint64 tupleLibpqSize);
+static void TaskTupleStoresTupleDestPutSlot(TupleDestination *self, Task *task,
+											int placementIndex, int queryNumber,
+											TupleTableSlot *slot);
+static TupleDesc TaskTupleStoresTupleDestTupleDescForQuery(TupleDestination *self,
+														   int queryNumber);
 static void TupleDestNonePutTuple(TupleDestination *self, Task *task,
 								  int placementIndex, int queryNumber,
 								  HeapTuple heapTuple, uint64 tupleLibpqSize);
@@ -78,6 +122,7 @@ CreateTupleStoreTupleDest(Tuplestorestate *tupleStore, TupleDesc tupleDescriptor
 	tupleStoreTupleDest->tupleStore = tupleStore;
 	tupleStoreTupleDest->tupleDesc = tupleDescriptor;
 	tupleStoreTupleDest->pub.putTuple = TupleStoreTupleDestPutTuple;
+	tupleStoreTupleDest->pub.putSlot = TupleStoreTupleDestPutSlot;
 	tupleStoreTupleDest->pub.tupleDescForQuery =
 		TupleStoreTupleDestTupleDescForQuery;
 
@@ -112,10 +157,48 @@ TupleStoreTupleDestPutTuple(TupleDestination *self, Task *task,
 		tupleSize = heapTuple->t_len;
 	}
 
-	/*
-	 * Enfoce citus.max_intermediate_result_size for subPlans if
-	 * the caller requested.
-	 */
+	RecordTupleStoreTupleSize(self, tupleSize, heapTuple->t_len);
+
+	/* do the actual work */
+	tuplestore_puttuple(tupleDest->tupleStore, heapTuple);
+
+	/* we record tuples received over network */
+	task->totalReceivedTupleData += tupleLibpqSize;
+}
+
+
+/*
+ * TupleStoreTupleDestPutSlot implements TupleDestination->putSlot for
+ * TupleStoreTupleDestination. Local execution uses it to form the minimal
+ * tuple in the tuple store directly from the slot of the shard query,
+ * rather than first materializing a heap tuple that the tuple store copies
+ * once more.
+ */
+static void
+TupleStoreTupleDestPutSlot(TupleDestination *self, Task *task,
+						   int placementIndex, int queryNumber,
+						   TupleTableSlot *slot)
+{
+	TupleStoreTupleDestination *tupleDest = (TupleStoreTupleDestination *) self;
+
+	uint64 tupleSize = SlotTupleSize(slot);
+
+	RecordTupleStoreTupleSize(self, tupleSize, tupleSize);
+
+	/* do the actual work */
+	tuplestore_puttupleslot(tupleDest->tupleStore, slot);
+}
+
+
+/*
+ * RecordTupleStoreTupleSize adds the size of a tuple that is about to be put
+ * into the tuple store to the stats of the tuple destination, and enforces
+ * citus.max_intermediate_result_size for subPlans if the caller requested.
+ */
+static void
+RecordTupleStoreTupleSize(TupleDestination *self, uint64 tupleSize,
+						  uint64 tupleStoreSize)
+{
 	TupleDestinationStats *tupleDestinationStats = self->tupleDestinationStats;
 	if (SubPlanLevel > 0 && tupleDestinationStats != NULL)
 	{
@@ -123,11 +206,42 @@ TupleStoreTupleDestPutTuple(TupleDestination *self, Task *task,
 		EnsureIntermediateSizeLimitNotExceeded(tupleDestinationStats);
 	}
 
-	/* do the actual work */
-	tuplestore_puttuple(tupleDest->tupleStore, heapTuple);
+	if (tupleDestinationStats != NULL)
+	{
+		tupleDestinationStats->totalTupleStoreSize += tupleStoreSize;
+	}
+}
 
-	/* we record tuples received over network */
-	task->totalReceivedTupleData += tupleLibpqSize;
+
+/*
+ * SlotTupleSize returns the size that the tuple in the slot takes once it is
+ * formed into a heap tuple, without forming it.
+ */
+static uint64
+SlotTupleSize(TupleTableSlot *slot)
+{
+	TupleDesc tupleDesc = slot->tts_tupleDescriptor;
+
+	slot_getallattrs(slot);
+
+	bool hasNulls = false;
+	for (int attrIndex = 0; attrIndex < tupleDesc->natts; attrIndex++)
+	{
+		if (slot->tts_isnull[attrIndex])
+		{
+			hasNulls = true;
+			break;
+		}
+	}
+
+	Size headerSize = SizeofHeapTupleHeader;
+	if (hasNulls)
+	{
+		headerSize += BITMAPLEN(tupleDesc->natts);
+	}
+
+	return MAXALIGN(headerSize) +
+		   heap_compute_data_size(tupleDesc, slot->tts_values, slot->tts_isnull);
 }
 
 
@@ -191,6 +305,121 @@ TupleStoreTupleDestTupleDescForQuery(TupleDestination *self, int queryNumber)
 }
 
 
+/*
+ * CreateTaskTupleStoresTupleDest creates a TupleDestination which forwards the
+ * tuples of each task in the task list to the tuple store at the same position
+ * in tupleStoreList, such that the results of the tasks are kept apart.
+ */
+TupleDestination *
+CreateTaskTupleStoresTupleDest(List *taskList, List *tupleStoreList,
+							   TupleDesc tupleDescriptor)
+{
+	Assert(list_length(taskList) == list_length(tupleStoreList));
+
+	TaskTupleStoresTupleDestination *taskTupleStoresDest = palloc0(
+		sizeof(TaskTupleStoresTupleDestination));
+
+	taskTupleStoresDest->tupleDesc = tupleDescriptor;
+	taskTupleStoresDest->pub.putTuple = TaskTupleStoresTupleDestPutTuple;
+	taskTupleStoresDest->pub.putSlot = TaskTupleStoresTupleDestPutSlot;
+	taskTupleStoresDest->pub.tupleDescForQuery =
+		TaskTupleStoresTupleDestTupleDescForQuery;
+
+	TupleDestination *tupleDestination = &taskTupleStoresDest->pub;
+	tupleDestination->tupleDestinationStats =
+		(TupleDestinationStats *) palloc0(sizeof(TupleDestinationStats));
+
+	taskTupleStoresDest->taskTupleDestHash =
+		CreateSimpleHashWithNameAndSize(uint32, TaskTupleDestHashEntry,
+										"TaskTupleDestHash",
+										Max(list_length(taskList), 1));
+
+	Task *task = NULL;
+	Tuplestorestate *tupleStore = NULL;
+	forboth_ptr(task, taskList, tupleStore, tupleStoreList)
+	{
+		bool found = false;
+		TaskTupleDestHashEntry *hashEntry = hash_search(
+			taskTupleStoresDest->taskTupleDestHash, &task->taskId, HASH_ENTER, &found);
+		Assert(!found);
+
+		/* the size limit applies to the results of all tasks together */
+		hashEntry->tupleDest = CreateTupleStoreTupleDest(tupleStore, tupleDescriptor);
+		hashEntry->tupleDest->tupleDestinationStats =
+			tupleDestination->tupleDestinationStats;
+	}
+
+	return tupleDestination;
+}
+
+
+/*
+ * TaskTupleStoresTupleDestPutTuple implements TupleDestination->putTuple for
+ * TaskTupleStoresTupleDestination.
+ */
+static void
+TaskTupleStoresTupleDestPutTuple(TupleDestination *self, Task *task,
+								 int placementIndex, int queryNumber,
+								 HeapTuple heapTuple, uint64 tupleLibpqSize)
+{
+	TaskTupleStoresTupleDestination *taskTupleStoresDest =
+		(TaskTupleStoresTupleDestination *) self;
+
+	bool found = false;
+	TaskTupleDestHashEntry *hashEntry = hash_search(
+		taskTupleStoresDest->taskTupleDestHash, &task->taskId, HASH_FIND, &found);
+	if (!found)
+	{
+		ereport(ERROR, (errmsg("unexpected result for task %u", task->taskId)));
+	}
+
+	TupleDestination *taskTupleDest = hashEntry->tupleDest;
+	taskTupleDest->putTuple(taskTupleDest, task, placementIndex, queryNumber,
+							heapTuple, tupleLibpqSize);
+}
+
+
+/*
+ * TaskTupleStoresTupleDestPutSlot implements TupleDestination->putSlot for
+ * TaskTupleStoresTupleDestination.
+ */
+static void
+TaskTupleStoresTupleDestPutSlot(TupleDestination *self, Task *task,
+								int placementIndex, int queryNumber,
+								TupleTableSlot *slot)
+{
+	TaskTupleStoresTupleDestination *taskTupleStoresDest =
+		(TaskTupleStoresTupleDestination *) self;
+
+	bool found = false;
+	TaskTupleDestHashEntry *hashEntry = hash_search(
+		taskTupleStoresDest->taskTupleDestHash, &task->taskId, HASH_FIND, &found);
+	if (!found)
+	{
+		ereport(ERROR, (errmsg("unexpected result for task %u", task->taskId)));
+	}
+
+	TupleDestination *taskTupleDest = hashEntry->tupleDest;
+	taskTupleDest->putSlot(taskTupleDest, task, placementIndex, queryNumber, slot);
+}
+
+
+/*
+ * TaskTupleStoresTupleDestTupleDescForQuery implements
+ * TupleDestination->TupleDescForQuery for TaskTupleStoresTupleDestination.
+ */
+static TupleDesc
+TaskTupleStoresTupleDestTupleDescForQuery(TupleDestination *self, int queryNumber)
+{
+	Assert(queryNumber == 0);
+
+	TaskTupleStoresTupleDestination *taskTupleStoresDest =
+		(TaskTupleStoresTupleDestination *) self;
+
+	return taskTupleStoresDest->tupleDesc;
+}
+
+
 /*
  * CreateTupleDestNone creates a tuple destination which ignores the tuples.
  */
@@ -282,6 +511,13 @@ TupleDestDestReceiverReceive(TupleTableSlot *slot,
 	Assert(task->queryCount == 1);
 	int queryNumber = 0;
 
+	if (tupleDest->putSlot != NULL && EnableLocalExecutionSlotTuples)
+	{
+		tupleDest->putSlot(tupleDest, task, placementIndex, queryNumber, slot);
+
+		return true;
+	}
+
 	HeapTuple heapTuple = ExecFetchSlotHeapTuple(slot, true, NULL);
 
 	uint64 tupleLibpqSize = 0;
@@ -17,6 +17,7 @@
 #include "access/htup_details.h"
 #include "access/skey.h"
 #include "access/sysattr.h"
+#include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/dependency.h"
 #include "catalog/indexing.h"
@@ -38,10 +39,12 @@
 #include "utils/fmgroids.h"
 #include "utils/hsearch.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/syscache.h"
 
 #include "pg_version_constants.h"
 
+#include "distributed/backend_data.h"
 #include "distributed/citus_depended_object.h"
 #include "distributed/commands.h"
 #include "distributed/commands/utility_hook.h"
@@ -118,6 +121,35 @@ typedef struct DependencyDefinition
 	} data;
 } DependencyDefinition;
 
+/*
+ * DependencyDefinitionCacheEntry holds the pg_depend and pg_shdepend records
+ * of an object, such that walking the dependencies of objects that share
+ * dependencies, or walking the dependencies of the same object in different
+ * ways, scans the catalogs once per object.
+ */
+typedef struct DependencyDefinitionCacheEntry
+{
+	/* the objectSubId of the key is always 0 */
+	ObjectAddress key;
+
+	bool isValid;
+	List *pgDependDefinitions;
+	List *pgShDependDefinitions;
+} DependencyDefinitionCacheEntry;
+
+/*
+ * The cached records are only used within the (sub)transaction and command in
+ * which they were read, since the catalog changes of the next commands become
+ * visible only after a command counter increment.
+ */
+static HTAB *DependencyDefinitionCache = NULL;
+static MemoryContext DependencyDefinitionCacheContext = NULL;
+static LocalTransactionId DependencyDefinitionCacheTransactionId =
+	InvalidLocalTransactionId;
+static SubTransactionId DependencyDefinitionCacheSubTransactionId =
+	InvalidSubTransactionId;
+static CommandId DependencyDefinitionCacheCommandId = InvalidCommandId;
+
 /*
  * ViewDependencyNode represents a view (or possibly a table) in a dependency graph of
  * views.
@@ -168,6 +200,9 @@ typedef void (*applyFn)(ObjectAddressCollector *collector,
 static void RecurseObjectDependencies(ObjectAddress target, expandFn expand,
 									  followFn follow, applyFn apply,
 									  ObjectAddressCollector *collector);
+static List * CachedDependencyDefinitionList(ObjectAddress target);
+static DependencyDefinitionCacheEntry * LookupDependencyDefinitionCacheEntry(
+	ObjectAddress target);
 static List * DependencyDefinitionFromPgDepend(ObjectAddress target);
 static List * DependencyDefinitionFromPgShDepend(ObjectAddress target);
 static bool FollowAllSupportedDependencies(ObjectAddressCollector *collector,
@@ -389,10 +424,7 @@ RecurseObjectDependencies(ObjectAddress target, expandFn expand, followFn follow
 	MarkObjectVisited(collector, target);
 
 	/* lookup both pg_depend and pg_shdepend for dependencies */
-	List *pgDependDefinitions = DependencyDefinitionFromPgDepend(target);
-	List *pgShDependDefinitions = DependencyDefinitionFromPgShDepend(target);
-	List *dependenyDefinitionList = list_concat(pgDependDefinitions,
-												pgShDependDefinitions);
+	List *dependenyDefinitionList = CachedDependencyDefinitionList(target);
 
 	/* concat expanded entries if applicable */
 	if (expand != NULL)
@@ -427,6 +459,107 @@ RecurseObjectDependencies(ObjectAddress target, expandFn expand, followFn follow
 }
 
 
+/*
+ * CachedDependencyDefinitionList returns the pg_depend and pg_shdepend records
+ * describing the dependencies of target, reading them from the catalogs only
+ * if they were not yet read in the current command.
+ *
+ * The definitions are copied into the current memory context, since the cache
+ * might be reset while the caller still recurses over the returned list.
+ */
+static List *
+CachedDependencyDefinitionList(ObjectAddress target)
+{
+	DependencyDefinitionCacheEntry *cacheEntry =
+		LookupDependencyDefinitionCacheEntry(target);
+
+	List *dependencyDefinitionList = NIL;
+	List *cachedDefinitionLists = list_make2(cacheEntry->pgDependDefinitions,
+											 cacheEntry->pgShDependDefinitions);
+
+	List *cachedDefinitionList = NIL;
+	foreach_ptr(cachedDefinitionList, cachedDefinitionLists)
+	{
+		DependencyDefinition *cachedDefinition = NULL;
+		foreach_ptr(cachedDefinition, cachedDefinitionList)
+		{
+			DependencyDefinition *definition = palloc(sizeof(DependencyDefinition));
+			*definition = *cachedDefinition;
+
+			dependencyDefinitionList = lappend(dependencyDefinitionList, definition);
+		}
+	}
+
+	return dependencyDefinitionList;
+}
+
+
+/*
+ * LookupDependencyDefinitionCacheEntry returns the cache entry holding the
+ * pg_depend and pg_shdepend records of target, and fills it if needed. The
+ * cache is reset whenever it is used in a different (sub)transaction or
+ * command than the one in which it was filled.
+ */
+static DependencyDefinitionCacheEntry *
+LookupDependencyDefinitionCacheEntry(ObjectAddress target)
+{
+	LocalTransactionId transactionId = GetMyProcLocalTransactionId();
+	SubTransactionId subTransactionId = GetCurrentSubTransactionId();
+	CommandId commandId = GetCurrentCommandId(false);
+
+	if (DependencyDefinitionCacheContext == NULL)
+	{
+		DependencyDefinitionCacheContext =
+			AllocSetContextCreate(CacheMemoryContext, "DependencyDefinitionCache",
+								  ALLOCSET_DEFAULT_SIZES);
+	}
+
+	if (DependencyDefinitionCache == NULL ||
+		DependencyDefinitionCacheTransactionId != transactionId ||
+		DependencyDefinitionCacheSubTransactionId != subTransactionId ||
+		DependencyDefinitionCacheCommandId != commandId)
+	{
+		MemoryContextReset(DependencyDefinitionCacheContext);
+
+		MemoryContext oldContext =
+			MemoryContextSwitchTo(DependencyDefinitionCacheContext);
+		DependencyDefinitionCache =
+			CreateSimpleHashWithNameAndSize(ObjectAddress,
+											DependencyDefinitionCacheEntry,
+											"dependency definition cache", 64);
+		MemoryContextSwitchTo(oldContext);
+
+		DependencyDefinitionCacheTransactionId = transactionId;
+		DependencyDefinitionCacheSubTransactionId = subTransactionId;
+		DependencyDefinitionCacheCommandId = commandId;
+	}
+
+	/* pg_depend and pg_shdepend are scanned without the objectSubId */
+	ObjectAddress key = { 0 };
+	ObjectAddressSet(key, target.classId, target.objectId);
+
+	bool found = false;
+	DependencyDefinitionCacheEntry *cacheEntry =
+		hash_search(DependencyDefinitionCache, &key, HASH_ENTER, &found);
+
+	if (!found || !cacheEntry->isValid)
+	{
+		/* only mark the entry valid once both scans succeeded */
+		cacheEntry->isValid = false;
+
+		MemoryContext oldContext =
+			MemoryContextSwitchTo(DependencyDefinitionCacheContext);
+		cacheEntry->pgDependDefinitions = DependencyDefinitionFromPgDepend(target);
+		cacheEntry->pgShDependDefinitions = DependencyDefinitionFromPgShDepend(target);
+		MemoryContextSwitchTo(oldContext);
+
+		cacheEntry->isValid = true;
+	}
+
+	return cacheEntry;
+}
+
+
 /*
  * DependencyDefinitionFromPgDepend loads all pg_depend records describing the
  * dependencies of target.
@@ -0,0 +1,921 @@
+/*-------------------------------------------------------------------------
+ *
+ * distributed_table_statistics.c
+ *
+ * Functions for giving the planner of the coordinator statistics about
+ * Citus tables. The rows of a Citus table are in its shards, so the table on
+ * the coordinator is empty and the planner misestimates the joins between
+ * distributed subplans, reference tables and local tables.
+ *
+ * When citus.enable_distributed_analyze is set, ANALYZE of a Citus table
+ * reads the statistics that ANALYZE collected for each of its shards from
+ * pg_class and pg_stats, merges them and stores the result as the
+ * statistics of the table on the coordinator: pg_class.reltuples and
+ * relpages hold the sums over the shards, and pg_statistic holds the merged
+ * column statistics. The planner uses the number of pages and rows of
+ * pg_class for Citus tables instead of the size of their empty storage.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "miscadmin.h"
+
+#include "access/htup_details.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/indexing.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_statistic.h"
+#include "catalog/pg_type.h"
+#include "executor/tuptable.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/sortsupport.h"
+#include "utils/syscache.h"
+#include "utils/tuplestore.h"
+#include "utils/typcache.h"
+
+#include "distributed/citus_nodes.h"
+#include "distributed/citus_safe_lib.h"
+#include "distributed/coordinator_protocol.h"
+#include "distributed/distributed_table_statistics.h"
+#include "distributed/hash_helpers.h"
+#include "distributed/listutils.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/metadata_utility.h"
+#include "distributed/multi_executor.h"
+#include "distributed/multi_join_order.h"
+#include "distributed/multi_physical_planner.h"
+#include "distributed/tuple_destination.h"
+
+
+/* number of columns of the statistics query of a shard */
+#define SHARD_STATISTICS_QUERY_COLUMN_COUNT 11
+
+/* ANALYZE stores the number of distinct values as a ratio above this fraction */
+#define DISTINCT_RATIO_THRESHOLD 0.1
+
+
+/*
+ * ShardColumnStatistics holds the statistics of a column of a shard, as
+ * returned by pg_stats on the node of the shard.
+ */
+typedef struct ShardColumnStatistics
+{
+	double rowCount;
+	float4 nullFraction;
+	int32 averageWidth;
+	float4 distinctCount;
+	char *mostCommonValues;
+	char *mostCommonFrequencies;
+	char *histogramBounds;
+	bool hasCorrelation;
+	float4 correlation;
+} ShardColumnStatistics;
+
+
+/*
+ * MergedCommonValue is a value that is among the most common values of at
+ * least one shard, with its number of rows summed over the shards.
+ */
+typedef struct MergedCommonValue
+{
+	char *valueString;
+	Datum value;
+	double rowCount;
+} MergedCommonValue;
+
+
+/*
+ * MergedColumnStatistics holds the merged statistics of a column in the form
+ * of a pg_statistic row.
+ */
+typedef struct MergedColumnStatistics
+{
+	float4 nullFraction;
+	int32 averageWidth;
+	float4 distinctCount;
+
+	int slotCount;
+	int16 kinds[STATISTIC_NUM_SLOTS];
+	Oid operators[STATISTIC_NUM_SLOTS];
+	Oid collations[STATISTIC_NUM_SLOTS];
+	Datum numbers[STATISTIC_NUM_SLOTS];
+	Datum values[STATISTIC_NUM_SLOTS];
+	bool numbersIsNull[STATISTIC_NUM_SLOTS];
+	bool valuesIsNull[STATISTIC_NUM_SLOTS];
+} MergedColumnStatistics;
+
+
+/* GUC, whether ANALYZE of a Citus table stores statistics on the coordinator */
+bool EnableDistributedAnalyze = false;
+
+
+static List * ShardStatisticsTaskList(Oid relationId, List *shardIntervalList);
+static TupleDesc ShardStatisticsTupleDesc(void);
+static MergedColumnStatistics * MergeColumnStatistics(Form_pg_attribute attribute,
+													  List *shardStatisticsList,
+													  double totalRowCount,
+													  bool isDistributionColumn);
+static float4 MergeDistinctCount(List *shardStatisticsList, double totalRowCount,
+								 float4 nullFraction, bool isDistributionColumn);
+static void MergeMostCommonValues(MergedColumnStatistics *merged,
+								  Form_pg_attribute attribute,
+								  TypeCacheEntry *typeEntry, List *shardStatisticsList,
+								  double totalRowCount);
+static void MergeHistogramBounds(MergedColumnStatistics *merged,
+								 Form_pg_attribute attribute,
+								 TypeCacheEntry *typeEntry, List *shardStatisticsList);
+static void MergeCorrelation(MergedColumnStatistics *merged, TypeCacheEntry *typeEntry,
+							 Oid collationId, List *shardStatisticsList);
+static Datum * ParseStatisticsArray(char *arrayString, Oid elementTypeId,
+									int32 typeMod, int *elementCount);
+static int CompareMergedCommonValueStrings(const ListCell *left, const ListCell *right);
+static int CompareMergedCommonValueRowCounts(const ListCell *left,
+											 const ListCell *right);
+static int CompareDatumsWithSortSupport(const void *left, const void *right,
+										void *arg);
+static void StoreMergedColumnStatistics(Relation pgStatistic, Oid relationId,
+										Form_pg_attribute attribute,
+										MergedColumnStatistics *merged);
+static void UpdateRelationSizeStatistics(Oid relationId, BlockNumber pageCount,
+										 double rowCount);
+
+
+/*
+ * UpdateDistributedTableStatistics merges the statistics of the shards of
+ * the given Citus table, which ANALYZE has just collected, and stores them
+ * as the statistics of the table on this node.
+ */
+void
+UpdateDistributedTableStatistics(Oid relationId)
+{
+	List *shardIntervalList = LoadShardIntervalList(relationId);
+	if (shardIntervalList == NIL)
+	{
+		return;
+	}
+
+	MemoryContext statisticsContext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "Distributed Table Statistics Context",
+							  ALLOCSET_DEFAULT_SIZES);
+	MemoryContext oldContext = MemoryContextSwitchTo(statisticsContext);
+
+	TupleDesc tupleDescriptor = ShardStatisticsTupleDesc();
+	Tuplestorestate *tupleStore = tuplestore_begin_heap(false, false, work_mem);
+	TupleDestination *tupleDest = CreateTupleStoreTupleDest(tupleStore,
+															tupleDescriptor);
+	List *taskList = ShardStatisticsTaskList(relationId, shardIntervalList);
+	bool expectResults = true;
+
+	ExecuteTaskListIntoTupleDest(ROW_MODIFY_READONLY, taskList, tupleDest,
+								 expectResults);
+
+	Relation relation = table_open(relationId, AccessShareLock);
+	TupleDesc relationDescriptor = RelationGetDescr(relation);
+	int attributeCount = relationDescriptor->natts;
+
+	/* statistics of each shard, indexed by attribute number - 1 */
+	List **columnStatisticsLists = palloc0(attributeCount * sizeof(List *));
+
+	HTAB *seenShardIdSet = CreateSimpleHashSetWithName(uint64, "Analyzed Shards");
+	double totalRowCount = 0;
+	BlockNumber totalPageCount = 0;
+
+	TupleTableSlot *slot = MakeSingleTupleTableSlot(tupleDescriptor,
+													&TTSOpsMinimalTuple);
+
+	while (tuplestore_gettupleslot(tupleStore, true, false, slot))
+	{
+		slot_getallattrs(slot);
+
+		uint64 shardId = DatumGetInt64(slot->tts_values[0]);
+		double shardRowCount = Max(DatumGetFloat8(slot->tts_values[1]), 0);
+
+		/* the shard is returned once for each of its columns */
+		bool shardSeen = false;
+		hash_search(seenShardIdSet, &shardId, HASH_ENTER, &shardSeen);
+		if (!shardSeen)
+		{
+			totalRowCount += shardRowCount;
+			totalPageCount += (BlockNumber) DatumGetInt64(slot->tts_values[2]);
+		}
+
+		if (slot->tts_isnull[3])
+		{
+			/* the shard has no column statistics, e.g. because it is empty */
+			continue;
+		}
+
+		char *columnName = TextDatumGetCString(slot->tts_values[3]);
+		AttrNumber attributeNumber = get_attnum(relationId, columnName);
+		if (attributeNumber <= 0 || attributeNumber > attributeCount)
+		{
+			continue;
+		}
+
+		ShardColumnStatistics *shardStatistics = palloc0(sizeof(ShardColumnStatistics));
+		shardStatistics->rowCount = shardRowCount;
+		shardStatistics->nullFraction = DatumGetFloat4(slot->tts_values[4]);
+		shardStatistics->averageWidth = DatumGetInt32(slot->tts_values[5]);
+		shardStatistics->distinctCount = DatumGetFloat4(slot->tts_values[6]);
+
+		if (!slot->tts_isnull[7] && !slot->tts_isnull[8])
+		{
+			shardStatistics->mostCommonValues =
+				TextDatumGetCString(slot->tts_values[7]);
+			shardStatistics->mostCommonFrequencies =
+				TextDatumGetCString(slot->tts_values[8]);
+		}
+
+		if (!slot->tts_isnull[9])
+		{
+			shardStatistics->histogramBounds = TextDatumGetCString(slot->tts_values[9]);
+		}
+
+		if (!slot->tts_isnull[10])
+		{
+			shardStatistics->hasCorrelation = true;
+			shardStatistics->correlation = DatumGetFloat4(slot->tts_values[10]);
+		}
+
+		columnStatisticsLists[attributeNumber - 1] =
+			lappend(columnStatisticsLists[attributeNumber - 1], shardStatistics);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	tuplestore_end(tupleStore);
+
+	/* the values of the distribution column of different shards are disjoint */
+	Var *distributionColumn = DistPartitionKey(relationId);
+	AttrNumber distributionAttributeNumber =
+		distributionColumn != NULL ? distributionColumn->varattno : InvalidAttrNumber;
+
+	Relation pgStatistic = table_open(StatisticRelationId, RowExclusiveLock);
+
+	for (int attributeIndex = 0; attributeIndex < attributeCount; attributeIndex++)
+	{
+		Form_pg_attribute attribute = TupleDescAttr(relationDescriptor, attributeIndex);
+		List *shardStatisticsList = columnStatisticsLists[attributeIndex];
+
+		if (attribute->attisdropped || shardStatisticsList == NIL ||
+			totalRowCount <= 0)
+		{
+			continue;
+		}
+
+		bool isDistributionColumn = attribute->attnum == distributionAttributeNumber;
+		MergedColumnStatistics *merged =
+			MergeColumnStatistics(attribute, shardStatisticsList, totalRowCount,
+								  isDistributionColumn);
+
+		StoreMergedColumnStatistics(pgStatistic, relationId, attribute, merged);
+	}
+
+	table_close(pgStatistic, RowExclusiveLock);
+	table_close(relation, NoLock);
+
+	UpdateRelationSizeStatistics(relationId, totalPageCount, totalRowCount);
+
+	MemoryContextSwitchTo(oldContext);
+	MemoryContextDelete(statisticsContext);
+
+	CommandCounterIncrement();
+}
+
+
+/*
+ * ShardStatisticsTaskList returns a task per shard that returns the number of
+ * rows and pages of the shard and, for each of its columns that has
+ * statistics, the statistics in pg_stats. Shards without column statistics
+ * are returned once with NULL column statistics.
+ */
+static List *
+ShardStatisticsTaskList(Oid relationId, List *shardIntervalList)
+{
+	List *taskList = NIL;
+	uint32 taskId = 1;
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		uint64 shardId = shardInterval->shardId;
+		char *qualifiedShardName = ConstructQualifiedShardName(shardInterval);
+		StringInfo queryString = makeStringInfo();
+
+		appendStringInfo(queryString,
+						 "SELECT " UINT64_FORMAT "::bigint, c.reltuples::float8, "
+						 "c.relpages::bigint, s.attname::text, s.null_frac, "
+						 "s.avg_width, s.n_distinct, s.most_common_vals::text, "
+						 "s.most_common_freqs::text, s.histogram_bounds::text, "
+						 "s.correlation FROM pg_class c "
+						 "JOIN pg_namespace n ON (n.oid = c.relnamespace) "
+						 "LEFT JOIN pg_stats s ON (s.schemaname = n.nspname AND "
+						 "s.tablename = c.relname AND NOT s.inherited) "
+						 "WHERE c.oid = %s::regclass",
+						 shardId, quote_literal_cstr(qualifiedShardName));
+
+		Task *task = CreateBasicTask(INVALID_JOB_ID, taskId, READ_TASK,
+									 queryString->data);
+
+		RelationShard *relationShard = CitusMakeNode(RelationShard);
+		relationShard->relationId = relationId;
+		relationShard->shardId = shardId;
+
+		task->anchorShardId = shardId;
+		task->relationShardList = list_make1(relationShard);
+		task->taskPlacementList = ActiveShardPlacementList(shardId);
+
+		taskList = lappend(taskList, task);
+		taskId++;
+	}
+
+	return taskList;
+}
+
+
+/*
+ * ShardStatisticsTupleDesc returns the tuple descriptor of the results of the
+ * tasks of ShardStatisticsTaskList.
+ */
+static TupleDesc
+ShardStatisticsTupleDesc(void)
+{
+	TupleDesc tupleDescriptor =
+		CreateTemplateTupleDesc(SHARD_STATISTICS_QUERY_COLUMN_COUNT);
+
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 1, "shardid", INT8OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 2, "reltuples", FLOAT8OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 3, "relpages", INT8OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 4, "attname", TEXTOID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 5, "null_frac", FLOAT4OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 6, "avg_width", INT4OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 7, "n_distinct", FLOAT4OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 8, "most_common_vals",
+					   TEXTOID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 9, "most_common_freqs",
+					   TEXTOID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 10, "histogram_bounds",
+					   TEXTOID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 11, "correlation",
+					   FLOAT4OID, -1, 0);
+
+	return tupleDescriptor;
+}
+
+
+/*
+ * MergeColumnStatistics merges the statistics of a column of the shards into
+ * the statistics of the column of the table. The fractions of the shards are
+ * weighted by their number of rows.
+ */
+static MergedColumnStatistics *
+MergeColumnStatistics(Form_pg_attribute attribute, List *shardStatisticsList,
+					  double totalRowCount, bool isDistributionColumn)
+{
+	MergedColumnStatistics *merged = palloc0(sizeof(MergedColumnStatistics));
+	double analyzedRowCount = 0;
+	double nullFractionSum = 0;
+	double averageWidthSum = 0;
+
+	ShardColumnStatistics *shardStatistics = NULL;
+	foreach_ptr(shardStatistics, shardStatisticsList)
+	{
+		analyzedRowCount += shardStatistics->rowCount;
+		nullFractionSum += shardStatistics->nullFraction * shardStatistics->rowCount;
+		averageWidthSum += shardStatistics->averageWidth * shardStatistics->rowCount;
+	}
+
+	if (analyzedRowCount > 0)
+	{
+		merged->nullFraction = (float4) (nullFractionSum / analyzedRowCount);
+		merged->averageWidth = (int32) (averageWidthSum / analyzedRowCount + 0.5);
+	}
+
+	merged->distinctCount = MergeDistinctCount(shardStatisticsList, totalRowCount,
+											   merged->nullFraction,
+											   isDistributionColumn);
+
+	for (int slotIndex = 0; slotIndex < STATISTIC_NUM_SLOTS; slotIndex++)
+	{
+		merged->numbersIsNull[slotIndex] = true;
+		merged->valuesIsNull[slotIndex] = true;
+	}
+
+	TypeCacheEntry *typeEntry =
+		lookup_type_cache(attribute->atttypid, TYPECACHE_EQ_OPR | TYPECACHE_LT_OPR);
+
+	if (OidIsValid(typeEntry->eq_opr))
+	{
+		MergeMostCommonValues(merged, attribute, typeEntry, shardStatisticsList,
+							  totalRowCount);
+	}
+
+	if (OidIsValid(typeEntry->lt_opr))
+	{
+		MergeHistogramBounds(merged, attribute, typeEntry, shardStatisticsList);
+		MergeCorrelation(merged, typeEntry, attribute->attcollation,
+						 shardStatisticsList);
+	}
+
+	return merged;
+}
+
+
+/*
+ * MergeDistinctCount returns the number of distinct values of a column in
+ * the representation of pg_statistic.stadistinct. If the number scales with
+ * the number of rows in all shards, the merged ratio is returned. Otherwise,
+ * the values of the distribution column are assumed to be distinct across
+ * shards, and the values of other columns to repeat across shards.
+ */
+static float4
+MergeDistinctCount(List *shardStatisticsList, double totalRowCount,
+				   float4 nullFraction, bool isDistributionColumn)
+{
+	bool allRatios = true;
+	double analyzedRowCount = 0;
+	double ratioSum = 0;
+	double distinctCountSum = 0;
+	double maxDistinctCount = 0;
+
+	ShardColumnStatistics *shardStatistics = NULL;
+	foreach_ptr(shardStatistics, shardStatisticsList)
+	{
+		double distinctCount = shardStatistics->distinctCount;
+
+		if (distinctCount < 0)
+		{
+			ratioSum += distinctCount * shardStatistics->rowCount;
+			distinctCount = -distinctCount * shardStatistics->rowCount;
+		}
+		else
+		{
+			allRatios = false;
+		}
+
+		analyzedRowCount += shardStatistics->rowCount;
+		distinctCountSum += distinctCount;
+		maxDistinctCount = Max(maxDistinctCount, distinctCount);
+	}
+
+	if (allRatios && analyzedRowCount > 0)
+	{
+		return (float4) (ratioSum / analyzedRowCount);
+	}
+
+	double distinctCount = isDistributionColumn ? distinctCountSum : maxDistinctCount;
+	distinctCount = Min(distinctCount, totalRowCount * (1.0 - nullFraction));
+
+	if (distinctCount > DISTINCT_RATIO_THRESHOLD * totalRowCount)
+	{
+		return (float4) (-distinctCount / totalRowCount);
+	}
+
+	return (float4) distinctCount;
+}
+
+
+/*
+ * MergeMostCommonValues adds a most common values slot to the merged
+ * statistics. The number of rows of each value is summed over the shards
+ * whose most common values include it, and the values with the most rows
+ * are kept, as many as the longest list of a shard.
+ */
+static void
+MergeMostCommonValues(MergedColumnStatistics *merged, Form_pg_attribute attribute,
+					  TypeCacheEntry *typeEntry, List *shardStatisticsList,
+					  double totalRowCount)
+{
+	List *commonValueList = NIL;
+	int maxValueCount = 0;
+	Oid outputFunctionId = InvalidOid;
+	bool typeIsVarlena = false;
+
+	getTypeOutputInfo(attribute->atttypid, &outputFunctionId, &typeIsVarlena);
+
+	ShardColumnStatistics *shardStatistics = NULL;
+	foreach_ptr(shardStatistics, shardStatisticsList)
+	{
+		if (shardStatistics->mostCommonValues == NULL)
+		{
+			continue;
+		}
+
+		int valueCount = 0;
+		int frequencyCount = 0;
+		Datum *values = ParseStatisticsArray(shardStatistics->mostCommonValues,
+											 attribute->atttypid, attribute->atttypmod,
+											 &valueCount);
+		Datum *frequencies = ParseStatisticsArray(shardStatistics->mostCommonFrequencies,
+												  FLOAT4OID, -1, &frequencyCount);
+		if (valueCount != frequencyCount)
+		{
+			continue;
+		}
+
+		for (int valueIndex = 0; valueIndex < valueCount; valueIndex++)
+		{
+			MergedCommonValue *commonValue = palloc0(sizeof(MergedCommonValue));
+			commonValue->value = values[valueIndex];
+			commonValue->valueString =
+				OidOutputFunctionCall(outputFunctionId, values[valueIndex]);
+			commonValue->rowCount =
+				DatumGetFloat4(frequencies[valueIndex]) * shardStatistics->rowCount;
+
+			commonValueList = lappend(commonValueList, commonValue);
+		}
+
+		maxValueCount = Max(maxValueCount, valueCount);
+	}
+
+	if (commonValueList == NIL)
+	{
+		return;
+	}
+
+	/* sum up the rows of equal values */
+	list_sort(commonValueList, CompareMergedCommonValueStrings);
+
+	List *mergedValueList = NIL;
+	MergedCommonValue *previousValue = NULL;
+	MergedCommonValue *commonValue = NULL;
+	foreach_ptr(commonValue, commonValueList)
+	{
+		if (previousValue != NULL &&
+			strcmp(previousValue->valueString, commonValue->valueString) == 0)
+		{
+			previousValue->rowCount += commonValue->rowCount;
+			continue;
+		}
+
+		mergedValueList = lappend(mergedValueList, commonValue);
+		previousValue = commonValue;
+	}
+
+	list_sort(mergedValueList, CompareMergedCommonValueRowCounts);
+
+	int valueCount = Min(list_length(mergedValueList), maxValueCount);
+	Datum *values = palloc0(valueCount * sizeof(Datum));
+	Datum *frequencies = palloc0(valueCount * sizeof(Datum));
+
+	for (int valueIndex = 0; valueIndex < valueCount; valueIndex++)
+	{
+		MergedCommonValue *mergedValue = list_nth(mergedValueList, valueIndex);
+
+		values[valueIndex] = mergedValue->value;
+		frequencies[valueIndex] =
+			Float4GetDatum((float4) (mergedValue->rowCount / totalRowCount));
+	}
+
+	int slotIndex = merged->slotCount++;
+	merged->kinds[slotIndex] = STATISTIC_KIND_MCV;
+	merged->operators[slotIndex] = typeEntry->eq_opr;
+	merged->collations[slotIndex] = attribute->attcollation;
+	merged->numbers[slotIndex] =
+		PointerGetDatum(construct_array(frequencies, valueCount, FLOAT4OID,
+										sizeof(float4), FLOAT4PASSBYVAL,
+										TYPALIGN_INT));
+	merged->numbersIsNull[slotIndex] = false;
+	merged->values[slotIndex] =
+		PointerGetDatum(construct_array(values, valueCount, attribute->atttypid,
+										typeEntry->typlen, typeEntry->typbyval,
+										typeEntry->typalign));
+	merged->valuesIsNull[slotIndex] = false;
+}
+
+
+/*
+ * MergeHistogramBounds adds a histogram slot to the merged statistics. The
+ * bounds of the histograms of all shards are sorted and the merged histogram
+ * takes evenly spaced bounds from them, as many as the longest histogram of
+ * a shard. The first and last bound of each shard histogram are the smallest
+ * and largest value of the shard, so they are kept for the table.
+ */
+static void
+MergeHistogramBounds(MergedColumnStatistics *merged, Form_pg_attribute attribute,
+					 TypeCacheEntry *typeEntry, List *shardStatisticsList)
+{
+	Datum *allBounds = NULL;
+	int allBoundCount = 0;
+	int maxBoundCount = 0;
+
+	ShardColumnStatistics *shardStatistics = NULL;
+	foreach_ptr(shardStatistics, shardStatisticsList)
+	{
+		if (shardStatistics->histogramBounds == NULL)
+		{
+			continue;
+		}
+
+		int boundCount = 0;
+		Datum *bounds = ParseStatisticsArray(shardStatistics->histogramBounds,
+											 attribute->atttypid, attribute->atttypmod,
+											 &boundCount);
+		if (boundCount == 0)
+		{
+			continue;
+		}
+
+		if (allBounds == NULL)
+		{
+			allBounds = palloc(boundCount * sizeof(Datum));
+		}
+		else
+		{
+			allBounds = repalloc(allBounds, (allBoundCount + boundCount) * sizeof(Datum));
+		}
+
+		memcpy_s(allBounds + allBoundCount, boundCount * sizeof(Datum), bounds,
+				 boundCount * sizeof(Datum));
+		allBoundCount += boundCount;
+		maxBoundCount = Max(maxBoundCount, boundCount);
+	}
+
+	if (maxBoundCount < 2)
+	{
+		return;
+	}
+
+	SortSupportData sortSupport;
+	memset(&sortSupport, 0, sizeof(sortSupport));
+	sortSupport.ssup_cxt = CurrentMemoryContext;
+	sortSupport.ssup_collation = attribute->attcollation;
+	sortSupport.ssup_nulls_first = false;
+	PrepareSortSupportFromOrderingOp(typeEntry->lt_opr, &sortSupport);
+
+	qsort_arg(allBounds, allBoundCount, sizeof(Datum), CompareDatumsWithSortSupport,
+			  &sortSupport);
+
+	int boundCount = maxBoundCount;
+	Datum *bounds = palloc0(boundCount * sizeof(Datum));
+
+	for (int boundIndex = 0; boundIndex < boundCount; boundIndex++)
+	{
+		int64 allBoundIndex = ((int64) boundIndex * (allBoundCount - 1)) /
+							  (boundCount - 1);
+
+		bounds[boundIndex] = allBounds[allBoundIndex];
+	}
+
+	int slotIndex = merged->slotCount++;
+	merged->kinds[slotIndex] = STATISTIC_KIND_HISTOGRAM;
+	merged->operators[slotIndex] = typeEntry->lt_opr;
+	merged->collations[slotIndex] = attribute->attcollation;
+	merged->values[slotIndex] =
+		PointerGetDatum(construct_array(bounds, boundCount, attribute->atttypid,
+										typeEntry->typlen, typeEntry->typbyval,
+										typeEntry->typalign));
+	merged->valuesIsNull[slotIndex] = false;
+}
+
+
+/*
+ * MergeCorrelation adds a correlation slot to the merged statistics, which
+ * holds the average correlation of the shards weighted by their rows.
+ */
+static void
+MergeCorrelation(MergedColumnStatistics *merged, TypeCacheEntry *typeEntry,
+				 Oid collationId, List *shardStatisticsList)
+{
+	double rowCount = 0;
+	double correlationSum = 0;
+
+	ShardColumnStatistics *shardStatistics = NULL;
+	foreach_ptr(shardStatistics, shardStatisticsList)
+	{
+		if (!shardStatistics->hasCorrelation)
+		{
+			continue;
+		}
+
+		rowCount += shardStatistics->rowCount;
+		correlationSum += shardStatistics->correlation * shardStatistics->rowCount;
+	}
+
+	if (rowCount <= 0)
+	{
+		return;
+	}
+
+	Datum correlation = Float4GetDatum((float4) (correlationSum / rowCount));
+
+	int slotIndex = merged->slotCount++;
+	merged->kinds[slotIndex] = STATISTIC_KIND_CORRELATION;
+	merged->operators[slotIndex] = typeEntry->lt_opr;
+	merged->collations[slotIndex] = collationId;
+	merged->numbers[slotIndex] =
+		PointerGetDatum(construct_array(&correlation, 1, FLOAT4OID, sizeof(float4),
+										FLOAT4PASSBYVAL, TYPALIGN_INT));
+	merged->numbersIsNull[slotIndex] = false;
+}
+
+
+/*
+ * ParseStatisticsArray parses the text representation of an array of
+ * statistics values of the given type and returns its elements.
+ */
+static Datum *
+ParseStatisticsArray(char *arrayString, Oid elementTypeId, int32 typeMod,
+					 int *elementCount)
+{
+	int16 typeLength = 0;
+	bool typeByValue = false;
+	char typeAlign = 0;
+	Datum *elements = NULL;
+	bool *elementIsNull = NULL;
+
+	Datum arrayDatum = OidInputFunctionCall(F_ARRAY_IN, arrayString, elementTypeId,
+											typeMod);
+	ArrayType *array = DatumGetArrayTypeP(arrayDatum);
+
+	get_typlenbyvalalign(elementTypeId, &typeLength, &typeByValue, &typeAlign);
+	deconstruct_array(array, elementTypeId, typeLength, typeByValue, typeAlign,
+					  &elements, &elementIsNull, elementCount);
+
+	return elements;
+}
+
+
+/*
+ * CompareMergedCommonValueStrings orders common values by their text
+ * representation, to bring equal values of different shards together.
+ */
+static int
+CompareMergedCommonValueStrings(const ListCell *left, const ListCell *right)
+{
+	MergedCommonValue *leftValue = lfirst(left);
+	MergedCommonValue *rightValue = lfirst(right);
+
+	return strcmp(leftValue->valueString, rightValue->valueString);
+}
+
+
+/*
+ * CompareMergedCommonValueRowCounts orders common values by descending
+ * number of rows, and equally common values by their text representation.
+ */
+static int
+CompareMergedCommonValueRowCounts(const ListCell *left, const ListCell *right)
+{
+	MergedCommonValue *leftValue = lfirst(left);
+	MergedCommonValue *rightValue = lfirst(right);
+
+	if (leftValue->rowCount > rightValue->rowCount)
+	{
+		return -1;
+	}
+	else if (leftValue->rowCount < rightValue->rowCount)
+	{
+		return 1;
+	}
+
+	return strcmp(leftValue->valueString, rightValue->valueString);
+}
+
+
+/*
+ * CompareDatumsWithSortSupport compares two datums with the given sort
+ * support, for use with qsort_arg.
+ */
+static int
+CompareDatumsWithSortSupport(const void *left, const void *right, void *arg)
+{
+	SortSupport sortSupport = (SortSupport) arg;
+
+	return ApplySortComparator(*(const Datum *) left, false,
+							   *(const Datum *) right, false, sortSupport);
+}
+
+
+/*
+ * StoreMergedColumnStatistics inserts or updates the pg_statistic row of the
+ * given column of the table, like ANALYZE does.
+ */
+static void
+StoreMergedColumnStatistics(Relation pgStatistic, Oid relationId,
+							Form_pg_attribute attribute,
+							MergedColumnStatistics *merged)
+{
+	Datum values[Natts_pg_statistic];
+	bool isNulls[Natts_pg_statistic];
+	bool replaces[Natts_pg_statistic];
+
+	memset(values, 0, sizeof(values));
+	memset(isNulls, false, sizeof(isNulls));
+	memset(replaces, true, sizeof(replaces));
+
+	values[Anum_pg_statistic_starelid - 1] = ObjectIdGetDatum(relationId);
+	values[Anum_pg_statistic_staattnum - 1] = Int16GetDatum(attribute->attnum);
+	values[Anum_pg_statistic_stainherit - 1] = BoolGetDatum(false);
+	values[Anum_pg_statistic_stanullfrac - 1] = Float4GetDatum(merged->nullFraction);
+	values[Anum_pg_statistic_stawidth - 1] = Int32GetDatum(merged->averageWidth);
+	values[Anum_pg_statistic_stadistinct - 1] = Float4GetDatum(merged->distinctCount);
+
+	for (int slotIndex = 0; slotIndex < STATISTIC_NUM_SLOTS; slotIndex++)
+	{
+		values[Anum_pg_statistic_stakind1 - 1 + slotIndex] =
+			Int16GetDatum(merged->kinds[slotIndex]);
+		values[Anum_pg_statistic_staop1 - 1 + slotIndex] =
+			ObjectIdGetDatum(merged->operators[slotIndex]);
+		values[Anum_pg_statistic_stacoll1 - 1 + slotIndex] =
+			ObjectIdGetDatum(merged->collations[slotIndex]);
+		values[Anum_pg_statistic_stanumbers1 - 1 + slotIndex] =
+			merged->numbers[slotIndex];
+		isNulls[Anum_pg_statistic_stanumbers1 - 1 + slotIndex] =
+			merged->numbersIsNull[slotIndex];
+		values[Anum_pg_statistic_stavalues1 - 1 + slotIndex] =
+			merged->values[slotIndex];
+		isNulls[Anum_pg_statistic_stavalues1 - 1 + slotIndex] =
+			merged->valuesIsNull[slotIndex];
+	}
+
+	HeapTuple statisticsTuple = NULL;
+	HeapTuple oldTuple = SearchSysCache3(STATRELATTINH,
+										 ObjectIdGetDatum(relationId),
+										 Int16GetDatum(attribute->attnum),
+										 BoolGetDatum(false));
+
+	if (HeapTupleIsValid(oldTuple))
+	{
+		statisticsTuple = heap_modify_tuple(oldTuple, RelationGetDescr(pgStatistic),
+											values, isNulls, replaces);
+		ReleaseSysCache(oldTuple);
+		CatalogTupleUpdate(pgStatistic, &statisticsTuple->t_self, statisticsTuple);
+	}
+	else
+	{
+		statisticsTuple = heap_form_tuple(RelationGetDescr(pgStatistic), values,
+										  isNulls);
+		CatalogTupleInsert(pgStatistic, statisticsTuple);
+	}
+
+	heap_freetuple(statisticsTuple);
+}
+
+
+/*
+ * UpdateRelationSizeStatistics sets the number of pages and rows of the
+ * given table in pg_class.
+ */
+static void
+UpdateRelationSizeStatistics(Oid relationId, BlockNumber pageCount, double rowCount)
+{
+	/* see the in-place update of pg_class by the local ANALYZE */
+	CommandCounterIncrement();
+
+	Relation pgClass = table_open(RelationRelationId, RowExclusiveLock);
+
+	HeapTuple classTuple = SearchSysCacheCopy1(RELOID, ObjectIdGetDatum(relationId));
+	if (!HeapTupleIsValid(classTuple))
+	{
+		ereport(ERROR, (errmsg("cache lookup failed for relation %u", relationId)));
+	}
+
+	Form_pg_class classForm = (Form_pg_class) GETSTRUCT(classTuple);
+	classForm->relpages = (int32) pageCount;
+	classForm->reltuples = (float4) rowCount;
+
+	CatalogTupleUpdate(pgClass, &classTuple->t_self, classTuple);
+
+	heap_freetuple(classTuple);
+	table_close(pgClass, RowExclusiveLock);
+}
+
+
+/*
+ * EstimateCitusTableSize sets the number of pages and rows of a Citus table
+ * that the planner estimated from its empty storage on this node to the ones
+ * stored by UpdateDistributedTableStatistics, if any.
+ */
+void
+EstimateCitusTableSize(Oid relationId, RelOptInfo *relOptInfo)
+{
+	if (!EnableDistributedAnalyze || relOptInfo->pages > 0 ||
+		!IsCitusTable(relationId))
+	{
+		return;
+	}
+
+	Relation relation = RelationIdGetRelation(relationId);
+	BlockNumber pageCount = relation->rd_rel->relpages;
+	double rowCount = relation->rd_rel->reltuples;
+	RelationClose(relation);
+
+	if (pageCount == 0 || rowCount <= 0)
+	{
+		return;
+	}
+
+	relOptInfo->pages = pageCount;
+	relOptInfo->tuples = rowCount;
+}
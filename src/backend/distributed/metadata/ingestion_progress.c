@@ -0,0 +1,357 @@
+/*-------------------------------------------------------------------------
+ *
+ * ingestion_progress.c
+ *
+ * Functions for maintaining pg_dist_ingestion, which holds the number of rows
+ * of each resumable bulk load into a distributed table that were committed.
+ *
+ * A bulk load consists of one or more COPY commands with the same
+ * ingestion_id option, each of which commits on its own. The
+ * ingestion_offset option tells the number of rows of the load that precede
+ * the input of a COPY. Every COPY records the rows that it adds in the same
+ * transaction as the rows themselves, such that a COPY that fails leaves the
+ * recorded progress as it was. A retry may therefore send the input again
+ * from any offset up to committed_rows, and the rows that were committed
+ * before are skipped instead of being copied twice.
+ *
+ * The progress is recorded on the node that runs the COPY.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/indexing.h"
+#include "commands/defrem.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
+
+#include "distributed/argutils.h"
+#include "distributed/ingestion_progress.h"
+#include "distributed/listutils.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/metadata_utility.h"
+#include "distributed/pg_dist_ingestion.h"
+#include "distributed/resource_lock.h"
+
+
+/* custom Citus options of COPY for resumable bulk loads */
+#define INGESTION_ID_OPTION "ingestion_id"
+#define INGESTION_OFFSET_OPTION "ingestion_offset"
+
+
+static HeapTuple IngestionTuple(Relation pgDistIngestion, const char *ingestionId,
+								SysScanDesc *scanDescriptor);
+static List * RemoveIngestionOptions(List *optionList);
+
+
+PG_FUNCTION_INFO_V1(citus_remove_ingestion);
+
+
+/*
+ * citus_remove_ingestion removes the progress of the bulk load with the given
+ * ingestion id from pg_dist_ingestion, such that the id can be reused for a
+ * new load.
+ */
+Datum
+citus_remove_ingestion(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	PG_ENSURE_ARGNOTNULL(0, "ingestion_id");
+
+	char *ingestionId = PG_GETARG_TEXT_TO_CSTRING(0);
+	SysScanDesc scanDescriptor = NULL;
+
+	LockIngestion(ingestionId, ExclusiveLock);
+
+	Relation pgDistIngestion = table_open(DistIngestionRelationId(), RowExclusiveLock);
+
+	HeapTuple heapTuple = IngestionTuple(pgDistIngestion, ingestionId, &scanDescriptor);
+	if (HeapTupleIsValid(heapTuple))
+	{
+		bool isNull = false;
+		Datum relationIdDatum = heap_getattr(heapTuple,
+											 Anum_pg_dist_ingestion_logicalrelid,
+											 RelationGetDescr(pgDistIngestion),
+											 &isNull);
+		Oid relationId = DatumGetObjectId(relationIdDatum);
+
+		/* the rows of dropped tables are removed along with their metadata */
+		if (get_rel_name(relationId) != NULL)
+		{
+			EnsureTableOwner(relationId);
+		}
+
+		CatalogTupleDelete(pgDistIngestion, &heapTuple->t_self);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistIngestion, NoLock);
+
+	CommandCounterIncrement();
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * ProcessIngestionOptions returns how the given COPY into the given table
+ * continues a resumable bulk load, or NULL if it has no ingestion_id option.
+ * It removes the ingestion options from the COPY, and locks the load until
+ * the end of the transaction, such that concurrent retries of a load wait for
+ * each other.
+ *
+ * We error out if the input would leave a gap after the rows that were
+ * committed, since those rows would then be missing from the load.
+ */
+IngestionProgress *
+ProcessIngestionOptions(Oid relationId, CopyStmt *copyStatement)
+{
+	DefElem *ingestionIdOption = NULL;
+	DefElem *ingestionOffsetOption = NULL;
+
+	DefElem *option = NULL;
+	foreach_ptr(option, copyStatement->options)
+	{
+		if (strncmp(option->defname, INGESTION_ID_OPTION, NAMEDATALEN) == 0)
+		{
+			ingestionIdOption = option;
+		}
+		else if (strncmp(option->defname, INGESTION_OFFSET_OPTION, NAMEDATALEN) == 0)
+		{
+			ingestionOffsetOption = option;
+		}
+	}
+
+	if (ingestionIdOption == NULL)
+	{
+		if (ingestionOffsetOption != NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							errmsg("ingestion_offset requires the ingestion_id option")));
+		}
+
+		return NULL;
+	}
+
+	if (!OidIsValid(DistIngestionRelationId()))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("ingestion_id requires the citus extension to be "
+							   "updated"),
+						errhint("Run ALTER EXTENSION citus UPDATE and try again.")));
+	}
+
+	IngestionProgress *progress = palloc0(sizeof(IngestionProgress));
+	progress->ingestionId = defGetString(ingestionIdOption);
+
+	if (ingestionOffsetOption != NULL)
+	{
+		progress->inputOffset = defGetInt64(ingestionOffsetOption);
+		if (progress->inputOffset < 0)
+		{
+			ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							errmsg("ingestion_offset cannot be negative")));
+		}
+	}
+
+	LockIngestion(progress->ingestionId, ExclusiveLock);
+
+	Relation pgDistIngestion = table_open(DistIngestionRelationId(), AccessShareLock);
+	SysScanDesc scanDescriptor = NULL;
+
+	HeapTuple heapTuple = IngestionTuple(pgDistIngestion, progress->ingestionId,
+										 &scanDescriptor);
+	if (HeapTupleIsValid(heapTuple))
+	{
+		Datum values[Natts_pg_dist_ingestion];
+		bool isNulls[Natts_pg_dist_ingestion];
+
+		heap_deform_tuple(heapTuple, RelationGetDescr(pgDistIngestion), values,
+						  isNulls);
+
+		Oid ingestionRelationId =
+			DatumGetObjectId(values[Anum_pg_dist_ingestion_logicalrelid - 1]);
+		if (ingestionRelationId != relationId)
+		{
+			ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							errmsg("ingestion \"%s\" loads into table %s",
+								   progress->ingestionId,
+								   get_rel_name(ingestionRelationId)),
+							errhint("Use a different ingestion_id, or remove the "
+									"ingestion using citus_remove_ingestion().")));
+		}
+
+		progress->committedRowCount =
+			DatumGetInt64(values[Anum_pg_dist_ingestion_committed_rows - 1]);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistIngestion, NoLock);
+
+	if (progress->inputOffset > progress->committedRowCount)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("ingestion \"%s\" committed " INT64_FORMAT " rows, "
+							   "cannot continue at row " INT64_FORMAT,
+							   progress->ingestionId, progress->committedRowCount,
+							   progress->inputOffset),
+						errhint("Send the input starting at most at the committed_rows "
+								"of the ingestion in pg_dist_ingestion.")));
+	}
+
+	progress->skipRowCount = progress->committedRowCount - progress->inputOffset;
+
+	copyStatement->options = RemoveIngestionOptions(copyStatement->options);
+
+	return progress;
+}
+
+
+/*
+ * RecordIngestionProgress records in pg_dist_ingestion that the COPY that
+ * continued the given bulk load copied the given number of rows, which come
+ * right after the rows of the load that were committed before.
+ */
+void
+RecordIngestionProgress(Oid relationId, IngestionProgress *progress,
+						uint64 copiedRowCount)
+{
+	Datum values[Natts_pg_dist_ingestion];
+	bool isNulls[Natts_pg_dist_ingestion];
+	bool replace[Natts_pg_dist_ingestion];
+	SysScanDesc scanDescriptor = NULL;
+
+	memset(values, 0, sizeof(values));
+	memset(isNulls, false, sizeof(isNulls));
+	memset(replace, true, sizeof(replace));
+
+	values[Anum_pg_dist_ingestion_ingestion_id - 1] =
+		CStringGetTextDatum(progress->ingestionId);
+	values[Anum_pg_dist_ingestion_logicalrelid - 1] = ObjectIdGetDatum(relationId);
+	values[Anum_pg_dist_ingestion_committed_rows - 1] =
+		Int64GetDatum(progress->committedRowCount + (int64) copiedRowCount);
+	values[Anum_pg_dist_ingestion_updated_at - 1] =
+		TimestampTzGetDatum(GetCurrentTimestamp());
+
+	Relation pgDistIngestion = table_open(DistIngestionRelationId(), RowExclusiveLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(pgDistIngestion);
+
+	HeapTuple heapTuple = IngestionTuple(pgDistIngestion, progress->ingestionId,
+										 &scanDescriptor);
+	if (HeapTupleIsValid(heapTuple))
+	{
+		HeapTuple newHeapTuple = heap_modify_tuple(heapTuple, tupleDescriptor, values,
+												   isNulls, replace);
+
+		CatalogTupleUpdate(pgDistIngestion, &newHeapTuple->t_self, newHeapTuple);
+	}
+	else
+	{
+		HeapTuple newHeapTuple = heap_form_tuple(tupleDescriptor, values, isNulls);
+
+		CatalogTupleInsert(pgDistIngestion, newHeapTuple);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistIngestion, NoLock);
+
+	CommandCounterIncrement();
+}
+
+
+/*
+ * DeleteIngestionProgressForRelation removes the progress of the bulk loads
+ * into the given table, which is no longer distributed.
+ */
+void
+DeleteIngestionProgressForRelation(Oid relationId)
+{
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = false;
+
+	Oid ingestionRelationId = DistIngestionRelationId();
+	if (!OidIsValid(ingestionRelationId))
+	{
+		return;
+	}
+
+	Relation pgDistIngestion = table_open(ingestionRelationId, RowExclusiveLock);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_ingestion_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relationId));
+
+	SysScanDesc scanDescriptor = systable_beginscan(pgDistIngestion, InvalidOid,
+													indexOK, NULL, scanKeyCount,
+													scanKey);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		CatalogTupleDelete(pgDistIngestion, &heapTuple->t_self);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistIngestion, NoLock);
+}
+
+
+/*
+ * IngestionTuple returns the pg_dist_ingestion tuple of the given ingestion
+ * id, or NULL if there is none. The tuple remains valid until the caller ends
+ * the returned scan.
+ */
+static HeapTuple
+IngestionTuple(Relation pgDistIngestion, const char *ingestionId,
+			   SysScanDesc *scanDescriptor)
+{
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_ingestion_ingestion_id,
+				BTEqualStrategyNumber, F_TEXTEQ, CStringGetTextDatum(ingestionId));
+
+	*scanDescriptor = systable_beginscan(pgDistIngestion,
+										 DistIngestionPrimaryKeyIndexId(), indexOK,
+										 NULL, scanKeyCount, scanKey);
+
+	return systable_getnext(*scanDescriptor);
+}
+
+
+/*
+ * RemoveIngestionOptions returns the given COPY options without the options
+ * for resumable bulk loads, which Postgres does not know.
+ */
+static List *
+RemoveIngestionOptions(List *optionList)
+{
+	List *newOptionList = NIL;
+
+	DefElem *option = NULL;
+	foreach_ptr(option, optionList)
+	{
+		if (strncmp(option->defname, INGESTION_ID_OPTION, NAMEDATALEN) == 0 ||
+			strncmp(option->defname, INGESTION_OFFSET_OPTION, NAMEDATALEN) == 0)
+		{
+			continue;
+		}
+
+		newOptionList = lappend(newOptionList, option);
+	}
+
+	return newOptionList;
+}
@@ -28,6 +28,7 @@
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_type.h"
 #include "commands/dbcommands.h"
+#include "commands/defrem.h"
 #include "commands/extension.h"
 #include "commands/trigger.h"
 #include "common/hashfn.h"
@@ -66,6 +67,7 @@
 #include "distributed/colocation_utils.h"
 #include "distributed/connection_management.h"
 #include "distributed/foreign_key_relationship.h"
+#include "distributed/function_call_delegation.h"
 #include "distributed/function_utils.h"
 #include "distributed/listutils.h"
 #include "distributed/metadata/pg_dist_object.h"
@@ -73,15 +75,20 @@
 #include "distributed/metadata_utility.h"
 #include "distributed/multi_executor.h"
 #include "distributed/multi_physical_planner.h"
+#include "distributed/pg_dist_async_reference_table.h"
 #include "distributed/pg_dist_local_group.h"
 #include "distributed/pg_dist_node.h"
 #include "distributed/pg_dist_node_metadata.h"
 #include "distributed/pg_dist_partition.h"
 #include "distributed/pg_dist_placement.h"
 #include "distributed/pg_dist_shard.h"
+#include "distributed/pg_dist_shard_column_stats.h"
 #include "distributed/remote_commands.h"
+#include "distributed/remote_prepared_statements.h"
 #include "distributed/shardinterval_utils.h"
 #include "distributed/shared_library_init.h"
+#include "distributed/shared_placement_cache.h"
+#include "distributed/tenant_schema_metadata.h"
 #include "distributed/utils/array_type.h"
 #include "distributed/utils/function.h"
 #include "distributed/version_compat.h"
@@ -191,6 +198,12 @@ typedef struct MetadataCacheData
 	Oid distObjectPrimaryKeyIndexId;
 	Oid distCleanupRelationId;
 	Oid distCleanupPrimaryKeyIndexId;
+	Oid distShardColumnStatsRelationId;
+	Oid distShardColumnStatsPrimaryKeyIndexId;
+	Oid distIngestionRelationId;
+	Oid distIngestionPrimaryKeyIndexId;
+	Oid distAsyncReferenceTableRelationId;
+	Oid distAsyncReferenceTablePrimaryKeyIndexId;
 	Oid distColocationRelationId;
 	Oid distColocationConfigurationIndexId;
 	Oid distPartitionRelationId;
@@ -242,6 +255,9 @@ static MetadataCacheData MetadataCache;
 /* Citus extension version variables */
 bool EnableVersionChecks = true; /* version checks are enabled */
 
+/* whether to keep the unchanged shards of invalidated cache entries */
+bool EnableIncrementalShardListRebuild = false;
+
 static bool citusVersionKnownCompatible = false;
 
 /* Variable to determine if we are in the process of creating citus */
@@ -280,8 +296,21 @@ static ScanKeyData DistObjectScanKey[3];
 /* local function forward declarations */
 static HeapTuple PgDistPartitionTupleViaCatalog(Oid relationId);
 static ShardIdCacheEntry * LookupShardIdCacheEntry(int64 shardId, bool missingOk);
-static CitusTableCacheEntry * BuildCitusTableCacheEntry(Oid relationId);
-static void BuildCachedShardList(CitusTableCacheEntry *cacheEntry);
+static CitusTableCacheEntry * BuildCitusTableCacheEntry(Oid relationId,
+														CitusTableCacheEntry *
+														previousEntry);
+static void BuildCachedShardList(CitusTableCacheEntry *cacheEntry,
+								 CitusTableCacheEntry *previousEntry);
+static bool PreviousShardListReusable(CitusTableCacheEntry *cacheEntry,
+									  CitusTableCacheEntry *previousEntry);
+static void LoadShardColumnStatistics(CitusTableCacheEntry *cacheEntry);
+static void LoadAsyncReplicationPrimaryGroupId(CitusTableCacheEntry *cacheEntry);
+static ShardColumnValueRange * BuildShardColumnValueRange(Oid relationId,
+														  Datum *datumArray,
+														  bool *isNullArray);
+static Const * ShardColumnValueConst(char *valueString, Oid columnType,
+									 int32 columnTypeMod, Oid constType,
+									 Oid columnCollation);
 static void PrepareWorkerNodeCache(void);
 static bool CheckInstalledVersion(int elevel);
 static char * AvailableExtensionVersion(void);
@@ -298,6 +327,7 @@ static void RegisterAuthinfoCacheCallbacks(void);
 static void RegisterCitusTableCacheEntryReleaseCallbacks(void);
 static void ResetCitusTableCacheEntry(CitusTableCacheEntry *cacheEntry);
 static void RemoveStaleShardIdCacheEntries(CitusTableCacheEntry *tableEntry);
+static void InvalidateRelcacheByRelid(Oid relationId);
 static void CreateDistTableCache(void);
 static void CreateShardIdCache(void);
 static void CreateDistObjectCache(void);
@@ -353,6 +383,7 @@ PG_FUNCTION_INFO_V1(citus_conninfo_cache_invalidate);
 PG_FUNCTION_INFO_V1(master_dist_authinfo_cache_invalidate);
 PG_FUNCTION_INFO_V1(citus_dist_object_cache_invalidate);
 PG_FUNCTION_INFO_V1(master_dist_object_cache_invalidate);
+PG_FUNCTION_INFO_V1(citus_dist_schema_cache_invalidate);
 PG_FUNCTION_INFO_V1(role_exists);
 PG_FUNCTION_INFO_V1(authinfo_valid);
 PG_FUNCTION_INFO_V1(poolinfo_valid);
@@ -990,6 +1021,375 @@ RelationIdForShard(uint64 shardId)
 }
 
 
+/*
+ * ShardHasColumnStatistics returns whether pg_dist_shard_column_stats has
+ * statistics for the given shard that can be used for pruning, and sets
+ * relationId to the relation of the shard in that case.
+ */
+bool
+ShardHasColumnStatistics(uint64 shardId, Oid *relationId)
+{
+	bool missingOk = true;
+	ShardIdCacheEntry *shardIdEntry = LookupShardIdCacheEntry(shardId, missingOk);
+	if (shardIdEntry == NULL)
+	{
+		return false;
+	}
+
+	CitusTableCacheEntry *tableEntry = shardIdEntry->tableEntry;
+	ShardColumnStatistics **statisticsArray = GetShardColumnStatisticsArray(tableEntry);
+	if (statisticsArray == NULL || statisticsArray[shardIdEntry->shardIndex] == NULL)
+	{
+		return false;
+	}
+
+	*relationId = tableEntry->relationId;
+	return true;
+}
+
+
+/*
+ * GetShardColumnStatisticsArray returns the statistics of the shards of the
+ * given table, indexed like its sortedShardIntervalArray, or NULL if none of
+ * the shards has statistics. The statistics are loaded from
+ * pg_dist_shard_column_stats on first use, since most tables do not have any.
+ */
+ShardColumnStatistics **
+GetShardColumnStatisticsArray(CitusTableCacheEntry *cacheEntry)
+{
+	if (!cacheEntry->shardColumnStatisticsLoaded)
+	{
+		LoadShardColumnStatistics(cacheEntry);
+	}
+
+	return cacheEntry->arrayOfShardColumnStatistics;
+}
+
+
+/*
+ * LoadShardColumnStatistics reads the statistics of the shards of the given
+ * table from pg_dist_shard_column_stats into the cache entry. Shards that have
+ * an invalidated statistics row do not get any statistics, and neither do
+ * the columns that were dropped or changed type since they were collected.
+ */
+static void
+LoadShardColumnStatistics(CitusTableCacheEntry *cacheEntry)
+{
+	Oid relationId = cacheEntry->relationId;
+	int shardCount = cacheEntry->shardIntervalArrayLength;
+
+	cacheEntry->arrayOfShardColumnStatistics = NULL;
+
+	/* the catalog does not exist before the extension is updated to 12.2 */
+	Oid statisticsRelationId = DistShardColumnStatsRelationId();
+	if (!OidIsValid(statisticsRelationId) || shardCount == 0)
+	{
+		cacheEntry->shardColumnStatisticsLoaded = true;
+		return;
+	}
+
+	if (cacheEntry->shardColumnStatisticsContext == NULL)
+	{
+		cacheEntry->shardColumnStatisticsContext =
+			AllocSetContextCreate(MetadataCacheMemoryContext,
+								  "ShardColumnStatisticsContext",
+								  ALLOCSET_SMALL_SIZES);
+	}
+	else
+	{
+		/* a previous attempt to load the statistics failed */
+		MemoryContextReset(cacheEntry->shardColumnStatisticsContext);
+	}
+
+	ShardColumnStatistics **statisticsArray = NULL;
+	bool *shardIsStale = palloc0(shardCount * sizeof(bool));
+	bool hasStatistics = false;
+
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+
+	Relation pgDistShardColumnStats = table_open(statisticsRelationId, AccessShareLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(pgDistShardColumnStats);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_shard_column_stats_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relationId));
+
+	SysScanDesc scanDescriptor =
+		systable_beginscan(pgDistShardColumnStats,
+						   DistShardColumnStatsPrimaryKeyIndexId(), indexOK,
+						   NULL, scanKeyCount, scanKey);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		Datum datumArray[Natts_pg_dist_shard_column_stats];
+		bool isNullArray[Natts_pg_dist_shard_column_stats];
+		bool foundInCache = false;
+
+		heap_deform_tuple(heapTuple, tupleDescriptor, datumArray, isNullArray);
+
+		uint64 shardId =
+			DatumGetInt64(datumArray[Anum_pg_dist_shard_column_stats_shardid - 1]);
+
+		/* skip the statistics of the shards that no longer belong to the table */
+		ShardIdCacheEntry *shardIdEntry =
+			hash_search(ShardIdCacheHash, &shardId, HASH_FIND, &foundInCache);
+		if (!foundInCache || shardIdEntry->tableEntry != cacheEntry)
+		{
+			continue;
+		}
+
+		int shardIndex = shardIdEntry->shardIndex;
+
+		if (isNullArray[Anum_pg_dist_shard_column_stats_row_count - 1] ||
+			isNullArray[Anum_pg_dist_shard_column_stats_null_count - 1])
+		{
+			/* a write invalidated the statistics of the shard */
+			shardIsStale[shardIndex] = true;
+			continue;
+		}
+
+		MemoryContext oldContext =
+			MemoryContextSwitchTo(cacheEntry->shardColumnStatisticsContext);
+
+		if (statisticsArray == NULL)
+		{
+			statisticsArray = palloc0(shardCount * sizeof(ShardColumnStatistics *));
+		}
+
+		ShardColumnStatistics *shardStatistics = statisticsArray[shardIndex];
+		if (shardStatistics == NULL)
+		{
+			shardStatistics = palloc0(sizeof(ShardColumnStatistics));
+			statisticsArray[shardIndex] = shardStatistics;
+		}
+
+		int64 rowCount =
+			DatumGetInt64(datumArray[Anum_pg_dist_shard_column_stats_row_count - 1]);
+		shardStatistics->rowCount = Max(shardStatistics->rowCount, rowCount);
+
+		ShardColumnValueRange *valueRange =
+			BuildShardColumnValueRange(relationId, datumArray, isNullArray);
+		if (valueRange != NULL)
+		{
+			shardStatistics->columnValueRangeList =
+				lappend(shardStatistics->columnValueRangeList, valueRange);
+		}
+
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistShardColumnStats, AccessShareLock);
+
+	for (int shardIndex = 0; statisticsArray != NULL && shardIndex < shardCount;
+		 shardIndex++)
+	{
+		if (shardIsStale[shardIndex])
+		{
+			statisticsArray[shardIndex] = NULL;
+		}
+
+		if (statisticsArray[shardIndex] != NULL)
+		{
+			hasStatistics = true;
+		}
+	}
+
+	pfree(shardIsStale);
+
+	if (hasStatistics)
+	{
+		cacheEntry->arrayOfShardColumnStatistics = statisticsArray;
+	}
+
+	cacheEntry->shardColumnStatisticsLoaded = true;
+}
+
+
+/*
+ * AsyncReplicationPrimaryGroupId returns the group of the placement that
+ * receives the modifications of the given reference table if it is
+ * replicated asynchronously, or INVALID_GROUP_ID otherwise. The group is
+ * loaded from pg_dist_async_reference_table on first use.
+ */
+int32
+AsyncReplicationPrimaryGroupId(CitusTableCacheEntry *cacheEntry)
+{
+	if (!cacheEntry->asyncReplicationLoaded)
+	{
+		LoadAsyncReplicationPrimaryGroupId(cacheEntry);
+	}
+
+	return cacheEntry->asyncReplicationPrimaryGroupId;
+}
+
+
+/*
+ * LoadAsyncReplicationPrimaryGroupId reads the primary group of the given
+ * table from pg_dist_async_reference_table into the cache entry.
+ */
+static void
+LoadAsyncReplicationPrimaryGroupId(CitusTableCacheEntry *cacheEntry)
+{
+	cacheEntry->asyncReplicationPrimaryGroupId = INVALID_GROUP_ID;
+
+	/* the catalog does not exist before the extension is updated to 12.2 */
+	Oid asyncReferenceTableRelationId = DistAsyncReferenceTableRelationId();
+	if (!OidIsValid(asyncReferenceTableRelationId) ||
+		!IsCitusTableTypeCacheEntry(cacheEntry, REFERENCE_TABLE))
+	{
+		cacheEntry->asyncReplicationLoaded = true;
+		return;
+	}
+
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+
+	Relation pgDistAsyncReferenceTable = table_open(asyncReferenceTableRelationId,
+													AccessShareLock);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_async_reference_table_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(cacheEntry->relationId));
+
+	SysScanDesc scanDescriptor =
+		systable_beginscan(pgDistAsyncReferenceTable,
+						   DistAsyncReferenceTablePrimaryKeyIndexId(), indexOK,
+						   NULL, scanKeyCount, scanKey);
+
+	HeapTuple heapTuple = systable_getnext(scanDescriptor);
+	if (HeapTupleIsValid(heapTuple))
+	{
+		Form_pg_dist_async_reference_table asyncReferenceTableForm =
+			(Form_pg_dist_async_reference_table) GETSTRUCT(heapTuple);
+
+		cacheEntry->asyncReplicationPrimaryGroupId =
+			asyncReferenceTableForm->primarygroupid;
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistAsyncReferenceTable, AccessShareLock);
+
+	cacheEntry->asyncReplicationLoaded = true;
+}
+
+
+/*
+ * BuildShardColumnValueRange builds the value range of a column from a
+ * pg_dist_shard_column_stats tuple, or returns NULL if the statistics cannot
+ * be used for the column as it is now.
+ */
+static ShardColumnValueRange *
+BuildShardColumnValueRange(Oid relationId, Datum *datumArray, bool *isNullArray)
+{
+	AttrNumber attributeNumber =
+		DatumGetInt16(datumArray[Anum_pg_dist_shard_column_stats_attnum - 1]);
+	Oid columnType =
+		DatumGetObjectId(datumArray[Anum_pg_dist_shard_column_stats_atttypid - 1]);
+	Oid columnCollation =
+		DatumGetObjectId(datumArray[Anum_pg_dist_shard_column_stats_attcollation - 1]);
+
+	HeapTuple attributeTuple = SearchSysCache2(ATTNUM, ObjectIdGetDatum(relationId),
+											   Int16GetDatum(attributeNumber));
+	if (!HeapTupleIsValid(attributeTuple))
+	{
+		return NULL;
+	}
+
+	Form_pg_attribute attributeForm = (Form_pg_attribute) GETSTRUCT(attributeTuple);
+	bool columnChanged = attributeForm->attisdropped ||
+						 attributeForm->atttypid != columnType ||
+						 attributeForm->attcollation != columnCollation;
+	int32 columnTypeMod = attributeForm->atttypmod;
+
+	ReleaseSysCache(attributeTuple);
+
+	/* the values were collected for a different column */
+	if (columnChanged)
+	{
+		return NULL;
+	}
+
+	Oid operatorClass = GetDefaultOpClass(columnType, BTREE_AM_OID);
+	if (!OidIsValid(operatorClass))
+	{
+		return NULL;
+	}
+
+	Oid operatorFamily = get_opclass_family(operatorClass);
+	Oid operatorInputType = get_opclass_input_type(operatorClass);
+	Oid greaterEqualOperator = get_opfamily_member(operatorFamily, operatorInputType,
+												   operatorInputType,
+												   BTGreaterEqualStrategyNumber);
+	Oid lessEqualOperator = get_opfamily_member(operatorFamily, operatorInputType,
+												operatorInputType,
+												BTLessEqualStrategyNumber);
+	if (!OidIsValid(greaterEqualOperator) || !OidIsValid(lessEqualOperator))
+	{
+		return NULL;
+	}
+
+	ShardColumnValueRange *valueRange = palloc0(sizeof(ShardColumnValueRange));
+	valueRange->attributeNumber = attributeNumber;
+	valueRange->columnType = columnType;
+	valueRange->columnTypeMod = columnTypeMod;
+	valueRange->columnCollation = columnCollation;
+	valueRange->hasNulls =
+		DatumGetInt64(datumArray[Anum_pg_dist_shard_column_stats_null_count - 1]) > 0;
+	valueRange->operatorInputType = operatorInputType;
+	valueRange->greaterEqualOperator = greaterEqualOperator;
+	valueRange->lessEqualOperator = lessEqualOperator;
+
+	if (!isNullArray[Anum_pg_dist_shard_column_stats_min_value - 1] &&
+		!isNullArray[Anum_pg_dist_shard_column_stats_max_value - 1])
+	{
+		/* polymorphic operators take the values as they are */
+		Oid constType = IsPolymorphicType(operatorInputType) ? columnType :
+						operatorInputType;
+		char *minValueString = TextDatumGetCString(
+			datumArray[Anum_pg_dist_shard_column_stats_min_value - 1]);
+		char *maxValueString = TextDatumGetCString(
+			datumArray[Anum_pg_dist_shard_column_stats_max_value - 1]);
+
+		valueRange->minValue = ShardColumnValueConst(minValueString, columnType,
+													 columnTypeMod, constType,
+													 columnCollation);
+		valueRange->maxValue = ShardColumnValueConst(maxValueString, columnType,
+													 columnTypeMod, constType,
+													 columnCollation);
+	}
+
+	return valueRange;
+}
+
+
+/*
+ * ShardColumnValueConst parses a minimum or maximum value of a column, as
+ * written by its type's output function, into a Const of the given type.
+ */
+static Const *
+ShardColumnValueConst(char *valueString, Oid columnType, int32 columnTypeMod,
+					  Oid constType, Oid columnCollation)
+{
+	Oid inputFunctionId = InvalidOid;
+	Oid typeIoParam = InvalidOid;
+	int16 typeLength = 0;
+	bool typeByValue = false;
+
+	getTypeInputInfo(columnType, &inputFunctionId, &typeIoParam);
+	get_typlenbyval(columnType, &typeLength, &typeByValue);
+
+	Datum value = OidInputFunctionCall(inputFunctionId, valueString, typeIoParam,
+									   columnTypeMod);
+
+	return makeConst(constType, -1, columnCollation, typeLength, value, false,
+					 typeByValue);
+}
+
+
 /*
  * ReferenceTableShardId returns true if the given shardId belongs to
  * a reference table.
@@ -1546,6 +1946,7 @@ LookupCitusTableCacheEntry(Oid relationId)
 	AcceptInvalidationMessages();
 	CitusTableCacheEntrySlot *cacheSlot =
 		hash_search(DistTableCacheHash, hashKey, HASH_ENTER, &foundInCache);
+	CitusTableCacheEntry *previousEntry = NULL;
 
 	/* return valid matches */
 	if (foundInCache)
@@ -1563,6 +1964,8 @@ LookupCitusTableCacheEntry(Oid relationId)
 
 			if (cacheSlot->citusTableMetadata)
 			{
+				previousEntry = cacheSlot->citusTableMetadata;
+
 				/*
 				 * The CitusTableCacheEntry might still be in use. We therefore do
 				 * not reset it until the end of the transaction.
@@ -1590,7 +1993,8 @@ LookupCitusTableCacheEntry(Oid relationId)
 	 */
 	HOLD_INTERRUPTS();
 
-	cacheSlot->citusTableMetadata = BuildCitusTableCacheEntry(relationId);
+	cacheSlot->citusTableMetadata = BuildCitusTableCacheEntry(relationId,
+															  previousEntry);
 
 	/*
 	 * Mark it as valid only after building the full entry, such that any
@@ -1713,9 +2117,11 @@ LookupDistObjectCacheEntry(Oid classid, Oid objid, int32 objsubid)
  * BuildCitusTableCacheEntry is a helper routine for
  * LookupCitusTableCacheEntry() for building the cache contents.
  * This function returns NULL if the relation isn't a distributed table.
+ * The previous entry of the relation, if any, is the invalidated entry that
+ * the new entry replaces.
  */
 static CitusTableCacheEntry *
-BuildCitusTableCacheEntry(Oid relationId)
+BuildCitusTableCacheEntry(Oid relationId, CitusTableCacheEntry *previousEntry)
 {
 	Relation pgDistPartition = table_open(DistPartitionRelationId(), AccessShareLock);
 	HeapTuple distPartitionTuple =
@@ -1801,7 +2207,7 @@ BuildCitusTableCacheEntry(Oid relationId)
 
 	heap_freetuple(distPartitionTuple);
 
-	BuildCachedShardList(cacheEntry);
+	BuildCachedShardList(cacheEntry, previousEntry);
 
 	/* we only need hash functions for hash distributed tables */
 	if (cacheEntry->partitionMethod == DISTRIBUTE_BY_HASH)
@@ -1849,9 +2255,15 @@ BuildCitusTableCacheEntry(Oid relationId)
 /*
  * BuildCachedShardList() is a helper routine for BuildCitusTableCacheEntry()
  * building up the list of shards in a distributed relation.
+ *
+ * If no transaction modified the shard list of the relation since the
+ * previous entry was built, we copy its sorted shards instead of reading
+ * pg_dist_shard, and only read the placements of the shards that were
+ * modified, such that moving a shard does not require reading all of them.
  */
 static void
-BuildCachedShardList(CitusTableCacheEntry *cacheEntry)
+BuildCachedShardList(CitusTableCacheEntry *cacheEntry,
+					 CitusTableCacheEntry *previousEntry)
 {
 	ShardInterval **shardIntervalArray = NULL;
 	ShardInterval **sortedShardIntervalArray = NULL;
@@ -1869,18 +2281,40 @@ BuildCachedShardList(CitusTableCacheEntry *cacheEntry)
 							  &intervalTypeId,
 							  &intervalTypeMod);
 
-	List *distShardTupleList = LookupDistShardTuples(cacheEntry->relationId);
-	int shardIntervalArrayLength = list_length(distShardTupleList);
-	if (shardIntervalArrayLength > 0)
-	{
-		Relation distShardRelation = table_open(DistShardRelationId(), AccessShareLock);
-		TupleDesc distShardTupleDesc = RelationGetDescr(distShardRelation);
-		int arrayIndex = 0;
+	SharedPlacementCacheVersion *shardListVersion = &cacheEntry->shardListVersion;
+	BeginSharedPlacementCacheRead(cacheEntry->relationId,
+								  EnableIncrementalShardListRebuild, shardListVersion);
 
+	bool reusePreviousShards = PreviousShardListReusable(cacheEntry, previousEntry);
+	int shardIntervalArrayLength = 0;
+
+	if (reusePreviousShards && previousEntry->shardIntervalArrayLength > 0)
+	{
+		shardIntervalArrayLength = previousEntry->shardIntervalArrayLength;
 		shardIntervalArray = MemoryContextAllocZero(MetadataCacheMemoryContext,
 													shardIntervalArrayLength *
 													sizeof(ShardInterval *));
 
+		MemoryContext oldContext = MemoryContextSwitchTo(MetadataCacheMemoryContext);
+
+		for (int shardIndex = 0; shardIndex < shardIntervalArrayLength; shardIndex++)
+		{
+			shardIntervalArray[shardIndex] =
+				CopyShardInterval(previousEntry->sortedShardIntervalArray[shardIndex]);
+		}
+
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	List *distShardTupleList = NIL;
+	if (!reusePreviousShards)
+	{
+		distShardTupleList = LookupDistShardTuples(cacheEntry->relationId);
+		shardIntervalArrayLength = list_length(distShardTupleList);
+	}
+
+	if (shardIntervalArrayLength > 0)
+	{
 		cacheEntry->arrayOfPlacementArrays =
 			MemoryContextAllocZero(MetadataCacheMemoryContext,
 								   shardIntervalArrayLength *
@@ -1890,6 +2324,24 @@ BuildCachedShardList(CitusTableCacheEntry *cacheEntry)
 								   shardIntervalArrayLength *
 								   sizeof(int));
 
+		if (shardListVersion->tracksShardModifications)
+		{
+			cacheEntry->arrayOfPlacementModificationCounters =
+				MemoryContextAllocZero(MetadataCacheMemoryContext,
+									   shardIntervalArrayLength * sizeof(uint64));
+		}
+	}
+
+	if (distShardTupleList != NIL)
+	{
+		Relation distShardRelation = table_open(DistShardRelationId(), AccessShareLock);
+		TupleDesc distShardTupleDesc = RelationGetDescr(distShardRelation);
+		int arrayIndex = 0;
+
+		shardIntervalArray = MemoryContextAllocZero(MetadataCacheMemoryContext,
+													shardIntervalArrayLength *
+													sizeof(ShardInterval *));
+
 		HeapTuple shardTuple = NULL;
 		foreach_ptr(shardTuple, distShardTupleList)
 		{
@@ -1941,9 +2393,19 @@ BuildCachedShardList(CitusTableCacheEntry *cacheEntry)
 		shardIntervalCompareFunction = NULL;
 	}
 
-	/* reference tables has a single shard which is not initialized */
-	if (cacheEntry->partitionMethod == DISTRIBUTE_BY_NONE)
+	if (reusePreviousShards)
+	{
+		/* the shards of the previous entry were already sorted and checked */
+		sortedShardIntervalArray = shardIntervalArray;
+
+		cacheEntry->hasUninitializedShardInterval =
+			previousEntry->hasUninitializedShardInterval;
+		cacheEntry->hasOverlappingShardInterval =
+			previousEntry->hasOverlappingShardInterval;
+	}
+	else if (cacheEntry->partitionMethod == DISTRIBUTE_BY_NONE)
 	{
+		/* reference tables has a single shard which is not initialized */
 		cacheEntry->hasUninitializedShardInterval = true;
 		cacheEntry->hasOverlappingShardInterval = true;
 
@@ -2020,21 +2482,51 @@ BuildCachedShardList(CitusTableCacheEntry *cacheEntry)
 		 */
 		cacheEntry->shardIntervalArrayLength++;
 
-		/* build list of shard placements */
-		List *placementList = BuildShardPlacementList(shardId);
-		int numberOfPlacements = list_length(placementList);
+		GroupShardPlacement *placementArray = NULL;
+		int numberOfPlacements = 0;
 
-		/* and copy that list into the cache entry */
-		MemoryContext oldContext = MemoryContextSwitchTo(MetadataCacheMemoryContext);
-		GroupShardPlacement *placementArray = palloc0(numberOfPlacements *
-													  sizeof(GroupShardPlacement));
-		GroupShardPlacement *srcPlacement = NULL;
-		foreach_ptr(srcPlacement, placementList)
+		if (shardListVersion->tracksShardModifications)
 		{
-			placementArray[placementOffset] = *srcPlacement;
-			placementOffset++;
+			cacheEntry->arrayOfPlacementModificationCounters[shardIndex] =
+				ShardModificationCounter(shardListVersion, shardId);
+		}
+
+		if (reusePreviousShards &&
+			previousEntry->arrayOfPlacementModificationCounters[shardIndex] ==
+			cacheEntry->arrayOfPlacementModificationCounters[shardIndex])
+		{
+			/* the placements did not change, copy them from the previous entry */
+			numberOfPlacements = previousEntry->arrayOfPlacementArrayLengths[shardIndex];
+			placementArray = MemoryContextAllocZero(MetadataCacheMemoryContext,
+													numberOfPlacements *
+													sizeof(GroupShardPlacement));
+
+			for (placementOffset = 0; placementOffset < numberOfPlacements;
+				 placementOffset++)
+			{
+				placementArray[placementOffset] =
+					previousEntry->arrayOfPlacementArrays[shardIndex][placementOffset];
+			}
+		}
+		else
+		{
+			/* build list of shard placements */
+			List *placementList = SharedCachedShardPlacementList(shardId,
+																 shardListVersion);
+			numberOfPlacements = list_length(placementList);
+
+			/* and copy that list into the cache entry */
+			MemoryContext oldContext =
+				MemoryContextSwitchTo(MetadataCacheMemoryContext);
+			placementArray = palloc0(numberOfPlacements * sizeof(GroupShardPlacement));
+			GroupShardPlacement *srcPlacement = NULL;
+			foreach_ptr(srcPlacement, placementList)
+			{
+				placementArray[placementOffset] = *srcPlacement;
+				placementOffset++;
+			}
+			MemoryContextSwitchTo(oldContext);
 		}
-		MemoryContextSwitchTo(oldContext);
 
 		cacheEntry->arrayOfPlacementArrays[shardIndex] = placementArray;
 		cacheEntry->arrayOfPlacementArrayLengths[shardIndex] = numberOfPlacements;
@@ -2045,6 +2537,46 @@ BuildCachedShardList(CitusTableCacheEntry *cacheEntry)
 
 	cacheEntry->shardColumnCompareFunction = shardColumnCompareFunction;
 	cacheEntry->shardIntervalCompareFunction = shardIntervalCompareFunction;
+
+	/* the counters of the shards are recorded, no need for the copy */
+	if (shardListVersion->shardCounters != NULL)
+	{
+		pfree(shardListVersion->shardCounters);
+		shardListVersion->shardCounters = NULL;
+	}
+}
+
+
+/*
+ * PreviousShardListReusable returns whether the shards of the previous cache
+ * entry of a relation can be used for the given entry that replaces it. That
+ * is the case when both were read at a version that tracks shard
+ * modifications and the shard list did not change in between.
+ */
+static bool
+PreviousShardListReusable(CitusTableCacheEntry *cacheEntry,
+						  CitusTableCacheEntry *previousEntry)
+{
+	if (previousEntry == NULL ||
+		!ShardListVersionUnchanged(&previousEntry->shardListVersion,
+								   &cacheEntry->shardListVersion))
+	{
+		return false;
+	}
+
+	if (previousEntry->partitionMethod != cacheEntry->partitionMethod)
+	{
+		return false;
+	}
+
+	if (previousEntry->partitionKeyString == NULL ||
+		cacheEntry->partitionKeyString == NULL)
+	{
+		return previousEntry->partitionKeyString == cacheEntry->partitionKeyString;
+	}
+
+	return strcmp(previousEntry->partitionKeyString,
+				  cacheEntry->partitionKeyString) == 0;
 }
 
 
@@ -2882,6 +3414,89 @@ DistCleanupPrimaryKeyIndexId(void)
 }
 
 
+/*
+ * DistShardColumnStatsRelationId returns the oid of the pg_dist_shard_column_stats
+ * relation, or InvalidOid if the extension was not yet updated to the version
+ * that introduced it.
+ */
+Oid
+DistShardColumnStatsRelationId(void)
+{
+	bool missingOk = true;
+	CachedRelationLookupExtended("pg_dist_shard_column_stats",
+								 &MetadataCache.distShardColumnStatsRelationId,
+								 missingOk);
+
+	return MetadataCache.distShardColumnStatsRelationId;
+}
+
+
+/* return oid of pg_dist_shard_column_stats primary key index */
+Oid
+DistShardColumnStatsPrimaryKeyIndexId(void)
+{
+	CachedRelationLookup("pg_dist_shard_column_stats_pkey",
+						 &MetadataCache.distShardColumnStatsPrimaryKeyIndexId);
+
+	return MetadataCache.distShardColumnStatsPrimaryKeyIndexId;
+}
+
+
+/*
+ * DistIngestionRelationId returns the oid of the pg_dist_ingestion table, or
+ * InvalidOid if the extension was not updated to a version that has it yet.
+ */
+Oid
+DistIngestionRelationId(void)
+{
+	bool missingOk = true;
+	CachedRelationLookupExtended("pg_dist_ingestion",
+								 &MetadataCache.distIngestionRelationId,
+								 missingOk);
+
+	return MetadataCache.distIngestionRelationId;
+}
+
+
+/* return oid of pg_dist_ingestion primary key index */
+Oid
+DistIngestionPrimaryKeyIndexId(void)
+{
+	CachedRelationLookup("pg_dist_ingestion_pkey",
+						 &MetadataCache.distIngestionPrimaryKeyIndexId);
+
+	return MetadataCache.distIngestionPrimaryKeyIndexId;
+}
+
+
+/*
+ * DistAsyncReferenceTableRelationId returns the oid of the
+ * pg_dist_async_reference_table table, or InvalidOid if the extension was not
+ * updated to a version that has it yet.
+ */
+Oid
+DistAsyncReferenceTableRelationId(void)
+{
+	bool missingOk = true;
+	CachedRelationLookupExtended("pg_dist_async_reference_table",
+								 &MetadataCache.distAsyncReferenceTableRelationId,
+								 missingOk);
+
+	return MetadataCache.distAsyncReferenceTableRelationId;
+}
+
+
+/* return oid of pg_dist_async_reference_table primary key index */
+Oid
+DistAsyncReferenceTablePrimaryKeyIndexId(void)
+{
+	CachedRelationLookup("pg_dist_async_reference_table_pkey",
+						 &MetadataCache.distAsyncReferenceTablePrimaryKeyIndexId);
+
+	return MetadataCache.distAsyncReferenceTablePrimaryKeyIndexId;
+}
+
+
 /* return oid of pg_dist_colocation relation */
 Oid
 DistColocationRelationId(void)
@@ -4114,6 +4729,31 @@ master_dist_object_cache_invalidate(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * citus_dist_schema_cache_invalidate is a trigger function that performs
+ * relcache invalidation when the contents of pg_dist_schema are changed on the
+ * SQL level, such as when the metadata of a worker is resynced.
+ *
+ * NB: We decided there is little point in checking permissions here, there
+ * are much easier ways to waste CPU than causing cache invalidations.
+ */
+Datum
+citus_dist_schema_cache_invalidate(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	if (!CALLED_AS_TRIGGER(fcinfo))
+	{
+		ereport(ERROR, (errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+						errmsg("must be called as trigger")));
+	}
+
+	CitusInvalidateRelcacheByRelid(DistTenantSchemaRelationId());
+
+	PG_RETURN_DATUM(PointerGetDatum(NULL));
+}
+
+
 /*
  * InitializeCaches() registers invalidation handlers for metadata_cache.c's
  * caches.
@@ -4601,6 +5241,22 @@ ResetCitusTableCacheEntry(CitusTableCacheEntry *cacheEntry)
 		cacheEntry->partitionColumn = NULL;
 	}
 
+	if (cacheEntry->shardColumnStatisticsContext != NULL)
+	{
+		MemoryContextDelete(cacheEntry->shardColumnStatisticsContext);
+		cacheEntry->shardColumnStatisticsContext = NULL;
+		cacheEntry->arrayOfShardColumnStatistics = NULL;
+		cacheEntry->shardColumnStatisticsLoaded = false;
+	}
+
+	cacheEntry->asyncReplicationLoaded = false;
+
+	if (cacheEntry->arrayOfPlacementModificationCounters != NULL)
+	{
+		pfree(cacheEntry->arrayOfPlacementModificationCounters);
+		cacheEntry->arrayOfPlacementModificationCounters = NULL;
+	}
+
 	if (cacheEntry->shardIntervalArrayLength == 0)
 	{
 		return;
@@ -4707,23 +5363,36 @@ RemoveStaleShardIdCacheEntries(CitusTableCacheEntry *invalidatedTableEntry)
 
 
 /*
- * InvalidateForeignRelationGraphCacheCallback invalidates the foreign key relation
- * graph and entire distributed cache entries.
+ * InvalidateForeignRelationGraphCacheCallback invalidates the entire distributed
+ * cache entries, which hold the foreign key relationships of the Citus tables,
+ * when InvalidateForeignKeyGraph is called.
+ *
+ * PostgreSQL invalidates the relcache entry of the referencing relation of a
+ * foreign key that changes, so for other relations it marks their foreign keys
+ * as changed, such that only their edges are re-read when the foreign key
+ * graph is used next rather than the whole graph.
  */
 static void
 InvalidateForeignRelationGraphCacheCallback(Datum argument, Oid relationId)
 {
 	if (relationId == MetadataCache.distColocationRelationId)
 	{
-		SetForeignConstraintRelationshipGraphInvalid();
 		InvalidateDistTableCache();
 	}
+	else
+	{
+		MarkForeignConstraintRelationshipsChanged(relationId);
+	}
 }
 
 
 /*
  * InvalidateForeignKeyGraph is used to invalidate the cached foreign key
  * graph (see ForeignKeyRelationGraph @ utils/foreign_key_relationship.c).
+ * The graph itself follows the relcache invalidations of the relations whose
+ * foreign keys change, which the command counter increment below processes,
+ * while the distributed cache entries that hold the foreign key relationships
+ * of Citus tables are invalidated as a whole.
  *
  * To invalidate the foreign key graph, we hack around relcache invalidation
  * callbacks. Given that there is no metadata table associated with the foreign
@@ -4767,12 +5436,36 @@ InvalidateDistRelationCacheCallback(Datum argument, Oid relationId)
 		InvalidateDistTableCache();
 		InvalidateDistObjectCache();
 		InvalidateMetadataSystemCache();
+		InvalidateRemotePreparedStatements();
+		InvalidateSharedPlacementCache();
+		InvalidateFunctionDelegationCache();
+		InvalidateTenantSchemaCache();
 	}
 	else
 	{
 		void *hashKey = (void *) &relationId;
 		bool foundInCache = false;
 
+		/*
+		 * We do not know whether other backends cached placements of the
+		 * table, so the shared cache is invalidated even if we did not.
+		 */
+		InvalidateSharedPlacementCacheForRelation(relationId);
+		InvalidateFunctionDelegationCacheForRelation(relationId);
+
+		/* changes to the catalog tables themselves, e.g. a TRUNCATE */
+		if (relationId == MetadataCache.distShardRelationId ||
+			relationId == MetadataCache.distPlacementRelationId)
+		{
+			InvalidateSharedPlacementCache();
+			SharedPlacementCacheRecordModification();
+		}
+
+		if (relationId == MetadataCache.distTenantSchemaRelationId)
+		{
+			InvalidateTenantSchemaCache();
+		}
+
 		if (DistTableCacheHash == NULL)
 		{
 			return;
@@ -4783,6 +5476,9 @@ InvalidateDistRelationCacheCallback(Datum argument, Oid relationId)
 		if (foundInCache)
 		{
 			InvalidateCitusTableCacheEntrySlot(cacheSlot);
+
+			/* the result types of the queries on the shards may have changed */
+			InvalidateRemotePreparedStatements();
 		}
 
 		/*
@@ -4796,12 +5492,14 @@ InvalidateDistRelationCacheCallback(Datum argument, Oid relationId)
 		if (relationId == MetadataCache.distPartitionRelationId)
 		{
 			InvalidateMetadataSystemCache();
+			InvalidateFunctionDelegationCache();
 		}
 
 
 		if (relationId == MetadataCache.distObjectRelationId)
 		{
 			InvalidateDistObjectCache();
+			InvalidateFunctionDelegationCache();
 		}
 	}
 }
@@ -5526,6 +6224,20 @@ RelationExists(Oid relationId)
  */
 void
 CitusInvalidateRelcacheByRelid(Oid relationId)
+{
+	/* our catalog scans now see uncommitted metadata */
+	SharedPlacementCacheRecordShardListModification(relationId);
+
+	InvalidateRelcacheByRelid(relationId);
+}
+
+
+/*
+ * InvalidateRelcacheByRelid registers a relcache invalidation for a
+ * non-shared relation, without recording a modification of its shard list.
+ */
+static void
+InvalidateRelcacheByRelid(Oid relationId)
 {
 	HeapTuple classTuple = SearchSysCache1(RELOID, ObjectIdGetDatum(relationId));
 
@@ -5547,6 +6259,10 @@ CitusInvalidateRelcacheByShardId(int64 shardId)
 	ScanKeyData scanKey[1];
 	int scanKeyCount = 1;
 	Form_pg_dist_shard shardForm = NULL;
+
+	/* only the placements of the shard changed */
+	SharedPlacementCacheRecordShardModification(shardId);
+
 	Relation pgDistShard = table_open(DistShardRelationId(), AccessShareLock);
 
 	/*
@@ -5567,7 +6283,7 @@ CitusInvalidateRelcacheByShardId(int64 shardId)
 	if (HeapTupleIsValid(heapTuple))
 	{
 		shardForm = (Form_pg_dist_shard) GETSTRUCT(heapTuple);
-		CitusInvalidateRelcacheByRelid(shardForm->logicalrelid);
+		InvalidateRelcacheByRelid(shardForm->logicalrelid);
 	}
 	else
 	{
@@ -97,6 +97,13 @@
 /* managed via a GUC */
 char *EnableManualMetadataChangesForUser = "";
 int MetadataSyncTransMode = METADATA_SYNC_TRANSACTIONAL;
+int MetadataSyncBatchSize = 1;
+
+/*
+ * DistributedSequenceCacheSize is the minimum number of values that each
+ * backend on a node caches from the sequences that Citus creates there.
+ */
+int DistributedSequenceCacheSize = 0;
 
 
 static void EnsureObjectMetadataIsSane(int distributionArgumentIndex,
@@ -140,6 +147,9 @@ static void EnsurePartitionMetadataIsSane(Oid relationId, char distributionMetho
 										  int colocationId, char replicationModel,
 										  Var *distributionKey);
 static void EnsureCitusInitiatedOperation(void);
+static void SendOrBatchCommandListToActivatedNodes(MetadataSyncContext *context,
+												   List *commands);
+static void FlushBatchedMetadataSyncCommands(MetadataSyncContext *context);
 static void EnsureShardMetadataIsSane(Oid relationId, int64 shardId, char storageType,
 									  text *shardMinValue,
 									  text *shardMaxValue);
@@ -321,8 +331,8 @@ CreateDependingViewsOnWorkers(Oid relationId)
 		char *createViewCommand = CreateViewDDLCommand(viewOid);
 		char *alterViewOwnerCommand = AlterViewOwnerCommand(viewOid);
 
-		SendCommandToWorkersWithMetadata(createViewCommand);
-		SendCommandToWorkersWithMetadata(alterViewOwnerCommand);
+		SendCommandListToWorkersWithMetadata(list_make2(createViewCommand,
+														alterViewOwnerCommand));
 
 		MarkObjectDistributed(viewAddress);
 	}
@@ -1461,8 +1471,6 @@ List *
 DDLCommandsForSequence(Oid sequenceOid, char *ownerName)
 {
 	List *sequenceDDLList = NIL;
-	char *sequenceDef = pg_get_sequencedef_string(sequenceOid);
-	char *escapedSequenceDef = quote_literal_cstr(sequenceDef);
 	StringInfo wrappedSequenceDef = makeStringInfo();
 	StringInfo sequenceGrantStmt = makeStringInfo();
 	char *sequenceName = generate_qualified_relation_name(sequenceOid);
@@ -1470,6 +1478,15 @@ DDLCommandsForSequence(Oid sequenceOid, char *ownerName)
 	Oid sequenceTypeOid = sequenceData->seqtypid;
 	char *typeName = format_type_be(sequenceTypeOid);
 
+	/*
+	 * Backends of the nodes draw values from a disjoint range of the sequence,
+	 * so caching more of them per backend only cuts the contention on the
+	 * sequence during bulk inserts.
+	 */
+	int64 cacheSize = Max(sequenceData->seqcache, DistributedSequenceCacheSize);
+	char *sequenceDef = pg_get_sequencedef_string_with_cache(sequenceOid, cacheSize);
+	char *escapedSequenceDef = quote_literal_cstr(sequenceDef);
+
 	/* create schema if needed */
 	appendStringInfo(wrappedSequenceDef,
 					 WORKER_APPLY_SEQUENCE_COMMAND,
@@ -2863,11 +2880,7 @@ CreateShellTableOnWorkers(Oid relationId)
 		commandList = lappend(commandList, GetTableDDLCommand(tableDDLCommand));
 	}
 
-	const char *command = NULL;
-	foreach_ptr(command, commandList)
-	{
-		SendCommandToWorkersWithMetadata(command);
-	}
+	SendCommandListToWorkersWithMetadata(commandList);
 }
 
 
@@ -2884,14 +2897,9 @@ CreateTableMetadataOnWorkers(Oid relationId)
 	List *commandList = CitusTableMetadataCreateCommandList(relationId);
 
 	/* prevent recursive propagation */
-	SendCommandToWorkersWithMetadata(DISABLE_DDL_PROPAGATION);
+	commandList = lcons(DISABLE_DDL_PROPAGATION, commandList);
 
-	/* send the commands one by one */
-	const char *command = NULL;
-	foreach_ptr(command, commandList)
-	{
-		SendCommandToWorkersWithMetadata(command);
-	}
+	SendCommandListToWorkersWithMetadata(commandList);
 }
 
 
@@ -4678,6 +4686,89 @@ SendOrCollectCommandListToActivatedNodes(MetadataSyncContext *context, List *com
 }
 
 
+/*
+ * SendOrBatchCommandListToActivatedNodes is used when syncing the catalog entries
+ * one by one (e.g. a table, a colocation group or a distributed object). When
+ * citus.metadata_sync_batch_size is above 1 and we send the commands, the commands
+ * are appended to the batch of the context instead and sent to the activated nodes
+ * once the batch holds the commands of that many entries. That way, activating a
+ * node in a cluster with many tables does not require a round-trip per entry.
+ *
+ * The caller should call FlushBatchedMetadataSyncCommands after the last entry.
+ */
+static void
+SendOrBatchCommandListToActivatedNodes(MetadataSyncContext *context, List *commands)
+{
+	if (commands == NIL)
+	{
+		return;
+	}
+
+	if (MetadataSyncBatchSize <= 1 || MetadataSyncCollectsCommands(context))
+	{
+		SendOrCollectCommandListToActivatedNodes(context, commands);
+		return;
+	}
+
+	/* the context of the sync is reset per entry, so keep the batch elsewhere */
+	if (context->batchContext == NULL)
+	{
+		context->batchContext = AllocSetContextCreate(TopTransactionContext,
+													  "metadata_sync_batch_context",
+													  ALLOCSET_DEFAULT_SIZES);
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(context->batchContext);
+
+	if (context->batchedCommands == NULL)
+	{
+		context->batchedCommands = makeStringInfo();
+	}
+
+	char *command = NULL;
+	foreach_ptr(command, commands)
+	{
+		if (context->batchedCommands->len > 0)
+		{
+			appendStringInfoChar(context->batchedCommands, ';');
+		}
+
+		appendStringInfoString(context->batchedCommands, command);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	context->batchedCommandListCount++;
+	if (context->batchedCommandListCount >= MetadataSyncBatchSize)
+	{
+		FlushBatchedMetadataSyncCommands(context);
+	}
+}
+
+
+/*
+ * FlushBatchedMetadataSyncCommands sends the commands batched by
+ * SendOrBatchCommandListToActivatedNodes to the activated nodes as a single
+ * command, which the nodes execute in a single (implicit) transaction in
+ * nontransactional mode.
+ */
+static void
+FlushBatchedMetadataSyncCommands(MetadataSyncContext *context)
+{
+	if (context->batchedCommandListCount == 0)
+	{
+		return;
+	}
+
+	List *commands = list_make1(context->batchedCommands->data);
+	SendOrCollectCommandListToActivatedNodes(context, commands);
+
+	MemoryContextReset(context->batchContext);
+	context->batchedCommands = NULL;
+	context->batchedCommandListCount = 0;
+}
+
+
 /*
  * SendOrCollectCommandListToMetadataNodes sends the commands to the metadata nodes with
  * bare connections inside metadatacontext or via coordinated connections.
@@ -5055,8 +5146,9 @@ SendColocationMetadataCommands(MetadataSyncContext *context)
 						 " = c.collnamespace)");
 
 		List *commandList = list_make1(colocationGroupCreateCommand->data);
-		SendOrCollectCommandListToActivatedNodes(context, commandList);
+		SendOrBatchCommandListToActivatedNodes(context, commandList);
 	}
+	FlushBatchedMetadataSyncCommands(context);
 	MemoryContextSwitchTo(oldContext);
 
 	systable_endscan(scanDesc);
@@ -5102,8 +5194,9 @@ SendTenantSchemaMetadataCommands(MetadataSyncContext *context)
 						 tenantSchemaForm->colocationid);
 
 		List *commandList = list_make1(insertTenantSchemaCommand->data);
-		SendOrCollectCommandListToActivatedNodes(context, commandList);
+		SendOrBatchCommandListToActivatedNodes(context, commandList);
 	}
+	FlushBatchedMetadataSyncCommands(context);
 	MemoryContextSwitchTo(oldContext);
 
 	systable_endscan(scanDesc);
@@ -5165,8 +5258,9 @@ SendDependencyCreationCommands(MetadataSyncContext *context)
 
 		/* dependency creation commands */
 		List *ddlCommands = GetAllDependencyCreateDDLCommands(list_make1(dependency));
-		SendOrCollectCommandListToActivatedNodes(context, ddlCommands);
+		SendOrBatchCommandListToActivatedNodes(context, ddlCommands);
 	}
+	FlushBatchedMetadataSyncCommands(context);
 	MemoryContextSwitchTo(oldContext);
 
 	if (!MetadataSyncCollectsCommands(context))
@@ -5220,8 +5314,9 @@ SendDistTableMetadataCommands(MetadataSyncContext *context)
 		}
 
 		List *commandList = CitusTableMetadataCreateCommandList(relationId);
-		SendOrCollectCommandListToActivatedNodes(context, commandList);
+		SendOrBatchCommandListToActivatedNodes(context, commandList);
 	}
+	FlushBatchedMetadataSyncCommands(context);
 	MemoryContextSwitchTo(oldContext);
 
 	systable_endscan(scanDesc);
@@ -5310,9 +5405,10 @@ SendDistObjectCommands(MetadataSyncContext *context)
 												list_make1_int(distributionArgumentIndex),
 												list_make1_int(colocationId),
 												list_make1_int(forceDelegation));
-		SendOrCollectCommandListToActivatedNodes(context,
-												 list_make1(workerMetadataUpdateCommand));
+		SendOrBatchCommandListToActivatedNodes(context,
+											   list_make1(workerMetadataUpdateCommand));
 	}
+	FlushBatchedMetadataSyncCommands(context);
 	MemoryContextSwitchTo(oldContext);
 
 	systable_endscan(scanDesc);
@@ -5370,8 +5466,9 @@ SendInterTableRelationshipCommands(MetadataSyncContext *context)
 		}
 
 		List *commandList = InterTableRelationshipOfRelationCommandList(relationId);
-		SendOrCollectCommandListToActivatedNodes(context, commandList);
+		SendOrBatchCommandListToActivatedNodes(context, commandList);
 	}
+	FlushBatchedMetadataSyncCommands(context);
 	MemoryContextSwitchTo(oldContext);
 
 	systable_endscan(scanDesc);
@@ -48,12 +48,14 @@
 
 #include "pg_version_constants.h"
 
+#include "distributed/async_reference_table.h"
 #include "distributed/background_jobs.h"
 #include "distributed/citus_nodes.h"
 #include "distributed/citus_safe_lib.h"
 #include "distributed/colocation_utils.h"
 #include "distributed/connection_management.h"
 #include "distributed/coordinator_protocol.h"
+#include "distributed/ingestion_progress.h"
 #include "distributed/listutils.h"
 #include "distributed/lock_graph.h"
 #include "distributed/metadata_cache.h"
@@ -74,7 +76,9 @@
 #include "distributed/relay_utility.h"
 #include "distributed/remote_commands.h"
 #include "distributed/resource_lock.h"
+#include "distributed/shard_column_statistics.h"
 #include "distributed/shard_rebalancer.h"
+#include "distributed/shard_size_cache.h"
 #include "distributed/tuplestore.h"
 #include "distributed/utils/array_type.h"
 #include "distributed/version_compat.h"
@@ -105,8 +109,15 @@ static char * GenerateSizeQueryForRelationNameList(List *quotedShardNames,
 static char * GetWorkerPartitionedSizeUDFNameBySizeQueryType(SizeQueryType sizeQueryType);
 static char * GetSizeQueryBySizeQueryType(SizeQueryType sizeQueryType);
 static char * GenerateAllShardStatisticsQueryForNode(WorkerNode *workerNode,
-													 List *citusTableIds);
-static List * GenerateShardStatisticsQueryList(List *workerNodeList, List *citusTableIds);
+													 List *citusTableIds,
+													 bool includeTableSize);
+static List * GenerateShardStatisticsQueryList(List *workerNodeList, List *citusTableIds,
+											   bool includeTableSize);
+static bool DistributedRelationSizeFromCache(Oid relationId,
+											 SizeQueryType sizeQueryType,
+											 uint64 *relationSize);
+static bool PutCachedShardSizes(List *citusTableIds, Tuplestorestate *tupleStore,
+								TupleDesc tupleDescriptor);
 static void ErrorIfNotSuitableToGetSize(Oid relationId);
 static List * OpenConnectionToNodes(List *workerNodeList);
 static void ReceiveShardIdAndSizeResults(List *connectionList,
@@ -119,6 +130,8 @@ static HeapTuple CreateDiskSpaceTuple(TupleDesc tupleDesc, uint64 availableBytes
 static bool GetLocalDiskSpaceStats(uint64 *availableBytes, uint64 *totalBytes);
 static BackgroundTask * DeformBackgroundTaskHeapTuple(TupleDesc tupleDescriptor,
 													  HeapTuple taskTuple);
+static BackgroundTask * LeastBusyRunnableBackgroundTask(SysScanDesc scanDescriptor,
+														TupleDesc tupleDescriptor);
 
 static bool SetFieldValue(int attno, Datum values[], bool isnull[], bool replace[],
 						  Datum newValue);
@@ -261,7 +274,8 @@ GetNodeDiskSpaceStatsForConnection(MultiConnection *connection, uint64 *availabl
 
 
 /*
- * citus_shard_sizes returns all shard ids and their sizes.
+ * citus_shard_sizes returns all shard ids and their sizes. The sizes are read
+ * from the shard size cache if it holds recent sizes of all placements.
  */
 Datum
 citus_shard_sizes(PG_FUNCTION_ARGS)
@@ -270,21 +284,100 @@ citus_shard_sizes(PG_FUNCTION_ARGS)
 
 	List *allCitusTableIds = AllCitusTableIds();
 
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+
+	if (PutCachedShardSizes(allCitusTableIds, tupleStore, tupleDescriptor))
+	{
+		PG_RETURN_VOID();
+	}
+
 	/* we don't need a distributed transaction here */
 	bool useDistributedTransaction = false;
 
 	List *connectionList =
 		SendShardStatisticsQueriesInParallel(allCitusTableIds, useDistributedTransaction);
 
-	TupleDesc tupleDescriptor = NULL;
-	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
-
 	ReceiveShardIdAndSizeResults(connectionList, tupleStore, tupleDescriptor);
 
 	PG_RETURN_VOID();
 }
 
 
+/*
+ * PutCachedShardSizes puts the shard id and the cached total relation size
+ * of all placements of the given tables on the active primary nodes into the
+ * tuple store, like ReceiveShardIdAndSizeResults. If the cache does not hold
+ * a recent size of any of the placements, it puts nothing and returns false.
+ */
+static bool
+PutCachedShardSizes(List *citusTableIds, Tuplestorestate *tupleStore,
+					TupleDesc tupleDescriptor)
+{
+	if (!ShardSizeCacheEnabled())
+	{
+		return false;
+	}
+
+	List *workerNodeList = ActivePrimaryNodeList(NoLock);
+	List *shardIdList = NIL;
+	List *shardSizeList = NIL;
+
+	Oid relationId = InvalidOid;
+	foreach_oid(relationId, citusTableIds)
+	{
+		/* skip tables that were dropped, like the size queries do */
+		Relation relation = try_relation_open(relationId, AccessShareLock);
+		if (relation == NULL)
+		{
+			continue;
+		}
+
+		relation_close(relation, AccessShareLock);
+
+		WorkerNode *workerNode = NULL;
+		foreach_ptr(workerNode, workerNodeList)
+		{
+			List *shardIntervalList = ShardIntervalsOnWorkerGroup(workerNode,
+																  relationId);
+
+			ShardInterval *shardInterval = NULL;
+			foreach_ptr(shardInterval, shardIntervalList)
+			{
+				uint64 shardSize = 0;
+
+				if (!GetCachedShardSize(shardInterval, workerNode->groupId,
+										TOTAL_RELATION_SIZE, &shardSize))
+				{
+					return false;
+				}
+
+				shardIdList = lappend(shardIdList,
+									  AllocateUint64(shardInterval->shardId));
+				shardSizeList = lappend(shardSizeList, AllocateUint64(shardSize));
+			}
+		}
+	}
+
+	uint64 *cachedShardId = NULL;
+	uint64 *cachedShardSize = NULL;
+	forboth_ptr(cachedShardId, shardIdList, cachedShardSize, shardSizeList)
+	{
+		Datum values[SHARD_SIZES_COLUMN_COUNT];
+		bool isNulls[SHARD_SIZES_COLUMN_COUNT];
+
+		memset(isNulls, false, sizeof(isNulls));
+
+		values[0] = Int64GetDatum(*cachedShardId);
+		values[1] = Int64GetDatum(*cachedShardSize);
+
+		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+	}
+
+	return true;
+}
+
+
 /*
  * citus_total_relation_size accepts a distributed table name and returns a distributed table
  * and its indexes' total relation size.
@@ -370,9 +463,27 @@ List *
 SendShardStatisticsQueriesInParallel(List *citusTableIds, bool useDistributedTransaction)
 {
 	List *workerNodeList = ActivePrimaryNodeList(NoLock);
+	bool includeTableSize = false;
 
+	return SendShardSizeQueriesToNodes(workerNodeList, citusTableIds,
+									   useDistributedTransaction, includeTableSize);
+}
+
+
+/*
+ * SendShardSizeQueriesToNodes sends a query to each of the given nodes that
+ * returns the shard id and the total relation size of each shard placement
+ * of the given tables on the node. If includeTableSize is true, the table
+ * size is returned between the two. It returns a connection per node, in the
+ * order of workerNodeList.
+ */
+List *
+SendShardSizeQueriesToNodes(List *workerNodeList, List *citusTableIds,
+							bool useDistributedTransaction, bool includeTableSize)
+{
 	List *shardSizesQueryList = GenerateShardStatisticsQueryList(workerNodeList,
-																 citusTableIds);
+																 citusTableIds,
+																 includeTableSize);
 
 	List *connectionList = OpenConnectionToNodes(workerNodeList);
 	FinishConnectionListEstablishment(connectionList);
@@ -440,14 +551,16 @@ OpenConnectionToNodes(List *workerNodeList)
  * shard_id, shard_name, shard_size for all shard placements on the node
  */
 static List *
-GenerateShardStatisticsQueryList(List *workerNodeList, List *citusTableIds)
+GenerateShardStatisticsQueryList(List *workerNodeList, List *citusTableIds,
+								 bool includeTableSize)
 {
 	List *shardStatisticsQueryList = NIL;
 	WorkerNode *workerNode = NULL;
 	foreach_ptr(workerNode, workerNodeList)
 	{
 		char *shardStatisticsQuery =
-			GenerateAllShardStatisticsQueryForNode(workerNode, citusTableIds);
+			GenerateAllShardStatisticsQueryForNode(workerNode, citusTableIds,
+												   includeTableSize);
 
 		shardStatisticsQueryList = lappend(shardStatisticsQueryList,
 										   shardStatisticsQuery);
@@ -557,6 +670,11 @@ DistributedRelationSize(Oid relationId, SizeQueryType sizeQueryType,
 
 	table_close(relation, AccessShareLock);
 
+	if (DistributedRelationSizeFromCache(relationId, sizeQueryType, relationSize))
+	{
+		return true;
+	}
+
 	List *workerNodeList = ActiveReadableNodeList();
 	WorkerNode *workerNode = NULL;
 	foreach_ptr(workerNode, workerNodeList)
@@ -580,6 +698,47 @@ DistributedRelationSize(Oid relationId, SizeQueryType sizeQueryType,
 }
 
 
+/*
+ * DistributedRelationSizeFromCache computes the size of a distributed table
+ * from the shard size cache, by summing the cached sizes of its placements on
+ * the same nodes as DistributedRelationSize. It returns false if the cache
+ * does not hold a recent size of any of the placements, and for indexes,
+ * partitioned tables and the size of the main fork, which are not cached.
+ */
+static bool
+DistributedRelationSizeFromCache(Oid relationId, SizeQueryType sizeQueryType,
+								 uint64 *relationSize)
+{
+	if (!ShardSizeCacheEnabled() || sizeQueryType == RELATION_SIZE ||
+		!IsCitusTable(relationId) || PartitionedTable(relationId))
+	{
+		return false;
+	}
+
+	uint64 sumOfSizes = 0;
+
+	List *workerNodeList = ActiveReadableNodeList();
+	WorkerNode *workerNode = NULL;
+	foreach_ptr(workerNode, workerNodeList)
+	{
+		List *shardIntervalList = ShardIntervalsOnWorkerGroup(workerNode, relationId);
+		uint64 relationSizeOnNode = 0;
+
+		if (!GetCachedShardListSize(shardIntervalList, workerNode->groupId,
+									sizeQueryType, &relationSizeOnNode))
+		{
+			return false;
+		}
+
+		sumOfSizes += relationSizeOnNode;
+	}
+
+	*relationSize = sumOfSizes;
+
+	return true;
+}
+
+
 /*
  * DistributedRelationSizeOnWorker gets the workerNode and relationId to calculate
  * size of that relation on the given workerNode by summing up the size of each
@@ -946,15 +1105,23 @@ GetSizeQueryBySizeQueryType(SizeQueryType sizeQueryType)
 
 /*
  * GenerateAllShardStatisticsQueryForNode generates a query that returns:
- * shard_id, shard_name, shard_size for all shard placements on the node
+ * shard_id, shard_name, shard_size for all shard placements on the node,
+ * with the table size of the shard before the shard_size if includeTableSize
+ * is true.
  */
 static char *
-GenerateAllShardStatisticsQueryForNode(WorkerNode *workerNode, List *citusTableIds)
+GenerateAllShardStatisticsQueryForNode(WorkerNode *workerNode, List *citusTableIds,
+									   bool includeTableSize)
 {
 	StringInfo allShardStatisticsQuery = makeStringInfo();
 	bool insertedValues = false;
 
 	appendStringInfoString(allShardStatisticsQuery, "SELECT shard_id, ");
+	if (includeTableSize)
+	{
+		appendStringInfo(allShardStatisticsQuery, PG_TABLE_SIZE_FUNCTION, "table_name");
+		appendStringInfoString(allShardStatisticsQuery, ", ");
+	}
 	appendStringInfo(allShardStatisticsQuery, PG_TOTAL_RELATION_SIZE_FUNCTION,
 					 "table_name");
 	appendStringInfoString(allShardStatisticsQuery, " FROM (VALUES ");
@@ -988,6 +1155,11 @@ GenerateAllShardStatisticsQueryForNode(WorkerNode *workerNode, List *citusTableI
 
 	if (!insertedValues)
 	{
+		if (includeTableSize)
+		{
+			return "SELECT 0 AS shard_id, 0 AS table_size, 0 AS total_size LIMIT 0";
+		}
+
 		return "SELECT 0 AS shard_id, '' AS table_name LIMIT 0";
 	}
 
@@ -2029,6 +2201,12 @@ DeletePartitionRow(Oid distributedRelationId)
 
 	systable_endscan(scanDescriptor);
 
+	/* bulk loads into the table can no longer be resumed */
+	DeleteIngestionProgressForRelation(distributedRelationId);
+
+	/* the table is no longer replicated asynchronously */
+	DeleteAsyncReferenceTableRow(distributedRelationId);
+
 	/* invalidate the cache */
 	CitusInvalidateRelcacheByRelid(distributedRelationId);
 
@@ -2073,6 +2251,8 @@ DeleteShardRow(uint64 shardId)
 
 	systable_endscan(scanDescriptor);
 
+	DeleteShardColumnStatistics(distributedRelationId, shardId);
+
 	/* invalidate previous cache entry */
 	CitusInvalidateRelcacheByRelid(distributedRelationId);
 
@@ -3546,6 +3726,11 @@ BackgroundTaskReadyToRun(BackgroundTask *task)
  * GetRunnableBackgroundTask returns the first candidate for a task to be run. When a task
  * is returned it has been checked for all the preconditions to hold.
  *
+ * When citus.background_task_balance_nodes is enabled, the candidate is instead the
+ * runnable task whose busiest involved node runs the least tasks. This starts tasks on
+ * idle nodes first, such that all nodes are kept busy rather than just the ones of the
+ * tasks with the lowest ids.
+ *
  * That means, if there is no task returned the background worker should close and let the
  * maintenance daemon start a new background tasks queue monitor once task become
  * available.
@@ -3580,7 +3765,14 @@ GetRunnableBackgroundTask(void)
 
 		HeapTuple taskTuple = NULL;
 		TupleDesc tupleDescriptor = RelationGetDescr(pgDistBackgroundTasks);
-		while (HeapTupleIsValid(taskTuple = systable_getnext(scanDescriptor)))
+
+		if (BackgroundTaskBalanceNodes)
+		{
+			task = LeastBusyRunnableBackgroundTask(scanDescriptor, tupleDescriptor);
+		}
+
+		while (!BackgroundTaskBalanceNodes &&
+			   HeapTupleIsValid(taskTuple = systable_getnext(scanDescriptor)))
 		{
 			task = DeformBackgroundTaskHeapTuple(tupleDescriptor, taskTuple);
 			if (BackgroundTaskReadyToRun(task) &&
@@ -3601,6 +3793,57 @@ GetRunnableBackgroundTask(void)
 }
 
 
+/*
+ * LeastBusyRunnableBackgroundTask returns the task of the given scan over runnable
+ * tasks that is ready to run and whose busiest involved node runs the fewest tasks,
+ * preferring the lowest task id among equally busy tasks. The parallel task counts
+ * of the nodes of the returned task are incremented. Returns NULL if no task can run.
+ */
+static BackgroundTask *
+LeastBusyRunnableBackgroundTask(SysScanDesc scanDescriptor, TupleDesc tupleDescriptor)
+{
+	BackgroundTask *leastBusyTask = NULL;
+	int leastBusyTaskCount = 0;
+
+	HeapTuple taskTuple = NULL;
+	while (HeapTupleIsValid(taskTuple = systable_getnext(scanDescriptor)))
+	{
+		BackgroundTask *task = DeformBackgroundTaskHeapTuple(tupleDescriptor,
+															 taskTuple);
+
+		int parallelTaskCount = ParallelTaskCountForNodesInvolved(task);
+		if (parallelTaskCount < 0 ||
+			(leastBusyTask != NULL && parallelTaskCount >= leastBusyTaskCount))
+		{
+			continue;
+		}
+
+		if (!BackgroundTaskReadyToRun(task))
+		{
+			continue;
+		}
+
+		leastBusyTask = task;
+		leastBusyTaskCount = parallelTaskCount;
+
+		if (leastBusyTaskCount == 0)
+		{
+			/* none of the nodes runs a task, we cannot do better */
+			break;
+		}
+	}
+
+	if (leastBusyTask != NULL &&
+		!IncrementParallelTaskCountForNodesInvolved(leastBusyTask))
+	{
+		/* cannot happen, we checked the limits above */
+		leastBusyTask = NULL;
+	}
+
+	return leastBusyTask;
+}
+
+
 /*
  * GetBackgroundJobByJobId loads a BackgroundJob from the catalog into memory. Return's a
  * null pointer if no job exist with the given JobId.
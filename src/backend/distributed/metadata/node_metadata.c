@@ -33,6 +33,7 @@
 #include "utils/rel.h"
 #include "utils/relcache.h"
 
+#include "distributed/async_reference_table.h"
 #include "distributed/citus_acquire_lock.h"
 #include "distributed/citus_safe_lib.h"
 #include "distributed/colocation_utils.h"
@@ -1981,6 +1982,7 @@ RemoveNodeFromCluster(char *nodeName, int32 nodePort)
 	if (NodeIsPrimary(workerNode))
 	{
 		ErrorIfNodeContainsNonRemovablePlacements(workerNode);
+		PrepareAsyncReferenceTableReplicaRemoval(workerNode);
 
 		/*
 		 * Delete reference table placements so they are not taken into account
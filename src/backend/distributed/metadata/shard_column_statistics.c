@@ -0,0 +1,973 @@
+/*-------------------------------------------------------------------------
+ *
+ * shard_column_statistics.c
+ *
+ * Functions for maintaining pg_dist_shard_column_stats, which holds the
+ * number of rows in the shards of a distributed table and the smallest and
+ * largest values of selected columns in each shard. The planner uses them to
+ * skip the shards that cannot have any rows matching the restrictions of a
+ * query, e.g. the shards of a sparse table that have no rows in the queried
+ * range of a created_at column.
+ *
+ * The statistics of a shard can only be used while they cover all of its
+ * rows. Therefore, the writes that Citus executes on this node invalidate the
+ * statistics of the shards that they modify, and the maintenance daemon
+ * recollects the invalidated statistics periodically. Writes that bypass the
+ * coordinator, such as writes from other nodes with metadata or writes into
+ * the shards themselves, are not tracked and require the statistics to be
+ * collected again with citus_collect_shard_column_statistics.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "miscadmin.h"
+
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/xact.h"
+#include "catalog/indexing.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_attribute.h"
+#include "catalog/pg_type.h"
+#include "commands/defrem.h"
+#include "executor/tuptable.h"
+#include "storage/lmgr.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/inval.h"
+#include "utils/lsyscache.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
+#include "utils/tuplestore.h"
+
+#include "distributed/argutils.h"
+#include "distributed/citus_nodes.h"
+#include "distributed/coordinator_protocol.h"
+#include "distributed/hash_helpers.h"
+#include "distributed/listutils.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/metadata_utility.h"
+#include "distributed/multi_executor.h"
+#include "distributed/multi_partitioning_utils.h"
+#include "distributed/multi_physical_planner.h"
+#include "distributed/pg_dist_shard_column_stats.h"
+#include "distributed/resource_lock.h"
+#include "distributed/shard_column_statistics.h"
+#include "distributed/tuple_destination.h"
+#include "distributed/worker_manager.h"
+
+
+/* number of values that the statistics query of a shard returns per column */
+#define STATISTICS_QUERY_VALUES_PER_COLUMN 3
+
+
+/*
+ * ShardValidColumnCount is an entry of the hash that counts the columns of a
+ * shard which have valid statistics.
+ */
+typedef struct ShardValidColumnCount
+{
+	uint64 shardId;
+	int validColumnCount;
+} ShardValidColumnCount;
+
+
+static void ErrorIfShardColumnStatisticsNotSupported(Oid relationId);
+static AttrNumber ShardStatisticsColumnAttributeNumber(Oid relationId, char *columnName);
+static bool ColumnSupportsShardStatistics(Oid relationId, AttrNumber attributeNumber);
+static List * TrackedAttributeNumberList(Oid relationId);
+static List * StaleShardIntervalList(Oid relationId, List *shardIntervalList,
+									 List *attributeNumberList);
+static List * ShardColumnStatisticsTaskList(Oid relationId, List *shardIntervalList,
+											List *attributeNumberList);
+static void StoreShardColumnStatisticsRow(Relation pgDistShardColumnStats,
+										  Oid relationId, uint64 shardId,
+										  AttrNumber attributeNumber, int64 rowCount,
+										  int64 nullCount, TupleTableSlot *slot,
+										  int minValueIndex, int maxValueIndex,
+										  TimestampTz collectedAt);
+static void MarkShardColumnStatisticsStale(Oid relationId, uint64 shardId);
+static void DeleteShardColumnStatisticsRows(Oid relationId, uint64 shardId,
+											AttrNumber attributeNumber);
+
+PG_FUNCTION_INFO_V1(citus_collect_shard_column_statistics);
+PG_FUNCTION_INFO_V1(citus_drop_shard_column_statistics);
+
+
+/*
+ * citus_collect_shard_column_statistics collects the number of rows and the
+ * minimum and maximum values of the given column in each shard of the given
+ * table, after which the column is considered for shard pruning and its
+ * statistics are kept up to date by the maintenance daemon. Without a column,
+ * the statistics of all columns that have statistics are collected again.
+ * With stale_only, only the invalidated statistics are collected.
+ *
+ * The function returns the number of shards whose statistics were collected.
+ */
+Datum
+citus_collect_shard_column_statistics(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+
+	PG_ENSURE_ARGNOTNULL(0, "table_name");
+	PG_ENSURE_ARGNOTNULL(2, "stale_only");
+
+	Oid relationId = PG_GETARG_OID(0);
+	bool staleOnly = PG_GETARG_BOOL(2);
+	List *attributeNumberList = NIL;
+
+	EnsureTableOwner(relationId);
+
+	/* block writes, see CollectShardColumnStatistics */
+	LockRelationOid(relationId, ShareRowExclusiveLock);
+
+	ErrorIfShardColumnStatisticsNotSupported(relationId);
+
+	if (!PG_ARGISNULL(1))
+	{
+		char *columnName = PG_GETARG_TEXT_TO_CSTRING(1);
+		AttrNumber attributeNumber =
+			ShardStatisticsColumnAttributeNumber(relationId, columnName);
+
+		attributeNumberList = list_make1_int(attributeNumber);
+	}
+
+	uint64 collectedShardCount =
+		CollectShardColumnStatistics(relationId, attributeNumberList, staleOnly);
+
+	PG_RETURN_INT64(collectedShardCount);
+}
+
+
+/*
+ * citus_drop_shard_column_statistics removes the statistics of the given
+ * column, or of all columns, of the given table, such that they are no longer
+ * used for shard pruning and no longer collected by the maintenance daemon.
+ */
+Datum
+citus_drop_shard_column_statistics(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+
+	PG_ENSURE_ARGNOTNULL(0, "table_name");
+
+	Oid relationId = PG_GETARG_OID(0);
+	AttrNumber attributeNumber = InvalidAttrNumber;
+
+	EnsureTableOwner(relationId);
+
+	/* the rows might otherwise be invalidated concurrently */
+	LockRelationOid(relationId, ShareRowExclusiveLock);
+
+	if (!PG_ARGISNULL(1))
+	{
+		char *columnName = PG_GETARG_TEXT_TO_CSTRING(1);
+
+		attributeNumber = get_attnum(relationId, columnName);
+		if (attributeNumber == InvalidAttrNumber)
+		{
+			ereport(ERROR, (errcode(ERRCODE_UNDEFINED_COLUMN),
+							errmsg("column \"%s\" of relation \"%s\" does not exist",
+								   columnName, get_rel_name(relationId))));
+		}
+	}
+
+	DeleteShardColumnStatisticsRows(relationId, INVALID_SHARD_ID, attributeNumber);
+
+	CitusInvalidateRelcacheByRelid(relationId);
+	CommandCounterIncrement();
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * ErrorIfShardColumnStatisticsNotSupported errors out if statistics cannot be
+ * collected for the shards of the given table.
+ */
+static void
+ErrorIfShardColumnStatisticsNotSupported(Oid relationId)
+{
+	if (!IsCitusTableType(relationId, DISTRIBUTED_TABLE))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("shard column statistics are only supported for "
+							   "distributed tables")));
+	}
+
+	/*
+	 * Writes into a partition would have to invalidate the statistics of the
+	 * shards of its parents and vice versa, which we do not track.
+	 */
+	if (PartitionedTable(relationId) || PartitionTable(relationId))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("shard column statistics are not supported for "
+							   "partitioned tables and partitions"),
+						errhint("Partition pruning already skips the partitions "
+								"that cannot match the restrictions of a query.")));
+	}
+}
+
+
+/*
+ * ShardStatisticsColumnAttributeNumber returns the attribute number of the
+ * column with the given name, and errors out if the column does not exist or
+ * its values cannot be used for shard pruning.
+ */
+static AttrNumber
+ShardStatisticsColumnAttributeNumber(Oid relationId, char *columnName)
+{
+	AttrNumber attributeNumber = get_attnum(relationId, columnName);
+	if (attributeNumber == InvalidAttrNumber)
+	{
+		ereport(ERROR, (errcode(ERRCODE_UNDEFINED_COLUMN),
+						errmsg("column \"%s\" of relation \"%s\" does not exist",
+							   columnName, get_rel_name(relationId))));
+	}
+
+	if (attributeNumber < 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot collect shard statistics for system column "
+							   "\"%s\"", columnName)));
+	}
+
+	if (!ColumnSupportsShardStatistics(relationId, attributeNumber))
+	{
+		Oid columnType = get_atttype(relationId, attributeNumber);
+
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot collect shard statistics for column \"%s\"",
+							   columnName),
+						errdetail("Type %s does not have a default btree operator "
+								  "class.", format_type_be(columnType))));
+	}
+
+	return attributeNumber;
+}
+
+
+/*
+ * ColumnSupportsShardStatistics returns whether the given column exists and
+ * its values can be compared with the restrictions of queries for pruning.
+ */
+static bool
+ColumnSupportsShardStatistics(Oid relationId, AttrNumber attributeNumber)
+{
+	HeapTuple attributeTuple = SearchSysCache2(ATTNUM, ObjectIdGetDatum(relationId),
+											   Int16GetDatum(attributeNumber));
+	if (!HeapTupleIsValid(attributeTuple))
+	{
+		return false;
+	}
+
+	Form_pg_attribute attributeForm = (Form_pg_attribute) GETSTRUCT(attributeTuple);
+	bool supported = !attributeForm->attisdropped &&
+					 OidIsValid(GetDefaultOpClass(attributeForm->atttypid,
+												  BTREE_AM_OID));
+
+	ReleaseSysCache(attributeTuple);
+
+	return supported;
+}
+
+
+/*
+ * CollectShardColumnStatistics collects the statistics of the given columns
+ * of the given table, or of the columns that already have statistics if the
+ * list is empty, in all shards or in the ones with invalidated or missing
+ * statistics, and returns the number of shards whose statistics were
+ * collected.
+ */
+uint64
+CollectShardColumnStatistics(Oid relationId, List *attributeNumberList, bool staleOnly)
+{
+	/*
+	 * Writes that run concurrently with reading the shards could be missed by
+	 * the statistics without invalidating them. We therefore block the writes
+	 * that go through this node until we commit. The ones that come after see
+	 * the new statistics, since they acquire their lock after we release ours.
+	 */
+	LockRelationOid(relationId, ShareRowExclusiveLock);
+
+	if (attributeNumberList == NIL)
+	{
+		attributeNumberList = TrackedAttributeNumberList(relationId);
+	}
+
+	List *shardIntervalList = LoadShardIntervalList(relationId);
+	if (staleOnly)
+	{
+		shardIntervalList = StaleShardIntervalList(relationId, shardIntervalList,
+												   attributeNumberList);
+	}
+
+	if (attributeNumberList == NIL || shardIntervalList == NIL)
+	{
+		return 0;
+	}
+
+	/* shard id and row count, followed by the values of each column */
+	int columnCount = list_length(attributeNumberList);
+	int resultColumnCount = 2 + columnCount * STATISTICS_QUERY_VALUES_PER_COLUMN;
+	TupleDesc tupleDescriptor = CreateTemplateTupleDesc(resultColumnCount);
+
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 1, "shardid", INT8OID, -1, 0);
+	TupleDescInitEntry(tupleDescriptor, (AttrNumber) 2, "row_count", INT8OID, -1, 0);
+
+	for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		AttrNumber firstResultColumn =
+			3 + columnIndex * STATISTICS_QUERY_VALUES_PER_COLUMN;
+
+		TupleDescInitEntry(tupleDescriptor, firstResultColumn, "value_count",
+						   INT8OID, -1, 0);
+		TupleDescInitEntry(tupleDescriptor, firstResultColumn + 1, "min_value",
+						   TEXTOID, -1, 0);
+		TupleDescInitEntry(tupleDescriptor, firstResultColumn + 2, "max_value",
+						   TEXTOID, -1, 0);
+	}
+
+	Tuplestorestate *tupleStore = tuplestore_begin_heap(false, false, work_mem);
+	TupleDestination *tupleDest = CreateTupleStoreTupleDest(tupleStore,
+															tupleDescriptor);
+	List *taskList = ShardColumnStatisticsTaskList(relationId, shardIntervalList,
+												   attributeNumberList);
+	bool expectResults = true;
+
+	ExecuteTaskListIntoTupleDest(ROW_MODIFY_READONLY, taskList, tupleDest,
+								 expectResults);
+
+	Relation pgDistShardColumnStats = table_open(DistShardColumnStatsRelationId(),
+												 RowExclusiveLock);
+	TimestampTz collectedAt = GetCurrentTimestamp();
+	TupleTableSlot *slot = MakeSingleTupleTableSlot(tupleDescriptor,
+													&TTSOpsMinimalTuple);
+	uint64 collectedShardCount = 0;
+
+	while (tuplestore_gettupleslot(tupleStore, true, false, slot))
+	{
+		slot_getallattrs(slot);
+
+		uint64 shardId = DatumGetInt64(slot->tts_values[0]);
+		int64 rowCount = DatumGetInt64(slot->tts_values[1]);
+		int valueIndex = 2;
+
+		int attributeNumber = 0;
+		foreach_int(attributeNumber, attributeNumberList)
+		{
+			int64 valueCount = DatumGetInt64(slot->tts_values[valueIndex]);
+
+			StoreShardColumnStatisticsRow(pgDistShardColumnStats, relationId, shardId,
+										  attributeNumber, rowCount,
+										  rowCount - valueCount, slot,
+										  valueIndex + 1, valueIndex + 2,
+										  collectedAt);
+
+			valueIndex += STATISTICS_QUERY_VALUES_PER_COLUMN;
+		}
+
+		collectedShardCount++;
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	tuplestore_end(tupleStore);
+	table_close(pgDistShardColumnStats, NoLock);
+
+	CitusInvalidateRelcacheByRelid(relationId);
+	CommandCounterIncrement();
+
+	return collectedShardCount;
+}
+
+
+/*
+ * TrackedAttributeNumberList returns the attribute numbers of the columns of
+ * the given table that have statistics, and removes the statistics of the
+ * columns that were dropped or whose type no longer supports them.
+ */
+static List *
+TrackedAttributeNumberList(Oid relationId)
+{
+	List *attributeNumberList = NIL;
+	List *unsupportedAttributeNumberList = NIL;
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+
+	Relation pgDistShardColumnStats = table_open(DistShardColumnStatsRelationId(),
+												 AccessShareLock);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_shard_column_stats_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relationId));
+
+	SysScanDesc scanDescriptor =
+		systable_beginscan(pgDistShardColumnStats,
+						   DistShardColumnStatsPrimaryKeyIndexId(), indexOK,
+						   NULL, scanKeyCount, scanKey);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		bool isNull = false;
+		Datum attributeNumberDatum = heap_getattr(heapTuple,
+												  Anum_pg_dist_shard_column_stats_attnum,
+												  RelationGetDescr(pgDistShardColumnStats),
+												  &isNull);
+		AttrNumber attributeNumber = DatumGetInt16(attributeNumberDatum);
+
+		if (list_member_int(attributeNumberList, attributeNumber) ||
+			list_member_int(unsupportedAttributeNumberList, attributeNumber))
+		{
+			continue;
+		}
+
+		if (ColumnSupportsShardStatistics(relationId, attributeNumber))
+		{
+			attributeNumberList = lappend_int(attributeNumberList, attributeNumber);
+		}
+		else
+		{
+			unsupportedAttributeNumberList =
+				lappend_int(unsupportedAttributeNumberList, attributeNumber);
+		}
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistShardColumnStats, NoLock);
+
+	int attributeNumber = 0;
+	foreach_int(attributeNumber, unsupportedAttributeNumberList)
+	{
+		DeleteShardColumnStatisticsRows(relationId, INVALID_SHARD_ID, attributeNumber);
+	}
+
+	return attributeNumberList;
+}
+
+
+/*
+ * StaleShardIntervalList returns the shards from the given list that do not
+ * have valid statistics for all of the given columns.
+ */
+static List *
+StaleShardIntervalList(Oid relationId, List *shardIntervalList,
+					   List *attributeNumberList)
+{
+	HTAB *validColumnCountHash = CreateSimpleHash(uint64, ShardValidColumnCount);
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+
+	Relation pgDistShardColumnStats = table_open(DistShardColumnStatsRelationId(),
+												 AccessShareLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(pgDistShardColumnStats);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_shard_column_stats_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relationId));
+
+	SysScanDesc scanDescriptor =
+		systable_beginscan(pgDistShardColumnStats,
+						   DistShardColumnStatsPrimaryKeyIndexId(), indexOK,
+						   NULL, scanKeyCount, scanKey);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		Datum datumArray[Natts_pg_dist_shard_column_stats];
+		bool isNullArray[Natts_pg_dist_shard_column_stats];
+		bool found = false;
+
+		heap_deform_tuple(heapTuple, tupleDescriptor, datumArray, isNullArray);
+
+		AttrNumber attributeNumber =
+			DatumGetInt16(datumArray[Anum_pg_dist_shard_column_stats_attnum - 1]);
+		if (isNullArray[Anum_pg_dist_shard_column_stats_row_count - 1] ||
+			!list_member_int(attributeNumberList, attributeNumber))
+		{
+			continue;
+		}
+
+		uint64 shardId =
+			DatumGetInt64(datumArray[Anum_pg_dist_shard_column_stats_shardid - 1]);
+		ShardValidColumnCount *validColumnCount =
+			hash_search(validColumnCountHash, &shardId, HASH_ENTER, &found);
+		if (!found)
+		{
+			validColumnCount->validColumnCount = 0;
+		}
+
+		validColumnCount->validColumnCount++;
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistShardColumnStats, NoLock);
+
+	List *staleShardIntervalList = NIL;
+	int columnCount = list_length(attributeNumberList);
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		bool found = false;
+		ShardValidColumnCount *validColumnCount =
+			hash_search(validColumnCountHash, &shardInterval->shardId, HASH_FIND,
+						&found);
+
+		if (!found || validColumnCount->validColumnCount < columnCount)
+		{
+			staleShardIntervalList = lappend(staleShardIntervalList, shardInterval);
+		}
+	}
+
+	hash_destroy(validColumnCountHash);
+
+	return staleShardIntervalList;
+}
+
+
+/*
+ * ShardColumnStatisticsTaskList returns a task for each of the given shards
+ * that returns the shard id, the number of rows in the shard and, for each of
+ * the given columns, the number of non-NULL values and the smallest and
+ * largest value as text.
+ */
+static List *
+ShardColumnStatisticsTaskList(Oid relationId, List *shardIntervalList,
+							  List *attributeNumberList)
+{
+	List *taskList = NIL;
+	uint32 taskId = 1;
+
+	StringInfo columnValuesString = makeStringInfo();
+
+	int attributeNumber = 0;
+	foreach_int(attributeNumber, attributeNumberList)
+	{
+		bool missingOk = false;
+		char *columnName = get_attname(relationId, attributeNumber, missingOk);
+		const char *quotedColumnName = quote_identifier(columnName);
+
+		appendStringInfo(columnValuesString,
+						 ", count(%s), min(%s)::text, max(%s)::text",
+						 quotedColumnName, quotedColumnName, quotedColumnName);
+	}
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		uint64 shardId = shardInterval->shardId;
+		StringInfo queryString = makeStringInfo();
+
+		appendStringInfo(queryString,
+						 "SELECT " UINT64_FORMAT "::bigint, count(*)%s FROM %s",
+						 shardId, columnValuesString->data,
+						 ConstructQualifiedShardName(shardInterval));
+
+		Task *task = CreateBasicTask(INVALID_JOB_ID, taskId, READ_TASK,
+									 queryString->data);
+
+		RelationShard *relationShard = CitusMakeNode(RelationShard);
+		relationShard->relationId = relationId;
+		relationShard->shardId = shardId;
+
+		task->anchorShardId = shardId;
+		task->relationShardList = list_make1(relationShard);
+		task->taskPlacementList = ActiveShardPlacementList(shardId);
+
+		taskList = lappend(taskList, task);
+		taskId++;
+	}
+
+	return taskList;
+}
+
+
+/*
+ * StoreShardColumnStatisticsRow inserts or updates the statistics of a column
+ * of a shard in pg_dist_shard_column_stats. The minimum and maximum values
+ * are taken from the given positions of the statistics query result in slot.
+ */
+static void
+StoreShardColumnStatisticsRow(Relation pgDistShardColumnStats, Oid relationId,
+							  uint64 shardId, AttrNumber attributeNumber,
+							  int64 rowCount, int64 nullCount, TupleTableSlot *slot,
+							  int minValueIndex, int maxValueIndex,
+							  TimestampTz collectedAt)
+{
+	Datum values[Natts_pg_dist_shard_column_stats];
+	bool isNulls[Natts_pg_dist_shard_column_stats];
+	bool replace[Natts_pg_dist_shard_column_stats];
+	Oid columnType = InvalidOid;
+	int32 columnTypeMod = -1;
+	Oid columnCollation = InvalidOid;
+	ScanKeyData scanKey[3];
+	int scanKeyCount = 3;
+	bool indexOK = true;
+
+	get_atttypetypmodcoll(relationId, attributeNumber, &columnType, &columnTypeMod,
+						  &columnCollation);
+
+	memset(values, 0, sizeof(values));
+	memset(isNulls, false, sizeof(isNulls));
+	memset(replace, true, sizeof(replace));
+
+	values[Anum_pg_dist_shard_column_stats_logicalrelid - 1] =
+		ObjectIdGetDatum(relationId);
+	values[Anum_pg_dist_shard_column_stats_shardid - 1] = Int64GetDatum(shardId);
+	values[Anum_pg_dist_shard_column_stats_attnum - 1] = Int16GetDatum(attributeNumber);
+	values[Anum_pg_dist_shard_column_stats_atttypid - 1] = ObjectIdGetDatum(columnType);
+	values[Anum_pg_dist_shard_column_stats_attcollation - 1] =
+		ObjectIdGetDatum(columnCollation);
+	values[Anum_pg_dist_shard_column_stats_row_count - 1] = Int64GetDatum(rowCount);
+	values[Anum_pg_dist_shard_column_stats_null_count - 1] = Int64GetDatum(nullCount);
+	values[Anum_pg_dist_shard_column_stats_min_value - 1] =
+		slot->tts_values[minValueIndex];
+	isNulls[Anum_pg_dist_shard_column_stats_min_value - 1] =
+		slot->tts_isnull[minValueIndex];
+	values[Anum_pg_dist_shard_column_stats_max_value - 1] =
+		slot->tts_values[maxValueIndex];
+	isNulls[Anum_pg_dist_shard_column_stats_max_value - 1] =
+		slot->tts_isnull[maxValueIndex];
+	values[Anum_pg_dist_shard_column_stats_collected_at - 1] =
+		TimestampTzGetDatum(collectedAt);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_shard_column_stats_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relationId));
+	ScanKeyInit(&scanKey[1], Anum_pg_dist_shard_column_stats_shardid,
+				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(shardId));
+	ScanKeyInit(&scanKey[2], Anum_pg_dist_shard_column_stats_attnum,
+				BTEqualStrategyNumber, F_INT2EQ, Int16GetDatum(attributeNumber));
+
+	SysScanDesc scanDescriptor =
+		systable_beginscan(pgDistShardColumnStats,
+						   DistShardColumnStatsPrimaryKeyIndexId(), indexOK,
+						   NULL, scanKeyCount, scanKey);
+
+	TupleDesc tupleDescriptor = RelationGetDescr(pgDistShardColumnStats);
+	HeapTuple heapTuple = systable_getnext(scanDescriptor);
+	if (HeapTupleIsValid(heapTuple))
+	{
+		HeapTuple newHeapTuple = heap_modify_tuple(heapTuple, tupleDescriptor, values,
+												   isNulls, replace);
+
+		CatalogTupleUpdate(pgDistShardColumnStats, &newHeapTuple->t_self,
+						   newHeapTuple);
+	}
+	else
+	{
+		HeapTuple newHeapTuple = heap_form_tuple(tupleDescriptor, values, isNulls);
+
+		CatalogTupleInsert(pgDistShardColumnStats, newHeapTuple);
+	}
+
+	systable_endscan(scanDescriptor);
+}
+
+
+/*
+ * TryRefreshStaleShardColumnStatistics collects the invalidated statistics of
+ * the given table for the maintenance daemon. It skips the table if it is
+ * being modified, rather than blocking the daemon, and reports errors as
+ * warnings. The function returns the number of shards whose statistics were
+ * collected.
+ */
+uint64
+TryRefreshStaleShardColumnStatistics(Oid relationId)
+{
+	uint64 collectedShardCount = 0;
+	MemoryContext savedContext = CurrentMemoryContext;
+
+	if (!ConditionalLockRelationOid(relationId, ShareRowExclusiveLock))
+	{
+		ereport(DEBUG1, (errmsg("skipping collecting shard column statistics of "
+								"relation %u, since it is being modified",
+								relationId)));
+		return 0;
+	}
+
+	/* the table might have been dropped in the meantime */
+	if (!IsCitusTable(relationId))
+	{
+		return 0;
+	}
+
+	/*
+	 * Start a subtransaction so we can rollback database's state to it in case
+	 * of error.
+	 */
+	BeginInternalSubTransaction(NULL);
+
+	PG_TRY();
+	{
+		bool staleOnly = true;
+		collectedShardCount = CollectShardColumnStatistics(relationId, NIL, staleOnly);
+
+		ReleaseCurrentSubTransaction();
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(savedContext);
+		ErrorData *edata = CopyErrorData();
+		FlushErrorState();
+
+		RollbackAndReleaseCurrentSubTransaction();
+
+		/* rethrow as WARNING */
+		edata->elevel = WARNING;
+		ThrowErrorData(edata);
+	}
+	PG_END_TRY();
+
+	return collectedShardCount;
+}
+
+
+/*
+ * RelationIdsWithStaleShardColumnStatistics returns the tables that have
+ * invalidated statistics in pg_dist_shard_column_stats.
+ */
+List *
+RelationIdsWithStaleShardColumnStatistics(void)
+{
+	List *relationIdList = NIL;
+	Oid statisticsRelationId = DistShardColumnStatsRelationId();
+
+	if (!OidIsValid(statisticsRelationId))
+	{
+		return NIL;
+	}
+
+	Relation pgDistShardColumnStats = table_open(statisticsRelationId, AccessShareLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(pgDistShardColumnStats);
+
+	SysScanDesc scanDescriptor = systable_beginscan(pgDistShardColumnStats, InvalidOid,
+													false, NULL, 0, NULL);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		bool isNull = false;
+
+		heap_getattr(heapTuple, Anum_pg_dist_shard_column_stats_row_count,
+					 tupleDescriptor, &isNull);
+		if (!isNull)
+		{
+			continue;
+		}
+
+		Datum relationIdDatum = heap_getattr(heapTuple,
+											 Anum_pg_dist_shard_column_stats_logicalrelid,
+											 tupleDescriptor, &isNull);
+
+		relationIdList = list_append_unique_oid(relationIdList,
+												DatumGetObjectId(relationIdDatum));
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistShardColumnStats, AccessShareLock);
+
+	return relationIdList;
+}
+
+
+/*
+ * InvalidateShardColumnStatisticsForTaskList invalidates the statistics of
+ * the shards that the given modification tasks write into.
+ */
+void
+InvalidateShardColumnStatisticsForTaskList(List *taskList)
+{
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		if (task->anchorShardId != INVALID_SHARD_ID)
+		{
+			InvalidateShardColumnStatistics(task->anchorShardId);
+		}
+	}
+}
+
+
+/*
+ * InvalidateShardColumnStatistics invalidates the statistics of the given
+ * shard, if it has any, since the current transaction writes into it. The
+ * statistics stay invalid until they are collected again.
+ */
+void
+InvalidateShardColumnStatistics(uint64 shardId)
+{
+	Oid relationId = InvalidOid;
+
+	if (!ShardHasColumnStatistics(shardId, &relationId))
+	{
+		return;
+	}
+
+	/*
+	 * Concurrent writers would otherwise try to update the same rows. The
+	 * ones that wait for us see our invalidation once we commit.
+	 */
+	LockShardColumnStatistics(shardId, ExclusiveLock);
+	AcceptInvalidationMessages();
+
+	if (!ShardHasColumnStatistics(shardId, &relationId))
+	{
+		return;
+	}
+
+	MarkShardColumnStatisticsStale(relationId, shardId);
+}
+
+
+/*
+ * MarkShardColumnStatisticsStale clears the statistics of the given shard in
+ * pg_dist_shard_column_stats, while keeping the rows around such that the
+ * maintenance daemon knows which columns to collect again.
+ */
+static void
+MarkShardColumnStatisticsStale(Oid relationId, uint64 shardId)
+{
+	Datum values[Natts_pg_dist_shard_column_stats];
+	bool isNulls[Natts_pg_dist_shard_column_stats];
+	bool replace[Natts_pg_dist_shard_column_stats];
+	ScanKeyData scanKey[2];
+	int scanKeyCount = 2;
+	bool indexOK = true;
+
+	memset(values, 0, sizeof(values));
+	memset(isNulls, false, sizeof(isNulls));
+	memset(replace, false, sizeof(replace));
+
+	isNulls[Anum_pg_dist_shard_column_stats_row_count - 1] = true;
+	replace[Anum_pg_dist_shard_column_stats_row_count - 1] = true;
+	isNulls[Anum_pg_dist_shard_column_stats_null_count - 1] = true;
+	replace[Anum_pg_dist_shard_column_stats_null_count - 1] = true;
+	isNulls[Anum_pg_dist_shard_column_stats_min_value - 1] = true;
+	replace[Anum_pg_dist_shard_column_stats_min_value - 1] = true;
+	isNulls[Anum_pg_dist_shard_column_stats_max_value - 1] = true;
+	replace[Anum_pg_dist_shard_column_stats_max_value - 1] = true;
+
+	Relation pgDistShardColumnStats = table_open(DistShardColumnStatsRelationId(),
+												 RowExclusiveLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(pgDistShardColumnStats);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_shard_column_stats_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relationId));
+	ScanKeyInit(&scanKey[1], Anum_pg_dist_shard_column_stats_shardid,
+				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(shardId));
+
+	SysScanDesc scanDescriptor =
+		systable_beginscan(pgDistShardColumnStats,
+						   DistShardColumnStatsPrimaryKeyIndexId(), indexOK,
+						   NULL, scanKeyCount, scanKey);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		bool rowCountIsNull = false;
+
+		heap_getattr(heapTuple, Anum_pg_dist_shard_column_stats_row_count,
+					 tupleDescriptor, &rowCountIsNull);
+		if (rowCountIsNull)
+		{
+			continue;
+		}
+
+		HeapTuple newHeapTuple = heap_modify_tuple(heapTuple, tupleDescriptor, values,
+												   isNulls, replace);
+
+		CatalogTupleUpdate(pgDistShardColumnStats, &newHeapTuple->t_self,
+						   newHeapTuple);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistShardColumnStats, NoLock);
+
+	CitusInvalidateRelcacheByRelid(relationId);
+	CommandCounterIncrement();
+}
+
+
+/*
+ * DeleteShardColumnStatistics removes the statistics of a shard that is
+ * being deleted.
+ */
+void
+DeleteShardColumnStatistics(Oid relationId, uint64 shardId)
+{
+	/* the catalog does not exist before the extension is updated to 12.2 */
+	if (!OidIsValid(DistShardColumnStatsRelationId()))
+	{
+		return;
+	}
+
+	/* wait for the writers that invalidate the statistics of the shard */
+	LockShardColumnStatistics(shardId, ExclusiveLock);
+
+	DeleteShardColumnStatisticsRows(relationId, shardId, InvalidAttrNumber);
+}
+
+
+/*
+ * DeleteShardColumnStatisticsRows deletes the pg_dist_shard_column_stats rows
+ * of the given table, limited to the given shard and column unless they are
+ * INVALID_SHARD_ID and InvalidAttrNumber.
+ */
+static void
+DeleteShardColumnStatisticsRows(Oid relationId, uint64 shardId,
+								AttrNumber attributeNumber)
+{
+	ScanKeyData scanKey[2];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+
+	Relation pgDistShardColumnStats = table_open(DistShardColumnStatsRelationId(),
+												 RowExclusiveLock);
+	TupleDesc tupleDescriptor = RelationGetDescr(pgDistShardColumnStats);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_shard_column_stats_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relationId));
+
+	if (shardId != INVALID_SHARD_ID)
+	{
+		ScanKeyInit(&scanKey[1], Anum_pg_dist_shard_column_stats_shardid,
+					BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(shardId));
+		scanKeyCount++;
+	}
+
+	SysScanDesc scanDescriptor =
+		systable_beginscan(pgDistShardColumnStats,
+						   DistShardColumnStatsPrimaryKeyIndexId(), indexOK,
+						   NULL, scanKeyCount, scanKey);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		if (attributeNumber != InvalidAttrNumber)
+		{
+			bool isNull = false;
+			Datum attributeNumberDatum =
+				heap_getattr(heapTuple, Anum_pg_dist_shard_column_stats_attnum,
+							 tupleDescriptor, &isNull);
+
+			if (DatumGetInt16(attributeNumberDatum) != attributeNumber)
+			{
+				continue;
+			}
+		}
+
+		CatalogTupleDelete(pgDistShardColumnStats, &heapTuple->t_self);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistShardColumnStats, NoLock);
+}
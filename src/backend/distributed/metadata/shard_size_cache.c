@@ -0,0 +1,629 @@
+/*-------------------------------------------------------------------------
+ *
+ * shard_size_cache.c
+ *   Shared memory cache for the sizes of shard placements.
+ *
+ *   citus_table_size, citus_total_relation_size and citus_shard_sizes (and
+ *   therefore citus_shards) query the size of every shard placement on all
+ *   nodes on each call, and the by_disk_size rebalance strategy queries the
+ *   size of each shard group it considers. On clusters with many shards that
+ *   are monitored by polling these functions, the fan-out dominates.
+ *
+ *   The maintenance daemon of the coordinator therefore collects the table
+ *   size and the total relation size of all placements every
+ *   citus.shard_size_cache_refresh_interval, and the functions above use the
+ *   collected sizes as long as they are not older than
+ *   citus.shard_size_cache_max_age. If the cache lacks a recent size of any
+ *   placement that a function needs, for instance because the shard was
+ *   created or moved since the last collection, the function falls back to
+ *   querying the nodes.
+ *
+ *   Shard IDs are only unique within a database and may be reused after a
+ *   table was dropped, hence cached sizes are keyed by database, group and
+ *   shard, and are only used for the table that they were collected for.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "libpq-fe.h"
+#include "miscadmin.h"
+
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
+
+#include "pg_version_constants.h"
+
+#include "distributed/hash_helpers.h"
+#include "distributed/listutils.h"
+#include "distributed/lock_graph.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/metadata_utility.h"
+#include "distributed/remote_commands.h"
+#include "distributed/shard_size_cache.h"
+#include "distributed/worker_manager.h"
+
+
+/* columns of the size queries: shard id, table size, total relation size */
+#define SHARD_SIZE_CACHE_QUERY_COLUMN_COUNT 3
+
+
+/* hash key of a cached placement size */
+typedef struct ShardSizeCacheKey
+{
+	Oid databaseId;
+	int32 groupId;
+	uint64 shardId;
+} ShardSizeCacheKey;
+
+
+/* the sizes of a shard placement and the time they were collected */
+typedef struct ShardSizeCacheEntry
+{
+	ShardSizeCacheKey key;
+
+	Oid relationId;
+	uint64 tableSize;
+	uint64 totalRelationSize;
+	TimestampTz collectedAt;
+} ShardSizeCacheEntry;
+
+
+/*
+ * The data structure used to store the lock of the cache in shared memory.
+ */
+typedef struct ShardSizeCacheSharedData
+{
+	int shardSizeCacheTrancheId;
+	char *shardSizeCacheTrancheName;
+
+	LWLock shardSizeCacheLock;
+} ShardSizeCacheSharedData;
+
+
+/* entry of the local hash that maps the refreshed shards to their tables */
+typedef struct ShardRelationEntry
+{
+	uint64 shardId;
+	Oid relationId;
+} ShardRelationEntry;
+
+
+/* GUC, size of the cache in kilobytes, 0 means no shared memory is used */
+int ShardSizeCacheSize = 0;
+
+/* GUC, age in milliseconds above which cached sizes are not used */
+int ShardSizeCacheMaxAge = 300000;
+
+
+/* the following two structs are used for accessing shared memory */
+static HTAB *ShardSizeCacheHash = NULL;
+static ShardSizeCacheSharedData *ShardSizeCacheSharedState = NULL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+/* local function declarations */
+static int ShardSizeCacheEntryCount(void);
+static HTAB * ShardRelationHash(List *citusTableIds);
+static List * ReceiveShardSizeCacheEntries(List *workerNodeList, List *connectionList,
+										   HTAB *shardRelationHash,
+										   TimestampTz collectedAt,
+										   List **collectedGroupIdList);
+static uint64 StoreShardSizeCacheEntries(List *entryList, List *collectedGroupIdList,
+										 HTAB *shardRelationHash, bool allTables);
+static bool CachedShardSizeUsable(ShardSizeCacheEntry *entry,
+								  ShardInterval *shardInterval,
+								  SizeQueryType sizeQueryType, TimestampTz now,
+								  uint64 *shardSize);
+static void InitShardSizeCacheKey(ShardSizeCacheKey *key, int32 groupId,
+								  uint64 shardId);
+
+
+PG_FUNCTION_INFO_V1(citus_refresh_shard_size_cache);
+
+
+/*
+ * citus_refresh_shard_size_cache collects the sizes of the shard placements
+ * of the given table, or of all Citus tables, into the shard size cache and
+ * returns the number of placements whose sizes were cached.
+ */
+Datum
+citus_refresh_shard_size_cache(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+
+	if (ShardSizeCacheHash == NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						errmsg("the shard size cache is disabled"),
+						errhint("Set citus.shard_size_cache_size to a positive value "
+								"and restart the server.")));
+	}
+
+	Oid relationId = InvalidOid;
+
+	if (!PG_ARGISNULL(0))
+	{
+		relationId = PG_GETARG_OID(0);
+
+		if (!IsCitusTable(relationId))
+		{
+			ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							errmsg("\"%s\" is not a Citus table",
+								   get_rel_name(relationId))));
+		}
+	}
+
+	uint64 cachedPlacementCount = RefreshShardSizeCache(relationId);
+
+	PG_RETURN_INT64(cachedPlacementCount);
+}
+
+
+/*
+ * ShardSizeCacheEnabled returns whether the size functions should look for
+ * sizes in the shard size cache.
+ */
+bool
+ShardSizeCacheEnabled(void)
+{
+	return ShardSizeCacheHash != NULL && ShardSizeCacheMaxAge > 0;
+}
+
+
+/*
+ * RefreshShardSizeCache collects the table size and the total relation size
+ * of all placements of the given table, or of all Citus tables if relationId
+ * is InvalidOid, on the active primary nodes and replaces their sizes in the
+ * cache. The cached sizes of nodes that could not be reached are kept, such
+ * that they are used until they are too old.
+ *
+ * The function returns the number of placements whose sizes were cached.
+ */
+uint64
+RefreshShardSizeCache(Oid relationId)
+{
+	if (ShardSizeCacheHash == NULL)
+	{
+		return 0;
+	}
+
+	bool allTables = !OidIsValid(relationId);
+	List *citusTableIds = allTables ? AllCitusTableIds() : list_make1_oid(relationId);
+	List *workerNodeList = ActivePrimaryNodeList(NoLock);
+
+	HTAB *shardRelationHash = ShardRelationHash(citusTableIds);
+
+	bool useDistributedTransaction = false;
+	bool includeTableSize = true;
+	List *connectionList = SendShardSizeQueriesToNodes(workerNodeList, citusTableIds,
+													   useDistributedTransaction,
+													   includeTableSize);
+
+	TimestampTz collectedAt = GetCurrentTimestamp();
+	List *collectedGroupIdList = NIL;
+	List *entryList = ReceiveShardSizeCacheEntries(workerNodeList, connectionList,
+												   shardRelationHash, collectedAt,
+												   &collectedGroupIdList);
+
+	uint64 cachedPlacementCount =
+		StoreShardSizeCacheEntries(entryList, collectedGroupIdList, shardRelationHash,
+								   allTables);
+
+	hash_destroy(shardRelationHash);
+
+	return cachedPlacementCount;
+}
+
+
+/*
+ * ShardRelationHash returns a hash that maps the shards of the given tables
+ * to their table.
+ */
+static HTAB *
+ShardRelationHash(List *citusTableIds)
+{
+	HTAB *shardRelationHash = CreateSimpleHashWithName(uint64, ShardRelationEntry,
+													   "Shard Size Cache Shards");
+
+	Oid relationId = InvalidOid;
+	foreach_oid(relationId, citusTableIds)
+	{
+		CitusTableCacheEntry *cacheEntry = LookupCitusTableCacheEntry(relationId);
+		if (cacheEntry == NULL)
+		{
+			/* the table was dropped concurrently */
+			continue;
+		}
+
+		for (int shardIndex = 0; shardIndex < cacheEntry->shardIntervalArrayLength;
+			 shardIndex++)
+		{
+			ShardInterval *shardInterval = cacheEntry->sortedShardIntervalArray[shardIndex];
+
+			ShardRelationEntry *shardRelationEntry =
+				hash_search(shardRelationHash, &shardInterval->shardId, HASH_ENTER, NULL);
+			shardRelationEntry->relationId = relationId;
+		}
+	}
+
+	return shardRelationHash;
+}
+
+
+/*
+ * ReceiveShardSizeCacheEntries receives the results of the size queries that
+ * were sent over the given connections, one per node in workerNodeList, and
+ * returns them as a list of cache entries. The groups of the nodes that
+ * returned sizes are appended to collectedGroupIdList.
+ */
+static List *
+ReceiveShardSizeCacheEntries(List *workerNodeList, List *connectionList,
+							 HTAB *shardRelationHash, TimestampTz collectedAt,
+							 List **collectedGroupIdList)
+{
+	List *entryList = NIL;
+
+	WorkerNode *workerNode = NULL;
+	MultiConnection *connection = NULL;
+	forboth_ptr(workerNode, workerNodeList, connection, connectionList)
+	{
+		bool raiseInterrupts = true;
+
+		if (PQstatus(connection->pgConn) != CONNECTION_OK)
+		{
+			continue;
+		}
+
+		PGresult *result = GetRemoteCommandResult(connection, raiseInterrupts);
+		if (!IsResponseOK(result))
+		{
+			ReportResultError(connection, result, WARNING);
+			PQclear(result);
+			ForgetResults(connection);
+			continue;
+		}
+
+		if (PQnfields(result) != SHARD_SIZE_CACHE_QUERY_COLUMN_COUNT)
+		{
+			ereport(WARNING, (errmsg("unexpected number of columns from the shard "
+									 "size query")));
+			PQclear(result);
+			ForgetResults(connection);
+			continue;
+		}
+
+		int64 rowCount = PQntuples(result);
+		for (int64 rowIndex = 0; rowIndex < rowCount; rowIndex++)
+		{
+			uint64 shardId = ParseIntField(result, rowIndex, 0);
+
+			ShardRelationEntry *shardRelationEntry =
+				hash_search(shardRelationHash, &shardId, HASH_FIND, NULL);
+			if (shardRelationEntry == NULL)
+			{
+				continue;
+			}
+
+			ShardSizeCacheEntry *entry = palloc0(sizeof(ShardSizeCacheEntry));
+			InitShardSizeCacheKey(&entry->key, workerNode->groupId, shardId);
+			entry->relationId = shardRelationEntry->relationId;
+			entry->tableSize = ParseIntField(result, rowIndex, 1);
+			entry->totalRelationSize = ParseIntField(result, rowIndex, 2);
+			entry->collectedAt = collectedAt;
+
+			entryList = lappend(entryList, entry);
+		}
+
+		*collectedGroupIdList = lappend_int(*collectedGroupIdList, workerNode->groupId);
+
+		PQclear(result);
+		ForgetResults(connection);
+	}
+
+	return entryList;
+}
+
+
+/*
+ * StoreShardSizeCacheEntries replaces the cached sizes of the refreshed
+ * shards on the nodes that returned sizes with the given entries, and returns
+ * the number of entries that fit into the cache. When all tables were
+ * refreshed, the sizes of shards that no longer exist are removed as well.
+ */
+static uint64
+StoreShardSizeCacheEntries(List *entryList, List *collectedGroupIdList,
+						   HTAB *shardRelationHash, bool allTables)
+{
+	uint64 storedEntryCount = 0;
+	bool cacheFull = false;
+
+	LWLockAcquire(&ShardSizeCacheSharedState->shardSizeCacheLock, LW_EXCLUSIVE);
+
+	HASH_SEQ_STATUS status;
+	ShardSizeCacheEntry *entry = NULL;
+
+	hash_seq_init(&status, ShardSizeCacheHash);
+	while ((entry = (ShardSizeCacheEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (entry->key.databaseId != MyDatabaseId ||
+			!list_member_int(collectedGroupIdList, entry->key.groupId))
+		{
+			continue;
+		}
+
+		if (allTables ||
+			hash_search(shardRelationHash, &entry->key.shardId, HASH_FIND, NULL) != NULL)
+		{
+			hash_search(ShardSizeCacheHash, &entry->key, HASH_REMOVE, NULL);
+		}
+	}
+
+	ShardSizeCacheEntry *newEntry = NULL;
+	foreach_ptr(newEntry, entryList)
+	{
+		bool found = false;
+
+		entry = hash_search(ShardSizeCacheHash, &newEntry->key, HASH_ENTER_NULL, &found);
+		if (entry == NULL)
+		{
+			cacheFull = true;
+			break;
+		}
+
+		*entry = *newEntry;
+		storedEntryCount++;
+	}
+
+	LWLockRelease(&ShardSizeCacheSharedState->shardSizeCacheLock);
+
+	if (cacheFull)
+	{
+		ereport(WARNING, (errmsg("the shard size cache can only hold the sizes of "
+								 UINT64_FORMAT " out of %d shard placements",
+								 storedEntryCount, list_length(entryList)),
+						  errhint("Increase citus.shard_size_cache_size.")));
+	}
+
+	return storedEntryCount;
+}
+
+
+/*
+ * GetCachedShardSize sets shardSize to the cached size of the placement of
+ * the given shard in the given group and returns true, or returns false if
+ * the cache does not hold a recent size of the placement.
+ */
+bool
+GetCachedShardSize(ShardInterval *shardInterval, int32 groupId,
+				   SizeQueryType sizeQueryType, uint64 *shardSize)
+{
+	return GetCachedShardListSize(list_make1(shardInterval), groupId, sizeQueryType,
+								  shardSize);
+}
+
+
+/*
+ * GetCachedShardListSize sets size to the sum of the cached sizes of the
+ * placements of the given shards in the given group and returns true, or
+ * returns false if the cache does not hold a recent size of any of them.
+ * Only table sizes and total relation sizes are cached.
+ */
+bool
+GetCachedShardListSize(List *shardIntervalList, int32 groupId,
+					   SizeQueryType sizeQueryType, uint64 *size)
+{
+	if (!ShardSizeCacheEnabled() || sizeQueryType == RELATION_SIZE)
+	{
+		return false;
+	}
+
+	TimestampTz now = GetCurrentTimestamp();
+	uint64 sumOfSizes = 0;
+	bool allSizesCached = true;
+
+	LWLockAcquire(&ShardSizeCacheSharedState->shardSizeCacheLock, LW_SHARED);
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		ShardSizeCacheKey key;
+		uint64 shardSize = 0;
+
+		InitShardSizeCacheKey(&key, groupId, shardInterval->shardId);
+
+		ShardSizeCacheEntry *entry = hash_search(ShardSizeCacheHash, &key, HASH_FIND,
+												 NULL);
+		if (!CachedShardSizeUsable(entry, shardInterval, sizeQueryType, now,
+								   &shardSize))
+		{
+			allSizesCached = false;
+			break;
+		}
+
+		sumOfSizes += shardSize;
+	}
+
+	LWLockRelease(&ShardSizeCacheSharedState->shardSizeCacheLock);
+
+	if (!allSizesCached)
+	{
+		return false;
+	}
+
+	*size = sumOfSizes;
+
+	return true;
+}
+
+
+/*
+ * CachedShardSizeUsable returns whether the given cache entry holds a size of
+ * the given shard that is recent enough to use, and sets shardSize to it.
+ */
+static bool
+CachedShardSizeUsable(ShardSizeCacheEntry *entry, ShardInterval *shardInterval,
+					  SizeQueryType sizeQueryType, TimestampTz now, uint64 *shardSize)
+{
+	if (entry == NULL || entry->relationId != shardInterval->relationId)
+	{
+		return false;
+	}
+
+	if (TimestampDifferenceExceeds(entry->collectedAt, now, ShardSizeCacheMaxAge))
+	{
+		return false;
+	}
+
+	if (sizeQueryType == TABLE_SIZE)
+	{
+		*shardSize = entry->tableSize;
+	}
+	else
+	{
+		Assert(sizeQueryType == TOTAL_RELATION_SIZE);
+		*shardSize = entry->totalRelationSize;
+	}
+
+	return true;
+}
+
+
+/*
+ * InitShardSizeCacheKey fills the hash key of the placement of the given shard
+ * in the given group of the current database. The key is zeroed first, since
+ * it is hashed and compared as a blob.
+ */
+static void
+InitShardSizeCacheKey(ShardSizeCacheKey *key, int32 groupId, uint64 shardId)
+{
+	memset(key, 0, sizeof(ShardSizeCacheKey));
+	key->databaseId = MyDatabaseId;
+	key->groupId = groupId;
+	key->shardId = shardId;
+}
+
+
+/*
+ * ShardSizeCacheEntryCount returns the number of placements that fit into the
+ * cache of size citus.shard_size_cache_size.
+ */
+static int
+ShardSizeCacheEntryCount(void)
+{
+	return (int) (((Size) ShardSizeCacheSize * 1024) / sizeof(ShardSizeCacheEntry));
+}
+
+
+/*
+ * InitializeShardSizeCache requests the necessary shared memory from Postgres
+ * and sets up the shared memory startup hook.
+ */
+void
+InitializeShardSizeCache(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(ShardSizeCacheShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = ShardSizeCacheShmemInit;
+}
+
+
+/*
+ * ShardSizeCacheShmemSize returns the size that should be allocated on the
+ * shared memory for the shard size cache.
+ */
+size_t
+ShardSizeCacheShmemSize(void)
+{
+	int entryCount = ShardSizeCacheEntryCount();
+	Size size = sizeof(ShardSizeCacheSharedData);
+
+	if (entryCount == 0)
+	{
+		return size;
+	}
+
+	Size hashSize = hash_estimate_size(entryCount, sizeof(ShardSizeCacheEntry));
+
+	size = add_size(size, hashSize);
+
+	return size;
+}
+
+
+/*
+ * ShardSizeCacheShmemInit initializes the shared memory used for caching the
+ * sizes of shard placements across backends.
+ */
+void
+ShardSizeCacheShmemInit(void)
+{
+	int entryCount = ShardSizeCacheEntryCount();
+	bool alreadyInitialized = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	ShardSizeCacheSharedState =
+		(ShardSizeCacheSharedData *) ShmemInitStruct(
+			"Shard Size Cache Data",
+			sizeof(ShardSizeCacheSharedData),
+			&alreadyInitialized);
+
+	if (!alreadyInitialized)
+	{
+		ShardSizeCacheSharedState->shardSizeCacheTrancheId = LWLockNewTrancheId();
+		ShardSizeCacheSharedState->shardSizeCacheTrancheName =
+			"Shard Size Cache Tranche";
+		LWLockRegisterTranche(ShardSizeCacheSharedState->shardSizeCacheTrancheId,
+							  ShardSizeCacheSharedState->shardSizeCacheTrancheName);
+
+		LWLockInitialize(&ShardSizeCacheSharedState->shardSizeCacheLock,
+						 ShardSizeCacheSharedState->shardSizeCacheTrancheId);
+	}
+
+	if (entryCount > 0)
+	{
+		HASHCTL info;
+
+		/* create (database, group, shard) -> sizes */
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(ShardSizeCacheKey);
+		info.entrysize = sizeof(ShardSizeCacheEntry);
+		uint32 hashFlags = (HASH_ELEM | HASH_BLOBS);
+
+		/* allocate hash table */
+		ShardSizeCacheHash =
+			ShmemInitHash("Shard Size Cache Hash", entryCount, entryCount,
+						  &info, hashFlags);
+
+		Assert(ShardSizeCacheHash != NULL);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+
+	Assert(ShardSizeCacheSharedState->shardSizeCacheTrancheId != 0);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
@@ -0,0 +1,730 @@
+/*-------------------------------------------------------------------------
+ *
+ * shared_placement_cache.c
+ *   Shared memory cache for the shard placements of distributed tables.
+ *   Every backend builds its own metadata cache entry for a table the first
+ *   time it uses the table, which requires a scan of pg_dist_placement for
+ *   each of its shards. For tables with many shards, and with many
+ *   short-lived connections, that dominates the cost of the first query of
+ *   a backend. Backends therefore share the placements they read.
+ *
+ *   The cache relies on the same relcache invalidations as the metadata
+ *   cache of each backend: whenever a backend processes an invalidation of
+ *   a table, it increments the counter of the table in shared memory, and
+ *   whenever it processes an invalidation of all relations, it increments a
+ *   global generation. Placements are stored along with the counters as
+ *   they were read before the catalog scan, and are only used while the
+ *   counters did not change. Since the invalidations of a transaction are
+ *   only sent after it committed, a backend that saw the new counter value
+ *   takes a catalog snapshot that sees the committed changes. The counters
+ *   are indexed by a hash of the relation, so different tables may share a
+ *   counter, which only causes some unnecessary cache misses.
+ *
+ *   A transaction that modified the metadata does not use the cache, since
+ *   its catalog scans see its own uncommitted changes.
+ *
+ *   We also keep counters that transactions which modified the shard list of
+ *   a table, or the placements of a single shard, increment when they commit,
+ *   before their invalidations are sent. A backend that rebuilds its cache
+ *   entry for a table after an invalidation can then keep the shards and the
+ *   placements of its previous entry that did not change. Prepared
+ *   transactions may be committed by any backend, hence a COMMIT PREPARED
+ *   disables such partial rebuilds until it incremented a separate counter.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+
+#include "access/xlog.h"
+#include "common/hashfn.h"
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
+
+#include "pg_version_constants.h"
+
+#include "distributed/listutils.h"
+#include "distributed/metadata_utility.h"
+#include "distributed/shared_placement_cache.h"
+
+
+/* maximum number of placements of a shard that is cached */
+#define SHARED_PLACEMENT_CACHE_MAX_PLACEMENTS 4
+
+/* number of invalidation counters that the tables map onto */
+#define SHARED_PLACEMENT_CACHE_COUNTER_COUNT 1024
+
+/* number of modification counters that the shards map onto */
+#define SHARED_PLACEMENT_CACHE_SHARD_COUNTER_COUNT 4096
+
+
+/* hash key of a cached shard, shard IDs are only unique within a database */
+typedef struct SharedPlacementCacheKey
+{
+	Oid databaseId;
+	uint64 shardId;
+} SharedPlacementCacheKey;
+
+
+/* the placements of a shard along with the version they were read at */
+typedef struct SharedPlacementCacheEntry
+{
+	SharedPlacementCacheKey key;
+
+	Oid relationId;
+	uint64 generation;
+	uint64 relationCounter;
+
+	int placementCount;
+	GroupShardPlacement placements[SHARED_PLACEMENT_CACHE_MAX_PLACEMENTS];
+} SharedPlacementCacheEntry;
+
+
+/*
+ * The data structure used to store the cache in shared memory. The hash is
+ * protected by the lock, the generation and the counters are atomic. The
+ * counters are allocated even when the cache itself is disabled.
+ */
+typedef struct SharedPlacementCacheSharedData
+{
+	int sharedPlacementCacheTrancheId;
+	char *sharedPlacementCacheTrancheName;
+
+	LWLock sharedPlacementCacheLock;
+
+	pg_atomic_uint64 generation;
+	pg_atomic_uint64 relationCounters[SHARED_PLACEMENT_CACHE_COUNTER_COUNT];
+
+	/* incremented by transactions that modified metadata, when they commit */
+	pg_atomic_uint64 shardListCounters[SHARED_PLACEMENT_CACHE_COUNTER_COUNT];
+	pg_atomic_uint64 shardCounters[SHARED_PLACEMENT_CACHE_SHARD_COUNTER_COUNT];
+
+	/* number of ongoing and completed COMMIT PREPARED commands */
+	pg_atomic_uint32 preparedCommitsInProgress;
+	pg_atomic_uint64 preparedCommitCounter;
+} SharedPlacementCacheSharedData;
+
+
+/* GUC, size of the cache in kilobytes, 0 means no shared memory is used */
+int SharedPlacementCacheSize = 0;
+
+
+/* the following two structs are used for accessing shared memory */
+static HTAB *SharedPlacementCacheHash = NULL;
+static SharedPlacementCacheSharedData *SharedPlacementCacheSharedState = NULL;
+
+/* whether the current transaction modified the metadata */
+static bool MetadataModifiedInTransaction = false;
+
+/*
+ * Shard list and shard modification counters of the current transaction,
+ * which we increment when the transaction commits. Allocated in the
+ * TopTransactionContext.
+ */
+static List *ModifiedShardListCounterIndexList = NIL;
+static List *ModifiedShardCounterIndexList = NIL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+/* local function declarations */
+static int SharedPlacementCacheEntryCount(void);
+static int RelationCounterIndex(Oid databaseId, Oid relationId);
+static int ShardCounterIndex(Oid databaseId, int64 shardId);
+static void RecordModifiedCounterIndex(List **counterIndexList, int counterIndex);
+static bool EntryMatchesCurrentVersion(SharedPlacementCacheEntry *cacheEntry);
+static void RemoveSharedPlacementCacheEntries(void);
+
+
+/*
+ * BeginSharedPlacementCacheRead is called before reading the shards and the
+ * placements of the given table and records the version of the table. To make
+ * sure that the metadata we read is at least as new as the version, we take
+ * a new catalog snapshot after reading the counters.
+ *
+ * If trackShardModifications is true, we also copy the shard modification
+ * counters, which the caller should free once it recorded the counters of
+ * its shards.
+ */
+void
+BeginSharedPlacementCacheRead(Oid relationId, bool trackShardModifications,
+							  SharedPlacementCacheVersion *version)
+{
+	memset(version, 0, sizeof(SharedPlacementCacheVersion));
+
+	if (SharedPlacementCacheSharedState == NULL || MetadataModifiedInTransaction)
+	{
+		return;
+	}
+
+	int counterIndex = RelationCounterIndex(MyDatabaseId, relationId);
+
+	version->relationId = relationId;
+	version->generation =
+		pg_atomic_read_u64(&SharedPlacementCacheSharedState->generation);
+	version->relationCounter = pg_atomic_read_u64(
+		&SharedPlacementCacheSharedState->relationCounters[counterIndex]);
+
+	/*
+	 * A standby replays metadata changes without running our commit hooks,
+	 * and while a COMMIT PREPARED is in progress we do not know which
+	 * shards it modifies. The number of commands in progress is read before
+	 * the counter, such that we notice commands that completed in between.
+	 */
+	if (trackShardModifications && !RecoveryInProgress() &&
+		pg_atomic_read_u32(&SharedPlacementCacheSharedState->
+						   preparedCommitsInProgress) == 0)
+	{
+		pg_memory_barrier();
+
+		version->preparedCommitCounter = pg_atomic_read_u64(
+			&SharedPlacementCacheSharedState->preparedCommitCounter);
+		version->shardListCounter = pg_atomic_read_u64(
+			&SharedPlacementCacheSharedState->shardListCounters[counterIndex]);
+
+		version->shardCounters =
+			palloc(SHARED_PLACEMENT_CACHE_SHARD_COUNTER_COUNT * sizeof(uint64));
+
+		for (int shardCounterIndex = 0;
+			 shardCounterIndex < SHARED_PLACEMENT_CACHE_SHARD_COUNTER_COUNT;
+			 shardCounterIndex++)
+		{
+			version->shardCounters[shardCounterIndex] = pg_atomic_read_u64(
+				&SharedPlacementCacheSharedState->shardCounters[shardCounterIndex]);
+		}
+
+		version->tracksShardModifications = true;
+	}
+
+	pg_memory_barrier();
+
+	InvalidateCatalogSnapshot();
+
+	version->usable = true;
+}
+
+
+/*
+ * SharedCachedShardPlacementList returns the placements of the given shard
+ * as a list of GroupShardPlacements, using the shared cache when the cached
+ * placements were read at the given version, and otherwise reading them from
+ * pg_dist_placement and adding them to the cache.
+ */
+List *
+SharedCachedShardPlacementList(int64 shardId, SharedPlacementCacheVersion *version)
+{
+	if (!version->usable || SharedPlacementCacheHash == NULL)
+	{
+		return BuildShardPlacementList(shardId);
+	}
+
+	SharedPlacementCacheKey key;
+	memset(&key, 0, sizeof(key));
+	key.databaseId = MyDatabaseId;
+	key.shardId = shardId;
+
+	List *placementList = NIL;
+	bool found = false;
+
+	LWLockAcquire(&SharedPlacementCacheSharedState->sharedPlacementCacheLock,
+				  LW_SHARED);
+
+	SharedPlacementCacheEntry *cacheEntry =
+		hash_search(SharedPlacementCacheHash, &key, HASH_FIND, &found);
+	if (found && cacheEntry->relationId == version->relationId &&
+		cacheEntry->generation == version->generation &&
+		cacheEntry->relationCounter == version->relationCounter)
+	{
+		for (int placementIndex = 0; placementIndex < cacheEntry->placementCount;
+			 placementIndex++)
+		{
+			GroupShardPlacement *placement = palloc0(sizeof(GroupShardPlacement));
+			*placement = cacheEntry->placements[placementIndex];
+
+			placementList = lappend(placementList, placement);
+		}
+
+		LWLockRelease(&SharedPlacementCacheSharedState->sharedPlacementCacheLock);
+
+		return placementList;
+	}
+
+	LWLockRelease(&SharedPlacementCacheSharedState->sharedPlacementCacheLock);
+
+	placementList = BuildShardPlacementList(shardId);
+	if (list_length(placementList) > SHARED_PLACEMENT_CACHE_MAX_PLACEMENTS)
+	{
+		return placementList;
+	}
+
+	LWLockAcquire(&SharedPlacementCacheSharedState->sharedPlacementCacheLock,
+				  LW_EXCLUSIVE);
+
+	cacheEntry = hash_search(SharedPlacementCacheHash, &key, HASH_ENTER_NULL, &found);
+	if (cacheEntry == NULL)
+	{
+		RemoveSharedPlacementCacheEntries();
+
+		cacheEntry = hash_search(SharedPlacementCacheHash, &key, HASH_ENTER_NULL,
+								 &found);
+	}
+
+	if (cacheEntry != NULL)
+	{
+		cacheEntry->relationId = version->relationId;
+		cacheEntry->generation = version->generation;
+		cacheEntry->relationCounter = version->relationCounter;
+		cacheEntry->placementCount = 0;
+
+		GroupShardPlacement *placement = NULL;
+		foreach_ptr(placement, placementList)
+		{
+			cacheEntry->placements[cacheEntry->placementCount] = *placement;
+			cacheEntry->placementCount++;
+		}
+	}
+
+	LWLockRelease(&SharedPlacementCacheSharedState->sharedPlacementCacheLock);
+
+	return placementList;
+}
+
+
+/*
+ * ShardListVersionUnchanged returns whether no transaction that modified the
+ * shard list of the table committed between the two versions, in which case
+ * the shards of the previous version can be kept, along with the placements
+ * of shards whose modification counter did not change.
+ */
+bool
+ShardListVersionUnchanged(SharedPlacementCacheVersion *previousVersion,
+						  SharedPlacementCacheVersion *version)
+{
+	return previousVersion->tracksShardModifications &&
+		   version->tracksShardModifications &&
+		   previousVersion->relationId == version->relationId &&
+		   previousVersion->generation == version->generation &&
+		   previousVersion->shardListCounter == version->shardListCounter &&
+		   previousVersion->preparedCommitCounter == version->preparedCommitCounter;
+}
+
+
+/*
+ * ShardModificationCounter returns the modification counter of the given shard
+ * at the given version, which should track shard modifications.
+ */
+uint64
+ShardModificationCounter(SharedPlacementCacheVersion *version, int64 shardId)
+{
+	Assert(version->shardCounters != NULL);
+
+	return version->shardCounters[ShardCounterIndex(MyDatabaseId, shardId)];
+}
+
+
+/*
+ * RemoveSharedPlacementCacheEntries makes room in the full cache by removing
+ * the entries that are no longer valid. If all entries are valid, we remove
+ * all of them, such that the cache follows the tables that are used now.
+ * The caller should hold the lock in exclusive mode.
+ */
+static void
+RemoveSharedPlacementCacheEntries(void)
+{
+	bool removeAll = true;
+	HASH_SEQ_STATUS status;
+	SharedPlacementCacheEntry *cacheEntry = NULL;
+
+	hash_seq_init(&status, SharedPlacementCacheHash);
+	while ((cacheEntry = hash_seq_search(&status)) != NULL)
+	{
+		if (!EntryMatchesCurrentVersion(cacheEntry))
+		{
+			hash_search(SharedPlacementCacheHash, &cacheEntry->key, HASH_REMOVE, NULL);
+			removeAll = false;
+		}
+	}
+
+	if (!removeAll)
+	{
+		return;
+	}
+
+	hash_seq_init(&status, SharedPlacementCacheHash);
+	while ((cacheEntry = hash_seq_search(&status)) != NULL)
+	{
+		hash_search(SharedPlacementCacheHash, &cacheEntry->key, HASH_REMOVE, NULL);
+	}
+}
+
+
+/*
+ * EntryMatchesCurrentVersion returns whether the placements in the given
+ * entry were read at the current version of their table.
+ */
+static bool
+EntryMatchesCurrentVersion(SharedPlacementCacheEntry *cacheEntry)
+{
+	int counterIndex = RelationCounterIndex(cacheEntry->key.databaseId,
+											cacheEntry->relationId);
+
+	return cacheEntry->generation ==
+		   pg_atomic_read_u64(&SharedPlacementCacheSharedState->generation) &&
+		   cacheEntry->relationCounter ==
+		   pg_atomic_read_u64(
+		&SharedPlacementCacheSharedState->relationCounters[counterIndex]);
+}
+
+
+/*
+ * InvalidateSharedPlacementCache invalidates all cached placements, which
+ * is called when a backend processes an invalidation of all relations, or
+ * of the catalog tables that the placements are read from.
+ */
+void
+InvalidateSharedPlacementCache(void)
+{
+	if (SharedPlacementCacheSharedState == NULL)
+	{
+		return;
+	}
+
+	pg_atomic_fetch_add_u64(&SharedPlacementCacheSharedState->generation, 1);
+}
+
+
+/*
+ * InvalidateSharedPlacementCacheForRelation invalidates the cached placements
+ * of the given table, which is called when a backend processes a relcache
+ * invalidation of the table.
+ */
+void
+InvalidateSharedPlacementCacheForRelation(Oid relationId)
+{
+	if (SharedPlacementCacheSharedState == NULL)
+	{
+		return;
+	}
+
+	int counterIndex = RelationCounterIndex(MyDatabaseId, relationId);
+
+	pg_atomic_fetch_add_u64(
+		&SharedPlacementCacheSharedState->relationCounters[counterIndex], 1);
+}
+
+
+/*
+ * SharedPlacementCacheRecordModification is called when the current
+ * transaction modifies the metadata, after which it no longer uses the cache.
+ */
+void
+SharedPlacementCacheRecordModification(void)
+{
+	MetadataModifiedInTransaction = true;
+}
+
+
+/*
+ * SharedPlacementCacheRecordShardListModification is called when the current
+ * transaction modifies the metadata of the given table, other than the
+ * placements of its shards.
+ */
+void
+SharedPlacementCacheRecordShardListModification(Oid relationId)
+{
+	MetadataModifiedInTransaction = true;
+
+	RecordModifiedCounterIndex(&ModifiedShardListCounterIndexList,
+							   RelationCounterIndex(MyDatabaseId, relationId));
+}
+
+
+/*
+ * SharedPlacementCacheRecordShardModification is called when the current
+ * transaction modifies the placements of the given shard.
+ */
+void
+SharedPlacementCacheRecordShardModification(int64 shardId)
+{
+	MetadataModifiedInTransaction = true;
+
+	RecordModifiedCounterIndex(&ModifiedShardCounterIndexList,
+							   ShardCounterIndex(MyDatabaseId, shardId));
+}
+
+
+/*
+ * RecordModifiedCounterIndex adds the given counter to the list of counters
+ * to increment when the transaction commits.
+ */
+static void
+RecordModifiedCounterIndex(List **counterIndexList, int counterIndex)
+{
+	if (SharedPlacementCacheSharedState == NULL ||
+		list_member_int(*counterIndexList, counterIndex))
+	{
+		return;
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(TopTransactionContext);
+
+	*counterIndexList = lappend_int(*counterIndexList, counterIndex);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * SharedPlacementCacheTransactionCommitted increments the counters of the
+ * metadata that the transaction modified. It is called after the transaction
+ * became visible to other transactions, and before its invalidations are
+ * sent, such that backends that process the invalidations see the new
+ * counters.
+ */
+void
+SharedPlacementCacheTransactionCommitted(void)
+{
+	int counterIndex = 0;
+	foreach_int(counterIndex, ModifiedShardListCounterIndexList)
+	{
+		pg_atomic_fetch_add_u64(
+			&SharedPlacementCacheSharedState->shardListCounters[counterIndex], 1);
+	}
+
+	foreach_int(counterIndex, ModifiedShardCounterIndexList)
+	{
+		pg_atomic_fetch_add_u64(
+			&SharedPlacementCacheSharedState->shardCounters[counterIndex], 1);
+	}
+
+	ResetSharedPlacementCacheModifications();
+}
+
+
+/*
+ * ResetSharedPlacementCacheModifications is called at the end of a
+ * transaction. Other backends notice the modifications of the transaction
+ * when they process its invalidations.
+ */
+void
+ResetSharedPlacementCacheModifications(void)
+{
+	MetadataModifiedInTransaction = false;
+	ModifiedShardListCounterIndexList = NIL;
+	ModifiedShardCounterIndexList = NIL;
+}
+
+
+/*
+ * BeginPreparedTransactionCommit is called before a COMMIT PREPARED, which
+ * may commit metadata changes of another backend without running its commit
+ * callbacks.
+ */
+void
+BeginPreparedTransactionCommit(void)
+{
+	if (SharedPlacementCacheSharedState == NULL)
+	{
+		return;
+	}
+
+	pg_atomic_fetch_add_u32(&SharedPlacementCacheSharedState->preparedCommitsInProgress,
+							1);
+}
+
+
+/*
+ * EndPreparedTransactionCommit is called after a COMMIT PREPARED, including
+ * when it failed. Metadata read before the command is then no longer
+ * considered up to date.
+ */
+void
+EndPreparedTransactionCommit(void)
+{
+	if (SharedPlacementCacheSharedState == NULL)
+	{
+		return;
+	}
+
+	pg_atomic_fetch_add_u64(&SharedPlacementCacheSharedState->preparedCommitCounter, 1);
+	pg_atomic_fetch_sub_u32(&SharedPlacementCacheSharedState->preparedCommitsInProgress,
+							1);
+}
+
+
+/*
+ * RelationCounterIndex returns the index of the invalidation counter of
+ * the given table.
+ */
+static int
+RelationCounterIndex(Oid databaseId, Oid relationId)
+{
+	uint32 relationHash = hash_combine(hash_uint32(databaseId),
+									   hash_uint32(relationId));
+
+	return relationHash % SHARED_PLACEMENT_CACHE_COUNTER_COUNT;
+}
+
+
+/*
+ * ShardCounterIndex returns the index of the modification counter of the
+ * given shard.
+ */
+static int
+ShardCounterIndex(Oid databaseId, int64 shardId)
+{
+	uint32 shardHash = hash_combine(hash_uint32(databaseId),
+									hash_bytes_uint32((uint32) shardId));
+
+	return shardHash % SHARED_PLACEMENT_CACHE_SHARD_COUNTER_COUNT;
+}
+
+
+/*
+ * SharedPlacementCacheEntryCount returns the number of shards that fit into
+ * the cache of size citus.shared_placement_cache_size.
+ */
+static int
+SharedPlacementCacheEntryCount(void)
+{
+	return (int) (((Size) SharedPlacementCacheSize * 1024) /
+				  sizeof(SharedPlacementCacheEntry));
+}
+
+
+/*
+ * InitializeSharedPlacementCache requests the necessary shared memory from
+ * Postgres and sets up the shared memory startup hook.
+ */
+void
+InitializeSharedPlacementCache(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(SharedPlacementCacheShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = SharedPlacementCacheShmemInit;
+}
+
+
+/*
+ * SharedPlacementCacheShmemSize returns the size that should be allocated on
+ * the shared memory for the counters and the cache.
+ */
+size_t
+SharedPlacementCacheShmemSize(void)
+{
+	int entryCount = SharedPlacementCacheEntryCount();
+	Size size = sizeof(SharedPlacementCacheSharedData);
+
+	if (entryCount == 0)
+	{
+		return size;
+	}
+
+	Size hashSize = hash_estimate_size(entryCount, sizeof(SharedPlacementCacheEntry));
+
+	size = add_size(size, hashSize);
+
+	return size;
+}
+
+
+/*
+ * SharedPlacementCacheShmemInit initializes the shared memory used for
+ * caching shard placements across backends.
+ */
+void
+SharedPlacementCacheShmemInit(void)
+{
+	int entryCount = SharedPlacementCacheEntryCount();
+	bool alreadyInitialized = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	SharedPlacementCacheSharedState =
+		(SharedPlacementCacheSharedData *) ShmemInitStruct(
+			"Shared Placement Cache Data",
+			sizeof(SharedPlacementCacheSharedData),
+			&alreadyInitialized);
+
+	if (!alreadyInitialized)
+	{
+		SharedPlacementCacheSharedState->sharedPlacementCacheTrancheId =
+			LWLockNewTrancheId();
+		SharedPlacementCacheSharedState->sharedPlacementCacheTrancheName =
+			"Shared Placement Cache Tranche";
+		LWLockRegisterTranche(
+			SharedPlacementCacheSharedState->sharedPlacementCacheTrancheId,
+			SharedPlacementCacheSharedState->sharedPlacementCacheTrancheName);
+
+		LWLockInitialize(&SharedPlacementCacheSharedState->sharedPlacementCacheLock,
+						 SharedPlacementCacheSharedState->sharedPlacementCacheTrancheId);
+
+		pg_atomic_init_u64(&SharedPlacementCacheSharedState->generation, 0);
+
+		for (int counterIndex = 0; counterIndex < SHARED_PLACEMENT_CACHE_COUNTER_COUNT;
+			 counterIndex++)
+		{
+			pg_atomic_init_u64(
+				&SharedPlacementCacheSharedState->relationCounters[counterIndex], 0);
+			pg_atomic_init_u64(
+				&SharedPlacementCacheSharedState->shardListCounters[counterIndex], 0);
+		}
+
+		for (int counterIndex = 0;
+			 counterIndex < SHARED_PLACEMENT_CACHE_SHARD_COUNTER_COUNT;
+			 counterIndex++)
+		{
+			pg_atomic_init_u64(
+				&SharedPlacementCacheSharedState->shardCounters[counterIndex], 0);
+		}
+
+		pg_atomic_init_u32(&SharedPlacementCacheSharedState->preparedCommitsInProgress,
+						   0);
+		pg_atomic_init_u64(&SharedPlacementCacheSharedState->preparedCommitCounter, 0);
+	}
+
+	if (entryCount > 0)
+	{
+		HASHCTL info;
+
+		/* create (database, shard) -> placements */
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(SharedPlacementCacheKey);
+		info.entrysize = sizeof(SharedPlacementCacheEntry);
+		uint32 hashFlags = (HASH_ELEM | HASH_BLOBS);
+
+		/* allocate hash table */
+		SharedPlacementCacheHash =
+			ShmemInitHash("Shared Placement Cache Hash", entryCount, entryCount,
+						  &info, hashFlags);
+
+		Assert(SharedPlacementCacheHash != NULL);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+
+	Assert(SharedPlacementCacheSharedState->sharedPlacementCacheTrancheId != 0);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
@@ -69,17 +69,44 @@
 #include "distributed/worker_transaction.h"
 
 
+/*
+ * DropShardBatch is a list of shards that are dropped by a single command
+ * over a connection.
+ */
+typedef struct DropShardBatch
+{
+	MultiConnection *connection;
+	char storageType;
+	StringInfo quotedShardNames;
+} DropShardBatch;
+
+/*
+ * Memory context of the deferred shard drops, which is not NULL while the
+ * remote drops of shards are deferred, see BeginShardDropBatch.
+ */
+static MemoryContext ShardDropBatchContext = NULL;
+
+/* deferred shard drops of the current batch */
+static List *DeferredDropShardBatchList = NIL;
+
+
 /* Local functions forward declarations */
 static int DropShards(Oid relationId, char *schemaName, char *relationName,
 					  List *deletableShardIntervalList, bool dropShardsMetadataOnly);
 static List * DropTaskList(Oid relationId, char *schemaName, char *relationName,
 						   List *deletableShardIntervalList);
-static void ExecuteDropShardPlacementCommandRemotely(ShardPlacement *shardPlacement,
-													 const char *shardRelationName,
-													 const char *dropShardPlacementCommand);
+static MultiConnection * GetDropShardPlacementConnection(ShardPlacement *shardPlacement,
+														 const char *relationName);
+static List * AddShardToDropShardBatch(List *dropShardBatchList,
+									   MultiConnection *connection,
+									   const char *schemaName, const char *relationName,
+									   ShardInterval *shardInterval);
+static void ExecuteDropShardBatchList(List *dropShardBatchList);
+static void DeferDropShardBatchList(List *dropShardBatchList);
 static char * CreateDropShardPlacementCommand(const char *schemaName,
 											  const char *shardRelationName,
 											  char storageType);
+static char * CreateDropShardListCommand(const char *quotedShardNames, char storageType);
 
 
 /* exports for SQL callable functions */
@@ -249,8 +276,12 @@ DropShards(Oid relationId, char *schemaName, char *relationName,
 									  deletableShardIntervalList);
 	bool shouldExecuteTasksLocally = ShouldExecuteTasksLocally(dropTaskList);
 
+	/* DROP commands for the remote placements, batched per connection */
+	List *dropShardBatchList = NIL;
+
 	Task *task = NULL;
-	foreach_ptr(task, dropTaskList)
+	ShardInterval *shardInterval = NULL;
+	forboth_ptr(task, dropTaskList, shardInterval, deletableShardIntervalList)
 	{
 		uint64 shardId = task->anchorShardId;
 
@@ -303,12 +334,18 @@ DropShards(Oid relationId, char *schemaName, char *relationName,
 					 * Regardless of the node is a remote node or the current node,
 					 * try to open a new connection (or use an existing one) to
 					 * connect to that node to drop the shard placement over that
-					 * remote connection.
+					 * remote connection. The placements that are dropped over the
+					 * same connection are dropped by a single command below.
 					 */
-					const char *dropShardPlacementCommand = TaskQueryString(task);
-					ExecuteDropShardPlacementCommandRemotely(shardPlacement,
-															 relationName,
-															 dropShardPlacementCommand);
+					MultiConnection *connection =
+						GetDropShardPlacementConnection(shardPlacement, relationName);
+					if (connection != NULL)
+					{
+						dropShardBatchList =
+							AddShardToDropShardBatch(dropShardBatchList, connection,
+													 schemaName, relationName,
+													 shardInterval);
+					}
 
 					if (isLocalShardPlacement)
 					{
@@ -327,6 +364,15 @@ DropShards(Oid relationId, char *schemaName, char *relationName,
 		DeleteShardRow(shardId);
 	}
 
+	if (ShardDropBatchContext != NULL)
+	{
+		DeferDropShardBatchList(dropShardBatchList);
+	}
+	else
+	{
+		ExecuteDropShardBatchList(dropShardBatchList);
+	}
+
 	int droppedShardCount = list_length(deletableShardIntervalList);
 
 	return droppedShardCount;
@@ -384,17 +430,17 @@ DropTaskList(Oid relationId, char *schemaName, char *relationName,
 
 
 /*
- * ExecuteDropShardPlacementCommandRemotely executes the given DROP shard command
- * via remote critical connection.
+ * GetDropShardPlacementConnection returns the connection over which the given
+ * shard placement should be dropped, in a critical remote transaction. If the
+ * node cannot be reached, the placement is marked for deletion later and NULL
+ * is returned.
  */
-static void
-ExecuteDropShardPlacementCommandRemotely(ShardPlacement *shardPlacement,
-										 const char *relationName,
-										 const char *dropShardPlacementCommand)
+static MultiConnection *
+GetDropShardPlacementConnection(ShardPlacement *shardPlacement,
+								const char *relationName)
 {
 	Assert(shardPlacement != NULL);
 	Assert(relationName != NULL);
-	Assert(dropShardPlacementCommand != NULL);
 
 	uint32 connectionFlags = FOR_DDL;
 	MultiConnection *connection = GetPlacementConnection(connectionFlags,
@@ -430,12 +476,179 @@ ExecuteDropShardPlacementCommandRemotely(ShardPlacement *shardPlacement,
 														 shardRelationName,
 														 shardPlacement->groupId);
 
-		return;
+		return NULL;
 	}
 
 	MarkRemoteTransactionCritical(connection);
 
-	ExecuteCriticalRemoteCommand(connection, dropShardPlacementCommand);
+	return connection;
+}
+
+
+/*
+ * AddShardToDropShardBatch adds the given shard to the batch of shards that
+ * are dropped over the given connection, and returns the (possibly extended)
+ * list of batches.
+ */
+static List *
+AddShardToDropShardBatch(List *dropShardBatchList, MultiConnection *connection,
+						 const char *schemaName, const char *relationName,
+						 ShardInterval *shardInterval)
+{
+	char *shardRelationName = pstrdup(relationName);
+	AppendShardIdToName(&shardRelationName, shardInterval->shardId);
+
+	const char *quotedShardName = quote_qualified_identifier(schemaName,
+															 shardRelationName);
+
+	DropShardBatch *dropShardBatch = NULL;
+	foreach_ptr(dropShardBatch, dropShardBatchList)
+	{
+		if (dropShardBatch->connection == connection &&
+			dropShardBatch->storageType == shardInterval->storageType)
+		{
+			appendStringInfo(dropShardBatch->quotedShardNames, ", %s",
+							 quotedShardName);
+
+			return dropShardBatchList;
+		}
+	}
+
+	dropShardBatch = palloc0(sizeof(DropShardBatch));
+	dropShardBatch->connection = connection;
+	dropShardBatch->storageType = shardInterval->storageType;
+	dropShardBatch->quotedShardNames = makeStringInfo();
+	appendStringInfoString(dropShardBatch->quotedShardNames, quotedShardName);
+
+	return lappend(dropShardBatchList, dropShardBatch);
+}
+
+
+/*
+ * BeginShardDropBatch starts deferring the remote DROP commands of the shards
+ * of dropped tables, such that the shards of many tables, typically old
+ * partitions of a distributed table, are dropped by a single command per
+ * connection in EndShardDropBatch. The deferred commands are kept in the given
+ * memory context, which should live until the end of the batch.
+ */
+void
+BeginShardDropBatch(MemoryContext batchContext)
+{
+	Assert(ShardDropBatchContext == NULL);
+
+	ShardDropBatchContext = batchContext;
+	DeferredDropShardBatchList = NIL;
+}
+
+
+/*
+ * EndShardDropBatch stops deferring the remote drops of shards, and drops the
+ * deferred shards if executeDeferred is true. It is called with false when
+ * the batch is aborted by an error.
+ */
+void
+EndShardDropBatch(bool executeDeferred)
+{
+	List *dropShardBatchList = DeferredDropShardBatchList;
+
+	ShardDropBatchContext = NULL;
+	DeferredDropShardBatchList = NIL;
+
+	if (executeDeferred)
+	{
+		ExecuteDropShardBatchList(dropShardBatchList);
+	}
+}
+
+
+/*
+ * DeferDropShardBatchList merges the given batches of shard drops into the
+ * deferred batches of the same connections and storage types. The connections
+ * remain valid until the end of the transaction, which the batch does not
+ * outlive.
+ */
+static void
+DeferDropShardBatchList(List *dropShardBatchList)
+{
+	MemoryContext oldContext = MemoryContextSwitchTo(ShardDropBatchContext);
+
+	DropShardBatch *dropShardBatch = NULL;
+	foreach_ptr(dropShardBatch, dropShardBatchList)
+	{
+		DropShardBatch *deferredBatch = NULL;
+
+		DropShardBatch *existingBatch = NULL;
+		foreach_ptr(existingBatch, DeferredDropShardBatchList)
+		{
+			if (existingBatch->connection == dropShardBatch->connection &&
+				existingBatch->storageType == dropShardBatch->storageType)
+			{
+				deferredBatch = existingBatch;
+				break;
+			}
+		}
+
+		if (deferredBatch == NULL)
+		{
+			deferredBatch = palloc0(sizeof(DropShardBatch));
+			deferredBatch->connection = dropShardBatch->connection;
+			deferredBatch->storageType = dropShardBatch->storageType;
+			deferredBatch->quotedShardNames = makeStringInfo();
+
+			DeferredDropShardBatchList = lappend(DeferredDropShardBatchList,
+												 deferredBatch);
+		}
+		else
+		{
+			appendStringInfoString(deferredBatch->quotedShardNames, ", ");
+		}
+
+		appendStringInfoString(deferredBatch->quotedShardNames,
+							   dropShardBatch->quotedShardNames->data);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * ExecuteDropShardBatchList sends the DROP command of each batch over its
+ * connection, and then waits for all of them to finish, such that the nodes
+ * drop their shards in parallel. Since the remote transactions are critical,
+ * any failure errors out.
+ */
+static void
+ExecuteDropShardBatchList(List *dropShardBatchList)
+{
+	DropShardBatch *dropShardBatch = NULL;
+	foreach_ptr(dropShardBatch, dropShardBatchList)
+	{
+		MultiConnection *connection = dropShardBatch->connection;
+		char *dropShardPlacementCommand =
+			CreateDropShardListCommand(dropShardBatch->quotedShardNames->data,
+									   dropShardBatch->storageType);
+
+		int querySent = SendRemoteCommand(connection, dropShardPlacementCommand);
+		if (querySent == 0)
+		{
+			ReportConnectionError(connection, ERROR);
+		}
+	}
+
+	foreach_ptr(dropShardBatch, dropShardBatchList)
+	{
+		MultiConnection *connection = dropShardBatch->connection;
+		bool raiseInterrupts = true;
+
+		PGresult *result = GetRemoteCommandResult(connection, raiseInterrupts);
+		if (!IsResponseOK(result))
+		{
+			ReportResultError(connection, result, ERROR);
+		}
+
+		PQclear(result);
+		ForgetResults(connection);
+	}
 }
 
 
@@ -451,21 +664,33 @@ CreateDropShardPlacementCommand(const char *schemaName, const char *shardRelatio
 	Assert(schemaName != NULL);
 	Assert(shardRelationName != NULL);
 
-	StringInfo workerDropQuery = makeStringInfo();
-
 	const char *quotedShardName = quote_qualified_identifier(schemaName,
 															 shardRelationName);
 
+	return CreateDropShardListCommand(quotedShardName, storageType);
+}
+
+
+/*
+ * CreateDropShardListCommand builds the DROP command to drop the given
+ * comma-separated list of qualified shard relation names, according to the
+ * storage type of the shards.
+ */
+static char *
+CreateDropShardListCommand(const char *quotedShardNames, char storageType)
+{
+	StringInfo workerDropQuery = makeStringInfo();
+
 	/* build workerDropQuery according to shard storage type */
 	if (storageType == SHARD_STORAGE_TABLE)
 	{
 		appendStringInfo(workerDropQuery, DROP_REGULAR_TABLE_COMMAND,
-						 quotedShardName);
+						 quotedShardNames);
 	}
 	else if (storageType == SHARD_STORAGE_FOREIGN)
 	{
 		appendStringInfo(workerDropQuery, DROP_FOREIGN_TABLE_COMMAND,
-						 quotedShardName);
+						 quotedShardNames);
 	}
 	else
 	{
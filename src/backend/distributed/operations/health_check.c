@@ -13,12 +13,20 @@
 
 #include "postgres.h"
 
+#include "miscadmin.h"
+#include "pgstat.h"
+
+#include "portability/instr_time.h"
+#include "storage/latch.h"
 #include "utils/builtins.h"
 
 #include "distributed/argutils.h"
+#include "distributed/connection_management.h"
+#include "distributed/health_check.h"
 #include "distributed/listutils.h"
 #include "distributed/lock_graph.h"
 #include "distributed/metadata_cache.h"
+#include "distributed/node_latency_stats.h"
 #include "distributed/remote_commands.h"
 #include "distributed/tuplestore.h"
 #include "distributed/worker_manager.h"
@@ -27,6 +35,12 @@
 #define CONNECTIVITY_CHECK_QUERY "SELECT 1"
 #define CONNECTIVITY_CHECK_COLUMNS 5
 
+/* query to probe the health of a node, returns its replication lag in milliseconds */
+#define NODE_HEALTH_PROBE_QUERY \
+	"SELECT CASE WHEN pg_is_in_recovery() THEN " \
+	"coalesce(extract(epoch FROM now() - pg_last_xact_replay_timestamp()) * 1000, 0) " \
+	"ELSE 0 END"
+
 PG_FUNCTION_INFO_V1(citus_check_connection_to_node);
 PG_FUNCTION_INFO_V1(citus_check_cluster_node_health);
 
@@ -35,6 +49,8 @@ static bool CheckConnectionToNode(char *nodeName, uint32 nodePort);
 static void StoreAllConnectivityChecks(Tuplestorestate *tupleStore,
 									   TupleDesc tupleDescriptor);
 static char * GetConnectivityCheckCommand(const char *nodeName, const uint32 nodePort);
+static void ProbeNode(WorkerNode *workerNode);
+static bool WaitForProbeResult(MultiConnection *connection, long timeout);
 
 
 /*
@@ -199,3 +215,126 @@ GetConnectivityCheckCommand(const char *nodeName, const uint32 nodePort)
 
 	return connectivityCheckCommand->data;
 }
+
+
+/*
+ * ProbeNodeHealth probes the readable nodes other than the local one and
+ * records the outcome in the node latency stats, where router queries find
+ * whether a node is degraded. The maintenance daemon calls this periodically
+ * when citus.node_health_check_interval is set.
+ */
+void
+ProbeNodeHealth(void)
+{
+	List *workerNodeList = ActiveReadableNodeList();
+	int32 localGroupId = GetLocalGroupId();
+
+	WorkerNode *workerNode = NULL;
+	foreach_ptr(workerNode, workerNodeList)
+	{
+		if (workerNode->groupId == localGroupId)
+		{
+			continue;
+		}
+
+		ProbeNode(workerNode);
+	}
+}
+
+
+/*
+ * ProbeNode runs the health probe query on the given node and records the
+ * round trip time of the query, which excludes the connection establishment,
+ * along with the replication lag of the node. We wait at most
+ * citus.node_connection_timeout for the result, such that unresponsive nodes
+ * do not hold up the maintenance daemon.
+ */
+static void
+ProbeNode(WorkerNode *workerNode)
+{
+	int connectionFlags = 0;
+	MultiConnection *connection = GetNodeConnection(connectionFlags,
+													workerNode->workerName,
+													workerNode->workerPort);
+	bool probeSucceeded = false;
+	double replicationLag = 0.0;
+
+	instr_time probeStart;
+	instr_time probeDuration;
+	INSTR_TIME_SET_CURRENT(probeStart);
+
+	if (PQstatus(connection->pgConn) == CONNECTION_OK &&
+		SendRemoteCommand(connection, NODE_HEALTH_PROBE_QUERY) != 0 &&
+		WaitForProbeResult(connection, NodeConnectionTimeout))
+	{
+		bool raiseInterrupts = true;
+		PGresult *result = GetRemoteCommandResult(connection, raiseInterrupts);
+
+		if (IsResponseOK(result) && PQntuples(result) == 1)
+		{
+			probeSucceeded = true;
+
+			if (!PQgetisnull(result, 0, 0))
+			{
+				replicationLag = strtod(PQgetvalue(result, 0, 0), NULL);
+			}
+		}
+
+		PQclear(result);
+	}
+
+	INSTR_TIME_SET_CURRENT(probeDuration);
+	INSTR_TIME_SUBTRACT(probeDuration, probeStart);
+
+	RecordNodeProbe(workerNode->workerName, workerNode->workerPort, probeSucceeded,
+					INSTR_TIME_GET_MICROSEC(probeDuration), replicationLag);
+
+	if (probeSucceeded)
+	{
+		ForgetResults(connection);
+	}
+	else
+	{
+		/* reconnect for the next probe */
+		CloseConnection(connection);
+	}
+}
+
+
+/*
+ * WaitForProbeResult waits until the result of the command on the given
+ * connection arrived, and returns false if that takes longer than the given
+ * timeout in milliseconds or the connection fails.
+ */
+static bool
+WaitForProbeResult(MultiConnection *connection, long timeout)
+{
+	instr_time waitStart;
+	INSTR_TIME_SET_CURRENT(waitStart);
+
+	while (PQisBusy(connection->pgConn))
+	{
+		instr_time waitDuration;
+		INSTR_TIME_SET_CURRENT(waitDuration);
+		INSTR_TIME_SUBTRACT(waitDuration, waitStart);
+
+		long remainingTime = timeout - (long) INSTR_TIME_GET_MILLISEC(waitDuration);
+		if (remainingTime <= 0)
+		{
+			return false;
+		}
+
+		int eventMask = WL_SOCKET_READABLE | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH;
+		int rc = WaitLatchOrSocket(NULL, eventMask, PQsocket(connection->pgConn),
+								   remainingTime, PG_WAIT_EXTENSION);
+
+		CHECK_FOR_INTERRUPTS();
+
+		if ((rc & WL_SOCKET_READABLE) && PQconsumeInput(connection->pgConn) == 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
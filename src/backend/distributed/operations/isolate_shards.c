@@ -17,6 +17,7 @@
 #include "libpq-fe.h"
 
 #include "catalog/pg_class.h"
+#include "executor/spi.h"
 #include "nodes/pg_list.h"
 #include "storage/lock.h"
 #include "utils/builtins.h"
@@ -25,10 +26,13 @@
 #include "utils/lsyscache.h"
 #include "utils/typcache.h"
 
+#include "distributed/citus_ruleutils.h"
 #include "distributed/colocation_utils.h"
 #include "distributed/coordinator_protocol.h"
+#include "distributed/listutils.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/metadata_sync.h"
+#include "distributed/metadata_utility.h"
 #include "distributed/multi_join_order.h"
 #include "distributed/multi_partitioning_utils.h"
 #include "distributed/multi_router_planner.h"
@@ -44,6 +48,59 @@
 #include "distributed/worker_protocol.h"
 #include "distributed/worker_transaction.h"
 
+/*
+ * HotTenant is a tenant whose share of the load exceeds
+ * citus.tenant_isolation_threshold.
+ */
+typedef struct HotTenant
+{
+	int colocationId;
+	char *tenantAttribute;
+} HotTenant;
+
+
+/*
+ * HOT_TENANTS_QUERY returns the tenants whose share of the queries or of the
+ * CPU usage of all tenants in the last period is at least the given threshold,
+ * from the hottest to the least hot tenant.
+ */
+#define HOT_TENANTS_QUERY \
+	"WITH tenants AS (" \
+	" SELECT colocation_id, tenant_attribute," \
+	" sum(query_count_in_last_period)::float8 AS query_count," \
+	" sum(cpu_usage_in_last_period) AS cpu_usage" \
+	" FROM pg_catalog.citus_stat_tenants(true)" \
+	" WHERE tenant_attribute IS NOT NULL" \
+	" GROUP BY colocation_id, tenant_attribute)," \
+	" shares AS (" \
+	" SELECT colocation_id, tenant_attribute, count(*) OVER () AS tenant_count," \
+	" greatest(coalesce(query_count / nullif(sum(query_count) OVER (), 0), 0)," \
+	" coalesce(cpu_usage / nullif(sum(cpu_usage) OVER (), 0), 0)) AS share" \
+	" FROM tenants)" \
+	" SELECT colocation_id, tenant_attribute FROM shares" \
+	" WHERE tenant_count > 1 AND share >= %f" \
+	" ORDER BY share DESC"
+
+/*
+ * LEAST_LOADED_NODE_QUERY returns the node that can have shards and stores the
+ * least amount of shard data.
+ */
+#define LEAST_LOADED_NODE_QUERY \
+	"SELECT n.nodeid FROM pg_catalog.pg_dist_node n" \
+	" LEFT JOIN pg_catalog.citus_shards s" \
+	" ON (s.nodename = n.nodename AND s.nodeport = n.nodeport)" \
+	" WHERE n.isactive AND n.noderole = 'primary' AND n.shouldhaveshards" \
+	" GROUP BY n.nodeid" \
+	" ORDER BY coalesce(sum(s.shard_size), 0), n.nodeid LIMIT 1"
+
+/* GUC variable, share of the tenant load above which a tenant is isolated */
+double TenantIsolationThreshold = 0.5;
+
+
+static List * HotTenantList(void);
+static int LeastLoadedNodeId(void);
+static Oid TenantIsolationRelationId(int colocationId);
+
 /* declarations for dynamic loading */
 PG_FUNCTION_INFO_V1(isolate_tenant_to_new_shard);
 PG_FUNCTION_INFO_V1(worker_hash);
@@ -218,3 +275,228 @@ worker_hash(PG_FUNCTION_ARGS)
 
 	PG_RETURN_INT32(hashedValueDatum);
 }
+
+
+/*
+ * ScheduleHotTenantIsolation looks for a tenant in citus_stat_tenants whose
+ * share of the load exceeds citus.tenant_isolation_threshold and whose shard
+ * also holds other tenants. For the hottest such tenant it schedules a
+ * background job that isolates the tenant to a new shard and then moves the
+ * new shard to the node that stores the least shard data. The job id is
+ * returned, or 0 if no job was scheduled.
+ *
+ * At most one such job runs at a time and no job is scheduled while a
+ * rebalance is running, such that we do not compete with other shard moves.
+ * The data transfers are limited by citus.shard_transfer_max_rate like any
+ * other shard transfer.
+ */
+int64
+ScheduleHotTenantIsolation(void)
+{
+	int64 jobId = 0;
+	if (HasNonTerminalJobOfType("rebalance", &jobId) ||
+		HasNonTerminalJobOfType("tenant isolation", &jobId))
+	{
+		return 0;
+	}
+
+	List *hotTenantList = HotTenantList();
+
+	HotTenant *hotTenant = NULL;
+	foreach_ptr(hotTenant, hotTenantList)
+	{
+		Oid relationId = TenantIsolationRelationId(hotTenant->colocationId);
+		if (!OidIsValid(relationId))
+		{
+			continue;
+		}
+
+		CitusTableCacheEntry *cacheEntry = GetCitusTableCacheEntry(relationId);
+		Oid distributionColumnType = cacheEntry->partitionColumn->vartype;
+		Datum tenantIdDatum = StringToDatum(hotTenant->tenantAttribute,
+											distributionColumnType);
+
+		ShardInterval *sourceShard = FindShardInterval(tenantIdDatum, cacheEntry);
+		if (sourceShard == NULL ||
+			DatumGetInt32(sourceShard->minValue) == DatumGetInt32(sourceShard->maxValue))
+		{
+			/* the tenant is already isolated */
+			continue;
+		}
+
+		List *sourcePlacementList = ActiveShardPlacementList(sourceShard->shardId);
+		if (list_length(sourcePlacementList) != 1)
+		{
+			/* tenants of replicated shards cannot be isolated */
+			continue;
+		}
+
+		ShardPlacement *sourcePlacement = linitial(sourcePlacementList);
+		int targetNodeId = LeastLoadedNodeId();
+		if (targetNodeId == 0)
+		{
+			return 0;
+		}
+
+		char *quotedTableName =
+			quote_literal_cstr(generate_qualified_relation_name(relationId));
+		char *quotedTenantId = quote_literal_cstr(hotTenant->tenantAttribute);
+
+		StringInfo description = makeStringInfo();
+		appendStringInfo(description, "Isolate tenant %s of %s",
+						 quotedTenantId, quotedTableName);
+
+		jobId = CreateBackgroundJob("tenant isolation", description->data);
+
+		/* isolate_tenant_to_new_shard keeps the new shard on the source node */
+		StringInfo isolateCommand = makeStringInfo();
+		appendStringInfo(isolateCommand,
+						 "SELECT pg_catalog.isolate_tenant_to_new_shard("
+						 "%s::regclass, %s::text, 'CASCADE', 'auto')",
+						 quotedTableName, quotedTenantId);
+
+		int32 isolateNodesInvolved[1] = { sourcePlacement->nodeId };
+		BackgroundTask *isolateTask =
+			ScheduleBackgroundTask(jobId, CitusExtensionOwner(), isolateCommand->data,
+								   0, NULL, 1, isolateNodesInvolved);
+
+		/*
+		 * The id of the new shard is only known once the tenant is isolated,
+		 * so the move looks it up when it runs.
+		 */
+		StringInfo moveCommand = makeStringInfo();
+		appendStringInfo(moveCommand,
+						 "SELECT pg_catalog.citus_move_shard_placement("
+						 "p.shardid, n.nodeid, %d, 'auto') "
+						 "FROM pg_catalog.pg_dist_placement p "
+						 "JOIN pg_catalog.pg_dist_node n USING (groupid) "
+						 "WHERE p.shardid = "
+						 "pg_catalog.get_shard_id_for_distribution_column("
+						 "%s::regclass, %s::text) "
+						 "AND n.noderole = 'primary' AND n.nodeid <> %d",
+						 targetNodeId, quotedTableName, quotedTenantId, targetNodeId);
+
+		int64 moveDependsOn[1] = { isolateTask->taskid };
+		int32 moveNodesInvolved[2] = { sourcePlacement->nodeId, targetNodeId };
+		ScheduleBackgroundTask(jobId, CitusExtensionOwner(), moveCommand->data,
+							   1, moveDependsOn, 2, moveNodesInvolved);
+
+		ereport(LOG, (errmsg("scheduled job " INT64_FORMAT " to isolate tenant %s "
+							 "of %s", jobId, quotedTenantId, quotedTableName)));
+
+		return jobId;
+	}
+
+	return 0;
+}
+
+
+/*
+ * HotTenantList returns the tenants in citus_stat_tenants whose share of the
+ * load exceeds citus.tenant_isolation_threshold as a list of HotTenant, the
+ * hottest tenant first.
+ */
+static List *
+HotTenantList(void)
+{
+	List *hotTenantList = NIL;
+	MemoryContext callerContext = CurrentMemoryContext;
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+	{
+		ereport(ERROR, (errmsg("could not connect to SPI manager")));
+	}
+
+	char *hotTenantsQuery = psprintf(HOT_TENANTS_QUERY, TenantIsolationThreshold);
+
+	bool readOnly = true;
+	int spiQueryResult = SPI_execute(hotTenantsQuery, readOnly, 0);
+	if (spiQueryResult != SPI_OK_SELECT)
+	{
+		ereport(ERROR, (errmsg("execution was not successful \"%s\"",
+							   hotTenantsQuery)));
+	}
+
+	for (uint64 rowIndex = 0; rowIndex < SPI_processed; rowIndex++)
+	{
+		HeapTuple row = SPI_tuptable->vals[rowIndex];
+		TupleDesc rowDescriptor = SPI_tuptable->tupdesc;
+
+		bool isNull = false;
+		Datum colocationIdDatum = SPI_getbinval(row, rowDescriptor, 1, &isNull);
+		char *tenantAttribute = SPI_getvalue(row, rowDescriptor, 2);
+
+		MemoryContext spiContext = MemoryContextSwitchTo(callerContext);
+
+		HotTenant *hotTenant = palloc0(sizeof(HotTenant));
+		hotTenant->colocationId = DatumGetInt32(colocationIdDatum);
+		hotTenant->tenantAttribute = pstrdup(tenantAttribute);
+		hotTenantList = lappend(hotTenantList, hotTenant);
+
+		MemoryContextSwitchTo(spiContext);
+	}
+
+	SPI_finish();
+
+	return hotTenantList;
+}
+
+
+/*
+ * LeastLoadedNodeId returns the id of the node that can have shards and
+ * stores the least amount of shard data, or 0 if there is no such node.
+ */
+static int
+LeastLoadedNodeId(void)
+{
+	int nodeId = 0;
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+	{
+		ereport(ERROR, (errmsg("could not connect to SPI manager")));
+	}
+
+	bool readOnly = true;
+	int spiQueryResult = SPI_execute(LEAST_LOADED_NODE_QUERY, readOnly, 1);
+	if (spiQueryResult != SPI_OK_SELECT)
+	{
+		ereport(ERROR, (errmsg("execution was not successful \"%s\"",
+							   LEAST_LOADED_NODE_QUERY)));
+	}
+
+	if (SPI_processed > 0)
+	{
+		bool isNull = false;
+		Datum nodeIdDatum = SPI_getbinval(SPI_tuptable->vals[0],
+										  SPI_tuptable->tupdesc, 1, &isNull);
+		nodeId = DatumGetInt32(nodeIdDatum);
+	}
+
+	SPI_finish();
+
+	return nodeId;
+}
+
+
+/*
+ * TenantIsolationRelationId returns a hash distributed table in the given
+ * colocation group that can be passed to isolate_tenant_to_new_shard, or
+ * InvalidOid if there is none.
+ */
+static Oid
+TenantIsolationRelationId(int colocationId)
+{
+	List *colocatedTableList = ColocationGroupTableList(colocationId, 0);
+
+	Oid relationId = InvalidOid;
+	foreach_oid(relationId, colocatedTableList)
+	{
+		if (IsCitusTableType(relationId, HASH_DISTRIBUTED) &&
+			!PartitionTable(relationId))
+		{
+			return relationId;
+		}
+	}
+
+	return InvalidOid;
+}
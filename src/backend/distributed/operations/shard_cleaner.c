@@ -41,6 +41,7 @@
 /* GUC configuration for shard cleaner */
 int NextOperationId = 0;
 int NextCleanupRecordId = 0;
+int OrphanedShardDropBatchSize = 1;
 
 /* Data structure for cleanup operation */
 
@@ -68,6 +69,22 @@ typedef struct CleanupRecord
 	CleanupPolicy policy;
 } CleanupRecord;
 
+/*
+ * ShardDropBatch holds the cleanup records of the orphaned shards on a node
+ * that are dropped together.
+ */
+typedef struct ShardDropBatch
+{
+	WorkerNode *workerNode;
+
+	/* records that still need to be dropped */
+	List *pendingRecordList;
+
+	/* records that are dropped by the command that is currently running */
+	List *currentRecordList;
+	MultiConnection *connection;
+} ShardDropBatch;
+
 /* operation ID set by RegisterOperationNeedingCleanup */
 OperationId CurrentOperationId = INVALID_OPERATION_ID;
 
@@ -112,6 +129,12 @@ static bool CleanupRecordExists(uint64 recordId);
 static List * ListCleanupRecords(void);
 static List * ListCleanupRecordsForCurrentOperation(void);
 static int DropOrphanedResourcesForCleanup(void);
+static List * DropOrphanedShardsInBatches(List *cleanupRecordList,
+										  int *removedResourceCount,
+										  int *failedResourceCount);
+static List * ShardDropBatchList(List *shardRecordList);
+static char * ShardDropBatchCommand(List *recordList);
+static void CompleteCleanupRecord(CleanupRecord *record, WorkerNode *workerNode);
 static int CompareCleanupRecordsByObjectType(const void *leftElement,
 											 const void *rightElement);
 
@@ -257,8 +280,17 @@ DropOrphanedResourcesForCleanup()
 
 	int removedResourceCountForCleanup = 0;
 	int failedResourceCountForCleanup = 0;
-	CleanupRecord *record = NULL;
+	int cleanupRecordCount = list_length(cleanupRecordList);
 
+	if (OrphanedShardDropBatchSize > 1)
+	{
+		cleanupRecordList =
+			DropOrphanedShardsInBatches(cleanupRecordList,
+										&removedResourceCountForCleanup,
+										&failedResourceCountForCleanup);
+	}
+
+	CleanupRecord *record = NULL;
 	foreach_ptr(record, cleanupRecordList)
 	{
 		if (!PrimaryNodeForGroup(record->nodeGroupId, NULL))
@@ -273,7 +305,6 @@ DropOrphanedResourcesForCleanup()
 			continue;
 		}
 
-		char *resourceName = record->objectName;
 		WorkerNode *workerNode = LookupNodeForGroup(record->nodeGroupId);
 
 		/*
@@ -290,23 +321,7 @@ DropOrphanedResourcesForCleanup()
 															 workerNode->workerName,
 															 workerNode->workerPort))
 		{
-			if (record->policy == CLEANUP_DEFERRED_ON_SUCCESS)
-			{
-				ereport(LOG, (errmsg("deferred drop of orphaned resource %s on %s:%d "
-									 "completed",
-									 resourceName,
-									 workerNode->workerName, workerNode->workerPort)));
-			}
-			else
-			{
-				ereport(LOG, (errmsg("cleaned up orphaned resource %s on %s:%d which "
-									 "was left behind after a failed operation",
-									 resourceName,
-									 workerNode->workerName, workerNode->workerPort)));
-			}
-
-			/* delete the cleanup record */
-			DeleteCleanupRecordByRecordId(record->recordId);
+			CompleteCleanupRecord(record, workerNode);
 			removedResourceCountForCleanup++;
 		}
 		else
@@ -323,13 +338,257 @@ DropOrphanedResourcesForCleanup()
 	{
 		ereport(WARNING, (errmsg("failed to clean up %d orphaned resources out of %d",
 								 failedResourceCountForCleanup,
-								 list_length(cleanupRecordList))));
+								 cleanupRecordCount)));
 	}
 
 	return removedResourceCountForCleanup;
 }
 
 
+/*
+ * DropOrphanedShardsInBatches drops the orphaned shard placements among the
+ * given cleanup records with a single DROP TABLE command for up to
+ * citus.orphaned_shard_drop_batch_size shards of a node, and sends these
+ * commands to all nodes in parallel. It returns the cleanup records of the
+ * other types of resources, which are to be cleaned up one by one.
+ *
+ * If a batch fails to drop, for instance because one of its shards is still
+ * locked by a query and the lock_timeout expires, we drop the shards of that
+ * batch one by one, such that only the shards that are in use are skipped.
+ */
+static List *
+DropOrphanedShardsInBatches(List *cleanupRecordList, int *removedResourceCount,
+							int *failedResourceCount)
+{
+	List *shardRecordList = NIL;
+	List *otherRecordList = NIL;
+
+	CleanupRecord *record = NULL;
+	foreach_ptr(record, cleanupRecordList)
+	{
+		if (record->objectType != CLEANUP_OBJECT_SHARD_PLACEMENT)
+		{
+			otherRecordList = lappend(otherRecordList, record);
+			continue;
+		}
+
+		if (!PrimaryNodeForGroup(record->nodeGroupId, NULL))
+		{
+			continue;
+		}
+
+		/* skip records of operations that are still running, see below */
+		if (!TryLockOperationId(record->operationId) ||
+			!CleanupRecordExists(record->recordId))
+		{
+			continue;
+		}
+
+		shardRecordList = lappend(shardRecordList, record);
+	}
+
+	List *batchList = ShardDropBatchList(shardRecordList);
+	bool batchesPending = true;
+
+	while (batchesPending)
+	{
+		batchesPending = false;
+
+		/* start the next batch on every node that still has shards to drop */
+		List *connectionList = NIL;
+		ShardDropBatch *batch = NULL;
+		foreach_ptr(batch, batchList)
+		{
+			batch->currentRecordList = NIL;
+			batch->connection = NULL;
+
+			int pendingRecordCount = list_length(batch->pendingRecordList);
+			if (pendingRecordCount == 0)
+			{
+				continue;
+			}
+
+			int batchSize = Min(pendingRecordCount, OrphanedShardDropBatchSize);
+			for (int recordIndex = 0; recordIndex < batchSize; recordIndex++)
+			{
+				batch->currentRecordList = lappend(batch->currentRecordList,
+												   list_nth(batch->pendingRecordList,
+															recordIndex));
+			}
+
+			batch->pendingRecordList = list_copy_tail(batch->pendingRecordList,
+													  batchSize);
+
+			int connectionFlags = OUTSIDE_TRANSACTION;
+			batch->connection =
+				StartNodeUserDatabaseConnection(connectionFlags,
+												batch->workerNode->workerName,
+												batch->workerNode->workerPort,
+												CurrentUserName(), NULL);
+			connectionList = lappend(connectionList, batch->connection);
+		}
+
+		if (connectionList == NIL)
+		{
+			break;
+		}
+
+		FinishConnectionListEstablishment(connectionList);
+
+		foreach_ptr(batch, batchList)
+		{
+			if (batch->connection == NULL ||
+				PQstatus(batch->connection->pgConn) != CONNECTION_OK)
+			{
+				continue;
+			}
+
+			char *dropCommand = ShardDropBatchCommand(batch->currentRecordList);
+			if (!SendRemoteCommand(batch->connection, dropCommand))
+			{
+				ReportConnectionError(batch->connection, WARNING);
+			}
+		}
+
+		foreach_ptr(batch, batchList)
+		{
+			if (batch->connection == NULL)
+			{
+				continue;
+			}
+
+			bool raiseErrors = false;
+			bool batchDropped =
+				PQstatus(batch->connection->pgConn) == CONNECTION_OK &&
+				ClearResults(batch->connection, raiseErrors);
+
+			CleanupRecord *shardRecord = NULL;
+			foreach_ptr(shardRecord, batch->currentRecordList)
+			{
+				if (batchDropped ||
+					TryDropShardOutsideTransaction(shardRecord->objectName,
+												   batch->workerNode->workerName,
+												   batch->workerNode->workerPort))
+				{
+					CompleteCleanupRecord(shardRecord, batch->workerNode);
+					(*removedResourceCount)++;
+				}
+				else
+				{
+					(*failedResourceCount)++;
+				}
+			}
+
+			if (batch->pendingRecordList != NIL)
+			{
+				batchesPending = true;
+			}
+		}
+	}
+
+	return otherRecordList;
+}
+
+
+/*
+ * ShardDropBatchList groups the given cleanup records of shard placements by
+ * the node they are on, and returns a list of ShardDropBatch.
+ */
+static List *
+ShardDropBatchList(List *shardRecordList)
+{
+	List *batchList = NIL;
+
+	CleanupRecord *record = NULL;
+	foreach_ptr(record, shardRecordList)
+	{
+		WorkerNode *workerNode = LookupNodeForGroup(record->nodeGroupId);
+		ShardDropBatch *nodeBatch = NULL;
+
+		ShardDropBatch *batch = NULL;
+		foreach_ptr(batch, batchList)
+		{
+			if (batch->workerNode->nodeId == workerNode->nodeId)
+			{
+				nodeBatch = batch;
+				break;
+			}
+		}
+
+		if (nodeBatch == NULL)
+		{
+			nodeBatch = palloc0(sizeof(ShardDropBatch));
+			nodeBatch->workerNode = workerNode;
+			batchList = lappend(batchList, nodeBatch);
+		}
+
+		nodeBatch->pendingRecordList = lappend(nodeBatch->pendingRecordList, record);
+	}
+
+	return batchList;
+}
+
+
+/*
+ * ShardDropBatchCommand returns a command that drops the shards of the given
+ * cleanup records in a single DROP TABLE. The command consists of multiple
+ * statements, which run in a single implicit transaction on the node, such
+ * that SET LOCAL applies to the DROP.
+ *
+ * As in TryDropShardOutsideTransaction, we set a lock_timeout so that we do
+ * not get blocked by running queries on the shards for more than 1s.
+ */
+static char *
+ShardDropBatchCommand(List *recordList)
+{
+	StringInfo tableList = makeStringInfo();
+
+	CleanupRecord *record = NULL;
+	foreach_ptr(record, recordList)
+	{
+		if (tableList->len > 0)
+		{
+			appendStringInfoString(tableList, ", ");
+		}
+
+		appendStringInfoString(tableList, record->objectName);
+	}
+
+	StringInfo dropCommand = makeStringInfo();
+	appendStringInfoString(dropCommand, "SET LOCAL lock_timeout TO '1s'; ");
+	appendStringInfo(dropCommand, DROP_REGULAR_TABLE_COMMAND, tableList->data);
+
+	return dropCommand->data;
+}
+
+
+/*
+ * CompleteCleanupRecord logs that the resource of the given cleanup record was
+ * dropped from the given node, and deletes the record.
+ */
+static void
+CompleteCleanupRecord(CleanupRecord *record, WorkerNode *workerNode)
+{
+	if (record->policy == CLEANUP_DEFERRED_ON_SUCCESS)
+	{
+		ereport(LOG, (errmsg("deferred drop of orphaned resource %s on %s:%d "
+							 "completed",
+							 record->objectName,
+							 workerNode->workerName, workerNode->workerPort)));
+	}
+	else
+	{
+		ereport(LOG, (errmsg("cleaned up orphaned resource %s on %s:%d which "
+							 "was left behind after a failed operation",
+							 record->objectName,
+							 workerNode->workerName, workerNode->workerPort)));
+	}
+
+	/* delete the cleanup record */
+	DeleteCleanupRecordByRecordId(record->recordId);
+}
+
+
 /*
  * RegisterOperationNeedingCleanup is be called by an operation to register
  * for cleanup.
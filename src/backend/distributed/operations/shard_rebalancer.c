@@ -64,6 +64,7 @@
 #include "distributed/resource_lock.h"
 #include "distributed/shard_cleaner.h"
 #include "distributed/shard_rebalancer.h"
+#include "distributed/shard_size_cache.h"
 #include "distributed/shard_transfer.h"
 #include "distributed/tuplestore.h"
 #include "distributed/utils/array_type.h"
@@ -127,6 +128,12 @@ typedef struct RebalanceState
 	 */
 	float4 totalCost;
 
+	/*
+	 * totalLoad is the query load of all the shards in the cluster added
+	 * together, it is 0 when the query load is not balanced.
+	 */
+	float4 totalLoad;
+
 	/*
 	 * totalCapacity is the capacity of all the nodes in the cluster added
 	 * together.
@@ -184,6 +191,9 @@ typedef struct WorkerShardStatistics
 	WorkerHashKey worker;
 	XLogRecPtr workerLSN;
 
+	/* citus.shard_transfer_max_rate of the worker in kB/s, 0 if unlimited */
+	uint64 maxCopyRate;
+
 	/*
 	 * Statistics for each shard on this worker:
 	 * key: shardId
@@ -254,24 +264,50 @@ static void MoveShardsAwayFromDisallowedNodes(RebalanceState *state);
 static bool FindAndMoveShardCost(float4 utilizationLowerBound,
 								 float4 utilizationUpperBound,
 								 float4 improvementThreshold,
+								 float4 loadUtilizationUpperBound,
 								 RebalanceState *state);
+static bool FindAndMoveShardLoad(float4 utilizationLowerBound,
+								 float4 utilizationUpperBound,
+								 float4 loadUtilizationUpperBound,
+								 int32 movesLeft,
+								 RebalanceState *state);
+static bool MoveCreatesLoadHotSpot(NodeFillState *sourceFillState,
+								   NodeFillState *targetFillState,
+								   ShardCost *shardCost,
+								   float4 loadUtilizationUpperBound);
+static bool MoveKeepsCostBalance(NodeFillState *sourceFillState,
+								 NodeFillState *targetFillState,
+								 float4 movedCost,
+								 float4 utilizationLowerBound,
+								 float4 utilizationUpperBound);
+static bool ShardCanMoveToNode(RebalanceState *state, uint64 shardId,
+							   WorkerNode *workerNode);
 static NodeFillState * FindAllowedTargetFillState(RebalanceState *state, uint64 shardId);
+static List * RepositionFillStates(List *fillStateList, NodeFillState *sourceFillState,
+								   NodeFillState *targetFillState,
+								   int (*compareFunction)(const void *, const void *));
 static void MoveShardCost(NodeFillState *sourceFillState, NodeFillState *targetFillState,
 						  ShardCost *shardCost, RebalanceState *state);
 static int CompareNodeFillStateAsc(const void *void1, const void *void2);
 static int CompareNodeFillStateDesc(const void *void1, const void *void2);
+static int CompareNodeFillStateLoadAsc(const void *void1, const void *void2);
+static int CompareNodeFillStateLoadDesc(const void *void1, const void *void2);
 static int CompareShardCostAsc(const void *void1, const void *void2);
 static int CompareShardCostDesc(const void *void1, const void *void2);
+static int CompareShardLoadAsc(const void *void1, const void *void2);
+static int CompareShardLoadDesc(const void *void1, const void *void2);
 static int CompareDisallowedPlacementAsc(const void *void1, const void *void2);
 static int CompareDisallowedPlacementDesc(const void *void1, const void *void2);
 static bool ShardAllowedOnNode(uint64 shardId, WorkerNode *workerNode, void *context);
 static float4 NodeCapacity(WorkerNode *workerNode, void *context);
 static ShardCost GetShardCost(uint64 shardId, void *context);
+static float4 GetShardLoad(uint64 shardId, void *context);
+static uint64 ShardListQueryLoad(List *shardIntervalList, char *workerNodeName,
+								 uint32 workerNodePort);
 static List * NonColocatedDistRelationIdList(void);
 static void RebalanceTableShards(RebalanceOptions *options, Oid shardReplicationModeOid);
 static int64 RebalanceTableShardsBackground(RebalanceOptions *options, Oid
 											shardReplicationModeOid);
-static void AcquireRebalanceColocationLock(Oid relationId, const char *operationName);
 static void ExecutePlacementUpdates(List *placementUpdateList, Oid
 									shardReplicationModeOid, char *noticeOperation);
 static float4 CalculateUtilization(float4 totalCost, float4 capacity);
@@ -290,6 +326,9 @@ static XLogRecPtr WorkerShardLSN(HTAB *workerShardStatisticsHash, char *workerNa
 								 int workerPort, uint64 shardId);
 static XLogRecPtr WorkerLSN(HTAB *workerShardStatisticsHash,
 							char *workerName, int workerPort);
+static uint64 WorkerMaxCopyRate(HTAB *workerShardStatisticsHash,
+								char *workerName, int workerPort);
+static uint64 GetRemoteShardTransferMaxRate(MultiConnection *connection);
 static void AddToWorkerShardIdSet(HTAB *shardsByWorker, char *workerName, int workerPort,
 								  uint64 shardId);
 static HTAB * BuildShardSizesHash(ProgressMonitorData *monitor, HTAB *shardStatistics);
@@ -322,6 +361,7 @@ PG_FUNCTION_INFO_V1(citus_rebalance_wait);
 bool RunningUnderCitusTestSuite = false;
 int MaxRebalancerLoggedIgnoredMoves = 5;
 int RebalancerByDiskSizeBaseCost = 100 * 1024 * 1024;
+bool RebalancerBalanceQueryLoad = false;
 bool PropagateSessionSettingsForLoopbackConnection = false;
 
 static const char *PlacementUpdateTypeNames[] = {
@@ -390,6 +430,8 @@ CheckRebalanceStateInvariants(const RebalanceState *state)
 		/* Check that utilization field is up to date. */
 		Assert(fillState->utilization == CalculateUtilization(fillState->totalCost,
 															  fillState->capacity)); /* lgtm[cpp/equality-on-floats] */
+		Assert(fillState->loadUtilization == CalculateUtilization(
+				   fillState->totalLoad, fillState->capacity)); /* lgtm[cpp/equality-on-floats] */
 
 		/*
 		 * Check that fillState->totalCost is within 0.1% difference of
@@ -514,6 +556,7 @@ GetRebalanceSteps(RebalanceOptions *options)
 		.shardAllowedOnNode = ShardAllowedOnNode,
 		.nodeCapacity = NodeCapacity,
 		.shardCost = GetShardCost,
+		.shardLoad = RebalancerBalanceQueryLoad ? GetShardLoad : NULL,
 		.context = &context,
 	};
 
@@ -679,11 +722,19 @@ citus_shard_cost_by_disk_size(PG_FUNCTION_ARGS)
 													   ALLOCSET_DEFAULT_SIZES);
 	MemoryContext oldContext = MemoryContextSwitchTo(localContext);
 	ShardInterval *shardInterval = LoadShardInterval(shardId);
-	List *colocatedShardList = ColocatedNonPartitionShardIntervalList(shardInterval);
+	uint64 colocationSizeInBytes = 0;
+
+	/* partitioned shards have no size of their own, their partitions are cached */
+	if (!GetCachedShardListSize(ColocatedShardIntervalList(shardInterval),
+								shardPlacement->groupId, TOTAL_RELATION_SIZE,
+								&colocationSizeInBytes))
+	{
+		List *colocatedShardList = ColocatedNonPartitionShardIntervalList(shardInterval);
 
-	uint64 colocationSizeInBytes = ShardListSizeInBytes(colocatedShardList,
-														shardPlacement->nodeName,
-														shardPlacement->nodePort);
+		colocationSizeInBytes = ShardListSizeInBytes(colocatedShardList,
+													 shardPlacement->nodeName,
+													 shardPlacement->nodePort);
+	}
 
 	MemoryContextSwitchTo(oldContext);
 	MemoryContextReset(localContext);
@@ -699,6 +750,103 @@ citus_shard_cost_by_disk_size(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * GetShardLoad returns the query load of the given shard, which is the query
+ * load of the shard and its colocated shards on the worker of the first active
+ * placement of the shard. It is used as the second dimension the rebalancer
+ * balances when citus.rebalancer_balance_query_load is enabled.
+ */
+static float4
+GetShardLoad(uint64 shardId, void *voidContext)
+{
+	bool missingOk = false;
+	ShardPlacement *shardPlacement = ActiveShardPlacement(shardId, missingOk);
+
+	MemoryContext localContext = AllocSetContextCreate(CurrentMemoryContext,
+													   "ShardLoadContext",
+													   ALLOCSET_DEFAULT_SIZES);
+	MemoryContext oldContext = MemoryContextSwitchTo(localContext);
+	ShardInterval *shardInterval = LoadShardInterval(shardId);
+	List *colocatedShardList = ColocatedShardIntervalList(shardInterval);
+
+	uint64 colocationQueryLoad = ShardListQueryLoad(colocatedShardList,
+													shardPlacement->nodeName,
+													shardPlacement->nodePort);
+
+	MemoryContextSwitchTo(oldContext);
+	MemoryContextDelete(localContext);
+
+	return (float4) colocationQueryLoad;
+}
+
+
+/*
+ * ShardListQueryLoad returns the number of scans and modified rows that the
+ * cumulative statistics of the given worker recorded for a set of shard
+ * tables. These counters are reset when the statistics are reset and when a
+ * shard is moved, since the shard is a new table on its new node.
+ */
+static uint64
+ShardListQueryLoad(List *shardIntervalList, char *workerNodeName,
+				   uint32 workerNodePort)
+{
+	uint32 connectionFlag = 0;
+	StringInfo loadQuery = makeStringInfo();
+
+	appendStringInfoString(loadQuery,
+						   "SELECT coalesce(sum(seq_scan + coalesce(idx_scan, 0) + "
+						   "n_tup_ins + n_tup_upd + n_tup_del), 0) "
+						   "FROM pg_stat_user_tables "
+						   "WHERE (schemaname, relname) IN (");
+
+	bool addComma = false;
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		Oid relationId = shardInterval->relationId;
+		char *schemaName = get_namespace_name(get_rel_namespace(relationId));
+		char *shardName = get_rel_name(relationId);
+		AppendShardIdToName(&shardName, shardInterval->shardId);
+
+		appendStringInfo(loadQuery, "%s(%s, %s)", addComma ? ", " : "",
+						 quote_literal_cstr(schemaName),
+						 quote_literal_cstr(shardName));
+		addComma = true;
+	}
+
+	appendStringInfoChar(loadQuery, ')');
+
+	MultiConnection *connection = GetNodeConnection(connectionFlag, workerNodeName,
+													workerNodePort);
+	PGresult *result = NULL;
+	int queryResult = ExecuteOptionalRemoteCommand(connection, loadQuery->data,
+												   &result);
+
+	if (queryResult != RESPONSE_OKAY)
+	{
+		ereport(ERROR, (errcode(ERRCODE_CONNECTION_FAILURE),
+						errmsg("cannot get the query load because of a connection "
+							   "error")));
+	}
+
+	List *loadList = ReadFirstColumnAsText(result);
+	if (list_length(loadList) != 1)
+	{
+		ereport(ERROR, (errmsg(
+							"received wrong number of rows from worker, expected 1 received %d",
+							list_length(loadList))));
+	}
+
+	StringInfo queryLoadStringInfo = (StringInfo) linitial(loadList);
+	uint64 queryLoad = SafeStringToUint64(queryLoadStringInfo->data);
+
+	PQclear(result);
+	ForgetResults(connection);
+
+	return queryLoad;
+}
+
+
 /*
  * GetColocatedRebalanceSteps takes a List of PlacementUpdateEvents and creates
  * a new List of containing those and all the updates for colocated shards.
@@ -740,7 +888,7 @@ GetColocatedRebalanceSteps(List *placementUpdateList)
  * instantly because this means another rebalance/replication
  * is currently happening. This would really mess up planning.
  */
-static void
+void
 AcquireRebalanceColocationLock(Oid relationId, const char *operationName)
 {
 	uint32 lockId = relationId;
@@ -1367,8 +1515,11 @@ get_rebalance_progress(PG_FUNCTION_ARGS)
 				shardSize = shardSizesStat->totalSize;
 			}
 
-			Datum values[15];
-			bool nulls[15];
+			uint64 maxCopyRate = WorkerMaxCopyRate(shardStatistics, step->sourceName,
+												   step->sourcePort);
+
+			Datum values[17];
+			bool nulls[17];
 
 			memset(values, 0, sizeof(values));
 			memset(nulls, 0, sizeof(nulls));
@@ -1403,6 +1554,27 @@ get_rebalance_progress(PG_FUNCTION_ARGS)
 												 pg_atomic_read_u64(
 													 &step->updateStatus)]));
 
+			values[15] = UInt64GetDatum(maxCopyRate * 1024);
+			if (maxCopyRate == 0)
+			{
+				nulls[15] = true;
+			}
+
+			/*
+			 * The replication lag is the amount of WAL of the source that the
+			 * subscription of this shard did not apply yet, which is what the
+			 * catch-up phase still needs to process.
+			 */
+			values[16] = Int64GetDatum(0);
+			if (sourceLSN == InvalidXLogRecPtr || targetLSN == InvalidXLogRecPtr)
+			{
+				nulls[16] = true;
+			}
+			else if (sourceLSN > targetLSN)
+			{
+				values[16] = Int64GetDatum((int64) (sourceLSN - targetLSN));
+			}
+
 			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
 		}
 	}
@@ -1588,6 +1760,28 @@ WorkerLSN(HTAB *workerShardStatisticsHash, char *workerName, int workerPort)
 }
 
 
+/*
+ * WorkerMaxCopyRate returns the citus.shard_transfer_max_rate of the given
+ * worker in kB/s, or 0 if it is unlimited or unknown.
+ */
+static uint64
+WorkerMaxCopyRate(HTAB *workerShardStatisticsHash, char *workerName, int workerPort)
+{
+	WorkerHashKey workerKey = { 0 };
+	strlcpy(workerKey.hostname, workerName, MAX_NODE_LENGTH);
+	workerKey.port = workerPort;
+
+	WorkerShardStatistics *workerStats =
+		hash_search(workerShardStatisticsHash, &workerKey, HASH_FIND, NULL);
+	if (!workerStats)
+	{
+		return 0;
+	}
+
+	return workerStats->maxCopyRate;
+}
+
+
 /*
  * BuildWorkerShardStatisticsHash returns a shard id -> shard statistics hash containing
  * sizes of shards on the source node and destination node.
@@ -1627,12 +1821,35 @@ BuildWorkerShardStatisticsHash(PlacementUpdateEventProgress *steps, int stepCoun
 			hash_search(workerShardStatistics, &entry->worker, HASH_ENTER, NULL);
 		moveStat->statistics = statistics;
 		moveStat->workerLSN = GetRemoteLogPosition(connection);
+		moveStat->maxCopyRate = GetRemoteShardTransferMaxRate(connection);
 	}
 
 	return workerShardStatistics;
 }
 
 
+/*
+ * GetRemoteShardTransferMaxRate fetches citus.shard_transfer_max_rate in kB/s
+ * over the given connection, which is the rate at which the shards that the
+ * node sends are copied.
+ */
+static uint64
+GetRemoteShardTransferMaxRate(MultiConnection *connection)
+{
+	char *query = "SELECT setting FROM pg_catalog.pg_settings "
+				  "WHERE name = 'citus.shard_transfer_max_rate'";
+
+	List *settingList = GetQueryResultStringList(connection, query);
+	if (settingList == NIL)
+	{
+		/* the worker runs an older version that cannot limit the rate */
+		return 0;
+	}
+
+	return SafeStringToUint64((char *) linitial(settingList));
+}
+
+
 /*
  * GetShardStatistics fetches the statics for the given shard ids over the
  * given connection. It returns a hashmap where the keys are the shard ids and
@@ -2454,6 +2671,11 @@ RebalancePlacementUpdates(List *workerNodeList, List *activeShardPlacementListLi
 			float4 utilizationLowerBound = ((1.0 - threshold) * averageUtilization);
 			float4 utilizationUpperBound = ((1.0 + threshold) * averageUtilization);
 
+			/* the query load is 0 everywhere when it is not balanced */
+			float4 averageLoadUtilization = (state->totalLoad / state->totalCapacity);
+			float4 loadUtilizationUpperBound = ((1.0 + threshold) *
+												averageLoadUtilization);
+
 			bool moreMovesAvailable = true;
 			while (list_length(state->placementUpdateList) < maxShardMoves &&
 				   moreMovesAvailable)
@@ -2462,8 +2684,27 @@ RebalancePlacementUpdates(List *workerNodeList, List *activeShardPlacementListLi
 					utilizationLowerBound,
 					utilizationUpperBound,
 					improvementThreshold,
+					loadUtilizationUpperBound,
 					state);
 			}
+
+			/*
+			 * Once the costs are balanced, move query load away from nodes
+			 * that are still hot spots without leaving the cost bounds.
+			 */
+			bool moreLoadMovesAvailable = !moreMovesAvailable &&
+										  state->functions->shardLoad != NULL;
+			while (list_length(state->placementUpdateList) < maxShardMoves &&
+				   moreLoadMovesAvailable)
+			{
+				moreLoadMovesAvailable = FindAndMoveShardLoad(
+					utilizationLowerBound,
+					utilizationUpperBound,
+					loadUtilizationUpperBound,
+					maxShardMoves - list_length(state->placementUpdateList),
+					state);
+			}
+			moreMovesAvailable = moreMovesAvailable || moreLoadMovesAvailable;
 			placementUpdateList = state->placementUpdateList;
 
 			if (moreMovesAvailable)
@@ -2550,6 +2791,8 @@ InitRebalanceState(List *workerNodeList, List *shardPlacementList,
 		 */
 		fillState->utilization = CalculateUtilization(fillState->totalCost,
 													  fillState->capacity);
+		fillState->loadUtilization = CalculateUtilization(fillState->totalLoad,
+														  fillState->capacity);
 		state->fillStateListAsc = lappend(state->fillStateListAsc, fillState);
 		state->fillStateListDesc = lappend(state->fillStateListDesc, fillState);
 		state->totalCapacity += fillState->capacity;
@@ -2565,15 +2808,23 @@ InitRebalanceState(List *workerNodeList, List *shardPlacementList,
 
 		*shardCost = functions->shardCost(placement->shardId, functions->context);
 
+		if (functions->shardLoad != NULL)
+		{
+			shardCost->load = functions->shardLoad(placement->shardId,
+												   functions->context);
+		}
+
 		fillState->totalCost += shardCost->cost;
 		fillState->utilization = CalculateUtilization(fillState->totalCost,
 													  fillState->capacity);
+		fillState->totalLoad += shardCost->load;
+		fillState->loadUtilization = CalculateUtilization(fillState->totalLoad,
+														  fillState->capacity);
 		fillState->shardCostListDesc = lappend(fillState->shardCostListDesc,
 											   shardCost);
-		fillState->shardCostListDesc = SortList(fillState->shardCostListDesc,
-												CompareShardCostDesc);
 
 		state->totalCost += shardCost->cost;
+		state->totalLoad += shardCost->load;
 
 		if (!functions->shardAllowedOnNode(placement->shardId, fillState->node,
 										   functions->context))
@@ -2587,6 +2838,14 @@ InitRebalanceState(List *workerNodeList, List *shardPlacementList,
 	}
 	foreach_htab_cleanup(placement, &status);
 
+	/* sort the shards of each node once, instead of after every placement */
+	NodeFillState *nodeFillState = NULL;
+	foreach_ptr(nodeFillState, state->fillStateListAsc)
+	{
+		nodeFillState->shardCostListDesc = SortList(nodeFillState->shardCostListDesc,
+													CompareShardCostDesc);
+	}
+
 	state->fillStateListAsc = SortList(state->fillStateListAsc, CompareNodeFillStateAsc);
 	state->fillStateListDesc = SortList(state->fillStateListDesc,
 										CompareNodeFillStateDesc);
@@ -2681,6 +2940,38 @@ CompareNodeFillStateDesc(const void *a, const void *b)
 }
 
 
+/*
+ * CompareNodeFillStateLoadAsc can be used to sort fill states from the lowest
+ * to the highest query load utilization.
+ */
+static int
+CompareNodeFillStateLoadAsc(const void *void1, const void *void2)
+{
+	const NodeFillState *a = *((const NodeFillState **) void1);
+	const NodeFillState *b = *((const NodeFillState **) void2);
+	if (a->loadUtilization < b->loadUtilization)
+	{
+		return -1;
+	}
+	if (a->loadUtilization > b->loadUtilization)
+	{
+		return 1;
+	}
+	return CompareNodeFillStateAsc(void1, void2);
+}
+
+
+/*
+ * CompareNodeFillStateLoadDesc can be used to sort fill states from the
+ * highest to the lowest query load utilization.
+ */
+static int
+CompareNodeFillStateLoadDesc(const void *a, const void *b)
+{
+	return -CompareNodeFillStateLoadAsc(a, b);
+}
+
+
 /*
  * CompareShardCostAsc can be used to sort shard costs from low cost to high
  * cost.
@@ -2719,6 +3010,38 @@ CompareShardCostDesc(const void *a, const void *b)
 }
 
 
+/*
+ * CompareShardLoadAsc can be used to sort shard costs from low query load to
+ * high query load.
+ */
+static int
+CompareShardLoadAsc(const void *void1, const void *void2)
+{
+	const ShardCost *a = *((const ShardCost **) void1);
+	const ShardCost *b = *((const ShardCost **) void2);
+	if (a->load < b->load)
+	{
+		return -1;
+	}
+	if (a->load > b->load)
+	{
+		return 1;
+	}
+	return CompareShardCostAsc(void1, void2);
+}
+
+
+/*
+ * CompareShardLoadDesc can be used to sort shard costs from high query load
+ * to low query load.
+ */
+static int
+CompareShardLoadDesc(const void *a, const void *b)
+{
+	return -CompareShardLoadAsc(a, b);
+}
+
+
 /*
  * MoveShardsAwayFromDisallowedNodes returns a list of placement updates that
  * move any shards that are not allowed on their current node to a node that
@@ -2819,8 +3142,9 @@ FindAllowedTargetFillState(RebalanceState *state, uint64 shardId)
  * and updates the RebalanceState accordingly. What it does in detail is:
  * 1. add a placement update to state->placementUpdateList
  * 2. update state->placementsHash
- * 3. update totalcost, utilization and shardCostListDesc in source and target
- * 4. resort state->fillStateListAsc/Desc
+ * 3. update totalcost, utilization, the query load and shardCostListDesc in
+ *    source and target
+ * 4. reposition source and target in state->fillStateListAsc/Desc
  */
 static void
 MoveShardCost(NodeFillState *sourceFillState,
@@ -2848,6 +3172,9 @@ MoveShardCost(NodeFillState *sourceFillState,
 	sourceFillState->totalCost -= shardCost->cost;
 	sourceFillState->utilization = CalculateUtilization(sourceFillState->totalCost,
 														sourceFillState->capacity);
+	sourceFillState->totalLoad -= shardCost->load;
+	sourceFillState->loadUtilization = CalculateUtilization(sourceFillState->totalLoad,
+															sourceFillState->capacity);
 	sourceFillState->shardCostListDesc = list_delete_ptr(
 		sourceFillState->shardCostListDesc,
 		shardCost);
@@ -2855,18 +3182,40 @@ MoveShardCost(NodeFillState *sourceFillState,
 	targetFillState->totalCost += shardCost->cost;
 	targetFillState->utilization = CalculateUtilization(targetFillState->totalCost,
 														targetFillState->capacity);
-	targetFillState->shardCostListDesc = lappend(targetFillState->shardCostListDesc,
-												 shardCost);
-	targetFillState->shardCostListDesc = SortList(targetFillState->shardCostListDesc,
-												  CompareShardCostDesc);
-
-	state->fillStateListAsc = SortList(state->fillStateListAsc, CompareNodeFillStateAsc);
-	state->fillStateListDesc = SortList(state->fillStateListDesc,
-										CompareNodeFillStateDesc);
+	targetFillState->totalLoad += shardCost->load;
+	targetFillState->loadUtilization = CalculateUtilization(targetFillState->totalLoad,
+															targetFillState->capacity);
+	targetFillState->shardCostListDesc = SortedListInsert(
+		targetFillState->shardCostListDesc, shardCost, CompareShardCostDesc);
+
+	state->fillStateListAsc = RepositionFillStates(state->fillStateListAsc,
+												   sourceFillState, targetFillState,
+												   CompareNodeFillStateAsc);
+	state->fillStateListDesc = RepositionFillStates(state->fillStateListDesc,
+													sourceFillState, targetFillState,
+													CompareNodeFillStateDesc);
 	CheckRebalanceStateInvariants(state);
 }
 
 
+/*
+ * RepositionFillStates moves the source and target fill states of a move to
+ * their new position in a sorted list of fill states. Only the utilization of
+ * these two changed, so this keeps the list sorted without sorting all nodes
+ * again for every move the rebalancer plans.
+ */
+static List *
+RepositionFillStates(List *fillStateList, NodeFillState *sourceFillState,
+					 NodeFillState *targetFillState,
+					 int (*compareFunction)(const void *, const void *))
+{
+	fillStateList = list_delete_ptr(fillStateList, sourceFillState);
+	fillStateList = list_delete_ptr(fillStateList, targetFillState);
+	fillStateList = SortedListInsert(fillStateList, sourceFillState, compareFunction);
+	return SortedListInsert(fillStateList, targetFillState, compareFunction);
+}
+
+
 /*
  * FindAndMoveShardCost is the main rebalancing algorithm. This takes the
  * current state and returns a list with a new move appended that improves the
@@ -2900,11 +3249,16 @@ MoveShardCost(NodeFillState *sourceFillState,
  * Again this is mostly useful for the by_disk_size rebalance strategy.
  * Without this threshold the rebalancer would move a shard of 1TB when this
  * move only improves the cluster by 10GB.
+ *
+ * loadUtilizationUpperBound is the query load utilization above which a node
+ * is considered a hot spot. Moves that would turn their target into a hot spot
+ * are skipped, so balancing the cost does not pile busy shards onto one node.
  */
 static bool
 FindAndMoveShardCost(float4 utilizationLowerBound,
 					 float4 utilizationUpperBound,
 					 float4 improvementThreshold,
+					 float4 loadUtilizationUpperBound,
 					 RebalanceState *state)
 {
 	NodeFillState *sourceFillState = NULL;
@@ -2976,6 +3330,13 @@ FindAndMoveShardCost(float4 utilizationLowerBound,
 					continue;
 				}
 
+				/* Skip shards that would make the target a query load hot spot */
+				if (MoveCreatesLoadHotSpot(sourceFillState, targetFillState,
+										   shardCost, loadUtilizationUpperBound))
+				{
+					continue;
+				}
+
 				/*
 				 * If the target is still less utilized than the source, then
 				 * this is clearly a good move. And if they are equally
@@ -3077,6 +3438,224 @@ FindAndMoveShardCost(float4 utilizationLowerBound,
 }
 
 
+/*
+ * FindAndMoveShardLoad moves query load away from hot spots once the costs
+ * are balanced. It tries to move a shard from the node with the highest query
+ * load utilization to the node with the lowest one, starting at the shard with
+ * the highest load. If moving the shard alone would leave the cost range,
+ * it tries to swap the shard with a shard of the target that has less load.
+ * That is the common case for the by_shard_count strategy, where every shard
+ * has the same cost. It returns true if it was able to find a move and false
+ * if it couldn't.
+ *
+ * A node is a hot spot when its load utilization is above
+ * loadUtilizationUpperBound. A move is only done when it lowers the highest
+ * load utilization of the source and target and keeps the cost utilization of
+ * both within the bounds, or at least within the range it already was in.
+ * Because of that every move improves the load balance without making the cost
+ * balance worse, just like the moves of FindAndMoveShardCost.
+ *
+ * movesLeft is the number of moves that may still be added, a swap needs two.
+ */
+static bool
+FindAndMoveShardLoad(float4 utilizationLowerBound,
+					 float4 utilizationUpperBound,
+					 float4 loadUtilizationUpperBound,
+					 int32 movesLeft,
+					 RebalanceState *state)
+{
+	NodeFillState *sourceFillState = NULL;
+	NodeFillState *targetFillState = NULL;
+
+	List *fillStateListLoadDesc = SortList(list_copy(state->fillStateListAsc),
+										   CompareNodeFillStateLoadDesc);
+	List *fillStateListLoadAsc = SortList(list_copy(state->fillStateListAsc),
+										  CompareNodeFillStateLoadAsc);
+
+	foreach_ptr(sourceFillState, fillStateListLoadDesc)
+	{
+		/* The remaining nodes are not hot spots, we're done searching */
+		if (sourceFillState->loadUtilization <= loadUtilizationUpperBound)
+		{
+			return false;
+		}
+
+		List *sourceShardListLoadDesc =
+			SortList(list_copy(sourceFillState->shardCostListDesc),
+					 CompareShardLoadDesc);
+
+		foreach_ptr(targetFillState, fillStateListLoadAsc)
+		{
+			ShardCost *shardCost = NULL;
+
+			/* Further target nodes would become hot spots as well */
+			if (targetFillState->loadUtilization >= loadUtilizationUpperBound)
+			{
+				break;
+			}
+
+			List *targetShardListLoadAsc =
+				SortList(list_copy(targetFillState->shardCostListDesc),
+						 CompareShardLoadAsc);
+
+			foreach_ptr(shardCost, sourceShardListLoadDesc)
+			{
+				ShardCost *swapShardCost = NULL;
+
+				/* The remaining shards have no load to move */
+				if (shardCost->load <= 0)
+				{
+					break;
+				}
+
+				if (!ShardCanMoveToNode(state, shardCost->shardId,
+										targetFillState->node))
+				{
+					continue;
+				}
+
+				float4 newTargetLoadUtilization = CalculateUtilization(
+					targetFillState->totalLoad + shardCost->load,
+					targetFillState->capacity);
+
+				if (newTargetLoadUtilization < sourceFillState->loadUtilization &&
+					MoveKeepsCostBalance(sourceFillState, targetFillState,
+										 shardCost->cost, utilizationLowerBound,
+										 utilizationUpperBound))
+				{
+					MoveShardCost(sourceFillState, targetFillState, shardCost, state);
+					return true;
+				}
+
+				if (movesLeft < 2)
+				{
+					continue;
+				}
+
+				/* try to swap the shard with a less loaded shard of the target */
+				foreach_ptr(swapShardCost, targetShardListLoadAsc)
+				{
+					if (swapShardCost->load >= shardCost->load)
+					{
+						break;
+					}
+
+					if (!ShardCanMoveToNode(state, swapShardCost->shardId,
+											sourceFillState->node))
+					{
+						continue;
+					}
+
+					float4 movedLoad = shardCost->load - swapShardCost->load;
+					float4 newSourceLoadUtilization = CalculateUtilization(
+						sourceFillState->totalLoad - movedLoad,
+						sourceFillState->capacity);
+					newTargetLoadUtilization = CalculateUtilization(
+						targetFillState->totalLoad + movedLoad,
+						targetFillState->capacity);
+
+					if (fmaxf(newSourceLoadUtilization, newTargetLoadUtilization) >=
+						sourceFillState->loadUtilization)
+					{
+						continue;
+					}
+
+					if (!MoveKeepsCostBalance(sourceFillState, targetFillState,
+											  shardCost->cost - swapShardCost->cost,
+											  utilizationLowerBound,
+											  utilizationUpperBound))
+					{
+						continue;
+					}
+
+					MoveShardCost(sourceFillState, targetFillState, shardCost, state);
+					MoveShardCost(targetFillState, sourceFillState, swapShardCost,
+								  state);
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+
+/*
+ * MoveCreatesLoadHotSpot returns whether moving the shard would make the
+ * target node a query load hot spot. That is the case when its load
+ * utilization ends up above the upper bound, and above the load utilization
+ * the source had before the move.
+ */
+static bool
+MoveCreatesLoadHotSpot(NodeFillState *sourceFillState,
+					   NodeFillState *targetFillState,
+					   ShardCost *shardCost,
+					   float4 loadUtilizationUpperBound)
+{
+	if (shardCost->load <= 0)
+	{
+		return false;
+	}
+
+	float4 newTargetLoadUtilization = CalculateUtilization(
+		targetFillState->totalLoad + shardCost->load,
+		targetFillState->capacity);
+
+	return newTargetLoadUtilization > fmaxf(loadUtilizationUpperBound,
+											sourceFillState->loadUtilization);
+}
+
+
+/*
+ * MoveKeepsCostBalance returns whether moving movedCost from the source to the
+ * target keeps the cost utilization of both within the utilization bounds, or
+ * within the range spanned by their current utilizations when that is wider.
+ */
+static bool
+MoveKeepsCostBalance(NodeFillState *sourceFillState,
+					 NodeFillState *targetFillState,
+					 float4 movedCost,
+					 float4 utilizationLowerBound,
+					 float4 utilizationUpperBound)
+{
+	float4 newSourceUtilization = CalculateUtilization(
+		sourceFillState->totalCost - movedCost,
+		sourceFillState->capacity);
+	float4 newTargetUtilization = CalculateUtilization(
+		targetFillState->totalCost + movedCost,
+		targetFillState->capacity);
+
+	float4 lowestUtilization = fminf(utilizationLowerBound,
+									 fminf(sourceFillState->utilization,
+										   targetFillState->utilization));
+	float4 highestUtilization = fmaxf(utilizationUpperBound,
+									  fmaxf(sourceFillState->utilization,
+											targetFillState->utilization));
+
+	return newSourceUtilization >= lowestUtilization &&
+		   newSourceUtilization <= highestUtilization &&
+		   newTargetUtilization >= lowestUtilization &&
+		   newTargetUtilization <= highestUtilization;
+}
+
+
+/*
+ * ShardCanMoveToNode returns whether the shard is not yet placed on the given
+ * node and is allowed on it.
+ */
+static bool
+ShardCanMoveToNode(RebalanceState *state, uint64 shardId, WorkerNode *workerNode)
+{
+	if (PlacementsHashFind(state->placementsHash, shardId, workerNode))
+	{
+		return false;
+	}
+
+	return state->functions->shardAllowedOnNode(shardId, workerNode,
+												state->functions->context);
+}
+
+
 /*
  * ReplicationPlacementUpdates returns a list of placement updates which
  * replicates shard placements that need re-replication. To do this, the
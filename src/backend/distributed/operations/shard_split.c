@@ -23,6 +23,7 @@
 #include "utils/lsyscache.h"
 
 #include "distributed/adaptive_executor.h"
+#include "distributed/citus_safe_lib.h"
 #include "distributed/colocation_utils.h"
 #include "distributed/connection_management.h"
 #include "distributed/coordinator_protocol.h"
@@ -30,6 +31,7 @@
 #include "distributed/hash_helpers.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/metadata_sync.h"
+#include "distributed/multi_logical_replication.h"
 #include "distributed/multi_partitioning_utils.h"
 #include "distributed/multi_physical_planner.h"
 #include "distributed/pg_dist_shard.h"
@@ -63,6 +65,16 @@ typedef struct ShardCreatedByWorkflowEntry
  * Key: node + owner
  * Value: List of dummy shards for that node + owner
  */
+/*
+ * SplitCopyBlockRange is the range of blocks [startBlock, endBlock) of a source
+ * shard that a single split copy stream copies.
+ */
+typedef struct SplitCopyBlockRange
+{
+	int64 startBlock;
+	int64 endBlock;
+} SplitCopyBlockRange;
+
 typedef struct GroupedDummyShards
 {
 	NodeAndOwner key;
@@ -118,10 +130,13 @@ static void DoSplitCopy(WorkerNode *sourceShardNode,
 						List *workersForPlacementList,
 						char *snapShotName,
 						DistributionColumnMap *distributionColumnOverrides);
+static List * SplitCopyBlockRangeList(WorkerNode *sourceShardNode,
+									  ShardInterval *sourceShardInterval);
 static StringInfo CreateSplitCopyCommand(ShardInterval *sourceShardSplitInterval,
 										 char *distributionColumnName,
 										 List *splitChildrenShardIntervalList,
-										 List *workersForPlacementList);
+										 List *workersForPlacementList,
+										 SplitCopyBlockRange *blockRange);
 static Task * CreateSplitCopyTask(StringInfo splitCopyUdfCommand, char *snapshotName, int
 								  taskId, uint64 jobId);
 static void UpdateDistributionColumnsForShardGroup(List *colocatedShardList,
@@ -159,6 +174,9 @@ static void AcquireNonblockingSplitLock(Oid relationId);
 static List * GetWorkerNodesFromWorkerIds(List *nodeIdsForPlacementList);
 static void DropShardListMetadata(List *shardIntervalList);
 
+/* number of parallel streams that copy a source shard to its split children */
+int ShardSplitCopyStreams = 1;
+
 /* Customize error message strings based on operation type */
 static const char *const SplitOperationName[] =
 {
@@ -862,23 +880,40 @@ DoSplitCopy(WorkerNode *sourceShardNode, List *sourceColocatedShardIntervalList,
 												   distributionColumn->varattno,
 												   missingOK);
 
-		StringInfo splitCopyUdfCommand = CreateSplitCopyCommand(
-			sourceShardIntervalToCopy,
-			distributionColumnName,
-			splitShardIntervalList,
-			destinationWorkerNodesList);
-
-		/* Create copy task. Snapshot name is required for nonblocking splits */
-		Task *splitCopyTask = CreateSplitCopyTask(splitCopyUdfCommand, snapShotName,
-												  taskId,
-												  sourceShardIntervalToCopy->shardId);
-
-		ShardPlacement *taskPlacement = CitusMakeNode(ShardPlacement);
-		SetPlacementNodeMetadata(taskPlacement, sourceShardNode);
-		splitCopyTask->taskPlacementList = list_make1(taskPlacement);
+		/*
+		 * Large shards can be copied by several streams that each copy a range
+		 * of blocks to all split children, otherwise a single stream copies
+		 * the whole shard.
+		 */
+		List *blockRangeList = SplitCopyBlockRangeList(sourceShardNode,
+													   sourceShardIntervalToCopy);
+		if (blockRangeList == NIL)
+		{
+			blockRangeList = list_make1(NULL);
+		}
 
-		splitCopyTaskList = lappend(splitCopyTaskList, splitCopyTask);
-		taskId++;
+		SplitCopyBlockRange *blockRange = NULL;
+		foreach_ptr(blockRange, blockRangeList)
+		{
+			StringInfo splitCopyUdfCommand = CreateSplitCopyCommand(
+				sourceShardIntervalToCopy,
+				distributionColumnName,
+				splitShardIntervalList,
+				destinationWorkerNodesList,
+				blockRange);
+
+			/* Create copy task. Snapshot name is required for nonblocking splits */
+			Task *splitCopyTask = CreateSplitCopyTask(splitCopyUdfCommand, snapShotName,
+													  taskId,
+													  sourceShardIntervalToCopy->shardId);
+
+			ShardPlacement *taskPlacement = CitusMakeNode(ShardPlacement);
+			SetPlacementNodeMetadata(taskPlacement, sourceShardNode);
+			splitCopyTask->taskPlacementList = list_make1(taskPlacement);
+
+			splitCopyTaskList = lappend(splitCopyTaskList, splitCopyTask);
+			taskId++;
+		}
 	}
 
 	ExecuteTaskListOutsideTransaction(ROW_MODIFY_NONE, splitCopyTaskList,
@@ -887,11 +922,74 @@ DoSplitCopy(WorkerNode *sourceShardNode, List *sourceColocatedShardIntervalList,
 }
 
 
+/*
+ * SplitCopyBlockRangeList returns the block ranges in which the source shard
+ * is copied by citus.shard_split_copy_streams parallel streams, or NIL when a
+ * single stream copies the whole shard. Streams scan their range with a TID
+ * range scan, so the source shard is still only read once. Columnar shards
+ * have no meaningful block ranges and always use a single stream.
+ */
+static List *
+SplitCopyBlockRangeList(WorkerNode *sourceShardNode, ShardInterval *sourceShardInterval)
+{
+	if (ShardSplitCopyStreams <= 1 ||
+		extern_IsColumnarTableAmTable(sourceShardInterval->relationId))
+	{
+		return NIL;
+	}
+
+	char *shardQualifiedName = ConstructQualifiedShardName(sourceShardInterval);
+	StringInfo blockCountQuery = makeStringInfo();
+	appendStringInfo(blockCountQuery,
+					 "SELECT pg_catalog.pg_relation_size(%s, 'main') / "
+					 "pg_catalog.current_setting('block_size')::bigint",
+					 quote_literal_cstr(shardQualifiedName));
+
+	int connectionFlags = 0;
+	MultiConnection *connection = GetNodeConnection(connectionFlags,
+													sourceShardNode->workerName,
+													sourceShardNode->workerPort);
+	List *blockCountList = GetQueryResultStringList(connection, blockCountQuery->data);
+	if (list_length(blockCountList) != 1)
+	{
+		ereport(ERROR, (errmsg("could not get the number of blocks of shard %s",
+							   shardQualifiedName)));
+	}
+
+	int64 blockCount = SafeStringToInt64((char *) linitial(blockCountList));
+
+	/* every stream copies at least one block */
+	int64 streamCount = Min(ShardSplitCopyStreams, blockCount);
+	if (streamCount <= 1)
+	{
+		return NIL;
+	}
+
+	int64 blocksPerStream = (blockCount + streamCount - 1) / streamCount;
+	List *blockRangeList = NIL;
+	for (int64 startBlock = 0; startBlock < blockCount; startBlock += blocksPerStream)
+	{
+		SplitCopyBlockRange *blockRange = palloc0(sizeof(SplitCopyBlockRange));
+		blockRange->startBlock = startBlock;
+		blockRange->endBlock = startBlock + blocksPerStream;
+
+		blockRangeList = lappend(blockRangeList, blockRange);
+	}
+
+	/* the last stream also copies pages that are added in the meantime */
+	SplitCopyBlockRange *lastBlockRange = llast(blockRangeList);
+	lastBlockRange->endBlock = SPLIT_COPY_BLOCK_RANGE_END;
+
+	return blockRangeList;
+}
+
+
 /*
  * Create Copy command for a given shard source shard to be copied to corresponding split children.
  * 'sourceShardSplitInterval' : Source shard interval to be copied.
  * 'splitChildrenShardINnerIntervalList' : List of shard intervals for split children.
  * 'destinationWorkerNodesList' : List of workers for split children placement.
+ * 'blockRange' : Range of blocks of the source shard to copy, NULL for all blocks.
  * Here is an example of a 2 way split copy :
  * SELECT * from worker_split_copy(
  *  81060000, -- source shard id to split copy
@@ -913,7 +1011,8 @@ static StringInfo
 CreateSplitCopyCommand(ShardInterval *sourceShardSplitInterval,
 					   char *distributionColumnName,
 					   List *splitChildrenShardIntervalList,
-					   List *destinationWorkerNodesList)
+					   List *destinationWorkerNodesList,
+					   SplitCopyBlockRange *blockRange)
 {
 	StringInfo splitCopyInfoArray = makeStringInfo();
 	appendStringInfo(splitCopyInfoArray, "ARRAY[");
@@ -943,10 +1042,25 @@ CreateSplitCopyCommand(ShardInterval *sourceShardSplitInterval,
 	appendStringInfo(splitCopyInfoArray, "]");
 
 	StringInfo splitCopyUdf = makeStringInfo();
-	appendStringInfo(splitCopyUdf, "SELECT pg_catalog.worker_split_copy(%lu, %s, %s);",
-					 sourceShardSplitInterval->shardId,
-					 quote_literal_cstr(distributionColumnName),
-					 splitCopyInfoArray->data);
+	if (blockRange != NULL)
+	{
+		appendStringInfo(splitCopyUdf,
+						 "SELECT pg_catalog.worker_split_copy(%lu, %s, %s, "
+						 INT64_FORMAT ", " INT64_FORMAT ");",
+						 sourceShardSplitInterval->shardId,
+						 quote_literal_cstr(distributionColumnName),
+						 splitCopyInfoArray->data,
+						 blockRange->startBlock,
+						 blockRange->endBlock);
+	}
+	else
+	{
+		appendStringInfo(splitCopyUdf,
+						 "SELECT pg_catalog.worker_split_copy(%lu, %s, %s);",
+						 sourceShardSplitInterval->shardId,
+						 quote_literal_cstr(distributionColumnName),
+						 splitCopyInfoArray->data);
+	}
 
 	return splitCopyUdf;
 }
@@ -20,10 +20,12 @@
 #include "access/htup_details.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_enum.h"
+#include "catalog/pg_type.h"
 #include "lib/stringinfo.h"
 #include "nodes/pg_list.h"
 #include "storage/lmgr.h"
 #include "storage/lock.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/elog.h"
 #include "utils/errcodes.h"
@@ -71,6 +73,14 @@ typedef struct ShardCommandList
 	List *ddlCommandList;
 } ShardCommandList;
 
+/*
+ * ShardTransferParallelism is the number of connections that a shard transfer
+ * uses to copy the data and build the indexes of colocated shards, 0 means
+ * citus.max_adaptive_executor_pool_size for the data copy and one shard at a
+ * time for the indexes.
+ */
+int ShardTransferParallelism = 0;
+
 static const char *ShardTransferTypeNames[] = {
 	[SHARD_TRANSFER_INVALID_FIRST] = "unknown",
 	[SHARD_TRANSFER_MOVE] = "move",
@@ -115,8 +125,9 @@ static void CopyShardTablesViaLogicalReplication(List *shardIntervalList,
 												 int32 targetNodePort);
 
 static void CopyShardTablesViaBlockWrites(List *shardIntervalList, char *sourceNodeName,
-										  int32 sourceNodePort,
-										  char *targetNodeName, int32 targetNodePort);
+										  int32 sourceNodePort, List *targetNodeList);
+static List * CopyShardsToNodeTaskList(WorkerNode *sourceNode, WorkerNode *targetNode,
+									   List *shardIntervalList, char *snapshotName);
 static void EnsureShardCanBeCopied(int64 shardId, const char *sourceNodeName,
 								   int32 sourceNodePort, const char *targetNodeName,
 								   int32 targetNodePort);
@@ -127,6 +138,9 @@ static void ErrorIfReplicatingDistributedTableWithFKeys(List *tableIdList);
 static void DropShardPlacementsFromMetadata(List *shardList,
 											char *nodeName,
 											int32 nodePort);
+static void UpdateShardPlacementMetadataOnWorkers(List *shardIntervalList,
+												  int32 sourceGroupId,
+												  int32 targetGroupId);
 static void UpdateColocatedShardPlacementMetadataOnWorkers(int64 shardId,
 														   char *sourceNodeName,
 														   int32 sourceNodePort,
@@ -165,11 +179,18 @@ static List * PostLoadShardCreationCommandList(ShardInterval *shardInterval,
 static ShardCommandList * CreateShardCommandList(ShardInterval *shardInterval,
 												 List *ddlCommandList);
 static char * CreateShardCopyCommand(ShardInterval *shard, WorkerNode *targetNode);
+static void ExecutePostLoadShardCreationCommands(List *shardIntervalList,
+												 char *sourceNodeName,
+												 int32 sourceNodePort,
+												 WorkerNode *targetNode);
+static void CopyShardPlacementToNodes(int64 shardId, WorkerNode *sourceNode,
+									  List *targetNodeList, char shardReplicationMode);
 
 
 /* declarations for dynamic loading */
 PG_FUNCTION_INFO_V1(citus_copy_shard_placement);
 PG_FUNCTION_INFO_V1(citus_copy_shard_placement_with_nodeid);
+PG_FUNCTION_INFO_V1(citus_copy_shard_placement_to_nodes);
 PG_FUNCTION_INFO_V1(master_copy_shard_placement);
 PG_FUNCTION_INFO_V1(citus_move_shard_placement);
 PG_FUNCTION_INFO_V1(citus_move_shard_placement_with_nodeid);
@@ -238,6 +259,52 @@ citus_copy_shard_placement_with_nodeid(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * citus_copy_shard_placement_to_nodes implements a UDF to copy a placement, including
+ * all co-located placements, from a source node to several target nodes at once.
+ */
+Datum
+citus_copy_shard_placement_to_nodes(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+
+	int64 shardId = PG_GETARG_INT64(0);
+	uint32 sourceNodeId = PG_GETARG_INT32(1);
+	ArrayType *targetNodeIdArray = PG_GETARG_ARRAYTYPE_P(2);
+	Oid shardReplicationModeOid = PG_GETARG_OID(3);
+
+	if (array_contains_nulls(targetNodeIdArray))
+	{
+		ereport(ERROR, (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+						errmsg("target node ids cannot contain NULL values")));
+	}
+
+	bool missingOk = false;
+	WorkerNode *sourceNode = FindNodeWithNodeId(sourceNodeId, missingOk);
+
+	Datum *targetNodeIdDatumArray = NULL;
+	int targetNodeCount = 0;
+	deconstruct_array(targetNodeIdArray, INT4OID, sizeof(int32), true, TYPALIGN_INT,
+					  &targetNodeIdDatumArray, NULL, &targetNodeCount);
+
+	List *targetNodeList = NIL;
+	for (int targetNodeIndex = 0; targetNodeIndex < targetNodeCount; targetNodeIndex++)
+	{
+		uint32 targetNodeId = DatumGetInt32(targetNodeIdDatumArray[targetNodeIndex]);
+		WorkerNode *targetNode = FindNodeWithNodeId(targetNodeId, missingOk);
+
+		targetNodeList = lappend(targetNodeList, targetNode);
+	}
+
+	char shardReplicationMode = LookupShardTransferMode(shardReplicationModeOid);
+
+	CopyShardPlacementToNodes(shardId, sourceNode, targetNodeList, shardReplicationMode);
+
+	PG_RETURN_VOID();
+}
+
+
 /*
  * master_copy_shard_placement is a wrapper function for old UDF name.
  */
@@ -574,6 +641,376 @@ TransferShards(int64 shardId, char *sourceNodeName,
 }
 
 
+/*
+ * CopyShardPlacementToNodes copies the given shard and its co-located shards from
+ * the source node to each of the target nodes, which do not have the shards yet.
+ *
+ * It does the same as a shard copy via TransferShards for each target node, but
+ * when writes are blocked during the copy, they are blocked once while the data
+ * is copied to all target nodes in parallel. Logical replication does not block
+ * writes, so in that case the shards are replicated to one node at a time.
+ */
+static void
+CopyShardPlacementToNodes(int64 shardId, WorkerNode *sourceNode, List *targetNodeList,
+						  char shardReplicationMode)
+{
+	ShardTransferType transferType = SHARD_TRANSFER_COPY;
+	const char *operationName = ShardTransferTypeNames[transferType];
+	const char *operationNameCapitalized =
+		ShardTransferTypeNamesCapitalized[transferType];
+	const char *operationFunctionName = ShardTransferTypeFunctionNames[transferType];
+	char *sourceNodeName = sourceNode->workerName;
+	int32 sourceNodePort = sourceNode->workerPort;
+
+	ShardInterval *shardInterval = LoadShardInterval(shardId);
+	Oid distributedTableId = shardInterval->relationId;
+
+	ErrorIfTableCannotBeReplicated(distributedTableId);
+	EnsureNoModificationsHaveBeenDone();
+
+	AcquirePlacementColocationLock(distributedTableId, ExclusiveLock, operationName);
+
+	List *colocatedTableList = ColocatedTableList(distributedTableId);
+	List *colocatedShardList = ColocatedShardIntervalList(shardInterval);
+
+	EnsureTableListOwner(colocatedTableList);
+	ErrorIfForeignTableForShardTransfer(colocatedTableList, transferType);
+	ErrorIfReplicatingDistributedTableWithFKeys(colocatedTableList);
+
+	/*
+	 * We sort shardIntervalList so that lock operations will not cause any
+	 * deadlocks.
+	 */
+	colocatedShardList = SortList(colocatedShardList, CompareShardIntervalsById);
+
+	List *copyTargetNodeList = NIL;
+	List *placementUpdateEventList = NIL;
+	WorkerNode *targetNode = NULL;
+	foreach_ptr(targetNode, targetNodeList)
+	{
+		char *targetNodeName = targetNode->workerName;
+		int32 targetNodePort = targetNode->workerPort;
+
+		ErrorIfSameNode(sourceNodeName, sourceNodePort,
+						targetNodeName, targetNodePort,
+						operationName);
+		ErrorIfTargetNodeIsNotSafeForTransfer(targetNodeName, targetNodePort,
+											  transferType);
+
+		bool duplicateTargetNode = false;
+		WorkerNode *copyTargetNode = NULL;
+		foreach_ptr(copyTargetNode, copyTargetNodeList)
+		{
+			if (copyTargetNode->nodeId == targetNode->nodeId)
+			{
+				duplicateTargetNode = true;
+				break;
+			}
+		}
+
+		if (duplicateTargetNode)
+		{
+			continue;
+		}
+
+		if (TransferAlreadyCompleted(colocatedShardList,
+									 sourceNodeName, sourceNodePort,
+									 targetNodeName, targetNodePort,
+									 transferType))
+		{
+			ereport(WARNING, (errmsg("shard is already present on node %s:%d",
+									 targetNodeName, targetNodePort),
+							  errdetail("%s may have already completed.",
+										operationNameCapitalized)));
+			continue;
+		}
+
+		EnsureAllShardsCanBeCopied(colocatedShardList, sourceNodeName, sourceNodePort,
+								   targetNodeName, targetNodePort);
+		EnsureEnoughDiskSpaceForShardMove(colocatedShardList,
+										  sourceNodeName, sourceNodePort,
+										  targetNodeName, targetNodePort, transferType);
+
+		PlacementUpdateEvent *placementUpdateEvent =
+			palloc0(sizeof(PlacementUpdateEvent));
+		placementUpdateEvent->updateType = PLACEMENT_UPDATE_COPY;
+		placementUpdateEvent->shardId = shardId;
+		placementUpdateEvent->sourceNode = sourceNode;
+		placementUpdateEvent->targetNode = targetNode;
+
+		placementUpdateEventList = lappend(placementUpdateEventList,
+										   placementUpdateEvent);
+		copyTargetNodeList = lappend(copyTargetNodeList, targetNode);
+	}
+
+	if (copyTargetNodeList == NIL)
+	{
+		return;
+	}
+
+	if (shardReplicationMode == TRANSFER_MODE_AUTOMATIC)
+	{
+		VerifyTablesHaveReplicaIdentity(colocatedTableList);
+	}
+
+	SetupRebalanceMonitor(placementUpdateEventList, distributedTableId,
+						  REBALANCE_PROGRESS_MOVING,
+						  PLACEMENT_UPDATE_STATUS_SETTING_UP);
+
+	bool useLogicalReplication = CanUseLogicalReplication(distributedTableId,
+														  shardReplicationMode);
+	if (!useLogicalReplication)
+	{
+		BlockWritesToShardList(colocatedShardList);
+	}
+
+	if (!IsCitusTableType(distributedTableId, REFERENCE_TABLE))
+	{
+		/* same as in TransferShards, make sure joins work right after the copy */
+		EnsureReferenceTablesExistOnAllNodesExtended(shardReplicationMode);
+	}
+
+	DropOrphanedResourcesInSeparateTransaction();
+
+	ShardInterval *colocatedShard = NULL;
+	foreach_ptr(colocatedShard, colocatedShardList)
+	{
+		char *qualifiedShardName = ConstructQualifiedShardName(colocatedShard);
+		ErrorIfCleanupRecordForShardExists(qualifiedShardName);
+	}
+
+	if (useLogicalReplication)
+	{
+		foreach_ptr(targetNode, copyTargetNodeList)
+		{
+			CopyShardTables(colocatedShardList, sourceNodeName, sourceNodePort,
+							targetNode->workerName, targetNode->workerPort,
+							useLogicalReplication, operationFunctionName);
+		}
+	}
+	else
+	{
+		RegisterOperationNeedingCleanup();
+
+		CopyShardTablesViaBlockWrites(colocatedShardList, sourceNodeName,
+									  sourceNodePort, copyTargetNodeList);
+
+		FinalizeOperationNeedingCleanupOnSuccess(operationFunctionName);
+	}
+
+	/*
+	 * Finally insert the placements to pg_dist_placement and sync it to the
+	 * metadata workers.
+	 */
+	foreach_ptr(targetNode, copyTargetNodeList)
+	{
+		foreach_ptr(colocatedShard, colocatedShardList)
+		{
+			uint64 colocatedShardId = colocatedShard->shardId;
+			uint64 placementId = GetNextPlacementId();
+
+			InsertShardPlacementRow(colocatedShardId, placementId,
+									ShardLength(colocatedShardId),
+									targetNode->groupId);
+
+			if (ShouldSyncTableMetadata(colocatedShard->relationId))
+			{
+				char *placementCommand = PlacementUpsertCommand(colocatedShardId,
+																placementId, 0,
+																targetNode->groupId);
+
+				SendCommandToWorkersWithMetadata(placementCommand);
+			}
+		}
+	}
+
+	UpdatePlacementUpdateStatusForShardIntervalList(
+		colocatedShardList,
+		sourceNodeName,
+		sourceNodePort,
+		PLACEMENT_UPDATE_STATUS_COMPLETED);
+
+	FinalizeCurrentProgressMonitor();
+}
+
+
+/*
+ * MoveShardGroupsToNode moves the co-location groups of the given shard
+ * intervals from the source node to the target node at once.
+ *
+ * It does the same as a shard move via TransferShards for each shard, but the
+ * shards of all groups are copied in a single logical replication session or
+ * a single parallel COPY, and the metadata of all groups is updated together.
+ * That is much cheaper for many small co-location groups, such as the ones of
+ * tenant schemas, than moving them one at a time.
+ */
+void
+MoveShardGroupsToNode(List *anchorShardList, WorkerNode *sourceNode,
+					  WorkerNode *targetNode, char shardReplicationMode)
+{
+	ShardTransferType transferType = SHARD_TRANSFER_MOVE;
+	const char *operationName = ShardTransferTypeNames[transferType];
+	const char *operationFunctionName = ShardTransferTypeFunctionNames[transferType];
+	char *sourceNodeName = sourceNode->workerName;
+	int32 sourceNodePort = sourceNode->workerPort;
+	char *targetNodeName = targetNode->workerName;
+	int32 targetNodePort = targetNode->workerPort;
+
+	ErrorIfSameNode(sourceNodeName, sourceNodePort,
+					targetNodeName, targetNodePort,
+					operationName);
+	ErrorIfTargetNodeIsNotSafeForTransfer(targetNodeName, targetNodePort,
+										  transferType);
+
+	/* lock the co-location groups in a consistent order to avoid deadlocks */
+	anchorShardList = SortList(anchorShardList, CompareShardIntervalsById);
+
+	List *movedTableList = NIL;
+	List *movedShardList = NIL;
+	List *placementUpdateEventList = NIL;
+	bool useLogicalReplication = true;
+
+	ShardInterval *anchorShard = NULL;
+	foreach_ptr(anchorShard, anchorShardList)
+	{
+		Oid distributedTableId = anchorShard->relationId;
+
+		ErrorIfMoveUnsupportedTableType(distributedTableId);
+		AcquirePlacementColocationLock(distributedTableId, ExclusiveLock,
+									   operationName);
+
+		List *colocatedTableList = ColocatedTableList(distributedTableId);
+		List *colocatedShardList = ColocatedShardIntervalList(anchorShard);
+
+		EnsureTableListOwner(colocatedTableList);
+		LockColocatedRelationsForMove(colocatedTableList);
+		ErrorIfForeignTableForShardTransfer(colocatedTableList, transferType);
+
+		if (TransferAlreadyCompleted(colocatedShardList,
+									 sourceNodeName, sourceNodePort,
+									 targetNodeName, targetNodePort,
+									 transferType))
+		{
+			ereport(WARNING, (errmsg("shard is already present on node %s:%d",
+									 targetNodeName, targetNodePort),
+							  errdetail("Move of shard " UINT64_FORMAT
+										" may have already completed.",
+										anchorShard->shardId)));
+			continue;
+		}
+
+		EnsureAllShardsCanBeCopied(colocatedShardList, sourceNodeName, sourceNodePort,
+								   targetNodeName, targetNodePort);
+
+		useLogicalReplication &= CanUseLogicalReplication(distributedTableId,
+														  shardReplicationMode);
+
+		PlacementUpdateEvent *placementUpdateEvent =
+			palloc0(sizeof(PlacementUpdateEvent));
+		placementUpdateEvent->updateType = PLACEMENT_UPDATE_MOVE;
+		placementUpdateEvent->shardId = anchorShard->shardId;
+		placementUpdateEvent->sourceNode = sourceNode;
+		placementUpdateEvent->targetNode = targetNode;
+
+		placementUpdateEventList = lappend(placementUpdateEventList,
+										   placementUpdateEvent);
+		movedTableList = list_concat(movedTableList, colocatedTableList);
+		movedShardList = list_concat(movedShardList, colocatedShardList);
+	}
+
+	if (movedShardList == NIL)
+	{
+		return;
+	}
+
+	/*
+	 * We sort shardIntervalList so that lock operations will not cause any
+	 * deadlocks.
+	 */
+	movedShardList = SortList(movedShardList, CompareShardIntervalsById);
+
+	if (shardReplicationMode == TRANSFER_MODE_AUTOMATIC)
+	{
+		VerifyTablesHaveReplicaIdentity(movedTableList);
+	}
+
+	EnsureEnoughDiskSpaceForShardMove(movedShardList,
+									  sourceNodeName, sourceNodePort,
+									  targetNodeName, targetNodePort, transferType);
+
+	if (!IsRebalancerInternalBackend())
+	{
+		ShardInterval *firstAnchorShard = linitial(anchorShardList);
+		SetupRebalanceMonitor(placementUpdateEventList, firstAnchorShard->relationId,
+							  REBALANCE_PROGRESS_MOVING,
+							  PLACEMENT_UPDATE_STATUS_SETTING_UP);
+	}
+
+	UpdatePlacementUpdateStatusForShardIntervalList(
+		movedShardList,
+		sourceNodeName,
+		sourceNodePort,
+		PLACEMENT_UPDATE_STATUS_SETTING_UP);
+
+	if (!useLogicalReplication)
+	{
+		BlockWritesToShardList(movedShardList);
+	}
+	else
+	{
+		/* same as in TransferShards, avoid a self-deadlock on slot creation */
+		if (PlacementMovedUsingLogicalReplicationInTX)
+		{
+			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							errmsg("moving multiple shard placements via logical "
+								   "replication in the same transaction is currently "
+								   "not supported"),
+							errhint("If you wish to move multiple shard placements "
+									"in a single transaction set the shard_transfer_mode "
+									"to 'block_writes'.")));
+		}
+
+		PlacementMovedUsingLogicalReplicationInTX = true;
+	}
+
+	DropOrphanedResourcesInSeparateTransaction();
+
+	ShardInterval *movedShard = NULL;
+	foreach_ptr(movedShard, movedShardList)
+	{
+		char *qualifiedShardName = ConstructQualifiedShardName(movedShard);
+		ErrorIfCleanupRecordForShardExists(qualifiedShardName);
+	}
+
+	CopyShardTables(movedShardList, sourceNodeName, sourceNodePort, targetNodeName,
+					targetNodePort, useLogicalReplication, operationFunctionName);
+
+	/* delete old shards metadata and mark the shards as to be deferred drop */
+	InsertCleanupRecordsForShardPlacementsOnNode(movedShardList, sourceNode->groupId);
+
+	foreach_ptr(movedShard, movedShardList)
+	{
+		uint64 movedShardId = movedShard->shardId;
+		uint64 placementId = GetNextPlacementId();
+
+		InsertShardPlacementRow(movedShardId, placementId, ShardLength(movedShardId),
+								targetNode->groupId);
+	}
+
+	DropShardPlacementsFromMetadata(movedShardList, sourceNodeName, sourceNodePort);
+	UpdateShardPlacementMetadataOnWorkers(movedShardList, sourceNode->groupId,
+										  targetNode->groupId);
+
+	UpdatePlacementUpdateStatusForShardIntervalList(
+		movedShardList,
+		sourceNodeName,
+		sourceNodePort,
+		PLACEMENT_UPDATE_STATUS_COMPLETED);
+
+	FinalizeCurrentProgressMonitor();
+}
+
+
 /*
  * Insert deferred cleanup records.
  * The shards will be dropped by background cleaner later.
@@ -1351,8 +1788,10 @@ CopyShardTables(List *shardIntervalList, char *sourceNodeName, int32 sourceNodeP
 	}
 	else
 	{
+		WorkerNode *targetNode = FindWorkerNode(targetNodeName, targetNodePort);
+
 		CopyShardTablesViaBlockWrites(shardIntervalList, sourceNodeName, sourceNodePort,
-									  targetNodeName, targetNodePort);
+									  list_make1(targetNode));
 	}
 
 	/*
@@ -1431,13 +1870,15 @@ CreateShardCommandList(ShardInterval *shardInterval, List *ddlCommandList)
 
 /*
  * CopyShardTablesViaBlockWrites copies a shard along with its co-located shards
- * from a source node to target node via COPY command. While the command is in
- * progress, the modifications on the source node is blocked.
+ * from a source node to each of the target nodes via COPY command. While the
+ * command is in progress, the modifications on the source node is blocked.
+ *
+ * The data of all shards is copied to all target nodes at once, such that
+ * copying to several nodes blocks the writes about as long as copying to one.
  */
 static void
 CopyShardTablesViaBlockWrites(List *shardIntervalList, char *sourceNodeName,
-							  int32 sourceNodePort, char *targetNodeName,
-							  int32 targetNodePort)
+							  int32 sourceNodePort, List *targetNodeList)
 {
 	MemoryContext localContext = AllocSetContextCreate(CurrentMemoryContext,
 													   "CopyShardTablesViaBlockWrites",
@@ -1445,35 +1886,40 @@ CopyShardTablesViaBlockWrites(List *shardIntervalList, char *sourceNodeName,
 	MemoryContext oldContext = MemoryContextSwitchTo(localContext);
 
 	WorkerNode *sourceNode = FindWorkerNode(sourceNodeName, sourceNodePort);
-	WorkerNode *targetNode = FindWorkerNode(targetNodeName, targetNodePort);
 
 	/* iterate through the colocated shards and copy each */
 	ShardInterval *shardInterval = NULL;
-	foreach_ptr(shardInterval, shardIntervalList)
+	WorkerNode *targetNode = NULL;
+	foreach_ptr(targetNode, targetNodeList)
 	{
-		/*
-		 * For each shard we first create the shard table in a separate
-		 * transaction and then we copy the data and create the indexes in a
-		 * second separate transaction. The reason we don't do both in a single
-		 * transaction is so we can see the size of the new shard growing
-		 * during the copy when we run get_rebalance_progress in another
-		 * session. If we wouldn't split these two phases up, then the table
-		 * wouldn't be visible in the session that get_rebalance_progress uses.
-		 * So get_rebalance_progress would always report its size as 0.
-		 */
-		List *ddlCommandList = RecreateShardDDLCommandList(shardInterval, sourceNodeName,
-														   sourceNodePort);
-		char *tableOwner = TableOwner(shardInterval->relationId);
-
-		/* drop the shard we created on the target, in case of failure */
-		InsertCleanupRecordOutsideTransaction(CLEANUP_OBJECT_SHARD_PLACEMENT,
-											  ConstructQualifiedShardName(shardInterval),
-											  GroupForNode(targetNodeName,
-														   targetNodePort),
-											  CLEANUP_ON_FAILURE);
-
-		SendCommandListToWorkerOutsideTransaction(targetNodeName, targetNodePort,
-												  tableOwner, ddlCommandList);
+		foreach_ptr(shardInterval, shardIntervalList)
+		{
+			/*
+			 * For each shard we first create the shard table in a separate
+			 * transaction and then we copy the data and create the indexes in a
+			 * second separate transaction. The reason we don't do both in a single
+			 * transaction is so we can see the size of the new shard growing
+			 * during the copy when we run get_rebalance_progress in another
+			 * session. If we wouldn't split these two phases up, then the table
+			 * wouldn't be visible in the session that get_rebalance_progress uses.
+			 * So get_rebalance_progress would always report its size as 0.
+			 */
+			List *ddlCommandList = RecreateShardDDLCommandList(shardInterval,
+															   sourceNodeName,
+															   sourceNodePort);
+			char *tableOwner = TableOwner(shardInterval->relationId);
+
+			/* drop the shard we created on the target, in case of failure */
+			InsertCleanupRecordOutsideTransaction(CLEANUP_OBJECT_SHARD_PLACEMENT,
+												  ConstructQualifiedShardName(
+													  shardInterval),
+												  targetNode->groupId,
+												  CLEANUP_ON_FAILURE);
+
+			SendCommandListToWorkerOutsideTransaction(targetNode->workerName,
+													  targetNode->workerPort,
+													  tableOwner, ddlCommandList);
+		}
 	}
 
 	UpdatePlacementUpdateStatusForShardIntervalList(
@@ -1482,8 +1928,26 @@ CopyShardTablesViaBlockWrites(List *shardIntervalList, char *sourceNodeName,
 		sourceNodePort,
 		PLACEMENT_UPDATE_STATUS_COPYING_DATA);
 
+	List *copyTaskList = NIL;
+	foreach_ptr(targetNode, targetNodeList)
+	{
+		copyTaskList = list_concat(copyTaskList,
+								   CopyShardsToNodeTaskList(sourceNode, targetNode,
+															shardIntervalList, NULL));
+	}
+
+	/* task IDs are only unique per target node, renumber them */
+	int taskId = 0;
+	Task *copyTask = NULL;
+	foreach_ptr(copyTask, copyTaskList)
+	{
+		copyTask->taskId = taskId++;
+	}
+
 	ConflictWithIsolationTestingBeforeCopy();
-	CopyShardsToNode(sourceNode, targetNode, shardIntervalList, NULL);
+	ExecuteTaskListOutsideTransaction(ROW_MODIFY_NONE, copyTaskList,
+									  ShardTransferPoolSize(),
+									  NULL /* jobIdList (ignored by API implementation) */);
 	ConflictWithIsolationTestingAfterCopy();
 
 	UpdatePlacementUpdateStatusForShardIntervalList(
@@ -1492,16 +1956,28 @@ CopyShardTablesViaBlockWrites(List *shardIntervalList, char *sourceNodeName,
 		sourceNodePort,
 		PLACEMENT_UPDATE_STATUS_CREATING_CONSTRAINTS);
 
-	foreach_ptr(shardInterval, shardIntervalList)
+	foreach_ptr(targetNode, targetNodeList)
 	{
-		List *ddlCommandList =
-			PostLoadShardCreationCommandList(shardInterval, sourceNodeName,
-											 sourceNodePort);
-		char *tableOwner = TableOwner(shardInterval->relationId);
-		SendCommandListToWorkerOutsideTransaction(targetNodeName, targetNodePort,
-												  tableOwner, ddlCommandList);
-
-		MemoryContextReset(localContext);
+		if (ShardTransferParallelism > 0)
+		{
+			ExecutePostLoadShardCreationCommands(shardIntervalList, sourceNodeName,
+												 sourceNodePort, targetNode);
+		}
+		else
+		{
+			foreach_ptr(shardInterval, shardIntervalList)
+			{
+				List *ddlCommandList =
+					PostLoadShardCreationCommandList(shardInterval, sourceNodeName,
+													 sourceNodePort);
+				char *tableOwner = TableOwner(shardInterval->relationId);
+				SendCommandListToWorkerOutsideTransaction(targetNode->workerName,
+														  targetNode->workerPort,
+														  tableOwner, ddlCommandList);
+
+				MemoryContextReset(localContext);
+			}
+		}
 	}
 
 	/*
@@ -1552,13 +2028,17 @@ CopyShardTablesViaBlockWrites(List *shardIntervalList, char *sourceNodeName,
 	}
 
 	/* Now execute the Partitioning & Foreign constraints creation commads. */
-	ShardCommandList *shardCommandList = NULL;
-	foreach_ptr(shardCommandList, shardIntervalWithDDCommandsList)
+	foreach_ptr(targetNode, targetNodeList)
 	{
-		char *tableOwner = TableOwner(shardCommandList->shardInterval->relationId);
-		SendCommandListToWorkerOutsideTransaction(targetNodeName, targetNodePort,
-												  tableOwner,
-												  shardCommandList->ddlCommandList);
+		ShardCommandList *shardCommandList = NULL;
+		foreach_ptr(shardCommandList, shardIntervalWithDDCommandsList)
+		{
+			char *tableOwner = TableOwner(shardCommandList->shardInterval->relationId);
+			SendCommandListToWorkerOutsideTransaction(targetNode->workerName,
+													  targetNode->workerPort,
+													  tableOwner,
+													  shardCommandList->ddlCommandList);
+		}
 	}
 
 	UpdatePlacementUpdateStatusForShardIntervalList(
@@ -1579,6 +2059,23 @@ CopyShardTablesViaBlockWrites(List *shardIntervalList, char *sourceNodeName,
 void
 CopyShardsToNode(WorkerNode *sourceNode, WorkerNode *targetNode, List *shardIntervalList,
 				 char *snapshotName)
+{
+	List *copyTaskList = CopyShardsToNodeTaskList(sourceNode, targetNode,
+												  shardIntervalList, snapshotName);
+
+	ExecuteTaskListOutsideTransaction(ROW_MODIFY_NONE, copyTaskList,
+									  ShardTransferPoolSize(),
+									  NULL /* jobIdList (ignored by API implementation) */);
+}
+
+
+/*
+ * CopyShardsToNodeTaskList returns the tasks that copy the given shards from
+ * the source to the target, one task per shard that contains data.
+ */
+static List *
+CopyShardsToNodeTaskList(WorkerNode *sourceNode, WorkerNode *targetNode,
+						 List *shardIntervalList, char *snapshotName)
 {
 	int taskId = 0;
 	List *copyTaskList = NIL;
@@ -1645,9 +2142,79 @@ CopyShardsToNode(WorkerNode *sourceNode, WorkerNode *targetNode, List *shardInte
 		taskId++;
 	}
 
-	ExecuteTaskListOutsideTransaction(ROW_MODIFY_NONE, copyTaskList,
-									  MaxAdaptiveExecutorPoolSize,
-									  NULL /* jobIdList (ignored by API implementation) */);
+	return copyTaskList;
+}
+
+
+/*
+ * ShardTransferPoolSize returns the number of connections that a shard
+ * transfer uses to copy the data and build the indexes of colocated shards.
+ */
+int
+ShardTransferPoolSize(void)
+{
+	if (ShardTransferParallelism > 0)
+	{
+		return ShardTransferParallelism;
+	}
+
+	return MaxAdaptiveExecutorPoolSize;
+}
+
+
+/*
+ * ExecutePostLoadShardCreationCommands creates the indexes and the other
+ * post-load objects of the given shards on the target node, building the
+ * objects of up to citus.shard_transfer_parallelism shards at a time.
+ *
+ * The commands of a shard depend on each other, so they run in order in a
+ * single transaction as the table owner, like they do when the shards are
+ * handled one at a time.
+ */
+static void
+ExecutePostLoadShardCreationCommands(List *shardIntervalList, char *sourceNodeName,
+									 int32 sourceNodePort, WorkerNode *targetNode)
+{
+	List *taskList = NIL;
+	int taskId = 1;
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		List *ddlCommandList =
+			PostLoadShardCreationCommandList(shardInterval, sourceNodeName,
+											 sourceNodePort);
+		if (ddlCommandList == NIL)
+		{
+			continue;
+		}
+
+		char *tableOwner = TableOwner(shardInterval->relationId);
+		char *setRoleCommand = psprintf("SET LOCAL ROLE %s",
+										quote_identifier(tableOwner));
+
+		List *queryStringList = list_make2("BEGIN", setRoleCommand);
+		queryStringList = list_concat(queryStringList, ddlCommandList);
+		queryStringList = lappend(queryStringList, "COMMIT");
+
+		Task *task = CitusMakeNode(Task);
+		task->jobId = shardInterval->shardId;
+		task->taskId = taskId++;
+		task->taskType = DDL_TASK;
+		task->replicationModel = REPLICATION_MODEL_INVALID;
+		SetTaskQueryStringList(task, queryStringList);
+
+		/* this placement is not in the metadata yet */
+		ShardPlacement *taskPlacement = CitusMakeNode(ShardPlacement);
+		SetPlacementNodeMetadata(taskPlacement, targetNode);
+
+		task->taskPlacementList = list_make1(taskPlacement);
+
+		taskList = lappend(taskList, task);
+	}
+
+	ExecuteTaskListOutsideTransaction(ROW_MODIFY_NONE, taskList,
+									  ShardTransferPoolSize(), NIL);
 }
 
 
@@ -2055,6 +2622,43 @@ UpdateColocatedShardPlacementMetadataOnWorkers(int64 shardId,
 }
 
 
+/*
+ * UpdateShardPlacementMetadataOnWorkers moves the placements of the given shards
+ * from the source group to the target group in the metadata of the workers,
+ * using a single command for all shards of tables whose metadata is synced.
+ */
+static void
+UpdateShardPlacementMetadataOnWorkers(List *shardIntervalList, int32 sourceGroupId,
+									  int32 targetGroupId)
+{
+	StringInfo shardIdArray = makeStringInfo();
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		if (!ShouldSyncTableMetadata(shardInterval->relationId))
+		{
+			continue;
+		}
+
+		appendStringInfo(shardIdArray, "%s" UINT64_FORMAT,
+						 shardIdArray->len > 0 ? "," : "", shardInterval->shardId);
+	}
+
+	if (shardIdArray->len == 0)
+	{
+		return;
+	}
+
+	StringInfo updateCommand = makeStringInfo();
+	appendStringInfo(updateCommand,
+					 "SELECT citus_internal.update_placement_metadata(shardid, %d, %d) "
+					 "FROM unnest(ARRAY[%s]::bigint[]) shardid",
+					 sourceGroupId, targetGroupId, shardIdArray->data);
+	SendCommandToWorkersWithMetadata(updateCommand->data);
+}
+
+
 /*
  * WorkerApplyShardDDLCommandList wraps all DDL commands in ddlCommandList
  * in a call to worker_apply_shard_ddl_command to apply the DDL command to
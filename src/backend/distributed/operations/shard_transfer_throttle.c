@@ -0,0 +1,237 @@
+/*-------------------------------------------------------------------------
+ *
+ * shard_transfer_throttle.c
+ *   Rate limiting of the data that shard moves, copies and splits send from
+ *   a node, such that they do not saturate its disks and network.
+ *
+ *   All streams that copy shards from a node share a budget of
+ *   citus.shard_transfer_max_rate per second. Each stream reserves a time
+ *   slot for every chunk it sends, right after the slots that other streams
+ *   reserved before, and sleeps until its slot starts.
+ *
+ *   The rate is kept in shared memory, so that a configuration reload
+ *   changes it for the transfers that are already running.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "pgstat.h"
+
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/timestamp.h"
+
+#include "pg_version_constants.h"
+
+#include "distributed/shard_transfer_throttle.h"
+
+
+/* number of bytes a stream sends before it reserves a time slot */
+#define SHARD_TRANSFER_THROTTLE_CHUNK_SIZE (64 * 1024)
+
+/* longest time we sleep before checking whether the rate changed, in ms */
+#define SHARD_TRANSFER_THROTTLE_MAX_SLEEP 100
+
+
+/*
+ * The data structure used to share the rate limit across the backends that
+ * send shards.
+ */
+typedef struct ShardTransferThrottleSharedData
+{
+	/* citus.shard_transfer_max_rate as of the last configuration reload */
+	pg_atomic_uint32 maxRate;
+
+	/* protects nextSendTime */
+	slock_t mutex;
+
+	/* time at which the data of all reserved slots is sent at maxRate */
+	TimestampTz nextSendTime;
+} ShardTransferThrottleSharedData;
+
+
+/* GUC, maximum rate in kB per second at which a node sends shards, 0 disables */
+int ShardTransferMaxRate = 0;
+
+
+static ShardTransferThrottleSharedData *ShardTransferThrottleSharedState = NULL;
+
+/* bytes that this backend sent since it last reserved a time slot */
+static uint64 UnreservedShardTransferBytes = 0;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+/* local function declarations */
+static void WaitForShardTransferSlot(uint64 bytes, uint32 maxRate);
+
+
+/*
+ * ThrottleShardTransfer is called after a shard transfer sent the given
+ * number of bytes, and sleeps as long as needed to keep all transfers from
+ * this node under citus.shard_transfer_max_rate.
+ */
+void
+ThrottleShardTransfer(uint64 bytes)
+{
+	if (ShardTransferThrottleSharedState == NULL)
+	{
+		return;
+	}
+
+	uint32 maxRate = pg_atomic_read_u32(&ShardTransferThrottleSharedState->maxRate);
+	if (maxRate == 0)
+	{
+		UnreservedShardTransferBytes = 0;
+		return;
+	}
+
+	UnreservedShardTransferBytes += bytes;
+	if (UnreservedShardTransferBytes < SHARD_TRANSFER_THROTTLE_CHUNK_SIZE)
+	{
+		return;
+	}
+
+	uint64 reservedBytes = UnreservedShardTransferBytes;
+	UnreservedShardTransferBytes = 0;
+
+	WaitForShardTransferSlot(reservedBytes, maxRate);
+}
+
+
+/*
+ * WaitForShardTransferSlot reserves the time it takes to send the given
+ * number of bytes at the given rate after the slots that other streams
+ * reserved, and sleeps until the slot starts. Throttling is over for the
+ * backend when the rate is disabled while it sleeps.
+ */
+static void
+WaitForShardTransferSlot(uint64 bytes, uint32 maxRate)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	int64 slotDuration = (int64) (bytes * USECS_PER_SEC / ((uint64) maxRate * 1024));
+
+	SpinLockAcquire(&ShardTransferThrottleSharedState->mutex);
+
+	/* we do not give credit for the time in which nothing was sent */
+	TimestampTz slotStartTime = Max(ShardTransferThrottleSharedState->nextSendTime, now);
+	ShardTransferThrottleSharedState->nextSendTime = slotStartTime + slotDuration;
+
+	SpinLockRelease(&ShardTransferThrottleSharedState->mutex);
+
+	while (now < slotStartTime)
+	{
+		long sleepTime = TimestampDifferenceMilliseconds(now, slotStartTime);
+		sleepTime = Max(Min(sleepTime, SHARD_TRANSFER_THROTTLE_MAX_SLEEP), 1);
+
+		int rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+						   sleepTime, PG_WAIT_EXTENSION);
+		if (rc & WL_LATCH_SET)
+		{
+			ResetLatch(MyLatch);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (pg_atomic_read_u32(&ShardTransferThrottleSharedState->maxRate) == 0)
+		{
+			break;
+		}
+
+		now = GetCurrentTimestamp();
+	}
+}
+
+
+/*
+ * SetSharedShardTransferMaxRate stores the rate for the transfers of all
+ * backends. It is called whenever a process assigns
+ * citus.shard_transfer_max_rate, which includes configuration reloads.
+ */
+void
+SetSharedShardTransferMaxRate(int maxRate)
+{
+	if (ShardTransferThrottleSharedState == NULL)
+	{
+		/* shared memory is not initialized yet, we set the rate there later */
+		return;
+	}
+
+	pg_atomic_write_u32(&ShardTransferThrottleSharedState->maxRate, (uint32) maxRate);
+}
+
+
+/*
+ * InitializeShardTransferThrottle requests the necessary shared memory from
+ * Postgres and sets up the shared memory startup hook.
+ */
+void
+InitializeShardTransferThrottle(void)
+{
+/* on PG 15, we use shmem_request_hook_type */
+#if PG_VERSION_NUM < PG_VERSION_15
+
+	/* allocate shared memory */
+	if (!IsUnderPostmaster)
+	{
+		RequestAddinShmemSpace(ShardTransferThrottleShmemSize());
+	}
+#endif
+
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = ShardTransferThrottleShmemInit;
+}
+
+
+/*
+ * ShardTransferThrottleShmemSize returns the size that should be allocated on
+ * the shared memory for the rate limit.
+ */
+size_t
+ShardTransferThrottleShmemSize(void)
+{
+	return sizeof(ShardTransferThrottleSharedData);
+}
+
+
+/*
+ * ShardTransferThrottleShmemInit initializes the shared memory used for
+ * limiting the rate of shard transfers across backends.
+ */
+void
+ShardTransferThrottleShmemInit(void)
+{
+	bool alreadyInitialized = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	ShardTransferThrottleSharedState =
+		(ShardTransferThrottleSharedData *) ShmemInitStruct(
+			"Shard Transfer Throttle Data",
+			sizeof(ShardTransferThrottleSharedData),
+			&alreadyInitialized);
+
+	if (!alreadyInitialized)
+	{
+		pg_atomic_init_u32(&ShardTransferThrottleSharedState->maxRate,
+						   (uint32) ShardTransferMaxRate);
+		SpinLockInit(&ShardTransferThrottleSharedState->mutex);
+		ShardTransferThrottleSharedState->nextSendTime = 0;
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
+}
@@ -64,8 +64,53 @@
 #include "distributed/worker_protocol.h"
 
 
+/* managed via a GUC */
+int ShardCreationBatchSize = 1;
+
+/*
+ * ShardCreationBatch holds the task that creates a batch of shards on a node,
+ * see BatchShardCreationTasksPerNode.
+ */
+typedef struct ShardCreationBatch
+{
+	int32 groupId;
+	Task *task;
+	int shardCount;
+} ShardCreationBatch;
+
+/*
+ * DeferredShardCreation holds the commands that create the placements on a
+ * node of the co-located shards at the same shard index of several tables,
+ * see DeferShardCreation.
+ */
+typedef struct DeferredShardCreation
+{
+	int32 groupId;
+	int shardIndex;
+	ShardPlacement *placement;
+	List *commandList;
+	List *relationShardList;
+} DeferredShardCreation;
+
+/*
+ * Memory context of the deferred shard creations, which is not NULL while the
+ * creation of shards is deferred, see BeginShardCreationBatch.
+ */
+static MemoryContext ShardCreationBatchContext = NULL;
+
+/* deferred shard creations of the current batch */
+static List *DeferredShardCreationList = NIL;
+
+/* whether all deferred shard creations asked for exclusive connections */
+static bool DeferredShardCreationUseExclusiveConnection = true;
+
 /* Local functions forward declarations */
 static List * RelationShardListForShardCreate(ShardInterval *shardInterval);
+static List * BatchShardCreationTasksPerNode(List *taskList);
+static void DeferShardCreation(ShardPlacement *shardPlacement,
+							   ShardInterval *shardInterval, List *commandList,
+							   List *relationShardList);
+static void ExecuteShardCreationTaskList(List *taskList, bool useExclusiveConnection);
 static bool WorkerShardStats(ShardPlacement *placement, Oid relationId,
 							 const char *shardName, uint64 *shardSize);
 static void UpdateTableStatistics(Oid relationId);
@@ -428,7 +473,6 @@ CreateShardsOnWorkers(Oid distributedRelationId, List *shardPlacements,
 
 	int taskId = 1;
 	List *taskList = NIL;
-	int poolSize = 1;
 
 	ShardPlacement *shardPlacement = NULL;
 	foreach_ptr(shardPlacement, shardPlacements)
@@ -440,6 +484,13 @@ CreateShardsOnWorkers(Oid distributedRelationId, List *shardPlacements,
 		List *commandList = WorkerCreateShardCommandList(distributedRelationId,
 														 shardId, ddlCommandList);
 
+		if (ShardCreationBatchContext != NULL)
+		{
+			DeferShardCreation(shardPlacement, shardInterval, commandList,
+							   relationShardList);
+			continue;
+		}
+
 		Task *task = CitusMakeNode(Task);
 		task->jobId = INVALID_JOB_ID;
 		task->taskId = taskId++;
@@ -455,6 +506,30 @@ CreateShardsOnWorkers(Oid distributedRelationId, List *shardPlacements,
 		taskList = lappend(taskList, task);
 	}
 
+	if (ShardCreationBatchContext != NULL)
+	{
+		if (!useExclusiveConnection)
+		{
+			DeferredShardCreationUseExclusiveConnection = false;
+		}
+
+		return;
+	}
+
+	ExecuteShardCreationTaskList(taskList, useExclusiveConnection);
+}
+
+
+/*
+ * ExecuteShardCreationTaskList executes the given shard creation tasks, either
+ * over as many connections as needed or, if useExclusiveConnection is false,
+ * over a single connection per node.
+ */
+static void
+ExecuteShardCreationTaskList(List *taskList, bool useExclusiveConnection)
+{
+	int poolSize = 1;
+
 	if (useExclusiveConnection)
 	{
 		/*
@@ -477,11 +552,247 @@ CreateShardsOnWorkers(Oid distributedRelationId, List *shardPlacements,
 		 */
 		poolSize = MaxAdaptiveExecutorPoolSize;
 	}
+	else if (ShardCreationBatchSize > 1)
+	{
+		/*
+		 * Without exclusive connections, the tasks of a node are executed one
+		 * after the other over a single connection anyway, so we can as well
+		 * send the commands of several shards in one go.
+		 */
+		taskList = BatchShardCreationTasksPerNode(taskList);
+	}
+
 	bool localExecutionSupported = true;
 	ExecuteUtilityTaskListExtended(taskList, poolSize, localExecutionSupported);
 }
 
 
+/*
+ * BeginShardCreationBatch starts deferring the creation of shards on the
+ * workers, such that the shards of many tables, typically the partitions of a
+ * distributed table, can be created with fewer round trips by
+ * EndShardCreationBatch. The deferred commands are kept in the given memory
+ * context, which should live until the end of the batch.
+ *
+ * The caller should only create empty tables while the batch is active, since
+ * the shards do not exist until the end of the batch.
+ */
+void
+BeginShardCreationBatch(MemoryContext batchContext)
+{
+	Assert(ShardCreationBatchContext == NULL);
+
+	ShardCreationBatchContext = batchContext;
+	DeferredShardCreationList = NIL;
+	DeferredShardCreationUseExclusiveConnection = true;
+}
+
+
+/*
+ * EndShardCreationBatch stops deferring the creation of shards, and creates
+ * the deferred shards if executeDeferred is true. It is called with false when
+ * the batch is aborted by an error.
+ *
+ * The placements of co-located shards at the same shard index are created by a
+ * single task. Such a task accesses the same placements of the parent table
+ * as the task of any single partition would, so the executor can assign it to
+ * a connection the same way, while the round trips per node go down from the
+ * number of shards times the number of tables to the number of shards.
+ */
+void
+EndShardCreationBatch(bool executeDeferred)
+{
+	List *deferredShardCreationList = DeferredShardCreationList;
+	bool useExclusiveConnection = DeferredShardCreationUseExclusiveConnection;
+
+	ShardCreationBatchContext = NULL;
+	DeferredShardCreationList = NIL;
+	DeferredShardCreationUseExclusiveConnection = true;
+
+	if (!executeDeferred || deferredShardCreationList == NIL)
+	{
+		return;
+	}
+
+	int32 localGroupId = GetLocalGroupId();
+	int taskId = 1;
+	List *taskList = NIL;
+
+	DeferredShardCreation *deferredShardCreation = NULL;
+	foreach_ptr(deferredShardCreation, deferredShardCreationList)
+	{
+		ShardPlacement *shardPlacement = deferredShardCreation->placement;
+
+		Task *task = CitusMakeNode(Task);
+		task->jobId = INVALID_JOB_ID;
+		task->taskId = taskId++;
+		task->taskType = DDL_TASK;
+		SetTaskQueryStringList(task, deferredShardCreation->commandList);
+
+		/*
+		 * Send the commands as a single query string, unless the tasks are
+		 * batched per node below anyway. See BatchShardCreationTasksPerNode
+		 * for why local tasks are kept as they are.
+		 */
+		if ((useExclusiveConnection || ShardCreationBatchSize <= 1) &&
+			shardPlacement->groupId != localGroupId &&
+			list_length(deferredShardCreation->commandList) > 1)
+		{
+			SetTaskQueryString(task, TaskQueryString(task));
+		}
+
+		task->replicationModel = REPLICATION_MODEL_INVALID;
+		task->dependentTaskList = NIL;
+		task->anchorShardId = shardPlacement->shardId;
+		task->relationShardList = deferredShardCreation->relationShardList;
+		task->taskPlacementList = list_make1(shardPlacement);
+
+		taskList = lappend(taskList, task);
+	}
+
+	ExecuteShardCreationTaskList(taskList, useExclusiveConnection);
+}
+
+
+/*
+ * DeferShardCreation adds the commands that create a shard placement to the
+ * deferred shard creation of the node and shard index of the placement.
+ */
+static void
+DeferShardCreation(ShardPlacement *shardPlacement, ShardInterval *shardInterval,
+				   List *commandList, List *relationShardList)
+{
+	MemoryContext oldContext = MemoryContextSwitchTo(ShardCreationBatchContext);
+
+	int shardIndex = ShardIndex(shardInterval);
+	DeferredShardCreation *deferredShardCreation = NULL;
+
+	DeferredShardCreation *existingShardCreation = NULL;
+	foreach_ptr(existingShardCreation, DeferredShardCreationList)
+	{
+		if (existingShardCreation->groupId == shardPlacement->groupId &&
+			existingShardCreation->shardIndex == shardIndex)
+		{
+			deferredShardCreation = existingShardCreation;
+			break;
+		}
+	}
+
+	if (deferredShardCreation == NULL)
+	{
+		deferredShardCreation = palloc0(sizeof(DeferredShardCreation));
+		deferredShardCreation->groupId = shardPlacement->groupId;
+		deferredShardCreation->shardIndex = shardIndex;
+		deferredShardCreation->placement = copyObject(shardPlacement);
+
+		DeferredShardCreationList = lappend(DeferredShardCreationList,
+											deferredShardCreation);
+	}
+
+	char *command = NULL;
+	foreach_ptr(command, commandList)
+	{
+		deferredShardCreation->commandList =
+			lappend(deferredShardCreation->commandList, pstrdup(command));
+	}
+
+	RelationShard *relationShard = NULL;
+	foreach_ptr(relationShard, relationShardList)
+	{
+		deferredShardCreation->relationShardList =
+			lappend(deferredShardCreation->relationShardList,
+					copyObject(relationShard));
+	}
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * BatchShardCreationTasksPerNode combines the shard creation tasks of up to
+ * citus.shard_creation_batch_size shards on the same node into a single task,
+ * whose commands are sent as a single query string. That way, creating a
+ * table with many shards and indexes does not require a round-trip per
+ * command.
+ *
+ * Tasks on the local node are kept as they are, since local execution of a
+ * query string does not make the effects of a command visible to the next.
+ */
+static List *
+BatchShardCreationTasksPerNode(List *taskList)
+{
+	List *batchedTaskList = NIL;
+	List *batchList = NIL;
+	List *openBatchList = NIL;
+	int32 localGroupId = GetLocalGroupId();
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		ShardPlacement *taskPlacement = linitial(task->taskPlacementList);
+		if (taskPlacement->groupId == localGroupId)
+		{
+			batchedTaskList = lappend(batchedTaskList, task);
+			continue;
+		}
+
+		/* find the batch that is being filled for the node of this task */
+		ShardCreationBatch *batch = NULL;
+		ShardCreationBatch *openBatch = NULL;
+		foreach_ptr(openBatch, openBatchList)
+		{
+			if (openBatch->groupId == taskPlacement->groupId)
+			{
+				batch = openBatch;
+				break;
+			}
+		}
+
+		if (batch == NULL)
+		{
+			/* the first task of the batch is turned into the batch */
+			batch = palloc0(sizeof(ShardCreationBatch));
+			batch->groupId = taskPlacement->groupId;
+			batch->task = task;
+
+			batchList = lappend(batchList, batch);
+			openBatchList = lappend(openBatchList, batch);
+			batchedTaskList = lappend(batchedTaskList, task);
+		}
+		else
+		{
+			Task *batchTask = batch->task;
+			List *queryStringList =
+				list_concat(batchTask->taskQuery.data.queryStringList,
+							task->taskQuery.data.queryStringList);
+			SetTaskQueryStringList(batchTask, queryStringList);
+
+			batchTask->relationShardList = list_concat(batchTask->relationShardList,
+													   task->relationShardList);
+		}
+
+		batch->shardCount++;
+		if (batch->shardCount >= ShardCreationBatchSize)
+		{
+			openBatchList = list_delete_ptr(openBatchList, batch);
+		}
+	}
+
+	/* send the commands of each batch as a single query string */
+	ShardCreationBatch *batch = NULL;
+	foreach_ptr(batch, batchList)
+	{
+		if (batch->shardCount > 1)
+		{
+			char *queryString = TaskQueryString(batch->task);
+			SetTaskQueryString(batch->task, queryString);
+		}
+	}
+
+	return batchedTaskList;
+}
+
+
 /*
  * RelationShardListForShardCreate gets a shard interval and returns the placement
  * accesses that would happen when a placement of the shard interval is created.
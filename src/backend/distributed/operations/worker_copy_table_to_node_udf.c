@@ -47,6 +47,14 @@ worker_copy_table_to_node(PG_FUNCTION_ARGS)
 		relationSchemaName,
 		relationName);
 
+	/* columnar shards can be copied without decompressing their stripes */
+	if (CopyColumnarStripesToNode(relationId,
+								  list_make2(relationSchemaName, relationName),
+								  targetNodeId))
+	{
+		PG_RETURN_VOID();
+	}
+
 	EState *executor = CreateExecutorState();
 	DestReceiver *destReceiver = CreateShardCopyDestReceiver(
 		executor,
@@ -12,7 +12,9 @@
 
 #include "libpq-fe.h"
 
+#include "catalog/pg_type.h"
 #include "commands/copy.h"
+#include "mb/pg_wchar.h"
 #include "nodes/makefuncs.h"
 #include "parser/parse_relation.h"
 #include "utils/builtins.h"
@@ -25,10 +27,19 @@
 #include "distributed/relation_utils.h"
 #include "distributed/remote_commands.h"
 #include "distributed/replication_origin_session_utils.h"
+#include "distributed/shard_transfer_throttle.h"
+#include "distributed/shared_library_init.h"
 #include "distributed/version_compat.h"
 #include "distributed/worker_manager.h"
 #include "distributed/worker_shard_copy.h"
 
+/* signature of the function that appends a columnar stripe to a table */
+#define IMPORT_STRIPE_FUNCTION_SIGNATURE \
+	"columnar_internal.import_stripe(regclass,bytea)"
+
+/* GUC, determining whether the stripes of columnar shards are copied as they are */
+bool EnableColumnarStripeTransfer = true;
+
 /*
  * LocalCopyBuffer is used in copy callback to return the copied rows.
  * The reason this is a global variable is that we cannot pass an additional
@@ -69,6 +80,15 @@ typedef struct ShardCopyDestReceiver
 	MultiConnection *connection;
 } ShardCopyDestReceiver;
 
+/* state of CopyColumnarStripesToNode while it sends the stripes */
+typedef struct ColumnarStripeTransferState
+{
+	MultiConnection *connection;
+
+	/* command that appends the stripe in its parameter to the destination shard */
+	char *importStripeCommand;
+} ColumnarStripeTransferState;
+
 static bool ShardCopyDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest);
 static void ShardCopyDestReceiverStartup(DestReceiver *dest, int operation,
 										 TupleDesc inputTupleDescriptor);
@@ -83,6 +103,9 @@ static int ReadFromLocalBufferCallback(void *outBuf, int minRead, int maxRead);
 static void LocalCopyToShard(ShardCopyDestReceiver *copyDest, CopyOutState
 							 localCopyOutState);
 static void ConnectToRemoteAndStartCopy(ShardCopyDestReceiver *copyDest);
+static bool DestinationSupportsColumnarStripeTransfer(MultiConnection *connection,
+													  char *destinationShardName);
+static void SendColumnarStripeToRemote(StringInfo stripeBuffer, void *callbackState);
 
 
 static bool
@@ -237,6 +260,8 @@ ShardCopyDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 									  copyOutState->fe_msgbuf->data,
 									  copyDest->destinationNodeId)));
 		}
+
+		ThrottleShardTransfer(copyOutState->fe_msgbuf->len);
 	}
 
 	MemoryContextSwitchTo(oldContext);
@@ -500,6 +525,8 @@ LocalCopyToShard(ShardCopyDestReceiver *copyDest, CopyOutState localCopyOutState
 		AppendCopyBinaryFooters(localCopyOutState);
 	}
 
+	ThrottleShardTransfer(localCopyOutState->fe_msgbuf->len);
+
 	/*
 	 * Set the buffer as a global variable to allow ReadFromLocalBufferCallback
 	 * to read from it. We cannot pass additional arguments to
@@ -566,3 +593,170 @@ ReadFromLocalBufferCallback(void *outBuf, int minRead, int maxRead)
 
 	return bytesRead;
 }
+
+
+/*
+ * CopyColumnarStripesToNode copies the stripes of the columnar table with
+ * given id into the destination shard as they are stored, so that we neither
+ * decompress the rows here nor compress them again on the destination node.
+ *
+ * It returns false without copying anything if the stripes of the table
+ * cannot be copied this way, or if the destination node doesn't support it,
+ * in which case the caller should copy the rows instead.
+ */
+bool
+CopyColumnarStripesToNode(Oid relationId, List *destinationShardFullyQualifiedName,
+						  uint32_t destinationNodeId)
+{
+	if (!EnableColumnarStripeTransfer || CanUseLocalCopy(destinationNodeId) ||
+		!extern_IsColumnarTableAmTable(relationId) ||
+		!extern_ColumnarStripeTransferSupported(relationId))
+	{
+		return false;
+	}
+
+	char *destinationShardName =
+		quote_qualified_identifier(linitial(destinationShardFullyQualifiedName),
+								   lsecond(destinationShardFullyQualifiedName));
+
+	int connectionFlags = OUTSIDE_TRANSACTION;
+	char *currentUser = CurrentUserName();
+	WorkerNode *workerNode = FindNodeWithNodeId(destinationNodeId,
+												false /* missingOk */);
+	MultiConnection *connection = GetNodeUserDatabaseConnection(connectionFlags,
+																workerNode->workerName,
+																workerNode->workerPort,
+																currentUser,
+																NULL /* database (current) */);
+	ClaimConnectionExclusively(connection);
+
+	if (!DestinationSupportsColumnarStripeTransfer(connection, destinationShardName))
+	{
+		CloseConnection(connection);
+		return false;
+	}
+
+	RemoteTransactionBeginIfNecessary(connection);
+
+	SetupReplicationOriginRemoteSession(connection);
+
+	/* like a single COPY, import either all of the stripes or none of them */
+	bool useExplicitTransaction =
+		connection->remoteTransaction.transactionState == REMOTE_TRANS_NOT_STARTED;
+	if (useExplicitTransaction)
+	{
+		ExecuteCriticalRemoteCommand(connection, "BEGIN");
+	}
+
+	StringInfo importStripeCommand = makeStringInfo();
+	appendStringInfo(importStripeCommand,
+					 "SELECT columnar_internal.import_stripe(%s::regclass, $1)",
+					 quote_literal_cstr(destinationShardName));
+
+	ColumnarStripeTransferState transferState = {
+		.connection = connection,
+		.importStripeCommand = importStripeCommand->data
+	};
+
+	uint64 stripeCount = extern_ColumnarExportStripes(relationId,
+													  SendColumnarStripeToRemote,
+													  &transferState);
+
+	if (useExplicitTransaction)
+	{
+		ExecuteCriticalRemoteCommand(connection, "COMMIT");
+	}
+
+	ereport(DEBUG1, (errmsg("copied " UINT64_FORMAT " columnar stripes to "
+							"destination shard %s on node %u", stripeCount,
+							destinationShardName, destinationNodeId)));
+
+	ResetReplicationOriginRemoteSession(connection);
+
+	CloseConnection(connection);
+
+	return true;
+}
+
+
+/*
+ * DestinationSupportsColumnarStripeTransfer returns true if the destination
+ * node can append the stripes that we send to the destination shard, which
+ * requires columnar_internal.import_stripe() and a columnar shard without
+ * indexes in a database that has the same encoding as ours.
+ */
+static bool
+DestinationSupportsColumnarStripeTransfer(MultiConnection *connection,
+										  char *destinationShardName)
+{
+	StringInfo command = makeStringInfo();
+	appendStringInfo(command,
+					 "SELECT CASE WHEN pg_catalog.to_regprocedure(%s) IS NULL "
+					 "THEN false "
+					 "ELSE pg_catalog.has_schema_privilege('columnar_internal', 'USAGE') "
+					 "AND pg_catalog.has_function_privilege(%s, 'EXECUTE') "
+					 "AND c.relam = (SELECT oid FROM pg_catalog.pg_am "
+					 "WHERE amname = 'columnar') "
+					 "AND NOT c.relhasindex "
+					 "AND pg_catalog.current_setting('server_encoding') = %s END "
+					 "FROM pg_catalog.pg_class c WHERE c.oid = %s::regclass",
+					 quote_literal_cstr(IMPORT_STRIPE_FUNCTION_SIGNATURE),
+					 quote_literal_cstr(IMPORT_STRIPE_FUNCTION_SIGNATURE),
+					 quote_literal_cstr(GetDatabaseEncodingName()),
+					 quote_literal_cstr(destinationShardName));
+
+	if (!SendRemoteCommand(connection, command->data))
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
+	PGresult *result = GetRemoteCommandResult(connection, true /* raiseInterrupts */);
+	if (!IsResponseOK(result))
+	{
+		ReportResultError(connection, result, ERROR);
+	}
+
+	bool supported = PQntuples(result) == 1 &&
+					 strcmp(PQgetvalue(result, 0, 0), "t") == 0;
+
+	PQclear(result);
+	ForgetResults(connection);
+
+	return supported;
+}
+
+
+/*
+ * SendColumnarStripeToRemote is the ColumnarStripeExportCallback of
+ * CopyColumnarStripesToNode, which appends the stripe to the destination
+ * shard. The stripe is sent as a binary parameter, so it's sent as is.
+ */
+static void
+SendColumnarStripeToRemote(StringInfo stripeBuffer, void *callbackState)
+{
+	ColumnarStripeTransferState *transferState =
+		(ColumnarStripeTransferState *) callbackState;
+	MultiConnection *connection = transferState->connection;
+
+	Oid parameterTypes[1] = { BYTEAOID };
+	const char *parameterValues[1] = { stripeBuffer->data };
+	int parameterLengths[1] = { stripeBuffer->len };
+
+	if (!SendRemoteCommandBinaryParams(connection, transferState->importStripeCommand,
+									   1, parameterTypes, parameterValues,
+									   parameterLengths))
+	{
+		ReportConnectionError(connection, ERROR);
+	}
+
+	PGresult *result = GetRemoteCommandResult(connection, true /* raiseInterrupts */);
+	if (!IsResponseOK(result))
+	{
+		ReportResultError(connection, result, ERROR);
+	}
+
+	PQclear(result);
+	ForgetResults(connection);
+
+	ThrottleShardTransfer(stripeBuffer->len);
+}
@@ -20,6 +20,7 @@
 #include "distributed/intermediate_results.h"
 #include "distributed/listutils.h"
 #include "distributed/multi_executor.h"
+#include "distributed/shard_split.h"
 #include "distributed/utils/array_type.h"
 #include "distributed/worker_shard_copy.h"
 
@@ -56,6 +57,10 @@ static char * TraceWorkerSplitCopyUdf(char *sourceShardToCopySchemaName,
  * UDF to split copy shard to list of destination shards.
  * 'source_shard_id' : Source ShardId to split copy.
  * 'splitCopyInfos'  : Array of Split Copy Info (destination_shard's id, min/max ranges and node_id)
+ *
+ * The variant with 'start_block' and 'end_block' only copies the rows in the
+ * blocks [start_block, end_block) of the source shard, such that several
+ * streams can split copy a large shard in parallel.
  */
 Datum
 worker_split_copy(PG_FUNCTION_ARGS)
@@ -91,6 +96,24 @@ worker_split_copy(PG_FUNCTION_ARGS)
 		splitCopyInfoList = lappend(splitCopyInfoList, splitCopyInfo);
 	}
 
+	bool copyBlockRange = (PG_NARGS() == 5);
+	int64 startBlock = 0;
+	int64 endBlock = SPLIT_COPY_BLOCK_RANGE_END;
+	if (copyBlockRange)
+	{
+		startBlock = PG_GETARG_INT64(3);
+		endBlock = PG_GETARG_INT64(4);
+
+		if (startBlock < 0 || endBlock < startBlock ||
+			endBlock > SPLIT_COPY_BLOCK_RANGE_END)
+		{
+			ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							errmsg("invalid block range [" INT64_FORMAT ", "
+								   INT64_FORMAT ") for split copy",
+								   startBlock, endBlock)));
+		}
+	}
+
 	EState *executor = CreateExecutorState();
 	DestReceiver *splitCopyDestReceiver = CreatePartitionedSplitCopyDestReceiver(executor,
 																				 shardIntervalToSplitCopy,
@@ -118,9 +141,24 @@ worker_split_copy(PG_FUNCTION_ARGS)
 		sourceShardToCopyName);
 
 	appendStringInfo(selectShardQueryForCopy,
-					 "SELECT %s FROM %s;", columnList,
+					 "SELECT %s FROM %s", columnList,
 					 sourceShardToCopyQualifiedName);
 
+	if (copyBlockRange)
+	{
+		ereport(LOG, (errmsg("copying blocks [" INT64_FORMAT ", " INT64_FORMAT
+							 ") of shard %s", startBlock, endBlock,
+							 sourceShardToCopyQualifiedName)));
+
+		/* this is planned as a TID range scan */
+		appendStringInfo(selectShardQueryForCopy,
+						 " WHERE ctid >= '(" INT64_FORMAT ",0)'::tid"
+						 " AND ctid < '(" INT64_FORMAT ",0)'::tid",
+						 startBlock, endBlock);
+	}
+
+	appendStringInfoChar(selectShardQueryForCopy, ';');
+
 	ParamListInfo params = NULL;
 	ExecuteQueryStringIntoDestReceiver(selectShardQueryForCopy->data, params,
 									   (DestReceiver *) splitCopyDestReceiver);
@@ -53,8 +53,7 @@ static ShardSplitInfo * CreateShardSplitInfo(uint64 sourceShardIdToSplit,
 											 int32 maxValue,
 											 int32 nodeId);
 static void AddShardSplitInfoEntryForNodeInMap(ShardSplitInfo *shardSplitInfo);
-static void PopulateShardSplitInfoInSM(ShardSplitInfoSMHeader *shardSplitInfoSMHeader,
-									   OperationId operationId);
+static void PopulateShardSplitInfoInSM(OperationId operationId);
 
 static void ReturnReplicationSlotInfo(Tuplestorestate *tupleStore,
 									  TupleDesc tupleDescriptor,
@@ -115,8 +114,6 @@ worker_split_shard_replication_setup(PG_FUNCTION_ARGS)
 	/* SetupMap */
 	ShardInfoHashMap = CreateSimpleHash(NodeAndOwner, GroupedShardSplitInfos);
 
-	int shardSplitInfoCount = 0;
-
 	ArrayIterator shardInfo_iterator = array_create_iterator(shardInfoArrayObject, 0,
 															 NULL);
 	Datum shardInfoDatum = 0;
@@ -143,17 +140,9 @@ worker_split_shard_replication_setup(PG_FUNCTION_ARGS)
 			nodeId);
 
 		AddShardSplitInfoEntryForNodeInMap(shardSplitInfo);
-		shardSplitInfoCount++;
 	}
 
-	dsm_handle dsmHandle;
-	ShardSplitInfoSMHeader *splitShardInfoSMHeader =
-		CreateSharedMemoryForShardSplitInfo(shardSplitInfoCount, &dsmHandle);
-
-	PopulateShardSplitInfoInSM(splitShardInfoSMHeader, operationId);
-
-	/* store handle in statically allocated shared memory*/
-	StoreShardSplitSharedMemoryHandle(dsmHandle);
+	PopulateShardSplitInfoInSM(operationId);
 
 	TupleDesc tupleDescriptor = NULL;
 	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
@@ -272,20 +261,20 @@ AddShardSplitInfoEntryForNodeInMap(ShardSplitInfo *shardSplitInfo)
 
 /*
  * PopulateShardSplitInfoInSM function copies information from the hash map
- * into shared memory segment. This information is consumed by the WAL sender
- * process during logical replication.
+ * into shared memory, along with the name of the replication slot of each
+ * node and owner. This information is consumed by the WAL sender process
+ * during logical replication.
  *
- * shardSplitInfoSMHeader - Shared memory header
+ * operationId - Id of the split operation, which is part of the slot names
  */
 static void
-PopulateShardSplitInfoInSM(ShardSplitInfoSMHeader *shardSplitInfoSMHeader,
-						   OperationId operationId)
+PopulateShardSplitInfoInSM(OperationId operationId)
 {
 	HASH_SEQ_STATUS status;
 	hash_seq_init(&status, ShardInfoHashMap);
 
+	List *shardSplitInfoList = NIL;
 	GroupedShardSplitInfos *entry = NULL;
-	int splitInfoIndex = 0;
 	while ((entry = (GroupedShardSplitInfos *) hash_seq_search(&status)) != NULL)
 	{
 		uint32_t nodeId = entry->key.nodeId;
@@ -296,17 +285,15 @@ PopulateShardSplitInfoInSM(ShardSplitInfoSMHeader *shardSplitInfoSMHeader,
 														   tableOwnerId,
 														   operationId);
 
-		List *shardSplitInfoList = entry->shardSplitInfoList;
 		ShardSplitInfo *splitShardInfo = NULL;
-		foreach_ptr(splitShardInfo, shardSplitInfoList)
+		foreach_ptr(splitShardInfo, entry->shardSplitInfoList)
 		{
-			shardSplitInfoSMHeader->splitInfoArray[splitInfoIndex] = *splitShardInfo;
-			strcpy_s(shardSplitInfoSMHeader->splitInfoArray[splitInfoIndex].slotName,
-					 NAMEDATALEN,
-					 derivedSlotName);
-			splitInfoIndex++;
+			strcpy_s(splitShardInfo->slotName, NAMEDATALEN, derivedSlotName);
+			shardSplitInfoList = lappend(shardSplitInfoList, splitShardInfo);
 		}
 	}
+
+	StoreShardSplitInfoList(shardSplitInfoList);
 }
 
 
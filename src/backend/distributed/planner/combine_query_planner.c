@@ -11,17 +11,21 @@
 
 #include "postgres.h"
 
+#include "access/stratnum.h"
 #include "catalog/pg_type.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
+#include "optimizer/paths.h"
 #include "optimizer/planner.h"
 #include "rewrite/rewriteManip.h"
+#include "utils/lsyscache.h"
 
 #include "pg_version_constants.h"
 
 #include "distributed/citus_ruleutils.h"
 #include "distributed/combine_query_planner.h"
+#include "distributed/distributed_planner.h"
 #include "distributed/insert_select_planner.h"
 #include "distributed/listutils.h"
 #include "distributed/metadata_cache.h"
@@ -35,6 +39,14 @@ static PlannedStmt * BuildSelectStatementViaStdPlanner(Query *combineQuery,
 static Plan * CitusCustomScanPathPlan(PlannerInfo *root, RelOptInfo *rel,
 									  struct CustomPath *best_path, List *tlist,
 									  List *clauses, List *custom_plans);
+static List * SortedMergePathKeys(PlannerInfo *root, RelOptInfo *relOptInfo,
+								  DistributedPlan *distributedPlan);
+static Var * RemoteScanColumn(RelOptInfo *relOptInfo, AttrNumber columnId);
+static Plan * FindParentPlan(Plan *plan, Plan *childPlan);
+static bool PlanReadsAllRowsAtOnce(Plan *plan);
+
+/* config variable managed via guc.c */
+bool EnableSortedMerge = false;
 
 bool ReplaceCitusExtraDataContainer = false;
 CustomScan *ReplaceCitusExtraDataContainerWithCustomScan = NULL;
@@ -64,9 +76,83 @@ PlanCombineQuery(DistributedPlan *distributedPlan, CustomScan *remoteScan)
 
 	Job *workerJob = distributedPlan->workerJob;
 	List *workerTargetList = workerJob->jobQuery->targetList;
+
+	/*
+	 * When the groups or window functions are evaluated on the workers, those
+	 * are the rows we get.
+	 */
+	if (distributedPlan->repartitionedAggregateQuery != NULL)
+	{
+		workerTargetList = distributedPlan->repartitionedAggregateQuery->targetList;
+	}
+
 	List *remoteScanTargetList = RemoteScanTargetList(workerTargetList);
-	return BuildSelectStatementViaStdPlanner(combineQuery, remoteScanTargetList,
-											 remoteScan);
+	PlannedStmt *combinePlan = BuildSelectStatementViaStdPlanner(combineQuery,
+																 remoteScanTargetList,
+																 remoteScan);
+
+	/*
+	 * When the node above the remote scan reads all the rows before returning
+	 * any, the executor can let it consume the task results as they arrive.
+	 */
+	Plan *parentPlan = FindParentPlan(combinePlan->planTree, (Plan *) remoteScan);
+	if (parentPlan != NULL && PlanReadsAllRowsAtOnce(parentPlan))
+	{
+		distributedPlan->incrementalCombineSupported = true;
+	}
+
+	return combinePlan;
+}
+
+
+/*
+ * FindParentPlan returns the plan node in the given plan tree whose child is
+ * childPlan, or NULL if there is none.
+ */
+static Plan *
+FindParentPlan(Plan *plan, Plan *childPlan)
+{
+	if (plan == NULL)
+	{
+		return NULL;
+	}
+
+	if (plan->lefttree == childPlan || plan->righttree == childPlan)
+	{
+		return plan;
+	}
+
+	Plan *parentPlan = FindParentPlan(plan->lefttree, childPlan);
+	if (parentPlan == NULL)
+	{
+		parentPlan = FindParentPlan(plan->righttree, childPlan);
+	}
+
+	return parentPlan;
+}
+
+
+/*
+ * PlanReadsAllRowsAtOnce returns whether the given plan node reads all the
+ * rows of its child the first time it is asked for a row, which is the case
+ * for sorts and for plain and hashed aggregates.
+ */
+static bool
+PlanReadsAllRowsAtOnce(Plan *plan)
+{
+	if (IsA(plan, Sort))
+	{
+		return true;
+	}
+
+	if (IsA(plan, Agg))
+	{
+		AggStrategy aggStrategy = ((Agg *) plan)->aggstrategy;
+
+		return aggStrategy == AGG_PLAIN || aggStrategy == AGG_HASHED;
+	}
+
+	return false;
 }
 
 
@@ -157,10 +243,157 @@ CreateCitusCustomScanPath(PlannerInfo *root, RelOptInfo *relOptInfo,
 	path->custom_path.path.rows = 100000;
 	path->remoteScan = remoteScan;
 
+	/*
+	 * When the tasks return their rows sorted, the remote scan can return the
+	 * rows in that order by merging the task results, such that the combine
+	 * query does not need to sort all of them again.
+	 */
+	if (EnableSortedMerge)
+	{
+		DistributedPlan *distributedPlan = GetDistributedPlan(remoteScan);
+
+		path->custom_path.path.pathkeys =
+			SortedMergePathKeys(root, relOptInfo, distributedPlan);
+	}
+
 	return (Path *) path;
 }
 
 
+/*
+ * SortedMergePathKeys returns the pathkeys for the order in which the remote
+ * scan returns the rows when it merges the task results by the ORDER BY of the
+ * worker query, or NIL if that order is of no use to the combine query.
+ *
+ * Sort keys can only be used up to the first one that is not returned by the
+ * workers or that has no equivalence class in the combine query, since the
+ * order of the later keys only holds within groups of the earlier ones.
+ */
+static List *
+SortedMergePathKeys(PlannerInfo *root, RelOptInfo *relOptInfo,
+					DistributedPlan *distributedPlan)
+{
+	Query *workerQuery = distributedPlan->workerJob->jobQuery;
+	List *pathKeyList = NIL;
+
+	/* the rows of the tasks that finalize the groups are not sorted */
+	if (distributedPlan->repartitionedAggregateQuery != NULL)
+	{
+		return NIL;
+	}
+
+	SortGroupClause *sortClause = NULL;
+	foreach_ptr(sortClause, workerQuery->sortClause)
+	{
+		AttrNumber columnId = WorkerSortColumnId(workerQuery->targetList, sortClause);
+		if (columnId == InvalidAttrNumber)
+		{
+			break;
+		}
+
+		Var *column = RemoteScanColumn(relOptInfo, columnId);
+		if (column == NULL)
+		{
+			break;
+		}
+
+		/* pathkeys built from an operator place NULLs in the default position */
+		Oid opfamily = InvalidOid;
+		Oid opcintype = InvalidOid;
+		int16 strategy = 0;
+		if (!get_ordering_op_properties(sortClause->sortop, &opfamily, &opcintype,
+										&strategy))
+		{
+			break;
+		}
+
+		bool defaultNullsFirst = (strategy == BTGreaterStrategyNumber);
+		if (sortClause->nulls_first != defaultNullsFirst)
+		{
+			break;
+		}
+
+		/* equivalence classes cannot be created anymore, only look them up */
+		bool createEquivalenceClass = false;
+
+#if PG_VERSION_NUM >= PG_VERSION_16
+		List *columnPathKeyList = build_expression_pathkey(root, (Expr *) column,
+														   sortClause->sortop,
+														   relOptInfo->relids,
+														   createEquivalenceClass);
+#else
+		List *columnPathKeyList = build_expression_pathkey(root, (Expr *) column, NULL,
+														   sortClause->sortop,
+														   relOptInfo->relids,
+														   createEquivalenceClass);
+#endif
+		if (columnPathKeyList == NIL)
+		{
+			break;
+		}
+
+		PathKey *pathKey = (PathKey *) linitial(columnPathKeyList);
+		if (!list_member_ptr(pathKeyList, pathKey))
+		{
+			pathKeyList = lappend(pathKeyList, pathKey);
+		}
+	}
+
+	return truncate_useless_pathkeys(root, relOptInfo, pathKeyList);
+}
+
+
+/*
+ * RemoteScanColumn returns the Var for the given column of the remote scan
+ * that the combine query uses, or NULL if the combine query does not use it.
+ */
+static Var *
+RemoteScanColumn(RelOptInfo *relOptInfo, AttrNumber columnId)
+{
+	Expr *targetExpr = NULL;
+	foreach_ptr(targetExpr, relOptInfo->reltarget->exprs)
+	{
+		if (IsA(targetExpr, Var) && ((Var *) targetExpr)->varattno == columnId)
+		{
+			return (Var *) targetExpr;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * WorkerSortColumnId returns the number of the remote scan column in which the
+ * workers return the sort key of the given sort clause of the worker query, or
+ * InvalidAttrNumber if the sort key is not returned. The columns are numbered
+ * in the same way as in RemoteScanTargetList.
+ */
+AttrNumber
+WorkerSortColumnId(List *workerTargetList, SortGroupClause *sortClause)
+{
+	AttrNumber columnId = 1;
+
+	TargetEntry *workerTargetEntry = NULL;
+	foreach_ptr(workerTargetEntry, workerTargetList)
+	{
+		if (workerTargetEntry->resjunk)
+		{
+			continue;
+		}
+
+		if (workerTargetEntry->ressortgroupref == sortClause->tleSortGroupRef)
+		{
+			return columnId;
+		}
+
+		columnId++;
+	}
+
+	return InvalidAttrNumber;
+}
+
+
 /*
  * CitusCustomScanPathPlan is called for the CitusCustomScanPath node in the best_path
  * after the postgres planner has evaluated all possible paths.
@@ -197,6 +430,16 @@ CitusCustomScanPathPlan(PlannerInfo *root,
 	 */
 	citusPath->remoteScan->scan.plan.targetlist = tlist;
 
+	/*
+	 * The combine query relies on the order of the path, hence the executor
+	 * needs to merge the sorted task results.
+	 */
+	if (best_path->path.pathkeys != NIL)
+	{
+		DistributedPlan *distributedPlan = GetDistributedPlan(citusPath->remoteScan);
+		distributedPlan->mergeSortedTaskResults = true;
+	}
+
 	/*
 	 * The custom_scan_tlist contains target entries for to the "output" of the call
 	 * to citus_extradata_container, which is actually replaced by a CustomScan.
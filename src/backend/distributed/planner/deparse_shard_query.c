@@ -12,10 +12,12 @@
 #include "postgres.h"
 
 #include "c.h"
+#include "miscadmin.h"
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "catalog/pg_constraint.h"
+#include "common/hashfn.h"
 #include "lib/stringinfo.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -24,7 +26,11 @@
 #include "nodes/pg_list.h"
 #include "parser/parsetree.h"
 #include "storage/lock.h"
+#include "utils/builtins.h"
+#include "utils/float.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
 
@@ -38,16 +44,83 @@
 #include "distributed/metadata_cache.h"
 #include "distributed/multi_physical_planner.h"
 #include "distributed/multi_router_planner.h"
+#include "distributed/relay_utility.h"
 #include "distributed/shard_utils.h"
 #include "distributed/utils/citus_stat_tenants.h"
 #include "distributed/version_compat.h"
 
 
+/*
+ * Byte that surrounds the index of the relation in the shard name placeholders
+ * of shard query templates. It requires the placeholders to be quoted, and does
+ * not appear in the deparsed identifiers and literals of regular queries.
+ */
+#define SHARD_NAME_PLACEHOLDER_MARKER '\x01'
+
+
+/*
+ * ShardNameContext is the context of the walker that replaces the relations
+ * in a query by their shards, or by placeholders for the shard names.
+ */
+typedef struct ShardNameContext
+{
+	List *relationShardList;
+
+	/* whether to use placeholders whose index is in placeholderRelationIdList */
+	bool usePlaceholders;
+	List *placeholderRelationIdList;
+} ShardNameContext;
+
+
+/* maximum number of shard query templates that a backend keeps */
+#define MAX_CACHED_SHARD_QUERY_TEMPLATES 64
+
+
+/*
+ * CachedShardQueryTemplate is a shard query template that is kept across
+ * executions, along with the query it was built from and the settings that
+ * affect how the constants in the query are deparsed.
+ */
+typedef struct CachedShardQueryTemplate
+{
+	/* cheap hash of the query to skip most entries without equal() */
+	uint32 fingerprint;
+	Query *query;
+
+	int dateStyle;
+	int dateOrder;
+	int intervalStyle;
+	int extraFloatDigits;
+
+	ShardQueryTemplate *queryTemplate;
+} CachedShardQueryTemplate;
+
+
+/* controlled via GUC */
+bool EnableShardQueryTemplates = false;
+bool EnableShardQueryTemplateCache = false;
+
+/* shard query templates kept across executions, in ShardQueryTemplateCacheContext */
+static MemoryContext ShardQueryTemplateCacheContext = NULL;
+static List *CachedShardQueryTemplateList = NIL;
+
+/* reset by the invalidation callbacks, the cache is flushed on its next use */
+static bool ShardQueryTemplateCacheValid = false;
+
+
 static void UpdateTaskQueryString(Query *query, Task *task);
+static bool UpdateRelationToShardNamesWalker(Node *node, ShardNameContext *context);
+static bool ParseShardQueryTemplate(ShardQueryTemplate *queryTemplate, char *queryString);
 static RelationShard * FindRelationShard(Oid inputRelationId, List *relationShardList);
 static void ConvertRteToSubqueryWithEmptyResult(RangeTblEntry *rte);
 static bool ShouldLazyDeparseQuery(Task *task);
 static char * DeparseTaskQuery(Task *task, Query *query);
+static void EnsureShardQueryTemplateCacheIsValid(void);
+static uint32 ShardQueryFingerprint(Query *query);
+static ShardQueryTemplate * CopyShardQueryTemplate(ShardQueryTemplate *queryTemplate);
+static void InvalidateShardQueryTemplateCacheCallback(Datum argument, Oid relationId);
+static void InvalidateShardQueryTemplateCacheSyscacheCallback(Datum argument, int cacheId,
+															  uint32 hashValue);
 
 
 /*
@@ -67,10 +140,68 @@ RebuildQueryStrings(Job *workerJob)
 		AddInsertAliasIfNeeded(originalQuery);
 	}
 
+	/*
+	 * The queries of UPDATE and DELETE tasks only differ in the shard names,
+	 * hence we deparse the query once and splice the shard names of the other
+	 * tasks into it. Tasks that may be executed locally need the query itself.
+	 */
+	bool tryQueryTemplate = EnableShardQueryTemplates && !isSingleTask &&
+							(originalQuery->commandType == CMD_UPDATE ||
+							 originalQuery->commandType == CMD_DELETE);
+	ShardQueryTemplate *queryTemplate = NULL;
+
+	if (tryQueryTemplate)
+	{
+		queryTemplate = LookupShardQueryTemplate(originalQuery);
+	}
+
 	foreach_ptr(task, taskList)
 	{
 		Query *query = originalQuery;
 
+		if (tryQueryTemplate && !TaskAccessesLocalNode(task))
+		{
+			char *queryString = NULL;
+			if (queryTemplate != NULL)
+			{
+				queryString = ShardQueryStringFromTemplate(queryTemplate,
+														   task->relationShardList);
+			}
+			else
+			{
+				Query *shardQuery = copyObject(originalQuery);
+				UpdateRelationToShardNames((Node *) shardQuery, task->relationShardList);
+				queryString = DeparseTaskQuery(task, shardQuery);
+
+				queryTemplate = CreateShardQueryTemplate(originalQuery,
+														 task->relationShardList,
+														 queryString);
+				tryQueryTemplate = queryTemplate != NULL;
+
+				if (queryTemplate != NULL)
+				{
+					CacheShardQueryTemplate(originalQuery, queryTemplate);
+				}
+			}
+
+			if (queryString != NULL)
+			{
+				task->partitionKeyValue = workerJob->partitionKeyValue;
+				SetJobColocationId(workerJob);
+				task->colocationId = workerJob->colocationId;
+
+				SetTaskQueryString(task, AnnotateQuery(queryString,
+													   task->partitionKeyValue,
+													   task->colocationId));
+				task->parametersInQueryStringResolved =
+					workerJob->parametersInJobQueryResolved;
+
+				ereport(DEBUG4, (errmsg("query after rebuilding:  %s",
+										TaskQueryString(task))));
+				continue;
+			}
+		}
+
 		/*
 		 * Copy the query if there are multiple tasks. If there is a single
 		 * task, we scribble on the original query to avoid the copying
@@ -215,6 +346,23 @@ UpdateTaskQueryString(Query *query, Task *task)
  */
 bool
 UpdateRelationToShardNames(Node *node, List *relationShardList)
+{
+	ShardNameContext context = {
+		.relationShardList = relationShardList,
+		.usePlaceholders = false,
+		.placeholderRelationIdList = NIL
+	};
+
+	return UpdateRelationToShardNamesWalker(node, &context);
+}
+
+
+/*
+ * UpdateRelationToShardNamesWalker implements UpdateRelationToShardNames, and
+ * optionally replaces the relations by placeholders for their shard names.
+ */
+static bool
+UpdateRelationToShardNamesWalker(Node *node, ShardNameContext *context)
 {
 	uint64 shardId = INVALID_SHARD_ID;
 
@@ -226,14 +374,14 @@ UpdateRelationToShardNames(Node *node, List *relationShardList)
 	/* want to look at all RTEs, even in subqueries, CTEs and such */
 	if (IsA(node, Query))
 	{
-		return query_tree_walker((Query *) node, UpdateRelationToShardNames,
-								 relationShardList, QTW_EXAMINE_RTES_BEFORE);
+		return query_tree_walker((Query *) node, UpdateRelationToShardNamesWalker,
+								 context, QTW_EXAMINE_RTES_BEFORE);
 	}
 
 	if (!IsA(node, RangeTblEntry))
 	{
-		return expression_tree_walker(node, UpdateRelationToShardNames,
-									  relationShardList);
+		return expression_tree_walker(node, UpdateRelationToShardNamesWalker,
+									  context);
 	}
 
 	RangeTblEntry *newRte = (RangeTblEntry *) node;
@@ -259,7 +407,7 @@ UpdateRelationToShardNames(Node *node, List *relationShardList)
 	}
 
 	RelationShard *relationShard = FindRelationShard(newRte->relid,
-													 relationShardList);
+													 context->relationShardList);
 
 	bool replaceRteWithNullValues = relationShard == NULL ||
 									relationShard->shardId == INVALID_SHARD_ID;
@@ -272,8 +420,21 @@ UpdateRelationToShardNames(Node *node, List *relationShardList)
 	shardId = relationShard->shardId;
 	Oid relationId = relationShard->relationId;
 
-	char *relationName = get_rel_name(relationId);
-	AppendShardIdToName(&relationName, shardId);
+	char *relationName = NULL;
+	if (context->usePlaceholders)
+	{
+		int placeholderIndex = list_length(context->placeholderRelationIdList);
+		context->placeholderRelationIdList =
+			lappend_oid(context->placeholderRelationIdList, relationId);
+
+		relationName = psprintf("%c%d%c", SHARD_NAME_PLACEHOLDER_MARKER,
+								placeholderIndex, SHARD_NAME_PLACEHOLDER_MARKER);
+	}
+	else
+	{
+		relationName = get_rel_name(relationId);
+		AppendShardIdToName(&relationName, shardId);
+	}
 
 	Oid schemaId = get_rel_namespace(relationId);
 	char *schemaName = get_namespace_name(schemaId);
@@ -284,6 +445,346 @@ UpdateRelationToShardNames(Node *node, List *relationShardList)
 }
 
 
+/*
+ * CreateShardQueryTemplate deparses the given query with placeholders for the
+ * shard names of its relations, such that the query strings of tasks that only
+ * differ in their shards can be created by splicing the shard names into it.
+ * The query string of a task on the shards in relationShardList is given to
+ * check that the template produces the same. If it does not, or the template
+ * cannot be parsed, the function returns NULL.
+ */
+ShardQueryTemplate *
+CreateShardQueryTemplate(Query *query, List *relationShardList, char *shardQueryString)
+{
+	Query *templateQuery = copyObject(query);
+
+	ShardNameContext context = {
+		.relationShardList = relationShardList,
+		.usePlaceholders = true,
+		.placeholderRelationIdList = NIL
+	};
+
+	UpdateRelationToShardNamesWalker((Node *) templateQuery, &context);
+
+	/* the task queries have explicit ANDs, see QueryPushdownTaskCreate */
+	if (templateQuery->jointree != NULL && templateQuery->jointree->quals != NULL &&
+		IsA(templateQuery->jointree->quals, List))
+	{
+		templateQuery->jointree->quals =
+			(Node *) make_ands_explicit((List *) templateQuery->jointree->quals);
+	}
+
+	StringInfo templateString = makeStringInfo();
+	pg_get_query_def(templateQuery, templateString);
+
+	ShardQueryTemplate *queryTemplate = palloc0(sizeof(ShardQueryTemplate));
+	queryTemplate->placeholderRelationIdList = context.placeholderRelationIdList;
+
+	if (!ParseShardQueryTemplate(queryTemplate, templateString->data))
+	{
+		return NULL;
+	}
+
+	char *templateQueryString = ShardQueryStringFromTemplate(queryTemplate,
+															 relationShardList);
+	if (strcmp(templateQueryString, shardQueryString) != 0)
+	{
+		ereport(DEBUG4, (errmsg("shard query template does not match the shard "
+								"query: %s", templateString->data)));
+		return NULL;
+	}
+
+	return queryTemplate;
+}
+
+
+/*
+ * ParseShardQueryTemplate splits the given query string, which was deparsed
+ * with shard name placeholders, into the fragments around the placeholders.
+ * It returns false if the query string contains the placeholder marker in
+ * other places than quoted placeholders.
+ */
+static bool
+ParseShardQueryTemplate(ShardQueryTemplate *queryTemplate, char *queryString)
+{
+	int placeholderCount = list_length(queryTemplate->placeholderRelationIdList);
+	char *fragmentStart = queryString;
+	char *marker = NULL;
+
+	while ((marker = strchr(fragmentStart, SHARD_NAME_PLACEHOLDER_MARKER)) != NULL)
+	{
+		/* placeholders are quoted, since they contain the marker */
+		if (marker == fragmentStart || marker[-1] != '"')
+		{
+			return false;
+		}
+
+		char *indexEnd = NULL;
+		long placeholderIndex = strtol(marker + 1, &indexEnd, 10);
+		if (indexEnd == marker + 1 || indexEnd[0] != SHARD_NAME_PLACEHOLDER_MARKER ||
+			indexEnd[1] != '"' || placeholderIndex < 0 ||
+			placeholderIndex >= placeholderCount)
+		{
+			return false;
+		}
+
+		/* the fragment ends before the opening quote of the placeholder */
+		queryTemplate->fragmentList =
+			lappend(queryTemplate->fragmentList,
+					pnstrdup(fragmentStart, marker - 1 - fragmentStart));
+		queryTemplate->placeholderIndexList =
+			lappend_int(queryTemplate->placeholderIndexList, (int) placeholderIndex);
+
+		fragmentStart = indexEnd + 2;
+	}
+
+	queryTemplate->fragmentList = lappend(queryTemplate->fragmentList,
+										  pstrdup(fragmentStart));
+
+	return true;
+}
+
+
+/*
+ * ShardQueryStringFromTemplate returns the query string of the given template
+ * with the placeholders replaced by the names of the shards of their relations
+ * in relationShardList, or NULL if relationShardList lacks one of the shards.
+ */
+char *
+ShardQueryStringFromTemplate(ShardQueryTemplate *queryTemplate,
+							 List *relationShardList)
+{
+	StringInfo queryString = makeStringInfo();
+	int placeholderCount = list_length(queryTemplate->placeholderIndexList);
+
+	for (int fragmentIndex = 0; fragmentIndex < placeholderCount; fragmentIndex++)
+	{
+		appendStringInfoString(queryString,
+							   list_nth(queryTemplate->fragmentList, fragmentIndex));
+
+		int placeholderIndex = list_nth_int(queryTemplate->placeholderIndexList,
+											fragmentIndex);
+		Oid relationId = list_nth_oid(queryTemplate->placeholderRelationIdList,
+									  placeholderIndex);
+		RelationShard *relationShard = FindRelationShard(relationId, relationShardList);
+		if (relationShard == NULL || relationShard->shardId == INVALID_SHARD_ID)
+		{
+			return NULL;
+		}
+
+		char *shardName = get_rel_name(relationId);
+		AppendShardIdToName(&shardName, relationShard->shardId);
+
+		appendStringInfoString(queryString, quote_identifier(shardName));
+	}
+
+	appendStringInfoString(queryString, llast(queryTemplate->fragmentList));
+
+	return queryString->data;
+}
+
+
+/*
+ * LookupShardQueryTemplate returns a copy of the shard query template that was
+ * cached for a query that is equal to the given query, or NULL if there is
+ * none or the shard query template cache is disabled.
+ */
+ShardQueryTemplate *
+LookupShardQueryTemplate(Query *query)
+{
+	if (!EnableShardQueryTemplateCache)
+	{
+		return NULL;
+	}
+
+	EnsureShardQueryTemplateCacheIsValid();
+
+	uint32 fingerprint = ShardQueryFingerprint(query);
+	CachedShardQueryTemplate *cachedTemplate = NULL;
+
+	foreach_ptr(cachedTemplate, CachedShardQueryTemplateList)
+	{
+		if (cachedTemplate->fingerprint != fingerprint ||
+			cachedTemplate->dateStyle != DateStyle ||
+			cachedTemplate->dateOrder != DateOrder ||
+			cachedTemplate->intervalStyle != IntervalStyle ||
+			cachedTemplate->extraFloatDigits != extra_float_digits ||
+			!equal(cachedTemplate->query, query))
+		{
+			continue;
+		}
+
+		ereport(DEBUG4, (errmsg("using cached shard query template")));
+
+		/* invalidations do not reach the copy while it is being used */
+		return CopyShardQueryTemplate(cachedTemplate->queryTemplate);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * CacheShardQueryTemplate keeps a copy of the given shard query template of
+ * the given query for later executions of the same query. The cache is
+ * flushed when it is full, since the templates are cheap to rebuild.
+ */
+void
+CacheShardQueryTemplate(Query *query, ShardQueryTemplate *queryTemplate)
+{
+	if (!EnableShardQueryTemplateCache)
+	{
+		return;
+	}
+
+	EnsureShardQueryTemplateCacheIsValid();
+
+	if (list_length(CachedShardQueryTemplateList) >= MAX_CACHED_SHARD_QUERY_TEMPLATES)
+	{
+		MemoryContextReset(ShardQueryTemplateCacheContext);
+		CachedShardQueryTemplateList = NIL;
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(ShardQueryTemplateCacheContext);
+
+	CachedShardQueryTemplate *cachedTemplate = palloc0(sizeof(CachedShardQueryTemplate));
+	cachedTemplate->fingerprint = ShardQueryFingerprint(query);
+	cachedTemplate->query = copyObject(query);
+	cachedTemplate->dateStyle = DateStyle;
+	cachedTemplate->dateOrder = DateOrder;
+	cachedTemplate->intervalStyle = IntervalStyle;
+	cachedTemplate->extraFloatDigits = extra_float_digits;
+	cachedTemplate->queryTemplate = CopyShardQueryTemplate(queryTemplate);
+
+	CachedShardQueryTemplateList = lappend(CachedShardQueryTemplateList,
+										   cachedTemplate);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * EnsureShardQueryTemplateCacheIsValid creates the memory context of the shard
+ * query template cache and registers its invalidation callbacks on first use,
+ * and flushes the cache if it was invalidated since its last use.
+ */
+static void
+EnsureShardQueryTemplateCacheIsValid(void)
+{
+	if (ShardQueryTemplateCacheContext == NULL)
+	{
+		ShardQueryTemplateCacheContext =
+			AllocSetContextCreate(CacheMemoryContext, "ShardQueryTemplateCache",
+								  ALLOCSET_DEFAULT_SIZES);
+
+		/*
+		 * The deparsed queries depend on the names of the relations, columns,
+		 * functions, operators, types, collations and schemas that they use.
+		 * DDL on any of those flushes the whole cache.
+		 */
+		CacheRegisterRelcacheCallback(InvalidateShardQueryTemplateCacheCallback,
+									  (Datum) 0);
+		CacheRegisterSyscacheCallback(NAMESPACEOID,
+									  InvalidateShardQueryTemplateCacheSyscacheCallback,
+									  (Datum) 0);
+		CacheRegisterSyscacheCallback(PROCOID,
+									  InvalidateShardQueryTemplateCacheSyscacheCallback,
+									  (Datum) 0);
+		CacheRegisterSyscacheCallback(OPEROID,
+									  InvalidateShardQueryTemplateCacheSyscacheCallback,
+									  (Datum) 0);
+		CacheRegisterSyscacheCallback(TYPEOID,
+									  InvalidateShardQueryTemplateCacheSyscacheCallback,
+									  (Datum) 0);
+		CacheRegisterSyscacheCallback(COLLOID,
+									  InvalidateShardQueryTemplateCacheSyscacheCallback,
+									  (Datum) 0);
+
+		ShardQueryTemplateCacheValid = true;
+	}
+
+	if (!ShardQueryTemplateCacheValid)
+	{
+		MemoryContextReset(ShardQueryTemplateCacheContext);
+		CachedShardQueryTemplateList = NIL;
+		ShardQueryTemplateCacheValid = true;
+	}
+}
+
+
+/*
+ * ShardQueryFingerprint returns a hash of the command type, target list length
+ * and range table of the query, which differs for most unequal queries.
+ */
+static uint32
+ShardQueryFingerprint(Query *query)
+{
+	uint32 fingerprint = hash_uint32((uint32) query->commandType);
+	fingerprint = hash_combine(fingerprint,
+							   hash_uint32((uint32) list_length(query->targetList)));
+
+	RangeTblEntry *rangeTableEntry = NULL;
+	foreach_ptr(rangeTableEntry, query->rtable)
+	{
+		fingerprint = hash_combine(fingerprint,
+								   hash_uint32((uint32) rangeTableEntry->rtekind));
+		fingerprint = hash_combine(fingerprint,
+								   hash_uint32((uint32) rangeTableEntry->relid));
+	}
+
+	return fingerprint;
+}
+
+
+/*
+ * CopyShardQueryTemplate returns a copy of the given shard query template in
+ * the current memory context.
+ */
+static ShardQueryTemplate *
+CopyShardQueryTemplate(ShardQueryTemplate *queryTemplate)
+{
+	ShardQueryTemplate *copiedTemplate = palloc0(sizeof(ShardQueryTemplate));
+	char *fragment = NULL;
+
+	foreach_ptr(fragment, queryTemplate->fragmentList)
+	{
+		copiedTemplate->fragmentList = lappend(copiedTemplate->fragmentList,
+											   pstrdup(fragment));
+	}
+
+	copiedTemplate->placeholderIndexList = list_copy(queryTemplate->placeholderIndexList);
+	copiedTemplate->placeholderRelationIdList =
+		list_copy(queryTemplate->placeholderRelationIdList);
+
+	return copiedTemplate;
+}
+
+
+/*
+ * InvalidateShardQueryTemplateCacheCallback marks the shard query template
+ * cache as invalid when a relation changes. The cache is flushed on its next
+ * use rather than here, since its templates may be in use.
+ */
+static void
+InvalidateShardQueryTemplateCacheCallback(Datum argument, Oid relationId)
+{
+	ShardQueryTemplateCacheValid = false;
+}
+
+
+/*
+ * InvalidateShardQueryTemplateCacheSyscacheCallback marks the shard query
+ * template cache as invalid when a schema, function, operator, type or
+ * collation changes.
+ */
+static void
+InvalidateShardQueryTemplateCacheSyscacheCallback(Datum argument, int cacheId,
+												  uint32 hashValue)
+{
+	ShardQueryTemplateCacheValid = false;
+}
+
+
 /*
  * FindRelationShard finds the RelationShard for shard relation with
  * given Oid if exists in given relationShardList. Otherwise, returns NULL.
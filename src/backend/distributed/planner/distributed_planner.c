@@ -38,6 +38,7 @@
 
 #include "pg_version_constants.h"
 
+#include "distributed/bulk_insert_select.h"
 #include "distributed/citus_depended_object.h"
 #include "distributed/citus_nodefuncs.h"
 #include "distributed/citus_nodes.h"
@@ -48,6 +49,7 @@
 #include "distributed/coordinator_protocol.h"
 #include "distributed/cte_inline.h"
 #include "distributed/distributed_planner.h"
+#include "distributed/distributed_table_statistics.h"
 #include "distributed/function_call_delegation.h"
 #include "distributed/insert_select_planner.h"
 #include "distributed/intermediate_result_pruning.h"
@@ -61,6 +63,7 @@
 #include "distributed/multi_partitioning_utils.h"
 #include "distributed/multi_physical_planner.h"
 #include "distributed/multi_router_planner.h"
+#include "distributed/planning_times.h"
 #include "distributed/query_pushdown_planning.h"
 #include "distributed/query_utils.h"
 #include "distributed/recursive_planning.h"
@@ -93,6 +96,25 @@ static uint64 NextPlanId = 1;
 /* keep track of planner call stack levels */
 int PlannerLevel = 0;
 
+/* GUC, whether multi-shard SELECTs with unresolved parameters get a generic plan */
+bool EnableGenericMultiShardPlans = false;
+
+/* GUC, whether fast path router queries are planned in FastPathPlanningContext */
+bool EnableFastPathPlanningContext = true;
+
+/* size of the first block of FastPathPlanningContext, which is kept on reset */
+#define FAST_PATH_PLANNING_CONTEXT_BLOCK_SIZE (64 * 1024)
+
+/*
+ * FastPathPlanningContext is the memory context that fast path router queries
+ * are planned in. Only the resulting plan is copied to the memory context of
+ * the caller, and the context is reset after planning. A reset keeps the first
+ * block of the context, so planning a simple router query usually reuses that
+ * block instead of allocating memory for each query.
+ */
+static MemoryContext FastPathPlanningContext = NULL;
+static bool FastPathPlanningContextInUse = false;
+
 static bool ListContainsDistributedTableRTE(List *rangeTableList,
 											bool *maybeHasForeignDistributedTable);
 static PlannedStmt * CreateDistributedPlannedStmt(
@@ -142,6 +164,8 @@ static void ResetPlannerRestrictionContext(
 	PlannerRestrictionContext *plannerRestrictionContext);
 static PlannedStmt * PlanFastPathDistributedStmt(DistributedPlanningContext *planContext,
 												 Node *distributionKeyValue);
+static PlannedStmt * PlanFastPathDistributedStmtInContext(
+	DistributedPlanningContext *planContext, Node *distributionKeyValue);
 static PlannedStmt * PlanDistributedStmt(DistributedPlanningContext *planContext,
 										 int rteIdCounter);
 static RTEListProperties * GetRTEListProperties(List *rangeTableList);
@@ -150,6 +174,16 @@ static void WarnIfListHasForeignDistributedTable(List *rangeTableList);
 static RouterPlanType GetRouterPlanType(Query *query,
 										Query *originalQuery,
 										bool hasUnresolvedParams);
+static bool CanCreateGenericMultiShardPlan(Query *originalQuery);
+static DistributedPlan * TryCreateGenericMultiShardPlan(Query *originalQuery, Query *query,
+														PlannerRestrictionContext *
+														plannerRestrictionContext);
+static DistributedPlan * CreateLogicalDistributedPlan(Query *originalQuery, Query *query,
+													  PlannerRestrictionContext *
+													  plannerRestrictionContext);
+static void PrunePartitionsForDistributedPlan(DistributedPlan *distributedPlan,
+											  DistributedPlanningContext *planContext);
+static List * PartitionPruningRestrictionList(DistributedPlanningContext *planContext);
 static void ConcatenateRTablesAndPerminfos(PlannedStmt *mainPlan,
 										   PlannedStmt *concatPlan);
 
@@ -215,11 +249,10 @@ distributed_planner(Query *parse,
 		 */
 		rteIdCounter = AssignRTEIdentities(rangeTableList, rteIdCounter);
 
-		planContext.originalQuery = copyObject(parse);
-
-
 		if (!fastPathRouterQuery)
 		{
+			planContext.originalQuery = copyObject(parse);
+
 			/*
 			 * When there are partitioned tables (not applicable to fast path),
 			 * pretend that they are regular tables to avoid unnecessary work
@@ -247,6 +280,12 @@ distributed_planner(Query *parse,
 	/* create a restriction context and put it at the end if context list */
 	planContext.plannerRestrictionContext = CreateAndPushPlannerRestrictionContext();
 
+	if (PlannerLevel == 0)
+	{
+		/* start measuring the planning phases of a new top-level query */
+		ResetPlanningPhaseTimes();
+	}
+
 	/*
 	 * We keep track of how many times we've recursed into the planner, primarily
 	 * to detect whether we are in a function call. We need to make sure that the
@@ -261,7 +300,8 @@ distributed_planner(Query *parse,
 	{
 		if (fastPathRouterQuery)
 		{
-			result = PlanFastPathDistributedStmt(&planContext, distributionKeyValue);
+			result = PlanFastPathDistributedStmtInContext(&planContext,
+														  distributionKeyValue);
 		}
 		else
 		{
@@ -279,7 +319,7 @@ distributed_planner(Query *parse,
 			}
 			else if ((result = TryToDelegateFunctionCall(&planContext)) == NULL)
 			{
-				result = planContext.plan;
+				result = BulkInsertSelectPlan(planContext.plan);
 			}
 		}
 	}
@@ -670,6 +710,71 @@ PlanFastPathDistributedStmt(DistributedPlanningContext *planContext,
 }
 
 
+/*
+ * PlanFastPathDistributedStmtInContext plans a fast path router query in
+ * FastPathPlanningContext and returns a copy of the plan in the current
+ * memory context, such that the intermediate allocations of planning are
+ * released at once and their memory is reused by the next query.
+ */
+static PlannedStmt *
+PlanFastPathDistributedStmtInContext(DistributedPlanningContext *planContext,
+									 Node *distributionKeyValue)
+{
+	if (!EnableFastPathPlanningContext || FastPathPlanningContextInUse)
+	{
+		/* we might plan a query while planning another, e.g. in a function */
+		planContext->originalQuery = copyObject(planContext->query);
+
+		return PlanFastPathDistributedStmt(planContext, distributionKeyValue);
+	}
+
+	if (FastPathPlanningContext == NULL)
+	{
+		FastPathPlanningContext =
+			AllocSetContextCreate(TopMemoryContext,
+								  "Fast Path Planning Context",
+								  0,
+								  FAST_PATH_PLANNING_CONTEXT_BLOCK_SIZE,
+								  ALLOCSET_DEFAULT_MAXSIZE);
+	}
+
+	MemoryContext callerContext = CurrentMemoryContext;
+	PlannedStmt *plan = NULL;
+
+	FastPathPlanningContextInUse = true;
+
+	PG_TRY();
+	{
+		MemoryContextSwitchTo(FastPathPlanningContext);
+
+		/*
+		 * Planning replaces parts of both queries, e.g. the quals and the
+		 * relations of shards. We plan copies that live in the planning context,
+		 * such that the parse tree of the caller does not end up pointing into
+		 * memory that is released below.
+		 */
+		planContext->originalQuery = copyObject(planContext->query);
+		planContext->query = copyObject(planContext->query);
+
+		plan = PlanFastPathDistributedStmt(planContext, distributionKeyValue);
+	}
+	PG_FINALLY();
+	{
+		MemoryContextSwitchTo(callerContext);
+
+		FastPathPlanningContextInUse = false;
+	}
+	PG_END_TRY();
+
+	/* only the plan outlives planning */
+	PlannedStmt *result = copyObject(plan);
+
+	MemoryContextReset(FastPathPlanningContext);
+
+	return result;
+}
+
+
 /*
  * PlanDistributedStmt creates a distributed planned statement using the PG
  * planner.
@@ -798,6 +903,17 @@ CreateDistributedPlannedStmt(DistributedPlanningContext *planContext)
 	/* remember the plan's identifier for identifying subplans */
 	distributedPlan->planId = planId;
 
+	if (!distributedPlan->planningError)
+	{
+		PrunePartitionsForDistributedPlan(distributedPlan, planContext);
+	}
+
+	if (PlannerLevel == 1)
+	{
+		/* remember how long each planning phase of the top-level query took */
+		GetPlanningPhaseTimes(distributedPlan->planningPhaseTimes);
+	}
+
 	/* create final plan by combining local plan with distributed plan */
 	resultPlan = FinalizePlan(planContext->plan, distributedPlan);
 
@@ -818,6 +934,123 @@ CreateDistributedPlannedStmt(DistributedPlanningContext *planContext)
 }
 
 
+/*
+ * PrunePartitionsForDistributedPlan prunes the partitions of the partitioned
+ * tables in the query using the restrictions of the query, in the same way
+ * that PostgreSQL prunes them on the shards, and records the partitions that
+ * remain in the distributed plan. That way, the executor only needs to lock
+ * the partitions which the query can actually access.
+ *
+ * A partitioned table is only pruned when it appears once in the query. We
+ * skip INSERT and MERGE commands, since their rows can go to any partition
+ * of the target table.
+ */
+static void
+PrunePartitionsForDistributedPlan(DistributedPlan *distributedPlan,
+								  DistributedPlanningContext *planContext)
+{
+	Query *originalQuery = planContext->originalQuery;
+
+	if (originalQuery->commandType == CMD_INSERT || IsMergeQuery(originalQuery))
+	{
+		return;
+	}
+
+	List *relationRestrictionList = PartitionPruningRestrictionList(planContext);
+
+	RelationRestriction *relationRestriction = NULL;
+	foreach_ptr(relationRestriction, relationRestrictionList)
+	{
+		Oid relationId = relationRestriction->relationId;
+
+		if (!PartitionedTable(relationId))
+		{
+			continue;
+		}
+
+		int relationRestrictionCount = 0;
+		RelationRestriction *otherRestriction = NULL;
+		foreach_ptr(otherRestriction, relationRestrictionList)
+		{
+			if (otherRestriction->relationId == relationId)
+			{
+				relationRestrictionCount++;
+			}
+		}
+
+		List *restrictionClauseList = relationRestriction->relOptInfo->baserestrictinfo;
+		if (relationRestrictionCount > 1 || restrictionClauseList == NIL)
+		{
+			continue;
+		}
+
+		bool partitionsPruned = false;
+		List *remainingPartitionList =
+			PrunedPartitionList(relationId, relationRestriction->index,
+								restrictionClauseList, &partitionsPruned);
+		if (!partitionsPruned)
+		{
+			/* nothing was pruned, lock all partitions as usual */
+			continue;
+		}
+
+		distributedPlan->prunedRelationIdList =
+			lappend_oid(distributedPlan->prunedRelationIdList, relationId);
+		distributedPlan->remainingPartitionListList =
+			lappend(distributedPlan->remainingPartitionListList, remainingPartitionList);
+	}
+}
+
+
+/*
+ * PartitionPruningRestrictionList returns the relation restrictions that the
+ * partitions of the tables in the query can be pruned with. For fast path
+ * router queries, which skip standard_planner, the restriction is built from
+ * the WHERE clause of the query.
+ */
+static List *
+PartitionPruningRestrictionList(DistributedPlanningContext *planContext)
+{
+	PlannerRestrictionContext *plannerRestrictionContext =
+		planContext->plannerRestrictionContext;
+
+	if (!plannerRestrictionContext->fastPathRestrictionContext->fastPathRouterQuery)
+	{
+		return plannerRestrictionContext->relationRestrictionContext->
+			   relationRestrictionList;
+	}
+
+	Query *query = planContext->query;
+	if (list_length(query->rtable) != 1 || query->jointree == NULL ||
+		query->jointree->quals == NULL)
+	{
+		return NIL;
+	}
+
+	RangeTblEntry *rangeTableEntry = linitial(query->rtable);
+	if (rangeTableEntry->rtekind != RTE_RELATION)
+	{
+		return NIL;
+	}
+
+	Node *quals = ResolveExternalParams(copyObject(query->jointree->quals),
+										planContext->boundParams);
+	if (!IsA(quals, List))
+	{
+		quals = (Node *) make_ands_implicit((Expr *) quals);
+	}
+
+	RelationRestriction *relationRestriction = palloc0(sizeof(RelationRestriction));
+	relationRestriction->index = 1;
+	relationRestriction->relationId = rangeTableEntry->relid;
+	relationRestriction->rte = rangeTableEntry;
+	relationRestriction->relOptInfo = makeNode(RelOptInfo);
+	relationRestriction->relOptInfo->baserestrictinfo = (List *) quals;
+
+	return list_make1(relationRestriction);
+}
+
+
 /*
  * InlineCtesAndCreateDistributedPlannedStmt gets all the parameters required
  * for creating a distributed planned statement. The function is primarily a
@@ -867,6 +1100,7 @@ TryCreateDistributedPlannedStmt(PlannedStmt *localPlan,
 								PlannerRestrictionContext *plannerRestrictionContext)
 {
 	MemoryContext savedContext = CurrentMemoryContext;
+	DistributedPlanningPhase savedPlanningPhase = CurrentPlanningPhase();
 	PlannedStmt *result = NULL;
 
 	DistributedPlanningContext *planContext = palloc0(sizeof(DistributedPlanningContext));
@@ -894,6 +1128,9 @@ TryCreateDistributedPlannedStmt(PlannedStmt *localPlan,
 			PG_RE_THROW();
 		}
 
+		/* the error may have interrupted any of the planning phases */
+		EndPlanningPhase(savedPlanningPhase);
+
 		ereport(DEBUG4, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 						 errmsg("Planning after CTEs inlined failed with "
 								"\nmessage: %s\ndetail: %s\nhint: %s",
@@ -983,6 +1220,9 @@ CreateDistributedPlan(uint64 planId, bool allowRecursivePlanning, Query *origina
 	RouterPlanType routerPlan = GetRouterPlanType(query, originalQuery,
 												  hasUnresolvedParams);
 
+	DistributedPlanningPhase previousPhase =
+		BeginPlanningPhase(PLANNING_PHASE_PHYSICAL_PLANNING);
+
 	switch (routerPlan)
 	{
 		case INSERT_SELECT_INTO_CITUS_TABLE:
@@ -1029,6 +1269,7 @@ CreateDistributedPlan(uint64 planId, bool allowRecursivePlanning, Query *origina
 			 * INSERT...SELECT when the partition column is a parameter
 			 * because we don't perform any additional pruning in the executor.
 			 */
+			EndPlanningPhase(previousPhase);
 			return NULL;
 		}
 
@@ -1046,6 +1287,8 @@ CreateDistributedPlan(uint64 planId, bool allowRecursivePlanning, Query *origina
 		}
 	}
 
+	EndPlanningPhase(previousPhase);
+
 	/* the functions above always return a plan, possibly with an error */
 	Assert(distributedPlan);
 
@@ -1064,11 +1307,17 @@ CreateDistributedPlan(uint64 planId, bool allowRecursivePlanning, Query *origina
 		 * There are parameters that don't have a value in boundParams.
 		 *
 		 * The remainder of the planning logic cannot handle unbound
-		 * parameters. We return a NULL plan, which will have an
-		 * extremely high cost, such that postgres will replan with
-		 * bound parameters.
+		 * parameters, except for the logical planner in some cases. We
+		 * return a NULL plan, which will have an extremely high cost,
+		 * such that postgres will replan with bound parameters.
 		 */
-		return NULL;
+		if (!CanCreateGenericMultiShardPlan(originalQuery))
+		{
+			return NULL;
+		}
+
+		return TryCreateGenericMultiShardPlan(originalQuery, query,
+											  plannerRestrictionContext);
 	}
 
 	/* force evaluation of bound params */
@@ -1095,9 +1344,13 @@ CreateDistributedPlan(uint64 planId, bool allowRecursivePlanning, Query *origina
 	 * standard_planner again, which will adjust things accordingly in
 	 * set_plan_references>add_rtes_to_flat_rtable>add_rte_to_flat_rtable.
 	 */
+	previousPhase = BeginPlanningPhase(PLANNING_PHASE_RECURSIVE_PLANNING);
+
 	List *subPlanList = GenerateSubplansForSubqueriesAndCTEs(planId, originalQuery,
 															 plannerRestrictionContext);
 
+	EndPlanningPhase(previousPhase);
+
 	/*
 	 * If subqueries were recursively planned then we need to replan the query
 	 * to get the new planner restriction context and apply planner transformations.
@@ -1151,8 +1404,12 @@ CreateDistributedPlan(uint64 planId, bool allowRecursivePlanning, Query *origina
 		 * being contiguous.
 		 */
 
+		previousPhase = BeginPlanningPhase(PLANNING_PHASE_RECURSIVE_PLANNING);
+
 		standard_planner(newQuery, NULL, 0, boundParams);
 
+		EndPlanningPhase(previousPhase);
+
 		/* overwrite the old transformed query with the new transformed query */
 		*query = *newQuery;
 
@@ -1170,6 +1427,9 @@ CreateDistributedPlan(uint64 planId, bool allowRecursivePlanning, Query *origina
 		Assert(distributedPlan != NULL);
 		distributedPlan->subPlanList = subPlanList;
 
+		MarkSubPlansForTaskPruning(distributedPlan, planId, originalQuery);
+		MarkSubPlansForResultSlicing(distributedPlan, planId, originalQuery);
+
 		return distributedPlan;
 	}
 
@@ -1193,10 +1453,27 @@ CreateDistributedPlan(uint64 planId, bool allowRecursivePlanning, Query *origina
 
 	/* Step 3: Try Logical planner */
 
+	return CreateLogicalDistributedPlan(originalQuery, query, plannerRestrictionContext);
+}
+
+
+/*
+ * CreateLogicalDistributedPlan plans the given query, which does not need
+ * recursive planning, with the logical and the physical planner.
+ */
+static DistributedPlan *
+CreateLogicalDistributedPlan(Query *originalQuery, Query *query,
+							 PlannerRestrictionContext *plannerRestrictionContext)
+{
+	DistributedPlanningPhase previousPhase =
+		BeginPlanningPhase(PLANNING_PHASE_LOGICAL_OPTIMIZATION);
+
 	MultiTreeRoot *logicalPlan = MultiLogicalPlanCreate(originalQuery, query,
 														plannerRestrictionContext);
 	MultiLogicalPlanOptimize(logicalPlan);
 
+	EndPlanningPhase(previousPhase);
+
 	/*
 	 * This check is here to make it likely that all node types used in
 	 * Citus are dumpable. Explain can dump logical and physical plans
@@ -1207,8 +1484,12 @@ CreateDistributedPlan(uint64 planId, bool allowRecursivePlanning, Query *origina
 	CheckNodeIsDumpable((Node *) logicalPlan);
 
 	/* Create the physical plan */
-	distributedPlan = CreatePhysicalDistributedPlan(logicalPlan,
-													plannerRestrictionContext);
+	previousPhase = BeginPlanningPhase(PLANNING_PHASE_PHYSICAL_PLANNING);
+
+	DistributedPlan *distributedPlan =
+		CreatePhysicalDistributedPlan(logicalPlan, plannerRestrictionContext);
+
+	EndPlanningPhase(previousPhase);
 
 	/* distributed plan currently should always succeed or error out */
 	Assert(distributedPlan && distributedPlan->planningError == NULL);
@@ -1217,6 +1498,100 @@ CreateDistributedPlan(uint64 planId, bool allowRecursivePlanning, Query *origina
 }
 
 
+/*
+ * CanCreateGenericMultiShardPlan returns whether we should try to plan the
+ * given query with the logical planner while the values of its parameters are
+ * unknown, such that prepared multi-shard SELECTs get a generic plan that is
+ * reused across executions. The parameters are sent along with the task
+ * queries, and the executor skips the tasks on the shards that the parameter
+ * values exclude.
+ *
+ * CTEs and subqueries in expressions are typically recursively planned, and
+ * the subplans would be executed without the parameters.
+ */
+static bool
+CanCreateGenericMultiShardPlan(Query *originalQuery)
+{
+	if (!EnableGenericMultiShardPlans)
+	{
+		return false;
+	}
+
+	return originalQuery->commandType == CMD_SELECT &&
+		   originalQuery->cteList == NIL &&
+		   !originalQuery->hasSubLinks &&
+		   !originalQuery->hasModifyingCTE &&
+		   originalQuery->rowMarks == NIL;
+}
+
+
+/*
+ * TryCreateGenericMultiShardPlan plans a multi-shard SELECT with unresolved
+ * parameters via the logical planner. It returns NULL if the query cannot be
+ * planned without recursive planning or without knowing the parameters, in
+ * which case postgres replans the query with bound parameters.
+ */
+static DistributedPlan *
+TryCreateGenericMultiShardPlan(Query *originalQuery, Query *query,
+							   PlannerRestrictionContext *plannerRestrictionContext)
+{
+	MemoryContext savedContext = CurrentMemoryContext;
+	DistributedPlanningPhase savedPlanningPhase = CurrentPlanningPhase();
+	DistributedPlan *distributedPlan = NULL;
+
+	/* CTEs that are not referenced are not planned */
+	query->cteList = NIL;
+
+	PG_TRY();
+	{
+		distributedPlan = CreateLogicalDistributedPlan(originalQuery, query,
+													   plannerRestrictionContext);
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(savedContext);
+		ErrorData *edata = CopyErrorData();
+		FlushErrorState();
+
+		/* don't try to intercept PANIC or FATAL, let those breeze past us */
+		if (edata->elevel != ERROR)
+		{
+			PG_RE_THROW();
+		}
+
+		/* the error may have interrupted any of the planning phases */
+		EndPlanningPhase(savedPlanningPhase);
+
+		ereport(DEBUG4, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("Planning with unresolved parameters failed with "
+								"\nmessage: %s\ndetail: %s\nhint: %s",
+								edata->message ? edata->message : "",
+								edata->detail ? edata->detail : "",
+								edata->hint ? edata->hint : "")));
+
+		/* leave the error handling system */
+		FreeErrorData(edata);
+
+		return NULL;
+	}
+	PG_END_TRY();
+
+	/*
+	 * The tasks of repartition joins and repartitioned aggregates are not
+	 * sent the parameters.
+	 */
+	if (distributedPlan->workerJob->dependentJobList != NIL ||
+		distributedPlan->repartitionedAggregateQuery != NULL)
+	{
+		return NULL;
+	}
+
+	ereport(DEBUG2, (errmsg("Creating a generic plan for a multi-shard query")));
+
+	return distributedPlan;
+}
+
+
 /*
  * EnsurePartitionTableNotReplicated errors out if the input relation is
  * a partition table and the table has a replication factor greater than
@@ -2038,6 +2413,8 @@ multi_relation_restriction_hook(PlannerInfo *root, RelOptInfo *relOptInfo,
  * multi_get_relation_info_hook modifies the relation's indexlist
  * if necessary, to avoid a crash in PG16 caused by our
  * Citus function AdjustPartitioningForDistributedPlanning().
+ * It also sets the size of Citus tables to the one that distributed
+ * ANALYZE stored, see EstimateCitusTableSize().
  *
  * AdjustPartitioningForDistributedPlanning() is a hack that we use
  * to prevent Postgres' standard_planner() to expand all the partitions
@@ -2087,6 +2464,12 @@ multi_get_relation_info_hook(PlannerInfo *root, Oid relationObjectId, bool inhpa
 			}
 		}
 	}
+
+	if (!inhparent)
+	{
+		/* the table is empty here, use the statistics of its shards if any */
+		EstimateCitusTableSize(relationObjectId, rel);
+	}
 }
 
 
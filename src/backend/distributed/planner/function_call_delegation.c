@@ -25,8 +25,11 @@
 #include "optimizer/clauses.h"
 #include "parser/parse_coerce.h"
 #include "parser/parsetree.h"
+#include "storage/lmgr.h"
 #include "tcop/dest.h"
+#include "utils/hsearch.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/syscache.h"
 
 #include "pg_version_constants.h"
@@ -59,8 +62,28 @@ struct ParamWalkerContext
 	ParamKind paramKind;
 };
 
+/*
+ * FunctionDelegationCacheEntry caches the table that a distributed function
+ * is co-located with, such that routing a delegated call does not need to
+ * scan pg_dist_partition.
+ */
+typedef struct FunctionDelegationCacheEntry
+{
+	/* lookup key - must be first */
+	Oid functionId;
+
+	/* co-location group of the function when the entry was created */
+	int colocationId;
+
+	Oid colocatedRelationId;
+} FunctionDelegationCacheEntry;
+
 extern AllowedDistributionColumn AllowedDistributionColumnValue;
 
+/* backend-local cache of co-located tables, keyed by function OID */
+static HTAB *FunctionDelegationCache = NULL;
+
+static void InitializeFunctionDelegationCache(void);
 static bool contain_param_walker(Node *node, void *context);
 static void CheckDelegatedFunctionExecution(DistObjectCacheEntry *procedure,
 											FuncExpr *funcExpr);
@@ -390,7 +413,7 @@ TryToDelegateFunctionCall(DistributedPlanningContext *planContext)
 		return NULL;
 	}
 
-	Oid colocatedRelationId = ColocatedTableId(procedure->colocationId);
+	Oid colocatedRelationId = DistributedFunctionColocatedTableId(procedure);
 	if (colocatedRelationId == InvalidOid)
 	{
 		ereport(DEBUG4, (errmsg("function does not have co-located tables")));
@@ -503,6 +526,132 @@ TryToDelegateFunctionCall(DistributedPlanningContext *planContext)
 }
 
 
+/*
+ * DistributedFunctionColocatedTableId returns a table that is co-located with
+ * the given distributed function or procedure, or InvalidOid if there is none.
+ *
+ * Unlike ColocatedTableId, the result is cached per function, since it is
+ * needed on every call of a delegated function. The cache is invalidated when
+ * pg_dist_object, pg_dist_partition, or the cached table changes. As in
+ * ColocatedTableId, the table is locked to prevent it from being dropped for
+ * the remainder of the transaction.
+ */
+Oid
+DistributedFunctionColocatedTableId(DistObjectCacheEntry *procedure)
+{
+	Oid functionId = procedure->key.objid;
+	bool found = false;
+
+	InitializeFunctionDelegationCache();
+
+	FunctionDelegationCacheEntry *cacheEntry =
+		hash_search(FunctionDelegationCache, &functionId, HASH_FIND, &found);
+	if (found && cacheEntry->colocationId == procedure->colocationId)
+	{
+		Oid colocatedRelationId = cacheEntry->colocatedRelationId;
+
+		/* locking processes invalidations, which might remove the entry */
+		LockRelationOid(colocatedRelationId, AccessShareLock);
+		InitializeFunctionDelegationCache();
+
+		cacheEntry = hash_search(FunctionDelegationCache, &functionId, HASH_FIND,
+								 &found);
+		if (found && cacheEntry->colocatedRelationId == colocatedRelationId)
+		{
+			return colocatedRelationId;
+		}
+	}
+
+	Oid colocatedRelationId = ColocatedTableId(procedure->colocationId);
+
+	/* ColocatedTableId might have processed invalidations */
+	InitializeFunctionDelegationCache();
+
+	if (colocatedRelationId == InvalidOid)
+	{
+		/* do not cache, a table might be added to the co-location group */
+		hash_search(FunctionDelegationCache, &functionId, HASH_REMOVE, NULL);
+		return InvalidOid;
+	}
+
+	cacheEntry = hash_search(FunctionDelegationCache, &functionId, HASH_ENTER, NULL);
+	cacheEntry->colocationId = procedure->colocationId;
+	cacheEntry->colocatedRelationId = colocatedRelationId;
+
+	return colocatedRelationId;
+}
+
+
+/*
+ * InitializeFunctionDelegationCache creates the backend-local cache of the
+ * tables that distributed functions are co-located with, if it does not
+ * exist yet.
+ */
+static void
+InitializeFunctionDelegationCache(void)
+{
+	if (FunctionDelegationCache != NULL)
+	{
+		return;
+	}
+
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(Oid);
+	info.entrysize = sizeof(FunctionDelegationCacheEntry);
+	info.hcxt = CacheMemoryContext;
+	int hashFlags = (HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	FunctionDelegationCache = hash_create("Function Delegation Cache", 32, &info,
+										  hashFlags);
+}
+
+
+/*
+ * InvalidateFunctionDelegationCache removes all entries from the function
+ * delegation cache.
+ */
+void
+InvalidateFunctionDelegationCache(void)
+{
+	if (FunctionDelegationCache == NULL)
+	{
+		return;
+	}
+
+	hash_destroy(FunctionDelegationCache);
+	FunctionDelegationCache = NULL;
+}
+
+
+/*
+ * InvalidateFunctionDelegationCacheForRelation removes the entries of the
+ * functions that were routed using the given table.
+ */
+void
+InvalidateFunctionDelegationCacheForRelation(Oid relationId)
+{
+	FunctionDelegationCacheEntry *cacheEntry = NULL;
+	HASH_SEQ_STATUS status;
+
+	if (FunctionDelegationCache == NULL)
+	{
+		return;
+	}
+
+	hash_seq_init(&status, FunctionDelegationCache);
+
+	while ((cacheEntry = hash_seq_search(&status)) != NULL)
+	{
+		if (cacheEntry->colocatedRelationId == relationId)
+		{
+			hash_search(FunctionDelegationCache, &cacheEntry->functionId,
+						HASH_REMOVE, NULL);
+		}
+	}
+}
+
+
 /*
  * ShardPlacementForFunctionColocatedWithDistTable decides on a placement
  * for delegating a procedure call that accesses a distributed table.
@@ -91,6 +91,8 @@ static DeferredErrorMessage * InsertPartitionColumnMatchesSelect(Query *query,
 static DistributedPlan * CreateNonPushableInsertSelectPlan(uint64 planId, Query *parse,
 														   ParamListInfo boundParams);
 static DeferredErrorMessage * NonPushableInsertSelectSupported(Query *insertSelectQuery);
+static bool InsertSelectSortClauseRemovable(Query *insertSelectQuery,
+											Query *selectQuery);
 static void RelabelTargetEntryList(List *selectTargetList, List *insertTargetList);
 static List * AddInsertSelectCasts(List *insertTargetList, List *selectTargetList,
 								   Oid targetRelationId);
@@ -1447,6 +1449,20 @@ CreateNonPushableInsertSelectPlan(uint64 planId, Query *parse, ParamListInfo bou
 	List *insertTargetList = insertSelectQuery->targetList;
 	RelabelTargetEntryList(selectQuery->targetList, insertTargetList);
 
+	/*
+	 * The order of the rows does not matter for the INSERT, but a sort on
+	 * top of the distributed SELECT would make us pull all the rows to the
+	 * coordinator. Drop it, such that the rows can be repartitioned between
+	 * the workers instead.
+	 */
+	if (InsertSelectSortClauseRemovable(insertSelectQuery, selectQuery))
+	{
+		ereport(DEBUG2, (errmsg("ignoring the ORDER BY of the SELECT since the "
+								"order of the inserted rows does not matter")));
+
+		selectQuery->sortClause = NIL;
+	}
+
 	/*
 	 * Make a copy of the select query, since following code scribbles it
 	 * but we need to keep the original for EXPLAIN.
@@ -1513,6 +1529,48 @@ NonPushableInsertSelectSupported(Query *insertSelectQuery)
 }
 
 
+/*
+ * InsertSelectSortClauseRemovable returns whether the top-level ORDER BY of the
+ * SELECT of a non-pushable INSERT ... SELECT into a table that supports
+ * repartitioning can be dropped without an observable difference. That is not
+ * the case when the order determines which rows are selected, in which order
+ * sequence values or volatile functions are evaluated, which row wins an
+ * ON CONFLICT or the order of the RETURNING rows.
+ */
+static bool
+InsertSelectSortClauseRemovable(Query *insertSelectQuery, Query *selectQuery)
+{
+	if (!EnableRepartitionedInsertSelect)
+	{
+		return false;
+	}
+
+	if (selectQuery->sortClause == NIL ||
+		selectQuery->limitCount != NULL ||
+		selectQuery->limitOffset != NULL ||
+		selectQuery->hasDistinctOn ||
+		selectQuery->setOperations != NULL)
+	{
+		return false;
+	}
+
+	if (insertSelectQuery->onConflict != NULL ||
+		insertSelectQuery->returningList != NIL)
+	{
+		return false;
+	}
+
+	if (contain_volatile_functions((Node *) selectQuery->targetList))
+	{
+		return false;
+	}
+
+	RangeTblEntry *insertRte = ExtractResultRelationRTE(insertSelectQuery);
+
+	return IsSupportedRedistributionTarget(insertRte->relid);
+}
+
+
 /*
  * InsertSelectResultPrefix returns the prefix to use for intermediate
  * results of an INSERT ... SELECT via the coordinator that runs in two
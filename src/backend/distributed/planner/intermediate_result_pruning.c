@@ -14,6 +14,8 @@
 #include "postgres.h"
 
 #include "common/hashfn.h"
+#include "nodes/makefuncs.h"
+#include "parser/parsetree.h"
 #include "utils/builtins.h"
 
 #include "distributed/citus_custom_scan.h"
@@ -22,12 +24,21 @@
 #include "distributed/listutils.h"
 #include "distributed/log_utils.h"
 #include "distributed/metadata_cache.h"
+#include "distributed/multi_join_order.h"
+#include "distributed/multi_logical_planner.h"
 #include "distributed/query_utils.h"
+#include "distributed/recursive_planning.h"
 #include "distributed/worker_manager.h"
 
 /* controlled via GUC, used mostly for testing */
 bool LogIntermediateResults = false;
 
+/* controlled via GUC, whether to skip tasks based on the results of subplans */
+bool EnableSubPlanTaskPruning = false;
+
+/* controlled via GUC, whether nodes only receive the rows of results they need */
+bool EnableSubPlanResultSlicing = false;
+
 
 static List * FindSubPlansUsedInNode(Node *node, SubPlanAccessType accessType);
 static void AppendAllAccessedWorkerNodes(IntermediateResultsHashEntry *entry,
@@ -38,6 +49,18 @@ static List * FindAllRemoteWorkerNodesUsingSubplan(IntermediateResultsHashEntry
 static List * RemoveLocalNodeFromWorkerList(List *workerNodeList);
 static void LogIntermediateResultMulticastSummary(IntermediateResultsHashEntry *entry,
 												  List *workerNodeList);
+static char * SubPlanRestrictingDistributionColumn(Node *qual, Query *query,
+												   Oid *relationId,
+												   AttrNumber *attributeNumber);
+static char * SubPlanJoinedWithDistributionColumn(Node *qual, Query *query,
+												  List *innerRangeTableIndexList,
+												  Oid *relationId,
+												  AttrNumber *attributeNumber);
+static Oid HashDistributionColumnRelation(Var *column, Query *query);
+static char * IntermediateResultQueryColumn(Query *subquery, AttrNumber resultNumber,
+											AttrNumber *attributeNumber);
+static void CollectInnerJoinedRangeTables(Node *node, List **rangeTableIndexList,
+										  List **qualList);
 
 
 /*
@@ -91,6 +114,371 @@ FindSubPlanUsages(DistributedPlan *plan)
 }
 
 
+/*
+ * MarkSubPlansForTaskPruning finds the subplans whose results restrict the
+ * distribution column of a hash distributed table via a top-level
+ * "<column> IN (<subquery>)" filter of the given query, and records the table
+ * in the subplans. When the subplans are executed, we then find the shards
+ * that the rows of the intermediate results hash to, and skip the tasks on
+ * the other shards, which cannot return any rows.
+ */
+void
+MarkSubPlansForTaskPruning(DistributedPlan *distributedPlan, uint64 planId,
+						   Query *query)
+{
+	Job *workerJob = distributedPlan->workerJob;
+
+	if (!EnableSubPlanTaskPruning || query->commandType != CMD_SELECT ||
+		query->jointree == NULL || workerJob == NULL)
+	{
+		return;
+	}
+
+	/* repartition joins do not map tasks to the shards of the tables */
+	if (workerJob->dependentJobList != NIL || list_length(workerJob->taskList) < 2)
+	{
+		return;
+	}
+
+	List *qualList = make_ands_implicit((Expr *) query->jointree->quals);
+
+	Node *qual = NULL;
+	foreach_ptr(qual, qualList)
+	{
+		Oid relationId = InvalidOid;
+		AttrNumber attributeNumber = InvalidAttrNumber;
+		char *resultId = SubPlanRestrictingDistributionColumn(qual, query,
+															  &relationId,
+															  &attributeNumber);
+		if (resultId == NULL)
+		{
+			continue;
+		}
+
+		DistributedSubPlan *subPlan = NULL;
+		foreach_ptr(subPlan, distributedPlan->subPlanList)
+		{
+			if (strcmp(SubPlanResultId(planId, subPlan), resultId) == 0)
+			{
+				subPlan->taskPruningRelationId = relationId;
+			}
+		}
+	}
+}
+
+
+/*
+ * MarkSubPlansForResultSlicing finds the subplans whose results restrict the
+ * distribution column of a hash distributed table in the given query, either
+ * via a "<column> IN (<subquery>)" filter or via an equality with a column of
+ * a subquery or CTE that is inner joined with the table, and records the table
+ * and the column of the result in the subplans. When the subplans are
+ * executed, each node then only receives the rows of the result that hash to
+ * the shards that its tasks access, since the other rows cannot match.
+ */
+void
+MarkSubPlansForResultSlicing(DistributedPlan *distributedPlan, uint64 planId,
+							 Query *query)
+{
+	Job *workerJob = distributedPlan->workerJob;
+	List *innerRangeTableIndexList = NIL;
+	List *qualList = NIL;
+
+	if (!EnableSubPlanResultSlicing || query->commandType != CMD_SELECT ||
+		query->jointree == NULL || workerJob == NULL)
+	{
+		return;
+	}
+
+	/* repartition joins do not map tasks to the shards of the tables */
+	if (workerJob->dependentJobList != NIL || list_length(workerJob->taskList) < 2)
+	{
+		return;
+	}
+
+	CollectInnerJoinedRangeTables((Node *) query->jointree, &innerRangeTableIndexList,
+								  &qualList);
+
+	Node *qual = NULL;
+	foreach_ptr(qual, qualList)
+	{
+		Oid relationId = InvalidOid;
+		AttrNumber attributeNumber = InvalidAttrNumber;
+		char *resultId = SubPlanRestrictingDistributionColumn(qual, query,
+															  &relationId,
+															  &attributeNumber);
+		if (resultId == NULL)
+		{
+			resultId = SubPlanJoinedWithDistributionColumn(qual, query,
+														   innerRangeTableIndexList,
+														   &relationId,
+														   &attributeNumber);
+		}
+
+		if (resultId == NULL)
+		{
+			continue;
+		}
+
+		DistributedSubPlan *subPlan = NULL;
+		foreach_ptr(subPlan, distributedPlan->subPlanList)
+		{
+			if (strcmp(SubPlanResultId(planId, subPlan), resultId) == 0 &&
+				!OidIsValid(subPlan->resultSlicingRelationId))
+			{
+				subPlan->resultSlicingRelationId = relationId;
+				subPlan->resultSlicingAttributeNumber = attributeNumber;
+			}
+		}
+	}
+}
+
+
+/*
+ * CollectInnerJoinedRangeTables appends the range table indexes of the
+ * relations in the given join tree that are only inner joined to
+ * rangeTableIndexList, and the quals of those joins to qualList.
+ */
+static void
+CollectInnerJoinedRangeTables(Node *node, List **rangeTableIndexList, List **qualList)
+{
+	if (node == NULL)
+	{
+		return;
+	}
+
+	if (IsA(node, RangeTblRef))
+	{
+		RangeTblRef *rangeTableRef = (RangeTblRef *) node;
+
+		*rangeTableIndexList = lappend_int(*rangeTableIndexList, rangeTableRef->rtindex);
+	}
+	else if (IsA(node, FromExpr))
+	{
+		FromExpr *fromExpr = (FromExpr *) node;
+
+		Node *fromNode = NULL;
+		foreach_ptr(fromNode, fromExpr->fromlist)
+		{
+			CollectInnerJoinedRangeTables(fromNode, rangeTableIndexList, qualList);
+		}
+
+		*qualList = list_concat(*qualList, make_ands_implicit((Expr *) fromExpr->quals));
+	}
+	else if (IsA(node, JoinExpr))
+	{
+		JoinExpr *joinExpr = (JoinExpr *) node;
+
+		if (joinExpr->jointype != JOIN_INNER)
+		{
+			return;
+		}
+
+		CollectInnerJoinedRangeTables(joinExpr->larg, rangeTableIndexList, qualList);
+		CollectInnerJoinedRangeTables(joinExpr->rarg, rangeTableIndexList, qualList);
+
+		*qualList = list_concat(*qualList, make_ands_implicit((Expr *) joinExpr->quals));
+	}
+}
+
+
+/*
+ * SubPlanJoinedWithDistributionColumn returns the ID of the intermediate
+ * result if the given filter is of the form "<column> = <result column>",
+ * where the column is the distribution column of a hash distributed table
+ * and the result column belongs to a subquery that only reads an intermediate
+ * result, and both are inner joined in the query. It also sets relationId to
+ * the table and attributeNumber to the column of the intermediate result.
+ * Otherwise, the function returns NULL.
+ */
+static char *
+SubPlanJoinedWithDistributionColumn(Node *qual, Query *query,
+									List *innerRangeTableIndexList, Oid *relationId,
+									AttrNumber *attributeNumber)
+{
+	if (!IsA(qual, OpExpr))
+	{
+		return NULL;
+	}
+
+	OpExpr *opExpr = (OpExpr *) qual;
+	if (list_length(opExpr->args) != 2 || !IsA(linitial(opExpr->args), Var) ||
+		!IsA(lsecond(opExpr->args), Var) || !OperatorImplementsEquality(opExpr->opno))
+	{
+		return NULL;
+	}
+
+	for (int columnIndex = 0; columnIndex < 2; columnIndex++)
+	{
+		Var *column = (Var *) list_nth(opExpr->args, columnIndex);
+		Var *resultColumn = (Var *) list_nth(opExpr->args, 1 - columnIndex);
+
+		/* the result rows should be hashed the same way as the column values */
+		if (column->varlevelsup != 0 || resultColumn->varlevelsup != 0 ||
+			resultColumn->vartype != column->vartype ||
+			opExpr->inputcollid != column->varcollid ||
+			!list_member_int(innerRangeTableIndexList, column->varno) ||
+			!list_member_int(innerRangeTableIndexList, resultColumn->varno))
+		{
+			continue;
+		}
+
+		Oid columnRelationId = HashDistributionColumnRelation(column, query);
+		if (!OidIsValid(columnRelationId))
+		{
+			continue;
+		}
+
+		RangeTblEntry *resultEntry = rt_fetch(resultColumn->varno, query->rtable);
+		if (resultEntry->rtekind != RTE_SUBQUERY)
+		{
+			continue;
+		}
+
+		char *resultId = IntermediateResultQueryColumn(resultEntry->subquery,
+													   resultColumn->varattno,
+													   attributeNumber);
+		if (resultId != NULL)
+		{
+			*relationId = columnRelationId;
+			return resultId;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * HashDistributionColumnRelation returns the hash distributed table of which
+ * the given column of the query is the distribution column, or InvalidOid.
+ */
+static Oid
+HashDistributionColumnRelation(Var *column, Query *query)
+{
+	RangeTblEntry *rangeTableEntry = rt_fetch(column->varno, query->rtable);
+	if (rangeTableEntry->rtekind != RTE_RELATION ||
+		!IsCitusTableType(rangeTableEntry->relid, HASH_DISTRIBUTED))
+	{
+		return InvalidOid;
+	}
+
+	Var *partitionColumn = DistPartitionKey(rangeTableEntry->relid);
+	if (partitionColumn == NULL || partitionColumn->varattno != column->varattno)
+	{
+		return InvalidOid;
+	}
+
+	return rangeTableEntry->relid;
+}
+
+
+/*
+ * IntermediateResultQueryColumn returns the ID of the intermediate result if
+ * the given subquery, which recursive planning built, returns the rows of the
+ * intermediate result as they are, and sets attributeNumber to the column of
+ * the result that the subquery returns as its resultNumber-th column.
+ * Otherwise, the function returns NULL.
+ */
+static char *
+IntermediateResultQueryColumn(Query *subquery, AttrNumber resultNumber,
+							  AttrNumber *attributeNumber)
+{
+	if (list_length(subquery->rtable) != 1 || subquery->hasAggs ||
+		subquery->hasWindowFuncs || subquery->hasTargetSRFs ||
+		subquery->groupClause != NIL || subquery->distinctClause != NIL ||
+		subquery->limitCount != NULL || subquery->limitOffset != NULL ||
+		subquery->setOperations != NULL)
+	{
+		return NULL;
+	}
+
+	RangeTblEntry *resultEntry = (RangeTblEntry *) linitial(subquery->rtable);
+	if (resultEntry->rtekind != RTE_FUNCTION)
+	{
+		return NULL;
+	}
+
+	TargetEntry *targetEntry = get_tle_by_resno(subquery->targetList, resultNumber);
+	if (targetEntry == NULL || !IsA(targetEntry->expr, Var))
+	{
+		return NULL;
+	}
+
+	Var *resultColumn = (Var *) targetEntry->expr;
+	if (resultColumn->varno != 1 || resultColumn->varlevelsup != 0)
+	{
+		return NULL;
+	}
+
+	*attributeNumber = resultColumn->varattno;
+
+	return FindIntermediateResultIdIfExists(resultEntry);
+}
+
+
+/*
+ * SubPlanRestrictingDistributionColumn returns the ID of the intermediate
+ * result if the given filter is of the form "<column> IN (<intermediate
+ * result>)", where the column is the distribution column of a hash
+ * distributed table in the query. It also sets relationId to the table and
+ * attributeNumber to the column of the result that the filter compares with.
+ * Otherwise, the function returns NULL.
+ */
+static char *
+SubPlanRestrictingDistributionColumn(Node *qual, Query *query, Oid *relationId,
+									 AttrNumber *attributeNumber)
+{
+	if (!IsA(qual, SubLink))
+	{
+		return NULL;
+	}
+
+	SubLink *sublink = (SubLink *) qual;
+	if (sublink->subLinkType != ANY_SUBLINK || !IsA(sublink->testexpr, OpExpr))
+	{
+		return NULL;
+	}
+
+	OpExpr *opExpr = (OpExpr *) sublink->testexpr;
+	if (list_length(opExpr->args) != 2 || !IsA(linitial(opExpr->args), Var) ||
+		!IsA(lsecond(opExpr->args), Param))
+	{
+		return NULL;
+	}
+
+	Var *column = (Var *) linitial(opExpr->args);
+	Param *param = (Param *) lsecond(opExpr->args);
+
+	/* the result rows should be hashed the same way as the column values */
+	if (column->varlevelsup != 0 || param->paramkind != PARAM_SUBLINK ||
+		param->paramtype != column->vartype ||
+		opExpr->inputcollid != column->varcollid ||
+		!OperatorImplementsEquality(opExpr->opno))
+	{
+		return NULL;
+	}
+
+	Oid columnRelationId = HashDistributionColumnRelation(column, query);
+	if (!OidIsValid(columnRelationId))
+	{
+		return NULL;
+	}
+
+	/* recursive planning replaced the subquery with an intermediate result */
+	Query *subquery = (Query *) sublink->subselect;
+	char *resultId = IntermediateResultQueryColumn(subquery, 1, attributeNumber);
+	if (resultId == NULL)
+	{
+		return NULL;
+	}
+
+	*relationId = columnRelationId;
+
+	return resultId;
+}
+
+
 /*
  * FindSubPlansUsedInPlan finds all the subplans used by the plan by traversing
  * the input node.
@@ -166,6 +554,11 @@ RecordSubplanExecutionsOnNodes(HTAB *intermediateResultsHash,
 		IntermediateResultsHashEntry *entry = SearchIntermediateResult(
 			intermediateResultsHash, resultId);
 
+		if (usedPlan->accessType != SUBPLAN_ACCESS_LOCAL)
+		{
+			entry->remoteAccessCount++;
+		}
+
 		/*
 		 * There is no need to traverse the subplan if the intermediate result
 		 * will be written to a local file and sent to all nodes. Note that the
@@ -448,6 +841,7 @@ SearchIntermediateResult(HTAB *intermediateResultsHash, char *resultId)
 	{
 		entry->nodeIdList = NIL;
 		entry->writeLocalFile = false;
+		entry->remoteAccessCount = 0;
 	}
 
 	return entry;
@@ -44,6 +44,7 @@
  * `prefer-local`: prefer converting local tables if there is
  * `prefer-distributed`: prefer converting distributed tables if there is
  * `auto`: use the above mechanism to decide (constant equality on unique column)
+ * `cost-based`: convert the side that moves fewer bytes, see CostBasedConversionChoice
  *
  * `auto` mode is the default.
  *
@@ -73,6 +74,7 @@
 
 #include "funcapi.h"
 
+#include "access/htup_details.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_index.h"
 #include "catalog/pg_type.h"
@@ -85,6 +87,7 @@
 #include "nodes/primnodes.h"
 #include "optimizer/clauses.h"
 #include "optimizer/optimizer.h"
+#include "optimizer/plancat.h"
 #include "optimizer/planner.h"
 #include "optimizer/prep.h"
 #include "parser/parse_relation.h"
@@ -116,7 +119,9 @@
 #include "distributed/recursive_planning.h"
 #include "distributed/relation_restriction_equivalence.h"
 #include "distributed/shard_pruning.h"
+#include "distributed/shard_size_cache.h"
 #include "distributed/version_compat.h"
+#include "distributed/worker_manager.h"
 
 #define INVALID_RTE_IDENTITY -1
 
@@ -135,6 +140,10 @@ typedef struct RangeTableEntryDetails
 	RangeTblEntry *rangeTableEntry;
 	List *requiredAttributeNumbers;
 	bool hasConstantFilterOnUniqueColumn;
+
+	/* estimated bytes that converting the table to a subquery moves */
+	bool hasSizeEstimate;
+	double estimatedBytes;
 #if PG_VERSION_NUM >= PG_VERSION_16
 	RTEPermissionInfo *perminfo;
 #endif
@@ -193,6 +202,15 @@ static void ConvertRTEsToSubquery(List *rangeTableEntryDetailsList,
 static int ResultRTEIdentity(Query *query);
 static List * RTEListToConvert(ConversionCandidates *conversionCandidates,
 							   ConversionChoice conversionChoice);
+static bool CostBasedConversionChoice(ConversionCandidates *conversionCandidates,
+									  ConversionChoice *conversionChoice);
+static bool EstimateConversionBytes(RangeTblEntry *rangeTableEntry,
+									RelationRestriction *relationRestriction,
+									bool hasConstantFilterOnUniqueColumn,
+									double *estimatedBytes);
+static bool EstimateCitusTableRowCount(Oid relationId,
+									   RelationRestriction *relationRestriction,
+									   double *rowCount);
 
 
 /*
@@ -278,6 +296,7 @@ GetConversionChoice(ConversionCandidates *conversionCandidates,
 {
 	RangeTableEntryDetails *localRTECandidate = NULL;
 	RangeTableEntryDetails *distributedRTECandidate = NULL;
+	ConversionChoice costBasedChoice = CONVERT_LOCAL_TABLES;
 
 	if (list_length(conversionCandidates->localTableList) > 0)
 	{
@@ -297,9 +316,17 @@ GetConversionChoice(ConversionCandidates *conversionCandidates,
 		return distributedRTECandidate ? CONVERT_DISTRIBUTED_TABLES :
 			   CONVERT_LOCAL_TABLES;
 	}
+	else if (LocalTableJoinPolicy == LOCAL_JOIN_POLICY_COST_BASED &&
+			 localRTECandidate != NULL && distributedRTECandidate != NULL &&
+			 CostBasedConversionChoice(conversionCandidates, &costBasedChoice))
+	{
+		return costBasedChoice;
+	}
 	else
 	{
 		/*
+		 * In cost-based mode, we get here when the size of a table is unknown.
+		 *
 		 * We want to convert distributed tables only if all the distributed tables
 		 * have a constant filter on a unique index, otherwise we would be redundantly
 		 * converting a distributed table as we will convert all the other local tables.
@@ -320,6 +347,151 @@ GetConversionChoice(ConversionCandidates *conversionCandidates,
 }
 
 
+/*
+ * CostBasedConversionChoice sets conversionChoice to the tables whose
+ * conversion to subqueries moves fewer bytes and returns true, or returns
+ * false if the size of any of the tables is unknown. The filtered rows of
+ * converted distributed tables are moved to the coordinator once, whereas
+ * the filtered rows of converted local tables are moved to every node that
+ * the distributed query runs on.
+ */
+static bool
+CostBasedConversionChoice(ConversionCandidates *conversionCandidates,
+						  ConversionChoice *conversionChoice)
+{
+	double localTableBytes = 0;
+	double distributedTableBytes = 0;
+	bool hasDistributedTable = false;
+
+	RangeTableEntryDetails *rangeTableEntryDetails = NULL;
+	foreach_ptr(rangeTableEntryDetails, conversionCandidates->localTableList)
+	{
+		if (!rangeTableEntryDetails->hasSizeEstimate)
+		{
+			return false;
+		}
+
+		localTableBytes += rangeTableEntryDetails->estimatedBytes;
+	}
+
+	foreach_ptr(rangeTableEntryDetails, conversionCandidates->distributedTableList)
+	{
+		if (!rangeTableEntryDetails->hasSizeEstimate)
+		{
+			return false;
+		}
+
+		distributedTableBytes += rangeTableEntryDetails->estimatedBytes;
+
+		if (IsCitusTableType(rangeTableEntryDetails->rangeTableEntry->relid,
+							 DISTRIBUTED_TABLE))
+		{
+			hasDistributedTable = true;
+		}
+	}
+
+	/* a query on reference tables only runs on a single node */
+	uint32 targetNodeCount = hasDistributedTable ? Max(ActiveReadableNodeCount(), 1) : 1;
+	double movedLocalTableBytes = localTableBytes * targetNodeCount;
+
+	ereport(DEBUG2, (errmsg("converting local tables moves %.0f bytes, converting "
+							"distributed tables moves %.0f bytes",
+							movedLocalTableBytes, distributedTableBytes)));
+
+	*conversionChoice = movedLocalTableBytes <= distributedTableBytes ?
+						CONVERT_LOCAL_TABLES : CONVERT_DISTRIBUTED_TABLES;
+
+	return true;
+}
+
+
+/*
+ * EstimateConversionBytes estimates the bytes of the filtered rows of the
+ * required columns of the given table, which converting it to a subquery
+ * moves, and returns whether it could be estimated.
+ */
+static bool
+EstimateConversionBytes(RangeTblEntry *rangeTableEntry,
+						RelationRestriction *relationRestriction,
+						bool hasConstantFilterOnUniqueColumn, double *estimatedBytes)
+{
+	if (relationRestriction == NULL)
+	{
+		return false;
+	}
+
+	RelOptInfo *relOptInfo = relationRestriction->relOptInfo;
+	double rowWidth = Max(relOptInfo->reltarget->width, 1);
+	double rowCount = 0;
+
+	if (hasConstantFilterOnUniqueColumn)
+	{
+		rowCount = 1;
+	}
+	else if (!IsCitusTable(rangeTableEntry->relid) || relOptInfo->tuples > 0)
+	{
+		/* local tables, and Citus tables that have distributed statistics */
+		rowCount = relOptInfo->rows;
+	}
+	else if (!EstimateCitusTableRowCount(rangeTableEntry->relid, relationRestriction,
+										 &rowCount))
+	{
+		return false;
+	}
+
+	*estimatedBytes = rowCount * rowWidth;
+
+	return true;
+}
+
+
+/*
+ * EstimateCitusTableRowCount estimates the number of filtered rows of the
+ * given Citus table from the cached sizes of its shards. It returns false if
+ * the shard size cache does not hold a recent size of all its shards.
+ */
+static bool
+EstimateCitusTableRowCount(Oid relationId, RelationRestriction *relationRestriction,
+						   double *rowCount)
+{
+	CitusTableCacheEntry *cacheEntry = GetCitusTableCacheEntry(relationId);
+	uint64 tableSize = 0;
+
+	for (int shardIndex = 0; shardIndex < cacheEntry->shardIntervalArrayLength;
+		 shardIndex++)
+	{
+		ShardInterval *shardInterval = cacheEntry->sortedShardIntervalArray[shardIndex];
+		bool missingOk = true;
+		uint64 shardSize = 0;
+
+		/* a single placement of each shard is read */
+		ShardPlacement *shardPlacement =
+			ActiveShardPlacement(shardInterval->shardId, missingOk);
+		if (shardPlacement == NULL ||
+			!GetCachedShardSize(shardInterval, shardPlacement->groupId, TABLE_SIZE,
+								&shardSize))
+		{
+			return false;
+		}
+
+		tableSize += shardSize;
+	}
+
+	/* estimate the number of rows like the planner does for tables with no stats */
+	int32 tupleWidth = get_relation_data_width(relationId, NULL);
+	tupleWidth += MAXALIGN(SizeofHeapTupleHeader) + sizeof(ItemIdData);
+
+	Selectivity selectivity =
+		clauselist_selectivity(relationRestriction->plannerInfo,
+							   relationRestriction->relOptInfo->baserestrictinfo,
+							   0, JOIN_INNER, NULL);
+
+	*rowCount = clamp_row_est(((double) tableSize / tupleWidth) * selectivity);
+
+	return true;
+}
+
+
 /*
  * ConvertRTEsToSubquery converts all the given range table entries
  * to a subquery.
@@ -581,6 +753,17 @@ CreateConversionCandidates(PlannerRestrictionContext *plannerRestrictionContext,
 			RequiredAttrNumbersForRelation(rangeTableEntry, plannerRestrictionContext);
 		rangeTableEntryDetails->hasConstantFilterOnUniqueColumn =
 			HasConstantFilterOnUniqueColumn(rangeTableEntry, relationRestriction);
+
+		if (LocalTableJoinPolicy == LOCAL_JOIN_POLICY_COST_BASED)
+		{
+			bool hasConstantFilterOnUniqueColumn =
+				rangeTableEntryDetails->hasConstantFilterOnUniqueColumn;
+
+			rangeTableEntryDetails->hasSizeEstimate =
+				EstimateConversionBytes(rangeTableEntry, relationRestriction,
+										hasConstantFilterOnUniqueColumn,
+										&rangeTableEntryDetails->estimatedBytes);
+		}
 #if PG_VERSION_NUM >= PG_VERSION_16
 		rangeTableEntryDetails->perminfo = NULL;
 		if (rangeTableEntry->perminfoindex)
@@ -9,8 +9,13 @@
  */
 #include "postgres.h"
 
+#include "access/table.h"
+#include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/optimizer.h"
+#include "parser/parse_relation.h"
+#include "storage/lmgr.h"
+#include "utils/rel.h"
 
 #include "pg_version_constants.h"
 
@@ -22,20 +27,86 @@
 #include "distributed/local_plan_cache.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/multi_executor.h"
+#include "distributed/query_utils.h"
+#include "distributed/shard_utils.h"
 #include "distributed/version_compat.h"
 
 
+/*
+ * LocalShardReplacement is a relation RTE in a query that is to be replaced
+ * with the shard of the relation on the local node.
+ */
+typedef struct LocalShardReplacement
+{
+	Query *query;
+	RangeTblEntry *rangeTableEntry;
+	Oid shardRelationId;
+} LocalShardReplacement;
+
+
+/*
+ * LocalShardReplacementContext is used to find the relation RTEs that
+ * ReplaceRelationsWithLocalShards replaces.
+ */
+typedef struct LocalShardReplacementContext
+{
+	List *relationShardList;
+	LOCKMODE lockMode;
+	List *replacementList;
+} LocalShardReplacementContext;
+
+
+static bool IsLocalPlanCachingSupportedForTask(Task *task, Job *currentJob);
 static Query * GetLocalShardQueryForCache(Query *jobQuery, Task *task,
 										  ParamListInfo paramListInfo);
+static bool ReplaceRelationsWithLocalShards(Query *query, List *relationShardList);
+static bool FindLocalShardReplacementsWalker(Node *node,
+											 LocalShardReplacementContext *context);
+static bool ShardHasSameColumns(Oid relationId, Oid shardRelationId);
 static char * DeparseLocalShardQuery(Query *jobQuery, List *relationShardList,
 									 Oid anchorDistributedTableId, int64 anchorShardId);
 static int ExtractParameterTypesForParamListInfo(ParamListInfo originalParamListInfo,
 												 Oid **parameterTypes);
 
 /*
- * CacheLocalPlanForShardQuery replaces the relation OIDs in the job query
- * with shard relation OIDs and then plans the query and caches the result
- * in the originalDistributedPlan (which may be preserved across executions).
+ * CacheLocalPlansForJob caches a local plan for each of the tasks of the job
+ * that are going to be executed locally, if local plan caching is supported
+ * for the job. During execution, we get the plans from the cache.
+ *
+ * The plans are cached across executions when originalDistributedPlan
+ * represents a prepared statement.
+ */
+void
+CacheLocalPlansForJob(Job *currentJob, DistributedPlan *originalDistributedPlan,
+					  ParamListInfo paramListInfo)
+{
+	if (!IsLocalPlanCachingSupported(currentJob, originalDistributedPlan))
+	{
+		return;
+	}
+
+	Task *task = NULL;
+	foreach_ptr(task, currentJob->taskList)
+	{
+		if (!TaskAccessesLocalNode(task) ||
+			!IsLocalPlanCachingSupportedForTask(task, currentJob))
+		{
+			continue;
+		}
+
+		CacheLocalPlanForShardQuery(task, originalDistributedPlan, paramListInfo);
+	}
+}
+
+
+/*
+ * CacheLocalPlanForShardQuery plans the query of the task on the local shards
+ * and caches the result in the originalDistributedPlan (which may be preserved
+ * across executions).
+ *
+ * When the shard pruning is deferred to the execution, the job query has the
+ * distributed tables, which we replace with the local shards. Otherwise, the
+ * query string of the task is the same across executions, and we plan that.
  */
 void
 CacheLocalPlanForShardQuery(Task *task, DistributedPlan *originalDistributedPlan,
@@ -61,32 +132,51 @@ CacheLocalPlanForShardQuery(Task *task, DistributedPlan *originalDistributedPlan
 	MemoryContext oldContext =
 		MemoryContextSwitchTo(GetMemoryChunkContext(originalDistributedPlan));
 
-	/*
-	 * We prefer to use jobQuery (over task->query) because we don't want any
-	 * functions/params to have been evaluated in the cached plan.
-	 */
-	Query *jobQuery = copyObject(originalDistributedPlan->workerJob->jobQuery);
+	Query *localShardQuery = NULL;
+	if (originalDistributedPlan->workerJob->deferredPruning)
+	{
+		/*
+		 * We prefer to use jobQuery (over task->query) because we don't want any
+		 * functions/params to have been evaluated in the cached plan.
+		 */
+		Query *jobQuery = copyObject(originalDistributedPlan->workerJob->jobQuery);
+
+		localShardQuery = GetLocalShardQueryForCache(jobQuery, task, paramListInfo);
+	}
+	else
+	{
+		Oid *parameterTypes = NULL;
+		int numberOfParameters =
+			ExtractParameterTypesForParamListInfo(paramListInfo, &parameterTypes);
 
-	Query *localShardQuery = GetLocalShardQueryForCache(jobQuery, task, paramListInfo);
+		localShardQuery = ParseQueryString(TaskQueryString(task), parameterTypes,
+										   numberOfParameters);
+	}
 
 	LOCKMODE lockMode = GetQueryLockMode(localShardQuery);
 
-	/* fast path queries can only have a single RTE by definition */
-	RangeTblEntry *rangeTableEntry = (RangeTblEntry *) linitial(localShardQuery->rtable);
+	List *rangeTableList = NIL;
+	ExtractRangeTableRelationWalker((Node *) localShardQuery, &rangeTableList);
 
 	/*
 	 * If the shard has been created in this transction, we wouldn't see the relationId
 	 * for it, so do not cache.
 	 */
-	if (rangeTableEntry->relid == InvalidOid)
+	RangeTblEntry *rangeTableEntry = NULL;
+	foreach_ptr(rangeTableEntry, rangeTableList)
 	{
-		pfree(jobQuery);
-		pfree(localShardQuery);
-		MemoryContextSwitchTo(oldContext);
-		return;
+		if (rangeTableEntry->relid == InvalidOid)
+		{
+			pfree(localShardQuery);
+			MemoryContextSwitchTo(oldContext);
+			return;
+		}
 	}
 
-	LockRelationOid(rangeTableEntry->relid, lockMode);
+	foreach_ptr(rangeTableEntry, rangeTableList)
+	{
+		LockRelationOid(rangeTableEntry->relid, lockMode);
+	}
 
 	LocalPlannedStatement *localPlannedStatement = CitusMakeNode(LocalPlannedStatement);
 	localPlan = planner(localShardQuery, NULL, 0, NULL);
@@ -102,24 +192,60 @@ CacheLocalPlanForShardQuery(Task *task, DistributedPlan *originalDistributedPlan
 }
 
 
+/*
+ * IsLocalPlanCachingSupportedForTask returns whether the plan of the given
+ * task, which is going to be executed locally, can be cached.
+ */
+static bool
+IsLocalPlanCachingSupportedForTask(Task *task, Job *currentJob)
+{
+	if (currentJob->deferredPruning)
+	{
+		/* the local shard query is generated from the job query */
+		return true;
+	}
+
+	if (task->dependentTaskList != NIL)
+	{
+		/* the task reads the results of other tasks of this execution */
+		return false;
+	}
+
+	if (task->parametersInQueryStringResolved)
+	{
+		/* the query string of the task changes with the parameters */
+		return false;
+	}
+
+	int taskQueryType = GetTaskQueryType(task);
+	return taskQueryType == TASK_QUERY_TEXT || taskQueryType == TASK_QUERY_OBJECT;
+}
+
+
 /*
  * GetLocalShardQueryForCache is a helper function which generates
  * the local shard query based on the jobQuery. The function should
  * not be used for generic purposes, it is specialized for local cached
  * queries.
  *
- * It is not guaranteed to have consistent attribute numbers on the shards
- * and on the shell (e.g., distributed/reference tables) due to DROP COLUMN
- * commands.
+ * In the common case, we replace the relations in the jobQuery with the
+ * local shards directly.
  *
- * To avoid any edge cases due to such discrepancies, we first deparse the
- * jobQuery with the tables replaced to shards, and parse the query string
- * back. This is normally a very expensive operation, however we only do it
- * once per cached local plan, which is acceptable.
+ * However, it is not guaranteed to have consistent attribute numbers on the
+ * shards and on the shell (e.g., distributed/reference tables) due to DROP
+ * COLUMN commands. To avoid any edge cases due to such discrepancies, we then
+ * deparse the jobQuery with the tables replaced to shards, and parse the query
+ * string back. This is normally a very expensive operation, however we only
+ * do it once per cached local plan, which is acceptable.
  */
 static Query *
 GetLocalShardQueryForCache(Query *jobQuery, Task *task, ParamListInfo orig_paramListInfo)
 {
+	if (ReplaceRelationsWithLocalShards(jobQuery, task->relationShardList))
+	{
+		return jobQuery;
+	}
+
 	char *shardQueryString =
 		DeparseLocalShardQuery(jobQuery, task->relationShardList,
 							   task->anchorDistributedTableId,
@@ -138,6 +264,187 @@ GetLocalShardQueryForCache(Query *jobQuery, Task *task, ParamListInfo orig_param
 }
 
 
+/*
+ * ReplaceRelationsWithLocalShards replaces the Citus tables in the given query
+ * with their shards in the relationShardList, which are on the local node.
+ *
+ * The query is only modified if all the Citus tables can be replaced, and the
+ * function returns whether they were replaced. This is not the case when a
+ * shard does not have the same columns as its table, or when the query refers
+ * to the table in ways other than by its range table entries and its columns.
+ */
+static bool
+ReplaceRelationsWithLocalShards(Query *query, List *relationShardList)
+{
+	if (query->onConflict != NULL)
+	{
+		/* the ON CONFLICT clause may refer to a constraint of the table */
+		return false;
+	}
+
+	LocalShardReplacementContext context = {
+		.relationShardList = relationShardList,
+		.lockMode = GetQueryLockMode(query),
+		.replacementList = NIL
+	};
+
+	if (FindLocalShardReplacementsWalker((Node *) query, &context))
+	{
+		return false;
+	}
+
+	LocalShardReplacement *replacement = NULL;
+	foreach_ptr(replacement, context.replacementList)
+	{
+		RangeTblEntry *rangeTableEntry = replacement->rangeTableEntry;
+
+#if PG_VERSION_NUM >= PG_VERSION_16
+		if (rangeTableEntry->perminfoindex != 0)
+		{
+			RTEPermissionInfo *perminfo =
+				getRTEPermissionInfo(replacement->query->rteperminfos,
+									 rangeTableEntry);
+			perminfo->relid = replacement->shardRelationId;
+		}
+#endif
+
+		rangeTableEntry->relid = replacement->shardRelationId;
+
+		/* the shard is not a Citus table, so it doesn't need an RTE identity */
+		rangeTableEntry->values_lists = NIL;
+	}
+
+	return true;
+}
+
+
+/*
+ * FindLocalShardReplacementsWalker adds the Citus tables in the query tree,
+ * along with their local shards, to the replacementList of the context. The
+ * walker returns true to stop the walk when a table cannot be replaced.
+ */
+static bool
+FindLocalShardReplacementsWalker(Node *node, LocalShardReplacementContext *context)
+{
+	if (node == NULL)
+	{
+		return false;
+	}
+
+	if (IsA(node, Query))
+	{
+		Query *query = (Query *) node;
+
+		RangeTblEntry *rangeTableEntry = NULL;
+		foreach_ptr(rangeTableEntry, query->rtable)
+		{
+			if (rangeTableEntry->rtekind != RTE_RELATION ||
+				!IsCitusTable(rangeTableEntry->relid))
+			{
+				/* leave local tables as is */
+				continue;
+			}
+
+			if (rangeTableEntry->securityQuals != NIL)
+			{
+				/* the row level security policies of the shard apply instead */
+				return true;
+			}
+
+			RelationShard *relationShard = NULL;
+			RelationShard *currentRelationShard = NULL;
+			foreach_ptr(currentRelationShard, context->relationShardList)
+			{
+				if (currentRelationShard->relationId == rangeTableEntry->relid)
+				{
+					relationShard = currentRelationShard;
+					break;
+				}
+			}
+
+			if (relationShard == NULL || relationShard->shardId == INVALID_SHARD_ID)
+			{
+				/* the table is replaced with an empty result when deparsing */
+				return true;
+			}
+
+			Oid shardRelationId = GetTableLocalShardOid(rangeTableEntry->relid,
+														relationShard->shardId);
+			if (!OidIsValid(shardRelationId))
+			{
+				return true;
+			}
+
+			LockRelationOid(shardRelationId, context->lockMode);
+
+			if (!ShardHasSameColumns(rangeTableEntry->relid, shardRelationId))
+			{
+				return true;
+			}
+
+			LocalShardReplacement *replacement = palloc0(sizeof(LocalShardReplacement));
+			replacement->query = query;
+			replacement->rangeTableEntry = rangeTableEntry;
+			replacement->shardRelationId = shardRelationId;
+
+			context->replacementList = lappend(context->replacementList, replacement);
+		}
+
+		return query_tree_walker(query, FindLocalShardReplacementsWalker, context, 0);
+	}
+
+	if (IsA(node, Var) && ((Var *) node)->varattno == InvalidAttrNumber)
+	{
+		/* whole-row references have the row type of the table */
+		return true;
+	}
+
+	return expression_tree_walker(node, FindLocalShardReplacementsWalker, context);
+}
+
+
+/*
+ * ShardHasSameColumns returns whether the shard has the same columns, at the
+ * same attribute numbers, as its table.
+ */
+static bool
+ShardHasSameColumns(Oid relationId, Oid shardRelationId)
+{
+	Relation relation = table_open(relationId, NoLock);
+	Relation shardRelation = table_open(shardRelationId, NoLock);
+
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+	TupleDesc shardTupleDescriptor = RelationGetDescr(shardRelation);
+
+	bool sameColumns = tupleDescriptor->natts == shardTupleDescriptor->natts;
+
+	for (int columnIndex = 0; sameColumns && columnIndex < tupleDescriptor->natts;
+		 columnIndex++)
+	{
+		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+		Form_pg_attribute shardAttributeForm = TupleDescAttr(shardTupleDescriptor,
+															 columnIndex);
+
+		if (attributeForm->attisdropped || shardAttributeForm->attisdropped)
+		{
+			sameColumns = attributeForm->attisdropped &&
+						  shardAttributeForm->attisdropped;
+			continue;
+		}
+
+		sameColumns = attributeForm->atttypid == shardAttributeForm->atttypid &&
+					  attributeForm->atttypmod == shardAttributeForm->atttypmod &&
+					  attributeForm->attcollation == shardAttributeForm->attcollation &&
+					  attributeForm->attgenerated == shardAttributeForm->attgenerated;
+	}
+
+	table_close(shardRelation, NoLock);
+	table_close(relation, NoLock);
+
+	return sameColumns;
+}
+
+
 /*
  * DeparseLocalShardQuery is a helper function to deparse given jobQuery for the shard(s)
  * identified by the relationShardList, anchorDistributedTableId and anchorShardId.
@@ -259,9 +566,12 @@ GetCachedLocalPlan(Task *task, DistributedPlan *distributedPlan)
 
 
 /*
- * IsLocalPlanCachingSupported returns whether (part of) the task can be planned
- * and executed locally and whether caching is supported (single shard, no volatile
- * functions).
+ * IsLocalPlanCachingSupported returns whether (part of) the job can be planned
+ * and executed locally and whether caching is supported.
+ *
+ * When the shard pruning is deferred to the execution, we only cache the plans
+ * of single shard queries without volatile functions. Otherwise, we cache the
+ * plans of the tasks whose query strings don't change across executions.
  */
 bool
 IsLocalPlanCachingSupported(Job *currentJob, DistributedPlan *originalDistributedPlan)
@@ -274,25 +584,51 @@ IsLocalPlanCachingSupported(Job *currentJob, DistributedPlan *originalDistribute
 		return false;
 	}
 
+	if (!EnableLocalExecution)
+	{
+		/* user requested not to use local execution */
+		return false;
+	}
+
+	if (GetCurrentLocalExecutionStatus() == LOCAL_EXECUTION_DISABLED)
+	{
+		/* transaction already connected to localhost */
+		return false;
+	}
+
+	List *taskList = currentJob->taskList;
+
 	if (!currentJob->deferredPruning)
 	{
 		/*
 		 * When not using deferred pruning we may have already replaced distributed
 		 * table RTEs with citus_extradata_container RTEs to pass the shard ID to the
-		 * deparser. In that case, we cannot pass the query tree directly to the
-		 * planner.
-		 *
-		 * If desired, we can relax this check by improving the implementation of
-		 * CacheLocalPlanForShardQuery to translate citus_extradata_container
-		 * to a shard relation OID.
+		 * deparser. Hence, we plan the query strings of the tasks instead of the job
+		 * query, which are generated once for the distributed plan.
 		 */
-		return false;
+		if (currentJob->requiresCoordinatorEvaluation)
+		{
+			/* the query strings are rebuilt after evaluating the functions */
+			return false;
+		}
+
+		if (currentJob->dependentJobList != NIL)
+		{
+			/* the tasks read the results of other jobs of this execution */
+			return false;
+		}
+
+		/* do not bother planning tasks that are going to be executed remotely */
+		return ShouldExecuteTasksLocally(taskList);
 	}
 
-	List *taskList = currentJob->taskList;
 	if (list_length(taskList) != 1)
 	{
-		/* we only support plan caching for single shard queries */
+		/*
+		 * We only support plan caching for single shard queries. Multi-row
+		 * INSERTs may have multiple tasks, whose rows are all in the job
+		 * query.
+		 */
 		return false;
 	}
 
@@ -303,18 +639,6 @@ IsLocalPlanCachingSupported(Job *currentJob, DistributedPlan *originalDistribute
 		return false;
 	}
 
-	if (!EnableLocalExecution)
-	{
-		/* user requested not to use local execution */
-		return false;
-	}
-
-	if (GetCurrentLocalExecutionStatus() == LOCAL_EXECUTION_DISABLED)
-	{
-		/* transaction already connected to localhost */
-		return false;
-	}
-
 	Query *originalJobQuery = originalDistributedPlan->workerJob->jobQuery;
 	if (contain_volatile_functions((Node *) originalJobQuery))
 	{
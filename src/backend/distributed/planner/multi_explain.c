@@ -7,6 +7,8 @@
  *-------------------------------------------------------------------------
  */
 
+#include <math.h>
+
 #include "postgres.h"
 
 #include "fmgr.h"
@@ -45,8 +47,13 @@
 
 #include "pg_version_constants.h"
 
+#if PG_VERSION_NUM >= PG_VERSION_15
+#include "common/pg_prng.h"
+#endif
+
 #include "distributed/citus_depended_object.h"
 #include "distributed/citus_nodefuncs.h"
+#include "distributed/citus_safe_lib.h"
 #include "distributed/combine_query_planner.h"
 #include "distributed/commands/utility_hook.h"
 #include "distributed/connection_management.h"
@@ -66,8 +73,10 @@
 #include "distributed/multi_router_planner.h"
 #include "distributed/multi_server_executor.h"
 #include "distributed/placement_connection.h"
+#include "distributed/planning_times.h"
 #include "distributed/recursive_planning.h"
 #include "distributed/remote_commands.h"
+#include "distributed/task_execution_trace.h"
 #include "distributed/tuple_destination.h"
 #include "distributed/tuplestore.h"
 #include "distributed/version_compat.h"
@@ -77,6 +86,13 @@
 /* Config variables that enable printing distributed query plans */
 bool ExplainDistributedQueries = true;
 bool ExplainAllTasks = false;
+bool ExplainTaskSummary = false;
+
+/* minimum duration in milliseconds of distributed queries whose plans are logged */
+int LogDistributedPlanMinDuration = -1;
+
+/* fraction of distributed queries that are considered for logging their plans */
+double LogDistributedPlanSampleRate = 1.0;
 int ExplainAnalyzeSortMethod = EXPLAIN_ANALYZE_SORT_BY_TIME;
 
 /*
@@ -104,6 +120,32 @@ static ExplainOptions CurrentDistributedQueryExplainOptions = {
 	0, 0, 0, 0, 0, 0, EXPLAIN_FORMAT_TEXT
 };
 
+/* number of tasks shown in the Slowest Tasks of the task summary */
+#define EXPLAIN_SUMMARY_SLOWEST_TASK_COUNT 3
+
+/* EXPLAIN ANALYZE results of a task, as used in the task summary */
+typedef struct TaskSummaryEntry
+{
+	Task *task;
+	const char *nodeName;
+	int nodePort;
+	double executionDuration;
+
+	/* rows received from the task, if its execution trace is valid */
+	bool hasRowCount;
+	uint64 rowCount;
+} TaskSummaryEntry;
+
+/* totals of the tasks that ran on a node, as used in the task summary */
+typedef struct TaskSummaryNodeTotals
+{
+	const char *nodeName;
+	int nodePort;
+	int taskCount;
+	double totalExecutionDuration;
+	uint64 rowCount;
+} TaskSummaryNodeTotals;
+
 /* Result for a single remote EXPLAIN command */
 typedef struct RemoteExplainPlan
 {
@@ -121,7 +163,12 @@ typedef struct ExplainAnalyzeDestination
 	TupleDestination pub;
 	Task *originalTask;
 	TupleDestination *originalTaskDestination;
-	TupleDesc lastSavedExplainAnalyzeTupDesc;
+
+	/* columns of the original query */
+	TupleDesc originalTupDesc;
+
+	/* columns of the original query followed by the EXPLAIN ANALYZE columns */
+	TupleDesc explainAnalyzeTupDesc;
 } ExplainAnalyzeDestination;
 
 
@@ -130,6 +177,15 @@ static void ExplainSubPlans(DistributedPlan *distributedPlan, ExplainState *es);
 static void ExplainJob(CitusScanState *scanState, Job *job, ExplainState *es,
 					   ParamListInfo params);
 static void ExplainMapMergeJob(MapMergeJob *mapMergeJob, ExplainState *es);
+static void ExplainTaskListSummary(List *taskList, ExplainState *es);
+static TaskSummaryNodeTotals * TaskSummaryNodeTotalsFor(List **nodeTotalsList,
+														TaskSummaryEntry *entry);
+static void ExplainSummaryDistribution(const char *qlabel, const char *unit,
+									   double *values, int valueCount,
+									   int ndigits, ExplainState *es);
+static int CompareDoubles(const void *leftElement, const void *rightElement);
+static int CompareTaskSummaryEntriesByDuration(const void *leftElement,
+											   const void *rightElement);
 static void ExplainTaskList(CitusScanState *scanState, List *taskList, ExplainState *es,
 							ParamListInfo params);
 static RemoteExplainPlan * RemoteExplain(Task *task, ExplainState *es, ParamListInfo
@@ -152,8 +208,12 @@ static void ExplainWorkerPlan(PlannedStmt *plannedStmt, DestReceiver *dest,
 							  double *executionDurationMillisec);
 static ExplainFormat ExtractFieldExplainFormat(Datum jsonbDoc, const char *fieldName,
 											   ExplainFormat defaultValue);
+static char * ExplainAnalyzeWorkerQuery(char *queryString, Datum explainOptions,
+									   DestReceiver *dest,
+									   double *executionDurationMillisec);
 static TupleDestination * CreateExplainAnlyzeDestination(Task *task,
-														 TupleDestination *taskDest);
+														 TupleDestination *taskDest,
+														 TupleDesc tupleDesc);
 static void ExplainAnalyzeDestPutTuple(TupleDestination *self, Task *task,
 									   int placementIndex, int queryNumber,
 									   HeapTuple heapTuple, uint64 tupleLibpqSize);
@@ -161,8 +221,6 @@ static TupleDesc ExplainAnalyzeDestTupleDescForQuery(TupleDestination *self, int
 													 queryNumber);
 static char * WrapQueryForExplainAnalyze(const char *queryString, TupleDesc tupleDesc,
 										 ParamListInfo params);
-static char * FetchPlanQueryForExplainAnalyze(const char *queryString,
-											  ParamListInfo params);
 static char * ParameterResolutionSubquery(ParamListInfo params);
 static List * SplitString(const char *str, char delimiter, int maxLength);
 
@@ -173,13 +231,20 @@ static void ExplainOneQuery(Query *query, int cursorOptions,
 							QueryEnvironment *queryEnv);
 static double elapsed_time(instr_time *starttime);
 static void ExplainPropertyBytes(const char *qlabel, int64 bytes, ExplainState *es);
+static void ExplainTaskExecutionTrace(TaskExecutionTrace *trace, ExplainState *es);
 static uint64 TaskReceivedTupleData(Task *task);
+static TaskExecutionTrace * ResetTaskExecutionTrace(Task *task);
+static Task * SlowestTracedTask(List *taskList);
+static double TaskExecutionTraceDuration(TaskExecutionTrace *trace);
 static bool ShowReceivedTupleData(CitusScanState *scanState, ExplainState *es);
+static void ExplainPlanningPhaseTimes(DistributedPlan *distributedPlan,
+									  ExplainState *es);
 
 
 /* exports for SQL callable functions */
 PG_FUNCTION_INFO_V1(worker_last_saved_explain_analyze);
 PG_FUNCTION_INFO_V1(worker_save_query_explain_analyze);
+PG_FUNCTION_INFO_V1(worker_explain_analyze_query);
 
 
 /*
@@ -217,12 +282,51 @@ CitusExplainScan(CustomScanState *node, List *ancestors, struct ExplainState *es
 
 	ExplainJob(scanState, distributedPlan->workerJob, es, params);
 
+	if (es->summary)
+	{
+		ExplainPlanningPhaseTimes(distributedPlan, es);
+	}
+
 	PopActiveSnapshot();
 
 	ExplainCloseGroup("Distributed Query", "Distributed Query", true, es);
 }
 
 
+/*
+ * ExplainPlanningPhaseTimes shows how long each phase of distributed planning
+ * took for the given plan. The times are only recorded in the plan of the
+ * top-level query, we don't show anything for other plans.
+ */
+static void
+ExplainPlanningPhaseTimes(DistributedPlan *distributedPlan, ExplainState *es)
+{
+	bool hasPlanningPhaseTimes = false;
+
+	for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+	{
+		if (distributedPlan->planningPhaseTimes[phase] > 0.0)
+		{
+			hasPlanningPhaseTimes = true;
+			break;
+		}
+	}
+
+	if (!hasPlanningPhaseTimes)
+	{
+		return;
+	}
+
+	for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+	{
+		char *label = psprintf("%s Time", PlanningPhaseName(phase));
+
+		ExplainPropertyFloat(label, "ms", distributedPlan->planningPhaseTimes[phase], 3,
+							 es);
+	}
+}
+
+
 /*
  * NonPushableInsertSelectExplainScan is a custom scan explain callback function
  * which is used to print explain information of a Citus plan for an INSERT INTO
@@ -380,7 +484,7 @@ ExplainSubPlans(DistributedPlan *distributedPlan, ExplainState *es)
 
 		if (es->format == EXPLAIN_FORMAT_TEXT)
 		{
-			char *resultId = GenerateResultId(planId, subPlan->subPlanId);
+			char *resultId = SubPlanResultId(planId, subPlan);
 
 			appendStringInfoSpaces(es->str, es->indent * 2);
 			appendStringInfo(es->str, "->  Distributed Subplan %s\n", resultId);
@@ -519,6 +623,11 @@ ExplainJob(CitusScanState *scanState, Job *job, ExplainState *es,
 		ExplainPropertyText("Tasks Shown", tasksShownText->data, es);
 	}
 
+	if (ExplainTaskSummary && es->analyze && dependentJobCount == 0 && taskCount > 1)
+	{
+		ExplainTaskListSummary(taskList, es);
+	}
+
 	/*
 	 * We cannot fetch EXPLAIN plans for jobs that have dependencies, since the
 	 * intermediate tables have not been created.
@@ -553,6 +662,302 @@ ExplainJob(CitusScanState *scanState, Job *job, ExplainState *es,
 }
 
 
+/*
+ * ExplainTaskListSummary shows the distribution of the execution times and row
+ * counts of the tasks in an EXPLAIN ANALYZE, the totals per node, and the
+ * slowest tasks. It only uses the durations and execution traces that were
+ * collected along with the remote plans, which gives an overview of queries
+ * with many tasks without showing the plan of every task.
+ *
+ * Like the actual times of plan nodes, the times are only shown with TIMING.
+ */
+static void
+ExplainTaskListSummary(List *taskList, ExplainState *es)
+{
+	int taskCount = list_length(taskList);
+	TaskSummaryEntry *entries = palloc0(taskCount * sizeof(TaskSummaryEntry));
+	double *durations = palloc0(taskCount * sizeof(double));
+	double *rowCounts = palloc0(taskCount * sizeof(double));
+	List *nodeTotalsList = NIL;
+	int entryCount = 0;
+	int rowCountCount = 0;
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		/* tasks whose EXPLAIN ANALYZE could not be fetched are left out */
+		if (task->fetchedExplainAnalyzePlan == NULL)
+		{
+			continue;
+		}
+
+		TaskSummaryEntry *entry = &entries[entryCount];
+		TaskExecutionTrace *trace = task->executionTrace;
+
+		entry->task = task;
+		entry->executionDuration = task->fetchedExplainAnalyzeExecutionDuration;
+
+		if (trace != NULL && trace->valid)
+		{
+			entry->nodeName = trace->nodeName;
+			entry->nodePort = trace->nodePort;
+			entry->hasRowCount = true;
+
+			/* the last row received holds the EXPLAIN ANALYZE output */
+			entry->rowCount = trace->rowsReceived > 0 ? trace->rowsReceived - 1 : 0;
+		}
+		else
+		{
+			ShardPlacement *placement =
+				list_nth(task->taskPlacementList,
+						 task->fetchedExplainAnalyzePlacementIndex);
+
+			entry->nodeName = placement->nodeName;
+			entry->nodePort = placement->nodePort;
+		}
+
+		durations[entryCount] = entry->executionDuration;
+
+		if (entry->hasRowCount)
+		{
+			rowCounts[rowCountCount++] = (double) entry->rowCount;
+		}
+
+		TaskSummaryNodeTotals *nodeTotals =
+			TaskSummaryNodeTotalsFor(&nodeTotalsList, entry);
+		nodeTotals->taskCount++;
+		nodeTotals->totalExecutionDuration += entry->executionDuration;
+		nodeTotals->rowCount += entry->rowCount;
+
+		entryCount++;
+	}
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str, "->  Task Summary\n");
+		es->indent += 3;
+	}
+
+	ExplainOpenGroup("Task Summary", "Task Summary", true, es);
+
+	ExplainPropertyInteger("Tasks Analyzed", NULL, entryCount, es);
+
+	if (es->timing)
+	{
+		ExplainSummaryDistribution("Execution Time", "ms", durations, entryCount, 3,
+								   es);
+	}
+
+	ExplainSummaryDistribution("Rows", NULL, rowCounts, rowCountCount, 0, es);
+
+	ExplainOpenGroup("Nodes", "Nodes", false, es);
+
+	TaskSummaryNodeTotals *nodeTotals = NULL;
+	foreach_ptr(nodeTotals, nodeTotalsList)
+	{
+		StringInfo nodeAddress = makeStringInfo();
+		appendStringInfo(nodeAddress, "host=%s port=%d dbname=%s",
+						 nodeTotals->nodeName, nodeTotals->nodePort,
+						 CurrentDatabaseName());
+
+		ExplainOpenGroup("Node", NULL, true, es);
+
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "->  Node: %s\n", nodeAddress->data);
+			es->indent += 3;
+		}
+		else
+		{
+			ExplainPropertyText("Node", nodeAddress->data, es);
+		}
+
+		ExplainPropertyInteger("Tasks", NULL, nodeTotals->taskCount, es);
+		ExplainPropertyInteger("Rows", NULL, nodeTotals->rowCount, es);
+
+		if (es->timing)
+		{
+			ExplainPropertyFloat("Total Execution Time", "ms",
+								 nodeTotals->totalExecutionDuration, 3, es);
+		}
+
+		ExplainCloseGroup("Node", NULL, true, es);
+
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			es->indent -= 3;
+		}
+	}
+
+	ExplainCloseGroup("Nodes", "Nodes", false, es);
+
+	/* the slowest tasks depend on the timings */
+	if (es->timing)
+	{
+		SafeQsort(entries, entryCount, sizeof(TaskSummaryEntry),
+				  CompareTaskSummaryEntriesByDuration);
+
+		ExplainOpenGroup("Slowest Tasks", "Slowest Tasks", false, es);
+
+		for (int entryIndex = 0;
+			 entryIndex < Min(entryCount, EXPLAIN_SUMMARY_SLOWEST_TASK_COUNT);
+			 entryIndex++)
+		{
+			TaskSummaryEntry *entry = &entries[entryIndex];
+
+			ExplainOpenGroup("Slow Task", NULL, true, es);
+
+			if (es->format == EXPLAIN_FORMAT_TEXT)
+			{
+				appendStringInfoSpaces(es->str, es->indent * 2);
+				appendStringInfo(es->str, "->  Slow Task\n");
+				es->indent += 3;
+			}
+
+			ExplainPropertyInteger("Task Id", NULL, entry->task->taskId, es);
+			ExplainPropertyInteger("Shard Id", NULL, entry->task->anchorShardId, es);
+
+			StringInfo nodeAddress = makeStringInfo();
+			appendStringInfo(nodeAddress, "host=%s port=%d dbname=%s",
+							 entry->nodeName, entry->nodePort, CurrentDatabaseName());
+			ExplainPropertyText("Node", nodeAddress->data, es);
+
+			ExplainPropertyFloat("Execution Time", "ms", entry->executionDuration, 3,
+								 es);
+
+			ExplainCloseGroup("Slow Task", NULL, true, es);
+
+			if (es->format == EXPLAIN_FORMAT_TEXT)
+			{
+				es->indent -= 3;
+			}
+		}
+
+		ExplainCloseGroup("Slowest Tasks", "Slowest Tasks", false, es);
+	}
+
+	ExplainCloseGroup("Task Summary", "Task Summary", true, es);
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		es->indent -= 3;
+	}
+}
+
+
+/*
+ * TaskSummaryNodeTotalsFor returns the totals of the node of the given entry
+ * in nodeTotalsList, after adding them if they are not there yet.
+ */
+static TaskSummaryNodeTotals *
+TaskSummaryNodeTotalsFor(List **nodeTotalsList, TaskSummaryEntry *entry)
+{
+	TaskSummaryNodeTotals *nodeTotals = NULL;
+	foreach_ptr(nodeTotals, *nodeTotalsList)
+	{
+		if (strncmp(nodeTotals->nodeName, entry->nodeName, MAX_NODE_LENGTH) == 0 &&
+			nodeTotals->nodePort == entry->nodePort)
+		{
+			return nodeTotals;
+		}
+	}
+
+	nodeTotals = palloc0(sizeof(TaskSummaryNodeTotals));
+	nodeTotals->nodeName = entry->nodeName;
+	nodeTotals->nodePort = entry->nodePort;
+
+	*nodeTotalsList = lappend(*nodeTotalsList, nodeTotals);
+
+	return nodeTotals;
+}
+
+
+/*
+ * ExplainSummaryDistribution shows the minimum, median, 95th percentile and
+ * maximum of the given values, which it sorts. Nothing is shown without
+ * values.
+ */
+static void
+ExplainSummaryDistribution(const char *qlabel, const char *unit, double *values,
+						   int valueCount, int ndigits, ExplainState *es)
+{
+	if (valueCount == 0)
+	{
+		return;
+	}
+
+	StringInfo label = makeStringInfo();
+
+	SafeQsort(values, valueCount, sizeof(double), CompareDoubles);
+
+	/* nearest-rank percentiles */
+	double median = values[(valueCount - 1) / 2];
+	double percentile95 = values[(int) ceil(0.95 * valueCount) - 1];
+
+	appendStringInfo(label, "%s Min", qlabel);
+	ExplainPropertyFloat(label->data, unit, values[0], ndigits, es);
+
+	resetStringInfo(label);
+	appendStringInfo(label, "%s Median", qlabel);
+	ExplainPropertyFloat(label->data, unit, median, ndigits, es);
+
+	resetStringInfo(label);
+	appendStringInfo(label, "%s P95", qlabel);
+	ExplainPropertyFloat(label->data, unit, percentile95, ndigits, es);
+
+	resetStringInfo(label);
+	appendStringInfo(label, "%s Max", qlabel);
+	ExplainPropertyFloat(label->data, unit, values[valueCount - 1], ndigits, es);
+}
+
+
+/*
+ * CompareDoubles is a qsort comparator for sorting doubles in increasing order.
+ */
+static int
+CompareDoubles(const void *leftElement, const void *rightElement)
+{
+	double left = *((const double *) leftElement);
+	double right = *((const double *) rightElement);
+
+	if (left < right)
+	{
+		return -1;
+	}
+	else if (left > right)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/*
+ * CompareTaskSummaryEntriesByDuration is a qsort comparator for sorting task
+ * summary entries by decreasing execution duration, and by task id otherwise.
+ */
+static int
+CompareTaskSummaryEntriesByDuration(const void *leftElement, const void *rightElement)
+{
+	const TaskSummaryEntry *left = (const TaskSummaryEntry *) leftElement;
+	const TaskSummaryEntry *right = (const TaskSummaryEntry *) rightElement;
+
+	if (left->executionDuration > right->executionDuration)
+	{
+		return -1;
+	}
+	else if (left->executionDuration < right->executionDuration)
+	{
+		return 1;
+	}
+
+	return left->task->taskId - right->task->taskId;
+}
+
+
 /*
  * TaskReceivedTupleData returns the amount of data that was received by the
  * coordinator for the task. If it's a RETURNING DML task the value stored in
@@ -877,6 +1282,13 @@ ExplainTask(CitusScanState *scanState, Task *task, int placementIndex,
 							 es);
 	}
 
+	/* like the actual times of plan nodes, the timings depend on TIMING */
+	if (es->analyze && es->verbose && es->timing && task->executionTrace != NULL &&
+		task->executionTrace->valid)
+	{
+		ExplainTaskExecutionTrace(task->executionTrace, es);
+	}
+
 	if (explainOutputList != NIL)
 	{
 		List *taskPlacementList = task->taskPlacementList;
@@ -898,6 +1310,22 @@ ExplainTask(CitusScanState *scanState, Task *task, int placementIndex,
 }
 
 
+/*
+ * ExplainTaskExecutionTrace shows where the time of the remote execution of a
+ * task went, which helps to tell apart slow connections, slow workers and
+ * large results.
+ */
+static void
+ExplainTaskExecutionTrace(TaskExecutionTrace *trace, ExplainState *es)
+{
+	ExplainPropertyFloat("Connection Acquire Time", "ms",
+						 trace->connectionAcquireTime, 3, es);
+	ExplainPropertyFloat("Send Time", "ms", trace->sendTime, 3, es);
+	ExplainPropertyFloat("First Byte Time", "ms", trace->firstByteTime, 3, es);
+	ExplainPropertyFloat("Receive Time", "ms", trace->receiveTime, 3, es);
+}
+
+
 /*
  * ExplainTaskPlacement shows the EXPLAIN output for an individual task placement.
  * It corrects the indentation of the remote explain output to match the local
@@ -1089,9 +1517,100 @@ worker_save_query_explain_analyze(PG_FUNCTION_ARGS)
 
 	text *queryText = PG_GETARG_TEXT_P(0);
 	char *queryString = text_to_cstring(queryText);
+	Datum explainOptions = PG_GETARG_DATUM(1);
 	double executionDurationMillisec = 0.0;
 
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	DestReceiver *tupleStoreDest = CreateTuplestoreDestReceiver();
+	SetTuplestoreDestReceiverParams(tupleStoreDest, tupleStore,
+									CurrentMemoryContext, false, NULL, NULL);
+
+	char *explainOutput = ExplainAnalyzeWorkerQuery(queryString, explainOptions,
+													tupleStoreDest,
+													&executionDurationMillisec);
+
+	/* save EXPLAIN ANALYZE result to be fetched later */
+	MemoryContext oldContext = MemoryContextSwitchTo(TopTransactionContext);
+	FreeSavedExplainPlan();
+
+	SavedExplainPlan = pstrdup(explainOutput);
+	SavedExecutionDurationMillisec = executionDurationMillisec;
+
+	MemoryContextSwitchTo(oldContext);
+
+	PG_RETURN_DATUM(0);
+}
+
+
+/*
+ * worker_explain_analyze_query executes and returns results of query, followed
+ * by a row with its EXPLAIN ANALYZE output and execution duration. The last two
+ * columns of the column definition hold the EXPLAIN ANALYZE output and the
+ * execution duration, which are NULL in the rows of the query. The remaining
+ * columns are NULL in the last row.
+ *
+ * Unlike worker_save_query_explain_analyze, this returns the EXPLAIN ANALYZE
+ * output along with the results, so the coordinator does not need another
+ * round trip to fetch it.
+ */
+Datum
+worker_explain_analyze_query(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	text *queryText = PG_GETARG_TEXT_P(0);
+	char *queryString = text_to_cstring(queryText);
 	Datum explainOptions = PG_GETARG_DATUM(1);
+	double executionDurationMillisec = 0.0;
+
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+
+	int columnCount = tupleDescriptor->natts;
+	if (columnCount < 2)
+	{
+		ereport(ERROR, (errmsg("expected at least 2 output columns in definition of "
+							   "worker_explain_analyze_query, but got %d",
+							   columnCount)));
+	}
+
+	/*
+	 * The rows of the query have fewer columns than the tuple descriptor, the
+	 * missing columns at the end are read as NULL.
+	 */
+	DestReceiver *tupleStoreDest = CreateTuplestoreDestReceiver();
+	SetTuplestoreDestReceiverParams(tupleStoreDest, tupleStore,
+									CurrentMemoryContext, false, NULL, NULL);
+
+	char *explainOutput = ExplainAnalyzeWorkerQuery(queryString, explainOptions,
+													tupleStoreDest,
+													&executionDurationMillisec);
+
+	Datum *columnValues = palloc0(columnCount * sizeof(Datum));
+	bool *columnNulls = palloc0(columnCount * sizeof(bool));
+	memset(columnNulls, true, columnCount * sizeof(bool));
+
+	columnValues[columnCount - 2] = CStringGetTextDatum(explainOutput);
+	columnNulls[columnCount - 2] = false;
+	columnValues[columnCount - 1] = Float8GetDatum(executionDurationMillisec);
+	columnNulls[columnCount - 1] = false;
+
+	tuplestore_putvalues(tupleStore, tupleDescriptor, columnValues, columnNulls);
+
+	PG_RETURN_DATUM(0);
+}
+
+
+/*
+ * ExplainAnalyzeWorkerQuery runs EXPLAIN ANALYZE of the given query with the
+ * given options, sending its results to dest. It returns the EXPLAIN ANALYZE
+ * output, and sets executionDurationMillisec.
+ */
+static char *
+ExplainAnalyzeWorkerQuery(char *queryString, Datum explainOptions, DestReceiver *dest,
+						  double *executionDurationMillisec)
+{
 	ExplainState *es = NewExplainState();
 	es->analyze = true;
 
@@ -1104,12 +1623,6 @@ worker_save_query_explain_analyze(PG_FUNCTION_ARGS)
 	es->timing = ExtractFieldBoolean(explainOptions, "timing", es->timing);
 	es->format = ExtractFieldExplainFormat(explainOptions, "format", es->format);
 
-	TupleDesc tupleDescriptor = NULL;
-	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
-	DestReceiver *tupleStoreDest = CreateTuplestoreDestReceiver();
-	SetTuplestoreDestReceiverParams(tupleStoreDest, tupleStore,
-									CurrentMemoryContext, false, NULL, NULL);
-
 	List *parseTreeList = pg_parse_query(queryString);
 	if (list_length(parseTreeList) != 1)
 	{
@@ -1157,21 +1670,12 @@ worker_save_query_explain_analyze(PG_FUNCTION_ARGS)
 	INSTR_TIME_SUBTRACT(planDuration, planStart);
 
 	/* do the actual EXPLAIN ANALYZE */
-	ExplainWorkerPlan(plan, tupleStoreDest, es, queryString, boundParams, NULL,
-					  &planDuration, &executionDurationMillisec);
+	ExplainWorkerPlan(plan, dest, es, queryString, boundParams, NULL,
+					  &planDuration, executionDurationMillisec);
 
 	ExplainEndOutput(es);
 
-	/* save EXPLAIN ANALYZE result to be fetched later */
-	MemoryContext oldContext = MemoryContextSwitchTo(TopTransactionContext);
-	FreeSavedExplainPlan();
-
-	SavedExplainPlan = pstrdup(es->str->data);
-	SavedExecutionDurationMillisec = executionDurationMillisec;
-
-	MemoryContextSwitchTo(oldContext);
-
-	PG_RETURN_DATUM(0);
+	return es->str->data;
 }
 
 
@@ -1292,23 +1796,34 @@ CitusExplainOneQuery(Query *query, int cursorOptions, IntoClause *into,
 
 /*
  * CreateExplainAnlyzeDestination creates a destination suitable for collecting
- * explain analyze output from workers.
+ * explain analyze output from workers. tupleDesc describes the results of the
+ * original query of the task.
  */
 static TupleDestination *
-CreateExplainAnlyzeDestination(Task *task, TupleDestination *taskDest)
+CreateExplainAnlyzeDestination(Task *task, TupleDestination *taskDest,
+							   TupleDesc tupleDesc)
 {
 	ExplainAnalyzeDestination *tupleDestination = palloc0(
 		sizeof(ExplainAnalyzeDestination));
 	tupleDestination->originalTask = task;
 	tupleDestination->originalTaskDestination = taskDest;
+	tupleDestination->originalTupDesc = tupleDesc;
+
+	int columnCount = tupleDesc->natts;
+	TupleDesc explainAnalyzeTupDesc = CreateTemplateTupleDesc(columnCount + 2);
 
-	TupleDesc lastSavedExplainAnalyzeTupDesc = CreateTemplateTupleDesc(2);
+	for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		TupleDescCopyEntry(explainAnalyzeTupDesc, columnIndex + 1, tupleDesc,
+						   columnIndex + 1);
+	}
 
-	TupleDescInitEntry(lastSavedExplainAnalyzeTupDesc, 1, "explain analyze", TEXTOID, 0,
-					   0);
-	TupleDescInitEntry(lastSavedExplainAnalyzeTupDesc, 2, "duration", FLOAT8OID, 0, 0);
+	TupleDescInitEntry(explainAnalyzeTupDesc, columnCount + 1, "explain analyze",
+					   TEXTOID, -1, 0);
+	TupleDescInitEntry(explainAnalyzeTupDesc, columnCount + 2, "duration",
+					   FLOAT8OID, -1, 0);
 
-	tupleDestination->lastSavedExplainAnalyzeTupDesc = lastSavedExplainAnalyzeTupDesc;
+	tupleDestination->explainAnalyzeTupDesc = explainAnalyzeTupDesc;
 
 	tupleDestination->pub.putTuple = ExplainAnalyzeDestPutTuple;
 	tupleDestination->pub.tupleDescForQuery = ExplainAnalyzeDestTupleDescForQuery;
@@ -1319,7 +1834,9 @@ CreateExplainAnlyzeDestination(Task *task, TupleDestination *taskDest)
 
 /*
  * ExplainAnalyzeDestPutTuple implements TupleDestination->putTuple
- * for ExplainAnalyzeDestination.
+ * for ExplainAnalyzeDestination. It passes on the rows of the original query
+ * without the EXPLAIN ANALYZE columns, and saves the EXPLAIN ANALYZE output
+ * from the last row in the task.
  */
 static void
 ExplainAnalyzeDestPutTuple(TupleDestination *self, Task *task,
@@ -1327,67 +1844,73 @@ ExplainAnalyzeDestPutTuple(TupleDestination *self, Task *task,
 						   HeapTuple heapTuple, uint64 tupleLibpqSize)
 {
 	ExplainAnalyzeDestination *tupleDestination = (ExplainAnalyzeDestination *) self;
-	if (queryNumber == 0)
+	if (queryNumber != 0)
 	{
-		TupleDestination *originalTupDest = tupleDestination->originalTaskDestination;
-		originalTupDest->putTuple(originalTupDest, task, placementIndex, 0, heapTuple,
-								  tupleLibpqSize);
-		tupleDestination->originalTask->totalReceivedTupleData += tupleLibpqSize;
+		ereport(ERROR, (errmsg("cannot get EXPLAIN ANALYZE of multiple queries"),
+						errdetail("while receiving tuples for query %d", queryNumber)));
 	}
-	else if (queryNumber == 1)
-	{
-		bool isNull = false;
-		TupleDesc tupDesc = tupleDestination->lastSavedExplainAnalyzeTupDesc;
-		Datum explainAnalyze = heap_getattr(heapTuple, 1, tupDesc, &isNull);
 
-		if (isNull)
-		{
-			ereport(WARNING, (errmsg(
-								  "received null explain analyze output from worker")));
-			return;
-		}
+	TupleDesc tupDesc = tupleDestination->explainAnalyzeTupDesc;
+	int columnCount = tupleDestination->originalTupDesc->natts;
+	bool isNull = false;
 
-		Datum executionDuration = heap_getattr(heapTuple, 2, tupDesc, &isNull);
+	Datum explainAnalyze = heap_getattr(heapTuple, columnCount + 1, tupDesc, &isNull);
 
-		if (isNull)
-		{
-			ereport(WARNING, (errmsg("received null execution time from worker")));
-			return;
-		}
+	if (isNull)
+	{
+		/* a row of the original query */
+		Datum *columnValues = palloc0((columnCount + 2) * sizeof(Datum));
+		bool *columnNulls = palloc0((columnCount + 2) * sizeof(bool));
 
-		char *fetchedExplainAnalyzePlan = TextDatumGetCString(explainAnalyze);
-		double fetchedExplainAnalyzeExecutionDuration = DatumGetFloat8(executionDuration);
+		heap_deform_tuple(heapTuple, tupDesc, columnValues, columnNulls);
 
-		/*
-		 * Allocate fetchedExplainAnalyzePlan in the same context as the Task, since we are
-		 * currently in execution context and a Task can span multiple executions.
-		 *
-		 * Although we won't reuse the same value in a future execution, but we have
-		 * calls to CheckNodeCopyAndSerialization() which asserts copy functions of the task
-		 * work as expected, which will try to copy this value in a future execution.
-		 *
-		 * Why don't we just allocate this field in executor context and reset it before
-		 * the next execution? Because when an error is raised we can skip pretty much most
-		 * of the meaningful places that we can insert the reset.
-		 *
-		 * TODO: Take all EXPLAIN ANALYZE related fields out of Task and store them in a
-		 * Task to ExplainAnalyzePrivate mapping in multi_explain.c, so we don't need to
-		 * do these hacky memory context management tricks.
-		 */
-		MemoryContext taskContext = GetMemoryChunkContext(tupleDestination->originalTask);
+		HeapTuple originalTuple = heap_form_tuple(tupleDestination->originalTupDesc,
+												  columnValues, columnNulls);
+
+		TupleDestination *originalTupDest = tupleDestination->originalTaskDestination;
+		originalTupDest->putTuple(originalTupDest, task, placementIndex, 0,
+								  originalTuple, tupleLibpqSize);
+		tupleDestination->originalTask->totalReceivedTupleData += tupleLibpqSize;
 
-		tupleDestination->originalTask->fetchedExplainAnalyzePlan =
-			MemoryContextStrdup(taskContext, fetchedExplainAnalyzePlan);
-		tupleDestination->originalTask->fetchedExplainAnalyzePlacementIndex =
-			placementIndex;
-		tupleDestination->originalTask->fetchedExplainAnalyzeExecutionDuration =
-			fetchedExplainAnalyzeExecutionDuration;
+		return;
 	}
-	else
+
+	Datum executionDuration = heap_getattr(heapTuple, columnCount + 2, tupDesc,
+										   &isNull);
+
+	if (isNull)
 	{
-		ereport(ERROR, (errmsg("cannot get EXPLAIN ANALYZE of multiple queries"),
-						errdetail("while receiving tuples for query %d", queryNumber)));
+		ereport(WARNING, (errmsg("received null execution time from worker")));
+		return;
 	}
+
+	char *fetchedExplainAnalyzePlan = TextDatumGetCString(explainAnalyze);
+	double fetchedExplainAnalyzeExecutionDuration = DatumGetFloat8(executionDuration);
+
+	/*
+	 * Allocate fetchedExplainAnalyzePlan in the same context as the Task, since we are
+	 * currently in execution context and a Task can span multiple executions.
+	 *
+	 * Although we won't reuse the same value in a future execution, but we have
+	 * calls to CheckNodeCopyAndSerialization() which asserts copy functions of the task
+	 * work as expected, which will try to copy this value in a future execution.
+	 *
+	 * Why don't we just allocate this field in executor context and reset it before
+	 * the next execution? Because when an error is raised we can skip pretty much most
+	 * of the meaningful places that we can insert the reset.
+	 *
+	 * TODO: Take all EXPLAIN ANALYZE related fields out of Task and store them in a
+	 * Task to ExplainAnalyzePrivate mapping in multi_explain.c, so we don't need to
+	 * do these hacky memory context management tricks.
+	 */
+	MemoryContext taskContext = GetMemoryChunkContext(tupleDestination->originalTask);
+
+	tupleDestination->originalTask->fetchedExplainAnalyzePlan =
+		MemoryContextStrdup(taskContext, fetchedExplainAnalyzePlan);
+	tupleDestination->originalTask->fetchedExplainAnalyzePlacementIndex =
+		placementIndex;
+	tupleDestination->originalTask->fetchedExplainAnalyzeExecutionDuration =
+		fetchedExplainAnalyzeExecutionDuration;
 }
 
 
@@ -1408,6 +1931,11 @@ ResetExplainAnalyzeData(List *taskList)
 		task->totalReceivedTupleData = 0;
 		task->fetchedExplainAnalyzePlacementIndex = 0;
 		task->fetchedExplainAnalyzePlan = NULL;
+
+		if (task->executionTrace != NULL)
+		{
+			task->executionTrace->valid = false;
+		}
 	}
 }
 
@@ -1422,12 +1950,7 @@ ExplainAnalyzeDestTupleDescForQuery(TupleDestination *self, int queryNumber)
 	ExplainAnalyzeDestination *tupleDestination = (ExplainAnalyzeDestination *) self;
 	if (queryNumber == 0)
 	{
-		TupleDestination *originalTupDest = tupleDestination->originalTaskDestination;
-		return originalTupDest->tupleDescForQuery(originalTupDest, 0);
-	}
-	else if (queryNumber == 1)
-	{
-		return tupleDestination->lastSavedExplainAnalyzeTupDesc;
+		return tupleDestination->explainAnalyzeTupDesc;
 	}
 
 	ereport(ERROR, (errmsg("cannot get EXPLAIN ANALYZE of multiple queries"),
@@ -1448,6 +1971,178 @@ RequestedForExplainAnalyze(CitusScanState *node)
 }
 
 
+/*
+ * ResetTaskExecutionTrace makes sure that the task has an execution trace for
+ * the adaptive executor to fill in, and marks it as not filled in yet.
+ *
+ * The trace is allocated in the same context as the task, see the comment in
+ * ExplainAnalyzeDestPutTuple on why.
+ */
+static TaskExecutionTrace *
+ResetTaskExecutionTrace(Task *task)
+{
+	if (task->executionTrace == NULL)
+	{
+		MemoryContext taskContext = GetMemoryChunkContext(task);
+		task->executionTrace =
+			MemoryContextAllocZero(taskContext, sizeof(TaskExecutionTrace));
+	}
+
+	task->executionTrace->valid = false;
+
+	return task->executionTrace;
+}
+
+
+/*
+ * ShouldLogDistributedPlan returns whether the plan of a new distributed
+ * execution should be logged if it takes longer than
+ * citus.log_distributed_plan_min_duration, with a probability of
+ * citus.log_distributed_plan_sample_rate.
+ */
+bool
+ShouldLogDistributedPlan(void)
+{
+	if (LogDistributedPlanMinDuration < 0 || LogDistributedPlanSampleRate <= 0.0)
+	{
+		return false;
+	}
+
+	if (LogDistributedPlanSampleRate >= 1.0)
+	{
+		return true;
+	}
+
+#if PG_VERSION_NUM >= PG_VERSION_15
+	double randomValue = pg_prng_double(&pg_global_prng_state);
+#else
+
+	/* Generate a random double between 0 and 1 */
+	double randomValue = (double) random() / MAX_RANDOM_VALUE;
+#endif
+
+	return randomValue < LogDistributedPlanSampleRate;
+}
+
+
+/*
+ * TraceTasksForDistributedPlanLog makes the adaptive executor trace the
+ * remote executions of the given tasks, such that LogDistributedPlanIfSlow
+ * can find the slowest one.
+ */
+void
+TraceTasksForDistributedPlanLog(List *taskList)
+{
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		ResetTaskExecutionTrace(task);
+	}
+}
+
+
+/*
+ * LogDistributedPlanIfSlow logs the distributed plan of the given scan if its
+ * execution took at least citus.log_distributed_plan_min_duration. Like
+ * auto_explain, it does not run the query again. Only the plan of the slowest
+ * remote task, according to the execution traces, is fetched from the worker
+ * with EXPLAIN, which is why this is only done for slow queries.
+ */
+void
+LogDistributedPlanIfSlow(CitusScanState *scanState, double durationMillisec)
+{
+	Job *workerJob = scanState->distributedPlan->workerJob;
+
+	if (durationMillisec < LogDistributedPlanMinDuration || workerJob == NULL)
+	{
+		return;
+	}
+
+	List *taskList = workerJob->taskList;
+	int taskCount = list_length(taskList);
+	ParamListInfo params = scanState->customScanState.ss.ps.state->es_param_list_info;
+
+	ExplainState *es = NewExplainState();
+	es->format = EXPLAIN_FORMAT_TEXT;
+
+	ExplainPropertyInteger("Task Count", NULL, taskCount, es);
+
+	Task *slowestTask = SlowestTracedTask(taskList);
+	if (slowestTask == NULL)
+	{
+		/* e.g. all tasks were executed locally */
+		ExplainPropertyText("Tasks Shown", "None, no remote task executions", es);
+	}
+	else
+	{
+		StringInfo tasksShownText = makeStringInfo();
+		appendStringInfo(tasksShownText, "Slowest of %d", taskCount);
+
+		ExplainPropertyText("Tasks Shown", tasksShownText->data, es);
+		ExplainPropertyFloat("Slowest Task Time", "ms",
+							 TaskExecutionTraceDuration(slowestTask->executionTrace), 3,
+							 es);
+
+		RemoteExplainPlan *remoteExplain =
+			FetchRemoteExplainFromWorkers(slowestTask, es, params);
+
+		ExplainTask(scanState, slowestTask, remoteExplain->placementIndex,
+					remoteExplain->explainOutputList, es);
+	}
+
+	/* remove the last line break */
+	if (es->str->len > 0 && es->str->data[es->str->len - 1] == '\n')
+	{
+		es->str->data[--es->str->len] = '\0';
+	}
+
+	ereport(LOG, (errmsg("duration: %.3f ms  distributed plan:\n%s",
+						 durationMillisec, es->str->data)));
+}
+
+
+/*
+ * SlowestTracedTask returns the task with the longest remote execution among
+ * the tasks with a valid execution trace, or NULL if there are none.
+ */
+static Task *
+SlowestTracedTask(List *taskList)
+{
+	Task *slowestTask = NULL;
+	double slowestDuration = 0.0;
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		TaskExecutionTrace *trace = task->executionTrace;
+		if (trace == NULL || !trace->valid)
+		{
+			continue;
+		}
+
+		double duration = TaskExecutionTraceDuration(trace);
+		if (slowestTask == NULL || duration > slowestDuration)
+		{
+			slowestTask = task;
+			slowestDuration = duration;
+		}
+	}
+
+	return slowestTask;
+}
+
+
+/*
+ * TaskExecutionTraceDuration returns the time from the task being ready until
+ * its execution finished in milliseconds.
+ */
+static double
+TaskExecutionTraceDuration(TaskExecutionTrace *trace)
+{
+	return trace->connectionAcquireTime + trace->firstByteTime + trace->receiveTime;
+}
+
+
 /*
  * ExplainAnalyzeTaskList returns a task list suitable for explain analyze. After executing
  * these tasks, fetchedExplainAnalyzePlan of originalTaskList should be populated.
@@ -1468,6 +2163,9 @@ ExplainAnalyzeTaskList(List *originalTaskList,
 			ereport(ERROR, (errmsg("cannot get EXPLAIN ANALYZE of multiple queries")));
 		}
 
+		/* the executed copy of the task shares the trace */
+		ResetTaskExecutionTrace(originalTask);
+
 		Task *explainAnalyzeTask = copyObject(originalTask);
 		const char *queryString = TaskQueryString(explainAnalyzeTask);
 		ParamListInfo taskParams = params;
@@ -1483,16 +2181,15 @@ ExplainAnalyzeTaskList(List *originalTaskList,
 
 		char *wrappedQuery = WrapQueryForExplainAnalyze(queryString, tupleDesc,
 														taskParams);
-		char *fetchQuery = FetchPlanQueryForExplainAnalyze(queryString, taskParams);
 
-		SetTaskQueryStringList(explainAnalyzeTask, list_make2(wrappedQuery, fetchQuery));
+		SetTaskQueryString(explainAnalyzeTask, wrappedQuery);
 
 		TupleDestination *originalTaskDest = originalTask->tupleDest ?
 											 originalTask->tupleDest :
 											 defaultTupleDest;
 
 		explainAnalyzeTask->tupleDest =
-			CreateExplainAnlyzeDestination(originalTask, originalTaskDest);
+			CreateExplainAnlyzeDestination(originalTask, originalTaskDest, tupleDesc);
 
 		explainAnalyzeTaskList = lappend(explainAnalyzeTaskList, explainAnalyzeTask);
 	}
@@ -1502,8 +2199,8 @@ ExplainAnalyzeTaskList(List *originalTaskList,
 
 
 /*
- * WrapQueryForExplainAnalyze wraps a query into a worker_save_query_explain_analyze()
- * call so we can fetch its explain analyze after its execution.
+ * WrapQueryForExplainAnalyze wraps a query into a worker_explain_analyze_query()
+ * call, which returns the explain analyze of the query after its results.
  */
 static char *
 WrapQueryForExplainAnalyze(const char *queryString, TupleDesc tupleDesc,
@@ -1534,6 +2231,9 @@ WrapQueryForExplainAnalyze(const char *queryString, TupleDesc tupleDesc,
 		appendStringInfo(columnDef, "dummy_field int");
 	}
 
+	appendStringInfoString(columnDef, ", explain_analyze_output text, "
+									  "execution_duration double precision");
+
 	StringInfo explainOptions = makeStringInfo();
 	appendStringInfo(explainOptions,
 					 "{\"verbose\": %s, \"costs\": %s, \"buffers\": %s, \"wal\": %s, "
@@ -1551,9 +2251,10 @@ WrapQueryForExplainAnalyze(const char *queryString, TupleDesc tupleDesc,
 	/*
 	 * We do not include dummy column if original query didn't return any columns.
 	 * Otherwise, number of columns that original query returned wouldn't match
-	 * number of columns returned by worker_save_query_explain_analyze.
+	 * number of columns in ExplainAnalyzeDestination.
 	 */
-	char *workerSaveQueryFetchCols = (tupleDesc->natts == 0) ? "" : "*";
+	char *workerExplainQueryFetchCols =
+		(tupleDesc->natts == 0) ? "explain_analyze_output, execution_duration" : "*";
 
 	if (params != NULL)
 	{
@@ -1566,8 +2267,8 @@ WrapQueryForExplainAnalyze(const char *queryString, TupleDesc tupleDesc,
 	}
 
 	appendStringInfo(wrappedQuery,
-					 "SELECT %s FROM worker_save_query_explain_analyze(%s, %s) AS (%s)",
-					 workerSaveQueryFetchCols,
+					 "SELECT %s FROM worker_explain_analyze_query(%s, %s) AS (%s)",
+					 workerExplainQueryFetchCols,
 					 quote_literal_cstr(queryString),
 					 quote_literal_cstr(explainOptions->data),
 					 columnDef->data);
@@ -1576,33 +2277,6 @@ WrapQueryForExplainAnalyze(const char *queryString, TupleDesc tupleDesc,
 }
 
 
-/*
- * FetchPlanQueryForExplainAnalyze generates a query to fetch the plan saved
- * by worker_save_query_explain_analyze from the worker.
- */
-static char *
-FetchPlanQueryForExplainAnalyze(const char *queryString, ParamListInfo params)
-{
-	StringInfo fetchQuery = makeStringInfo();
-
-	if (params != NULL)
-	{
-		/*
-		 * Add a dummy CTE to ensure all parameters are referenced, such that their
-		 * types can be resolved.
-		 */
-		appendStringInfo(fetchQuery, "WITH unused AS (%s) ",
-						 ParameterResolutionSubquery(params));
-	}
-
-	appendStringInfoString(fetchQuery,
-						   "SELECT explain_analyze_output, execution_duration "
-						   "FROM worker_last_saved_explain_analyze()");
-
-	return fetchQuery->data;
-}
-
-
 /*
  * ParameterResolutionSubquery generates a subquery that returns all parameters
  * in params with explicit casts to their type names. This can be used in cases
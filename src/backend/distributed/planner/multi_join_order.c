@@ -3,6 +3,9 @@
  * multi_join_order.c
  *
  * Routines for constructing the join order list using a rule-based approach.
+ * When citus.enable_cost_based_join_order is set, the join orders and the
+ * sides of single repartition joins are additionally chosen such that the
+ * estimated amount of repartitioned data is minimal.
  *
  * Copyright (c) Citus Data, Inc.
  *
@@ -41,6 +44,7 @@
 /* Config variables managed via guc.c */
 bool LogMultiJoinOrder = false; /* print join order as a debugging aid */
 bool EnableSingleHashRepartitioning = false;
+bool EnableCostBasedJoinOrder = false;
 
 /* Function pointer type definition for join rule evaluation functions */
 typedef JoinOrderNode *(*RuleEvalFunction) (JoinOrderNode *currentJoinNode,
@@ -61,6 +65,8 @@ static List * BestJoinOrder(List *candidateJoinOrders);
 static List * FewestOfJoinRuleType(List *candidateJoinOrders, JoinRuleType ruleType);
 static uint32 JoinRuleTypeCount(List *joinOrder, JoinRuleType ruleTypeToCount);
 static List * LatestLargeDataTransfer(List *candidateJoinOrders);
+static List * LeastRepartitionedData(List *candidateJoinOrders);
+static uint64 RepartitionedDataSize(List *joinOrder);
 static void PrintJoinOrderList(List *joinOrder);
 static uint32 LargeDataTransferLocation(List *joinOrder);
 static List * TableEntryListDifference(List *lhsTableList, List *rhsTableList);
@@ -288,6 +294,15 @@ JoinOrderList(List *tableEntryList, List *joinClauseList)
 	List *candidateJoinOrderList = NIL;
 	ListCell *tableEntryCell = NULL;
 
+	if (EnableCostBasedJoinOrder)
+	{
+		TableEntry *tableEntry = NULL;
+		foreach_ptr(tableEntry, tableEntryList)
+		{
+			tableEntry->estimatedSize = EstimatedTableSize(tableEntry->relationId);
+		}
+	}
+
 	foreach(tableEntryCell, tableEntryList)
 	{
 		TableEntry *startingTable = (TableEntry *) lfirst(tableEntryCell);
@@ -348,6 +363,7 @@ JoinOrderForTable(TableEntry *firstTable, List *tableEntryList, List *joinClause
 													 list_make1(firstPartitionColumn),
 													 firstPartitionMethod,
 													 firstTable);
+	firstJoinNode->estimatedJoinedSize = firstTable->estimatedSize;
 
 	/* add first node to the join order */
 	List *joinOrderList = list_make1(firstJoinNode);
@@ -393,6 +409,13 @@ JoinOrderForTable(TableEntry *firstTable, List *tableEntryList, List *joinClause
 				nextJoinNode = pendingJoinNode;
 				nextJoinRuleType = pendingJoinRuleType;
 			}
+			else if (EnableCostBasedJoinOrder &&
+					 pendingJoinRuleType == nextJoinRuleType &&
+					 pendingTable->estimatedSize < nextJoinNode->tableEntry->estimatedSize)
+			{
+				/* among equal rules, join smaller tables first to repartition less */
+				nextJoinNode = pendingJoinNode;
+			}
 		}
 
 		if (nextJoinNode == NULL)
@@ -408,6 +431,8 @@ JoinOrderForTable(TableEntry *firstTable, List *tableEntryList, List *joinClause
 		TableEntry *nextJoinedTable = nextJoinNode->tableEntry;
 
 		/* add next node to the join order */
+		nextJoinNode->estimatedJoinedSize = currentJoinNode->estimatedJoinedSize +
+											nextJoinedTable->estimatedSize;
 		joinOrderList = lappend(joinOrderList, nextJoinNode);
 		joinedTableList = lappend(joinedTableList, nextJoinedTable);
 		currentJoinNode = nextJoinNode;
@@ -425,6 +450,11 @@ JoinOrderForTable(TableEntry *firstTable, List *tableEntryList, List *joinClause
  * this. First, the function chooses join orders that have the fewest number of
  * join operators that cause large data transfers. Second, the function chooses
  * join orders where large data transfers occur later in the execution.
+ *
+ * With cost-based join ordering, the function instead first chooses the join
+ * orders without needless cartesian products that repartition the least
+ * amount of data according to the estimated table sizes, and only uses the
+ * heuristics above to break ties.
  */
 static List *
 BestJoinOrder(List *candidateJoinOrders)
@@ -432,6 +462,13 @@ BestJoinOrder(List *candidateJoinOrders)
 	uint32 highestValidIndex = JOIN_RULE_LAST - 1;
 	uint32 candidateCount PG_USED_FOR_ASSERTS_ONLY = 0;
 
+	if (EnableCostBasedJoinOrder)
+	{
+		candidateJoinOrders = FewestOfJoinRuleType(candidateJoinOrders,
+												   CARTESIAN_PRODUCT);
+		candidateJoinOrders = LeastRepartitionedData(candidateJoinOrders);
+	}
+
 	/*
 	 * We start with the highest ranking rule type (cartesian product), and walk
 	 * over these rules in reverse order. For each rule type, we then keep join
@@ -595,6 +632,119 @@ LargeDataTransferLocation(List *joinOrder)
 }
 
 
+/*
+ * LeastRepartitionedData finds and returns the join orders that repartition
+ * the least amount of data, as estimated by RepartitionedDataSize.
+ */
+static List *
+LeastRepartitionedData(List *candidateJoinOrders)
+{
+	List *leastJoinOrders = NIL;
+	uint64 leastDataSize = PG_UINT64_MAX;
+	ListCell *joinOrderCell = NULL;
+
+	foreach(joinOrderCell, candidateJoinOrders)
+	{
+		List *joinOrder = (List *) lfirst(joinOrderCell);
+		uint64 dataSize = RepartitionedDataSize(joinOrder);
+
+		if (dataSize == leastDataSize)
+		{
+			leastJoinOrders = lappend(leastJoinOrders, joinOrder);
+		}
+		else if (dataSize < leastDataSize)
+		{
+			leastJoinOrders = list_make1(joinOrder);
+			leastDataSize = dataSize;
+		}
+	}
+
+	return leastJoinOrders;
+}
+
+
+/*
+ * RepartitionedDataSize estimates the number of bytes that the given join
+ * order sends over the network. A single repartition join moves either the
+ * candidate table or the tables joined so far, depending on which one keeps
+ * its partitioning, whereas dual repartition joins and cartesian products
+ * move both. The size of the tables joined so far is (over)estimated by the
+ * sum of their sizes.
+ */
+static uint64
+RepartitionedDataSize(List *joinOrder)
+{
+	uint64 dataSize = 0;
+	uint64 joinedSize = 0;
+	JoinOrderNode *joinOrderNode = NULL;
+
+	foreach_ptr(joinOrderNode, joinOrder)
+	{
+		TableEntry *tableEntry = joinOrderNode->tableEntry;
+
+		switch (joinOrderNode->joinRuleType)
+		{
+			case SINGLE_HASH_PARTITION_JOIN:
+			case SINGLE_RANGE_PARTITION_JOIN:
+			{
+				/* the candidate table becomes the anchor when the others move */
+				if (joinOrderNode->anchorTable == tableEntry)
+				{
+					dataSize += joinedSize;
+				}
+				else
+				{
+					dataSize += tableEntry->estimatedSize;
+				}
+				break;
+			}
+
+			case DUAL_PARTITION_JOIN:
+			case CARTESIAN_PRODUCT:
+			{
+				dataSize += joinedSize + tableEntry->estimatedSize;
+				break;
+			}
+
+			default:
+			{
+				break;
+			}
+		}
+
+		joinedSize += tableEntry->estimatedSize;
+	}
+
+	return dataSize;
+}
+
+
+/*
+ * EstimatedTableSize returns the size of the given table in bytes, as recorded
+ * in the shard placement metadata by citus_update_table_statistics. Tables
+ * whose statistics were never updated have a size of 0.
+ */
+uint64
+EstimatedTableSize(Oid relationId)
+{
+	CitusTableCacheEntry *cacheEntry = GetCitusTableCacheEntry(relationId);
+	uint64 tableSize = 0;
+
+	for (int shardIndex = 0; shardIndex < cacheEntry->shardIntervalArrayLength;
+		 shardIndex++)
+	{
+		if (cacheEntry->arrayOfPlacementArrayLengths[shardIndex] > 0)
+		{
+			GroupShardPlacement *placement =
+				&cacheEntry->arrayOfPlacementArrays[shardIndex][0];
+			tableSize += placement->shardLength;
+		}
+	}
+
+	return tableSize;
+}
+
+
 /* Prints the join order list and join rules for debugging purposes. */
 static void
 PrintJoinOrderList(List *joinOrder)
@@ -998,6 +1148,9 @@ SinglePartitionJoin(JoinOrderNode *currentJoinNode, TableEntry *candidateTable,
 		return NULL;
 	}
 
+	/* join order node that repartitions the candidate table, if applicable */
+	JoinOrderNode *nextJoinNode = NULL;
+
 	OpExpr *joinClause =
 		SinglePartitionJoinClause(currentPartitionColumnList, applicableJoinClauses,
 								  NULL);
@@ -1014,17 +1167,29 @@ SinglePartitionJoin(JoinOrderNode *currentJoinNode, TableEntry *candidateTable,
 				return NULL;
 			}
 
-			return MakeJoinOrderNode(candidateTable, SINGLE_HASH_PARTITION_JOIN,
-									 currentPartitionColumnList,
-									 currentPartitionMethod,
-									 currentAnchorTable);
+			nextJoinNode = MakeJoinOrderNode(candidateTable, SINGLE_HASH_PARTITION_JOIN,
+											 currentPartitionColumnList,
+											 currentPartitionMethod,
+											 currentAnchorTable);
 		}
 		else if (candidatePartitionMethod == DISTRIBUTE_BY_RANGE)
 		{
-			return MakeJoinOrderNode(candidateTable, SINGLE_RANGE_PARTITION_JOIN,
-									 currentPartitionColumnList,
-									 currentPartitionMethod,
-									 currentAnchorTable);
+			nextJoinNode = MakeJoinOrderNode(candidateTable, SINGLE_RANGE_PARTITION_JOIN,
+											 currentPartitionColumnList,
+											 currentPartitionMethod,
+											 currentAnchorTable);
+		}
+
+		/*
+		 * With cost-based join ordering, we rather repartition the tables
+		 * joined so far if they are smaller than the candidate table and
+		 * the candidate table's partitioning allows it.
+		 */
+		if (nextJoinNode != NULL &&
+			(!EnableCostBasedJoinOrder ||
+			 candidateTable->estimatedSize <= currentJoinNode->estimatedJoinedSize))
+		{
+			return nextJoinNode;
 		}
 	}
 
@@ -1050,7 +1215,7 @@ SinglePartitionJoin(JoinOrderNode *currentJoinNode, TableEntry *candidateTable,
 				 */
 				if (!EnableSingleHashRepartitioning)
 				{
-					return NULL;
+					return nextJoinNode;
 				}
 
 				return MakeJoinOrderNode(candidateTable,
@@ -1070,7 +1235,7 @@ SinglePartitionJoin(JoinOrderNode *currentJoinNode, TableEntry *candidateTable,
 		}
 	}
 
-	return NULL;
+	return nextJoinNode;
 }
 
 
@@ -39,12 +39,14 @@
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
+#include "utils/typcache.h"
 
 #include "pg_version_constants.h"
 
 #include "distributed/citus_nodes.h"
 #include "distributed/citus_ruleutils.h"
 #include "distributed/colocation_utils.h"
+#include "distributed/combine_query_planner.h"
 #include "distributed/errormessage.h"
 #include "distributed/extended_op_node_utils.h"
 #include "distributed/function_utils.h"
@@ -279,6 +281,9 @@ static bool AggregateEnabledCustom(Aggref *aggregateExpression);
 static Oid CitusFunctionOidWithSignature(char *functionName, int numargs, Oid *argtypes);
 static Oid WorkerPartialAggOid(void);
 static Oid CoordCombineAggOid(void);
+static Oid CountDistinctSketchAggOid(void);
+static Oid CountDistinctMergeAggOid(void);
+static bool HllExtensionLoaded(void);
 static Oid AggregateFunctionOid(const char *functionName, Oid inputType);
 static Oid TypeOid(Oid schemaId, const char *typeName);
 static SortGroupClause * CreateSortGroupClause(Var *column);
@@ -321,7 +326,8 @@ static bool CanPushDownLimitApproximate(List *sortClauseList, List *targetList);
 static bool HasOrderByAggregate(List *sortClauseList, List *targetList);
 static bool HasOrderByNonCommutativeAggregate(List *sortClauseList, List *targetList);
 static bool HasOrderByComplexExpression(List *sortClauseList, List *targetList);
-static bool HasOrderByHllType(List *sortClauseList, List *targetList);
+static bool HasOrderByCountDistinctApproximation(List *sortClauseList,
+												List *targetList);
 static bool ShouldProcessDistinctOrderAndLimitForWorker(
 	ExtendedOpNodeProperties *extendedOpNodeProperties,
 	bool pushingDownOriginalGrouping,
@@ -461,14 +467,16 @@ MultiLogicalPlanOptimize(MultiTreeRoot *multiLogicalPlan)
 	}
 
 	/*
-	 * When enabled, count(distinct) approximation uses hll as the intermediate
-	 * data type. We currently have a mismatch between hll target entry and sort
-	 * clause's sortop oid, so we can't push an order by on the hll data type to
-	 * the worker node. We check that here and error out if necessary.
+	 * When enabled, count(distinct) approximation uses hll or our own sketches
+	 * as the intermediate data type. We currently have a mismatch between the
+	 * sketch target entry and sort clause's sortop oid, so we can't push an
+	 * order by on the sketch to the worker node. We check that here and error
+	 * out if necessary.
 	 */
-	bool hasOrderByHllType = HasOrderByHllType(workerExtendedOpNode->sortClauseList,
-											   workerExtendedOpNode->targetList);
-	if (hasOrderByHllType)
+	bool hasOrderByApproximation =
+		HasOrderByCountDistinctApproximation(workerExtendedOpNode->sortClauseList,
+											 workerExtendedOpNode->targetList);
+	if (hasOrderByApproximation)
 	{
 		ereport(ERROR, (errmsg("cannot approximate count(distinct) and order by it"),
 						errhint("You might need to disable approximations for either "
@@ -1697,6 +1705,37 @@ MasterAggregateExpression(Aggref *originalAggregate,
 
 		newMasterExpression = (Expr *) aggregate;
 	}
+	else if (aggregateType == AGGREGATE_COUNT && originalAggregate->aggdistinct &&
+			 CountDistinctErrorRate != DISABLE_DISTINCT_APPROXIMATION &&
+			 !HllExtensionLoaded())
+	{
+		/*
+		 * Without hll, we approximate count(distinct) using our own sketches.
+		 * We first compute citus_count_distinct_sketch(column, log2m) on worker
+		 * nodes, and then merge the sketches on the master node to estimate the
+		 * distinct count using citus_count_distinct_merge(sketch).
+		 */
+		const int defaultTypeMod = -1;
+
+		Var *sketchColumn = makeVar(masterTableId, walkerContext->columnId, BYTEAOID,
+									defaultTypeMod, InvalidOid, columnLevelsUp);
+		walkerContext->columnId++;
+
+		TargetEntry *sketchTargetEntry = makeTargetEntry((Expr *) sketchColumn,
+														 argumentId, NULL, false);
+
+		Aggref *mergeAggregate = makeNode(Aggref);
+		mergeAggregate->aggfnoid = CountDistinctMergeAggOid();
+		mergeAggregate->aggtype = INT8OID;
+		mergeAggregate->args = list_make1(sketchTargetEntry);
+		mergeAggregate->aggkind = AGGKIND_NORMAL;
+		mergeAggregate->aggfilter = NULL;
+		mergeAggregate->aggtranstype = InvalidOid;
+		mergeAggregate->aggargtypes = list_make1_oid(BYTEAOID);
+		mergeAggregate->aggsplit = AGGSPLIT_SIMPLE;
+
+		newMasterExpression = (Expr *) mergeAggregate;
+	}
 	else if (aggregateType == AGGREGATE_COUNT && originalAggregate->aggdistinct &&
 			 CountDistinctErrorRate != DISABLE_DISTINCT_APPROXIMATION)
 	{
@@ -3106,6 +3145,43 @@ WorkerAggregateExpressionList(Aggref *originalAggregate,
 
 		walkerContext->createGroupByClause = true;
 	}
+	else if (aggregateType == AGGREGATE_COUNT && originalAggregate->aggdistinct &&
+			 CountDistinctErrorRate != DISABLE_DISTINCT_APPROXIMATION &&
+			 !HllExtensionLoaded())
+	{
+		/*
+		 * If the original aggregate is a count(distinct) approximation and hll
+		 * is not available, we want to compute
+		 * citus_count_distinct_sketch(var, storageSize) on worker nodes.
+		 */
+		const AttrNumber firstArgumentId = 1;
+		const AttrNumber secondArgumentId = 2;
+
+		Oid argumentType = AggregateArgumentType(originalAggregate);
+		TargetEntry *argument = (TargetEntry *) linitial(originalAggregate->args);
+		Expr *argumentExpression = copyObject(argument->expr);
+
+		int logOfStorageSize = CountDistinctStorageSize(CountDistinctErrorRate);
+		Const *logOfStorageSizeConst = MakeIntegerConst(logOfStorageSize);
+
+		TargetEntry *valueArgument = makeTargetEntry(argumentExpression,
+													 firstArgumentId, NULL, false);
+		TargetEntry *storageSizeArgument = makeTargetEntry((Expr *) logOfStorageSizeConst,
+														   secondArgumentId, NULL, false);
+
+		Aggref *sketchAggregate = makeNode(Aggref);
+		sketchAggregate->aggfnoid = CountDistinctSketchAggOid();
+		sketchAggregate->aggtype = BYTEAOID;
+		sketchAggregate->inputcollid = originalAggregate->inputcollid;
+		sketchAggregate->args = list_make2(valueArgument, storageSizeArgument);
+		sketchAggregate->aggkind = AGGKIND_NORMAL;
+		sketchAggregate->aggfilter = (Expr *) copyObject(originalAggregate->aggfilter);
+		sketchAggregate->aggtranstype = InvalidOid;
+		sketchAggregate->aggargtypes = list_make2_oid(argumentType, INT4OID);
+		sketchAggregate->aggsplit = AGGSPLIT_SIMPLE;
+
+		workerAggregateList = lappend(workerAggregateList, sketchAggregate);
+	}
 	else if (aggregateType == AGGREGATE_COUNT && originalAggregate->aggdistinct &&
 			 CountDistinctErrorRate != DISABLE_DISTINCT_APPROXIMATION)
 	{
@@ -3664,6 +3740,51 @@ CoordCombineAggOid()
 }
 
 
+/*
+ * CountDistinctSketchAggOid looks up oid of pg_catalog.citus_count_distinct_sketch
+ */
+static Oid
+CountDistinctSketchAggOid(void)
+{
+	Oid argtypes[] = {
+		ANYELEMENTOID,
+		INT4OID,
+	};
+
+	return CitusFunctionOidWithSignature(COUNT_DISTINCT_SKETCH_AGGREGATE_NAME, 2,
+										 argtypes);
+}
+
+
+/*
+ * CountDistinctMergeAggOid looks up oid of pg_catalog.citus_count_distinct_merge
+ */
+static Oid
+CountDistinctMergeAggOid(void)
+{
+	Oid argtypes[] = {
+		BYTEAOID,
+	};
+
+	return CitusFunctionOidWithSignature(COUNT_DISTINCT_MERGE_AGGREGATE_NAME, 1,
+										 argtypes);
+}
+
+
+/*
+ * HllExtensionLoaded returns whether the hll extension is loaded, in which
+ * case we use it to approximate count(distinct) instead of our own sketches.
+ */
+static bool
+HllExtensionLoaded(void)
+{
+	bool missingOK = true;
+	Oid hllId = get_extension_oid(HLL_EXTENSION_NAME, missingOK);
+
+	return OidIsValid(hllId);
+}
+
+
 /*
  * TypeOid looks for a type that has the given name and schema, and returns the
  * corresponding type's oid.
@@ -4112,11 +4233,17 @@ DeferErrorIfUnsupportedAggregateDistinct(Aggref *aggregateExpression,
 	if (aggregateType == AGGREGATE_COUNT &&
 		CountDistinctErrorRate != DISABLE_DISTINCT_APPROXIMATION)
 	{
-		bool missingOK = true;
-		Oid distinctExtensionId = get_extension_oid(HLL_EXTENSION_NAME, missingOK);
-
 		/* if extension for distinct approximation is loaded, we are good */
-		if (distinctExtensionId != InvalidOid)
+		if (HllExtensionLoaded())
+		{
+			return NULL;
+		}
+
+		/* otherwise, our own sketches need to hash the distinct values */
+		Oid argumentType = AggregateArgumentType(aggregateExpression);
+		TypeCacheEntry *typeEntry = lookup_type_cache(argumentType,
+													  TYPECACHE_HASH_EXTENDED_PROC);
+		if (OidIsValid(typeEntry->hash_extended_proc))
 		{
 			return NULL;
 		}
@@ -4124,7 +4251,8 @@ DeferErrorIfUnsupportedAggregateDistinct(Aggref *aggregateExpression,
 		{
 			return DeferredError(ERRCODE_FEATURE_NOT_SUPPORTED,
 								 "cannot compute count (distinct) approximation",
-								 NULL,
+								 "The data type of the distinct values cannot be "
+								 "hashed.",
 								 "You need to have the hll extension loaded.");
 		}
 	}
@@ -4801,10 +4929,23 @@ WorkerSortClauseList(Node *limitCount, List *groupClauseList, List *sortClauseLi
 {
 	List *workerSortClauseList = NIL;
 
-	/* if no limit node and no hasDistinctOn, no need to push down sort clauses */
+	/*
+	 * If no limit node and no hasDistinctOn, we only push down the sort clauses
+	 * to let the coordinator merge the sorted task results instead of sorting
+	 * all rows. That requires the workers to return the final rows, rather
+	 * than rows that are aggregated again on the coordinator.
+	 */
 	if (limitCount == NULL && !orderByLimitReference.hasDistinctOn)
 	{
-		return NIL;
+		bool workerReturnsFinalRows =
+			(orderByLimitReference.groupClauseIsEmpty &&
+			 !orderByLimitReference.hasOrderByAggregate) ||
+			orderByLimitReference.groupedByDisjointPartitionColumn;
+
+		if (!EnableSortedMerge || !workerReturnsFinalRows)
+		{
+			return NIL;
+		}
 	}
 
 	/* If window functions are computed on coordinator, we cannot push down sorting. */
@@ -4980,23 +5121,37 @@ HasOrderByComplexExpression(List *sortClauseList, List *targetList)
 
 
 /*
- * HasOrderByHllType walks over the given order by clauses, and checks if any of
- * those clauses operate on hll data type. If they do, the function returns true.
+ * HasOrderByCountDistinctApproximation walks over the given order by clauses,
+ * and checks if any of those clauses operate on the hll data type or on our
+ * own count(distinct) sketches. If they do, the function returns true.
  */
 static bool
-HasOrderByHllType(List *sortClauseList, List *targetList)
+HasOrderByCountDistinctApproximation(List *sortClauseList, List *targetList)
 {
-	bool hasOrderByHllType = false;
+	bool hasOrderByApproximation = false;
 
-	/* check whether HLL is loaded */
-	Oid hllId = get_extension_oid(HLL_EXTENSION_NAME, true);
-	if (!OidIsValid(hllId))
+	if (sortClauseList == NIL)
 	{
-		return hasOrderByHllType;
+		return hasOrderByApproximation;
 	}
 
-	Oid hllSchemaOid = get_extension_schema(hllId);
-	Oid hllTypeId = TypeOid(hllSchemaOid, HLL_TYPE_NAME);
+	/* check whether HLL is loaded, otherwise we may use our own sketches */
+	Oid hllTypeId = InvalidOid;
+	Oid sketchAggregateId = InvalidOid;
+	Oid hllId = get_extension_oid(HLL_EXTENSION_NAME, true);
+	if (OidIsValid(hllId))
+	{
+		Oid hllSchemaOid = get_extension_schema(hllId);
+		hllTypeId = TypeOid(hllSchemaOid, HLL_TYPE_NAME);
+	}
+	else if (CountDistinctErrorRate != DISABLE_DISTINCT_APPROXIMATION)
+	{
+		sketchAggregateId = CountDistinctSketchAggOid();
+	}
+	else
+	{
+		return hasOrderByApproximation;
+	}
 
 	SortGroupClause *sortClause = NULL;
 	foreach_ptr(sortClause, sortClauseList)
@@ -5004,14 +5159,21 @@ HasOrderByHllType(List *sortClauseList, List *targetList)
 		Node *sortExpression = get_sortgroupclause_expr(sortClause, targetList);
 
 		Oid sortColumnTypeId = exprType(sortExpression);
-		if (sortColumnTypeId == hllTypeId)
+		if (OidIsValid(hllTypeId) && sortColumnTypeId == hllTypeId)
+		{
+			hasOrderByApproximation = true;
+			break;
+		}
+
+		if (OidIsValid(sketchAggregateId) && IsA(sortExpression, Aggref) &&
+			((Aggref *) sortExpression)->aggfnoid == sketchAggregateId)
 		{
-			hasOrderByHllType = true;
+			hasOrderByApproximation = true;
 			break;
 		}
 	}
 
-	return hasOrderByHllType;
+	return hasOrderByApproximation;
 }
 
 
@@ -45,6 +45,7 @@
 #include "distributed/multi_logical_planner.h"
 #include "distributed/multi_physical_planner.h"
 #include "distributed/multi_router_planner.h"
+#include "distributed/planning_times.h"
 #include "distributed/query_pushdown_planning.h"
 #include "distributed/query_utils.h"
 #include "distributed/reference_table_utils.h"
@@ -146,8 +147,13 @@ MultiLogicalPlanCreate(Query *originalQuery, Query *queryTree,
 {
 	MultiNode *multiQueryNode = NULL;
 
+	DistributedPlanningPhase previousPhase =
+		BeginPlanningPhase(PLANNING_PHASE_PUSHDOWN_CHECK);
+	bool useSubqueryPushdown = ShouldUseSubqueryPushDown(originalQuery, queryTree,
+														 plannerRestrictionContext);
+	EndPlanningPhase(previousPhase);
 
-	if (ShouldUseSubqueryPushDown(originalQuery, queryTree, plannerRestrictionContext))
+	if (useSubqueryPushdown)
 	{
 		multiQueryNode = SubqueryMultiNodeTree(originalQuery, queryTree,
 											   plannerRestrictionContext);
@@ -92,6 +92,12 @@ int RepartitionJoinBucketCountPerNode = 4;
 int TaskAssignmentPolicy = TASK_ASSIGNMENT_GREEDY;
 bool EnableUniqueJobIds = true;
 
+/* whether to finalize the GROUP BY of the combine query on the workers */
+bool EnableRepartitionedAggregation = false;
+
+/* whether to evaluate the window functions of the combine query on the workers */
+bool EnableRepartitionedWindowFunctions = false;
+
 
 /*
  * OperatorCache is used for caching operator identifiers for given typeId,
@@ -120,6 +126,12 @@ typedef struct AddAnyValueAggregatesContext
 
 
 /* Local functions forward declarations for job creation */
+static void PlanRepartitionedAggregation(DistributedPlan *distributedPlan);
+static int RepartitionedAggregateColumnIndex(Query *combineQuery);
+static int RepartitionedWindowColumnIndex(Query *combineQuery);
+static bool CanRepartitionByColumn(Node *expression);
+static bool TargetListHasPseudoTypes(List *targetList);
+static bool IsParam(Node *node);
 static Job * BuildJobTree(MultiTreeRoot *multiTree);
 static MultiNode * LeftMostNode(MultiTreeRoot *multiTree);
 static Oid RangePartitionJoinBaseRelationId(MultiJoin *joinNode);
@@ -168,12 +180,16 @@ static uint32 HashPartitionCount(void);
 static Job * BuildJobTreeTaskList(Job *jobTree,
 								  PlannerRestrictionContext *plannerRestrictionContext);
 static bool IsInnerTableOfOuterJoin(RelationRestriction *relationRestriction);
+static void RecordParameterPruningRestrictions(Job *workerJob,
+											   RelationRestrictionContext *
+											   relationRestrictionContext);
 static void ErrorIfUnsupportedShardDistribution(Query *query);
 static Task * QueryPushdownTaskCreate(Query *originalQuery, int shardIndex,
 									  RelationRestrictionContext *restrictionContext,
 									  uint32 taskId,
 									  TaskType taskType,
 									  bool modifyRequiresCoordinatorEvaluation,
+									  ShardQueryTemplate *queryTemplate,
 									  DeferredErrorMessage **planningError);
 static List * SqlTaskList(Job *job);
 static bool DependsOnHashPartitionJob(Job *job);
@@ -257,6 +273,13 @@ CreatePhysicalDistributedPlan(MultiTreeRoot *multiTree,
 	/* create the tree of executable tasks for the worker job */
 	workerJob = BuildJobTreeTaskList(workerJob, plannerRestrictionContext);
 
+	if (!workerJob->parametersInJobQueryResolved)
+	{
+		RecordParameterPruningRestrictions(workerJob,
+										   plannerRestrictionContext->
+										   relationRestrictionContext);
+	}
+
 	/* build the final merge query to execute on the master */
 	List *masterDependentJobList = list_make1(workerJob);
 	Query *combineQuery = BuildJobQuery((MultiNode *) multiTree, masterDependentJobList);
@@ -267,10 +290,402 @@ CreatePhysicalDistributedPlan(MultiTreeRoot *multiTree,
 	distributedPlan->modLevel = ROW_MODIFY_READONLY;
 	distributedPlan->expectResults = true;
 
+	PlanRepartitionedAggregation(distributedPlan);
+
 	return distributedPlan;
 }
 
 
+/*
+ * RecordParameterPruningRestrictions records the restrictions of the
+ * distributed table of a generic plan that contain parameters, such that the
+ * executor can skip the tasks on shards that the parameter values exclude.
+ * We only do so when the query has a single table with a distribution key,
+ * since the tasks of co-located joins are pruned by each of the tables.
+ */
+static void
+RecordParameterPruningRestrictions(Job *workerJob,
+								   RelationRestrictionContext *relationRestrictionContext)
+{
+	RelationRestriction *pruningRestriction = NULL;
+
+	RelationRestriction *relationRestriction = NULL;
+	foreach_ptr(relationRestriction, relationRestrictionContext->relationRestrictionList)
+	{
+		if (!relationRestriction->citusTable ||
+			!HasDistributionKey(relationRestriction->relationId))
+		{
+			continue;
+		}
+
+		if (pruningRestriction != NULL)
+		{
+			return;
+		}
+
+		pruningRestriction = relationRestriction;
+	}
+
+	if (pruningRestriction == NULL || IsInnerTableOfOuterJoin(pruningRestriction))
+	{
+		return;
+	}
+
+	List *restrictClauseList =
+		get_all_actual_clauses(pruningRestriction->relOptInfo->baserestrictinfo);
+	List *parameterClauseList = NIL;
+
+	Node *restrictClause = NULL;
+	foreach_ptr(restrictClause, restrictClauseList)
+	{
+		if (HasUnresolvedExternParamsWalker(restrictClause, NULL) &&
+			!contain_subplans(restrictClause))
+		{
+			parameterClauseList = lappend(parameterClauseList,
+										  copyObject(restrictClause));
+		}
+	}
+
+	if (parameterClauseList == NIL)
+	{
+		return;
+	}
+
+	ChangeVarNodes((Node *) parameterClauseList, pruningRestriction->index, 1, 0);
+
+	workerJob->parameterPruningRelationId = pruningRestriction->relationId;
+	workerJob->parameterPruningClauseList = parameterClauseList;
+}
+
+
+/*
+ * PlanRepartitionedAggregation checks whether the groups or the window
+ * functions of the combine query can be evaluated on the workers instead of the
+ * coordinator. If so, the task results (the partial aggregates, or the rows
+ * that window functions that are not partitioned by the distribution column
+ * are evaluated over) are repartitioned by a group or window partition key
+ * across the shards of the anchor relation during execution, and a task per
+ * shard runs repartitionedAggregateQuery on the partitions it received. The
+ * combine query is replaced by one that only applies the DISTINCT, ORDER BY
+ * and LIMIT of the original combine query to the rows returned by the tasks.
+ *
+ * All rows of a group, and all rows of a window partition, end up in the same
+ * partition, hence evaluating each partition separately gives the same result
+ * as evaluating all of them at once, whatever the aggregates and window
+ * functions are.
+ */
+static void
+PlanRepartitionedAggregation(DistributedPlan *distributedPlan)
+{
+	Job *workerJob = distributedPlan->workerJob;
+	Query *combineQuery = distributedPlan->combineQuery;
+
+	if (combineQuery->hasWindowFuncs ? !EnableRepartitionedWindowFunctions :
+		!EnableRepartitionedAggregation)
+	{
+		return;
+	}
+
+	/* the partial results of repartition joins are not task results */
+	if (list_length(workerJob->taskList) <= 1 || workerJob->dependentJobList != NIL)
+	{
+		return;
+	}
+
+	if ((combineQuery->groupClause == NIL && !combineQuery->hasWindowFuncs) ||
+		combineQuery->groupingSets != NIL || combineQuery->hasSubLinks ||
+		combineQuery->setOperations != NULL ||
+		expression_returns_set((Node *) combineQuery->targetList) ||
+		combineQuery->jointree->quals != NULL ||
+		list_length(combineQuery->rtable) != 1)
+	{
+		return;
+	}
+
+	/*
+	 * Task queries are embedded in the partitioning queries and the finalizing
+	 * query is sent to the workers, neither can refer to parameters. Volatile
+	 * functions (e.g. nextval) are kept on the coordinator.
+	 */
+	if (FindNodeMatchingCheckFunction((Node *) workerJob->jobQuery, IsParam) ||
+		FindNodeMatchingCheckFunction((Node *) combineQuery, IsParam) ||
+		contain_volatile_functions((Node *) combineQuery->targetList) ||
+		contain_volatile_functions(combineQuery->havingQual))
+	{
+		return;
+	}
+
+	/* values of pseudo-types (e.g. partial aggregates) cannot be written to files */
+	if (TargetListHasPseudoTypes(workerJob->jobQuery->targetList) ||
+		TargetListHasPseudoTypes(combineQuery->targetList))
+	{
+		return;
+	}
+
+	int partitionColumnIndex = combineQuery->hasWindowFuncs ?
+							   RepartitionedWindowColumnIndex(combineQuery) :
+							   RepartitionedAggregateColumnIndex(combineQuery);
+	if (partitionColumnIndex < 0)
+	{
+		return;
+	}
+
+	Task *anchorTask = (Task *) linitial(workerJob->taskList);
+	if (anchorTask->anchorShardId == INVALID_SHARD_ID)
+	{
+		return;
+	}
+
+	Oid anchorRelationId = RelationIdForShard(anchorTask->anchorShardId);
+	if (!IsCitusTableType(anchorRelationId, HASH_DISTRIBUTED))
+	{
+		return;
+	}
+
+	/*
+	 * The finalizing query is the combine query without the clauses that
+	 * have to be applied to all rows, and returns all target entries such
+	 * that the new combine query can refer to them.
+	 */
+	Query *aggregateQuery = copyObject(combineQuery);
+	aggregateQuery->sortClause = NIL;
+	aggregateQuery->distinctClause = NIL;
+	aggregateQuery->hasDistinctOn = false;
+	aggregateQuery->limitCount = NULL;
+	aggregateQuery->limitOffset = NULL;
+	aggregateQuery->limitOption = LIMIT_OPTION_DEFAULT;
+
+	List *targetList = NIL;
+	List *funcColumnNames = NIL;
+	List *funcColumnTypes = NIL;
+	List *funcColumnTypeMods = NIL;
+	List *funcCollations = NIL;
+	AttrNumber columnId = 1;
+
+	TargetEntry *targetEntry = NULL;
+	foreach_ptr(targetEntry, aggregateQuery->targetList)
+	{
+		Node *expr = (Node *) targetEntry->expr;
+
+		if (targetEntry->resname == NULL)
+		{
+			StringInfo columnName = makeStringInfo();
+			appendStringInfo(columnName, WORKER_COLUMN_FORMAT, columnId);
+
+			targetEntry->resname = columnName->data;
+		}
+
+		TargetEntry *newTargetEntry = flatCopyTargetEntry(targetEntry);
+		newTargetEntry->expr = (Expr *) makeVar(1, columnId, exprType(expr),
+												exprTypmod(expr), exprCollation(expr),
+												0);
+		targetList = lappend(targetList, newTargetEntry);
+
+		funcColumnNames = lappend(funcColumnNames, makeString(targetEntry->resname));
+		funcColumnTypes = lappend_oid(funcColumnTypes, exprType(expr));
+		funcColumnTypeMods = lappend_int(funcColumnTypeMods, exprTypmod(expr));
+		funcCollations = lappend_oid(funcCollations, exprCollation(expr));
+
+		targetEntry->resjunk = false;
+		columnId++;
+	}
+
+	List *columnNameList = DerivedColumnNameList(list_length(targetList),
+												 workerJob->jobId);
+	List *tableIdList = list_make1(makeInteger(1));
+	RangeTblEntry *rangeTableEntry = DerivedRangeTableEntry(NULL, columnNameList,
+															tableIdList,
+															funcColumnNames,
+															funcColumnTypes,
+															funcColumnTypeMods,
+															funcCollations);
+
+	/* the DISTINCT, ORDER BY and LIMIT clauses refer to the copied target entries */
+	Query *newCombineQuery = copyObject(combineQuery);
+	newCombineQuery->rtable = list_make1(rangeTableEntry);
+	newCombineQuery->targetList = targetList;
+	newCombineQuery->groupClause = NIL;
+	newCombineQuery->havingQual = NULL;
+	newCombineQuery->hasAggs = false;
+	newCombineQuery->windowClause = NIL;
+	newCombineQuery->hasWindowFuncs = false;
+
+	distributedPlan->combineQuery = newCombineQuery;
+	distributedPlan->repartitionedAggregateQuery = aggregateQuery;
+	distributedPlan->repartitionedAggregateColumnIndex = partitionColumnIndex;
+	distributedPlan->repartitionedAggregateRelationId = anchorRelationId;
+
+	if (combineQuery->hasWindowFuncs)
+	{
+		ereport(DEBUG1, (errmsg("evaluating the window functions on the workers "
+								"after repartitioning the rows by partition key")));
+	}
+	else
+	{
+		ereport(DEBUG1, (errmsg("finalizing the groups on the workers after "
+								"repartitioning the partial results by group key")));
+	}
+}
+
+
+/*
+ * RepartitionedAggregateColumnIndex returns the index of the column of the
+ * task results that the partial results can be repartitioned by to finalize
+ * the groups of the combine query separately, or -1 if there is none. That
+ * is a group key that is a column of the task results and whose values can
+ * be hashed consistently with the equality used for grouping.
+ */
+static int
+RepartitionedAggregateColumnIndex(Query *combineQuery)
+{
+	SortGroupClause *groupClause = NULL;
+	foreach_ptr(groupClause, combineQuery->groupClause)
+	{
+		Node *groupExpression = get_sortgroupclause_expr(groupClause,
+														 combineQuery->targetList);
+		if (!CanRepartitionByColumn(groupExpression))
+		{
+			continue;
+		}
+
+		return ((Var *) groupExpression)->varattno - 1;
+	}
+
+	return -1;
+}
+
+
+/*
+ * RepartitionedWindowColumnIndex returns the index of the column of the task
+ * results that the rows can be repartitioned by to evaluate the window
+ * functions of the combine query separately, or -1 if there is none. That is a
+ * column that every window is partitioned by, which in a grouped query also
+ * has to be a group key such that the groups are repartitioned along.
+ */
+static int
+RepartitionedWindowColumnIndex(Query *combineQuery)
+{
+	if (combineQuery->windowClause == NIL)
+	{
+		return -1;
+	}
+
+	WindowClause *firstWindowClause = (WindowClause *) linitial(combineQuery->windowClause);
+
+	SortGroupClause *partitionClause = NULL;
+	foreach_ptr(partitionClause, firstWindowClause->partitionClause)
+	{
+		Node *partitionExpression =
+			get_sortgroupclause_expr(partitionClause, combineQuery->targetList);
+		if (!CanRepartitionByColumn(partitionExpression))
+		{
+			continue;
+		}
+
+		bool partitionsAllWindows = true;
+
+		WindowClause *windowClause = NULL;
+		foreach_ptr(windowClause, combineQuery->windowClause)
+		{
+			List *windowExpressions =
+				get_sortgrouplist_exprs(windowClause->partitionClause,
+										combineQuery->targetList);
+			if (!list_member(windowExpressions, partitionExpression))
+			{
+				partitionsAllWindows = false;
+				break;
+			}
+		}
+
+		if (!partitionsAllWindows)
+		{
+			continue;
+		}
+
+		if (combineQuery->groupClause != NIL)
+		{
+			List *groupExpressions = get_sortgrouplist_exprs(combineQuery->groupClause,
+															 combineQuery->targetList);
+			if (!list_member(groupExpressions, partitionExpression))
+			{
+				continue;
+			}
+		}
+
+		return ((Var *) partitionExpression)->varattno - 1;
+	}
+
+	return -1;
+}
+
+
+/*
+ * CanRepartitionByColumn returns whether the given expression of the combine
+ * query is a column of the task results whose values can be hashed
+ * consistently with the equality used for grouping and window partitioning.
+ */
+static bool
+CanRepartitionByColumn(Node *expression)
+{
+	if (!IsA(expression, Var))
+	{
+		return false;
+	}
+
+	Var *column = (Var *) expression;
+	if (column->varno != 1 || column->varlevelsup != 0)
+	{
+		return false;
+	}
+
+	TypeCacheEntry *typeEntry = lookup_type_cache(column->vartype,
+												  TYPECACHE_HASH_PROC);
+	if (!OidIsValid(typeEntry->hash_proc))
+	{
+		return false;
+	}
+
+	/* equal values may hash differently under nondeterministic collations */
+	if (OidIsValid(column->varcollid) &&
+		!get_collation_isdeterministic(column->varcollid))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * TargetListHasPseudoTypes returns whether any of the entries in the given
+ * target list has a pseudo-type, such as record or cstring.
+ */
+static bool
+TargetListHasPseudoTypes(List *targetList)
+{
+	TargetEntry *targetEntry = NULL;
+	foreach_ptr(targetEntry, targetList)
+	{
+		if (get_typtype(exprType((Node *) targetEntry->expr)) == TYPTYPE_PSEUDO)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * IsParam returns whether the given node is a parameter.
+ */
+static bool
+IsParam(Node *node)
+{
+	return node != NULL && IsA(node, Param);
+}
+
+
 /*
  * ModifyLocalTableJob returns true if the given task contains
  * a modification of local table.
@@ -2259,6 +2674,28 @@ QueryPushdownSqlTaskList(Query *query, uint64 jobId,
 	 * identify the end of the bitmapset.
 	 */
 	int shardOffset = minShardOffset - 1;
+
+	/*
+	 * The task queries only differ in the shard names, unless arrays are
+	 * reduced to the elements of each shard. Hence, we deparse the query of
+	 * the first task as usual and then splice the shard names of the other
+	 * tasks into a template of it.
+	 */
+	bool tryQueryTemplate = EnableShardQueryTemplates &&
+							bms_num_members(taskRequiredForShardIndex) > 1 &&
+							(taskType == READ_TASK ||
+							 (taskType == MODIFY_TASK &&
+							  !modifyRequiresCoordinatorEvaluation)) &&
+							!HasArrayRestrictionsToSplit(query);
+	ShardQueryTemplate *queryTemplate = NULL;
+
+	/* a template of an earlier execution of the same query also covers the first task */
+	if (tryQueryTemplate)
+	{
+		queryTemplate = LookupShardQueryTemplate(query);
+		tryQueryTemplate = queryTemplate == NULL;
+	}
+
 	while ((shardOffset = bms_next_member(taskRequiredForShardIndex, shardOffset)) >= 0)
 	{
 		Task *subqueryTask = QueryPushdownTaskCreate(query, shardOffset,
@@ -2266,12 +2703,26 @@ QueryPushdownSqlTaskList(Query *query, uint64 jobId,
 													 taskIdIndex,
 													 taskType,
 													 modifyRequiresCoordinatorEvaluation,
+													 queryTemplate,
 													 planningError);
 		if (*planningError != NULL)
 		{
 			return NIL;
 		}
 		subqueryTask->jobId = jobId;
+
+		if (tryQueryTemplate)
+		{
+			queryTemplate = CreateShardQueryTemplate(query,
+													 subqueryTask->relationShardList,
+													 TaskQueryString(subqueryTask));
+			tryQueryTemplate = false;
+
+			if (queryTemplate != NULL)
+			{
+				CacheShardQueryTemplate(query, queryTemplate);
+			}
+		}
 		sqlTaskList = lappend(sqlTaskList, subqueryTask);
 
 		++taskIdIndex;
@@ -2439,10 +2890,9 @@ static Task *
 QueryPushdownTaskCreate(Query *originalQuery, int shardIndex,
 						RelationRestrictionContext *restrictionContext, uint32 taskId,
 						TaskType taskType, bool modifyRequiresCoordinatorEvaluation,
+						ShardQueryTemplate *queryTemplate,
 						DeferredErrorMessage **planningError)
 {
-	Query *taskQuery = copyObject(originalQuery);
-
 	StringInfo queryString = makeStringInfo();
 	ListCell *restrictionCell = NULL;
 	List *taskShardList = NIL;
@@ -2526,32 +2976,54 @@ QueryPushdownTaskCreate(Query *originalQuery, int shardIndex,
 		return NULL;
 	}
 
-	/*
-	 * Augment the relations in the query with the shard IDs.
-	 */
-	UpdateRelationToShardNames((Node *) taskQuery, relationShardList);
+	Task *subqueryTask = CreateBasicTask(jobId, taskId, taskType, NULL);
 
-	/*
-	 * Ands are made implicit during shard pruning, as predicate comparison and
-	 * refutation depend on it being so. We need to make them explicit again so
-	 * that the query string is generated as (...) AND (...) as opposed to
-	 * (...), (...).
-	 */
-	if (taskQuery->jointree->quals != NULL && IsA(taskQuery->jointree->quals, List))
+	char *templateQueryString = NULL;
+	if (queryTemplate != NULL)
 	{
-		taskQuery->jointree->quals = (Node *) make_ands_explicit(
-			(List *) taskQuery->jointree->quals);
+		templateQueryString = ShardQueryStringFromTemplate(queryTemplate,
+														   relationShardList);
 	}
 
-	Task *subqueryTask = CreateBasicTask(jobId, taskId, taskType, NULL);
-
-	if ((taskType == MODIFY_TASK && !modifyRequiresCoordinatorEvaluation) ||
-		taskType == READ_TASK)
+	if (templateQueryString != NULL)
 	{
-		pg_get_query_def(taskQuery, queryString);
 		ereport(DEBUG4, (errmsg("distributed statement: %s",
-								queryString->data)));
-		SetTaskQueryString(subqueryTask, queryString->data);
+								templateQueryString)));
+		SetTaskQueryString(subqueryTask, templateQueryString);
+	}
+	else
+	{
+		Query *taskQuery = copyObject(originalQuery);
+
+		/* only send the elements of large IN lists that belong to the task's shards */
+		SplitArrayRestrictionsByShard(taskQuery, relationShardList);
+
+		/*
+		 * Augment the relations in the query with the shard IDs.
+		 */
+		UpdateRelationToShardNames((Node *) taskQuery, relationShardList);
+
+		/*
+		 * Ands are made implicit during shard pruning, as predicate comparison and
+		 * refutation depend on it being so. We need to make them explicit again so
+		 * that the query string is generated as (...) AND (...) as opposed to
+		 * (...), (...).
+		 */
+		if (taskQuery->jointree->quals != NULL && IsA(taskQuery->jointree->quals,
+													  List))
+		{
+			taskQuery->jointree->quals = (Node *) make_ands_explicit(
+				(List *) taskQuery->jointree->quals);
+		}
+
+		if ((taskType == MODIFY_TASK && !modifyRequiresCoordinatorEvaluation) ||
+			taskType == READ_TASK)
+		{
+			pg_get_query_def(taskQuery, queryString);
+			ereport(DEBUG4, (errmsg("distributed statement: %s",
+									queryString->data)));
+			SetTaskQueryString(subqueryTask, queryString->data);
+		}
 	}
 
 	subqueryTask->dependentTaskList = NULL;
@@ -2704,6 +3176,12 @@ SqlTaskList(Job *job)
 		List *fragmentRangeTableList = taskQuery->rtable;
 		UpdateRangeTableAlias(fragmentRangeTableList, fragmentCombination);
 
+		List *relationShardList = BuildRelationShardList(fragmentRangeTableList,
+														 fragmentCombination);
+
+		/* only send the elements of large IN lists that belong to the task's shards */
+		SplitArrayRestrictionsByShard(taskQuery, relationShardList);
+
 		/* transform the updated task query to a SQL query string */
 		StringInfo sqlQueryString = makeStringInfo();
 		pg_get_query_def(taskQuery, sqlQueryString);
@@ -2711,8 +3189,7 @@ SqlTaskList(Job *job)
 		Task *sqlTask = CreateBasicTask(jobId, taskIdIndex, READ_TASK,
 										sqlQueryString->data);
 		sqlTask->dependentTaskList = dataFetchTaskList;
-		sqlTask->relationShardList = BuildRelationShardList(fragmentRangeTableList,
-															fragmentCombination);
+		sqlTask->relationShardList = relationShardList;
 
 		/* log the query string we generated */
 		ereport(DEBUG4, (errmsg("generated sql query for task %d", sqlTask->taskId),
@@ -73,6 +73,7 @@
 #include "distributed/multi_physical_planner.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/multi_server_executor.h"
+#include "distributed/node_latency_stats.h"
 #include "distributed/query_pushdown_planning.h"
 #include "distributed/query_utils.h"
 #include "distributed/recursive_planning.h"
@@ -82,6 +83,7 @@
 #include "distributed/resource_lock.h"
 #include "distributed/shard_pruning.h"
 #include "distributed/shardinterval_utils.h"
+#include "distributed/utils/citus_stat_tenants.h"
 
 /* intermediate value for INSERT processing */
 typedef struct InsertValues
@@ -164,8 +166,9 @@ static List * SingleShardTaskList(Query *query, uint64 jobId,
 								  List *relationShardList, List *placementList,
 								  uint64 shardId, bool parametersInQueryResolved,
 								  bool isLocalTableModification, Const *partitionKeyValue,
-								  int colocationId);
+								  int colocationId, char *shardQueryString);
 static bool RowLocksOnRelations(Node *node, List **rtiLockList);
+static List * MoveDegradedPlacementsLast(List *placementList);
 static void ReorderTaskPlacementsByTaskAssignmentPolicy(Job *job,
 														TaskAssignmentPolicyType
 														taskAssignmentPolicy,
@@ -1941,7 +1944,7 @@ RouterJob(Query *originalQuery, PlannerRestrictionContext *plannerRestrictionCon
 	{
 		GenerateSingleShardRouterTaskList(job, relationShardList,
 										  placementList, shardId,
-										  isLocalTableModification);
+										  isLocalTableModification, NULL);
 	}
 
 	job->requiresCoordinatorEvaluation = requiresCoordinatorEvaluation;
@@ -1953,12 +1956,15 @@ RouterJob(Query *originalQuery, PlannerRestrictionContext *plannerRestrictionCon
  * GenerateSingleShardRouterTaskList is a wrapper around other corresponding task
  * list generation functions specific to single shard selects and modifications.
  *
+ * If shardQueryString is not NULL, it is used as the query string of the task
+ * instead of deparsing the job query.
+ *
  * The function updates the input job's taskList in-place.
  */
 void
 GenerateSingleShardRouterTaskList(Job *job, List *relationShardList,
 								  List *placementList, uint64 shardId, bool
-								  isLocalTableModification)
+								  isLocalTableModification, char *shardQueryString)
 {
 	Query *originalQuery = job->jobQuery;
 
@@ -1971,7 +1977,8 @@ GenerateSingleShardRouterTaskList(Job *job, List *relationShardList,
 											shardId,
 											job->parametersInJobQueryResolved,
 											isLocalTableModification,
-											job->partitionKeyValue, job->colocationId);
+											job->partitionKeyValue, job->colocationId,
+											shardQueryString);
 
 		/*
 		 * Queries to reference tables, or distributed tables with multiple replica's have
@@ -2002,7 +2009,8 @@ GenerateSingleShardRouterTaskList(Job *job, List *relationShardList,
 											shardId,
 											job->parametersInJobQueryResolved,
 											isLocalTableModification,
-											job->partitionKeyValue, job->colocationId);
+											job->partitionKeyValue, job->colocationId,
+											shardQueryString);
 	}
 }
 
@@ -2015,6 +2023,10 @@ GenerateSingleShardRouterTaskList(Job *job, List *relationShardList,
  * - TASK_ASSIGNMENT_ROUND_ROBIN round robin schedule queries among placements
  *
  * By default it does not reorder the task list, implying a first-replica strategy.
+ *
+ * When citus.avoid_degraded_nodes is enabled, the placements on degraded nodes
+ * are moved to the end afterwards, such that the executor only reads from them
+ * when the other placements fail.
  */
 static void
 ReorderTaskPlacementsByTaskAssignmentPolicy(Job *job,
@@ -2054,6 +2066,48 @@ ReorderTaskPlacementsByTaskAssignmentPolicy(Job *job,
 								primaryPlacement->nodeName,
 								primaryPlacement->nodePort)));
 	}
+
+	if (AvoidDegradedNodes)
+	{
+		Task *task = (Task *) linitial(job->taskList);
+		task->taskPlacementList = MoveDegradedPlacementsLast(task->taskPlacementList);
+	}
+}
+
+
+/*
+ * MoveDegradedPlacementsLast returns the given placement list with the
+ * placements on degraded nodes moved to the end, otherwise keeping the order
+ * of the placements.
+ */
+static List *
+MoveDegradedPlacementsLast(List *placementList)
+{
+	List *healthyPlacementList = NIL;
+	List *degradedPlacementList = NIL;
+
+	if (list_length(placementList) < 2)
+	{
+		return placementList;
+	}
+
+	ShardPlacement *placement = NULL;
+	foreach_ptr(placement, placementList)
+	{
+		if (NodeIsDegraded(placement->nodeName, placement->nodePort))
+		{
+			ereport(DEBUG3, (errmsg("avoiding placement on degraded node %s:%d",
+									placement->nodeName, placement->nodePort)));
+
+			degradedPlacementList = lappend(degradedPlacementList, placement);
+		}
+		else
+		{
+			healthyPlacementList = lappend(healthyPlacementList, placement);
+		}
+	}
+
+	return list_concat(healthyPlacementList, degradedPlacementList);
 }
 
 
@@ -2097,7 +2151,7 @@ SingleShardTaskList(Query *query, uint64 jobId, List *relationShardList,
 					List *placementList, uint64 shardId,
 					bool parametersInQueryResolved,
 					bool isLocalTableModification, Const *partitionKeyValue,
-					int colocationId)
+					int colocationId, char *shardQueryString)
 {
 	TaskType taskType = READ_TASK;
 	char replicationModel = 0;
@@ -2169,7 +2223,18 @@ SingleShardTaskList(Query *query, uint64 jobId, List *relationShardList,
 	task->taskPlacementList = placementList;
 	task->partitionKeyValue = partitionKeyValue;
 	task->colocationId = colocationId;
-	SetTaskQueryIfShouldLazyDeparse(task, query);
+
+	if (shardQueryString != NULL)
+	{
+		/* the shard query was deparsed in an earlier execution */
+		SetTaskQueryString(task, AnnotateQuery(shardQueryString, partitionKeyValue,
+											   colocationId));
+	}
+	else
+	{
+		SetTaskQueryIfShouldLazyDeparse(task, query);
+	}
+
 	task->anchorShardId = shardId;
 	task->jobId = jobId;
 	task->relationShardList = relationShardList;
@@ -2911,6 +2976,14 @@ TargetShardIntervalsForRestrictInfo(RelationRestrictionContext *restrictionConte
 			prunedShardIntervalList = PruneShards(relationId, tableId, restrictClauseList,
 												  &restrictionPartitionValueConst);
 
+			if (EnableShardColumnStatisticsPruning)
+			{
+				prunedShardIntervalList =
+					PruneShardsByColumnStatistics(relationId, tableId,
+												  restrictClauseList,
+												  prunedShardIntervalList);
+			}
+
 			if (list_length(prunedShardIntervalList) > 1)
 			{
 				(*multiShardQuery) = true;
@@ -0,0 +1,180 @@
+/*-------------------------------------------------------------------------
+ *
+ * planning_times.c
+ *
+ * Functions for measuring the time spent in each phase of distributed
+ * planning (pushdown checks, recursive planning, logical optimization,
+ * physical planning and deparsing). The durations are accumulated while
+ * planning a top-level query and are recorded in the resulting distributed
+ * plan, such that EXPLAIN and citus_stat_statements can report them.
+ *
+ * The phases nest: e.g. recursive planning checks whether subqueries can be
+ * pushed down and deparses the ones that cannot. Time is always attributed
+ * to the innermost phase only, such that the phase durations add up to (at
+ * most) the total planning time.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "portability/instr_time.h"
+
+#include "distributed/distributed_planner.h"
+#include "distributed/planning_times.h"
+
+
+/* time spent in each phase while planning the current query, in milliseconds */
+static double PlanningPhaseTimes[PLANNING_PHASE_COUNT];
+
+/* the phase we are currently in and when we entered it */
+static DistributedPlanningPhase ActivePlanningPhase = PLANNING_PHASE_NONE;
+static instr_time ActivePlanningPhaseStart;
+
+
+static void SwitchPlanningPhase(DistributedPlanningPhase phase);
+
+
+/*
+ * ResetPlanningPhaseTimes clears the phase durations. It is called when we
+ * start planning a top-level query, and also discards the current phase in
+ * case the previous planning was interrupted by an error.
+ */
+void
+ResetPlanningPhaseTimes(void)
+{
+	for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+	{
+		PlanningPhaseTimes[phase] = 0.0;
+	}
+
+	ActivePlanningPhase = PLANNING_PHASE_NONE;
+}
+
+
+/*
+ * BeginPlanningPhase starts attributing the planning time to the given phase
+ * and returns the phase that was active before, which should be passed to
+ * EndPlanningPhase. Outside of the distributed planner (e.g. when deparsing
+ * during execution) the function is a no-op.
+ */
+DistributedPlanningPhase
+BeginPlanningPhase(DistributedPlanningPhase phase)
+{
+	DistributedPlanningPhase previousPhase = ActivePlanningPhase;
+
+	if (PlannerLevel == 0 || phase == previousPhase)
+	{
+		return previousPhase;
+	}
+
+	SwitchPlanningPhase(phase);
+
+	return previousPhase;
+}
+
+
+/*
+ * EndPlanningPhase stops attributing the planning time to the current phase
+ * and resumes the given phase, as returned by BeginPlanningPhase.
+ */
+void
+EndPlanningPhase(DistributedPlanningPhase previousPhase)
+{
+	if (previousPhase == ActivePlanningPhase)
+	{
+		return;
+	}
+
+	SwitchPlanningPhase(previousPhase);
+}
+
+
+/*
+ * CurrentPlanningPhase returns the phase that the planning time is currently
+ * attributed to, such that it can be restored after catching an error.
+ */
+DistributedPlanningPhase
+CurrentPlanningPhase(void)
+{
+	return ActivePlanningPhase;
+}
+
+
+/*
+ * SwitchPlanningPhase adds the time spent since entering the current phase
+ * to its duration and makes the given phase the current one.
+ */
+static void
+SwitchPlanningPhase(DistributedPlanningPhase phase)
+{
+	instr_time now;
+
+	INSTR_TIME_SET_CURRENT(now);
+
+	if (ActivePlanningPhase != PLANNING_PHASE_NONE)
+	{
+		instr_time elapsed = now;
+
+		INSTR_TIME_SUBTRACT(elapsed, ActivePlanningPhaseStart);
+		PlanningPhaseTimes[ActivePlanningPhase] += INSTR_TIME_GET_MILLISEC(elapsed);
+	}
+
+	ActivePlanningPhase = phase;
+	ActivePlanningPhaseStart = now;
+}
+
+
+/*
+ * GetPlanningPhaseTimes copies the durations of the phases of the current
+ * planning into the given array of PLANNING_PHASE_COUNT elements.
+ */
+void
+GetPlanningPhaseTimes(double *planningPhaseTimes)
+{
+	for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+	{
+		planningPhaseTimes[phase] = PlanningPhaseTimes[phase];
+	}
+}
+
+
+/*
+ * PlanningPhaseName returns the name of the given phase as shown in EXPLAIN.
+ */
+const char *
+PlanningPhaseName(DistributedPlanningPhase phase)
+{
+	switch (phase)
+	{
+		case PLANNING_PHASE_PUSHDOWN_CHECK:
+		{
+			return "Pushdown Check";
+		}
+
+		case PLANNING_PHASE_RECURSIVE_PLANNING:
+		{
+			return "Recursive Planning";
+		}
+
+		case PLANNING_PHASE_LOGICAL_OPTIMIZATION:
+		{
+			return "Logical Optimization";
+		}
+
+		case PLANNING_PHASE_PHYSICAL_PLANNING:
+		{
+			return "Physical Planning";
+		}
+
+		case PLANNING_PHASE_DEPARSE:
+		{
+			return "Deparse";
+		}
+
+		default:
+		{
+			return "Unknown";
+		}
+	}
+}
@@ -39,6 +39,7 @@
 #include "distributed/multi_logical_planner.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/pg_dist_partition.h"
+#include "distributed/planning_times.h"
 #include "distributed/query_pushdown_planning.h"
 #include "distributed/query_utils.h"
 #include "distributed/recursive_planning.h"
@@ -523,6 +524,9 @@ MultiNode *
 SubqueryMultiNodeTree(Query *originalQuery, Query *queryTree,
 					  PlannerRestrictionContext *plannerRestrictionContext)
 {
+	DistributedPlanningPhase previousPhase =
+		BeginPlanningPhase(PLANNING_PHASE_PUSHDOWN_CHECK);
+
 	/*
 	 * This is a generic error check that applies to both subquery pushdown
 	 * and single table repartition subquery.
@@ -542,6 +546,8 @@ SubqueryMultiNodeTree(Query *originalQuery, Query *queryTree,
 		RaiseDeferredError(subqueryPushdownError, ERROR);
 	}
 
+	EndPlanningPhase(previousPhase);
+
 	MultiNode *multiQueryNode = SubqueryPushdownMultiNodeTree(originalQuery);
 
 	Assert(multiQueryNode != NULL);
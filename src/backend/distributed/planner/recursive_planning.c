@@ -49,9 +49,11 @@
 #include "postgres.h"
 
 #include "funcapi.h"
+#include "miscadmin.h"
 
 #include "catalog/pg_class.h"
 #include "catalog/pg_type.h"
+#include "common/hashfn.h"
 #include "lib/stringinfo.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -73,6 +75,7 @@
 
 #include "distributed/citus_nodes.h"
 #include "distributed/citus_ruleutils.h"
+#include "distributed/colocation_utils.h"
 #include "distributed/commands/multi_copy.h"
 #include "distributed/distributed_planner.h"
 #include "distributed/errormessage.h"
@@ -80,6 +83,7 @@
 #include "distributed/local_distributed_join_planner.h"
 #include "distributed/log_utils.h"
 #include "distributed/metadata_cache.h"
+#include "distributed/multi_join_order.h"
 #include "distributed/multi_logical_optimizer.h"
 #include "distributed/multi_logical_planner.h"
 #include "distributed/multi_physical_planner.h"
@@ -87,9 +91,11 @@
 #include "distributed/multi_server_executor.h"
 #include "distributed/query_colocation_checker.h"
 #include "distributed/query_pushdown_planning.h"
+#include "distributed/query_utils.h"
 #include "distributed/recursive_planning.h"
 #include "distributed/relation_restriction_equivalence.h"
 #include "distributed/shard_pruning.h"
+#include "distributed/subplan_execution.h"
 #include "distributed/version_compat.h"
 
 /*
@@ -109,6 +115,13 @@ struct RecursivePlanningContextInternal
 /* track depth of current recursive planner query */
 static int recursivePlanningDepth = 0;
 
+/*
+ * Distributed tables up to this size (in kB) that are not co-located with the
+ * other tables in a join are broadcast as intermediate results instead of
+ * being repartitioned. Managed via a GUC, 0 disables it.
+ */
+int BroadcastJoinThreshold = 0;
+
 /*
  * CteReferenceWalkerContext is used to collect CTE references in
  * CteReferenceListWalker.
@@ -140,6 +153,11 @@ static bool ContainsSubquery(Query *query);
 static bool ShouldRecursivelyPlanOuterJoins(RecursivePlanningContext *context);
 static void RecursivelyPlanNonColocatedSubqueries(Query *subquery,
 												  RecursivePlanningContext *context);
+static List * SmallDistributedTablesToBroadcast(Query *query,
+												RecursivePlanningContext *context);
+static void RecursivelyPlanSmallDistributedTables(Query *query,
+												  List *rangeTableEntryList,
+												  RecursivePlanningContext *context);
 static void RecursivelyPlanNonColocatedJoinWalker(Node *joinNode,
 												  ColocatedJoinChecker *
 												  colocatedJoinChecker,
@@ -176,7 +194,12 @@ static void RecursivelyPlanSetOperations(Query *query, Node *node,
 										 RecursivePlanningContext *context);
 static bool IsLocalTableRteOrMatView(Node *node);
 static DistributedSubPlan * CreateDistributedSubPlan(uint32 subPlanId,
-													 Query *subPlanQuery);
+													 Query *subPlanQuery,
+													 List *earlierSubPlanList);
+static bool SubPlanQueryIsReusable(Query *subPlanQuery, List *earlierSubPlanList,
+								   List **relationIdList);
+static bool IsExternParam(Node *node);
+static char * ReusableSubPlanResultId(Query *subPlanQuery);
 static bool CteReferenceListWalker(Node *node, CteReferenceWalkerContext *context);
 static bool ContainsReferencesToOuterQueryWalker(Node *node,
 												 VarLevelsUpWalkerContext *context);
@@ -347,6 +370,18 @@ RecursivelyPlanSubqueriesAndCTEs(Query *query, RecursivePlanningContext *context
 		RecursivelyPlanLocalTableJoins(query, context);
 	}
 
+	/*
+	 * A join between a large distributed table and small distributed tables
+	 * that are not co-located with it would require repartitioning. Instead,
+	 * we convert the small tables into intermediate results, which are sent
+	 * to all the nodes, such that the large table does not need to move.
+	 */
+	List *broadcastTableList = SmallDistributedTablesToBroadcast(query, context);
+	if (broadcastTableList != NIL)
+	{
+		RecursivelyPlanSmallDistributedTables(query, broadcastTableList, context);
+	}
+
 	/*
 	 * Similarly, logical planner cannot handle outer joins when the outer rel
 	 * is recurring, such as "<recurring> LEFT JOIN <distributed>". In that case,
@@ -481,6 +516,134 @@ ShouldRecursivelyPlanOuterJoins(RecursivePlanningContext *context)
 }
 
 
+/*
+ * SmallDistributedTablesToBroadcast returns the range table entries of the
+ * hash distributed tables in the query that are not co-located with the
+ * largest distributed table in the query, if all of them are smaller than
+ * citus.broadcast_join_threshold. Otherwise, or if the sizes of the tables are
+ * not known, it returns NIL.
+ *
+ * The sizes are those recorded in the shard metadata by
+ * citus_update_table_statistics, hence tables whose statistics were never
+ * updated are never broadcast.
+ */
+static List *
+SmallDistributedTablesToBroadcast(Query *query, RecursivePlanningContext *context)
+{
+	if (BroadcastJoinThreshold <= 0 || context->allDistributionKeysInQueryAreEqual)
+	{
+		return NIL;
+	}
+
+	/*
+	 * Broadcasting the inner side of an outer join would make the outer side
+	 * recurring, which is then recursively planned as well, so we only handle
+	 * SELECT queries with inner joins.
+	 */
+	if (query->commandType != CMD_SELECT || ShouldRecursivelyPlanOuterJoins(context))
+	{
+		return NIL;
+	}
+
+	List *distributedTableList = NIL;
+	RangeTblEntry *largestTable = NULL;
+	uint64 largestTableSize = 0;
+
+	RangeTblEntry *rangeTableEntry = NULL;
+	foreach_ptr(rangeTableEntry, query->rtable)
+	{
+		if (!IsRecursivelyPlannableRelation(rangeTableEntry) ||
+			!IsCitusTableType(rangeTableEntry->relid, DISTRIBUTED_TABLE))
+		{
+			continue;
+		}
+
+		if (!IsCitusTableType(rangeTableEntry->relid, HASH_DISTRIBUTED))
+		{
+			/* co-location is only defined for hash distributed tables */
+			return NIL;
+		}
+
+		uint64 tableSize = EstimatedTableSize(rangeTableEntry->relid);
+		if (largestTable == NULL || tableSize > largestTableSize)
+		{
+			largestTable = rangeTableEntry;
+			largestTableSize = tableSize;
+		}
+
+		distributedTableList = lappend(distributedTableList, rangeTableEntry);
+	}
+
+	if (list_length(distributedTableList) < 2)
+	{
+		return NIL;
+	}
+
+	uint32 anchorColocationId = TableColocationId(largestTable->relid);
+	uint64 thresholdBytes = (uint64) BroadcastJoinThreshold * 1024;
+	List *broadcastTableList = NIL;
+
+	foreach_ptr(rangeTableEntry, distributedTableList)
+	{
+		if (TableColocationId(rangeTableEntry->relid) == anchorColocationId)
+		{
+			continue;
+		}
+
+		uint64 tableSize = EstimatedTableSize(rangeTableEntry->relid);
+		if (tableSize == 0 || tableSize > thresholdBytes)
+		{
+			/* we would still need to repartition, let the logical planner decide */
+			return NIL;
+		}
+
+		broadcastTableList = lappend(broadcastTableList, rangeTableEntry);
+	}
+
+	return broadcastTableList;
+}
+
+
+/*
+ * RecursivelyPlanSmallDistributedTables converts the given distributed tables
+ * into subqueries and recursively plans them. The intermediate results are
+ * sent to all the nodes that execute the remaining, co-located part of the
+ * query.
+ */
+static void
+RecursivelyPlanSmallDistributedTables(Query *query, List *rangeTableEntryList,
+									  RecursivePlanningContext *context)
+{
+	PlannerRestrictionContext *restrictionContext =
+		GetPlannerRestrictionContext(context);
+
+	RangeTblEntry *rangeTableEntry = NULL;
+	foreach_ptr(rangeTableEntry, rangeTableEntryList)
+	{
+		ereport(DEBUG1, (errmsg("recursively planning distributed relation %s "
+								"since it is small enough to be broadcast",
+								GetRelationNameAndAliasName(rangeTableEntry))));
+
+		List *requiredAttributes =
+			RequiredAttrNumbersForRelation(rangeTableEntry, restrictionContext);
+
+#if PG_VERSION_NUM >= PG_VERSION_16
+		RTEPermissionInfo *perminfo = NULL;
+		if (rangeTableEntry->perminfoindex)
+		{
+			perminfo = getRTEPermissionInfo(query->rteperminfos, rangeTableEntry);
+		}
+
+		ReplaceRTERelationWithRteSubquery(rangeTableEntry, requiredAttributes,
+										  context, perminfo);
+#else
+		ReplaceRTERelationWithRteSubquery(rangeTableEntry, requiredAttributes,
+										  context, NULL);
+#endif
+	}
+}
+
+
 /*
  * RecursivelyPlanNonColocatedSubqueries gets a query which includes one or more
  * other subqueries that are not joined on their distribution keys. The function
@@ -1146,11 +1309,12 @@ RecursivelyPlanCTEs(Query *query, RecursivePlanningContext *planningContext)
 		}
 
 		/* build a sub plan for the CTE */
-		DistributedSubPlan *subPlan = CreateDistributedSubPlan(subPlanId, subquery);
+		DistributedSubPlan *subPlan =
+			CreateDistributedSubPlan(subPlanId, subquery, planningContext->subPlanList);
 		planningContext->subPlanList = lappend(planningContext->subPlanList, subPlan);
 
 		/* build the result_id parameter for the call to read_intermediate_result */
-		char *resultId = GenerateResultId(planId, subPlanId);
+		char *resultId = SubPlanResultId(planId, subPlan);
 
 		if (subquery->returningList)
 		{
@@ -1540,11 +1704,12 @@ RecursivelyPlanSubquery(Query *subquery, RecursivePlanningContext *planningConte
 	 */
 	int subPlanId = list_length(planningContext->subPlanList) + 1;
 
-	DistributedSubPlan *subPlan = CreateDistributedSubPlan(subPlanId, subquery);
+	DistributedSubPlan *subPlan =
+		CreateDistributedSubPlan(subPlanId, subquery, planningContext->subPlanList);
 	planningContext->subPlanList = lappend(planningContext->subPlanList, subPlan);
 
 	/* build the result_id parameter for the call to read_intermediate_result */
-	char *resultId = GenerateResultId(planId, subPlanId);
+	char *resultId = SubPlanResultId(planId, subPlan);
 
 	/*
 	 * BuildSubPlanResultQuery() can optionally use provided column aliases.
@@ -1575,7 +1740,8 @@ RecursivelyPlanSubquery(Query *subquery, RecursivePlanningContext *planningConte
  * distributed plan, which can itself contain subplans.
  */
 static DistributedSubPlan *
-CreateDistributedSubPlan(uint32 subPlanId, Query *subPlanQuery)
+CreateDistributedSubPlan(uint32 subPlanId, Query *subPlanQuery,
+						 List *earlierSubPlanList)
 {
 	int cursorOptions = 0;
 
@@ -1593,6 +1759,15 @@ CreateDistributedSubPlan(uint32 subPlanId, Query *subPlanQuery)
 	}
 
 	DistributedSubPlan *subPlan = CitusMakeNode(DistributedSubPlan);
+
+	if (EnableSubPlanResultReuse &&
+		SubPlanQueryIsReusable(subPlanQuery, earlierSubPlanList,
+							   &subPlan->relationIdList))
+	{
+		/* the planner scribbles on the query, so we deparse it beforehand */
+		subPlan->reusableResultId = ReusableSubPlanResultId(subPlanQuery);
+	}
+
 	subPlan->plan = planner(subPlanQuery, NULL, cursorOptions, NULL);
 	subPlan->subPlanId = subPlanId;
 
@@ -1600,6 +1775,119 @@ CreateDistributedSubPlan(uint32 subPlanId, Query *subPlanQuery)
 }
 
 
+/*
+ * SubPlanQueryIsReusable returns whether the result of the given subplan
+ * query only depends on the query itself and the tables that it reads, such
+ * that a later subplan with the same query in the same transaction can reuse
+ * the result. That rules out modifications, row locks, volatile functions,
+ * parameters and reading intermediate results other than the reusable
+ * results of the earlier subplans. If the result is reusable, the function
+ * sets relationIdList to the tables that the query reads, including the ones
+ * that the reused results of earlier subplans read.
+ */
+static bool
+SubPlanQueryIsReusable(Query *subPlanQuery, List *earlierSubPlanList,
+					   List **relationIdList)
+{
+	List *rangeTableList = NIL;
+
+	if (subPlanQuery->commandType != CMD_SELECT || subPlanQuery->hasModifyingCTE ||
+		subPlanQuery->rowMarks != NIL)
+	{
+		return false;
+	}
+
+	if (contain_volatile_functions((Node *) subPlanQuery) ||
+		FindNodeMatchingCheckFunction((Node *) subPlanQuery, IsExternParam) ||
+		ContainsReadIntermediateResultArrayFunction((Node *) subPlanQuery))
+	{
+		return false;
+	}
+
+	ExtractRangeTableEntryWalker((Node *) subPlanQuery, &rangeTableList);
+
+	RangeTblEntry *rangeTableEntry = NULL;
+	foreach_ptr(rangeTableEntry, rangeTableList)
+	{
+		if (rangeTableEntry->rtekind == RTE_RELATION)
+		{
+			*relationIdList = list_append_unique_oid(*relationIdList,
+													 rangeTableEntry->relid);
+			continue;
+		}
+
+		if (rangeTableEntry->rtekind != RTE_FUNCTION)
+		{
+			continue;
+		}
+
+		char *resultId = FindIntermediateResultIdIfExists(rangeTableEntry);
+		if (resultId == NULL)
+		{
+			continue;
+		}
+
+		DistributedSubPlan *readSubPlan = NULL;
+		DistributedSubPlan *earlierSubPlan = NULL;
+		foreach_ptr(earlierSubPlan, earlierSubPlanList)
+		{
+			if (earlierSubPlan->reusableResultId != NULL &&
+				strcmp(earlierSubPlan->reusableResultId, resultId) == 0)
+			{
+				readSubPlan = earlierSubPlan;
+				break;
+			}
+		}
+
+		if (readSubPlan == NULL)
+		{
+			/* the result may differ in the next statement */
+			*relationIdList = NIL;
+			return false;
+		}
+
+		*relationIdList = list_concat_unique_oid(*relationIdList,
+												 readSubPlan->relationIdList);
+	}
+
+	return true;
+}
+
+
+/*
+ * IsExternParam returns whether the given node is a parameter of the query.
+ */
+static bool
+IsExternParam(Node *node)
+{
+	return IsA(node, Param) && ((Param *) node)->paramkind == PARAM_EXTERN;
+}
+
+
+/*
+ * ReusableSubPlanResultId returns the ID of the intermediate result of the
+ * given reusable subplan query, which is derived from the deparsed query and
+ * the current user, since row level security policies depend on the user.
+ * Subplans with the same query therefore write the same intermediate result.
+ */
+static char *
+ReusableSubPlanResultId(Query *subPlanQuery)
+{
+	StringInfo reuseKey = makeStringInfo();
+	StringInfo resultId = makeStringInfo();
+
+	appendStringInfo(reuseKey, "%u:", GetUserId());
+	pg_get_query_def(subPlanQuery, reuseKey);
+
+	uint64 reuseKeyHash = hash_bytes_extended((unsigned char *) reuseKey->data,
+											  reuseKey->len, 0);
+
+	appendStringInfo(resultId, "reuse_" UINT64_FORMAT, reuseKeyHash);
+
+	return resultId->data;
+}
+
+
 /*
  * CteReferenceListWalker finds all references to CTEs in the top level of a query
  * and adds them to context->cteReferenceList.
@@ -2451,6 +2739,22 @@ GenerateResultId(uint64 planId, uint32 subPlanId)
 }
 
 
+/*
+ * SubPlanResultId returns the ID of the intermediate result of the given
+ * subplan of the plan with the given ID.
+ */
+char *
+SubPlanResultId(uint64 planId, DistributedSubPlan *subPlan)
+{
+	if (subPlan->reusableResultId != NULL)
+	{
+		return subPlan->reusableResultId;
+	}
+
+	return GenerateResultId(planId, subPlan->subPlanId);
+}
+
+
 /*
  * GeneratingSubplans returns true if we are currently in the process of
  * generating subplans.
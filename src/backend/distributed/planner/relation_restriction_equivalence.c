@@ -25,12 +25,14 @@
 
 #include "distributed/colocation_utils.h"
 #include "distributed/distributed_planner.h"
+#include "distributed/hash_helpers.h"
 #include "distributed/listutils.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/multi_logical_optimizer.h"
 #include "distributed/multi_logical_planner.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/pg_dist_partition.h"
+#include "distributed/planning_times.h"
 #include "distributed/query_utils.h"
 #include "distributed/relation_restriction_equivalence.h"
 #include "distributed/shard_pruning.h"
@@ -83,6 +85,34 @@ typedef struct AttributeEquivalenceClassMember
 	AttrNumber varattno;
 } AttributeEquivalenceClassMember;
 
+/*
+ * AttributeEquivalenceMemberKey identifies an AttributeEquivalenceClassMember
+ * the same way AttributeEquivalenceClassMembers are compared, by rteIdentity
+ * and varattno.
+ */
+typedef struct AttributeEquivalenceMemberKey
+{
+	int rteIdentity;
+	int varattno;
+} AttributeEquivalenceMemberKey;
+
+assert_valid_hash_key2(AttributeEquivalenceMemberKey, rteIdentity, varattno);
+
+/*
+ * AttributeEquivalenceMemberEntry is a node of the disjoint-set forest that
+ * GenerateCommonEquivalence() uses to merge the attribute equivalence classes.
+ * All entries whose parents lead to the same root are equivalent.
+ */
+typedef struct AttributeEquivalenceMemberEntry
+{
+	AttributeEquivalenceMemberKey key;
+	struct AttributeEquivalenceMemberEntry *parent;
+	int rank;
+
+	/* the first member that we have seen with this key */
+	AttributeEquivalenceClassMember *member;
+} AttributeEquivalenceMemberEntry;
+
 
 static bool ContextContainsLocalRelation(RelationRestrictionContext *restrictionContext);
 static bool ContextContainsAppendRelation(RelationRestrictionContext *restrictionContext);
@@ -126,17 +156,9 @@ static Var * GetVarFromAssignedParam(List *outerPlanParamsList, Param *plannerPa
 static Var * SearchPlannerParamList(List *plannerParamList, Param *plannerParam);
 static List * GenerateAttributeEquivalencesForJoinRestrictions(JoinRestrictionContext
 															   *joinRestrictionContext);
-static bool AttributeClassContainsAttributeClassMember(AttributeEquivalenceClassMember *
-													   inputMember,
-													   AttributeEquivalenceClass *
-													   attributeEquivalenceClass);
 static List * AddAttributeClassToAttributeClassList(List *attributeEquivalenceList,
 													AttributeEquivalenceClass *
 													attributeEquivalence);
-static bool AttributeEquivalencesAreEqual(AttributeEquivalenceClass *
-										  firstAttributeEquivalence,
-										  AttributeEquivalenceClass *
-										  secondAttributeEquivalence);
 static AttributeEquivalenceClass * GenerateCommonEquivalence(List *
 															 attributeEquivalenceList,
 															 RelationRestrictionContext *
@@ -145,10 +167,14 @@ static AttributeEquivalenceClass * GenerateEquivalenceClassForRelationRestrictio
 	RelationRestrictionContext
 	*
 	relationRestrictionContext);
-static void ListConcatUniqueAttributeClassMemberLists(AttributeEquivalenceClass *
-													  firstClass,
-													  AttributeEquivalenceClass *
-													  secondClass);
+static AttributeEquivalenceMemberEntry * AttributeEquivalenceMemberEntryForMember(
+	HTAB *memberEntryHash, AttributeEquivalenceClassMember *member,
+	List **memberEntryList);
+static AttributeEquivalenceMemberEntry * FindAttributeEquivalenceRoot(
+	AttributeEquivalenceMemberEntry *memberEntry);
+static void UnionAttributeEquivalenceMembers(AttributeEquivalenceMemberEntry *firstEntry,
+											 AttributeEquivalenceMemberEntry *
+											 secondEntry);
 static Var * PartitionKeyForRTEIdentityInQuery(Query *query, int targetRTEIndex,
 											   Index *partitionKeyIndex);
 static bool AllDistributedRelationsInRestrictionContextColocated(
@@ -529,10 +555,18 @@ RestrictionEquivalenceForPartitionKeys(PlannerRestrictionContext *restrictionCon
 		return false;
 	}
 
+	DistributedPlanningPhase previousPhase =
+		BeginPlanningPhase(PLANNING_PHASE_PUSHDOWN_CHECK);
+
 	List *attributeEquivalenceList = GenerateAllAttributeEquivalences(restrictionContext);
 
-	return RestrictionEquivalenceForPartitionKeysViaEquivalences(restrictionContext,
-																 attributeEquivalenceList);
+	bool partitionKeysEquivalent =
+		RestrictionEquivalenceForPartitionKeysViaEquivalences(restrictionContext,
+															  attributeEquivalenceList);
+
+	EndPlanningPhase(previousPhase);
+
+	return partitionKeysEquivalent;
 }
 
 
@@ -637,7 +671,7 @@ UniqueRelationCount(RelationRestrictionContext *restrictionContext, CitusTableTy
 					tableType)
 {
 	ListCell *relationRestrictionCell = NULL;
-	List *rteIdentityList = NIL;
+	Bitmapset *rteIdentities = NULL;
 
 	foreach(relationRestrictionCell, restrictionContext->relationRestrictionList)
 	{
@@ -655,11 +689,11 @@ UniqueRelationCount(RelationRestrictionContext *restrictionContext, CitusTableTy
 		if (IsCitusTableTypeCacheEntry(cacheEntry, tableType))
 		{
 			int rteIdentity = GetRTEIdentity(relationRestriction->rte);
-			rteIdentityList = list_append_unique_int(rteIdentityList, rteIdentity);
+			rteIdentities = bms_add_member(rteIdentities, rteIdentity);
 		}
 	}
 
-	return list_length(rteIdentityList);
+	return bms_num_members(rteIdentities);
 }
 
 
@@ -743,6 +777,7 @@ GenerateAttributeEquivalencesForRelationRestrictions(RelationRestrictionContext
 													 *restrictionContext)
 {
 	List *attributeEquivalenceList = NIL;
+	List *processedPlannerInfoList = NIL;
 	ListCell *relationRestrictionCell = NULL;
 
 	if (restrictionContext == NULL)
@@ -754,9 +789,27 @@ GenerateAttributeEquivalencesForRelationRestrictions(RelationRestrictionContext
 	{
 		RelationRestriction *relationRestriction =
 			(RelationRestriction *) lfirst(relationRestrictionCell);
-		List *equivalenceClasses = relationRestriction->plannerInfo->eq_classes;
+		PlannerInfo *plannerInfo = relationRestriction->plannerInfo;
+		List *equivalenceClasses = plannerInfo->eq_classes;
 		ListCell *equivalenceClassCell = NULL;
 
+		/*
+		 * All relations of a query level share the planner info and hence the
+		 * equivalence classes. Unless there are lateral references, which are
+		 * resolved via the outer plan params of the relation, the relations of
+		 * the same query level yield the same attribute equivalences, so we
+		 * only generate them once per query level.
+		 */
+		if (relationRestriction->outerPlanParamsList == NIL)
+		{
+			if (list_member_ptr(processedPlannerInfoList, plannerInfo))
+			{
+				continue;
+			}
+
+			processedPlannerInfoList = lappend(processedPlannerInfoList, plannerInfo);
+		}
+
 		foreach(equivalenceClassCell, equivalenceClasses)
 		{
 			EquivalenceClass *plannerEqClass =
@@ -933,27 +986,26 @@ SearchPlannerParamList(List *plannerParamList, Param *plannerParam)
  * GenerateCommonEquivalence gets a list of unrelated AttributeEquiavalenceClass
  * whose all members are partition keys.
  *
- * With the equivalence classes, the function follows the algorithm
- * outlined below:
+ * The common equivalence class consists of the members that are (transitively)
+ * equivalent to the partition key of the first distributed relation. Since
+ * the classes may share members in any order, we merge them using a disjoint-set
+ * forest with union by rank and path halving, which keeps the cost close to
+ * linear in the total number of members even for queries with many joins:
  *
- *     - Add the first equivalence class to the common equivalence class
- *     - Then, iterate on the remaining equivalence classes
- *          - If any of the members equal to the common equivalence class
- *            add all the members of the equivalence class to the common
- *            class
- *          - Start the iteration from the beginning. The reason is that
- *            in case any of the classes we've passed is equivalent to the
- *            newly added one. To optimize the algorithm, we utilze the
- *            equivalence class ids and skip the ones that are already added.
- *      - Finally, return the common equivalence class.
+ *     - Create a set per distinct member, where members are identified by
+ *       their rteIdentity and varattno
+ *     - Per equivalence class, merge the sets of all its members
+ *     - Finally, return the members that are in the same set as the
+ *       partition key of the first distributed relation.
  */
 static AttributeEquivalenceClass *
 GenerateCommonEquivalence(List *attributeEquivalenceList,
 						  RelationRestrictionContext *relationRestrictionContext)
 {
-	Bitmapset *addedEquivalenceIds = NULL;
 	uint32 equivalenceListSize = list_length(attributeEquivalenceList);
-	uint32 equivalenceClassIndex = 0;
+	List *memberEntryList = NIL;
+	ListCell *equivalenceClassCell = NULL;
+	ListCell *memberEntryCell = NULL;
 
 	AttributeEquivalenceClass *commonEquivalenceClass = palloc0(
 		sizeof(AttributeEquivalenceClass));
@@ -973,72 +1025,150 @@ GenerateCommonEquivalence(List *attributeEquivalenceList,
 		return commonEquivalenceClass;
 	}
 
-	commonEquivalenceClass->equivalentAttributes =
-		firstEquivalenceClass->equivalentAttributes;
-	addedEquivalenceIds = bms_add_member(addedEquivalenceIds,
-										 firstEquivalenceClass->equivalenceId);
+	HTAB *memberEntryHash = CreateSimpleHash(AttributeEquivalenceMemberKey,
+											 AttributeEquivalenceMemberEntry);
+
+	AttributeEquivalenceClassMember *firstMember =
+		(AttributeEquivalenceClassMember *) linitial(
+			firstEquivalenceClass->equivalentAttributes);
+	AttributeEquivalenceMemberEntry *firstMemberEntry =
+		AttributeEquivalenceMemberEntryForMember(memberEntryHash, firstMember,
+												 &memberEntryList);
 
-	while (equivalenceClassIndex < equivalenceListSize)
+	foreach(equivalenceClassCell, attributeEquivalenceList)
 	{
+		AttributeEquivalenceClass *currentEquivalenceClass =
+			(AttributeEquivalenceClass *) lfirst(equivalenceClassCell);
+		AttributeEquivalenceMemberEntry *classMemberEntry = NULL;
 		ListCell *equivalenceMemberCell = NULL;
-		bool restartLoop = false;
-
-		AttributeEquivalenceClass *currentEquivalenceClass = list_nth(
-			attributeEquivalenceList,
-			equivalenceClassIndex);
-
-		/*
-		 * This is an optimization. If we already added the same equivalence class,
-		 * we could skip it since we've already added all the relevant equivalence
-		 * members.
-		 */
-		if (bms_is_member(currentEquivalenceClass->equivalenceId, addedEquivalenceIds))
-		{
-			equivalenceClassIndex++;
-
-			continue;
-		}
 
 		foreach(equivalenceMemberCell, currentEquivalenceClass->equivalentAttributes)
 		{
-			AttributeEquivalenceClassMember *attributeEquialanceMember =
+			AttributeEquivalenceClassMember *attributeEquivalenceMember =
 				(AttributeEquivalenceClassMember *) lfirst(equivalenceMemberCell);
+			AttributeEquivalenceMemberEntry *memberEntry =
+				AttributeEquivalenceMemberEntryForMember(memberEntryHash,
+														 attributeEquivalenceMember,
+														 &memberEntryList);
 
-			if (AttributeClassContainsAttributeClassMember(attributeEquialanceMember,
-														   commonEquivalenceClass))
+			if (classMemberEntry == NULL)
 			{
-				ListConcatUniqueAttributeClassMemberLists(commonEquivalenceClass,
-														  currentEquivalenceClass);
-
-				addedEquivalenceIds = bms_add_member(addedEquivalenceIds,
-													 currentEquivalenceClass->
-													 equivalenceId);
-
-				/*
-				 * It seems inefficient to start from the beginning.
-				 * But, we should somehow restart from the beginning to test that
-				 * whether the already skipped ones are equal or not.
-				 */
-				restartLoop = true;
-
-				break;
+				classMemberEntry = memberEntry;
+			}
+			else
+			{
+				UnionAttributeEquivalenceMembers(classMemberEntry, memberEntry);
 			}
 		}
+	}
 
-		if (restartLoop)
-		{
-			equivalenceClassIndex = 0;
-		}
-		else
+	/* collect the members that are equivalent to the first partition key */
+	AttributeEquivalenceMemberEntry *commonRoot =
+		FindAttributeEquivalenceRoot(firstMemberEntry);
+
+	foreach(memberEntryCell, memberEntryList)
+	{
+		AttributeEquivalenceMemberEntry *memberEntry =
+			(AttributeEquivalenceMemberEntry *) lfirst(memberEntryCell);
+
+		if (FindAttributeEquivalenceRoot(memberEntry) == commonRoot)
 		{
-			++equivalenceClassIndex;
+			commonEquivalenceClass->equivalentAttributes =
+				lappend(commonEquivalenceClass->equivalentAttributes,
+						memberEntry->member);
 		}
 	}
 
+	hash_destroy(memberEntryHash);
+
 	return commonEquivalenceClass;
 }
 
 
+/*
+ * AttributeEquivalenceMemberEntryForMember returns the disjoint-set entry of
+ * the given member. If there is no entry for it yet, the function creates a
+ * new set that only contains the member and appends it to memberEntryList.
+ */
+static AttributeEquivalenceMemberEntry *
+AttributeEquivalenceMemberEntryForMember(HTAB *memberEntryHash,
+										 AttributeEquivalenceClassMember *member,
+										 List **memberEntryList)
+{
+	AttributeEquivalenceMemberKey key;
+	bool found = false;
+
+	memset(&key, 0, sizeof(key));
+	key.rteIdentity = member->rteIdentity;
+	key.varattno = member->varattno;
+
+	AttributeEquivalenceMemberEntry *memberEntry =
+		hash_search(memberEntryHash, &key, HASH_ENTER, &found);
+
+	if (!found)
+	{
+		memberEntry->parent = memberEntry;
+		memberEntry->rank = 0;
+		memberEntry->member = member;
+
+		*memberEntryList = lappend(*memberEntryList, memberEntry);
+	}
+
+	return memberEntry;
+}
+
+
+/*
+ * FindAttributeEquivalenceRoot returns the root of the set that the given entry
+ * belongs to. While walking up, it makes every other entry on the path point to
+ * its grandparent to keep the trees flat.
+ */
+static AttributeEquivalenceMemberEntry *
+FindAttributeEquivalenceRoot(AttributeEquivalenceMemberEntry *memberEntry)
+{
+	while (memberEntry->parent != memberEntry)
+	{
+		memberEntry->parent = memberEntry->parent->parent;
+		memberEntry = memberEntry->parent;
+	}
+
+	return memberEntry;
+}
+
+
+/*
+ * UnionAttributeEquivalenceMembers merges the sets that the given entries
+ * belong to, attaching the lower ranked tree below the other one.
+ */
+static void
+UnionAttributeEquivalenceMembers(AttributeEquivalenceMemberEntry *firstEntry,
+								 AttributeEquivalenceMemberEntry *secondEntry)
+{
+	AttributeEquivalenceMemberEntry *firstRoot = FindAttributeEquivalenceRoot(firstEntry);
+	AttributeEquivalenceMemberEntry *secondRoot =
+		FindAttributeEquivalenceRoot(secondEntry);
+
+	if (firstRoot == secondRoot)
+	{
+		return;
+	}
+
+	if (firstRoot->rank < secondRoot->rank)
+	{
+		firstRoot->parent = secondRoot;
+	}
+	else if (firstRoot->rank > secondRoot->rank)
+	{
+		secondRoot->parent = firstRoot;
+	}
+	else
+	{
+		secondRoot->parent = firstRoot;
+		firstRoot->rank++;
+	}
+}
+
+
 /*
  * GenerateEquivalenceClassForRelationRestriction generates an AttributeEquivalenceClass
  * with a single AttributeEquivalenceClassMember.
@@ -1077,38 +1207,6 @@ GenerateEquivalenceClassForRelationRestriction(
 }
 
 
-/*
- * ListConcatUniqueAttributeClassMemberLists gets two attribute equivalence classes. It
- * basically concatenates attribute equivalence member lists uniquely and updates the
- * firstClass' member list with the list.
- *
- * Basically, the function iterates over the secondClass' member list and checks whether
- * it already exists in the firstClass' member list. If not, the member is added to the
- * firstClass.
- */
-static void
-ListConcatUniqueAttributeClassMemberLists(AttributeEquivalenceClass *firstClass,
-										  AttributeEquivalenceClass *secondClass)
-{
-	ListCell *equivalenceClassMemberCell = NULL;
-	List *equivalenceMemberList = secondClass->equivalentAttributes;
-
-	foreach(equivalenceClassMemberCell, equivalenceMemberList)
-	{
-		AttributeEquivalenceClassMember *newEqMember =
-			(AttributeEquivalenceClassMember *) lfirst(equivalenceClassMemberCell);
-
-		if (AttributeClassContainsAttributeClassMember(newEqMember, firstClass))
-		{
-			continue;
-		}
-
-		firstClass->equivalentAttributes = lappend(firstClass->equivalentAttributes,
-												   newEqMember);
-	}
-}
-
-
 /*
  * GenerateAttributeEquivalencesForJoinRestrictions gets a join restriction
  * context and returns a list of AttrributeEquivalenceClass.
@@ -1623,32 +1721,6 @@ AddRteRelationToAttributeEquivalenceClass(AttributeEquivalenceClass *
 }
 
 
-/*
- * AttributeClassContainsAttributeClassMember returns true if it the input class member
- * is already exists in the attributeEquivalenceClass. An equality is identified by the
- * varattno and rteIdentity.
- */
-static bool
-AttributeClassContainsAttributeClassMember(AttributeEquivalenceClassMember *inputMember,
-										   AttributeEquivalenceClass *
-										   attributeEquivalenceClass)
-{
-	ListCell *classCell = NULL;
-	foreach(classCell, attributeEquivalenceClass->equivalentAttributes)
-	{
-		AttributeEquivalenceClassMember *memberOfClass =
-			(AttributeEquivalenceClassMember *) lfirst(classCell);
-		if (memberOfClass->rteIdentity == inputMember->rteIdentity &&
-			memberOfClass->varattno == inputMember->varattno)
-		{
-			return true;
-		}
-	}
-
-	return false;
-}
-
-
 /*
  * AddAttributeClassToAttributeClassList checks for certain properties of the
  * input attributeEquivalence before adding it to the attributeEquivalenceList.
@@ -1656,15 +1728,15 @@ AttributeClassContainsAttributeClassMember(AttributeEquivalenceClassMember *inpu
  * Firstly, the function skips adding NULL attributeEquivalence to the list.
  * Secondly, since an attribute equivalence class with a single member does
  * not contribute to our purposes, we skip such classed adding to the list.
- * Finally, we don't want to add an equivalence class whose exact equivalent
- * already exists in the list.
+ *
+ * Note that we don't check whether the list already contains an equivalent
+ * class, since doing so is quadratic in the number of join restrictions and
+ * GenerateCommonEquivalence() merges duplicate classes cheaply anyway.
  */
 static List *
 AddAttributeClassToAttributeClassList(List *attributeEquivalenceList,
 									  AttributeEquivalenceClass *attributeEquivalence)
 {
-	ListCell *attributeEquivalenceCell = NULL;
-
 	if (attributeEquivalence == NULL)
 	{
 		return attributeEquivalenceList;
@@ -1680,19 +1752,6 @@ AddAttributeClassToAttributeClassList(List *attributeEquivalenceList,
 		return attributeEquivalenceList;
 	}
 
-	/* we don't want to add an attributeEquivalence which already exists */
-	foreach(attributeEquivalenceCell, attributeEquivalenceList)
-	{
-		AttributeEquivalenceClass *currentAttributeEquivalence =
-			(AttributeEquivalenceClass *) lfirst(attributeEquivalenceCell);
-
-		if (AttributeEquivalencesAreEqual(currentAttributeEquivalence,
-										  attributeEquivalence))
-		{
-			return attributeEquivalenceList;
-		}
-	}
-
 	attributeEquivalenceList = lappend(attributeEquivalenceList,
 									   attributeEquivalence);
 
@@ -1700,58 +1759,6 @@ AddAttributeClassToAttributeClassList(List *attributeEquivalenceList,
 }
 
 
-/*
- *  AttributeEquivalencesAreEqual returns true if both input attribute equivalence
- *  classes contains exactly the same members.
- */
-static bool
-AttributeEquivalencesAreEqual(AttributeEquivalenceClass *firstAttributeEquivalence,
-							  AttributeEquivalenceClass *secondAttributeEquivalence)
-{
-	List *firstEquivalenceMemberList =
-		firstAttributeEquivalence->equivalentAttributes;
-	List *secondEquivalenceMemberList =
-		secondAttributeEquivalence->equivalentAttributes;
-	ListCell *firstAttributeEquivalenceCell = NULL;
-	ListCell *secondAttributeEquivalenceCell = NULL;
-
-	if (list_length(firstEquivalenceMemberList) != list_length(
-			secondEquivalenceMemberList))
-	{
-		return false;
-	}
-
-	foreach(firstAttributeEquivalenceCell, firstEquivalenceMemberList)
-	{
-		AttributeEquivalenceClassMember *firstEqMember =
-			(AttributeEquivalenceClassMember *) lfirst(firstAttributeEquivalenceCell);
-		bool foundAnEquivalentMember = false;
-
-		foreach(secondAttributeEquivalenceCell, secondEquivalenceMemberList)
-		{
-			AttributeEquivalenceClassMember *secondEqMember =
-				(AttributeEquivalenceClassMember *) lfirst(
-					secondAttributeEquivalenceCell);
-
-			if (firstEqMember->rteIdentity == secondEqMember->rteIdentity &&
-				firstEqMember->varattno == secondEqMember->varattno)
-			{
-				foundAnEquivalentMember = true;
-				break;
-			}
-		}
-
-		/* we couldn't find an equivalent member */
-		if (!foundAnEquivalentMember)
-		{
-			return false;
-		}
-	}
-
-	return true;
-}
-
-
 /*
  * ContainsUnionSubquery gets a queryTree and returns true if the query
  * contains
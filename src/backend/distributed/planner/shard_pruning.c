@@ -76,6 +76,7 @@
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
 #include "optimizer/planner.h"
+#include "optimizer/predtest.h"
 #include "parser/parse_coerce.h"
 #include "utils/arrayaccess.h"
 #include "utils/catcache.h"
@@ -99,6 +100,33 @@
 #include "distributed/worker_protocol.h"
 
 
+/*
+ * Minimum number of elements of the array of a <distribution column> =
+ * ANY(<constant array>) restriction for it to be reduced to the elements that
+ * belong to the shard of each task, -1 disables it.
+ */
+int ArrayRestrictionSplitThreshold = 100;
+
+/*
+ * Whether to prune the shards that cannot have rows matching the restrictions
+ * of a query according to the statistics in pg_dist_shard_column_stats.
+ */
+bool EnableShardColumnStatisticsPruning = false;
+
+
+/*
+ * ArraySplitContext is the context of the walker that reduces the arrays of
+ * <distribution column> = ANY(<constant array>) restrictions to the elements
+ * of the shards in relationShardList. If relationShardList is NIL, the walker
+ * only records whether there are arrays that would be reduced.
+ */
+typedef struct ArraySplitContext
+{
+	List *relationShardList;
+	bool hasArrayToSplit;
+} ArraySplitContext;
+
+
 /*
  * Tree node for compact representation of the given query logical tree.
  * Represent a single boolean operator node and its associated
@@ -294,6 +322,20 @@ static OpExpr * SAORestrictionArrayEqualityOp(ScalarArrayOpExpr *arrayOperatorEx
 static void DebugLogNode(char *fmt, Node *node, List *deparseCtx);
 static void DebugLogPruningInstance(PruningInstance *pruning, List *deparseCtx);
 static int ConstraintCount(PruningTreeNode *node);
+static bool SplitArrayRestrictionsByShardWalker(Node *node,
+												ArraySplitContext *context);
+static Node * SplitArrayRestrictionByShard(Node *clause, Query *query,
+										   ArraySplitContext *context);
+static ScalarArrayOpExpr * SingleHashedSAORestriction(PruningTreeNode *tree,
+													  Var *partitionColumn);
+static bool ShardColumnStatisticsRefuteClauses(ShardColumnStatistics *shardStatistics,
+											   Index rangeTableId, List *clauseList);
+static Expr * ShardColumnValueRangeConstraint(ShardColumnValueRange *valueRange,
+											  Index rangeTableId);
+static List * PruneHashedSAORestriction(CitusTableCacheEntry *cacheEntry,
+										ClauseWalkerContext *context,
+										ScalarArrayOpExpr *arrayOperatorExpression,
+										Const **singlePartitionValueConst);
 
 
 /*
@@ -385,6 +427,35 @@ PruneShards(Oid relationId, Index rangeTableId, List *whereClauseList,
 	/* Simplify logic tree of prunable restrictions */
 	SimplifyPruningTree(tree, NULL);
 
+	/*
+	 * A lone <partition column> = ANY(<constant array>) restriction on a hash
+	 * distributed table, as commonly used with large IN lists, does not need
+	 * a pruning instance per array element. We hash the elements directly to
+	 * shard indexes instead. We take the regular path when debug logging the
+	 * pruning instances.
+	 */
+	ScalarArrayOpExpr *hashedArrayOperatorExpression = NULL;
+	if (partitionMethod == DISTRIBUTE_BY_HASH && !IsLoggableLevel(DEBUG3))
+	{
+		hashedArrayOperatorExpression =
+			SingleHashedSAORestriction(tree, context.partitionColumn);
+	}
+
+	if (hashedArrayOperatorExpression != NULL)
+	{
+		prunedList = PruneHashedSAORestriction(cacheEntry, &context,
+											   hashedArrayOperatorExpression,
+											   &singlePartitionValueConst);
+
+		if (partitionValueConst != NULL)
+		{
+			*partitionValueConst = singlePartitionValueConst != NULL ?
+								   copyObject(singlePartitionValueConst) : NULL;
+		}
+
+		return DeepCopyShardIntervalList(prunedList);
+	}
+
 	/* Figure out what we can prune on */
 	PrunableExpressions(tree, &context);
 
@@ -521,6 +592,400 @@ PruneShards(Oid relationId, Index rangeTableId, List *whereClauseList,
 }
 
 
+/*
+ * PruneShardsByColumnStatistics removes the shards from the given list of
+ * shards of a relation that cannot have any rows matching the restrictions in
+ * whereClauseList according to their statistics in pg_dist_shard_column_stats:
+ * the shards that are empty, and the shards for which the ranges of values of
+ * the columns contradict the restrictions, e.g. because all values of a
+ * created_at column are before the time range that is queried.
+ */
+List *
+PruneShardsByColumnStatistics(Oid relationId, Index rangeTableId,
+							  List *whereClauseList, List *shardIntervalList)
+{
+	CitusTableCacheEntry *cacheEntry = GetCitusTableCacheEntry(relationId);
+	ShardColumnStatistics **statisticsArray = GetShardColumnStatisticsArray(cacheEntry);
+	if (statisticsArray == NULL)
+	{
+		return shardIntervalList;
+	}
+
+	/* restrictions with volatile functions cannot refute anything */
+	List *pruningClauseList = NIL;
+	Node *whereClause = NULL;
+	foreach_ptr(whereClause, whereClauseList)
+	{
+		if (!contain_volatile_functions(whereClause))
+		{
+			pruningClauseList = lappend(pruningClauseList, whereClause);
+		}
+	}
+
+	List *remainingShardList = NIL;
+	int prunedShardCount = 0;
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		int shardIndex = shardInterval->shardIndex;
+
+		if (shardIndex >= 0 && shardIndex < cacheEntry->shardIntervalArrayLength &&
+			statisticsArray[shardIndex] != NULL &&
+			ShardColumnStatisticsRefuteClauses(statisticsArray[shardIndex],
+											   rangeTableId, pruningClauseList))
+		{
+			prunedShardCount++;
+			continue;
+		}
+
+		remainingShardList = lappend(remainingShardList, shardInterval);
+	}
+
+	if (prunedShardCount > 0)
+	{
+		ereport(DEBUG2, (errmsg("pruned %d shards of %s using shard column statistics",
+								prunedShardCount, get_rel_name(relationId))));
+	}
+
+	return remainingShardList;
+}
+
+
+/*
+ * ShardColumnStatisticsRefuteClauses returns whether no row of a shard with
+ * the given statistics can satisfy all of the clauses in clauseList.
+ */
+static bool
+ShardColumnStatisticsRefuteClauses(ShardColumnStatistics *shardStatistics,
+								   Index rangeTableId, List *clauseList)
+{
+	if (shardStatistics->rowCount == 0)
+	{
+		return true;
+	}
+
+	if (clauseList == NIL || shardStatistics->columnValueRangeList == NIL)
+	{
+		return false;
+	}
+
+	/*
+	 * The statistics imply a constraint on each column, much like a CHECK
+	 * constraint, so we can use the same proof as constraint exclusion.
+	 */
+	List *constraintList = NIL;
+	ShardColumnValueRange *valueRange = NULL;
+	foreach_ptr(valueRange, shardStatistics->columnValueRangeList)
+	{
+		constraintList = lappend(constraintList,
+								 ShardColumnValueRangeConstraint(valueRange,
+																 rangeTableId));
+	}
+
+	bool weakRefutation = false;
+	return predicate_refuted_by(constraintList, clauseList, weakRefutation);
+}
+
+
+/*
+ * ShardColumnValueRangeConstraint returns the constraint that all values of a
+ * column in a shard satisfy, i.e. column >= min AND column <= max, possibly
+ * OR'ed with column IS NULL.
+ */
+static Expr *
+ShardColumnValueRangeConstraint(ShardColumnValueRange *valueRange, Index rangeTableId)
+{
+	Var *column = makeVar(rangeTableId, valueRange->attributeNumber,
+						  valueRange->columnType, valueRange->columnTypeMod,
+						  valueRange->columnCollation, 0);
+
+	NullTest *nullTest = makeNode(NullTest);
+	nullTest->arg = (Expr *) column;
+	nullTest->nulltesttype = IS_NULL;
+	nullTest->argisrow = false;
+	nullTest->location = -1;
+
+	if (valueRange->minValue == NULL)
+	{
+		/* all values of the column are NULL */
+		return (Expr *) nullTest;
+	}
+
+	/* compare the column the way the parser would, e.g. varchar as text */
+	Expr *operand = (Expr *) column;
+	if (valueRange->operatorInputType != valueRange->columnType &&
+		!IsPolymorphicType(valueRange->operatorInputType))
+	{
+		operand = (Expr *) makeRelabelType((Expr *) column,
+										   valueRange->operatorInputType, -1,
+										   valueRange->columnCollation,
+										   COERCE_IMPLICIT_CAST);
+	}
+
+	Expr *lowerBound = make_opclause(valueRange->greaterEqualOperator, BOOLOID, false,
+									 operand, (Expr *) copyObject(valueRange->minValue),
+									 InvalidOid, valueRange->columnCollation);
+	Expr *upperBound = make_opclause(valueRange->lessEqualOperator, BOOLOID, false,
+									 operand, (Expr *) copyObject(valueRange->maxValue),
+									 InvalidOid, valueRange->columnCollation);
+	Expr *rangeConstraint = make_andclause(list_make2(lowerBound, upperBound));
+
+	if (!valueRange->hasNulls)
+	{
+		return rangeConstraint;
+	}
+
+	return make_orclause(list_make2(rangeConstraint, nullTest));
+}
+
+
+/*
+ * SplitArrayRestrictionsByShard reduces the arrays of the top-level
+ * <distribution column> = ANY(<constant array>) restrictions in the WHERE
+ * clauses of the given task query and its subqueries to the elements that
+ * hash to the shard that the task reads from the relation, as given by
+ * relationShardList. Other elements cannot match any row of the shard, so
+ * there is no need to send them to the worker and to compare the rows of the
+ * shard against them.
+ *
+ * The query is modified in place, hence it should be a copy that only
+ * belongs to the task.
+ */
+void
+SplitArrayRestrictionsByShard(Query *query, List *relationShardList)
+{
+	if (ArrayRestrictionSplitThreshold < 0 || relationShardList == NIL)
+	{
+		return;
+	}
+
+	ArraySplitContext context = {
+		.relationShardList = relationShardList,
+		.hasArrayToSplit = false
+	};
+
+	SplitArrayRestrictionsByShardWalker((Node *) query, &context);
+}
+
+
+/*
+ * HasArrayRestrictionsToSplit returns whether SplitArrayRestrictionsByShard
+ * may reduce an array in the given query, in which case the queries of the
+ * tasks on different shards differ in more than the shard names.
+ */
+bool
+HasArrayRestrictionsToSplit(Query *query)
+{
+	if (ArrayRestrictionSplitThreshold < 0)
+	{
+		return false;
+	}
+
+	ArraySplitContext context = {
+		.relationShardList = NIL,
+		.hasArrayToSplit = false
+	};
+
+	SplitArrayRestrictionsByShardWalker((Node *) query, &context);
+
+	return context.hasArrayToSplit;
+}
+
+
+/*
+ * SplitArrayRestrictionsByShardWalker applies SplitArrayRestrictionByShard to
+ * the top-level WHERE clauses of all queries in the given query tree.
+ */
+static bool
+SplitArrayRestrictionsByShardWalker(Node *node, ArraySplitContext *context)
+{
+	if (node == NULL)
+	{
+		return false;
+	}
+
+	if (IsA(node, Query))
+	{
+		Query *query = (Query *) node;
+		FromExpr *joinTree = query->jointree;
+
+		if (joinTree != NULL && joinTree->quals != NULL)
+		{
+			Node *quals = joinTree->quals;
+
+			/* the quals are implicitly ANDed during planning, explicitly when deparsing */
+			List *clauseList = NIL;
+			if (IsA(quals, List))
+			{
+				clauseList = (List *) quals;
+			}
+			else if (is_andclause(quals))
+			{
+				clauseList = ((BoolExpr *) quals)->args;
+			}
+
+			if (clauseList != NIL)
+			{
+				ListCell *clauseCell = NULL;
+				foreach(clauseCell, clauseList)
+				{
+					lfirst(clauseCell) =
+						SplitArrayRestrictionByShard((Node *) lfirst(clauseCell), query,
+													 context);
+				}
+			}
+			else
+			{
+				joinTree->quals = SplitArrayRestrictionByShard(quals, query, context);
+			}
+		}
+
+		return query_tree_walker(query, SplitArrayRestrictionsByShardWalker,
+								 context, 0);
+	}
+
+	return expression_tree_walker(node, SplitArrayRestrictionsByShardWalker,
+								  context);
+}
+
+
+/*
+ * SplitArrayRestrictionByShard returns the given clause with its array reduced
+ * to the elements that hash to the shard of the relation in relationShardList,
+ * if the clause is a <distribution column> = ANY(<constant array>) restriction
+ * on a hash distributed table in the given query. Otherwise, or if all the
+ * elements belong to the shard, it returns the clause as is.
+ */
+static Node *
+SplitArrayRestrictionByShard(Node *clause, Query *query, ArraySplitContext *context)
+{
+	if (!IsA(clause, ScalarArrayOpExpr))
+	{
+		return clause;
+	}
+
+	ScalarArrayOpExpr *arrayOperatorExpression = (ScalarArrayOpExpr *) clause;
+	if (!arrayOperatorExpression->useOr ||
+		!OperatorImplementsEquality(arrayOperatorExpression->opno))
+	{
+		return clause;
+	}
+
+	Node *leftOperand = strip_implicit_coercions(linitial(arrayOperatorExpression->args));
+	Node *arrayArgument = lsecond(arrayOperatorExpression->args);
+	if (!IsA(leftOperand, Var) || !IsA(arrayArgument, Const) ||
+		((Const *) arrayArgument)->constisnull)
+	{
+		return clause;
+	}
+
+	Var *column = (Var *) leftOperand;
+	Const *arrayConst = (Const *) arrayArgument;
+	if (column->varlevelsup != 0 || column->varno < 1 ||
+		column->varno > list_length(query->rtable) ||
+		get_element_type(arrayConst->consttype) != column->vartype)
+	{
+		return clause;
+	}
+
+	RangeTblEntry *rangeTableEntry = rt_fetch(column->varno, query->rtable);
+	if (rangeTableEntry->rtekind != RTE_RELATION ||
+		!IsCitusTableType(rangeTableEntry->relid, HASH_DISTRIBUTED))
+	{
+		return clause;
+	}
+
+	CitusTableCacheEntry *cacheEntry = GetCitusTableCacheEntry(rangeTableEntry->relid);
+	if (cacheEntry->partitionColumn->varattno != column->varattno)
+	{
+		return clause;
+	}
+
+	ArrayType *array = DatumGetArrayTypeP(arrayConst->constvalue);
+	if (ArrayGetNItems(ARR_NDIM(array), ARR_DIMS(array)) < ArrayRestrictionSplitThreshold)
+	{
+		return clause;
+	}
+
+	context->hasArrayToSplit = true;
+
+	/* find the shard of the relation, unless the task reads multiple of them */
+	uint64 shardId = INVALID_SHARD_ID;
+	RelationShard *relationShard = NULL;
+	foreach_ptr(relationShard, context->relationShardList)
+	{
+		if (relationShard->relationId != rangeTableEntry->relid)
+		{
+			continue;
+		}
+		else if (shardId != INVALID_SHARD_ID && shardId != relationShard->shardId)
+		{
+			return clause;
+		}
+
+		shardId = relationShard->shardId;
+	}
+
+	if (shardId == INVALID_SHARD_ID)
+	{
+		return clause;
+	}
+
+	int16 typlen = 0;
+	bool typbyval = false;
+	char typalign = '\0';
+	Datum *elementValues = NULL;
+	bool *elementNulls = NULL;
+	int elementCount = 0;
+
+	get_typlenbyvalalign(ARR_ELEMTYPE(array), &typlen, &typbyval, &typalign);
+	deconstruct_array(array, ARR_ELEMTYPE(array), typlen, typbyval, typalign,
+					  &elementValues, &elementNulls, &elementCount);
+
+	int shardIndex = ShardIndex(LoadShardInterval(shardId));
+	Oid partitionColumnCollation = cacheEntry->partitionColumn->varcollid;
+	int shardElementCount = 0;
+
+	/*
+	 * Keep the elements that hash to the shard, in place. NULL elements never
+	 * match, which does not make a difference for a top-level restriction.
+	 */
+	for (int elementIndex = 0; elementIndex < elementCount; elementIndex++)
+	{
+		if (elementNulls[elementIndex])
+		{
+			continue;
+		}
+
+		Datum hashedValue = FunctionCall1Coll(cacheEntry->hashFunction,
+											  partitionColumnCollation,
+											  elementValues[elementIndex]);
+		if (FindShardIntervalIndex(hashedValue, cacheEntry) == shardIndex)
+		{
+			elementValues[shardElementCount++] = elementValues[elementIndex];
+		}
+	}
+
+	if (shardElementCount == elementCount)
+	{
+		return clause;
+	}
+
+	ArrayType *shardArray = construct_array(elementValues, shardElementCount,
+											ARR_ELEMTYPE(array), typlen, typbyval,
+											typalign);
+
+	arrayOperatorExpression->args =
+		list_make2(linitial(arrayOperatorExpression->args),
+				   makeConst(arrayConst->consttype, arrayConst->consttypmod,
+							 arrayConst->constcollid, -1,
+							 PointerGetDatum(shardArray), false, false));
+
+	return clause;
+}
+
+
 /*
  * IsValidConditionNode checks whether node is a valid constraint for pruning.
  */
@@ -1039,6 +1504,132 @@ SAORestrictions(ScalarArrayOpExpr *arrayOperatorExpression, Var *partitionColumn
 }
 
 
+/*
+ * SingleHashedSAORestriction returns the <partition column> = ANY(<constant
+ * array>) restriction of the given pruning tree if it is the only restriction
+ * on the partition column that the tree contains, and the array elements have
+ * the type of the partition column. Otherwise, it returns NULL.
+ */
+static ScalarArrayOpExpr *
+SingleHashedSAORestriction(PruningTreeNode *tree, Var *partitionColumn)
+{
+	Assert(tree->boolop == AND_EXPR);
+
+	if (tree->childBooleanNodes != NIL || list_length(tree->validConstraints) != 1)
+	{
+		return NULL;
+	}
+
+	Node *constraint = (Node *) linitial(tree->validConstraints);
+	if (!IsA(constraint, ScalarArrayOpExpr))
+	{
+		return NULL;
+	}
+
+	/* IsValidConditionNode already checked for partcol = ANY(const array) */
+	ScalarArrayOpExpr *arrayOperatorExpression = (ScalarArrayOpExpr *) constraint;
+	Const *arrayConst = (Const *) lsecond(arrayOperatorExpression->args);
+
+	/* otherwise each element would need to be coerced to the partition column type */
+	if (get_element_type(arrayConst->consttype) != partitionColumn->vartype)
+	{
+		return NULL;
+	}
+
+	return arrayOperatorExpression;
+}
+
+
+/*
+ * PruneHashedSAORestriction returns the shards of a hash distributed table
+ * that contain the non-NULL elements of the array of a <partition column> =
+ * ANY(<constant array>) restriction, in the order in which the elements first
+ * hit them. Each element is hashed once and mapped to its shard index, which
+ * is a direct computation when the table has a uniform hash distribution, and
+ * the shards are deduplicated using an array of flags.
+ *
+ * If all the non-NULL elements are equal, singlePartitionValueConst is set to
+ * that value, otherwise to NULL.
+ */
+static List *
+PruneHashedSAORestriction(CitusTableCacheEntry *cacheEntry,
+						  ClauseWalkerContext *context,
+						  ScalarArrayOpExpr *arrayOperatorExpression,
+						  Const **singlePartitionValueConst)
+{
+	ShardInterval **sortedShardIntervalArray = cacheEntry->sortedShardIntervalArray;
+	int shardCount = cacheEntry->shardIntervalArrayLength;
+	Oid partitionColumnCollation = cacheEntry->partitionColumn->varcollid;
+	Const *arrayConst = (Const *) lsecond(arrayOperatorExpression->args);
+	bool *shardIncluded = palloc0(shardCount * sizeof(bool));
+	List *prunedList = NIL;
+	Datum firstElement = 0;
+	bool foundElement = false;
+	bool foundDifferentElements = false;
+	int16 typlen = 0;
+	bool typbyval = false;
+	char typalign = '\0';
+	Datum arrayElement = 0;
+	bool isNull = false;
+
+	Assert(IsCitusTableTypeCacheEntry(cacheEntry, HASH_DISTRIBUTED));
+
+	ArrayType *array = DatumGetArrayTypeP(arrayConst->constvalue);
+	Oid elementType = ARR_ELEMTYPE(array);
+	get_typlenbyvalalign(elementType, &typlen, &typbyval, &typalign);
+
+	ArrayIterator arrayIterator = array_create_iterator(array, 0, NULL);
+	while (array_iterate(arrayIterator, &arrayElement, &isNull))
+	{
+		/* a value is never equal to NULL */
+		if (isNull)
+		{
+			continue;
+		}
+
+		if (!foundElement)
+		{
+			firstElement = arrayElement;
+			foundElement = true;
+		}
+		else if (!foundDifferentElements &&
+				 PerformValueCompare((FunctionCallInfo) &
+									 context->compareValueFunctionCall,
+									 arrayElement, firstElement) != 0)
+		{
+			foundDifferentElements = true;
+		}
+
+		Datum hashedValue = FunctionCall1Coll(cacheEntry->hashFunction,
+											  partitionColumnCollation,
+											  arrayElement);
+		int shardIndex = FindShardIntervalIndex(hashedValue, cacheEntry);
+
+		if (shardIndex != INVALID_SHARD_INDEX && !shardIncluded[shardIndex])
+		{
+			shardIncluded[shardIndex] = true;
+			prunedList = lappend(prunedList, sortedShardIntervalArray[shardIndex]);
+		}
+	}
+
+	array_free_iterator(arrayIterator);
+	pfree(shardIncluded);
+
+	if (foundElement && !foundDifferentElements)
+	{
+		*singlePartitionValueConst = makeConst(elementType, -1,
+											   arrayConst->constcollid, typlen,
+											   firstElement, false, typbyval);
+	}
+	else
+	{
+		*singlePartitionValueConst = NULL;
+	}
+
+	return prunedList;
+}
+
+
 /*
  * AddNewConjuction adds the OpExpr to pending instance list of context
  * as conjunction as partial instance.
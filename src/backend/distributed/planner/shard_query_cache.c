@@ -0,0 +1,132 @@
+/*-------------------------------------------------------------------------
+ *
+ * shard_query_cache.c
+ *
+ * Functions for caching the shard queries of fast path queries whose
+ * shard pruning is deferred to the execution.
+ *
+ * When the distribution key of a fast path query is a parameter, the
+ * generic plan of the prepared statement only holds the job query, and
+ * each execution normally evaluates the parameters in a copy of the job
+ * query, prunes the shards and deparses the resulting shard query. The
+ * query string only depends on the shard as long as the parameters are
+ * left in it. Therefore, we deparse the shard query once per shard with
+ * the parameters intact, cache it in the distributed plan (which may be
+ * preserved across executions) and send the parameters along with it.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "lib/stringinfo.h"
+#include "utils/memutils.h"
+
+#include "distributed/citus_nodefuncs.h"
+#include "distributed/citus_ruleutils.h"
+#include "distributed/deparse_shard_query.h"
+#include "distributed/listutils.h"
+#include "distributed/shard_query_cache.h"
+
+
+/* controlled via GUC */
+bool EnableShardQueryCaching = false;
+
+
+/*
+ * IsShardQueryCachingSupported returns whether the shard query of the current
+ * execution of the job can be taken from, or added to, the shard query cache
+ * of the original distributed plan.
+ */
+bool
+IsShardQueryCachingSupported(Job *currentJob, DistributedPlan *originalDistributedPlan)
+{
+	if (!EnableShardQueryCaching)
+	{
+		return false;
+	}
+
+	if (originalDistributedPlan->numberOfTimesExecuted < 1)
+	{
+		/*
+		 * Only cache if a plan is being reused (via a prepared statement).
+		 */
+		return false;
+	}
+
+	if (!currentJob->deferredPruning || !originalDistributedPlan->fastPathRouterPlan)
+	{
+		/* pruned queries already have their shard queries in the plan */
+		return false;
+	}
+
+	Query *jobQuery = currentJob->jobQuery;
+	if (jobQuery->commandType == CMD_INSERT)
+	{
+		/* the values of INSERTs are routed row by row */
+		return false;
+	}
+
+	if (jobQuery->commandType != CMD_SELECT &&
+		currentJob->requiresCoordinatorEvaluation)
+	{
+		/*
+		 * The functions of modifications are evaluated on the coordinator on
+		 * every execution, so their shard queries differ across executions.
+		 */
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * GetOrCacheShardQueryString returns the query string of the job query of
+ * the original distributed plan on given shard, with the parameters of the
+ * job query left in it. The query string is deparsed on the first call for
+ * the shard and cached in the original distributed plan.
+ */
+char *
+GetOrCacheShardQueryString(DistributedPlan *originalDistributedPlan, uint64 shardId,
+						   List *relationShardList)
+{
+	Job *originalJob = originalDistributedPlan->workerJob;
+
+	CachedShardQuery *cachedShardQuery = NULL;
+	foreach_ptr(cachedShardQuery, originalJob->cachedShardQueries)
+	{
+		if (cachedShardQuery->shardId == shardId)
+		{
+			return cachedShardQuery->queryString;
+		}
+	}
+
+	/* the job query in the plan should stay intact for the next executions */
+	Query *shardQuery = copyObject(originalJob->jobQuery);
+	UpdateRelationToShardNames((Node *) shardQuery, relationShardList);
+
+	StringInfo queryString = makeStringInfo();
+	pg_get_query_def(shardQuery, queryString);
+
+	ereport(DEBUG5, (errmsg("shard query that is going to be cached: %s",
+							queryString->data)));
+
+	/*
+	 * The cache entry should live as long as the plan, which may be preserved
+	 * across executions.
+	 */
+	MemoryContext oldContext =
+		MemoryContextSwitchTo(GetMemoryChunkContext(originalDistributedPlan));
+
+	cachedShardQuery = CitusMakeNode(CachedShardQuery);
+	cachedShardQuery->shardId = shardId;
+	cachedShardQuery->queryString = pstrdup(queryString->data);
+
+	originalJob->cachedShardQueries = lappend(originalJob->cachedShardQueries,
+											  cachedShardQuery);
+
+	MemoryContextSwitchTo(oldContext);
+
+	return cachedShardQuery->queryString;
+}
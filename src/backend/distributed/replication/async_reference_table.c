@@ -0,0 +1,1185 @@
+/*-------------------------------------------------------------------------
+ *
+ * async_reference_table.c
+ *
+ * Modifications of reference tables are normally written to all placements
+ * in a distributed transaction, which makes every write to a small, often
+ * updated reference table cost a 2PC round over the whole cluster. The
+ * modifications of a reference table that is set to asynchronous replication
+ * via citus_set_reference_table_async() are instead only written to its
+ * primary placement, the one in the lowest group, and the other placements
+ * receive them through a publication on the primary node and a subscription
+ * on each of the other nodes. Reads keep using any placement, so they may
+ * not see the latest modifications yet, and
+ * citus_wait_for_async_reference_tables() waits until all placements applied
+ * the modifications that were committed before it was called.
+ *
+ * The other placements have a trigger that rejects modifications, such that
+ * writes from nodes that do not know that the table is replicated
+ * asynchronously, such as the workers with metadata, fail rather than let
+ * the placements diverge. The trigger does not fire for the changes that the
+ * subscription applies.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "pgstat.h"
+
+#include "access/genam.h"
+#include "access/htup_details.h"
+#include "access/table.h"
+#include "access/xact.h"
+#include "catalog/indexing.h"
+#include "commands/dbcommands.h"
+#include "commands/trigger.h"
+#include "storage/latch.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
+
+#include "pg_version_constants.h"
+
+#include "distributed/async_reference_table.h"
+#include "distributed/citus_ruleutils.h"
+#include "distributed/commands.h"
+#include "distributed/connection_management.h"
+#include "distributed/coordinator_protocol.h"
+#include "distributed/listutils.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/metadata_utility.h"
+#include "distributed/multi_logical_replication.h"
+#include "distributed/multi_physical_planner.h"
+#include "distributed/pg_dist_async_reference_table.h"
+#include "distributed/remote_commands.h"
+#include "distributed/resource_lock.h"
+#include "distributed/shard_cleaner.h"
+#include "distributed/shard_transfer.h"
+#include "distributed/worker_manager.h"
+
+
+#define ASYNC_REPLICATION_PUBLICATION_NAME "citus_async_reference_tables"
+#define ASYNC_REPLICATION_SUBSCRIPTION_PREFIX "citus_async_reference_tables_"
+#define ASYNC_REPLICATION_SLOT_PREFIX "citus_async_reference_tables_slot_"
+#define ASYNC_REPLICA_TRIGGER_NAME "citus_async_reference_table_replica"
+
+/* how often to check whether the replicas caught up with the primary */
+#define ASYNC_REPLICA_POLL_INTERVAL_MS 10
+
+
+/* an asynchronously replicated reference table and the group of its primary */
+typedef struct AsyncReferenceTable
+{
+	Oid relationId;
+	int32 primaryGroupId;
+} AsyncReferenceTable;
+
+
+static void EnableAsyncReplication(Oid relationId);
+static void DisableAsyncReplication(Oid relationId, int32 primaryGroupId);
+static List * AsyncReferenceTableList(void);
+static bool PrimaryGroupReplicatesTables(int32 primaryGroupId);
+static int32 RemoveAsyncReferenceTableRow(Oid relationId);
+static void RegisterAsyncReplicationCleanup(int32 primaryGroupId);
+static void InsertAsyncReferenceTableRow(Oid relationId, int32 primaryGroupId);
+static int32 ShardAsyncReplicationPrimaryGroupId(uint64 shardId);
+static List * ReplicaPlacementList(uint64 shardId, int32 primaryGroupId);
+static ShardPlacement * PrimaryPlacement(uint64 shardId, int32 primaryGroupId);
+static MultiConnection * AsyncReplicationConnection(char *nodeName, int nodePort);
+static void EnsurePublicationExists(MultiConnection *primaryConnection);
+static void EnsureSubscriptionExists(MultiConnection *replicaConnection,
+									 ShardPlacement *primaryPlacement,
+									 int32 replicaGroupId, bool copyData);
+static void DropSubscriptionIfExists(MultiConnection *replicaConnection,
+									 char *subscriptionName);
+static bool RemoteSubscriptionExists(MultiConnection *replicaConnection,
+									 char *subscriptionName);
+static bool WaitForReplicaToCatchUp(MultiConnection *replicaConnection,
+									char *subscriptionName,
+									XLogRecPtr primaryPosition,
+									TimestampTz deadline);
+static char * AsyncReplicationSubscriptionName(int32 primaryGroupId);
+static char * AsyncReplicationSlotName(int32 replicaGroupId);
+
+
+PG_FUNCTION_INFO_V1(citus_set_reference_table_async);
+PG_FUNCTION_INFO_V1(citus_wait_for_async_reference_tables);
+PG_FUNCTION_INFO_V1(citus_internal_async_reference_table_replica_trigger);
+
+
+/*
+ * citus_set_reference_table_async sets whether the modifications of the given
+ * reference table are written to all placements, or only to its primary
+ * placement and replicated asynchronously to the other placements.
+ */
+Datum
+citus_set_reference_table_async(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+
+	/* the subscriptions are created and refreshed outside of the transaction */
+	PreventInTransactionBlock(true, "citus_set_reference_table_async");
+
+	Oid relationId = PG_GETARG_OID(0);
+	bool async = PG_GETARG_BOOL(1);
+
+	EnsureTableOwner(relationId);
+
+	if (!IsCitusTableType(relationId, REFERENCE_TABLE))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("\"%s\" is not a reference table",
+							   get_rel_name(relationId))));
+	}
+
+	CitusTableCacheEntry *cacheEntry = GetCitusTableCacheEntry(relationId);
+	int32 primaryGroupId = AsyncReplicationPrimaryGroupId(cacheEntry);
+
+	if (async && primaryGroupId == INVALID_GROUP_ID)
+	{
+		/* the publication and subscriptions of dropped tables might still be pending */
+		DropOrphanedResourcesInSeparateTransaction();
+
+		EnableAsyncReplication(relationId);
+	}
+	else if (!async && primaryGroupId != INVALID_GROUP_ID)
+	{
+		DisableAsyncReplication(relationId, primaryGroupId);
+	}
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * citus_wait_for_async_reference_tables waits until all placements of the
+ * asynchronously replicated reference tables applied the modifications that
+ * were committed on their primary placements before the call. It returns
+ * false if that did not happen within the given number of milliseconds, a
+ * negative timeout waits indefinitely.
+ */
+Datum
+citus_wait_for_async_reference_tables(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+	EnsureCoordinator();
+
+	int timeoutMs = PG_GETARG_INT32(0);
+	TimestampTz deadline = 0;
+
+	if (timeoutMs >= 0)
+	{
+		deadline = TimestampTzPlusMilliseconds(GetCurrentTimestamp(), timeoutMs);
+	}
+
+	/* all placements of a node apply the changes of one primary in order */
+	List *waitedReplicaList = NIL;
+
+	AsyncReferenceTable *asyncTable = NULL;
+	foreach_ptr(asyncTable, AsyncReferenceTableList())
+	{
+		int32 primaryGroupId = asyncTable->primaryGroupId;
+		uint64 shardId = GetFirstShardId(asyncTable->relationId);
+
+		ShardPlacement *primaryPlacement = PrimaryPlacement(shardId, primaryGroupId);
+		MultiConnection *primaryConnection =
+			AsyncReplicationConnection(primaryPlacement->nodeName,
+									   primaryPlacement->nodePort);
+		XLogRecPtr primaryPosition = GetRemoteLogPosition(primaryConnection);
+		CloseConnection(primaryConnection);
+
+		char *subscriptionName = AsyncReplicationSubscriptionName(primaryGroupId);
+
+		ShardPlacement *replicaPlacement = NULL;
+		foreach_ptr(replicaPlacement, ReplicaPlacementList(shardId, primaryGroupId))
+		{
+			String *replica = makeString(psprintf("%d:%d", primaryGroupId,
+												  replicaPlacement->groupId));
+			if (list_member(waitedReplicaList, replica))
+			{
+				continue;
+			}
+
+			waitedReplicaList = lappend(waitedReplicaList, replica);
+
+			MultiConnection *replicaConnection =
+				AsyncReplicationConnection(replicaPlacement->nodeName,
+										   replicaPlacement->nodePort);
+			bool caughtUp = WaitForReplicaToCatchUp(replicaConnection,
+													subscriptionName,
+													primaryPosition, deadline);
+			CloseConnection(replicaConnection);
+
+			if (!caughtUp)
+			{
+				PG_RETURN_BOOL(false);
+			}
+		}
+	}
+
+	PG_RETURN_BOOL(true);
+}
+
+
+/*
+ * citus_internal_async_reference_table_replica_trigger rejects modifications
+ * of the placements of asynchronously replicated reference tables that are
+ * not the primary placement. It is not fired for the changes that are
+ * applied by their subscription.
+ */
+Datum
+citus_internal_async_reference_table_replica_trigger(PG_FUNCTION_ARGS)
+{
+	if (!CALLED_AS_TRIGGER(fcinfo))
+	{
+		ereport(ERROR, (errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+						errmsg("must be called as trigger")));
+	}
+
+	TriggerData *triggerData = (TriggerData *) fcinfo->context;
+
+	ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					errmsg("cannot modify \"%s\" because it is a replica of an "
+						   "asynchronously replicated reference table",
+						   RelationGetRelationName(triggerData->tg_relation)),
+					errhint("Modify the reference table from the coordinator.")));
+
+	PG_RETURN_NULL();
+}
+
+
+/*
+ * EnableAsyncReplication makes the placement in the lowest group the primary
+ * placement of the given reference table, and sets up the replication of its
+ * modifications to the other placements.
+ *
+ * The slots of new subscriptions are created before writes are blocked, since
+ * creating a slot waits for the running transactions, which might in turn
+ * wait for us. Writes are then blocked while the table is added to the
+ * publication and the subscriptions, which all start from placements that
+ * are identical at that point.
+ */
+static void
+EnableAsyncReplication(Oid relationId)
+{
+	ShardInterval *shardInterval = linitial(LoadShardIntervalList(relationId));
+
+	if (!RelationCanPublishAllModifications(relationId))
+	{
+		ereport(ERROR, (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						errmsg("cannot replicate \"%s\" asynchronously because it "
+							   "does not have a replica identity",
+							   get_rel_name(relationId)),
+						errhint("Add a primary key or set the replica identity of "
+								"the table.")));
+	}
+
+	if (TableReferenced(relationId) || TableReferencing(relationId))
+	{
+		ereport(ERROR, (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+						errmsg("cannot replicate \"%s\" asynchronously because it "
+							   "is involved in a foreign key",
+							   get_rel_name(relationId)),
+						errdetail("The other placements apply the modifications "
+								  "without checking foreign keys, and writes to "
+								  "the other table could not see them yet.")));
+	}
+
+	uint64 shardId = shardInterval->shardId;
+	char *shardName = ConstructQualifiedShardName(shardInterval);
+
+	List *placementList = SortList(ActiveShardPlacementList(shardId),
+								   CompareShardPlacementsByGroupId);
+	if (placementList == NIL)
+	{
+		ereport(ERROR, (errmsg("reference table \"%s\" does not have an active "
+							   "placement", get_rel_name(relationId))));
+	}
+
+	ShardPlacement *primaryPlacement = linitial(placementList);
+	int32 primaryGroupId = primaryPlacement->groupId;
+	List *replicaPlacementList = ReplicaPlacementList(shardId, primaryGroupId);
+
+	MultiConnection *primaryConnection =
+		AsyncReplicationConnection(primaryPlacement->nodeName,
+								   primaryPlacement->nodePort);
+	EnsurePublicationExists(primaryConnection);
+
+	List *replicaConnectionList = NIL;
+	ShardPlacement *replicaPlacement = NULL;
+	foreach_ptr(replicaPlacement, replicaPlacementList)
+	{
+		MultiConnection *replicaConnection =
+			AsyncReplicationConnection(replicaPlacement->nodeName,
+									   replicaPlacement->nodePort);
+
+		bool copyData = false;
+		EnsureSubscriptionExists(replicaConnection, primaryPlacement,
+								 replicaPlacement->groupId, copyData);
+
+		replicaConnectionList = lappend(replicaConnectionList, replicaConnection);
+	}
+
+	BlockWritesToShardList(list_make1(shardInterval));
+
+	ExecuteCriticalRemoteCommand(primaryConnection,
+								 psprintf("ALTER PUBLICATION %s ADD TABLE %s",
+										  ASYNC_REPLICATION_PUBLICATION_NAME,
+										  shardName));
+
+	char *subscriptionName = AsyncReplicationSubscriptionName(primaryGroupId);
+
+	MultiConnection *replicaConnection = NULL;
+	foreach_ptr(replicaConnection, replicaConnectionList)
+	{
+		ExecuteCriticalRemoteCommand(replicaConnection, psprintf(
+										 "CREATE TRIGGER %s BEFORE INSERT OR UPDATE "
+										 "OR DELETE ON %s FOR EACH STATEMENT "
+										 "EXECUTE FUNCTION citus_internal."
+										 "async_reference_table_replica_trigger()",
+										 ASYNC_REPLICA_TRIGGER_NAME, shardName));
+		ExecuteCriticalRemoteCommand(replicaConnection, psprintf(
+										 "ALTER SUBSCRIPTION %s REFRESH PUBLICATION "
+										 "WITH (copy_data = false)",
+										 subscriptionName));
+		CloseConnection(replicaConnection);
+	}
+
+	CloseConnection(primaryConnection);
+
+	InsertAsyncReferenceTableRow(relationId, primaryGroupId);
+}
+
+
+/*
+ * DisableAsyncReplication writes the modifications of the given reference
+ * table to all placements again. Writes are blocked until all placements
+ * applied the modifications of the primary placement, and the table is
+ * removed from the publication and the subscriptions. The publication and
+ * subscriptions are dropped once they no longer replicate any table.
+ */
+static void
+DisableAsyncReplication(Oid relationId, int32 primaryGroupId)
+{
+	ShardInterval *shardInterval = linitial(LoadShardIntervalList(relationId));
+	uint64 shardId = shardInterval->shardId;
+	char *shardName = ConstructQualifiedShardName(shardInterval);
+
+	BlockWritesToShardList(list_make1(shardInterval));
+
+	ShardPlacement *primaryPlacement = PrimaryPlacement(shardId, primaryGroupId);
+	MultiConnection *primaryConnection =
+		AsyncReplicationConnection(primaryPlacement->nodeName,
+								   primaryPlacement->nodePort);
+	XLogRecPtr primaryPosition = GetRemoteLogPosition(primaryConnection);
+
+	char *subscriptionName = AsyncReplicationSubscriptionName(primaryGroupId);
+	TimestampTz deadline = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+													   LogicalReplicationTimeout);
+
+	List *replicaConnectionList = NIL;
+	ShardPlacement *replicaPlacement = NULL;
+	foreach_ptr(replicaPlacement, ReplicaPlacementList(shardId, primaryGroupId))
+	{
+		MultiConnection *replicaConnection =
+			AsyncReplicationConnection(replicaPlacement->nodeName,
+									   replicaPlacement->nodePort);
+
+		if (!WaitForReplicaToCatchUp(replicaConnection, subscriptionName,
+									 primaryPosition, deadline))
+		{
+			ereport(ERROR, (errmsg("the placement of \"%s\" on %s:%d did not catch "
+								   "up with the primary placement within %d msec",
+								   get_rel_name(relationId),
+								   replicaPlacement->nodeName,
+								   replicaPlacement->nodePort,
+								   LogicalReplicationTimeout),
+							errhint("Consider using a higher value for "
+									"citus.logical_replication_timeout.")));
+		}
+
+		replicaConnectionList = lappend(replicaConnectionList, replicaConnection);
+	}
+
+	ExecuteCriticalRemoteCommand(primaryConnection,
+								 psprintf("ALTER PUBLICATION %s DROP TABLE %s",
+										  ASYNC_REPLICATION_PUBLICATION_NAME,
+										  shardName));
+
+	RemoveAsyncReferenceTableRow(relationId);
+	CitusInvalidateRelcacheByRelid(relationId);
+	CommandCounterIncrement();
+
+	bool primaryReplicatesTables = PrimaryGroupReplicatesTables(primaryGroupId);
+
+	MultiConnection *replicaConnection = NULL;
+	foreach_ptr(replicaConnection, replicaConnectionList)
+	{
+		ExecuteCriticalRemoteCommand(replicaConnection, psprintf(
+										 "DROP TRIGGER IF EXISTS %s ON %s",
+										 ASYNC_REPLICA_TRIGGER_NAME, shardName));
+
+		if (primaryReplicatesTables)
+		{
+			ExecuteCriticalRemoteCommand(replicaConnection, psprintf(
+											 "ALTER SUBSCRIPTION %s REFRESH PUBLICATION "
+											 "WITH (copy_data = false)",
+											 subscriptionName));
+		}
+		else
+		{
+			/* also drops the replication slot on the primary node */
+			ExecuteCriticalRemoteCommand(replicaConnection, psprintf(
+											 "DROP SUBSCRIPTION IF EXISTS %s",
+											 subscriptionName));
+		}
+
+		CloseConnection(replicaConnection);
+	}
+
+	if (!primaryReplicatesTables)
+	{
+		ExecuteCriticalRemoteCommand(primaryConnection,
+									 "DROP PUBLICATION IF EXISTS "
+									 ASYNC_REPLICATION_PUBLICATION_NAME);
+	}
+
+	CloseConnection(primaryConnection);
+}
+
+
+/*
+ * WritableShardPlacementList returns the active placements of the given shard
+ * that modifications are written to, which are all of them unless the shard
+ * belongs to an asynchronously replicated reference table.
+ */
+List *
+WritableShardPlacementList(uint64 shardId)
+{
+	List *placementList = ActiveShardPlacementList(shardId);
+
+	int32 primaryGroupId = ShardAsyncReplicationPrimaryGroupId(shardId);
+	if (primaryGroupId == INVALID_GROUP_ID)
+	{
+		return placementList;
+	}
+
+	return list_make1(PrimaryPlacement(shardId, primaryGroupId));
+}
+
+
+/*
+ * IsAsyncReferenceTable returns whether the given table is a reference table
+ * whose modifications are replicated asynchronously.
+ */
+bool
+IsAsyncReferenceTable(Oid relationId)
+{
+	CitusTableCacheEntry *cacheEntry = LookupCitusTableCacheEntry(relationId);
+	if (cacheEntry == NULL || !IsCitusTableTypeCacheEntry(cacheEntry, REFERENCE_TABLE))
+	{
+		return false;
+	}
+
+	return AsyncReplicationPrimaryGroupId(cacheEntry) != INVALID_GROUP_ID;
+}
+
+
+/*
+ * ExcludeAsyncReplicaPlacements returns the given task list, in which the
+ * modification tasks on the shards of asynchronously replicated reference
+ * tables are replaced by tasks that only modify the primary placement. The
+ * tasks are copied, since they may belong to a cached plan.
+ */
+List *
+ExcludeAsyncReplicaPlacements(List *taskList)
+{
+	/* the catalog does not exist before the extension is updated to 12.2 */
+	if (!OidIsValid(DistAsyncReferenceTableRelationId()))
+	{
+		return taskList;
+	}
+
+	List *writableTaskList = NIL;
+
+	Task *task = NULL;
+	foreach_ptr(task, taskList)
+	{
+		if (task->taskType != MODIFY_TASK ||
+			list_length(task->taskPlacementList) < 2)
+		{
+			writableTaskList = lappend(writableTaskList, task);
+			continue;
+		}
+
+		int32 primaryGroupId = ShardAsyncReplicationPrimaryGroupId(task->anchorShardId);
+		if (primaryGroupId == INVALID_GROUP_ID)
+		{
+			writableTaskList = lappend(writableTaskList, task);
+			continue;
+		}
+
+		List *primaryPlacementList = NIL;
+		ShardPlacement *placement = NULL;
+		foreach_ptr(placement, task->taskPlacementList)
+		{
+			if (placement->groupId == primaryGroupId)
+			{
+				primaryPlacementList = lappend(primaryPlacementList, placement);
+			}
+		}
+
+		if (primaryPlacementList == NIL)
+		{
+			ereport(ERROR, (errmsg("could not find the primary placement of "
+								   "shard " UINT64_FORMAT, task->anchorShardId),
+							errdetail("The primary placement of the "
+									  "asynchronously replicated reference "
+									  "table is in group %d.", primaryGroupId)));
+		}
+
+		Task *primaryTask = palloc0(sizeof(Task));
+		*primaryTask = *task;
+		primaryTask->taskPlacementList = primaryPlacementList;
+
+		writableTaskList = lappend(writableTaskList, primaryTask);
+	}
+
+	return writableTaskList;
+}
+
+
+/*
+ * ReplicateAsyncReferenceTablesToNodes sets up the asynchronous replication of
+ * the reference tables to the given nodes, which just received copies of
+ * them. The copies may have been taken from a placement that did not apply
+ * all modifications of the primary placement yet, and modifications may have
+ * been committed since, so they are emptied and filled again by the initial
+ * synchronization of a new subscription.
+ */
+void
+ReplicateAsyncReferenceTablesToNodes(List *workerNodeList)
+{
+	List *asyncTableList = AsyncReferenceTableList();
+	if (asyncTableList == NIL)
+	{
+		return;
+	}
+
+	/*
+	 * Creating the replication slot of a subscription waits for the running
+	 * transactions on the primary node, which might include our own.
+	 */
+	if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot replicate asynchronously replicated "
+							   "reference tables in a transaction that modified "
+							   "data"),
+						errhint("Run SELECT replicate_reference_tables() first.")));
+	}
+
+	WorkerNode *workerNode = NULL;
+	foreach_ptr(workerNode, workerNodeList)
+	{
+		List *primaryGroupIdList = NIL;
+
+		AsyncReferenceTable *asyncTable = NULL;
+		foreach_ptr(asyncTable, asyncTableList)
+		{
+			if (asyncTable->primaryGroupId != workerNode->groupId)
+			{
+				primaryGroupIdList = list_append_unique_int(primaryGroupIdList,
+															asyncTable->primaryGroupId);
+			}
+		}
+
+		MultiConnection *replicaConnection =
+			AsyncReplicationConnection(workerNode->workerName, workerNode->workerPort);
+
+		int32 primaryGroupId = 0;
+		foreach_int(primaryGroupId, primaryGroupIdList)
+		{
+			ShardPlacement *primaryPlacement = NULL;
+			List *shardNameList = NIL;
+
+			foreach_ptr(asyncTable, asyncTableList)
+			{
+				if (asyncTable->primaryGroupId != primaryGroupId)
+				{
+					continue;
+				}
+
+				uint64 shardId = GetFirstShardId(asyncTable->relationId);
+				primaryPlacement = PrimaryPlacement(shardId, primaryGroupId);
+				shardNameList = lappend(shardNameList,
+										ConstructQualifiedShardName(
+											LoadShardInterval(shardId)));
+			}
+
+			/* a subscription of an earlier incarnation of the node would apply twice */
+			char *subscriptionName = AsyncReplicationSubscriptionName(primaryGroupId);
+			DropSubscriptionIfExists(replicaConnection, subscriptionName);
+
+			/* the replica role skips the foreign keys from other placements */
+			ExecuteCriticalRemoteCommand(replicaConnection,
+										 "SET session_replication_role TO replica");
+
+			char *shardName = NULL;
+			foreach_ptr(shardName, shardNameList)
+			{
+				ExecuteCriticalRemoteCommand(replicaConnection,
+											 psprintf("DELETE FROM %s", shardName));
+				ExecuteCriticalRemoteCommand(replicaConnection, psprintf(
+												 "CREATE TRIGGER %s BEFORE INSERT OR "
+												 "UPDATE OR DELETE ON %s FOR EACH "
+												 "STATEMENT EXECUTE FUNCTION "
+												 "citus_internal."
+												 "async_reference_table_replica_trigger()",
+												 ASYNC_REPLICA_TRIGGER_NAME, shardName));
+			}
+
+			ExecuteCriticalRemoteCommand(replicaConnection,
+										 "RESET session_replication_role");
+
+			bool copyData = true;
+			EnsureSubscriptionExists(replicaConnection, primaryPlacement,
+									 workerNode->groupId, copyData);
+		}
+
+		CloseConnection(replicaConnection);
+	}
+}
+
+
+/*
+ * PrepareAsyncReferenceTableReplicaRemoval is called when the given node is
+ * removed. It errors out if the node has a primary placement, and otherwise
+ * drops the replication slots of the node once the removal commits. The
+ * subscription on the removed node itself is left alone, since the node
+ * might not be reachable.
+ */
+void
+PrepareAsyncReferenceTableReplicaRemoval(WorkerNode *workerNode)
+{
+	List *primaryGroupIdList = NIL;
+
+	AsyncReferenceTable *asyncTable = NULL;
+	foreach_ptr(asyncTable, AsyncReferenceTableList())
+	{
+		if (asyncTable->primaryGroupId == workerNode->groupId)
+		{
+			ereport(ERROR, (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+							errmsg("cannot remove the node %s:%d because "
+								   "it has the primary placement of the "
+								   "asynchronously replicated reference table %s",
+								   workerNode->workerName, workerNode->workerPort,
+								   generate_qualified_relation_name(
+									   asyncTable->relationId)),
+							errhint("Use citus_set_reference_table_async(%s, false) "
+									"first.",
+									quote_literal_cstr(generate_qualified_relation_name(
+														   asyncTable->relationId)))));
+		}
+
+		primaryGroupIdList = list_append_unique_int(primaryGroupIdList,
+													asyncTable->primaryGroupId);
+	}
+
+	if (primaryGroupIdList != NIL && CurrentOperationId == INVALID_OPERATION_ID)
+	{
+		RegisterOperationNeedingCleanup();
+	}
+
+	int32 primaryGroupId = 0;
+	foreach_int(primaryGroupId, primaryGroupIdList)
+	{
+		InsertCleanupOnSuccessRecordInCurrentTransaction(
+			CLEANUP_OBJECT_REPLICATION_SLOT,
+			AsyncReplicationSlotName(workerNode->groupId),
+			primaryGroupId);
+	}
+}
+
+
+/*
+ * DeleteAsyncReferenceTableRow removes the given table from
+ * pg_dist_async_reference_table when the table is dropped, if it is there.
+ * The placements of the table leave the publication and the subscriptions
+ * along with the dropped shards, so those only need to be dropped when the
+ * primary node does not replicate other tables, which happens once the drop
+ * commits.
+ */
+void
+DeleteAsyncReferenceTableRow(Oid relationId)
+{
+	int32 primaryGroupId = RemoveAsyncReferenceTableRow(relationId);
+	if (primaryGroupId == INVALID_GROUP_ID)
+	{
+		return;
+	}
+
+	CommandCounterIncrement();
+
+	if (!PrimaryGroupReplicatesTables(primaryGroupId))
+	{
+		RegisterAsyncReplicationCleanup(primaryGroupId);
+	}
+}
+
+
+/*
+ * RemoveAsyncReferenceTableRow removes the given table from
+ * pg_dist_async_reference_table, and returns the group of its primary
+ * placement, or INVALID_GROUP_ID if the table was not there.
+ */
+static int32
+RemoveAsyncReferenceTableRow(Oid relationId)
+{
+	ScanKeyData scanKey[1];
+	int scanKeyCount = 1;
+	bool indexOK = true;
+	int32 primaryGroupId = INVALID_GROUP_ID;
+
+	Oid asyncReferenceTableRelationId = DistAsyncReferenceTableRelationId();
+	if (!OidIsValid(asyncReferenceTableRelationId))
+	{
+		return INVALID_GROUP_ID;
+	}
+
+	Relation pgDistAsyncReferenceTable = table_open(asyncReferenceTableRelationId,
+													RowExclusiveLock);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_async_reference_table_logicalrelid,
+				BTEqualStrategyNumber, F_OIDEQ, ObjectIdGetDatum(relationId));
+
+	SysScanDesc scanDescriptor =
+		systable_beginscan(pgDistAsyncReferenceTable,
+						   DistAsyncReferenceTablePrimaryKeyIndexId(), indexOK,
+						   NULL, scanKeyCount, scanKey);
+
+	HeapTuple heapTuple = systable_getnext(scanDescriptor);
+	if (HeapTupleIsValid(heapTuple))
+	{
+		Form_pg_dist_async_reference_table asyncReferenceTableForm =
+			(Form_pg_dist_async_reference_table) GETSTRUCT(heapTuple);
+		primaryGroupId = asyncReferenceTableForm->primarygroupid;
+
+		CatalogTupleDelete(pgDistAsyncReferenceTable, &heapTuple->t_self);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistAsyncReferenceTable, NoLock);
+
+	return primaryGroupId;
+}
+
+
+/*
+ * PrimaryGroupReplicatesTables returns whether the primary node in the given
+ * group replicates any table asynchronously.
+ */
+static bool
+PrimaryGroupReplicatesTables(int32 primaryGroupId)
+{
+	AsyncReferenceTable *asyncTable = NULL;
+	foreach_ptr(asyncTable, AsyncReferenceTableList())
+	{
+		if (asyncTable->primaryGroupId == primaryGroupId)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * RegisterAsyncReplicationCleanup drops the subscriptions to the publication
+ * of the primary node in the given group, their replication slots, and the
+ * publication once the current transaction commits. They cannot be dropped
+ * in the transaction, since dropping the publication waits for the
+ * transaction when the coordinator is the primary node.
+ */
+static void
+RegisterAsyncReplicationCleanup(int32 primaryGroupId)
+{
+	if (CurrentOperationId == INVALID_OPERATION_ID)
+	{
+		RegisterOperationNeedingCleanup();
+	}
+
+	char *subscriptionName = AsyncReplicationSubscriptionName(primaryGroupId);
+
+	WorkerNode *workerNode = NULL;
+	foreach_ptr(workerNode, ActivePrimaryNodeList(NoLock))
+	{
+		if (workerNode->groupId == primaryGroupId)
+		{
+			continue;
+		}
+
+		InsertCleanupOnSuccessRecordInCurrentTransaction(CLEANUP_OBJECT_SUBSCRIPTION,
+														 subscriptionName,
+														 workerNode->groupId);
+		InsertCleanupOnSuccessRecordInCurrentTransaction(
+			CLEANUP_OBJECT_REPLICATION_SLOT,
+			AsyncReplicationSlotName(workerNode->groupId),
+			primaryGroupId);
+	}
+
+	InsertCleanupOnSuccessRecordInCurrentTransaction(CLEANUP_OBJECT_PUBLICATION,
+													 ASYNC_REPLICATION_PUBLICATION_NAME,
+													 primaryGroupId);
+}
+
+
+/*
+ * AsyncReferenceTableList returns the asynchronously replicated reference
+ * tables in pg_dist_async_reference_table.
+ */
+static List *
+AsyncReferenceTableList(void)
+{
+	List *asyncTableList = NIL;
+
+	Oid asyncReferenceTableRelationId = DistAsyncReferenceTableRelationId();
+	if (!OidIsValid(asyncReferenceTableRelationId))
+	{
+		return NIL;
+	}
+
+	Relation pgDistAsyncReferenceTable = table_open(asyncReferenceTableRelationId,
+													AccessShareLock);
+
+	SysScanDesc scanDescriptor = systable_beginscan(pgDistAsyncReferenceTable,
+													InvalidOid, false, NULL, 0, NULL);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		Form_pg_dist_async_reference_table asyncReferenceTableForm =
+			(Form_pg_dist_async_reference_table) GETSTRUCT(heapTuple);
+
+		AsyncReferenceTable *asyncTable = palloc0(sizeof(AsyncReferenceTable));
+		asyncTable->relationId = asyncReferenceTableForm->logicalrelid;
+		asyncTable->primaryGroupId = asyncReferenceTableForm->primarygroupid;
+
+		asyncTableList = lappend(asyncTableList, asyncTable);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistAsyncReferenceTable, AccessShareLock);
+
+	return asyncTableList;
+}
+
+
+/*
+ * InsertAsyncReferenceTableRow records in pg_dist_async_reference_table that
+ * the modifications of the given table are written to the placement in the
+ * given group.
+ */
+static void
+InsertAsyncReferenceTableRow(Oid relationId, int32 primaryGroupId)
+{
+	Datum values[Natts_pg_dist_async_reference_table];
+	bool isNulls[Natts_pg_dist_async_reference_table];
+
+	memset(values, 0, sizeof(values));
+	memset(isNulls, false, sizeof(isNulls));
+
+	values[Anum_pg_dist_async_reference_table_logicalrelid - 1] =
+		ObjectIdGetDatum(relationId);
+	values[Anum_pg_dist_async_reference_table_primarygroupid - 1] =
+		Int32GetDatum(primaryGroupId);
+
+	Relation pgDistAsyncReferenceTable = table_open(DistAsyncReferenceTableRelationId(),
+													RowExclusiveLock);
+
+	HeapTuple heapTuple = heap_form_tuple(RelationGetDescr(pgDistAsyncReferenceTable),
+										  values, isNulls);
+	CatalogTupleInsert(pgDistAsyncReferenceTable, heapTuple);
+
+	table_close(pgDistAsyncReferenceTable, NoLock);
+
+	CitusInvalidateRelcacheByRelid(relationId);
+	CommandCounterIncrement();
+}
+
+
+/*
+ * ShardAsyncReplicationPrimaryGroupId returns the group of the primary
+ * placement of the given shard if it belongs to an asynchronously replicated
+ * reference table, or INVALID_GROUP_ID otherwise.
+ */
+static int32
+ShardAsyncReplicationPrimaryGroupId(uint64 shardId)
+{
+	Oid relationId = RelationIdForShard(shardId);
+
+	CitusTableCacheEntry *cacheEntry = LookupCitusTableCacheEntry(relationId);
+	if (cacheEntry == NULL || !IsCitusTableTypeCacheEntry(cacheEntry, REFERENCE_TABLE))
+	{
+		return INVALID_GROUP_ID;
+	}
+
+	return AsyncReplicationPrimaryGroupId(cacheEntry);
+}
+
+
+/*
+ * ReplicaPlacementList returns the active placements of the given shard that
+ * are not in the given primary group.
+ */
+static List *
+ReplicaPlacementList(uint64 shardId, int32 primaryGroupId)
+{
+	List *replicaPlacementList = NIL;
+
+	ShardPlacement *placement = NULL;
+	foreach_ptr(placement, ActiveShardPlacementList(shardId))
+	{
+		if (placement->groupId != primaryGroupId)
+		{
+			replicaPlacementList = lappend(replicaPlacementList, placement);
+		}
+	}
+
+	return replicaPlacementList;
+}
+
+
+/*
+ * PrimaryPlacement returns the active placement of the given shard in the
+ * given primary group, or errors out if there is none.
+ */
+static ShardPlacement *
+PrimaryPlacement(uint64 shardId, int32 primaryGroupId)
+{
+	List *placementList = ActiveShardPlacementListOnGroup(shardId, primaryGroupId);
+	if (placementList == NIL)
+	{
+		ereport(ERROR, (errmsg("could not find the primary placement of shard "
+							   UINT64_FORMAT, shardId),
+						errdetail("The primary placement of the asynchronously "
+								  "replicated reference table is in group %d.",
+								  primaryGroupId)));
+	}
+
+	return linitial(placementList);
+}
+
+
+/*
+ * AsyncReplicationConnection opens a connection to the given node as the
+ * extension owner, which may create publications and subscriptions, and
+ * change the shards directly. The connection is not part of the distributed
+ * transaction, since subscriptions with a replication slot cannot be changed
+ * in a transaction block.
+ */
+static MultiConnection *
+AsyncReplicationConnection(char *nodeName, int nodePort)
+{
+	int connectionFlags = FORCE_NEW_CONNECTION | OUTSIDE_TRANSACTION;
+
+	MultiConnection *connection =
+		GetNodeUserDatabaseConnection(connectionFlags, nodeName, nodePort,
+									  CitusExtensionOwnerName(), NULL);
+
+	ExecuteCriticalRemoteCommand(connection,
+								 "SET citus.enable_ddl_propagation TO off");
+	ExecuteCriticalRemoteCommand(connection,
+								 "SET citus.enable_manual_changes_to_shards TO on");
+
+	return connection;
+}
+
+
+/*
+ * EnsurePublicationExists creates the publication of the asynchronously
+ * replicated reference tables on the primary node, if it does not exist yet.
+ */
+static void
+EnsurePublicationExists(MultiConnection *primaryConnection)
+{
+	char *publicationExistsQuery =
+		"SELECT EXISTS (SELECT 1 FROM pg_catalog.pg_publication "
+		"WHERE pubname = '" ASYNC_REPLICATION_PUBLICATION_NAME "')";
+
+	if (!ExecuteRemoteCommandAndCheckResult(primaryConnection, publicationExistsQuery,
+											"t"))
+	{
+		ExecuteCriticalRemoteCommand(primaryConnection,
+									 "CREATE PUBLICATION "
+									 ASYNC_REPLICATION_PUBLICATION_NAME);
+	}
+}
+
+
+/*
+ * EnsureSubscriptionExists creates the subscription of a replica node to the
+ * publication of the given primary node, if it does not exist yet. With
+ * copyData, the subscription first copies the tables of the publication.
+ */
+static void
+EnsureSubscriptionExists(MultiConnection *replicaConnection,
+						 ShardPlacement *primaryPlacement, int32 replicaGroupId,
+						 bool copyData)
+{
+	char *subscriptionName = AsyncReplicationSubscriptionName(primaryPlacement->groupId);
+
+	if (RemoteSubscriptionExists(replicaConnection, subscriptionName))
+	{
+		return;
+	}
+
+	StringInfo conninfo = makeStringInfo();
+	appendStringInfo(conninfo, "host='%s' port=%d user='%s' dbname='%s' "
+							   "connect_timeout=20",
+					 escape_param_str(primaryPlacement->nodeName),
+					 primaryPlacement->nodePort,
+					 escape_param_str(CitusExtensionOwnerName()),
+					 escape_param_str(get_database_name(MyDatabaseId)));
+
+	StringInfo createSubscriptionCommand = makeStringInfo();
+	appendStringInfo(createSubscriptionCommand,
+					 "CREATE SUBSCRIPTION %s CONNECTION %s PUBLICATION %s "
+					 "WITH (citus_use_authinfo=true, create_slot=true, "
+					 "slot_name=%s, copy_data=%s",
+					 subscriptionName,
+					 quote_literal_cstr(conninfo->data),
+					 ASYNC_REPLICATION_PUBLICATION_NAME,
+					 AsyncReplicationSlotName(replicaGroupId),
+					 copyData ? "true" : "false");
+
+#if PG_VERSION_NUM >= PG_VERSION_16
+
+	/* the subscription is owned by a superuser, which ignores the setting */
+	appendStringInfoString(createSubscriptionCommand, ", password_required=false");
+#endif
+
+	appendStringInfoString(createSubscriptionCommand, ")");
+
+	ExecuteCriticalRemoteCommand(replicaConnection, createSubscriptionCommand->data);
+}
+
+
+/*
+ * DropSubscriptionIfExists drops the given subscription on a replica node.
+ * The replication slot of the subscription is left to the cleanup that was
+ * registered when its node was removed, since it might not exist anymore.
+ */
+static void
+DropSubscriptionIfExists(MultiConnection *replicaConnection, char *subscriptionName)
+{
+	if (!RemoteSubscriptionExists(replicaConnection, subscriptionName))
+	{
+		return;
+	}
+
+	ExecuteCriticalRemoteCommand(replicaConnection,
+								 psprintf("ALTER SUBSCRIPTION %s DISABLE",
+										  subscriptionName));
+	ExecuteCriticalRemoteCommand(replicaConnection,
+								 psprintf("ALTER SUBSCRIPTION %s SET (slot_name = NONE)",
+										  subscriptionName));
+	ExecuteCriticalRemoteCommand(replicaConnection,
+								 psprintf("DROP SUBSCRIPTION %s", subscriptionName));
+}
+
+
+/*
+ * RemoteSubscriptionExists returns whether the given subscription exists in
+ * the database of the given connection.
+ */
+static bool
+RemoteSubscriptionExists(MultiConnection *replicaConnection, char *subscriptionName)
+{
+	char *subscriptionExistsQuery =
+		psprintf("SELECT EXISTS (SELECT 1 FROM pg_catalog.pg_subscription "
+				 "WHERE subname = %s AND subdbid = (SELECT oid FROM "
+				 "pg_catalog.pg_database WHERE datname = "
+				 "pg_catalog.current_database()))",
+				 quote_literal_cstr(subscriptionName));
+
+	return ExecuteRemoteCommandAndCheckResult(replicaConnection,
+											  subscriptionExistsQuery, "t");
+}
+
+
+/*
+ * WaitForReplicaToCatchUp waits until the given subscription finished the
+ * initial copy of its tables and applied the changes up to the given
+ * position of the primary node. It returns false if that did not happen
+ * before the deadline, a deadline of 0 waits indefinitely.
+ */
+static bool
+WaitForReplicaToCatchUp(MultiConnection *replicaConnection, char *subscriptionName,
+						XLogRecPtr primaryPosition, TimestampTz deadline)
+{
+	char *quotedSubscriptionName = quote_literal_cstr(subscriptionName);
+	char *replicaPositionQuery =
+		psprintf("SELECT CASE WHEN EXISTS (SELECT 1 FROM "
+				 "pg_catalog.pg_subscription_rel r JOIN pg_catalog.pg_subscription s "
+				 "ON (r.srsubid = s.oid) WHERE s.subname = %s AND "
+				 "r.srsubstate <> 'r') THEN NULL ELSE (SELECT latest_end_lsn "
+				 "FROM pg_catalog.pg_stat_subscription WHERE subname = %s AND "
+				 "relid IS NULL) END",
+				 quotedSubscriptionName, quotedSubscriptionName);
+
+	while (true)
+	{
+		XLogRecPtr replicaPosition = GetRemoteLSN(replicaConnection,
+												  replicaPositionQuery);
+		if (replicaPosition != InvalidXLogRecPtr && replicaPosition >= primaryPosition)
+		{
+			return true;
+		}
+
+		if (deadline != 0 && GetCurrentTimestamp() >= deadline)
+		{
+			return false;
+		}
+
+		int latchFlags = WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH;
+		int rc = WaitLatch(MyLatch, latchFlags, ASYNC_REPLICA_POLL_INTERVAL_MS,
+						   PG_WAIT_EXTENSION);
+
+		if (rc & WL_LATCH_SET)
+		{
+			ResetLatch(MyLatch);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+
+/*
+ * AsyncReplicationSubscriptionName returns the name of the subscriptions to
+ * the publication of the primary node in the given group.
+ */
+static char *
+AsyncReplicationSubscriptionName(int32 primaryGroupId)
+{
+	return psprintf(ASYNC_REPLICATION_SUBSCRIPTION_PREFIX "%d", primaryGroupId);
+}
+
+
+/*
+ * AsyncReplicationSlotName returns the name of the replication slot on a
+ * primary node of the subscription of the node in the given group.
+ */
+static char *
+AsyncReplicationSlotName(int32 replicaGroupId)
+{
+	return psprintf(ASYNC_REPLICATION_SLOT_PREFIX "%d", replicaGroupId);
+}
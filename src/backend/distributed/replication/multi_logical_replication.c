@@ -105,6 +105,18 @@ static const char *subscriptionRolePrefix[] = {
 /* GUC variable, defaults to 2 hours */
 int LogicalReplicationTimeout = 2 * 60 * 60 * 1000;
 
+/*
+ * GUC variable, when enabled a shard move decodes the changes of all the
+ * table owners of the shard group using a single replication slot.
+ */
+bool LogicalReplicationSingleSlot = false;
+
+/*
+ * GUC variable, when enabled the subscriptions of shard moves and splits
+ * stream large in-progress transactions, and apply them in parallel on PG16+.
+ */
+bool LogicalReplicationParallelApply = false;
+
 
 /* see the comment in master_move_shard_placement */
 bool PlacementMovedUsingLogicalReplicationInTX = false;
@@ -127,17 +139,18 @@ static List * ConvertNonExistingPlacementDDLCommandsToTasks(List *shardCommandLi
 static void ExecuteClusterOnCommands(List *logicalRepTargetList);
 static void ExecuteCreateIndexStatisticsCommands(List *logicalRepTargetList);
 static void ExecuteRemainingPostLoadTableCommands(List *logicalRepTargetList);
-static char * escape_param_str(const char *str);
-static XLogRecPtr GetRemoteLSN(MultiConnection *connection, char *command);
 static void WaitForMiliseconds(long timeout);
 static XLogRecPtr GetSubscriptionPosition(
 	GroupedLogicalRepTargets *groupedLogicalRepTargets);
 static void AcquireLogicalReplicationLock(void);
 
 static HTAB * CreateShardMovePublicationInfoHash(WorkerNode *targetNode,
-												 List *shardIntervals);
+												 List *shardIntervals,
+												 Oid replicationOwnerId);
 static List * CreateShardMoveLogicalRepTargetList(HTAB *publicationInfoHash,
-												  List *shardList);
+												  List *shardList,
+												  Oid replicationOwnerId);
+static char * SubscriptionOwnerMemberOfRoles(LogicalRepTarget *target);
 static void WaitForGroupedLogicalRepTargetsToCatchUp(XLogRecPtr sourcePosition,
 													 GroupedLogicalRepTargets *
 													 groupedLogicalRepTargets);
@@ -183,11 +196,28 @@ LogicallyReplicateShards(List *shardList, char *sourceNodeName, int sourceNodePo
 	WorkerNode *sourceNode = FindWorkerNode(sourceNodeName, sourceNodePort);
 	WorkerNode *targetNode = FindWorkerNode(targetNodeName, targetNodePort);
 
+	/*
+	 * By default we create a publication, replication slot and subscription
+	 * per table owner, which means the WAL of the source node is decoded once
+	 * for every owner. When citus.logical_replication_single_slot is enabled
+	 * all shards in the group are replicated through the publication of the
+	 * owner of the first shard, and the subscription owner is made a member
+	 * of all the table owners instead.
+	 */
+	Oid replicationOwnerId = InvalidOid;
+	if (LogicalReplicationSingleSlot)
+	{
+		ShardInterval *firstShardInterval =
+			(ShardInterval *) linitial(replicationSubscriptionList);
+		replicationOwnerId = TableOwnerOid(firstShardInterval->relationId);
+	}
+
 	HTAB *publicationInfoHash = CreateShardMovePublicationInfoHash(
-		targetNode, replicationSubscriptionList);
+		targetNode, replicationSubscriptionList, replicationOwnerId);
 
 	List *logicalRepTargetList = CreateShardMoveLogicalRepTargetList(publicationInfoHash,
-																	 shardList);
+																	 shardList,
+																	 replicationOwnerId);
 
 	HTAB *groupedLogicalRepTargetsHash = CreateGroupedLogicalRepTargetsHash(
 		logicalRepTargetList);
@@ -407,9 +437,13 @@ CompleteNonBlockingShardTransfer(List *shardList,
  * node, the resulting hashmap can have multiple PublicationInfos in it.
  * The reason for that is that we need a separate publication for each
  * distributed table owning user in the shard group.
+ *
+ * If replicationOwnerId is valid, all shards are added to the publication of
+ * that owner instead.
  */
 static HTAB *
-CreateShardMovePublicationInfoHash(WorkerNode *targetNode, List *shardIntervals)
+CreateShardMovePublicationInfoHash(WorkerNode *targetNode, List *shardIntervals,
+								   Oid replicationOwnerId)
 {
 	HTAB *publicationInfoHash = CreateSimpleHash(NodeAndOwner, PublicationInfo);
 	ShardInterval *shardInterval = NULL;
@@ -417,7 +451,9 @@ CreateShardMovePublicationInfoHash(WorkerNode *targetNode, List *shardIntervals)
 	{
 		NodeAndOwner key;
 		key.nodeId = targetNode->nodeId;
-		key.tableOwnerId = TableOwnerOid(shardInterval->relationId);
+		key.tableOwnerId = OidIsValid(replicationOwnerId) ?
+						   replicationOwnerId :
+						   TableOwnerOid(shardInterval->relationId);
 		bool found = false;
 		PublicationInfo *publicationInfo =
 			(PublicationInfo *) hash_search(publicationInfoHash, &key,
@@ -442,7 +478,8 @@ CreateShardMovePublicationInfoHash(WorkerNode *targetNode, List *shardIntervals)
  * publicationHash.
  */
 static List *
-CreateShardMoveLogicalRepTargetList(HTAB *publicationInfoHash, List *shardList)
+CreateShardMoveLogicalRepTargetList(HTAB *publicationInfoHash, List *shardList,
+									Oid replicationOwnerId)
 {
 	List *logicalRepTargetList = NIL;
 
@@ -478,7 +515,9 @@ CreateShardMoveLogicalRepTargetList(HTAB *publicationInfoHash, List *shardList)
 	{
 		NodeAndOwner key;
 		key.nodeId = nodeId;
-		key.tableOwnerId = TableOwnerOid(shardInterval->relationId);
+		key.tableOwnerId = OidIsValid(replicationOwnerId) ?
+						   replicationOwnerId :
+						   TableOwnerOid(shardInterval->relationId);
 
 		bool found = false;
 		publication = (PublicationInfo *) hash_search(
@@ -763,7 +802,7 @@ ExecuteCreateIndexCommands(List *logicalRepTargetList)
 							"(indexes)")));
 
 	ExecuteTaskListOutsideTransaction(ROW_MODIFY_NONE, taskList,
-									  MaxAdaptiveExecutorPoolSize,
+									  ShardTransferPoolSize(),
 									  NIL);
 }
 
@@ -1483,8 +1522,6 @@ CreateSubscriptions(MultiConnection *sourceConnection,
 	LogicalRepTarget *target = NULL;
 	foreach_ptr(target, logicalRepTargetList)
 	{
-		int ownerId = target->tableOwnerId;
-
 		WorkerNode *worker = FindWorkerNode(target->superuserConnection->hostname,
 											target->superuserConnection->port);
 
@@ -1503,7 +1540,7 @@ CreateSubscriptions(MultiConnection *sourceConnection,
 				psprintf(
 					"CREATE USER %s SUPERUSER IN ROLE %s;",
 					quote_identifier(target->subscriptionOwnerName),
-					quote_identifier(GetUserNameFromId(ownerId, false))
+					SubscriptionOwnerMemberOfRoles(target)
 					)));
 
 		InsertCleanupRecordOutsideTransaction(CLEANUP_OBJECT_USER,
@@ -1552,6 +1589,23 @@ CreateSubscriptions(MultiConnection *sourceConnection,
 						 quote_identifier(target->publication->name),
 						 quote_identifier(target->replicationSlot->name));
 
+		if (LogicalReplicationParallelApply)
+		{
+			/*
+			 * Without streaming, the apply worker only receives a transaction
+			 * once it committed on the source, and then applies it by itself,
+			 * which makes large write transactions the bottleneck of the
+			 * catch-up. With streaming=parallel, PG16+ hands such transactions
+			 * to parallel apply workers while they are still running on the
+			 * source. Older versions can only stream them to the apply worker.
+			 */
+#if PG_VERSION_NUM >= PG_VERSION_16
+			appendStringInfoString(createSubscriptionCommand, ", streaming=parallel");
+#else
+			appendStringInfoString(createSubscriptionCommand, ", streaming=on");
+#endif
+		}
+
 		if (EnableBinaryProtocol)
 		{
 			appendStringInfoString(createSubscriptionCommand, ", binary=true)");
@@ -1594,6 +1648,43 @@ CreateSubscriptions(MultiConnection *sourceConnection,
 }
 
 
+/*
+ * SubscriptionOwnerMemberOfRoles returns the comma separated list of roles
+ * that the subscription owner of the given target should be a member of,
+ * which are the owners of all the tables that the subscription applies
+ * changes to. Usually that is only target->tableOwnerId, but a single
+ * subscription can replicate the shards of multiple owners when
+ * citus.logical_replication_single_slot is enabled.
+ */
+static char *
+SubscriptionOwnerMemberOfRoles(LogicalRepTarget *target)
+{
+	List *ownerIdList = list_make1_oid(target->tableOwnerId);
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, target->newShards)
+	{
+		ownerIdList = list_append_unique_oid(ownerIdList,
+											 TableOwnerOid(shardInterval->relationId));
+	}
+
+	StringInfo roleList = makeStringInfo();
+	Oid ownerId = InvalidOid;
+	foreach_oid(ownerId, ownerIdList)
+	{
+		if (roleList->len > 0)
+		{
+			appendStringInfoString(roleList, ", ");
+		}
+
+		appendStringInfoString(roleList,
+							   quote_identifier(GetUserNameFromId(ownerId, false)));
+	}
+
+	return roleList->data;
+}
+
+
 /*
  * EnableSubscriptions enables all the the subscriptions in the
  * logicalRepTargetList. This means the replication slot will start to be read
@@ -1621,7 +1712,7 @@ EnableSubscriptions(List *logicalRepTargetList)
  *
  * Copied from dblink.c to escape libpq params
  */
-static char *
+char *
 escape_param_str(const char *str)
 {
 	StringInfoData buf;
@@ -1655,7 +1746,7 @@ GetRemoteLogPosition(MultiConnection *connection)
  * GetRemoteLSN executes a command that returns a single LSN over the given connection
  * and returns it as an XLogRecPtr (uint64).
  */
-static XLogRecPtr
+XLogRecPtr
 GetRemoteLSN(MultiConnection *connection, char *command)
 {
 	bool raiseInterrupts = false;
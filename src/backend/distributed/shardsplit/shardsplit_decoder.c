@@ -10,8 +10,11 @@
 #include "postgres.h"
 
 #include "catalog/pg_namespace.h"
+#include "common/hashfn.h"
 #include "replication/logical.h"
+#include "utils/builtins.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/typcache.h"
 
 #include "distributed/listutils.h"
@@ -27,6 +30,15 @@ static LogicalDecodeChangeCB pgOutputPluginChangeCB;
 #define InvalidRepOriginId 0
 
 static HTAB *SourceToDestinationShardMap = NULL;
+
+/*
+ * Changes tend to come in runs for the same relation, so we remember the map
+ * entry of the last source relation to skip the hash lookup. A NULL entry
+ * means that the relation is not split by the current replication slot.
+ */
+static Oid LastSourceShardRelationOid = InvalidOid;
+static SourceToDestinationShardMapEntry *LastSourceShardMapEntry = NULL;
+
 static bool replication_origin_filter_cb(LogicalDecodingContext *ctx, RepOriginId
 										 origin_id);
 
@@ -36,10 +48,16 @@ static void shard_split_change_cb(LogicalDecodingContext *ctx,
 								  Relation relation, ReorderBufferChange *change);
 
 /* Helper methods */
+static SourceToDestinationShardMapEntry * GetSourceShardMapEntry(Relation
+																 sourceShardRelation,
+																 char *currentSlotName);
+static void InitializeSourceShardHashFunction(SourceToDestinationShardMapEntry *entry,
+											  Relation sourceShardRelation);
 static int32_t GetHashValueForIncomingTuple(Relation sourceShardRelation,
 											HeapTuple tuple,
-											int partitionColumIndex,
-											Oid distributedTableOid);
+											SourceToDestinationShardMapEntry *entry);
+static ShardSplitInfo * FindChildShardForHashValue(
+	SourceToDestinationShardMapEntry *entry, int32 hashValue);
 
 static Oid FindTargetRelationOid(Relation sourceShardRelation,
 								 HeapTuple tuple,
@@ -171,12 +189,21 @@ shard_split_change_cb(LogicalDecodingContext *ctx, ReorderBufferTXN *txn,
 
 	/*
 	 * Initialize SourceToDestinationShardMap if not already initialized.
-	 * This gets initialized during the replication of first message.
+	 * This gets initialized during the replication of first message, and
+	 * filled in as the changes of each relation arrive.
 	 */
 	if (SourceToDestinationShardMap == NULL)
 	{
-		SourceToDestinationShardMap = PopulateSourceToDestinationShardMapForSlot(
-			replicationSlotName, TopMemoryContext);
+		HASHCTL info;
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(Oid);
+		info.entrysize = sizeof(SourceToDestinationShardMapEntry);
+		info.hash = uint32_hash;
+		info.hcxt = TopMemoryContext;
+
+		int hashFlags = (HASH_ELEM | HASH_CONTEXT | HASH_FUNCTION);
+		SourceToDestinationShardMap = hash_create("SourceToDestinationShardMap", 128,
+												  &info, hashFlags);
 	}
 
 	Oid targetRelationOid = InvalidOid;
@@ -304,14 +331,8 @@ FindTargetRelationOid(Relation sourceShardRelation,
 					  HeapTuple tuple,
 					  char *currentSlotName)
 {
-	Oid targetRelationOid = InvalidOid;
-	Oid sourceShardRelationOid = sourceShardRelation->rd_id;
-
-	/* Get child shard list for source(parent) shard from hashmap*/
-	bool found = false;
-	SourceToDestinationShardMapEntry *entry =
-		(SourceToDestinationShardMapEntry *) hash_search(
-			SourceToDestinationShardMap, &sourceShardRelationOid, HASH_FIND, &found);
+	SourceToDestinationShardMapEntry *entry = GetSourceShardMapEntry(sourceShardRelation,
+																	 currentSlotName);
 
 	/*
 	 * Source shard Oid might not exist in the hash map. This can happen
@@ -324,30 +345,104 @@ FindTargetRelationOid(Relation sourceShardRelation,
 	 * Commit 'b' should be skipped as the source shard and destination for commit 'b'
 	 * are same and the commit has already been applied.
 	 */
-	if (!found)
+	if (entry == NULL)
 	{
 		return InvalidOid;
 	}
 
-	ShardSplitInfo *shardSplitInfo = (ShardSplitInfo *) lfirst(list_head(
-																   entry->
-																   shardSplitInfoList));
-	int hashValue = GetHashValueForIncomingTuple(sourceShardRelation, tuple,
-												 shardSplitInfo->partitionColumnIndex,
-												 shardSplitInfo->distributedTableOid);
+	int32 hashValue = GetHashValueForIncomingTuple(sourceShardRelation, tuple, entry);
 
-	shardSplitInfo = NULL;
-	foreach_ptr(shardSplitInfo, entry->shardSplitInfoList)
+	ShardSplitInfo *shardSplitInfo = FindChildShardForHashValue(entry, hashValue);
+	if (shardSplitInfo == NULL)
 	{
-		if (shardSplitInfo->shardMinValue <= hashValue &&
-			shardSplitInfo->shardMaxValue >= hashValue)
-		{
-			targetRelationOid = shardSplitInfo->splitChildShardOid;
-			break;
-		}
+		return InvalidOid;
+	}
+
+	return shardSplitInfo->splitChildShardOid;
+}
+
+
+/*
+ * GetSourceShardMapEntry returns the SourceToDestinationShardMap entry of the
+ * given source shard relation, or NULL if the current replication slot does not
+ * split it. The child shards of a relation are copied from shared memory on
+ * its first change. The result of the last lookup is reused for consecutive
+ * changes of the same relation.
+ */
+static SourceToDestinationShardMapEntry *
+GetSourceShardMapEntry(Relation sourceShardRelation, char *currentSlotName)
+{
+	Oid sourceShardRelationOid = RelationGetRelid(sourceShardRelation);
+	if (sourceShardRelationOid == LastSourceShardRelationOid)
+	{
+		return LastSourceShardMapEntry;
 	}
 
-	return targetRelationOid;
+	bool found = false;
+	SourceToDestinationShardMapEntry *entry =
+		(SourceToDestinationShardMapEntry *) hash_search(
+			SourceToDestinationShardMap, &sourceShardRelationOid, HASH_ENTER, &found);
+	if (!found)
+	{
+		entry->childShardCount = 0;
+		entry->sortedChildShardArray = NULL;
+		entry->hashFunction = NULL;
+		entry->hashFunctionCollation = InvalidOid;
+
+		MemoryContext oldContext = MemoryContextSwitchTo(TopMemoryContext);
+
+		entry->sortedChildShardArray =
+			GetShardSplitChildShards(sourceShardRelationOid, currentSlotName,
+									 &entry->childShardCount);
+
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	if (entry->childShardCount == 0)
+	{
+		entry = NULL;
+	}
+	else if (entry->hashFunction == NULL)
+	{
+		InitializeSourceShardHashFunction(entry, sourceShardRelation);
+	}
+
+	LastSourceShardRelationOid = sourceShardRelationOid;
+	LastSourceShardMapEntry = entry;
+
+	return entry;
+}
+
+
+/*
+ * InitializeSourceShardHashFunction looks up the hash function of the partition
+ * column of the source shard and stores a copy of it in the map entry, such that
+ * the type cache does not need to be consulted for every change.
+ */
+static void
+InitializeSourceShardHashFunction(SourceToDestinationShardMapEntry *entry,
+								  Relation sourceShardRelation)
+{
+	ShardSplitInfo *shardSplitInfo = &entry->sortedChildShardArray[0];
+	TupleDesc relationTupleDes = RelationGetDescr(sourceShardRelation);
+	Form_pg_attribute partitionColumn = TupleDescAttr(relationTupleDes,
+													  shardSplitInfo->
+													  partitionColumnIndex);
+
+	TypeCacheEntry *typeEntry = lookup_type_cache(partitionColumn->atttypid,
+												  TYPECACHE_HASH_PROC_FINFO);
+	if (!OidIsValid(typeEntry->hash_proc_finfo.fn_oid))
+	{
+		ereport(ERROR, (errmsg("could not identify a hash function for type %s",
+							   format_type_be(partitionColumn->atttypid))));
+	}
+
+	FmgrInfo *hashFunction = MemoryContextAllocZero(TopMemoryContext,
+													sizeof(FmgrInfo));
+	fmgr_info_copy(hashFunction, &(typeEntry->hash_proc_finfo), TopMemoryContext);
+
+	entry->hashFunctionCollation = typeEntry->typcollation;
+	entry->hashFunction = hashFunction;
 }
 
 
@@ -358,31 +453,67 @@ FindTargetRelationOid(Relation sourceShardRelation,
 static int32_t
 GetHashValueForIncomingTuple(Relation sourceShardRelation,
 							 HeapTuple tuple,
-							 int partitionColumnIndex,
-							 Oid distributedTableOid)
+							 SourceToDestinationShardMapEntry *entry)
 {
-	TupleDesc relationTupleDes = RelationGetDescr(sourceShardRelation);
-	Form_pg_attribute partitionColumn = TupleDescAttr(relationTupleDes,
-													  partitionColumnIndex);
+	int partitionColumnIndex = entry->sortedChildShardArray[0].partitionColumnIndex;
 
 	bool isNull = false;
 	Datum partitionColumnValue = heap_getattr(tuple,
 											  partitionColumnIndex + 1,
-											  relationTupleDes,
+											  RelationGetDescr(sourceShardRelation),
 											  &isNull);
 
-	TypeCacheEntry *typeEntry = lookup_type_cache(partitionColumn->atttypid,
-												  TYPECACHE_HASH_PROC_FINFO);
-
 	/* get hashed value of the distribution value */
-	Datum hashedValueDatum = FunctionCall1Coll(&(typeEntry->hash_proc_finfo),
-											   typeEntry->typcollation,
+	Datum hashedValueDatum = FunctionCall1Coll(entry->hashFunction,
+											   entry->hashFunctionCollation,
 											   partitionColumnValue);
 
 	return DatumGetInt32(hashedValueDatum);
 }
 
 
+/*
+ * FindChildShardForHashValue does a binary search over the child shards of the
+ * entry, which are sorted by their hash range, and returns the one whose range
+ * contains the given hash value. It returns NULL if the child shard that covers
+ * the hash value is not handled by the current replication slot.
+ */
+static ShardSplitInfo *
+FindChildShardForHashValue(SourceToDestinationShardMapEntry *entry, int32 hashValue)
+{
+	int lowerBoundIndex = 0;
+	int upperBoundIndex = entry->childShardCount;
+
+	/* find the last child shard whose range starts at or before the hash value */
+	while (lowerBoundIndex < upperBoundIndex)
+	{
+		int middleIndex = lowerBoundIndex + (upperBoundIndex - lowerBoundIndex) / 2;
+
+		if (entry->sortedChildShardArray[middleIndex].shardMinValue <= hashValue)
+		{
+			lowerBoundIndex = middleIndex + 1;
+		}
+		else
+		{
+			upperBoundIndex = middleIndex;
+		}
+	}
+
+	if (lowerBoundIndex == 0)
+	{
+		return NULL;
+	}
+
+	ShardSplitInfo *shardSplitInfo = &entry->sortedChildShardArray[lowerBoundIndex - 1];
+	if (shardSplitInfo->shardMaxValue < hashValue)
+	{
+		return NULL;
+	}
+
+	return shardSplitInfo;
+}
+
+
 /*
  * GetTupleForTargetSchema returns a tuple with the schema of the target relation.
  * If some columns within the source relations are dropped, we would have to reformat
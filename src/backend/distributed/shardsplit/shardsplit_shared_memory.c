@@ -1,10 +1,9 @@
 /*-------------------------------------------------------------------------
  *
  * shardsplit_shared_memory.c
- *    API's for creating and accessing shared memory segments to store
- *    shard split information. 'setup_shard_replication' UDF creates the
- *    shared memory, populates the contents and WAL sender processes are
- *    the consumers.
+ *    API's for storing and accessing shard split information in a dynamic
+ *    shared memory area. 'worker_split_shard_replication_setup' UDF populates
+ *    the contents and WAL sender processes are the consumers.
  *
  * Copyright (c) Citus Data, Inc.
  *
@@ -13,11 +12,11 @@
 
 #include "postgres.h"
 
-#include "common/hashfn.h"
 #include "storage/ipc.h"
 #include "utils/memutils.h"
 
 #include "distributed/citus_safe_lib.h"
+#include "distributed/listutils.h"
 #include "distributed/multi_logical_replication.h"
 #include "distributed/shardinterval_utils.h"
 #include "distributed/shardsplit_shared_memory.h"
@@ -25,346 +24,449 @@
 const char *SharedMemoryNameForHandleManagement =
 	"Shared memory handle for shard split";
 
+static const char *ShardSplitTrancheName = "Split Shard Setup Tranche";
+
 static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 
+/* area and hash table of the shard split information, once attached */
+static dsa_area *ShardSplitInfoArea = NULL;
+static dshash_table *ShardSplitInfoHash = NULL;
+
 /* Function declarations */
-static ShardSplitInfoSMHeader * AllocateSharedMemoryForShardSplitInfo(int
-																	  shardSplitInfoCount,
-																	  Size
-																	  shardSplitInfoSize,
-																	  dsm_handle *
-																	  dsmHandle);
-static ShardSplitInfoSMHeader * GetShardSplitInfoSMHeaderFromDSMHandle(dsm_handle
-																	   dsmHandle);
-static dsm_handle GetShardSplitSharedMemoryHandle(void);
 static void ShardSplitShmemInit(void);
+static ShardSplitShmemData * GetShardSplitShmemData(void);
+static bool AttachShardSplitInfoHash(bool createIfMissing);
+static void StoreShardSplitChildShards(ShardSplitShmemData *smData,
+									   ShardSplitInfo **childShardArray,
+									   int childShardCount);
+static void UnlinkShardSplitChildShards(ShardSplitShmemData *smData,
+										dsa_pointer childShardsPointer);
+static void MakeShardSplitInfoKey(ShardSplitInfoKey *key, Oid sourceShardOid,
+								  char *slotName);
+static bool ShardSplitInfoHasSameKey(ShardSplitInfo *leftInfo,
+									 ShardSplitInfo *rightInfo);
+static int CompareShardSplitInfo(const void *leftElement, const void *rightElement);
+
 
 /*
- * GetShardSplitInfoSMHeaderFromDSMHandle returns the header of the shared memory
- * segment. It pins the mapping till lifetime of the backend process accessing it.
+ * InitializeShardSplitSMHandleManagement sets up the shared memory startup
+ * hook. The statically allocated shared memory holds the handles of the
+ * dynamic shared memory area in which the split information is stored.
  */
-static ShardSplitInfoSMHeader *
-GetShardSplitInfoSMHeaderFromDSMHandle(dsm_handle dsmHandle)
+void
+InitializeShardSplitSMHandleManagement(void)
 {
-	dsm_segment *dsmSegment = dsm_find_mapping(dsmHandle);
+	prev_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = ShardSplitShmemInit;
+}
 
-	if (dsmSegment == NULL)
-	{
-		dsmSegment = dsm_attach(dsmHandle);
-	}
 
-	if (dsmSegment == NULL)
+static void
+ShardSplitShmemInit(void)
+{
+	bool alreadyInitialized = false;
+	ShardSplitShmemData *smData = ShmemInitStruct(SharedMemoryNameForHandleManagement,
+												  sizeof(ShardSplitShmemData),
+												  &alreadyInitialized);
+
+	if (!alreadyInitialized)
 	{
-		ereport(ERROR,
-				(errmsg("could not attach to dynamic shared memory segment "
-						"corresponding to handle:%u", dsmHandle)));
-	}
+		NamedLWLockTranche *namedLockTranche =
+			&smData->namedLockTranche;
 
-	/*
-	 * Detatching segment associated with resource owner with 'dsm_pin_mapping' call before the
-	 * resource owner releases, to avoid warning being logged and potential leaks.
-	 */
-	dsm_pin_mapping(dsmSegment);
+		/* start by zeroing out all the memory */
+		memset(smData, 0,
+			   sizeof(ShardSplitShmemData));
 
-	ShardSplitInfoSMHeader *header = (ShardSplitInfoSMHeader *) dsm_segment_address(
-		dsmSegment);
+		namedLockTranche->trancheId = LWLockNewTrancheId();
 
-	if (header == NULL)
-	{
-		ereport(ERROR,
-				(errmsg("Could not get shared memory segment header "
-						"corresponding to handle for split workflow:%u", dsmHandle)));
+		LWLockRegisterTranche(namedLockTranche->trancheId, ShardSplitTrancheName);
+		LWLockInitialize(&smData->lock,
+						 namedLockTranche->trancheId);
+
+		smData->dsaHandle = DSM_HANDLE_INVALID;
+		smData->hashHandle = InvalidDsaPointer;
+		smData->childShardsList = InvalidDsaPointer;
 	}
 
-	return header;
+	if (prev_shmem_startup_hook != NULL)
+	{
+		prev_shmem_startup_hook();
+	}
 }
 
 
 /*
- * GetShardSplitInfoSMHeader returns pointer to the header of shared memory segment.
+ * GetShardSplitShmemData returns the statically allocated shared memory for
+ * shard splits.
  */
-ShardSplitInfoSMHeader *
-GetShardSplitInfoSMHeader()
+static ShardSplitShmemData *
+GetShardSplitShmemData(void)
 {
-	dsm_handle dsmHandle = GetShardSplitSharedMemoryHandle();
-
-	ShardSplitInfoSMHeader *shardSplitInfoSMHeader =
-		GetShardSplitInfoSMHeaderFromDSMHandle(dsmHandle);
+	bool found = false;
+	ShardSplitShmemData *smData = ShmemInitStruct(SharedMemoryNameForHandleManagement,
+												  sizeof(ShardSplitShmemData),
+												  &found);
+	if (!found)
+	{
+		ereport(ERROR,
+				errmsg(
+					"Shared memory for handle management should have been initialized during boot"));
+	}
 
-	return shardSplitInfoSMHeader;
+	return smData;
 }
 
 
 /*
- * AllocateSharedMemoryForShardSplitInfo is used to allocate and store
- * information about the shard undergoing a split. The function allocates dynamic
- * shared memory segment consisting of a header and an array of ShardSplitInfo structure.
- * The contents of this shared memory segment are consumed by WAL sender process
- * during catch up phase of replication through logical decoding plugin.
- *
- * The shared memory segment exists till the catch up phase completes or the
- * postmaster shutsdown.
+ * AttachShardSplitInfoHash attaches the current backend to the dynamic shared
+ * memory area and hash table of the shard split information. The first backend
+ * that stores split information creates them, and they live until the
+ * postmaster shuts down, such that splits do not need to create their own
+ * segments. The function returns false if they do not exist and createIfMissing
+ * is false.
  */
-static ShardSplitInfoSMHeader *
-AllocateSharedMemoryForShardSplitInfo(int shardSplitInfoCount, Size shardSplitInfoSize,
-									  dsm_handle *dsmHandle)
+static bool
+AttachShardSplitInfoHash(bool createIfMissing)
 {
-	if (shardSplitInfoCount <= 0 || shardSplitInfoSize <= 0)
+	if (ShardSplitInfoHash != NULL)
 	{
-		ereport(ERROR,
-				(errmsg("shardSplitInfoCount and size of each step should be "
-						"positive values")));
+		return true;
 	}
 
-	Size totalSize = offsetof(ShardSplitInfoSMHeader, splitInfoArray) +
-					 (shardSplitInfoCount * shardSplitInfoSize);
-	dsm_segment *dsmSegment = dsm_create(totalSize, DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	ShardSplitShmemData *smData = GetShardSplitShmemData();
+	int trancheId = smData->namedLockTranche.trancheId;
+
+	dshash_parameters hashParams = {
+		.key_size = sizeof(ShardSplitInfoKey),
+		.entry_size = sizeof(ShardSplitInfoHashEntry),
+		.compare_function = dshash_memcmp,
+		.hash_function = dshash_memhash,
+		.tranche_id = trancheId
+	};
+
+	LWLockRegisterTranche(trancheId, ShardSplitTrancheName);
 
-	if (dsmSegment == NULL)
+	LWLockAcquire(&smData->lock, LW_EXCLUSIVE);
+
+	if (smData->dsaHandle == DSM_HANDLE_INVALID && !createIfMissing)
 	{
-		ereport(ERROR,
-				(errmsg("could not create a dynamic shared memory segment to "
-						"store shard split info")));
+		LWLockRelease(&smData->lock);
+		return false;
 	}
 
-	*dsmHandle = dsm_segment_handle(dsmSegment);
+	/* the area and hash table are used for the lifetime of the backend */
+	MemoryContext oldContext = MemoryContextSwitchTo(TopMemoryContext);
 
-	/*
-	 * Pin the segment till Postmaster shutsdown since we need this
-	 * segment even after the session ends for replication catchup phase.
-	 */
-	dsm_pin_segment(dsmSegment);
+	if (smData->dsaHandle == DSM_HANDLE_INVALID)
+	{
+		ShardSplitInfoArea = dsa_create(trancheId);
 
-	ShardSplitInfoSMHeader *shardSplitInfoSMHeader =
-		GetShardSplitInfoSMHeaderFromDSMHandle(*dsmHandle);
+		/* keep the area after the current backend exits */
+		dsa_pin(ShardSplitInfoArea);
 
-	shardSplitInfoSMHeader->count = shardSplitInfoCount;
+		ShardSplitInfoHash = dshash_create(ShardSplitInfoArea, &hashParams, NULL);
 
-	return shardSplitInfoSMHeader;
-}
+		smData->dsaHandle = dsa_get_handle(ShardSplitInfoArea);
+		smData->hashHandle = dshash_get_hash_table_handle(ShardSplitInfoHash);
+	}
+	else
+	{
+		ShardSplitInfoArea = dsa_attach(smData->dsaHandle);
+		ShardSplitInfoHash = dshash_attach(ShardSplitInfoArea, &hashParams,
+										   smData->hashHandle, NULL);
+	}
 
+	/* keep the mapping after the resource owner of the current statement is released */
+	dsa_pin_mapping(ShardSplitInfoArea);
 
-/*
- * CreateSharedMemoryForShardSplitInfo is a wrapper function which creates shared memory
- * for storing shard split infomation. The function returns pointer to the header of
- * shared memory segment.
- *
- * shardSplitInfoCount - number of 'ShardSplitInfo ' elements to be allocated
- * dsmHandle           - handle of the allocated shared memory segment
- */
-ShardSplitInfoSMHeader *
-CreateSharedMemoryForShardSplitInfo(int shardSplitInfoCount, dsm_handle *dsmHandle)
-{
-	ShardSplitInfoSMHeader *shardSplitInfoSMHeader =
-		AllocateSharedMemoryForShardSplitInfo(shardSplitInfoCount,
-											  sizeof(ShardSplitInfo),
-											  dsmHandle);
-	return shardSplitInfoSMHeader;
+	MemoryContextSwitchTo(oldContext);
+	LWLockRelease(&smData->lock);
+
+	return true;
 }
 
 
 /*
- * ReleaseSharedMemoryOfShardSplitInfo releases(unpins) the dynamic shared memory segment
- * allocated by 'worker_split_shard_replication_setup'. This shared memory was pinned
- * to Postmaster process and is valid till Postmaster shutsdown or
- * explicitly unpinned by calling 'dsm_unpin_segment'.
+ * StoreShardSplitInfoList stores the given split information, whose slot names
+ * are filled in, into shared memory. The child shards of each source shard and
+ * replication slot are stored together, sorted by their hash range, replacing
+ * those of an earlier split that used the same slot.
+ *
+ * The information exists till worker_split_shard_release_dsm releases it or the
+ * postmaster shuts down.
  */
 void
-ReleaseSharedMemoryOfShardSplitInfo()
+StoreShardSplitInfoList(List *shardSplitInfoList)
 {
-	/* Get handle of dynamic shared memory segment*/
-	dsm_handle dsmHandle = GetShardSplitSharedMemoryHandle();
-
-	if (dsmHandle == DSM_HANDLE_INVALID)
+	int shardSplitInfoCount = list_length(shardSplitInfoList);
+	if (shardSplitInfoCount == 0)
 	{
 		return;
 	}
 
-	/*
-	 * Unpin the dynamic shared memory segment. 'dsm_pin_segment' was
-	 * called previously by 'AllocateSharedMemoryForShardSplitInfo'.
-	 */
-	dsm_unpin_segment(dsmHandle);
+	ShardSplitInfo **sortedShardSplitInfoArray =
+		palloc0(shardSplitInfoCount * sizeof(ShardSplitInfo *));
+
+	int shardSplitInfoIndex = 0;
+	ShardSplitInfo *shardSplitInfo = NULL;
+	foreach_ptr(shardSplitInfo, shardSplitInfoList)
+	{
+		sortedShardSplitInfoArray[shardSplitInfoIndex++] = shardSplitInfo;
+	}
+
+	SafeQsort(sortedShardSplitInfoArray, shardSplitInfoCount, sizeof(ShardSplitInfo *),
+			  CompareShardSplitInfo);
+
+	AttachShardSplitInfoHash(true);
+
+	ShardSplitShmemData *smData = GetShardSplitShmemData();
+	LWLockAcquire(&smData->lock, LW_EXCLUSIVE);
 
 	/*
-	 * As dynamic shared memory is unpinned, store an invalid handle in static
-	 * shared memory used for handle management.
+	 * In a normal situation, the split information of the previous split shard
+	 * workflow should have been released before the current function is called.
+	 * If it is still there, it means cleanup of previous split shard workflow
+	 * failed. Log a warning and continue the current shard split operation.
 	 */
-	StoreShardSplitSharedMemoryHandle(DSM_HANDLE_INVALID);
+	bool previousSplitNotReleased = DsaPointerIsValid(smData->childShardsList);
+
+	int firstChildIndex = 0;
+	while (firstChildIndex < shardSplitInfoCount)
+	{
+		int childShardCount = 1;
+		while (firstChildIndex + childShardCount < shardSplitInfoCount &&
+			   ShardSplitInfoHasSameKey(
+				   sortedShardSplitInfoArray[firstChildIndex],
+				   sortedShardSplitInfoArray[firstChildIndex + childShardCount]))
+		{
+			childShardCount++;
+		}
+
+		StoreShardSplitChildShards(smData, &sortedShardSplitInfoArray[firstChildIndex],
+								   childShardCount);
+
+		firstChildIndex += childShardCount;
+	}
+
+	LWLockRelease(&smData->lock);
+
+	if (previousSplitNotReleased)
+	{
+		ereport(WARNING,
+				errmsg(
+					"Previous split shard worflow was not successfully and could not complete the cleanup phase."
+					" Continuing with the current split shard workflow."));
+	}
 }
 
 
 /*
- * InitializeShardSplitSMHandleManagement requests the necessary shared memory
- * from Postgres and sets up the shared memory startup hook.
- * This memory is used to store handle of other shared memories allocated during split workflow.
+ * StoreShardSplitChildShards copies the given child shards of a source shard
+ * and replication slot, which are sorted by their hash range, into the area and
+ * adds them to the hash table. The caller holds the lock of smData.
  */
-void
-InitializeShardSplitSMHandleManagement(void)
+static void
+StoreShardSplitChildShards(ShardSplitShmemData *smData, ShardSplitInfo **childShardArray,
+						   int childShardCount)
 {
-	prev_shmem_startup_hook = shmem_startup_hook;
-	shmem_startup_hook = ShardSplitShmemInit;
-}
+	ShardSplitInfoKey key;
+	MakeShardSplitInfoKey(&key, childShardArray[0]->sourceShardOid,
+						  childShardArray[0]->slotName);
 
+	Size childShardsSize = add_size(offsetof(ShardSplitChildShards, childShardArray),
+									mul_size(childShardCount, sizeof(ShardSplitInfo)));
+	dsa_pointer childShardsPointer = dsa_allocate(ShardSplitInfoArea, childShardsSize);
 
-static void
-ShardSplitShmemInit(void)
-{
-	bool alreadyInitialized = false;
-	ShardSplitShmemData *smData = ShmemInitStruct(SharedMemoryNameForHandleManagement,
-												  sizeof(ShardSplitShmemData),
-												  &alreadyInitialized);
+	ShardSplitChildShards *childShards =
+		(ShardSplitChildShards *) dsa_get_address(ShardSplitInfoArea,
+												  childShardsPointer);
+	childShards->key = key;
+	childShards->childShardCount = childShardCount;
 
-	if (!alreadyInitialized)
+	for (int childShardIndex = 0; childShardIndex < childShardCount; childShardIndex++)
 	{
-		char *trancheName = "Split Shard Setup Tranche";
-
-		NamedLWLockTranche *namedLockTranche =
-			&smData->namedLockTranche;
+		childShards->childShardArray[childShardIndex] = *childShardArray[childShardIndex];
+	}
 
-		/* start by zeroing out all the memory */
-		memset(smData, 0,
-			   sizeof(ShardSplitShmemData));
+	childShards->next = smData->childShardsList;
+	smData->childShardsList = childShardsPointer;
 
-		namedLockTranche->trancheId = LWLockNewTrancheId();
+	bool found = false;
+	ShardSplitInfoHashEntry *entry =
+		(ShardSplitInfoHashEntry *) dshash_find_or_insert(ShardSplitInfoHash, &key,
+														  &found);
+	dsa_pointer replacedChildShardsPointer =
+		found ? entry->childShards : InvalidDsaPointer;
+	entry->childShards = childShardsPointer;
+	dshash_release_lock(ShardSplitInfoHash, entry);
+
+	/* decoders copy the child shards under the entry lock, so they are done with them */
+	if (DsaPointerIsValid(replacedChildShardsPointer))
+	{
+		UnlinkShardSplitChildShards(smData, replacedChildShardsPointer);
+		dsa_free(ShardSplitInfoArea, replacedChildShardsPointer);
+	}
+}
 
-		LWLockRegisterTranche(namedLockTranche->trancheId, trancheName);
-		LWLockInitialize(&smData->lock,
-						 namedLockTranche->trancheId);
 
-		smData->dsmHandle = DSM_HANDLE_INVALID;
-	}
+/*
+ * UnlinkShardSplitChildShards removes the given child shards from the list of
+ * all child shards in smData. The caller holds the lock of smData.
+ */
+static void
+UnlinkShardSplitChildShards(ShardSplitShmemData *smData, dsa_pointer childShardsPointer)
+{
+	dsa_pointer *link = &smData->childShardsList;
 
-	if (prev_shmem_startup_hook != NULL)
+	while (DsaPointerIsValid(*link))
 	{
-		prev_shmem_startup_hook();
+		ShardSplitChildShards *childShards =
+			(ShardSplitChildShards *) dsa_get_address(ShardSplitInfoArea, *link);
+
+		if (*link == childShardsPointer)
+		{
+			*link = childShards->next;
+			return;
+		}
+
+		link = &childShards->next;
 	}
 }
 
 
 /*
- * StoreShardSplitSharedMemoryHandle stores a handle of shared memory
- * allocated and populated by 'worker_split_shard_replication_setup' UDF.
- * This handle is stored in a different statically allocated shared memory
- * segment with name 'Shared memory handle for shard split'.
+ * ReleaseSharedMemoryOfShardSplitInfo releases the split information stored by
+ * 'worker_split_shard_replication_setup'. The area itself is kept for later
+ * splits.
  */
 void
-StoreShardSplitSharedMemoryHandle(dsm_handle dsmHandle)
+ReleaseSharedMemoryOfShardSplitInfo()
 {
-	bool found = false;
-	ShardSplitShmemData *smData = ShmemInitStruct(SharedMemoryNameForHandleManagement,
-												  sizeof(ShardSplitShmemData),
-												  &found);
-	if (!found)
+	if (!AttachShardSplitInfoHash(false))
 	{
-		ereport(ERROR,
-				errmsg(
-					"Shared memory for handle management should have been initialized during boot"));
+		return;
 	}
 
-	/*
-	 * We only support non concurrent split. However, it is fine to take a
-	 * lock and store the handle incase concurrent splits are introduced in future.
-	 */
+	ShardSplitShmemData *smData = GetShardSplitShmemData();
 	LWLockAcquire(&smData->lock, LW_EXCLUSIVE);
 
-	/*
-	 * In a normal situation, previously stored handle should have been invalidated
-	 * before the current function is called.
-	 * If this handle is still valid, it means cleanup of previous split shard
-	 * workflow failed. Log a waring and continue the current shard split operation.
-	 * Skip warning if new handle to be stored is invalid. We store invalid handle
-	 * when shared memory is released by calling worker_split_shard_release_dsm.
-	 */
-	if (smData->dsmHandle != DSM_HANDLE_INVALID && dsmHandle != DSM_HANDLE_INVALID)
+	dsa_pointer childShardsPointer = smData->childShardsList;
+	while (DsaPointerIsValid(childShardsPointer))
 	{
-		ereport(WARNING,
-				errmsg(
-					"Previous split shard worflow was not successfully and could not complete the cleanup phase."
-					" Continuing with the current split shard workflow."));
+		ShardSplitChildShards *childShards =
+			(ShardSplitChildShards *) dsa_get_address(ShardSplitInfoArea,
+													  childShardsPointer);
+		dsa_pointer nextChildShardsPointer = childShards->next;
+
+		dshash_delete_key(ShardSplitInfoHash, &childShards->key);
+		dsa_free(ShardSplitInfoArea, childShardsPointer);
+
+		childShardsPointer = nextChildShardsPointer;
 	}
 
-	/* Store the incoming handle */
-	smData->dsmHandle = dsmHandle;
+	smData->childShardsList = InvalidDsaPointer;
 
 	LWLockRelease(&smData->lock);
 }
 
 
 /*
- * GetShardSplitSharedMemoryHandle returns the handle of dynamic shared memory segment stored
- * by 'worker_split_shard_replication_setup' UDF. This handle is requested by WAL sender processes
- * during logical replication phase or during cleanup.
+ * GetShardSplitChildShards returns a copy of the child shards of the given
+ * source shard that the given replication slot routes changes to, sorted by
+ * their hash range, or NULL if the slot does not split the source shard.
  */
-dsm_handle
-GetShardSplitSharedMemoryHandle(void)
+ShardSplitInfo *
+GetShardSplitChildShards(Oid sourceShardOid, char *slotName, int *childShardCount)
 {
-	bool found = false;
-	ShardSplitShmemData *smData = ShmemInitStruct(SharedMemoryNameForHandleManagement,
-												  sizeof(ShardSplitShmemData),
-												  &found);
-	if (!found)
+	*childShardCount = 0;
+
+	if (!AttachShardSplitInfoHash(false))
 	{
-		ereport(ERROR,
-				errmsg(
-					"Shared memory for handle management should have been initialized during boot"));
+		return NULL;
 	}
 
-	LWLockAcquire(&smData->lock, LW_SHARED);
-	dsm_handle dsmHandle = smData->dsmHandle;
-	LWLockRelease(&smData->lock);
+	ShardSplitInfoKey key;
+	MakeShardSplitInfoKey(&key, sourceShardOid, slotName);
+
+	ShardSplitInfoHashEntry *entry =
+		(ShardSplitInfoHashEntry *) dshash_find(ShardSplitInfoHash, &key, false);
+	if (entry == NULL)
+	{
+		return NULL;
+	}
+
+	ShardSplitChildShards *childShards =
+		(ShardSplitChildShards *) dsa_get_address(ShardSplitInfoArea,
+												  entry->childShards);
 
-	return dsmHandle;
+	Size childShardArraySize = childShards->childShardCount * sizeof(ShardSplitInfo);
+	ShardSplitInfo *childShardArray = palloc(childShardArraySize);
+	memcpy_s(childShardArray, childShardArraySize, childShards->childShardArray,
+			 childShardArraySize);
+	*childShardCount = childShards->childShardCount;
+
+	dshash_release_lock(ShardSplitInfoHash, entry);
+
+	return childShardArray;
+}
+
+
+/*
+ * MakeShardSplitInfoKey fills in the key of the given source shard and
+ * replication slot. The key is zeroed first, since the hash table hashes and
+ * compares its bytes.
+ */
+static void
+MakeShardSplitInfoKey(ShardSplitInfoKey *key, Oid sourceShardOid, char *slotName)
+{
+	memset(key, 0, sizeof(ShardSplitInfoKey));
+	key->sourceShardOid = sourceShardOid;
+	strlcpy(key->slotName, slotName, NAMEDATALEN);
+}
+
+
+/*
+ * ShardSplitInfoHasSameKey returns whether the given split information belongs
+ * to the same source shard and replication slot.
+ */
+static bool
+ShardSplitInfoHasSameKey(ShardSplitInfo *leftInfo, ShardSplitInfo *rightInfo)
+{
+	return leftInfo->sourceShardOid == rightInfo->sourceShardOid &&
+		   strncmp(leftInfo->slotName, rightInfo->slotName, NAMEDATALEN) == 0;
 }
 
 
 /*
- * PopulateSourceToDestinationShardMapForSlot populates 'SourceToDestinationShard' hash map for a given slot.
- * Key of the map is Oid of source shard which is undergoing a split and value is a list of corresponding child shards.
- * To populate the map, the function traverses 'ShardSplitInfo' array stored within shared memory segment.
+ * CompareShardSplitInfo is a comparator to sort pointers to ShardSplitInfo by
+ * replication slot, source shard and the start of their hash range.
  */
-HTAB *
-PopulateSourceToDestinationShardMapForSlot(char *slotName, MemoryContext cxt)
+static int
+CompareShardSplitInfo(const void *leftElement, const void *rightElement)
 {
-	HASHCTL info;
-	memset(&info, 0, sizeof(info));
-	info.keysize = sizeof(Oid);
-	info.entrysize = sizeof(SourceToDestinationShardMapEntry);
-	info.hash = uint32_hash;
-	info.hcxt = cxt;
+	const ShardSplitInfo *leftInfo = *((const ShardSplitInfo **) leftElement);
+	const ShardSplitInfo *rightInfo = *((const ShardSplitInfo **) rightElement);
 
-	int hashFlags = (HASH_ELEM | HASH_CONTEXT | HASH_FUNCTION);
-	HTAB *sourceShardToDesShardMap = hash_create("SourceToDestinationShardMap", 128,
-												 &info, hashFlags);
+	int slotNameCompare = strncmp(leftInfo->slotName, rightInfo->slotName, NAMEDATALEN);
+	if (slotNameCompare != 0)
+	{
+		return slotNameCompare;
+	}
 
-	MemoryContext oldContext = MemoryContextSwitchTo(cxt);
+	if (leftInfo->sourceShardOid != rightInfo->sourceShardOid)
+	{
+		return (leftInfo->sourceShardOid < rightInfo->sourceShardOid) ? -1 : 1;
+	}
 
-	ShardSplitInfoSMHeader *smHeader = GetShardSplitInfoSMHeader();
-	for (int index = 0; index < smHeader->count; index++)
+	if (leftInfo->shardMinValue < rightInfo->shardMinValue)
 	{
-		if (strcmp(smHeader->splitInfoArray[index].slotName, slotName) == 0)
-		{
-			Oid sourceShardOid = smHeader->splitInfoArray[index].sourceShardOid;
-			bool found = false;
-			SourceToDestinationShardMapEntry *entry =
-				(SourceToDestinationShardMapEntry *) hash_search(
-					sourceShardToDesShardMap, &sourceShardOid, HASH_ENTER, &found);
-
-			if (!found)
-			{
-				entry->shardSplitInfoList = NIL;
-				entry->sourceShardKey = sourceShardOid;
-			}
-
-			ShardSplitInfo *shardSplitInfoForSlot = (ShardSplitInfo *) palloc0(
-				sizeof(ShardSplitInfo));
-			*shardSplitInfoForSlot = smHeader->splitInfoArray[index];
-
-			entry->shardSplitInfoList = lappend(entry->shardSplitInfoList,
-												(ShardSplitInfo *) shardSplitInfoForSlot);
-		}
+		return -1;
+	}
+	else if (leftInfo->shardMinValue > rightInfo->shardMinValue)
+	{
+		return 1;
 	}
 
-	MemoryContextSwitchTo(oldContext);
-	return sourceShardToDesShardMap;
+	return 0;
 }
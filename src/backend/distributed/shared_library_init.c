@@ -53,27 +53,40 @@
 #include "distributed/adaptive_executor.h"
 #include "distributed/backend_data.h"
 #include "distributed/background_jobs.h"
+#include "distributed/bulk_insert_select.h"
 #include "distributed/causal_clock.h"
+#include "distributed/citus_custom_scan.h"
 #include "distributed/citus_depended_object.h"
 #include "distributed/citus_nodefuncs.h"
 #include "distributed/citus_safe_lib.h"
 #include "distributed/combine_query_planner.h"
+#include "distributed/column_result_format.h"
 #include "distributed/commands.h"
 #include "distributed/commands/multi_copy.h"
 #include "distributed/commands/utility_hook.h"
+#include "distributed/connection_counters.h"
 #include "distributed/connection_management.h"
 #include "distributed/coordinator_protocol.h"
 #include "distributed/cte_inline.h"
+#include "distributed/deparse_shard_query.h"
+#include "distributed/directed_acyclic_graph_execution.h"
 #include "distributed/distributed_deadlock_detection.h"
 #include "distributed/distributed_planner.h"
+#include "distributed/distributed_table_statistics.h"
 #include "distributed/errormessage.h"
+#include "distributed/executor_memory_budget.h"
+#include "distributed/insert_buffer.h"
+#include "distributed/insert_select_executor.h"
 #include "distributed/intermediate_result_pruning.h"
+#include "distributed/intermediate_results.h"
 #include "distributed/local_distributed_join_planner.h"
 #include "distributed/local_executor.h"
 #include "distributed/local_multi_copy.h"
 #include "distributed/locally_reserved_shared_connections.h"
 #include "distributed/log_utils.h"
 #include "distributed/maintenanced.h"
+#include "distributed/memory_intermediate_results.h"
+#include "distributed/merge_executor.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/metadata_sync.h"
 #include "distributed/metadata_utility.h"
@@ -85,37 +98,54 @@
 #include "distributed/multi_physical_planner.h"
 #include "distributed/multi_router_planner.h"
 #include "distributed/multi_server_executor.h"
+#include "distributed/node_latency_stats.h"
 #include "distributed/pg_dist_partition.h"
 #include "distributed/placement_connection.h"
 #include "distributed/priority.h"
 #include "distributed/query_pushdown_planning.h"
+#include "distributed/query_result_cache.h"
 #include "distributed/query_stats.h"
 #include "distributed/recursive_planning.h"
 #include "distributed/reference_table_utils.h"
 #include "distributed/relation_access_tracking.h"
+#include "distributed/remote_command_trace.h"
 #include "distributed/remote_commands.h"
+#include "distributed/remote_prepared_statements.h"
 #include "distributed/remote_transaction.h"
 #include "distributed/repartition_executor.h"
+#include "distributed/repartition_join_execution.h"
 #include "distributed/replication_origin_session_utils.h"
 #include "distributed/resource_lock.h"
+#include "distributed/result_compression.h"
+#include "distributed/router_proxy.h"
 #include "distributed/run_from_same_connection.h"
 #include "distributed/shard_cleaner.h"
+#include "distributed/shard_pruning.h"
+#include "distributed/shard_query_cache.h"
 #include "distributed/shard_rebalancer.h"
+#include "distributed/shard_size_cache.h"
+#include "distributed/shard_split.h"
 #include "distributed/shard_transfer.h"
+#include "distributed/shard_transfer_throttle.h"
 #include "distributed/shardsplit_shared_memory.h"
 #include "distributed/shared_connection_stats.h"
 #include "distributed/shared_library_init.h"
+#include "distributed/shared_placement_cache.h"
 #include "distributed/statistics_collection.h"
 #include "distributed/subplan_execution.h"
+#include "distributed/task_execution_trace.h"
 #include "distributed/time_constants.h"
 #include "distributed/transaction_management.h"
 #include "distributed/transaction_recovery.h"
+#include "distributed/tuple_destination.h"
 #include "distributed/utils/citus_stat_tenants.h"
 #include "distributed/utils/directory.h"
 #include "distributed/worker_log_messages.h"
 #include "distributed/worker_manager.h"
 #include "distributed/worker_protocol.h"
+#include "distributed/worker_shard_copy.h"
 #include "distributed/worker_shard_visibility.h"
+#include "distributed/worker_transaction.h"
 
 /* marks shared object as one loadable by the postgres version compiled against */
 PG_MODULE_MAGIC;
@@ -124,6 +154,10 @@ ColumnarSupportsIndexAM_type extern_ColumnarSupportsIndexAM = NULL;
 CompressionTypeStr_type extern_CompressionTypeStr = NULL;
 IsColumnarTableAmTable_type extern_IsColumnarTableAmTable = NULL;
 ReadColumnarOptions_type extern_ReadColumnarOptions = NULL;
+ColumnarTableRelationIdList_type extern_ColumnarTableRelationIdList = NULL;
+ColumnarCompactSmallStripes_type extern_ColumnarCompactSmallStripes = NULL;
+ColumnarStripeTransferSupported_type extern_ColumnarStripeTransferSupported = NULL;
+ColumnarExportStripes_type extern_ColumnarExportStripes = NULL;
 
 /*
  * Define "pass-through" functions so that a SQL function defined as one of
@@ -206,7 +240,9 @@ static bool ShowShardsForAppNamePrefixesCheckHook(char **newval, void **extra,
 												  GucSource source);
 static void ShowShardsForAppNamePrefixesAssignHook(const char *newval, void *extra);
 static void ApplicationNameAssignHook(const char *newval, void *extra);
+static void CacheNodeAddressesAssignHook(bool newval, void *extra);
 static void CpuPriorityAssignHook(int newval, void *extra);
+static void ShardTransferMaxRateAssignHook(int newval, void *extra);
 static bool NodeConninfoGucCheckHook(char **newval, void **extra, GucSource source);
 static void NodeConninfoGucAssignHook(const char *newval, void *extra);
 static const char * MaxSharedPoolSizeGucShowHook(void);
@@ -222,6 +258,13 @@ static emit_log_hook_type original_emit_log_hook = NULL;
 
 /* *INDENT-OFF* */
 /* GUC enum definitions */
+static const struct config_enum_entry parallel_copy_to_options[] = {
+	{ "off", PARALLEL_COPY_TO_OFF, false },
+	{ "ordered", PARALLEL_COPY_TO_ORDERED, false },
+	{ "unordered", PARALLEL_COPY_TO_UNORDERED, false },
+	{ NULL, 0, false }
+};
+
 static const struct config_enum_entry propagate_set_commands_options[] = {
 	{"none", PROPSETCMD_NONE, false},
 	{"local", PROPSETCMD_LOCAL, false},
@@ -295,6 +338,7 @@ static const struct config_enum_entry local_table_join_policies[] = {
 	{ "prefer-local", LOCAL_JOIN_POLICY_PREFER_LOCAL, false},
 	{ "prefer-distributed", LOCAL_JOIN_POLICY_PREFER_DISTRIBUTED, false},
 	{ "auto", LOCAL_JOIN_POLICY_AUTO, false},
+	{ "cost-based", LOCAL_JOIN_POLICY_COST_BASED, false},
 	{ NULL, 0, false}
 };
 
@@ -305,6 +349,30 @@ static const struct config_enum_entry multi_shard_modify_connection_options[] =
 	{ NULL, 0, false }
 };
 
+static const struct config_enum_entry execution_priority_options[] = {
+	{ "low", EXECUTION_PRIORITY_LOW, false },
+	{ "normal", EXECUTION_PRIORITY_NORMAL, false },
+	{ "high", EXECUTION_PRIORITY_HIGH, false },
+	{ NULL, 0, false }
+};
+
+static const struct config_enum_entry intermediate_result_compression_options[] = {
+	{ "none", RESULT_COMPRESSION_NONE, false },
+#if HAVE_CITUS_LIBLZ4
+	{ "lz4", RESULT_COMPRESSION_LZ4, false },
+#endif
+#if HAVE_LIBZSTD
+	{ "zstd", RESULT_COMPRESSION_ZSTD, false },
+#endif
+	{ NULL, 0, false }
+};
+
+static const struct config_enum_entry intermediate_result_format_options[] = {
+	{ "copy", INTERMEDIATE_RESULT_FORMAT_COPY, false },
+	{ "columnar", INTERMEDIATE_RESULT_FORMAT_COLUMNAR, false },
+	{ NULL, 0, false }
+};
+
 static const struct config_enum_entry explain_analyze_sort_method_options[] = {
 	{ "execution-time", EXPLAIN_ANALYZE_SORT_BY_TIME, false },
 	{ "taskId", EXPLAIN_ANALYZE_SORT_BY_TASK_ID, false },
@@ -492,6 +560,17 @@ _PG_init(void)
 	InitRelationAccessHash();
 	InitializeCitusQueryStats();
 	InitializeSharedConnectionStats();
+	InitializeNodeLatencyStats();
+	InitializeConnectionCounters();
+	InitializeTaskExecutionTraces();
+	InitializeRemoteCommandTraces();
+	InitializeRouterProxy();
+	InitializeMemoryIntermediateResults();
+	InitializeQueryResultCache();
+	InitializeSharedPlacementCache();
+	InitializeShardSizeCache();
+	InitializeExecutorMemoryBudget();
+	InitializeShardTransferThrottle();
 	InitializeLocallyReservedSharedConnections();
 	InitializeClusterClockMem();
 
@@ -564,6 +643,11 @@ _PG_init(void)
 	INIT_COLUMNAR_SYMBOL(CompressionTypeStr_type, CompressionTypeStr);
 	INIT_COLUMNAR_SYMBOL(IsColumnarTableAmTable_type, IsColumnarTableAmTable);
 	INIT_COLUMNAR_SYMBOL(ReadColumnarOptions_type, ReadColumnarOptions);
+	INIT_COLUMNAR_SYMBOL(ColumnarTableRelationIdList_type, ColumnarTableRelationIdList);
+	INIT_COLUMNAR_SYMBOL(ColumnarCompactSmallStripes_type, ColumnarCompactSmallStripes);
+	INIT_COLUMNAR_SYMBOL(ColumnarStripeTransferSupported_type,
+						 ColumnarStripeTransferSupported);
+	INIT_COLUMNAR_SYMBOL(ColumnarExportStripes_type, ColumnarExportStripes);
 
 	/* initialize symbols for "pass-through" functions */
 	INIT_COLUMNAR_SYMBOL(PGFunction, columnar_handler);
@@ -619,6 +703,17 @@ citus_shmem_request(void)
 
 	RequestAddinShmemSpace(BackendManagementShmemSize());
 	RequestAddinShmemSpace(SharedConnectionStatsShmemSize());
+	RequestAddinShmemSpace(NodeLatencyStatsShmemSize());
+	RequestAddinShmemSpace(ConnectionCountersShmemSize());
+	RequestAddinShmemSpace(TaskExecutionTraceShmemSize());
+	RequestAddinShmemSpace(RemoteCommandTraceShmemSize());
+	RequestAddinShmemSpace(RouterProxyShmemSize());
+	RequestAddinShmemSpace(MemoryIntermediateResultsShmemSize());
+	RequestAddinShmemSpace(QueryResultCacheShmemSize());
+	RequestAddinShmemSpace(SharedPlacementCacheShmemSize());
+	RequestAddinShmemSpace(ShardSizeCacheShmemSize());
+	RequestAddinShmemSpace(ExecutorMemoryBudgetShmemSize());
+	RequestAddinShmemSpace(ShardTransferThrottleShmemSize());
 	RequestAddinShmemSpace(MaintenanceDaemonShmemSize());
 	RequestAddinShmemSpace(CitusQueryStatsSharedMemSize());
 	RequestAddinShmemSpace(LogicalClockShmemSize());
@@ -994,6 +1089,53 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.array_restriction_split_threshold",
+		gettext_noop("Sets the minimum number of array elements of a distribution "
+					 "column = ANY(array) filter for sending each shard only the "
+					 "elements that hash to it."),
+		gettext_noop("When a query with such a filter is sent to multiple shards, "
+					 "the array in the query of each shard is reduced to the "
+					 "elements that belong to that shard. Arrays with fewer "
+					 "elements are sent as they are. Set to -1 to disable."),
+		&ArrayRestrictionSplitThreshold,
+		100, -1, INT_MAX,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.avoid_degraded_nodes",
+		gettext_noop("Makes router queries read from placements on degraded nodes "
+					 "last."),
+		gettext_noop("When a read-only router query can use several placements, "
+					 "such as with reference tables or replicated shards, the "
+					 "placements on nodes that the health probes of the "
+					 "maintenance daemon found degraded are tried after the "
+					 "others, independent of citus.task_assignment_policy. See "
+					 "citus.node_health_check_interval and "
+					 "citus.degraded_node_threshold."),
+		&AvoidDegradedNodes,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.background_task_balance_nodes",
+		gettext_noop("Starts the background tasks of the least busy nodes first."),
+		gettext_noop("By default, the background task queue monitor starts runnable "
+					 "tasks in the order of their task ids. When enabled, it "
+					 "starts the runnable task whose involved nodes run the fewest "
+					 "tasks, which keeps all nodes busy when "
+					 "citus.max_background_task_executors_per_node is larger than "
+					 "1."),
+		&BackgroundTaskBalanceNodes,
+		false,
+		PGC_SIGHUP,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.background_task_queue_interval",
 		gettext_noop("Time to wait between checks for scheduled background tasks."),
@@ -1004,6 +1146,56 @@ RegisterCitusConfigVariables(void)
 		GUC_UNIT_MS,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.broadcast_join_threshold",
+		gettext_noop("Sets the maximum size of distributed tables that are "
+					 "broadcast in non-co-located joins."),
+		gettext_noop("When a query joins distributed tables that are not "
+					 "co-located, the tables that are not co-located with the "
+					 "largest table and are smaller than this threshold are "
+					 "sent to all nodes as intermediate results, instead of "
+					 "repartitioning the tables. The sizes are those recorded "
+					 "by citus_update_table_statistics. 0 disables this."),
+		&BroadcastJoinThreshold,
+		0, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_UNIT_KB | GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.buffer_ddl_propagation",
+		gettext_noop("Buffers the DDL commands propagated to nodes with metadata "
+					 "in a transaction block."),
+		gettext_noop("Each DDL command on a distributed table is propagated to "
+					 "the shell tables on the nodes with metadata right away, "
+					 "which costs several round trips per command. When enabled, "
+					 "the commands are kept until a statement might observe them, "
+					 "until another command is sent to the nodes, or until the "
+					 "transaction commits, and are then sent with a single round "
+					 "trip per node. Errors of buffered commands are reported by "
+					 "the statement that sends them."),
+		&BufferDDLPropagation,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.cache_node_addresses",
+		gettext_noop("Resolves the host names of nodes once for their connections."),
+		gettext_noop("libpq resolves the host name of every new connection, which "
+					 "adds to the connection establishment time. When enabled, "
+					 "each backend resolves the host name of a node once and "
+					 "passes the address to libpq as hostaddr, until the "
+					 "configuration is reloaded. The host name "
+					 "is still used for authentication and for verifying server "
+					 "certificates."),
+		&CacheNodeAddresses,
+		false,
+		PGC_SIGHUP,
+		GUC_STANDARD,
+		NULL, CacheNodeAddressesAssignHook, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.check_available_space_before_move",
 		gettext_noop("When enabled will check free disk space before a shard move"),
@@ -1025,6 +1217,41 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.columnar_stripe_compaction_interval",
+		gettext_noop("Sets the time to wait between merging the small stripes of "
+					 "columnar tables in the background."),
+		gettext_noop("Inserting a few rows at a time into columnar tables creates "
+					 "many small stripes, which compress poorly and slow down "
+					 "scans. The maintenance daemon merges the adjacent small "
+					 "stripes of the columnar tables without indexes at the "
+					 "interval configured here, skipping the tables that it "
+					 "cannot lock without waiting. When set to -1 this background "
+					 "process is skipped."),
+		&ColumnarStripeCompactionInterval,
+		-1, -1, 7 * 24 * 3600 * 1000,
+		PGC_SIGHUP,
+		GUC_UNIT_MS,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.commit_prepared_timeout",
+		gettext_noop("Sets the time to wait for the nodes to commit the prepared "
+					 "transactions of a two-phase commit."),
+		gettext_noop("By default, a two-phase commit returns to the client once "
+					 "all nodes committed their prepared transactions. When set, "
+					 "it returns after the given time, and the prepared "
+					 "transactions on slow nodes are committed by them or by "
+					 "transaction recovery in the background. Subsequent "
+					 "commands might then not immediately see the writes of the "
+					 "committed transaction on those nodes. -1 disables the "
+					 "timeout."),
+		&CommitPreparedTimeout,
+		-1, -1, INT_MAX,
+		PGC_USERSET,
+		GUC_UNIT_MS,
+		NULL, NULL, NULL);
+
 	DefineCustomEnumVariable(
 		"citus.coordinator_aggregation_strategy",
 		gettext_noop("Sets the strategy for when an aggregate cannot be pushed down. "
@@ -1160,6 +1387,19 @@ RegisterCitusConfigVariables(void)
 		GUC_UNIT_MS,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.degraded_node_threshold",
+		gettext_noop("Sets the round trip time or replication lag above which a "
+					 "node is considered degraded."),
+		gettext_noop("A node is degraded when its recent health probes failed, "
+					 "or when the average round trip time of the probes or the "
+					 "replication lag of the node exceeds this threshold."),
+		&DegradedNodeThreshold,
+		1000, 1, INT_MAX,
+		PGC_USERSET,
+		GUC_UNIT_MS | GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomRealVariable(
 		"citus.desired_percent_disk_available_after_move",
 		gettext_noop(
@@ -1187,6 +1427,40 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		ErrorIfNotASuitableDeadlockFactor, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.distributed_sequence_cache_size",
+		gettext_noop("Sets the minimum number of sequence values that backends "
+					 "on the workers cache for distributed sequences."),
+		gettext_noop("Sequences used by distributed tables are created on the "
+					 "nodes with metadata with this cache size when the cache "
+					 "size of the sequence is lower. Each backend then allocates "
+					 "that many values at a time, which cuts the contention on "
+					 "the sequence when many backends insert rows. Values "
+					 "cached but not used by a backend are lost, which leaves "
+					 "gaps in the sequence. 0 keeps the cache size of the "
+					 "sequence."),
+		&DistributedSequenceCacheSize,
+		0, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_aggregate_combine_per_node",
+		gettext_noop("Merges the partial aggregates of the shards on each node on "
+					 "that node."),
+		gettext_noop("Multi-shard aggregates send the partial aggregates of each "
+					 "shard and group to the coordinator. When enabled, the shards "
+					 "on a node are queried by a single task that merges their "
+					 "partial counts, sums, minimums, maximums, boolean aggregates "
+					 "and tdigests first, such that the coordinator receives one "
+					 "row per node and group."),
+		&EnableAggregateCombinePerNode,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_alter_database_owner",
 		gettext_noop("Enables propagating ALTER DATABASE ... OWNER TO ... statements to "
@@ -1219,6 +1493,22 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_batched_task_results",
+		gettext_noop("Receives the rows of SELECT tasks in batches rather than "
+					 "one at a time"),
+		gettext_noop("By default, the executor receives the rows that a task returns "
+					 "as a separate libpq result per row, which dominates the CPU "
+					 "time of the coordinator for tasks that return many rows. When "
+					 "enabled, the executor uses chunked rows mode if libpq supports "
+					 "it, and otherwise receives the rows of SELECT tasks via binary "
+					 "COPY when all of their columns support the binary format."),
+		&EnableBatchedTaskResults,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_binary_protocol",
 		gettext_noop(
@@ -1230,6 +1520,38 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_binary_protocol_for_composite_types",
+		gettext_noop("Enables transferring composite types using binary protocol "
+					 "when all of their attributes support it"),
+		gettext_noop("By default, composite types and arrays of composite types "
+					 "are always transferred in text format. When enabled and "
+					 "citus.enable_binary_protocol is on, they are transferred in "
+					 "binary format if all of their attributes have binary send "
+					 "and receive functions."),
+		&EnableBinaryProtocolForCompositeTypes,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_bulk_insert_select",
+		gettext_noop("Inserts the rows of INSERT ... SELECT commands on shards "
+					 "in batches, the way COPY does."),
+		gettext_noop("When enabled, the rows of an INSERT ... SELECT into a shard "
+					 "without triggers, such as the tasks of a co-located "
+					 "INSERT ... SELECT, are buffered and inserted with a bulk "
+					 "insert state, which writes fewer WAL records and avoids "
+					 "evicting the shared buffers. The setting takes effect on "
+					 "the node on which the shard is, so it needs to be enabled "
+					 "on the workers."),
+		&EnableBulkInsertSelect,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_change_data_capture",
 		gettext_noop("Enables using replication origin tracking for change data capture"),
@@ -1253,6 +1575,37 @@ RegisterCitusConfigVariables(void)
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_columnar_stripe_transfer",
+		gettext_noop("Enables copying the stripes of columnar shards as they are "
+					 "stored when moving or copying shards"),
+		gettext_noop("When enabled, shard moves and copies send the compressed "
+					 "stripes of a columnar shard to the target node instead of "
+					 "decompressing its rows and sending them using COPY, if "
+					 "the target node supports it."),
+		&EnableColumnarStripeTransfer,
+		true,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_concurrent_copy_flush",
+		gettext_noop("Enables flushing all connections of a COPY while it waits "
+					 "for one of them to flush."),
+		gettext_noop("When a COPY into a distributed table buffered "
+					 "citus.remote_copy_flush_threshold bytes for a connection, "
+					 "it waits for them to be sent. When enabled, the COPY keeps "
+					 "sending the pending data of its other connections while it "
+					 "waits, such that a slow node does not leave the others "
+					 "idle."),
+		&EnableConcurrentCopyFlush,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_cost_based_connection_establishment",
 		gettext_noop("When enabled the connection establishment times "
@@ -1265,6 +1618,21 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_cost_based_join_order",
+		gettext_noop("Enables choosing the join order of repartition joins based "
+					 "on the table sizes."),
+		gettext_noop("When enabled, the planner picks the join order and the "
+					 "sides of single repartition joins that repartition the "
+					 "least amount of data, based on the shard sizes recorded "
+					 "by citus_update_table_statistics. Otherwise, the join "
+					 "order is only chosen based on the types of the joins."),
+		&EnableCostBasedJoinOrder,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_create_database_propagation",
 		gettext_noop("Enables propagating CREATE DATABASE "
@@ -1297,6 +1665,22 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_ddl_command_batching",
+		gettext_noop("Sends the DDL commands that create an object and its "
+					 "dependencies on other nodes as a single command."),
+		gettext_noop("When creating distributed tables and their dependencies "
+					 "on other nodes, each DDL command is sent separately by "
+					 "default, and the dependencies are created on one node "
+					 "after the other. When enabled, the commands are sent in "
+					 "a single round-trip and the dependencies are created on "
+					 "all nodes in parallel."),
+		&EnableDDLCommandBatching,
+		false,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_ddl_propagation",
 		gettext_noop("Enables propagating DDL statements to worker shards"),
@@ -1322,6 +1706,33 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_distributed_analyze",
+		gettext_noop("Stores the merged statistics of the shards of a Citus table "
+					 "as its statistics on the coordinator when it is analyzed."),
+		gettext_noop("The tables on the coordinator are empty, so without these "
+					 "statistics the planner of the coordinator misestimates "
+					 "the joins of Citus tables with local tables and subplans. "
+					 "ANALYZE then reads the row counts and column statistics "
+					 "of the shards after analyzing them."),
+		&EnableDistributedAnalyze,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_fast_path_planning_context",
+		gettext_noop("Plans fast path router queries in a reused memory context."),
+		gettext_noop("When enabled, fast path router queries are planned in a "
+					 "memory context that is reset after planning, and only the "
+					 "resulting plan is copied out of it."),
+		&EnableFastPathPlanningContext,
+		true,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_fast_path_router_planner",
 		gettext_noop("Enables fast path router planner"),
@@ -1332,6 +1743,85 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_generic_multi_shard_plans",
+		gettext_noop("Enables generic plans for prepared multi-shard SELECT "
+					 "queries."),
+		gettext_noop("By default, prepared statements that query multiple shards "
+					 "are planned again for every execution. When enabled, "
+					 "multi-shard SELECT queries without CTEs or subqueries in "
+					 "expressions are planned once with their parameters sent "
+					 "to the workers, and the tasks on shards that the parameter "
+					 "values exclude are skipped during execution."),
+		&EnableGenericMultiShardPlans,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_incremental_combine",
+		gettext_noop("Combines the results of the tasks of multi-shard queries "
+					 "as the tasks finish."),
+		gettext_noop("When the coordinator sorts or aggregates the results of "
+					 "a multi-shard query, the rows of the tasks are buffered "
+					 "until all the tasks finished by default. When enabled, "
+					 "the sort or aggregate consumes the rows of the tasks that "
+					 "finished while the others are still running, such that "
+					 "only the running aggregate state is kept. This only "
+					 "applies to SELECT queries outside of transaction blocks."),
+		&EnableIncrementalCombine,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_incremental_shard_list_rebuild",
+		gettext_noop("Rebuilds invalidated metadata cache entries by only "
+					 "reading the shards that changed."),
+		gettext_noop("When the placements of some shards of a table change, "
+					 "for instance because a shard is moved, all backends "
+					 "rebuild the metadata of the table by reading all of its "
+					 "shards and placements by default. When enabled, the "
+					 "shards and placements that did not change are copied "
+					 "from the previous metadata of the table."),
+		&EnableIncrementalShardListRebuild,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_interleaved_local_execution",
+		gettext_noop("Executes the local tasks of a query while waiting for its "
+					 "remote tasks."),
+		gettext_noop("When the coordinator has shards, the tasks on those shards "
+					 "are executed locally by default once the tasks on the other "
+					 "nodes finished. When enabled, the local tasks are executed "
+					 "one by one whenever the remote tasks are busy on the "
+					 "workers, such that local and remote work overlap."),
+		&EnableInterleavedLocalExecution,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_limit_early_termination",
+		gettext_noop("Stops executing the remaining tasks once a query with a "
+					 "LIMIT received enough rows."),
+		gettext_noop("For multi-shard queries with a LIMIT and without ORDER BY, "
+					 "aggregates or DISTINCT, any rows satisfy the query. When "
+					 "enabled, the commands that are still running on the workers "
+					 "are cancelled once the tasks returned enough rows. This only "
+					 "applies outside of transaction blocks."),
+		&EnableLimitEarlyTermination,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_local_execution",
 		gettext_noop("Enables queries on shards that are local to the current node "
@@ -1343,6 +1833,20 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_local_execution_slot_tuples",
+		gettext_noop("Stores the rows of local tasks directly from the executor "
+					 "slots."),
+		gettext_noop("When enabled, the rows that local execution returns are "
+					 "put into the tuple store of the distributed query straight "
+					 "from the slots of the shard queries, without forming an "
+					 "intermediate heap tuple for each row."),
+		&EnableLocalExecutionSlotTuples,
+		true,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_local_reference_table_foreign_keys",
 		gettext_noop("Enables foreign keys from/to local tables"),
@@ -1377,6 +1881,25 @@ RegisterCitusConfigVariables(void)
 		GUC_SUPERUSER_ONLY | GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_merge_fragment_fetch_pipelining",
+		gettext_noop("Enables MERGE tasks to fetch the repartitioned source rows "
+					 "of their own shard."),
+		gettext_noop("When the source of a MERGE is repartitioned across the "
+					 "nodes of the target shards, all fragments of the source "
+					 "results are transferred to the nodes of the target shards "
+					 "before any MERGE task starts. When enabled, the MERGE "
+					 "task on each shard fetches the fragments of its shard "
+					 "itself, such that each MERGE starts as soon as its own "
+					 "fragments arrive. MERGE commands with parameters and "
+					 "target tables with replicated shards are executed in "
+					 "the usual way."),
+		&EnableMergeFragmentFetchPipelining,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_metadata_sync",
 		gettext_noop("Enables object and metadata syncing."),
@@ -1387,6 +1910,21 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_node_latency_feedback",
+		gettext_noop("Uses the latencies of earlier executions to decide how many "
+					 "connections to open to a node."),
+		gettext_noop("When enabled, executions keep track of the task execution "
+					 "and connection establishment times of each node in shared "
+					 "memory, and open the number of connections that the "
+					 "recent latencies of a node call for right away, instead "
+					 "of ramping up through citus.executor_slow_start_interval."),
+		&EnableNodeLatencyFeedback,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_non_colocated_router_query_pushdown",
 		gettext_noop("Enables router planner for the queries that reference "
@@ -1407,6 +1945,71 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_one_phase_commit",
+		gettext_noop("Commits transactions in which a single node wrote in one "
+					 "phase."),
+		gettext_noop("Transactions that modify over multiple connections use "
+					 "two-phase commit. Nodes that were only read from are "
+					 "already left out of the prepare phase. When enabled, "
+					 "two-phase commit is skipped altogether if only a single "
+					 "connection modified data and the local node did not "
+					 "write, which saves the PREPARE round trip and the "
+					 "pg_dist_transaction record."),
+		&EnableOnePhaseCommit,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_parallel_subplan_execution",
+		gettext_noop("Runs the tasks of independent CTEs and subqueries that are "
+					 "planned separately concurrently."),
+		gettext_noop("Subplans of a query, such as CTEs that are computed before "
+					 "the rest of the query, are normally executed one after the "
+					 "other. When enabled, the tasks of the subplans that do not "
+					 "use the results of other subplans run in a single "
+					 "distributed execution in read-only queries."),
+		&EnableParallelSubPlanExecution,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_query_result_cache",
+		gettext_noop("Caches the results of read-only queries on reference tables."),
+		gettext_noop("When enabled, the results of router queries that only read "
+					 "reference tables are kept in shared memory of size "
+					 "citus.query_result_cache_size, and returned without "
+					 "executing the query again until one of the tables is "
+					 "modified. Only modifications made via this node invalidate "
+					 "the results. Queries that call volatile or stable "
+					 "functions, and queries in transactions that modified one "
+					 "of the tables or use a single snapshot, are not cached."),
+		&EnableQueryResultCache,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_repartition_join_pipelining",
+		gettext_noop("Starts the tasks of repartition joins as soon as the tasks "
+					 "they depend on finished."),
+		gettext_noop("The map and fetch tasks of repartition joins are normally "
+					 "executed in waves, where a wave only starts once all tasks "
+					 "of the previous wave finished. When enabled, all tasks run "
+					 "in a single distributed execution, in which each task "
+					 "starts once its own dependencies finished, unless some of "
+					 "the tasks access the local node."),
+		&EnableRepartitionJoinPipelining,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_repartition_joins",
 		gettext_noop("Allows Citus to repartition data between nodes."),
@@ -1417,6 +2020,22 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_repartitioned_aggregation",
+		gettext_noop("Enables finalizing GROUP BY aggregates on the workers."),
+		gettext_noop("When a query groups by a column other than the distribution "
+					 "column, the partial aggregates of the shards are finalized "
+					 "on the coordinator. When enabled, the partial aggregates "
+					 "are instead repartitioned by a group key across the shards "
+					 "of the distributed table, such that the workers finalize "
+					 "the groups in parallel and the coordinator only applies "
+					 "DISTINCT, ORDER BY and LIMIT to the finalized groups."),
+		&EnableRepartitionedAggregation,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_repartitioned_insert_select",
 		gettext_noop("Enables repartitioned INSERT/SELECTs"),
@@ -1427,6 +2046,56 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_repartitioned_insert_select_push",
+		gettext_noop("Enables pushing the SELECT results of repartitioned "
+					 "INSERT/SELECTs to the nodes of the target shards."),
+		gettext_noop("When enabled, each SELECT task of a repartitioned "
+					 "INSERT/SELECT streams the partitions of its result to "
+					 "the nodes of the target shards while it executes, "
+					 "rather than writing the partitions to local files that "
+					 "are fetched by the target nodes in a separate phase. "
+					 "Only used when the shards of the target table are not "
+					 "replicated."),
+		&EnableRepartitionedInsertSelectPush,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_repartitioned_window_functions",
+		gettext_noop("Enables evaluating window functions on the workers."),
+		gettext_noop("When a window function is not partitioned by the "
+					 "distribution column, it is evaluated on the coordinator "
+					 "over all rows. When enabled, the rows are instead "
+					 "repartitioned by a PARTITION BY column across the shards "
+					 "of the distributed table, such that the workers evaluate "
+					 "the window functions in parallel and the coordinator only "
+					 "applies DISTINCT, ORDER BY and LIMIT to the results."),
+		&EnableRepartitionedWindowFunctions,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_result_streaming",
+		gettext_noop("Returns the rows of distributed SELECT queries to the "
+					 "client as they arrive from the workers."),
+		gettext_noop("By default, the rows of all the tasks are buffered on the "
+					 "coordinator until the tasks finished. When enabled and the "
+					 "coordinator only returns the rows of the tasks, they are "
+					 "sent to the client in batches as they arrive, and the "
+					 "workers wait while the client is reading. This only "
+					 "applies to SELECT queries outside of transaction blocks "
+					 "that are not scanned backward."),
+		&EnableResultStreaming,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_router_execution",
 		gettext_noop("Enables router execution"),
@@ -1451,6 +2120,84 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_shard_column_statistics_pruning",
+		gettext_noop("Enables pruning shards using their collected column "
+					 "statistics."),
+		gettext_noop("When the columns of a distributed table have statistics "
+					 "collected by citus_collect_shard_column_statistics, Citus "
+					 "skips the shards that are empty or whose smallest and "
+					 "largest values of those columns contradict the filters "
+					 "of a query."),
+		&EnableShardColumnStatisticsPruning,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_shard_query_caching",
+		gettext_noop("Enables caching the shard queries of prepared statements."),
+		gettext_noop("When the distribution column of a prepared router query is "
+					 "compared to a parameter, Citus prunes the shards and "
+					 "deparses the shard query on every execution. When enabled, "
+					 "the shard query is deparsed once per shard with the "
+					 "parameters left in it and cached in the plan of the "
+					 "prepared statement, and the parameters are sent to the "
+					 "workers along with it."),
+		&EnableShardQueryCaching,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_shard_query_template_cache",
+		gettext_noop("Keeps the shard query templates of multi-shard queries "
+					 "across executions."),
+		gettext_noop("When citus.enable_shard_query_templates is enabled, the "
+					 "template of a multi-shard query is by default built for "
+					 "every execution. When enabled, each backend keeps the "
+					 "templates of recent queries, such that the shard queries "
+					 "of a repeated query are built without deparsing it. The "
+					 "templates are dropped on DDL."),
+		&EnableShardQueryTemplateCache,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_shard_query_templates",
+		gettext_noop("Enables building the shard queries of multi-shard queries "
+					 "from a single deparsed query."),
+		gettext_noop("By default, the query of each task of a multi-shard query "
+					 "is deparsed separately. When enabled, the query is deparsed "
+					 "once with placeholders for the shard names, and the shard "
+					 "names of each task are spliced into it, unless the task "
+					 "queries differ in more than the shard names."),
+		&EnableShardQueryTemplates,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_shard_task_grouping",
+		gettext_noop("Enables running the tasks of a multi-shard SELECT on the "
+					 "same node as a single task."),
+		gettext_noop("When enabled, the shard queries of a node are run in a "
+					 "UNION ALL over a single connection, which reduces the "
+					 "per-task overhead of queries on many shards, at the cost "
+					 "of the parallelism across the shards of a node. Tasks on "
+					 "the local node, and tasks on shards that the transaction "
+					 "already accessed, are not grouped."),
+		&EnableShardTaskGrouping,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_single_hash_repartition_joins",
 		gettext_noop("Enables single hash repartitioning between hash "
@@ -1462,6 +2209,35 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_skew_aware_repartition_joins",
+		gettext_noop("Places the tasks of dual repartition joins on the nodes by "
+					 "the size of their buckets."),
+		gettext_noop("When enabled, the map tasks of a repartition join report "
+					 "the number of rows in each bucket before the buckets are "
+					 "fetched. The tasks that join the buckets are then spread "
+					 "over the nodes largest first, such that a few hot buckets "
+					 "do not end up on the same node."),
+		&EnableSkewAwareRepartitionJoins,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_sorted_merge",
+		gettext_noop("Enables merging sorted task results instead of sorting "
+					 "them on the coordinator."),
+		gettext_noop("For multi-shard queries with ORDER BY, the sort is pushed "
+					 "down to the workers and the coordinator merges the sorted "
+					 "results of the tasks, rather than sorting all the rows "
+					 "again."),
+		&EnableSortedMerge,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_statistics_collection",
 		gettext_noop("Enables sending basic usage statistics to Citus."),
@@ -1480,6 +2256,81 @@ RegisterCitusConfigVariables(void)
 		&StatisticsCollectionGucCheckHook,
 		NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_subplan_result_reuse",
+		gettext_noop("Enables reusing the results of subplans within a transaction."),
+		gettext_noop("When a statement in a repeatable read or serializable "
+					 "transaction runs a CTE or subquery that is planned "
+					 "separately with the same query as an earlier statement, "
+					 "the statement reads the intermediate result that the "
+					 "earlier statement sent to the workers instead of "
+					 "computing and sending it again, unless the transaction "
+					 "modified one of the tables that the query reads since."),
+		&EnableSubPlanResultReuse,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_subplan_result_slicing",
+		gettext_noop("Enables sending nodes only the rows of subplan results "
+					 "that their tasks can use."),
+		gettext_noop("When a subquery or CTE that is planned separately is "
+					 "joined on the distribution column of a table, or restricts "
+					 "it as in \"WHERE key IN (SELECT ...)\", each node only "
+					 "receives the rows of the result that hash to the shards "
+					 "that its tasks access, rather than the entire result."),
+		&EnableSubPlanResultSlicing,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_subplan_task_pruning",
+		gettext_noop("Enables skipping tasks based on the results of subplans."),
+		gettext_noop("When a subquery that is planned separately restricts the "
+					 "distribution column of a table, as in \"WHERE key IN "
+					 "(SELECT ...)\", the tasks on the shards that none of the "
+					 "rows of the subquery hash to are skipped."),
+		&EnableSubPlanTaskPruning,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_task_stealing",
+		gettext_noop("Lets idle connections execute the tasks that are waiting "
+					 "for a connection to another node that has a placement."),
+		gettext_noop("Tasks of reads on replicated shards and reference tables "
+					 "are assigned to one of the placements according to "
+					 "citus.task_assignment_policy. When enabled, a node that "
+					 "finished its tasks takes over the tasks that still wait "
+					 "for another node, if it has a placement of their shards."),
+		&EnableTaskStealing,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.enable_tdigest_combine_per_node",
+		gettext_noop("Merges the partial tdigests of the shards on each node on "
+					 "that node."),
+		gettext_noop("Percentile approximations with the tdigest extension "
+					 "merge a partial tdigest per shard and group on the "
+					 "coordinator. When enabled, the shards on a node are "
+					 "queried by a single task that merges their partial "
+					 "tdigests first, such that the coordinator merges one "
+					 "per node and group."),
+		&EnableTDigestCombinePerNode,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_unique_job_ids",
 		gettext_noop("Enables unique job IDs by prepending the local process ID and "
@@ -1545,7 +2396,54 @@ RegisterCitusConfigVariables(void)
 		&EnforceLocalObjectRestrictions,
 		true,
 		PGC_USERSET,
-		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+
+	DefineCustomEnumVariable(
+		"citus.execution_priority",
+		gettext_noop("Sets the priority of distributed executions when they "
+					 "compete for the connections of citus.max_shared_pool_size."),
+		gettext_noop("Executions with priority normal leave "
+					 "citus.shared_pool_priority_reserve connections per worker node "
+					 "to executions with priority high, and executions with priority "
+					 "low leave twice as many. Setting it per role allows "
+					 "latency-critical applications to get connections while large "
+					 "analytic queries wait."),
+		&ExecutionPriority,
+		EXECUTION_PRIORITY_NORMAL,
+		execution_priority_options,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.executor_memory_wait_timeout",
+		gettext_noop("Sets how long distributed executions wait for memory "
+					 "within citus.max_executor_memory."),
+		gettext_noop("When the distributed executions on the coordinator use "
+					 "all of citus.max_executor_memory, new executions wait "
+					 "for running ones to finish. Once they waited this long, "
+					 "they error out. 0 makes them error out right away."),
+		&ExecutorMemoryWaitTimeout,
+		10000, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_UNIT_MS | GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.executor_pipeline_depth",
+		gettext_noop("Sets the number of SELECT tasks the executor sends over a "
+					 "connection before reading their results"),
+		gettext_noop("When many tasks of a multi-shard query run over the same "
+					 "connection to a worker node, waiting for the results of each "
+					 "task before sending the next one costs a network round trip "
+					 "per task. With a value larger than 1, the executor sends up to "
+					 "this many tasks at once in a libpq pipeline and reads their "
+					 "results in order. The default of 1 disables pipelining."),
+		&ExecutorPipelineDepth,
+		1, 1, 1024,
+		PGC_USERSET,
+		GUC_STANDARD,
 		NULL, NULL, NULL);
 
 	DefineCustomIntVariable(
@@ -1604,6 +2502,19 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.explain_task_summary",
+		gettext_noop("Summarizes the tasks of distributed queries in EXPLAIN ANALYZE."),
+		gettext_noop("When enabled, EXPLAIN ANALYZE of a distributed query with "
+					 "multiple tasks also shows the distribution of the execution "
+					 "times and row counts of the tasks, the totals per node, and "
+					 "the slowest tasks, without showing the plan of every task."),
+		&ExplainTaskSummary,
+		false,
+		PGC_USERSET,
+		0,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.force_max_query_parallelization",
 		gettext_noop("Open as many connections as possible to maximize query "
@@ -1620,6 +2531,21 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.fragment_fetch_streams",
+		gettext_noop("Sets the number of concurrent streams used to fetch "
+					 "repartitioned result fragments between a pair of nodes."),
+		gettext_noop("When the SELECT results of INSERT..SELECT or MERGE are "
+					 "repartitioned, each node fetches the fragments it needs "
+					 "from every other node. With a value above 1, the "
+					 "fragments between a pair of nodes are spread over "
+					 "multiple fetches that run over separate connections."),
+		&FragmentFetchStreams,
+		1, 1, 64,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.function_opens_transaction_block",
 		gettext_noop("Open transaction blocks for function calls"),
@@ -1646,6 +2572,21 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomRealVariable(
+		"citus.hedged_read_percentile",
+		gettext_noop("Sends single-shard reads to another placement when they take "
+					 "longer than this percentile of recent reads."),
+		gettext_noop("When a read-only query on a single shard with multiple "
+					 "placements does not respond within the given percentile "
+					 "of the durations of recent such queries in the session, "
+					 "it is also sent to another placement and the rows of the "
+					 "placement that responds first are used. 0 disables hedging."),
+		&HedgedReadPercentile,
+		0.0, 0.0, 100.0,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.hide_citus_dependent_objects",
 		gettext_noop(
@@ -1678,6 +2619,88 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.index_build_processes_per_node",
+		gettext_noop("Sets the number of processes that CREATE INDEX on a distributed "
+					 "table uses per node."),
+		gettext_noop("When set, shard indexes are built over at most this many "
+					 "connections per node, and nodes that build fewer shard "
+					 "indexes than this give the remaining processes to the "
+					 "builds as parallel maintenance workers. 0 builds indexes "
+					 "using citus.max_adaptive_executor_pool_size connections "
+					 "and the max_parallel_maintenance_workers of the workers."),
+		&IndexBuildProcessesPerNode,
+		0, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.intermediate_result_broadcast_fanout",
+		gettext_noop("Sets the number of nodes to which each node sends an "
+					 "intermediate result that is broadcast to the workers."),
+		gettext_noop("When the result of a subquery or CTE is needed on more "
+					 "nodes than this, the coordinator only sends it to this many "
+					 "nodes, and the other nodes fetch it from the nodes that "
+					 "already have it, with each of those nodes serving this many "
+					 "nodes at a time. This bounds the network traffic of the "
+					 "coordinator at the cost of additional round trips. 0 "
+					 "disables forwarding results between the workers."),
+		&IntermediateResultBroadcastFanout,
+		0, 0, 1000,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomEnumVariable(
+		"citus.intermediate_result_compression",
+		gettext_noop("Sets the compression to use for intermediate results that "
+					 "are sent to or fetched from other nodes."),
+		gettext_noop("Intermediate results, such as the results of subqueries and "
+					 "CTEs that are broadcast to the workers and the results that "
+					 "are fetched during repartitioning, are then sent over the "
+					 "network in compressed frames, which trades CPU time for "
+					 "network bandwidth. Workers use their own setting when "
+					 "they fetch results from other nodes, and all nodes need "
+					 "to support the compression."),
+		&IntermediateResultCompression,
+		RESULT_COMPRESSION_NONE,
+		intermediate_result_compression_options,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomEnumVariable(
+		"citus.intermediate_result_format",
+		gettext_noop("Sets the format in which intermediate results are written."),
+		gettext_noop("With columnar, intermediate results are written in stripes "
+					 "in which the values of each column are stored together and "
+					 "compressed using citus.intermediate_result_compression. "
+					 "read_intermediate_result then only decompresses the columns "
+					 "that it returns. All nodes need to support the format."),
+		&IntermediateResultFormat,
+		INTERMEDIATE_RESULT_FORMAT_COPY,
+		intermediate_result_format_options,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.intermediate_result_memory_threshold",
+		gettext_noop("Sets the maximum size of intermediate results that are kept "
+					 "in shared memory instead of in files."),
+		gettext_noop("Intermediate results that are written on this node, or that "
+					 "other nodes send to it, are stored in a dynamic shared "
+					 "memory segment as long as they are at most this large, "
+					 "which avoids creating, syncing and removing files for small "
+					 "results. Larger results are written to files. 0 disables "
+					 "keeping results in memory."),
+		&IntermediateResultMemoryThreshold,
+		0, 0, 1024 * 1024,
+		PGC_USERSET,
+		GUC_UNIT_KB | GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.isolation_test_session_process_id",
 		NULL,
@@ -1756,10 +2779,13 @@ RegisterCitusConfigVariables(void)
 		gettext_noop("defines the behaviour when a distributed table "
 					 "is joined with a local table"),
 		gettext_noop(
-			"There are 4 values available. The default, 'auto' will recursively plan "
+			"There are 5 values available. The default, 'auto' will recursively plan "
 			"distributed tables if there is a constant filter on a unique index. "
 			"'prefer-local' will choose local tables if possible. "
 			"'prefer-distributed' will choose distributed tables if possible. "
+			"'cost-based' will choose the tables whose estimated filtered rows "
+			"take fewer bytes to move, using the cached shard sizes or the "
+			"distributed statistics of Citus tables. "
 			"'never' will basically skip local table joins."
 			),
 		&LocalTableJoinPolicy,
@@ -1780,6 +2806,31 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.log_distributed_plan_min_duration",
+		gettext_noop("Sets the minimum execution time above which distributed plans "
+					 "are logged, along with the plan of the slowest task."),
+		gettext_noop("Zero logs the plans of all distributed queries, -1 turns this "
+					 "feature off. The plan of the slowest task is fetched from "
+					 "the worker after the execution, without running the task "
+					 "again."),
+		&LogDistributedPlanMinDuration,
+		-1, -1, INT_MAX,
+		PGC_SUSET,
+		GUC_UNIT_MS,
+		NULL, NULL, NULL);
+
+	DefineCustomRealVariable(
+		"citus.log_distributed_plan_sample_rate",
+		gettext_noop("Sets the fraction of distributed queries whose plans are "
+					 "logged when they exceed citus.log_distributed_plan_min_duration."),
+		NULL,
+		&LogDistributedPlanSampleRate,
+		1.0, 0.0, 1.0,
+		PGC_SUSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.log_intermediate_results",
 		gettext_noop("Log intermediate results sent to other nodes"),
@@ -1822,6 +2873,40 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.logical_replication_parallel_apply",
+		gettext_noop("Streams large transactions to the subscriptions of shard "
+					 "transfers and applies them in parallel"),
+		gettext_noop("When enabled, the subscriptions that Citus creates for shard "
+					 "moves and splits use streaming=parallel on PostgreSQL 16 and "
+					 "later, and streaming=on on earlier versions. This lets large "
+					 "transactions be applied on the target node while they are "
+					 "still running on the source, which shortens the catch-up "
+					 "phase for write-heavy shards. The number of parallel apply "
+					 "workers is limited by max_parallel_apply_workers_per_subscription "
+					 "on the target node."),
+		&LogicalReplicationParallelApply,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.logical_replication_single_slot",
+		gettext_noop("Replicates all tables of a shard move using a single "
+					 "replication slot"),
+		gettext_noop("By default, a shard move creates a publication, replication "
+					 "slot and subscription for every user that owns a table in the "
+					 "shard group, which means the source node decodes its WAL once "
+					 "per owner. When enabled, a single replication slot is used "
+					 "and the subscription owner is made a member of all the table "
+					 "owners."),
+		&LogicalReplicationSingleSlot,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.logical_replication_timeout",
 		gettext_noop("Sets the timeout to error out when logical replication is used"),
@@ -1892,6 +2977,23 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.max_buffered_insert_rows",
+		gettext_noop("Sets the maximum number of rows of single shard INSERTs "
+					 "to buffer in a transaction block."),
+		gettext_noop("When set, INSERTs into a single remote shard that do not "
+					 "return rows are not sent right away, but when a statement "
+					 "might observe them, when the transaction commits or when "
+					 "the given number of rows is buffered. The buffered INSERTs "
+					 "are then sent with a single round trip per shard. Errors "
+					 "of buffered INSERTs are reported by the statement that "
+					 "sends them. 0 disables buffering."),
+		&MaxBufferedInsertRows,
+		0, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.max_cached_connection_lifetime",
 		gettext_noop("Sets the maximum lifetime of cached connections to other nodes."),
@@ -1933,6 +3035,24 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.max_executor_memory",
+		gettext_noop("Sets the memory of this node that all distributed "
+					 "executions together may use."),
+		gettext_noop("Each distributed execution reserves its estimated memory "
+					 "for the results of its tasks and the state of its tasks "
+					 "and connections before it starts, and reserves more when "
+					 "its results turn out larger. When the memory is used up, "
+					 "new executions wait for up to "
+					 "citus.executor_memory_wait_timeout. An execution is "
+					 "always admitted when no other execution holds memory. "
+					 "-1 disables the limit."),
+		&MaxExecutorMemory,
+		-1, -1, MAX_KILOBYTES,
+		PGC_SIGHUP,
+		GUC_UNIT_KB | GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.max_high_priority_background_processes",
 		gettext_noop("Sets the maximum number of background processes "
@@ -1969,6 +3089,24 @@ RegisterCitusConfigVariables(void)
 		GUC_UNIT_MB | GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.max_prepared_statements_per_connection",
+		gettext_noop("Sets the maximum number of statements to prepare on a "
+					 "connection to a worker."),
+		gettext_noop("Queries from generic plans of prepared statements are sent "
+					 "to the workers along with their parameters, and the workers "
+					 "parse them on every execution. When set above 0, such queries "
+					 "are prepared on the connection the first time they are sent "
+					 "over it, up to the configured number of queries, and are "
+					 "executed as prepared statements afterwards. This should not "
+					 "be used with connection poolers in transaction mode between "
+					 "the nodes. Setting to 0 disables preparing statements."),
+		&MaxPreparedStatementsPerConnection,
+		0, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.max_rebalancer_logged_ignored_moves",
 		gettext_noop("Sets the maximum number of ignored moves the rebalance logs"),
@@ -2012,6 +3150,23 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.metadata_sync_batch_size",
+		gettext_noop("Sets the number of tables and other catalog entries whose "
+					 "metadata is sent to a node in a single command."),
+		gettext_noop("When activating a node, the metadata of each table, "
+					 "colocation group and distributed object is sent with a "
+					 "separate command by default, which requires a round-trip "
+					 "per entry. Setting this to a higher value combines the "
+					 "commands of that many entries, which makes adding nodes "
+					 "to clusters with many tables faster. In nontransactional "
+					 "mode, each batch is executed in a separate transaction."),
+		&MetadataSyncBatchSize,
+		1, 1, 100000,
+		PGC_SUSET,
+		GUC_SUPERUSER_ONLY | GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.metadata_sync_interval",
 		gettext_noop("Sets the time to wait between metadata syncs."),
@@ -2069,6 +3224,23 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.multi_row_insert_copy_threshold",
+		gettext_noop("Sets the number of rows from which multi-row INSERTs are "
+					 "executed via COPY."),
+		gettext_noop("Multi-row INSERTs send an INSERT with the rows of each shard "
+					 "to the workers by default, which is expensive to deparse and "
+					 "parse for many rows. Multi-row INSERTs with at least this many "
+					 "rows into hash-distributed, single shard or reference tables "
+					 "copy their rows into the shards instead, unless they have a "
+					 "RETURNING or ON CONFLICT clause. Setting it to -1 disables "
+					 "this."),
+		&MultiRowInsertCopyThreshold,
+		-1, -1, INT_MAX,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomEnumVariable(
 		"citus.multi_shard_modify_mode",
 		gettext_noop("Sets the connection type for multi shard modify queries"),
@@ -2175,6 +3347,36 @@ RegisterCitusConfigVariables(void)
 		NodeConninfoGucAssignHook,
 		NULL);
 
+	DefineCustomIntVariable(
+		"citus.node_health_check_interval",
+		gettext_noop("Sets the time to wait between health probes of the nodes."),
+		gettext_noop("The maintenance daemon periodically runs a short query on "
+					 "each readable node to measure its round trip time and "
+					 "replication lag, and to detect failing nodes. Router "
+					 "queries use the outcome when citus.avoid_degraded_nodes "
+					 "is enabled, and citus_node_latencies() shows it. When set "
+					 "to 0 the nodes are not probed."),
+		&NodeHealthCheckInterval,
+		0, 0, 7 * 24 * 3600 * 1000,
+		PGC_SIGHUP,
+		GUC_UNIT_MS | GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.orphaned_shard_drop_batch_size",
+		gettext_noop("Sets the number of orphaned shards that are dropped from a "
+					 "node with a single command."),
+		gettext_noop("When larger than 1, the cleanup of orphaned shards drops up "
+					 "to this many shards of a node in a single DROP TABLE and "
+					 "cleans up all nodes in parallel. If a batch cannot be "
+					 "dropped, for instance because a shard is still in use, its "
+					 "shards are dropped one by one."),
+		&OrphanedShardDropBatchSize,
+		1, 1, 10000,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.override_table_visibility",
 		gettext_noop("Enables replacing occurrrences of pg_catalog.pg_table_visible() "
@@ -2188,6 +3390,40 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.parallel_copy_from_workers",
+		gettext_noop("Sets the number of parallel workers that parse the input of "
+					 "COPY .. FROM STDIN into a distributed table."),
+		gettext_noop("When set, the input is split into blocks of lines that "
+					 "parallel workers parse and route to the shards, while the "
+					 "backend sends the rows to the worker nodes. Only input in "
+					 "text format is parsed in parallel, and rows may arrive in "
+					 "the shards in a different order. 0 disables parallel "
+					 "parsing."),
+		&ParallelCopyFromWorkers,
+		0, 0, 1024,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomEnumVariable(
+		"citus.parallel_copy_to",
+		gettext_noop("Sets whether COPY .. TO STDOUT on a distributed table reads "
+					 "its shards in parallel."),
+		gettext_noop("When set to ordered, up to "
+					 "citus.max_adaptive_executor_pool_size shards are read ahead, "
+					 "but sent to the client one after the other. When set to "
+					 "unordered, up to citus.max_adaptive_executor_pool_size "
+					 "shards are read from each worker node at a time, and rows of "
+					 "any shard are sent as they arrive. Shards are only read in "
+					 "parallel outside of transaction blocks."),
+		&ParallelCopyTo,
+		PARALLEL_COPY_TO_OFF,
+		parallel_copy_to_options,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.prevent_incomplete_connection_establishment",
 		gettext_noop("When enabled, the executor waits until all the connections "
@@ -2225,6 +3461,33 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.query_result_cache_size",
+		gettext_noop("Sets the size of the shared memory that caches the results "
+					 "of queries on reference tables."),
+		gettext_noop("Results are only cached when citus.enable_query_result_cache "
+					 "is enabled. Each cached result uses about 16 kB, results "
+					 "that do not fit are not cached. 0 disables the cache."),
+		&QueryResultCacheSize,
+		0, 0, MAX_KILOBYTES,
+		PGC_POSTMASTER,
+		GUC_UNIT_KB | GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.rebalancer_balance_query_load",
+		gettext_noop("Makes the rebalancer also balance the query load of shards."),
+		gettext_noop("When enabled, the rebalancer reads the scans and modified rows "
+					 "of the shards from the statistics of the workers. Moves that "
+					 "would make a node a hot spot are avoided, and once the costs "
+					 "of the rebalance strategy are balanced, shards are moved or "
+					 "swapped away from nodes with a lot of query load."),
+		&RebalancerBalanceQueryLoad,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.rebalancer_by_disk_size_base_cost",
 		gettext_noop(
@@ -2242,6 +3505,19 @@ RegisterCitusConfigVariables(void)
 		GUC_UNIT_BYTE | GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.recover_2pc_in_background_worker",
+		gettext_noop("Runs 2PC recovery in a background worker of its own."),
+		gettext_noop("By default, the maintenance daemon recovers 2PCs itself, "
+					 "which delays its other duties such as distributed deadlock "
+					 "detection while recovery runs. When enabled, each recovery "
+					 "pass runs in a separate background worker instead."),
+		&Recover2PCInBackgroundWorker,
+		false,
+		PGC_SIGHUP,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.recover_2pc_interval",
 		gettext_noop("Sets the time to wait between recovering 2PCs."),
@@ -2256,6 +3532,21 @@ RegisterCitusConfigVariables(void)
 		GUC_UNIT_MS | GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomRealVariable(
+		"citus.remote_command_trace_sample_rate",
+		gettext_noop("Sets the fraction of the commands sent to remote nodes that "
+					 "are traced."),
+		gettext_noop("The node, duration, bytes and the start of the text of sampled "
+					 "remote commands are kept in a ring buffer in shared memory, "
+					 "which can be queried through citus_remote_command_traces. "
+					 "Unlike citus.log_remote_commands, this does not write to the "
+					 "server log, so it can be left on in production."),
+		&RemoteCommandTraceSampleRate,
+		0.0, 0.0, 1.0,
+		PGC_SUSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.remote_copy_flush_threshold",
 		gettext_noop("Sets the threshold for remote copy to be flushed."),
@@ -2317,6 +3608,21 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		WarnIfReplicationModelIsSet, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.router_proxy_workers",
+		gettext_noop("Sets the number of router proxies per database."),
+		gettext_noop("Router proxies are background workers that execute the "
+					 "read-only router queries of backends outside of transaction "
+					 "blocks over their own worker connections, such that many "
+					 "client connections share few worker connections. Backends "
+					 "execute such queries themselves when all router proxies are "
+					 "busy. 0 disables router proxies."),
+		&RouterProxyWorkerCount,
+		0, 0, MAX_ROUTER_PROXY_WORKERS,
+		PGC_SIGHUP,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.running_under_citus_test_suite",
 		gettext_noop(
@@ -2348,6 +3654,23 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.shard_column_statistics_refresh_interval",
+		gettext_noop("Sets the time to wait between collecting the invalidated "
+					 "shard column statistics in the background."),
+		gettext_noop("Writes into a shard invalidate the column statistics that "
+					 "were collected for it by "
+					 "citus_collect_shard_column_statistics. The maintenance "
+					 "daemon collects the invalidated statistics again at the "
+					 "interval configured here, skipping the tables that it "
+					 "cannot lock without waiting. When set to -1 this background "
+					 "process is skipped."),
+		&ShardColumnStatisticsRefreshInterval,
+		60000, -1, 7 * 24 * 3600 * 1000,
+		PGC_SIGHUP,
+		GUC_UNIT_MS,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.shard_count",
 		gettext_noop("Sets the number of shards for a new hash-partitioned table "
@@ -2359,6 +3682,39 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.shard_creation_batch_size",
+		gettext_noop("Sets the number of shards on a node that are created with "
+					 "a single command."),
+		gettext_noop("When a distributed table is created, the commands that "
+					 "create each shard with its indexes and constraints are "
+					 "sent to the workers one by one. Setting this to a higher "
+					 "value sends the commands of that many shards on the same "
+					 "node in a single round-trip. It has no effect when each "
+					 "shard is created over its own connection."),
+		&ShardCreationBatchSize,
+		1, 1, MAX_SHARD_COUNT,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.shard_ddl_batch_size",
+		gettext_noop("Sets the number of shards on a node whose DDL commands are "
+					 "sent with a single command."),
+		gettext_noop("DDL commands on distributed tables, such as ALTER TABLE, "
+					 "are applied to each shard by a task of its own, which "
+					 "costs a round trip per shard. Setting this to a higher "
+					 "value sends the commands of that many shards on the same "
+					 "nodes in a single round trip. Shards on the local node "
+					 "and shards that were already accessed in the transaction "
+					 "are not batched."),
+		&ShardDDLBatchSize,
+		1, 1, MAX_SHARD_COUNT,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.shard_replication_factor",
 		gettext_noop("Sets the replication factor for shards."),
@@ -2372,6 +3728,119 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.shard_size_cache_max_age",
+		gettext_noop("Sets the maximum age of the cached shard sizes that the "
+					 "size functions use."),
+		gettext_noop("citus_table_size, citus_total_relation_size, "
+					 "citus_shard_sizes and the by_disk_size rebalance strategy "
+					 "use the shard sizes that the maintenance daemon collected "
+					 "if they are not older than this, and otherwise query the "
+					 "nodes. 0 always queries the nodes."),
+		&ShardSizeCacheMaxAge,
+		300000, 0, 7 * 24 * 3600 * 1000,
+		PGC_USERSET,
+		GUC_UNIT_MS | GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.shard_size_cache_refresh_interval",
+		gettext_noop("Sets the time to wait between collecting the sizes of all "
+					 "shard placements into the shard size cache."),
+		gettext_noop("The maintenance daemon of the coordinator collects the "
+					 "sizes at the interval configured here if "
+					 "citus.shard_size_cache_size is set. When set to -1 this "
+					 "background process is skipped."),
+		&ShardSizeCacheRefreshInterval,
+		60000, -1, 7 * 24 * 3600 * 1000,
+		PGC_SIGHUP,
+		GUC_UNIT_MS,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.shard_size_cache_size",
+		gettext_noop("Sets the size of the shared memory that caches the sizes "
+					 "of shard placements."),
+		gettext_noop("Each cached shard placement uses about 50 bytes. 0 "
+					 "disables the cache."),
+		&ShardSizeCacheSize,
+		0, 0, MAX_KILOBYTES,
+		PGC_POSTMASTER,
+		GUC_UNIT_KB | GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.shard_split_copy_streams",
+		gettext_noop("Sets the number of parallel streams that copy a shard "
+					 "to its split children."),
+		gettext_noop("Each stream copies a range of blocks of the source shard "
+					 "to all split children, which speeds up splitting large "
+					 "shards. Columnar shards are always copied by a single "
+					 "stream."),
+		&ShardSplitCopyStreams,
+		1, 1, 128,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.shard_transfer_max_rate",
+		gettext_noop("Sets the maximum rate, per second, at which shard moves, "
+					 "copies and splits send data from this node."),
+		gettext_noop("All transfers that copy shards from the node share this "
+					 "budget, such that they do not saturate its disks and "
+					 "network. Changes take effect for running transfers when "
+					 "the configuration is reloaded. 0 disables the limit."),
+		&ShardTransferMaxRate,
+		0, 0, MAX_KILOBYTES,
+		PGC_SIGHUP,
+		GUC_UNIT_KB | GUC_STANDARD,
+		NULL, ShardTransferMaxRateAssignHook, NULL);
+
+	DefineCustomIntVariable(
+		"citus.shard_transfer_parallelism",
+		gettext_noop("Sets the number of connections that a shard move or copy "
+					 "uses for the colocated shards."),
+		gettext_noop("The data of colocated shards is copied, and their indexes "
+					 "are built, over at most this many connections to the "
+					 "target node at a time, such that moving a colocation "
+					 "group takes about as long as moving its largest shard. "
+					 "0 copies the data over citus.max_adaptive_executor_pool_size "
+					 "connections and builds the indexes one shard at a time when "
+					 "blocking writes."),
+		&ShardTransferParallelism,
+		0, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.shared_placement_cache_size",
+		gettext_noop("Sets the size of the shared memory that caches the shard "
+					 "placements of distributed tables across backends."),
+		gettext_noop("Backends that build their metadata cache for a table read "
+					 "the placements of its shards from this cache rather than "
+					 "from pg_dist_placement. Each cached shard uses about 200 "
+					 "bytes. 0 disables the cache."),
+		&SharedPlacementCacheSize,
+		0, 0, MAX_KILOBYTES,
+		PGC_POSTMASTER,
+		GUC_UNIT_KB | GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		"citus.shared_pool_priority_reserve",
+		gettext_noop("Sets the number of connections per worker node that each "
+					 "execution priority leaves to higher priorities."),
+		gettext_noop("Only executions with citus.execution_priority set to high can "
+					 "use all of citus.max_shared_pool_size. The default, 0, lets "
+					 "all executions use the whole shared pool."),
+		&SharedPoolPriorityReserve,
+		0, 0, INT_MAX,
+		PGC_SIGHUP,
+		GUC_SUPERUSER_ONLY,
+		NULL, NULL, NULL);
+
 	DefineCustomStringVariable(
 		"citus.show_shards_for_app_name_prefixes",
 		gettext_noop("If application_name starts with one of these values, show shards"),
@@ -2491,6 +3960,22 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.stat_tenants_flush_interval",
+		gettext_noop("Sets how often a backend adds the statistics of its queries "
+					 "to citus_stat_tenants."),
+		gettext_noop("When 0, the statistics of every query are added right away. "
+					 "Otherwise backends collect the statistics of their queries "
+					 "and add them at most once per interval, at the end of a "
+					 "query, which avoids taking the lock of the tenant monitor for "
+					 "every query. The statistics of an idle backend show up after "
+					 "its next query, or when it exits."),
+		&StatTenantsFlushInterval,
+		0, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_UNIT_MS | GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.stat_tenants_limit",
 		gettext_noop("Number of tenants to be shown in citus_stat_tenants."),
@@ -2590,6 +4075,21 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomRealVariable(
+		"citus.task_execution_trace_sample_rate",
+		gettext_noop("Sets the fraction of distributed executions of which the remote "
+					 "task executions are traced."),
+		gettext_noop("The connection acquire, send, first byte and receive times of "
+					 "the tasks of sampled executions are kept in a ring buffer in "
+					 "shared memory, which can be queried through "
+					 "citus_task_execution_traces. This helps to find the cause of "
+					 "slow tasks in production."),
+		&TaskExecutionTraceSampleRate,
+		0.0, 0.0, 1.0,
+		PGC_SUSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomEnumVariable(
 		"citus.task_executor_type",
 		gettext_noop("Sets the executor type to be used for distributed queries."),
@@ -2604,6 +4104,36 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		WarnIfDeprecatedExecutorUsed, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.tenant_isolation_check_interval",
+		gettext_noop("Sets the time to wait between checks for tenants to isolate."),
+		gettext_noop("When set, the maintenance daemon of the coordinator "
+					 "periodically looks for a tenant in citus_stat_tenants whose "
+					 "share of queries or CPU usage exceeds "
+					 "citus.tenant_isolation_threshold, and schedules a background "
+					 "job that isolates the tenant to its own shard and moves the "
+					 "shard to the node that stores the least shard data. Set to -1 "
+					 "to disable automatic tenant isolation."),
+		&TenantIsolationCheckInterval,
+		-1, -1, 7 * 24 * 3600 * 1000,
+		PGC_SIGHUP,
+		GUC_UNIT_MS | GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomRealVariable(
+		"citus.tenant_isolation_threshold",
+		gettext_noop("Sets the share of the load of all tenants above which a "
+					 "tenant is isolated automatically."),
+		gettext_noop("A tenant is isolated when its share of the queries or of the "
+					 "CPU usage of all tenants in the last citus.stat_tenants_period "
+					 "is at least this value. Only used when "
+					 "citus.tenant_isolation_check_interval is set."),
+		&TenantIsolationThreshold,
+		0.5, 0.01, 1.0,
+		PGC_SIGHUP,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.use_citus_managed_tables",
 		gettext_noop("Allows new local tables to be accessed on workers"),
@@ -2625,6 +4155,49 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.vacuum_processes_per_node",
+		gettext_noop("Sets the number of connections per node that VACUUM and "
+					 "ANALYZE of Citus tables use."),
+		gettext_noop("The shards of Citus tables are vacuumed and analyzed over "
+					 "at most this many connections per node, which bounds the "
+					 "I/O load that maintenance puts on a node. 0 uses "
+					 "citus.max_adaptive_executor_pool_size connections."),
+		&VacuumProcessesPerNode,
+		0, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.vacuum_shards_by_dead_tuples",
+		gettext_noop("Vacuums the shards with the most dead tuples first."),
+		gettext_noop("When enabled, VACUUM of Citus tables reads the number of "
+					 "dead tuples of their shards from the nodes and vacuums "
+					 "the shards of all tables of the command together, in "
+					 "decreasing order of dead tuples."),
+		&VacuumShardsByDeadTuples,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		"citus.validate_jsonb_syntax_only_in_copy",
+		gettext_noop("Validates only the JSON syntax of JSONB columns on the "
+					 "coordinator during COPY into a distributed table"),
+		gettext_noop("When citus.skip_jsonb_validation_in_copy is off, the "
+					 "coordinator parses JSONB columns into JSONB values and "
+					 "converts them back to text to send them to the workers, "
+					 "which parse them again. If this GUC is set, the coordinator "
+					 "only checks the JSON syntax and sends the input text as is, "
+					 "which still reports the line number of malformed JSON."),
+		&ValidateJsonbSyntaxOnlyInCopy,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.values_materialization_threshold",
 		gettext_noop("Sets the maximum number of rows allowed for pushing down "
@@ -2958,6 +4531,17 @@ NodeConninfoGucCheckHook(char **newval, void **extra, GucSource source)
 }
 
 
+/*
+ * CacheNodeAddressesAssignHook recomputes the cached connection parameters,
+ * such that new connections use or stop using the resolved node addresses.
+ */
+static void
+CacheNodeAddressesAssignHook(bool newval, void *extra)
+{
+	InvalidateConnParamsHashEntries();
+}
+
+
 /*
  * CpuPriorityAssignHook changes the priority of the current backend to match
  * the chosen value.
@@ -2969,6 +4553,17 @@ CpuPriorityAssignHook(int newval, void *extra)
 }
 
 
+/*
+ * ShardTransferMaxRateAssignHook passes the new rate on to the shard
+ * transfers that are already running in other backends.
+ */
+static void
+ShardTransferMaxRateAssignHook(int newval, void *extra)
+{
+	SetSharedShardTransferMaxRate(newval);
+}
+
+
 /*
  * NodeConninfoGucAssignHook is the assignment hook for the node_conninfo GUC
  * variable. Though this GUC is a "string", we actually parse it as a non-URI
@@ -55,3 +55,182 @@ DROP VIEW IF EXISTS pg_catalog.citus_lock_waits;
 #include "udfs/citus_internal_update_relation_colocation/12.2-1.sql"
 #include "udfs/repl_origin_helper/12.2-1.sql"
 #include "udfs/citus_finish_pg_upgrade/12.2-1.sql"
+
+DROP VIEW pg_catalog.citus_stat_statements;
+DROP FUNCTION pg_catalog.citus_stat_statements();
+DROP FUNCTION pg_catalog.citus_query_stats();
+#include "udfs/citus_query_stats/12.2-1.sql"
+#include "udfs/citus_stat_statements/12.2-1.sql"
+
+-- Support infrastructure for approximating count(distinct) without hll
+CREATE FUNCTION pg_catalog.citus_count_distinct_sketch_sfunc(internal, anyelement, integer)
+RETURNS internal
+AS 'MODULE_PATHNAME'
+LANGUAGE C PARALLEL SAFE;
+COMMENT ON FUNCTION pg_catalog.citus_count_distinct_sketch_sfunc(internal, anyelement, integer)
+    IS 'transition function for citus_count_distinct_sketch';
+
+CREATE FUNCTION pg_catalog.citus_count_distinct_sketch_ffunc(internal)
+RETURNS bytea
+AS 'MODULE_PATHNAME'
+LANGUAGE C PARALLEL SAFE;
+COMMENT ON FUNCTION pg_catalog.citus_count_distinct_sketch_ffunc(internal)
+    IS 'finalizer for citus_count_distinct_sketch';
+
+CREATE FUNCTION pg_catalog.citus_count_distinct_merge_sfunc(internal, bytea)
+RETURNS internal
+AS 'MODULE_PATHNAME'
+LANGUAGE C PARALLEL SAFE;
+COMMENT ON FUNCTION pg_catalog.citus_count_distinct_merge_sfunc(internal, bytea)
+    IS 'transition function for citus_count_distinct_merge';
+
+CREATE FUNCTION pg_catalog.citus_count_distinct_merge_ffunc(internal)
+RETURNS bigint
+AS 'MODULE_PATHNAME'
+LANGUAGE C PARALLEL SAFE;
+COMMENT ON FUNCTION pg_catalog.citus_count_distinct_merge_ffunc(internal)
+    IS 'finalizer for citus_count_distinct_merge';
+
+-- select citus_count_distinct_sketch(col, log2m)
+-- builds a HyperLogLog sketch of col with 2^log2m registers
+CREATE AGGREGATE pg_catalog.citus_count_distinct_sketch(anyelement, integer) (
+    STYPE = internal,
+    SFUNC = pg_catalog.citus_count_distinct_sketch_sfunc,
+    FINALFUNC = pg_catalog.citus_count_distinct_sketch_ffunc
+);
+COMMENT ON AGGREGATE pg_catalog.citus_count_distinct_sketch(anyelement, integer)
+    IS 'support aggregate for approximating count(distinct) on workers';
+
+-- select citus_count_distinct_merge(sketch)
+-- estimates the number of distinct values in the union of the sketches
+CREATE AGGREGATE pg_catalog.citus_count_distinct_merge(bytea) (
+    STYPE = internal,
+    SFUNC = pg_catalog.citus_count_distinct_merge_sfunc,
+    FINALFUNC = pg_catalog.citus_count_distinct_merge_ffunc
+);
+COMMENT ON AGGREGATE pg_catalog.citus_count_distinct_merge(bytea)
+    IS 'support aggregate for combining count(distinct) sketches from workers';
+
+REVOKE ALL ON FUNCTION pg_catalog.citus_count_distinct_sketch_ffunc FROM PUBLIC;
+REVOKE ALL ON FUNCTION pg_catalog.citus_count_distinct_sketch_sfunc FROM PUBLIC;
+REVOKE ALL ON FUNCTION pg_catalog.citus_count_distinct_merge_ffunc FROM PUBLIC;
+REVOKE ALL ON FUNCTION pg_catalog.citus_count_distinct_merge_sfunc FROM PUBLIC;
+
+-- Per-shard column statistics that are used for pruning shards by the ranges
+-- of values of non-distribution columns. A row whose row_count is NULL was
+-- invalidated by a write and is recollected by the maintenance daemon. The
+-- rows are only kept on the coordinator and are not preserved across
+-- pg_upgrade, since they can be recollected at any time.
+CREATE TABLE citus.pg_dist_shard_column_stats (
+    logicalrelid regclass NOT NULL,
+    shardid bigint NOT NULL,
+    attnum int2 NOT NULL,
+    atttypid oid NOT NULL,
+    attcollation oid NOT NULL,
+    row_count bigint,
+    null_count bigint,
+    min_value text,
+    max_value text,
+    collected_at timestamptz,
+
+    CONSTRAINT pg_dist_shard_column_stats_pkey PRIMARY KEY (logicalrelid, shardid, attnum)
+);
+ALTER TABLE citus.pg_dist_shard_column_stats SET SCHEMA pg_catalog;
+GRANT SELECT ON pg_catalog.pg_dist_shard_column_stats TO public;
+
+#include "udfs/citus_collect_shard_column_statistics/12.2-1.sql"
+#include "udfs/citus_drop_shard_column_statistics/12.2-1.sql"
+
+-- Number of committed rows of resumable bulk loads, which COPY commands with
+-- the ingestion_id option continue. The rows are kept on the node that ran
+-- the COPY and are not preserved across pg_upgrade.
+CREATE TABLE citus.pg_dist_ingestion (
+    ingestion_id text COLLATE "C" NOT NULL,
+    logicalrelid regclass NOT NULL,
+    committed_rows bigint NOT NULL,
+    updated_at timestamptz NOT NULL,
+
+    CONSTRAINT pg_dist_ingestion_pkey PRIMARY KEY (ingestion_id)
+);
+ALTER TABLE citus.pg_dist_ingestion SET SCHEMA pg_catalog;
+GRANT SELECT ON pg_catalog.pg_dist_ingestion TO public;
+
+#include "udfs/citus_remove_ingestion/12.2-1.sql"
+
+#include "udfs/citus_warm_connections/12.2-1.sql"
+#include "udfs/citus_node_latencies/12.2-1.sql"
+
+#include "udfs/worker_push_partition_query_result/12.2-1.sql"
+
+#include "udfs/get_rebalance_progress/12.2-1.sql"
+
+#include "udfs/worker_split_copy/12.2-1.sql"
+
+#include "udfs/citus_stat_statements_histograms/12.2-1.sql"
+
+#include "udfs/citus_task_execution_traces/12.2-1.sql"
+
+-- citus_stat_tenants(_local) return the buffer usage and the returned rows of the tenants
+DROP VIEW pg_catalog.citus_stat_tenants;
+DROP FUNCTION pg_catalog.citus_stat_tenants(boolean);
+DROP VIEW pg_catalog.citus_stat_tenants_local;
+DROP FUNCTION pg_catalog.citus_stat_tenants_local(boolean);
+DROP FUNCTION pg_catalog.citus_stat_tenants_local_internal(boolean);
+#include "udfs/citus_stat_tenants_local/12.2-1.sql"
+#include "udfs/citus_stat_tenants/12.2-1.sql"
+
+#include "udfs/citus_wait_events/12.2-1.sql"
+-- citus_stat_activity and the views that depend on it are recreated to report
+-- the Citus wait events
+DROP VIEW pg_catalog.citus_lock_waits;
+DROP VIEW pg_catalog.citus_dist_stat_activity;
+DROP VIEW pg_catalog.citus_stat_activity;
+#include "udfs/citus_stat_activity/12.2-1.sql"
+#include "udfs/citus_dist_stat_activity/11.0-1.sql"
+#include "udfs/citus_lock_waits/12.2-1.sql"
+
+#include "udfs/citus_connection_counters/12.2-1.sql"
+
+#include "udfs/citus_stat_intermediate_results/12.2-1.sql"
+
+#include "udfs/worker_explain_analyze_query/12.2-1.sql"
+
+#include "udfs/citus_refresh_shard_size_cache/12.2-1.sql"
+
+#include "udfs/citus_call_procedure_batch/12.2-1.sql"
+
+#include "udfs/citus_execute_partition_commands/12.2-1.sql"
+#include "udfs/create_time_partitions/12.2-1.sql"
+#include "udfs/drop_old_time_partitions/12.2-1.sql"
+
+#include "udfs/citus_copy_shard_placement_to_nodes/12.2-1.sql"
+
+-- reference tables whose modifications are only written to their primary placement
+CREATE TABLE citus.pg_dist_async_reference_table (
+    logicalrelid regclass NOT NULL,
+    primarygroupid integer NOT NULL,
+
+    CONSTRAINT pg_dist_async_reference_table_pkey PRIMARY KEY (logicalrelid)
+);
+ALTER TABLE citus.pg_dist_async_reference_table SET SCHEMA pg_catalog;
+GRANT SELECT ON pg_catalog.pg_dist_async_reference_table TO public;
+
+#include "udfs/citus_set_reference_table_async/12.2-1.sql"
+#include "udfs/citus_wait_for_async_reference_tables/12.2-1.sql"
+#include "udfs/citus_internal_async_reference_table_replica_trigger/12.2-1.sql"
+#include "udfs/citus_prepare_pg_upgrade/12.2-1.sql"
+
+-- pg_dist_schema is cached per backend for schema-based sharding
+#include "udfs/citus_dist_schema_cache_invalidate/12.2-1.sql"
+CREATE TRIGGER dist_schema_cache_invalidate
+    AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE
+    ON pg_catalog.pg_dist_schema
+    FOR EACH STATEMENT EXECUTE FUNCTION pg_catalog.citus_dist_schema_cache_invalidate();
+
+#include "udfs/citus_schema_move_batch/12.2-1.sql"
+
+#include "udfs/alter_distributed_table_concurrently/12.2-1.sql"
+
+#include "udfs/citus_maintenance_daemon_duties/12.2-1.sql"
+
+#include "udfs/citus_remote_command_traces/12.2-1.sql"
@@ -55,3 +55,139 @@ DROP FUNCTION citus_internal.start_replication_origin_tracking();
 DROP FUNCTION citus_internal.stop_replication_origin_tracking();
 DROP FUNCTION citus_internal.is_replication_origin_tracking_active();
 #include "../udfs/citus_finish_pg_upgrade/12.1-1.sql"
+
+DROP VIEW pg_catalog.citus_stat_statements;
+DROP FUNCTION pg_catalog.citus_stat_statements();
+DROP FUNCTION pg_catalog.citus_query_stats();
+
+CREATE FUNCTION pg_catalog.citus_query_stats(OUT queryid bigint,
+											 OUT userid oid,
+											 OUT dbid oid,
+											 OUT executor bigint,
+											 OUT partition_key text,
+											 OUT calls bigint)
+RETURNS SETOF record
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_query_stats$$;
+
+CREATE FUNCTION pg_catalog.citus_stat_statements(OUT queryid bigint,
+												 OUT userid oid,
+												 OUT dbid oid,
+												 OUT query text,
+												 OUT executor bigint,
+												 OUT partition_key text,
+												 OUT calls bigint)
+RETURNS SETOF record
+LANGUAGE plpgsql
+AS $citus_stat_statements$
+BEGIN
+ IF EXISTS (
+ 	SELECT extname FROM pg_extension
+ 	WHERE extname = 'pg_stat_statements')
+ THEN
+ 	RETURN QUERY SELECT pss.queryid, pss.userid, pss.dbid, pss.query, cqs.executor,
+ 						cqs.partition_key, cqs.calls
+ 				 FROM pg_stat_statements(true) pss
+ 				 	JOIN citus_query_stats() cqs
+ 				 	USING (queryid, userid, dbid);
+ ELSE
+    RAISE EXCEPTION 'pg_stat_statements is not installed'
+    	USING HINT = 'install pg_stat_statements extension and try again';
+ END IF;
+END;
+$citus_stat_statements$;
+
+CREATE VIEW citus.citus_stat_statements AS
+SELECT
+  queryid,
+  userid,
+  dbid,
+  query,
+  pg_catalog.citus_executor_name(executor::int) AS executor,
+  partition_key,
+  calls
+FROM pg_catalog.citus_stat_statements();
+ALTER VIEW citus.citus_stat_statements SET SCHEMA pg_catalog;
+GRANT SELECT ON pg_catalog.citus_stat_statements TO public;
+
+DROP AGGREGATE pg_catalog.citus_count_distinct_sketch(anyelement, integer);
+DROP AGGREGATE pg_catalog.citus_count_distinct_merge(bytea);
+DROP FUNCTION pg_catalog.citus_count_distinct_sketch_sfunc(internal, anyelement, integer);
+DROP FUNCTION pg_catalog.citus_count_distinct_sketch_ffunc(internal);
+DROP FUNCTION pg_catalog.citus_count_distinct_merge_sfunc(internal, bytea);
+DROP FUNCTION pg_catalog.citus_count_distinct_merge_ffunc(internal);
+
+DROP FUNCTION pg_catalog.citus_collect_shard_column_statistics(regclass, text, boolean);
+DROP FUNCTION pg_catalog.citus_drop_shard_column_statistics(regclass, text);
+DROP TABLE pg_catalog.pg_dist_shard_column_stats;
+
+DROP FUNCTION pg_catalog.citus_remove_ingestion(text);
+DROP TABLE pg_catalog.pg_dist_ingestion;
+
+DROP FUNCTION pg_catalog.citus_warm_connections();
+DROP FUNCTION pg_catalog.citus_node_latencies();
+
+DROP FUNCTION pg_catalog.worker_push_partition_query_result(text, text, int, citus.distribution_type, text[], text[], text[], int[], boolean, boolean);
+
+#include "../udfs/get_rebalance_progress/11.2-1.sql"
+
+DROP FUNCTION pg_catalog.worker_split_copy(bigint, text, pg_catalog.split_copy_info[], bigint, bigint);
+
+DROP VIEW pg_catalog.citus_stat_statements_histograms;
+DROP FUNCTION pg_catalog.citus_query_stats_histograms();
+
+DROP FUNCTION pg_catalog.citus_task_execution_traces();
+
+DROP VIEW pg_catalog.citus_stat_tenants;
+DROP FUNCTION pg_catalog.citus_stat_tenants(boolean);
+DROP VIEW pg_catalog.citus_stat_tenants_local;
+DROP FUNCTION pg_catalog.citus_stat_tenants_local(boolean);
+DROP FUNCTION pg_catalog.citus_stat_tenants_local_internal(boolean);
+#include "../udfs/citus_stat_tenants_local/12.0-1.sql"
+#include "../udfs/citus_stat_tenants/11.3-1.sql"
+
+DROP FUNCTION pg_catalog.citus_wait_events();
+
+-- citus_stat_activity no longer reports the Citus wait events
+DROP VIEW pg_catalog.citus_lock_waits;
+DROP VIEW pg_catalog.citus_dist_stat_activity;
+DROP VIEW pg_catalog.citus_stat_activity;
+#include "../udfs/citus_stat_activity/11.0-1.sql"
+#include "../udfs/citus_dist_stat_activity/11.0-1.sql"
+#include "../udfs/citus_lock_waits/11.0-1.sql"
+
+DROP VIEW pg_catalog.citus_stat_connections;
+DROP FUNCTION pg_catalog.citus_connection_counters();
+DROP FUNCTION pg_catalog.citus_connection_counters_reset();
+
+DROP VIEW pg_catalog.citus_stat_intermediate_results;
+DROP FUNCTION pg_catalog.citus_query_stats_intermediate_results();
+
+DROP FUNCTION pg_catalog.worker_explain_analyze_query(text, jsonb);
+
+DROP FUNCTION pg_catalog.citus_refresh_shard_size_cache(regclass);
+
+DROP FUNCTION pg_catalog.citus_call_procedure_batch(regprocedure, text[]);
+
+#include "../udfs/create_time_partitions/10.2-1.sql"
+#include "../udfs/drop_old_time_partitions/12.0-1.sql"
+DROP FUNCTION pg_catalog.citus_execute_partition_commands(text[]);
+
+DROP FUNCTION pg_catalog.citus_copy_shard_placement_to_nodes(bigint, integer, integer[], citus.shard_transfer_mode);
+
+DROP FUNCTION pg_catalog.citus_set_reference_table_async(regclass, boolean);
+DROP FUNCTION pg_catalog.citus_wait_for_async_reference_tables(integer);
+DROP FUNCTION citus_internal.async_reference_table_replica_trigger();
+DROP TABLE pg_catalog.pg_dist_async_reference_table;
+#include "../udfs/citus_prepare_pg_upgrade/12.1-1.sql"
+
+DROP TRIGGER dist_schema_cache_invalidate ON pg_catalog.pg_dist_schema;
+DROP FUNCTION pg_catalog.citus_dist_schema_cache_invalidate();
+
+DROP FUNCTION pg_catalog.citus_schema_move_batch(regnamespace[], text, integer, citus.shard_transfer_mode);
+
+DROP FUNCTION pg_catalog.alter_distributed_table_concurrently(regclass, integer, citus.shard_transfer_mode);
+
+DROP FUNCTION pg_catalog.citus_maintenance_daemon_duties();
+
+DROP FUNCTION pg_catalog.citus_remote_command_traces();
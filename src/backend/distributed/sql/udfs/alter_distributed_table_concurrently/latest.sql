@@ -0,0 +1,12 @@
+CREATE OR REPLACE FUNCTION pg_catalog.alter_distributed_table_concurrently(
+    table_name regclass,
+    shard_count int,
+    shard_transfer_mode citus.shard_transfer_mode default 'auto')
+  RETURNS void
+  LANGUAGE C STRICT
+  AS 'MODULE_PATHNAME', $$alter_distributed_table_concurrently$$;
+COMMENT ON FUNCTION pg_catalog.alter_distributed_table_concurrently(
+    table_name regclass,
+    shard_count int,
+    shard_transfer_mode citus.shard_transfer_mode)
+  IS 'increases the shard count of a distributed table and its co-located tables by splitting their shards, without blocking writes';
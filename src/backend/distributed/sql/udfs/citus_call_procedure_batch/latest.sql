@@ -0,0 +1,8 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_call_procedure_batch(
+    procedure regprocedure,
+    call_arguments text[])
+    RETURNS bigint
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_call_procedure_batch$$;
+COMMENT ON FUNCTION pg_catalog.citus_call_procedure_batch(regprocedure, text[])
+    IS 'calls a distributed procedure for every row of arguments, with a single command per node';
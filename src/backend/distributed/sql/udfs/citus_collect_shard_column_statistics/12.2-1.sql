@@ -0,0 +1,9 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_collect_shard_column_statistics(
+    table_name regclass,
+    column_name text DEFAULT NULL,
+    stale_only boolean DEFAULT false)
+    RETURNS bigint
+    LANGUAGE C
+    AS 'MODULE_PATHNAME', $$citus_collect_shard_column_statistics$$;
+COMMENT ON FUNCTION pg_catalog.citus_collect_shard_column_statistics(regclass, text, boolean)
+    IS 'collects the row counts and the minimum and maximum values of a column in the shards of a table, which are used for shard pruning';
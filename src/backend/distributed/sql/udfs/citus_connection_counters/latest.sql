@@ -0,0 +1,34 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_connection_counters(
+    OUT nodename text,
+    OUT nodeport int,
+    OUT commands_sent bigint,
+    OUT bytes_sent bigint,
+    OUT copy_bytes_sent bigint,
+    OUT bytes_received bigint,
+    OUT connections_established bigint,
+    OUT connection_establishment_time float8,
+    OUT connection_failures bigint,
+    OUT wait_time float8,
+    OUT stats_reset timestamptz)
+RETURNS SETOF RECORD
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_connection_counters$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_connection_counters()
+    IS 'returns the cumulative counters of the connections from this node to each node';
+
+REVOKE ALL ON FUNCTION pg_catalog.citus_connection_counters() FROM PUBLIC;
+
+CREATE OR REPLACE FUNCTION pg_catalog.citus_connection_counters_reset()
+RETURNS void
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_connection_counters_reset$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_connection_counters_reset()
+    IS 'resets the counters of the connections from this node';
+
+REVOKE ALL ON FUNCTION pg_catalog.citus_connection_counters_reset() FROM PUBLIC;
+
+CREATE VIEW citus.citus_stat_connections AS
+SELECT * FROM pg_catalog.citus_connection_counters();
+ALTER VIEW citus.citus_stat_connections SET SCHEMA pg_catalog;
@@ -0,0 +1,15 @@
+CREATE FUNCTION pg_catalog.citus_copy_shard_placement_to_nodes(
+	shard_id bigint,
+	source_node_id integer,
+	target_node_ids integer[],
+	transfer_mode citus.shard_transfer_mode default 'auto')
+RETURNS void
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_copy_shard_placement_to_nodes$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_copy_shard_placement_to_nodes(
+	shard_id bigint,
+	source_node_id integer,
+	target_node_ids integer[],
+	transfer_mode citus.shard_transfer_mode)
+IS 'copy a shard from the source node to all of the destination nodes at once';
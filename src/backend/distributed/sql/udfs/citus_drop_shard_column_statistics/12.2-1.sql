@@ -0,0 +1,8 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_drop_shard_column_statistics(
+    table_name regclass,
+    column_name text DEFAULT NULL)
+    RETURNS void
+    LANGUAGE C
+    AS 'MODULE_PATHNAME', $$citus_drop_shard_column_statistics$$;
+COMMENT ON FUNCTION pg_catalog.citus_drop_shard_column_statistics(regclass, text)
+    IS 'removes the statistics collected for a column, or all columns, of a table';
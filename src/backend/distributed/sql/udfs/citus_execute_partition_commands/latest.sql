@@ -0,0 +1,6 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_execute_partition_commands(commands text[])
+    RETURNS void
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_execute_partition_commands$$;
+COMMENT ON FUNCTION pg_catalog.citus_execute_partition_commands(text[])
+    IS 'creates or drops partitions, and creates or drops the shards of all of them together';
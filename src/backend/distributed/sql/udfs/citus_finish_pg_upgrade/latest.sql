@@ -124,6 +124,7 @@ BEGIN
     INSERT INTO pg_catalog.pg_dist_colocation SELECT * FROM public.pg_dist_colocation;
     INSERT INTO pg_catalog.pg_dist_cleanup SELECT * FROM public.pg_dist_cleanup;
     INSERT INTO pg_catalog.pg_dist_schema SELECT schemaname::regnamespace, colocationid FROM public.pg_dist_schema;
+    INSERT INTO pg_catalog.pg_dist_async_reference_table SELECT * FROM public.pg_dist_async_reference_table;
     -- enterprise catalog tables
     INSERT INTO pg_catalog.pg_dist_authinfo SELECT * FROM public.pg_dist_authinfo;
     INSERT INTO pg_catalog.pg_dist_poolinfo SELECT * FROM public.pg_dist_poolinfo;
@@ -162,6 +163,7 @@ BEGIN
     DROP TABLE public.pg_dist_rebalance_strategy;
     DROP TABLE public.pg_dist_cleanup;
     DROP TABLE public.pg_dist_schema;
+    DROP TABLE public.pg_dist_async_reference_table;
     --
     -- reset sequences
     --
@@ -0,0 +1,6 @@
+CREATE OR REPLACE FUNCTION citus_internal.async_reference_table_replica_trigger()
+    RETURNS trigger
+    LANGUAGE C
+    AS 'MODULE_PATHNAME', $$citus_internal_async_reference_table_replica_trigger$$;
+COMMENT ON FUNCTION citus_internal.async_reference_table_replica_trigger()
+    IS 'rejects modifications of the replica placements of asynchronously replicated reference tables';
@@ -0,0 +1,15 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_maintenance_daemon_duties(
+    OUT duty text,
+    OUT runs bigint,
+    OUT last_start timestamptz,
+    OUT last_duration float8,
+    OUT max_duration float8,
+    OUT total_duration float8)
+RETURNS SETOF RECORD
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_maintenance_daemon_duties$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_maintenance_daemon_duties()
+    IS 'returns the timings of the duties of the maintenance daemon of the current database';
+
+REVOKE ALL ON FUNCTION pg_catalog.citus_maintenance_daemon_duties() FROM PUBLIC;
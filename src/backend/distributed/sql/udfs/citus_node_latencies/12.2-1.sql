@@ -0,0 +1,19 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_node_latencies(
+    OUT nodename text,
+    OUT nodeport int,
+    OUT avg_task_execution_time float8,
+    OUT task_count bigint,
+    OUT avg_connection_establishment_time float8,
+    OUT connection_count bigint,
+    OUT avg_probe_round_trip_time float8,
+    OUT replication_lag float8,
+    OUT probe_error_rate float8,
+    OUT degraded bool)
+RETURNS SETOF RECORD
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_node_latencies$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_node_latencies()
+    IS 'returns the recent average task execution and connection establishment times and the health of the nodes';
+
+REVOKE ALL ON FUNCTION pg_catalog.citus_node_latencies() FROM PUBLIC;
@@ -43,6 +43,7 @@ BEGIN
     DROP TABLE IF EXISTS public.pg_dist_object;
     DROP TABLE IF EXISTS public.pg_dist_cleanup;
     DROP TABLE IF EXISTS public.pg_dist_schema;
+    DROP TABLE IF EXISTS public.pg_dist_async_reference_table;
     DROP TABLE IF EXISTS public.pg_dist_clock_logical_seq;
 
     --
@@ -59,6 +60,7 @@ BEGIN
     CREATE TABLE public.pg_dist_cleanup AS SELECT * FROM pg_catalog.pg_dist_cleanup;
     -- save names of the tenant schemas instead of their oids because the oids might change after pg upgrade
     CREATE TABLE public.pg_dist_schema AS SELECT schemaid::regnamespace::text AS schemaname, colocationid FROM pg_catalog.pg_dist_schema;
+    CREATE TABLE public.pg_dist_async_reference_table AS SELECT * FROM pg_catalog.pg_dist_async_reference_table;
     -- enterprise catalog tables
     CREATE TABLE public.pg_dist_authinfo AS SELECT * FROM pg_catalog.pg_dist_authinfo;
     CREATE TABLE public.pg_dist_poolinfo AS SELECT * FROM pg_catalog.pg_dist_poolinfo;
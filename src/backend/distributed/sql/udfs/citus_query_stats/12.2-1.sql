@@ -0,0 +1,15 @@
+CREATE FUNCTION pg_catalog.citus_query_stats(OUT queryid bigint,
+											 OUT userid oid,
+											 OUT dbid oid,
+											 OUT executor bigint,
+											 OUT partition_key text,
+											 OUT calls bigint,
+											 OUT plans bigint,
+											 OUT pushdown_check_time double precision,
+											 OUT recursive_planning_time double precision,
+											 OUT logical_optimization_time double precision,
+											 OUT physical_planning_time double precision,
+											 OUT deparse_time double precision)
+RETURNS SETOF record
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_query_stats$$;
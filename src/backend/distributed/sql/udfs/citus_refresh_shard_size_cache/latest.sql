@@ -0,0 +1,7 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_refresh_shard_size_cache(
+    table_name regclass DEFAULT NULL)
+    RETURNS bigint
+    LANGUAGE C
+    AS 'MODULE_PATHNAME', $$citus_refresh_shard_size_cache$$;
+COMMENT ON FUNCTION pg_catalog.citus_refresh_shard_size_cache(regclass)
+    IS 'collects the sizes of the shard placements of a table, or of all tables, into the shard size cache';
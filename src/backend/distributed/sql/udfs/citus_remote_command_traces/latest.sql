@@ -0,0 +1,19 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_remote_command_traces(
+    OUT start_time timestamptz,
+    OUT pid int,
+    OUT queryid bigint,
+    OUT nodename text,
+    OUT nodeport int,
+    OUT connection_id bigint,
+    OUT duration float8,
+    OUT bytes_sent bigint,
+    OUT bytes_received bigint,
+    OUT command text)
+RETURNS SETOF RECORD
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_remote_command_traces$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_remote_command_traces()
+    IS 'returns the sampled commands sent to remote nodes';
+
+REVOKE ALL ON FUNCTION pg_catalog.citus_remote_command_traces() FROM PUBLIC;
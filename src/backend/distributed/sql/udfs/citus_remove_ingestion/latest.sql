@@ -0,0 +1,6 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_remove_ingestion(ingestion_id text)
+    RETURNS void
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_remove_ingestion$$;
+COMMENT ON FUNCTION pg_catalog.citus_remove_ingestion(text)
+    IS 'removes the progress of a resumable bulk load, such that its id can be reused';
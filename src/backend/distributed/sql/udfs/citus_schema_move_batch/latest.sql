@@ -0,0 +1,14 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_schema_move_batch(
+	schema_ids regnamespace[],
+	target_node_name text,
+	target_node_port integer,
+	shard_transfer_mode citus.shard_transfer_mode default 'auto')
+RETURNS void
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_schema_move_batch$$;
+COMMENT ON FUNCTION pg_catalog.citus_schema_move_batch(
+	schema_ids regnamespace[],
+	target_node_name text,
+	target_node_port integer,
+	shard_transfer_mode citus.shard_transfer_mode)
+IS 'move distributed schemas on the same node to given node in a single transfer';
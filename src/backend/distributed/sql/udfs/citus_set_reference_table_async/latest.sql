@@ -0,0 +1,8 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_set_reference_table_async(
+    table_name regclass,
+    async boolean)
+    RETURNS void
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_set_reference_table_async$$;
+COMMENT ON FUNCTION pg_catalog.citus_set_reference_table_async(regclass, boolean)
+    IS 'sets whether the modifications of a reference table are only written to its primary placement and replicated asynchronously to the other placements';
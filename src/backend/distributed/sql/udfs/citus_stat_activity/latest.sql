@@ -4,6 +4,8 @@
 -- citus_stat_activity has the most expansive column set, including the newly added columns.
 -- If citus_stat_activity is queried in a Postgres version where pg_stat_activity doesn't have some columns citus_stat_activity has
 -- the values for those columns will be NULL
+-- pg_stat_activity reports all wait events of extensions as "Extension", so
+-- citus_stat_activity replaces them with the Citus wait events from citus_wait_events()
 
 CREATE OR REPLACE FUNCTION pg_catalog.citus_stat_activity(OUT global_pid bigint, OUT nodeid int, OUT is_worker_query boolean, OUT datid oid, OUT datname name, OUT pid integer,
                                                           OUT leader_pid integer, OUT usesysid oid, OUT usename name, OUT application_name text, OUT client_addr inet, OUT client_hostname text,
@@ -18,10 +20,16 @@ BEGIN
         SELECT jsonb_agg(all_csa_rows_as_jsonb.csa_row_as_jsonb)::JSONB FROM (
             SELECT jsonb_array_elements(run_command_on_all_nodes.result::JSONB)::JSONB || ('{"nodeid":' || run_command_on_all_nodes.nodeid || '}')::JSONB AS csa_row_as_jsonb
             FROM run_command_on_all_nodes($$
-                SELECT coalesce(to_jsonb(array_agg(csa_from_one_node.*)), '[{}]'::JSONB)
+                SELECT coalesce(jsonb_agg(to_jsonb(csa_from_one_node.*) - 'citus_wait_event' ||
+                                          CASE WHEN citus_wait_event IS NULL THEN '{}'::JSONB
+                                          ELSE jsonb_build_object('wait_event', citus_wait_event) END),
+                                '[{}]'::JSONB)
                 FROM (
-                    SELECT global_pid, worker_query AS is_worker_query, pg_stat_activity.* FROM
+                    SELECT global_pid, worker_query AS is_worker_query, pg_stat_activity.*,
+                           citus_wait_events.citus_wait_event FROM
                     pg_stat_activity LEFT JOIN get_all_active_transactions() ON process_id = pid
+                    LEFT JOIN citus_wait_events() AS citus_wait_events(citus_wait_pid, citus_wait_event)
+                    ON citus_wait_pid = pg_stat_activity.pid
                 ) AS csa_from_one_node;
             $$, parallel:=true, give_warning_for_connection_errors:=true)
             WHERE success = 't'
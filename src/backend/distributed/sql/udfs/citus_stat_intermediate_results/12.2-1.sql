@@ -0,0 +1,32 @@
+CREATE FUNCTION pg_catalog.citus_query_stats_intermediate_results(
+    OUT queryid bigint,
+    OUT userid oid,
+    OUT dbid oid,
+    OUT executor bigint,
+    OUT partition_key text,
+    OUT intermediate_results bigint,
+    OUT bytes_written bigint,
+    OUT bytes_broadcast bigint,
+    OUT receiving_nodes bigint,
+    OUT total_time double precision)
+RETURNS SETOF record
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_query_stats_intermediate_results$$;
+COMMENT ON FUNCTION pg_catalog.citus_query_stats_intermediate_results()
+    IS 'returns the totals of the intermediate results created by the distributed queries in citus_stat_statements';
+
+CREATE VIEW citus.citus_stat_intermediate_results AS
+SELECT
+  queryid,
+  userid,
+  dbid,
+  pg_catalog.citus_executor_name(executor::int) AS executor,
+  partition_key,
+  intermediate_results,
+  bytes_written,
+  bytes_broadcast,
+  receiving_nodes,
+  total_time
+FROM pg_catalog.citus_query_stats_intermediate_results();
+ALTER VIEW citus.citus_stat_intermediate_results SET SCHEMA pg_catalog;
+GRANT SELECT ON pg_catalog.citus_stat_intermediate_results TO public;
@@ -0,0 +1,54 @@
+CREATE FUNCTION pg_catalog.citus_stat_statements(OUT queryid bigint,
+												 OUT userid oid,
+												 OUT dbid oid,
+												 OUT query text,
+												 OUT executor bigint,
+												 OUT partition_key text,
+												 OUT calls bigint,
+												 OUT plans bigint,
+												 OUT pushdown_check_time double precision,
+												 OUT recursive_planning_time double precision,
+												 OUT logical_optimization_time double precision,
+												 OUT physical_planning_time double precision,
+												 OUT deparse_time double precision)
+RETURNS SETOF record
+LANGUAGE plpgsql
+AS $citus_stat_statements$
+BEGIN
+ IF EXISTS (
+ 	SELECT extname FROM pg_extension
+ 	WHERE extname = 'pg_stat_statements')
+ THEN
+ 	RETURN QUERY SELECT pss.queryid, pss.userid, pss.dbid, pss.query, cqs.executor,
+ 						cqs.partition_key, cqs.calls, cqs.plans,
+ 						cqs.pushdown_check_time, cqs.recursive_planning_time,
+ 						cqs.logical_optimization_time, cqs.physical_planning_time,
+ 						cqs.deparse_time
+ 				 FROM pg_stat_statements(true) pss
+ 				 	JOIN citus_query_stats() cqs
+ 				 	USING (queryid, userid, dbid);
+ ELSE
+    RAISE EXCEPTION 'pg_stat_statements is not installed'
+    	USING HINT = 'install pg_stat_statements extension and try again';
+ END IF;
+END;
+$citus_stat_statements$;
+
+CREATE VIEW citus.citus_stat_statements AS
+SELECT
+  queryid,
+  userid,
+  dbid,
+  query,
+  pg_catalog.citus_executor_name(executor::int) AS executor,
+  partition_key,
+  calls,
+  plans,
+  pushdown_check_time,
+  recursive_planning_time,
+  logical_optimization_time,
+  physical_planning_time,
+  deparse_time
+FROM pg_catalog.citus_stat_statements();
+ALTER VIEW citus.citus_stat_statements SET SCHEMA pg_catalog;
+GRANT SELECT ON pg_catalog.citus_stat_statements TO public;
@@ -0,0 +1,29 @@
+CREATE FUNCTION pg_catalog.citus_query_stats_histograms(OUT queryid bigint,
+														OUT userid oid,
+														OUT dbid oid,
+														OUT executor bigint,
+														OUT partition_key text,
+														OUT metric text,
+														OUT lower_bound double precision,
+														OUT upper_bound double precision,
+														OUT count bigint)
+RETURNS SETOF record
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_query_stats_histograms$$;
+COMMENT ON FUNCTION pg_catalog.citus_query_stats_histograms()
+    IS 'returns the latency histograms of the distributed queries in citus_stat_statements';
+
+CREATE VIEW citus.citus_stat_statements_histograms AS
+SELECT
+  queryid,
+  userid,
+  dbid,
+  pg_catalog.citus_executor_name(executor::int) AS executor,
+  partition_key,
+  metric,
+  lower_bound,
+  upper_bound,
+  count
+FROM pg_catalog.citus_query_stats_histograms();
+ALTER VIEW citus.citus_stat_statements_histograms SET SCHEMA pg_catalog;
+GRANT SELECT ON pg_catalog.citus_stat_statements_histograms TO public;
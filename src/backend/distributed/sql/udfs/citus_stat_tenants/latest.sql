@@ -10,7 +10,13 @@ CREATE OR REPLACE FUNCTION pg_catalog.citus_stat_tenants (
     OUT query_count_in_last_period INT,
     OUT cpu_usage_in_this_period DOUBLE PRECISION,
     OUT cpu_usage_in_last_period DOUBLE PRECISION,
-    OUT score BIGINT
+    OUT score BIGINT,
+    OUT buffer_hits_in_this_period BIGINT,
+    OUT buffer_hits_in_last_period BIGINT,
+    OUT buffer_reads_in_this_period BIGINT,
+    OUT buffer_reads_in_last_period BIGINT,
+    OUT rows_returned_in_this_period BIGINT,
+    OUT rows_returned_in_last_period BIGINT
 )
     RETURNS SETOF record
     LANGUAGE plpgsql
@@ -55,7 +61,13 @@ AS (
     query_count_in_last_period INT,
     cpu_usage_in_this_period DOUBLE PRECISION,
     cpu_usage_in_last_period DOUBLE PRECISION,
-    score BIGINT
+    score BIGINT,
+    buffer_hits_in_this_period BIGINT,
+    buffer_hits_in_last_period BIGINT,
+    buffer_reads_in_this_period BIGINT,
+    buffer_reads_in_last_period BIGINT,
+    rows_returned_in_this_period BIGINT,
+    rows_returned_in_last_period BIGINT
 )
     ORDER BY score DESC
     LIMIT CASE WHEN NOT return_all_tenants THEN current_setting('citus.stat_tenants_limit')::BIGINT END;
@@ -72,7 +84,13 @@ SELECT
     query_count_in_this_period,
     query_count_in_last_period,
     cpu_usage_in_this_period,
-    cpu_usage_in_last_period
+    cpu_usage_in_last_period,
+    buffer_hits_in_this_period,
+    buffer_hits_in_last_period,
+    buffer_reads_in_this_period,
+    buffer_reads_in_last_period,
+    rows_returned_in_this_period,
+    rows_returned_in_last_period
 FROM pg_catalog.citus_stat_tenants(FALSE);
 
 ALTER VIEW citus.citus_stat_tenants SET SCHEMA pg_catalog;
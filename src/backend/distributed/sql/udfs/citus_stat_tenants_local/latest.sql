@@ -8,7 +8,13 @@ CREATE OR REPLACE FUNCTION pg_catalog.citus_stat_tenants_local_internal(
     OUT query_count_in_last_period INT,
     OUT cpu_usage_in_this_period DOUBLE PRECISION,
     OUT cpu_usage_in_last_period DOUBLE PRECISION,
-    OUT score BIGINT)
+    OUT score BIGINT,
+    OUT buffer_hits_in_this_period BIGINT,
+    OUT buffer_hits_in_last_period BIGINT,
+    OUT buffer_reads_in_this_period BIGINT,
+    OUT buffer_reads_in_last_period BIGINT,
+    OUT rows_returned_in_this_period BIGINT,
+    OUT rows_returned_in_last_period BIGINT)
 RETURNS SETOF RECORD
 LANGUAGE C
 AS 'citus', $$citus_stat_tenants_local$$;
@@ -23,7 +29,13 @@ CREATE OR REPLACE FUNCTION pg_catalog.citus_stat_tenants_local(
     OUT query_count_in_last_period INT,
     OUT cpu_usage_in_this_period DOUBLE PRECISION,
     OUT cpu_usage_in_last_period DOUBLE PRECISION,
-    OUT score BIGINT)
+    OUT score BIGINT,
+    OUT buffer_hits_in_this_period BIGINT,
+    OUT buffer_hits_in_last_period BIGINT,
+    OUT buffer_reads_in_this_period BIGINT,
+    OUT buffer_reads_in_last_period BIGINT,
+    OUT rows_returned_in_this_period BIGINT,
+    OUT rows_returned_in_last_period BIGINT)
 RETURNS SETOF RECORD
 LANGUAGE plpgsql
 AS $function$
@@ -38,7 +50,13 @@ BEGIN
         L.query_count_in_last_period,
         L.cpu_usage_in_this_period,
         L.cpu_usage_in_last_period,
-        L.score
+        L.score,
+        L.buffer_hits_in_this_period,
+        L.buffer_hits_in_last_period,
+        L.buffer_reads_in_this_period,
+        L.buffer_reads_in_last_period,
+        L.rows_returned_in_this_period,
+        L.rows_returned_in_last_period
     FROM pg_catalog.citus_stat_tenants_local_internal(return_all_tenants) L
     LEFT JOIN pg_dist_schema S ON L.tenant_attribute IS NULL AND L.colocation_id = S.colocationid
     LEFT JOIN pg_namespace N ON N.oid = S.schemaid
@@ -55,7 +73,13 @@ SELECT
     query_count_in_this_period,
     query_count_in_last_period,
     cpu_usage_in_this_period,
-    cpu_usage_in_last_period
+    cpu_usage_in_last_period,
+    buffer_hits_in_this_period,
+    buffer_hits_in_last_period,
+    buffer_reads_in_this_period,
+    buffer_reads_in_last_period,
+    rows_returned_in_this_period,
+    rows_returned_in_last_period
 FROM pg_catalog.citus_stat_tenants_local()
 ORDER BY score DESC;
 
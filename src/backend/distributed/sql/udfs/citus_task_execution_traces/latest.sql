@@ -0,0 +1,21 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_task_execution_traces(
+    OUT start_time timestamptz,
+    OUT queryid bigint,
+    OUT task_id int,
+    OUT shardid bigint,
+    OUT nodename text,
+    OUT nodeport int,
+    OUT connection_acquire_time float8,
+    OUT send_time float8,
+    OUT first_byte_time float8,
+    OUT receive_time float8,
+    OUT bytes_received bigint,
+    OUT rows_received bigint)
+RETURNS SETOF RECORD
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_task_execution_traces$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_task_execution_traces()
+    IS 'returns the timings of the sampled remote task executions';
+
+REVOKE ALL ON FUNCTION pg_catalog.citus_task_execution_traces() FROM PUBLIC;
@@ -0,0 +1,9 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_wait_events(
+    OUT pid int,
+    OUT wait_event text)
+RETURNS SETOF RECORD
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$citus_wait_events$$;
+
+COMMENT ON FUNCTION pg_catalog.citus_wait_events()
+    IS 'returns the Citus wait events of the backends on this node';
@@ -0,0 +1,7 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_wait_for_async_reference_tables(
+    timeout_ms integer DEFAULT -1)
+    RETURNS boolean
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_wait_for_async_reference_tables$$;
+COMMENT ON FUNCTION pg_catalog.citus_wait_for_async_reference_tables(integer)
+    IS 'waits until all placements of asynchronously replicated reference tables applied the modifications committed before the call';
@@ -0,0 +1,6 @@
+CREATE OR REPLACE FUNCTION pg_catalog.citus_warm_connections()
+    RETURNS int
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$citus_warm_connections$$;
+COMMENT ON FUNCTION pg_catalog.citus_warm_connections()
+    IS 'opens the connections that the session caches to the other nodes';
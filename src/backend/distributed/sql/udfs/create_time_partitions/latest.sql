@@ -14,8 +14,8 @@ DECLARE
     -- record for to-be-created partition
     missing_partition_record record;
 
-    -- result indiciates whether any partitions were created
-    partition_created bool := false;
+    -- commands that create the missing partitions
+    partition_commands text[] := ARRAY[]::text[];
 BEGIN
     IF start_from >= end_at THEN
         RAISE 'start_from (%) must be older than end_at (%)', start_from, end_at;
@@ -32,18 +32,24 @@ BEGIN
         SELECT *
         FROM get_missing_time_partition_ranges(table_name, partition_interval, end_at, start_from)
     LOOP
-        EXECUTE format('CREATE TABLE %I.%I PARTITION OF %I.%I FOR VALUES FROM (%L) TO (%L)',
-        schema_name_text,
-        missing_partition_record.partition_name,
-        schema_name_text,
-        table_name_text,
-        missing_partition_record.range_from_value,
-        missing_partition_record.range_to_value);
-
-        partition_created := true;
+        partition_commands := partition_commands ||
+            format('CREATE TABLE %I.%I PARTITION OF %I.%I FOR VALUES FROM (%L) TO (%L)',
+            schema_name_text,
+            missing_partition_record.partition_name,
+            schema_name_text,
+            table_name_text,
+            missing_partition_record.range_from_value,
+            missing_partition_record.range_to_value);
     END LOOP;
 
-    RETURN partition_created;
+    IF cardinality(partition_commands) = 0 THEN
+        RETURN false;
+    END IF;
+
+    -- create the shards of all partitions of a distributed table together
+    PERFORM pg_catalog.citus_execute_partition_commands(partition_commands);
+
+    RETURN true;
 END;
 $$;
 COMMENT ON FUNCTION pg_catalog.create_time_partitions(
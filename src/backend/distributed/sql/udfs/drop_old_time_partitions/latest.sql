@@ -15,6 +15,9 @@ DECLARE
     older_partitions_query text;
 
     r record;
+
+    -- commands that drop the old partitions
+    partition_commands text[] := ARRAY[]::text[];
 BEGIN
     -- check whether the table is time partitioned table, if not error out
     SELECT partnatts, partattrs[0]
@@ -58,8 +61,14 @@ BEGIN
     FOR r IN EXECUTE older_partitions_query USING table_name, older_than
     LOOP
         RAISE NOTICE 'dropping % with start time % and end time %', r.partition, r.from_value, r.to_value;
-        EXECUTE format('DROP TABLE %I.%I', r.schema_name, r.table_name);
+        partition_commands := partition_commands ||
+            format('DROP TABLE %I.%I', r.schema_name, r.table_name);
     END LOOP;
+
+    -- drop the shards of all partitions of a distributed table together
+    IF cardinality(partition_commands) > 0 THEN
+        PERFORM pg_catalog.citus_execute_partition_commands(partition_commands);
+    END IF;
 END;
 $$;
 COMMENT ON PROCEDURE pg_catalog.drop_old_time_partitions(
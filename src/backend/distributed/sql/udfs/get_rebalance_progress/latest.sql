@@ -15,7 +15,9 @@ CREATE OR REPLACE FUNCTION pg_catalog.get_rebalance_progress()
                 operation_type text,
                 source_lsn pg_lsn,
                 target_lsn pg_lsn,
-                status text
+                status text,
+                source_max_copy_rate bigint,
+                replication_lag bigint
             )
   AS 'MODULE_PATHNAME'
   LANGUAGE C STRICT;
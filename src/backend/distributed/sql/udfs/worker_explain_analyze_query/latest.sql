@@ -0,0 +1,8 @@
+CREATE OR REPLACE FUNCTION pg_catalog.worker_explain_analyze_query(
+      query text, options jsonb)
+    RETURNS SETOF record
+    LANGUAGE C STRICT
+    AS 'MODULE_PATHNAME', $$worker_explain_analyze_query$$;
+
+COMMENT ON FUNCTION pg_catalog.worker_explain_analyze_query(text, jsonb) IS
+    'Executes and returns results of query followed by a row with its EXPLAIN ANALYZE output';
@@ -0,0 +1,20 @@
+CREATE OR REPLACE FUNCTION pg_catalog.worker_push_partition_query_result(
+    result_prefix text,
+    query text,
+    partition_column_index int,
+    partition_method citus.distribution_type,
+    partition_min_values text[],
+    partition_max_values text[],
+    partition_node_names text[],
+    partition_node_ports int[],
+    binary_copy boolean,
+    allow_null_partition_column boolean DEFAULT false,
+    OUT partition_index int,
+    OUT result_id text,
+    OUT rows_written bigint,
+    OUT bytes_written bigint)
+RETURNS SETOF record
+LANGUAGE C STRICT VOLATILE
+AS 'MODULE_PATHNAME', $$worker_push_partition_query_result$$;
+COMMENT ON FUNCTION pg_catalog.worker_push_partition_query_result(text, text, int, citus.distribution_type, text[], text[], text[], int[], boolean, boolean)
+IS 'execute a query and push its partitioned results to the nodes of the partitions';
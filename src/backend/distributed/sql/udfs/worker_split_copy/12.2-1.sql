@@ -0,0 +1,22 @@
+-- pg_catalog.split_copy_info is created in 11.1-1.sql
+CREATE OR REPLACE FUNCTION pg_catalog.worker_split_copy(
+    source_shard_id bigint,
+	distribution_column text,
+    splitCopyInfos pg_catalog.split_copy_info[])
+RETURNS void
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$worker_split_copy$$;
+COMMENT ON FUNCTION pg_catalog.worker_split_copy(source_shard_id bigint, distribution_column text, splitCopyInfos pg_catalog.split_copy_info[])
+    IS 'Perform split copy for shard';
+
+CREATE OR REPLACE FUNCTION pg_catalog.worker_split_copy(
+    source_shard_id bigint,
+    distribution_column text,
+    splitCopyInfos pg_catalog.split_copy_info[],
+    start_block bigint,
+    end_block bigint)
+RETURNS void
+LANGUAGE C STRICT
+AS 'MODULE_PATHNAME', $$worker_split_copy$$;
+COMMENT ON FUNCTION pg_catalog.worker_split_copy(source_shard_id bigint, distribution_column text, splitCopyInfos pg_catalog.split_copy_info[], start_block bigint, end_block bigint)
+    IS 'Perform split copy for a range of blocks of a shard';
@@ -84,7 +84,8 @@ partition_task_list_results(PG_FUNCTION_ARGS)
 
 	List *fragmentList = PartitionTasklistResults(resultIdPrefix, taskList,
 												  partitionColumnIndex,
-												  targetRelation, binaryFormat);
+												  targetRelation, binaryFormat,
+												  false);
 
 	TupleDesc tupleDescriptor = NULL;
 	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
@@ -151,7 +152,8 @@ redistribute_task_list_results(PG_FUNCTION_ARGS)
 
 	List **shardResultIds = RedistributeTaskListResults(resultIdPrefix, taskList,
 														partitionColumnIndex,
-														targetRelation, binaryFormat);
+														targetRelation, binaryFormat,
+														false);
 
 	TupleDesc tupleDescriptor = NULL;
 	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
@@ -0,0 +1,270 @@
+/*-------------------------------------------------------------------------
+ *
+ * test/src/planner_microbenchmark.c
+ *
+ * This file contains functions to measure the cost of the planner and
+ * deparser hot paths of Citus in isolation. Each function runs a step on a
+ * given query a number of times and returns the average time and memory
+ * it took per run.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "fmgr.h"
+#include "funcapi.h"
+
+#include "access/htup_details.h"
+#include "executor/instrument.h"
+#include "lib/stringinfo.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodes.h"
+#include "nodes/parsenodes.h"
+#include "nodes/pg_list.h"
+#include "optimizer/optimizer.h"
+#include "optimizer/planner.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+
+#include "pg_version_compat.h"
+
+#include "distributed/citus_ruleutils.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/multi_router_planner.h"
+#include "distributed/shard_pruning.h"
+
+
+/* the step of which the cost is measured */
+typedef enum MicrobenchmarkStep
+{
+	MICROBENCHMARK_PLANNER,
+	MICROBENCHMARK_FAST_PATH_ROUTER,
+	MICROBENCHMARK_SHARD_PRUNING,
+	MICROBENCHMARK_DEPARSE
+} MicrobenchmarkStep;
+
+
+/* local function forward declarations */
+static Datum RunMicrobenchmark(FunctionCallInfo fcinfo, MicrobenchmarkStep step);
+static Query * ParseSingleQuery(char *queryString);
+static void RunMicrobenchmarkStep(MicrobenchmarkStep step, Query *query,
+								  char *queryString);
+
+
+/* declarations for dynamic loading */
+PG_FUNCTION_INFO_V1(microbenchmark_planner);
+PG_FUNCTION_INFO_V1(microbenchmark_fast_path_router);
+PG_FUNCTION_INFO_V1(microbenchmark_shard_pruning);
+PG_FUNCTION_INFO_V1(microbenchmark_deparse);
+
+
+/*
+ * microbenchmark_planner measures planning the given query through the
+ * planner hook, which includes distributed_planner.
+ */
+Datum
+microbenchmark_planner(PG_FUNCTION_ARGS)
+{
+	return RunMicrobenchmark(fcinfo, MICROBENCHMARK_PLANNER);
+}
+
+
+/*
+ * microbenchmark_fast_path_router measures deciding whether the given query
+ * is a fast path router query.
+ */
+Datum
+microbenchmark_fast_path_router(PG_FUNCTION_ARGS)
+{
+	return RunMicrobenchmark(fcinfo, MICROBENCHMARK_FAST_PATH_ROUTER);
+}
+
+
+/*
+ * microbenchmark_shard_pruning measures pruning the shards of the single
+ * distributed table in the given query using its WHERE clause.
+ */
+Datum
+microbenchmark_shard_pruning(PG_FUNCTION_ARGS)
+{
+	return RunMicrobenchmark(fcinfo, MICROBENCHMARK_SHARD_PRUNING);
+}
+
+
+/*
+ * microbenchmark_deparse measures deparsing the given query back into a
+ * query string.
+ */
+Datum
+microbenchmark_deparse(PG_FUNCTION_ARGS)
+{
+	return RunMicrobenchmark(fcinfo, MICROBENCHMARK_DEPARSE);
+}
+
+
+/*
+ * RunMicrobenchmark parses the query in the first argument and runs the given
+ * step on a copy of it as many times as the second argument says. It returns
+ * a record with the average duration in nanoseconds and the average number of
+ * bytes of memory allocated per run.
+ *
+ * Every run happens in a memory context that is reset afterwards, so that
+ * the memory usage of one run does not affect the next one. The first run is
+ * not measured, since it populates the metadata cache.
+ */
+static Datum
+RunMicrobenchmark(FunctionCallInfo fcinfo, MicrobenchmarkStep step)
+{
+	char *queryString = text_to_cstring(PG_GETARG_TEXT_P(0));
+	int iterationCount = PG_GETARG_INT32(1);
+
+	if (iterationCount <= 0)
+	{
+		ereport(ERROR, (errmsg("number of iterations must be positive")));
+	}
+
+	TupleDesc tupleDescriptor = NULL;
+	if (get_call_result_type(fcinfo, NULL, &tupleDescriptor) != TYPEFUNC_COMPOSITE)
+	{
+		elog(ERROR, "return type must be a row type");
+	}
+
+	Query *query = ParseSingleQuery(queryString);
+
+	MemoryContext microbenchmarkContext =
+		AllocSetContextCreate(CurrentMemoryContext, "Microbenchmark Context",
+							  ALLOCSET_DEFAULT_SIZES);
+	MemoryContext oldContext = MemoryContextSwitchTo(microbenchmarkContext);
+
+	RunMicrobenchmarkStep(step, copyObject(query), queryString);
+	MemoryContextReset(microbenchmarkContext);
+
+	Size baselineBytes = MemoryContextMemAllocated(microbenchmarkContext, true);
+	uint64 totalAllocatedBytes = 0;
+	double totalSeconds = 0.0;
+
+	for (int iteration = 0; iteration < iterationCount; iteration++)
+	{
+		Query *queryCopy = copyObject(query);
+		Size copyBytes = MemoryContextMemAllocated(microbenchmarkContext, true);
+
+		instr_time startTime;
+		instr_time duration;
+
+		INSTR_TIME_SET_CURRENT(startTime);
+
+		RunMicrobenchmarkStep(step, queryCopy, queryString);
+
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, startTime);
+
+		totalSeconds += INSTR_TIME_GET_DOUBLE(duration);
+		totalAllocatedBytes += MemoryContextMemAllocated(microbenchmarkContext, true) -
+							   Max(copyBytes, baselineBytes);
+
+		MemoryContextReset(microbenchmarkContext);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	MemoryContextDelete(microbenchmarkContext);
+
+	Datum values[2];
+	bool isNulls[2] = { false, false };
+
+	values[0] = Float8GetDatum(totalSeconds * 1e9 / iterationCount);
+	values[1] = Int64GetDatum(totalAllocatedBytes / iterationCount);
+
+	HeapTuple tuple = heap_form_tuple(tupleDescriptor, values, isNulls);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+
+/*
+ * ParseSingleQuery parses and analyzes the given query string, which should
+ * contain exactly one query.
+ */
+static Query *
+ParseSingleQuery(char *queryString)
+{
+	List *parseTreeList = pg_parse_query(queryString);
+	if (list_length(parseTreeList) != 1)
+	{
+		ereport(ERROR, (errmsg("query string must contain a single query")));
+	}
+
+	List *queryTreeList =
+		pg_analyze_and_rewrite_fixedparams(linitial(parseTreeList), queryString,
+										   NULL, 0, NULL);
+	if (list_length(queryTreeList) != 1)
+	{
+		ereport(ERROR, (errmsg("query must not be rewritten into multiple queries")));
+	}
+
+	Query *query = linitial(queryTreeList);
+	if (query->commandType == CMD_UTILITY)
+	{
+		ereport(ERROR, (errmsg("utility commands are not supported")));
+	}
+
+	return query;
+}
+
+
+/*
+ * RunMicrobenchmarkStep runs the given step once on the query, which it may
+ * modify.
+ */
+static void
+RunMicrobenchmarkStep(MicrobenchmarkStep step, Query *query, char *queryString)
+{
+	switch (step)
+	{
+		case MICROBENCHMARK_PLANNER:
+		{
+			planner(query, queryString, CURSOR_OPT_PARALLEL_OK, NULL);
+			break;
+		}
+
+		case MICROBENCHMARK_FAST_PATH_ROUTER:
+		{
+			Node *distributionKeyValue = NULL;
+			FastPathRouterQuery(query, &distributionKeyValue);
+			break;
+		}
+
+		case MICROBENCHMARK_SHARD_PRUNING:
+		{
+			if (list_length(query->rtable) != 1)
+			{
+				ereport(ERROR, (errmsg("shard pruning needs a query on a single "
+									   "table")));
+			}
+
+			RangeTblEntry *rangeTableEntry = linitial(query->rtable);
+			if (rangeTableEntry->rtekind != RTE_RELATION ||
+				!IsCitusTable(rangeTableEntry->relid))
+			{
+				ereport(ERROR, (errmsg("shard pruning needs a query on a "
+									   "distributed table")));
+			}
+
+			Node *quals = query->jointree->quals;
+			List *whereClauseList = make_ands_implicit((Expr *) quals);
+
+			PruneShards(rangeTableEntry->relid, 1, whereClauseList, NULL);
+			break;
+		}
+
+		case MICROBENCHMARK_DEPARSE:
+		{
+			StringInfo queryStringBuffer = makeStringInfo();
+			pg_get_query_def(query, queryStringBuffer);
+			break;
+		}
+	}
+}
@@ -48,6 +48,7 @@ static ArrayType * PlacementUpdateListToJsonArray(List *placementUpdateList);
 static bool ShardAllowedOnNode(uint64 shardId, WorkerNode *workerNode, void *context);
 static float NodeCapacity(WorkerNode *workerNode, void *context);
 static ShardCost GetShardCost(uint64 shardId, void *context);
+static float4 GetShardLoad(uint64 shardId, void *context);
 
 
 PG_FUNCTION_INFO_V1(shard_placement_rebalance_array);
@@ -59,6 +60,7 @@ typedef struct ShardPlacementTestInfo
 {
 	ShardPlacement *placement;
 	uint64 cost;
+	uint64 load;
 	bool nextColocationGroup;
 } ShardPlacementTestInfo;
 
@@ -136,6 +138,12 @@ shard_placement_rebalance_array(PG_FUNCTION_ARGS)
 	/* map shardPlacementTestInfoList to a list of list of its ShardPlacements */
 	foreach_ptr(shardPlacementTestInfo, context.shardPlacementTestInfoList)
 	{
+		/* only balance the query load when the test gives one */
+		if (shardPlacementTestInfo->load > 0)
+		{
+			rebalancePlanFunctions.shardLoad = GetShardLoad;
+		}
+
 		if (shardPlacementTestInfo->nextColocationGroup)
 		{
 			shardPlacementList = SortList(shardPlacementList, CompareShardPlacements);
@@ -264,6 +272,27 @@ GetShardCost(uint64 shardId, void *voidContext)
 }
 
 
+/*
+ * GetShardLoad is the function that gets the query load of a shard when
+ * running the shard rebalancer unit tests.
+ */
+static float4
+GetShardLoad(uint64 shardId, void *voidContext)
+{
+	RebalancePlacementContext *context = voidContext;
+	ShardPlacementTestInfo *shardPlacementTestInfo = NULL;
+	foreach_ptr(shardPlacementTestInfo, context->shardPlacementTestInfoList)
+	{
+		if (shardPlacementTestInfo->placement->shardId == shardId)
+		{
+			break;
+		}
+	}
+	Assert(shardPlacementTestInfo != NULL);
+	return shardPlacementTestInfo->load;
+}
+
+
 /*
  * shard_placement_replication_array returns a list of operations which will
  * replicate under-replicated shards in a cluster consisting of given shard
@@ -375,6 +404,7 @@ JsonArrayToShardPlacementTestInfoList(ArrayType *shardPlacementJsonArrayObject)
 			placementJson, FIELD_NAME_PLACEMENT_ID, placementIndex + 1);
 
 		uint64 cost = JsonFieldValueUInt64Default(placementJson, "cost", 1);
+		uint64 load = JsonFieldValueUInt64Default(placementJson, "load", 0);
 		bool nextColocationGroup =
 			JsonFieldValueBoolDefault(placementJson, "next_colocation", false);
 
@@ -387,6 +417,7 @@ JsonArrayToShardPlacementTestInfoList(ArrayType *shardPlacementJsonArrayObject)
 		placementTestInfo->placement->nodePort = nodePort;
 		placementTestInfo->placement->placementId = placementId;
 		placementTestInfo->cost = cost;
+		placementTestInfo->load = load;
 		placementTestInfo->nextColocationGroup = nextColocationGroup;
 
 		/*
@@ -107,9 +107,11 @@ static const CitusBackendType CitusBackendTypes[] = {
 
 static void StoreAllActiveTransactions(Tuplestorestate *tupleStore, TupleDesc
 									   tupleDescriptor);
-static bool UserHasPermissionToViewStatsOf(Oid currentUserId, Oid backendOwnedId);
 static uint64 CalculateGlobalPID(int32 nodeId, pid_t pid);
 static uint64 GenerateGlobalPID(void);
+static inline void BeginBackendDataWrite(BackendData *backendData);
+static inline void EndBackendDataWrite(BackendData *backendData);
+static void ReadBackendDataSnapshot(BackendData *backendData, BackendData *result);
 
 static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 static BackendManagementShmemData *backendManagementShmemData = NULL;
@@ -158,12 +160,12 @@ assign_distributed_transaction_id(PG_FUNCTION_ARGS)
 	 * initiator node, which already takes the required lock to enforce the consistency.
 	 */
 
-	SpinLockAcquire(&MyBackendData->mutex);
+	BeginBackendDataWrite(MyBackendData);
 
 	/* if an id is already assigned, release the lock and error */
 	if (MyBackendData->transactionId.transactionNumber != 0)
 	{
-		SpinLockRelease(&MyBackendData->mutex);
+		EndBackendDataWrite(MyBackendData);
 
 		ereport(ERROR, (errmsg("the backend has already been assigned a "
 							   "transaction id")));
@@ -174,7 +176,7 @@ assign_distributed_transaction_id(PG_FUNCTION_ARGS)
 	MyBackendData->transactionId.timestamp = timestamp;
 	MyBackendData->transactionId.transactionOriginator = false;
 
-	SpinLockRelease(&MyBackendData->mutex);
+	EndBackendDataWrite(MyBackendData);
 
 	PG_RETURN_VOID();
 }
@@ -397,15 +399,13 @@ StoreAllActiveTransactions(Tuplestorestate *tupleStore, TupleDesc tupleDescripto
 			&backendManagementShmemData->backends[backendIndex];
 		PGPROC *currentProc = GetPGProcByNumber(backendIndex);
 
-		/* to work on data after releasing g spinlock to protect against errors */
-		uint64 transactionNumber = 0;
-
-		SpinLockAcquire(&currentBackend->mutex);
+		/* read a consistent copy without blocking the backend */
+		BackendData currentBackendData;
+		ReadBackendDataSnapshot(currentBackend, &currentBackendData);
 
-		if (currentProc->pid == 0 || !currentBackend->activeBackend)
+		if (currentProc->pid == 0 || !currentBackendData.activeBackend)
 		{
 			/* unused PGPROC slot or the backend already exited */
-			SpinLockRelease(&currentBackend->mutex);
 			continue;
 		}
 
@@ -419,7 +419,7 @@ StoreAllActiveTransactions(Tuplestorestate *tupleStore, TupleDesc tupleDescripto
 			showCurrentBackendDetails = true;
 		}
 
-		Oid databaseId = currentBackend->databaseId;
+		Oid databaseId = currentBackendData.databaseId;
 		int backendPid = GetPGProcByNumber(backendIndex)->pid;
 
 		/*
@@ -428,12 +428,10 @@ StoreAllActiveTransactions(Tuplestorestate *tupleStore, TupleDesc tupleDescripto
 		 * we negate the result before returning.
 		 */
 		bool distributedCommandOriginator =
-			currentBackend->distributedCommandOriginator;
+			currentBackendData.distributedCommandOriginator;
 
-		transactionNumber = currentBackend->transactionId.transactionNumber;
-		TimestampTz transactionIdTimestamp = currentBackend->transactionId.timestamp;
-
-		SpinLockRelease(&currentBackend->mutex);
+		uint64 transactionNumber = currentBackendData.transactionId.transactionNumber;
+		TimestampTz transactionIdTimestamp = currentBackendData.transactionId.timestamp;
 
 		memset(values, 0, sizeof(values));
 		memset(isNulls, false, sizeof(isNulls));
@@ -451,7 +449,7 @@ StoreAllActiveTransactions(Tuplestorestate *tupleStore, TupleDesc tupleDescripto
 		{
 			bool missingOk = true;
 			int initiatorNodeId =
-				ExtractNodeIdFromGlobalPID(currentBackend->globalPID, missingOk);
+				ExtractNodeIdFromGlobalPID(currentBackendData.globalPID, missingOk);
 
 			values[0] = ObjectIdGetDatum(databaseId);
 			values[1] = Int32GetDatum(backendPid);
@@ -459,7 +457,7 @@ StoreAllActiveTransactions(Tuplestorestate *tupleStore, TupleDesc tupleDescripto
 			values[3] = !distributedCommandOriginator;
 			values[4] = UInt64GetDatum(transactionNumber);
 			values[5] = TimestampTzGetDatum(transactionIdTimestamp);
-			values[6] = UInt64GetDatum(currentBackend->globalPID);
+			values[6] = UInt64GetDatum(currentBackendData.globalPID);
 		}
 		else
 		{
@@ -469,7 +467,7 @@ StoreAllActiveTransactions(Tuplestorestate *tupleStore, TupleDesc tupleDescripto
 			values[3] = !distributedCommandOriginator;
 			isNulls[4] = true;
 			isNulls[5] = true;
-			values[6] = UInt64GetDatum(currentBackend->globalPID);
+			values[6] = UInt64GetDatum(currentBackendData.globalPID);
 		}
 
 		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
@@ -493,7 +491,6 @@ StoreAllActiveTransactions(Tuplestorestate *tupleStore, TupleDesc tupleDescripto
  *
  * We follow the same approach with pg_stat_activity.
  */
-static
 bool
 UserHasPermissionToViewStatsOf(Oid currentUserId, Oid backendOwnedId)
 {
@@ -590,6 +587,7 @@ BackendManagementShmemInit(void)
 			BackendData *backendData =
 				&backendManagementShmemData->backends[backendIndex];
 			SpinLockInit(&backendData->mutex);
+			pg_atomic_init_u32(&backendData->changeCount, 0);
 		}
 	}
 
@@ -710,10 +708,10 @@ InitializeBackendData(const char *applicationName)
 	UnSetDistributedTransactionId();
 	UnSetGlobalPID();
 
-	SpinLockAcquire(&MyBackendData->mutex);
+	BeginBackendDataWrite(MyBackendData);
 	MyBackendData->distributedCommandOriginator = IsExternalClientBackend();
 	MyBackendData->globalPID = gpid;
-	SpinLockRelease(&MyBackendData->mutex);
+	EndBackendDataWrite(MyBackendData);
 
 	/*
 	 * Signal that this backend is active and should show up
@@ -735,7 +733,7 @@ UnSetDistributedTransactionId(void)
 	/* backend does not exist if the extension is not created */
 	if (MyBackendData)
 	{
-		SpinLockAcquire(&MyBackendData->mutex);
+		BeginBackendDataWrite(MyBackendData);
 
 		MyBackendData->cancelledDueToDeadlock = false;
 		MyBackendData->transactionId.initiatorNodeIdentifier = 0;
@@ -743,7 +741,7 @@ UnSetDistributedTransactionId(void)
 		MyBackendData->transactionId.transactionNumber = 0;
 		MyBackendData->transactionId.timestamp = 0;
 
-		SpinLockRelease(&MyBackendData->mutex);
+		EndBackendDataWrite(MyBackendData);
 	}
 }
 
@@ -757,13 +755,13 @@ UnSetGlobalPID(void)
 	/* backend does not exist if the extension is not created */
 	if (MyBackendData)
 	{
-		SpinLockAcquire(&MyBackendData->mutex);
+		BeginBackendDataWrite(MyBackendData);
 
 		MyBackendData->globalPID = 0;
 		MyBackendData->databaseId = 0;
 		MyBackendData->distributedCommandOriginator = false;
 
-		SpinLockRelease(&MyBackendData->mutex);
+		EndBackendDataWrite(MyBackendData);
 	}
 }
 
@@ -777,11 +775,11 @@ SetActiveMyBackend(bool value)
 	/* backend does not exist if the extension is not created */
 	if (MyBackendData)
 	{
-		SpinLockAcquire(&MyBackendData->mutex);
+		BeginBackendDataWrite(MyBackendData);
 
 		MyBackendData->activeBackend = value;
 
-		SpinLockRelease(&MyBackendData->mutex);
+		EndBackendDataWrite(MyBackendData);
 	}
 }
 
@@ -862,14 +860,14 @@ AssignDistributedTransactionId(void)
 	int32 localGroupId = GetLocalGroupId();
 	TimestampTz currentTimestamp = GetCurrentTimestamp();
 
-	SpinLockAcquire(&MyBackendData->mutex);
+	BeginBackendDataWrite(MyBackendData);
 
 	MyBackendData->transactionId.initiatorNodeIdentifier = localGroupId;
 	MyBackendData->transactionId.transactionOriginator = true;
 	MyBackendData->transactionId.transactionNumber = nextTransactionNumber;
 	MyBackendData->transactionId.timestamp = currentTimestamp;
 
-	SpinLockRelease(&MyBackendData->mutex);
+	EndBackendDataWrite(MyBackendData);
 }
 
 
@@ -909,7 +907,7 @@ AssignGlobalPID(const char *applicationName)
 		globalPID = ExtractGlobalPID(applicationName);
 	}
 
-	SpinLockAcquire(&MyBackendData->mutex);
+	BeginBackendDataWrite(MyBackendData);
 
 	/*
 	 * Skip updating globalpid when we were a command originator and still are
@@ -923,7 +921,7 @@ AssignGlobalPID(const char *applicationName)
 		MyBackendData->globalPID = globalPID;
 		MyBackendData->distributedCommandOriginator = distributedCommandOriginator;
 	}
-	SpinLockRelease(&MyBackendData->mutex);
+	EndBackendDataWrite(MyBackendData);
 }
 
 
@@ -937,9 +935,9 @@ void
 SetBackendDataDatabaseId(void)
 {
 	Assert(MyDatabaseId != InvalidOid);
-	SpinLockAcquire(&MyBackendData->mutex);
+	BeginBackendDataWrite(MyBackendData);
 	MyBackendData->databaseId = MyDatabaseId;
-	SpinLockRelease(&MyBackendData->mutex);
+	EndBackendDataWrite(MyBackendData);
 }
 
 
@@ -958,9 +956,9 @@ SetBackendDataGlobalPID(uint64 gpid)
 	{
 		return;
 	}
-	SpinLockAcquire(&MyBackendData->mutex);
+	BeginBackendDataWrite(MyBackendData);
 	MyBackendData->globalPID = gpid;
-	SpinLockRelease(&MyBackendData->mutex);
+	EndBackendDataWrite(MyBackendData);
 }
 
 
@@ -1183,14 +1181,73 @@ GetBackendDataForProc(PGPROC *proc, BackendData *result)
 
 	BackendData *backendData = &backendManagementShmemData->backends[pgprocno];
 
+	ReadBackendDataSnapshot(backendData, result);
+}
+
+
+/*
+ * BeginBackendDataWrite starts modifying the given backend data. Writers
+ * serialize on the spinlock, and make the change count odd while they modify
+ * the backend data, such that readers can detect concurrent changes without
+ * taking the spinlock.
+ */
+static inline void
+BeginBackendDataWrite(BackendData *backendData)
+{
 	SpinLockAcquire(&backendData->mutex);
 
-	*result = *backendData;
+	/* full memory barrier, the change is not visible before the count is odd */
+	pg_atomic_fetch_add_u32(&backendData->changeCount, 1);
+}
+
+
+/*
+ * EndBackendDataWrite finishes modifying the given backend data.
+ */
+static inline void
+EndBackendDataWrite(BackendData *backendData)
+{
+	/* full memory barrier, the change is visible before the count is even */
+	pg_atomic_fetch_add_u32(&backendData->changeCount, 1);
 
 	SpinLockRelease(&backendData->mutex);
 }
 
 
+/*
+ * ReadBackendDataSnapshot copies the given backend data into result without
+ * taking its spinlock, such that monitoring functions that read all backends
+ * never block a backend that is assigning or resetting its transaction id.
+ *
+ * The copy is retried until the change count was even and unchanged while
+ * copying, which means no write happened in between. Writes finish quickly
+ * and never wait for anything, so retries are rare and short.
+ */
+static void
+ReadBackendDataSnapshot(BackendData *backendData, BackendData *result)
+{
+	for (;;)
+	{
+		uint32 changeCountBefore = pg_atomic_read_u32(&backendData->changeCount);
+
+		pg_read_barrier();
+
+		*result = *backendData;
+
+		pg_read_barrier();
+
+		uint32 changeCountAfter = pg_atomic_read_u32(&backendData->changeCount);
+
+		if (changeCountBefore == changeCountAfter && (changeCountBefore & 1) == 0)
+		{
+			break;
+		}
+
+		pg_spin_delay();
+	}
+}
+
+
 /*
  * CancelTransactionDueToDeadlock cancels the input proc and also marks the backend
  * data with this information.
@@ -1206,13 +1263,13 @@ CancelTransactionDueToDeadlock(PGPROC *proc)
 		return;
 	}
 
-	SpinLockAcquire(&backendData->mutex);
+	BeginBackendDataWrite(backendData);
 
 	/* send a SIGINT only if the process is still in a distributed transaction */
 	if (backendData->transactionId.transactionNumber != 0)
 	{
 		backendData->cancelledDueToDeadlock = true;
-		SpinLockRelease(&backendData->mutex);
+		EndBackendDataWrite(backendData);
 
 		if (kill(proc->pid, SIGINT) != 0)
 		{
@@ -1224,7 +1281,7 @@ CancelTransactionDueToDeadlock(PGPROC *proc)
 	}
 	else
 	{
-		SpinLockRelease(&backendData->mutex);
+		EndBackendDataWrite(backendData);
 	}
 }
 
@@ -1249,7 +1306,7 @@ MyBackendGotCancelledDueToDeadlock(bool clearState)
 		return false;
 	}
 
-	SpinLockAcquire(&MyBackendData->mutex);
+	BeginBackendDataWrite(MyBackendData);
 
 	if (IsInDistributedTransaction(MyBackendData))
 	{
@@ -1260,7 +1317,7 @@ MyBackendGotCancelledDueToDeadlock(bool clearState)
 		MyBackendData->cancelledDueToDeadlock = false;
 	}
 
-	SpinLockRelease(&MyBackendData->mutex);
+	EndBackendDataWrite(MyBackendData);
 
 	return cancelledDueToDeadlock;
 }
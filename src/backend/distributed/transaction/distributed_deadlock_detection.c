@@ -39,6 +39,15 @@ typedef struct QueuedTransactionNode
 } QueuedTransactionNode;
 
 
+/* used only for finding the strongly connected components of the wait graph */
+typedef struct ComponentSearchFrame
+{
+	TransactionNode *transactionNode;
+
+	int nextWaitsForIndex;
+} ComponentSearchFrame;
+
+
 /* GUC, determining whether debug messages for deadlock detection sent to LOG */
 bool LogDistributedDeadlockDetection = false;
 
@@ -52,7 +61,12 @@ static void PrependOutgoingNodesToQueue(TransactionNode *queuedTransactionNode,
 static void BuildDeadlockPathList(QueuedTransactionNode *cycledTransactionNode,
 								  TransactionNode **transactionNodeStack,
 								  List **deadlockPath);
-static void ResetVisitedFields(HTAB *adjacencyList);
+static List ** FindStronglyConnectedComponents(HTAB *adjacencyList);
+static void PushComponentSearchFrame(TransactionNode *transactionNode, int *nextIndex,
+									 ComponentSearchFrame *frameStack, int *frameCount,
+									 TransactionNode **componentStack,
+									 int *componentStackSize);
+static void ResetVisitedFields(List *componentMembers);
 static bool AssociateDistributedTransactionWithBackendProc(TransactionNode *
 														   transactionNode);
 static TransactionNode * GetOrCreateTransactionNode(HTAB *adjacencyList,
@@ -94,9 +108,17 @@ check_distributed_deadlocks(PG_FUNCTION_ARGS)
  * distributed deadlock. Upon finding a deadlock, the youngest
  * participant backend is cancelled.
  *
+ * Any cycle lies entirely within a strongly connected component of the
+ * graph, so the components are computed once upfront (Tarjan's algorithm,
+ * O(N + E)). The DFS then only starts from transactions in components
+ * that contain a cycle, and never leaves the component of its starting
+ * transaction. Hence, the many transactions that merely wait on a lock
+ * without being part of a cycle do not add to the cost of the search.
+ *
  * The complexity of the algorithm is O(N) for each distributed
- * transaction that's checked for deadlocks. Note that there exists
- *  0 to MaxBackends number of transactions.
+ * transaction that's checked for deadlocks, where N is the size of the
+ * component of the transaction. Note that there exists 0 to
+ * MaxBackends number of transactions.
  *
  * The function returns true if a deadlock is found. Otherwise, returns
  * false.
@@ -124,6 +146,7 @@ CheckForDistributedDeadlocks(void)
 	bool onlyDistributedTx = true;
 	WaitGraph *waitGraph = BuildGlobalWaitGraph(onlyDistributedTx);
 	HTAB *adjacencyLists = BuildAdjacencyListsForWaitGraph(waitGraph);
+	List **componentMembers = FindStronglyConnectedComponents(adjacencyLists);
 
 	int edgeCount = waitGraph->edgeCount;
 
@@ -148,7 +171,13 @@ CheckForDistributedDeadlocks(void)
 			continue;
 		}
 
-		ResetVisitedFields(adjacencyLists);
+		/* a transaction outside of a cycle cannot be part of a deadlock */
+		if (!transactionNode->inCyclicComponent)
+		{
+			continue;
+		}
+
+		ResetVisitedFields(componentMembers[transactionNode->componentId]);
 
 		bool deadlockFound = CheckDeadlockForTransactionNode(transactionNode,
 															 maxStackDepth,
@@ -294,7 +323,8 @@ CheckDeadlockForTransactionNode(TransactionNode *startingTransactionNode,
 
 /*
  * PrependOutgoingNodesToQueue prepends the waiters of the input transaction nodes to the
- * toBeVisitedNodes.
+ * toBeVisitedNodes. Waiters in other components are skipped, since they cannot lead
+ * back to the transaction node.
  */
 static void
 PrependOutgoingNodesToQueue(TransactionNode *transactionNode, int currentStackDepth,
@@ -307,6 +337,11 @@ PrependOutgoingNodesToQueue(TransactionNode *transactionNode, int currentStackDe
 	TransactionNode *waitForTransaction = NULL;
 	foreach_ptr(waitForTransaction, transactionNode->waitsFor)
 	{
+		if (waitForTransaction->componentId != transactionNode->componentId)
+		{
+			continue;
+		}
+
 		QueuedTransactionNode *queuedNode = palloc0(sizeof(QueuedTransactionNode));
 
 		queuedNode->transactionNode = waitForTransaction;
@@ -338,19 +373,151 @@ BuildDeadlockPathList(QueuedTransactionNode *cycledTransactionNode,
 
 
 /*
- * ResetVisitedFields goes over all the elements of the input adjacency list
- * and sets transactionVisited to false.
+ * FindStronglyConnectedComponents finds the strongly connected components of
+ * the wait graph using Tarjan's algorithm. The componentId and
+ * inCyclicComponent fields of all the transaction nodes are set, and the
+ * function returns an array with the list of transaction nodes of each
+ * component, indexed by componentId.
+ *
+ * The search is iterative rather than recursive, since the wait graph can
+ * have as many transactions as there are backends in the cluster.
  */
-static void
-ResetVisitedFields(HTAB *adjacencyList)
+static List **
+FindStronglyConnectedComponents(HTAB *adjacencyList)
 {
 	HASH_SEQ_STATUS status;
-	TransactionNode *resetNode = NULL;
+	TransactionNode *transactionNode = NULL;
+	long transactionCount = hash_get_num_entries(adjacencyList);
+	int nextIndex = 0;
+	int componentCount = 0;
+
+	List **componentMembers = palloc0(Max(transactionCount, 1) * sizeof(List *));
+	ComponentSearchFrame *frameStack =
+		palloc0(Max(transactionCount, 1) * sizeof(ComponentSearchFrame));
+	TransactionNode **componentStack =
+		palloc0(Max(transactionCount, 1) * sizeof(TransactionNode *));
+	int componentStackSize = 0;
 
-	/* reset all visited fields */
 	hash_seq_init(&status, adjacencyList);
+	while ((transactionNode = (TransactionNode *) hash_seq_search(&status)) != 0)
+	{
+		int frameCount = 0;
 
-	while ((resetNode = (TransactionNode *) hash_seq_search(&status)) != 0)
+		if (transactionNode->componentIndex >= 0)
+		{
+			/* already part of a component */
+			continue;
+		}
+
+		PushComponentSearchFrame(transactionNode, &nextIndex, frameStack, &frameCount,
+								 componentStack, &componentStackSize);
+
+		while (frameCount > 0)
+		{
+			ComponentSearchFrame *frame = &frameStack[frameCount - 1];
+			TransactionNode *currentNode = frame->transactionNode;
+
+			if (frame->nextWaitsForIndex < list_length(currentNode->waitsFor))
+			{
+				TransactionNode *waitForTransaction =
+					list_nth(currentNode->waitsFor, frame->nextWaitsForIndex);
+
+				frame->nextWaitsForIndex++;
+
+				if (waitForTransaction->componentIndex < 0)
+				{
+					PushComponentSearchFrame(waitForTransaction, &nextIndex,
+											 frameStack, &frameCount,
+											 componentStack, &componentStackSize);
+				}
+				else if (waitForTransaction->onComponentStack)
+				{
+					currentNode->componentLowLink =
+						Min(currentNode->componentLowLink,
+							waitForTransaction->componentIndex);
+				}
+
+				continue;
+			}
+
+			/* all waiters are visited, pop the component if this is its root */
+			if (currentNode->componentLowLink == currentNode->componentIndex)
+			{
+				List *members = NIL;
+				TransactionNode *memberNode = NULL;
+
+				do {
+					memberNode = componentStack[--componentStackSize];
+					memberNode->onComponentStack = false;
+					memberNode->componentId = componentCount;
+					members = lappend(members, memberNode);
+				} while (memberNode != currentNode);
+
+				/* a single transaction only forms a cycle when it waits for itself */
+				bool inCyclicComponent = list_length(members) > 1 ||
+										 list_member_ptr(currentNode->waitsFor,
+														 currentNode);
+
+				foreach_ptr(memberNode, members)
+				{
+					memberNode->inCyclicComponent = inCyclicComponent;
+				}
+
+				componentMembers[componentCount] = members;
+				componentCount++;
+			}
+
+			frameCount--;
+
+			if (frameCount > 0)
+			{
+				TransactionNode *parentNode = frameStack[frameCount - 1].transactionNode;
+
+				parentNode->componentLowLink = Min(parentNode->componentLowLink,
+												   currentNode->componentLowLink);
+			}
+		}
+	}
+
+	pfree(frameStack);
+	pfree(componentStack);
+
+	return componentMembers;
+}
+
+
+/*
+ * PushComponentSearchFrame assigns the next index to the transaction node and
+ * pushes it to both the search stack and the component stack of Tarjan's
+ * algorithm.
+ */
+static void
+PushComponentSearchFrame(TransactionNode *transactionNode, int *nextIndex,
+						 ComponentSearchFrame *frameStack, int *frameCount,
+						 TransactionNode **componentStack, int *componentStackSize)
+{
+	transactionNode->componentIndex = *nextIndex;
+	transactionNode->componentLowLink = *nextIndex;
+	(*nextIndex)++;
+
+	transactionNode->onComponentStack = true;
+	componentStack[(*componentStackSize)++] = transactionNode;
+
+	frameStack[*frameCount].transactionNode = transactionNode;
+	frameStack[*frameCount].nextWaitsForIndex = 0;
+	(*frameCount)++;
+}
+
+
+/*
+ * ResetVisitedFields goes over all the transaction nodes of the input
+ * component and sets transactionVisited to false.
+ */
+static void
+ResetVisitedFields(List *componentMembers)
+{
+	TransactionNode *resetNode = NULL;
+	foreach_ptr(resetNode, componentMembers)
 	{
 		resetNode->transactionVisited = false;
 	}
@@ -509,6 +676,12 @@ GetOrCreateTransactionNode(HTAB *adjacencyList, DistributedTransactionId *transa
 	{
 		transactionNode->waitsFor = NIL;
 		transactionNode->initiatorProc = NULL;
+		transactionNode->transactionVisited = false;
+		transactionNode->componentId = -1;
+		transactionNode->inCyclicComponent = false;
+		transactionNode->componentIndex = -1;
+		transactionNode->componentLowLink = -1;
+		transactionNode->onComponentStack = false;
 	}
 
 	return transactionNode;
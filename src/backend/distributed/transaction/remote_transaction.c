@@ -113,6 +113,12 @@ char *SuperuserRole = NULL;
  */
 bool IsMainDBCommandInXact = true;
 
+/*
+ * GUC, time to wait for the replies to COMMIT PREPARED before leaving the
+ * remaining prepared transactions to recovery, or -1 to always wait
+ */
+int CommitPreparedTimeout = -1;
+
 
 /*
  * start_management_transaction starts a management transaction
@@ -776,15 +782,14 @@ StartRemoteTransactionPrepare(struct MultiConnection *connection)
 	/* can't prepare if already started to prepare/abort/commit */
 	Assert(transaction->transactionState < REMOTE_TRANS_PREPARING);
 
+	/*
+	 * The transaction record in pg_dist_transaction is logged by the caller
+	 * (CoordinatedRemoteTransactionsPrepare), for all participants at once.
+	 * The records only become visible when the local transaction commits,
+	 * after all PREPAREs finished, so the order does not matter.
+	 */
 	Assign2PCIdentifier(connection);
 
-	/* log transactions to workers in pg_dist_transaction */
-	WorkerNode *workerNode = FindWorkerNode(connection->hostname, connection->port);
-	if (workerNode != NULL)
-	{
-		LogTransactionRecord(workerNode->groupId, transaction->preparedName, OuterXid);
-	}
-
 	/*
 	 * We need to allocate 424 bytes for command buffer (including '\0'):
 	 *  - len("PREPARE TRANSACTION ") = 20
@@ -1060,6 +1065,8 @@ CoordinatedRemoteTransactionsPrepare(void)
 {
 	dlist_iter iter;
 	List *connectionList = NIL;
+	List *transactionGroupIdList = NIL;
+	List *transactionNameList = NIL;
 
 	/* issue PREPARE TRANSACTION; to all relevant remote nodes */
 
@@ -1087,9 +1094,22 @@ CoordinatedRemoteTransactionsPrepare(void)
 		{
 			StartRemoteTransactionPrepare(connection);
 			connectionList = lappend(connectionList, connection);
+
+			WorkerNode *workerNode = FindWorkerNode(connection->hostname,
+													connection->port);
+			if (workerNode != NULL)
+			{
+				transactionGroupIdList = lappend_int(transactionGroupIdList,
+													 workerNode->groupId);
+				transactionNameList = lappend(transactionNameList,
+											  transaction->preparedName);
+			}
 		}
 	}
 
+	/* log transactions to workers in pg_dist_transaction while they prepare */
+	LogTransactionRecordList(transactionGroupIdList, transactionNameList, OuterXid);
+
 	bool raiseInterrupts = true;
 	WaitForAllConnections(connectionList, raiseInterrupts);
 
@@ -1120,6 +1140,33 @@ CoordinatedRemoteTransactionsPrepare(void)
 }
 
 
+/*
+ * CountModifyingRemoteTransactions returns the number of connections
+ * participating in the coordinated transaction over which any DML or DDL
+ * was executed, i.e. the connections that CoordinatedRemoteTransactionsPrepare
+ * would PREPARE.
+ */
+int
+CountModifyingRemoteTransactions(void)
+{
+	dlist_iter iter;
+	int modifyingTransactionCount = 0;
+
+	dlist_foreach(iter, &InProgressTransactions)
+	{
+		MultiConnection *connection = dlist_container(MultiConnection, transactionNode,
+													  iter.cur);
+
+		if (ConnectionModifiedPlacement(connection))
+		{
+			modifyingTransactionCount++;
+		}
+	}
+
+	return modifyingTransactionCount;
+}
+
+
 /*
  * CoordinatedRemoteTransactionsCommit performs distributed transactions
  * handling at commit time. This will be called at XACT_EVENT_PRE_COMMIT if
@@ -1133,6 +1180,7 @@ CoordinatedRemoteTransactionsCommit(void)
 {
 	dlist_iter iter;
 	List *connectionList = NIL;
+	bool onlyCommitPrepared = true;
 
 	/*
 	 * Issue appropriate transaction commands to remote nodes. If everything
@@ -1158,10 +1206,23 @@ CoordinatedRemoteTransactionsCommit(void)
 
 		StartRemoteTransactionCommit(connection);
 		connectionList = lappend(connectionList, connection);
+
+		if (transaction->transactionState != REMOTE_TRANS_2PC_COMMITTING)
+		{
+			onlyCommitPrepared = false;
+		}
 	}
 
+	/*
+	 * Once the transaction records are committed, committing the prepared
+	 * transactions is only a matter of time, since recovery finishes the
+	 * stragglers. Hence, we may stop waiting for slow nodes to reply to
+	 * COMMIT PREPARED, but not for any other command.
+	 */
+	long timeoutMs = onlyCommitPrepared ? CommitPreparedTimeout : -1;
+
 	bool raiseInterrupts = false;
-	WaitForAllConnections(connectionList, raiseInterrupts);
+	WaitForAllConnectionsWithTimeout(connectionList, raiseInterrupts, timeoutMs);
 
 	/* wait for the replies to the commands to come in */
 	dlist_foreach(iter, &InProgressTransactions)
@@ -1179,6 +1240,17 @@ CoordinatedRemoteTransactionsCommit(void)
 			continue;
 		}
 
+		if (timeoutMs >= 0 && PQstatus(connection->pgConn) == CONNECTION_OK &&
+			PQisBusy(connection->pgConn))
+		{
+			/*
+			 * COMMIT PREPARED did not finish in time. We do not wait for the
+			 * reply, and the connection is closed at the end of the transaction.
+			 */
+			connection->forceCloseAtTransactionEnd = true;
+			continue;
+		}
+
 		FinishRemoteTransactionCommit(connection);
 	}
 
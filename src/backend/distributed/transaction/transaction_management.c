@@ -35,6 +35,7 @@
 #include "distributed/distributed_planner.h"
 #include "distributed/function_call_delegation.h"
 #include "distributed/hash_helpers.h"
+#include "distributed/insert_buffer.h"
 #include "distributed/intermediate_results.h"
 #include "distributed/listutils.h"
 #include "distributed/local_executor.h"
@@ -46,16 +47,19 @@
 #include "distributed/multi_explain.h"
 #include "distributed/multi_logical_replication.h"
 #include "distributed/placement_connection.h"
+#include "distributed/query_result_cache.h"
 #include "distributed/relation_access_tracking.h"
 #include "distributed/remote_commands.h"
 #include "distributed/repartition_join_execution.h"
 #include "distributed/replication_origin_session_utils.h"
 #include "distributed/shard_cleaner.h"
 #include "distributed/shared_connection_stats.h"
+#include "distributed/shared_placement_cache.h"
 #include "distributed/subplan_execution.h"
 #include "distributed/transaction_management.h"
 #include "distributed/version_compat.h"
 #include "distributed/worker_log_messages.h"
+#include "distributed/worker_transaction.h"
 
 #define COMMIT_MANAGEMENT_COMMAND_2PC \
 	"SELECT citus_internal.commit_management_command_2pc()"
@@ -75,6 +79,9 @@ bool AllModificationsCommutative = false;
 /* we've deprecated this flag, keeping here for some time not to break existing users */
 bool EnableDeadlockPrevention = true;
 
+/* GUC, whether to commit in one phase when only a single node wrote */
+bool EnableOnePhaseCommit = false;
+
 /* number of nested stored procedure call levels we are currently in */
 int StoredProcedureLevel = 0;
 
@@ -165,6 +172,7 @@ static void PopSubXact(SubTransactionId subId, bool commit);
 static void ResetGlobalVariables(void);
 static bool SwallowErrors(void (*func)(void));
 static void ForceAllInProgressConnectionsToClose(void);
+static bool CoordinatedTransactionHasSingleWriter(void);
 static void EnsurePrepareTransactionIsAllowed(void);
 static HTAB * CurrentTransactionPropagatedObjects(bool readonly);
 static HTAB * ParentTransactionPropagatedObjects(bool readonly);
@@ -355,8 +363,15 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 				TriggerNodeMetadataSync(MyDatabaseId);
 			}
 
+			/* modifications are visible, so cached results on them are invalid */
+			QueryResultCacheTransactionCommitted();
+			SharedPlacementCacheTransactionCommitted();
+			ResetReusableSubPlanResults();
+
 			ResetGlobalVariables();
 			ResetRelationAccessHash();
+			ResetBufferedInserts();
+			ResetBufferedDDLPropagation();
 			ResetPropagatedObjects();
 
 			/*
@@ -430,6 +445,11 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 
 			ResetGlobalVariables();
 			ResetRelationAccessHash();
+			ResetQueryResultCacheModifications();
+			ResetSharedPlacementCacheModifications();
+			ResetReusableSubPlanResults();
+			ResetBufferedInserts();
+			ResetBufferedDDLPropagation();
 			ResetPropagatedObjects();
 
 			/* Reset any local replication origin session since transaction has been aborted.*/
@@ -492,6 +512,11 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 		{
 			/* we need to reset SavedExplainPlan before TopTransactionContext is deleted */
 			FreeSavedExplainPlan();
+			ResetQueryResultCacheModifications();
+			ResetSharedPlacementCacheModifications();
+			ResetReusableSubPlanResults();
+			ResetBufferedInserts();
+			ResetBufferedDDLPropagation();
 
 			/*
 			 * This callback is only relevant for worker queries since
@@ -512,6 +537,13 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 
 		case XACT_EVENT_PRE_COMMIT:
 		{
+			/*
+			 * Send the INSERTs and DDL commands that are still buffered, e.g.
+			 * when a procedure commits, before we commit the remote transactions.
+			 */
+			FlushBufferedInserts();
+			FlushBufferedDDLPropagation();
+
 			/*
 			 * If the distributed query involves 2PC, we already removed
 			 * the intermediate result directory on XACT_EVENT_PREPARE. However,
@@ -546,7 +578,8 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 			 * fails, which can lead to divergence when not using 2PC.
 			 */
 
-			if (ShouldCoordinatedTransactionUse2PC)
+			if (ShouldCoordinatedTransactionUse2PC &&
+				!CoordinatedTransactionHasSingleWriter())
 			{
 				CoordinatedRemoteTransactionsPrepare();
 				CurrentCoordinatedTransactionState = COORD_TRANS_PREPARED;
@@ -584,6 +617,8 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 		case XACT_EVENT_PARALLEL_PRE_COMMIT:
 		case XACT_EVENT_PRE_PREPARE:
 		{
+			FlushBufferedInserts();
+			FlushBufferedDDLPropagation();
 			EnsurePrepareTransactionIsAllowed();
 			break;
 		}
@@ -610,6 +645,35 @@ ForceAllInProgressConnectionsToClose(void)
 }
 
 
+/*
+ * CoordinatedTransactionHasSingleWriter returns true if citus.enable_one_phase_commit
+ * is enabled and at most one node wrote in the coordinated transaction, in which case
+ * there is no need for 2PC even if it was activated: the other participants only
+ * read, and committing them cannot fail in a way that needs to be undone.
+ *
+ * The local node counts as a writer once the transaction has been assigned a
+ * transaction id, which covers both local shard modifications and changes to the
+ * Citus metadata.
+ */
+static bool
+CoordinatedTransactionHasSingleWriter(void)
+{
+	if (!EnableOnePhaseCommit || !IsMainDB)
+	{
+		return false;
+	}
+
+	int writerCount = CountModifyingRemoteTransactions();
+
+	if (TransactionIdIsValid(GetTopTransactionIdIfAny()))
+	{
+		writerCount++;
+	}
+
+	return writerCount <= 1;
+}
+
+
 /*
  * If an ERROR is thrown while processing a transaction the ABORT handler is called.
  * ERRORS thrown during ABORT are not treated any differently, the ABORT handler is also
@@ -703,6 +767,14 @@ CoordinatedSubTransactionCallback(SubXactEvent event, SubTransactionId subId,
 		 */
 		case SUBXACT_EVENT_START_SUB:
 		{
+			/*
+			 * We do not buffer INSERTs and DDL commands in subtransactions, so
+			 * send the buffered ones before the savepoint, e.g. for exception
+			 * blocks in PL/pgSQL.
+			 */
+			FlushBufferedInserts();
+			FlushBufferedDDLPropagation();
+
 			MemoryContext previousContext =
 				MemoryContextSwitchTo(CitusXactCallbackContext);
 
@@ -762,6 +834,9 @@ CoordinatedSubTransactionCallback(SubXactEvent event, SubTransactionId subId,
 			}
 			PopSubXact(subId, false);
 
+			/* rolled back modifications may be reflected in reusable results */
+			ResetReusableSubPlanResults();
+
 			/*
 			 * Clear MetadataCache table if we're aborting from a CREATE EXTENSION Citus
 			 * so that any created OIDs from the table are cleared and invalidated. We
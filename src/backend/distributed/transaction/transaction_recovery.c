@@ -19,6 +19,7 @@
 
 #include "libpq-fe.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 
 #include "access/genam.h"
 #include "access/heapam.h"
@@ -27,6 +28,7 @@
 #include "access/xact.h"
 #include "catalog/indexing.h"
 #include "lib/stringinfo.h"
+#include "postmaster/bgworker.h"
 #include "storage/lmgr.h"
 #include "storage/lock.h"
 #include "storage/procarray.h"
@@ -40,8 +42,10 @@
 #include "pg_version_constants.h"
 
 #include "distributed/backend_data.h"
+#include "distributed/citus_safe_lib.h"
 #include "distributed/connection_management.h"
 #include "distributed/listutils.h"
+#include "distributed/maintenanced.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/pg_dist_transaction.h"
 #include "distributed/remote_commands.h"
@@ -86,26 +90,65 @@ recover_prepared_transactions(PG_FUNCTION_ARGS)
  */
 void
 LogTransactionRecord(int32 groupId, char *transactionName, FullTransactionId outerXid)
+{
+	LogTransactionRecordList(list_make1_int(groupId), list_make1(transactionName),
+							 outerXid);
+}
+
+
+/*
+ * LogTransactionRecordList registers the fact that transactions have been
+ * prepared on the workers of the given groups, where the n-th transaction
+ * name belongs to the n-th group id.
+ *
+ * All records of a 2PC are inserted at once, such that pg_dist_transaction
+ * and its indexes are only opened once and a single command counter
+ * increment is needed, rather than one for each participant.
+ */
+void
+LogTransactionRecordList(List *groupIdList, List *transactionNameList,
+						 FullTransactionId outerXid)
 {
 	Datum values[Natts_pg_dist_transaction];
 	bool isNulls[Natts_pg_dist_transaction];
 
-	/* form new transaction tuple */
-	memset(values, 0, sizeof(values));
-	memset(isNulls, false, sizeof(isNulls));
+	Assert(list_length(groupIdList) == list_length(transactionNameList));
 
-	values[Anum_pg_dist_transaction_groupid - 1] = Int32GetDatum(groupId);
-	values[Anum_pg_dist_transaction_gid - 1] = CStringGetTextDatum(transactionName);
-	values[Anum_pg_dist_transaction_outerxid - 1] = FullTransactionIdGetDatum(outerXid);
+	if (groupIdList == NIL)
+	{
+		return;
+	}
 
-	/* open transaction relation and insert new tuple */
+	/* open transaction relation and its indexes */
 	Relation pgDistTransaction = table_open(DistTransactionRelationId(),
 											RowExclusiveLock);
-
 	TupleDesc tupleDescriptor = RelationGetDescr(pgDistTransaction);
-	HeapTuple heapTuple = heap_form_tuple(tupleDescriptor, values, isNulls);
+	CatalogIndexState indexState = CatalogOpenIndexes(pgDistTransaction);
+
+	ListCell *groupIdCell = NULL;
+	ListCell *transactionNameCell = NULL;
+	forboth(groupIdCell, groupIdList, transactionNameCell, transactionNameList)
+	{
+		int32 groupId = lfirst_int(groupIdCell);
+		char *transactionName = (char *) lfirst(transactionNameCell);
 
-	CatalogTupleInsert(pgDistTransaction, heapTuple);
+		/* form new transaction tuple */
+		memset(values, 0, sizeof(values));
+		memset(isNulls, false, sizeof(isNulls));
+
+		values[Anum_pg_dist_transaction_groupid - 1] = Int32GetDatum(groupId);
+		values[Anum_pg_dist_transaction_gid - 1] = CStringGetTextDatum(transactionName);
+		values[Anum_pg_dist_transaction_outerxid - 1] =
+			FullTransactionIdGetDatum(outerXid);
+
+		HeapTuple heapTuple = heap_form_tuple(tupleDescriptor, values, isNulls);
+
+		CatalogTupleInsertWithInfo(pgDistTransaction, heapTuple, indexState);
+
+		heap_freetuple(heapTuple);
+	}
+
+	CatalogCloseIndexes(indexState);
 
 	CommandCounterIncrement();
 
@@ -137,6 +180,97 @@ RecoverTwoPhaseCommits(void)
 }
 
 
+/*
+ * TransactionRecoveryWorkerMain is the main function of the background worker
+ * that the maintenance daemon starts for a 2PC recovery pass, such that a slow
+ * pass over many nodes does not hold up its other duties. It makes a single
+ * pass and exits.
+ */
+void
+TransactionRecoveryWorkerMain(Datum main_arg)
+{
+	Oid databaseOid = DatumGetObjectId(main_arg);
+
+	/* extension owner is passed via bgw_extra */
+	Oid extensionOwner = InvalidOid;
+	memcpy_s(&extensionOwner, sizeof(extensionOwner),
+			 MyBgworkerEntry->bgw_extra, sizeof(Oid));
+
+	BackgroundWorkerUnblockSignals();
+
+	/* connect to database, after that we can actually access catalogs */
+	BackgroundWorkerInitializeConnectionByOid(databaseOid, extensionOwner, 0);
+
+	/* make worker recognizable in pg_stat_activity */
+	pgstat_report_appname("Citus Transaction Recovery");
+
+	TimestampTz startTime = GetCurrentTimestamp();
+	int recoveredTransactionCount = 0;
+
+	InvalidateMetadataSystemCache();
+	StartTransactionCommand();
+
+	if (!LockCitusExtension())
+	{
+		ereport(DEBUG1, (errmsg("could not lock the citus extension, "
+								"skipping 2PC recovery")));
+	}
+	else if (CheckCitusVersion(DEBUG1) && CitusHasBeenLoaded())
+	{
+		recoveredTransactionCount = RecoverTwoPhaseCommits();
+	}
+
+	CommitTransactionCommand();
+
+	if (recoveredTransactionCount > 0)
+	{
+		ereport(LOG, (errmsg("maintenance daemon recovered %d distributed "
+							 "transactions",
+							 recoveredTransactionCount)));
+	}
+
+	RecordMaintenanceDutyTime(databaseOid, MAINTENANCE_DUTY_2PC_RECOVERY, startTime);
+}
+
+
+/*
+ * SpawnTransactionRecoveryWorker starts a background worker which makes a 2PC
+ * recovery pass. On success it returns the worker's handle. Otherwise it
+ * returns NULL.
+ */
+BackgroundWorkerHandle *
+SpawnTransactionRecoveryWorker(Oid databaseId, Oid extensionOwner)
+{
+	BackgroundWorker worker;
+	BackgroundWorkerHandle *handle = NULL;
+
+	memset(&worker, 0, sizeof(worker));
+	SafeSnprintf(worker.bgw_name, BGW_MAXLEN,
+				 "Citus Transaction Recovery: %u/%u",
+				 databaseId, extensionOwner);
+	worker.bgw_flags =
+		BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+
+	/* don't restart, the maintenance daemon starts the next pass */
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	strcpy_s(worker.bgw_library_name, sizeof(worker.bgw_library_name), "citus");
+	strcpy_s(worker.bgw_function_name, sizeof(worker.bgw_function_name),
+			 "TransactionRecoveryWorkerMain");
+	worker.bgw_main_arg = ObjectIdGetDatum(databaseId);
+	memcpy_s(worker.bgw_extra, sizeof(worker.bgw_extra), &extensionOwner,
+			 sizeof(Oid));
+	worker.bgw_notify_pid = MyProcPid;
+
+	if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+	{
+		return NULL;
+	}
+
+	return handle;
+}
+
+
 /*
  * RecoverWorkerTransactions recovers any pending prepared transactions
  * started by this node on the specified worker.
@@ -32,10 +32,24 @@
 #include "distributed/pg_dist_transaction.h"
 #include "distributed/remote_commands.h"
 #include "distributed/resource_lock.h"
+#include "distributed/transaction_management.h"
 #include "distributed/transaction_recovery.h"
 #include "distributed/worker_manager.h"
 #include "distributed/worker_transaction.h"
 
+/* managed via a GUC */
+bool EnableDDLCommandBatching = false;
+bool BufferDDLPropagation = false;
+
+/*
+ * Propagated DDL commands that are not yet sent to the remote nodes with
+ * metadata, and the user that should send them. Both are allocated in
+ * BufferedDDLContext, which lives as long as the transaction.
+ */
+static List *BufferedDDLCommandList = NIL;
+static char *BufferedDDLCommandUser = NULL;
+static MemoryContext BufferedDDLContext = NULL;
+
 static void SendBareCommandListToMetadataNodesInternal(List *commandList,
 													   TargetWorkerSet targetWorkerSet);
 static void SendCommandToMetadataWorkersParams(const char *command,
@@ -48,6 +62,8 @@ static void SendCommandToWorkersParamsInternal(TargetWorkerSet targetWorkerSet,
 											   const Oid *parameterTypes,
 											   const char *const *parameterValues);
 static void ErrorIfAnyMetadataNodeOutOfSync(List *metadataNodeList);
+static void SendCommandListToRemoteMetadataNodesAsUser(List *commandList,
+													   const char *user);
 
 
 /*
@@ -142,10 +158,25 @@ SendCommandToWorkersWithMetadataViaSuperUser(const char *command)
 /*
  * SendCommandListToWorkersWithMetadata sends all commands to all metadata workers
  * with the current user. See `SendCommandToWorkersWithMetadata`for details.
+ *
+ * When citus.enable_ddl_command_batching is on, the commands are sent as a single
+ * command string, which requires a single round-trip to the workers.
  */
 void
 SendCommandListToWorkersWithMetadata(List *commands)
 {
+	if (EnableDDLCommandBatching)
+	{
+		List *workerNodeList = TargetWorkerSetNodeList(NON_COORDINATOR_METADATA_NODES,
+													   RowShareLock);
+
+		Use2PCForCoordinatedTransaction();
+		SendMetadataCommandListToWorkerListInCoordinatedTransaction(workerNodeList,
+																	CurrentUserName(),
+																	commands);
+		return;
+	}
+
 	char *command = NULL;
 	foreach_ptr(command, commands)
 	{
@@ -188,10 +219,29 @@ SendCommandToRemoteNodesWithMetadataViaSuperUser(const char *command)
 /*
  * SendCommandListToRemoteNodesWithMetadata sends all commands to remote nodes
  * with the current user. See `SendCommandToRemoteNodesWithMetadata`for details.
+ *
+ * When citus.enable_ddl_command_batching is on, the commands are sent as a single
+ * command string, which requires a single round-trip to the nodes.
  */
 void
 SendCommandListToRemoteNodesWithMetadata(List *commands)
 {
+	if (EnableDDLCommandBatching)
+	{
+		/* use METADATA_NODES so that ErrorIfAnyMetadataNodeOutOfSync checks local node */
+		List *metadataNodeList = TargetWorkerSetNodeList(METADATA_NODES, RowShareLock);
+		ErrorIfAnyMetadataNodeOutOfSync(metadataNodeList);
+
+		List *remoteNodeList = TargetWorkerSetNodeList(REMOTE_METADATA_NODES,
+													   RowShareLock);
+
+		Use2PCForCoordinatedTransaction();
+		SendMetadataCommandListToWorkerListInCoordinatedTransaction(remoteNodeList,
+																	CurrentUserName(),
+																	commands);
+		return;
+	}
+
 	char *command = NULL;
 	foreach_ptr(command, commands)
 	{
@@ -200,6 +250,159 @@ SendCommandListToRemoteNodesWithMetadata(List *commands)
 }
 
 
+/*
+ * ShouldBufferDDLPropagation returns whether the DDL commands propagated to
+ * the remote nodes with metadata should be buffered in the current
+ * transaction. As for buffered INSERTs, we do not buffer in subtransactions,
+ * since the commands of a subtransaction that is rolled back would have to
+ * be removed from the buffer.
+ */
+bool
+ShouldBufferDDLPropagation(void)
+{
+	return BufferDDLPropagation && IsMultiStatementTransaction() &&
+		   GetCurrentTransactionNestLevel() == 1;
+}
+
+
+/*
+ * BufferCommandListForRemoteNodesWithMetadata adds the given commands to the
+ * DDL commands that are sent to the remote nodes with metadata by
+ * FlushBufferedDDLPropagation, in a single round trip per node.
+ */
+void
+BufferCommandListForRemoteNodesWithMetadata(List *commandList)
+{
+	const char *currentUser = CurrentUserName();
+
+	/* the buffered commands are sent over the connections of a single user */
+	if (BufferedDDLCommandUser != NULL &&
+		strcmp(BufferedDDLCommandUser, currentUser) != 0)
+	{
+		FlushBufferedDDLPropagation();
+	}
+
+	if (BufferedDDLContext == NULL)
+	{
+		BufferedDDLContext = AllocSetContextCreate(TopTransactionContext,
+												   "Buffered DDL Commands",
+												   ALLOCSET_DEFAULT_SIZES);
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(BufferedDDLContext);
+
+	if (BufferedDDLCommandUser == NULL)
+	{
+		BufferedDDLCommandUser = pstrdup(currentUser);
+	}
+
+	const char *command = NULL;
+	foreach_ptr(command, commandList)
+	{
+		BufferedDDLCommandList = lappend(BufferedDDLCommandList, pstrdup(command));
+	}
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * FlushBufferedDDLPropagation sends the buffered DDL commands to the remote
+ * nodes with metadata, joined into a single command string.
+ */
+void
+FlushBufferedDDLPropagation(void)
+{
+	if (BufferedDDLCommandList == NIL)
+	{
+		return;
+	}
+
+	/* detach the buffer first, such that sending the commands does not flush it */
+	List *commandList = BufferedDDLCommandList;
+	char *user = BufferedDDLCommandUser;
+	MemoryContext bufferedDDLContext = BufferedDDLContext;
+
+	ResetBufferedDDLPropagation();
+
+	SendCommandListToRemoteMetadataNodesAsUser(commandList, user);
+
+	MemoryContextDelete(bufferedDDLContext);
+}
+
+
+/*
+ * ResetBufferedDDLPropagation forgets about the buffered DDL commands. It is
+ * called when the transaction ends, at which point their memory is freed
+ * along with the transaction memory.
+ */
+void
+ResetBufferedDDLPropagation(void)
+{
+	BufferedDDLCommandList = NIL;
+	BufferedDDLCommandUser = NULL;
+	BufferedDDLContext = NULL;
+}
+
+
+/*
+ * SendCommandListToRemoteMetadataNodesAsUser sends the given commands to the
+ * remote nodes with metadata in parallel as a single command string, over
+ * the metadata connections of the given user. Commands are committed on the
+ * nodes when the local transaction commits.
+ */
+static void
+SendCommandListToRemoteMetadataNodesAsUser(List *commandList, const char *user)
+{
+	/* use METADATA_NODES so that ErrorIfAnyMetadataNodeOutOfSync checks local node */
+	List *metadataNodeList = TargetWorkerSetNodeList(METADATA_NODES, RowShareLock);
+	ErrorIfAnyMetadataNodeOutOfSync(metadataNodeList);
+
+	List *workerNodeList = TargetWorkerSetNodeList(REMOTE_METADATA_NODES,
+												   RowShareLock);
+	List *connectionList = NIL;
+
+	UseCoordinatedTransaction();
+	Use2PCForCoordinatedTransaction();
+
+	WorkerNode *workerNode = NULL;
+	foreach_ptr(workerNode, workerNodeList)
+	{
+		int32 connectionFlags = REQUIRE_METADATA_CONNECTION;
+
+		MultiConnection *connection =
+			StartNodeUserDatabaseConnection(connectionFlags, workerNode->workerName,
+											workerNode->workerPort, user, NULL);
+
+		MarkRemoteTransactionCritical(connection);
+
+		connectionList = lappend(connectionList, connection);
+	}
+
+	FinishConnectionListEstablishment(connectionList);
+
+	RemoteTransactionsBeginIfNecessary(connectionList);
+
+	char *commandString = StringJoin(commandList, ';');
+
+	MultiConnection *connection = NULL;
+	foreach_ptr(connection, connectionList)
+	{
+		int querySent = SendRemoteCommand(connection, commandString);
+		if (querySent == 0)
+		{
+			ReportConnectionError(connection, ERROR);
+		}
+	}
+
+	bool failOnError = true;
+	foreach_ptr(connection, connectionList)
+	{
+		ClearResults(connection, failOnError);
+	}
+}
+
+
 /*
  * SendCommandToRemoteMetadataNodesParams is a wrapper around
  * SendCommandToWorkersParamsInternal() that can be used to send commands
@@ -375,6 +578,9 @@ SendCommandToWorkersParamsInternal(TargetWorkerSet targetWorkerSet, const char *
 	List *connectionList = NIL;
 	List *workerNodeList = TargetWorkerSetNodeList(targetWorkerSet, RowShareLock);
 
+	/* the command might depend on the buffered DDL commands */
+	FlushBufferedDDLPropagation();
+
 	UseCoordinatedTransaction();
 	Use2PCForCoordinatedTransaction();
 
@@ -472,6 +678,80 @@ SendCommandListToWorkerOutsideTransaction(const char *nodeName, int32 nodePort,
 }
 
 
+/*
+ * SendCommandListToWorkerListOutsideTransaction is like
+ * SendCommandListToWorkerOutsideTransaction, but it sends the commands to all
+ * given nodes in parallel. A new connection is opened to each node and the
+ * commands are sent as a single command string in a separate transaction on
+ * each node, which is committed before returning. The function raises an error
+ * if any of the queries fails.
+ */
+void
+SendCommandListToWorkerListOutsideTransaction(List *workerNodeList,
+											  const char *nodeUser,
+											  List *commandList)
+{
+	if (list_length(commandList) == 0 || list_length(workerNodeList) == 0)
+	{
+		/* nothing to do */
+		return;
+	}
+
+	List *connectionList = NIL;
+
+	/* open connections in parallel */
+	WorkerNode *workerNode = NULL;
+	foreach_ptr(workerNode, workerNodeList)
+	{
+		int connectionFlags = FORCE_NEW_CONNECTION;
+
+		MultiConnection *connection =
+			StartNodeUserDatabaseConnection(connectionFlags, workerNode->workerName,
+											workerNode->workerPort, nodeUser, NULL);
+
+		MarkRemoteTransactionCritical(connection);
+		connectionList = lappend(connectionList, connection);
+	}
+
+	FinishConnectionListEstablishment(connectionList);
+
+	RemoteTransactionListBegin(connectionList);
+
+	char *stringToSend = (list_length(commandList) == 1) ?
+						 linitial(commandList) : StringJoin(commandList, ';');
+
+	/* send commands in parallel */
+	MultiConnection *connection = NULL;
+	foreach_ptr(connection, connectionList)
+	{
+		int querySent = SendRemoteCommand(connection, stringToSend);
+		if (querySent == 0)
+		{
+			ReportConnectionError(connection, ERROR);
+		}
+	}
+
+	bool failOnError = true;
+	foreach_ptr(connection, connectionList)
+	{
+		ClearResults(connection, failOnError);
+	}
+
+	/* commit in parallel */
+	foreach_ptr(connection, connectionList)
+	{
+		StartRemoteTransactionCommit(connection);
+	}
+
+	foreach_ptr(connection, connectionList)
+	{
+		FinishRemoteTransactionCommit(connection);
+		ResetRemoteTransaction(connection);
+		CloseConnection(connection);
+	}
+}
+
+
 /*
  * SendCommandListToWorkerOutsideTransactionWithConnection sends the command list
  * over the specified connection. This opens a new transaction on the
@@ -564,6 +844,9 @@ SendMetadataCommandListToWorkerListInCoordinatedTransaction(List *workerNodeList
 		return;
 	}
 
+	/* the commands might depend on the buffered DDL commands */
+	FlushBufferedDDLPropagation();
+
 	ErrorIfAnyMetadataNodeOutOfSync(workerNodeList);
 
 	UseCoordinatedTransaction();
@@ -708,6 +991,9 @@ SendOptionalMetadataCommandListToWorkerInCoordinatedTransaction(const char *node
 	int connectionFlags = REQUIRE_METADATA_CONNECTION;
 	bool failed = false;
 
+	/* the commands might depend on the buffered DDL commands */
+	FlushBufferedDDLPropagation();
+
 	UseCoordinatedTransaction();
 
 	MultiConnection *workerConnection =
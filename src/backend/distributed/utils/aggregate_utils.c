@@ -8,11 +8,18 @@
  * calling finalfunc on workers, instead passing state to coordinator where
  * it uses combinefunc in coord_combine_agg & applying finalfunc only at end.
  *
+ * It also implements the sketches that approximate count(distinct) when the
+ * hll extension is not available: citus_count_distinct_sketch builds a
+ * HyperLogLog sketch of the hashes of its input on each shard, and
+ * citus_count_distinct_merge combines these sketches on the coordinator and
+ * returns the estimated number of distinct values.
+ *
  * Copyright Citus Data, Inc.
  *
  *-------------------------------------------------------------------------
  */
 
+#include <math.h>
 
 #include "postgres.h"
 
@@ -25,6 +32,7 @@
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "nodes/nodeFuncs.h"
+#include "port/pg_bitutils.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
@@ -32,12 +40,30 @@
 #include "utils/syscache.h"
 #include "utils/typcache.h"
 
+#include "distributed/citus_safe_lib.h"
 #include "distributed/version_compat.h"
 
 PG_FUNCTION_INFO_V1(worker_partial_agg_sfunc);
 PG_FUNCTION_INFO_V1(worker_partial_agg_ffunc);
 PG_FUNCTION_INFO_V1(coord_combine_agg_sfunc);
 PG_FUNCTION_INFO_V1(coord_combine_agg_ffunc);
+PG_FUNCTION_INFO_V1(citus_count_distinct_sketch_sfunc);
+PG_FUNCTION_INFO_V1(citus_count_distinct_sketch_ffunc);
+PG_FUNCTION_INFO_V1(citus_count_distinct_merge_sfunc);
+PG_FUNCTION_INFO_V1(citus_count_distinct_merge_ffunc);
+
+/* version and representations of serialized count(distinct) sketches */
+#define COUNT_DISTINCT_SKETCH_VERSION 1
+#define COUNT_DISTINCT_SKETCH_EXPLICIT 'e'
+#define COUNT_DISTINCT_SKETCH_DENSE 'd'
+#define COUNT_DISTINCT_SKETCH_HEADER_SIZE 3
+
+/* allowed range for the log-base-2 of the number of registers */
+#define COUNT_DISTINCT_SKETCH_MIN_LOG2M 4
+#define COUNT_DISTINCT_SKETCH_MAX_LOG2M 17
+
+/* initial size of the hash set of explicit sketches */
+#define COUNT_DISTINCT_SKETCH_INITIAL_CAPACITY 16
 
 /*
  * Holds information describing the structure of aggregation arguments
@@ -75,6 +101,32 @@ typedef struct StypeBox
 	AggregationArgumentContext *aggregationArgumentContext;
 } StypeBox;
 
+/*
+ * CountDistinctSketch is the transition state of the count(distinct) sketch
+ * aggregates. Small sets are kept explicitly as an open addressing hash set
+ * of the 64-bit hashes of the values, which gives exact counts. Once the set
+ * would take more space than the registers, the sketch is converted to a
+ * dense HyperLogLog with one byte-sized register per bucket.
+ */
+typedef struct CountDistinctSketch
+{
+	MemoryContext context;
+	int log2m;
+
+	/* explicit representation, hash 0 marks empty slots so it is kept apart */
+	uint64 *hashes;
+	int hashCapacity;
+	int hashCount;
+	bool hasZeroHash;
+
+	/* dense representation, NULL while the sketch is explicit */
+	uint8 *registers;
+
+	/* extended hash function of the input type, used by the sketch aggregate */
+	FmgrInfo hashFunction;
+	Oid hashCollation;
+} CountDistinctSketch;
+
 static HeapTuple GetAggregateForm(Oid oid, Form_pg_aggregate *form);
 static HeapTuple GetProcForm(Oid oid, Form_pg_proc *form);
 static HeapTuple GetTypeForm(Oid oid, Form_pg_type *form);
@@ -97,6 +149,17 @@ static void HandleStrictUninit(StypeBox *box, FunctionCallInfo fcinfo, Datum val
 static bool TypecheckWorkerPartialAggArgType(FunctionCallInfo fcinfo, StypeBox *box);
 static bool TypecheckCoordCombineAggReturnType(FunctionCallInfo fcinfo, Oid ffunc,
 											   StypeBox *box);
+static CountDistinctSketch * CreateCountDistinctSketch(MemoryContext context, int log2m);
+static void CheckCountDistinctSketchLog2m(int log2m);
+static bool SketchAddHashToSet(CountDistinctSketch *sketch, uint64 hash);
+static void SketchGrowHashSet(CountDistinctSketch *sketch);
+static void SketchAddHash(CountDistinctSketch *sketch, uint64 hash);
+static void SketchUpdateRegister(CountDistinctSketch *sketch, uint64 hash);
+static void SketchConvertToDense(CountDistinctSketch *sketch);
+static bytea * SerializeCountDistinctSketch(CountDistinctSketch *sketch);
+static void SketchMergeSerialized(CountDistinctSketch *sketch, const char *data,
+								  Size length);
+static int64 SketchEstimate(CountDistinctSketch *sketch);
 
 /*
  * GetAggregateForm loads corresponding tuple & Form_pg_aggregate for oid
@@ -960,3 +1023,511 @@ TypecheckCoordCombineAggReturnType(FunctionCallInfo fcinfo, Oid ffunc, StypeBox
 	return nulltag != NULL && IsA(nulltag->expr, Const) &&
 		   ((Const *) nulltag->expr)->consttype == finalType;
 }
+
+
+/*
+ * citus_count_distinct_sketch_sfunc adds the hash of the given value to the
+ * count(distinct) sketch, essentially implementing the following pseudocode:
+ *
+ * (sketch, value, log2m) -> sketch
+ * sketch = sketch ?? new sketch with 2^log2m registers
+ * sketch.add(hash_extended(value, 0)) unless value is null
+ * return sketch
+ */
+Datum
+citus_count_distinct_sketch_sfunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext = NULL;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		elog(ERROR, "Aggregate function called without an aggregate context");
+	}
+
+	CountDistinctSketch *sketch = NULL;
+	if (PG_ARGISNULL(0))
+	{
+		if (PG_ARGISNULL(2))
+		{
+			ereport(ERROR, (errmsg("count(distinct) sketch size cannot be NULL")));
+		}
+
+		int log2m = PG_GETARG_INT32(2);
+		CheckCountDistinctSketchLog2m(log2m);
+
+		sketch = CreateCountDistinctSketch(aggregateContext, log2m);
+
+		Oid argumentType = get_fn_expr_argtype(fcinfo->flinfo, 1);
+		TypeCacheEntry *typeEntry = lookup_type_cache(argumentType,
+													  TYPECACHE_HASH_EXTENDED_PROC);
+		if (!OidIsValid(typeEntry->hash_extended_proc))
+		{
+			ereport(ERROR, (errcode(ERRCODE_UNDEFINED_FUNCTION),
+							errmsg("could not identify an extended hash function "
+								   "for type %s", format_type_be(argumentType))));
+		}
+
+		fmgr_info_cxt(typeEntry->hash_extended_proc, &sketch->hashFunction,
+					  aggregateContext);
+		sketch->hashCollation = PG_GET_COLLATION();
+	}
+	else
+	{
+		sketch = (CountDistinctSketch *) PG_GETARG_POINTER(0);
+	}
+
+	if (!PG_ARGISNULL(1))
+	{
+		Datum hash = FunctionCall2Coll(&sketch->hashFunction, sketch->hashCollation,
+									   PG_GETARG_DATUM(1), Int64GetDatum(0));
+
+		SketchAddHash(sketch, DatumGetUInt64(hash));
+	}
+
+	PG_RETURN_POINTER(sketch);
+}
+
+
+/*
+ * citus_count_distinct_sketch_ffunc serializes the count(distinct) sketch such
+ * that it can be sent to the coordinator.
+ */
+Datum
+citus_count_distinct_sketch_ffunc(PG_FUNCTION_ARGS)
+{
+	if (PG_ARGISNULL(0))
+	{
+		PG_RETURN_NULL();
+	}
+
+	CountDistinctSketch *sketch = (CountDistinctSketch *) PG_GETARG_POINTER(0);
+
+	PG_RETURN_BYTEA_P(SerializeCountDistinctSketch(sketch));
+}
+
+
+/*
+ * citus_count_distinct_merge_sfunc merges a serialized count(distinct) sketch
+ * into the transition state, essentially implementing the following pseudocode:
+ *
+ * (sketch, bytea) -> sketch
+ * sketch = sketch ?? new sketch of the same size as bytea
+ * sketch.union(deserialize(bytea)) unless bytea is null
+ * return sketch
+ */
+Datum
+citus_count_distinct_merge_sfunc(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext = NULL;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		elog(ERROR, "Aggregate function called without an aggregate context");
+	}
+
+	CountDistinctSketch *sketch =
+		PG_ARGISNULL(0) ? NULL : (CountDistinctSketch *) PG_GETARG_POINTER(0);
+
+	if (PG_ARGISNULL(1))
+	{
+		if (sketch == NULL)
+		{
+			PG_RETURN_NULL();
+		}
+
+		PG_RETURN_POINTER(sketch);
+	}
+
+	bytea *serializedSketch = PG_GETARG_BYTEA_PP(1);
+	const char *data = VARDATA_ANY(serializedSketch);
+	Size length = VARSIZE_ANY_EXHDR(serializedSketch);
+
+	if (length < COUNT_DISTINCT_SKETCH_HEADER_SIZE ||
+		data[0] != COUNT_DISTINCT_SKETCH_VERSION)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+						errmsg("invalid count(distinct) sketch")));
+	}
+
+	int log2m = data[1];
+	CheckCountDistinctSketchLog2m(log2m);
+
+	if (sketch == NULL)
+	{
+		sketch = CreateCountDistinctSketch(aggregateContext, log2m);
+	}
+	else if (sketch->log2m != log2m)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("cannot merge count(distinct) sketches of different "
+							   "sizes")));
+	}
+
+	SketchMergeSerialized(sketch, data, length);
+
+	PG_RETURN_POINTER(sketch);
+}
+
+
+/*
+ * citus_count_distinct_merge_ffunc returns the estimated number of distinct
+ * values in the merged count(distinct) sketches.
+ */
+Datum
+citus_count_distinct_merge_ffunc(PG_FUNCTION_ARGS)
+{
+	if (PG_ARGISNULL(0))
+	{
+		PG_RETURN_INT64(0);
+	}
+
+	CountDistinctSketch *sketch = (CountDistinctSketch *) PG_GETARG_POINTER(0);
+
+	PG_RETURN_INT64(SketchEstimate(sketch));
+}
+
+
+/*
+ * CreateCountDistinctSketch allocates an empty, explicit count(distinct)
+ * sketch with 2^log2m registers in the given memory context.
+ */
+static CountDistinctSketch *
+CreateCountDistinctSketch(MemoryContext context, int log2m)
+{
+	CountDistinctSketch *sketch = MemoryContextAllocZero(context,
+														 sizeof(CountDistinctSketch));
+	sketch->context = context;
+	sketch->log2m = log2m;
+	sketch->hashCapacity = COUNT_DISTINCT_SKETCH_INITIAL_CAPACITY;
+	sketch->hashes = MemoryContextAllocZero(context,
+											sketch->hashCapacity * sizeof(uint64));
+
+	return sketch;
+}
+
+
+/*
+ * CheckCountDistinctSketchLog2m errors out if the given number of registers
+ * is outside of the range that CountDistinctStorageSize produces.
+ */
+static void
+CheckCountDistinctSketchLog2m(int log2m)
+{
+	if (log2m < COUNT_DISTINCT_SKETCH_MIN_LOG2M ||
+		log2m > COUNT_DISTINCT_SKETCH_MAX_LOG2M)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("count(distinct) sketch size must be between %d and %d",
+							   COUNT_DISTINCT_SKETCH_MIN_LOG2M,
+							   COUNT_DISTINCT_SKETCH_MAX_LOG2M)));
+	}
+}
+
+
+/*
+ * SketchAddHash adds the given hash to the sketch, and converts the sketch to
+ * the dense representation once it holds more than one distinct hash for
+ * every 8 registers, since the hashes then take more space than the
+ * registers.
+ */
+static void
+SketchAddHash(CountDistinctSketch *sketch, uint64 hash)
+{
+	if (sketch->registers != NULL)
+	{
+		SketchUpdateRegister(sketch, hash);
+		return;
+	}
+
+	if (hash == 0)
+	{
+		sketch->hasZeroHash = true;
+	}
+	else if (!SketchAddHashToSet(sketch, hash))
+	{
+		return;
+	}
+
+	int distinctHashCount = sketch->hashCount + (sketch->hasZeroHash ? 1 : 0);
+	if (distinctHashCount > (1 << sketch->log2m) / 8)
+	{
+		SketchConvertToDense(sketch);
+	}
+}
+
+
+/*
+ * SketchAddHashToSet adds the given non-zero hash to the hash set of an
+ * explicit sketch, and returns whether it was not in the set yet.
+ */
+static bool
+SketchAddHashToSet(CountDistinctSketch *sketch, uint64 hash)
+{
+	/* keep the load factor of the hash set at most 1/2 */
+	if ((sketch->hashCount + 1) * 2 > sketch->hashCapacity)
+	{
+		SketchGrowHashSet(sketch);
+	}
+
+	uint64 mask = sketch->hashCapacity - 1;
+	uint64 slot = (hash ^ (hash >> 32)) & mask;
+
+	while (sketch->hashes[slot] != 0)
+	{
+		if (sketch->hashes[slot] == hash)
+		{
+			return false;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	sketch->hashes[slot] = hash;
+	sketch->hashCount++;
+
+	return true;
+}
+
+
+/*
+ * SketchGrowHashSet doubles the capacity of the hash set of an explicit
+ * sketch and re-inserts the hashes.
+ */
+static void
+SketchGrowHashSet(CountDistinctSketch *sketch)
+{
+	uint64 *oldHashes = sketch->hashes;
+	int oldCapacity = sketch->hashCapacity;
+
+	sketch->hashCapacity = oldCapacity * 2;
+	sketch->hashes = MemoryContextAllocZero(sketch->context,
+											sketch->hashCapacity * sizeof(uint64));
+	sketch->hashCount = 0;
+
+	for (int slot = 0; slot < oldCapacity; slot++)
+	{
+		if (oldHashes[slot] != 0)
+		{
+			SketchAddHashToSet(sketch, oldHashes[slot]);
+		}
+	}
+
+	pfree(oldHashes);
+}
+
+
+/*
+ * SketchUpdateRegister updates the register of the bucket that the lowest
+ * log2m bits of the hash select with the position of the lowest set bit in
+ * the remaining bits.
+ */
+static void
+SketchUpdateRegister(CountDistinctSketch *sketch, uint64 hash)
+{
+	int log2m = sketch->log2m;
+	uint64 bucket = hash & ((UINT64CONST(1) << log2m) - 1);
+	uint64 remainingBits = hash >> log2m;
+
+	uint8 rank = (remainingBits == 0) ?
+				 (64 - log2m + 1) :
+				 (pg_rightmost_one_pos64(remainingBits) + 1);
+
+	if (sketch->registers[bucket] < rank)
+	{
+		sketch->registers[bucket] = rank;
+	}
+}
+
+
+/*
+ * SketchConvertToDense moves the hashes of an explicit sketch into newly
+ * allocated registers.
+ */
+static void
+SketchConvertToDense(CountDistinctSketch *sketch)
+{
+	sketch->registers = MemoryContextAllocZero(sketch->context,
+											   (Size) 1 << sketch->log2m);
+
+	for (int slot = 0; slot < sketch->hashCapacity; slot++)
+	{
+		if (sketch->hashes[slot] != 0)
+		{
+			SketchUpdateRegister(sketch, sketch->hashes[slot]);
+		}
+	}
+
+	if (sketch->hasZeroHash)
+	{
+		SketchUpdateRegister(sketch, 0);
+	}
+
+	pfree(sketch->hashes);
+	sketch->hashes = NULL;
+	sketch->hashCapacity = 0;
+	sketch->hashCount = 0;
+	sketch->hasZeroHash = false;
+}
+
+
+/*
+ * SerializeCountDistinctSketch serializes the sketch into a version byte, the
+ * log-base-2 of the number of registers and the representation, followed by
+ * either the distinct hashes or the registers.
+ */
+static bytea *
+SerializeCountDistinctSketch(CountDistinctSketch *sketch)
+{
+	bool isDense = (sketch->registers != NULL);
+	Size dataLength = isDense ?
+					  ((Size) 1 << sketch->log2m) :
+					  (sketch->hashCount + (sketch->hasZeroHash ? 1 : 0)) *
+					  sizeof(uint64);
+	Size length = COUNT_DISTINCT_SKETCH_HEADER_SIZE + dataLength;
+
+	bytea *serializedSketch = palloc(VARHDRSZ + length);
+	SET_VARSIZE(serializedSketch, VARHDRSZ + length);
+
+	char *data = VARDATA(serializedSketch);
+	data[0] = COUNT_DISTINCT_SKETCH_VERSION;
+	data[1] = (char) sketch->log2m;
+	data[2] = isDense ? COUNT_DISTINCT_SKETCH_DENSE : COUNT_DISTINCT_SKETCH_EXPLICIT;
+	data += COUNT_DISTINCT_SKETCH_HEADER_SIZE;
+
+	if (isDense)
+	{
+		memcpy_s(data, dataLength, sketch->registers, dataLength);
+		return serializedSketch;
+	}
+
+	for (int slot = 0; slot < sketch->hashCapacity; slot++)
+	{
+		if (sketch->hashes[slot] != 0)
+		{
+			memcpy_s(data, sizeof(uint64), &sketch->hashes[slot], sizeof(uint64));
+			data += sizeof(uint64);
+		}
+	}
+
+	if (sketch->hasZeroHash)
+	{
+		uint64 zeroHash = 0;
+		memcpy_s(data, sizeof(uint64), &zeroHash, sizeof(uint64));
+	}
+
+	return serializedSketch;
+}
+
+
+/*
+ * SketchMergeSerialized merges the serialized sketch of the same size into the
+ * given sketch.
+ */
+static void
+SketchMergeSerialized(CountDistinctSketch *sketch, const char *data, Size length)
+{
+	char representation = data[2];
+	Size registerCount = (Size) 1 << sketch->log2m;
+
+	data += COUNT_DISTINCT_SKETCH_HEADER_SIZE;
+	length -= COUNT_DISTINCT_SKETCH_HEADER_SIZE;
+
+	if (representation == COUNT_DISTINCT_SKETCH_EXPLICIT &&
+		length % sizeof(uint64) == 0)
+	{
+		for (Size offset = 0; offset < length; offset += sizeof(uint64))
+		{
+			uint64 hash = 0;
+			memcpy_s(&hash, sizeof(uint64), data + offset, sizeof(uint64));
+
+			SketchAddHash(sketch, hash);
+		}
+	}
+	else if (representation == COUNT_DISTINCT_SKETCH_DENSE &&
+			 length == registerCount)
+	{
+		if (sketch->registers == NULL)
+		{
+			SketchConvertToDense(sketch);
+		}
+
+		for (Size bucket = 0; bucket < registerCount; bucket++)
+		{
+			uint8 rank = (uint8) data[bucket];
+			if (sketch->registers[bucket] < rank)
+			{
+				sketch->registers[bucket] = rank;
+			}
+		}
+	}
+	else
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+						errmsg("invalid count(distinct) sketch")));
+	}
+}
+
+
+/*
+ * SketchEstimate returns the number of distinct hashes for explicit sketches,
+ * and the HyperLogLog estimate, using linear counting for small cardinalities,
+ * for dense sketches.
+ */
+static int64
+SketchEstimate(CountDistinctSketch *sketch)
+{
+	if (sketch->registers == NULL)
+	{
+		return sketch->hashCount + (sketch->hasZeroHash ? 1 : 0);
+	}
+
+	int registerCount = 1 << sketch->log2m;
+	double inverseSum = 0.0;
+	int zeroRegisterCount = 0;
+
+	for (int bucket = 0; bucket < registerCount; bucket++)
+	{
+		inverseSum += ldexp(1.0, -sketch->registers[bucket]);
+
+		if (sketch->registers[bucket] == 0)
+		{
+			zeroRegisterCount++;
+		}
+	}
+
+	double alpha = 0.0;
+	switch (registerCount)
+	{
+		case 16:
+		{
+			alpha = 0.673;
+			break;
+		}
+
+		case 32:
+		{
+			alpha = 0.697;
+			break;
+		}
+
+		case 64:
+		{
+			alpha = 0.709;
+			break;
+		}
+
+		default:
+		{
+			alpha = 0.7213 / (1.0 + 1.079 / registerCount);
+			break;
+		}
+	}
+
+	double estimate = alpha * registerCount * registerCount / inverseSum;
+
+	/* with 64-bit hashes, only the small range correction is needed */
+	if (estimate <= 2.5 * registerCount && zeroRegisterCount > 0)
+	{
+		estimate = registerCount * log((double) registerCount / zeroRegisterCount);
+	}
+
+	return (int64) (estimate + 0.5);
+}
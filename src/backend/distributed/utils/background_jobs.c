@@ -126,6 +126,7 @@ static volatile sig_atomic_t GotSighup = false;
 /* keeping track of parallel background tasks per node */
 HTAB *ParallelTasksPerNode = NULL;
 int MaxBackgroundTaskExecutorsPerNode = 1;
+bool BackgroundTaskBalanceNodes = false;
 
 PG_FUNCTION_INFO_V1(citus_job_cancel);
 PG_FUNCTION_INFO_V1(citus_job_wait);
@@ -921,6 +922,38 @@ IncrementParallelTaskCountForNodesInvolved(BackgroundTask *task)
 }
 
 
+/*
+ * ParallelTaskCountForNodesInvolved returns the largest number of parallel
+ * tasks that currently run on any of the nodes involved with the task, or -1
+ * if the limit of parallel tasks is reached for one of these nodes.
+ */
+int
+ParallelTaskCountForNodesInvolved(BackgroundTask *task)
+{
+	int maxParallelTaskCount = 0;
+
+	int node;
+	foreach_int(node, task->nodesInvolved)
+	{
+		ParallelTasksPerNodeEntry *hashEntry = hash_search(
+			ParallelTasksPerNode, &(node), HASH_FIND, NULL);
+		if (hashEntry == NULL)
+		{
+			continue;
+		}
+
+		if (hashEntry->counter >= MaxBackgroundTaskExecutorsPerNode)
+		{
+			return -1;
+		}
+
+		maxParallelTaskCount = Max(maxParallelTaskCount, hashEntry->counter);
+	}
+
+	return maxParallelTaskCount;
+}
+
+
 /*
  * DecrementParallelTaskCountForNodesInvolved
  * Decrements the parallel task count for each of the nodes involved
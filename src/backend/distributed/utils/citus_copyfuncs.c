@@ -100,7 +100,10 @@ copyJobInfo(Job *newnode, Job *from)
 	COPY_SCALAR_FIELD(deferredPruning);
 	COPY_NODE_FIELD(partitionKeyValue);
 	COPY_NODE_FIELD(localPlannedStatements);
+	COPY_NODE_FIELD(cachedShardQueries);
 	COPY_SCALAR_FIELD(parametersInJobQueryResolved);
+	COPY_SCALAR_FIELD(parameterPruningRelationId);
+	COPY_NODE_FIELD(parameterPruningClauseList);
 }
 
 
@@ -124,8 +127,15 @@ CopyNodeDistributedPlan(COPYFUNC_ARGS)
 
 	COPY_NODE_FIELD(workerJob);
 	COPY_NODE_FIELD(combineQuery);
+	COPY_SCALAR_FIELD(mergeSortedTaskResults);
+	COPY_SCALAR_FIELD(incrementalCombineSupported);
+	COPY_NODE_FIELD(repartitionedAggregateQuery);
+	COPY_SCALAR_FIELD(repartitionedAggregateColumnIndex);
+	COPY_SCALAR_FIELD(repartitionedAggregateRelationId);
 	COPY_SCALAR_FIELD(queryId);
 	COPY_NODE_FIELD(relationIdList);
+	COPY_NODE_FIELD(prunedRelationIdList);
+	COPY_NODE_FIELD(remainingPartitionListList);
 	COPY_SCALAR_FIELD(targetRelationId);
 	COPY_NODE_FIELD(modifyQueryViaCoordinatorOrRepartition);
 	COPY_NODE_FIELD(selectPlanForModifyViaCoordinatorOrRepartition);
@@ -137,6 +147,11 @@ CopyNodeDistributedPlan(COPYFUNC_ARGS)
 	COPY_SCALAR_FIELD(fastPathRouterPlan);
 	COPY_SCALAR_FIELD(numberOfTimesExecuted);
 	COPY_NODE_FIELD(planningError);
+
+	for (int phase = 0; phase < PLANNING_PHASE_COUNT; phase++)
+	{
+		COPY_SCALAR_FIELD(planningPhaseTimes[phase]);
+	}
 }
 
 
@@ -147,6 +162,11 @@ CopyNodeDistributedSubPlan(COPYFUNC_ARGS)
 
 	COPY_SCALAR_FIELD(subPlanId);
 	COPY_NODE_FIELD(plan);
+	COPY_SCALAR_FIELD(taskPruningRelationId);
+	COPY_SCALAR_FIELD(resultSlicingRelationId);
+	COPY_SCALAR_FIELD(resultSlicingAttributeNumber);
+	COPY_STRING_FIELD(reusableResultId);
+	COPY_NODE_FIELD(relationIdList);
 }
 
 
@@ -325,6 +345,7 @@ CopyNodeTask(COPYFUNC_ARGS)
 	COPY_SCALAR_FIELD(fetchedExplainAnalyzePlacementIndex);
 	COPY_STRING_FIELD(fetchedExplainAnalyzePlan);
 	COPY_SCALAR_FIELD(fetchedExplainAnalyzeExecutionDuration);
+	COPY_SCALAR_FIELD(executionTrace);
 	COPY_SCALAR_FIELD(isLocalTableModification);
 	COPY_SCALAR_FIELD(cannotBeExecutedInTransaction);
 }
@@ -341,6 +362,16 @@ CopyNodeLocalPlannedStatement(COPYFUNC_ARGS)
 }
 
 
+void
+CopyNodeCachedShardQuery(COPYFUNC_ARGS)
+{
+	DECLARE_FROM_AND_NEW_NODE(CachedShardQuery);
+
+	COPY_SCALAR_FIELD(shardId);
+	COPY_STRING_FIELD(queryString);
+}
+
+
 void
 CopyNodeDeferredErrorMessage(COPYFUNC_ARGS)
 {
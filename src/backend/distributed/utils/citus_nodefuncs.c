@@ -42,6 +42,7 @@ static const char *CitusNodeTagNamesD[] = {
 	"UsedDistributedSubPlan",
 	"Task",
 	"LocalPlannedStatement",
+	"CachedShardQuery",
 	"ShardInterval",
 	"ShardPlacement",
 	"RelationShard",
@@ -409,6 +410,7 @@ const ExtensibleNodeMethods nodeMethods[] =
 	DEFINE_NODE_METHODS(RelationRowLock),
 	DEFINE_NODE_METHODS(Task),
 	DEFINE_NODE_METHODS(LocalPlannedStatement),
+	DEFINE_NODE_METHODS(CachedShardQuery),
 	DEFINE_NODE_METHODS(DeferredErrorMessage),
 	DEFINE_NODE_METHODS(GroupShardPlacement),
 
@@ -137,6 +137,23 @@
 #define WRITE_ENUM_ARRAY(fldname, count) WRITE_INT_ARRAY(fldname, count)
 
 
+/* Write a float array (anything written as ":fldname (%.3f, %.3f") */
+#define WRITE_FLOAT_ARRAY(fldname, count, format) \
+	appendStringInfo(str, " :" CppAsString(fldname) " ("); \
+	{ \
+		int i;\
+		for (i = 0; i < count; i++) \
+		{ \
+			if (i > 0) \
+			{ \
+				appendStringInfo(str, ", "); \
+			} \
+			appendStringInfo(str, format, node->fldname[i]); \
+		}\
+	}\
+	appendStringInfo(str, ")")
+
+
 #define booltostr(x)  ((x) ? "true" : "false")
 static void WriteTaskQuery(OUTFUNC_ARGS);
 
@@ -189,8 +206,15 @@ OutDistributedPlan(OUTFUNC_ARGS)
 
 	WRITE_NODE_FIELD(workerJob);
 	WRITE_NODE_FIELD(combineQuery);
+	WRITE_BOOL_FIELD(mergeSortedTaskResults);
+	WRITE_BOOL_FIELD(incrementalCombineSupported);
+	WRITE_NODE_FIELD(repartitionedAggregateQuery);
+	WRITE_INT_FIELD(repartitionedAggregateColumnIndex);
+	WRITE_OID_FIELD(repartitionedAggregateRelationId);
 	WRITE_UINT64_FIELD(queryId);
 	WRITE_NODE_FIELD(relationIdList);
+	WRITE_NODE_FIELD(prunedRelationIdList);
+	WRITE_NODE_FIELD(remainingPartitionListList);
 	WRITE_OID_FIELD(targetRelationId);
 	WRITE_NODE_FIELD(modifyQueryViaCoordinatorOrRepartition);
 	WRITE_NODE_FIELD(selectPlanForModifyViaCoordinatorOrRepartition);
@@ -203,6 +227,7 @@ OutDistributedPlan(OUTFUNC_ARGS)
 	WRITE_UINT_FIELD(numberOfTimesExecuted);
 
 	WRITE_NODE_FIELD(planningError);
+	WRITE_FLOAT_ARRAY(planningPhaseTimes, PLANNING_PHASE_COUNT, "%.3f");
 }
 
 
@@ -215,6 +240,11 @@ OutDistributedSubPlan(OUTFUNC_ARGS)
 
 	WRITE_UINT_FIELD(subPlanId);
 	WRITE_NODE_FIELD(plan);
+	WRITE_OID_FIELD(taskPruningRelationId);
+	WRITE_OID_FIELD(resultSlicingRelationId);
+	WRITE_INT_FIELD(resultSlicingAttributeNumber);
+	WRITE_STRING_FIELD(reusableResultId);
+	WRITE_NODE_FIELD(relationIdList);
 }
 
 void
@@ -348,7 +378,10 @@ OutJobFields(StringInfo str, const Job *node)
 	WRITE_BOOL_FIELD(deferredPruning);
 	WRITE_NODE_FIELD(partitionKeyValue);
 	WRITE_NODE_FIELD(localPlannedStatements);
+	WRITE_NODE_FIELD(cachedShardQueries);
 	WRITE_BOOL_FIELD(parametersInJobQueryResolved);
+	WRITE_OID_FIELD(parameterPruningRelationId);
+	WRITE_NODE_FIELD(parameterPruningClauseList);
 }
 
 
@@ -551,6 +584,18 @@ OutLocalPlannedStatement(OUTFUNC_ARGS)
 	WRITE_NODE_FIELD(localPlan);
 }
 
+
+void
+OutCachedShardQuery(OUTFUNC_ARGS)
+{
+	WRITE_LOCALS(CachedShardQuery);
+
+	WRITE_NODE_TYPE("CachedShardQuery");
+
+	WRITE_UINT64_FIELD(shardId);
+	WRITE_STRING_FIELD(queryString);
+}
+
 void
 OutDeferredErrorMessage(OUTFUNC_ARGS)
 {
@@ -9,6 +9,7 @@
  */
 
 #include <time.h>
+#include <sys/resource.h>
 
 #include "postgres.h"
 
@@ -16,6 +17,7 @@
 
 #include "access/hash.h"
 #include "executor/execdesc.h"
+#include "executor/instrument.h"
 #include "storage/ipc.h"
 #include "storage/lwlock.h"
 #include "storage/shmem.h"
@@ -24,7 +26,9 @@
 #include "utils/datetime.h"
 #include "utils/json.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/syscache.h"
+#include "utils/timestamp.h"
 
 #include "distributed/citus_safe_lib.h"
 #include "distributed/colocation_utils.h"
@@ -42,21 +46,49 @@
 	#include "common/pg_prng.h"
 #endif
 
-static void AttributeMetricsIfApplicable(void);
+/*
+ * TenantQueryStats contains the resources used by one or more queries of a
+ * tenant.
+ */
+typedef struct TenantQueryStats
+{
+	int queryCount;
+	int reads;
+	int writes;
+	double cpuUsage;
+	int64 bufferHits;
+	int64 bufferReads;
+	int64 rowsReturned;
+} TenantQueryStats;
+
+/*
+ * TenantStatsBatchEntry keeps the statistics of a tenant that a backend
+ * collected since it last flushed them into the multi tenant monitor, see
+ * citus.stat_tenants_flush_interval.
+ */
+typedef struct TenantStatsBatchEntry
+{
+	TenantStatsHashKey key;   /* hash key of entry - MUST BE FIRST */
+
+	TenantQueryStats stats;
+	TimestampTz lastQueryTime;
+} TenantStatsBatchEntry;
+
+static void AttributeMetricsIfApplicable(QueryDesc *queryDesc);
 
 ExecutorEnd_hook_type prev_ExecutorEnd = NULL;
 
 #define ATTRIBUTE_PREFIX "/*{\"cId\":"
 #define ATTRIBUTE_STRING_FORMAT "/*{\"cId\":%d,\"tId\":%s}*/"
 #define ATTRIBUTE_STRING_FORMAT_WITHOUT_TID "/*{\"cId\":%d}*/"
-#define STAT_TENANTS_COLUMNS 9
+#define STAT_TENANTS_COLUMNS 15
 #define ONE_QUERY_SCORE 1000000000
 
 static char AttributeToTenant[MAX_TENANT_ATTRIBUTE_LENGTH] = "";
 static CmdType AttributeToCommandType = CMD_UNKNOWN;
 static int AttributeToColocationGroupId = INVALID_COLOCATION_ID;
-static clock_t QueryStartClock = { 0 };
-static clock_t QueryEndClock = { 0 };
+static struct rusage QueryStartResourceUsage;
+static BufferUsage QueryStartBufferUsage;
 
 static const char *SharedMemoryNameForMultiTenantMonitor =
 	"Shared memory for multi tenant monitor";
@@ -68,15 +100,25 @@ static int CompareTenantScore(const void *leftElement, const void *rightElement)
 static void UpdatePeriodsIfNecessary(TenantStats *tenantStats, TimestampTz queryTime);
 static void ReduceScoreIfNecessary(TenantStats *tenantStats, TimestampTz queryTime);
 static void EvictTenantsIfNecessary(TimestampTz queryTime);
-static void RecordTenantStats(TenantStats *tenantStats, TimestampTz queryTime);
+static void AddTenantStats(TenantStatsHashKey *key, TimestampTz queryTime,
+						   TenantQueryStats *queryStats);
+static void RecordTenantStats(TenantStats *tenantStats, TimestampTz queryTime,
+							  TenantQueryStats *queryStats);
+static void BatchTenantStats(TenantStatsHashKey *key, TimestampTz queryTime,
+							 TenantQueryStats *queryStats);
+static double CpuTimeSince(struct rusage *startResourceUsage);
+static void FlushTenantStatsBatch(void);
+static void FlushTenantStatsBatchAtExit(int code, Datum arg);
+static TimestampTz StatTenantsPeriodStart(TimestampTz time);
 static MultiTenantMonitor * CreateSharedMemoryForMultiTenantMonitor(void);
 static MultiTenantMonitor * GetMultiTenantMonitor(void);
 static void MultiTenantMonitorSMInit(void);
-static TenantStats * CreateTenantStats(MultiTenantMonitor *monitor, TimestampTz
-									   queryTime);
+static TenantStats * CreateTenantStats(MultiTenantMonitor *monitor,
+									   TenantStatsHashKey *key, TimestampTz queryTime);
 static void FillTenantStatsHashKey(TenantStatsHashKey *key, char *tenantAttribute, uint32
 								   colocationGroupId);
-static TenantStats * FindTenantStats(MultiTenantMonitor *monitor);
+static TenantStats * FindTenantStats(MultiTenantMonitor *monitor,
+									 TenantStatsHashKey *key);
 static size_t MultiTenantMonitorshmemSize(void);
 static char * ExtractTopComment(const char *inputString);
 static char * EscapeCommentChars(const char *str);
@@ -87,6 +129,20 @@ int StatTenantsPeriod = (time_t) 60;
 int StatTenantsLimit = 100;
 int StatTenantsTrack = STAT_TENANTS_TRACK_NONE;
 double StatTenantsSampleRateForNewTenants = 1;
+int StatTenantsFlushInterval = 0;
+
+/*
+ * Statistics of the tenants that this backend did not flush into the monitor
+ * yet, the time of the last flush and the start of the period the batched
+ * statistics belong to.
+ */
+static HTAB *TenantStatsBatch = NULL;
+static TimestampTz TenantStatsBatchFlushTime = 0;
+static TimestampTz TenantStatsBatchPeriodStart = 0;
+static bool TenantStatsBatchExitCallbackRegistered = false;
+
+/* the monitor in shared memory, once we looked it up */
+static MultiTenantMonitor *CachedMultiTenantMonitor = NULL;
 
 PG_FUNCTION_INFO_V1(citus_stat_tenants_local);
 PG_FUNCTION_INFO_V1(citus_stat_tenants_local_reset);
@@ -121,6 +177,9 @@ citus_stat_tenants_local(PG_FUNCTION_ARGS)
 		PG_RETURN_VOID();
 	}
 
+	/* make sure the statistics of our own queries show up */
+	FlushTenantStatsBatch();
+
 	LWLockAcquire(&monitor->lock, LW_EXCLUSIVE);
 
 	int numberOfRowsToReturn = 0;
@@ -184,6 +243,12 @@ citus_stat_tenants_local(PG_FUNCTION_ARGS)
 		values[6] = Float8GetDatum(tenantStats->cpuUsageInThisPeriod);
 		values[7] = Float8GetDatum(tenantStats->cpuUsageInLastPeriod);
 		values[8] = Int64GetDatum(tenantStats->score);
+		values[9] = Int64GetDatum(tenantStats->bufferHitsInThisPeriod);
+		values[10] = Int64GetDatum(tenantStats->bufferHitsInLastPeriod);
+		values[11] = Int64GetDatum(tenantStats->bufferReadsInThisPeriod);
+		values[12] = Int64GetDatum(tenantStats->bufferReadsInLastPeriod);
+		values[13] = Int64GetDatum(tenantStats->rowsReturnedInThisPeriod);
+		values[14] = Int64GetDatum(tenantStats->rowsReturnedInLastPeriod);
 
 		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
 	}
@@ -214,6 +279,13 @@ citus_stat_tenants_local_reset(PG_FUNCTION_ARGS)
 	HASH_SEQ_STATUS hash_seq;
 	TenantStats *stats;
 
+	/* we can only drop our own batch, other backends still flush theirs */
+	if (TenantStatsBatch != NULL)
+	{
+		hash_destroy(TenantStatsBatch);
+		TenantStatsBatch = NULL;
+	}
+
 	LWLockAcquire(&monitor->lock, LW_EXCLUSIVE);
 
 	hash_seq_init(&hash_seq, monitor->tenants);
@@ -285,15 +357,25 @@ AttributeTask(char *tenantId, int colocationId, CmdType commandType)
 	TenantStatsHashKey key = { 0 };
 	FillTenantStatsHashKey(&key, tenantId, colocationId);
 
-	MultiTenantMonitor *monitor = GetMultiTenantMonitor();
 	bool found = false;
 
-	/* Acquire the lock in shared mode to check if the tenant is already in the hash table. */
-	LWLockAcquire(&monitor->lock, LW_SHARED);
+	/* tenants in our batch are tracked, so we can skip the monitor lock */
+	if (TenantStatsBatch != NULL)
+	{
+		hash_search(TenantStatsBatch, &key, HASH_FIND, &found);
+	}
+
+	if (!found)
+	{
+		MultiTenantMonitor *monitor = GetMultiTenantMonitor();
 
-	hash_search(monitor->tenants, &key, HASH_FIND, &found);
+		/* Acquire the lock in shared mode to check if the tenant is already in the hash table. */
+		LWLockAcquire(&monitor->lock, LW_SHARED);
 
-	LWLockRelease(&monitor->lock);
+		hash_search(monitor->tenants, &key, HASH_FIND, &found);
+
+		LWLockRelease(&monitor->lock);
+	}
 
 	/* If the tenant is not found in the hash table, we will track the query with a probability of StatTenantsSampleRateForNewTenants. */
 	if (!found)
@@ -335,7 +417,9 @@ AttributeTask(char *tenantId, int colocationId, CmdType commandType)
 		strcpy_s(AttributeToTenant, sizeof(AttributeToTenant), "");
 	}
 	AttributeToCommandType = commandType;
-	QueryStartClock = clock();
+
+	getrusage(RUSAGE_SELF, &QueryStartResourceUsage);
+	QueryStartBufferUsage = pgBufferUsage;
 }
 
 
@@ -404,7 +488,7 @@ CitusAttributeToEnd(QueryDesc *queryDesc)
 	 * At the end of the Executor is the last moment we have to attribute the previous
 	 * attribution to a tenant, if applicable
 	 */
-	AttributeMetricsIfApplicable();
+	AttributeMetricsIfApplicable(queryDesc);
 
 	/* now call in to the previously installed hook, or the standard implementation */
 	if (prev_ExecutorEnd)
@@ -444,7 +528,7 @@ CompareTenantScore(const void *leftElement, const void *rightElement)
  * AttributeMetricsIfApplicable updates the metrics for current tenant's statistics
  */
 static void
-AttributeMetricsIfApplicable()
+AttributeMetricsIfApplicable(QueryDesc *queryDesc)
 {
 	if (StatTenantsTrack == STAT_TENANTS_TRACK_NONE ||
 		AttributeToColocationGroupId == INVALID_COLOCATION_ID)
@@ -461,10 +545,88 @@ AttributeMetricsIfApplicable()
 		return;
 	}
 
-	QueryEndClock = clock();
+	TenantQueryStats queryStats;
+	memset(&queryStats, 0, sizeof(TenantQueryStats));
+
+	queryStats.queryCount = 1;
+	queryStats.cpuUsage = CpuTimeSince(&QueryStartResourceUsage);
+
+	if (AttributeToCommandType == CMD_SELECT)
+	{
+		queryStats.reads = 1;
+	}
+	else if (AttributeToCommandType == CMD_UPDATE ||
+			 AttributeToCommandType == CMD_INSERT ||
+			 AttributeToCommandType == CMD_DELETE)
+	{
+		queryStats.writes = 1;
+	}
+
+	/* local buffers are only used for temporary tables, we count them all */
+	queryStats.bufferHits =
+		(pgBufferUsage.shared_blks_hit - QueryStartBufferUsage.shared_blks_hit) +
+		(pgBufferUsage.local_blks_hit - QueryStartBufferUsage.local_blks_hit);
+	queryStats.bufferReads =
+		(pgBufferUsage.shared_blks_read - QueryStartBufferUsage.shared_blks_read) +
+		(pgBufferUsage.local_blks_read - QueryStartBufferUsage.local_blks_read);
+
+	/* only SELECT and RETURNING send the processed rows to the client */
+	if (queryDesc->estate != NULL &&
+		(queryDesc->operation == CMD_SELECT || queryDesc->plannedstmt->hasReturning))
+	{
+		queryStats.rowsReturned = queryDesc->estate->es_processed;
+	}
 
 	TimestampTz queryTime = GetCurrentTimestamp();
 
+	TenantStatsHashKey key = { 0 };
+	FillTenantStatsHashKey(&key, AttributeToTenant, AttributeToColocationGroupId);
+
+	if (StatTenantsFlushInterval > 0)
+	{
+		BatchTenantStats(&key, queryTime, &queryStats);
+	}
+	else
+	{
+		AddTenantStats(&key, queryTime, &queryStats);
+	}
+
+	AttributeToColocationGroupId = INVALID_COLOCATION_ID;
+}
+
+
+/*
+ * CpuTimeSince returns the user and system CPU time in seconds that this
+ * backend used since the given resource usage was taken.
+ */
+static double
+CpuTimeSince(struct rusage *startResourceUsage)
+{
+	struct rusage resourceUsage;
+
+	getrusage(RUSAGE_SELF, &resourceUsage);
+
+	double userTime =
+		(double) (resourceUsage.ru_utime.tv_sec - startResourceUsage->ru_utime.tv_sec) +
+		(double) (resourceUsage.ru_utime.tv_usec -
+				  startResourceUsage->ru_utime.tv_usec) / 1000000.0;
+	double systemTime =
+		(double) (resourceUsage.ru_stime.tv_sec - startResourceUsage->ru_stime.tv_sec) +
+		(double) (resourceUsage.ru_stime.tv_usec -
+				  startResourceUsage->ru_stime.tv_usec) / 1000000.0;
+
+	return userTime + systemTime;
+}
+
+
+/*
+ * AddTenantStats adds the statistics of one or more queries of a tenant to
+ * the multi tenant monitor, creating an entry for the tenant if needed.
+ */
+static void
+AddTenantStats(TenantStatsHashKey *key, TimestampTz queryTime,
+			   TenantQueryStats *queryStats)
+{
 	MultiTenantMonitor *monitor = GetMultiTenantMonitor();
 
 	/*
@@ -483,7 +645,25 @@ AttributeMetricsIfApplicable()
 	 */
 	LWLockAcquire(&monitor->lock, LW_SHARED);
 
-	TenantStats *tenantStats = FindTenantStats(monitor);
+	TenantStats *tenantStats = FindTenantStats(monitor, key);
+
+	if (tenantStats == NULL)
+	{
+		LWLockRelease(&monitor->lock);
+
+		LWLockAcquire(&monitor->lock, LW_EXCLUSIVE);
+		tenantStats = FindTenantStats(monitor, key);
+
+		if (tenantStats == NULL)
+		{
+			CreateTenantStats(monitor, key, queryTime);
+		}
+
+		LWLockRelease(&monitor->lock);
+
+		LWLockAcquire(&monitor->lock, LW_SHARED);
+		tenantStats = FindTenantStats(monitor, key);
+	}
 
 	if (tenantStats != NULL)
 	{
@@ -491,40 +671,143 @@ AttributeMetricsIfApplicable()
 
 		UpdatePeriodsIfNecessary(tenantStats, queryTime);
 		ReduceScoreIfNecessary(tenantStats, queryTime);
-		RecordTenantStats(tenantStats, queryTime);
+		RecordTenantStats(tenantStats, queryTime, queryStats);
 
 		SpinLockRelease(&tenantStats->lock);
 	}
-	else
+
+	LWLockRelease(&monitor->lock);
+}
+
+
+/*
+ * BatchTenantStats adds the statistics of a query to the batch of this
+ * backend, and flushes the batch into the multi tenant monitor once
+ * citus.stat_tenants_flush_interval passed since the last flush. The batch
+ * is also flushed when a new period starts, such that the queries are
+ * counted in the right period.
+ */
+static void
+BatchTenantStats(TenantStatsHashKey *key, TimestampTz queryTime,
+				 TenantQueryStats *queryStats)
+{
+	TimestampTz periodStart = StatTenantsPeriodStart(queryTime);
+
+	if (TenantStatsBatch == NULL)
 	{
-		LWLockRelease(&monitor->lock);
+		HASHCTL info;
 
-		LWLockAcquire(&monitor->lock, LW_EXCLUSIVE);
-		tenantStats = FindTenantStats(monitor);
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(TenantStatsHashKey);
+		info.entrysize = sizeof(TenantStatsBatchEntry);
+		info.hcxt = TopMemoryContext;
 
-		if (tenantStats == NULL)
+		TenantStatsBatch = hash_create("citus_stat_tenants batch", 32, &info,
+									   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+		if (!TenantStatsBatchExitCallbackRegistered)
 		{
-			tenantStats = CreateTenantStats(monitor, queryTime);
+			before_shmem_exit(FlushTenantStatsBatchAtExit, 0);
+			TenantStatsBatchExitCallbackRegistered = true;
 		}
 
-		LWLockRelease(&monitor->lock);
+		TenantStatsBatchFlushTime = queryTime;
+		TenantStatsBatchPeriodStart = periodStart;
+	}
+	else if (TenantStatsBatchPeriodStart != periodStart)
+	{
+		FlushTenantStatsBatch();
+		TenantStatsBatchPeriodStart = periodStart;
+	}
 
-		LWLockAcquire(&monitor->lock, LW_SHARED);
-		tenantStats = FindTenantStats(monitor);
-		if (tenantStats != NULL)
-		{
-			SpinLockAcquire(&tenantStats->lock);
+	bool found = false;
+	TenantStatsBatchEntry *entry = hash_search(TenantStatsBatch, key, HASH_ENTER,
+											   &found);
+	if (!found)
+	{
+		memset(&entry->stats, 0, sizeof(TenantQueryStats));
+	}
+
+	entry->stats.queryCount += queryStats->queryCount;
+	entry->stats.reads += queryStats->reads;
+	entry->stats.writes += queryStats->writes;
+	entry->stats.cpuUsage += queryStats->cpuUsage;
+	entry->stats.bufferHits += queryStats->bufferHits;
+	entry->stats.bufferReads += queryStats->bufferReads;
+	entry->stats.rowsReturned += queryStats->rowsReturned;
+	entry->lastQueryTime = queryTime;
+
+	if (TimestampDifferenceExceeds(TenantStatsBatchFlushTime, queryTime,
+								   StatTenantsFlushInterval))
+	{
+		FlushTenantStatsBatch();
+	}
+}
+
+
+/*
+ * FlushTenantStatsBatch adds the batched statistics of this backend to the
+ * multi tenant monitor.
+ */
+static void
+FlushTenantStatsBatch(void)
+{
+	if (TenantStatsBatch == NULL)
+	{
+		return;
+	}
 
-			UpdatePeriodsIfNecessary(tenantStats, queryTime);
-			ReduceScoreIfNecessary(tenantStats, queryTime);
-			RecordTenantStats(tenantStats, queryTime);
+	HASH_SEQ_STATUS hash_seq;
+	TenantStatsBatchEntry *entry = NULL;
 
-			SpinLockRelease(&tenantStats->lock);
+	hash_seq_init(&hash_seq, TenantStatsBatch);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		if (entry->stats.queryCount > 0)
+		{
+			AddTenantStats(&entry->key, entry->lastQueryTime, &entry->stats);
 		}
+
+		/* keep the entry, so AttributeTask skips the monitor for the tenant */
+		memset(&entry->stats, 0, sizeof(TenantQueryStats));
 	}
-	LWLockRelease(&monitor->lock);
 
-	AttributeToColocationGroupId = INVALID_COLOCATION_ID;
+	/* do not let the batch grow with every tenant we ever saw */
+	if (hash_get_num_entries(TenantStatsBatch) > StatTenantsLimit * 3)
+	{
+		hash_destroy(TenantStatsBatch);
+		TenantStatsBatch = NULL;
+	}
+
+	TenantStatsBatchFlushTime = GetCurrentTimestamp();
+}
+
+
+/*
+ * FlushTenantStatsBatchAtExit flushes the batched statistics when the backend
+ * exits normally, such that they are not lost. After an error we might still
+ * hold the monitor lock, so we rather lose the batch then.
+ */
+static void
+FlushTenantStatsBatchAtExit(int code, Datum arg)
+{
+	if (code != 0)
+	{
+		return;
+	}
+
+	FlushTenantStatsBatch();
+}
+
+
+/*
+ * StatTenantsPeriodStart returns the start of the period the given time is in.
+ */
+static TimestampTz
+StatTenantsPeriodStart(TimestampTz time)
+{
+	long long int periodInMicroSeconds = StatTenantsPeriod * USECS_PER_SEC;
+	return time - (time % periodInMicroSeconds);
 }
 
 
@@ -559,6 +842,15 @@ UpdatePeriodsIfNecessary(TenantStats *tenantStats, TimestampTz queryTime)
 
 		tenantStats->cpuUsageInLastPeriod = tenantStats->cpuUsageInThisPeriod;
 		tenantStats->cpuUsageInThisPeriod = 0;
+
+		tenantStats->bufferHitsInLastPeriod = tenantStats->bufferHitsInThisPeriod;
+		tenantStats->bufferHitsInThisPeriod = 0;
+
+		tenantStats->bufferReadsInLastPeriod = tenantStats->bufferReadsInThisPeriod;
+		tenantStats->bufferReadsInThisPeriod = 0;
+
+		tenantStats->rowsReturnedInLastPeriod = tenantStats->rowsReturnedInThisPeriod;
+		tenantStats->rowsReturnedInThisPeriod = 0;
 	}
 
 	/*
@@ -572,6 +864,12 @@ UpdatePeriodsIfNecessary(TenantStats *tenantStats, TimestampTz queryTime)
 		tenantStats->readsInLastPeriod = 0;
 
 		tenantStats->cpuUsageInLastPeriod = 0;
+
+		tenantStats->bufferHitsInLastPeriod = 0;
+
+		tenantStats->bufferReadsInLastPeriod = 0;
+
+		tenantStats->rowsReturnedInLastPeriod = 0;
 	}
 }
 
@@ -663,33 +961,30 @@ EvictTenantsIfNecessary(TimestampTz queryTime)
 
 
 /*
- * RecordTenantStats records the query statistics for the tenant.
+ * RecordTenantStats records the statistics of one or more queries for the
+ * tenant.
  */
 static void
-RecordTenantStats(TenantStats *tenantStats, TimestampTz queryTime)
+RecordTenantStats(TenantStats *tenantStats, TimestampTz queryTime,
+				  TenantQueryStats *queryStats)
 {
-	if (tenantStats->score < LLONG_MAX - ONE_QUERY_SCORE)
+	long long queryScore = (long long) ONE_QUERY_SCORE * queryStats->queryCount;
+
+	if (tenantStats->score < LLONG_MAX - queryScore)
 	{
-		tenantStats->score += ONE_QUERY_SCORE;
+		tenantStats->score += queryScore;
 	}
 	else
 	{
 		tenantStats->score = LLONG_MAX;
 	}
 
-	if (AttributeToCommandType == CMD_SELECT)
-	{
-		tenantStats->readsInThisPeriod++;
-	}
-	else if (AttributeToCommandType == CMD_UPDATE ||
-			 AttributeToCommandType == CMD_INSERT ||
-			 AttributeToCommandType == CMD_DELETE)
-	{
-		tenantStats->writesInThisPeriod++;
-	}
-
-	double queryCpuTime = ((double) (QueryEndClock - QueryStartClock)) / CLOCKS_PER_SEC;
-	tenantStats->cpuUsageInThisPeriod += queryCpuTime;
+	tenantStats->readsInThisPeriod += queryStats->reads;
+	tenantStats->writesInThisPeriod += queryStats->writes;
+	tenantStats->cpuUsageInThisPeriod += queryStats->cpuUsage;
+	tenantStats->bufferHitsInThisPeriod += queryStats->bufferHits;
+	tenantStats->bufferReadsInThisPeriod += queryStats->bufferReads;
+	tenantStats->rowsReturnedInThisPeriod += queryStats->rowsReturned;
 
 	tenantStats->lastQueryTime = queryTime;
 }
@@ -738,6 +1033,12 @@ CreateSharedMemoryForMultiTenantMonitor()
 static MultiTenantMonitor *
 GetMultiTenantMonitor()
 {
+	/* the monitor never moves, so we only look it up once per backend */
+	if (CachedMultiTenantMonitor != NULL)
+	{
+		return CachedMultiTenantMonitor;
+	}
+
 	bool found = false;
 	MultiTenantMonitor *monitor = ShmemInitStruct(SharedMemoryNameForMultiTenantMonitor,
 												  MultiTenantMonitorshmemSize(),
@@ -749,6 +1050,8 @@ GetMultiTenantMonitor()
 		return NULL;
 	}
 
+	CachedMultiTenantMonitor = monitor;
+
 	return monitor;
 }
 
@@ -786,7 +1089,8 @@ MultiTenantMonitorSMInit()
  * Calling this function should be protected by the monitor->lock in LW_EXCLUSIVE mode.
  */
 static TenantStats *
-CreateTenantStats(MultiTenantMonitor *monitor, TimestampTz queryTime)
+CreateTenantStats(MultiTenantMonitor *monitor, TenantStatsHashKey *key,
+				  TimestampTz queryTime)
 {
 	/*
 	 * If the tenant count reached 3 * StatTenantsLimit, we evict the tenants
@@ -794,10 +1098,7 @@ CreateTenantStats(MultiTenantMonitor *monitor, TimestampTz queryTime)
 	 */
 	EvictTenantsIfNecessary(queryTime);
 
-	TenantStatsHashKey key = { 0 };
-	FillTenantStatsHashKey(&key, AttributeToTenant, AttributeToColocationGroupId);
-
-	TenantStats *stats = (TenantStats *) hash_search(monitor->tenants, &key,
+	TenantStats *stats = (TenantStats *) hash_search(monitor->tenants, key,
 													 HASH_ENTER, NULL);
 
 	stats->writesInLastPeriod = 0;
@@ -806,6 +1107,12 @@ CreateTenantStats(MultiTenantMonitor *monitor, TimestampTz queryTime)
 	stats->readsInThisPeriod = 0;
 	stats->cpuUsageInLastPeriod = 0;
 	stats->cpuUsageInThisPeriod = 0;
+	stats->bufferHitsInLastPeriod = 0;
+	stats->bufferHitsInThisPeriod = 0;
+	stats->bufferReadsInLastPeriod = 0;
+	stats->bufferReadsInThisPeriod = 0;
+	stats->rowsReturnedInLastPeriod = 0;
+	stats->rowsReturnedInThisPeriod = 0;
 	stats->score = 0;
 	stats->lastScoreReduction = 0;
 
@@ -816,15 +1123,12 @@ CreateTenantStats(MultiTenantMonitor *monitor, TimestampTz queryTime)
 
 
 /*
- * FindTenantStats finds the current tenant's statistics.
+ * FindTenantStats finds the statistics of the tenant with the given key.
  */
 static TenantStats *
-FindTenantStats(MultiTenantMonitor *monitor)
+FindTenantStats(MultiTenantMonitor *monitor, TenantStatsHashKey *key)
 {
-	TenantStatsHashKey key = { 0 };
-	FillTenantStatsHashKey(&key, AttributeToTenant, AttributeToColocationGroupId);
-
-	TenantStats *stats = (TenantStats *) hash_search(monitor->tenants, &key,
+	TenantStats *stats = (TenantStats *) hash_search(monitor->tenants, key,
 													 HASH_FIND, NULL);
 
 	return stats;
@@ -0,0 +1,137 @@
+/*-------------------------------------------------------------------------
+ *
+ * citus_wait_events.c
+ *   Reports the Citus wait events of the backends on this node.
+ *
+ *   Postgres versions before 17 cannot register names for wait events of
+ *   extensions, so pg_stat_activity shows "Extension" for all of them.
+ *   citus_wait_events() translates the wait_event_info of the backends
+ *   that wait in one of the places listed in CitusWaitEvent, and
+ *   citus_stat_activity uses it to show the Citus wait event instead.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+
+#include "catalog/pg_authid.h"
+#include "storage/proc.h"
+#include "utils/acl.h"
+#include "utils/builtins.h"
+
+#include "distributed/backend_data.h"
+#include "distributed/citus_wait_events.h"
+#include "distributed/metadata_cache.h"
+#include "distributed/tuplestore.h"
+
+
+#define CITUS_WAIT_EVENTS_COLUMNS 2
+
+
+PG_FUNCTION_INFO_V1(citus_wait_events);
+
+
+/*
+ * citus_wait_events returns the pid and the name of the wait event of the
+ * backends on this node that are waiting in a Citus wait event. Like
+ * pg_stat_activity, it only shows the backends of other users to members of
+ * pg_read_all_stats.
+ */
+Datum
+citus_wait_events(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	Datum values[CITUS_WAIT_EVENTS_COLUMNS];
+	bool isNulls[CITUS_WAIT_EVENTS_COLUMNS];
+	Oid userId = GetUserId();
+	bool showAllBackends = superuser() || is_member_of_role(userId, ROLE_PG_MONITOR);
+
+	for (int procIndex = 0; procIndex < TotalProcCount(); procIndex++)
+	{
+		PGPROC *proc = GetPGProcByNumber(procIndex);
+		int pid = proc->pid;
+
+		if (pid == 0)
+		{
+			/* unused PGPROC slot */
+			continue;
+		}
+
+		/* the backend changes its wait event without locking */
+		uint32 waitEventInfo = UINT32_ACCESS_ONCE(proc->wait_event_info);
+		const char *waitEventName = CitusWaitEventName(waitEventInfo);
+		if (waitEventName == NULL)
+		{
+			continue;
+		}
+
+		if (!showAllBackends && !UserHasPermissionToViewStatsOf(userId, proc->roleId))
+		{
+			continue;
+		}
+
+		memset(values, 0, sizeof(values));
+		memset(isNulls, false, sizeof(isNulls));
+
+		values[0] = Int32GetDatum(pid);
+		values[1] = CStringGetTextDatum(waitEventName);
+
+		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+	}
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * CitusWaitEventName returns the name of the given wait event if it is one
+ * of the Citus wait events, and NULL otherwise.
+ */
+const char *
+CitusWaitEventName(uint32 waitEventInfo)
+{
+	switch (waitEventInfo)
+	{
+		case WAIT_EVENT_CITUS_CONNECTION_ESTABLISH:
+		{
+			return "CitusConnectionEstablish";
+		}
+
+		case WAIT_EVENT_CITUS_REMOTE_RESULT:
+		{
+			return "CitusRemoteResult";
+		}
+
+		case WAIT_EVENT_CITUS_SHARED_CONNECTION_SLOT:
+		{
+			return "CitusSharedConnectionSlot";
+		}
+
+		case WAIT_EVENT_CITUS_COPY_FLUSH:
+		{
+			return "CitusCopyFlush";
+		}
+
+		case WAIT_EVENT_CITUS_INTERMEDIATE_RESULT_FETCH:
+		{
+			return "CitusIntermediateResultFetch";
+		}
+
+		case WAIT_EVENT_CITUS_EXECUTOR_MEMORY:
+		{
+			return "CitusExecutorMemory";
+		}
+
+		default:
+		{
+			return NULL;
+		}
+	}
+}
@@ -3,7 +3,9 @@
  * foreign_key_relationship.c
  *   This file contains functions for creating foreign key relationship graph
  *   between distributed tables. Created relationship graph will be hold by
- *   a static variable defined in this file until an invalidation comes in.
+ *   a static variable defined in this file. Relcache invalidations of
+ *   relations mark their foreign keys as changed, and the edges of those
+ *   relations are re-read from pg_constraint before the graph is used next.
  *
  * Copyright (c) Citus Data, Inc.
  *
@@ -36,6 +38,12 @@
 #include "distributed/version_compat.h"
 
 
+/*
+ * Maximum number of relations whose foreign keys are re-read before using the
+ * graph. When more relations changed, we rebuild the whole graph instead.
+ */
+#define MAX_CHANGED_RELATION_COUNT 1024
+
 /*
  * ForeignConstraintRelationshipGraph holds the graph data structure for foreign constraint relationship
  * between relations. We will only have single static instance of that struct and it
@@ -45,6 +53,10 @@ typedef struct ForeignConstraintRelationshipGraph
 {
 	HTAB *nodeMap;
 	bool isValid;
+
+	/* relations whose foreign keys changed since the graph was updated */
+	HTAB *changedRelationSet;
+	int changedRelationCount;
 }ForeignConstraintRelationshipGraph;
 
 /*
@@ -91,6 +103,11 @@ static void PopulateAdjacencyLists(void);
 static int CompareForeignConstraintRelationshipEdges(const void *leftElement,
 													 const void *rightElement);
 static void AddForeignConstraintRelationshipEdge(Oid referencingOid, Oid referencedOid);
+static void UpdateChangedRelationEdges(void);
+static void ReplaceReferencingRelationEdges(Oid relationId);
+static List * InsertRelationshipNodeSorted(List *relationshipNodeList,
+										   ForeignConstraintRelationshipNode *node);
+static void RemoveNodeIfUnconnected(ForeignConstraintRelationshipNode *node);
 static ForeignConstraintRelationshipNode * CreateOrFindNode(HTAB *adjacencyLists, Oid
 															relid);
 static List * GetConnectedListHelper(ForeignConstraintRelationshipNode *node,
@@ -318,10 +335,15 @@ GetRelationshipNodeForRelationId(Oid relationId, bool *isFound)
 static void
 CreateForeignConstraintRelationshipGraph()
 {
-	/* if we have already created the graph, use it */
+	/* if we have already created the graph, bring it up to date and use it */
 	if (IsForeignConstraintRelationshipGraphValid())
 	{
-		return;
+		UpdateChangedRelationEdges();
+
+		if (fConstraintRelationshipGraph->isValid)
+		{
+			return;
+		}
 	}
 
 	/*
@@ -361,6 +383,9 @@ CreateForeignConstraintRelationshipGraph()
 
 	fConstraintRelationshipGraph->nodeMap = CreateSimpleHash(Oid,
 															 ForeignConstraintRelationshipNode);
+	fConstraintRelationshipGraph->changedRelationSet =
+		CreateSimpleHashSetWithName(Oid, "changed foreign key relations");
+	fConstraintRelationshipGraph->changedRelationCount = 0;
 
 	PopulateAdjacencyLists();
 
@@ -403,6 +428,222 @@ SetForeignConstraintRelationshipGraphInvalid()
 }
 
 
+/*
+ * MarkForeignConstraintRelationshipsChanged records that the foreign keys of
+ * the given relation may have changed, such that its edges are re-read before
+ * the graph is used next. PostgreSQL invalidates the relcache entry of the
+ * referencing relation whenever a foreign key is added, dropped or altered,
+ * so re-reading the foreign keys that the changed relations reference keeps
+ * the graph complete.
+ *
+ * This is called from a relcache invalidation callback, so it does not access
+ * the catalogs.
+ */
+void
+MarkForeignConstraintRelationshipsChanged(Oid relationId)
+{
+	if (fConstraintRelationshipGraph == NULL || !fConstraintRelationshipGraph->isValid)
+	{
+		/* the graph is rebuilt from scratch anyway */
+		return;
+	}
+
+	if (!OidIsValid(relationId) ||
+		fConstraintRelationshipGraph->changedRelationCount >= MAX_CHANGED_RELATION_COUNT)
+	{
+		/* all relations may have changed or re-reading would take longer */
+		fConstraintRelationshipGraph->isValid = false;
+		return;
+	}
+
+	bool found = false;
+	hash_search(fConstraintRelationshipGraph->changedRelationSet, &relationId,
+				HASH_ENTER, &found);
+	if (!found)
+	{
+		fConstraintRelationshipGraph->changedRelationCount++;
+	}
+}
+
+
+/*
+ * UpdateChangedRelationEdges re-reads the foreign keys of the relations that
+ * were marked as changed since the graph was last used.
+ */
+static void
+UpdateChangedRelationEdges(void)
+{
+	if (fConstraintRelationshipGraph->changedRelationCount == 0)
+	{
+		return;
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(
+		ForeignConstraintRelationshipMemoryContext);
+
+	/* copy the set, invalidations may come in while we read the catalog */
+	List *changedRelationIdList = NIL;
+	HASH_SEQ_STATUS status;
+	Oid *changedRelationId = NULL;
+
+	hash_seq_init(&status, fConstraintRelationshipGraph->changedRelationSet);
+	while ((changedRelationId = hash_seq_search(&status)) != NULL)
+	{
+		changedRelationIdList = lappend_oid(changedRelationIdList, *changedRelationId);
+	}
+
+	Oid relationId = InvalidOid;
+	foreach_oid(relationId, changedRelationIdList)
+	{
+		hash_search(fConstraintRelationshipGraph->changedRelationSet, &relationId,
+					HASH_REMOVE, NULL);
+		fConstraintRelationshipGraph->changedRelationCount--;
+	}
+
+	foreach_oid(relationId, changedRelationIdList)
+	{
+		ReplaceReferencingRelationEdges(relationId);
+
+		if (!fConstraintRelationshipGraph->isValid)
+		{
+			/* a full invalidation came in, the graph is rebuilt on next use */
+			break;
+		}
+	}
+
+	list_free(changedRelationIdList);
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * ReplaceReferencingRelationEdges replaces the edges from the given relation
+ * to the relations it references with the foreign keys of the relation in
+ * pg_constraint.
+ */
+static void
+ReplaceReferencingRelationEdges(Oid relationId)
+{
+	bool isFound = false;
+	ForeignConstraintRelationshipNode *referencingNode =
+		(ForeignConstraintRelationshipNode *) hash_search(
+			fConstraintRelationshipGraph->nodeMap, &relationId, HASH_FIND, &isFound);
+
+	if (isFound)
+	{
+		ForeignConstraintRelationshipNode *referencedNode = NULL;
+		foreach_ptr(referencedNode, referencingNode->adjacencyList)
+		{
+			referencedNode->backAdjacencyList =
+				list_delete_ptr(referencedNode->backAdjacencyList, referencingNode);
+
+			if (referencedNode != referencingNode)
+			{
+				RemoveNodeIfUnconnected(referencedNode);
+			}
+		}
+
+		list_free(referencingNode->adjacencyList);
+		referencingNode->adjacencyList = NIL;
+	}
+
+	ScanKeyData scanKey[2];
+	int scanKeyCount = 2;
+
+	Relation pgConstraint = table_open(ConstraintRelationId, AccessShareLock);
+
+	ScanKeyInit(&scanKey[0], Anum_pg_constraint_conrelid, BTEqualStrategyNumber,
+				F_OIDEQ, ObjectIdGetDatum(relationId));
+	ScanKeyInit(&scanKey[1], Anum_pg_constraint_contypid, BTEqualStrategyNumber,
+				F_OIDEQ, ObjectIdGetDatum(InvalidOid));
+	SysScanDesc scanDescriptor = systable_beginscan(pgConstraint,
+													ConstraintRelidTypidNameIndexId,
+													true, NULL, scanKeyCount, scanKey);
+
+	HeapTuple tuple = NULL;
+	while (HeapTupleIsValid(tuple = systable_getnext(scanDescriptor)))
+	{
+		Form_pg_constraint constraintForm = (Form_pg_constraint) GETSTRUCT(tuple);
+		if (constraintForm->contype != CONSTRAINT_FOREIGN)
+		{
+			continue;
+		}
+
+		referencingNode = CreateOrFindNode(fConstraintRelationshipGraph->nodeMap,
+										   relationId);
+		ForeignConstraintRelationshipNode *referencedNode =
+			CreateOrFindNode(fConstraintRelationshipGraph->nodeMap,
+							 constraintForm->confrelid);
+
+		if (list_member_ptr(referencingNode->adjacencyList, referencedNode))
+		{
+			/* multiple foreign keys between the same relations are a single edge */
+			continue;
+		}
+
+		/* keep the lists ordered like a graph built from scratch */
+		referencingNode->adjacencyList =
+			InsertRelationshipNodeSorted(referencingNode->adjacencyList,
+										 referencedNode);
+		referencedNode->backAdjacencyList =
+			InsertRelationshipNodeSorted(referencedNode->backAdjacencyList,
+										 referencingNode);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgConstraint, AccessShareLock);
+
+	referencingNode = (ForeignConstraintRelationshipNode *) hash_search(
+		fConstraintRelationshipGraph->nodeMap, &relationId, HASH_FIND, &isFound);
+	if (isFound)
+	{
+		RemoveNodeIfUnconnected(referencingNode);
+	}
+}
+
+
+/*
+ * InsertRelationshipNodeSorted inserts the given node into the given list of
+ * nodes ordered by relation id.
+ */
+static List *
+InsertRelationshipNodeSorted(List *relationshipNodeList,
+							 ForeignConstraintRelationshipNode *node)
+{
+	int position = 0;
+
+	ForeignConstraintRelationshipNode *currentNode = NULL;
+	foreach_ptr(currentNode, relationshipNodeList)
+	{
+		if (currentNode->relationId > node->relationId)
+		{
+			break;
+		}
+
+		position++;
+	}
+
+	return list_insert_nth(relationshipNodeList, position, node);
+}
+
+
+/*
+ * RemoveNodeIfUnconnected removes the given node from the graph when it has
+ * no edges left, since relations without foreign keys are not in the graph.
+ */
+static void
+RemoveNodeIfUnconnected(ForeignConstraintRelationshipNode *node)
+{
+	if (node->adjacencyList != NIL || node->backAdjacencyList != NIL)
+	{
+		return;
+	}
+
+	Oid relationId = node->relationId;
+	hash_search(fConstraintRelationshipGraph->nodeMap, &relationId, HASH_REMOVE, NULL);
+}
+
+
 /*
  * GetConnectedListHelper returns list of ForeignConstraintRelationshipNode
  * objects for relations referenced by or referencing to given relation
@@ -71,6 +71,39 @@ SortList(List *pointerList, int (*comparisonFunction)(const void *, const void *
 }
 
 
+/*
+ * SortedListInsert inserts a pointer into a list of pointers that is sorted by
+ * the given comparison function, such that the list stays sorted. The position
+ * is found with a binary search, which is much cheaper than appending the
+ * pointer and sorting the whole list again. The comparison function is of the
+ * same form as the one of SortList.
+ */
+List *
+SortedListInsert(List *sortedList, void *pointer,
+				 int (*comparisonFunction)(const void *, const void *))
+{
+	int lowIndex = 0;
+	int highIndex = list_length(sortedList);
+
+	while (lowIndex < highIndex)
+	{
+		int middleIndex = lowIndex + (highIndex - lowIndex) / 2;
+		void *middlePointer = list_nth(sortedList, middleIndex);
+
+		if (comparisonFunction(&pointer, &middlePointer) < 0)
+		{
+			highIndex = middleIndex;
+		}
+		else
+		{
+			lowIndex = middleIndex + 1;
+		}
+	}
+
+	return list_insert_nth(sortedList, lowIndex, pointer);
+}
+
+
 /*
  * PointerArrayFromList converts a list of pointers to an array of pointers.
  */
@@ -43,6 +43,7 @@
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/snapmgr.h"
 
 #include "citus_version.h"
 #include "pg_version_constants.h"
@@ -51,14 +52,22 @@
 #include "distributed/citus_safe_lib.h"
 #include "distributed/coordinator_protocol.h"
 #include "distributed/distributed_deadlock_detection.h"
+#include "distributed/health_check.h"
 #include "distributed/maintenanced.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/metadata_sync.h"
 #include "distributed/query_stats.h"
+#include "distributed/listutils.h"
 #include "distributed/resource_lock.h"
+#include "distributed/router_proxy.h"
 #include "distributed/shard_cleaner.h"
+#include "distributed/shard_column_statistics.h"
+#include "distributed/shard_size_cache.h"
+#include "distributed/shard_split.h"
+#include "distributed/shared_library_init.h"
 #include "distributed/statistics_collection.h"
 #include "distributed/transaction_recovery.h"
+#include "distributed/tuplestore.h"
 #include "distributed/version_compat.h"
 
 /*
@@ -77,6 +86,19 @@ typedef struct MaintenanceDaemonControlData
 } MaintenanceDaemonControlData;
 
 
+/*
+ * Timings of a duty of the maintenance daemon, in milliseconds.
+ */
+typedef struct MaintenanceDutyStats
+{
+	int64 runCount;
+	TimestampTz lastStartTime;
+	double lastDuration;
+	double maxDuration;
+	double totalDuration;
+} MaintenanceDutyStats;
+
+
 /*
  * Per database worker state.
  */
@@ -91,13 +113,22 @@ typedef struct MaintenanceDaemonDBData
 	bool daemonStarted;
 	bool triggerNodeMetadataSync;
 	Latch *latch; /* pointer to the background worker's latch */
+
+	/* timings of the duties, protected by MaintenanceDaemonControl->lock */
+	MaintenanceDutyStats dutyStats[MAINTENANCE_DUTY_COUNT];
 } MaintenanceDaemonDBData;
 
 /* config variable for distributed deadlock detection timeout */
 double DistributedDeadlockDetectionTimeoutFactor = 2.0;
 int Recover2PCInterval = 60000;
+bool Recover2PCInBackgroundWorker = false;
 int DeferShardDeleteInterval = 15000;
 int BackgroundTaskQueueCheckInterval = 5000;
+int ColumnarStripeCompactionInterval = -1;
+int ShardColumnStatisticsRefreshInterval = 60000;
+int ShardSizeCacheRefreshInterval = 60000;
+int NodeHealthCheckInterval = 0;
+int TenantIsolationCheckInterval = -1;
 int MaxBackgroundTaskExecutors = 4;
 char *MainDb = "";
 
@@ -105,6 +136,25 @@ char *MainDb = "";
 int MetadataSyncInterval = 60000;
 int MetadataSyncRetryInterval = 5000;
 
+/* names of the duties in citus_maintenance_daemon_duties() */
+static const char *const MaintenanceDutyNames[MAINTENANCE_DUTY_COUNT] = {
+	[MAINTENANCE_DUTY_STATISTICS_COLLECTION] = "statistics_collection",
+	[MAINTENANCE_DUTY_METADATA_SYNC_CHECK] = "metadata_sync_check",
+	[MAINTENANCE_DUTY_2PC_RECOVERY] = "2pc_recovery",
+	[MAINTENANCE_DUTY_DEADLOCK_DETECTION] = "deadlock_detection",
+	[MAINTENANCE_DUTY_SHARD_CLEANUP] = "shard_cleanup",
+	[MAINTENANCE_DUTY_STAT_STATEMENTS_PURGE] = "stat_statements_purge",
+	[MAINTENANCE_DUTY_COLUMNAR_STRIPE_COMPACTION] = "columnar_stripe_compaction",
+	[MAINTENANCE_DUTY_SHARD_COLUMN_STATISTICS_REFRESH] =
+		"shard_column_statistics_refresh",
+	[MAINTENANCE_DUTY_SHARD_SIZE_CACHE_REFRESH] = "shard_size_cache_refresh",
+	[MAINTENANCE_DUTY_NODE_HEALTH_CHECK] = "node_health_check",
+	[MAINTENANCE_DUTY_TENANT_ISOLATION_CHECK] = "tenant_isolation_check",
+	[MAINTENANCE_DUTY_BACKGROUND_TASK_QUEUE_CHECK] = "background_task_queue_check",
+};
+
+#define MAINTENANCE_DAEMON_DUTIES_COLUMNS 6
+
 static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 static MaintenanceDaemonControlData *MaintenanceDaemonControl = NULL;
 
@@ -120,11 +170,18 @@ static volatile sig_atomic_t got_SIGTERM = false;
 /* set to true when becoming a maintenance daemon */
 static bool IsMaintenanceDaemon = false;
 
+PG_FUNCTION_INFO_V1(citus_maintenance_daemon_duties);
+
 static void MaintenanceDaemonSigTermHandler(SIGNAL_ARGS);
 static void MaintenanceDaemonSigHupHandler(SIGNAL_ARGS);
 static void MaintenanceDaemonShmemExit(int code, Datum arg);
 static void MaintenanceDaemonErrorContext(void *arg);
 static bool MetadataSyncTriggeredCheckAndReset(MaintenanceDaemonDBData *dbData);
+static uint64 CompactColumnarTables(void);
+static void ProbeNodeHealthInTransaction(void);
+static void ScheduleHotTenantIsolationInTransaction(void);
+static uint64 RefreshShardColumnStatistics(void);
+static uint64 RefreshShardSizeCacheInTransaction(void);
 static void WarnMaintenanceDaemonNotStarted(void);
 static MaintenanceDaemonDBData * GetMaintenanceDaemonDBHashEntry(Oid databaseId,
 																 bool *found);
@@ -489,6 +546,11 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 	TimestampTz lastRecoveryTime = 0;
 	TimestampTz lastShardCleanTime = 0;
 	TimestampTz lastStatStatementsPurgeTime = 0;
+	TimestampTz lastColumnarStripeCompactionTime = 0;
+	TimestampTz lastShardColumnStatisticsRefreshTime = 0;
+	TimestampTz lastShardSizeCacheRefreshTime = 0;
+	TimestampTz lastNodeHealthCheckTime = 0;
+	TimestampTz lastTenantIsolationCheckTime = 0;
 	TimestampTz nextMetadataSyncTime = 0;
 
 	/* state kept for the background tasks queue monitor */
@@ -503,6 +565,9 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 	 */
 	BackgroundWorkerHandle *metadataSyncBgwHandle = NULL;
 
+	/* 2PC recovery may also run in a separate background worker */
+	BackgroundWorkerHandle *transactionRecoveryBgwHandle = NULL;
+
 	MaintenanceDaemonDBData *myDbData = ConnectToDatabase(databaseOid);
 
 	/* make worker recognizable in pg_stat_activity */
@@ -544,6 +609,7 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 		if (EnableStatisticsCollection &&
 			GetCurrentTimestamp() >= nextStatsCollectionTime)
 		{
+			TimestampTz dutyStartTime = GetCurrentTimestamp();
 			bool statsCollectionSuccess = false;
 			InvalidateMetadataSystemCache();
 			StartTransactionCommand();
@@ -590,6 +656,10 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 			}
 
 			CommitTransactionCommand();
+
+			RecordMaintenanceDutyTime(MyDatabaseId,
+									  MAINTENANCE_DUTY_STATISTICS_COLLECTION,
+									  dutyStartTime);
 		}
 #endif
 
@@ -621,6 +691,8 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 				metadataSyncBgwHandle = NULL;
 			}
 
+			TimestampTz dutyStartTime = GetCurrentTimestamp();
+
 			InvalidateMetadataSystemCache();
 			StartTransactionCommand();
 			PushActiveSnapshot(GetTransactionSnapshot());
@@ -651,6 +723,9 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 			PopActiveSnapshot();
 			CommitTransactionCommand();
 
+			RecordMaintenanceDutyTime(MyDatabaseId, MAINTENANCE_DUTY_METADATA_SYNC_CHECK,
+									  dutyStartTime);
+
 			if (syncMetadata)
 			{
 				metadataSyncBgwHandle =
@@ -665,12 +740,50 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 		/*
 		 * If enabled, run 2PC recovery on primary nodes (where !RecoveryInProgress()),
 		 * since we'll write to the pg_dist_transaction log.
+		 *
+		 * With citus.recover_2pc_in_background_worker, each pass runs in a
+		 * background worker of its own, such that a slow pass does not hold up
+		 * deadlock detection and the other duties. A new pass is only started
+		 * once the previous one finished.
 		 */
-		if (Recover2PCInterval > 0 && !RecoveryInProgress() &&
+		pid_t transactionRecoveryBgwPid = 0;
+		BgwHandleStatus transactionRecoveryStatus =
+			transactionRecoveryBgwHandle != NULL ?
+			GetBackgroundWorkerPid(transactionRecoveryBgwHandle,
+								   &transactionRecoveryBgwPid) :
+			BGWH_STOPPED;
+
+		if (Recover2PCInBackgroundWorker && Recover2PCInterval > 0 &&
+			!RecoveryInProgress() && transactionRecoveryStatus == BGWH_STOPPED &&
 			TimestampDifferenceExceeds(lastRecoveryTime, GetCurrentTimestamp(),
 									   Recover2PCInterval))
+		{
+			if (transactionRecoveryBgwHandle)
+			{
+				pfree(transactionRecoveryBgwHandle);
+				transactionRecoveryBgwHandle = NULL;
+			}
+
+			lastRecoveryTime = GetCurrentTimestamp();
+
+			transactionRecoveryBgwHandle =
+				SpawnTransactionRecoveryWorker(MyDatabaseId, myDbData->userOid);
+			if (transactionRecoveryBgwHandle == NULL)
+			{
+				ereport(WARNING, (errmsg("unable to start background worker for "
+										 "2PC recovery")));
+			}
+
+			/* make sure we don't wait too long */
+			timeout = Min(timeout, Recover2PCInterval);
+		}
+		else if (!Recover2PCInBackgroundWorker && Recover2PCInterval > 0 &&
+				 !RecoveryInProgress() &&
+				 TimestampDifferenceExceeds(lastRecoveryTime, GetCurrentTimestamp(),
+											Recover2PCInterval))
 		{
 			int recoveredTransactionCount = 0;
+			TimestampTz dutyStartTime = GetCurrentTimestamp();
 
 			InvalidateMetadataSystemCache();
 			StartTransactionCommand();
@@ -693,6 +806,9 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 
 			CommitTransactionCommand();
 
+			RecordMaintenanceDutyTime(MyDatabaseId, MAINTENANCE_DUTY_2PC_RECOVERY,
+									  dutyStartTime);
+
 			if (recoveredTransactionCount > 0)
 			{
 				ereport(LOG, (errmsg("maintenance daemon recovered %d distributed "
@@ -709,6 +825,7 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 		{
 			double deadlockTimeout =
 				DistributedDeadlockDetectionTimeoutFactor * (double) DeadlockTimeout;
+			TimestampTz dutyStartTime = GetCurrentTimestamp();
 
 			InvalidateMetadataSystemCache();
 			StartTransactionCommand();
@@ -733,6 +850,9 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 
 			CommitTransactionCommand();
 
+			RecordMaintenanceDutyTime(MyDatabaseId, MAINTENANCE_DUTY_DEADLOCK_DETECTION,
+									  dutyStartTime);
+
 			/*
 			 * If we find any deadlocks, run the distributed deadlock detection
 			 * more often since it is quite possible that there are other
@@ -757,6 +877,7 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 									   DeferShardDeleteInterval))
 		{
 			int numberOfDroppedResources = 0;
+			TimestampTz dutyStartTime = GetCurrentTimestamp();
 
 			InvalidateMetadataSystemCache();
 			StartTransactionCommand();
@@ -779,6 +900,9 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 
 			CommitTransactionCommand();
 
+			RecordMaintenanceDutyTime(MyDatabaseId, MAINTENANCE_DUTY_SHARD_CLEANUP,
+									  dutyStartTime);
+
 			if (numberOfDroppedResources > 0)
 			{
 				ereport(LOG, (errmsg("maintenance daemon dropped %d "
@@ -795,6 +919,8 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 			TimestampDifferenceExceeds(lastStatStatementsPurgeTime, GetCurrentTimestamp(),
 									   (StatStatementsPurgeInterval * 1000)))
 		{
+			TimestampTz dutyStartTime = GetCurrentTimestamp();
+
 			StartTransactionCommand();
 
 			if (!LockCitusExtension())
@@ -815,10 +941,118 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 
 			CommitTransactionCommand();
 
+			RecordMaintenanceDutyTime(MyDatabaseId, MAINTENANCE_DUTY_STAT_STATEMENTS_PURGE,
+									  dutyStartTime);
+
 			/* make sure we don't wait too long, need to convert seconds to milliseconds */
 			timeout = Min(timeout, (StatStatementsPurgeInterval * 1000));
 		}
 
+		if (!RecoveryInProgress() && ColumnarStripeCompactionInterval > 0 &&
+			TimestampDifferenceExceeds(lastColumnarStripeCompactionTime,
+									   GetCurrentTimestamp(),
+									   ColumnarStripeCompactionInterval))
+		{
+			/*
+			 * Record last compaction time at start to ensure we run once per
+			 * ColumnarStripeCompactionInterval even if compaction takes some
+			 * time.
+			 */
+			lastColumnarStripeCompactionTime = GetCurrentTimestamp();
+
+			uint64 mergedStripeCount = CompactColumnarTables();
+			RecordMaintenanceDutyTime(MyDatabaseId,
+									  MAINTENANCE_DUTY_COLUMNAR_STRIPE_COMPACTION,
+									  lastColumnarStripeCompactionTime);
+
+			if (mergedStripeCount > 0)
+			{
+				ereport(LOG, (errmsg("maintenance daemon merged " UINT64_FORMAT
+									 " small columnar stripes",
+									 mergedStripeCount)));
+			}
+
+			/* make sure we don't wait too long */
+			timeout = Min(timeout, ColumnarStripeCompactionInterval);
+		}
+
+		if (!RecoveryInProgress() && ShardColumnStatisticsRefreshInterval > 0 &&
+			TimestampDifferenceExceeds(lastShardColumnStatisticsRefreshTime,
+									   GetCurrentTimestamp(),
+									   ShardColumnStatisticsRefreshInterval))
+		{
+			lastShardColumnStatisticsRefreshTime = GetCurrentTimestamp();
+
+			uint64 refreshedShardCount = RefreshShardColumnStatistics();
+			RecordMaintenanceDutyTime(MyDatabaseId,
+									  MAINTENANCE_DUTY_SHARD_COLUMN_STATISTICS_REFRESH,
+									  lastShardColumnStatisticsRefreshTime);
+
+			if (refreshedShardCount > 0)
+			{
+				ereport(DEBUG1, (errmsg("maintenance daemon collected the column "
+										"statistics of " UINT64_FORMAT " shards",
+										refreshedShardCount)));
+			}
+
+			/* make sure we don't wait too long */
+			timeout = Min(timeout, ShardColumnStatisticsRefreshInterval);
+		}
+
+		if (!RecoveryInProgress() && ShardSizeCacheSize > 0 &&
+			ShardSizeCacheRefreshInterval > 0 &&
+			TimestampDifferenceExceeds(lastShardSizeCacheRefreshTime,
+									   GetCurrentTimestamp(),
+									   ShardSizeCacheRefreshInterval))
+		{
+			lastShardSizeCacheRefreshTime = GetCurrentTimestamp();
+
+			uint64 cachedPlacementCount = RefreshShardSizeCacheInTransaction();
+			RecordMaintenanceDutyTime(MyDatabaseId,
+									  MAINTENANCE_DUTY_SHARD_SIZE_CACHE_REFRESH,
+									  lastShardSizeCacheRefreshTime);
+
+			if (cachedPlacementCount > 0)
+			{
+				ereport(DEBUG1, (errmsg("maintenance daemon cached the sizes of "
+										UINT64_FORMAT " shard placements",
+										cachedPlacementCount)));
+			}
+
+			/* make sure we don't wait too long */
+			timeout = Min(timeout, ShardSizeCacheRefreshInterval);
+		}
+
+		if (NodeHealthCheckInterval > 0 &&
+			TimestampDifferenceExceeds(lastNodeHealthCheckTime, GetCurrentTimestamp(),
+									   NodeHealthCheckInterval))
+		{
+			lastNodeHealthCheckTime = GetCurrentTimestamp();
+
+			ProbeNodeHealthInTransaction();
+			RecordMaintenanceDutyTime(MyDatabaseId, MAINTENANCE_DUTY_NODE_HEALTH_CHECK,
+									  lastNodeHealthCheckTime);
+
+			/* make sure we don't wait too long */
+			timeout = Min(timeout, NodeHealthCheckInterval);
+		}
+
+		if (!RecoveryInProgress() && TenantIsolationCheckInterval > 0 &&
+			TimestampDifferenceExceeds(lastTenantIsolationCheckTime,
+									   GetCurrentTimestamp(),
+									   TenantIsolationCheckInterval))
+		{
+			lastTenantIsolationCheckTime = GetCurrentTimestamp();
+
+			ScheduleHotTenantIsolationInTransaction();
+			RecordMaintenanceDutyTime(MyDatabaseId,
+									  MAINTENANCE_DUTY_TENANT_ISOLATION_CHECK,
+									  lastTenantIsolationCheckTime);
+
+			/* make sure we don't wait too long */
+			timeout = Min(timeout, TenantIsolationCheckInterval);
+		}
+
 		pid_t backgroundTaskQueueWorkerPid = 0;
 		BgwHandleStatus backgroundTaskQueueWorkerStatus =
 			backgroundTasksQueueBgwHandle != NULL ? GetBackgroundWorkerPid(
@@ -837,6 +1071,8 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 				backgroundTasksQueueBgwHandle = NULL;
 			}
 
+			TimestampTz dutyStartTime = GetCurrentTimestamp();
+
 			StartTransactionCommand();
 
 			bool shouldStartBackgroundTaskQueueBackgroundWorker = false;
@@ -854,6 +1090,10 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 
 			CommitTransactionCommand();
 
+			RecordMaintenanceDutyTime(MyDatabaseId,
+									  MAINTENANCE_DUTY_BACKGROUND_TASK_QUEUE_CHECK,
+									  dutyStartTime);
+
 			if (shouldStartBackgroundTaskQueueBackgroundWorker)
 			{
 				/*
@@ -921,6 +1161,12 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 			timeout = Min(timeout, BackgroundTaskQueueCheckInterval);
 		}
 
+		/*
+		 * Keep citus.router_proxy_workers router proxies running. We are their
+		 * notify_pid, so we wake up when one of them exits.
+		 */
+		MaintainRouterProxyWorkers(myDbData->userOid);
+
 		/*
 		 * Wait until timeout, or until somebody wakes us up. Also cast the timeout to
 		 * integer where we've calculated it using double for not losing the precision.
@@ -966,6 +1212,215 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 	{
 		TerminateBackgroundWorker(metadataSyncBgwHandle);
 	}
+
+	if (transactionRecoveryBgwHandle)
+	{
+		TerminateBackgroundWorker(transactionRecoveryBgwHandle);
+	}
+}
+
+
+/*
+ * CompactColumnarTables merges the small stripes of the columnar tables in
+ * the database, using a separate transaction for each table so that we don't
+ * keep the tables locked for long, and returns the number of stripes that
+ * were merged.
+ */
+static uint64
+CompactColumnarTables(void)
+{
+	uint64 mergedStripeCount = 0;
+	List *relationIdList = NIL;
+
+	/* the list of tables needs to survive the transactions */
+	MemoryContext compactionContext = AllocSetContextCreate(TopMemoryContext,
+															"Columnar Compaction Context",
+															ALLOCSET_DEFAULT_SIZES);
+
+	InvalidateMetadataSystemCache();
+	StartTransactionCommand();
+
+	if (!LockCitusExtension())
+	{
+		ereport(DEBUG1, (errmsg("could not lock the citus extension, "
+								"skipping columnar stripe compaction")));
+	}
+	else if (CheckCitusVersion(DEBUG1) && CitusHasBeenLoaded())
+	{
+		List *columnarTableList = extern_ColumnarTableRelationIdList();
+
+		MemoryContext oldContext = MemoryContextSwitchTo(compactionContext);
+		relationIdList = list_copy(columnarTableList);
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	CommitTransactionCommand();
+
+	Oid relationId = InvalidOid;
+	foreach_oid(relationId, relationIdList)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (got_SIGTERM)
+		{
+			break;
+		}
+
+		StartTransactionCommand();
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		mergedStripeCount += extern_ColumnarCompactSmallStripes(relationId);
+
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+	}
+
+	MemoryContextDelete(compactionContext);
+
+	return mergedStripeCount;
+}
+
+
+/*
+ * RefreshShardColumnStatistics collects the invalidated column statistics of
+ * the shards of distributed tables, using a separate transaction for each
+ * table so that we don't block writes to the tables for long, and returns the
+ * number of shards whose statistics were collected.
+ */
+static uint64
+RefreshShardColumnStatistics(void)
+{
+	uint64 refreshedShardCount = 0;
+	List *relationIdList = NIL;
+
+	/* the list of tables needs to survive the transactions */
+	MemoryContext refreshContext = AllocSetContextCreate(TopMemoryContext,
+														 "Shard Column Statistics Context",
+														 ALLOCSET_DEFAULT_SIZES);
+
+	InvalidateMetadataSystemCache();
+	StartTransactionCommand();
+
+	if (!LockCitusExtension())
+	{
+		ereport(DEBUG1, (errmsg("could not lock the citus extension, "
+								"skipping shard column statistics collection")));
+	}
+	else if (CheckCitusVersion(DEBUG1) && CitusHasBeenLoaded() && IsCoordinator())
+	{
+		List *staleRelationIdList = RelationIdsWithStaleShardColumnStatistics();
+
+		MemoryContext oldContext = MemoryContextSwitchTo(refreshContext);
+		relationIdList = list_copy(staleRelationIdList);
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	CommitTransactionCommand();
+
+	Oid relationId = InvalidOid;
+	foreach_oid(relationId, relationIdList)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (got_SIGTERM)
+		{
+			break;
+		}
+
+		StartTransactionCommand();
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		refreshedShardCount += TryRefreshStaleShardColumnStatistics(relationId);
+
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+	}
+
+	MemoryContextDelete(refreshContext);
+
+	return refreshedShardCount;
+}
+
+
+/*
+ * RefreshShardSizeCacheInTransaction collects the sizes of the placements of
+ * all Citus tables into the shard size cache, see RefreshShardSizeCache, and
+ * returns the number of placements whose sizes were cached.
+ */
+static uint64
+RefreshShardSizeCacheInTransaction(void)
+{
+	uint64 cachedPlacementCount = 0;
+
+	InvalidateMetadataSystemCache();
+	StartTransactionCommand();
+
+	if (!LockCitusExtension())
+	{
+		ereport(DEBUG1, (errmsg("could not lock the citus extension, "
+								"skipping shard size collection")));
+	}
+	else if (CheckCitusVersion(DEBUG1) && CitusHasBeenLoaded() && IsCoordinator())
+	{
+		PushActiveSnapshot(GetTransactionSnapshot());
+		cachedPlacementCount = RefreshShardSizeCache(InvalidOid);
+		PopActiveSnapshot();
+	}
+
+	CommitTransactionCommand();
+
+	return cachedPlacementCount;
+}
+
+
+/*
+ * ScheduleHotTenantIsolationInTransaction schedules a background job that
+ * isolates and moves a hot tenant, see ScheduleHotTenantIsolation. The job is
+ * picked up by the background task queue monitor.
+ */
+static void
+ScheduleHotTenantIsolationInTransaction(void)
+{
+	InvalidateMetadataSystemCache();
+	StartTransactionCommand();
+
+	if (!LockCitusExtension())
+	{
+		ereport(DEBUG1, (errmsg("could not lock the citus extension, "
+								"skipping tenant isolation checks")));
+	}
+	else if (CheckCitusVersion(DEBUG1) && CitusHasBeenLoaded() && IsCoordinator())
+	{
+		PushActiveSnapshot(GetTransactionSnapshot());
+		ScheduleHotTenantIsolation();
+		PopActiveSnapshot();
+	}
+
+	CommitTransactionCommand();
+}
+
+
+/*
+ * ProbeNodeHealthInTransaction probes the health of the nodes in the cluster,
+ * see ProbeNodeHealth.
+ */
+static void
+ProbeNodeHealthInTransaction(void)
+{
+	InvalidateMetadataSystemCache();
+	StartTransactionCommand();
+
+	if (!LockCitusExtension())
+	{
+		ereport(DEBUG1, (errmsg("could not lock the citus extension, "
+								"skipping node health checks")));
+	}
+	else if (CheckCitusVersion(DEBUG1) && CitusHasBeenLoaded())
+	{
+		ProbeNodeHealth();
+	}
+
+	CommitTransactionCommand();
 }
 
 
@@ -1071,6 +1526,8 @@ MaintenanceDaemonShmemExit(int code, Datum arg)
 	}
 
 	LWLockRelease(&MaintenanceDaemonControl->lock);
+
+	StopRouterProxyWorkers();
 }
 
 
@@ -1227,3 +1684,93 @@ MetadataSyncTriggeredCheckAndReset(MaintenanceDaemonDBData *dbData)
 
 	return metadataSyncTriggered;
 }
+
+
+/*
+ * RecordMaintenanceDutyTime adds the time since the given start time to the
+ * timings of the given duty of the maintenance daemon of the given database.
+ */
+void
+RecordMaintenanceDutyTime(Oid databaseId, MaintenanceDaemonDuty duty,
+						  TimestampTz startTime)
+{
+	long durationSeconds = 0;
+	int durationMicrosecs = 0;
+	TimestampDifference(startTime, GetCurrentTimestamp(), &durationSeconds,
+						&durationMicrosecs);
+	double duration = durationSeconds * 1000.0 + durationMicrosecs / 1000.0;
+
+	LWLockAcquire(&MaintenanceDaemonControl->lock, LW_EXCLUSIVE);
+
+	MaintenanceDaemonDBData *dbData = (MaintenanceDaemonDBData *) hash_search(
+		MaintenanceDaemonDBHash,
+		&databaseId,
+		HASH_FIND, NULL);
+	if (dbData != NULL)
+	{
+		MaintenanceDutyStats *dutyStats = &dbData->dutyStats[duty];
+
+		dutyStats->runCount++;
+		dutyStats->lastStartTime = startTime;
+		dutyStats->lastDuration = duration;
+		dutyStats->maxDuration = Max(dutyStats->maxDuration, duration);
+		dutyStats->totalDuration += duration;
+	}
+
+	LWLockRelease(&MaintenanceDaemonControl->lock);
+}
+
+
+/*
+ * citus_maintenance_daemon_duties returns the timings of the duties of the
+ * maintenance daemon of the current database, in milliseconds, since the
+ * maintenance daemon was first started for the database.
+ */
+Datum
+citus_maintenance_daemon_duties(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupTuplestore(fcinfo, &tupleDescriptor);
+	Datum values[MAINTENANCE_DAEMON_DUTIES_COLUMNS];
+	bool isNulls[MAINTENANCE_DAEMON_DUTIES_COLUMNS];
+	MaintenanceDutyStats dutyStats[MAINTENANCE_DUTY_COUNT];
+
+	LWLockAcquire(&MaintenanceDaemonControl->lock, LW_SHARED);
+
+	MaintenanceDaemonDBData *dbData = (MaintenanceDaemonDBData *) hash_search(
+		MaintenanceDaemonDBHash,
+		&MyDatabaseId,
+		HASH_FIND, NULL);
+	if (dbData != NULL)
+	{
+		memcpy_s(dutyStats, sizeof(dutyStats), dbData->dutyStats,
+				 sizeof(dbData->dutyStats));
+	}
+	else
+	{
+		memset(dutyStats, 0, sizeof(dutyStats));
+	}
+
+	LWLockRelease(&MaintenanceDaemonControl->lock);
+
+	for (int duty = 0; duty < MAINTENANCE_DUTY_COUNT; duty++)
+	{
+		memset(values, 0, sizeof(values));
+		memset(isNulls, false, sizeof(isNulls));
+
+		values[0] = PointerGetDatum(cstring_to_text(MaintenanceDutyNames[duty]));
+		values[1] = Int64GetDatum(dutyStats[duty].runCount);
+		values[2] = TimestampTzGetDatum(dutyStats[duty].lastStartTime);
+		isNulls[2] = (dutyStats[duty].runCount == 0);
+		values[3] = Float8GetDatum(dutyStats[duty].lastDuration);
+		isNulls[3] = (dutyStats[duty].runCount == 0);
+		values[4] = Float8GetDatum(dutyStats[duty].maxDuration);
+		values[5] = Float8GetDatum(dutyStats[duty].totalDuration);
+
+		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+	}
+
+	PG_RETURN_VOID();
+}
@@ -17,15 +17,23 @@
 #include "catalog/pg_class.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_inherits.h"
+#include "catalog/pg_type.h"
 #include "commands/tablecmds.h"
 #include "common/string.h"
+#include "executor/spi.h"
 #include "lib/stringinfo.h"
 #include "nodes/makefuncs.h"
+#include "nodes/pathnodes.h"
 #include "nodes/pg_list.h"
 #include "partitioning/partdesc.h"
+#include "partitioning/partprune.h"
+#include "rewrite/rewriteManip.h"
+#include "tcop/tcopprot.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
+#include "utils/partcache.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
 #include "utils/varlena.h"
@@ -51,6 +59,8 @@
 #include "distributed/worker_protocol.h"
 
 static char * PartitionBound(Oid partitionId);
+static List ** PartitionKeyExpressionArray(PartitionKey partitionKey,
+										   Index rangeTableIndex);
 static Relation try_relation_open_nolock(Oid relationId);
 static List * CreateFixPartitionConstraintsTaskList(Oid relationId);
 static List * WorkerFixPartitionConstraintCommandList(Oid relationId, uint64 shardId,
@@ -73,12 +83,14 @@ static List * CheckConstraintNameListForRelation(Oid relationId);
 static bool RelationHasConstraint(Oid relationId, char *constraintName);
 static char * RenameConstraintCommand(Oid relationId, char *constraintName,
 									  char *newConstraintName);
+static void ErrorIfUnsupportedPartitionCommand(const char *command);
 
 
 PG_FUNCTION_INFO_V1(fix_pre_citus10_partitioned_table_constraint_names);
 PG_FUNCTION_INFO_V1(worker_fix_pre_citus10_partitioned_table_constraint_names);
 PG_FUNCTION_INFO_V1(fix_partition_shard_index_names);
 PG_FUNCTION_INFO_V1(worker_fix_partition_shard_index_names);
+PG_FUNCTION_INFO_V1(citus_execute_partition_commands);
 
 
 /*
@@ -154,6 +166,113 @@ worker_fix_pre_citus10_partitioned_table_constraint_names(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * citus_execute_partition_commands executes CREATE TABLE .. PARTITION OF and
+ * DROP TABLE commands, as used by create_time_partitions and
+ * drop_old_time_partitions, while deferring the creation and the drops of the
+ * shards of the partitions until all commands ran. That way, the shards of
+ * all partitions are created or dropped with a few commands per node, rather
+ * than with a round trip per partition and shard.
+ */
+Datum
+citus_execute_partition_commands(PG_FUNCTION_ARGS)
+{
+	CheckCitusVersion(ERROR);
+
+	ArrayType *commandArray = PG_GETARG_ARRAYTYPE_P(0);
+	Datum *commandDatumArray = NULL;
+	int commandCount = 0;
+	deconstruct_array(commandArray, TEXTOID, -1, false, TYPALIGN_INT,
+					  &commandDatumArray, NULL, &commandCount);
+
+	List *commandList = NIL;
+	for (int commandIndex = 0; commandIndex < commandCount; commandIndex++)
+	{
+		char *command = TextDatumGetCString(commandDatumArray[commandIndex]);
+
+		/* the shards do not exist before the end, so no other commands are allowed */
+		ErrorIfUnsupportedPartitionCommand(command);
+
+		commandList = lappend(commandList, command);
+	}
+
+	MemoryContext batchContext = AllocSetContextCreate(CurrentMemoryContext,
+													   "Partition Command Batch",
+													   ALLOCSET_DEFAULT_SIZES);
+
+	BeginShardCreationBatch(batchContext);
+	BeginShardDropBatch(batchContext);
+
+	PG_TRY();
+	{
+		if (SPI_connect() != SPI_OK_CONNECT)
+		{
+			ereport(ERROR, (errmsg("could not connect to SPI manager")));
+		}
+
+		char *command = NULL;
+		foreach_ptr(command, commandList)
+		{
+			int spiResult = SPI_execute(command, false, 0);
+			if (spiResult < 0)
+			{
+				ereport(ERROR, (errmsg("could not run command: %s", command)));
+			}
+		}
+
+		SPI_finish();
+	}
+	PG_CATCH();
+	{
+		bool executeDeferred = false;
+		EndShardCreationBatch(executeDeferred);
+		EndShardDropBatch(executeDeferred);
+
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	bool executeDeferred = true;
+	EndShardCreationBatch(executeDeferred);
+	EndShardDropBatch(executeDeferred);
+
+	MemoryContextDelete(batchContext);
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * ErrorIfUnsupportedPartitionCommand errors out if the given query string is
+ * not a single CREATE TABLE .. PARTITION OF or DROP TABLE command.
+ */
+static void
+ErrorIfUnsupportedPartitionCommand(const char *command)
+{
+	List *parseTreeList = pg_parse_query(command);
+	if (list_length(parseTreeList) == 1)
+	{
+		RawStmt *rawStmt = linitial(parseTreeList);
+		Node *parseTree = rawStmt->stmt;
+
+		if (IsA(parseTree, CreateStmt) &&
+			((CreateStmt *) parseTree)->partbound != NULL)
+		{
+			return;
+		}
+		else if (IsA(parseTree, DropStmt) &&
+				 ((DropStmt *) parseTree)->removeType == OBJECT_TABLE)
+		{
+			return;
+		}
+	}
+
+	ereport(ERROR, (errmsg("only CREATE TABLE .. PARTITION OF and DROP TABLE "
+						   "commands can be executed in a batch"),
+					errdetail("Command: %s", command)));
+}
+
+
 /*
  * fix_partition_shard_index_names fixes the index names of shards of partitions of
  * partitioned tables on workers. If the input is a partition rather than a partitioned
@@ -1093,6 +1212,128 @@ PartitionList(Oid parentRelationId)
 }
 
 
+/*
+ * PrunedPartitionList returns the partitions of the given parent relation that
+ * may contain rows which satisfy the given restriction clauses, in the same
+ * order as PartitionList. The Vars of the parent in the clauses are expected
+ * to have the given range table index.
+ *
+ * The clauses are pruned in the same way as the planner prunes the partitions
+ * of an inheritance parent, so only the partitions which PostgreSQL would scan
+ * on the shards of the parent are returned. partitionsPruned is set to whether
+ * any partition was left out.
+ */
+List *
+PrunedPartitionList(Oid parentRelationId, Index rangeTableIndex,
+					List *restrictionClauseList, bool *partitionsPruned)
+{
+	Relation rel = table_open(parentRelationId, AccessShareLock);
+	List *partitionList = NIL;
+
+	if (!PartitionedTable(parentRelationId))
+	{
+		char *relationName = get_rel_name(parentRelationId);
+
+		ereport(ERROR, (errmsg("\"%s\" is not a parent table", relationName)));
+	}
+
+	PartitionKey partitionKey = RelationGetPartitionKey(rel);
+	PartitionDesc partDesc = RelationGetPartitionDesc(rel, true);
+	Assert(partDesc != NULL);
+
+	/* describe the parent the way the planner describes a partitioned rel */
+	PartitionScheme partitionScheme = palloc0(sizeof(PartitionSchemeData));
+	int partitionKeyCount = partitionKey->partnatts;
+
+	partitionScheme->strategy = partitionKey->strategy;
+	partitionScheme->partnatts = partitionKeyCount;
+	partitionScheme->partopfamily = partitionKey->partopfamily;
+	partitionScheme->partopcintype = partitionKey->partopcintype;
+	partitionScheme->partcollation = partitionKey->partcollation;
+	partitionScheme->parttyplen = partitionKey->parttyplen;
+	partitionScheme->parttypbyval = partitionKey->parttypbyval;
+	partitionScheme->partsupfunc = palloc0(sizeof(FmgrInfo) * partitionKeyCount);
+
+	for (int keyIndex = 0; keyIndex < partitionKeyCount; keyIndex++)
+	{
+		fmgr_info_copy(&partitionScheme->partsupfunc[keyIndex],
+					   &partitionKey->partsupfunc[keyIndex],
+					   CurrentMemoryContext);
+	}
+
+	RelOptInfo *relOptInfo = makeNode(RelOptInfo);
+	relOptInfo->relid = rangeTableIndex;
+	relOptInfo->baserestrictinfo = restrictionClauseList;
+	relOptInfo->part_scheme = partitionScheme;
+	relOptInfo->nparts = partDesc->nparts;
+	relOptInfo->boundinfo = partDesc->boundinfo;
+	relOptInfo->partexprs = PartitionKeyExpressionArray(partitionKey, rangeTableIndex);
+
+	Bitmapset *partitionIndexes = prune_append_rel_partitions(relOptInfo);
+	*partitionsPruned = bms_num_members(partitionIndexes) < partDesc->nparts;
+
+	int partitionIndex = -1;
+	while ((partitionIndex = bms_next_member(partitionIndexes, partitionIndex)) >= 0)
+	{
+		partitionList = lappend_oid(partitionList, partDesc->oids[partitionIndex]);
+	}
+
+	/* keep the lock */
+	table_close(rel, NoLock);
+
+	return partitionList;
+}
+
+
+/*
+ * PartitionKeyExpressionArray returns an array with a single-element list of
+ * the expression of each column of the given partition key, in which the
+ * Vars have the given range table index.
+ */
+static List **
+PartitionKeyExpressionArray(PartitionKey partitionKey, Index rangeTableIndex)
+{
+	int partitionKeyCount = partitionKey->partnatts;
+	List **partitionExpressionArray = palloc0(sizeof(List *) * partitionKeyCount);
+	ListCell *partitionExpressionCell = list_head(partitionKey->partexprs);
+
+	for (int keyIndex = 0; keyIndex < partitionKeyCount; keyIndex++)
+	{
+		AttrNumber attributeNumber = partitionKey->partattrs[keyIndex];
+		Expr *partitionExpression = NULL;
+
+		if (attributeNumber != InvalidAttrNumber)
+		{
+			partitionExpression = (Expr *) makeVar(rangeTableIndex, attributeNumber,
+												   partitionKey->parttypid[keyIndex],
+												   partitionKey->parttypmod[keyIndex],
+												   partitionKey->parttypcoll[keyIndex],
+												   0);
+		}
+		else
+		{
+			if (partitionExpressionCell == NULL)
+			{
+				ereport(ERROR, (errmsg("wrong number of partition key expressions")));
+			}
+
+			partitionExpression = copyObject(lfirst(partitionExpressionCell));
+			if (rangeTableIndex != 1)
+			{
+				ChangeVarNodes((Node *) partitionExpression, 1, rangeTableIndex, 0);
+			}
+
+			partitionExpressionCell = lnext(partitionKey->partexprs,
+											partitionExpressionCell);
+		}
+
+		partitionExpressionArray[keyIndex] = list_make1(partitionExpression);
+	}
+
+	return partitionExpressionArray;
+}
+
+
 /*
  * GenerateDetachPartitionCommand gets a partition table and returns
  * "ALTER TABLE parent_table DETACH PARTITION partitionName" command.
@@ -23,6 +23,7 @@
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 
+#include "distributed/async_reference_table.h"
 #include "distributed/backend_data.h"
 #include "distributed/colocation_utils.h"
 #include "distributed/commands.h"
@@ -44,9 +45,9 @@
 
 /* local function forward declarations */
 static List * WorkersWithoutReferenceTablePlacement(uint64 shardId, LOCKMODE lockMode);
-static StringInfo CopyShardPlacementToWorkerNodeQuery(
+static StringInfo CopyShardPlacementToWorkerNodesQuery(
 	ShardPlacement *sourceShardPlacement,
-	WorkerNode *workerNode,
+	List *workerNodeList,
 	char transferMode);
 static bool AnyRelationsModifiedInTransaction(List *relationIdList);
 static List * ReplicatedMetadataSyncedDistributedTableList(void);
@@ -233,51 +234,56 @@ EnsureReferenceTablesExistOnAllNodesExtended(char transferMode)
 		ereport(NOTICE, (errmsg("replicating reference table '%s' to %s:%d ...",
 								referenceTableName, newWorkerNode->workerName,
 								newWorkerNode->workerPort)));
+	}
 
-		/*
-		 * Call citus_copy_shard_placement using citus extension owner. Current
-		 * user might not have permissions to do the copy.
-		 */
-		const char *userName = CitusExtensionOwnerName();
-		int connectionFlags = OUTSIDE_TRANSACTION;
+	/*
+	 * Call citus_copy_shard_placement_to_nodes using citus extension owner. Current
+	 * user might not have permissions to do the copy. The reference tables are
+	 * copied to all new nodes by a single call, such that writes to them are only
+	 * blocked once and the data is streamed to the nodes in parallel.
+	 */
+	const char *userName = CitusExtensionOwnerName();
+	int connectionFlags = OUTSIDE_TRANSACTION;
 
-		MultiConnection *connection = GetNodeUserDatabaseConnection(
-			connectionFlags, LocalHostName, PostPortNumber,
-			userName, NULL);
+	MultiConnection *connection = GetNodeUserDatabaseConnection(
+		connectionFlags, LocalHostName, PostPortNumber,
+		userName, NULL);
 
-		if (PQstatus(connection->pgConn) == CONNECTION_OK)
-		{
-			UseCoordinatedTransaction();
+	if (PQstatus(connection->pgConn) == CONNECTION_OK)
+	{
+		UseCoordinatedTransaction();
 
-			RemoteTransactionBegin(connection);
-			StringInfo placementCopyCommand =
-				CopyShardPlacementToWorkerNodeQuery(sourceShardPlacement,
-													newWorkerNode,
-													transferMode);
+		RemoteTransactionBegin(connection);
+		StringInfo placementCopyCommand =
+			CopyShardPlacementToWorkerNodesQuery(sourceShardPlacement,
+												 newWorkersList,
+												 transferMode);
 
-			/*
-			 * The placement copy command uses distributed execution to copy
-			 * the shard. This is allowed when indicating that the backend is a
-			 * rebalancer backend.
-			 */
-			ExecuteCriticalRemoteCommand(connection, psprintf(
-											 "SET LOCAL application_name TO '%s%ld'",
-											 CITUS_REBALANCER_APPLICATION_NAME_PREFIX,
-											 GetGlobalPID()));
-			ExecuteCriticalRemoteCommand(connection, placementCopyCommand->data);
-			RemoteTransactionCommit(connection);
-		}
-		else
-		{
-			ereport(ERROR, (errmsg("could not open a connection to localhost "
-								   "when replicating reference tables"),
-							errdetail(
-								"citus.replicate_reference_tables_on_activate = false "
-								"requires localhost connectivity.")));
-		}
-
-		CloseConnection(connection);
+		/*
+		 * The placement copy command uses distributed execution to copy
+		 * the shard. This is allowed when indicating that the backend is a
+		 * rebalancer backend.
+		 */
+		ExecuteCriticalRemoteCommand(connection, psprintf(
+										 "SET LOCAL application_name TO '%s%ld'",
+										 CITUS_REBALANCER_APPLICATION_NAME_PREFIX,
+										 GetGlobalPID()));
+		ExecuteCriticalRemoteCommand(connection, placementCopyCommand->data);
+		RemoteTransactionCommit(connection);
 	}
+	else
+	{
+		ereport(ERROR, (errmsg("could not open a connection to localhost "
+							   "when replicating reference tables"),
+						errdetail(
+							"citus.replicate_reference_tables_on_activate = false "
+							"requires localhost connectivity.")));
+	}
+
+	CloseConnection(connection);
+
+	/* the copies of asynchronously replicated tables are synchronized again */
+	ReplicateAsyncReferenceTablesToNodes(newWorkersList);
 
 	/*
 	 * Since reference tables have been copied via a loopback connection we do not have to
@@ -406,13 +412,13 @@ WorkersWithoutReferenceTablePlacement(uint64 shardId, LOCKMODE lockMode)
 
 
 /*
- * CopyShardPlacementToWorkerNodeQuery returns the citus_copy_shard_placement
- * command to copy the given shard placement to given node.
+ * CopyShardPlacementToWorkerNodesQuery returns the citus_copy_shard_placement_to_nodes
+ * command to copy the given shard placement to the given nodes.
  */
 static StringInfo
-CopyShardPlacementToWorkerNodeQuery(ShardPlacement *sourceShardPlacement,
-									WorkerNode *workerNode,
-									char transferMode)
+CopyShardPlacementToWorkerNodesQuery(ShardPlacement *sourceShardPlacement,
+									 List *workerNodeList,
+									 char transferMode)
 {
 	StringInfo queryString = makeStringInfo();
 
@@ -422,12 +428,23 @@ CopyShardPlacementToWorkerNodeQuery(ShardPlacement *sourceShardPlacement,
 		"auto";
 
 	appendStringInfo(queryString,
-					 "SELECT pg_catalog.citus_copy_shard_placement("
-					 UINT64_FORMAT ", %d, %d, "
-								   "transfer_mode := %s)",
+					 "SELECT pg_catalog.citus_copy_shard_placement_to_nodes("
+					 UINT64_FORMAT ", %d, ARRAY[",
 					 sourceShardPlacement->shardId,
-					 sourceShardPlacement->nodeId,
-					 workerNode->nodeId,
+					 sourceShardPlacement->nodeId);
+
+	WorkerNode *workerNode = NULL;
+	foreach_ptr(workerNode, workerNodeList)
+	{
+		if (workerNode != linitial(workerNodeList))
+		{
+			appendStringInfoString(queryString, ", ");
+		}
+
+		appendStringInfo(queryString, "%d", workerNode->nodeId);
+	}
+
+	appendStringInfo(queryString, "]::integer[], transfer_mode := %s)",
 					 quote_literal_cstr(transferModeString));
 
 	return queryString;
@@ -21,6 +21,7 @@
 #include "access/xact.h"
 #include "catalog/namespace.h"
 #include "commands/tablecmds.h"
+#include "common/hashfn.h"
 #include "storage/lmgr.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
@@ -95,6 +96,7 @@ static void LockReferencedReferenceShardResources(uint64 shardId, LOCKMODE lockM
 static bool AnyTableReplicated(List *shardIntervalList,
 							   List **replicatedShardIntervalList);
 static void LockShardListResources(List *shardIntervalList, LOCKMODE lockMode);
+static bool ShardIntervalListSortedById(List *shardIntervalList);
 static void LockShardListResourcesOnFirstWorker(LOCKMODE lockmode,
 												List *shardIntervalList);
 static bool IsFirstWorkerNode();
@@ -627,6 +629,43 @@ LockShardResource(uint64 shardId, LOCKMODE lockmode)
 }
 
 
+/*
+ * LockShardColumnStatistics acquires a lock that serializes the transactions
+ * that invalidate the pg_dist_shard_column_stats rows of the given shard.
+ */
+void
+LockShardColumnStatistics(uint64 shardId, LOCKMODE lockmode)
+{
+	LOCKTAG tag;
+	const bool sessionLock = false;
+	const bool dontWait = false;
+
+	SET_LOCKTAG_SHARD_COLUMN_STATISTICS(tag, shardId);
+
+	(void) LockAcquire(&tag, lockmode, sessionLock, dontWait);
+}
+
+
+/*
+ * LockIngestion acquires a lock that serializes the COPY commands that
+ * continue the bulk load with the given ingestion id. Different ids may share
+ * a lock, since the lock is taken on a hash of the id.
+ */
+void
+LockIngestion(const char *ingestionId, LOCKMODE lockmode)
+{
+	LOCKTAG tag;
+	const bool sessionLock = false;
+	const bool dontWait = false;
+	uint32 ingestionIdHash = hash_bytes((const unsigned char *) ingestionId,
+										strlen(ingestionId));
+
+	SET_LOCKTAG_INGESTION(tag, ingestionIdHash);
+
+	(void) LockAcquire(&tag, lockmode, sessionLock, dontWait);
+}
+
+
 /* LockTransactionRecovery acquires a lock for transaction recovery */
 void
 LockTransactionRecovery(LOCKMODE lockmode)
@@ -753,11 +792,17 @@ SerializeNonCommutativeWrites(List *shardIntervalList, LOCKMODE lockMode)
  *
  * If the optional replicatedShardIntervalList is passed, the function
  * fills it with the replicated shard intervals.
+ *
+ * Checking whether a table is replicated goes over the placements of all of its
+ * shards, so the result is reused for consecutive shards of the same table.
+ * Otherwise, a multi-shard command would take quadratic time in the shard count.
  */
 static bool
 AnyTableReplicated(List *shardIntervalList, List **replicatedShardIntervalList)
 {
 	List *localList = NIL;
+	Oid previousRelationId = InvalidOid;
+	bool previousRelationReplicated = false;
 
 	ShardInterval *shardInterval = NULL;
 	foreach_ptr(shardInterval, shardIntervalList)
@@ -765,12 +810,14 @@ AnyTableReplicated(List *shardIntervalList, List **replicatedShardIntervalList)
 		int64 shardId = shardInterval->shardId;
 
 		Oid relationId = RelationIdForShard(shardId);
-		if (ReferenceTableShardId(shardId))
+		if (relationId != previousRelationId)
 		{
-			localList =
-				lappend(localList, LoadShardInterval(shardId));
+			previousRelationId = relationId;
+			previousRelationReplicated = ReferenceTableShardId(shardId) ||
+										 !SingleReplicatedTable(relationId);
 		}
-		else if (!SingleReplicatedTable(relationId))
+
+		if (previousRelationReplicated)
 		{
 			localList =
 				lappend(localList, LoadShardInterval(shardId));
@@ -794,7 +841,10 @@ static void
 LockShardListResources(List *shardIntervalList, LOCKMODE lockMode)
 {
 	/* lock shards in order of shard id to prevent deadlock */
-	shardIntervalList = SortList(shardIntervalList, CompareShardIntervalsById);
+	if (!ShardIntervalListSortedById(shardIntervalList))
+	{
+		shardIntervalList = SortList(shardIntervalList, CompareShardIntervalsById);
+	}
 
 	ShardInterval *shardInterval = NULL;
 	foreach_ptr(shardInterval, shardIntervalList)
@@ -806,6 +856,31 @@ LockShardListResources(List *shardIntervalList, LOCKMODE lockMode)
 }
 
 
+/*
+ * ShardIntervalListSortedById returns whether the shard intervals in the given
+ * list are in ascending order of shard id. Most callers already pass sorted
+ * lists, which then need not be copied and sorted again.
+ */
+static bool
+ShardIntervalListSortedById(List *shardIntervalList)
+{
+	uint64 previousShardId = 0;
+
+	ShardInterval *shardInterval = NULL;
+	foreach_ptr(shardInterval, shardIntervalList)
+	{
+		if (shardInterval->shardId < previousShardId)
+		{
+			return false;
+		}
+
+		previousShardId = shardInterval->shardId;
+	}
+
+	return true;
+}
+
+
 /*
  * LockRelationShardResources takes locks on all shards in a list of RelationShards
  * to prevent concurrent DML statements on those shards.
@@ -16,8 +16,11 @@
 #include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_type.h"
+#include "common/hashfn.h"
 #include "utils/catcache.h"
+#include "utils/fmgroids.h"
 #include "utils/memutils.h"
+#include "utils/uuid.h"
 
 #include "distributed/distributed_planner.h"
 #include "distributed/listutils.h"
@@ -29,6 +32,11 @@
 #include "distributed/worker_protocol.h"
 
 
+/* local function declarations */
+static Datum HashPartitionColumnValue(Datum partitionColumnValue,
+									  CitusTableCacheEntry *cacheEntry);
+
+
 /*
  * SortedShardIntervalArray sorts the input shardIntervalArray. Shard intervals with
  * no min/max values are placed at the end of the array.
@@ -261,11 +269,22 @@ FindShardInterval(Datum partitionColumnValue, CitusTableCacheEntry *cacheEntry)
 {
 	Datum searchedValue = partitionColumnValue;
 
+	/* most tables have uniform hash ranges, find the shard by its index */
+	if (cacheEntry->hasUniformHashDistribution &&
+		cacheEntry->shardIntervalArrayLength > 0)
+	{
+		searchedValue = HashPartitionColumnValue(partitionColumnValue, cacheEntry);
+
+		int shardIndex =
+			CalculateUniformHashRangeIndex(DatumGetInt32(searchedValue),
+										   cacheEntry->shardIntervalArrayLength);
+
+		return cacheEntry->sortedShardIntervalArray[shardIndex];
+	}
+
 	if (IsCitusTableTypeCacheEntry(cacheEntry, HASH_DISTRIBUTED))
 	{
-		searchedValue = FunctionCall1Coll(cacheEntry->hashFunction,
-										  cacheEntry->partitionColumn->varcollid,
-										  partitionColumnValue);
+		searchedValue = HashPartitionColumnValue(partitionColumnValue, cacheEntry);
 	}
 
 	int shardIndex = FindShardIntervalIndex(searchedValue, cacheEntry);
@@ -279,6 +298,75 @@ FindShardInterval(Datum partitionColumnValue, CitusTableCacheEntry *cacheEntry)
 }
 
 
+/*
+ * HashPartitionColumnValue returns the hash of the given partition column
+ * value of a hash distributed table. Since this is done for every row that we
+ * route, for instance in COPY, we compute the hash of the most common
+ * distribution column types inline, without going through the function
+ * manager. The results are the same as the ones of their hash functions.
+ */
+static Datum
+HashPartitionColumnValue(Datum partitionColumnValue, CitusTableCacheEntry *cacheEntry)
+{
+	Oid collation = cacheEntry->partitionColumn->varcollid;
+
+	switch (cacheEntry->hashFunction->fn_oid)
+	{
+		case F_HASHINT4:
+		{
+			return hash_uint32(DatumGetInt32(partitionColumnValue));
+		}
+
+		case F_HASHINT8:
+		{
+			/* see hashint8(), which hashes int8 values like int4 values in range */
+			int64 value = DatumGetInt64(partitionColumnValue);
+			uint32 lohalf = (uint32) value;
+			uint32 hihalf = (uint32) (value >> 32);
+
+			lohalf ^= (value >= 0) ? hihalf : ~hihalf;
+
+			return hash_uint32(lohalf);
+		}
+
+		case F_UUID_HASH:
+		{
+			pg_uuid_t *uuid = DatumGetUUIDP(partitionColumnValue);
+
+			return hash_any(uuid->data, UUID_LEN);
+		}
+
+		case F_HASHTEXT:
+		{
+			/* only deterministic collations hash the bytes of the text */
+			if (collation != DEFAULT_COLLATION_OID && collation != C_COLLATION_OID &&
+				collation != POSIX_COLLATION_OID)
+			{
+				break;
+			}
+
+			text *key = DatumGetTextPP(partitionColumnValue);
+			Datum hashValue = hash_any((unsigned char *) VARDATA_ANY(key),
+									   VARSIZE_ANY_EXHDR(key));
+
+			if ((Pointer) key != DatumGetPointer(partitionColumnValue))
+			{
+				pfree(key);
+			}
+
+			return hashValue;
+		}
+
+		default:
+		{
+			break;
+		}
+	}
+
+	return FunctionCall1Coll(cacheEntry->hashFunction, collation, partitionColumnValue);
+}
+
+
 /*
  * FindShardIntervalIndex finds the index of the shard interval which covers
  * the searched value. Note that the searched value must be the hashed value
@@ -297,8 +385,6 @@ FindShardIntervalIndex(Datum searchedValue, CitusTableCacheEntry *cacheEntry)
 	ShardInterval **shardIntervalCache = cacheEntry->sortedShardIntervalArray;
 	int shardCount = cacheEntry->shardIntervalArrayLength;
 	FmgrInfo *compareFunction = cacheEntry->shardIntervalCompareFunction;
-	bool useBinarySearch = (!IsCitusTableTypeCacheEntry(cacheEntry, HASH_DISTRIBUTED) ||
-							!cacheEntry->hasUniformHashDistribution);
 	int shardIndex = INVALID_SHARD_INDEX;
 
 	if (shardCount == 0)
@@ -306,31 +392,34 @@ FindShardIntervalIndex(Datum searchedValue, CitusTableCacheEntry *cacheEntry)
 		return INVALID_SHARD_INDEX;
 	}
 
+	/*
+	 * Uniform hash ranges are only detected for hash distributed tables, in
+	 * which case the index of the range follows from the hashed value, which
+	 * avoids the comparison function calls of the binary search.
+	 */
+	if (cacheEntry->hasUniformHashDistribution)
+	{
+		int hashedValue = DatumGetInt32(searchedValue);
+
+		return CalculateUniformHashRangeIndex(hashedValue, shardCount);
+	}
+
 	if (IsCitusTableTypeCacheEntry(cacheEntry, HASH_DISTRIBUTED))
 	{
-		if (useBinarySearch)
-		{
-			Assert(compareFunction != NULL);
+		Assert(compareFunction != NULL);
 
-			Oid shardIntervalCollation = cacheEntry->partitionColumn->varcollid;
-			shardIndex = SearchCachedShardInterval(searchedValue, shardIntervalCache,
-												   shardCount, shardIntervalCollation,
-												   compareFunction);
+		Oid shardIntervalCollation = cacheEntry->partitionColumn->varcollid;
+		shardIndex = SearchCachedShardInterval(searchedValue, shardIntervalCache,
+											   shardCount, shardIntervalCollation,
+											   compareFunction);
 
-			/* we should always return a valid shard index for hash partitioned tables */
-			if (shardIndex == INVALID_SHARD_INDEX)
-			{
-				ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
-								errmsg("cannot find shard interval"),
-								errdetail("Hash of the partition column value "
-										  "does not fall into any shards.")));
-			}
-		}
-		else
+		/* we should always return a valid shard index for hash partitioned tables */
+		if (shardIndex == INVALID_SHARD_INDEX)
 		{
-			int hashedValue = DatumGetInt32(searchedValue);
-
-			shardIndex = CalculateUniformHashRangeIndex(hashedValue, shardCount);
+			ereport(ERROR, (errcode(ERRCODE_DATA_EXCEPTION),
+							errmsg("cannot find shard interval"),
+							errdetail("Hash of the partition column value "
+									  "does not fall into any shards.")));
 		}
 	}
 	else if (!HasDistributionKeyCacheEntry(cacheEntry))
@@ -16,6 +16,9 @@
 #include "access/table.h"
 #include "storage/lockdefs.h"
 #include "utils/fmgroids.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
 #include "utils/relcache.h"
 
 #include "distributed/colocation_utils.h"
@@ -25,6 +28,42 @@
 #include "distributed/tenant_schema_metadata.h"
 
 
+/* entry of the cache from the schema id to the colocation id of a tenant schema */
+typedef struct TenantSchemaCacheEntry
+{
+	Oid schemaId;
+
+	/* INVALID_COLOCATION_ID if the schema is not a tenant schema */
+	uint32 colocationId;
+} TenantSchemaCacheEntry;
+
+/* entry of the cache from the colocation id to the id of a tenant schema */
+typedef struct TenantColocationCacheEntry
+{
+	uint32 colocationId;
+
+	/* InvalidOid if the colocation group does not belong to a tenant schema */
+	Oid schemaId;
+} TenantColocationCacheEntry;
+
+
+static void InitializeTenantSchemaCache(void);
+static uint32 LookupTenantColocationId(Oid schemaId);
+static Oid LookupTenantSchemaId(uint32 colocationId);
+
+
+/*
+ * Backend-local caches of pg_dist_schema in both directions, which are filled
+ * as schemas and colocation groups are looked up, including the ones that do
+ * not belong to a tenant schema. Schema-based sharding looks up the tenant
+ * schema of every table that is created and of every tenant that is tracked,
+ * which would otherwise scan pg_dist_schema each time. Both are emptied when
+ * pg_dist_schema changes.
+ */
+static HTAB *TenantSchemaCache = NULL;
+static HTAB *TenantColocationCache = NULL;
+
+
 /*
  * IsTenantSchema returns true if there is a tenant schema with given schemaId.
  */
@@ -80,38 +119,30 @@ IsTenantSchemaColocationGroup(uint32 colocationId)
 uint32
 SchemaIdGetTenantColocationId(Oid schemaId)
 {
-	uint32 colocationId = INVALID_COLOCATION_ID;
-
 	if (!OidIsValid(schemaId))
 	{
 		ereport(ERROR, (errmsg("schema id is invalid")));
 	}
 
-	Relation pgDistTenantSchema = table_open(DistTenantSchemaRelationId(),
-											 AccessShareLock);
-	ScanKeyData scanKey[1];
-	ScanKeyInit(&scanKey[0], Anum_pg_dist_schema_schemaid, BTEqualStrategyNumber,
-				F_OIDEQ, ObjectIdGetDatum(schemaId));
-
-	bool indexOk = true;
-	SysScanDesc scanDescriptor = systable_beginscan(pgDistTenantSchema,
-													DistTenantSchemaPrimaryKeyIndexId(),
-													indexOk, NULL, 1, scanKey);
+	/* pick up the changes of concurrently committed transactions */
+	AcceptInvalidationMessages();
+	InitializeTenantSchemaCache();
 
-	HeapTuple heapTuple = systable_getnext_ordered(scanDescriptor, ForwardScanDirection);
-	if (HeapTupleIsValid(heapTuple))
+	bool found = false;
+	TenantSchemaCacheEntry *cacheEntry =
+		hash_search(TenantSchemaCache, &schemaId, HASH_FIND, &found);
+	if (found)
 	{
-		bool isNull = false;
-		colocationId = DatumGetUInt32(
-			heap_getattr(heapTuple,
-						 Anum_pg_dist_schema_colocationid,
-						 RelationGetDescr(pgDistTenantSchema),
-						 &isNull));
-		Assert(!isNull);
+		return cacheEntry->colocationId;
 	}
 
-	systable_endscan(scanDescriptor);
-	table_close(pgDistTenantSchema, AccessShareLock);
+	uint32 colocationId = LookupTenantColocationId(schemaId);
+
+	/* opening pg_dist_schema might have processed invalidations */
+	InitializeTenantSchemaCache();
+
+	cacheEntry = hash_search(TenantSchemaCache, &schemaId, HASH_ENTER, NULL);
+	cacheEntry->colocationId = colocationId;
 
 	return colocationId;
 }
@@ -131,34 +162,51 @@ ColocationIdGetTenantSchemaId(uint32 colocationId)
 		ereport(ERROR, (errmsg("colocation id is invalid")));
 	}
 
-	Relation pgDistTenantSchema = table_open(DistTenantSchemaRelationId(),
-											 AccessShareLock);
-	ScanKeyData scanKey[1];
-	ScanKeyInit(&scanKey[0], Anum_pg_dist_schema_colocationid,
-				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(colocationId));
-
-	bool indexOk = true;
-	SysScanDesc scanDescriptor = systable_beginscan(pgDistTenantSchema,
-													DistTenantSchemaUniqueColocationIdIndexId(),
-													indexOk, NULL, 1, scanKey);
+	/* pick up the changes of concurrently committed transactions */
+	AcceptInvalidationMessages();
+	InitializeTenantSchemaCache();
 
-	HeapTuple heapTuple = systable_getnext_ordered(scanDescriptor, ForwardScanDirection);
-	Oid schemaId = InvalidOid;
-	if (HeapTupleIsValid(heapTuple))
+	bool found = false;
+	TenantColocationCacheEntry *cacheEntry =
+		hash_search(TenantColocationCache, &colocationId, HASH_FIND, &found);
+	if (found)
 	{
-		bool isNull = false;
-		schemaId = heap_getattr(heapTuple, Anum_pg_dist_schema_schemaid,
-								RelationGetDescr(pgDistTenantSchema), &isNull);
-		Assert(!isNull);
+		return cacheEntry->schemaId;
 	}
 
-	systable_endscan(scanDescriptor);
-	table_close(pgDistTenantSchema, AccessShareLock);
+	Oid schemaId = LookupTenantSchemaId(colocationId);
+
+	/* opening pg_dist_schema might have processed invalidations */
+	InitializeTenantSchemaCache();
+
+	cacheEntry = hash_search(TenantColocationCache, &colocationId, HASH_ENTER, NULL);
+	cacheEntry->schemaId = schemaId;
 
 	return schemaId;
 }
 
 
+/*
+ * InvalidateTenantSchemaCache empties the caches of pg_dist_schema. It is
+ * called when pg_dist_schema changes, or when all caches are flushed.
+ */
+void
+InvalidateTenantSchemaCache(void)
+{
+	if (TenantSchemaCache != NULL)
+	{
+		hash_destroy(TenantSchemaCache);
+		TenantSchemaCache = NULL;
+	}
+
+	if (TenantColocationCache != NULL)
+	{
+		hash_destroy(TenantColocationCache);
+		TenantColocationCache = NULL;
+	}
+}
+
+
 /*
  * InsertTenantSchemaLocally inserts an entry into pg_dist_schema
  * with given schemaId and colocationId.
@@ -192,6 +240,9 @@ InsertTenantSchemaLocally(Oid schemaId, uint32 colocationId)
 	HeapTuple heapTuple = heap_form_tuple(tupleDescriptor, values, isNulls);
 
 	CatalogTupleInsert(pgDistTenantSchema, heapTuple);
+
+	/* empty the pg_dist_schema caches of all backends */
+	CitusInvalidateRelcacheByRelid(DistTenantSchemaRelationId());
 	CommandCounterIncrement();
 
 	table_close(pgDistTenantSchema, NoLock);
@@ -230,8 +281,116 @@ DeleteTenantSchemaLocally(Oid schemaId)
 	}
 
 	CatalogTupleDelete(pgDistTenantSchema, &heapTuple->t_self);
+
+	/* empty the pg_dist_schema caches of all backends */
+	CitusInvalidateRelcacheByRelid(DistTenantSchemaRelationId());
 	CommandCounterIncrement();
 
 	systable_endscan(scanDescriptor);
 	table_close(pgDistTenantSchema, NoLock);
 }
+
+
+/*
+ * InitializeTenantSchemaCache creates the backend-local caches of
+ * pg_dist_schema, if they do not exist yet.
+ */
+static void
+InitializeTenantSchemaCache(void)
+{
+	if (TenantSchemaCache != NULL)
+	{
+		return;
+	}
+
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(Oid);
+	info.entrysize = sizeof(TenantSchemaCacheEntry);
+	info.hcxt = CacheMemoryContext;
+	int hashFlags = (HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	TenantSchemaCache = hash_create("Tenant Schema Cache", 32, &info, hashFlags);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(uint32);
+	info.entrysize = sizeof(TenantColocationCacheEntry);
+	info.hcxt = CacheMemoryContext;
+
+	TenantColocationCache = hash_create("Tenant Colocation Cache", 32, &info,
+										hashFlags);
+}
+
+
+/*
+ * LookupTenantColocationId returns the colocation id of the tenant schema with
+ * given id from pg_dist_schema, or INVALID_COLOCATION_ID if there is none.
+ */
+static uint32
+LookupTenantColocationId(Oid schemaId)
+{
+	uint32 colocationId = INVALID_COLOCATION_ID;
+
+	Relation pgDistTenantSchema = table_open(DistTenantSchemaRelationId(),
+											 AccessShareLock);
+	ScanKeyData scanKey[1];
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_schema_schemaid, BTEqualStrategyNumber,
+				F_OIDEQ, ObjectIdGetDatum(schemaId));
+
+	bool indexOk = true;
+	SysScanDesc scanDescriptor = systable_beginscan(pgDistTenantSchema,
+													DistTenantSchemaPrimaryKeyIndexId(),
+													indexOk, NULL, 1, scanKey);
+
+	HeapTuple heapTuple = systable_getnext_ordered(scanDescriptor, ForwardScanDirection);
+	if (HeapTupleIsValid(heapTuple))
+	{
+		bool isNull = false;
+		colocationId = DatumGetUInt32(
+			heap_getattr(heapTuple,
+						 Anum_pg_dist_schema_colocationid,
+						 RelationGetDescr(pgDistTenantSchema),
+						 &isNull));
+		Assert(!isNull);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistTenantSchema, AccessShareLock);
+
+	return colocationId;
+}
+
+
+/*
+ * LookupTenantSchemaId returns the id of the tenant schema that is associated
+ * with given colocation id from pg_dist_schema, or InvalidOid if there is none.
+ */
+static Oid
+LookupTenantSchemaId(uint32 colocationId)
+{
+	Relation pgDistTenantSchema = table_open(DistTenantSchemaRelationId(),
+											 AccessShareLock);
+	ScanKeyData scanKey[1];
+	ScanKeyInit(&scanKey[0], Anum_pg_dist_schema_colocationid,
+				BTEqualStrategyNumber, F_INT4EQ, Int32GetDatum(colocationId));
+
+	bool indexOk = true;
+	SysScanDesc scanDescriptor = systable_beginscan(pgDistTenantSchema,
+													DistTenantSchemaUniqueColocationIdIndexId(),
+													indexOk, NULL, 1, scanKey);
+
+	HeapTuple heapTuple = systable_getnext_ordered(scanDescriptor, ForwardScanDirection);
+	Oid schemaId = InvalidOid;
+	if (HeapTupleIsValid(heapTuple))
+	{
+		bool isNull = false;
+		schemaId = heap_getattr(heapTuple, Anum_pg_dist_schema_schemaid,
+								RelationGetDescr(pgDistTenantSchema), &isNull);
+		Assert(!isNull);
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(pgDistTenantSchema, AccessShareLock);
+
+	return schemaId;
+}
@@ -21,6 +21,7 @@
 #include "utils/memutils.h"
 
 #include "distributed/commands/multi_copy.h"
+#include "distributed/memory_intermediate_results.h"
 #include "distributed/multi_executor.h"
 #include "distributed/transmit.h"
 #include "distributed/version_compat.h"
@@ -29,7 +30,12 @@
 
 #define COPY_BUFFER_SIZE (4 * 1024 * 1024)
 
-/* TaskFileDestReceiver can be used to stream results into a file */
+/*
+ * TaskFileDestReceiver can be used to stream results into a file. Results of
+ * at most citus.intermediate_result_memory_threshold are kept in shared memory
+ * under the file name instead, such that a partition that is read on the same
+ * node is never written to and read back from a file.
+ */
 typedef struct TaskFileDestReceiver
 {
 	/* public DestReceiver interface */
@@ -47,8 +53,13 @@ typedef struct TaskFileDestReceiver
 	/* output file */
 	char *filePath;
 	FileCompat fileCompat;
+	bool fileOpened;
 	bool binaryCopyFormat;
 
+	/* result data that is kept in memory until it exceeds memoryResultLimit */
+	StringInfo memoryResultData;
+	int64 memoryResultLimit;
+
 	/* state on how to copy out data types */
 	CopyOutState copyOutState;
 	FmgrInfo *columnOutputFunctions;
@@ -63,6 +74,8 @@ static void TaskFileDestReceiverStartup(DestReceiver *dest, int operation,
 										TupleDesc inputTupleDescriptor);
 static bool TaskFileDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest);
 static void WriteToLocalFile(StringInfo copyData, TaskFileDestReceiver *taskFileDest);
+static void OpenTaskFile(TaskFileDestReceiver *taskFileDest);
+static void WriteToFile(StringInfo copyData, TaskFileDestReceiver *taskFileDest);
 static void TaskFileDestReceiverShutdown(DestReceiver *destReceiver);
 static void TaskFileDestReceiverDestroy(DestReceiver *destReceiver);
 
@@ -125,8 +138,6 @@ TaskFileDestReceiverStartup(DestReceiver *dest, int operation,
 	const char *delimiterCharacter = "\t";
 	const char *nullPrintCharacter = "\\N";
 
-	const int fileFlags = (O_APPEND | O_CREAT | O_RDWR | O_TRUNC | PG_BINARY);
-
 	/* use the memory context that was in place when the DestReceiver was created */
 	MemoryContext oldContext = MemoryContextSwitchTo(taskFileDest->memoryContext);
 
@@ -145,9 +156,15 @@ TaskFileDestReceiverStartup(DestReceiver *dest, int operation,
 	taskFileDest->columnOutputFunctions = ColumnOutputFunctions(inputTupleDescriptor,
 																copyOutState->binary);
 
-	taskFileDest->fileCompat = FileCompatFromFileStart(FileOpenForTransmit(
-														   taskFileDest->filePath,
-														   fileFlags));
+	taskFileDest->memoryResultLimit = MemoryIntermediateResultLimit();
+	if (taskFileDest->memoryResultLimit >= 0)
+	{
+		taskFileDest->memoryResultData = makeStringInfo();
+	}
+	else
+	{
+		OpenTaskFile(taskFileDest);
+	}
 
 	if (copyOutState->binary)
 	{
@@ -205,10 +222,64 @@ TaskFileDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 
 
 /*
- * WriteToLocalResultsFile writes the bytes in a StringInfo to a local file.
+ * WriteToLocalFile appends the bytes in a StringInfo to the result. They are
+ * kept in memory as long as the result stays within the memory limit, after
+ * which the result is moved to the local file.
  */
 static void
 WriteToLocalFile(StringInfo copyData, TaskFileDestReceiver *taskFileDest)
+{
+	StringInfo memoryResultData = taskFileDest->memoryResultData;
+
+	if (memoryResultData != NULL &&
+		(int64) memoryResultData->len + copyData->len > taskFileDest->memoryResultLimit)
+	{
+		/* the result no longer fits in memory, move it to the file */
+		OpenTaskFile(taskFileDest);
+		WriteToFile(memoryResultData, taskFileDest);
+
+		pfree(memoryResultData->data);
+		pfree(memoryResultData);
+		taskFileDest->memoryResultData = NULL;
+	}
+
+	if (taskFileDest->memoryResultData != NULL)
+	{
+		appendBinaryStringInfo(taskFileDest->memoryResultData, copyData->data,
+							   copyData->len);
+	}
+	else
+	{
+		WriteToFile(copyData, taskFileDest);
+	}
+
+	taskFileDest->bytesSent += copyData->len;
+}
+
+
+/*
+ * OpenTaskFile creates the output file of the TaskFileDestReceiver.
+ */
+static void
+OpenTaskFile(TaskFileDestReceiver *taskFileDest)
+{
+	const int fileFlags = (O_APPEND | O_CREAT | O_RDWR | O_TRUNC | PG_BINARY);
+
+	/* an earlier result with the same name may be in memory */
+	RemoveMemoryIntermediateResult(taskFileDest->filePath);
+
+	taskFileDest->fileCompat = FileCompatFromFileStart(FileOpenForTransmit(
+														   taskFileDest->filePath,
+														   fileFlags));
+	taskFileDest->fileOpened = true;
+}
+
+
+/*
+ * WriteToFile writes the bytes in a StringInfo to the output file.
+ */
+static void
+WriteToFile(StringInfo copyData, TaskFileDestReceiver *taskFileDest)
 {
 	int bytesWritten = FileWriteCompat(&taskFileDest->fileCompat, copyData->data,
 									   copyData->len, PG_WAIT_IO);
@@ -217,15 +288,13 @@ WriteToLocalFile(StringInfo copyData, TaskFileDestReceiver *taskFileDest)
 		ereport(ERROR, (errcode_for_file_access(),
 						errmsg("could not append to file: %m")));
 	}
-
-	taskFileDest->bytesSent += bytesWritten;
 }
 
 
 /*
  * TaskFileDestReceiverShutdown implements the rShutdown interface of
- * TaskFileDestReceiver. It writes the footer and closes the file.
- * the relation.
+ * TaskFileDestReceiver. It writes the footer and stores the result in
+ * memory, or closes the file.
  */
 static void
 TaskFileDestReceiverShutdown(DestReceiver *destReceiver)
@@ -247,7 +316,20 @@ TaskFileDestReceiverShutdown(DestReceiver *destReceiver)
 		resetStringInfo(copyOutState->fe_msgbuf);
 	}
 
-	FileClose(taskFileDest->fileCompat.fd);
+	if (taskFileDest->memoryResultData != NULL &&
+		!StoreMemoryIntermediateResult(taskFileDest->filePath,
+									   taskFileDest->memoryResultData))
+	{
+		/* there is no room in memory, write the result to the file */
+		OpenTaskFile(taskFileDest);
+		WriteToFile(taskFileDest->memoryResultData, taskFileDest);
+	}
+
+	if (taskFileDest->fileOpened)
+	{
+		FileClose(taskFileDest->fileCompat.fd);
+		taskFileDest->fileOpened = false;
+	}
 }
 
 
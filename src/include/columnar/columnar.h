@@ -15,16 +15,21 @@
 
 #include "fmgr.h"
 
+#include "access/relscan.h"
 #include "lib/stringinfo.h"
 #include "nodes/parsenodes.h"
+#include "port/atomics.h"
+#include "portability/instr_time.h"
 #include "storage/bufpage.h"
 #include "storage/lockdefs.h"
 #include "utils/relcache.h"
 #include "utils/snapmgr.h"
+#include "utils/tuplesort.h"
 
 #include "pg_version_compat.h"
 
 #include "columnar/columnar_compression.h"
+#include "columnar/columnar_encoding.h"
 #include "columnar/columnar_metadata.h"
 
 #if PG_VERSION_NUM >= PG_VERSION_16
@@ -50,6 +55,7 @@
 #define CHUNK_ROW_COUNT_MAXIMUM 100000
 #define COMPRESSION_LEVEL_MIN 1
 #define COMPRESSION_LEVEL_MAX 19
+#define COMPRESSION_WORKERS_MAX 64
 
 /* Columnar file signature */
 #define COLUMNAR_VERSION_MAJOR 2
@@ -61,6 +67,16 @@
 #define COLUMNAR_POSTSCRIPT_SIZE_MAX 256
 #define COLUMNAR_BYTES_PER_PAGE (BLCKSZ - SizeOfPageHeaderData)
 
+/*
+ * Deleted rows of a stripe are kept in a bitmap that is indexed by the
+ * offset of the rows within the stripe, see columnar.row_mask.
+ */
+#define COLUMNAR_ROW_MASK_SIZE(rowCount) (((rowCount) + 7) / 8)
+#define COLUMNAR_ROW_MASK_IS_SET(rowMask, rowOffset) \
+	(((rowMask)[(rowOffset) / 8] & (1 << ((rowOffset) % 8))) != 0)
+#define COLUMNAR_ROW_MASK_SET(rowMask, rowOffset) \
+	((rowMask)[(rowOffset) / 8] |= (1 << ((rowOffset) % 8)))
+
 /*global variables for citus_columnar fake version Y */
 #define CITUS_COLUMNAR_INTERNAL_VERSION "11.1-0"
 
@@ -78,6 +94,22 @@ typedef struct ColumnarOptions
 } ColumnarOptions;
 
 
+/*
+ * ColumnarColumnOptions holds the options of a column that override the
+ * options of its table. COMPRESSION_TYPE_INVALID and 0 mean that the table's
+ * compression type and compression level are used, respectively.
+ *
+ * sortKeyPosition is the 1-based position of the column in the sort key of
+ * the table, as set by columnar.sort_key, or 0 if the column isn't part of it.
+ */
+typedef struct ColumnarColumnOptions
+{
+	CompressionType compressionType;
+	int compressionLevel;
+	int sortKeyPosition;
+} ColumnarColumnOptions;
+
+
 /* ColumnChunkSkipNode contains statistics for a ColumnChunkData. */
 typedef struct ColumnChunkSkipNode
 {
@@ -105,6 +137,10 @@ typedef struct ColumnChunkSkipNode
 
 	CompressionType valueCompressionType;
 	int valueCompressionLevel;
+	ChunkEncodingType valueEncodingType;
+
+	/* bloom filter of the values in the chunk, or NULL if not built */
+	bytea *bloomFilter;
 } ColumnChunkSkipNode;
 
 
@@ -143,6 +179,12 @@ typedef struct ChunkData
 
 	/* valueBuffer keeps actual data for type-by-reference datums from valueArray. */
 	StringInfo *valueBufferArray;
+
+	/*
+	 * dictionaryArray[column] is the decoded dictionary of the column if the
+	 * column is dictionary encoded in this chunk, or NULL otherwise.
+	 */
+	ChunkDictionary **dictionaryArray;
 } ChunkData;
 
 
@@ -150,15 +192,26 @@ typedef struct ChunkData
  * ColumnChunkBuffers represents a chunk of serialized data in a column.
  * valueBuffer stores the serialized values of data, and existsBuffer stores
  * serialized value of presence information. valueCompressionType contains
- * compression type if valueBuffer is compressed. Finally rowCount has
- * the number of rows in this chunk.
+ * compression type if valueBuffer is compressed, and valueEncodingType
+ * contains the encoding that was applied to the values before compression.
+ * Finally rowCount has the number of rows in this chunk.
  */
 typedef struct ColumnChunkBuffers
 {
 	StringInfo existsBuffer;
 	StringInfo valueBuffer;
 	CompressionType valueCompressionType;
+	int valueCompressionLevel;
+	ChunkEncodingType valueEncodingType;
 	uint64 decompressedValueSize;
+
+	/*
+	 * If valueBuffer is NULL, reading the value chunk is deferred until we
+	 * know that some rows of the chunk group are needed, and it is read
+	 * from valueOffset of the storage on demand.
+	 */
+	uint64 valueOffset;
+	uint64 valueLength;
 } ColumnChunkBuffers;
 
 
@@ -179,10 +232,49 @@ typedef struct StripeBuffers
 	uint32 rowCount;
 	ColumnBuffers **columnBuffersArray;
 
+	uint32 selectedChunkGroupCount;
 	uint32 *selectedChunkGroupRowCounts;
+
+	/*
+	 * Indexes of the selected chunk groups within the stripe, and the ids
+	 * that are used to look up their chunks in the chunk cache.
+	 */
+	uint32 *selectedChunkGroupIndexes;
+	uint64 stripeId;
+	uint64 storageId;
+
+	/*
+	 * Maximum number of rows in a chunk group of the stripe, and the bitmap
+	 * of the rows deleted from the stripe, or NULL if no rows are deleted.
+	 */
+	uint32 chunkGroupRowCount;
+	uint8 *deletedRowMask;
+
+	/* counters of the scan that reads the stripe */
+	struct ColumnarScanStats *scanStats;
 } StripeBuffers;
 
 
+/*
+ * ColumnarScanStats keeps the counters of a read operation, which are shown
+ * in EXPLAIN ANALYZE and accumulated per relation in columnar.stat_scans.
+ */
+typedef struct ColumnarScanStats
+{
+	/* stripes that we read, and the ones whose chunk groups were all skipped */
+	int64 stripesRead;
+	int64 stripesSkipped;
+
+	int64 chunkGroupsRead;
+	int64 chunkGroupsSkipped;
+
+	/* bytes read from the storage, and the bytes produced by decompressing them */
+	int64 bytesRead;
+	int64 bytesDecompressed;
+	instr_time decompressionTime;
+} ColumnarScanStats;
+
+
 /* return value of StripeWriteState to decide stripe write state */
 typedef enum StripeWriteStateEnum
 {
@@ -207,11 +299,67 @@ typedef bool (*ColumnarSupportsIndexAM_type)(char *);
 typedef const char *(*CompressionTypeStr_type)(CompressionType);
 typedef bool (*IsColumnarTableAmTable_type)(Oid);
 typedef bool (*ReadColumnarOptions_type)(Oid, ColumnarOptions *);
+typedef List *(*ColumnarTableRelationIdList_type)(void);
+typedef uint64 (*ColumnarCompactSmallStripes_type)(Oid);
+
+/*
+ * ColumnarStripeExportCallback is called by ColumnarExportStripes for each
+ * stripe of the exported table, with the stripe serialized into stripeBuffer
+ * in the format that columnar_internal.import_stripe() accepts.
+ */
+typedef void (*ColumnarStripeExportCallback)(StringInfo stripeBuffer,
+											 void *callbackState);
+typedef bool (*ColumnarStripeTransferSupported_type)(Oid);
+typedef uint64 (*ColumnarExportStripes_type)(Oid, ColumnarStripeExportCallback, void *);
+
+/*
+ * ParallelColumnarScanDescData is the shared state of a parallel columnar
+ * scan. It is stored in the dynamic shared memory segment of the parallel
+ * query and participants claim stripes to read by atomically incrementing
+ * nextStripeIndex. Stripes are numbered in the order of their first row
+ * numbers, so all the participants agree on the stripe that given index
+ * refers to since they all use the same snapshot.
+ */
+typedef struct ParallelColumnarScanDescData
+{
+	ParallelTableScanDescData base; /* must be first field */
+
+	pg_atomic_uint64 nextStripeIndex;
+} ParallelColumnarScanDescData;
+
+typedef struct ParallelColumnarScanDescData *ParallelColumnarScanDesc;
 
 /* ColumnarReadState represents state of a columnar scan. */
 struct ColumnarReadState;
 typedef struct ColumnarReadState ColumnarReadState;
 
+/*
+ * ColumnarChunkGroupCallback is called for each chunk group that is not
+ * refuted by the quals of a read operation, before the chunk group is read.
+ * allRowsMatch is true if the min/max values in the skip list prove that all
+ * rows of the chunk group satisfy the quals. The chunk group is read only if
+ * the callback returns true.
+ */
+typedef bool (*ColumnarChunkGroupCallback)(StripeSkipList *stripeSkipList,
+										   uint32 chunkIndex, bool allRowsMatch,
+										   void *callbackState);
+
+
+/*
+ * ColumnarSampleStripe describes the rows of a stripe for the scans that
+ * sample rows from it, see ColumnarReadSampleStripes.
+ */
+typedef struct ColumnarSampleStripe
+{
+	uint64 firstRowNumber;
+	uint64 rowCount;
+	uint32 chunkGroupRowCount;
+
+	/* number of rows and chunk groups in the stripes that come before it */
+	uint64 precedingRowCount;
+	uint64 precedingChunkGroupCount;
+} ColumnarSampleStripe;
+
 
 /* ColumnarWriteState represents state of a columnar write operation. */
 struct ColumnarWriteState;
@@ -221,7 +369,15 @@ typedef struct ColumnarWriteState ColumnarWriteState;
 extern int columnar_compression;
 extern int columnar_stripe_row_limit;
 extern int columnar_chunk_group_row_limit;
+extern int columnar_stripe_memory_limit;
 extern int columnar_compression_level;
+extern int columnar_compression_workers;
+extern bool columnar_enable_bloom_filter;
+extern bool columnar_enable_chunk_encoding;
+extern bool columnar_enable_vectorized_filter;
+extern int columnar_chunk_cache_size;
+extern int columnar_stat_scans_max;
+extern double columnar_vacuum_compaction_threshold;
 
 /* called when the user changes options on the given relation */
 typedef void (*ColumnarTableSetOptions_hook_type)(Oid relid, ColumnarOptions options);
@@ -234,6 +390,7 @@ extern CompressionType ParseCompressionType(const char *compressionTypeString);
 /* Function declarations for writing to a columnar table */
 extern ColumnarWriteState * ColumnarBeginWrite(RelFileLocator relfilelocator,
 											   ColumnarOptions options,
+											   ColumnarColumnOptions *columnOptions,
 											   TupleDesc tupleDescriptor);
 extern uint64 ColumnarWriteRow(ColumnarWriteState *state, Datum *columnValues,
 							   bool *columnNulls);
@@ -241,6 +398,9 @@ extern void ColumnarFlushPendingWrites(ColumnarWriteState *state);
 extern void ColumnarEndWrite(ColumnarWriteState *state);
 extern bool ContainsPendingWrites(ColumnarWriteState *state);
 extern MemoryContext ColumnarWritePerTupleContext(ColumnarWriteState *state);
+extern Tuplesortstate * ColumnarBeginSortKeySort(TupleDesc tupleDescriptor,
+												 ColumnarColumnOptions *columnOptions,
+												 int workMem);
 
 /* Function declarations for reading from columnar table */
 
@@ -251,7 +411,8 @@ extern ColumnarReadState * ColumnarBeginRead(Relation relation,
 											 List *qualConditions,
 											 MemoryContext scanContext,
 											 Snapshot snaphot,
-											 bool randomAccess);
+											 bool randomAccess,
+											 ParallelColumnarScanDesc parallelScan);
 extern void ColumnarReadFlushPendingWrites(ColumnarReadState *readState);
 extern void ColumnarEndRead(ColumnarReadState *state);
 extern void ColumnarResetRead(ColumnarReadState *readState);
@@ -260,6 +421,10 @@ extern void ColumnarResetRead(ColumnarReadState *readState);
 extern bool ColumnarReadNextRow(ColumnarReadState *state, Datum *columnValues,
 								bool *columnNulls, uint64 *rowNumber);
 extern int64 ColumnarReadChunkGroupsFiltered(ColumnarReadState *state);
+extern ColumnarScanStats * ColumnarReadScanStats(ColumnarReadState *state);
+extern void ColumnarReadSetChunkGroupCallback(ColumnarReadState *readState,
+											  ColumnarChunkGroupCallback callback,
+											  void *callbackState);
 extern void ColumnarRescan(ColumnarReadState *readState, List *scanQual);
 
 /* functions only applicable for random access */
@@ -269,6 +434,11 @@ extern void ColumnarReadRowByRowNumberOrError(ColumnarReadState *readState,
 extern bool ColumnarReadRowByRowNumber(ColumnarReadState *readState,
 									   uint64 rowNumber, Datum *columnValues,
 									   bool *columnNulls);
+extern ColumnarSampleStripe * ColumnarReadSampleStripes(ColumnarReadState *readState,
+														uint32 *stripeCount);
+extern uint8 * ColumnarReadStripeRowMask(Relation relation,
+										 StripeMetadata *stripeMetadata,
+										 Snapshot snapshot);
 
 /* Function declarations for common functions */
 extern FmgrInfo * GetFunctionInfoOrNull(Oid typeId, Oid accessMethodId,
@@ -284,6 +454,8 @@ extern PGDLLEXPORT void InitColumnarOptions(Oid regclass);
 extern PGDLLEXPORT void SetColumnarOptions(Oid regclass, ColumnarOptions *options);
 extern PGDLLEXPORT bool DeleteColumnarTableOptions(Oid regclass, bool missingOk);
 extern PGDLLEXPORT bool ReadColumnarOptions(Oid regclass, ColumnarOptions *options);
+extern ColumnarColumnOptions * ReadColumnarColumnOptions(Oid regclass,
+														 uint32 columnCount);
 extern PGDLLEXPORT bool IsColumnarTableAmTable(Oid relationId);
 
 /* columnar_metadata_tables.c */
@@ -301,6 +473,8 @@ extern void SaveStripeSkipList(RelFileLocator relfilelocator, uint64 stripe,
 							   TupleDesc tupleDescriptor);
 extern void SaveChunkGroups(RelFileLocator relfilelocator, uint64 stripe,
 							List *chunkGroupRowCounts);
+extern bool ColumnarChunkEncodingSupported(void);
+extern bool ColumnarChunkBloomFilterSupported(void);
 extern StripeSkipList * ReadStripeSkipList(RelFileLocator relfilelocator, uint64 stripe,
 										   TupleDesc tupleDescriptor,
 										   uint32 chunkCount,
@@ -316,8 +490,22 @@ extern StripeWriteStateEnum StripeWriteState(StripeMetadata *stripeMetadata);
 extern uint64 StripeGetHighestRowNumber(StripeMetadata *stripeMetadata);
 extern StripeMetadata * FindStripeWithHighestRowNumber(Relation relation,
 													   Snapshot snapshot);
+extern uint8 * ReadStripeRowMask(uint64 storageId, uint64 stripeId, uint64 rowCount,
+								 Snapshot snapshot);
+extern void SaveStripeRowMask(uint64 storageId, uint64 stripeId, uint64 rowCount,
+							  const uint8 *deletedRowMask);
+extern uint64 ColumnarDeletedRowCount(RelFileLocator relfilelocator);
+extern void DeleteStripeMetadataRows(RelFileLocator relfilelocator, uint64 stripeId);
+extern bytea * DatumToBytea(Datum value, Form_pg_attribute attrForm);
+extern Datum ByteaToDatum(bytea *bytes, Form_pg_attribute attrForm);
 extern Datum columnar_relation_storageid(PG_FUNCTION_ARGS);
 
+/* columnar_transfer.c */
+extern PGDLLEXPORT bool ColumnarStripeTransferSupported(Oid relationId);
+extern PGDLLEXPORT uint64 ColumnarExportStripes(Oid relationId,
+												ColumnarStripeExportCallback callback,
+												void *callbackState);
+
 
 /* write_state_management.c */
 extern ColumnarWriteState * columnar_init_write_state(Relation relation, TupleDesc
@@ -335,6 +523,13 @@ extern void MarkRelfilenumberDropped(RelFileNumber relfilenumber,
 extern void NonTransactionDropWriteState(RelFileNumber relfilenumber);
 extern bool PendingWritesInUpperTransactions(RelFileNumber relfilenumber,
 											 SubTransactionId currentSubXid);
+extern bool PendingWritesInCurrentTransaction(RelFileNumber relfilenumber);
+extern bool AddPendingRowDeletion(Relation relation, StripeMetadata *stripeMetadata,
+								  uint64 rowOffset, SubTransactionId currentSubXid,
+								  CommandId cid, CommandId *deletingCid);
+extern void ApplyPendingRowDeletions(RelFileNumber relfilenumber,
+									 StripeMetadata *stripeMetadata,
+									 Snapshot snapshot, uint8 **rowMask);
 extern MemoryContext GetWriteContextForDebug(void);
 
 #endif /* COLUMNAR_H */
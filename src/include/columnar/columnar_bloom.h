@@ -0,0 +1,24 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_bloom.h
+ *
+ * Function declarations for bloom filters of column chunks.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMNAR_BLOOM_H
+#define COLUMNAR_BLOOM_H
+
+/* number of bits per value when sizing a chunk bloom filter */
+#define CHUNK_BLOOM_FILTER_BITS_PER_VALUE 10
+
+/* number of hash functions, which is optimal for the bits per value above */
+#define CHUNK_BLOOM_FILTER_HASH_COUNT 7
+
+extern bytea * BuildChunkBloomFilter(uint32 *hashArray, uint32 hashCount);
+extern bool ChunkBloomFilterMightContain(bytea *bloomFilter, uint32 hash);
+
+#endif /* COLUMNAR_BLOOM_H */
@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_chunk_cache.h
+ *
+ * Type and function declarations for the shared cache of decompressed
+ * column chunks.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMNAR_CHUNK_CACHE_H
+#define COLUMNAR_CHUNK_CACHE_H
+
+#include "lib/stringinfo.h"
+
+/* key of a decompressed column chunk in the cache */
+typedef struct ColumnarChunkCacheKey
+{
+	uint64 storageId;
+	uint64 stripeId;
+	uint32 columnIndex;
+	uint32 chunkGroupIndex;
+} ColumnarChunkCacheKey;
+
+extern void ColumnarChunkCacheInit(void);
+extern bool ColumnarChunkCacheEnabled(void);
+extern StringInfo ColumnarChunkCacheLookup(ColumnarChunkCacheKey *key);
+extern void ColumnarChunkCacheInsert(ColumnarChunkCacheKey *key, StringInfo valueBuffer);
+extern void ColumnarChunkCacheInvalidateStorage(uint64 storageId);
+
+#endif /* COLUMNAR_CHUNK_CACHE_H */
@@ -21,6 +21,12 @@ typedef enum
 	COMPRESSION_LZ4 = 2,
 	COMPRESSION_ZSTD = 3,
 
+	/*
+	 * The writer picks one of the compression types above for each chunk,
+	 * so this is never stored in the chunk metadata.
+	 */
+	COMPRESSION_AUTO = 4,
+
 	COMPRESSION_COUNT
 } CompressionType;
 
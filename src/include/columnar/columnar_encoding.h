@@ -0,0 +1,55 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_encoding.h
+ *
+ * Type and function declarations for column chunk encodings.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMNAR_ENCODING_H
+#define COLUMNAR_ENCODING_H
+
+#include "lib/stringinfo.h"
+
+/*
+ * Enumeration for the encoding that is applied to the serialized values of
+ * a column chunk before they are compressed.
+ */
+typedef enum
+{
+	CHUNK_ENCODING_NONE = 0,
+	CHUNK_ENCODING_DICTIONARY = 1,
+	CHUNK_ENCODING_RLE = 2,
+
+	CHUNK_ENCODING_COUNT
+} ChunkEncodingType;
+
+/* maximum number of distinct values in a dictionary encoded chunk */
+#define CHUNK_DICTIONARY_MAX_ENTRIES 256
+
+/*
+ * ChunkDictionary is the decoded dictionary of a dictionary encoded column
+ * chunk. codeArray is indexed by row and its entries are only valid for the
+ * rows that exist.
+ */
+typedef struct ChunkDictionary
+{
+	uint32 entryCount;
+	Datum *entryArray;
+	uint8 *codeArray;
+} ChunkDictionary;
+
+extern ChunkEncodingType EncodeChunkValues(StringInfo valueBuffer, bool *existsArray,
+										   uint32 rowCount, bool datumTypeByValue,
+										   int datumTypeLength, char datumTypeAlign,
+										   StringInfo encodedBuffer);
+extern ChunkDictionary * DecodeChunkValues(StringInfo valueBuffer,
+										   ChunkEncodingType encodingType,
+										   bool *existsArray, uint32 rowCount,
+										   bool datumTypeByValue, int datumTypeLength,
+										   char datumTypeAlign, Datum *datumArray);
+
+#endif /* COLUMNAR_ENCODING_H */
@@ -65,5 +65,9 @@ extern List * StripesForRelfilelocator(RelFileLocator relfilelocator);
 extern void ColumnarStorageUpdateIfNeeded(Relation rel, bool isUpgrade);
 extern List * ExtractColumnarRelOptions(List *inOptions, List **outColumnarOptions);
 extern void SetColumnarRelOptions(RangeVar *rv, List *reloptions);
+extern List * ExtractColumnarColumnRelOptions(List *inOptions,
+											  List **outColumnarOptions);
+extern void SetColumnarColumnRelOptions(RangeVar *rv, const char *columnName,
+										List *reloptions);
 
 #endif /* COLUMNAR_METADATA_H */
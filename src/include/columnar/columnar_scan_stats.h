@@ -0,0 +1,24 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_scan_stats.h
+ *
+ * Function declarations for the cumulative per relation statistics of
+ * columnar scans.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMNAR_SCAN_STATS_H
+#define COLUMNAR_SCAN_STATS_H
+
+#include "utils/relcache.h"
+
+#include "columnar/columnar.h"
+
+extern void ColumnarScanStatsInit(void);
+extern void ColumnarScanStatsReport(Relation relation, ColumnarScanStats *scanStats);
+extern void ColumnarScanStatsRemove(Oid relationId);
+
+#endif /* COLUMNAR_SCAN_STATS_H */
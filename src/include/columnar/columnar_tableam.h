@@ -58,7 +58,11 @@ extern TableScanDesc columnar_beginscan_extended(Relation relation, Snapshot sna
 												 uint32 flags, Bitmapset *attr_needed,
 												 List *scanQual);
 extern int64 ColumnarScanChunkGroupsFiltered(ColumnarScanDesc columnarScanDesc);
+extern struct ColumnarScanStats * ColumnarScanGetScanStats(ColumnarScanDesc
+															  columnarScanDesc);
 extern PGDLLEXPORT bool ColumnarSupportsIndexAM(char *indexAMName);
+extern PGDLLEXPORT List * ColumnarTableRelationIdList(void);
+extern PGDLLEXPORT uint64 ColumnarCompactSmallStripes(Oid relationId);
 extern bool IsColumnarTableAmTable(Oid relationId);
 extern void CheckCitusColumnarCreateExtensionStmt(Node *parseTree);
 extern void CheckCitusColumnarAlterExtensionStmt(Node *parseTree);
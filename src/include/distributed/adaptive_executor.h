@@ -14,12 +14,31 @@ extern int ExecutorSlowStartInterval;
 extern bool EnableCostBasedConnectionEstablishment;
 extern bool PreventIncompleteConnectionEstablishment;
 
+/* GUC, number of tasks that can be sent over a connection before reading results */
+extern int ExecutorPipelineDepth;
+
+/* GUC, whether the rows of SELECT tasks are received in batches */
+extern bool EnableBatchedTaskResults;
+
+/* GUC, whether to stop executing tasks once the LIMIT of the query is reached */
+extern bool EnableLimitEarlyTermination;
+
+/* GUC, whether the combine query consumes the task results as the tasks finish */
+extern bool EnableIncrementalCombine;
+extern bool EnableResultStreaming;
+extern bool EnableInterleavedLocalExecution;
+extern bool EnableTaskStealing;
+extern double HedgedReadPercentile;
+
 extern uint64 ExecuteTaskList(RowModifyLevel modLevel, List *taskList);
+extern uint64 ExecuteTaskListRespectingDependencies(RowModifyLevel modLevel,
+													 List *taskList);
 extern uint64 ExecuteUtilityTaskList(List *utilityTaskList, bool localExecutionSupported);
 extern uint64 ExecuteUtilityTaskListExtended(List *utilityTaskList, int poolSize,
 											 bool localExecutionSupported);
 extern uint64 ExecuteTaskListOutsideTransaction(RowModifyLevel modLevel, List *taskList,
 												int targetPoolSize, List *jobIdList);
+extern double GetRemoteWaitTime(void);
 
 
 #endif /* ADAPTIVE_EXECUTOR_H */
@@ -0,0 +1,30 @@
+/*-------------------------------------------------------------------------
+ *
+ * async_reference_table.h
+ *	  Functions for reference tables whose modifications are written to a
+ *	  primary placement and replicated to the other placements via logical
+ *	  replication.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef ASYNC_REFERENCE_TABLE_H
+#define ASYNC_REFERENCE_TABLE_H
+
+#include "postgres.h"
+
+#include "nodes/pg_list.h"
+
+#include "distributed/worker_manager.h"
+
+
+extern List * WritableShardPlacementList(uint64 shardId);
+extern bool IsAsyncReferenceTable(Oid relationId);
+extern List * ExcludeAsyncReplicaPlacements(List *taskList);
+extern void ReplicateAsyncReferenceTablesToNodes(List *workerNodeList);
+extern void PrepareAsyncReferenceTableReplicaRemoval(WorkerNode *workerNode);
+extern void DeleteAsyncReferenceTableRow(Oid relationId);
+
+#endif /* ASYNC_REFERENCE_TABLE_H */
@@ -37,7 +37,13 @@
 typedef struct BackendData
 {
 	Oid databaseId;
+
+	/* serializes writers, readers use changeCount instead */
 	slock_t mutex;
+
+	/* odd while the backend data is being modified, see ReadBackendDataSnapshot */
+	pg_atomic_uint32 changeCount;
+
 	bool cancelledDueToDeadlock;
 	uint64 globalPID;
 	bool distributedCommandOriginator;
@@ -65,6 +71,7 @@ extern uint64 ExtractGlobalPID(const char *applicationName);
 extern int ExtractNodeIdFromGlobalPID(uint64 globalPID, bool missingOk);
 extern int ExtractProcessIdFromGlobalPID(uint64 globalPID);
 extern void GetBackendDataForProc(PGPROC *proc, BackendData *result);
+extern bool UserHasPermissionToViewStatsOf(Oid currentUserId, Oid backendOwnedId);
 extern void CancelTransactionDueToDeadlock(PGPROC *proc);
 extern bool MyBackendGotCancelledDueToDeadlock(bool clearState);
 extern List * ActiveDistributedTransactionNumbers(void);
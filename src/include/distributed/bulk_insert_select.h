@@ -0,0 +1,28 @@
+/*-------------------------------------------------------------------------
+ *
+ * bulk_insert_select.h
+ *
+ * Declarations for public functions and types related to inserting the
+ * rows of an INSERT ... SELECT on a shard with bulk inserts.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef BULK_INSERT_SELECT_H
+#define BULK_INSERT_SELECT_H
+
+#include "postgres.h"
+
+#include "nodes/extensible.h"
+#include "nodes/plannodes.h"
+
+
+extern bool EnableBulkInsertSelect;
+
+extern CustomScanMethods BulkInsertSelectCustomScanMethods;
+
+extern PlannedStmt * BulkInsertSelectPlan(PlannedStmt *plan);
+
+#endif /* BULK_INSERT_SELECT_H */
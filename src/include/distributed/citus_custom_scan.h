@@ -12,8 +12,10 @@
 
 #include "executor/execdesc.h"
 #include "nodes/plannodes.h"
+#include "portability/instr_time.h"
 
 #include "distributed/distributed_planner.h"
+#include "distributed/intermediate_results.h"
 #include "distributed/multi_server_executor.h"
 
 typedef struct CitusScanState
@@ -28,9 +30,37 @@ typedef struct CitusScanState
 	MultiExecutorType executorType;   /* distributed executor type */
 	bool finishedRemoteScan;          /* flag to check if remote scan is finished */
 	Tuplestorestate *tuplestorestate; /* tuple store to store distributed results */
+	bool firstExecution;              /* whether the plan is executed the first time */
+
+	/* start of the execution and remote wait time by then, for citus_stat_statements */
+	instr_time executionStartTime;
+	double remoteWaitTimeAtStart;
+	IntermediateResultStats intermediateResultStatsAtStart;
+
+	/* whether the plan is logged if the execution is slow */
+	bool logDistributedPlan;
+
+	/* tasks of the worker job left after pruning by subplan results, or NIL */
+	List *subPlanPrunedTaskList;
+
+	/*
+	 * Execution whose remaining tasks are still running while the combine
+	 * query consumes the results of the finished ones, or NULL.
+	 */
+	struct DistributedExecution *incrementalExecution;
+
+	/* whether task results were discarded after the combine query read them */
+	bool discardedTaskResults;
 } CitusScanState;
 
 
+/* GUCs, determining whether the partial aggregates of a node are merged on the node */
+extern bool EnableAggregateCombinePerNode;
+extern bool EnableTDigestCombinePerNode;
+
+/* GUC, determining whether the tasks of a multi-shard SELECT are grouped per node */
+extern bool EnableShardTaskGrouping;
+
 /* custom scan methods for all executors */
 extern CustomScanMethods AdaptiveExecutorCustomScanMethods;
 extern CustomScanMethods NonPushableInsertSelectCustomScanMethods;
@@ -43,6 +73,7 @@ extern void CitusExplainScan(CustomScanState *node, List *ancestors, struct
 							 ExplainState *es);
 extern TupleDesc ScanStateGetTupleDescriptor(CitusScanState *scanState);
 extern EState * ScanStateGetExecutorState(CitusScanState *scanState);
+extern void MergeSortedTaskResults(CitusScanState *scanState, List *taskTupleStoreList);
 
 extern CustomScan * FetchCitusCustomScanIfExists(Plan *plan);
 extern bool IsCitusPlan(Plan *plan);
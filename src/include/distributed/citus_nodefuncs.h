@@ -50,6 +50,7 @@ extern void OutRelationShard(OUTFUNC_ARGS);
 extern void OutRelationRowLock(OUTFUNC_ARGS);
 extern void OutTask(OUTFUNC_ARGS);
 extern void OutLocalPlannedStatement(OUTFUNC_ARGS);
+extern void OutCachedShardQuery(OUTFUNC_ARGS);
 extern void OutDeferredErrorMessage(OUTFUNC_ARGS);
 extern void OutGroupShardPlacement(OUTFUNC_ARGS);
 
@@ -77,6 +78,7 @@ extern void CopyNodeRelationShard(COPYFUNC_ARGS);
 extern void CopyNodeRelationRowLock(COPYFUNC_ARGS);
 extern void CopyNodeTask(COPYFUNC_ARGS);
 extern void CopyNodeLocalPlannedStatement(COPYFUNC_ARGS);
+extern void CopyNodeCachedShardQuery(COPYFUNC_ARGS);
 extern void CopyNodeTaskQuery(COPYFUNC_ARGS);
 extern void CopyNodeDeferredErrorMessage(COPYFUNC_ARGS);
 
@@ -60,6 +60,7 @@ typedef enum CitusNodeTag
 	T_UsedDistributedSubPlan,
 	T_Task,
 	T_LocalPlannedStatement,
+	T_CachedShardQuery,
 	T_ShardInterval,
 	T_ShardPlacement,
 	T_RelationShard,
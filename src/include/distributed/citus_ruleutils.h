@@ -27,6 +27,7 @@ extern Oid get_extension_schema(Oid ext_oid);
 extern char * get_extension_version(Oid extensionId);
 extern char * pg_get_serverdef_string(Oid tableRelationId);
 extern char * pg_get_sequencedef_string(Oid sequenceRelid);
+extern char * pg_get_sequencedef_string_with_cache(Oid sequenceRelid, int64 cacheSize);
 extern Form_pg_sequence pg_get_sequencedef(Oid sequenceRelationId);
 extern char * pg_get_tableschemadef_string(Oid tableRelationId,
 										   IncludeSequenceDefaults includeSequenceDefaults,
@@ -0,0 +1,53 @@
+/*-------------------------------------------------------------------------
+ *
+ * citus_wait_events.h
+ *   Wait events of the places where Citus backends wait for other nodes or
+ *   for shared resources.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef CITUS_WAIT_EVENTS_H
+#define CITUS_WAIT_EVENTS_H
+
+#include "utils/wait_event.h"
+
+
+/*
+ * pg_stat_activity shows all wait events in the extension class as
+ * "Extension", but the event identifier is kept in the wait_event_info of
+ * the backend, from which citus_wait_events() and citus_stat_activity
+ * report the names in CitusWaitEventName().
+ *
+ * The identifiers start at an arbitrary offset to make clashes with other
+ * extensions that report wait events in the extension class less likely.
+ */
+#define CITUS_WAIT_EVENT_ID_OFFSET 0xC100
+
+typedef enum CitusWaitEvent
+{
+	/* establishing connections to other nodes */
+	WAIT_EVENT_CITUS_CONNECTION_ESTABLISH = PG_WAIT_EXTENSION | CITUS_WAIT_EVENT_ID_OFFSET,
+
+	/* sending commands to or waiting for results from other nodes */
+	WAIT_EVENT_CITUS_REMOTE_RESULT,
+
+	/* waiting for a slot in the shared connection pool */
+	WAIT_EVENT_CITUS_SHARED_CONNECTION_SLOT,
+
+	/* waiting for other nodes to accept COPY data */
+	WAIT_EVENT_CITUS_COPY_FLUSH,
+
+	/* fetching an intermediate result from another node */
+	WAIT_EVENT_CITUS_INTERMEDIATE_RESULT_FETCH,
+
+	/* waiting for citus.max_executor_memory to become available */
+	WAIT_EVENT_CITUS_EXECUTOR_MEMORY
+} CitusWaitEvent;
+
+
+extern const char * CitusWaitEventName(uint32 waitEventInfo);
+
+#endif /* CITUS_WAIT_EVENTS_H */
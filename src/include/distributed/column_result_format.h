@@ -0,0 +1,59 @@
+/*-------------------------------------------------------------------------
+ *
+ * column_result_format.h
+ *	  Column-oriented, compressed format for intermediate result files.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMN_RESULT_FORMAT_H
+#define COLUMN_RESULT_FORMAT_H
+
+#include "postgres.h"
+
+#include "access/tupdesc.h"
+#include "lib/stringinfo.h"
+#include "utils/tuplestore.h"
+
+#include "distributed/result_compression.h"
+
+
+/* values of the citus.intermediate_result_format setting */
+typedef enum IntermediateResultFormatType
+{
+	INTERMEDIATE_RESULT_FORMAT_COPY,
+	INTERMEDIATE_RESULT_FORMAT_COLUMNAR
+} IntermediateResultFormatType;
+
+
+/* opaque state of a writer that encodes tuples in stripes */
+typedef struct ColumnResultWriter ColumnResultWriter;
+
+
+extern int IntermediateResultFormat;
+
+
+extern ColumnResultWriter * CreateColumnResultWriter(TupleDesc tupleDescriptor,
+													 ResultCompressionType
+													 compressionType);
+extern void ColumnResultWriterAppendHeader(ColumnResultWriter *writer,
+										   StringInfo output);
+extern bool ColumnResultWriterAddRow(ColumnResultWriter *writer, Datum *columnValues,
+									 bool *columnNulls);
+extern void ColumnResultWriterAppendStripe(ColumnResultWriter *writer,
+										   StringInfo output);
+extern void ColumnResultWriterAppendFooter(ColumnResultWriter *writer,
+										   StringInfo output);
+extern bool IsColumnResultFile(const char *fileName);
+extern bool IsColumnResultData(StringInfo resultData);
+extern void ReadColumnResultFileIntoTupleStore(const char *fileName,
+											   TupleDesc tupleDescriptor,
+											   Tuplestorestate *tupleStore);
+extern void ReadColumnResultDataIntoTupleStore(const char *fileName,
+											   StringInfo resultData,
+											   TupleDesc tupleDescriptor,
+											   Tuplestorestate *tupleStore);
+
+#endif /* COLUMN_RESULT_FORMAT_H */
@@ -27,6 +27,9 @@ extern Path * CreateCitusCustomScanPath(PlannerInfo *root, RelOptInfo *relOptInf
 extern PlannedStmt * PlanCombineQuery(struct DistributedPlan *distributedPlan,
 									  struct CustomScan *dataScan);
 extern bool FindCitusExtradataContainerRTE(Node *node, RangeTblEntry **result);
+extern AttrNumber WorkerSortColumnId(List *workerTargetList,
+									 SortGroupClause *sortClause);
+extern bool EnableSortedMerge;
 extern bool ReplaceCitusExtraDataContainer;
 extern CustomScan *ReplaceCitusExtraDataContainerWithCustomScan;
 
@@ -42,6 +42,11 @@ extern int MaxMatViewSizeToAutoRecreate;
 
 extern bool EnforceLocalObjectRestrictions;
 
+extern int IndexBuildProcessesPerNode;
+
+extern int VacuumProcessesPerNode;
+extern bool VacuumShardsByDeadTuples;
+
 extern void SwitchToSequentialAndLocalExecutionIfRelationNameTooLong(Oid relationId,
 																	 char *
 																	 finalRelationName);
@@ -16,6 +16,8 @@
 #include "nodes/execnodes.h"
 #include "nodes/parsenodes.h"
 #include "parser/parse_coerce.h"
+#include "storage/dsm.h"
+#include "storage/shm_toc.h"
 #include "tcop/dest.h"
 
 #include "distributed/metadata_cache.h"
@@ -37,6 +39,18 @@ typedef enum CitusCopyDest
 } CitusCopyDest;
 
 
+/*
+ * ParallelCopyToMode indicates whether and how COPY .. TO STDOUT on a
+ * distributed table reads its shards in parallel.
+ */
+typedef enum ParallelCopyToMode
+{
+	PARALLEL_COPY_TO_OFF,       /* read the shards one at a time */
+	PARALLEL_COPY_TO_ORDERED,   /* read ahead, but send the shards in order */
+	PARALLEL_COPY_TO_UNORDERED  /* send rows from any shard as they arrive */
+} ParallelCopyToMode;
+
+
 /*
  * A smaller version of copy.c's CopyStateData, trimmed to the elements
  * necessary to copy out results. While it'd be a bit nicer to share code,
@@ -159,10 +173,21 @@ typedef struct CitusCopyDestReceiver
 
 /* GUCs */
 extern bool SkipJsonbValidationInCopy;
+extern bool ValidateJsonbSyntaxOnlyInCopy;
+extern bool EnableBinaryProtocolForCompositeTypes;
 
 /* managed via GUC, the default is 4MB */
 extern int CopySwitchOverThresholdBytes;
 
+/* managed via GUC, see ParallelCopyToMode */
+extern int ParallelCopyTo;
+
+/* managed via GUC, 0 disables parsing COPY .. FROM STDIN in parallel workers */
+extern int ParallelCopyFromWorkers;
+
+/* managed via GUC, whether COPY flushes its other connections while waiting */
+extern bool EnableConcurrentCopyFlush;
+
 
 /* function declarations for copying into a distributed table */
 extern CitusCopyDestReceiver * CreateCitusCopyDestReceiver(Oid relationId,
@@ -171,6 +196,16 @@ extern CitusCopyDestReceiver * CreateCitusCopyDestReceiver(Oid relationId,
 														   EState *executorState,
 														   char *intermediateResultPrefix,
 														   bool isPublishable);
+extern void InitializeCopyRowSerialization(CitusCopyDestReceiver *copyDest,
+										   TupleDesc inputTupleDescriptor);
+extern Relation CopyFromParseRelation(Relation distributedRelation, List *attlist,
+									  bool isInputFormatBinary,
+									  CitusCopyDestReceiver *copyDest);
+extern uint64 ShardIdForTuple(CitusCopyDestReceiver *copyDest, Datum *columnValues,
+							  bool *columnNulls);
+extern void CitusCopyDestReceiverSendRows(CitusCopyDestReceiver *copyDest,
+										  uint64 shardId, StringInfo rowData,
+										  int64 rowCount);
 extern FmgrInfo * ColumnOutputFunctions(TupleDesc rowDescriptor, bool binaryFormat);
 extern bool CanUseBinaryCopyFormat(TupleDesc tupleDescription);
 extern bool CanUseBinaryCopyFormatForTargetList(List *targetEntryList);
@@ -193,5 +228,10 @@ extern void ConversionPathForTypes(Oid inputType, Oid destType, CopyCoercionData
 extern Datum CoerceColumnValue(Datum inputValue, CopyCoercionData *coercionPath);
 extern void ReportCopyError(MultiConnection *connection, PGresult *result);
 
+/* parsing COPY .. FROM STDIN in parallel workers */
+extern bool ParallelCopyFrom(CitusCopyDestReceiver *copyDest, CopyStmt *copyStatement,
+							 uint64 *processedRowCount);
+extern PGDLLEXPORT void ParallelCopyFromWorkerMain(dsm_segment *segment, shm_toc *toc);
+
 
 #endif /* MULTI_COPY_H */
@@ -40,6 +40,7 @@ typedef enum
 extern PropSetCmdBehavior PropagateSetCommands;
 extern bool EnableDDLPropagation;
 extern int CreateObjectPropagationMode;
+extern int ShardDDLBatchSize;
 extern bool EnableCreateDatabasePropagation;
 extern bool EnableCreateTypePropagation;
 extern bool EnableCreateRolePropagation;
@@ -84,6 +85,12 @@ typedef struct DDLJob
 	 * failure.
 	 */
 	bool warnForPartialFailure;
+
+	/*
+	 * Maximum number of connections per node to use for executing the tasks,
+	 * 0 means citus.max_adaptive_executor_pool_size.
+	 */
+	int poolSize;
 } DDLJob;
 
 extern ProcessUtility_hook_type PrevProcessUtility;
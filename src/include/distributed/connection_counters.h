@@ -0,0 +1,52 @@
+/*-------------------------------------------------------------------------
+ *
+ * connection_counters.h
+ *   Cumulative counters of the traffic over the connections to each node.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef CONNECTION_COUNTERS_H
+#define CONNECTION_COUNTERS_H
+
+
+/*
+ * ConnectionCounters are kept per MultiConnection while it is used, and
+ * added to the counters of the node in shared memory at the end of the
+ * transaction or when the connection is closed. Times are in microseconds.
+ */
+typedef struct ConnectionCounters
+{
+	/* commands sent, each of which is a round trip to the node */
+	uint64 commandsSent;
+
+	/* bytes of commands and parameters sent */
+	uint64 bytesSent;
+
+	/* bytes of COPY data sent */
+	uint64 copyBytesSent;
+
+	/* bytes of result rows and intermediate results received */
+	uint64 bytesReceived;
+
+	uint64 connectionsEstablished;
+	uint64 connectionEstablishmentTime;
+
+	/* connections that were closed before they were established */
+	uint64 connectionFailures;
+
+	/* time spent waiting for the results of commands */
+	uint64 waitTime;
+} ConnectionCounters;
+
+
+struct MultiConnection;
+
+extern void InitializeConnectionCounters(void);
+extern size_t ConnectionCountersShmemSize(void);
+extern void ConnectionCountersShmemInit(void);
+extern void FlushConnectionCounters(struct MultiConnection *connection);
+
+#endif /* CONNECTION_COUNTERS_H */
@@ -22,6 +22,7 @@
 #include "utils/hsearch.h"
 #include "utils/timestamp.h"
 
+#include "distributed/connection_counters.h"
 #include "distributed/remote_transaction.h"
 #include "distributed/transaction_management.h"
 
@@ -223,6 +224,16 @@ typedef struct MultiConnection
 	/* replication option */
 	bool requiresReplication;
 
+	/* statements prepared on the connection, see remote_prepared_statements.c */
+	HTAB *preparedStatementHash;
+	MemoryContext preparedStatementContext;
+
+	/* counters not yet added to the counters of the node, see connection_counters.c */
+	ConnectionCounters counters;
+
+	/* sampled command in flight, see remote_command_trace.c */
+	struct PendingRemoteCommandTrace *pendingCommandTrace;
+
 	MultiConnectionStructInitializationState initializationState;
 } MultiConnection;
 
@@ -279,6 +290,7 @@ extern int MaxCachedConnectionLifetime;
 /* parameters used for outbound connections */
 extern char *NodeConninfo;
 extern char *LocalHostName;
+extern bool CacheNodeAddresses;
 extern bool checkAtBootPassed;
 
 /* the hash tables are externally accessiable */
@@ -324,6 +336,7 @@ extern void CloseNodeConnectionsAfterTransaction(char *nodeName, int nodePort);
 extern MultiConnection * ConnectionAvailableToNode(char *hostName, int nodePort,
 												   const char *userName,
 												   const char *database);
+extern int WarmNodeConnections(List *workerNodeList);
 extern void CloseConnection(MultiConnection *connection);
 extern void ShutdownAllConnections(void);
 extern void ShutdownConnection(MultiConnection *connection);
@@ -214,6 +214,7 @@ extern TableDDLCommand * ColumnarGetCustomTableOptionsDDL(char *schemaName,
 /* Config variables managed via guc.c */
 extern int ShardCount;
 extern int ShardReplicationFactor;
+extern int ShardCreationBatchSize;
 extern int NextShardId;
 extern int NextPlacementId;
 
@@ -253,6 +254,8 @@ extern void CreateAppendDistributedShardPlacements(Oid relationId, int64 shardId
 												   replicationFactor);
 extern void CreateShardsOnWorkers(Oid distributedRelationId, List *shardPlacements,
 								  bool useExclusiveConnection);
+extern void BeginShardCreationBatch(MemoryContext batchContext);
+extern void EndShardCreationBatch(bool executeDeferred);
 extern void InsertShardPlacementRows(Oid relationId, int64 shardId,
 									 List *workerNodeList, int workerStartIndex,
 									 int replicationFactor);
@@ -293,6 +296,8 @@ extern Datum lock_relation_if_exists(PG_FUNCTION_ARGS);
 extern Datum citus_drop_all_shards(PG_FUNCTION_ARGS);
 extern Datum master_drop_all_shards(PG_FUNCTION_ARGS);
 extern int MasterDropAllShards(Oid relationId, char *schemaName, char *relationName);
+extern void BeginShardDropBatch(MemoryContext batchContext);
+extern void EndShardDropBatch(bool executeDeferred);
 
 /* function declarations for shard creation functionality */
 extern Datum master_create_worker_shards(PG_FUNCTION_ARGS);
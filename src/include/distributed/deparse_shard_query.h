@@ -22,8 +22,38 @@
 #include "distributed/citus_custom_scan.h"
 
 
+/*
+ * ShardQueryTemplate is a query string deparsed with placeholders for the
+ * shard names, into which the shard names of each task are spliced.
+ */
+typedef struct ShardQueryTemplate
+{
+	/* parts of the query string around the placeholders, one more than those */
+	List *fragmentList;
+
+	/* index into placeholderRelationIdList of the placeholder after each fragment */
+	List *placeholderIndexList;
+
+	/* relation whose shard name replaces each placeholder */
+	List *placeholderRelationIdList;
+} ShardQueryTemplate;
+
+
+/* GUC to enable splicing shard names into a query deparsed once per job */
+extern bool EnableShardQueryTemplates;
+
+/* GUC to keep the shard query templates of queries across executions */
+extern bool EnableShardQueryTemplateCache;
+
 extern void RebuildQueryStrings(Job *workerJob);
 extern bool UpdateRelationToShardNames(Node *node, List *relationShardList);
+extern ShardQueryTemplate * CreateShardQueryTemplate(Query *query,
+													 List *relationShardList,
+													 char *shardQueryString);
+extern char * ShardQueryStringFromTemplate(ShardQueryTemplate *queryTemplate,
+										   List *relationShardList);
+extern ShardQueryTemplate * LookupShardQueryTemplate(Query *query);
+extern void CacheShardQueryTemplate(Query *query, ShardQueryTemplate *queryTemplate);
 extern void SetTaskQueryIfShouldLazyDeparse(Task *task, Query *query);
 extern void SetTaskQueryString(Task *task, char *queryString);
 extern void SetTaskQueryStringList(Task *task, List *queryStringList);
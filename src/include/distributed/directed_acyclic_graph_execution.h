@@ -14,6 +14,8 @@
 
 #include "nodes/pg_list.h"
 
+extern bool EnableRepartitionJoinPipelining;
+
 extern void ExecuteTasksInDependencyOrder(List *allTasks, List *excludedTasks,
 										  List *jobIds);
 
@@ -32,6 +32,17 @@ typedef struct TransactionNode
 	PGPROC *initiatorProc;
 
 	bool transactionVisited;
+
+	/*
+	 * Strongly connected component of the wait graph that the transaction
+	 * belongs to, and the bookkeeping used to find it. A transaction can only
+	 * be part of a deadlock if its component contains a cycle.
+	 */
+	int componentId;
+	bool inCyclicComponent;
+	int componentIndex;
+	int componentLowLink;
+	bool onComponentStack;
 } TransactionNode;
 
 
@@ -37,6 +37,9 @@
 /* level of planner calls */
 extern int PlannerLevel;
 
+extern bool EnableGenericMultiShardPlans;
+extern bool EnableFastPathPlanningContext;
+
 
 typedef struct RelationRestrictionContext
 {
@@ -0,0 +1,25 @@
+/*-------------------------------------------------------------------------
+ *
+ * distributed_table_statistics.h
+ *	  Functions for storing the merged statistics of the shards of Citus
+ *	  tables as the statistics of the tables on the coordinator.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef DISTRIBUTED_TABLE_STATISTICS_H
+#define DISTRIBUTED_TABLE_STATISTICS_H
+
+#include "postgres.h"
+
+#include "nodes/pathnodes.h"
+
+
+extern bool EnableDistributedAnalyze;
+
+extern void UpdateDistributedTableStatistics(Oid relationId);
+extern void EstimateCitusTableSize(Oid relationId, RelOptInfo *relOptInfo);
+
+#endif /* DISTRIBUTED_TABLE_STATISTICS_H */
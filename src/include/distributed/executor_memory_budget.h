@@ -0,0 +1,46 @@
+/*-------------------------------------------------------------------------
+ *
+ * executor_memory_budget.h
+ *   Admission control for distributed executions based on the memory of
+ *   the coordinator that they use.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef EXECUTOR_MEMORY_BUDGET_H
+#define EXECUTOR_MEMORY_BUDGET_H
+
+#include "postgres.h"
+
+#include "utils/palloc.h"
+
+
+/*
+ * ExecutorMemoryReservation is the part of citus.max_executor_memory that a
+ * distributed execution holds. The reservation is released when the memory
+ * context it is allocated in is reset, such that executions that fail do not
+ * hold on to their memory.
+ */
+typedef struct ExecutorMemoryReservation
+{
+	uint64 reservedBytes;
+	bool released;
+	MemoryContextCallback releaseCallback;
+} ExecutorMemoryReservation;
+
+
+extern int MaxExecutorMemory;
+extern int ExecutorMemoryWaitTimeout;
+
+
+extern void InitializeExecutorMemoryBudget(void);
+extern size_t ExecutorMemoryBudgetShmemSize(void);
+extern void ExecutorMemoryBudgetShmemInit(void);
+extern ExecutorMemoryReservation * ReserveExecutorMemory(uint64 estimatedBytes);
+extern void UpdateExecutorMemoryReservation(ExecutorMemoryReservation *reservation,
+											uint64 usedBytes);
+extern void ReleaseExecutorMemory(ExecutorMemoryReservation *reservation);
+
+#endif /* EXECUTOR_MEMORY_BUDGET_H */
@@ -12,6 +12,7 @@
 #include "postgres.h"
 
 #include "distributed/distributed_planner.h"
+#include "distributed/metadata_cache.h"
 #include "distributed/multi_physical_planner.h"
 
 
@@ -23,6 +24,9 @@ extern bool InTopLevelDelegatedFunctionCall;
 extern bool InDelegatedProcedureCall;
 
 PlannedStmt * TryToDelegateFunctionCall(DistributedPlanningContext *planContext);
+extern Oid DistributedFunctionColocatedTableId(DistObjectCacheEntry *procedure);
+extern void InvalidateFunctionDelegationCache(void);
+extern void InvalidateFunctionDelegationCacheForRelation(Oid relationId);
 extern void CheckAndResetAllowedShardKeyValueIfNeeded(void);
 extern bool IsShardKeyValueAllowed(Const *shardKey, uint32 colocationId);
 
@@ -0,0 +1,16 @@
+/*-------------------------------------------------------------------------
+ *
+ * health_check.h
+ *   Checks of the connectivity and the health of the nodes in the cluster.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef HEALTH_CHECK_H
+#define HEALTH_CHECK_H
+
+extern void ProbeNodeHealth(void);
+
+#endif /* HEALTH_CHECK_H */
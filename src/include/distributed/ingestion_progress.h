@@ -0,0 +1,45 @@
+/*-------------------------------------------------------------------------
+ *
+ * ingestion_progress.h
+ *	  Functions for keeping track of the progress of resumable bulk loads
+ *	  in pg_dist_ingestion.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INGESTION_PROGRESS_H
+#define INGESTION_PROGRESS_H
+
+#include "postgres.h"
+
+#include "nodes/parsenodes.h"
+
+
+/*
+ * IngestionProgress describes how a COPY with the ingestion_id option
+ * continues a bulk load.
+ */
+typedef struct IngestionProgress
+{
+	char *ingestionId;
+
+	/* number of rows of the load that precede the input of the COPY */
+	int64 inputOffset;
+
+	/* number of rows of the load that were committed before the COPY */
+	int64 committedRowCount;
+
+	/* number of rows at the start of the input that were committed before */
+	int64 skipRowCount;
+} IngestionProgress;
+
+
+extern IngestionProgress * ProcessIngestionOptions(Oid relationId,
+												   CopyStmt *copyStatement);
+extern void RecordIngestionProgress(Oid relationId, IngestionProgress *progress,
+									uint64 copiedRowCount);
+extern void DeleteIngestionProgressForRelation(Oid relationId);
+
+#endif /* INGESTION_PROGRESS_H */
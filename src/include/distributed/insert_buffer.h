@@ -0,0 +1,27 @@
+/*-------------------------------------------------------------------------
+ *
+ * insert_buffer.h
+ *   Buffering of router INSERTs in transaction blocks.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef INSERT_BUFFER_H
+#define INSERT_BUFFER_H
+
+#include "distributed/citus_custom_scan.h"
+
+
+extern int MaxBufferedInsertRows;
+
+
+extern bool IsBufferableInsertPlan(PlannedStmt *plannedStmt);
+extern bool ShouldBufferInsert(CitusScanState *scanState);
+extern void BufferInsert(CitusScanState *scanState);
+extern bool HasBufferedInserts(void);
+extern void FlushBufferedInserts(void);
+extern void ResetBufferedInserts(void);
+
+#endif /* INSERT_BUFFER_H */
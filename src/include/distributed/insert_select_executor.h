@@ -3,7 +3,7 @@
  * insert_select_executor.h
  *
  * Declarations for public functions and types related to executing
- * INSERT..SELECT commands.
+ * INSERT..SELECT commands, and multi-row INSERTs via COPY.
  *
  * Copyright (c) Citus Data, Inc.
  *
@@ -16,9 +16,15 @@
 
 #include "executor/execdesc.h"
 
+#include "distributed/citus_custom_scan.h"
+
+
+extern int MultiRowInsertCopyThreshold;
 
 extern TupleTableSlot * NonPushableInsertSelectExecScan(CustomScanState *node);
 extern List * BuildColumnNameListFromTargetList(Oid targetRelationId,
 												List *insertTargetList);
+extern bool ShouldExecuteMultiRowInsertViaCopy(CitusScanState *scanState);
+extern void ExecuteMultiRowInsertViaCopy(CitusScanState *scanState);
 
 #endif /* INSERT_SELECT_EXECUTOR_H */
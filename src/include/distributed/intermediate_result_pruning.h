@@ -14,8 +14,14 @@
 #include "distributed/subplan_execution.h"
 
 extern bool LogIntermediateResults;
+extern bool EnableSubPlanTaskPruning;
+extern bool EnableSubPlanResultSlicing;
 
 extern List * FindSubPlanUsages(DistributedPlan *plan);
+extern void MarkSubPlansForTaskPruning(DistributedPlan *distributedPlan, uint64 planId,
+									   Query *query);
+extern void MarkSubPlansForResultSlicing(DistributedPlan *distributedPlan,
+										 uint64 planId, Query *query);
 extern List * FindAllWorkerNodesUsingSubplan(HTAB *intermediateResultsHash,
 											 char *resultId);
 extern HTAB * MakeIntermediateResultHTAB(void);
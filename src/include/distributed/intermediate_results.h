@@ -21,6 +21,7 @@
 #include "utils/palloc.h"
 
 #include "distributed/commands/multi_copy.h"
+#include "distributed/result_compression.h"
 
 
 /*
@@ -70,9 +71,36 @@ typedef struct NodeToNodeFragmentsTransfer
 	List *fragmentList;
 } NodeToNodeFragmentsTransfer;
 
+/*
+ * IntermediateResultStats are the cumulative statistics of the intermediate
+ * results that a backend created through a RemoteFileDestReceiver.
+ */
+typedef struct IntermediateResultStats
+{
+	/* number of intermediate results created */
+	uint64 resultCount;
+
+	/* bytes of the results, as written to the local file or sent to one node */
+	uint64 bytesWritten;
+
+	/* bytes sent to all nodes together, after compression */
+	uint64 bytesBroadcast;
+
+	/* number of nodes that received the results, including forwarded ones */
+	uint64 receivingNodeCount;
+
+	/* time spent in the RemoteFileDestReceiver, in milliseconds */
+	double receiverTime;
+} IntermediateResultStats;
+
+
 /* Forward Declarations */
 struct CitusTableCacheEntry;
 
+/* config variables managed via guc.c */
+extern int FragmentFetchStreams;
+extern int IntermediateResultBroadcastFanout;
+
 /* intermediate_results.c */
 extern DestReceiver * CreateRemoteFileDestReceiver(const char *resultId,
 												   EState *executorState,
@@ -92,8 +120,13 @@ extern CitusTableCacheEntry * QueryTupleShardSearchInfo(ArrayType *minValuesArra
 														Var *partitionColumn);
 extern void WriteToLocalFile(StringInfo copyData, FileCompat *fileCompat);
 extern uint64 RemoteFileDestReceiverBytesSent(DestReceiver *destReceiver);
-extern void SendQueryResultViaCopy(const char *resultId);
-extern void ReceiveQueryResultViaCopy(const char *resultId);
+extern void GetIntermediateResultStats(IntermediateResultStats *stats);
+extern void SubtractIntermediateResultStats(IntermediateResultStats *stats,
+											IntermediateResultStats *statsAtStart);
+extern void SendQueryResultViaCopy(const char *resultId,
+								   ResultCompressionType compressionType);
+extern void ReceiveQueryResultViaCopy(const char *resultId,
+									  ResultCompressionType compressionType);
 extern void RemoveIntermediateResultsDirectories(void);
 extern int64 IntermediateResultSize(const char *resultId);
 extern char * QueryResultFileName(const char *resultId);
@@ -107,11 +140,26 @@ extern List ** RedistributeTaskListResults(const char *resultIdPrefix,
 										   List *selectTaskList,
 										   int partitionColumnIndex,
 										   CitusTableCacheEntry *targetRelation,
-										   bool binaryFormat);
+										   bool binaryFormat,
+										   bool allowNullPartitionColumnValues);
 extern List * PartitionTasklistResults(const char *resultIdPrefix, List *selectTaskList,
 									   int partitionColumnIndex,
 									   CitusTableCacheEntry *distributionScheme,
-									   bool binaryFormat);
+									   bool binaryFormat,
+									   bool allowNullPartitionColumnValues);
+extern List ** PartitionTasklistResultsByShard(const char *resultIdPrefix,
+											   List *selectTaskList,
+											   int partitionColumnIndex,
+											   CitusTableCacheEntry *targetRelation,
+											   bool binaryFormat,
+											   bool allowNullPartitionColumnValues,
+											   List ***fragmentFetchQueries);
+extern List ** PushTasklistResultsToShards(const char *resultIdPrefix,
+										   List *selectTaskList,
+										   int partitionColumnIndex,
+										   CitusTableCacheEntry *targetRelation,
+										   bool binaryFormat,
+										   bool allowNullPartitionColumnValues);
 extern char * QueryStringForFragmentsTransfer(
 	NodeToNodeFragmentsTransfer *fragmentsTransfer);
 extern void ShardMinMaxValueArrays(ShardInterval **shardIntervalArray, int shardCount,
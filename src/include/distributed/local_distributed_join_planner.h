@@ -24,6 +24,7 @@ typedef enum
 	LOCAL_JOIN_POLICY_PREFER_LOCAL = 1,
 	LOCAL_JOIN_POLICY_PREFER_DISTRIBUTED = 2,
 	LOCAL_JOIN_POLICY_AUTO = 3,
+	LOCAL_JOIN_POLICY_COST_BASED = 4,
 } LocalJoinPolicy;
 
 extern int LocalTableJoinPolicy;
@@ -3,6 +3,9 @@
 
 extern bool IsLocalPlanCachingSupported(Job *currentJob,
 										DistributedPlan *originalDistributedPlan);
+extern void CacheLocalPlansForJob(Job *currentJob,
+								  DistributedPlan *originalDistributedPlan,
+								  ParamListInfo paramListInfo);
 extern PlannedStmt * GetCachedLocalPlan(Task *task, DistributedPlan *distributedPlan);
 extern void CacheLocalPlanForShardQuery(Task *task,
 										DistributedPlan *originalDistributedPlan,
@@ -12,14 +12,44 @@
 #ifndef MAINTENANCED_H
 #define MAINTENANCED_H
 
+#include "utils/timestamp.h"
+
 /* collect statistics every 24 hours */
 #define STATS_COLLECTION_TIMEOUT_MILLIS (24 * 60 * 60 * 1000)
 
 /* if statistics collection fails, retry in 1 minute */
 #define STATS_COLLECTION_RETRY_TIMEOUT_MILLIS (60 * 1000)
 
+/*
+ * MaintenanceDaemonDuty lists the duties of the maintenance daemon, for which
+ * it keeps track of the time they take.
+ */
+typedef enum MaintenanceDaemonDuty
+{
+	MAINTENANCE_DUTY_STATISTICS_COLLECTION,
+	MAINTENANCE_DUTY_METADATA_SYNC_CHECK,
+	MAINTENANCE_DUTY_2PC_RECOVERY,
+	MAINTENANCE_DUTY_DEADLOCK_DETECTION,
+	MAINTENANCE_DUTY_SHARD_CLEANUP,
+	MAINTENANCE_DUTY_STAT_STATEMENTS_PURGE,
+	MAINTENANCE_DUTY_COLUMNAR_STRIPE_COMPACTION,
+	MAINTENANCE_DUTY_SHARD_COLUMN_STATISTICS_REFRESH,
+	MAINTENANCE_DUTY_SHARD_SIZE_CACHE_REFRESH,
+	MAINTENANCE_DUTY_NODE_HEALTH_CHECK,
+	MAINTENANCE_DUTY_TENANT_ISOLATION_CHECK,
+	MAINTENANCE_DUTY_BACKGROUND_TASK_QUEUE_CHECK,
+
+	MAINTENANCE_DUTY_COUNT
+} MaintenanceDaemonDuty;
+
 /* config variable for */
 extern double DistributedDeadlockDetectionTimeoutFactor;
+extern bool Recover2PCInBackgroundWorker;
+extern int ColumnarStripeCompactionInterval;
+extern int ShardColumnStatisticsRefreshInterval;
+extern int ShardSizeCacheRefreshInterval;
+extern int NodeHealthCheckInterval;
+extern int TenantIsolationCheckInterval;
 extern char *MainDb;
 
 extern void StopMaintenanceDaemon(Oid databaseId);
@@ -30,6 +60,8 @@ extern void MaintenanceDaemonShmemInit(void);
 extern void InitializeMaintenanceDaemonBackend(void);
 extern void InitializeMaintenanceDaemonForMainDb(void);
 extern bool LockCitusExtension(void);
+extern void RecordMaintenanceDutyTime(Oid databaseId, MaintenanceDaemonDuty duty,
+									  TimestampTz startTime);
 
 extern PGDLLEXPORT void CitusMaintenanceDaemonMain(Datum main_arg);
 
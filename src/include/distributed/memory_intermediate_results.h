@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * memory_intermediate_results.h
+ *   Small intermediate results that are kept in dynamic shared memory
+ *   instead of in files.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef MEMORY_INTERMEDIATE_RESULTS_H
+#define MEMORY_INTERMEDIATE_RESULTS_H
+
+#include "postgres.h"
+
+#include "lib/stringinfo.h"
+
+
+extern int IntermediateResultMemoryThreshold;
+
+
+extern void InitializeMemoryIntermediateResults(void);
+extern size_t MemoryIntermediateResultsShmemSize(void);
+extern void MemoryIntermediateResultsShmemInit(void);
+extern int64 MemoryIntermediateResultLimit(void);
+extern bool StoreMemoryIntermediateResult(const char *fileName, StringInfo resultData);
+extern StringInfo FetchMemoryIntermediateResult(const char *fileName);
+extern int64 MemoryIntermediateResultSize(const char *fileName);
+extern void RemoveMemoryIntermediateResult(const char *fileName);
+extern void RemoveMemoryIntermediateResults(void);
+
+#endif /* MEMORY_INTERMEDIATE_RESULTS_H */
@@ -12,6 +12,8 @@
 #ifndef MERGE_EXECUTOR_H
 #define MERGE_EXECUTOR_H
 
+extern bool EnableMergeFragmentFetchPipelining;
+
 extern TupleTableSlot * NonPushableMergeCommandExecScan(CustomScanState *node);
 
 #endif /* MERGE_EXECUTOR_H */
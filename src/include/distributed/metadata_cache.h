@@ -19,9 +19,11 @@
 
 #include "distributed/metadata_utility.h"
 #include "distributed/pg_dist_partition.h"
+#include "distributed/shared_placement_cache.h"
 #include "distributed/worker_manager.h"
 
 extern bool EnableVersionChecks;
+extern bool EnableIncrementalShardListRebuild;
 
 /* managed via guc.c */
 typedef enum
@@ -40,6 +42,43 @@ extern int ReadFromSecondaries;
 #define GROUP_ID_UPGRADING -2
 
 
+/*
+ * ShardColumnValueRange describes the values of a column in a shard, as
+ * recorded in pg_dist_shard_column_stats, together with the operators that
+ * are needed to compare them with the restrictions of a query.
+ */
+typedef struct ShardColumnValueRange
+{
+	AttrNumber attributeNumber;
+	Oid columnType;
+	int32 columnTypeMod;
+	Oid columnCollation;
+
+	/* whether the shard has rows in which the column is NULL */
+	bool hasNulls;
+
+	/* smallest and largest non-NULL values, NULL if all values are NULL */
+	Const *minValue;
+	Const *maxValue;
+
+	/* >= and <= operators of the default btree operator class of the type */
+	Oid operatorInputType;
+	Oid greaterEqualOperator;
+	Oid lessEqualOperator;
+} ShardColumnValueRange;
+
+
+/*
+ * ShardColumnStatistics holds the statistics of a shard that were not
+ * invalidated by a write since they were collected.
+ */
+typedef struct ShardColumnStatistics
+{
+	int64 rowCount;
+	List *columnValueRangeList;
+} ShardColumnStatistics;
+
+
 /*
  * Representation of a table's metadata that is frequently used for
  * distributed execution. Cached.
@@ -98,6 +137,32 @@ typedef struct
 	/* pg_dist_placement metadata */
 	GroupShardPlacement **arrayOfPlacementArrays;
 	int *arrayOfPlacementArrayLengths;
+
+	/*
+	 * Version of the metadata at which the shards were read, and the shard
+	 * modification counters of the placements, indexed like
+	 * sortedShardIntervalArray. Used for rebuilding the entry incrementally,
+	 * the array is NULL when the version does not track shard modifications.
+	 */
+	SharedPlacementCacheVersion shardListVersion;
+	uint64 *arrayOfPlacementModificationCounters;
+
+	/*
+	 * pg_dist_shard_column_stats metadata, loaded on first use. The array is
+	 * indexed like sortedShardIntervalArray, and is NULL when none of the
+	 * shards has statistics.
+	 */
+	bool shardColumnStatisticsLoaded;
+	MemoryContext shardColumnStatisticsContext;
+	ShardColumnStatistics **arrayOfShardColumnStatistics;
+
+	/*
+	 * pg_dist_async_reference_table metadata, loaded on first use. The group
+	 * of the placement that receives the modifications of the table, or
+	 * INVALID_GROUP_ID when they are written to all placements.
+	 */
+	bool asyncReplicationLoaded;
+	int32 asyncReplicationPrimaryGroupId;
 } CitusTableCacheEntry;
 
 typedef struct DistObjectCacheEntryKey
@@ -169,6 +234,10 @@ extern List * CitusTableList(void);
 extern ShardInterval * LoadShardInterval(uint64 shardId);
 extern bool ShardExists(uint64 shardId);
 extern Oid RelationIdForShard(uint64 shardId);
+extern int32 AsyncReplicationPrimaryGroupId(CitusTableCacheEntry *cacheEntry);
+extern ShardColumnStatistics ** GetShardColumnStatisticsArray(
+	CitusTableCacheEntry *cacheEntry);
+extern bool ShardHasColumnStatistics(uint64 shardId, Oid *relationId);
 extern bool ReferenceTableShardId(uint64 shardId);
 extern bool DistributedTableShardId(uint64 shardId);
 extern ShardPlacement * ShardPlacementOnGroupIncludingOrphanedPlacements(int32 groupId,
@@ -249,6 +318,9 @@ extern Oid DistLocalGroupIdRelationId(void);
 extern Oid DistObjectRelationId(void);
 extern Oid DistEnabledCustomAggregatesId(void);
 extern Oid DistTenantSchemaRelationId(void);
+extern Oid DistShardColumnStatsRelationId(void);
+extern Oid DistIngestionRelationId(void);
+extern Oid DistAsyncReferenceTableRelationId(void);
 
 /* index oids */
 extern Oid DistNodeNodeIdIndexId(void);
@@ -271,6 +343,9 @@ extern Oid DistTransactionGroupIndexId(void);
 extern Oid DistPlacementGroupidIndexId(void);
 extern Oid DistObjectPrimaryKeyIndexId(void);
 extern Oid DistCleanupPrimaryKeyIndexId(void);
+extern Oid DistShardColumnStatsPrimaryKeyIndexId(void);
+extern Oid DistIngestionPrimaryKeyIndexId(void);
+extern Oid DistAsyncReferenceTablePrimaryKeyIndexId(void);
 extern Oid DistTenantSchemaPrimaryKeyIndexId(void);
 extern Oid DistTenantSchemaUniqueColocationIdIndexId(void);
 
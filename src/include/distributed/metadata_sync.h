@@ -30,6 +30,8 @@ typedef enum
 extern int MetadataSyncInterval;
 extern int MetadataSyncRetryInterval;
 extern int MetadataSyncTransMode;
+extern int MetadataSyncBatchSize;
+extern int DistributedSequenceCacheSize;
 
 /*
  * MetadataSyncContext is used throughout metadata sync.
@@ -43,6 +45,9 @@ typedef struct MetadataSyncContext
 	bool collectCommands; /* if we collect commands instead of sending and resetting */
 	List *collectedCommands; /* collected commands. (NIL if collectCommands == false) */
 	bool nodesAddedInSameTransaction; /* if the nodes are added just before activation */
+	MemoryContext batchContext; /* memory context for the batched commands */
+	StringInfo batchedCommands; /* commands that are not yet sent to the nodes */
+	int batchedCommandListCount; /* number of command lists in batchedCommands */
 } MetadataSyncContext;
 
 typedef enum
@@ -431,6 +431,9 @@ extern void GetIntervalTypeInfo(char partitionMethod, Var *partitionColumn,
 								Oid *intervalTypeId, int32 *intervalTypeMod);
 extern List * SendShardStatisticsQueriesInParallel(List *citusTableIds,
 												   bool useDistributedTransaction);
+extern List * SendShardSizeQueriesToNodes(List *workerNodeList, List *citusTableIds,
+										  bool useDistributedTransaction,
+										  bool includeTableSize);
 extern bool GetNodeDiskSpaceStatsForConnection(MultiConnection *connection,
 											   uint64 *availableBytes,
 											   uint64 *totalBytes);
@@ -78,6 +78,8 @@ extern void CitusExecutorRun(QueryDesc *queryDesc, ScanDirection direction, uint
 							 bool execute_once);
 extern void AdaptiveExecutorPreExecutorRun(CitusScanState *scanState);
 extern TupleTableSlot * AdaptiveExecutor(CitusScanState *scanState);
+extern void ContinueAdaptiveExecutor(CitusScanState *scanState);
+extern void StopAdaptiveExecutor(CitusScanState *scanState);
 
 
 /*
@@ -115,6 +117,10 @@ typedef struct ExecutionParams
 	 * command such as a DDL command.*/
 	bool isUtilityCommand;
 
+	/* respectTaskDependencies is true if tasks wait for the tasks in their
+	 * dependentTaskList that are part of the execution.*/
+	bool respectTaskDependencies;
+
 	/* pass bind parameters to the distributed executor for parameterized plans */
 	ParamListInfo paramListInfo;
 } ExecutionParams;
@@ -138,6 +144,9 @@ extern TupleTableSlot * CitusExecScan(CustomScanState *node);
 extern TupleTableSlot * ReturnTupleFromTuplestore(CitusScanState *scanState);
 extern void ReadFileIntoTupleStore(char *fileName, char *copyFormat, TupleDesc
 								   tupleDescriptor, Tuplestorestate *tupstore);
+extern void ReadBufferIntoTupleStore(StringInfo copyData, char *copyFormat,
+									 TupleDesc tupleDescriptor,
+									 Tuplestorestate *tupstore);
 extern Query * ParseQueryString(const char *queryString, Oid *paramOids, int numParams);
 extern Query * RewriteRawQueryStmt(RawStmt *rawStmt, const char *queryString,
 								   Oid *paramOids, int numParams);
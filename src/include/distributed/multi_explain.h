@@ -23,8 +23,13 @@ typedef enum
 /* Config variables managed via guc.c to explain distributed query plans */
 extern bool ExplainDistributedQueries;
 extern bool ExplainAllTasks;
+extern bool ExplainTaskSummary;
 extern int ExplainAnalyzeSortMethod;
 
+/* Config variables managed via guc.c to log the plans of slow distributed queries */
+extern int LogDistributedPlanMinDuration;
+extern double LogDistributedPlanSampleRate;
+
 extern void FreeSavedExplainPlan(void);
 extern void CitusExplainOneQuery(Query *query, int cursorOptions, IntoClause *into,
 								 ExplainState *es, const char *queryString, ParamListInfo
@@ -35,5 +40,8 @@ extern List * ExplainAnalyzeTaskList(List *originalTaskList,
 									 tupleDesc, ParamListInfo params);
 extern bool RequestedForExplainAnalyze(CitusScanState *node);
 extern void ResetExplainAnalyzeData(List *taskList);
+extern bool ShouldLogDistributedPlan(void);
+extern void TraceTasksForDistributedPlanLog(List *taskList);
+extern void LogDistributedPlanIfSlow(CitusScanState *scanState, double durationMillisec);
 
 #endif /* MULTI_EXPLAIN_H */
@@ -56,6 +56,9 @@ typedef struct TableEntry
 {
 	Oid relationId;
 	uint32 rangeTableId;
+
+	/* estimated size of the table in bytes, only set for cost-based join ordering */
+	uint64 estimatedSize;
 } TableEntry;
 
 
@@ -80,12 +83,16 @@ typedef struct JoinOrderNode
 	char partitionMethod;
 	List *joinClauseList;       /* not relevant for the first table */
 	TableEntry *anchorTable;
+
+	/* estimated size of the tables joined up to this node, for cost-based ordering */
+	uint64 estimatedJoinedSize;
 } JoinOrderNode;
 
 
 /* Config variables managed via guc.c */
 extern bool LogMultiJoinOrder;
 extern bool EnableSingleHashRepartitioning;
+extern bool EnableCostBasedJoinOrder;
 
 
 /* Function declaration for determining table join orders */
@@ -109,6 +116,7 @@ extern Var * DistPartitionKey(Oid relationId);
 extern Var * DistPartitionKeyOrError(Oid relationId);
 extern char PartitionMethod(Oid relationId);
 extern char TableReplicationModel(Oid relationId);
+extern uint64 EstimatedTableSize(Oid relationId);
 extern bool JoinOnColumns(List *currentPartitionColumnList, Var *candidatePartitionColumn,
 						  List *joinClauseList);
 
@@ -41,6 +41,8 @@
 #define HLL_UNION_AGGREGATE_NAME "hll_union_agg"
 #define HLL_CARDINALITY_FUNC_NAME "hll_cardinality"
 #define HLL_FORCE_GROUPAGG_GUC_NAME "hll.force_groupagg"
+#define COUNT_DISTINCT_SKETCH_AGGREGATE_NAME "citus_count_distinct_sketch"
+#define COUNT_DISTINCT_MERGE_AGGREGATE_NAME "citus_count_distinct_merge"
 
 /* Definitions related to Top-N approximations */
 #define TOPN_ADD_AGGREGATE_NAME "topn_add_agg"
@@ -23,6 +23,8 @@
 
 /* Config variables managed via guc.c */
 extern int LogicalReplicationTimeout;
+extern bool LogicalReplicationSingleSlot;
+extern bool LogicalReplicationParallelApply;
 
 extern bool PlacementMovedUsingLogicalReplicationInTX;
 
@@ -140,6 +142,8 @@ extern void CreateReplicaIdentitiesOnNode(List *shardList,
 										  char *nodeName,
 										  int32 nodePort);
 extern XLogRecPtr GetRemoteLogPosition(MultiConnection *connection);
+extern XLogRecPtr GetRemoteLSN(MultiConnection *connection, char *command);
+extern char * escape_param_str(const char *str);
 extern List * GetQueryResultStringList(MultiConnection *connection, char *query);
 
 extern MultiConnection * GetReplicationConnection(char *nodeName, int nodePort);
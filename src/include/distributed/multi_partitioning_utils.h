@@ -22,6 +22,9 @@ extern bool IsParentTable(Oid relationId);
 extern Oid PartitionParentOid(Oid partitionOid);
 extern Oid PartitionWithLongestNameRelationId(Oid parentRelationId);
 extern List * PartitionList(Oid parentRelationId);
+extern List * PrunedPartitionList(Oid parentRelationId, Index rangeTableIndex,
+								  List *restrictionClauseList,
+								  bool *partitionsPruned);
 extern char * GenerateDetachPartitionCommand(Oid partitionTableId);
 extern List * GenerateDetachPartitionCommandRelationIdList(List *relationIds);
 extern char * GenerateAttachShardPartitionCommand(ShardInterval *shardInterval);
@@ -31,6 +31,7 @@
 #include "distributed/log_utils.h"
 #include "distributed/metadata_utility.h"
 #include "distributed/multi_logical_planner.h"
+#include "distributed/planning_times.h"
 #include "distributed/worker_manager.h"
 
 
@@ -124,6 +125,20 @@ typedef struct LocalPlannedStatement
 } LocalPlannedStatement;
 
 
+/*
+ * CachedShardQuery represents the query string of a shard that is deparsed
+ * with the parameters of the job query still in it, such that it can be
+ * reused by the executions of a prepared statement that prune to the shard.
+ */
+typedef struct CachedShardQuery
+{
+	CitusNode type;
+
+	uint64 shardId;
+	char *queryString;
+} CachedShardQuery;
+
+
 /*
  * Job represents a logical unit of work that contains one set of data transfers
  * in our physical plan. The physical planner maps each SQL query into one or
@@ -146,6 +161,9 @@ typedef struct Job
 	/* for local shard queries, we may save the local plan here */
 	List *localPlannedStatements;
 
+	/* for fast path queries with deferred pruning, we may save shard queries here */
+	List *cachedShardQueries;
+
 	/*
 	 * When we evaluate functions and parameters in jobQuery then we
 	 * should no longer send the list of parameters along with the
@@ -153,6 +171,14 @@ typedef struct Job
 	 */
 	bool parametersInJobQueryResolved;
 	uint32 colocationId; /* common colocation group ID of the relations */
+
+	/*
+	 * In generic plans, the distributed table whose tasks can be skipped once
+	 * the parameter values are known, and its restrictions that contain
+	 * parameters, with the table as range table entry 1.
+	 */
+	Oid parameterPruningRelationId;
+	List *parameterPruningClauseList;
 } Job;
 
 
@@ -322,6 +348,13 @@ typedef struct Task
 	 */
 	double fetchedExplainAnalyzeExecutionDuration;
 
+	/*
+	 * Timings of the remote execution of the task, which the adaptive executor
+	 * fills in for EXPLAIN ANALYZE VERBOSE when not NULL. The copies of the
+	 * task that are executed share the trace with the original task.
+	 */
+	struct TaskExecutionTrace *executionTrace;
+
 	/*
 	 * isLocalTableModification is true if the task is on modifying a local table.
 	 */
@@ -403,12 +436,47 @@ typedef struct DistributedPlan
 	/* local query that merges results from the workers */
 	Query *combineQuery;
 
+	/*
+	 * Whether the combine query relies on the task results being merged by
+	 * the ORDER BY of the worker query, rather than sorting all the rows.
+	 */
+	bool mergeSortedTaskResults;
+
+	/*
+	 * Whether the plan node above the scan reads all the task results before
+	 * it returns anything (i.e. a sort, or an aggregate that is not grouped
+	 * by a sort), such that the executor can hand the task results to the
+	 * combine query as the tasks finish and discard them afterwards.
+	 */
+	bool incrementalCombineSupported;
+
+	/*
+	 * When the GROUP BY or the window functions of the combine query are
+	 * evaluated on the workers, the query that evaluates them over the task
+	 * results that are repartitioned by the column at
+	 * repartitionedAggregateColumnIndex across the shards of
+	 * repartitionedAggregateRelationId. The query reads from the same range
+	 * table entry as the combine query originally did.
+	 */
+	Query *repartitionedAggregateQuery;
+	int repartitionedAggregateColumnIndex;
+	Oid repartitionedAggregateRelationId;
+
 	/* query identifier (copied from the top-level PlannedStmt) */
 	uint64 queryId;
 
 	/* which relations are accessed by this distributed plan */
 	List *relationIdList;
 
+	/*
+	 * Partitioned tables for which the restrictions of the query rule out
+	 * some of the partitions, and for each of them the list of partitions
+	 * that remain after pruning. Only the remaining partitions are locked
+	 * during execution.
+	 */
+	List *prunedRelationIdList;
+	List *remainingPartitionListList;
+
 	/* target relation of a modification */
 	Oid targetRelationId;
 
@@ -471,6 +539,13 @@ typedef struct DistributedPlan
 	 * of source rows to be repartitioned for colocation with the target.
 	 */
 	int sourceResultRepartitionColumnIndex;
+
+	/*
+	 * Time spent in each phase of distributed planning, in milliseconds,
+	 * indexed by DistributedPlanningPhase. Only recorded for the plan of
+	 * the top-level query.
+	 */
+	double planningPhaseTimes[PLANNING_PHASE_COUNT];
 } DistributedPlan;
 
 
@@ -487,6 +562,31 @@ typedef struct DistributedSubPlan
 	uint32 subPlanId;
 	PlannedStmt *plan;
 
+	/*
+	 * Hash distributed table whose distribution column the distributed query
+	 * restricts to the result of the subplan, or InvalidOid. Tasks on shards
+	 * that none of the result rows hash to are skipped.
+	 */
+	Oid taskPruningRelationId;
+
+	/*
+	 * Hash distributed table whose distribution column the distributed query
+	 * restricts to the given column of the result of the subplan, or
+	 * InvalidOid. Each node then only receives the rows of the result that
+	 * hash to the shards that its tasks access.
+	 */
+	Oid resultSlicingRelationId;
+	AttrNumber resultSlicingAttributeNumber;
+
+	/*
+	 * ID of the intermediate result if later subplans with the same query
+	 * may reuse the result within the transaction, or NULL. The ID is
+	 * derived from the query, and relationIdList holds the tables that the
+	 * query reads.
+	 */
+	char *reusableResultId;
+	List *relationIdList;
+
 	/* EXPLAIN ANALYZE instrumentations */
 	uint64 bytesSentPerWorker;
 	uint32 remoteWorkerCount;
@@ -541,6 +641,8 @@ typedef List *(*ReorderFunction)(List *);
 /* Config variable managed via guc.c */
 extern int TaskAssignmentPolicy;
 extern bool EnableUniqueJobIds;
+extern bool EnableRepartitionedAggregation;
+extern bool EnableRepartitionedWindowFunctions;
 
 
 /* Function declarations for building physical plans and constructing queries */
@@ -91,7 +91,8 @@ extern void GenerateSingleShardRouterTaskList(Job *job,
 											  List *relationShardList,
 											  List *placementList,
 											  uint64 shardId,
-											  bool isLocalTableModification);
+											  bool isLocalTableModification,
+											  char *shardQueryString);
 
 /*
  * FastPathPlanner is a subset of router planner, that's why we prefer to
@@ -0,0 +1,43 @@
+/*-------------------------------------------------------------------------
+ *
+ * node_latency_stats.h
+ *   Tracking of task execution and connection establishment times per
+ *   worker node across backends.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef NODE_LATENCY_STATS_H
+#define NODE_LATENCY_STATS_H
+
+/*
+ * NodeLatencies contains the recent average latencies of a node, in
+ * microseconds.
+ */
+typedef struct NodeLatencies
+{
+	double taskExecutionTime;
+	double connectionEstablishmentTime;
+} NodeLatencies;
+
+
+extern bool EnableNodeLatencyFeedback;
+extern bool AvoidDegradedNodes;
+extern int DegradedNodeThreshold;
+
+
+extern void InitializeNodeLatencyStats(void);
+extern size_t NodeLatencyStatsShmemSize(void);
+extern void NodeLatencyStatsShmemInit(void);
+extern void RecordNodeLatencies(const char *hostname, int port,
+								uint64 totalTaskExecutionTime, int taskCount,
+								uint64 totalConnectionEstablishmentTime,
+								int connectionCount);
+extern bool GetNodeLatencies(const char *hostname, int port, NodeLatencies *latencies);
+extern void RecordNodeProbe(const char *hostname, int port, bool probeSucceeded,
+							uint64 roundTripTime, double replicationLag);
+extern bool NodeIsDegraded(const char *hostname, int port);
+
+#endif /* NODE_LATENCY_STATS_H */
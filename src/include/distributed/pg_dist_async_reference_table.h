@@ -0,0 +1,41 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_dist_async_reference_table.h
+ *	  definition of the relation that holds the reference tables whose
+ *	  modifications are replicated asynchronously from a primary placement
+ *	  (pg_dist_async_reference_table).
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef PG_DIST_ASYNC_REFERENCE_TABLE_H
+#define PG_DIST_ASYNC_REFERENCE_TABLE_H
+
+/* ----------------
+ *		pg_dist_async_reference_table definition.
+ * ----------------
+ */
+typedef struct FormData_pg_dist_async_reference_table
+{
+	Oid logicalrelid;
+	int primarygroupid;
+} FormData_pg_dist_async_reference_table;
+
+/* ----------------
+ *      FormData_pg_dist_async_reference_table corresponds to a pointer to a
+ *      tuple with the format of pg_dist_async_reference_table relation.
+ * ----------------
+ */
+typedef FormData_pg_dist_async_reference_table *Form_pg_dist_async_reference_table;
+
+/* ----------------
+ *      compiler constants for pg_dist_async_reference_table
+ * ----------------
+ */
+#define Natts_pg_dist_async_reference_table 2
+#define Anum_pg_dist_async_reference_table_logicalrelid 1
+#define Anum_pg_dist_async_reference_table_primarygroupid 2
+
+#endif /* PG_DIST_ASYNC_REFERENCE_TABLE_H */
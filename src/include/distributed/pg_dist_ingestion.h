@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_dist_ingestion.h
+ *	  definition of the relation that holds the progress of resumable bulk
+ *	  loads into distributed tables (pg_dist_ingestion).
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef PG_DIST_INGESTION_H
+#define PG_DIST_INGESTION_H
+
+/* ----------------
+ *      compiler constants for pg_dist_ingestion
+ * ----------------
+ */
+
+#define Natts_pg_dist_ingestion 4
+#define Anum_pg_dist_ingestion_ingestion_id 1
+#define Anum_pg_dist_ingestion_logicalrelid 2
+#define Anum_pg_dist_ingestion_committed_rows 3
+#define Anum_pg_dist_ingestion_updated_at 4
+
+#endif /* PG_DIST_INGESTION_H */
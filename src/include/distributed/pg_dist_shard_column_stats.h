@@ -0,0 +1,32 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_dist_shard_column_stats.h
+ *	  definition of the relation that holds the statistics of the columns
+ *	  of shards that are used for shard pruning (pg_dist_shard_column_stats).
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef PG_DIST_SHARD_COLUMN_STATS_H
+#define PG_DIST_SHARD_COLUMN_STATS_H
+
+/* ----------------
+ *      compiler constants for pg_dist_shard_column_stats
+ * ----------------
+ */
+
+#define Natts_pg_dist_shard_column_stats 10
+#define Anum_pg_dist_shard_column_stats_logicalrelid 1
+#define Anum_pg_dist_shard_column_stats_shardid 2
+#define Anum_pg_dist_shard_column_stats_attnum 3
+#define Anum_pg_dist_shard_column_stats_atttypid 4
+#define Anum_pg_dist_shard_column_stats_attcollation 5
+#define Anum_pg_dist_shard_column_stats_row_count 6
+#define Anum_pg_dist_shard_column_stats_null_count 7
+#define Anum_pg_dist_shard_column_stats_min_value 8
+#define Anum_pg_dist_shard_column_stats_max_value 9
+#define Anum_pg_dist_shard_column_stats_collected_at 10
+
+#endif /* PG_DIST_SHARD_COLUMN_STATS_H */
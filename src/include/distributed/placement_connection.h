@@ -40,6 +40,7 @@ extern void ResetShardPlacementAssociation(struct MultiConnection *connection);
 extern void InitPlacementConnectionManagement(void);
 
 extern bool ConnectionModifiedPlacement(MultiConnection *connection);
+extern bool PlacementAccessedInTransaction(struct ShardPlacement *placement);
 extern bool UseConnectionPerPlacement(void);
 
 #endif /* PLACEMENT_CONNECTION_H */
@@ -0,0 +1,40 @@
+/*-------------------------------------------------------------------------
+ *
+ * planning_times.h
+ *	  Functions for measuring the time spent in each phase of distributed
+ *	  planning.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef PLANNING_TIMES_H
+#define PLANNING_TIMES_H
+
+/*
+ * DistributedPlanningPhase enumerates the phases of distributed planning
+ * whose durations we measure separately.
+ */
+typedef enum DistributedPlanningPhase
+{
+	PLANNING_PHASE_NONE = -1,
+	PLANNING_PHASE_PUSHDOWN_CHECK = 0,
+	PLANNING_PHASE_RECURSIVE_PLANNING,
+	PLANNING_PHASE_LOGICAL_OPTIMIZATION,
+	PLANNING_PHASE_PHYSICAL_PLANNING,
+	PLANNING_PHASE_DEPARSE,
+
+	/* number of phases, must be the last entry */
+	PLANNING_PHASE_COUNT
+} DistributedPlanningPhase;
+
+
+extern void ResetPlanningPhaseTimes(void);
+extern DistributedPlanningPhase BeginPlanningPhase(DistributedPlanningPhase phase);
+extern void EndPlanningPhase(DistributedPlanningPhase previousPhase);
+extern DistributedPlanningPhase CurrentPlanningPhase(void);
+extern void GetPlanningPhaseTimes(double *planningPhaseTimes);
+extern const char * PlanningPhaseName(DistributedPlanningPhase phase);
+
+#endif /* PLANNING_TIMES_H */
@@ -0,0 +1,65 @@
+/*-------------------------------------------------------------------------
+ *
+ * query_result_cache.h
+ *   Shared memory cache for the results of read-only queries on reference
+ *   tables.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef QUERY_RESULT_CACHE_H
+#define QUERY_RESULT_CACHE_H
+
+#include "postgres.h"
+
+#include "nodes/params.h"
+#include "nodes/pg_list.h"
+#include "utils/tuplestore.h"
+
+#include "distributed/multi_physical_planner.h"
+
+
+/* maximum number of reference tables that a cached query can read */
+#define QUERY_RESULT_CACHE_MAX_RELATIONS 8
+
+
+/*
+ * QueryResultCacheRequest describes the result of a task that can be looked
+ * up in or added to the cache. The modification counts of the tables are
+ * read before the task executes, such that the result is not considered
+ * valid if one of the tables is modified in the mean time.
+ */
+typedef struct QueryResultCacheRequest
+{
+	char *keyString;
+	int keyLength;
+	uint64 keyHash;
+
+	int relationCount;
+	int counterIndexes[QUERY_RESULT_CACHE_MAX_RELATIONS];
+	uint64 modificationCounts[QUERY_RESULT_CACHE_MAX_RELATIONS];
+} QueryResultCacheRequest;
+
+
+extern bool EnableQueryResultCache;
+extern int QueryResultCacheSize;
+
+
+extern void InitializeQueryResultCache(void);
+extern size_t QueryResultCacheShmemSize(void);
+extern void QueryResultCacheShmemInit(void);
+extern QueryResultCacheRequest * CreateQueryResultCacheRequest(Task *task,
+															   ParamListInfo
+															   paramListInfo);
+extern bool LookupQueryResultCache(QueryResultCacheRequest *request,
+								   Tuplestorestate *tupleStore, TupleDesc tupleDesc);
+extern void StoreQueryResultCache(QueryResultCacheRequest *request,
+								  Tuplestorestate *tupleStore, TupleDesc tupleDesc);
+extern void QueryResultCacheRecordTaskListModifications(List *taskList);
+extern void QueryResultCacheRecordRelationModification(Oid relationId);
+extern void QueryResultCacheTransactionCommitted(void);
+extern void ResetQueryResultCacheModifications(void);
+
+#endif /* QUERY_RESULT_CACHE_H */
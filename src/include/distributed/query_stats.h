@@ -10,6 +10,7 @@
 #ifndef QUERY_STATS_H
 #define QUERY_STATS_H
 
+#include "distributed/intermediate_results.h"
 #include "distributed/multi_server_executor.h"
 
 #define STATS_SHARED_MEM_NAME "citus_query_stats"
@@ -17,7 +18,10 @@
 extern Size CitusQueryStatsSharedMemSize(void);
 extern void InitializeCitusQueryStats(void);
 extern void CitusQueryStatsExecutorsEntry(uint64 queryId, MultiExecutorType executorType,
-										  char *partitionKey);
+										  char *partitionKey, double *planningPhaseTimes,
+										  double executionTime, double remoteWaitTime,
+										  IntermediateResultStats *
+										  intermediateResultStats);
 extern void CitusQueryStatsSynchronizeEntries(void);
 extern int StatStatementsPurgeInterval;
 extern int StatStatementsMax;
@@ -18,10 +18,14 @@
 
 #include "distributed/errormessage.h"
 #include "distributed/log_utils.h"
+#include "distributed/multi_physical_planner.h"
 #include "distributed/relation_restriction_equivalence.h"
 
 typedef struct RecursivePlanningContextInternal RecursivePlanningContext;
 
+/* Config variables managed via guc.c */
+extern int BroadcastJoinThreshold;
+
 typedef struct RangeTblEntryIndex
 {
 	RangeTblEntry *rangeTableEntry;
@@ -34,6 +38,7 @@ extern List * GenerateSubplansForSubqueriesAndCTEs(uint64 planId, Query *origina
 												   PlannerRestrictionContext *
 												   plannerRestrictionContext);
 extern char * GenerateResultId(uint64 planId, uint32 subPlanId);
+extern char * SubPlanResultId(uint64 planId, DistributedSubPlan *subPlan);
 extern Query * BuildSubPlanResultQuery(List *targetEntryList, List *columnAliasList,
 									   char *resultId);
 extern Query * BuildReadIntermediateResultsArrayQuery(List *targetEntryList,
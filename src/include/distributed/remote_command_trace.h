@@ -0,0 +1,64 @@
+/*-------------------------------------------------------------------------
+ *
+ * remote_command_trace.h
+ *   Sampled remote commands, recorded into a ring buffer in shared memory.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef REMOTE_COMMAND_TRACE_H
+#define REMOTE_COMMAND_TRACE_H
+
+#include "datatype/timestamp.h"
+
+#include "distributed/connection_management.h"
+
+
+/* longer commands are truncated in the traces */
+#define REMOTE_COMMAND_TRACE_COMMAND_LENGTH 256
+
+
+/*
+ * RemoteCommandTrace describes a command that was sent over a connection to
+ * a remote node. The duration is in milliseconds.
+ */
+typedef struct RemoteCommandTrace
+{
+	/* whether the fields below are filled in */
+	bool valid;
+
+	TimestampTz startTime;
+	int pid;
+	uint64 queryId;
+	char nodeName[MAX_NODE_LENGTH];
+	int nodePort;
+	uint64 connectionId;
+
+	/* from sending the command until its last result was read */
+	double duration;
+
+	/* bytes of the command and its parameters */
+	uint64 bytesSent;
+
+	/* bytes of the result rows, as far as the executor counts them */
+	uint64 bytesReceived;
+
+	/* empty for prepared statements that are executed by name */
+	char command[REMOTE_COMMAND_TRACE_COMMAND_LENGTH];
+} RemoteCommandTrace;
+
+
+extern double RemoteCommandTraceSampleRate;
+
+
+extern void InitializeRemoteCommandTraces(void);
+extern size_t RemoteCommandTraceShmemSize(void);
+extern void RemoteCommandTraceShmemInit(void);
+extern void StartRemoteCommandTrace(MultiConnection *connection, const char *command,
+									uint64 bytesSent);
+extern void FinishRemoteCommandTrace(MultiConnection *connection);
+extern void ReleaseRemoteCommandTrace(MultiConnection *connection);
+
+#endif /* REMOTE_COMMAND_TRACE_H */
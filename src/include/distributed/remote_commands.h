@@ -58,15 +58,29 @@ extern int SendRemoteCommandParams(MultiConnection *connection, const char *comm
 								   int parameterCount, const Oid *parameterTypes,
 								   const char *const *parameterValues,
 								   bool binaryResults);
+extern int SendRemoteCommandBinaryParams(MultiConnection *connection,
+										 const char *command, int parameterCount,
+										 const Oid *parameterTypes,
+										 const char *const *parameterValues,
+										 const int *parameterLengths);
+extern void CountRemoteCommand(MultiConnection *connection, const char *command,
+							   int parameterCount, const char *const *parameterValues,
+							   const int *parameterLengths);
 extern List * ReadFirstColumnAsText(PGresult *queryResult);
 extern PGresult * GetRemoteCommandResult(MultiConnection *connection,
 										 bool raiseInterrupts);
 extern bool PutRemoteCopyData(MultiConnection *connection, const char *buffer,
 							  int nbytes);
+extern bool QueueRemoteCopyData(MultiConnection *connection, const char *buffer,
+								int nbytes);
+extern bool RemoteCopyFlushThresholdReached(MultiConnection *connection);
+extern bool FlushRemoteCopyData(MultiConnection *connection, List *connectionList);
 extern bool PutRemoteCopyEnd(MultiConnection *connection, const char *errormsg);
 
 /* waiting for multiple command results */
 extern void WaitForAllConnections(List *connectionList, bool raiseInterrupts);
+extern void WaitForAllConnectionsWithTimeout(List *connectionList, bool raiseInterrupts,
+											 long timeoutMs);
 
 extern bool SendCancelationRequest(MultiConnection *connection);
 
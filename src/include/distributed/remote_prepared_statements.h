@@ -0,0 +1,27 @@
+/*-------------------------------------------------------------------------
+ *
+ * remote_prepared_statements.h
+ *	  Statements that are prepared on the connections to remote nodes.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef REMOTE_PREPARED_STATEMENTS_H
+#define REMOTE_PREPARED_STATEMENTS_H
+
+#include "distributed/connection_management.h"
+
+/* GUC, the number of statements that can be prepared on a connection */
+extern int MaxPreparedStatementsPerConnection;
+
+extern int SendRemoteCommandParamsPrepared(MultiConnection *connection,
+										   const char *command, int parameterCount,
+										   const Oid *parameterTypes,
+										   const char *const *parameterValues,
+										   bool binaryResults);
+extern void ReleaseRemotePreparedStatements(MultiConnection *connection);
+extern void InvalidateRemotePreparedStatements(void);
+
+#endif /* REMOTE_PREPARED_STATEMENTS_H */
@@ -135,6 +135,7 @@ extern void ResetRemoteTransaction(struct MultiConnection *connection);
 
 /* perform handling for all in-progress transactions */
 extern void CoordinatedRemoteTransactionsPrepare(void);
+extern int CountModifyingRemoteTransactions(void);
 extern void CoordinatedRemoteTransactionsCommit(void);
 extern void CoordinatedRemoteTransactionsAbort(void);
 extern void CheckRemoteTransactionsHealth(void);
@@ -153,5 +154,6 @@ extern char *SuperuserRole;
 extern char *MainDb;
 extern struct MultiConnection *MainDBConnection;
 extern bool IsMainDBCommandInXact;
+extern int CommitPreparedTimeout;
 
 #endif /* REMOTE_TRANSACTION_H */
@@ -14,6 +14,7 @@
 #define REPARTITION_EXECUTOR_H
 
 extern bool EnableRepartitionedInsertSelect;
+extern bool EnableRepartitionedInsertSelectPush;
 
 extern int DistributionColumnIndex(List *insertTargetList, Var *distributionColumn);
 extern List * GenerateTaskListWithColocatedIntermediateResults(Oid targetRelationId,
@@ -28,5 +29,7 @@ extern List * GenerateTaskListWithRedistributedResults(
 	bool useBinaryFormat);
 extern bool IsSupportedRedistributionTarget(Oid targetRelationId);
 extern bool IsRedistributablePlan(Plan *selectPlan);
+extern List * RepartitionedAggregateTaskList(DistributedPlan *distributedPlan,
+											 List *taskList);
 
 #endif /* REPARTITION_EXECUTOR_H */
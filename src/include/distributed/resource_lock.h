@@ -47,7 +47,9 @@ typedef enum AdvisoryLocktagClass
 	ADV_LOCKTAG_CLASS_CITUS_LOGICAL_REPLICATION = 12,
 	ADV_LOCKTAG_CLASS_CITUS_REBALANCE_PLACEMENT_COLOCATION = 13,
 	ADV_LOCKTAG_CLASS_CITUS_BACKGROUND_TASK = 14,
-	ADV_LOCKTAG_CLASS_CITUS_GLOBAL_DDL_SERIALIZATION = 15
+	ADV_LOCKTAG_CLASS_CITUS_GLOBAL_DDL_SERIALIZATION = 15,
+	ADV_LOCKTAG_CLASS_CITUS_SHARD_COLUMN_STATISTICS = 16,
+	ADV_LOCKTAG_CLASS_CITUS_INGESTION = 17
 } AdvisoryLocktagClass;
 
 /* CitusOperations has constants for citus operations */
@@ -144,6 +146,26 @@ typedef enum CitusOperations
 						 (uint32) (taskId), \
 						 ADV_LOCKTAG_CLASS_CITUS_BACKGROUND_TASK)
 
+/* reuse advisory lock, but with different, unused field 4 (16)
+ * Also it has the database hardcoded to MyDatabaseId, to ensure the locks
+ * are local to each database */
+#define SET_LOCKTAG_SHARD_COLUMN_STATISTICS(tag, shardid) \
+	SET_LOCKTAG_ADVISORY(tag, \
+						 MyDatabaseId, \
+						 (uint32) ((shardid) >> 32), \
+						 (uint32) (shardid), \
+						 ADV_LOCKTAG_CLASS_CITUS_SHARD_COLUMN_STATISTICS)
+
+/* reuse advisory lock, but with different, unused field 4 (17)
+ * Also it has the database hardcoded to MyDatabaseId, to ensure the locks
+ * are local to each database */
+#define SET_LOCKTAG_INGESTION(tag, ingestionIdHash) \
+	SET_LOCKTAG_ADVISORY(tag, \
+						 MyDatabaseId, \
+						 0, \
+						 (uint32) (ingestionIdHash), \
+						 ADV_LOCKTAG_CLASS_CITUS_INGESTION)
+
 /*
  * IsNodeWideObjectClass returns true if the given object class is node-wide,
  * i.e., that is not bound to a particular database but to whole server.
@@ -244,6 +266,8 @@ extern void LockReferencedReferenceShardDistributionMetadata(uint64 shardId,
 
 /* Lock shard data, for DML commands or remote fetches */
 extern void LockShardResource(uint64 shardId, LOCKMODE lockmode);
+extern void LockShardColumnStatistics(uint64 shardId, LOCKMODE lockmode);
+extern void LockIngestion(const char *ingestionId, LOCKMODE lockmode);
 
 /* Lock a co-location group */
 extern void LockColocationId(int colocationId, LOCKMODE lockMode);
@@ -0,0 +1,46 @@
+/*-------------------------------------------------------------------------
+ *
+ * result_compression.h
+ *	  Compression of intermediate results that are transferred between
+ *	  nodes.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef RESULT_COMPRESSION_H
+#define RESULT_COMPRESSION_H
+
+#include "postgres.h"
+
+#include "lib/stringinfo.h"
+
+
+/*
+ * Number of bytes of result data that we compress into a single frame. The
+ * frames are sent as separate COPY data messages.
+ */
+#define RESULT_COMPRESSION_FRAME_SIZE (64 * 1024)
+
+
+typedef enum ResultCompressionType
+{
+	RESULT_COMPRESSION_NONE,
+	RESULT_COMPRESSION_LZ4,
+	RESULT_COMPRESSION_ZSTD
+} ResultCompressionType;
+
+
+extern int IntermediateResultCompression;
+
+
+extern const char * ResultCompressionName(ResultCompressionType compressionType);
+extern ResultCompressionType ResultCompressionTypeFromName(const char *compressionName);
+extern void CompressResultFrame(ResultCompressionType compressionType,
+								const char *data, int length, StringInfo frame);
+extern void DecompressResultFrame(ResultCompressionType compressionType,
+								  const char *frame, int frameLength,
+								  StringInfo data);
+
+#endif /* RESULT_COMPRESSION_H */
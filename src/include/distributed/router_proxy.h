@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * router_proxy.h
+ *   Execution of read-only router queries through background workers that
+ *   share their worker connections across backends.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef ROUTER_PROXY_H
+#define ROUTER_PROXY_H
+
+#include "distributed/citus_custom_scan.h"
+#include "distributed/tuple_destination.h"
+
+
+/* upper bound of citus.router_proxy_workers */
+#define MAX_ROUTER_PROXY_WORKERS 64
+
+
+extern int RouterProxyWorkerCount;
+
+
+extern void InitializeRouterProxy(void);
+extern size_t RouterProxyShmemSize(void);
+extern void RouterProxyShmemInit(void);
+extern bool ShouldExecuteViaRouterProxy(CitusScanState *scanState, List *taskList,
+										ParamListInfo paramListInfo);
+extern bool ExecuteTaskViaRouterProxy(Task *task, TupleDestination *tupleDest,
+									  TupleDesc tupleDescriptor);
+extern void MaintainRouterProxyWorkers(Oid extensionOwner);
+extern void StopRouterProxyWorkers(void);
+extern PGDLLEXPORT void RouterProxyWorkerMain(Datum mainArg);
+
+#endif /* ROUTER_PROXY_H */
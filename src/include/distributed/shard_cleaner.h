@@ -22,6 +22,7 @@ extern bool CheckAvailableSpaceBeforeMove;
 
 extern int NextOperationId;
 extern int NextCleanupRecordId;
+extern int OrphanedShardDropBatchSize;
 
 extern int TryDropOrphanedResources(void);
 extern void DropOrphanedResourcesInSeparateTransaction(void);
@@ -0,0 +1,28 @@
+/*-------------------------------------------------------------------------
+ *
+ * shard_column_statistics.h
+ *	  Functions for collecting and invalidating the statistics of the
+ *	  columns of shards in pg_dist_shard_column_stats.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef SHARD_COLUMN_STATISTICS_H
+#define SHARD_COLUMN_STATISTICS_H
+
+#include "postgres.h"
+
+#include "nodes/pg_list.h"
+
+
+extern uint64 CollectShardColumnStatistics(Oid relationId, List *attributeNumberList,
+										   bool staleOnly);
+extern uint64 TryRefreshStaleShardColumnStatistics(Oid relationId);
+extern List * RelationIdsWithStaleShardColumnStatistics(void);
+extern void InvalidateShardColumnStatisticsForTaskList(List *taskList);
+extern void InvalidateShardColumnStatistics(uint64 shardId);
+extern void DeleteShardColumnStatistics(Oid relationId, uint64 shardId);
+
+#endif /* SHARD_COLUMN_STATISTICS_H */
@@ -11,16 +11,28 @@
 #ifndef SHARD_PRUNING_H_
 #define SHARD_PRUNING_H_
 
+#include "nodes/parsenodes.h"
 #include "nodes/primnodes.h"
 
 #include "distributed/metadata_cache.h"
 
 #define INVALID_SHARD_INDEX -1
 
+/* GUC, minimum array size for splitting array restrictions by shard */
+extern int ArrayRestrictionSplitThreshold;
+
+/* GUC, whether to prune shards using pg_dist_shard_column_stats */
+extern bool EnableShardColumnStatisticsPruning;
+
 /* Function declarations for shard pruning */
 extern List * PruneShards(Oid relationId, Index rangeTableId, List *whereClauseList,
 						  Const **partitionValueConst);
+extern List * PruneShardsByColumnStatistics(Oid relationId, Index rangeTableId,
+											 List *whereClauseList,
+											 List *shardIntervalList);
 extern bool ContainsFalseClause(List *whereClauseList);
+extern void SplitArrayRestrictionsByShard(Query *query, List *relationShardList);
+extern bool HasArrayRestrictionsToSplit(Query *query);
 extern List * get_all_actual_clauses(List *restrictinfo_list);
 extern Const * TransformPartitionRestrictionValue(Var *partitionColumn,
 												  Const *restrictionValue,
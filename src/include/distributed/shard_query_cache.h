@@ -0,0 +1,25 @@
+/*-------------------------------------------------------------------------
+ *
+ * shard_query_cache.h
+ *	  Functions for caching the shard queries of prepared fast path queries.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef SHARD_QUERY_CACHE_H
+#define SHARD_QUERY_CACHE_H
+
+#include "distributed/distributed_planner.h"
+#include "distributed/multi_physical_planner.h"
+
+/* GUC to enable caching the shard queries of prepared statements */
+extern bool EnableShardQueryCaching;
+
+extern bool IsShardQueryCachingSupported(Job *currentJob,
+										 DistributedPlan *originalDistributedPlan);
+extern char * GetOrCacheShardQueryString(DistributedPlan *originalDistributedPlan,
+										 uint64 shardId, List *relationShardList);
+
+#endif /* SHARD_QUERY_CACHE_H */
@@ -154,6 +154,14 @@ typedef struct NodeFillState
 	 */
 	float4 utilization;
 
+	/*
+	 * totalLoad is the query load of the ShardCosts on the node added
+	 * together and loadUtilization is totalLoad divided by capacity. Both are
+	 * only used when the rebalancer also balances the query load.
+	 */
+	float4 totalLoad;
+	float4 loadUtilization;
+
 	/*
 	 * shardCostListDesc contains all ShardCosts that are on the current node,
 	 * ordered from high cost to low cost.
@@ -172,6 +180,12 @@ typedef struct ShardCost
 	 * 2. number of queries per day
 	 */
 	float4 cost;
+
+	/*
+	 * load is the query load of the shard, which the rebalancer balances as a
+	 * second dimension next to the cost. It is 0 when the load is not used.
+	 */
+	float4 load;
 } ShardCost;
 
 typedef struct DisallowedPlacement
@@ -185,12 +199,16 @@ typedef struct RebalancePlanFunctions
 	bool (*shardAllowedOnNode)(uint64 shardId, WorkerNode *workerNode, void *context);
 	float4 (*nodeCapacity)(WorkerNode *workerNode, void *context);
 	ShardCost (*shardCost)(uint64 shardId, void *context);
+
+	/* optional, query load of a shard, NULL if only the cost is balanced */
+	float4 (*shardLoad)(uint64 shardId, void *context);
 	void *context;
 } RebalancePlanFunctions;
 
 extern char *VariablesToBePassedToNewConnections;
 extern int MaxRebalancerLoggedIgnoredMoves;
 extern int RebalancerByDiskSizeBaseCost;
+extern bool RebalancerBalanceQueryLoad;
 extern bool RunningUnderCitusTestSuite;
 extern bool PropagateSessionSettingsForLoopbackConnection;
 extern int MaxBackgroundTaskExecutorsPerNode;
@@ -214,6 +232,7 @@ extern List * RebalancePlacementUpdates(List *workerNodeList,
 extern List * ReplicationPlacementUpdates(List *workerNodeList, List *shardPlacementList,
 										  int shardReplicationFactor);
 extern void ExecuteRebalancerCommandInSeparateTransaction(char *command);
+extern void AcquireRebalanceColocationLock(Oid relationId, const char *operationName);
 extern void AcquirePlacementColocationLock(Oid relationId, int lockMode,
 										   const char *operationName);
 
@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * shard_size_cache.h
+ *   Shared memory cache for the sizes of shard placements, which the
+ *   maintenance daemon collects in the background such that the citus size
+ *   functions do not need to query all nodes.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef SHARD_SIZE_CACHE_H
+#define SHARD_SIZE_CACHE_H
+
+#include "postgres.h"
+
+#include "nodes/pg_list.h"
+
+#include "distributed/metadata_utility.h"
+
+
+extern int ShardSizeCacheSize;
+extern int ShardSizeCacheMaxAge;
+
+
+extern void InitializeShardSizeCache(void);
+extern size_t ShardSizeCacheShmemSize(void);
+extern void ShardSizeCacheShmemInit(void);
+extern bool ShardSizeCacheEnabled(void);
+extern uint64 RefreshShardSizeCache(Oid relationId);
+extern bool GetCachedShardSize(ShardInterval *shardInterval, int32 groupId,
+							   SizeQueryType sizeQueryType, uint64 *shardSize);
+extern bool GetCachedShardListSize(List *shardIntervalList, int32 groupId,
+								   SizeQueryType sizeQueryType, uint64 *size);
+
+#endif /* SHARD_SIZE_CACHE_H */
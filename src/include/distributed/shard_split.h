@@ -12,8 +12,17 @@
 #ifndef SHARDSPLIT_H_
 #define SHARDSPLIT_H_
 
+#include "storage/block.h"
+
 #include "distributed/utils/distribution_column_map.h"
 
+/*
+ * End of the block range of the last split copy stream of a shard, which is
+ * past the last possible block so it includes pages that were added after the
+ * number of blocks was read.
+ */
+#define SPLIT_COPY_BLOCK_RANGE_END ((int64) MaxBlockNumber + 1)
+
 /* Split Modes supported by Shard Split API */
 typedef enum SplitMode
 {
@@ -51,4 +60,9 @@ extern SplitMode LookupSplitMode(Oid shardTransferModeOid);
 
 extern void ErrorIfMultipleNonblockingMoveSplitInTheSameTransaction(void);
 
+extern int64 ScheduleHotTenantIsolation(void);
+
+extern int ShardSplitCopyStreams;
+extern double TenantIsolationThreshold;
+
 #endif /* SHARDSPLIT_H_ */
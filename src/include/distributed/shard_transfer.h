@@ -23,15 +23,21 @@ typedef enum
 	SHARD_TRANSFER_COPY = 2
 } ShardTransferType;
 
+extern int ShardTransferParallelism;
+
+
 extern void TransferShards(int64 shardId,
 						   char *sourceNodeName, int32 sourceNodePort,
 						   char *targetNodeName, int32 targetNodePort,
 						   char shardReplicationMode, ShardTransferType transferType);
+extern void MoveShardGroupsToNode(List *anchorShardList, WorkerNode *sourceNode,
+								  WorkerNode *targetNode, char shardReplicationMode);
 extern uint64 ShardListSizeInBytes(List *colocatedShardList,
 								   char *workerNodeName, uint32 workerNodePort);
 extern void ErrorIfMoveUnsupportedTableType(Oid relationId);
 extern void CopyShardsToNode(WorkerNode *sourceNode, WorkerNode *targetNode,
 							 List *shardIntervalList, char *snapshotName);
+extern int ShardTransferPoolSize(void);
 extern void VerifyTablesHaveReplicaIdentity(List *colocatedTableList);
 extern bool RelationCanPublishAllModifications(Oid relationId);
 extern void UpdatePlacementUpdateStatusForShardIntervalList(List *shardIntervalList,
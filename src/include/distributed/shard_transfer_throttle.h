@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------
+ *
+ * shard_transfer_throttle.h
+ *   Rate limiting of the data that shard transfers send from a node.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef SHARD_TRANSFER_THROTTLE_H
+#define SHARD_TRANSFER_THROTTLE_H
+
+#include "postgres.h"
+
+
+extern int ShardTransferMaxRate;
+
+
+extern void InitializeShardTransferThrottle(void);
+extern size_t ShardTransferThrottleShmemSize(void);
+extern void ShardTransferThrottleShmemInit(void);
+extern void SetSharedShardTransferMaxRate(int maxRate);
+extern void ThrottleShardTransfer(uint64 bytes);
+
+#endif /* SHARD_TRANSFER_THROTTLE_H */
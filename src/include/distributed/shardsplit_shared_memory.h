@@ -1,10 +1,10 @@
 /*-------------------------------------------------------------------------
  *
  * shardsplit_shared_memory.h
- *    API's for creating and accessing shared memory segments to store
- *    shard split information. 'worker_split_shard_replication_setup' UDF creates the
- *    shared memory and populates the contents. WAL sender processes are consumer
- *    of split information for appropriate tuple routing.
+ *    API's for storing and accessing shard split information in a dynamic
+ *    shared memory area. 'worker_split_shard_replication_setup' UDF populates
+ *    the contents. WAL sender processes are consumer of split information for
+ *    appropriate tuple routing.
  *
  * Copyright (c) Citus Data, Inc.
  *
@@ -16,6 +16,13 @@
 
 #include "postgres.h"
 
+#include "fmgr.h"
+
+#include "lib/dshash.h"
+#include "nodes/pg_list.h"
+#include "storage/lwlock.h"
+#include "utils/dsa.h"
+
 /*
  * In-memory mapping of a split child shard.
  */
@@ -35,26 +42,60 @@ typedef struct ShardSplitInfo
 
 
 /*
- * Header of the shared memory segment where shard split information is stored.
+ * Key of the shard split information in shared memory. The changes of a source
+ * shard are routed by each replication slot to its own child shards.
  */
-typedef struct ShardSplitInfoSMHeader
+typedef struct ShardSplitInfoKey
 {
-	int count;          /* number of elements in the shared memory */
-	ShardSplitInfo splitInfoArray[FLEXIBLE_ARRAY_MEMBER];
-} ShardSplitInfoSMHeader;
+	Oid sourceShardOid;
+	char slotName[NAMEDATALEN];
+} ShardSplitInfoKey;
 
 /*
- * Shard split information is populated and stored in shared memory in the form of one dimensional
- * array by 'worker_split_shard_replication_setup'. Information belonging to same replication
- * slot is grouped together and stored contiguously within this array.
- * 'SourceToDestinationShardMap' maps list of child(destination) shards that should be processed by a replication
- * slot corresponding to a parent(source) shard. When a parent shard receives a change, the decoder can use this map
- * to traverse only the list of child shards corresponding the given parent.
+ * Child shards of a source shard that a replication slot routes changes to,
+ * sorted by their hash range. They are allocated in the dynamic shared memory
+ * area for shard splits, and linked into a list of all of them for release.
+ */
+typedef struct ShardSplitChildShards
+{
+	ShardSplitInfoKey key;
+	dsa_pointer next;
+	int childShardCount;
+	ShardSplitInfo childShardArray[FLEXIBLE_ARRAY_MEMBER];
+} ShardSplitChildShards;
+
+/*
+ * Entry of the shared hash table that maps a source shard and a replication
+ * slot to its ShardSplitChildShards.
+ */
+typedef struct ShardSplitInfoHashEntry
+{
+	ShardSplitInfoKey key;
+	dsa_pointer childShards;
+} ShardSplitInfoHashEntry;
+
+/*
+ * Shard split information is stored in shared memory by 'worker_split_shard_replication_setup'
+ * in a hash table keyed by source shard and replication slot. The decoder of a replication
+ * slot copies the child shards of a source shard into 'SourceToDestinationShardMap' when it
+ * receives the first change of the source shard, such that later changes are routed without
+ * accessing shared memory.
+ *
+ * The child shards are kept in an array sorted by their hash range, such that
+ * the decoder can find the child shard of a hash value with a binary search. The
+ * hash function of the partition column is looked up by the decoder when it
+ * receives the first change of the source shard. Relations that the replication
+ * slot does not split have an entry without child shards.
  */
 typedef struct SourceToDestinationShardMapEntry
 {
 	Oid sourceShardKey;
-	List *shardSplitInfoList;
+
+	int childShardCount;
+	ShardSplitInfo *sortedChildShardArray;
+
+	FmgrInfo *hashFunction;
+	Oid hashFunctionCollation;
 } SourceToDestinationShardMapEntry;
 
 typedef struct ShardSplitShmemData
@@ -63,22 +104,20 @@ typedef struct ShardSplitShmemData
 	NamedLWLockTranche namedLockTranche;
 	LWLock lock;
 
-	dsm_handle dsmHandle;
+	/* dynamic shared memory area and hash table, created on first use */
+	dsa_handle dsaHandle;
+	dshash_table_handle hashHandle;
+
+	/* list of all ShardSplitChildShards in the area */
+	dsa_pointer childShardsList;
 } ShardSplitShmemData;
 
 /* Functions for creating and accessing shared memory used for dsm handle managment */
 void InitializeShardSplitSMHandleManagement(void);
 
-void StoreShardSplitSharedMemoryHandle(dsm_handle dsmHandle);
-
-/* Functions for creating and accessing shared memory segments consisting shard split information */
-extern ShardSplitInfoSMHeader * CreateSharedMemoryForShardSplitInfo(int
-																	shardSplitInfoCount,
-																	dsm_handle *dsmHandle);
+/* Functions for storing and accessing shard split information in shared memory */
+extern void StoreShardSplitInfoList(List *shardSplitInfoList);
 extern void ReleaseSharedMemoryOfShardSplitInfo(void);
-
-extern ShardSplitInfoSMHeader *  GetShardSplitInfoSMHeader(void);
-
-extern HTAB * PopulateSourceToDestinationShardMapForSlot(char *slotName, MemoryContext
-														 cxt);
+extern ShardSplitInfo * GetShardSplitChildShards(Oid sourceShardOid, char *slotName,
+												 int *childShardCount);
 #endif /* SHARDSPLIT_SHARED_MEMORY_H */
@@ -17,9 +17,23 @@
 #define ALLOW_ALL_EXTERNAL_CONNECTIONS -1
 
 
+/*
+ * ExecutionPriority is the priority of the executions of a session when
+ * they compete for the connections of the shared pool.
+ */
+typedef enum ExecutionPriority
+{
+	EXECUTION_PRIORITY_LOW,
+	EXECUTION_PRIORITY_NORMAL,
+	EXECUTION_PRIORITY_HIGH
+} ExecutionPriority;
+
+
 extern int MaxSharedPoolSize;
 extern int LocalSharedPoolSize;
 extern int MaxClientConnections;
+extern int ExecutionPriority;
+extern int SharedPoolPriorityReserve;
 
 
 extern void InitializeSharedConnectionStats(void);
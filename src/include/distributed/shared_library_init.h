@@ -21,6 +21,11 @@ extern PGDLLEXPORT ColumnarSupportsIndexAM_type extern_ColumnarSupportsIndexAM;
 extern PGDLLEXPORT CompressionTypeStr_type extern_CompressionTypeStr;
 extern PGDLLEXPORT IsColumnarTableAmTable_type extern_IsColumnarTableAmTable;
 extern PGDLLEXPORT ReadColumnarOptions_type extern_ReadColumnarOptions;
+extern PGDLLEXPORT ColumnarTableRelationIdList_type extern_ColumnarTableRelationIdList;
+extern PGDLLEXPORT ColumnarCompactSmallStripes_type extern_ColumnarCompactSmallStripes;
+extern PGDLLEXPORT ColumnarStripeTransferSupported_type
+	extern_ColumnarStripeTransferSupported;
+extern PGDLLEXPORT ColumnarExportStripes_type extern_ColumnarExportStripes;
 
 extern void StartupCitusBackend(void);
 extern const char * GetClientMinMessageLevelNameForValue(int minMessageLevel);
@@ -0,0 +1,71 @@
+/*-------------------------------------------------------------------------
+ *
+ * shared_placement_cache.h
+ *   Shared memory cache for the shard placements of distributed tables,
+ *   such that backends do not all need to scan pg_dist_placement when
+ *   building their metadata cache.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef SHARED_PLACEMENT_CACHE_H
+#define SHARED_PLACEMENT_CACHE_H
+
+#include "postgres.h"
+
+#include "nodes/pg_list.h"
+
+
+/*
+ * SharedPlacementCacheVersion holds the invalidation counters of a table as
+ * they were before a backend started reading its placements. Cached
+ * placements are only used if they were read at the same version.
+ *
+ * When tracking shard modifications, the version also holds the counters
+ * that committed transactions increment when they modify the shards of the
+ * table, or a single shard, which allows a backend to rebuild its metadata
+ * cache entry by only reading the shards that changed.
+ */
+typedef struct SharedPlacementCacheVersion
+{
+	bool usable;
+	Oid relationId;
+	uint64 generation;
+	uint64 relationCounter;
+
+	bool tracksShardModifications;
+	uint64 shardListCounter;
+	uint64 preparedCommitCounter;
+
+	/* copy of the shard modification counters, only during the build */
+	uint64 *shardCounters;
+} SharedPlacementCacheVersion;
+
+
+extern int SharedPlacementCacheSize;
+
+
+extern void InitializeSharedPlacementCache(void);
+extern size_t SharedPlacementCacheShmemSize(void);
+extern void SharedPlacementCacheShmemInit(void);
+extern void BeginSharedPlacementCacheRead(Oid relationId, bool trackShardModifications,
+										  SharedPlacementCacheVersion *version);
+extern List * SharedCachedShardPlacementList(int64 shardId,
+											 SharedPlacementCacheVersion *version);
+extern bool ShardListVersionUnchanged(SharedPlacementCacheVersion *previousVersion,
+									  SharedPlacementCacheVersion *version);
+extern uint64 ShardModificationCounter(SharedPlacementCacheVersion *version,
+									   int64 shardId);
+extern void InvalidateSharedPlacementCache(void);
+extern void InvalidateSharedPlacementCacheForRelation(Oid relationId);
+extern void SharedPlacementCacheRecordModification(void);
+extern void SharedPlacementCacheRecordShardListModification(Oid relationId);
+extern void SharedPlacementCacheRecordShardModification(int64 shardId);
+extern void SharedPlacementCacheTransactionCommitted(void);
+extern void ResetSharedPlacementCacheModifications(void);
+extern void BeginPreparedTransactionCommit(void);
+extern void EndPreparedTransactionCommit(void);
+
+#endif /* SHARED_PLACEMENT_CACHE_H */
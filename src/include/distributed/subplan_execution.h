@@ -12,12 +12,21 @@
 #define SUBPLAN_EXECUTION_H
 
 
+#include "utils/tuplestore.h"
+
 #include "distributed/multi_physical_planner.h"
 
 extern int MaxIntermediateResult;
 extern int SubPlanLevel;
+extern bool EnableParallelSubPlanExecution;
+extern bool EnableSubPlanResultReuse;
 
 extern void ExecuteSubPlans(DistributedPlan *distributedPlan);
+extern List * ExecuteSubPlansAndPruneTasks(DistributedPlan *distributedPlan);
+extern Tuplestorestate * TakePrefetchedSubPlanResult(uint64 planId);
+extern void InvalidateReusableSubPlanResults(Oid relationId);
+extern void InvalidateReusableSubPlanResultsForTaskList(List *taskList);
+extern void ResetReusableSubPlanResults(void);
 
 /**
  * IntermediateResultsHashEntry is used to store which nodes need to receive
@@ -32,12 +41,16 @@ extern void ExecuteSubPlans(DistributedPlan *distributedPlan);
  * writeLocalFile indicates if the intermediate result is accessed during local
  * execution. Note that there can possibly be an item for the local node in the
  * NodeIdList.
+ *
+ * remoteAccessCount is the number of references to the intermediate result in
+ * queries that may run on other nodes.
  */
 typedef struct IntermediateResultsHashEntry
 {
 	char key[NAMEDATALEN];
 	List *nodeIdList;
 	bool writeLocalFile;
+	int remoteAccessCount;
 } IntermediateResultsHashEntry;
 
 #endif /* SUBPLAN_EXECUTION_H */
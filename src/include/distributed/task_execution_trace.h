@@ -0,0 +1,62 @@
+/*-------------------------------------------------------------------------
+ *
+ * task_execution_trace.h
+ *   Per task timings of remote executions, shown by EXPLAIN ANALYZE VERBOSE
+ *   and sampled into a ring buffer in shared memory.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef TASK_EXECUTION_TRACE_H
+#define TASK_EXECUTION_TRACE_H
+
+#include "datatype/timestamp.h"
+
+#include "distributed/worker_manager.h"
+
+
+/*
+ * TaskExecutionTrace breaks down where the time of a task execution on a
+ * remote placement went. All durations are in milliseconds.
+ */
+typedef struct TaskExecutionTrace
+{
+	/* whether the fields below are filled in */
+	bool valid;
+
+	TimestampTz startTime;
+	uint64 queryId;
+	int taskId;
+	uint64 anchorShardId;
+	char nodeName[MAX_NODE_LENGTH];
+	int nodePort;
+
+	/* from the task being ready until a connection was available to send it */
+	double connectionAcquireTime;
+
+	/* sending the query to the node */
+	double sendTime;
+
+	/* from starting to send the query until the first result arrived */
+	double firstByteTime;
+
+	/* from the first result until the task finished */
+	double receiveTime;
+
+	uint64 bytesReceived;
+	uint64 rowsReceived;
+} TaskExecutionTrace;
+
+
+extern double TaskExecutionTraceSampleRate;
+
+
+extern void InitializeTaskExecutionTraces(void);
+extern size_t TaskExecutionTraceShmemSize(void);
+extern void TaskExecutionTraceShmemInit(void);
+extern bool ShouldSampleTaskExecutionTraces(void);
+extern void RecordTaskExecutionTrace(TaskExecutionTrace *trace);
+
+#endif /* TASK_EXECUTION_TRACE_H */
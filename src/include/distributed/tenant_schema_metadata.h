@@ -19,6 +19,7 @@ extern Oid ColocationIdGetTenantSchemaId(uint32 colocationId);
 extern uint32 SchemaIdGetTenantColocationId(Oid schemaId);
 extern bool IsTenantSchema(Oid schemaId);
 extern bool IsTenantSchemaColocationGroup(uint32 colocationId);
+extern void InvalidateTenantSchemaCache(void);
 
 /*
  * Local only modifiers.
@@ -132,6 +132,9 @@ extern bool AllModificationsCommutative;
 /* we've deprecated this flag, keeping here for some time not to break existing users */
 extern bool EnableDeadlockPrevention;
 
+/* GUC, whether to commit in one phase when only a single node wrote */
+extern bool EnableOnePhaseCommit;
+
 /* number of nested stored procedure call levels we are currently in */
 extern int StoredProcedureLevel;
 
@@ -11,6 +11,8 @@
 #ifndef TRANSACTION_RECOVERY_H
 #define TRANSACTION_RECOVERY_H
 
+#include "postmaster/bgworker.h"
+
 
 /* GUC to configure interval for 2PC auto-recovery */
 extern int Recover2PCInterval;
@@ -19,7 +21,13 @@ extern int Recover2PCInterval;
 /* Functions declarations for worker transactions */
 extern void LogTransactionRecord(int32 groupId, char *transactionName,
 								 FullTransactionId outerXid);
+extern void LogTransactionRecordList(List *groupIdList, List *transactionNameList,
+									 FullTransactionId outerXid);
 extern int RecoverTwoPhaseCommits(void);
 extern void DeleteWorkerTransactions(WorkerNode *workerNode);
+extern BackgroundWorkerHandle * SpawnTransactionRecoveryWorker(Oid databaseId,
+															   Oid extensionOwner);
+
+extern PGDLLEXPORT void TransactionRecoveryWorkerMain(Datum main_arg);
 
 #endif /* TRANSACTION_RECOVERY_H */
@@ -17,10 +17,18 @@
 #include "nodes/parsenodes.h"
 #include "storage/fd.h"
 
+#include "distributed/result_compression.h"
+
 
 /* Function declarations for transmitting files between two nodes */
-extern void RedirectCopyDataToRegularFile(const char *filename);
-extern void SendRegularFile(const char *filename);
+extern void RedirectCopyDataToRegularFile(const char *filename,
+										  ResultCompressionType compressionType);
+extern StringInfo RedirectCopyDataToBufferOrFile(const char *filename,
+												 ResultCompressionType compressionType,
+												 int64 memoryLimit);
+extern void SendRegularFile(const char *filename,
+							ResultCompressionType compressionType);
+extern void SendRegularBuffer(StringInfo data, ResultCompressionType compressionType);
 extern File FileOpenForTransmit(const char *filename, int fileFlags);
 extern File FileOpenForTransmitPerm(const char *filename, int fileFlags, int fileMode);
 
@@ -26,10 +26,14 @@ typedef struct TupleDestination TupleDestination;
  * totalIntermediateResultSize is a counter to keep the size
  * of the intermediate results of complex subqueries and CTEs
  * so that we can put a limit on the size.
+ *
+ * totalTupleStoreSize is the size of the tuples put into tuple stores,
+ * which we use to account for the memory of executions.
  */
 typedef struct TupleDestinationStats
 {
 	uint64 totalIntermediateResultSize;
+	uint64 totalTupleStoreSize;
 } TupleDestinationStats;
 
 
@@ -50,6 +54,15 @@ struct TupleDestination
 					 int placementIndex, int queryNumber,
 					 HeapTuple tuple, uint64 tupleLibpqSize);
 
+	/*
+	 * putSlot optionally implements putTuple for tuples that are still in a
+	 * slot, such that destinations that copy the tuple anyway can skip
+	 * forming an intermediate heap tuple. Can be NULL.
+	 */
+	void (*putSlot)(TupleDestination *self, Task *task,
+					int placementIndex, int queryNumber,
+					TupleTableSlot *slot);
+
 	/* tupleDescForQuery returns tuple descriptor for a query number. Can return NULL. */
 	TupleDesc (*tupleDescForQuery)(TupleDestination *self, int queryNumber);
 
@@ -60,8 +73,13 @@ struct TupleDestination
 	TupleDestinationStats *tupleDestinationStats;
 };
 
+extern bool EnableLocalExecutionSlotTuples;
+
 extern TupleDestination * CreateTupleStoreTupleDest(Tuplestorestate *tupleStore, TupleDesc
 													tupleDescriptor);
+extern TupleDestination * CreateTaskTupleStoresTupleDest(List *taskList,
+														 List *tupleStoreList,
+														 TupleDesc tupleDescriptor);
 extern TupleDestination * CreateTupleDestNone(void);
 extern DestReceiver * CreateTupleDestDestReceiver(TupleDestination *tupleDest,
 												  Task *task, int placementIndex);
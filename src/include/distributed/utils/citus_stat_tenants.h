@@ -59,6 +59,21 @@ typedef struct TenantStats
 	double cpuUsageInLastPeriod;
 	double cpuUsageInThisPeriod;
 
+	/*
+	 * Buffers found in and read into shared and local buffers by the queries
+	 * of this tenant in this and last periods.
+	 */
+	int64 bufferHitsInLastPeriod;
+	int64 bufferHitsInThisPeriod;
+	int64 bufferReadsInLastPeriod;
+	int64 bufferReadsInThisPeriod;
+
+	/*
+	 * Number of rows returned by the queries of this tenant in this and last periods.
+	 */
+	int64 rowsReturnedInLastPeriod;
+	int64 rowsReturnedInThisPeriod;
+
 	/*
 	 * The latest time this tenant ran a query. This value is used to update the score later.
 	 */
@@ -123,5 +138,6 @@ extern int StatTenantsPeriod;
 extern int StatTenantsLimit;
 extern int StatTenantsTrack;
 extern double StatTenantsSampleRateForNewTenants;
+extern int StatTenantsFlushInterval;
 
 #endif /*CITUS_ATTRIBUTE_H */
@@ -34,6 +34,7 @@
 #define WORKER_DEFAULT_CLUSTER "default"
 
 #define COORDINATOR_GROUP_ID 0
+#define INVALID_GROUP_ID -1
 
 /*
  * In memory representation of pg_dist_node table elements. The elements are hold in
@@ -15,10 +15,17 @@
 /* GUC, determining whether Binary Copy is enabled */
 extern bool EnableBinaryProtocol;
 
+/* GUC, determining whether the stripes of columnar shards are copied as they are */
+extern bool EnableColumnarStripeTransfer;
+
 extern DestReceiver * CreateShardCopyDestReceiver(EState *executorState,
 												  List *destinationShardFullyQualifiedName,
 												  uint32_t destinationNodeId);
 
+extern bool CopyColumnarStripesToNode(Oid relationId,
+									  List *destinationShardFullyQualifiedName,
+									  uint32_t destinationNodeId);
+
 extern const char * CopyableColumnNamesFromRelationName(const char *schemaName, const
 														char *relationName);
 
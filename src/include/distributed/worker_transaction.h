@@ -59,6 +59,11 @@ typedef enum TargetWorkerSet
 } TargetWorkerSet;
 
 
+/* config variables */
+extern bool EnableDDLCommandBatching;
+extern bool BufferDDLPropagation;
+
+
 /* Functions declarations for worker transactions */
 extern List * GetWorkerTransactions(void);
 extern List * TargetWorkerSetNodeList(TargetWorkerSet targetWorkerSet, LOCKMODE lockMode);
@@ -94,12 +99,19 @@ extern void SendCommandToRemoteNodesWithMetadata(const char *command);
 extern void SendCommandToRemoteNodesWithMetadataViaSuperUser(const char *command);
 extern void SendCommandListToRemoteNodesWithMetadata(List *commands);
 extern void SendBareCommandListToRemoteMetadataNodes(List *commandList);
+extern bool ShouldBufferDDLPropagation(void);
+extern void BufferCommandListForRemoteNodesWithMetadata(List *commandList);
+extern void FlushBufferedDDLPropagation(void);
+extern void ResetBufferedDDLPropagation(void);
 extern void SendBareCommandListToMetadataWorkers(List *commandList);
 extern void EnsureNoModificationsHaveBeenDone(void);
 extern void SendCommandListToWorkerOutsideTransaction(const char *nodeName,
 													  int32 nodePort,
 													  const char *nodeUser,
 													  List *commandList);
+extern void SendCommandListToWorkerListOutsideTransaction(List *workerNodeList,
+														  const char *nodeUser,
+														  List *commandList);
 extern void SendCommandListToWorkerOutsideTransactionWithConnection(
 	MultiConnection *workerConnection,
 	List *commandList);
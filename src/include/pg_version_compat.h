@@ -43,6 +43,9 @@ get_guc_variables_compat(int *gucCount)
 
 #define get_relids_in_jointree_compat(a, b, c) get_relids_in_jointree(a, b, c)
 
+#define ExecInsertIndexTuples_compat(a, b, c, d, e, f, g, h) \
+	ExecInsertIndexTuples(a, b, c, d, e, f, g, h)
+
 #define object_ownercheck(a, b, c) object_ownercheck(a, b, c)
 #define object_aclcheck(a, b, c, d) object_aclcheck(a, b, c, d)
 
@@ -92,6 +95,9 @@ get_guc_variables_compat(int *gucCount)
 
 #define get_relids_in_jointree_compat(a, b, c) get_relids_in_jointree(a, b)
 
+#define ExecInsertIndexTuples_compat(a, b, c, d, e, f, g, h) \
+	ExecInsertIndexTuples(a, b, c, d, e, f, g)
+
 static inline bool
 object_ownercheck(Oid classid, Oid objectid, Oid roleid)
 {
@@ -187,6 +193,8 @@ typedef RangeTblEntry RTEPermissionInfo;
 
 #if PG_VERSION_NUM >= PG_VERSION_15
 #define ProcessCompletedNotifies()
+#define shm_mq_send_compat(a, b, c, d, e) shm_mq_send(a, b, c, d, e)
+#define shm_mq_sendv_compat(a, b, c, d, e) shm_mq_sendv(a, b, c, d, e)
 #define RelationCreateStorage_compat(a, b, c) RelationCreateStorage(a, b, c)
 #define parse_analyze_varparams_compat(a, b, c, d, e) parse_analyze_varparams(a, b, c, d, \
 																			  e)
@@ -211,6 +219,8 @@ typedef Value String;
 #define strtou64(str, endptr, base) ((uint64) strtoull(str, endptr, base))
 #endif
 #define RelationCreateStorage_compat(a, b, c) RelationCreateStorage(a, b)
+#define shm_mq_send_compat(a, b, c, d, e) shm_mq_send(a, b, c, d)
+#define shm_mq_sendv_compat(a, b, c, d, e) shm_mq_sendv(a, b, c, d)
 #define parse_analyze_varparams_compat(a, b, c, d, e) parse_analyze_varparams(a, b, c, d)
 #define pgstat_init_relation(r) pgstat_initstats(r)
 #define pg_analyze_and_rewrite_fixedparams(a, b, c, d, e) pg_analyze_and_rewrite(a, b, c, \
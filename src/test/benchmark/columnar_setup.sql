@@ -0,0 +1,118 @@
+--
+-- columnar_setup.sql creates the functions used by run_columnar_benchmarks.sh
+-- to load a data set into a columnar table with a given set of options and
+-- to measure the size of the table and the speed of scans and index lookups.
+--
+\set ON_ERROR_STOP on
+
+DROP SCHEMA IF EXISTS bench_columnar CASCADE;
+CREATE SCHEMA bench_columnar;
+
+--
+-- load_dataset recreates bench_columnar.data with the given options and loads
+-- row_count rows of the given data set into it. It returns the number of
+-- rows loaded per second.
+--
+-- The data sets are:
+--   events          sequential ids and timestamps with low cardinality columns,
+--                   which compresses well and allows chunk group filtering
+--   text_heavy      long text values from a small dictionary
+--   random          uniformly random values, which hardly compress
+--
+CREATE FUNCTION bench_columnar.load_dataset(dataset text, row_count bigint,
+                                            compression text,
+                                            chunk_group_row_limit int,
+                                            stripe_row_limit int)
+RETURNS float8
+LANGUAGE plpgsql AS $$
+DECLARE
+    start_time timestamptz;
+BEGIN
+    DROP TABLE IF EXISTS bench_columnar.data;
+    CREATE TABLE bench_columnar.data (
+        id bigint NOT NULL,
+        category int NOT NULL,
+        amount numeric(12,2) NOT NULL,
+        created_at timestamptz NOT NULL,
+        description text
+    ) USING columnar;
+
+    EXECUTE format('ALTER TABLE bench_columnar.data SET (columnar.compression = %s, '
+                   'columnar.chunk_group_row_limit = %s, columnar.stripe_row_limit = %s)',
+                   compression, chunk_group_row_limit, stripe_row_limit);
+
+    start_time := clock_timestamp();
+
+    IF dataset = 'events' THEN
+        INSERT INTO bench_columnar.data
+        SELECT s, s % 16, (s % 10000) / 100.0,
+               '2024-01-01'::timestamptz + s * interval '1 second',
+               'event ' || (s % 100)
+        FROM generate_series(1, row_count) s;
+    ELSIF dataset = 'text_heavy' THEN
+        INSERT INTO bench_columnar.data
+        SELECT s, s % 1000, (s % 10000) / 100.0,
+               '2024-01-01'::timestamptz + s * interval '1 second',
+               repeat(md5((s % 1000)::text), 8)
+        FROM generate_series(1, row_count) s;
+    ELSIF dataset = 'random' THEN
+        INSERT INTO bench_columnar.data
+        SELECT s, (random() * 1000000)::int, (random() * 1000000)::numeric(12,2),
+               '2024-01-01'::timestamptz + random() * interval '365 days',
+               md5(random()::text)
+        FROM generate_series(1, row_count) s;
+    ELSE
+        RAISE EXCEPTION 'unknown data set "%"', dataset;
+    END IF;
+
+    RETURN row_count / extract(epoch FROM clock_timestamp() - start_time);
+END;
+$$;
+
+--
+-- measure_dataset measures bench_columnar.data after it was loaded by
+-- load_dataset and committed. The scans run on a warm cache, since the
+-- first full scan reads the table from disk into the buffer pool.
+--
+CREATE FUNCTION bench_columnar.measure_dataset(index_lookups int,
+                                               OUT size_bytes bigint,
+                                               OUT stripe_count bigint,
+                                               OUT full_scan_ms float8,
+                                               OUT filtered_scan_ms float8,
+                                               OUT index_lookup_ms float8)
+LANGUAGE plpgsql AS $$
+DECLARE
+    start_time timestamptz;
+    row_count bigint;
+BEGIN
+    size_bytes := pg_total_relation_size('bench_columnar.data');
+
+    SELECT count(*) INTO stripe_count
+    FROM columnar.stripe
+    WHERE storage_id = columnar.get_storage_id('bench_columnar.data');
+
+    SELECT count(*) INTO row_count FROM bench_columnar.data;
+
+    start_time := clock_timestamp();
+    PERFORM count(*), sum(amount), max(created_at), max(length(description))
+    FROM bench_columnar.data;
+    full_scan_ms := extract(epoch FROM clock_timestamp() - start_time) * 1000;
+
+    -- a range on id skips most of the chunk groups of the sequential data sets
+    start_time := clock_timestamp();
+    PERFORM count(*), sum(amount)
+    FROM bench_columnar.data
+    WHERE id BETWEEN row_count / 2 AND row_count / 2 + 10000 AND category < 100;
+    filtered_scan_ms := extract(epoch FROM clock_timestamp() - start_time) * 1000;
+
+    CREATE INDEX ON bench_columnar.data (id);
+    SET LOCAL enable_seqscan TO off;
+
+    start_time := clock_timestamp();
+    FOR lookup IN 1 .. index_lookups LOOP
+        PERFORM * FROM bench_columnar.data WHERE id = (random() * (row_count - 1))::bigint + 1;
+    END LOOP;
+    index_lookup_ms := extract(epoch FROM clock_timestamp() - start_time) * 1000 /
+                       greatest(index_lookups, 1);
+END;
+$$;
@@ -0,0 +1,159 @@
+#!/bin/bash
+#
+# run_benchmarks.sh runs the pgbench workloads in the workloads directory and
+# a COPY ingestion workload against an existing Citus cluster, and writes the
+# throughput and latency of every workload to results.csv and results.json in
+# the output directory.
+#
+# The coordinator is reached through the regular libpq environment variables
+# (PGHOST, PGPORT, PGUSER, PGDATABASE). See README.md for the other settings.
+
+# fail if trying to reference a variable that is not set.
+set -u
+# exit immediately if a command fails
+set -e
+
+script_dir=$(cd "$(dirname "$0")" && pwd)
+
+scale="${BENCH_SCALE:-10}"
+clients="${BENCH_CLIENTS:-8}"
+jobs="${BENCH_JOBS:-${clients}}"
+duration="${BENCH_DURATION:-60}"
+shard_moves="${BENCH_SHARD_MOVES:-10}"
+copy_batches="${BENCH_COPY_BATCHES:-10}"
+copy_rows="${BENCH_COPY_ROWS:-100000}"
+skip_setup="${BENCH_SKIP_SETUP:-0}"
+output_dir="${BENCH_OUTPUT_DIR:-${script_dir}/results}"
+workloads="${BENCH_WORKLOADS:-router_select router_update multi_shard_aggregate repartition_join insert_select_pushdown insert_select_repartition columnar_scan copy_ingest shard_move}"
+
+mkdir -p "${output_dir}"
+log_dir="${output_dir}/logs"
+rm -rf "${log_dir}"
+mkdir -p "${log_dir}"
+
+results_csv="${output_dir}/results.csv"
+results_json="${output_dir}/results.json"
+
+citus_version=$(psql -X -A -t -c "SELECT extversion FROM pg_extension WHERE extname = 'citus'")
+run_time=$(date -u +"%Y-%m-%dT%H:%M:%SZ")
+git_commit=$(git -C "${script_dir}" rev-parse --short HEAD 2>/dev/null || echo "unknown")
+
+echo "workload,clients,duration_s,transactions,failed,tps,latency_avg_ms,latency_p50_ms,latency_p95_ms,latency_p99_ms,latency_max_ms" > "${results_csv}"
+
+# latency_percentiles prints the average, p50, p95, p99 and max of the
+# latencies in microseconds on stdin, in milliseconds
+latency_percentiles() {
+    sort -n | awk '
+        { latency[NR] = $1; sum += $1 }
+        END {
+            if (NR == 0) { print "0 0 0 0 0"; exit }
+            p50 = latency[int(NR * 0.50) > 0 ? int(NR * 0.50) : 1]
+            p95 = latency[int(NR * 0.95) > 0 ? int(NR * 0.95) : 1]
+            p99 = latency[int(NR * 0.99) > 0 ? int(NR * 0.99) : 1]
+            printf "%.3f %.3f %.3f %.3f %.3f\n",
+                   sum / NR / 1000, p50 / 1000, p95 / 1000, p99 / 1000, latency[NR] / 1000
+        }'
+}
+
+# record_result appends a line to results.csv
+record_result() {
+    local workload=$1 run_clients=$2 elapsed=$3 transactions=$4 failed=$5 latency_file=$6
+
+    read -r avg p50 p95 p99 max < <(latency_percentiles < "${latency_file}")
+    tps=$(awk -v t="${transactions}" -v s="${elapsed}" 'BEGIN { printf "%.3f", s > 0 ? t / s : 0 }')
+
+    echo "${workload},${run_clients},${elapsed},${transactions},${failed},${tps},${avg},${p50},${p95},${p99},${max}" >> "${results_csv}"
+    echo "${workload}: ${tps} tps, p99 ${p99} ms"
+}
+
+# run_pgbench runs a workload script with pgbench and records its results
+# from the per-transaction logs. Extra arguments are passed to pgbench.
+run_pgbench() {
+    local workload=$1 run_clients=$2
+    shift 2
+
+    local log_prefix="${log_dir}/${workload}"
+    local start end
+
+    start=$(date +%s.%N)
+    pgbench -n -c "${run_clients}" -j "$(( jobs < run_clients ? jobs : run_clients ))" \
+            -D scale="${scale}" -f "${script_dir}/workloads/${workload}.sql" \
+            -l --log-prefix="${log_prefix}" "$@" > "${log_prefix}.out" 2>&1 || {
+        cat "${log_prefix}.out"
+        exit 1
+    }
+    end=$(date +%s.%N)
+
+    # the third field of a pgbench log line is the latency in microseconds,
+    # failed transactions are logged as "failed" or "skipped" instead
+    cat "${log_prefix}".[0-9]* | awk '$3 ~ /^[0-9]+$/ { print $3 }' > "${log_prefix}.latency"
+    local transactions failed elapsed
+    transactions=$(wc -l < "${log_prefix}.latency")
+    failed=$(cat "${log_prefix}".[0-9]* | awk '$3 !~ /^[0-9]+$/' | wc -l)
+    elapsed=$(awk -v s="${start}" -v e="${end}" 'BEGIN { printf "%.3f", e - s }')
+
+    record_result "${workload}" "${run_clients}" "${elapsed}" "${transactions}" "${failed}" "${log_prefix}.latency"
+}
+
+# run_copy_ingest loads a generated CSV file into bench.ingest with \copy a
+# number of times and records the rows per second as throughput and the
+# duration of every batch as latency
+run_copy_ingest() {
+    local workload=copy_ingest
+    local log_prefix="${log_dir}/${workload}"
+    local data_file="${log_dir}/${workload}.csv"
+
+    psql -X -q -v ON_ERROR_STOP=1 -c "\copy (SELECT s % (${scale} * 100000) + 1, s % 1000, s % 5000, now() FROM generate_series(1, ${copy_rows}) s) TO '${data_file}' WITH (FORMAT csv)"
+    psql -X -q -v ON_ERROR_STOP=1 -c "TRUNCATE bench.ingest"
+
+    : > "${log_prefix}.latency"
+    local total_start total_end batch_start batch_end
+    total_start=$(date +%s%N)
+    for _ in $(seq 1 "${copy_batches}"); do
+        batch_start=$(date +%s%N)
+        psql -X -q -v ON_ERROR_STOP=1 -c "\copy bench.ingest FROM '${data_file}' WITH (FORMAT csv)"
+        batch_end=$(date +%s%N)
+        echo $(( (batch_end - batch_start) / 1000 )) >> "${log_prefix}.latency"
+    done
+    total_end=$(date +%s%N)
+
+    local elapsed
+    elapsed=$(awk -v s="${total_start}" -v e="${total_end}" 'BEGIN { printf "%.3f", (e - s) / 1e9 }')
+
+    # the throughput of COPY is reported in rows per second
+    record_result "${workload}" 1 "${elapsed}" "$(( copy_batches * copy_rows ))" 0 "${log_prefix}.latency"
+}
+
+if [ "${skip_setup}" != "1" ]; then
+    echo "loading the data set with scale ${scale}"
+    psql -X -q -v ON_ERROR_STOP=1 -v scale="${scale}" -f "${script_dir}/setup.sql" > "${log_dir}/setup.out"
+fi
+
+for workload in ${workloads}; do
+    case "${workload}" in
+        copy_ingest)
+            run_copy_ingest
+            ;;
+        shard_move)
+            run_pgbench "${workload}" 1 -t "${shard_moves}"
+            ;;
+        *)
+            run_pgbench "${workload}" "${clients}" -T "${duration}"
+            ;;
+    esac
+done
+
+# convert the CSV into a JSON document together with the run settings
+awk -F, -v version="${citus_version}" -v commit="${git_commit}" -v time="${run_time}" -v scale="${scale}" '
+    NR == 1 { for (i = 1; i <= NF; i++) column[i] = $i; next }
+    {
+        row = "    {\"" column[1] "\": \"" $1 "\""
+        for (i = 2; i <= NF; i++) row = row ", \"" column[i] "\": " $i
+        rows = rows (rows == "" ? "" : ",\n") row "}"
+    }
+    END {
+        printf "{\n  \"citus_version\": \"%s\",\n  \"git_commit\": \"%s\",\n", version, commit
+        printf "  \"run_time\": \"%s\",\n  \"scale\": %s,\n  \"results\": [\n%s\n  ]\n}\n", time, scale, rows
+    }' "${results_csv}" > "${results_json}"
+
+echo "results written to ${results_csv} and ${results_json}"
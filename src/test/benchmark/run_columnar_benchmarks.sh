@@ -0,0 +1,69 @@
+#!/bin/bash
+#
+# run_columnar_benchmarks.sh loads data sets into columnar tables with every
+# combination of the given compression types, chunk group row limits and
+# stripe row limits, and measures the load rate, the size on disk, the speed
+# of a full and a filtered scan and the latency of index lookups. The results
+# are printed as a table and written to columnar_results.csv and
+# columnar_results.json in the output directory.
+#
+# The server is reached through the regular libpq environment variables
+# (PGHOST, PGPORT, PGUSER, PGDATABASE). See README.md for the other settings.
+
+# fail if trying to reference a variable that is not set.
+set -u
+# exit immediately if a command fails
+set -e
+
+script_dir=$(cd "$(dirname "$0")" && pwd)
+
+row_count="${BENCH_COLUMNAR_ROWS:-1000000}"
+datasets="${BENCH_COLUMNAR_DATASETS:-events text_heavy random}"
+compressions="${BENCH_COLUMNAR_COMPRESSIONS:-none pglz lz4 zstd}"
+chunk_group_row_limits="${BENCH_COLUMNAR_CHUNK_GROUP_ROW_LIMITS:-1000 10000 100000}"
+stripe_row_limits="${BENCH_COLUMNAR_STRIPE_ROW_LIMITS:-150000 1000000}"
+index_lookups="${BENCH_COLUMNAR_INDEX_LOOKUPS:-1000}"
+output_dir="${BENCH_OUTPUT_DIR:-${script_dir}/results}"
+
+mkdir -p "${output_dir}"
+results_csv="${output_dir}/columnar_results.csv"
+results_json="${output_dir}/columnar_results.json"
+
+psql -X -q -v ON_ERROR_STOP=1 -f "${script_dir}/columnar_setup.sql"
+
+echo "dataset,rows,compression,chunk_group_row_limit,stripe_row_limit,load_rows_per_s,size_bytes,stripes,full_scan_ms,filtered_scan_ms,index_lookup_ms" > "${results_csv}"
+
+for dataset in ${datasets}; do
+    for compression in ${compressions}; do
+        for chunk_group_row_limit in ${chunk_group_row_limits}; do
+            for stripe_row_limit in ${stripe_row_limits}; do
+                # the load and the measurements run in separate transactions,
+                # so that the scans see committed stripes
+                load_rate=$(psql -X -A -t -v ON_ERROR_STOP=1 -c \
+                    "SELECT round(bench_columnar.load_dataset('${dataset}', ${row_count}, '${compression}', ${chunk_group_row_limit}, ${stripe_row_limit})::numeric, 1)")
+                measurements=$(psql -X -A -t -F, -v ON_ERROR_STOP=1 -c \
+                    "SELECT size_bytes, stripe_count, round(full_scan_ms::numeric, 3), round(filtered_scan_ms::numeric, 3), round(index_lookup_ms::numeric, 3) FROM bench_columnar.measure_dataset(${index_lookups})")
+
+                echo "${dataset},${row_count},${compression},${chunk_group_row_limit},${stripe_row_limit},${load_rate},${measurements}" >> "${results_csv}"
+            done
+        done
+    done
+done
+
+psql -X -q -v ON_ERROR_STOP=1 -c "DROP SCHEMA bench_columnar CASCADE"
+
+# dataset and compression are strings, the other columns are numbers
+awk -F, '
+    NR == 1 { for (i = 1; i <= NF; i++) column[i] = $i; next }
+    {
+        row = "  {"
+        for (i = 1; i <= NF; i++) {
+            value = (i == 1 || i == 3) ? "\"" $i "\"" : $i
+            row = row (i == 1 ? "" : ", ") "\"" column[i] "\": " value
+        }
+        rows = rows (rows == "" ? "" : ",\n") row "}"
+    }
+    END { printf "[\n%s\n]\n", rows }' "${results_csv}" > "${results_json}"
+
+column -s, -t < "${results_csv}"
+echo "results written to ${results_csv} and ${results_json}"
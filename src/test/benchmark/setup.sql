@@ -0,0 +1,96 @@
+--
+-- setup.sql creates and loads the tables used by the benchmark workloads.
+-- The size of the data set is controlled by the scale variable, every unit
+-- of scale adds 100000 accounts, 100000 orders and 100000 events.
+--
+-- psql -v scale=10 -f setup.sql
+--
+\set ON_ERROR_STOP on
+
+DROP SCHEMA IF EXISTS bench CASCADE;
+CREATE SCHEMA bench;
+SET search_path TO bench;
+
+SET citus.shard_count TO 32;
+SET citus.shard_replication_factor TO 1;
+
+-- router OLTP, multi-shard aggregates and INSERT..SELECT
+CREATE TABLE accounts (
+    aid bigint PRIMARY KEY,
+    bid int NOT NULL,
+    abalance bigint NOT NULL,
+    filler char(84)
+);
+SELECT create_distributed_table('accounts', 'aid');
+
+CREATE TABLE history (
+    aid bigint NOT NULL,
+    bid int NOT NULL,
+    delta bigint NOT NULL,
+    mtime timestamptz NOT NULL
+);
+SELECT create_distributed_table('history', 'aid', colocate_with => 'accounts');
+
+CREATE TABLE account_snapshots (
+    aid bigint NOT NULL,
+    abalance bigint NOT NULL,
+    snapshot_time timestamptz NOT NULL
+);
+SELECT create_distributed_table('account_snapshots', 'aid', colocate_with => 'accounts');
+
+CREATE TABLE branch_totals (
+    bid int PRIMARY KEY,
+    account_count bigint NOT NULL,
+    balance_total bigint NOT NULL
+);
+SELECT create_distributed_table('branch_totals', 'bid');
+
+-- repartition joins, orders is distributed by a column other than the join column
+CREATE TABLE orders (
+    order_id bigint PRIMARY KEY,
+    customer_id bigint NOT NULL,
+    amount numeric(12,2) NOT NULL,
+    order_time timestamptz NOT NULL
+);
+SELECT create_distributed_table('orders', 'order_id', colocate_with => 'none');
+
+-- columnar scans
+CREATE TABLE events (
+    aid bigint NOT NULL,
+    event_type int NOT NULL,
+    amount numeric(12,2) NOT NULL,
+    event_time timestamptz NOT NULL,
+    payload text
+) USING columnar;
+SELECT create_distributed_table('events', 'aid', colocate_with => 'accounts');
+
+-- COPY ingestion
+CREATE TABLE ingest (LIKE history);
+SELECT create_distributed_table('ingest', 'aid', colocate_with => 'accounts');
+
+-- shard moves, in its own colocation group so that only its shards move
+CREATE TABLE move_target (
+    id bigint PRIMARY KEY,
+    payload text
+);
+SELECT create_distributed_table('move_target', 'id', shard_count => 4, colocate_with => 'none');
+
+INSERT INTO accounts
+SELECT s, (s - 1) / 1000 + 1, 0, ''
+FROM generate_series(1, :scale * 100000) s;
+
+INSERT INTO orders
+SELECT s, (s * 7919) % (:scale * 100000) + 1, (s % 10000) / 100.0,
+       '2024-01-01'::timestamptz + s * interval '1 second'
+FROM generate_series(1, :scale * 100000) s;
+
+INSERT INTO events
+SELECT (s * 104729) % (:scale * 100000) + 1, s % 16, (s % 10000) / 100.0,
+       '2024-01-01'::timestamptz + s * interval '1 second', md5(s::text)
+FROM generate_series(1, :scale * 100000) s;
+
+INSERT INTO move_target
+SELECT s, repeat(md5(s::text), 8)
+FROM generate_series(1, 100000) s;
+
+VACUUM ANALYZE accounts, history, orders, events, move_target;
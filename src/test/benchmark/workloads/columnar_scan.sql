@@ -0,0 +1,5 @@
+-- scan a few columns of a distributed columnar table with a selective filter
+\set event_type random(0, 15)
+SELECT count(*), sum(amount)
+FROM bench.events
+WHERE event_type = :event_type AND amount > 50;
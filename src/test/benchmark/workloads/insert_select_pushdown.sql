@@ -0,0 +1,4 @@
+-- INSERT..SELECT between colocated tables, pushed down to the shards
+\set bid random(1, :scale * 100)
+INSERT INTO bench.account_snapshots (aid, abalance, snapshot_time)
+SELECT aid, abalance, now() FROM bench.accounts WHERE bid = :bid;
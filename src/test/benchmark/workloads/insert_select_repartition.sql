@@ -0,0 +1,6 @@
+-- INSERT..SELECT into a table distributed by a different column, which
+-- repartitions the results of the SELECT by the target distribution column
+INSERT INTO bench.branch_totals AS t (bid, account_count, balance_total)
+SELECT bid, count(*), sum(abalance) FROM bench.accounts GROUP BY bid
+ON CONFLICT (bid) DO UPDATE
+SET account_count = excluded.account_count, balance_total = excluded.balance_total;
@@ -0,0 +1,6 @@
+-- aggregate across all shards, grouped by a column other than the distribution column
+SELECT bid, count(*), sum(abalance), avg(abalance)
+FROM bench.accounts
+GROUP BY bid
+ORDER BY sum(abalance) DESC
+LIMIT 10;
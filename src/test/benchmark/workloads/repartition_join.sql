@@ -0,0 +1,7 @@
+-- join on a column that is not the distribution column of orders, which
+-- requires repartitioning the intermediate results between the workers
+\set bid random(1, :scale * 100)
+SET citus.enable_repartition_joins TO on;
+SELECT count(*), sum(o.amount)
+FROM bench.accounts a JOIN bench.orders o ON (a.aid = o.customer_id)
+WHERE a.bid = :bid;
@@ -0,0 +1,3 @@
+-- single row lookup on the distribution column, routed to one shard
+\set aid random(1, :scale * 100000)
+SELECT abalance FROM bench.accounts WHERE aid = :aid;
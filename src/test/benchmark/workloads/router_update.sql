@@ -0,0 +1,9 @@
+-- pgbench style transaction in which all statements go to the same shard group
+\set aid random(1, :scale * 100000)
+\set delta random(-5000, 5000)
+BEGIN;
+UPDATE bench.accounts SET abalance = abalance + :delta WHERE aid = :aid;
+SELECT abalance FROM bench.accounts WHERE aid = :aid;
+INSERT INTO bench.history (aid, bid, delta, mtime)
+VALUES (:aid, (:aid - 1) / 1000 + 1, :delta, now());
+END;
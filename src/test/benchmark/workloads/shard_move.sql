@@ -0,0 +1,18 @@
+-- move the first shard of move_target to another node, every transaction
+-- moves it away from where the previous one left it, after dropping the
+-- placement left behind by the previous move
+CALL citus_cleanup_orphaned_resources();
+SELECT s.shardid, p.nodename AS source_name, p.nodeport AS source_port
+FROM pg_dist_shard s JOIN pg_dist_shard_placement p USING (shardid)
+WHERE s.logicalrelid = 'bench.move_target'::regclass
+ORDER BY s.shardid LIMIT 1
+\gset
+SELECT nodename AS target_name, nodeport AS target_port
+FROM pg_dist_node
+WHERE noderole = 'primary' AND isactive AND shouldhaveshards
+  AND (nodename, nodeport) <> (':source_name', :source_port)
+ORDER BY nodeid LIMIT 1
+\gset
+SELECT citus_move_shard_placement(:shardid, ':source_name', :source_port,
+                                  ':target_name', :target_port,
+                                  shard_transfer_mode => 'block_writes');
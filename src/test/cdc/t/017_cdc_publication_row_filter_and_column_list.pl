@@ -0,0 +1,93 @@
+# CDC test for publications with row filters and column lists on a distributed table
+use strict;
+use warnings;
+
+use Test::More;
+
+use lib './t';
+use cdctestlib;
+
+### Create the citus cluster with coordinator and two worker nodes
+our ($node_coordinator, @workers) = create_citus_cluster(2,"localhost",57636);
+
+# Row filters and column lists are only supported from PG15 onwards.
+my $server_version_num = $node_coordinator->safe_psql('postgres', 'SHOW server_version_num;');
+if ($server_version_num < 150000) {
+    plan skip_all => 'publication row filters and column lists require PG15 or later';
+}
+
+# Only the published columns are compared.
+my $select_stmt = qq(SELECT measureid, eventdatetime, measure_status FROM sensors ORDER BY measureid, eventdatetime;);
+my $filtered_select_stmt = qq(SELECT measureid, eventdatetime, measure_status FROM sensors WHERE measureid % 2 = 0 ORDER BY measureid, eventdatetime;);
+my $result = 0;
+
+our $node_cdc_client = create_node('cdc_client', 0, "localhost", 57639);
+
+my $initial_schema = "
+        CREATE TABLE sensors(
+        measureid               integer,
+        eventdatetime           timestamptz,
+        measure_status          char(1),
+        measure_comment         varchar(44),
+        PRIMARY KEY (measureid, eventdatetime));";
+
+$node_coordinator->safe_psql('postgres',$initial_schema);
+$node_cdc_client->safe_psql('postgres',$initial_schema);
+
+# Publish only the primary key and status columns of the rows with an even measureid.
+create_cdc_publication_and_slots_for_coordinator($node_coordinator,
+    'sensors (measureid, eventdatetime, measure_status) WHERE (measureid % 2 = 0)');
+connect_cdc_client_to_coordinator_publication($node_coordinator, $node_cdc_client);
+wait_for_cdc_client_to_catch_up_with_coordinator($node_coordinator);
+
+create_cdc_slots_for_workers(\@workers);
+
+# Distribute the sensors table to worker nodes.
+$node_coordinator->safe_psql('postgres',"SELECT create_distributed_table('sensors', 'measureid');");
+
+connect_cdc_client_to_workers_publication(\@workers, $node_cdc_client);
+wait_for_cdc_client_to_catch_up_with_citus_cluster($node_coordinator, \@workers);
+
+$node_coordinator->safe_psql('postgres',"
+ INSERT INTO sensors
+	SELECT i, '2020-01-05', 'A', 'I <3 Citus'
+	FROM generate_series(0,10)i;");
+
+wait_for_cdc_client_to_catch_up_with_citus_cluster($node_coordinator, \@workers);
+
+$result = compare_tables_in_different_nodes($node_coordinator,$node_cdc_client,'postgres',$filtered_select_stmt);
+is($result, 1, 'CDC publication filter test - filtered rows are inserted');
+
+$result = $node_cdc_client->safe_psql('postgres',"SELECT count(*) FROM sensors WHERE measureid % 2 = 1 OR measure_comment IS NOT NULL;");
+is($result, 0, 'CDC publication filter test - unpublished rows and columns are not inserted');
+
+$node_coordinator->safe_psql('postgres',"
+UPDATE sensors
+	SET measure_status = 'B', measure_comment = 'Comment:' || measureid::text;");
+
+wait_for_cdc_client_to_catch_up_with_citus_cluster($node_coordinator, \@workers);
+
+$result = compare_tables_in_different_nodes($node_coordinator,$node_cdc_client,'postgres',$filtered_select_stmt);
+is($result, 1, 'CDC publication filter test - filtered rows are updated');
+
+$result = $node_cdc_client->safe_psql('postgres',"SELECT count(*) FROM sensors WHERE measure_comment IS NOT NULL;");
+is($result, 0, 'CDC publication filter test - unpublished columns are not updated');
+
+$node_coordinator->safe_psql('postgres',"DELETE FROM sensors WHERE measureid < 5;");
+
+wait_for_cdc_client_to_catch_up_with_citus_cluster($node_coordinator, \@workers);
+
+$result = compare_tables_in_different_nodes($node_coordinator,$node_cdc_client,'postgres',$filtered_select_stmt);
+is($result, 1, 'CDC publication filter test - filtered rows are deleted');
+
+# Stop publishing deletes and check that they are no longer decoded.
+$node_coordinator->safe_psql('postgres',"ALTER PUBLICATION cdc_publication SET (publish = 'insert, update');");
+$node_coordinator->safe_psql('postgres',"DELETE FROM sensors WHERE measureid = 6;");
+
+wait_for_cdc_client_to_catch_up_with_citus_cluster($node_coordinator, \@workers);
+
+$result = $node_cdc_client->safe_psql('postgres',"SELECT count(*) FROM sensors WHERE measureid = 6;");
+is($result, 1, 'CDC publication filter test - unpublished deletes are skipped');
+
+drop_cdc_client_subscriptions($node_cdc_client,\@workers);
+done_testing();
@@ -481,6 +481,12 @@ if ($majorversion >= "14") {
 push(@pgOptions, "citus.shard_count=4");
 push(@pgOptions, "citus.max_adaptive_executor_pool_size=4");
 push(@pgOptions, "citus.defer_shard_delete_interval=-1");
+push(@pgOptions, "citus.shard_column_statistics_refresh_interval=-1");
+push(@pgOptions, "citus.shard_size_cache_refresh_interval=-1");
+push(@pgOptions, "citus.shard_size_cache_size='1MB'");
+push(@pgOptions, "citus.query_result_cache_size='1MB'");
+push(@pgOptions, "citus.shared_placement_cache_size='1MB'");
+push(@pgOptions, "citus.enable_incremental_shard_list_rebuild='on'");
 push(@pgOptions, "citus.repartition_join_bucket_count_per_node=2");
 push(@pgOptions, "citus.sort_returning='on'");
 push(@pgOptions, "citus.shard_replication_factor=2");
@@ -495,6 +501,9 @@ push(@pgOptions, "citus.stat_tenants_track = 'ALL'");
 push(@pgOptions, "citus.main_db = 'regression'");
 push(@pgOptions, "citus.superuser = 'postgres'");
 
+# Columnar options set for the tests
+push(@pgOptions, "columnar.chunk_cache_size='4MB'");
+
 # Some tests look at shards in pg_class, make sure we can usually see them:
 push(@pgOptions, "citus.show_shards_for_app_name_prefixes='pg_regress'");
 
@@ -0,0 +1,60 @@
+setup
+{
+    CREATE TABLE test_stripe_compaction (a int) USING columnar;
+    INSERT INTO test_stripe_compaction VALUES (1), (2);
+    INSERT INTO test_stripe_compaction VALUES (3), (4);
+    INSERT INTO test_stripe_compaction VALUES (5), (6);
+}
+
+teardown
+{
+    DROP TABLE IF EXISTS test_stripe_compaction CASCADE;
+}
+
+session "s1"
+
+step "s1-begin"
+{
+    BEGIN TRANSACTION ISOLATION LEVEL REPEATABLE READ;
+}
+
+step "s1-select"
+{
+    SELECT count(*), sum(a) FROM test_stripe_compaction;
+}
+
+step "s1-insert"
+{
+    INSERT INTO test_stripe_compaction VALUES (7);
+}
+
+step "s1-delete"
+{
+    DELETE FROM test_stripe_compaction WHERE a = 1;
+}
+
+step "s1-commit"
+{
+    COMMIT;
+}
+
+session "s2"
+
+step "s2-compact"
+{
+    SELECT columnar.compact_stripes('test_stripe_compaction');
+}
+
+step "s2-select"
+{
+    SELECT count(*), sum(a) FROM test_stripe_compaction;
+}
+
+// readers that started before the compaction keep reading the old stripes
+permutation "s1-begin" "s1-select" "s2-compact" "s1-select" "s1-commit" "s2-select"
+
+// concurrent inserts are not blocked, their stripes are not merged yet
+permutation "s1-begin" "s1-insert" "s2-compact" "s1-commit" "s2-select"
+
+// compaction waits for the transactions that delete rows
+permutation "s1-begin" "s1-delete" "s2-compact" "s1-commit" "s2-select"
@@ -0,0 +1,56 @@
+setup
+{
+	SET citus.shard_replication_factor TO 1;
+	CREATE TABLE wait_events_table (key int, value int);
+	SELECT create_distributed_table('wait_events_table', 'key');
+	INSERT INTO wait_events_table VALUES (1, 1);
+}
+
+teardown
+{
+	DROP TABLE wait_events_table;
+}
+
+session "s1"
+
+step "s1-begin"
+{
+	BEGIN;
+}
+
+step "s1-update"
+{
+	UPDATE wait_events_table SET value = 2 WHERE key = 1;
+}
+
+step "s1-commit"
+{
+	COMMIT;
+}
+
+session "s2"
+
+step "s2-update"
+{
+	UPDATE wait_events_table SET value = 3 WHERE key = 1;
+}
+
+session "s3"
+
+// the patterns are split, such that they do not match the query of s3 itself
+step "s3-show-wait-events"
+{
+	SELECT w.wait_event
+	FROM citus_wait_events() w JOIN pg_stat_activity a USING (pid)
+	WHERE a.query LIKE '%SET value = ' || '3%';
+}
+
+step "s3-show-citus-stat-activity"
+{
+	SELECT wait_event_type, wait_event
+	FROM citus_stat_activity
+	WHERE query LIKE '%SET value = ' || '3%' AND NOT is_worker_query;
+}
+
+// s2 waits for the result of its update on the worker, which waits for the lock of s1
+permutation "s1-begin" "s1-update" "s2-update" "s3-show-wait-events" "s3-show-citus-stat-activity" "s1-commit"
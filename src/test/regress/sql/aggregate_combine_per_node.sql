@@ -0,0 +1,70 @@
+--
+-- aggregate_combine_per_node.sql
+--
+-- Test merging the partial aggregates of the shards on each node on the node,
+-- and grouping the tasks of each node into one.
+--
+
+CREATE SCHEMA aggregate_combine_per_node;
+SET search_path TO aggregate_combine_per_node;
+SET citus.next_shard_id TO 1942000;
+SET citus.shard_count TO 8;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE events (a int, b int, c int);
+SELECT create_distributed_table('events', 'a');
+INSERT INTO events SELECT s, s % 5, s % 97 FROM generate_series(1, 1000) s;
+
+CREATE TABLE uncombined_results AS
+SELECT b, count(*), sum(a), min(c), max(c), round(avg(a), 2) AS avg,
+       bool_and(a > 0), bool_or(a > 995)
+FROM events GROUP BY b;
+
+SET citus.enable_aggregate_combine_per_node TO on;
+SET client_min_messages TO DEBUG1;
+
+-- the tasks of each node are merged into one
+SELECT b, count(*), sum(a), min(c), max(c), round(avg(a), 2) AS avg,
+       bool_and(a > 0), bool_or(a > 995)
+FROM events GROUP BY b ORDER BY b;
+
+SELECT count(*), sum(a), max(c) FROM events WHERE c < 10;
+
+-- aggregates that are not merged on the nodes keep a task per shard
+SELECT b, array_length(array_agg(a), 1) FROM events GROUP BY b ORDER BY b;
+
+-- groups by the distribution column are not merged on the coordinator either
+SELECT a, count(*) FROM events WHERE a < 4 GROUP BY a ORDER BY a;
+
+-- placements that the transaction accessed are left alone
+BEGIN;
+INSERT INTO events VALUES (1001, 1, 1);
+SELECT b, count(*) FROM events GROUP BY b ORDER BY b;
+ROLLBACK;
+
+RESET client_min_messages;
+
+CREATE TABLE combined_results AS
+SELECT b, count(*), sum(a), min(c), max(c), round(avg(a), 2) AS avg,
+       bool_and(a > 0), bool_or(a > 995)
+FROM events GROUP BY b;
+
+SELECT count(*) FROM (TABLE combined_results EXCEPT TABLE uncombined_results) diff;
+
+-- the tasks of each node can also be grouped without merging their results
+RESET citus.enable_aggregate_combine_per_node;
+SET citus.enable_shard_task_grouping TO on;
+SET client_min_messages TO DEBUG1;
+
+SELECT a, c FROM events WHERE c = 3 ORDER BY a;
+
+SELECT b, array_length(array_agg(a), 1) FROM events GROUP BY b ORDER BY b;
+
+-- sorted task results are not grouped
+SELECT a FROM events ORDER BY a LIMIT 3;
+
+RESET client_min_messages;
+RESET citus.enable_shard_task_grouping;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA aggregate_combine_per_node CASCADE;
@@ -0,0 +1,61 @@
+--
+-- alter_distributed_table_concurrently.sql
+--
+-- Test increasing the shard count of distributed tables by splitting their
+-- shards.
+--
+
+CREATE SCHEMA alter_table_concurrently;
+SET search_path TO alter_table_concurrently;
+SET citus.next_shard_id TO 1945000;
+SET citus.shard_count TO 2;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int PRIMARY KEY, b int);
+SELECT create_distributed_table('dist_table', 'a');
+CREATE TABLE colocated_table (a int PRIMARY KEY, b int);
+SELECT create_distributed_table('colocated_table', 'a', colocate_with := 'dist_table');
+INSERT INTO dist_table SELECT i, i FROM generate_series(1, 100) i;
+INSERT INTO colocated_table SELECT i, i * 2 FROM generate_series(1, 100) i;
+
+-- the shard count can only be increased to a multiple of the current one
+SELECT alter_distributed_table_concurrently('dist_table', 3);
+SELECT alter_distributed_table_concurrently('dist_table', 2);
+
+-- the shards are split in transactions of their own
+BEGIN;
+SELECT alter_distributed_table_concurrently('dist_table', 4);
+ROLLBACK;
+
+CREATE TABLE ref_table (a int);
+SELECT create_reference_table('ref_table');
+SELECT alter_distributed_table_concurrently('ref_table', 4);
+
+SELECT alter_distributed_table_concurrently('dist_table', 4, shard_transfer_mode := 'force_logical');
+
+SELECT logicalrelid, count(*) FROM pg_dist_shard
+WHERE logicalrelid IN ('dist_table'::regclass, 'colocated_table'::regclass)
+GROUP BY logicalrelid ORDER BY logicalrelid;
+
+SELECT count(DISTINCT p.colocationid), min(c.shardcount)
+FROM pg_dist_partition p JOIN pg_dist_colocation c USING (colocationid)
+WHERE logicalrelid IN ('dist_table'::regclass, 'colocated_table'::regclass);
+
+SELECT count(*), sum(d.b), sum(c.b) FROM dist_table d JOIN colocated_table c USING (a);
+
+SELECT alter_distributed_table_concurrently('colocated_table', 8, 'block_writes');
+
+SELECT logicalrelid, count(*) FROM pg_dist_shard
+WHERE logicalrelid IN ('dist_table'::regclass, 'colocated_table'::regclass)
+GROUP BY logicalrelid ORDER BY logicalrelid;
+
+SELECT count(DISTINCT p.colocationid), min(c.shardcount)
+FROM pg_dist_partition p JOIN pg_dist_colocation c USING (colocationid)
+WHERE logicalrelid IN ('dist_table'::regclass, 'colocated_table'::regclass);
+
+SELECT count(*), sum(d.b), sum(c.b) FROM dist_table d JOIN colocated_table c USING (a);
+SELECT b FROM dist_table WHERE a = 42;
+
+SET client_min_messages TO WARNING;
+CALL citus_cleanup_orphaned_resources();
+DROP SCHEMA alter_table_concurrently CASCADE;
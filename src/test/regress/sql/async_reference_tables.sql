@@ -0,0 +1,83 @@
+--
+-- async_reference_tables.sql
+--
+-- Test reference tables whose modifications are only written to their primary
+-- placement and replicated asynchronously to the other placements.
+--
+
+CREATE SCHEMA async_reference_tables;
+SET search_path TO async_reference_tables;
+SET citus.next_shard_id TO 1945000;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE settings (key text PRIMARY KEY, value text);
+SELECT create_reference_table('settings');
+INSERT INTO settings VALUES ('a', '1'), ('b', '2'), ('c', '3');
+
+-- only reference tables can be replicated asynchronously
+CREATE TABLE events (id int);
+SELECT create_distributed_table('events', 'id');
+SELECT citus_set_reference_table_async('events', true);
+
+-- tables involved in a foreign key cannot be replicated asynchronously
+CREATE TABLE overrides (key text PRIMARY KEY REFERENCES settings (key), value text);
+SELECT create_reference_table('overrides');
+SELECT citus_set_reference_table_async('settings', true);
+SELECT citus_set_reference_table_async('overrides', true);
+DROP TABLE overrides;
+
+-- subscriptions cannot be created in a transaction block
+BEGIN;
+SELECT citus_set_reference_table_async('settings', true);
+ROLLBACK;
+
+SELECT citus_set_reference_table_async('settings', true);
+SELECT count(*) FROM pg_dist_async_reference_table WHERE logicalrelid = 'settings'::regclass;
+
+-- setting it again is a no-op
+SELECT citus_set_reference_table_async('settings', true);
+
+-- foreign keys cannot be added to asynchronously replicated tables either
+CREATE TABLE overrides (key text PRIMARY KEY, value text);
+SELECT create_reference_table('overrides');
+ALTER TABLE overrides ADD CONSTRAINT overrides_key_fkey FOREIGN KEY (key) REFERENCES settings (key);
+DROP TABLE overrides;
+
+UPDATE settings SET value = '20' WHERE key = 'b';
+DELETE FROM settings WHERE key = 'c';
+INSERT INTO settings VALUES ('d', '4');
+COPY settings FROM STDIN WITH CSV;
+e,5
+\.
+
+-- all placements have the modifications once they caught up
+SELECT citus_wait_for_async_reference_tables();
+SELECT DISTINCT result FROM run_command_on_placements('settings', $$SELECT string_agg(key || '=' || value, ',' ORDER BY key) FROM %s$$);
+
+-- writes go to all placements again after disabling
+SELECT citus_set_reference_table_async('settings', false);
+SELECT count(*) FROM pg_dist_async_reference_table WHERE logicalrelid = 'settings'::regclass;
+INSERT INTO settings VALUES ('f', '6');
+SELECT DISTINCT result FROM run_command_on_placements('settings', $$SELECT string_agg(key || '=' || value, ',' ORDER BY key) FROM %s$$);
+
+-- the subscriptions, publication, replication slots and triggers are gone
+SELECT DISTINCT result FROM run_command_on_all_nodes($$SELECT count(*) FROM pg_subscription WHERE subname LIKE 'citus_async_reference_tables%'$$);
+SELECT DISTINCT result FROM run_command_on_all_nodes($$SELECT count(*) FROM pg_publication WHERE pubname LIKE 'citus_async_reference_tables%'$$);
+SELECT DISTINCT result FROM run_command_on_all_nodes($$SELECT count(*) FROM pg_replication_slots WHERE slot_name LIKE 'citus_async_reference_tables%'$$);
+SELECT DISTINCT result FROM run_command_on_placements('settings', $$SELECT count(*) FROM pg_trigger WHERE tgrelid = '%s'::regclass AND tgname = 'citus_async_reference_table_replica'$$);
+
+-- dropping an asynchronously replicated table removes its metadata and replication
+SELECT citus_set_reference_table_async('settings', true);
+DROP TABLE settings;
+SELECT count(*) FROM pg_dist_async_reference_table;
+
+-- the subscriptions, publication and replication slots are dropped after the commit
+SET client_min_messages TO WARNING;
+CALL citus_cleanup_orphaned_resources();
+RESET client_min_messages;
+SELECT DISTINCT result FROM run_command_on_all_nodes($$SELECT count(*) FROM pg_subscription WHERE subname LIKE 'citus_async_reference_tables%'$$);
+SELECT DISTINCT result FROM run_command_on_all_nodes($$SELECT count(*) FROM pg_publication WHERE pubname LIKE 'citus_async_reference_tables%'$$);
+SELECT DISTINCT result FROM run_command_on_all_nodes($$SELECT count(*) FROM pg_replication_slots WHERE slot_name LIKE 'citus_async_reference_tables%'$$);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA async_reference_tables CASCADE;
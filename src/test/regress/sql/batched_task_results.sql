@@ -0,0 +1,47 @@
+--
+-- batched_task_results.sql
+--
+-- Test receiving the rows of SELECT tasks in batches rather than as one
+-- libpq result per row.
+--
+CREATE SCHEMA batched_task_results;
+SET search_path TO batched_task_results;
+
+SET citus.next_shard_id TO 1914000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE readings(id int, sensor text, value numeric, taken_at timestamp);
+SELECT create_distributed_table('readings', 'id');
+INSERT INTO readings
+SELECT i,
+       CASE WHEN i % 10 = 0 THEN NULL ELSE 'sensor ' || (i % 7) END,
+       i * 0.25,
+       timestamp '2024-01-01 00:00:00' + i * interval '1 minute'
+FROM generate_series(1, 10000) i;
+
+SET citus.enable_batched_task_results TO on;
+
+-- the rows are combined on the coordinator
+SELECT count(*), count(sensor), sum(value), to_char(max(taken_at), 'YYYY-MM-DD HH24:MI')
+FROM (SELECT * FROM readings OFFSET 0) r;
+SELECT id, sensor, value FROM readings WHERE id % 2501 = 0 OR id = 10000 ORDER BY id;
+SELECT sensor, count(*) FROM readings GROUP BY sensor ORDER BY sensor NULLS FIRST;
+
+-- tasks that return no rows
+SELECT id, sensor, value FROM readings WHERE id < 0;
+
+-- subplans go through the same path
+WITH top_readings AS (SELECT * FROM readings ORDER BY value DESC LIMIT 3)
+SELECT id, value FROM top_readings ORDER BY id;
+
+-- parameters cannot be sent along with COPY
+PREPARE readings_above(numeric) AS SELECT id FROM readings WHERE value > $1 ORDER BY id;
+EXECUTE readings_above(2499);
+
+-- errors are reported as usual
+SELECT id / (id - 5000) FROM readings ORDER BY 1 LIMIT 1;
+
+RESET citus.enable_batched_task_results;
+SET client_min_messages TO warning;
+DROP SCHEMA batched_task_results CASCADE;
@@ -92,6 +92,22 @@ SELECT ARRAY[(col1, col1)] FROM binaryless_builtin;
 SELECT ARRAY[(col1, col1)::binaryless_composite_type] FROM binaryless_builtin;
 SELECT ARRAY[(col1, col1)::binaryless_composite_domain] FROM binaryless_builtin;
 
+-- composite types whose attributes can all be binary encoded use binary format
+SET citus.enable_binary_protocol_for_composite_types TO on;
+SELECT col FROM composite_type_table;
+SELECT col::composite_type_domain FROM composite_type_table;
+SELECT (col, col)::nested_composite_type FROM composite_type_table;
+SELECT ARRAY[(col, col)::nested_composite_type_domain] FROM composite_type_table;
+SELECT (col1, col1)::binaryless_composite_type FROM binaryless_builtin;
+SELECT ARRAY[(col1, col1)::binaryless_composite_domain] FROM binaryless_builtin;
+
+-- adding an attribute that cannot be binary encoded makes us use text format
+CREATE TYPE evolving_composite_type AS (a int);
+SELECT ROW(id)::evolving_composite_type FROM composite_type_table;
+ALTER TYPE evolving_composite_type ADD ATTRIBUTE b aclitem;
+SELECT ROW(1, col1)::evolving_composite_type FROM binaryless_builtin;
+RESET citus.enable_binary_protocol_for_composite_types;
+
 CREATE TABLE test_table_1(id int, val1 int);
 CREATE TABLE test_table_2(id int, val1 bigint);
 SELECT create_distributed_table('test_table_1', 'id');
@@ -0,0 +1,76 @@
+--
+-- broadcast_join.sql
+--
+-- Test broadcasting small distributed tables as intermediate results in joins
+-- with distributed tables that they are not co-located with.
+--
+CREATE SCHEMA broadcast_join;
+SET search_path TO broadcast_join;
+
+SET citus.next_shard_id TO 1902000;
+SET citus.shard_replication_factor TO 1;
+SET citus.enable_repartition_joins TO on;
+
+SET citus.shard_count TO 3;
+CREATE TABLE small_table(key int, value int);
+SELECT create_distributed_table('small_table', 'key');
+INSERT INTO small_table SELECT i, i FROM generate_series(1, 10) i;
+
+SET citus.shard_count TO 4;
+CREATE TABLE large_table(key int, value int);
+SELECT create_distributed_table('large_table', 'key');
+INSERT INTO large_table SELECT i, i FROM generate_series(1, 100000) i;
+
+CREATE TABLE colocated_table(key int, value int);
+SELECT create_distributed_table('colocated_table', 'key', colocate_with => 'large_table');
+INSERT INTO colocated_table SELECT i, i FROM generate_series(1, 100) i;
+
+-- returns how the join in the given query is planned
+CREATE FUNCTION join_strategy(query text)
+RETURNS text LANGUAGE plpgsql AS $$
+DECLARE
+  line text;
+BEGIN
+  FOR line IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+    IF line LIKE '%Distributed Subplan %' THEN
+      RETURN 'broadcast';
+    ELSIF line LIKE '%Map Task Count: %' THEN
+      RETURN 'repartition';
+    END IF;
+  END LOOP;
+  RETURN 'pushdown';
+END;
+$$;
+
+-- disabled by default
+SELECT join_strategy('SELECT count(*) FROM large_table l JOIN small_table s ON (l.value = s.key)');
+
+SET citus.broadcast_join_threshold TO '1GB';
+
+-- without statistics, the table sizes are unknown
+SELECT join_strategy('SELECT count(*) FROM large_table l JOIN small_table s ON (l.value = s.key)');
+
+SELECT citus_update_table_statistics('small_table');
+SELECT citus_update_table_statistics('large_table');
+SELECT citus_update_table_statistics('colocated_table');
+
+-- only the small table is broadcast, regardless of the join order
+SELECT join_strategy('SELECT count(*) FROM large_table l JOIN small_table s ON (l.value = s.key)');
+SELECT join_strategy('SELECT count(*) FROM small_table s JOIN large_table l ON (l.value = s.key)');
+SELECT count(*), sum(l.value) FROM large_table l JOIN small_table s ON (l.value = s.key);
+
+SELECT join_strategy('SELECT count(*) FROM large_table l JOIN colocated_table c USING (key) JOIN small_table s ON (c.value = s.value)');
+SELECT count(*), sum(l.value) FROM large_table l JOIN colocated_table c USING (key) JOIN small_table s ON (c.value = s.value);
+
+-- co-located joins are pushed down as before
+SELECT join_strategy('SELECT count(*) FROM large_table l JOIN colocated_table c USING (key)');
+
+-- tables above the threshold are repartitioned
+SET citus.broadcast_join_threshold TO '8kB';
+SELECT join_strategy('SELECT count(*) FROM large_table l JOIN small_table s ON (l.value = s.key)');
+SELECT count(*), sum(l.value) FROM large_table l JOIN small_table s ON (l.value = s.key);
+
+RESET citus.broadcast_join_threshold;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA broadcast_join CASCADE;
@@ -0,0 +1,63 @@
+--
+-- buffered_ddl_propagation.sql
+--
+-- Test buffering the DDL commands propagated to nodes with metadata in
+-- transaction blocks.
+--
+
+CREATE SCHEMA buffered_ddl_propagation;
+SET search_path TO buffered_ddl_propagation;
+SET citus.next_shard_id TO 1935000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int PRIMARY KEY, b text);
+SELECT create_distributed_table('dist_table', 'a');
+
+SET citus.buffer_ddl_propagation TO on;
+
+-- buffered DDL commands are sent to the nodes with metadata on commit
+BEGIN;
+ALTER TABLE dist_table ADD COLUMN c int;
+ALTER TABLE dist_table ADD COLUMN d int DEFAULT 4;
+CREATE INDEX dist_table_c_idx ON dist_table (c);
+ALTER TABLE dist_table RENAME COLUMN b TO bb;
+COMMIT;
+
+SELECT result FROM run_command_on_workers($$
+    SELECT string_agg(attname, ',' ORDER BY attnum) FROM pg_attribute
+    WHERE attrelid = 'buffered_ddl_propagation.dist_table'::regclass AND attnum > 0 AND NOT attisdropped
+$$);
+SELECT result FROM run_command_on_workers($$
+    SELECT count(*) FROM pg_indexes
+    WHERE schemaname = 'buffered_ddl_propagation' AND indexname = 'dist_table_c_idx'
+$$);
+
+-- buffered DDL commands are discarded on rollback
+BEGIN;
+ALTER TABLE dist_table ADD COLUMN e int;
+ROLLBACK;
+
+-- queries after buffered DDL commands observe them
+BEGIN;
+ALTER TABLE dist_table ADD COLUMN e int;
+INSERT INTO dist_table (a, e) VALUES (1, 5);
+SELECT a, bb, c, d, e FROM dist_table;
+ALTER TABLE dist_table DROP COLUMN e;
+COMMIT;
+
+-- the buffer is sent before savepoints
+BEGIN;
+ALTER TABLE dist_table ADD COLUMN e int;
+SAVEPOINT s1;
+ALTER TABLE dist_table ADD COLUMN f int;
+ROLLBACK TO SAVEPOINT s1;
+COMMIT;
+
+SELECT result FROM run_command_on_workers($$
+    SELECT string_agg(attname, ',' ORDER BY attnum) FROM pg_attribute
+    WHERE attrelid = 'buffered_ddl_propagation.dist_table'::regclass AND attnum > 0 AND NOT attisdropped
+$$);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA buffered_ddl_propagation CASCADE;
@@ -0,0 +1,121 @@
+--
+-- buffered_insert.sql
+--
+-- Test buffering router INSERTs in transaction blocks.
+--
+
+CREATE SCHEMA buffered_insert;
+SET search_path TO buffered_insert;
+SET citus.next_shard_id TO 1925000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int PRIMARY KEY, b text);
+SELECT create_distributed_table('dist_table', 'a');
+SET citus.shard_count TO 1;
+CREATE TABLE single_shard_table (a int PRIMARY KEY, b text);
+SELECT create_distributed_table('single_shard_table', 'a');
+
+SET citus.max_buffered_insert_rows TO 100;
+
+-- buffered INSERTs are visible to the next read
+BEGIN;
+INSERT INTO dist_table VALUES (1, 'one');
+INSERT INTO dist_table VALUES (2, 'two');
+INSERT INTO dist_table VALUES (3, 'three'), (4, 'four');
+SELECT a, b FROM dist_table ORDER BY a;
+INSERT INTO dist_table VALUES (5, 'five');
+COMMIT;
+SELECT count(*) FROM dist_table;
+
+-- buffered INSERTs are discarded on rollback
+BEGIN;
+INSERT INTO dist_table VALUES (6, 'six');
+INSERT INTO dist_table VALUES (7, 'seven');
+ROLLBACK;
+SELECT count(*) FROM dist_table;
+
+-- prepared statements
+PREPARE insert_row(int, text) AS INSERT INTO dist_table VALUES ($1, $2);
+BEGIN;
+EXECUTE insert_row(6, 'six');
+EXECUTE insert_row(7, 'seven');
+EXECUTE insert_row(8, 'eight');
+EXECUTE insert_row(9, 'nine');
+EXECUTE insert_row(10, 'ten');
+EXECUTE insert_row(11, 'eleven');
+EXECUTE insert_row(12, 'twelve');
+SELECT a, b FROM dist_table WHERE a > 5 ORDER BY a;
+COMMIT;
+
+-- modifications observe the buffered rows
+BEGIN;
+INSERT INTO dist_table VALUES (13, 'thirteen');
+UPDATE dist_table SET b = upper(b) WHERE a = 13;
+INSERT INTO dist_table VALUES (14, 'fourteen');
+DELETE FROM dist_table WHERE a = 14;
+COMMIT;
+SELECT a, b FROM dist_table WHERE a > 12 ORDER BY a;
+
+-- the buffer is sent before savepoints, rows before the savepoint survive
+BEGIN;
+INSERT INTO dist_table VALUES (15, 'fifteen');
+SAVEPOINT s1;
+INSERT INTO dist_table VALUES (16, 'sixteen');
+ROLLBACK TO SAVEPOINT s1;
+INSERT INTO dist_table VALUES (17, 'seventeen');
+COMMIT;
+SELECT a, b FROM dist_table WHERE a > 14 ORDER BY a;
+
+\set VERBOSITY terse
+
+-- errors are reported by the statement that sends the buffer
+BEGIN;
+INSERT INTO single_shard_table VALUES (1, 'one');
+INSERT INTO single_shard_table VALUES (1, 'again');
+SELECT count(*) FROM single_shard_table;
+ROLLBACK;
+
+-- or by the COMMIT
+BEGIN;
+INSERT INTO single_shard_table VALUES (1, 'one');
+INSERT INTO single_shard_table VALUES (1, 'again');
+COMMIT;
+SELECT count(*) FROM single_shard_table;
+
+-- the buffer is sent when it holds citus.max_buffered_insert_rows rows
+SET citus.max_buffered_insert_rows TO 2;
+BEGIN;
+INSERT INTO single_shard_table VALUES (2, 'two');
+INSERT INTO single_shard_table VALUES (2, 'again');
+ROLLBACK;
+
+-- INSERTs outside of transaction blocks are not buffered
+INSERT INTO single_shard_table VALUES (3, 'three');
+INSERT INTO single_shard_table VALUES (3, 'again');
+
+\set VERBOSITY default
+
+SELECT a, b FROM single_shard_table ORDER BY a;
+
+-- the buffer is sent before the role changes, because the placement connections
+-- are opened for the current user and the reader may not insert rows
+CREATE ROLE buffered_insert_reader;
+GRANT USAGE ON SCHEMA buffered_insert TO buffered_insert_reader;
+GRANT SELECT ON dist_table TO buffered_insert_reader;
+SET citus.max_buffered_insert_rows TO 100;
+BEGIN;
+INSERT INTO dist_table VALUES (18, 'eighteen');
+SET ROLE buffered_insert_reader;
+COMMIT;
+RESET ROLE;
+BEGIN;
+INSERT INTO dist_table VALUES (19, 'nineteen');
+SET SESSION AUTHORIZATION buffered_insert_reader;
+COMMIT;
+SELECT current_user, a, b FROM dist_table WHERE a > 17 ORDER BY a;
+RESET SESSION AUTHORIZATION;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA buffered_insert CASCADE;
+DROP ROLE buffered_insert_reader;
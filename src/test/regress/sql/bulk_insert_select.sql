@@ -0,0 +1,60 @@
+--
+-- bulk_insert_select.sql
+--
+-- Test co-located INSERT ... SELECT where the shards bulk insert the rows
+-- of the SELECT.
+--
+
+CREATE SCHEMA bulk_insert_select;
+SET search_path TO bulk_insert_select;
+SET citus.next_shard_id TO 1941000;
+SET citus.shard_count TO 1;
+SET citus.shard_replication_factor TO 1;
+\set VERBOSITY terse
+
+CREATE TABLE source_table (a int, b int, c text);
+SELECT create_distributed_table('source_table', 'a');
+INSERT INTO source_table SELECT s, s % 100, 'row ' || s FROM generate_series(1, 10000) s;
+
+CREATE TABLE target_table (a int primary key, b int CHECK (b >= 0), c text);
+SELECT create_distributed_table('target_table', 'a', colocate_with => 'source_table');
+
+SET citus.propagate_set_commands TO 'local';
+
+BEGIN;
+SET LOCAL citus.enable_bulk_insert_select TO on;
+INSERT INTO target_table SELECT * FROM source_table;
+COMMIT;
+
+SELECT count(*), sum(a), sum(b), count(DISTINCT c) FROM target_table;
+SELECT count(*) FROM (SELECT * FROM target_table EXCEPT SELECT * FROM source_table) diff;
+
+-- the indexes and constraints of the shard are still enforced
+BEGIN;
+SET LOCAL citus.enable_bulk_insert_select TO on;
+INSERT INTO target_table SELECT * FROM source_table WHERE a > 9000;
+ROLLBACK;
+
+BEGIN;
+SET LOCAL citus.enable_bulk_insert_select TO on;
+INSERT INTO target_table SELECT a + 10000, -b, c FROM source_table WHERE a = 1;
+ROLLBACK;
+
+SELECT count(*) FROM target_table;
+
+-- the shard plans use the bulk insert scan only when enabled
+SELECT nodeport AS shard_port FROM pg_dist_shard_placement WHERE shardid = 1941001 \gset
+\c - - - :shard_port
+SET search_path TO bulk_insert_select;
+
+EXPLAIN (COSTS OFF) INSERT INTO target_table_1941001 SELECT * FROM source_table_1941000;
+
+SET citus.enable_bulk_insert_select TO on;
+EXPLAIN (COSTS OFF) INSERT INTO target_table_1941001 SELECT * FROM source_table_1941000;
+
+-- RETURNING still goes through the regular insert
+EXPLAIN (COSTS OFF) INSERT INTO target_table_1941001 SELECT * FROM source_table_1941000 RETURNING a;
+
+\c - - - :master_port
+SET client_min_messages TO WARNING;
+DROP SCHEMA bulk_insert_select CASCADE;
@@ -169,6 +169,34 @@ RESET ROLE;
 REVOKE USAGE ON SCHEMA citus_schema_move FROM regularuser;
 DROP ROLE regularuser, tenantuser;
 
+-- move many small schemas together
+CREATE SCHEMA s3;
+CREATE TABLE s3.t1 (a int PRIMARY KEY);
+INSERT INTO s3.t1 SELECT i FROM generate_series(1, 10) i;
+CREATE SCHEMA s4;
+CREATE TABLE s4.t1 (a int PRIMARY KEY);
+CREATE TABLE s4.t2 (a int PRIMARY KEY REFERENCES s4.t1 (a));
+INSERT INTO s4.t1 SELECT i FROM generate_series(1, 20) i;
+INSERT INTO s4.t2 SELECT i FROM generate_series(1, 20) i;
+
+-- schemas that are already on the target node are skipped
+SELECT citus_schema_move_batch(ARRAY['s3']::regnamespace[], 'localhost', :worker_1_port, 'block_writes');
+SELECT citus_schema_move_batch(ARRAY['s4']::regnamespace[], 'localhost', :worker_1_port, 'block_writes');
+SELECT citus_schema_move_batch(ARRAY['s3', 's4']::regnamespace[], 'localhost', :worker_1_port);
+
+SELECT citus_schema_move_batch(ARRAY['s3', 's4']::regnamespace[], 'localhost', :worker_2_port, 'force_logical');
+SELECT DISTINCT nodeport = :worker_2_port FROM citus_shards WHERE starts_with(table_name::text, 's3.') OR starts_with(table_name::text, 's4.');
+SELECT count(*) FROM s3.t1;
+SELECT count(*) FROM s4.t1 JOIN s4.t2 USING (a);
+
+-- schemas on different nodes cannot be moved together
+SELECT citus_schema_move_batch(ARRAY['s3']::regnamespace[], 'localhost', :worker_1_port, 'block_writes');
+SELECT citus_schema_move_batch(ARRAY['s3', 's4']::regnamespace[], 'localhost', :master_port);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA s3, s4 CASCADE;
+SET client_min_messages TO NOTICE;
+
 RESET citus.enable_schema_based_sharding;
 
 SET client_min_messages TO WARNING;
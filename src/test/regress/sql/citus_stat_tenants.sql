@@ -56,6 +56,16 @@ SELECT count(*)>=0 FROM dist_tbl JOIN dist_tbl_2 ON dist_tbl.a = dist_tbl_2.a WH
 
 SELECT tenant_attribute, query_count_in_this_period FROM citus_stat_tenants(true) WHERE tenant_attribute = '1';
 
+-- buffer usage and returned rows are tracked per tenant
+SELECT citus_stat_tenants_reset();
+SELECT b FROM dist_tbl WHERE a = 1;
+UPDATE dist_tbl SET b = b WHERE a = 1;
+
+SELECT tenant_attribute, rows_returned_in_this_period,
+    (buffer_hits_in_this_period + buffer_reads_in_this_period > 0) AS buffers_are_used_in_this_period
+FROM citus_stat_tenants(true)
+ORDER BY tenant_attribute;
+
 -- test scoring
 -- all of these distribution column values are from second worker
 SELECT nodeid AS worker_2_nodeid FROM pg_dist_node WHERE nodeport = :worker_2_port \gset
@@ -115,6 +125,21 @@ SELECT tenant_attribute, read_count_in_this_period, read_count_in_last_period, q
 FROM citus_stat_tenants_local
 ORDER BY tenant_attribute;
 
+-- statistics batched by a backend show up in its own citus_stat_tenants_local
+SET citus.stat_tenants_flush_interval TO '1h';
+SELECT citus_stat_tenants_reset();
+SELECT sleep_until_next_period();
+
+SELECT count(*)>=0 FROM dist_tbl WHERE a = 1;
+SELECT count(*)>=0 FROM dist_tbl WHERE a = 1;
+INSERT INTO dist_tbl VALUES (5, 'abcd');
+
+SELECT tenant_attribute, read_count_in_this_period, query_count_in_this_period
+FROM citus_stat_tenants_local
+ORDER BY tenant_attribute;
+
+RESET citus.stat_tenants_flush_interval;
+
 \c - - - :master_port
 SET search_path TO citus_stat_tenants;
 
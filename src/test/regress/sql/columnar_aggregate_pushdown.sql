@@ -0,0 +1,79 @@
+--
+-- columnar_aggregate_pushdown.sql
+--
+-- Test computing count(*), min() and max() aggregates from the chunk group
+-- statistics when columnar.enable_aggregate_pushdown is enabled.
+--
+
+CREATE SCHEMA columnar_aggregate_pushdown;
+SET search_path TO columnar_aggregate_pushdown;
+
+CREATE FUNCTION aggregate_scan_counters(query text) RETURNS text AS $$
+DECLARE
+  line text;
+  counters text[] := '{}';
+BEGIN
+  FOR line IN EXECUTE 'EXPLAIN (analyze on, costs off, timing off, summary off) ' || query LOOP
+    IF line LIKE '%Columnar Chunk Groups%' THEN
+      counters := counters || split_part(line, ': ', 2);
+    END IF;
+  END LOOP;
+  RETURN array_to_string(counters, ' ');
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TABLE agg_pushdown(id int NOT NULL, v int, s text) USING columnar;
+ALTER TABLE agg_pushdown SET (columnar.chunk_group_row_limit = 1000);
+INSERT INTO agg_pushdown
+  SELECT i, CASE WHEN i % 10 = 0 THEN NULL ELSE i % 500 END, 'x' || (i % 100)
+  FROM generate_series(1, 10000) i;
+
+-- disabled by default
+EXPLAIN (costs off) SELECT count(*), min(id), max(id) FROM agg_pushdown;
+
+SELECT count(*), min(id), max(id), min(v), max(v), min(s), max(s) FROM agg_pushdown;
+SELECT count(*), min(id), max(id), min(v), max(v) FROM agg_pushdown WHERE id > 2500;
+SELECT count(*), min(id), max(id) FROM agg_pushdown WHERE v < 10;
+
+SET columnar.enable_aggregate_pushdown TO on;
+
+EXPLAIN (costs off) SELECT count(*), min(id), max(id) FROM agg_pushdown;
+EXPLAIN (costs off) SELECT count(*), min(v) FROM agg_pushdown WHERE id > 2500;
+
+-- all chunk groups are answered by metadata
+SELECT count(*), min(id), max(id), min(v), max(v), min(s), max(s) FROM agg_pushdown;
+SELECT aggregate_scan_counters('SELECT count(*), min(id), max(id), min(v), max(v) FROM agg_pushdown');
+
+-- chunk groups that are refuted are skipped, and only the chunk group that
+-- partially matches the qual is read
+SELECT count(*), min(id), max(id), min(v), max(v) FROM agg_pushdown WHERE id > 2500;
+SELECT aggregate_scan_counters('SELECT count(*), min(id), max(id), min(v), max(v) FROM agg_pushdown WHERE id > 2500');
+
+-- chunk groups cannot be answered by metadata when the qual references nullable columns
+SELECT count(*), min(id), max(id) FROM agg_pushdown WHERE v < 10;
+SELECT aggregate_scan_counters('SELECT count(*), min(id), max(id) FROM agg_pushdown WHERE v < 10');
+
+-- expressions on top of the aggregates
+SELECT max(id) - min(id) AS id_range, count(*) + 1 FROM agg_pushdown WHERE id <= 5000;
+
+-- no rows
+SELECT count(*), min(id), max(v) FROM agg_pushdown WHERE id > 20000;
+
+-- columns added after writing the stripes are read
+ALTER TABLE agg_pushdown ADD COLUMN w int DEFAULT 7;
+SELECT count(*), min(w), max(w) FROM agg_pushdown;
+SELECT aggregate_scan_counters('SELECT count(*), min(w), max(w) FROM agg_pushdown');
+
+-- not supported aggregates and queries use a regular aggregate
+EXPLAIN (costs off) SELECT sum(id) FROM agg_pushdown;
+EXPLAIN (costs off) SELECT count(v) FROM agg_pushdown;
+EXPLAIN (costs off) SELECT min(id) FROM agg_pushdown GROUP BY v;
+
+SET columnar.enable_custom_scan TO off;
+EXPLAIN (costs off) SELECT count(*) FROM agg_pushdown;
+RESET columnar.enable_custom_scan;
+
+RESET columnar.enable_aggregate_pushdown;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_aggregate_pushdown CASCADE;
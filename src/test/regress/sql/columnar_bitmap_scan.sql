@@ -0,0 +1,58 @@
+--
+-- columnar_bitmap_scan.sql
+--
+-- Test bitmap heap scans on columnar tables.
+--
+
+CREATE SCHEMA columnar_bitmap_scan;
+SET search_path TO columnar_bitmap_scan;
+
+CREATE FUNCTION columnar_scan_node(query text) RETURNS text AS
+$$
+    DECLARE
+        result jsonb;
+    BEGIN
+        EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO result;
+        RETURN result->0->'Plan'->>'Node Type';
+    END;
+$$ LANGUAGE PLPGSQL;
+
+CREATE TABLE bitmap_test(a int, b int) USING columnar
+WITH (columnar.stripe_row_limit = 2000, columnar.chunk_group_row_limit = 1000);
+
+-- make sure that autovacuum doesn't add to the statistics
+ALTER TABLE bitmap_test SET (autovacuum_enabled = false);
+
+-- three stripes, each with two chunk groups
+INSERT INTO bitmap_test SELECT i, i % 10 FROM generate_series(1, 6000) i;
+CREATE INDEX bitmap_test_a_idx ON bitmap_test (a);
+CREATE INDEX bitmap_test_b_idx ON bitmap_test (b);
+
+BEGIN;
+SET LOCAL enable_seqscan TO off;
+SET LOCAL enable_indexscan TO off;
+SET LOCAL columnar.enable_custom_scan TO off;
+
+SELECT columnar_scan_node('SELECT a FROM bitmap_test WHERE b = 3');
+
+SELECT columnar.stat_scans_reset();
+
+-- the matching rows are spread over all the stripes, but each stripe and
+-- chunk group is read only once
+SELECT count(*), sum(a) FROM bitmap_test WHERE b = 3;
+
+SELECT scans, stripes_read, chunk_groups_read
+FROM columnar.stat_scans WHERE relation = 'bitmap_test'::regclass;
+
+SELECT count(*), sum(a) FROM bitmap_test WHERE a BETWEEN 1990 AND 2010;
+SELECT count(*), sum(a) FROM bitmap_test WHERE a < 10 OR a > 5990;
+SELECT count(*), sum(a) FROM bitmap_test WHERE a > 1000 AND b = 0;
+
+-- deleted rows are not returned
+DELETE FROM bitmap_test WHERE a BETWEEN 1995 AND 2005;
+SELECT count(*), sum(a) FROM bitmap_test WHERE a BETWEEN 1990 AND 2010;
+
+ROLLBACK;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_bitmap_scan CASCADE;
@@ -0,0 +1,65 @@
+--
+-- columnar_bloom_filter.sql
+--
+-- Test chunk group filtering using the bloom filters that are built when
+-- columnar.enable_bloom_filter is enabled.
+--
+
+CREATE SCHEMA columnar_bloom_filter;
+SET search_path TO columnar_bloom_filter;
+
+CREATE FUNCTION chunk_groups_removed(query text) RETURNS int AS $$
+DECLARE
+  line text;
+BEGIN
+  FOR line IN EXECUTE 'EXPLAIN (analyze on, costs off, timing off, summary off) ' || query LOOP
+    IF line LIKE '%Chunk Groups Removed by Filter:%' THEN
+      RETURN split_part(line, ': ', 2)::int;
+    END IF;
+  END LOOP;
+  RETURN 0;
+END;
+$$ LANGUAGE plpgsql;
+
+-- values are spread over all chunk groups, so min/max filtering doesn't help
+CREATE TABLE with_bloom(id int, v int, t text) USING columnar;
+ALTER TABLE with_bloom SET (columnar.chunk_group_row_limit = 1000);
+CREATE TABLE without_bloom(LIKE with_bloom) USING columnar;
+ALTER TABLE without_bloom SET (columnar.chunk_group_row_limit = 1000);
+
+SET columnar.enable_bloom_filter TO on;
+INSERT INTO with_bloom
+  SELECT i, i * 37 % 10000, 'value-' || (i * 37 % 10000) FROM generate_series(0, 9999) i;
+RESET columnar.enable_bloom_filter;
+INSERT INTO without_bloom SELECT * FROM with_bloom;
+
+SELECT attr_num, count(*) FILTER (WHERE value_bloom_filter IS NOT NULL) AS with_filter, count(*)
+FROM columnar_internal.chunk chunk, columnar.storage storage
+WHERE chunk.storage_id = storage.storage_id AND storage.relation = 'with_bloom'::regclass
+GROUP BY attr_num ORDER BY attr_num;
+
+SELECT count(*) FROM columnar_internal.chunk chunk, columnar.storage storage
+WHERE chunk.storage_id = storage.storage_id AND storage.relation = 'without_bloom'::regclass
+  AND value_bloom_filter IS NOT NULL;
+
+SELECT id FROM with_bloom WHERE v = 1234;
+SELECT id FROM with_bloom WHERE 1234 = v;
+SELECT id FROM with_bloom WHERE t = 'value-42';
+SELECT id FROM with_bloom WHERE v = 1234::bigint;
+SELECT id FROM with_bloom WHERE v IN (1, 2, 3, 10001) ORDER BY id;
+SELECT id FROM with_bloom WHERE v = ANY('{5,NULL}'::int[]);
+SELECT count(*) FROM with_bloom WHERE v = 20000;
+
+-- all chunk groups but the one containing the value should be skipped,
+-- allowing a few false positives
+SELECT chunk_groups_removed('SELECT * FROM with_bloom WHERE v = 1234') >= 7;
+SELECT chunk_groups_removed('SELECT * FROM with_bloom WHERE t = ''value-42''') >= 7;
+SELECT chunk_groups_removed('SELECT * FROM with_bloom WHERE v IN (1, 2, 3)') >= 5;
+SELECT chunk_groups_removed('SELECT * FROM without_bloom WHERE v = 1234');
+
+-- rows written without bloom filters are still found
+INSERT INTO with_bloom VALUES (10000, 1234, 'value-1234');
+SELECT id FROM with_bloom WHERE v = 1234 ORDER BY id;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_bloom_filter CASCADE;
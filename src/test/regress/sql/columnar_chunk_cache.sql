@@ -0,0 +1,54 @@
+--
+-- columnar_chunk_cache.sql
+--
+-- Test the shared cache of decompressed column chunks, which the test
+-- suite enables by setting columnar.chunk_cache_size. Other tests might be
+-- using the cache concurrently, so we only check how the counters change.
+--
+
+CREATE SCHEMA columnar_chunk_cache;
+SET search_path TO columnar_chunk_cache;
+
+SELECT cache_size > 0 AS cache_enabled, used_size <= cache_size AS fits
+FROM columnar.chunk_cache_stats;
+
+CREATE TABLE cached(a int, b text) USING columnar;
+ALTER TABLE cached SET (columnar.compression = pglz);
+INSERT INTO cached SELECT i % 10, 'value-' || (i % 100) FROM generate_series(1, 20000) i;
+
+-- first scan decompresses the chunks and caches them
+CREATE TABLE stats_before AS SELECT * FROM columnar.chunk_cache_stats;
+SELECT count(*), sum(a), count(DISTINCT b) FROM cached;
+SELECT s.misses - b.misses >= 4 AS missed, s.chunk_count > 0 AS cached
+FROM columnar.chunk_cache_stats s, stats_before b;
+DROP TABLE stats_before;
+
+-- second scan uses the cached chunks
+CREATE TABLE stats_before AS SELECT * FROM columnar.chunk_cache_stats;
+SELECT count(*), sum(a), count(DISTINCT b) FROM cached;
+SELECT s.hits - b.hits >= 4 AS hit FROM columnar.chunk_cache_stats s, stats_before b;
+DROP TABLE stats_before;
+
+-- chunk groups and columns are cached separately
+SELECT sum(a) FROM cached WHERE a > 5;
+SELECT count(DISTINCT b) FROM cached;
+
+-- uncompressed chunks are not cached
+CREATE TABLE not_compressed(a int) USING columnar;
+ALTER TABLE not_compressed SET (columnar.compression = none);
+INSERT INTO not_compressed SELECT i % 10 FROM generate_series(1, 20000) i;
+SELECT count(*), sum(a) FROM not_compressed;
+SELECT count(*), sum(a) FROM not_compressed;
+
+-- truncating the storage during VACUUM invalidates the cached chunks
+BEGIN;
+INSERT INTO cached SELECT i % 10, 'value-' || i FROM generate_series(1, 20000) i;
+ROLLBACK;
+VACUUM cached;
+CREATE TABLE stats_before AS SELECT * FROM columnar.chunk_cache_stats;
+SELECT count(*), sum(a), count(DISTINCT b) FROM cached;
+SELECT s.misses - b.misses >= 4 AS missed FROM columnar.chunk_cache_stats s, stats_before b;
+DROP TABLE stats_before;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_chunk_cache CASCADE;
@@ -0,0 +1,51 @@
+--
+-- columnar_chunk_encoding.sql
+--
+-- Test dictionary and run-length encoding of column chunks, enabled by
+-- columnar.enable_chunk_encoding.
+--
+
+CREATE SCHEMA columnar_chunk_encoding;
+SET search_path TO columnar_chunk_encoding;
+
+CREATE TABLE encoded(id int, status text, grp int) USING columnar;
+ALTER TABLE encoded SET (columnar.chunk_group_row_limit = 1000);
+
+SET columnar.enable_chunk_encoding TO on;
+INSERT INTO encoded
+  SELECT i, CASE WHEN i % 10 = 0 THEN NULL ELSE (ARRAY['new','active','closed'])[i % 3 + 1] END, i / 500
+  FROM generate_series(1, 3000) i;
+RESET columnar.enable_chunk_encoding;
+
+-- distinct values are not encoded, low cardinality values are dictionary
+-- encoded and long runs of same value are run-length encoded
+SELECT attr_num, value_encoding, count(*)
+FROM columnar_internal.chunk chunk, columnar.storage storage
+WHERE chunk.storage_id = storage.storage_id AND storage.relation = 'encoded'::regclass
+GROUP BY attr_num, value_encoding ORDER BY attr_num;
+
+SELECT status, count(*) FROM encoded GROUP BY status ORDER BY status;
+SELECT sum(grp), min(grp), max(grp) FROM encoded;
+SELECT count(*) FROM encoded WHERE grp = 3;
+SELECT sum(id) FROM encoded WHERE status = 'closed' AND grp >= 4;
+
+-- evaluate quals on dictionary entries
+SET columnar.enable_vectorized_filter TO on;
+SELECT count(*) FROM encoded WHERE status = 'active';
+SELECT sum(id) FROM encoded WHERE status = 'closed' AND grp >= 4;
+RESET columnar.enable_vectorized_filter;
+
+-- rows written without encoding are still readable
+INSERT INTO encoded SELECT i, 'new', 7 FROM generate_series(3001, 3010) i;
+SELECT status, count(*) FROM encoded WHERE grp = 7 GROUP BY status;
+
+-- index scans read single rows of encoded chunks
+CREATE INDEX encoded_id_idx ON encoded (id);
+SET enable_seqscan TO off;
+SET columnar.enable_custom_scan TO off;
+SELECT * FROM encoded WHERE id IN (10, 11, 1501, 3005) ORDER BY id;
+RESET enable_seqscan;
+RESET columnar.enable_custom_scan;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_chunk_encoding CASCADE;
@@ -0,0 +1,81 @@
+--
+-- columnar_column_options.sql
+--
+-- Test compression options of columns and the "auto" compression type.
+--
+
+CREATE SCHEMA columnar_column_options;
+SET search_path TO columnar_column_options;
+
+CREATE TABLE per_column(a int, b text, c text) USING columnar;
+ALTER TABLE per_column SET (columnar.compression = none, columnar.compression_level = 3);
+ALTER TABLE per_column ALTER COLUMN b SET (columnar.compression = pglz);
+ALTER TABLE per_column ALTER COLUMN c SET (columnar.compression = pglz, columnar.compression_level = 5);
+
+-- only compression options can be set for a column
+ALTER TABLE per_column ALTER COLUMN a SET (columnar.stripe_row_limit = 1000);
+ALTER TABLE per_column ALTER COLUMN a SET (columnar.compression = foo);
+ALTER TABLE per_column ALTER COLUMN a SET (columnar.compression_level = 100);
+ALTER TABLE per_column ALTER COLUMN a SET (compression = pglz);
+ALTER TABLE per_column ALTER COLUMN d SET (columnar.compression = pglz);
+
+SELECT relation, column_name, compression, compression_level
+FROM columnar.column_options WHERE relation = 'per_column'::regclass
+ORDER BY column_name;
+
+INSERT INTO per_column SELECT i, repeat('b', 100), repeat('c', 100) FROM generate_series(1, 1000) i;
+
+-- columns use their own compression options, or the ones of the table
+SELECT DISTINCT attr_num, value_compression_type, value_compression_level
+FROM columnar_internal.chunk chunk, columnar.storage storage
+WHERE chunk.storage_id = storage.storage_id AND storage.relation = 'per_column'::regclass
+ORDER BY attr_num;
+
+-- reset options take effect for the newly inserted data
+ALTER TABLE per_column ALTER COLUMN b RESET (columnar.compression);
+ALTER TABLE per_column ALTER COLUMN c RESET (columnar.compression_level);
+
+SELECT relation, column_name, compression, compression_level
+FROM columnar.column_options WHERE relation = 'per_column'::regclass
+ORDER BY column_name;
+
+-- options of the columns are kept when the table is rewritten
+VACUUM FULL per_column;
+
+SELECT DISTINCT attr_num, value_compression_type, value_compression_level
+FROM columnar_internal.chunk chunk, columnar.storage storage
+WHERE chunk.storage_id = storage.storage_id AND storage.relation = 'per_column'::regclass
+ORDER BY attr_num;
+
+SELECT count(*), sum(a), count(DISTINCT b), count(DISTINCT c) FROM per_column;
+
+-- options of dropped columns are not shown
+ALTER TABLE per_column DROP COLUMN c;
+
+SELECT relation, column_name, compression, compression_level
+FROM columnar.column_options WHERE relation = 'per_column'::regclass
+ORDER BY column_name;
+
+-- "auto" picks a compression type for each chunk, and never stores "auto"
+CREATE TABLE auto_compressed(a int, b text) USING columnar;
+ALTER TABLE auto_compressed SET (columnar.compression = auto);
+
+SELECT compression FROM columnar.options WHERE relation = 'auto_compressed'::regclass;
+
+INSERT INTO auto_compressed SELECT i, repeat('x', 200) FROM generate_series(1, 5000) i;
+
+-- the repetitive text column always compresses well
+SELECT count(*) FILTER (WHERE value_compression_type = 4) AS auto_chunks,
+       count(*) FILTER (WHERE attr_num = 2 AND value_compression_type = 0) AS uncompressed_text_chunks
+FROM columnar_internal.chunk chunk, columnar.storage storage
+WHERE chunk.storage_id = storage.storage_id AND storage.relation = 'auto_compressed'::regclass;
+
+SELECT count(*), sum(a), min(b) = repeat('x', 200) FROM auto_compressed;
+
+-- a column can use "auto" while the table uses another compression type
+ALTER TABLE per_column ALTER COLUMN b SET (columnar.compression = auto);
+INSERT INTO per_column SELECT i, repeat('b', 100) FROM generate_series(1, 1000) i;
+SELECT count(*), sum(a) FROM per_column WHERE b = repeat('b', 100);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_column_options CASCADE;
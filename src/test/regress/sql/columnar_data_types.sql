@@ -82,3 +82,29 @@ CREATE TABLE test_json(j json) USING columnar;
 INSERT INTO test_json SELECT ('{"att": ' || g::text || '}')::json from generate_series(1,1000000) g;
 SELECT * FROM test_json WHERE (j->'att')::text::int8 > 999990;
 DROP TABLE test_json;
+
+-- Test fixed-width values with and without nulls, including a chunk group
+-- whose row count is not a multiple of 8
+CREATE VIEW fixed_width_values AS
+SELECT i AS a,
+       CASE WHEN i % 3 <> 0 THEN i * 1000000000::int8 END AS b,
+       CASE WHEN i > 1000 THEN i / 7.0::float8 END AS c,
+       CASE WHEN i % 8 <> 5 THEN '2000-01-01'::timestamp + i * interval '1 minute' END AS d,
+       (i % 1000)::int2 AS e,
+       CASE WHEN i % 5 <> 0 THEN i % 2 = 0 END AS f,
+       CASE WHEN i % 11 <> 0 THEN chr(65 + i % 26)::"char" END AS g,
+       CASE WHEN i % 2 = 0 THEN i::float4 END AS h
+FROM generate_series(1, 2503) i;
+
+CREATE TABLE test_fixed_width USING columnar
+WITH (columnar.chunk_group_row_limit = 1000)
+AS SELECT * FROM fixed_width_values;
+
+SELECT count(*) FROM test_fixed_width;
+SELECT count(*) FROM (SELECT * FROM test_fixed_width EXCEPT ALL
+                      SELECT * FROM fixed_width_values) differences;
+SELECT count(b), count(c), count(d), count(f), count(g), count(h)
+FROM test_fixed_width;
+
+DROP TABLE test_fixed_width;
+DROP VIEW fixed_width_values;
@@ -86,5 +86,17 @@ SELECT
 
 SELECT count(*) FROM t;
 
+-- the buffers of a stripe are flushed before reaching the stripe row limit
+-- if they exceed columnar.stripe_memory_limit
+CREATE TABLE wide_rows (a int, b text) USING columnar
+WITH (columnar.compression = none);
+SET columnar.stripe_memory_limit TO '1MB';
+INSERT INTO wide_rows SELECT i, repeat(md5(i::text), 300) FROM generate_series(1, 1000) i;
+RESET columnar.stripe_memory_limit;
+
+SELECT count(*) > 1 AS flushed_early, max(row_count) < 1000 AS below_row_limit
+FROM columnar.stripe WHERE storage_id = columnar.get_storage_id('wide_rows');
+SELECT count(*), sum(a), sum(length(b)) FROM wide_rows;
+
 SET client_min_messages TO WARNING;
 DROP SCHEMA columnar_memory CASCADE;
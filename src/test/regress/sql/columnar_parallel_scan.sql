@@ -0,0 +1,45 @@
+--
+-- columnar_parallel_scan.sql
+--
+-- Test columnar.enable_parallel_scan = true, where the participants of
+-- a parallel ColumnarScan claim the stripes to read from the shared
+-- state of the scan.
+--
+
+create table parallel_scan(i int) using columnar;
+-- have many stripes so that each participant can claim some
+ALTER TABLE parallel_scan SET (columnar.stripe_row_limit = 10000);
+insert into parallel_scan select generate_series(1,150000);
+vacuum analyze parallel_scan;
+
+set columnar.enable_parallel_scan to on;
+set min_parallel_table_scan_size = 1;
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set max_parallel_workers = 4;
+set max_parallel_workers_per_gather = 2;
+
+explain (costs off) select count(*), min(i), max(i), avg(i) from parallel_scan;
+select count(*), min(i), max(i), avg(i) from parallel_scan;
+select count(*), min(i), max(i) from parallel_scan where i > 140000;
+
+-- rescan the parallel scan
+select count(*) from generate_series(1,3) s, lateral
+  (select count(*) c from parallel_scan where i > s.s * 50000) q where q.c > 0;
+
+-- we don't plan parallel scans when there are pending writes
+begin;
+  insert into parallel_scan select generate_series(150001,160000);
+  explain (costs off) select count(*), min(i), max(i) from parallel_scan;
+  select count(*), min(i), max(i) from parallel_scan;
+commit;
+select count(*), min(i), max(i) from parallel_scan;
+
+set columnar.enable_parallel_scan to default;
+set min_parallel_table_scan_size to default;
+set parallel_setup_cost to default;
+set parallel_tuple_cost to default;
+set max_parallel_workers to default;
+set max_parallel_workers_per_gather to default;
+
+drop table parallel_scan;
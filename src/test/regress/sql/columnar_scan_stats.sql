@@ -0,0 +1,89 @@
+--
+-- columnar_scan_stats.sql
+--
+-- Test the scan statistics shown by EXPLAIN (ANALYZE, BUFFERS) and kept in
+-- columnar.stat_scans.
+--
+
+CREATE SCHEMA columnar_scan_stats;
+SET search_path TO columnar_scan_stats;
+
+CREATE FUNCTION columnar_scan_plan(options text, query text) RETURNS jsonb AS
+$$
+    DECLARE
+        result jsonb;
+    BEGIN
+        EXECUTE 'EXPLAIN (' || options || ', FORMAT JSON) ' || query INTO result;
+        RETURN result->0->'Plan';
+    END;
+$$ LANGUAGE PLPGSQL;
+
+CREATE TABLE stats_test(a int, b text) USING columnar
+WITH (columnar.compression = pglz, columnar.stripe_row_limit = 2000,
+      columnar.chunk_group_row_limit = 1000);
+
+-- make sure that autovacuum doesn't add to the statistics
+ALTER TABLE stats_test SET (autovacuum_enabled = false);
+
+-- three stripes, each with two chunk groups
+INSERT INTO stats_test SELECT i, repeat('x', 100) FROM generate_series(1, 6000) i;
+
+SELECT columnar.stat_scans_reset();
+
+-- only the second chunk group of the last stripe is not refuted
+SELECT a FROM stats_test WHERE a > 5995 ORDER BY a;
+
+SELECT (p->>'Columnar Stripes Read')::int AS stripes_read,
+       (p->>'Columnar Stripes Skipped')::int AS stripes_skipped,
+       (p->>'Columnar Chunk Groups Read')::int AS chunk_groups_read,
+       (p->>'Columnar Chunk Groups Skipped')::int AS chunk_groups_skipped,
+       (p->>'Columnar Bytes Read')::bigint > 0 AS bytes_read,
+       (p->>'Columnar Bytes Decompressed')::bigint > 0 AS bytes_decompressed,
+       p ? 'Columnar Decompression Time' AS decompression_time
+FROM columnar_scan_plan('ANALYZE, BUFFERS',
+                        'SELECT * FROM stats_test WHERE a > 4500') p;
+
+-- the counters are shown only with BUFFERS
+SELECT p ? 'Columnar Stripes Read' AS stripes_read,
+       p ? 'Columnar Bytes Read' AS bytes_read
+FROM columnar_scan_plan('ANALYZE', 'SELECT * FROM stats_test WHERE a > 4500') p;
+
+SELECT relation, scans, stripes_read, stripes_skipped, chunk_groups_read,
+       chunk_groups_skipped, bytes_read > 0 AS bytes_read,
+       bytes_decompressed > 0 AS bytes_decompressed
+FROM columnar.stat_scans WHERE relation = 'stats_test'::regclass;
+
+SELECT columnar.stat_scans_reset();
+
+SELECT count(*) FROM columnar.stat_scans WHERE relation = 'stats_test'::regclass;
+
+-- statistics are removed when the table is dropped
+SELECT a FROM stats_test WHERE a = 1;
+SELECT 'stats_test'::regclass::oid AS stats_test_oid \gset
+DROP TABLE stats_test;
+SELECT count(*) FROM columnar_internal.stat_scans() WHERE relid = :stats_test_oid;
+
+-- index scans that go back and forth between stripes read each of them once
+CREATE TABLE index_fetch_test(a int, b int) USING columnar
+WITH (columnar.stripe_row_limit = 1000, columnar.chunk_group_row_limit = 100);
+ALTER TABLE index_fetch_test SET (autovacuum_enabled = false);
+
+-- consecutive values of b are in different stripes
+INSERT INTO index_fetch_test
+SELECT i, ((i - 1) % 1000) * 3 + (i - 1) / 1000 FROM generate_series(1, 3000) i;
+CREATE INDEX ON index_fetch_test (b);
+
+SELECT columnar.stat_scans_reset();
+
+BEGIN;
+SET LOCAL columnar.enable_custom_scan TO OFF;
+SET LOCAL enable_seqscan TO OFF;
+SET LOCAL enable_bitmapscan TO OFF;
+SELECT count(*), sum(a) FROM index_fetch_test WHERE b < 300;
+COMMIT;
+
+SELECT scans, stripes_read, chunk_groups_read
+FROM columnar.stat_scans WHERE relation = 'index_fetch_test'::regclass;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_scan_stats CASCADE;
@@ -0,0 +1,94 @@
+--
+-- columnar_sort_key.sql
+--
+-- Test sorting the stripes of columnar tables by columnar.sort_key.
+--
+
+CREATE SCHEMA columnar_sort_key;
+SET search_path TO columnar_sort_key;
+
+CREATE FUNCTION chunk_groups_removed(query text) RETURNS bigint AS
+$$
+    DECLARE
+        result bigint;
+        rec text;
+    BEGIN
+        result := 0;
+
+        FOR rec IN EXECUTE 'EXPLAIN ANALYZE ' || query LOOP
+            IF rec ~ '^\s+Columnar Chunk Groups Removed by Filter' then
+                result := regexp_replace(rec, '[^0-9]*', '', 'g');
+            END IF;
+        END LOOP;
+
+        RETURN result;
+    END;
+$$ LANGUAGE PLPGSQL;
+
+CREATE TABLE sorted(id int, category text, doc json) USING columnar
+WITH (columnar.sort_key = 'category, id');
+
+SELECT relation, column_name, sort_key_position
+FROM columnar.column_options WHERE relation = 'sorted'::regclass
+ORDER BY sort_key_position;
+
+-- should fail
+ALTER TABLE sorted SET (columnar.sort_key = 'no_such_column');
+ALTER TABLE sorted SET (columnar.sort_key = 'id, id');
+ALTER TABLE sorted SET (columnar.sort_key = 'id,');
+ALTER TABLE sorted SET (columnar.sort_key = 'doc');
+ALTER TABLE sorted ALTER COLUMN id SET (columnar.sort_key = 'id');
+
+ALTER TABLE sorted SET (columnar.sort_key = 'id', columnar.stripe_row_limit = 2000,
+                        columnar.chunk_group_row_limit = 1000);
+
+SELECT relation, column_name, sort_key_position
+FROM columnar.column_options WHERE relation = 'sorted'::regclass
+ORDER BY sort_key_position;
+
+CREATE TABLE unsorted(id int, category text, doc json) USING columnar
+WITH (columnar.stripe_row_limit = 2000, columnar.chunk_group_row_limit = 1000);
+
+-- a permutation of 1..4000, written into two stripes of each table
+INSERT INTO sorted SELECT (i * 7919) % 4000 + 1, 'c' || i % 4 FROM generate_series(1, 4000) i;
+INSERT INTO unsorted SELECT (i * 7919) % 4000 + 1, 'c' || i % 4 FROM generate_series(1, 4000) i;
+
+-- rows of each stripe are sorted
+SELECT id FROM sorted LIMIT 5;
+SELECT id FROM unsorted LIMIT 5;
+SELECT count(*), sum(id) FROM sorted;
+
+SELECT chunk_groups_removed('SELECT id FROM sorted WHERE id <= 1000');
+SELECT chunk_groups_removed('SELECT id FROM unsorted WHERE id <= 1000');
+
+-- VACUUM FULL sorts all rows of the table, so the stripes are ordered too
+VACUUM FULL sorted;
+
+SELECT chunk_groups_removed('SELECT id FROM sorted WHERE id <= 1000');
+SELECT count(*), sum(id) FROM sorted;
+
+-- rows written in the same transaction are sorted before being read
+BEGIN;
+INSERT INTO sorted VALUES (5003), (5001), (5002);
+DELETE FROM sorted WHERE id = 5001;
+SELECT id FROM sorted WHERE id > 5000;
+COMMIT;
+SELECT id FROM sorted WHERE id > 5000;
+
+-- rows aren't sorted when the table has indexes, since these store the
+-- row numbers of the rows
+CREATE TABLE indexed(id int) USING columnar WITH (columnar.sort_key = 'id');
+CREATE INDEX indexed_id_idx ON indexed (id);
+INSERT INTO indexed VALUES (3), (1), (2);
+SELECT id FROM indexed;
+
+-- removing the sort key
+ALTER TABLE sorted RESET (columnar.sort_key);
+
+SELECT count(*) FROM columnar.column_options WHERE relation = 'sorted'::regclass;
+
+INSERT INTO sorted VALUES (6003), (6001), (6002);
+SELECT id FROM sorted WHERE id > 6000;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_sort_key CASCADE;
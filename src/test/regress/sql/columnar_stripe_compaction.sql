@@ -0,0 +1,58 @@
+CREATE SCHEMA columnar_stripe_compaction;
+SET search_path TO columnar_stripe_compaction;
+
+-- each INSERT creates a separate small stripe
+CREATE TABLE trickle(a int) USING columnar;
+INSERT INTO trickle SELECT generate_series(1, 10);
+INSERT INTO trickle SELECT generate_series(11, 20);
+INSERT INTO trickle VALUES (21);
+INSERT INTO trickle SELECT generate_series(22, 30);
+DELETE FROM trickle WHERE a <= 5;
+
+SELECT stripe_num, row_count FROM columnar.stripe
+WHERE relation = 'trickle'::regclass ORDER BY stripe_num;
+
+-- all rows fit into a single stripe, and the deleted rows are removed
+SELECT columnar.compact_stripes('trickle');
+
+SELECT stripe_num, row_count FROM columnar.stripe
+WHERE relation = 'trickle'::regclass ORDER BY stripe_num;
+SELECT count(*), sum(a) FROM trickle;
+SELECT count(*) FROM columnar_internal.row_mask
+WHERE storage_id = columnar.get_storage_id('trickle');
+
+-- nothing left to merge
+SELECT columnar.compact_stripes('trickle');
+
+-- stripes that are at least half full are not merged and split the runs
+ALTER TABLE trickle SET (columnar.stripe_row_limit = 1000);
+INSERT INTO trickle SELECT generate_series(1, 600);
+INSERT INTO trickle SELECT generate_series(1, 10);
+INSERT INTO trickle SELECT generate_series(1, 10);
+
+SELECT columnar.compact_stripes('trickle');
+
+SELECT stripe_num, row_count FROM columnar.stripe
+WHERE relation = 'trickle'::regclass ORDER BY stripe_num;
+
+-- a run ends before it exceeds stripe_row_limit
+INSERT INTO trickle SELECT generate_series(1, 400);
+INSERT INTO trickle SELECT generate_series(1, 400);
+INSERT INTO trickle SELECT generate_series(1, 400);
+
+SELECT columnar.compact_stripes('trickle');
+
+SELECT stripe_num, row_count FROM columnar.stripe
+WHERE relation = 'trickle'::regclass ORDER BY stripe_num;
+SELECT count(*), sum(a) FROM trickle;
+
+-- should fail, merging stripes would change the row numbers of the rows
+CREATE INDEX trickle_a_idx ON trickle (a);
+SELECT columnar.compact_stripes('trickle');
+
+-- should fail, not a columnar table
+CREATE TABLE heap_table(a int);
+SELECT columnar.compact_stripes('heap_table');
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_stripe_compaction CASCADE;
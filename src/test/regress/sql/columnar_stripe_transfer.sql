@@ -0,0 +1,119 @@
+--
+-- columnar_stripe_transfer.sql
+--
+-- Test exporting the stripes of columnar tables and importing them into other
+-- columnar tables without decompressing them, which shard moves and copies
+-- use for columnar shards.
+--
+
+CREATE SCHEMA columnar_stripe_transfer;
+SET search_path TO columnar_stripe_transfer;
+
+CREATE TABLE source_table(a int, b text, c numeric, d int[]) USING columnar
+WITH (columnar.stripe_row_limit = 2000, columnar.chunk_group_row_limit = 1000);
+
+-- three stripes, the last one with a partial chunk group
+INSERT INTO source_table
+SELECT i, CASE WHEN i % 7 = 0 THEN NULL ELSE 'text ' || (i % 100) END, i / 3.0,
+       ARRAY[i, i + 1]
+FROM generate_series(1, 5500) i;
+
+-- the deleted rows stay deleted in the imported stripes
+DELETE FROM source_table WHERE a % 10 = 0;
+
+CREATE TABLE target_table(a int, b text, c numeric, d int[]) USING columnar;
+
+SELECT sum(columnar_internal.import_stripe('target_table', stripe))
+FROM columnar_internal.export_stripes('source_table') stripe;
+
+SELECT count(*), sum(a), count(b) FROM target_table;
+
+SELECT count(*) AS different_rows FROM (
+  (SELECT * FROM source_table EXCEPT ALL SELECT * FROM target_table)
+  UNION ALL
+  (SELECT * FROM target_table EXCEPT ALL SELECT * FROM source_table)) diff;
+
+-- the stripes and chunks are copied as they are
+SELECT (SELECT array_agg((data_length, column_count, chunk_row_count, row_count,
+                          chunk_group_count) ORDER BY first_row_number)
+        FROM columnar.stripe WHERE relation = 'source_table'::regclass) =
+       (SELECT array_agg((data_length, column_count, chunk_row_count, row_count,
+                          chunk_group_count) ORDER BY first_row_number)
+        FROM columnar.stripe WHERE relation = 'target_table'::regclass)
+       AS same_stripes;
+
+SELECT (SELECT array_agg((attr_num, chunk_group_num, minimum_value, maximum_value,
+                          value_stream_length, exists_stream_length,
+                          value_compression_type, value_count)
+                         ORDER BY stripe_num, attr_num, chunk_group_num)
+        FROM columnar.chunk WHERE relation = 'source_table'::regclass) =
+       (SELECT array_agg((attr_num, chunk_group_num, minimum_value, maximum_value,
+                          value_stream_length, exists_stream_length,
+                          value_compression_type, value_count)
+                         ORDER BY stripe_num, attr_num, chunk_group_num)
+        FROM columnar.chunk WHERE relation = 'target_table'::regclass)
+       AS same_chunks;
+
+-- importing again appends the stripes to the existing ones
+SELECT sum(columnar_internal.import_stripe('target_table', stripe))
+FROM columnar_internal.export_stripes('source_table') stripe;
+
+SELECT count(*), sum(a) FROM target_table;
+SELECT count(*) FROM target_table WHERE a BETWEEN 100 AND 199;
+
+-- the writes of the current transaction are exported too
+CREATE TABLE pending_source(a int) USING columnar;
+CREATE TABLE pending_target(a int) USING columnar;
+
+BEGIN;
+INSERT INTO pending_source SELECT generate_series(1, 100);
+SELECT sum(columnar_internal.import_stripe('pending_target', stripe))
+FROM columnar_internal.export_stripes('pending_source') stripe;
+COMMIT;
+
+SELECT count(*), sum(a) FROM pending_target;
+
+-- empty tables don't have any stripes
+CREATE TABLE empty_table(a int) USING columnar;
+SELECT count(*) FROM columnar_internal.export_stripes('empty_table');
+
+-- tables whose stripes cannot be exported
+CREATE TYPE mood AS ENUM ('sad', 'happy');
+CREATE TABLE enum_table(a int, m mood) USING columnar;
+INSERT INTO enum_table VALUES (1, 'happy');
+SELECT count(*) FROM columnar_internal.export_stripes('enum_table');
+
+CREATE TABLE dropped_column_table(a int, b int) USING columnar;
+INSERT INTO dropped_column_table VALUES (1, 2);
+ALTER TABLE dropped_column_table DROP COLUMN b;
+SELECT count(*) FROM columnar_internal.export_stripes('dropped_column_table');
+
+CREATE TABLE added_column_table(a int) USING columnar;
+INSERT INTO added_column_table VALUES (1);
+ALTER TABLE added_column_table ADD COLUMN b int;
+SELECT count(*) FROM columnar_internal.export_stripes('added_column_table');
+
+CREATE TABLE heap_table(a int);
+SELECT count(*) FROM columnar_internal.export_stripes('heap_table');
+
+-- tables that the stripes cannot be imported into
+CREATE TABLE wrong_columns_table(a int, b text) USING columnar;
+SELECT sum(columnar_internal.import_stripe('wrong_columns_table', stripe))
+FROM columnar_internal.export_stripes('source_table') stripe;
+
+CREATE TABLE wrong_types_table(a int, b text, c numeric, d bigint[]) USING columnar;
+SELECT sum(columnar_internal.import_stripe('wrong_types_table', stripe))
+FROM columnar_internal.export_stripes('source_table') stripe;
+
+CREATE TABLE indexed_table(a int, b text, c numeric, d int[]) USING columnar;
+CREATE INDEX ON indexed_table (a);
+SELECT sum(columnar_internal.import_stripe('indexed_table', stripe))
+FROM columnar_internal.export_stripes('source_table') stripe;
+
+SELECT sum(columnar_internal.import_stripe('heap_table', stripe))
+FROM columnar_internal.export_stripes('pending_source') stripe;
+
+SELECT columnar_internal.import_stripe('pending_target', '\x0102');
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_stripe_transfer CASCADE;
@@ -0,0 +1,80 @@
+--
+-- columnar_tablesample.sql
+--
+-- Test sample scans and ANALYZE on columnar tables, which sample the rows at
+-- chunk group granularity.
+--
+
+CREATE SCHEMA columnar_tablesample;
+SET search_path TO columnar_tablesample;
+
+CREATE TABLE sample_test(a int, b int) USING columnar
+WITH (columnar.stripe_row_limit = 2000, columnar.chunk_group_row_limit = 1000);
+
+-- make sure that autovacuum doesn't add to the statistics
+ALTER TABLE sample_test SET (autovacuum_enabled = false);
+
+-- three stripes, each with two chunk groups
+INSERT INTO sample_test SELECT i, i % 10 FROM generate_series(1, 6000) i;
+
+SELECT count(*), sum(a) FROM sample_test TABLESAMPLE SYSTEM (100);
+SELECT count(*) FROM sample_test TABLESAMPLE SYSTEM (0);
+
+-- SYSTEM returns all or none of the rows of a chunk group
+SELECT count(*) % 1000 AS partial_chunk_group_rows
+FROM sample_test TABLESAMPLE SYSTEM (50) REPEATABLE (0);
+
+SELECT (SELECT array_agg(a ORDER BY a) FROM sample_test TABLESAMPLE SYSTEM (50) REPEATABLE (1)) =
+       (SELECT array_agg(a ORDER BY a) FROM sample_test TABLESAMPLE SYSTEM (50) REPEATABLE (1))
+       AS repeatable;
+
+-- and only reads the chunk groups that it returns the rows of
+SELECT columnar.stat_scans_reset();
+SELECT count(*) FROM sample_test TABLESAMPLE SYSTEM (0);
+SELECT count(*) FROM columnar.stat_scans WHERE relation = 'sample_test'::regclass;
+
+SELECT count(*) AS sampled_rows FROM sample_test TABLESAMPLE SYSTEM (50) REPEATABLE (2) \gset
+SELECT coalesce((SELECT chunk_groups_read FROM columnar.stat_scans
+                 WHERE relation = 'sample_test'::regclass), 0) * 1000 = :sampled_rows
+       AS chunk_groups_read;
+
+-- BERNOULLI samples individual rows
+SELECT count(*), sum(a) FROM sample_test TABLESAMPLE BERNOULLI (100);
+SELECT count(*) FROM sample_test TABLESAMPLE BERNOULLI (0);
+
+SELECT count(*) BETWEEN 2000 AND 4000 AS sampled_half
+FROM sample_test TABLESAMPLE BERNOULLI (50) REPEATABLE (3);
+
+SELECT (SELECT array_agg(a ORDER BY a) FROM sample_test TABLESAMPLE BERNOULLI (50) REPEATABLE (4)) =
+       (SELECT array_agg(a ORDER BY a) FROM sample_test TABLESAMPLE BERNOULLI (50) REPEATABLE (4))
+       AS repeatable;
+
+-- quals are applied to the sampled rows
+SELECT count(*), sum(a) FROM sample_test TABLESAMPLE SYSTEM (100) WHERE b = 3;
+
+-- deleted rows are not returned
+DELETE FROM sample_test WHERE a <= 1500;
+SELECT count(*), sum(a) FROM sample_test TABLESAMPLE SYSTEM (100);
+SELECT count(*), sum(a) FROM sample_test TABLESAMPLE BERNOULLI (100);
+
+-- rows that are not flushed yet are sampled too
+BEGIN;
+INSERT INTO sample_test VALUES (7000, 0);
+SELECT count(*) FROM sample_test TABLESAMPLE SYSTEM (100) WHERE a = 7000;
+ROLLBACK;
+
+-- ANALYZE counts the live rows of the blocks that it samples, which are all
+-- the blocks of a small table
+ANALYZE sample_test;
+SELECT reltuples FROM pg_class WHERE oid = 'sample_test'::regclass;
+SELECT n_distinct FROM pg_stats
+WHERE schemaname = 'columnar_tablesample' AND tablename = 'sample_test' AND attname = 'b';
+
+-- sample scans on empty tables
+CREATE TABLE empty_sample_test(a int) USING columnar;
+SELECT count(*) FROM empty_sample_test TABLESAMPLE SYSTEM (100);
+SELECT count(*) FROM empty_sample_test TABLESAMPLE BERNOULLI (100);
+ANALYZE empty_sample_test;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_tablesample CASCADE;
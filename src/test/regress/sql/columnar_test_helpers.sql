@@ -61,7 +61,8 @@ BEGIN
    (
    SELECT storage_id FROM columnar_internal.stripe UNION ALL
    SELECT storage_id FROM columnar_internal.chunk UNION ALL
-   SELECT storage_id FROM columnar_internal.chunk_group
+   SELECT storage_id FROM columnar_internal.chunk_group UNION ALL
+   SELECT storage_id FROM columnar_internal.row_mask
    ) AS union_storage_id
    WHERE storage_id=input_storage_id;
 
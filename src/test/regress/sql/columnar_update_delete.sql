@@ -1,14 +1,47 @@
-
 CREATE TABLE columnar_update(i int, j int) USING columnar;
 
 INSERT INTO columnar_update VALUES (1, 10);
 INSERT INTO columnar_update VALUES (2, 20);
 INSERT INTO columnar_update VALUES (3, 30);
 
--- should fail
 UPDATE columnar_update SET j = j+1 WHERE i = 2;
--- should fail
-DELETE FROM columnar_update WHERE i = 2;
+DELETE FROM columnar_update WHERE i = 3;
+
+SELECT * FROM columnar_update ORDER BY i;
+
+-- deleted rows are neither counted nor used by the chunk group statistics
+SELECT count(*), sum(j), min(i), max(i) FROM columnar_update;
+
+-- updating a row deletes it from its stripe and writes a new version
+SELECT s.stripe_num, row_count, deleted_rows
+FROM columnar.stripe s, columnar_internal.row_mask m
+WHERE s.relation = 'columnar_update'::regclass AND
+      m.storage_id = s.storage_id AND m.stripe_num = s.stripe_num
+ORDER BY stripe_num;
+
+-- deletions are rolled back with the (sub)transaction
+BEGIN;
+DELETE FROM columnar_update WHERE i = 1;
+SELECT * FROM columnar_update ORDER BY i;
+SAVEPOINT s1;
+UPDATE columnar_update SET j = 0;
+DELETE FROM columnar_update WHERE j = 0;
+SELECT count(*) FROM columnar_update;
+ROLLBACK TO SAVEPOINT s1;
+SELECT * FROM columnar_update ORDER BY i;
+ROLLBACK;
+
+SELECT * FROM columnar_update ORDER BY i;
+
+-- rows that are inserted by the same transaction can be deleted as well
+BEGIN;
+INSERT INTO columnar_update VALUES (4, 40), (5, 50);
+DELETE FROM columnar_update WHERE i = 4;
+UPDATE columnar_update SET j = j+1 WHERE i = 5;
+SELECT * FROM columnar_update ORDER BY i;
+COMMIT;
+
+SELECT * FROM columnar_update ORDER BY i;
 
 -- should succeed because there's no target
 INSERT INTO columnar_update VALUES
@@ -28,11 +61,48 @@ INSERT INTO columnar_update VALUES
 SELECT * FROM columnar_update WHERE i = 2 FOR SHARE;
 SELECT * FROM columnar_update WHERE i = 2 FOR UPDATE;
 
--- CTID scans should fail
+-- CTID quals are evaluated as filters
 SELECT * FROM columnar_update WHERE ctid = '(0,2)';
 
+-- deleted rows are skipped by index scans too
+CREATE INDEX columnar_update_i_idx ON columnar_update (i);
+DELETE FROM columnar_update WHERE i = 2 AND j = 21;
+SET enable_seqscan TO off;
+SET columnar.enable_custom_scan TO off;
+SELECT * FROM columnar_update WHERE i = 2;
+SELECT count(*) FROM columnar_update WHERE i >= 3;
+RESET columnar.enable_custom_scan;
+RESET enable_seqscan;
+
 DROP TABLE columnar_update;
 
+-- VACUUM rewrites the live rows of stripes with many deleted rows
+CREATE TABLE columnar_compact(a int) USING columnar;
+INSERT INTO columnar_compact SELECT generate_series(1, 1000);
+INSERT INTO columnar_compact SELECT generate_series(1001, 2000);
+DELETE FROM columnar_compact WHERE a % 2 = 0 AND a <= 1000;
+DELETE FROM columnar_compact WHERE a = 2000;
+
+SELECT count(*), sum(a) FROM columnar_compact;
+SELECT stripe_num, row_count FROM columnar.stripe
+WHERE relation = 'columnar_compact'::regclass ORDER BY stripe_num;
+
+VACUUM columnar_compact;
+
+-- first stripe is replaced, second one is below the threshold
+SELECT stripe_num, row_count FROM columnar.stripe
+WHERE relation = 'columnar_compact'::regclass ORDER BY stripe_num;
+SELECT count(*), sum(a) FROM columnar_compact;
+
+-- VACUUM FULL drops all deleted rows
+VACUUM FULL columnar_compact;
+
+SELECT count(*) FROM columnar_internal.row_mask
+WHERE storage_id = columnar.get_storage_id('columnar_compact');
+SELECT count(*), sum(a) FROM columnar_compact;
+
+DROP TABLE columnar_compact;
+
 CREATE TABLE parent(ts timestamptz, i int, n numeric, s text)
   PARTITION BY RANGE (ts);
 
@@ -58,30 +128,30 @@ SELECT * FROM parent;
 UPDATE p2 SET i = i+1 WHERE ts = '2020-03-15';
 DELETE FROM p2 WHERE ts = '2020-03-21';
 
--- update on specific columnar partition should fail
+-- update on specific columnar partition should succeed
 UPDATE p1 SET i = i+1 WHERE ts = '2020-02-15';
-DELETE FROM p1 WHERE ts = '2020-02-15';
+DELETE FROM p0 WHERE ts = '2020-01-15';
 
 -- partitioned updates that affect only row tables
--- should succeed
 UPDATE parent SET i = i+1 WHERE ts = '2020-03-15';
 DELETE FROM parent WHERE ts = '2020-03-22';
 
 -- partitioned updates that affect columnar tables
--- should fail
-UPDATE parent SET i = i+1 WHERE ts > '2020-02-15';
-DELETE FROM parent WHERE ts > '2020-02-15';
+INSERT INTO parent VALUES('2020-01-20', 11, 110, 'one thousand and ten'); -- columnar
+UPDATE parent SET i = i+1 WHERE ts < '2020-03-01';
+DELETE FROM parent WHERE i = 22;
 
--- non-partitioned update should fail, even if it
--- only affects a row partition
-UPDATE parent SET i = i+1 WHERE n = 300;
+-- non-partitioned updates
+UPDATE parent SET i = i+1 WHERE n = 300 OR n = 110;
 DELETE FROM parent WHERE n = 303;
 
-SELECT * FROM parent;
+-- move a row from the row partition to a columnar partition
+UPDATE parent SET ts = '2020-02-20' WHERE n = 300;
+
+SELECT * FROM parent ORDER BY ts;
 
 -- detach partition
 ALTER TABLE parent DETACH PARTITION p0;
 DROP TABLE p0;
 
 DROP TABLE parent;
-
@@ -0,0 +1,54 @@
+--
+-- columnar_vectorized_filter.sql
+--
+-- Test columnar.enable_vectorized_filter = true, where the simple quals
+-- pushed down to the columnar reader are evaluated over the column vectors
+-- of each chunk group.
+--
+
+create table vectorized_filter(i int, j int, t text) using columnar;
+ALTER TABLE vectorized_filter SET (columnar.chunk_group_row_limit = 1000);
+insert into vectorized_filter
+  select i, case when i % 7 = 0 then null else i end, (i % 10)::text
+  from generate_series(1,30000) i;
+
+set columnar.enable_vectorized_filter to on;
+
+select count(*), min(i), max(i) from vectorized_filter where i > 29000;
+select count(*) from vectorized_filter where t = '3';
+
+-- rows with NULL values are refuted by strict operators
+select count(*) from vectorized_filter where j < 100;
+
+-- constant on the left hand side
+select count(*), max(i) from vectorized_filter where 100 >= i;
+
+-- multiple quals, and quals that cannot be vectorized
+select count(*) from vectorized_filter where i between 500 and 1500 and t <> '0';
+select count(*) from vectorized_filter where i + 1 > 29001 and t = '1';
+
+-- rescan with a different qual
+select s, (select count(*) from vectorized_filter where i <= s) from generate_series(999,1001) s;
+
+-- results are same when the quals are not vectorized
+set columnar.enable_vectorized_filter to off;
+select count(*) from vectorized_filter where i between 500 and 1500 and t <> '0';
+
+reset columnar.enable_vectorized_filter;
+drop table vectorized_filter;
+
+-- columns that are not referenced by the vectorized quals are read and
+-- deserialized only for the chunk groups having rows that satisfy the quals
+create table late_materialization(i int, a text, b int, c numeric) using columnar;
+ALTER TABLE late_materialization SET (columnar.chunk_group_row_limit = 1000);
+insert into late_materialization
+  select i, repeat('x', i % 50), i * 2, i * 1.5 from generate_series(1, 10000) i;
+alter table late_materialization add column d int default 7;
+
+set columnar.enable_vectorized_filter to on;
+select i, length(a), b, c, d from late_materialization where i = 4321;
+select count(*), sum(b), max(length(a)) from late_materialization where b > 19990;
+select sum(d), count(c) from late_materialization where i <= 10 and c > 3;
+select count(a) from late_materialization where i < 0;
+reset columnar.enable_vectorized_filter;
+drop table late_materialization;
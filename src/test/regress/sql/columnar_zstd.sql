@@ -44,6 +44,14 @@ SELECT pg_relation_size('test_pglz') AS size_pglz \gset
 -- verify that zstd compressed better than pglz
 SELECT :size_pglz > :size_comp_level_default;
 
+-- compress large chunks using zstd worker threads
+SET columnar.compression TO 'zstd';
+SET columnar.compression_workers TO 2;
+CREATE TABLE test_zstd_workers (a int, b text) USING columnar;
+INSERT INTO test_zstd_workers SELECT i, repeat(md5(i::text), 50) FROM generate_series(1, 10000) i;
+RESET columnar.compression_workers;
+SELECT count(*), sum(length(b)), bool_and(b = repeat(md5(a::text), 50)) FROM test_zstd_workers;
+
 -- Other operations
 
 ANALYZE test_zstd;
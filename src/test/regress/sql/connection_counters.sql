@@ -0,0 +1,67 @@
+--
+-- connection_counters.sql
+--
+-- Test the cumulative counters of the connections to the workers.
+--
+
+SELECT citus_connection_counters_reset();
+
+CREATE SCHEMA connection_counters;
+SET search_path TO connection_counters;
+SET citus.next_shard_id TO 1919000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE dist_table(a int, b int);
+SELECT create_distributed_table('dist_table', 'a');
+
+COPY dist_table FROM STDIN WITH CSV;
+1,1
+2,2
+3,3
+4,4
+5,5
+6,6
+7,7
+8,8
+\.
+
+INSERT INTO dist_table SELECT i, i FROM generate_series(9, 100) i;
+SELECT count(*), sum(a), sum(b) FROM dist_table;
+SELECT * FROM dist_table WHERE a = 1;
+
+-- the counters are added to the counters of the node at the end of the transaction
+SELECT count(*), bool_and(commands_sent > 0), bool_and(bytes_sent > 0),
+       bool_and(copy_bytes_sent > 0), bool_and(bytes_received > 0),
+       bool_and(connections_established > 0),
+       bool_and(connection_establishment_time >= 0), bool_and(wait_time > 0),
+       bool_and(stats_reset IS NOT NULL)
+FROM citus_stat_connections
+WHERE nodeport IN (:worker_1_port, :worker_2_port);
+
+-- the counters only grow until they are reset
+CREATE TABLE counters_before AS
+SELECT nodeport, commands_sent, bytes_received FROM citus_stat_connections;
+
+SELECT sum(a) FROM dist_table;
+
+SELECT bool_and(after.commands_sent > before.commands_sent),
+       bool_and(after.bytes_received > before.bytes_received)
+FROM citus_stat_connections after JOIN counters_before before USING (nodeport)
+WHERE nodeport IN (:worker_1_port, :worker_2_port);
+
+SELECT citus_connection_counters_reset();
+
+SELECT count(*) FROM citus_stat_connections
+WHERE nodeport IN (:worker_1_port, :worker_2_port) AND bytes_received > 1000;
+
+-- only superusers can see and reset the counters by default
+CREATE ROLE connection_counters_user WITH LOGIN;
+SET ROLE connection_counters_user;
+SELECT count(*) FROM citus_stat_connections;
+SELECT citus_connection_counters_reset();
+RESET ROLE;
+DROP ROLE connection_counters_user;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA connection_counters CASCADE;
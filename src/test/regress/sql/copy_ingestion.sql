@@ -0,0 +1,87 @@
+--
+-- copy_ingestion.sql
+--
+-- Test resuming bulk loads through COPY with the ingestion_id option.
+--
+
+CREATE SCHEMA copy_ingestion;
+SET search_path TO copy_ingestion;
+SET citus.next_shard_id TO 1929000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int, b text);
+SELECT create_distributed_table('dist_table', 'a');
+
+CREATE TABLE other_table (a int, b text);
+SELECT create_distributed_table('other_table', 'a');
+
+COPY dist_table FROM STDIN WITH (ingestion_id 'load1');
+1	one
+2	two
+3	three
+\.
+
+SELECT ingestion_id, logicalrelid, committed_rows FROM pg_dist_ingestion;
+
+-- sending the input again only copies the rows that were not committed
+COPY dist_table FROM STDIN WITH (ingestion_id 'load1', ingestion_offset 0);
+1	one
+2	two
+3	three
+4	four
+5	five
+\.
+
+SELECT * FROM dist_table ORDER BY a;
+SELECT ingestion_id, logicalrelid, committed_rows FROM pg_dist_ingestion;
+
+-- the input cannot leave a gap after the committed rows
+COPY dist_table FROM STDIN WITH (ingestion_id 'load1', ingestion_offset 10);
+
+-- continue right after the committed rows
+COPY dist_table FROM STDIN WITH (ingestion_id 'load1', ingestion_offset 5);
+6	six
+7	seven
+\.
+
+SELECT count(*), sum(a) FROM dist_table;
+SELECT ingestion_id, logicalrelid, committed_rows FROM pg_dist_ingestion;
+
+-- an ingestion loads into a single table
+COPY other_table FROM STDIN WITH (ingestion_id 'load1');
+
+COPY dist_table FROM STDIN WITH (ingestion_offset 1);
+
+COPY dist_table FROM STDIN WITH (ingestion_id 'load2', ingestion_offset -1);
+
+-- progress of a COPY that is rolled back is not recorded
+BEGIN;
+COPY dist_table FROM STDIN WITH (ingestion_id 'load1', ingestion_offset 7);
+8	eight
+\.
+ROLLBACK;
+
+SELECT count(*), sum(a) FROM dist_table;
+SELECT ingestion_id, logicalrelid, committed_rows FROM pg_dist_ingestion;
+
+-- the id can be reused after removing the ingestion
+SELECT citus_remove_ingestion('load1');
+SELECT citus_remove_ingestion('load1');
+
+COPY other_table FROM STDIN WITH (ingestion_id 'load1');
+1	one
+\.
+
+COPY dist_table FROM STDIN WITH (ingestion_id 'load2');
+8	eight
+\.
+
+SELECT ingestion_id, logicalrelid, committed_rows FROM pg_dist_ingestion ORDER BY 1;
+
+-- dropping a table removes its ingestions
+DROP TABLE other_table;
+SELECT ingestion_id, logicalrelid, committed_rows FROM pg_dist_ingestion ORDER BY 1;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA copy_ingestion CASCADE;
@@ -0,0 +1,62 @@
+--
+-- cost_based_join_order.sql
+--
+-- Test choosing the side of single repartition joins based on the table
+-- sizes recorded by citus_update_table_statistics.
+--
+CREATE SCHEMA cost_based_join_order;
+SET search_path TO cost_based_join_order;
+
+SET citus.next_shard_id TO 1901000;
+SET citus.shard_replication_factor TO 1;
+SET citus.enable_repartition_joins TO on;
+SET citus.enable_single_hash_repartition_joins TO on;
+
+SET citus.shard_count TO 8;
+CREATE TABLE small_table(key int, value int);
+SELECT create_distributed_table('small_table', 'key');
+INSERT INTO small_table SELECT i, i FROM generate_series(1, 10) i;
+
+SET citus.shard_count TO 4;
+CREATE TABLE large_table(key int, value int);
+SELECT create_distributed_table('large_table', 'key');
+INSERT INTO large_table SELECT i, i FROM generate_series(1, 100000) i;
+
+-- returns the number of map tasks of the repartition job of the given query,
+-- which is the shard count of the repartitioned table
+CREATE FUNCTION map_task_count(query text)
+RETURNS int LANGUAGE plpgsql AS $$
+DECLARE
+  line text;
+BEGIN
+  FOR line IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+    IF line LIKE '%Map Task Count: %' THEN
+      RETURN substring(line FROM 'Map Task Count: (\d+)')::int;
+    END IF;
+  END LOOP;
+  RETURN NULL;
+END;
+$$;
+
+-- by default, the table that is joined second is repartitioned
+SELECT map_task_count('SELECT count(*) FROM small_table s JOIN large_table l ON (s.key = l.key)');
+
+SET citus.enable_cost_based_join_order TO on;
+
+-- without statistics, the table sizes are unknown
+SELECT map_task_count('SELECT count(*) FROM small_table s JOIN large_table l ON (s.key = l.key)');
+
+SELECT citus_update_table_statistics('small_table');
+SELECT citus_update_table_statistics('large_table');
+
+-- with statistics, the small table is repartitioned regardless of the order
+SELECT map_task_count('SELECT count(*) FROM small_table s JOIN large_table l ON (s.key = l.key)');
+SELECT map_task_count('SELECT count(*) FROM large_table l JOIN small_table s ON (s.key = l.key)');
+SELECT count(*), sum(l.value) FROM small_table s JOIN large_table l ON (s.key = l.key);
+
+RESET citus.enable_cost_based_join_order;
+SELECT map_task_count('SELECT count(*) FROM small_table s JOIN large_table l ON (s.key = l.key)');
+SELECT count(*), sum(l.value) FROM small_table s JOIN large_table l ON (s.key = l.key);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA cost_based_join_order CASCADE;
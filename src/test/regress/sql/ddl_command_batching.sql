@@ -0,0 +1,47 @@
+--
+-- ddl_command_batching.sql
+--
+-- Test sending the DDL commands that create a distributed table and its
+-- dependencies on other nodes as a single command.
+--
+
+SET citus.enable_ddl_command_batching TO on;
+CREATE SCHEMA ddl_command_batching;
+SET search_path TO ddl_command_batching;
+SET citus.next_shard_id TO 1939100;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+-- the type and the sequence are created before the table
+CREATE TYPE pair AS (x int, y int);
+CREATE SEQUENCE id_seq;
+CREATE TABLE dist_table(a int PRIMARY KEY DEFAULT nextval('id_seq'), p pair);
+CREATE VIEW dist_view AS SELECT a, (p).x FROM dist_table;
+SELECT create_distributed_table('dist_table', 'a');
+
+BEGIN;
+CREATE TYPE triple AS (x int, y int, z int);
+CREATE TABLE other_table(a int, t triple);
+SELECT create_distributed_table('other_table', 'a');
+COMMIT;
+
+\c - - - :worker_1_port
+SELECT attname, atttypid::regtype FROM pg_attribute
+WHERE attrelid = 'ddl_command_batching.dist_table'::regclass AND attnum > 0
+ORDER BY attnum;
+SELECT count(*) FROM pg_dist_shard
+WHERE logicalrelid = 'ddl_command_batching.dist_table'::regclass;
+SELECT pg_get_viewdef('ddl_command_batching.dist_view'::regclass) IS NOT NULL AS has_view;
+SELECT attname, atttypid::regtype FROM pg_attribute
+WHERE attrelid = 'ddl_command_batching.other_table'::regclass AND attnum > 0
+ORDER BY attnum;
+
+\c - - - :master_port
+SET search_path TO ddl_command_batching;
+INSERT INTO dist_table (p) VALUES ((1, 2));
+INSERT INTO other_table VALUES (1, (1, 2, 3));
+SELECT x FROM dist_view;
+SELECT (t).z FROM other_table;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA ddl_command_batching CASCADE;
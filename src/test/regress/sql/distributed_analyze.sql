@@ -0,0 +1,71 @@
+--
+-- distributed_analyze.sql
+--
+-- Test that ANALYZE of a Citus table stores the merged statistics of its
+-- shards as the statistics of the table on the coordinator.
+--
+CREATE SCHEMA distributed_analyze;
+SET search_path TO distributed_analyze;
+
+SET citus.next_shard_id TO 1914000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+SET citus.enable_distributed_analyze TO on;
+
+CREATE TABLE analyzed_events(id int, category int, note text);
+SELECT create_distributed_table('analyzed_events', 'id');
+
+INSERT INTO analyzed_events
+SELECT i, i % 10, CASE WHEN i % 4 = 0 THEN NULL ELSE 'note ' || i END
+FROM generate_series(1, 1000) i;
+
+ANALYZE analyzed_events;
+
+SELECT reltuples, relpages > 0 AS has_pages FROM pg_class
+WHERE oid = 'analyzed_events'::regclass;
+
+SELECT attname, round(null_frac::numeric, 2) AS null_frac,
+       round(n_distinct::numeric, 2) AS n_distinct,
+       most_common_vals IS NOT NULL AS has_common_values,
+       histogram_bounds IS NOT NULL AS has_histogram
+FROM pg_stats
+WHERE schemaname = 'distributed_analyze' AND tablename = 'analyzed_events'
+ORDER BY attname;
+
+-- the histogram of the distribution column covers all shards
+SELECT (histogram_bounds::text::int[])[1] AS first_bound,
+       (histogram_bounds::text::int[])[array_length(histogram_bounds::text::int[], 1)] AS last_bound,
+       round(correlation::numeric, 2) AS correlation
+FROM pg_stats
+WHERE schemaname = 'distributed_analyze' AND tablename = 'analyzed_events' AND attname = 'id';
+
+-- the common values of the shards are merged
+SELECT array_length(most_common_vals::text::int[], 1) AS common_value_count,
+       (SELECT round(sum(f)::numeric, 2) FROM unnest(most_common_freqs) f) AS frequency_sum
+FROM pg_stats
+WHERE schemaname = 'distributed_analyze' AND tablename = 'analyzed_events' AND attname = 'category';
+
+-- reference tables have a single shard
+CREATE TABLE analyzed_categories(id int, name text);
+SELECT create_reference_table('analyzed_categories');
+INSERT INTO analyzed_categories SELECT i, 'category ' || i FROM generate_series(0, 9) i;
+ANALYZE analyzed_categories;
+
+SELECT reltuples FROM pg_class WHERE oid = 'analyzed_categories'::regclass;
+SELECT attname, round(n_distinct::numeric, 2) AS n_distinct FROM pg_stats
+WHERE schemaname = 'distributed_analyze' AND tablename = 'analyzed_categories'
+ORDER BY attname;
+
+-- without the setting, ANALYZE only analyzes the shards
+SET citus.enable_distributed_analyze TO off;
+CREATE TABLE unanalyzed_events(id int);
+SELECT create_distributed_table('unanalyzed_events', 'id');
+INSERT INTO unanalyzed_events SELECT i FROM generate_series(1, 100) i;
+ANALYZE unanalyzed_events;
+
+SELECT reltuples FROM pg_class WHERE oid = 'unanalyzed_events'::regclass;
+SELECT count(*) FROM pg_stats
+WHERE schemaname = 'distributed_analyze' AND tablename = 'unanalyzed_events';
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA distributed_analyze CASCADE;
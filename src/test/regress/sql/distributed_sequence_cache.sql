@@ -0,0 +1,36 @@
+--
+-- distributed_sequence_cache.sql
+--
+-- Test the cache size of the sequences of distributed tables on the workers.
+--
+
+CREATE SCHEMA dist_seq_cache;
+SET search_path TO dist_seq_cache;
+SET citus.next_shard_id TO 1947000;
+SET citus.shard_replication_factor TO 1;
+
+-- by default the workers use the cache size of the sequence
+CREATE TABLE events (id bigserial, a int);
+SELECT create_distributed_table('events', 'a');
+SELECT run_command_on_workers($$SELECT cache_size FROM pg_sequences WHERE schemaname = 'dist_seq_cache' AND sequencename = 'events_id_seq'$$);
+
+SET citus.distributed_sequence_cache_size TO 1000;
+CREATE TABLE sessions (id bigserial, a int);
+SELECT create_distributed_table('sessions', 'a');
+SELECT run_command_on_workers($$SELECT cache_size FROM pg_sequences WHERE schemaname = 'dist_seq_cache' AND sequencename = 'sessions_id_seq'$$);
+
+-- the cache size on the coordinator is unchanged
+SELECT cache_size FROM pg_sequences WHERE schemaname = 'dist_seq_cache' AND sequencename = 'sessions_id_seq';
+
+-- a larger cache size of the sequence is kept
+CREATE SEQUENCE big_cache_seq CACHE 5000;
+CREATE TABLE visits (id bigint DEFAULT nextval('big_cache_seq'), a int);
+SELECT create_distributed_table('visits', 'a');
+SELECT run_command_on_workers($$SELECT cache_size FROM pg_sequences WHERE schemaname = 'dist_seq_cache' AND sequencename = 'big_cache_seq'$$);
+
+INSERT INTO sessions (a) SELECT i FROM generate_series(1, 10) i;
+SELECT count(DISTINCT id) FROM sessions;
+
+RESET citus.distributed_sequence_cache_size;
+SET client_min_messages TO WARNING;
+DROP SCHEMA dist_seq_cache CASCADE;
@@ -0,0 +1,55 @@
+--
+-- executor_memory_budget.sql
+--
+-- Test the admission control of distributed executions based on
+-- citus.max_executor_memory.
+--
+
+CREATE SCHEMA executor_memory_budget;
+SET search_path TO executor_memory_budget;
+SET citus.next_shard_id TO 1922000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table(a int, b text);
+SELECT create_distributed_table('dist_table', 'a');
+INSERT INTO dist_table SELECT i, repeat('x', 100) FROM generate_series(1, 1000) i;
+
+-- a budget that is smaller than any execution
+ALTER SYSTEM SET citus.max_executor_memory TO '1kB';
+SELECT pg_reload_conf();
+SELECT pg_sleep(0.1);
+SHOW citus.max_executor_memory;
+
+-- executions are always admitted when no other execution holds memory
+SELECT count(*) FROM dist_table;
+SELECT count(*) FROM dist_table WHERE a = 5;
+SELECT sum(length(b)) FROM dist_table;
+SELECT a, length(b) FROM dist_table WHERE a < 4 ORDER BY a;
+
+-- the results of the tasks grow the reservation while executing
+SELECT count(*) FROM (SELECT a, b FROM dist_table OFFSET 0) s;
+
+-- executions within a transaction and in a CTE
+BEGIN;
+UPDATE dist_table SET b = 'y' WHERE a = 1;
+WITH cte AS (SELECT a, b FROM dist_table WHERE b = 'y')
+SELECT count(*) FROM cte JOIN dist_table USING (a);
+ROLLBACK;
+
+-- cursors keep working, since their executions finish before returning rows
+BEGIN;
+DECLARE c CURSOR FOR SELECT a FROM dist_table ORDER BY a;
+FETCH 2 FROM c;
+SELECT count(*) FROM dist_table;
+FETCH 2 FROM c;
+CLOSE c;
+COMMIT;
+
+ALTER SYSTEM RESET citus.max_executor_memory;
+SELECT pg_reload_conf();
+SELECT pg_sleep(0.1);
+SHOW citus.max_executor_memory;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA executor_memory_budget CASCADE;
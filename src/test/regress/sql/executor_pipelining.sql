@@ -0,0 +1,57 @@
+--
+-- executor_pipelining.sql
+--
+-- Test sending the tasks of multi-shard queries in a pipeline over the same
+-- connection, rather than waiting for the results of each task before
+-- sending the next one.
+--
+CREATE SCHEMA executor_pipelining;
+SET search_path TO executor_pipelining;
+
+SET citus.next_shard_id TO 1913000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 32;
+
+CREATE TABLE items(id int, category int, name text);
+SELECT create_distributed_table('items', 'id');
+INSERT INTO items SELECT i, i % 5, 'item ' || i FROM generate_series(1, 1000) i;
+
+-- run all the tasks on a worker over a single connection
+SET citus.max_adaptive_executor_pool_size TO 1;
+SET citus.executor_pipeline_depth TO 8;
+
+SELECT count(*) FROM items;
+SELECT category, count(*), sum(id) FROM items GROUP BY category ORDER BY category;
+SELECT name FROM items WHERE id % 100 = 0 ORDER BY id;
+
+-- the pipeline can be deeper than the number of tasks
+SET citus.executor_pipeline_depth TO 1024;
+SELECT count(*) FROM items WHERE name LIKE 'item 1%';
+
+-- tasks assigned to the connection of an earlier modification are pipelined as well
+BEGIN;
+UPDATE items SET category = 5 WHERE id <= 100;
+SELECT count(*) FROM items WHERE category = 5;
+SELECT count(*) FROM items;
+ROLLBACK;
+
+-- parameters are sent along with each task
+PREPARE count_category(int) AS SELECT count(*) FROM items WHERE category = $1;
+EXECUTE count_category(1);
+EXECUTE count_category(2);
+
+-- an error in the pipeline fails the query, the connection is usable afterwards
+SELECT count(*) FROM items WHERE 1 / (id - 500) > 0;
+SELECT count(*) FROM items;
+
+BEGIN;
+SAVEPOINT s1;
+SELECT count(*) FROM items WHERE 1 / (id - 500) > 0;
+ROLLBACK TO SAVEPOINT s1;
+SELECT count(*) FROM items;
+COMMIT;
+
+RESET citus.executor_pipeline_depth;
+RESET citus.max_adaptive_executor_pool_size;
+SET client_min_messages TO warning;
+DROP SCHEMA executor_pipelining CASCADE;
@@ -153,7 +153,7 @@ SELECT count(*) FROM reference_table;
 
 -- immediately kill when we see cascading TRUNCATE on the hash table to see
 -- rollbacked properly
-SELECT citus.mitmproxy('conn.onQuery(query="^TRUNCATE TABLE").after(2).kill()');
+SELECT citus.mitmproxy('conn.onQuery(query="^TRUNCATE TABLE").after(1).kill()');
 TRUNCATE reference_table CASCADE;
 SELECT citus.mitmproxy('conn.allow()');
 SELECT * FROM unhealthy_shard_count;
@@ -162,7 +162,7 @@ SELECT count(*) FROM reference_table;
 
 -- immediately cancel when we see cascading TRUNCATE on the hash table to see
 -- if the command still cascaded to referencing table or failed successfuly
-SELECT citus.mitmproxy('conn.onQuery(query="^TRUNCATE TABLE").after(2).cancel(' ||  pg_backend_pid() || ')');
+SELECT citus.mitmproxy('conn.onQuery(query="^TRUNCATE TABLE").after(1).cancel(' ||  pg_backend_pid() || ')');
 TRUNCATE reference_table CASCADE;
 SELECT citus.mitmproxy('conn.allow()');
 SELECT * FROM unhealthy_shard_count;
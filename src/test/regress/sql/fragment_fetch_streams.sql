@@ -0,0 +1,47 @@
+--
+-- fragment_fetch_streams.sql
+--
+-- Test fetching many intermediate results in one round trip and spreading
+-- repartitioned fragments over multiple fetch streams.
+--
+
+CREATE SCHEMA fragment_fetch_streams;
+SET search_path TO fragment_fetch_streams;
+SET citus.next_shard_id TO 1934000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+-- all results of a fetch, including empty ones, come back in order
+BEGIN;
+SELECT broadcast_intermediate_result('squares_1', 'SELECT s, s*s FROM generate_series(1, 5) s');
+SELECT broadcast_intermediate_result('empty', 'SELECT s, s*s FROM generate_series(1, 0) s');
+SELECT broadcast_intermediate_result('squares_2', 'SELECT s, s*s FROM generate_series(6, 10) s');
+SELECT * FROM fetch_intermediate_results(ARRAY['squares_1', 'empty', 'squares_2']::text[], 'localhost', :worker_1_port);
+SELECT * FROM read_intermediate_results(ARRAY['squares_1', 'empty', 'squares_2']::text[], 'binary') AS res (x int, x2 int);
+
+-- results that already exist locally are not fetched again
+SELECT broadcast_intermediate_result('squares_3', 'SELECT s, s*s FROM generate_series(11, 12) s');
+SELECT * FROM fetch_intermediate_results(ARRAY['squares_1', 'squares_3', 'squares_2']::text[], 'localhost', :worker_2_port);
+SELECT count(*), sum(x2) FROM read_intermediate_results(ARRAY['squares_1', 'squares_2', 'squares_3']::text[], 'binary') AS res (x int, x2 int);
+END;
+
+CREATE TABLE source_table (a int, b int);
+SELECT create_distributed_table('source_table', 'a');
+INSERT INTO source_table SELECT s, s % 100 FROM generate_series(1, 10000) s;
+
+CREATE TABLE target_table (a int, b int);
+SELECT create_distributed_table('target_table', 'a');
+
+-- the fragments between each pair of nodes are fetched by multiple tasks
+SET citus.fragment_fetch_streams TO 4;
+INSERT INTO target_table (a, b) SELECT b, a FROM source_table;
+SELECT count(*), sum(a), sum(b) FROM target_table;
+
+-- more streams than fragments
+SET citus.fragment_fetch_streams TO 64;
+INSERT INTO target_table (a, b) SELECT b, a FROM source_table WHERE a <= 100;
+SELECT count(*), sum(a), sum(b) FROM target_table;
+
+RESET citus.fragment_fetch_streams;
+SET client_min_messages TO WARNING;
+DROP SCHEMA fragment_fetch_streams CASCADE;
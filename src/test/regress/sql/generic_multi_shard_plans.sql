@@ -0,0 +1,97 @@
+--
+-- generic_multi_shard_plans.sql
+--
+-- Test reusing generic plans of prepared multi-shard SELECTs, whose tasks on
+-- shards that the parameter values exclude are skipped during execution.
+--
+CREATE SCHEMA generic_multi_shard_plans;
+SET search_path TO generic_multi_shard_plans;
+
+SET citus.next_shard_id TO 1909000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE dist_table(a int, b int);
+SELECT create_distributed_table('dist_table', 'a');
+INSERT INTO dist_table SELECT i, i % 10 FROM generate_series(1, 100) i;
+
+CREATE TABLE ref_table(b int, name text);
+SELECT create_reference_table('ref_table');
+INSERT INTO ref_table SELECT i, 'name ' || i FROM generate_series(0, 9) i;
+
+-- renames the shards of dist_table that key 1 does not hash to, such that
+-- queries fail if they access those shards
+CREATE FUNCTION rename_other_shards(suffix_from text, suffix_to text)
+RETURNS bool LANGUAGE sql AS $$
+  SELECT bool_and(success) FROM (
+    SELECT (run_command_on_workers(format(
+              'ALTER TABLE IF EXISTS generic_multi_shard_plans.%I RENAME TO %I',
+              'dist_table_' || shardid || suffix_from,
+              'dist_table_' || shardid || suffix_to))).success
+    FROM pg_dist_shard
+    WHERE logicalrelid = 'dist_table'::regclass AND
+          shardid <> get_shard_id_for_distribution_column('dist_table', 1)) results;
+$$;
+
+SET citus.enable_generic_multi_shard_plans TO on;
+SET plan_cache_mode TO force_generic_plan;
+
+PREPARE filtered(int) AS
+SELECT count(*), sum(a) FROM dist_table WHERE b < $1;
+EXECUTE filtered(5);
+EXECUTE filtered(10);
+EXECUTE filtered(0);
+EXECUTE filtered(5);
+
+-- parameters in the combine query
+PREPARE grouped(int, int) AS
+SELECT b, count(*) FROM dist_table WHERE a > $1
+GROUP BY b HAVING count(*) > $2 ORDER BY b LIMIT 3;
+EXECUTE grouped(50, 4);
+EXECUTE grouped(90, 0);
+
+PREPARE joined(text) AS
+SELECT name, count(*) FROM dist_table JOIN ref_table USING (b)
+WHERE name <> $1 GROUP BY name ORDER BY name LIMIT 2;
+EXECUTE joined('name 0');
+EXECUTE joined('name 1');
+
+-- the tasks are pruned by the parameters of the distribution column
+PREPARE in_list(int[]) AS
+SELECT count(*), sum(b) FROM dist_table WHERE a = ANY($1);
+EXECUTE in_list(ARRAY[1]);
+EXECUTE in_list(ARRAY[]::int[]);
+EXECUTE in_list(ARRAY[1, 2, 3]);
+
+PREPARE in_params(int, int) AS
+SELECT a, b FROM dist_table WHERE a IN ($1, $2) ORDER BY a;
+EXECUTE in_params(1, 1);
+EXECUTE in_params(2, 3);
+
+SET client_min_messages TO WARNING;
+SELECT rename_other_shards('', '_hidden');
+RESET client_min_messages;
+
+EXECUTE in_list(ARRAY[1]);
+EXECUTE in_params(1, 1);
+EXECUTE in_list(ARRAY[1, 1]);
+
+SET client_min_messages TO WARNING;
+SELECT rename_other_shards('_hidden', '');
+RESET client_min_messages;
+
+EXECUTE in_list(ARRAY[1, 2, 3]);
+
+-- queries that need recursive planning are still planned for every execution
+PREPARE sublink(int) AS
+SELECT count(*) FROM dist_table WHERE a IN (SELECT a FROM dist_table WHERE b = $1);
+EXECUTE sublink(3);
+EXECUTE sublink(4);
+
+PREPARE non_colocated(int) AS
+SELECT count(*) FROM dist_table d1 JOIN dist_table d2 ON d1.b = d2.a WHERE d1.a < $1;
+EXECUTE non_colocated(11);
+EXECUTE non_colocated(21);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA generic_multi_shard_plans CASCADE;
@@ -0,0 +1,62 @@
+--
+-- hedged_reads.sql
+--
+-- Test sending slow single-shard reads on replicated shards to a second
+-- placement and using the rows of the placement that responds first.
+--
+
+CREATE SCHEMA hedged_reads;
+SET search_path TO hedged_reads;
+SET citus.next_shard_id TO 1917000;
+SET citus.shard_replication_factor TO 2;
+SET citus.shard_count TO 4;
+
+CREATE TABLE replicated_table(a int, b int);
+SELECT create_distributed_table('replicated_table', 'a');
+
+INSERT INTO replicated_table SELECT i, i % 10 FROM generate_series(1, 100) i;
+
+SET citus.hedged_read_percentile TO 90;
+
+-- we do not hedge until we have seen enough reads
+SELECT count(*), sum(b) FROM replicated_table WHERE a = 1;
+SELECT a, pg_sleep(0.2) IS NOT NULL AS slept FROM replicated_table WHERE a = 2;
+
+-- fill the recent read durations with fast reads
+SELECT b AS b3 FROM replicated_table WHERE a = 3 \gset
+SELECT b AS b4 FROM replicated_table WHERE a = 4 \gset
+SELECT b AS b5 FROM replicated_table WHERE a = 5 \gset
+SELECT b AS b6 FROM replicated_table WHERE a = 6 \gset
+SELECT b AS b7 FROM replicated_table WHERE a = 7 \gset
+SELECT b AS b8 FROM replicated_table WHERE a = 8 \gset
+SELECT b AS b9 FROM replicated_table WHERE a = 9 \gset
+SELECT b AS b10 FROM replicated_table WHERE a = 10 \gset
+SELECT b AS b11 FROM replicated_table WHERE a = 11 \gset
+SELECT b AS b12 FROM replicated_table WHERE a = 12 \gset
+SELECT :b3 + :b4 + :b5 + :b6 + :b7 + :b8 + :b9 + :b10 + :b11 + :b12 AS sum;
+
+-- slow reads are sent to both placements and return the rows only once
+SELECT a, pg_sleep(0.2) IS NOT NULL AS slept FROM replicated_table WHERE a = 13;
+SELECT a, b, pg_sleep(0.01) IS NOT NULL AS slept FROM replicated_table
+WHERE a IN (14, 15) ORDER BY a;
+SELECT count(*), sum(b) FROM replicated_table WHERE a = 16 AND pg_sleep(0.2) IS NOT NULL;
+
+-- errors of the placement that responds first are still reported
+SELECT a / (b - b) FROM replicated_table WHERE a = 17 AND pg_sleep(0.2) IS NOT NULL;
+
+-- fast reads are not affected
+SELECT count(*), sum(b) FROM replicated_table WHERE a = 18;
+
+-- reads in a transaction block are not hedged
+BEGIN;
+SELECT a, pg_sleep(0.2) IS NOT NULL AS slept FROM replicated_table WHERE a = 19;
+UPDATE replicated_table SET b = b + 1 WHERE a = 19;
+SELECT a, b FROM replicated_table WHERE a = 19;
+ROLLBACK;
+
+-- multi-shard reads are not hedged
+SELECT count(*), sum(b) FROM replicated_table WHERE pg_sleep(0.001) IS NOT NULL;
+
+RESET citus.hedged_read_percentile;
+SET client_min_messages TO WARNING;
+DROP SCHEMA hedged_reads CASCADE;
@@ -0,0 +1,59 @@
+--
+-- incremental_combine.sql
+--
+-- Test combining the results of the tasks of multi-shard queries on the
+-- coordinator as the tasks finish, rather than once all of them finished.
+--
+
+CREATE SCHEMA incremental_combine;
+SET search_path TO incremental_combine;
+SET citus.next_shard_id TO 1908000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 8;
+
+CREATE TABLE combine_table(a int, b int);
+SELECT create_distributed_table('combine_table', 'a');
+
+INSERT INTO combine_table SELECT i, i % 37 FROM generate_series(1, 1000) i;
+
+SET citus.enable_incremental_combine TO on;
+
+-- plain aggregates
+SELECT count(*), sum(a), sum(b), max(b) FROM combine_table;
+SELECT count(DISTINCT b) FROM combine_table;
+
+-- hashed aggregates
+SELECT b % 5 AS g, count(*), sum(a), max(a) FROM combine_table GROUP BY 1 ORDER BY 1;
+SELECT b % 5 AS g, count(*) FROM combine_table GROUP BY 1 HAVING sum(a) > 100000 ORDER BY 1;
+
+-- sorts
+SELECT a, b FROM combine_table ORDER BY b DESC, a LIMIT 5;
+
+-- aggregates that are evaluated over the rows of all the shards
+SET citus.coordinator_aggregation_strategy TO 'row-gather';
+SELECT mode() WITHIN GROUP (ORDER BY b), percentile_disc(0.5) WITHIN GROUP (ORDER BY a)
+FROM combine_table;
+RESET citus.coordinator_aggregation_strategy;
+
+-- in transaction blocks, the task results are combined once all tasks finished
+BEGIN;
+INSERT INTO combine_table VALUES (1001, 1);
+SELECT count(*), sum(a), sum(b), max(b) FROM combine_table;
+ROLLBACK;
+
+-- distinct rows
+SELECT DISTINCT b FROM combine_table WHERE b < 3 ORDER BY 1;
+
+-- the combine query does not read all the rows at once
+SELECT a, b FROM combine_table WHERE b = 0 LIMIT 0;
+
+-- prepared statements
+PREPARE grouped(int) AS
+SELECT b % 3 AS g, count(*), sum(a) FROM combine_table WHERE b < $1 GROUP BY 1 ORDER BY 1;
+EXECUTE grouped(10);
+EXECUTE grouped(20);
+DEALLOCATE grouped;
+
+RESET citus.enable_incremental_combine;
+SET client_min_messages TO WARNING;
+DROP SCHEMA incremental_combine CASCADE;
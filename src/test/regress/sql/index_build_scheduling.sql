@@ -0,0 +1,57 @@
+--
+-- index_build_scheduling.sql
+--
+-- Test balancing concurrent shard index builds on a node against the
+-- parallel workers of each build.
+--
+
+CREATE SCHEMA index_build_scheduling;
+SET search_path TO index_build_scheduling;
+SET citus.next_shard_id TO 1939300;
+SET citus.shard_replication_factor TO 1;
+
+SET citus.shard_count TO 2;
+CREATE TABLE few_shards(a int, b int);
+SELECT create_distributed_table('few_shards', 'a');
+INSERT INTO few_shards SELECT i, i FROM generate_series(1, 1000) i;
+
+SET citus.shard_count TO 8;
+CREATE TABLE many_shards(a int, b int);
+SELECT create_distributed_table('many_shards', 'a');
+INSERT INTO many_shards SELECT i, i FROM generate_series(1, 1000) i;
+
+SET citus.index_build_processes_per_node TO 4;
+
+-- one shard per node, each build may use parallel workers
+CREATE INDEX few_shards_b_idx ON few_shards(b);
+
+-- more shards than processes per node
+CREATE INDEX many_shards_b_idx ON many_shards(b);
+
+-- within a transaction block
+BEGIN;
+CREATE INDEX few_shards_a_b_idx ON few_shards(a, b);
+SHOW max_parallel_maintenance_workers;
+COMMIT;
+
+-- CREATE INDEX CONCURRENTLY only limits the number of connections
+CREATE INDEX CONCURRENTLY many_shards_a_b_idx ON many_shards(a, b);
+
+SET citus.multi_shard_modify_mode TO 'sequential';
+CREATE UNIQUE INDEX many_shards_a_idx ON many_shards(a);
+RESET citus.multi_shard_modify_mode;
+
+RESET citus.index_build_processes_per_node;
+
+-- all shards got their indexes
+SELECT count(*) FROM run_command_on_placements('few_shards',
+	$$SELECT count(*) FROM pg_index WHERE indrelid = '%s'::regclass$$)
+WHERE result = '2';
+SELECT count(*) FROM run_command_on_placements('many_shards',
+	$$SELECT count(*) FROM pg_index WHERE indrelid = '%s'::regclass$$)
+WHERE result = '3';
+
+SELECT count(*) FROM many_shards WHERE b = 42;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA index_build_scheduling CASCADE;
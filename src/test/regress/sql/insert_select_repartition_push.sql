@@ -0,0 +1,59 @@
+--
+-- insert_select_repartition_push.sql
+--
+-- Test repartitioned INSERT ... SELECT where the SELECT tasks push their
+-- results to the nodes of the target shards.
+--
+
+CREATE SCHEMA insert_select_repartition_push;
+SET search_path TO insert_select_repartition_push;
+SET citus.next_shard_id TO 1933000;
+SET citus.shard_count TO 2;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE source_table (a int, b int, c text);
+SELECT create_distributed_table('source_table', 'a');
+INSERT INTO source_table SELECT s, s % 100, repeat(md5(s::text), 4) FROM generate_series(1, 100000) s;
+
+CREATE TABLE target_table (a int, b int, c text);
+SELECT create_distributed_table('target_table', 'a');
+
+CREATE TABLE fetched_table (a int, b int, c text);
+SELECT create_distributed_table('fetched_table', 'a');
+
+-- the rows are fetched by the nodes of the target shards
+INSERT INTO fetched_table (a, b, c) SELECT b, a, c FROM source_table;
+
+SET citus.enable_repartitioned_insert_select_push TO on;
+
+-- the partitions are larger than a chunk, so they are pushed in several results
+INSERT INTO target_table (a, b, c) SELECT b, a, c FROM source_table;
+SELECT count(*), sum(a), sum(b), count(DISTINCT c) FROM target_table;
+SELECT count(*) FROM (SELECT * FROM target_table EXCEPT SELECT * FROM fetched_table) diff;
+
+-- the pushed rows are rolled back with the transaction
+BEGIN;
+INSERT INTO target_table (a, b, c) SELECT b, a, c FROM source_table WHERE a <= 1000;
+INSERT INTO target_table (a, b, c) SELECT b, a, c FROM source_table WHERE a > 99000;
+SELECT count(*) FROM target_table;
+ROLLBACK;
+SELECT count(*) FROM target_table;
+
+-- replicated target shards use the fetch phase
+SET citus.shard_replication_factor TO 2;
+CREATE TABLE replicated_table (a int, b int, c text);
+SELECT create_distributed_table('replicated_table', 'a');
+INSERT INTO replicated_table (a, b, c) SELECT b, a, c FROM source_table;
+SELECT count(*), sum(a) FROM replicated_table;
+
+RESET citus.enable_repartitioned_insert_select_push;
+
+-- the ORDER BY of the SELECT does not pull the rows to the coordinator
+EXPLAIN (COSTS OFF) INSERT INTO target_table (a, b, c) SELECT b, a, c FROM source_table ORDER BY a;
+TRUNCATE target_table;
+INSERT INTO target_table (a, b, c) SELECT b, a, c FROM source_table ORDER BY a;
+SELECT count(*) FROM target_table;
+SELECT count(*) FROM (SELECT * FROM target_table EXCEPT SELECT * FROM fetched_table) diff;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA insert_select_repartition_push CASCADE;
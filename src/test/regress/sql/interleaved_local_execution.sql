@@ -0,0 +1,69 @@
+--
+-- interleaved_local_execution.sql
+--
+-- Test executing the local tasks of a query while waiting for its remote
+-- tasks, when the coordinator has shards.
+--
+
+CREATE SCHEMA interleaved_local_execution;
+SET search_path TO interleaved_local_execution;
+SET citus.next_shard_id TO 1923000;
+SET citus.shard_count TO 8;
+SET citus.shard_replication_factor TO 1;
+
+SELECT 1 FROM master_set_node_property('localhost', :master_port, 'shouldhaveshards', true);
+
+CREATE TABLE test (x int, y int);
+SELECT create_distributed_table('test', 'x');
+
+SELECT count(*) > 0 FROM pg_dist_shard JOIN pg_dist_placement USING (shardid)
+WHERE logicalrelid = 'test'::regclass AND groupid = 0;
+
+INSERT INTO test SELECT s, s FROM generate_series(1, 100) s;
+
+SET citus.enable_interleaved_local_execution TO on;
+
+-- multi-shard queries in transaction blocks execute the local tasks locally
+BEGIN;
+SELECT y FROM test WHERE x = 1;
+SELECT count(*), sum(y) FROM test;
+SELECT x FROM test ORDER BY x LIMIT 3;
+UPDATE test SET y = y + 1;
+SELECT sum(y) FROM test;
+SELECT count(*) FROM test WHERE y > 50;
+ROLLBACK;
+
+-- remote tasks that take a while
+BEGIN;
+SELECT y FROM test WHERE x = 1;
+SELECT count(*) FROM (SELECT pg_sleep(0.01), x FROM test) s;
+COMMIT;
+
+RESET citus.enable_interleaved_local_execution;
+
+-- rows of local tasks are stored straight from the executor slots
+CREATE TABLE wide (x int, y text);
+SELECT create_distributed_table('wide', 'x');
+INSERT INTO wide
+SELECT s, CASE WHEN s % 10 = 0 THEN NULL ELSE repeat('a', s) END
+FROM generate_series(1, 100) s;
+
+SELECT x, coalesce(length(y), 0) AS y_length FROM wide WHERE x IN (9, 10, 11) ORDER BY x;
+SELECT count(*) AS row_count, count(y) AS y_count, sum(length(y)) AS y_length
+FROM (SELECT * FROM wide OFFSET 0) s;
+
+-- the size of the locally stored rows counts towards the limit
+SET citus.max_intermediate_result_size TO 2;
+SELECT count(*) FROM (SELECT * FROM wide OFFSET 0) s;
+RESET citus.max_intermediate_result_size;
+
+SET citus.enable_local_execution_slot_tuples TO off;
+SELECT x, coalesce(length(y), 0) AS y_length FROM wide WHERE x IN (9, 10, 11) ORDER BY x;
+SELECT count(*) AS row_count, count(y) AS y_count, sum(length(y)) AS y_length
+FROM (SELECT * FROM wide OFFSET 0) s;
+RESET citus.enable_local_execution_slot_tuples;
+
+SELECT 1 FROM master_set_node_property('localhost', :master_port, 'shouldhaveshards', false);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA interleaved_local_execution CASCADE;
@@ -0,0 +1,42 @@
+--
+-- intermediate_result_compression.sql
+--
+-- Test compressing intermediate results that are sent between nodes.
+--
+
+CREATE SCHEMA intermediate_result_compression;
+SET search_path TO intermediate_result_compression;
+SET citus.next_shard_id TO 1926000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int, b text);
+SELECT create_distributed_table('dist_table', 'a');
+INSERT INTO dist_table SELECT s, repeat(md5(s::text), 10) FROM generate_series(1, 5000) s;
+
+SET citus.intermediate_result_compression TO lz4;
+
+-- the CTE result is broadcast to the workers in compressed frames
+WITH cte AS MATERIALIZED (SELECT a, b FROM dist_table ORDER BY a LIMIT 4000)
+SELECT count(*), count(DISTINCT cte.b) FROM cte JOIN dist_table USING (a);
+
+-- results are fetched in compressed frames as well
+BEGIN;
+SELECT broadcast_intermediate_result('wide_rows', $$SELECT s, repeat(md5(s::text), 20) FROM generate_series(1, 5000) s$$);
+SELECT fetch_intermediate_results(ARRAY['wide_rows']::text[], 'localhost', :worker_1_port) > 0 AS fetched;
+SELECT count(*), sum(x), count(DISTINCT y) FROM read_intermediate_result('wide_rows', 'binary') AS res (x int, y text);
+END;
+
+-- empty results
+BEGIN;
+SELECT broadcast_intermediate_result('empty', 'SELECT s FROM generate_series(1, 0) s');
+SELECT fetch_intermediate_results(ARRAY['empty']::text[], 'localhost', :worker_2_port);
+SELECT count(*) FROM read_intermediate_result('empty', 'binary') AS res (x int);
+END;
+
+RESET citus.intermediate_result_compression;
+WITH cte AS MATERIALIZED (SELECT a, b FROM dist_table ORDER BY a LIMIT 4000)
+SELECT count(*), count(DISTINCT cte.b) FROM cte JOIN dist_table USING (a);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA intermediate_result_compression CASCADE;
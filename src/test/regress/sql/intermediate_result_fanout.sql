@@ -0,0 +1,49 @@
+--
+-- intermediate_result_fanout.sql
+--
+-- Test broadcasting intermediate results to a few workers that forward them
+-- to the other workers.
+--
+
+CREATE SCHEMA intermediate_result_fanout;
+SET search_path TO intermediate_result_fanout;
+SET citus.next_shard_id TO 1937000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE dist_table(a int, b int);
+SELECT create_distributed_table('dist_table', 'a');
+
+INSERT INTO dist_table SELECT i, i % 10 FROM generate_series(1, 1000) i;
+
+SET citus.intermediate_result_broadcast_fanout TO 1;
+
+-- the coordinator sends the result to one worker, the other fetches it
+WITH top_rows AS MATERIALIZED (SELECT a, b FROM dist_table ORDER BY a DESC LIMIT 20)
+SELECT count(*), sum(top_rows.b) FROM dist_table JOIN top_rows USING (a);
+
+-- empty results are forwarded as well
+WITH no_rows AS MATERIALIZED (SELECT a, b FROM dist_table WHERE b > 10 ORDER BY a LIMIT 5)
+SELECT count(*) FROM dist_table JOIN no_rows USING (a);
+
+-- forwarding within a transaction block, after a modification
+BEGIN;
+INSERT INTO dist_table VALUES (1001, 1);
+WITH top_rows AS MATERIALIZED (SELECT a, b FROM dist_table ORDER BY a DESC LIMIT 20)
+SELECT count(*), sum(top_rows.b) FROM dist_table JOIN top_rows USING (a);
+ROLLBACK;
+
+-- forwarding compressed results
+SET citus.intermediate_result_compression TO lz4;
+WITH top_rows AS MATERIALIZED (SELECT a, b FROM dist_table ORDER BY a DESC LIMIT 20)
+SELECT count(*), sum(top_rows.b) FROM dist_table JOIN top_rows USING (a);
+RESET citus.intermediate_result_compression;
+
+-- a fanout that covers all workers sends the result to every worker directly
+SET citus.intermediate_result_broadcast_fanout TO 2;
+WITH top_rows AS MATERIALIZED (SELECT a, b FROM dist_table ORDER BY a DESC LIMIT 20)
+SELECT count(*), sum(top_rows.b) FROM dist_table JOIN top_rows USING (a);
+
+RESET citus.intermediate_result_broadcast_fanout;
+SET client_min_messages TO WARNING;
+DROP SCHEMA intermediate_result_fanout CASCADE;
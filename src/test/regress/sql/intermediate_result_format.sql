@@ -0,0 +1,66 @@
+--
+-- intermediate_result_format.sql
+--
+-- Test writing intermediate results in the column-oriented format.
+--
+
+CREATE SCHEMA intermediate_result_format;
+SET search_path TO intermediate_result_format;
+SET citus.next_shard_id TO 1931000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+-- composite types are stored in text format
+CREATE TYPE pair AS (x int, y text);
+
+CREATE TABLE dist_table (a int, b text, c pair);
+SELECT create_distributed_table('dist_table', 'a');
+INSERT INTO dist_table SELECT s, repeat(md5(s::text), 10), (s, md5(s::text))::pair FROM generate_series(1, 25000) s;
+
+SET citus.intermediate_result_format TO columnar;
+SET citus.intermediate_result_compression TO lz4;
+
+-- the CTE result is broadcast to the workers in the column-oriented format
+WITH cte AS MATERIALIZED (SELECT a, b, c FROM dist_table ORDER BY a LIMIT 20000)
+SELECT count(*), count(DISTINCT cte.b), sum((cte.c).x) FROM cte JOIN dist_table USING (a);
+
+BEGIN;
+SELECT create_intermediate_result('columns', $$SELECT s AS x, md5(s::text) AS y, CASE WHEN s % 2 = 0 THEN NULL ELSE (s, 'odd')::pair END AS z FROM generate_series(1, 15000) s$$);
+
+-- the full column definition list matches columns by position
+SELECT count(*), sum(x), count(y), count(z) FROM read_intermediate_result('columns', 'binary') AS res (x int, y text, z pair);
+
+-- a shorter column definition list only reads the columns with those names
+SELECT count(*), sum((z).x) FROM read_intermediate_result('columns', 'text') AS res (z pair);
+SELECT * FROM read_intermediate_result('columns', 'binary') AS res (y text, x int) ORDER BY x LIMIT 2;
+
+SAVEPOINT s1;
+SELECT * FROM read_intermediate_result('columns', 'binary') AS res (w int);
+ROLLBACK TO SAVEPOINT s1;
+SELECT * FROM read_intermediate_result('columns', 'binary') AS res (x int, y int, z pair);
+ROLLBACK TO SAVEPOINT s1;
+SELECT * FROM read_intermediate_result('columns', 'binary') AS res (x int, y text, z pair, w int);
+ROLLBACK TO SAVEPOINT s1;
+
+-- empty results
+SELECT create_intermediate_result('empty', 'SELECT s FROM generate_series(1, 0) s');
+SELECT count(*) FROM read_intermediate_result('empty', 'binary') AS res (s int);
+
+-- column chunks can be stored uncompressed
+SET LOCAL citus.intermediate_result_compression TO none;
+SELECT create_intermediate_result('uncompressed', $$SELECT s, s * 2 AS t FROM generate_series(1, 100) s$$);
+SELECT sum(t) FROM read_intermediate_result('uncompressed', 'binary') AS res (t int);
+
+-- results in COPY format can be read together with column-oriented results
+SET LOCAL citus.intermediate_result_format TO copy;
+SELECT create_intermediate_result('copy_rows', $$SELECT s, s * 2 AS t FROM generate_series(1, 100) s$$);
+SELECT count(*), sum(t) FROM read_intermediate_result_array(ARRAY['uncompressed', 'copy_rows'], 'binary') AS res (s int, t int);
+END;
+
+RESET citus.intermediate_result_format;
+RESET citus.intermediate_result_compression;
+WITH cte AS MATERIALIZED (SELECT a, b, c FROM dist_table ORDER BY a LIMIT 20000)
+SELECT count(*), count(DISTINCT cte.b), sum((cte.c).x) FROM cte JOIN dist_table USING (a);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA intermediate_result_format CASCADE;
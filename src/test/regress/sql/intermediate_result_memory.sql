@@ -0,0 +1,57 @@
+--
+-- intermediate_result_memory.sql
+--
+-- Test keeping small intermediate results in shared memory.
+--
+
+CREATE SCHEMA intermediate_result_memory;
+SET search_path TO intermediate_result_memory;
+SET citus.next_shard_id TO 1932000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int, b text);
+SELECT create_distributed_table('dist_table', 'a');
+INSERT INTO dist_table SELECT s, md5(s::text) FROM generate_series(1, 1000) s;
+
+SET citus.intermediate_result_memory_threshold TO '64kB';
+
+-- the CTE result is small enough to be kept in memory on the workers
+WITH cte AS MATERIALIZED (SELECT a, b FROM dist_table ORDER BY a LIMIT 500)
+SELECT count(*), sum(a) FROM cte JOIN dist_table USING (a, b);
+
+BEGIN;
+-- a small result stays in memory, a large one spills to a file
+SELECT create_intermediate_result('small', 'SELECT s AS x, md5(s::text) AS y FROM generate_series(1, 100) s');
+SELECT create_intermediate_result('large', 'SELECT s AS x, md5(s::text) AS y FROM generate_series(1, 50000) s');
+
+SELECT count(*), sum(x) FROM read_intermediate_result('small', 'binary') AS res (x int, y text);
+SELECT count(*), sum(x) FROM read_intermediate_result('large', 'binary') AS res (x int, y text);
+SELECT count(*), sum(x) FROM read_intermediate_result_array(ARRAY['small', 'large'], 'binary') AS res (x int, y text);
+
+-- overwriting a result replaces the copy in memory
+SELECT create_intermediate_result('small', 'SELECT s AS x, md5(s::text) AS y FROM generate_series(1, 10) s');
+SELECT count(*), sum(x) FROM read_intermediate_result('small', 'binary') AS res (x int, y text);
+
+-- results in the column-oriented format can be kept in memory as well
+SET LOCAL citus.intermediate_result_format TO columnar;
+SELECT create_intermediate_result('columns', 'SELECT s AS x, md5(s::text) AS y FROM generate_series(1, 100) s');
+SELECT count(*), sum(x) FROM read_intermediate_result('columns', 'binary') AS res (x int, y text);
+END;
+
+-- the results are gone after the transaction
+SELECT count(*) FROM read_intermediate_result('small', 'binary') AS res (x int, y text);
+
+-- the partitions of a query result are kept in memory too, the large one spills
+BEGIN;
+SELECT partition_index, rows_written FROM worker_partition_query_result('parts',
+    'SELECT s FROM generate_series(1, 50000) s', 0, 'range',
+    '{1,101}'::text[], '{100,50000}'::text[], true) ORDER BY 1;
+SELECT count(*), sum(x) FROM read_intermediate_result('parts_0', 'binary') AS res (x int);
+SELECT count(*), sum(x) FROM read_intermediate_result('parts_1', 'binary') AS res (x int);
+END;
+
+RESET citus.intermediate_result_memory_threshold;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA intermediate_result_memory CASCADE;
@@ -0,0 +1,60 @@
+--
+-- limit_early_termination.sql
+--
+-- Test cancelling the remaining tasks of multi-shard queries with a LIMIT
+-- once enough rows were received.
+--
+CREATE SCHEMA limit_early_termination;
+SET search_path TO limit_early_termination;
+
+SET citus.next_shard_id TO 1904000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE dist_table(key int, value int);
+SELECT create_distributed_table('dist_table', 'key');
+
+-- key 1 is the only row in its shard, such that filtering on it is slow
+INSERT INTO dist_table
+SELECT i, i FROM generate_series(1, 100) i
+WHERE i = 1 OR get_shard_id_for_distribution_column('dist_table', i) <>
+               get_shard_id_for_distribution_column('dist_table', 1);
+
+CREATE FUNCTION query_duration(query text)
+RETURNS interval LANGUAGE plpgsql AS $$
+DECLARE
+  start_time timestamptz := clock_timestamp();
+BEGIN
+  EXECUTE query;
+  RETURN clock_timestamp() - start_time;
+END;
+$$;
+
+-- disabled by default, we wait for the slow task
+SELECT query_duration('SELECT key FROM dist_table WHERE key <> 1 OR pg_sleep(3) IS NOT NULL LIMIT 1') >= '3s';
+
+SET citus.enable_limit_early_termination TO on;
+
+SELECT query_duration('SELECT key FROM dist_table WHERE key <> 1 OR pg_sleep(3) IS NOT NULL LIMIT 1') < '2s';
+SELECT query_duration('SELECT key FROM dist_table WHERE key <> 1 OR pg_sleep(3) IS NOT NULL LIMIT 2 OFFSET 3') < '2s';
+
+-- the cancelled tasks do not affect later queries
+SELECT count(*) FROM dist_table WHERE key = 1;
+
+SELECT count(*) FROM (SELECT key FROM dist_table LIMIT 5) limited;
+SELECT count(*) FROM (SELECT key FROM dist_table LIMIT 5 OFFSET 10) limited;
+
+-- all rows are needed with ORDER BY
+SELECT query_duration('SELECT key FROM dist_table WHERE key <> 1 OR pg_sleep(3) IS NOT NULL ORDER BY key LIMIT 1') >= '3s';
+SELECT array_agg(key) FROM (SELECT key FROM dist_table ORDER BY key LIMIT 1) limited;
+
+-- tasks are not cancelled in transaction blocks that use remote transactions
+BEGIN;
+INSERT INTO dist_table VALUES (1000, 1000);
+SELECT query_duration('SELECT key FROM dist_table WHERE key <> 1 OR pg_sleep(3) IS NOT NULL LIMIT 1') >= '3s';
+ROLLBACK;
+
+RESET citus.enable_limit_early_termination;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA limit_early_termination CASCADE;
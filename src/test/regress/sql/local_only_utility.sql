@@ -0,0 +1,32 @@
+--
+-- local_only_utility.sql
+--
+-- Test that utility statements which cannot affect distributed objects skip
+-- the distributed processing.
+--
+
+CREATE SCHEMA local_only_utility;
+SET search_path TO local_only_utility;
+SET citus.next_shard_id TO 1944000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int, b text);
+SELECT create_distributed_table('dist_table', 'a');
+
+SET client_min_messages TO DEBUG4;
+SHOW citus.shard_count;
+CHECKPOINT;
+CREATE TEMP TABLE temp_table (a int, b text);
+RESET client_min_messages;
+
+-- inheriting from a distributed table still goes through the regular path
+CREATE TEMP TABLE temp_child () INHERITS (dist_table);
+
+-- the temporary table is usable alongside the distributed table
+INSERT INTO temp_table VALUES (1, 'one');
+INSERT INTO dist_table SELECT * FROM temp_table;
+SELECT a, b FROM dist_table ORDER BY a;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA local_only_utility CASCADE;
@@ -0,0 +1,83 @@
+--
+-- local_plan_cache.sql
+--
+-- Test caching the local plans of prepared statements whose shards are on
+-- the local node.
+--
+CREATE SCHEMA local_plan_cache;
+SET search_path TO local_plan_cache;
+
+SET citus.next_shard_id TO 1897000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE test(key int, value int);
+SELECT create_distributed_table('test', 'key');
+INSERT INTO test SELECT i, i * 10 FROM generate_series(1, 100) i;
+
+CREATE TABLE target(key int, value int);
+SELECT create_distributed_table('target', 'key');
+
+-- the shards don't have the dropped column of the table
+CREATE TABLE dropped(key int, dropped int, value int);
+ALTER TABLE dropped DROP COLUMN dropped;
+SELECT create_distributed_table('dropped', 'key');
+INSERT INTO dropped SELECT i, i * 10 FROM generate_series(1, 100) i;
+
+\c - - - :worker_1_port
+SET search_path TO local_plan_cache;
+SET plan_cache_mode TO force_generic_plan;
+
+-- fast path queries, some of whose shards are local
+PREPARE fast_path_select(int) AS SELECT value FROM test WHERE key = $1;
+EXECUTE fast_path_select(1);
+EXECUTE fast_path_select(1);
+EXECUTE fast_path_select(1);
+EXECUTE fast_path_select(2);
+EXECUTE fast_path_select(3);
+EXECUTE fast_path_select(4);
+EXECUTE fast_path_select(5);
+
+PREPARE fast_path_update(int, int) AS
+UPDATE test SET value = value + $2 WHERE key = $1 RETURNING *;
+EXECUTE fast_path_update(1, 1);
+EXECUTE fast_path_update(1, 1);
+EXECUTE fast_path_update(2, 1);
+EXECUTE fast_path_update(3, 1);
+EXECUTE fast_path_update(4, 1);
+EXECUTE fast_path_update(5, 1);
+
+-- the queries on shards with different columns are planned once as well
+PREPARE dropped_select(int) AS SELECT * FROM dropped WHERE key = $1;
+EXECUTE dropped_select(1);
+EXECUTE dropped_select(1);
+EXECUTE dropped_select(2);
+EXECUTE dropped_select(3);
+EXECUTE dropped_select(4);
+EXECUTE dropped_select(5);
+
+-- multi-shard queries use local execution in transaction blocks
+PREPARE multi_shard_select(int) AS
+SELECT count(*), sum(value) FROM test WHERE value > $1;
+
+BEGIN;
+EXECUTE fast_path_select(1);
+EXECUTE multi_shard_select(100);
+EXECUTE multi_shard_select(100);
+EXECUTE multi_shard_select(500);
+COMMIT;
+
+PREPARE insert_select(int) AS
+INSERT INTO target SELECT key, value + $1 FROM test WHERE key > 50;
+
+BEGIN;
+EXECUTE fast_path_select(1);
+EXECUTE insert_select(1);
+EXECUTE insert_select(2);
+EXECUTE insert_select(3);
+SELECT count(*), sum(value) FROM target;
+ROLLBACK;
+
+\c - - - :master_port
+SET client_min_messages TO WARNING;
+DROP SCHEMA local_plan_cache CASCADE;
@@ -0,0 +1,58 @@
+--
+-- local_table_join_cost.sql
+--
+-- Test that the cost-based local table join policy converts the tables whose
+-- filtered rows take fewer bytes to move, using the cached shard sizes.
+--
+CREATE SCHEMA local_table_join_cost;
+SET search_path TO local_table_join_cost;
+
+SET citus.next_shard_id TO 1915000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE large_local (key int, value text);
+INSERT INTO large_local SELECT i, 'value ' || i FROM generate_series(1, 20000) i;
+ANALYZE large_local;
+
+CREATE TABLE small_local (key int, value text);
+INSERT INTO small_local SELECT i, 'value ' || i FROM generate_series(1, 10) i;
+ANALYZE small_local;
+
+CREATE TABLE small_dist (key int, value text);
+SELECT create_distributed_table('small_dist', 'key');
+INSERT INTO small_dist SELECT i, 'value ' || i FROM generate_series(1, 10) i;
+
+CREATE TABLE large_dist (key int, value text);
+SELECT create_distributed_table('large_dist', 'key');
+INSERT INTO large_dist SELECT i, 'value ' || i FROM generate_series(1, 20000) i;
+
+SELECT citus_refresh_shard_size_cache('small_dist');
+SELECT citus_refresh_shard_size_cache('large_dist');
+
+SET client_min_messages TO DEBUG1;
+
+-- auto converts the large local table, since there is no filter on a unique column
+SELECT count(*) FROM large_local JOIN small_dist USING (key);
+
+SET citus.local_table_join_policy TO 'cost-based';
+
+-- the small distributed table is cheaper to move
+SELECT count(*) FROM large_local JOIN small_dist USING (key);
+
+-- the small local table is cheaper to move
+SELECT count(*) FROM small_local JOIN large_dist USING (key);
+
+-- filters on the local table are taken into account
+SELECT count(*) FROM large_local JOIN large_dist USING (key) WHERE large_local.key < 5;
+
+-- without recent shard sizes, the decision falls back to auto
+SET citus.shard_size_cache_max_age TO 0;
+SELECT count(*) FROM large_local JOIN small_dist USING (key);
+
+RESET citus.shard_size_cache_max_age;
+RESET citus.local_table_join_policy;
+RESET client_min_messages;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA local_table_join_cost CASCADE;
@@ -0,0 +1,54 @@
+--
+-- many_joins_pushdown.sql
+--
+-- Test the distribution key equality checks of queries that join many
+-- distributed tables.
+--
+CREATE SCHEMA many_joins_pushdown;
+SET search_path TO many_joins_pushdown;
+
+SET citus.next_shard_id TO 1899000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE test(key int, value int);
+SELECT create_distributed_table('test', 'key');
+INSERT INTO test SELECT i, i % 10 FROM generate_series(1, 100) i;
+
+-- the distribution keys are equal through a chain of joins
+SELECT count(*), sum(t1.value) FROM (
+  SELECT t1.* FROM test t1
+  JOIN test t2 ON (t1.key = t2.key)
+  JOIN test t3 ON (t2.key = t3.key)
+  JOIN test t4 ON (t3.key = t4.key)
+  JOIN test t5 ON (t4.key = t5.key)
+  JOIN test t6 ON (t5.key = t6.key)
+  JOIN test t7 ON (t6.key = t7.key)
+  JOIN test t8 ON (t7.key = t8.key)
+  JOIN test t9 ON (t8.key = t9.key)
+  JOIN test t10 ON (t9.key = t10.key)
+  JOIN test t11 ON (t10.key = t11.key)
+  JOIN test t12 ON (t11.key = t12.key)
+  JOIN test t13 ON (t12.key = t13.key)
+  JOIN test t14 ON (t13.key = t14.key)
+  JOIN test t15 ON (t14.key = t15.key)
+  JOIN test t16 ON (t15.key = t16.key)
+  JOIN test t17 ON (t16.key = t17.key)
+  JOIN test t18 ON (t17.key = t18.key)
+  JOIN test t19 ON (t18.key = t19.key)
+  JOIN test t20 ON (t19.key = t20.key)
+  JOIN test t21 ON (t20.key = t21.key)
+  JOIN test t22 ON (t21.key = t22.key)
+  JOIN test t23 ON (t22.key = t23.key)
+  JOIN test t24 ON (t23.key = t24.key)
+  LIMIT 1000) t1;
+
+-- the same equalities given in reverse order of the joins
+SELECT count(*) FROM (
+  SELECT t1.key FROM test t1, test t2, test t3, test t4, test t5, test t6
+  WHERE t5.key = t6.key AND t4.key = t5.key AND t3.key = t4.key AND
+        t2.key = t3.key AND t1.key = t2.key
+  OFFSET 0) sub1 JOIN test USING (key);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA many_joins_pushdown CASCADE;
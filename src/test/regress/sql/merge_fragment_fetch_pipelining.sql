@@ -0,0 +1,74 @@
+SHOW server_version \gset
+SELECT substring(:'server_version', '\d+')::int >= 15 AS server_version_ge_15
+\gset
+\if :server_version_ge_15
+\else
+\q
+\endif
+--
+-- merge_fragment_fetch_pipelining.sql
+--
+-- Test MERGE commands whose repartitioned source rows are fetched by the
+-- MERGE tasks of the target shards rather than in a separate phase.
+--
+CREATE SCHEMA merge_fragment_fetch_pipelining;
+SET search_path TO merge_fragment_fetch_pipelining;
+
+SET citus.next_shard_id TO 1912000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE target(id int PRIMARY KEY, val int);
+CREATE TABLE source(id int, target_id int, val int);
+SELECT create_distributed_table('target', 'id');
+SELECT create_distributed_table('source', 'id');
+
+INSERT INTO target SELECT i, 0 FROM generate_series(1, 50) i;
+INSERT INTO source SELECT i, 101 - i, i FROM generate_series(1, 100) i;
+
+SET citus.enable_merge_fragment_fetch_pipelining TO on;
+
+-- the source is joined on a column other than its distribution column, so it is repartitioned
+MERGE INTO target t
+USING source s ON t.id = s.target_id
+WHEN MATCHED THEN UPDATE SET val = t.val + s.val
+WHEN NOT MATCHED THEN INSERT VALUES (s.target_id, s.val);
+SELECT count(*), sum(val) FROM target;
+
+MERGE INTO target t
+USING (SELECT target_id, val FROM source WHERE val % 2 = 0) s ON t.id = s.target_id
+WHEN MATCHED THEN DELETE;
+SELECT count(*), sum(val) FROM target;
+
+-- the fetched fragments are only visible to the MERGE of the transaction block
+BEGIN;
+MERGE INTO target t
+USING (SELECT target_id, val FROM source) s ON t.id = s.target_id
+WHEN MATCHED THEN UPDATE SET val = t.val - s.val
+WHEN NOT MATCHED THEN INSERT VALUES (s.target_id, 0);
+SELECT count(*), sum(val) FROM target;
+ROLLBACK;
+
+-- MERGE commands with parameters fetch the source rows in a separate phase
+PREPARE merge_with_param(int) AS
+MERGE INTO target t
+USING source s ON t.id = s.target_id
+WHEN MATCHED THEN UPDATE SET val = $1
+WHEN NOT MATCHED THEN INSERT VALUES (s.target_id, $1);
+EXECUTE merge_with_param(7);
+SELECT count(*), sum(val) FROM target;
+
+-- the same MERGE on a target with replicated shards fetches in a separate phase as well
+SET citus.shard_replication_factor TO 2;
+CREATE TABLE replicated_target(id int PRIMARY KEY, val int);
+SELECT create_distributed_table('replicated_target', 'id', colocate_with => 'none');
+INSERT INTO replicated_target SELECT i, 0 FROM generate_series(1, 50) i;
+MERGE INTO replicated_target t
+USING source s ON t.id = s.target_id
+WHEN MATCHED THEN UPDATE SET val = t.val + s.val
+WHEN NOT MATCHED THEN INSERT VALUES (s.target_id, s.val);
+SELECT count(*), sum(val) FROM replicated_target;
+
+RESET citus.enable_merge_fragment_fetch_pipelining;
+SET client_min_messages TO warning;
+DROP SCHEMA merge_fragment_fetch_pipelining CASCADE;
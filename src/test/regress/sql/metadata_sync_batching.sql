@@ -0,0 +1,54 @@
+--
+-- metadata_sync_batching.sql
+--
+-- Test sending the metadata of several catalog entries in a single command
+-- when activating a node.
+--
+
+CREATE SCHEMA metadata_sync_batching;
+SET search_path TO metadata_sync_batching;
+SET citus.next_shard_id TO 1939000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE ref_table(a int PRIMARY KEY);
+SELECT create_reference_table('ref_table');
+CREATE TABLE dist_table(a int PRIMARY KEY, b int REFERENCES ref_table(a));
+SELECT create_distributed_table('dist_table', 'a');
+CREATE TABLE colocated_table(a int REFERENCES dist_table(a), b int);
+SELECT create_distributed_table('colocated_table', 'a', colocate_with => 'dist_table');
+CREATE TYPE pair AS (x int, y int);
+CREATE TABLE other_table(a int, p pair);
+SELECT create_distributed_table('other_table', 'a', colocate_with => 'none');
+
+-- the batch size does not divide the number of entries
+SET citus.metadata_sync_batch_size TO 3;
+SELECT 1 FROM citus_activate_node('localhost', :worker_1_port);
+
+SET citus.metadata_sync_mode TO 'nontransactional';
+SELECT 1 FROM citus_activate_node('localhost', :worker_1_port);
+RESET citus.metadata_sync_mode;
+RESET citus.metadata_sync_batch_size;
+
+\c - - - :worker_1_port
+SELECT logicalrelid::text, count(*) FROM pg_dist_shard
+WHERE logicalrelid::text LIKE 'metadata_sync_batching.%'
+GROUP BY 1 ORDER BY 1;
+
+SELECT count(DISTINCT shardid) FROM pg_dist_placement JOIN pg_dist_shard USING (shardid)
+WHERE logicalrelid::text LIKE 'metadata_sync_batching.%';
+
+SELECT conname FROM pg_constraint
+WHERE conrelid = 'metadata_sync_batching.colocated_table'::regclass
+ORDER BY 1;
+
+INSERT INTO metadata_sync_batching.ref_table VALUES (1);
+INSERT INTO metadata_sync_batching.dist_table VALUES (1, 1);
+INSERT INTO metadata_sync_batching.colocated_table VALUES (1, 1);
+INSERT INTO metadata_sync_batching.other_table VALUES (1, (1, 2));
+SELECT * FROM metadata_sync_batching.dist_table JOIN metadata_sync_batching.colocated_table USING (a);
+SELECT (p).y FROM metadata_sync_batching.other_table;
+
+\c - - - :master_port
+SET client_min_messages TO WARNING;
+DROP SCHEMA metadata_sync_batching CASCADE;
@@ -791,4 +791,18 @@ SELECT * FROM copy_jsonb ORDER BY key;
 red	{"r":255,"g":0,"b":0
 \.
 
+-- JSONB syntax validation only: should also see line number
+SET citus.validate_jsonb_syntax_only_in_copy TO on;
+\COPY copy_jsonb (key, value) FROM STDIN
+red	{"r":255,"g":0,"b":0}
+white	{"r":255, "g":255, "b":255}
+\.
+SELECT * FROM copy_jsonb ORDER BY key;
+
+\COPY copy_jsonb (key, value) FROM STDIN
+red	{"r":255,"g":0,"b":0}
+red	{"r":255,"g":0,"b":0
+\.
+RESET citus.validate_jsonb_syntax_only_in_copy;
+
 DROP TABLE copy_jsonb;
@@ -358,6 +358,45 @@ GROUP BY
 ORDER BY
   types;$$);
 
+-- rows are routed with an inline hash for the common distribution column
+-- types, which has to agree with their hash functions that worker_hash calls
+SET citus.shard_count TO 8;
+CREATE TABLE hash_routing_int4 (key int);
+SELECT create_distributed_table('hash_routing_int4', 'key');
+CREATE TABLE hash_routing_int8 (key bigint);
+SELECT create_distributed_table('hash_routing_int8', 'key');
+CREATE TABLE hash_routing_uuid (key uuid);
+SELECT create_distributed_table('hash_routing_uuid', 'key');
+CREATE TABLE hash_routing_text (key text);
+SELECT create_distributed_table('hash_routing_text', 'key');
+CREATE TABLE hash_routing_text_c (key text COLLATE "C");
+SELECT create_distributed_table('hash_routing_text_c', 'key');
+
+INSERT INTO hash_routing_int4 SELECT i * 1000000 FROM generate_series(-2000, 2000) i;
+INSERT INTO hash_routing_int8 SELECT i * 10000000000 FROM generate_series(-2000, 2000) i;
+INSERT INTO hash_routing_uuid SELECT md5(i::text)::uuid FROM generate_series(-2000, 2000) i;
+INSERT INTO hash_routing_text SELECT 'key ' || i FROM generate_series(-2000, 2000) i;
+INSERT INTO hash_routing_text_c SELECT 'key ' || i FROM generate_series(-2000, 2000) i;
+
+CREATE FUNCTION misrouted_shard_count(table_name regclass)
+RETURNS bigint
+LANGUAGE sql
+AS $$
+  SELECT count(*)
+  FROM run_command_on_shards(table_name, 'SELECT min(worker_hash(key)) || '','' || max(worker_hash(key)) FROM %s') r
+  JOIN pg_dist_shard USING (shardid)
+  WHERE split_part(r.result, ',', 1)::int < shardminvalue::int OR
+        split_part(r.result, ',', 2)::int > shardmaxvalue::int;
+$$;
+
+SELECT misrouted_shard_count('hash_routing_int4'), misrouted_shard_count('hash_routing_int8'),
+       misrouted_shard_count('hash_routing_uuid'), misrouted_shard_count('hash_routing_text'),
+       misrouted_shard_count('hash_routing_text_c');
+
+SELECT count(*) FROM hash_routing_int8 WHERE key = -20000000000000;
+SELECT count(*) FROM hash_routing_uuid WHERE key = md5('42')::uuid;
+SELECT count(*) FROM hash_routing_text_c WHERE key = 'key 42';
+
 -- clear unnecessary tables;
 SET client_min_messages TO ERROR;
 DROP SCHEMA metadata_test CASCADE;
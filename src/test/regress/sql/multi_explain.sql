@@ -708,6 +708,12 @@ SELECT * FROM worker_save_query_explain_analyze($Q$SELECT * FROM explain_analyze
 SELECT explain_analyze_output FROM worker_last_saved_explain_analyze();
 ROLLBACK;
 
+-- select from table, followed by a row with the explain analyze output
+SELECT a, b, explain_analyze_output IS NOT NULL AS has_explain
+FROM worker_explain_analyze_query($Q$SELECT * FROM explain_analyze_test$Q$, :default_opts)
+	 AS (a int, b text, explain_analyze_output text, execution_duration double precision);
+SELECT * FROM worker_explain_analyze_query('SELECT 1', :default_opts) as (a int);
+
 -- insert into with returning
 BEGIN;
 SELECT * FROM worker_save_query_explain_analyze($Q$
@@ -1105,6 +1111,17 @@ set citus.explain_analyze_sort_method to "taskId";
 EXPLAIN (COSTS FALSE, ANALYZE TRUE, TIMING FALSE, SUMMARY FALSE) select a, CASE WHEN pg_sleep(0.4) IS NULL THEN  'x' END from explain_analyze_execution_time;
 set citus.explain_analyze_sort_method to "execution-time";
 EXPLAIN (COSTS FALSE, ANALYZE TRUE, TIMING FALSE, SUMMARY FALSE) select a, CASE WHEN pg_sleep(0.4) IS NULL THEN  'x' END from explain_analyze_execution_time;
+-- summarize the execution of the tasks
+set citus.explain_analyze_sort_method to "taskId";
+set citus.explain_task_summary to on;
+EXPLAIN (COSTS FALSE, ANALYZE TRUE, TIMING FALSE, SUMMARY FALSE) select a from explain_analyze_execution_time;
+reset citus.explain_task_summary;
+-- log the distributed plan of slow queries along with the plan of the slowest task
+SET citus.log_distributed_plan_min_duration TO 0;
+SET client_min_messages TO log;
+SELECT a FROM explain_analyze_execution_time WHERE a = 2;
+RESET client_min_messages;
+RESET citus.log_distributed_plan_min_duration;
 -- reset back
 reset citus.explain_analyze_sort_method;
 DROP TABLE explain_analyze_execution_time;
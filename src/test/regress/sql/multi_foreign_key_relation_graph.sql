@@ -289,8 +289,8 @@ ORDER BY tablename;
 CREATE TABLE local_table_1 (col int unique);
 CREATE TABLE local_table_2 (col int unique);
 
--- show that we do not trigger updating foreign key graph when
--- defining/dropping foreign keys between postgres tables
+-- show that the foreign key graph follows the foreign keys between
+-- postgres tables as well
 
 ALTER TABLE local_table_1 ADD CONSTRAINT fkey_1 FOREIGN KEY (col) REFERENCES local_table_2(col);
 
@@ -253,6 +253,23 @@ call multi_mx_call.mx_call_proc(multi_mx_call.mx_call_add(3, 4), 2);
 -- volatile parameter cannot be pushed down
 call multi_mx_call.mx_call_proc(floor(random())::int, 2);
 
+-- Test calling a procedure for many distribution arguments in a batch
+SET client_min_messages TO WARNING;
+CREATE PROCEDURE mx_call_proc_batch(x int, y int) LANGUAGE plpgsql AS $$
+BEGIN
+    INSERT INTO multi_mx_call.mx_call_dist_table_2 VALUES (x, y);
+END;$$;
+select create_distributed_function('mx_call_proc_batch(int,int)', '$1', 'mx_call_dist_table_2');
+select citus_call_procedure_batch('mx_call_proc_batch(int,int)',
+                                  ARRAY[['40','1'],['41','2'],['42','3'],['43',NULL]]);
+select id, val from mx_call_dist_table_2 where id >= 40 order by id;
+select citus_call_procedure_batch('mx_call_proc_batch(int,int)', ARRAY[['44']]);
+select citus_call_procedure_batch('mx_call_proc_batch(int,int)', ARRAY[[NULL,'1']]);
+select citus_call_procedure_batch('mx_call_add(int,int)', ARRAY[['44','1']]);
+BEGIN;
+select citus_call_procedure_batch('mx_call_proc_batch(int,int)', ARRAY[['44','1']]);
+ROLLBACK;
+
 reset client_min_messages;
 \set VERBOSITY terse
 drop schema multi_mx_call cascade;
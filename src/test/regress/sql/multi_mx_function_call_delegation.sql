@@ -206,6 +206,22 @@ select create_distributed_function('mx_call_func_raise(int)', '$1', 'mx_call_dis
 \set VERBOSITY terse
 select mx_call_func_raise(2);
 \set VERBOSITY default
+-- Test that dropping the table a function is co-located with is noticed
+SET client_min_messages TO ERROR;
+CREATE TABLE mx_call_dist_table_dropped (id int);
+select create_distributed_table('mx_call_dist_table_dropped', 'id', colocate_with := 'none');
+CREATE FUNCTION mx_call_func_dropped(x int)
+RETURNS int LANGUAGE plpgsql AS $$
+BEGIN
+    RETURN x;
+END;$$;
+select create_distributed_function('mx_call_func_dropped(int)', '$1', 'mx_call_dist_table_dropped');
+SET client_min_messages TO DEBUG1;
+select mx_call_func_dropped(2);
+SET client_min_messages TO ERROR;
+DROP TABLE mx_call_dist_table_dropped;
+SET client_min_messages TO DEBUG1;
+select mx_call_func_dropped(2);
 -- Don't push-down when doing INSERT INTO ... SELECT func();
 SET client_min_messages TO ERROR;
 CREATE TABLE test (x int primary key);
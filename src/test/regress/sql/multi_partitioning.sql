@@ -940,6 +940,12 @@ SELECT * FROM partitioning_locks WHERE id = 1 ORDER BY 1, 2;
 SELECT relation::regclass, locktype, mode FROM pg_locks WHERE relation::regclass::text LIKE 'partitioning_locks%' AND pid = pg_backend_pid() ORDER BY 1, 2, 3;
 COMMIT;
 
+-- test locks on router SELECT that prunes partitions
+BEGIN;
+SELECT * FROM partitioning_locks WHERE id = 1 AND time >= '2010-01-01' ORDER BY 1, 2;
+SELECT relation::regclass, locktype, mode FROM pg_locks WHERE relation::regclass::text LIKE 'partitioning_locks%' AND pid = pg_backend_pid() ORDER BY 1, 2, 3;
+COMMIT;
+
 -- test locks on real-time SELECT
 BEGIN;
 SELECT * FROM partitioning_locks ORDER BY 1, 2;
@@ -963,6 +969,12 @@ UPDATE partitioning_locks SET time = '2009-02-01' WHERE id = 1;
 SELECT relation::regclass, locktype, mode FROM pg_locks WHERE relation::regclass::text LIKE 'partitioning_locks%' AND pid = pg_backend_pid() ORDER BY 1, 2, 3;
 COMMIT;
 
+-- test locks on UPDATE that prunes partitions
+BEGIN;
+UPDATE partitioning_locks SET ref_id = 2 WHERE id = 1 AND time < '2010-01-01';
+SELECT relation::regclass, locktype, mode FROM pg_locks WHERE relation::regclass::text LIKE 'partitioning_locks%' AND pid = pg_backend_pid() ORDER BY 1, 2, 3;
+COMMIT;
+
 -- test locks on DELETE
 BEGIN;
 DELETE FROM partitioning_locks WHERE id = 1;
@@ -1943,6 +1955,9 @@ SELECT partition FROM time_partitions WHERE parent_table = '"test !/ \n _dist_12
 CALL drop_old_time_partitions('"test !/ \n _dist_123_table_exp"', '2021-01-01 12:00:00+00');
 SELECT partition FROM time_partitions WHERE parent_table = '"test !/ \n _dist_123_table_exp"'::regclass ORDER BY partition::text;
 
+-- only partition creation and table drops can be batched
+SELECT citus_execute_partition_commands(ARRAY['TRUNCATE "test !/ \n _dist_123_table_exp"']);
+
 \set VERBOSITY default
 DROP TABLE "test !/ \n _dist_123_table_exp";
 
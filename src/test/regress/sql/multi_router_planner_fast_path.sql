@@ -855,6 +855,27 @@ SELECT * FROM authors_reference ORDER BY 1, 2;
 
 SET client_min_messages to 'NOTICE';
 
+-- fast path queries are planned in a reused memory context, plans that
+-- outlive a single execution must not depend on it
+CREATE TABLE planning_context_test (key int, value text);
+SELECT create_distributed_table('planning_context_test', 'key');
+INSERT INTO planning_context_test VALUES (1, 'a'), (2, 'b');
+SELECT value FROM planning_context_test WHERE key = 1;
+UPDATE planning_context_test SET value = 'c' WHERE key = 2 RETURNING *;
+PREPARE planning_context_select(int) AS SELECT value FROM planning_context_test WHERE key = $1;
+EXECUTE planning_context_select(1);
+EXECUTE planning_context_select(2);
+EXECUTE planning_context_select(1);
+EXECUTE planning_context_select(2);
+EXECUTE planning_context_select(1);
+EXECUTE planning_context_select(2);
+EXECUTE planning_context_select(1);
+DEALLOCATE planning_context_select;
+SET citus.enable_fast_path_planning_context TO off;
+SELECT value FROM planning_context_test WHERE key = 2;
+RESET citus.enable_fast_path_planning_context;
+DROP TABLE planning_context_test;
+
 DROP FUNCTION author_articles_max_id();
 DROP FUNCTION author_articles_id_word_count();
 
@@ -0,0 +1,65 @@
+--
+-- multi_row_insert_copy.sql
+--
+-- Test executing multi-row INSERTs via COPY.
+--
+
+CREATE SCHEMA multi_row_insert_copy;
+SET search_path TO multi_row_insert_copy;
+SET citus.next_shard_id TO 1924000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int, b text DEFAULT 'default', c serial, d numeric);
+SELECT create_distributed_table('dist_table', 'a');
+CREATE TABLE ref_table (a int PRIMARY KEY, b text);
+SELECT create_reference_table('ref_table');
+
+SET citus.multi_row_insert_copy_threshold TO 2;
+
+-- constants, defaults, casts and NULLs
+INSERT INTO dist_table (a, b, d) VALUES (1, 'one', 1.5), (2, DEFAULT, '2.5'), (3, NULL, 3);
+INSERT INTO dist_table (a, d) VALUES (4, 4 * 1.5), (5, NULL);
+SELECT a, b, c, d FROM dist_table ORDER BY a;
+
+-- functions that are evaluated on the coordinator
+INSERT INTO dist_table (a, b) VALUES (6, upper('six')), (7, 'seven' || 7), (8, lower('EIGHT'));
+SELECT a, b FROM dist_table WHERE a > 5 ORDER BY a;
+
+-- parameters
+PREPARE insert_rows(int, text, int, text) AS
+INSERT INTO dist_table (a, b) VALUES ($1, $2), ($3, $4);
+EXECUTE insert_rows(9, 'nine', 10, 'ten');
+EXECUTE insert_rows(11, 'eleven', 12, 'twelve');
+SELECT a, b FROM dist_table WHERE a > 8 ORDER BY a;
+
+-- reference tables
+INSERT INTO ref_table VALUES (1, 'one'), (2, 'two'), (3, 'three');
+SELECT count(*) FROM ref_table;
+
+-- single rows are not affected
+INSERT INTO ref_table VALUES (4, 'four');
+
+-- RETURNING and ON CONFLICT use INSERT
+INSERT INTO ref_table VALUES (5, 'five'), (6, 'six') RETURNING a, b;
+INSERT INTO ref_table VALUES (6, 'SIX'), (7, 'seven') ON CONFLICT (a) DO UPDATE SET b = excluded.b;
+SELECT a, b FROM ref_table ORDER BY a;
+
+-- within a transaction block
+BEGIN;
+INSERT INTO dist_table (a, b) VALUES (13, 'thirteen'), (14, 'fourteen');
+SELECT count(*) FROM dist_table;
+INSERT INTO dist_table (a, b) VALUES (15, 'fifteen'), (16, 'sixteen');
+SELECT count(*) FROM dist_table;
+ROLLBACK;
+SELECT count(*) FROM dist_table;
+
+-- the number of rows below the threshold
+SET citus.multi_row_insert_copy_threshold TO 3;
+INSERT INTO dist_table (a, b) VALUES (17, 'seventeen'), (18, 'eighteen');
+SELECT count(*) FROM dist_table;
+
+RESET citus.multi_row_insert_copy_threshold;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA multi_row_insert_copy CASCADE;
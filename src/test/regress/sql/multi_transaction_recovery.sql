@@ -252,6 +252,23 @@ SELECT count(*) FROM pg_dist_transaction;
 ALTER SYSTEM RESET citus.recover_2pc_interval;
 SELECT pg_reload_conf();
 
+-- Test whether auto-recovery runs in a background worker of its own
+SELECT runs AS recovery_runs_before FROM citus_maintenance_daemon_duties()
+WHERE duty = '2pc_recovery' \gset
+INSERT INTO test_reference VALUES(3);
+SELECT count(*) > 0 FROM pg_dist_transaction;
+ALTER SYSTEM SET citus.recover_2pc_in_background_worker TO on;
+ALTER SYSTEM SET citus.recover_2pc_interval TO 10;
+SELECT pg_reload_conf();
+SELECT pg_sleep(1);
+SELECT count(*) FROM pg_dist_transaction;
+SELECT runs > :recovery_runs_before AS recovery_ran, last_duration >= 0 AS recovery_timed
+FROM citus_maintenance_daemon_duties() WHERE duty = '2pc_recovery';
+
+ALTER SYSTEM RESET citus.recover_2pc_in_background_worker;
+ALTER SYSTEM RESET citus.recover_2pc_interval;
+SELECT pg_reload_conf();
+
 DROP TABLE test_recovery_ref;
 DROP TABLE test_recovery;
 DROP TABLE test_recovery_single;
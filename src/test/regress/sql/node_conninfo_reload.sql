@@ -231,4 +231,16 @@ ALTER SYSTEM RESET citus.node_conninfo;
 select pg_reload_conf();
 select pg_sleep(0.1); -- wait for config reload to apply
 
+-- new connections use the resolved node addresses when enabled
+ALTER SYSTEM SET citus.cache_node_addresses TO on;
+SELECT pg_reload_conf();
+SELECT pg_sleep(0.1);
+\c - - - :master_port
+SET search_path TO node_conninfo_reload;
+SET citus.force_max_query_parallelization TO ON;
+SELECT COUNT(*)>=0 FROM test;
+ALTER SYSTEM RESET citus.cache_node_addresses;
+SELECT pg_reload_conf();
+SELECT pg_sleep(0.1);
+
 DROP SCHEMA node_conninfo_reload CASCADE;
@@ -0,0 +1,112 @@
+--
+-- node_latency_feedback.sql
+--
+-- Test opening connections based on the latencies of the nodes in earlier
+-- executions.
+--
+
+CREATE SCHEMA node_latency_feedback;
+SET search_path TO node_latency_feedback;
+SET citus.next_shard_id TO 1918000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 32;
+
+CREATE TABLE dist_table(a int, b int);
+SELECT create_distributed_table('dist_table', 'a');
+
+INSERT INTO dist_table SELECT i, i % 10 FROM generate_series(1, 1000) i;
+
+SET citus.enable_node_latency_feedback TO on;
+
+-- the first executions record the latencies of the nodes
+SELECT count(*), sum(a), sum(b) FROM dist_table;
+SELECT count(*), sum(a), sum(b) FROM dist_table WHERE pg_sleep(0.001) IS NOT NULL;
+
+-- later executions use them to open connections
+SELECT count(*), sum(a), sum(b) FROM dist_table;
+SELECT count(*), sum(a), sum(b) FROM dist_table WHERE pg_sleep(0.001) IS NOT NULL;
+SELECT b, count(*) FROM dist_table GROUP BY b ORDER BY b LIMIT 3;
+
+-- also with a short slow start interval and a small pool
+SET citus.executor_slow_start_interval TO 1;
+SET citus.max_adaptive_executor_pool_size TO 2;
+SELECT count(*), sum(a), sum(b) FROM dist_table WHERE pg_sleep(0.001) IS NOT NULL;
+RESET citus.max_adaptive_executor_pool_size;
+RESET citus.executor_slow_start_interval;
+
+-- modifications in a transaction block
+BEGIN;
+UPDATE dist_table SET b = b + 1;
+SELECT count(*), sum(a), sum(b) FROM dist_table;
+ROLLBACK;
+
+SELECT count(*), sum(a), sum(b) FROM dist_table;
+
+-- warming opens the connections that the session caches to each worker
+SET citus.max_cached_conns_per_worker TO 2;
+SELECT citus_warm_connections();
+SELECT citus_warm_connections();
+RESET citus.max_cached_conns_per_worker;
+
+-- the latencies include the warmed connections
+SELECT count(*) > 0, bool_and(task_count > 0), bool_and(connection_count > 0),
+       bool_and(avg_connection_establishment_time >= 0)
+FROM citus_node_latencies()
+WHERE nodeport IN (:worker_1_port, :worker_2_port);
+
+-- the maintenance daemon probes the health of the nodes when enabled
+ALTER SYSTEM SET citus.node_health_check_interval TO 100;
+SELECT pg_reload_conf();
+
+DO $$
+BEGIN
+    FOR i IN 1 .. 100 LOOP
+        EXIT WHEN (SELECT count(*) FROM citus_node_latencies()
+                   WHERE avg_probe_round_trip_time IS NOT NULL) >= 2;
+        PERFORM pg_sleep(0.1);
+    END LOOP;
+END;
+$$;
+
+SELECT bool_and(avg_probe_round_trip_time >= 0), bool_and(replication_lag = 0),
+       bool_and(NOT degraded)
+FROM citus_node_latencies()
+WHERE nodeport IN (:worker_1_port, :worker_2_port);
+
+ALTER SYSTEM RESET citus.node_health_check_interval;
+SELECT pg_reload_conf();
+
+-- reads from reference tables prefer healthy nodes
+CREATE TABLE ref_table(a int, b int);
+SELECT create_reference_table('ref_table');
+INSERT INTO ref_table VALUES (1, 2), (3, 4);
+
+SET citus.avoid_degraded_nodes TO on;
+SELECT * FROM ref_table WHERE a = 1;
+SELECT count(*) FROM ref_table;
+RESET citus.avoid_degraded_nodes;
+
+-- sampled executions leave traces of their remote tasks
+SET citus.task_execution_trace_sample_rate TO 1;
+SELECT count(*), sum(a), sum(b) FROM dist_table;
+RESET citus.task_execution_trace_sample_rate;
+
+SELECT count(DISTINCT shardid), bool_and(rows_received = 1), bool_and(bytes_received > 0),
+       bool_and(connection_acquire_time >= 0 AND send_time >= 0 AND
+                first_byte_time >= send_time AND receive_time >= 0)
+FROM citus_task_execution_traces()
+WHERE shardid BETWEEN 1918000 AND 1918031;
+
+-- sampled remote commands are recorded with their node, duration and bytes
+SET citus.remote_command_trace_sample_rate TO 1;
+SELECT count(*), sum(a), sum(b) FROM dist_table;
+RESET citus.remote_command_trace_sample_rate;
+
+SELECT count(*), bool_and(duration >= 0), bool_and(bytes_sent > 0),
+       bool_and(bytes_received > 0)
+FROM citus_remote_command_traces()
+WHERE pid = pg_backend_pid() AND command LIKE '%dist_table_1918%';
+
+RESET citus.enable_node_latency_feedback;
+SET client_min_messages TO WARNING;
+DROP SCHEMA node_latency_feedback CASCADE;
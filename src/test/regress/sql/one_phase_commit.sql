@@ -0,0 +1,53 @@
+--
+-- one_phase_commit.sql
+--
+-- Test committing transactions in which only a single node wrote in one phase.
+--
+
+CREATE SCHEMA one_phase_commit;
+SET search_path TO one_phase_commit;
+SET citus.next_shard_id TO 1940000;
+SET citus.shard_count TO 2;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE counters (id int PRIMARY KEY, value int);
+SELECT create_distributed_table('counters', 'id');
+INSERT INTO counters SELECT i, 0 FROM generate_series(1, 10) i;
+CREATE TABLE local_log (id int);
+
+-- put both shards on the first worker
+SELECT citus_move_shard_placement(1940001, 'localhost', :worker_2_port, 'localhost', :worker_1_port, 'block_writes');
+CALL citus_cleanup_orphaned_resources();
+
+-- modify both shards over a single connection
+SET citus.multi_shard_modify_mode TO 'sequential';
+
+-- a multi-shard modification uses 2PC by default
+SELECT count(*) AS transaction_records FROM pg_dist_transaction \gset
+UPDATE counters SET value = value + 1;
+SELECT count(*) - :transaction_records AS new_transaction_records FROM pg_dist_transaction;
+
+-- with only a single writer, commit in one phase
+SET citus.enable_one_phase_commit TO on;
+SELECT count(*) AS transaction_records FROM pg_dist_transaction \gset
+UPDATE counters SET value = value + 1;
+BEGIN;
+SELECT count(*) FROM counters;
+UPDATE counters SET value = value + 1;
+COMMIT;
+SELECT count(*) - :transaction_records AS new_transaction_records FROM pg_dist_transaction;
+
+-- a local write makes the coordinator a second writer, so 2PC is still used
+SELECT count(*) AS transaction_records FROM pg_dist_transaction \gset
+BEGIN;
+UPDATE counters SET value = value + 1;
+INSERT INTO local_log VALUES (1);
+COMMIT;
+SELECT count(*) - :transaction_records AS new_transaction_records FROM pg_dist_transaction;
+
+SELECT sum(value) FROM counters;
+
+RESET citus.enable_one_phase_commit;
+RESET citus.multi_shard_modify_mode;
+SET client_min_messages TO WARNING;
+DROP SCHEMA one_phase_commit CASCADE;
@@ -0,0 +1,87 @@
+--
+-- parallel_copy_from.sql
+--
+-- Test parsing the input of COPY .. FROM STDIN in parallel workers.
+--
+
+CREATE SCHEMA parallel_copy_from;
+SET search_path TO parallel_copy_from;
+SET citus.next_shard_id TO 1928000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int, b text, c int DEFAULT 7);
+SELECT create_distributed_table('dist_table', 'a');
+
+SET citus.parallel_copy_from_workers TO 2;
+
+COPY dist_table FROM STDIN;
+1	one	1
+2	two	2
+3	three	3
+4	four	\N
+5	five	5
+6	six	6
+\.
+
+COPY dist_table (a, b) FROM STDIN WITH (delimiter '|', null 'none');
+7|seven
+8|none
+\.
+
+SELECT * FROM dist_table ORDER BY a;
+
+COPY dist_table (a) FROM STDIN;
+9
+\.
+
+SELECT count(*), sum(a) FROM dist_table;
+
+-- csv input is parsed by the backend
+COPY dist_table FROM STDIN WITH (format csv);
+11,"eleven, csv",11
+\.
+
+-- so is input for volatile defaults
+CREATE TABLE serial_table (a int, b bigserial);
+SELECT create_distributed_table('serial_table', 'a');
+COPY serial_table (a) FROM STDIN;
+1
+2
+\.
+
+SELECT a, b FROM serial_table ORDER BY b;
+
+-- rows are routed to the right shards
+SELECT shardid, result FROM run_command_on_placements('dist_table', 'SELECT count(*) FROM %s')
+ORDER BY shardid;
+
+-- rolling back discards the rows
+BEGIN;
+COPY dist_table (a, b) FROM STDIN;
+12	twelve
+\.
+SELECT count(*) FROM dist_table;
+ROLLBACK;
+SELECT count(*) FROM dist_table;
+
+SET citus.parallel_copy_from_workers TO 0;
+COPY dist_table (a, b) FROM STDIN;
+12	twelve
+\.
+SELECT count(*), sum(a) FROM dist_table;
+
+-- flush the other connections while waiting for one to flush
+SET citus.enable_concurrent_copy_flush TO on;
+SET citus.remote_copy_flush_threshold TO 1;
+COPY dist_table (a, b) FROM STDIN;
+13	thirteen
+14	fourteen
+15	fifteen
+\.
+SELECT count(*), sum(a) FROM dist_table;
+RESET citus.remote_copy_flush_threshold;
+RESET citus.enable_concurrent_copy_flush;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA parallel_copy_from CASCADE;
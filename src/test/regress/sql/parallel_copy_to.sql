@@ -0,0 +1,55 @@
+--
+-- parallel_copy_to.sql
+--
+-- Test reading the shards of COPY .. TO STDOUT in parallel.
+--
+
+CREATE SCHEMA parallel_copy_to;
+SET search_path TO parallel_copy_to;
+SET citus.next_shard_id TO 1927000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int, b text);
+SELECT create_distributed_table('dist_table', 'a');
+INSERT INTO dist_table SELECT s, 'row ' || s FROM generate_series(1, 8) s;
+
+-- rows of the same shard only, such that the order does not depend on timing
+CREATE TABLE single_shard_rows (a int, b text);
+SELECT create_distributed_table('single_shard_rows', 'a');
+INSERT INTO single_shard_rows VALUES (1, 'one'), (5, 'five'), (8, 'eight'), (10, 'ten');
+
+SET citus.parallel_copy_to TO ordered;
+
+-- shards are sent in shard order
+COPY dist_table TO STDOUT;
+COPY dist_table (b) TO STDOUT WITH (format csv, header true);
+
+-- smaller pool than shard count
+SET citus.max_adaptive_executor_pool_size TO 2;
+COPY dist_table TO STDOUT;
+RESET citus.max_adaptive_executor_pool_size;
+
+SET citus.parallel_copy_to TO unordered;
+COPY single_shard_rows TO STDOUT;
+COPY single_shard_rows TO STDOUT WITH (format csv);
+
+-- one shard per worker node at a time
+SET citus.max_adaptive_executor_pool_size TO 1;
+COPY single_shard_rows TO STDOUT;
+RESET citus.max_adaptive_executor_pool_size;
+
+-- the header needs to come first, so we fall back to ordered
+COPY dist_table TO STDOUT WITH (format csv, header true);
+
+-- in transaction blocks, shards are read one after the other
+BEGIN;
+INSERT INTO dist_table VALUES (9, 'row 9');
+COPY dist_table TO STDOUT;
+ROLLBACK;
+
+SET citus.parallel_copy_to TO off;
+COPY dist_table TO STDOUT;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA parallel_copy_to CASCADE;
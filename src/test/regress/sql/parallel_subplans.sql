@@ -0,0 +1,69 @@
+--
+-- parallel_subplans.sql
+--
+-- Test running the tasks of independent subplans in a single distributed
+-- execution.
+--
+
+CREATE SCHEMA parallel_subplans;
+SET search_path TO parallel_subplans;
+SET citus.next_shard_id TO 1919000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE dist_table(a int, b int);
+SELECT create_distributed_table('dist_table', 'a');
+
+INSERT INTO dist_table SELECT i, i % 10 FROM generate_series(1, 1000) i;
+
+SET citus.enable_parallel_subplan_execution TO on;
+
+-- independent multi-shard subplans
+WITH total AS MATERIALIZED (SELECT count(*) AS c FROM dist_table),
+     total_b AS MATERIALIZED (SELECT sum(b) AS s FROM dist_table),
+     max_a AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT c, s, m FROM total, total_b, max_a;
+
+-- independent router subplans
+WITH x AS MATERIALIZED (SELECT b FROM dist_table WHERE a = 5),
+     y AS MATERIALIZED (SELECT b FROM dist_table WHERE a = 17),
+     z AS MATERIALIZED (SELECT count(*) AS c FROM dist_table WHERE b = 7)
+SELECT x.b, y.b, z.c FROM x, y, z;
+
+-- subplans that use the results of other subplans run after them
+WITH ones AS MATERIALIZED (SELECT a FROM dist_table WHERE b = 1),
+     ones_count AS MATERIALIZED (
+        SELECT count(*) AS c FROM dist_table WHERE a IN (SELECT a FROM ones)),
+     twos AS MATERIALIZED (SELECT sum(b) AS s FROM dist_table WHERE b = 2)
+SELECT c, s FROM ones_count, twos;
+
+-- subplans with many rows
+WITH evens AS MATERIALIZED (SELECT a FROM dist_table WHERE a % 2 = 0),
+     odds AS MATERIALIZED (SELECT a FROM dist_table WHERE a % 2 = 1)
+SELECT (SELECT count(*) FROM evens), (SELECT sum(a) FROM odds);
+
+-- in a transaction block that modified some of the shards
+BEGIN;
+UPDATE dist_table SET b = b + 1 WHERE a <= 10;
+WITH total AS MATERIALIZED (SELECT count(*) AS c FROM dist_table),
+     total_b AS MATERIALIZED (SELECT sum(b) AS s FROM dist_table),
+     max_a AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT c, s, m FROM total, total_b, max_a;
+ROLLBACK;
+
+-- subplans are not run in advance along with modifications
+BEGIN;
+WITH ins AS (INSERT INTO dist_table VALUES (1001, 1) RETURNING a),
+     total AS MATERIALIZED (SELECT count(*) AS c FROM dist_table WHERE a <= 1000),
+     total_b AS MATERIALIZED (SELECT sum(b) AS s FROM dist_table WHERE a <= 1000)
+SELECT (SELECT a FROM ins), c, s FROM total, total_b;
+ROLLBACK;
+
+-- errors in any of the subplans are reported
+WITH total AS MATERIALIZED (SELECT count(*) AS c FROM dist_table),
+     fails AS MATERIALIZED (SELECT a / (b - b) AS d FROM dist_table)
+SELECT c FROM total, fails;
+
+RESET citus.enable_parallel_subplan_execution;
+SET client_min_messages TO WARNING;
+DROP SCHEMA parallel_subplans CASCADE;
@@ -0,0 +1,84 @@
+--
+-- PLANNER_MICROBENCHMARKS
+--
+-- Measures the per-query cost of the planner, fast path router detection,
+-- shard pruning and deparsing on a representative schema. The output only
+-- checks that the measurements ran, the numbers themselves are written to
+-- the server log, where they can be compared between branches.
+--
+CREATE SCHEMA planner_microbenchmarks;
+SET search_path TO planner_microbenchmarks;
+SET citus.next_shard_id TO 7910000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 32;
+
+CREATE FUNCTION microbenchmark_planner(query text, iterations int,
+									   OUT ns_per_op float8, OUT bytes_per_op bigint)
+	AS 'citus'
+	LANGUAGE C STRICT;
+CREATE FUNCTION microbenchmark_fast_path_router(query text, iterations int,
+												OUT ns_per_op float8, OUT bytes_per_op bigint)
+	AS 'citus'
+	LANGUAGE C STRICT;
+CREATE FUNCTION microbenchmark_shard_pruning(query text, iterations int,
+											 OUT ns_per_op float8, OUT bytes_per_op bigint)
+	AS 'citus'
+	LANGUAGE C STRICT;
+CREATE FUNCTION microbenchmark_deparse(query text, iterations int,
+									   OUT ns_per_op float8, OUT bytes_per_op bigint)
+	AS 'citus'
+	LANGUAGE C STRICT;
+
+CREATE TABLE customers (customer_id bigint PRIMARY KEY, name text, country_id int);
+SELECT create_distributed_table('customers', 'customer_id');
+CREATE TABLE orders (customer_id bigint, order_id bigint, status text, amount numeric,
+					 PRIMARY KEY (customer_id, order_id));
+SELECT create_distributed_table('orders', 'customer_id', colocate_with => 'customers');
+CREATE TABLE countries (country_id int PRIMARY KEY, name text);
+SELECT create_reference_table('countries');
+
+CREATE TABLE microbenchmark_queries (name text, query text, single_table bool);
+INSERT INTO microbenchmark_queries VALUES
+('router_select', 'SELECT * FROM planner_microbenchmarks.orders WHERE customer_id = 5', true),
+('router_update', 'UPDATE planner_microbenchmarks.orders SET amount = 0 WHERE customer_id = 5 AND order_id = 1', true),
+('router_join', 'SELECT * FROM planner_microbenchmarks.customers c JOIN planner_microbenchmarks.orders o USING (customer_id) WHERE customer_id = 5', false),
+('in_list_pruning', 'SELECT count(*) FROM planner_microbenchmarks.orders WHERE customer_id IN (1, 2, 3, 4, 5)', true),
+('multi_shard_aggregate', 'SELECT status, count(*), sum(amount) FROM planner_microbenchmarks.orders GROUP BY status ORDER BY 2 DESC LIMIT 10', true),
+('reference_join', 'SELECT co.name, count(*) FROM planner_microbenchmarks.customers cu JOIN planner_microbenchmarks.countries co USING (country_id) GROUP BY co.name', false),
+('subquery_pushdown', 'SELECT count(*) FROM (SELECT customer_id, sum(amount) FROM planner_microbenchmarks.orders GROUP BY customer_id) s', false),
+('insert_select', 'INSERT INTO planner_microbenchmarks.orders SELECT customer_id, order_id + 1, status, amount FROM planner_microbenchmarks.orders WHERE customer_id = 5', false);
+
+CREATE TABLE microbenchmark_results (name text, step text, ns_per_op float8, bytes_per_op bigint);
+
+INSERT INTO microbenchmark_results
+SELECT name, 'planner', r.* FROM microbenchmark_queries, microbenchmark_planner(query, 100) r;
+INSERT INTO microbenchmark_results
+SELECT name, 'fast_path_router', r.* FROM microbenchmark_queries, microbenchmark_fast_path_router(query, 1000) r;
+INSERT INTO microbenchmark_results
+SELECT name, 'shard_pruning', r.* FROM microbenchmark_queries, microbenchmark_shard_pruning(query, 1000) r
+WHERE single_table;
+INSERT INTO microbenchmark_results
+SELECT name, 'deparse', r.* FROM microbenchmark_queries, microbenchmark_deparse(query, 1000) r;
+
+SELECT name, step, ns_per_op > 0 AS measured, bytes_per_op >= 0 AS measured_memory
+FROM microbenchmark_results ORDER BY name, step;
+
+DO $$
+DECLARE
+	result record;
+BEGIN
+	FOR result IN SELECT * FROM microbenchmark_results ORDER BY name, step LOOP
+		RAISE LOG 'microbenchmark %/%: % ns/op, % bytes/op', result.name, result.step,
+			round(result.ns_per_op::numeric, 1), result.bytes_per_op;
+	END LOOP;
+END;
+$$;
+
+-- invalid arguments
+SELECT * FROM microbenchmark_planner('SELECT 1', 0);
+SELECT * FROM microbenchmark_planner('SELECT 1; SELECT 2', 1);
+SELECT * FROM microbenchmark_deparse('VACUUM orders', 1);
+SELECT * FROM microbenchmark_shard_pruning('SELECT * FROM planner_microbenchmarks.countries c, planner_microbenchmarks.orders o', 1);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA planner_microbenchmarks CASCADE;
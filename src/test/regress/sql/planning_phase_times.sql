@@ -0,0 +1,49 @@
+--
+-- planning_phase_times.sql
+--
+-- Test showing the time spent in each phase of distributed planning in
+-- EXPLAIN (SUMMARY).
+--
+CREATE SCHEMA planning_phase_times;
+SET search_path TO planning_phase_times;
+
+SET citus.next_shard_id TO 1898000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE test(key int, value int);
+SELECT create_distributed_table('test', 'key');
+
+-- returns the planning phase lines of the explain output without the durations
+CREATE FUNCTION planning_phases(explain_command text, out query_plan text)
+RETURNS SETOF TEXT AS $$
+BEGIN
+  FOR query_plan IN EXECUTE explain_command LOOP
+    IF query_plan ~ ' Time: [0-9.]+ ms$' AND query_plan !~ 'Planning Time|Execution Time'
+    THEN
+      query_plan := regexp_replace(trim(query_plan), '[0-9.]+ ms$', 'N ms');
+      RETURN NEXT;
+    END IF;
+  END LOOP;
+  RETURN;
+END; $$ language plpgsql;
+
+-- multi-shard query
+SELECT planning_phases('EXPLAIN (COSTS OFF, SUMMARY) SELECT count(*) FROM test');
+
+-- recursively planned CTE
+SELECT planning_phases($Q$
+EXPLAIN (COSTS OFF, SUMMARY)
+WITH cte AS MATERIALIZED (SELECT * FROM test ORDER BY value LIMIT 5)
+SELECT count(*) FROM cte JOIN test USING (key)
+$Q$);
+
+-- router query
+SELECT planning_phases('EXPLAIN (COSTS OFF, SUMMARY) SELECT * FROM test WHERE key = 1');
+
+-- the planning phases are only shown with SUMMARY
+SELECT planning_phases('EXPLAIN (COSTS OFF) SELECT count(*) FROM test');
+SELECT planning_phases('EXPLAIN (COSTS OFF, SUMMARY OFF) SELECT count(*) FROM test');
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA planning_phase_times CASCADE;
@@ -0,0 +1,78 @@
+--
+-- query_result_cache.sql
+--
+-- Test caching the results of read-only queries on reference tables.
+--
+
+CREATE SCHEMA query_result_cache;
+SET search_path TO query_result_cache;
+SET citus.next_shard_id TO 1921000;
+
+CREATE TABLE ref_table(a int, b int);
+SELECT create_reference_table('ref_table');
+CREATE TABLE other_ref_table(a int, c text);
+SELECT create_reference_table('other_ref_table');
+
+INSERT INTO ref_table SELECT i, i FROM generate_series(1, 10) i;
+INSERT INTO other_ref_table SELECT i, 'value ' || i FROM generate_series(1, 10) i;
+
+SET citus.enable_query_result_cache TO on;
+
+-- caches the result
+SELECT sum(b) FROM ref_table;
+
+-- modify the placements directly, which the cache does not notice
+SELECT bool_and(success)
+FROM run_command_on_placements('ref_table', 'UPDATE %s SET b = b + 1');
+
+-- returns the cached result
+SELECT sum(b) FROM ref_table;
+
+RESET citus.enable_query_result_cache;
+SELECT sum(b) FROM ref_table;
+SET citus.enable_query_result_cache TO on;
+
+-- modifications via the coordinator invalidate the result
+INSERT INTO ref_table VALUES (11, 11);
+SELECT sum(b) FROM ref_table;
+
+-- the result is not used in a transaction that modified the table
+BEGIN;
+UPDATE ref_table SET b = 0 WHERE a = 11;
+SELECT sum(b) FROM ref_table;
+ROLLBACK;
+SELECT sum(b) FROM ref_table;
+
+-- results of prepared statements are cached per parameter value
+PREPARE ref_query(int) AS SELECT b FROM ref_table WHERE a = $1;
+EXECUTE ref_query(1);
+EXECUTE ref_query(2);
+SELECT bool_and(success)
+FROM run_command_on_placements('ref_table', 'UPDATE %s SET b = b + 1 WHERE a <= 2');
+EXECUTE ref_query(1);
+EXECUTE ref_query(2);
+EXECUTE ref_query(3);
+
+-- joins of reference tables are invalidated by either table
+SELECT count(*), max(c) FROM ref_table JOIN other_ref_table USING (a);
+DELETE FROM other_ref_table WHERE a = 10;
+SELECT count(*), max(c) FROM ref_table JOIN other_ref_table USING (a);
+TRUNCATE ref_table;
+SELECT count(*), max(c) FROM ref_table JOIN other_ref_table USING (a);
+SELECT sum(b) FROM ref_table;
+
+-- COPY invalidates the result
+COPY ref_table FROM STDIN WITH CSV;
+1,1
+2,2
+\.
+SELECT sum(b) FROM ref_table;
+
+-- queries with stable or volatile functions are not cached
+SELECT count(*) FROM ref_table WHERE now() IS NOT NULL;
+SELECT bool_and(success)
+FROM run_command_on_placements('ref_table', 'DELETE FROM %s WHERE a = 2');
+SELECT count(*) FROM ref_table WHERE now() IS NOT NULL;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA query_result_cache CASCADE;
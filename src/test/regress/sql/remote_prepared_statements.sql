@@ -0,0 +1,50 @@
+--
+-- remote_prepared_statements.sql
+--
+-- Test preparing the parameterized shard queries on the worker connections.
+--
+CREATE SCHEMA remote_prepared_statements;
+SET search_path TO remote_prepared_statements;
+
+SET citus.next_shard_id TO 1895000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE test(key int, value int);
+SELECT create_distributed_table('test', 'key');
+INSERT INTO test SELECT i, i * 10 FROM generate_series(1, 100) i;
+
+-- the shard queries are sent along with their parameters when they are cached
+SET citus.enable_shard_query_caching TO on;
+SET citus.max_prepared_statements_per_connection TO 2;
+SET plan_cache_mode TO force_generic_plan;
+
+PREPARE select_value(int) AS SELECT value FROM test WHERE key = $1;
+PREPARE select_all(int) AS SELECT * FROM test WHERE key = $1;
+PREPARE update_value(int, int) AS UPDATE test SET value = $2 WHERE key = $1 RETURNING *;
+
+EXECUTE select_value(1);
+EXECUTE select_value(1);
+EXECUTE select_value(1);
+EXECUTE select_all(1);
+EXECUTE select_all(1);
+EXECUTE select_all(1);
+
+-- there is no room to prepare another statement, so it's only sent
+EXECUTE update_value(1, 11);
+EXECUTE update_value(1, 12);
+EXECUTE select_value(1);
+
+-- the statements are prepared again when the result types change
+ALTER TABLE test ADD COLUMN other int DEFAULT 5;
+EXECUTE select_all(1);
+EXECUTE select_all(1);
+EXECUTE select_value(1);
+
+-- the results are the same when preparing statements is disabled
+SET citus.max_prepared_statements_per_connection TO 0;
+EXECUTE select_all(1);
+EXECUTE select_value(1);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA remote_prepared_statements CASCADE;
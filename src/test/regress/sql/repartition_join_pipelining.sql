@@ -0,0 +1,38 @@
+--
+-- repartition_join_pipelining.sql
+--
+-- Test starting the tasks of repartition joins as soon as the tasks they
+-- depend on finished.
+--
+
+CREATE SCHEMA repartition_join_pipelining;
+SET search_path TO repartition_join_pipelining;
+SET citus.next_shard_id TO 1920000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE left_table(a int, b int);
+SELECT create_distributed_table('left_table', 'a');
+CREATE TABLE right_table(x int, y int);
+SELECT create_distributed_table('right_table', 'x');
+
+INSERT INTO left_table SELECT i, i % 10 FROM generate_series(1, 100) i;
+INSERT INTO right_table SELECT i, i % 10 FROM generate_series(1, 50) i;
+
+SET citus.enable_repartition_joins TO on;
+SET citus.enable_repartition_join_pipelining TO on;
+
+-- single repartition join
+SELECT count(*) FROM left_table JOIN right_table ON (b = x);
+
+-- dual repartition joins
+SELECT count(*), sum(a) FROM left_table JOIN right_table ON (b = y);
+SELECT y, count(*) FROM left_table JOIN right_table ON (b = y)
+GROUP BY y ORDER BY y LIMIT 3;
+
+-- the results match the ones of the executions in waves
+RESET citus.enable_repartition_join_pipelining;
+SELECT count(*), sum(a) FROM left_table JOIN right_table ON (b = y);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA repartition_join_pipelining CASCADE;
@@ -0,0 +1,43 @@
+--
+-- repartition_join_skew.sql
+--
+-- Test placing the tasks of repartition joins by the size of their buckets.
+--
+
+CREATE SCHEMA repartition_join_skew;
+SET search_path TO repartition_join_skew;
+SET citus.next_shard_id TO 1935000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE left_table(a int, b int);
+SELECT create_distributed_table('left_table', 'a');
+CREATE TABLE right_table(x int, y int);
+SELECT create_distributed_table('right_table', 'x');
+
+-- most rows of left_table have the same join key
+INSERT INTO left_table SELECT i, CASE WHEN i <= 900 THEN 0 ELSE i % 10 END FROM generate_series(1, 1000) i;
+INSERT INTO right_table SELECT i, i % 10 FROM generate_series(1, 50) i;
+
+SET citus.enable_repartition_joins TO on;
+SET citus.enable_skew_aware_repartition_joins TO on;
+
+-- dual repartition joins are placed by their bucket sizes
+SELECT count(*), sum(a) FROM left_table JOIN right_table ON (b = y);
+SELECT y, count(*) FROM left_table JOIN right_table ON (b = y)
+GROUP BY y ORDER BY y LIMIT 3;
+
+-- single repartition joins stay with the anchor shard
+SELECT count(*) FROM left_table JOIN right_table ON (b = x);
+
+-- also when the tasks are pipelined
+SET citus.enable_repartition_join_pipelining TO on;
+SELECT count(*), sum(a) FROM left_table JOIN right_table ON (b = y);
+RESET citus.enable_repartition_join_pipelining;
+
+-- the results match the ones of the default placement
+RESET citus.enable_skew_aware_repartition_joins;
+SELECT count(*), sum(a) FROM left_table JOIN right_table ON (b = y);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA repartition_join_skew CASCADE;
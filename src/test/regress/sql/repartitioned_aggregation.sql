@@ -0,0 +1,78 @@
+--
+-- repartitioned_aggregation.sql
+--
+-- Test finalizing the groups of queries that group by other columns than the
+-- distribution column on the workers, after repartitioning the partial
+-- aggregates of the shards by group key.
+--
+
+CREATE SCHEMA repartitioned_aggregation;
+SET search_path TO repartitioned_aggregation;
+SET citus.next_shard_id TO 1906000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE events(event_id int, user_id int, category text, amount numeric);
+SELECT create_distributed_table('events', 'event_id');
+
+INSERT INTO events
+SELECT i, i % 50, CASE WHEN i % 7 = 0 THEN NULL ELSE 'category ' || (i % 13) END,
+       i % 100
+FROM generate_series(1, 10000) i;
+
+CREATE TABLE users(user_id int, name text);
+SELECT create_reference_table('users');
+INSERT INTO users SELECT i, 'user ' || i FROM generate_series(0, 49) i;
+
+-- compares the results of a query with the groups finalized on the
+-- coordinator and on the workers
+CREATE FUNCTION same_results(query text, ordered bool DEFAULT false)
+RETURNS bool LANGUAGE plpgsql AS $$
+DECLARE
+  aggregate_query text := format('SELECT array_agg(r::text%s) FROM (%s) r',
+                                 CASE WHEN ordered THEN '' ELSE ' ORDER BY r::text' END,
+                                 query);
+  coordinator_results text[];
+  worker_results text[];
+BEGIN
+  PERFORM set_config('citus.enable_repartitioned_aggregation', 'off', true);
+  EXECUTE aggregate_query INTO coordinator_results;
+  PERFORM set_config('citus.enable_repartitioned_aggregation', 'on', true);
+  EXECUTE aggregate_query INTO worker_results;
+  RETURN coordinator_results IS NOT DISTINCT FROM worker_results AND
+         coordinator_results IS NOT NULL;
+END;
+$$;
+
+-- disabled by default
+SET client_min_messages TO DEBUG1;
+SELECT category, count(*), sum(amount) FROM events GROUP BY category ORDER BY category;
+
+-- the NULL group is finalized by the first shard
+SET citus.enable_repartitioned_aggregation TO on;
+SELECT category, count(*), sum(amount) FROM events GROUP BY category ORDER BY category;
+
+-- groups on the distribution column are already finalized on the workers
+SELECT event_id, count(*) FROM events WHERE event_id < 3 GROUP BY event_id ORDER BY event_id;
+RESET client_min_messages;
+
+SELECT same_results('SELECT user_id % 7, count(*), sum(amount), avg(amount) FROM events GROUP BY 1');
+SELECT same_results('SELECT category, count(DISTINCT user_id), min(amount) FROM events GROUP BY category');
+SELECT same_results('SELECT category, amount > 50, max(event_id) FROM events GROUP BY 1, 2');
+SELECT same_results('SELECT user_id, sum(amount) FROM events GROUP BY user_id HAVING sum(amount) > 10000');
+SELECT same_results('SELECT user_id, count(*) FROM events GROUP BY user_id ORDER BY sum(amount) DESC, user_id LIMIT 5', true);
+SELECT same_results('SELECT user_id, count(*) FROM events GROUP BY user_id ORDER BY user_id LIMIT 5 OFFSET 10', true);
+SELECT same_results('SELECT DISTINCT count(*) FROM events GROUP BY user_id');
+SELECT same_results('SELECT user_id, array_agg(event_id ORDER BY event_id) FROM events GROUP BY user_id');
+SELECT same_results('SELECT name, count(*) FROM events JOIN users USING (user_id) GROUP BY name');
+SELECT same_results('SELECT category, count(*) FROM events WHERE user_id IN (SELECT user_id FROM events WHERE event_id < 10) GROUP BY category');
+
+-- the groups are finalized within the transaction that modified the table
+BEGIN;
+INSERT INTO events VALUES (10001, 1, 'new category', 1);
+SELECT category, count(*) FROM events WHERE category LIKE 'new%' GROUP BY category;
+ROLLBACK;
+
+RESET citus.enable_repartitioned_aggregation;
+SET client_min_messages TO WARNING;
+DROP SCHEMA repartitioned_aggregation CASCADE;
@@ -0,0 +1,75 @@
+--
+-- repartitioned_window_functions.sql
+--
+-- Test evaluating window functions that are not partitioned by the
+-- distribution column on the workers, after repartitioning the rows of the
+-- shards by a PARTITION BY column.
+--
+
+CREATE SCHEMA repartitioned_window_functions;
+SET search_path TO repartitioned_window_functions;
+SET citus.next_shard_id TO 1907000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE events(event_id int, user_id int, category text, amount numeric);
+SELECT create_distributed_table('events', 'event_id');
+
+INSERT INTO events
+SELECT i, i % 50, CASE WHEN i % 7 = 0 THEN NULL ELSE 'category ' || (i % 13) END,
+       i % 100
+FROM generate_series(1, 10000) i;
+
+-- compares the results of a query with the window functions evaluated on the
+-- coordinator and on the workers
+CREATE FUNCTION same_results(query text, ordered bool DEFAULT false)
+RETURNS bool LANGUAGE plpgsql AS $$
+DECLARE
+  aggregate_query text := format('SELECT array_agg(r::text%s) FROM (%s) r',
+                                 CASE WHEN ordered THEN '' ELSE ' ORDER BY r::text' END,
+                                 query);
+  coordinator_results text[];
+  worker_results text[];
+BEGIN
+  PERFORM set_config('citus.enable_repartitioned_window_functions', 'off', true);
+  EXECUTE aggregate_query INTO coordinator_results;
+  PERFORM set_config('citus.enable_repartitioned_window_functions', 'on', true);
+  EXECUTE aggregate_query INTO worker_results;
+  RETURN coordinator_results IS NOT DISTINCT FROM worker_results AND
+         coordinator_results IS NOT NULL;
+END;
+$$;
+
+-- disabled by default
+SET client_min_messages TO DEBUG1;
+SELECT user_id, event_id, row_number() OVER (PARTITION BY user_id ORDER BY event_id)
+FROM events ORDER BY 3 DESC, 1 LIMIT 3;
+
+SET citus.enable_repartitioned_window_functions TO on;
+SELECT user_id, event_id, row_number() OVER (PARTITION BY user_id ORDER BY event_id)
+FROM events ORDER BY 3 DESC, 1 LIMIT 3;
+
+-- windows without a common PARTITION BY column are evaluated on the coordinator
+SELECT user_id, event_id, row_number() OVER (ORDER BY event_id)
+FROM events ORDER BY 3 DESC LIMIT 1;
+RESET client_min_messages;
+
+SELECT same_results('SELECT user_id, event_id, sum(amount) OVER (PARTITION BY user_id ORDER BY event_id) FROM events');
+SELECT same_results('SELECT category, event_id, rank() OVER (PARTITION BY category ORDER BY amount, event_id) FROM events');
+SELECT same_results('SELECT user_id, category, count(*) OVER (PARTITION BY user_id), avg(amount) OVER (PARTITION BY category, user_id) FROM events');
+SELECT same_results('SELECT user_id, lag(event_id) OVER w, lead(event_id, 2) OVER w FROM events WINDOW w AS (PARTITION BY user_id ORDER BY event_id ROWS BETWEEN 1 PRECEDING AND 1 FOLLOWING)');
+SELECT same_results('SELECT category, user_id, sum(amount), rank() OVER (PARTITION BY category ORDER BY sum(amount) DESC, user_id) FROM events GROUP BY category, user_id');
+SELECT same_results('SELECT user_id, event_id, ntile(4) OVER (PARTITION BY user_id ORDER BY event_id) FROM events ORDER BY 3 DESC, 2 LIMIT 10 OFFSET 5', true);
+SELECT same_results('SELECT DISTINCT user_id, max(amount) OVER (PARTITION BY user_id) FROM events');
+SELECT same_results('SELECT count(*) FROM (SELECT user_id, rank() OVER (PARTITION BY user_id ORDER BY amount DESC, event_id) AS r FROM events) ranked WHERE r <= 3');
+
+-- the window functions are evaluated within the transaction that modified the table
+BEGIN;
+INSERT INTO events VALUES (10001, 1, 'new category', 1);
+SELECT category, event_id, count(*) OVER (PARTITION BY category)
+FROM events WHERE category LIKE 'new%';
+ROLLBACK;
+
+RESET citus.enable_repartitioned_window_functions;
+SET client_min_messages TO WARNING;
+DROP SCHEMA repartitioned_window_functions CASCADE;
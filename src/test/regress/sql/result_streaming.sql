@@ -0,0 +1,53 @@
+--
+-- result_streaming.sql
+--
+-- Test returning the rows of simple distributed SELECTs to the client as
+-- they arrive from the workers, rather than once all the tasks finished.
+--
+
+CREATE SCHEMA result_streaming;
+SET search_path TO result_streaming;
+SET citus.next_shard_id TO 1915000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE stream_table(a int, b int, c text);
+SELECT create_distributed_table('stream_table', 'a');
+
+INSERT INTO stream_table SELECT i, i % 37, 'row ' || i FROM generate_series(1, 5000) i;
+
+SET citus.enable_result_streaming TO on;
+
+-- multi-shard and router queries whose rows are returned as they are
+SELECT b, length(c) FROM stream_table WHERE a % 370 = 0 AND a < 1000;
+SELECT a, b, c FROM stream_table WHERE a = 42;
+
+-- more rows than fit in a batch
+CREATE TABLE streamed_rows AS SELECT a, b, c FROM stream_table;
+SELECT count(*), sum(a), sum(b), count(DISTINCT c) FROM streamed_rows;
+
+-- queries whose rows are combined on the coordinator are not streamed
+SELECT a, b FROM stream_table ORDER BY a DESC LIMIT 3;
+
+-- neither are cursors in transaction blocks
+BEGIN;
+DECLARE stream_cursor CURSOR FOR
+SELECT b, length(c) FROM stream_table WHERE a % 370 = 0 AND a < 1000;
+FETCH 1 FROM stream_cursor;
+FETCH 1 FROM stream_cursor;
+COMMIT;
+
+-- a task that fails after other rows were returned
+SELECT a / (a - 4000) FROM stream_table;
+SELECT count(*) FROM stream_table;
+
+-- prepared statements
+PREPARE stream_rows(int) AS
+SELECT b, length(c) FROM stream_table WHERE a % $1 = 0 AND a < 1000;
+EXECUTE stream_rows(370);
+EXECUTE stream_rows(999);
+DEALLOCATE stream_rows;
+
+RESET citus.enable_result_streaming;
+SET client_min_messages TO WARNING;
+DROP SCHEMA result_streaming CASCADE;
@@ -0,0 +1,74 @@
+--
+-- router_proxy.sql
+--
+-- Test executing read-only router queries through router proxies.
+--
+
+CREATE SCHEMA router_proxy;
+SET search_path TO router_proxy;
+SET citus.next_shard_id TO 1930000;
+SET citus.shard_count TO 4;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE dist_table (a int, b text);
+SELECT create_distributed_table('dist_table', 'a');
+INSERT INTO dist_table VALUES (1, 'one'), (2, 'two'), (3, NULL), (4, 'four');
+
+ALTER SYSTEM SET citus.router_proxy_workers TO 2;
+SELECT pg_reload_conf();
+
+-- wait for the maintenance daemon to start the router proxies
+DO $$
+BEGIN
+    FOR i IN 1 .. 100 LOOP
+        PERFORM pg_stat_clear_snapshot();
+        EXIT WHEN (SELECT count(*) FROM pg_stat_activity
+                   WHERE backend_type = 'Citus Router Proxy'
+                   AND datname = current_database()) = 2;
+        PERFORM pg_sleep(0.1);
+    END LOOP;
+END;
+$$;
+
+SELECT count(*) FROM pg_stat_activity
+WHERE backend_type = 'Citus Router Proxy' AND datname = current_database();
+
+-- router queries return the same results through the proxies
+SELECT * FROM dist_table WHERE a = 1;
+SELECT * FROM dist_table WHERE a = 3;
+SELECT a, b || '!' AS c FROM dist_table WHERE a = 2;
+SELECT count(*) FROM dist_table WHERE a = 4;
+SELECT * FROM dist_table WHERE a = 5;
+
+-- errors on the worker are rethrown
+SELECT a / 0 FROM dist_table WHERE a = 1;
+
+-- the next query works after the error
+SELECT * FROM dist_table WHERE a = 4;
+
+-- queries in transaction blocks do not use the proxies
+BEGIN;
+SELECT * FROM dist_table WHERE a = 1;
+INSERT INTO dist_table VALUES (1, 'uno');
+SELECT * FROM dist_table WHERE a = 1 ORDER BY b;
+ROLLBACK;
+
+-- prepared statements with parameters
+PREPARE select_a(int) AS SELECT * FROM dist_table WHERE a = $1;
+EXECUTE select_a(1);
+EXECUTE select_a(2);
+EXECUTE select_a(3);
+EXECUTE select_a(4);
+EXECUTE select_a(1);
+EXECUTE select_a(2);
+EXECUTE select_a(3);
+DEALLOCATE select_a;
+
+-- multi-shard queries run as usual
+SELECT * FROM dist_table ORDER BY a;
+
+ALTER SYSTEM RESET citus.router_proxy_workers;
+SELECT pg_reload_conf();
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA router_proxy CASCADE;
@@ -0,0 +1,38 @@
+--
+-- shard_cleanup_batches.sql
+--
+-- Test dropping the orphaned shards of several moves in batches.
+--
+
+CREATE SCHEMA shard_cleanup_batches;
+SET search_path TO shard_cleanup_batches;
+SET citus.next_shard_id TO 1939900;
+SET citus.shard_count TO 6;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE events (id int PRIMARY KEY);
+SELECT create_distributed_table('events', 'id');
+
+SELECT citus_move_shard_placement(1939900, 'localhost', :worker_1_port, 'localhost', :worker_2_port, 'block_writes');
+SELECT citus_move_shard_placement(1939902, 'localhost', :worker_1_port, 'localhost', :worker_2_port, 'block_writes');
+SELECT citus_move_shard_placement(1939904, 'localhost', :worker_1_port, 'localhost', :worker_2_port, 'block_writes');
+SELECT citus_move_shard_placement(1939901, 'localhost', :worker_2_port, 'localhost', :worker_1_port, 'block_writes');
+SELECT citus_move_shard_placement(1939903, 'localhost', :worker_2_port, 'localhost', :worker_1_port, 'block_writes');
+
+-- the moved shards are still on their source nodes
+SELECT run_command_on_workers($cmd$
+    SELECT count(*) FROM pg_class WHERE relname ~ '^events_19399[0-9]{2}$';
+$cmd$);
+
+-- drop up to 2 shards of a node at a time
+SET citus.orphaned_shard_drop_batch_size TO 2;
+CALL citus_cleanup_orphaned_resources();
+RESET citus.orphaned_shard_drop_batch_size;
+
+SELECT count(*) FROM pg_dist_cleanup WHERE object_name LIKE 'shard_cleanup_batches.%';
+SELECT run_command_on_workers($cmd$
+    SELECT count(*) FROM pg_class WHERE relname ~ '^events_19399[0-9]{2}$';
+$cmd$);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA shard_cleanup_batches CASCADE;
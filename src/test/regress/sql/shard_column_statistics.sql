@@ -0,0 +1,93 @@
+--
+-- shard_column_statistics.sql
+--
+-- Test pruning shards using the row counts and the smallest and largest
+-- column values of each shard collected into pg_dist_shard_column_stats.
+--
+CREATE SCHEMA shard_column_statistics;
+SET search_path TO shard_column_statistics;
+
+SET citus.next_shard_id TO 1911000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE events(id int, created_at date, note text);
+SELECT create_distributed_table('events', 'id');
+
+-- each shard covers a different month, except for the last one which is empty
+INSERT INTO events
+SELECT i,
+       CASE WHEN i % 50 = 0 THEN NULL
+       ELSE date '2024-01-01' + ((get_shard_id_for_distribution_column('events', i) - 1911000) * 31 + i % 28)::int
+       END,
+       'event ' || i
+FROM generate_series(1, 200) i
+WHERE get_shard_id_for_distribution_column('events', i) <> 1911003;
+
+SELECT citus_collect_shard_column_statistics('events', 'created_at');
+SELECT shardid, row_count, null_count, min_value, max_value
+FROM pg_dist_shard_column_stats WHERE logicalrelid = 'events'::regclass ORDER BY shardid;
+
+-- all shards are queried unless pruning is enabled
+SELECT public.coordinator_plan($Q$
+EXPLAIN (COSTS OFF)
+SELECT * FROM events WHERE created_at BETWEEN '2024-02-01' AND '2024-02-10';
+$Q$);
+SET citus.enable_shard_column_statistics_pruning TO on;
+SELECT public.coordinator_plan($Q$
+EXPLAIN (COSTS OFF)
+SELECT * FROM events WHERE created_at BETWEEN '2024-02-01' AND '2024-02-10';
+$Q$);
+SELECT count(*) FROM events WHERE created_at BETWEEN '2024-02-01' AND '2024-02-10';
+SELECT count(*) FROM events WHERE created_at IS NULL;
+SELECT count(*) FROM events WHERE created_at >= '2024-04-01';
+
+-- writes invalidate the statistics of the shards they modify
+INSERT INTO events VALUES (2, '2024-04-05', 'late event');
+INSERT INTO events SELECT id, '2024-03-31', 'copied event' FROM (VALUES (6), (13)) v(id);
+UPDATE events SET note = 'updated' WHERE id = 1;
+SELECT shardid, row_count, null_count, min_value, max_value
+FROM pg_dist_shard_column_stats WHERE logicalrelid = 'events'::regclass ORDER BY shardid;
+SELECT count(*) FROM events WHERE created_at >= '2024-03-31';
+
+-- rolled back writes leave the statistics intact
+SELECT citus_collect_shard_column_statistics('events', stale_only => true);
+BEGIN;
+DELETE FROM events WHERE id = 3;
+ROLLBACK;
+SELECT shardid, row_count, null_count, min_value, max_value
+FROM pg_dist_shard_column_stats WHERE logicalrelid = 'events'::regclass ORDER BY shardid;
+SELECT public.coordinator_plan($Q$
+EXPLAIN (COSTS OFF)
+SELECT * FROM events WHERE created_at >= '2024-03-31';
+$Q$);
+SELECT count(*) FROM events WHERE created_at >= '2024-03-31';
+
+-- collecting without a column collects the columns that have statistics
+SELECT citus_collect_shard_column_statistics('events', 'id');
+SELECT citus_collect_shard_column_statistics('events');
+SELECT attnum, count(*) FROM pg_dist_shard_column_stats
+WHERE logicalrelid = 'events'::regclass GROUP BY attnum ORDER BY attnum;
+SELECT count(*) FROM events WHERE created_at >= '2024-03-31' AND id > 5;
+
+-- unsupported tables and columns
+CREATE TABLE ref_table(a int);
+SELECT create_reference_table('ref_table');
+SELECT citus_collect_shard_column_statistics('ref_table', 'a');
+CREATE TABLE partitioned_events(id int, created_at date) PARTITION BY RANGE (created_at);
+SELECT create_distributed_table('partitioned_events', 'id');
+SELECT citus_collect_shard_column_statistics('partitioned_events', 'created_at');
+SELECT citus_collect_shard_column_statistics('events', 'no_such_column');
+SELECT citus_collect_shard_column_statistics('events', 'ctid');
+ALTER TABLE events ADD COLUMN location point;
+SELECT citus_collect_shard_column_statistics('events', 'location');
+
+-- dropping the statistics of a column or a table
+SELECT citus_drop_shard_column_statistics('events', 'id');
+SELECT attnum, count(*) FROM pg_dist_shard_column_stats
+WHERE logicalrelid = 'events'::regclass GROUP BY attnum ORDER BY attnum;
+DROP TABLE events;
+SELECT count(*) FROM pg_dist_shard_column_stats;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA shard_column_statistics CASCADE;
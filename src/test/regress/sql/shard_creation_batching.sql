@@ -0,0 +1,41 @@
+--
+-- shard_creation_batching.sql
+--
+-- Test sending the commands that create several shards on a node in a single
+-- round-trip.
+--
+
+CREATE SCHEMA shard_creation_batching;
+SET search_path TO shard_creation_batching;
+SET citus.next_shard_id TO 1939200;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 8;
+
+CREATE TABLE ref_table(a int PRIMARY KEY);
+SELECT create_reference_table('ref_table');
+INSERT INTO ref_table SELECT i FROM generate_series(1, 10) i;
+
+-- the batch size does not divide the number of shards per node
+SET citus.shard_creation_batch_size TO 3;
+CREATE TABLE dist_table(a int PRIMARY KEY, b int REFERENCES ref_table(a), c text);
+CREATE INDEX dist_table_c_idx ON dist_table(c);
+SELECT create_distributed_table('dist_table', 'a');
+
+CREATE TABLE colocated_table(a int REFERENCES dist_table(a), b int);
+SELECT create_distributed_table('colocated_table', 'a', colocate_with => 'dist_table');
+RESET citus.shard_creation_batch_size;
+
+-- all shards got their indexes and foreign keys
+SELECT count(*) FROM run_command_on_placements('dist_table',
+	$$SELECT count(*) FROM pg_index WHERE indrelid = '%s'::regclass$$)
+WHERE result = '2';
+SELECT count(*) FROM run_command_on_placements('colocated_table',
+	$$SELECT count(*) FROM pg_constraint WHERE conrelid = '%s'::regclass$$)
+WHERE result = '1';
+
+INSERT INTO dist_table SELECT i, i % 10 + 1, i::text FROM generate_series(1, 100) i;
+INSERT INTO colocated_table SELECT i, i FROM generate_series(1, 100) i;
+SELECT count(*) FROM dist_table JOIN colocated_table USING (a) WHERE c = '42';
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA shard_creation_batching CASCADE;
@@ -0,0 +1,53 @@
+--
+-- shard_ddl_batching.sql
+--
+-- Test sending the DDL commands of several shards on a node with a single
+-- command.
+--
+
+CREATE SCHEMA shard_ddl_batching;
+SET search_path TO shard_ddl_batching;
+SET citus.next_shard_id TO 1940000;
+SET citus.shard_count TO 8;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE ref_table (a int PRIMARY KEY);
+SELECT create_reference_table('ref_table');
+INSERT INTO ref_table SELECT i FROM generate_series(1, 10) i;
+
+CREATE TABLE dist_table (a int, b int);
+SELECT create_distributed_table('dist_table', 'a');
+INSERT INTO dist_table SELECT i, i FROM generate_series(1, 10) i;
+
+SET citus.shard_ddl_batch_size TO 3;
+
+ALTER TABLE dist_table ADD COLUMN c int DEFAULT 5;
+CREATE INDEX dist_table_b_idx ON dist_table (b);
+ALTER TABLE dist_table ADD CONSTRAINT a_fkey FOREIGN KEY (a) REFERENCES ref_table (a);
+
+SELECT DISTINCT result FROM run_command_on_shards('dist_table', $$
+    SELECT count(*) FROM pg_attribute WHERE attrelid = '%s'::regclass AND attname = 'c'
+$$);
+SELECT DISTINCT result FROM run_command_on_shards('dist_table', $$
+    SELECT count(*) FROM pg_constraint WHERE conrelid = '%s'::regclass AND contype = 'f'
+$$);
+SELECT count(*) FROM dist_table WHERE c = 5;
+
+-- shards that were already accessed in the transaction are not batched
+BEGIN;
+SELECT count(*) FROM dist_table WHERE a = 1;
+ALTER TABLE dist_table ADD COLUMN d int;
+UPDATE dist_table SET d = a;
+SELECT sum(d) FROM dist_table;
+COMMIT;
+
+-- batched commands are rolled back with the transaction
+BEGIN;
+ALTER TABLE dist_table DROP COLUMN d;
+ROLLBACK;
+SELECT DISTINCT result FROM run_command_on_shards('dist_table', $$
+    SELECT count(*) FROM pg_attribute WHERE attrelid = '%s'::regclass AND attname = 'd' AND NOT attisdropped
+$$);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA shard_ddl_batching CASCADE;
@@ -0,0 +1,34 @@
+--
+-- shard_move_parallel_apply.sql
+--
+-- Test moving shards with logical replication subscriptions that stream
+-- and apply large transactions in parallel.
+--
+
+CREATE SCHEMA shard_move_parallel_apply;
+SET search_path TO shard_move_parallel_apply;
+SET citus.next_shard_id TO 1939800;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 1;
+
+CREATE TABLE events (id bigint PRIMARY KEY, payload text);
+SELECT create_distributed_table('events', 'id');
+INSERT INTO events SELECT i, 'event ' || i FROM generate_series(1, 1000) i;
+
+SET citus.logical_replication_parallel_apply TO on;
+SELECT citus_move_shard_placement(1939800, 'localhost', :worker_1_port,
+                                  'localhost', :worker_2_port, 'force_logical');
+RESET citus.logical_replication_parallel_apply;
+
+SELECT nodeport = :worker_2_port AS on_worker_2
+FROM pg_dist_shard JOIN pg_dist_shard_placement USING (shardid)
+WHERE logicalrelid = 'events'::regclass;
+
+SELECT count(*), count(DISTINCT payload) FROM events;
+
+-- no moves are running, so no replication lag is reported
+SELECT count(*) FROM get_rebalance_progress() WHERE replication_lag IS NOT NULL;
+
+SET client_min_messages TO WARNING;
+CALL citus_cleanup_orphaned_resources();
+DROP SCHEMA shard_move_parallel_apply CASCADE;
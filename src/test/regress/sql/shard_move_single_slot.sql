@@ -0,0 +1,52 @@
+--
+-- shard_move_single_slot.sql
+--
+-- Test moving a shard group with tables of multiple owners through a single
+-- replication slot.
+--
+
+CREATE SCHEMA shard_move_single_slot;
+SET search_path TO shard_move_single_slot;
+SET citus.next_shard_id TO 1939700;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 1;
+
+CREATE ROLE shard_move_single_slot_owner_1;
+CREATE ROLE shard_move_single_slot_owner_2;
+GRANT ALL ON SCHEMA shard_move_single_slot TO shard_move_single_slot_owner_1,
+                                              shard_move_single_slot_owner_2;
+
+CREATE TABLE orders (id bigint PRIMARY KEY, total int);
+CREATE TABLE order_lines (id bigint, line int, PRIMARY KEY (id, line));
+ALTER TABLE orders OWNER TO shard_move_single_slot_owner_1;
+ALTER TABLE order_lines OWNER TO shard_move_single_slot_owner_2;
+SELECT create_distributed_table('orders', 'id');
+SELECT create_distributed_table('order_lines', 'id', colocate_with => 'orders');
+
+INSERT INTO orders SELECT i, i FROM generate_series(1, 1000) i;
+INSERT INTO order_lines SELECT i, j FROM generate_series(1, 1000) i, generate_series(1, 3) j;
+
+SET citus.logical_replication_single_slot TO on;
+SELECT citus_move_shard_placement(1939700, 'localhost', :worker_1_port,
+                                  'localhost', :worker_2_port, 'force_logical');
+RESET citus.logical_replication_single_slot;
+
+SELECT logicalrelid, nodeport = :worker_2_port AS on_worker_2
+FROM pg_dist_shard JOIN pg_dist_shard_placement USING (shardid)
+WHERE logicalrelid IN ('orders'::regclass, 'order_lines'::regclass)
+ORDER BY 1;
+
+SELECT count(*), sum(total) FROM orders;
+SELECT count(*), count(DISTINCT id) FROM order_lines;
+
+-- the tables kept their owners
+SELECT result FROM run_command_on_placements('orders', 'SELECT relowner::regrole FROM pg_class WHERE oid = ''%s''::regclass');
+SELECT result FROM run_command_on_placements('order_lines', 'SELECT relowner::regrole FROM pg_class WHERE oid = ''%s''::regclass');
+
+-- the subscription and its owner were dropped
+SELECT run_command_on_workers($$SELECT count(*) FROM pg_roles WHERE rolname LIKE 'citus_shard_move_subscription_role_%'$$);
+
+SET client_min_messages TO WARNING;
+CALL citus_cleanup_orphaned_resources();
+DROP SCHEMA shard_move_single_slot CASCADE;
+DROP ROLE shard_move_single_slot_owner_1, shard_move_single_slot_owner_2;
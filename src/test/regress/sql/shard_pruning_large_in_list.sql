@@ -0,0 +1,161 @@
+--
+-- shard_pruning_large_in_list.sql
+--
+-- Test shard pruning for <distribution column> = ANY(<constant array>)
+-- filters on hash distributed tables with large arrays, and sending each
+-- task only the array elements that belong to its shard.
+--
+CREATE SCHEMA shard_pruning_large_in_list;
+SET search_path TO shard_pruning_large_in_list;
+
+SET citus.next_shard_id TO 1900000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 32;
+
+CREATE TABLE tenants(tenant_id bigint, value int);
+SELECT create_distributed_table('tenants', 'tenant_id');
+INSERT INTO tenants SELECT i, i % 10 FROM generate_series(1, 10000) i;
+
+-- returns the task count of the distributed plan of the given query
+CREATE FUNCTION task_count(query text)
+RETURNS int LANGUAGE plpgsql AS $$
+DECLARE
+  line text;
+BEGIN
+  FOR line IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+    IF line LIKE '%Task Count: %' THEN
+      RETURN substring(line FROM 'Task Count: (\d+)')::int;
+    END IF;
+  END LOOP;
+  RETURN NULL;
+END;
+$$;
+
+-- returns the result of the given count query
+CREATE FUNCTION run_count(query text)
+RETURNS bigint LANGUAGE plpgsql AS $$
+DECLARE
+  result bigint;
+BEGIN
+  EXECUTE query INTO result;
+  RETURN result;
+END;
+$$;
+
+-- returns the number of shards that the given tenants belong to
+CREATE FUNCTION shard_count_for(tenant_ids bigint[])
+RETURNS bigint LANGUAGE sql AS $$
+  SELECT count(DISTINCT get_shard_id_for_distribution_column('tenants', tenant_id))
+  FROM unnest(tenant_ids) tenant_id WHERE tenant_id IS NOT NULL;
+$$;
+
+-- a short list only hits the shards of its tenants
+WITH tenant_list AS (
+  SELECT 'SELECT count(*) FROM tenants WHERE tenant_id = ANY(' ||
+         quote_literal(array_agg(i::bigint)) || ')' AS query,
+         array_agg(i::bigint) AS tenant_ids
+  FROM generate_series(1, 20) i)
+SELECT task_count(query) = shard_count_for(tenant_ids) AS pruned, run_count(query)
+FROM tenant_list;
+
+-- a large list with duplicates and NULLs
+WITH tenant_list AS (
+  SELECT 'SELECT count(*) FROM tenants WHERE tenant_id = ANY(' ||
+         quote_literal(array_agg(tenant_id)) || ')' AS query,
+         array_agg(tenant_id) AS tenant_ids
+  FROM (SELECT CASE WHEN i % 100 = 0 THEN NULL ELSE i % 3000 END::bigint AS tenant_id
+        FROM generate_series(1, 6000) i) tenant_ids)
+SELECT task_count(query) = shard_count_for(tenant_ids) AS pruned, run_count(query)
+FROM tenant_list;
+
+-- filters on other columns do not prevent pruning
+WITH tenant_list AS (
+  SELECT 'SELECT count(*) FROM tenants WHERE value = 3 AND tenant_id = ANY(' ||
+         quote_literal(array_agg(i::bigint)) || ')' AS query,
+         array_agg(i::bigint) AS tenant_ids
+  FROM generate_series(1, 20) i)
+SELECT task_count(query) = shard_count_for(tenant_ids) AS pruned, run_count(query)
+FROM tenant_list;
+
+-- a single distinct tenant is routed to a single shard
+SELECT task_count($Q$SELECT count(*) FROM tenants WHERE tenant_id = ANY('{5,5,NULL,5}')$Q$);
+SELECT count(*) FROM tenants WHERE tenant_id = ANY('{5,5,NULL,5}');
+
+-- combined with another filter on the distribution column
+SELECT task_count($Q$SELECT count(*) FROM tenants WHERE tenant_id = ANY('{1,2,3,4,5,6,7}') AND tenant_id = 7$Q$);
+SELECT count(*) FROM tenants WHERE tenant_id = ANY('{1,2,3,4,5,6,7}') AND tenant_id = 7;
+
+-- array elements of a different type than the distribution column
+SELECT task_count($Q$SELECT count(*) FROM tenants WHERE tenant_id = ANY('{1,2,3}'::int[])$Q$) =
+       shard_count_for('{1,2,3}') AS pruned;
+SELECT count(*) FROM tenants WHERE tenant_id = ANY('{1,2,3}'::int[]);
+
+-- parameterized arrays
+PREPARE tenant_count(bigint[]) AS SELECT count(*) FROM tenants WHERE tenant_id = ANY($1);
+EXECUTE tenant_count('{1,2,3,3,NULL}');
+EXECUTE tenant_count('{}');
+
+-- returns whether the tasks of the given query only get the tenants in their
+-- shard, and the total number of tenants that the tasks get
+CREATE FUNCTION task_tenants(query text, OUT own_tenants_only bool, OUT tenant_count int)
+LANGUAGE plpgsql AS $$
+DECLARE
+  line text;
+  shard_id bigint;
+  tenant_ids bigint[];
+BEGIN
+  PERFORM set_config('citus.explain_all_tasks', 'on', true);
+  own_tenants_only := true;
+  tenant_count := 0;
+  FOR line IN EXECUTE 'EXPLAIN (VERBOSE, COSTS OFF) ' || query LOOP
+    IF line LIKE '%Query: %' THEN
+      shard_id := substring(line FROM 'tenants_(\d+)')::bigint;
+      tenant_ids := substring(line FROM 'ANY \(''(\{[^}]*\})''')::bigint[];
+      own_tenants_only := own_tenants_only AND NOT EXISTS (
+        SELECT 1 FROM unnest(tenant_ids) tenant_id
+        WHERE get_shard_id_for_distribution_column('tenants', tenant_id) <> shard_id);
+      tenant_count := tenant_count + cardinality(tenant_ids);
+    END IF;
+  END LOOP;
+END;
+$$;
+
+-- the tasks only get the elements of large arrays that belong to their shard
+WITH tenant_list AS (
+  SELECT 'SELECT count(*) FROM tenants WHERE tenant_id = ANY(' ||
+         quote_literal(array_agg(i::bigint)) || ')' AS query
+  FROM generate_series(1, 200) i)
+SELECT (task_tenants(query)).*, run_count(query) FROM tenant_list;
+
+WITH tenant_list AS (
+  SELECT 'SELECT count(*) FROM (SELECT DISTINCT tenant_id FROM tenants ' ||
+         'WHERE tenant_id = ANY(' || quote_literal(array_agg(i::bigint)) || ')) t' AS query
+  FROM generate_series(1, 200) i)
+SELECT (task_tenants(query)).*, run_count(query) FROM tenant_list;
+
+-- NULLs are not sent
+WITH tenant_list AS (
+  SELECT 'SELECT count(*) FROM tenants WHERE tenant_id = ANY(' ||
+         quote_literal(array_agg(CASE WHEN i % 10 = 0 THEN NULL ELSE i % 100 END::bigint)) ||
+         ')' AS query
+  FROM generate_series(1, 200) i)
+SELECT (task_tenants(query)).*, run_count(query) FROM tenant_list;
+
+-- smaller arrays are sent as they are
+SET citus.array_restriction_split_threshold TO 1000;
+WITH tenant_list AS (
+  SELECT 'SELECT count(*) FROM tenants WHERE tenant_id = ANY(' ||
+         quote_literal(array_agg(i::bigint)) || ')' AS query
+  FROM generate_series(1, 200) i)
+SELECT (task_tenants(query)).own_tenants_only, run_count(query) FROM tenant_list;
+
+SET citus.array_restriction_split_threshold TO -1;
+WITH tenant_list AS (
+  SELECT 'SELECT count(*) FROM tenants WHERE tenant_id = ANY(' ||
+         quote_literal(array_agg(i::bigint)) || ')' AS query
+  FROM generate_series(1, 200) i)
+SELECT (task_tenants(query)).own_tenants_only, run_count(query) FROM tenant_list;
+RESET citus.array_restriction_split_threshold;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA shard_pruning_large_in_list CASCADE;
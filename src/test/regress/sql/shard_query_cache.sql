@@ -0,0 +1,76 @@
+--
+-- shard_query_cache.sql
+--
+-- Test caching the shard queries of prepared fast path queries whose shard
+-- pruning is deferred to the execution.
+--
+CREATE SCHEMA shard_query_cache;
+SET search_path TO shard_query_cache;
+
+SET citus.next_shard_id TO 1890000;
+SET citus.shard_replication_factor TO 1;
+
+SET citus.shard_count TO 1;
+CREATE TABLE single_shard(key int, value int);
+SELECT create_distributed_table('single_shard', 'key');
+INSERT INTO single_shard SELECT i, i * 10 FROM generate_series(1, 10) i;
+
+SET citus.shard_count TO 4;
+CREATE TABLE test(key int, value int);
+SELECT create_distributed_table('test', 'key');
+INSERT INTO test SELECT i, i * 10 FROM generate_series(1, 100) i;
+
+SET citus.enable_shard_query_caching TO on;
+SET plan_cache_mode TO force_generic_plan;
+
+PREPARE select_value(int) AS SELECT value FROM single_shard WHERE key = $1;
+
+-- the shard query is cached from the second execution on, and the parameters
+-- are sent along with it
+EXECUTE select_value(1);
+SET citus.log_remote_commands TO on;
+EXECUTE select_value(2);
+EXECUTE select_value(3);
+RESET citus.log_remote_commands;
+
+-- the parameters that are not on the distribution column are sent too
+PREPARE select_sum(int, int) AS
+SELECT key, value + $2 AS value FROM test WHERE key = $1 AND value > $2;
+
+EXECUTE select_sum(1, 5);
+EXECUTE select_sum(2, 5);
+EXECUTE select_sum(2, 50);
+EXECUTE select_sum(7, 5);
+EXECUTE select_sum(8, 5);
+EXECUTE select_sum(50, 5);
+EXECUTE select_sum(99, 5);
+
+-- NULL values on the distribution column don't hit any shards
+EXECUTE select_sum(NULL, 5);
+
+PREPARE update_value(int, int) AS
+UPDATE test SET value = $2 WHERE key = $1 RETURNING *;
+
+EXECUTE update_value(1, 11);
+EXECUTE update_value(2, 22);
+EXECUTE update_value(3, 33);
+EXECUTE update_value(50, 500);
+
+PREPARE delete_value(int) AS DELETE FROM test WHERE key = $1 RETURNING *;
+
+EXECUTE delete_value(4);
+EXECUTE delete_value(5);
+EXECUTE delete_value(6);
+
+SELECT count(*), sum(value) FROM test;
+
+-- modifications that evaluate functions on the coordinator are not cached
+PREPARE update_random(int) AS
+UPDATE test SET value = (random() * 0)::int WHERE key = $1 RETURNING *;
+
+EXECUTE update_random(7);
+EXECUTE update_random(8);
+EXECUTE update_random(9);
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA shard_query_cache CASCADE;
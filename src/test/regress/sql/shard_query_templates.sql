@@ -0,0 +1,82 @@
+--
+-- shard_query_templates.sql
+--
+-- Test building the queries of the tasks of multi-shard queries by splicing
+-- the shard names into a query that is deparsed once.
+--
+CREATE SCHEMA "shard query templates";
+SET search_path TO "shard query templates";
+
+SET citus.next_shard_id TO 1910000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE dist_table(a int, b int, c text);
+SELECT create_distributed_table('dist_table', 'a');
+INSERT INTO dist_table SELECT i, i % 10, 'text ' || i FROM generate_series(1, 100) i;
+
+-- names that need quoting and names that are truncated for the shards
+CREATE TABLE "Other Table"(a int, "B" int);
+SELECT create_distributed_table('"Other Table"', 'a', colocate_with => 'dist_table');
+INSERT INTO "Other Table" SELECT i, i FROM generate_series(1, 100) i;
+
+CREATE TABLE table_with_a_long_name_that_gets_truncated_in_the_shard_names(a int);
+SELECT create_distributed_table('table_with_a_long_name_that_gets_truncated_in_the_shard_names', 'a', colocate_with => 'dist_table');
+INSERT INTO table_with_a_long_name_that_gets_truncated_in_the_shard_names
+SELECT generate_series(1, 100);
+
+CREATE TABLE ref_table(b int, name text);
+SELECT create_reference_table('ref_table');
+INSERT INTO ref_table SELECT i, 'name ' || i FROM generate_series(0, 9) i;
+
+SET citus.enable_shard_query_templates TO on;
+
+SELECT count(*), sum(a), max(c) FROM dist_table;
+SELECT b, count(*) FROM dist_table WHERE a > 50 GROUP BY b ORDER BY b LIMIT 3;
+
+-- joins, including self-joins
+SELECT count(*), sum(o."B") FROM dist_table d JOIN "Other Table" o USING (a) WHERE d.b = 3;
+SELECT count(*) FROM dist_table d1 JOIN dist_table d2 USING (a) WHERE d1.b = d2.b;
+SELECT count(*)
+FROM dist_table JOIN table_with_a_long_name_that_gets_truncated_in_the_shard_names t USING (a);
+SELECT name, count(*) FROM dist_table JOIN ref_table USING (b)
+GROUP BY name ORDER BY name LIMIT 2;
+
+-- subqueries and whole-row references
+SELECT count(*) FROM (SELECT d FROM dist_table d WHERE a < 20) s;
+SELECT count(*) FROM dist_table
+WHERE a IN (SELECT a FROM "Other Table" WHERE "B" % 2 = 0);
+
+-- literals that look like the shard names
+SELECT count(*) FROM dist_table WHERE c <> 'dist_table_1910000' AND c <> E'\x01' || '0';
+
+-- arrays that are reduced to the elements of each shard
+SET citus.array_restriction_split_threshold TO 2;
+SELECT count(*), sum(b) FROM dist_table WHERE a = ANY(ARRAY[1, 2, 3, 4, 5, 6]);
+RESET citus.array_restriction_split_threshold;
+
+-- modifications, with and without functions evaluated on the coordinator
+UPDATE dist_table SET b = b + 1 WHERE b = 9;
+UPDATE dist_table SET c = 'updated ' || length(now()::text)::bool WHERE a % 10 = 1;
+DELETE FROM "Other Table" WHERE "B" > 90 AND now() IS NOT NULL;
+SELECT b, count(*) FROM dist_table GROUP BY b ORDER BY b;
+SELECT c, count(*) FROM dist_table WHERE c LIKE 'updated%' GROUP BY c;
+SELECT count(*) FROM "Other Table";
+
+-- templates kept across executions, and dropped on DDL
+SET citus.enable_shard_query_template_cache TO on;
+SELECT count(*), sum(o."B") FROM dist_table d JOIN "Other Table" o USING (a) WHERE d.b = 3;
+SELECT count(*), sum(o."B") FROM dist_table d JOIN "Other Table" o USING (a) WHERE d.b = 3;
+ALTER TABLE "Other Table" RENAME COLUMN "B" TO "New B";
+SELECT count(*), sum(o."New B") FROM dist_table d JOIN "Other Table" o USING (a) WHERE d.b = 3;
+ALTER TABLE "Other Table" RENAME COLUMN "New B" TO "B";
+DELETE FROM dist_table WHERE b > 100;
+DELETE FROM dist_table WHERE b > 100;
+RESET citus.enable_shard_query_template_cache;
+
+-- the results are the same without templates
+SET citus.enable_shard_query_templates TO off;
+SELECT count(*), sum(o."B") FROM dist_table d JOIN "Other Table" o USING (a) WHERE d.b = 3;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA "shard query templates" CASCADE;
@@ -584,3 +584,29 @@ SELECT unnest(shard_placement_rebalance_array(
         ]::json[],
     improvement_threshold := 0.1
 ));
+
+
+-- Test that the query load is balanced by swapping shards when moving a
+-- single shard would unbalance the shard counts
+SELECT unnest(shard_placement_rebalance_array(
+    ARRAY['{"node_name": "a"}',
+          '{"node_name": "b"}']::json[],
+    ARRAY['{"shardid":1, "load":100, "nodename":"a"}',
+          '{"shardid":2, "load":100, "nodename":"a"}',
+          '{"shardid":3, "load":1,   "nodename":"b"}',
+          '{"shardid":4, "load":1,   "nodename":"b"}'
+        ]::json[]
+));
+
+
+-- Test that balancing the cost does not move a busy shard to a node that
+-- already has a lot of query load
+SELECT unnest(shard_placement_rebalance_array(
+    ARRAY['{"node_name": "a"}',
+          '{"node_name": "b"}']::json[],
+    ARRAY['{"shardid":1, "load":100, "nodename":"a"}',
+          '{"shardid":2, "nodename":"a"}',
+          '{"shardid":3, "nodename":"a"}',
+          '{"shardid":4, "load":100, "nodename":"b"}'
+        ]::json[]
+));
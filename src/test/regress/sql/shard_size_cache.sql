@@ -0,0 +1,63 @@
+--
+-- shard_size_cache.sql
+--
+-- Test that the size functions use the shard sizes collected into the shard
+-- size cache while they are recent enough, and query the nodes otherwise.
+--
+CREATE SCHEMA shard_size_cache;
+SET search_path TO shard_size_cache;
+
+SET citus.next_shard_id TO 1913000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE sizes(id int, value int);
+SELECT create_distributed_table('sizes', 'id');
+
+-- cache the sizes of the empty shards
+SELECT citus_refresh_shard_size_cache('sizes');
+
+INSERT INTO sizes SELECT i, i FROM generate_series(1, 100) i;
+
+-- the cached sizes are used until they are older than the maximum age
+SELECT citus_table_size('sizes'), citus_total_relation_size('sizes');
+SET citus.shard_size_cache_max_age TO 0;
+SELECT citus_table_size('sizes'), citus_total_relation_size('sizes');
+RESET citus.shard_size_cache_max_age;
+
+-- the size of the main fork is not cached
+SELECT citus_relation_size('sizes');
+
+SELECT citus_refresh_shard_size_cache('sizes');
+SELECT citus_table_size('sizes'), citus_total_relation_size('sizes');
+
+-- indexes are not cached, their size is queried from the nodes
+CREATE INDEX sizes_id_idx ON sizes (id);
+SELECT citus_total_relation_size('sizes_id_idx') > 0 AS index_has_size;
+
+-- the cached total relation size of the table does not include the new index yet
+SELECT citus_total_relation_size('sizes');
+
+-- citus_shard_sizes uses the cache only when it holds the sizes of all shards
+SELECT citus_refresh_shard_size_cache() >= 4 AS refreshed;
+INSERT INTO sizes SELECT i, i FROM generate_series(101, 5000) i;
+SELECT shard_id, size FROM citus_shard_sizes()
+WHERE shard_id BETWEEN 1913000 AND 1913003 ORDER BY shard_id;
+SET citus.shard_size_cache_max_age TO 0;
+SELECT shard_id, size > 16384 AS has_grown FROM citus_shard_sizes()
+WHERE shard_id BETWEEN 1913000 AND 1913003 ORDER BY shard_id;
+RESET citus.shard_size_cache_max_age;
+
+-- the sizes of a dropped table are not used for a new table with its shards
+DROP TABLE sizes;
+SET citus.next_shard_id TO 1913000;
+CREATE TABLE sizes(id int, value int);
+SELECT create_distributed_table('sizes', 'id');
+INSERT INTO sizes SELECT i, i FROM generate_series(1, 100) i;
+SELECT citus_table_size('sizes');
+
+CREATE TABLE local_table(id int);
+SELECT citus_refresh_shard_size_cache('local_table');
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA shard_size_cache CASCADE;
@@ -0,0 +1,44 @@
+--
+-- shard_split_copy_streams.sql
+--
+-- Test splitting a shard with several parallel split copy streams.
+--
+
+CREATE SCHEMA shard_split_copy_streams;
+SET search_path TO shard_split_copy_streams;
+SET citus.next_shard_id TO 1939600;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 1;
+
+CREATE TABLE events (id bigint, payload text);
+SELECT create_distributed_table('events', 'id');
+INSERT INTO events SELECT i, repeat('x', 100) FROM generate_series(1, 10000) i;
+CREATE INDEX events_id_idx ON events (id);
+
+SELECT nodeid AS worker_1_node FROM pg_dist_node WHERE nodeport = :worker_1_port \gset
+SELECT nodeid AS worker_2_node FROM pg_dist_node WHERE nodeport = :worker_2_port \gset
+
+-- each of the 4 streams copies a range of blocks to all split children
+SET citus.shard_split_copy_streams TO 4;
+SELECT citus_split_shard_by_split_points(
+    1939600,
+    ARRAY['-1073741824', '0', '1073741824'],
+    ARRAY[:worker_1_node, :worker_2_node, :worker_1_node, :worker_2_node],
+    'block_writes');
+RESET citus.shard_split_copy_streams;
+
+-- no rows were lost or copied twice
+SELECT count(*), count(DISTINCT id) FROM events;
+SELECT sum(result::int) FROM run_command_on_shards('events', 'SELECT count(*) FROM %s');
+
+SELECT nodeport = :worker_1_port AS on_worker_1, count(*)
+FROM pg_dist_shard JOIN pg_dist_shard_placement USING (shardid)
+WHERE logicalrelid = 'events'::regclass
+GROUP BY 1 ORDER BY 1;
+
+-- every row is in the child that owns its hash value
+SELECT count(*) FROM events WHERE id = 4242;
+
+SET client_min_messages TO WARNING;
+CALL citus_cleanup_orphaned_resources();
+DROP SCHEMA shard_split_copy_streams CASCADE;
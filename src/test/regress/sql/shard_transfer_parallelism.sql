@@ -0,0 +1,57 @@
+--
+-- shard_transfer_parallelism.sql
+--
+-- Test copying the data and building the indexes of colocated shards over
+-- several connections when moving shards.
+--
+
+CREATE SCHEMA shard_transfer_parallelism;
+SET search_path TO shard_transfer_parallelism;
+SET citus.next_shard_id TO 1939400;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE first_table(a int PRIMARY KEY, b int);
+CREATE INDEX first_table_b_idx ON first_table(b);
+SELECT create_distributed_table('first_table', 'a');
+
+CREATE TABLE second_table(a int PRIMARY KEY, b int, c text);
+CREATE INDEX second_table_b_idx ON second_table(b);
+CREATE INDEX second_table_c_idx ON second_table(c);
+SELECT create_distributed_table('second_table', 'a', colocate_with => 'first_table');
+
+INSERT INTO first_table SELECT i, i FROM generate_series(1, 1000) i;
+INSERT INTO second_table SELECT i, i, i::text FROM generate_series(1, 1000) i;
+
+SELECT nodeport AS source_port FROM pg_dist_shard_placement WHERE shardid = 1939400 \gset
+SELECT nodeport AS target_port FROM pg_dist_node
+WHERE noderole = 'primary' AND shouldhaveshards AND nodeport <> :source_port
+ORDER BY nodeport LIMIT 1 \gset
+
+SET citus.shard_transfer_parallelism TO 2;
+
+SELECT citus_move_shard_placement(1939400, 'localhost', :source_port, 'localhost', :target_port,
+								  shard_transfer_mode := 'block_writes');
+SET client_min_messages TO WARNING;
+CALL citus_cleanup_orphaned_resources();
+RESET client_min_messages;
+SELECT citus_move_shard_placement(1939400, 'localhost', :target_port, 'localhost', :source_port,
+								  shard_transfer_mode := 'force_logical');
+
+RESET citus.shard_transfer_parallelism;
+SET client_min_messages TO WARNING;
+CALL citus_cleanup_orphaned_resources();
+RESET client_min_messages;
+
+-- the moved shards got their indexes
+SELECT count(*) FROM run_command_on_placements('first_table',
+	$$SELECT count(*) FROM pg_index WHERE indrelid = '%s'::regclass$$)
+WHERE result = '2';
+SELECT count(*) FROM run_command_on_placements('second_table',
+	$$SELECT count(*) FROM pg_index WHERE indrelid = '%s'::regclass$$)
+WHERE result = '3';
+
+SELECT count(*) FROM first_table JOIN second_table USING (a) WHERE c = '42';
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA shard_transfer_parallelism CASCADE;
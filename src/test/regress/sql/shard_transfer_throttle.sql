@@ -0,0 +1,43 @@
+--
+-- shard_transfer_throttle.sql
+--
+-- Test limiting the rate at which shard moves send data from a node.
+--
+
+CREATE SCHEMA shard_transfer_throttle;
+SET search_path TO shard_transfer_throttle;
+SET citus.next_shard_id TO 1939500;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 2;
+
+-- the rate is set on the nodes that send the shards
+SELECT result FROM run_command_on_workers('ALTER SYSTEM SET citus.shard_transfer_max_rate TO ''1MB''');
+SELECT result FROM run_command_on_workers('SELECT pg_reload_conf()');
+SELECT pg_sleep(0.1);
+SELECT result FROM run_command_on_workers($$SELECT setting FROM pg_settings WHERE name = 'citus.shard_transfer_max_rate'$$);
+
+CREATE TABLE throttled_table(a int PRIMARY KEY, b text);
+SELECT create_distributed_table('throttled_table', 'a');
+INSERT INTO throttled_table SELECT i, md5(i::text) FROM generate_series(1, 5000) i;
+
+SELECT nodeport AS source_port FROM pg_dist_shard_placement WHERE shardid = 1939500 \gset
+SELECT nodeport AS target_port FROM pg_dist_node
+WHERE noderole = 'primary' AND shouldhaveshards AND nodeport <> :source_port
+ORDER BY nodeport LIMIT 1 \gset
+
+SELECT citus_move_shard_placement(1939500, 'localhost', :source_port, 'localhost', :target_port,
+								  shard_transfer_mode := 'block_writes');
+SET client_min_messages TO WARNING;
+CALL citus_cleanup_orphaned_resources();
+RESET client_min_messages;
+
+SELECT count(*), count(DISTINCT b) FROM throttled_table;
+
+-- no moves are in progress
+SELECT count(*) FROM get_rebalance_progress() WHERE source_max_copy_rate IS NOT NULL;
+
+SELECT result FROM run_command_on_workers('ALTER SYSTEM RESET citus.shard_transfer_max_rate');
+SELECT result FROM run_command_on_workers('SELECT pg_reload_conf()');
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA shard_transfer_throttle CASCADE;
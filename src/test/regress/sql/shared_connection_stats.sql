@@ -161,6 +161,63 @@ BEGIN;
 		hostname, port;
 COMMIT;
 
+-- reserve 2 connections of the shared pool for each higher execution priority
+ALTER SYSTEM SET citus.shared_pool_priority_reserve TO 2;
+SELECT pg_reload_conf();
+SELECT pg_sleep(0.1);
+
+-- executions with the default priority leave 2 connections to high priority ones
+BEGIN;
+	SET LOCAL citus.execution_priority TO normal;
+	SET LOCAL citus.max_adaptive_executor_pool_size TO 16;
+	with cte_1 as (select pg_sleep(0.1) is null, a from test) SELECT a from cte_1 ORDER By 1 LIMIT 1;
+	SELECT
+		connection_count_to_node
+	FROM
+		citus_remote_connection_stats()
+	WHERE
+		port IN (SELECT node_port FROM master_get_active_worker_nodes()) AND
+		database_name = 'regression'
+	ORDER BY
+		hostname, port;
+COMMIT;
+
+-- low priority executions leave 4 connections, and only get the required one
+BEGIN;
+	SET LOCAL citus.execution_priority TO low;
+	SET LOCAL citus.max_adaptive_executor_pool_size TO 16;
+	with cte_1 as (select pg_sleep(0.1) is null, a from test) SELECT a from cte_1 ORDER By 1 LIMIT 1;
+	SELECT
+		connection_count_to_node
+	FROM
+		citus_remote_connection_stats()
+	WHERE
+		port IN (SELECT node_port FROM master_get_active_worker_nodes()) AND
+		database_name = 'regression'
+	ORDER BY
+		hostname, port;
+COMMIT;
+
+-- high priority executions can use the whole shared pool
+BEGIN;
+	SET LOCAL citus.execution_priority TO high;
+	SET LOCAL citus.max_adaptive_executor_pool_size TO 16;
+	with cte_1 as (select pg_sleep(0.1) is null, a from test) SELECT a from cte_1 ORDER By 1 LIMIT 1;
+	SELECT
+		connection_count_to_node
+	FROM
+		citus_remote_connection_stats()
+	WHERE
+		port IN (SELECT node_port FROM master_get_active_worker_nodes()) AND
+		database_name = 'regression'
+	ORDER BY
+		hostname, port;
+COMMIT;
+
+ALTER SYSTEM RESET citus.shared_pool_priority_reserve;
+SELECT pg_reload_conf();
+SELECT pg_sleep(0.1);
+
 
 SHOW citus.max_shared_pool_size;
 
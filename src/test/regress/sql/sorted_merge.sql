@@ -0,0 +1,89 @@
+--
+-- sorted_merge.sql
+--
+-- Test merging the sorted results of the tasks on the coordinator instead of
+-- sorting all rows of multi-shard queries with ORDER BY.
+--
+CREATE SCHEMA sorted_merge;
+SET search_path TO sorted_merge;
+
+SET citus.next_shard_id TO 1905000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE dist_table(key int, value text, score int);
+SELECT create_distributed_table('dist_table', 'key');
+
+INSERT INTO dist_table
+SELECT i, 'value ' || (i % 5), CASE WHEN i % 4 = 0 THEN NULL ELSE i % 7 END
+FROM generate_series(1, 12) i;
+
+-- returns whether the coordinator sorts the rows returned by the workers
+CREATE FUNCTION coordinator_sorts(query text)
+RETURNS bool LANGUAGE plpgsql AS $$
+DECLARE
+  plan_line text;
+BEGIN
+  FOR plan_line IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+    IF plan_line LIKE '%Task Count:%' THEN
+      RETURN false;
+    ELSIF plan_line LIKE '%Sort%' THEN
+      RETURN true;
+    END IF;
+  END LOOP;
+  RETURN false;
+END;
+$$;
+
+-- disabled by default
+SELECT coordinator_sorts('SELECT key FROM dist_table ORDER BY key');
+
+SET citus.enable_sorted_merge TO on;
+
+SELECT coordinator_sorts('SELECT key FROM dist_table ORDER BY key');
+SELECT key, value FROM dist_table ORDER BY key;
+
+SELECT coordinator_sorts('SELECT key, score FROM dist_table ORDER BY score DESC, key');
+SELECT key, score FROM dist_table ORDER BY score DESC, key;
+
+SELECT coordinator_sorts('SELECT key, value FROM dist_table ORDER BY value, key DESC');
+SELECT key, value FROM dist_table ORDER BY value, key DESC;
+
+SELECT coordinator_sorts('SELECT key FROM dist_table ORDER BY key LIMIT 3 OFFSET 2');
+SELECT key FROM dist_table ORDER BY key LIMIT 3 OFFSET 2;
+
+-- groups by the distribution column are complete on the workers
+SELECT key, count(*) FROM dist_table GROUP BY key ORDER BY key LIMIT 4;
+
+-- NULLs in the non-default position are sorted by the coordinator
+SELECT coordinator_sorts('SELECT key, score FROM dist_table ORDER BY score NULLS FIRST, key');
+SELECT key, score FROM dist_table ORDER BY score NULLS FIRST, key LIMIT 4;
+
+-- groups that are combined on the coordinator are sorted there
+SELECT coordinator_sorts('SELECT value, count(*) FROM dist_table GROUP BY value ORDER BY value');
+SELECT value, count(*) FROM dist_table GROUP BY value ORDER BY value;
+
+-- sort keys that are not in the target list
+SELECT key FROM dist_table WHERE score IS NOT NULL ORDER BY score, key;
+
+-- scrollable cursors read the merged rows in both directions
+BEGIN;
+DECLARE sorted_cursor SCROLL CURSOR FOR SELECT key FROM dist_table ORDER BY key DESC;
+FETCH 3 FROM sorted_cursor;
+FETCH BACKWARD 2 FROM sorted_cursor;
+COMMIT;
+
+-- prepared statements keep merging the results
+PREPARE sorted_keys(int) AS SELECT key FROM dist_table WHERE key > $1 ORDER BY key;
+EXECUTE sorted_keys(8);
+EXECUTE sorted_keys(9);
+EXECUTE sorted_keys(10);
+EXECUTE sorted_keys(11);
+EXECUTE sorted_keys(12);
+EXECUTE sorted_keys(7);
+DEALLOCATE sorted_keys;
+
+RESET citus.enable_sorted_merge;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA sorted_merge CASCADE;
@@ -253,6 +253,34 @@ SELECT normalize_query_string(query), executor, partition_key, calls
 FROM citus_stat_statements
 ORDER BY 1, 2, 3, 4;
 
+-- every call is counted in the total and remote wait time histograms, every plan in the planning time histogram
+SELECT metric, sum(count) = (SELECT sum(calls) FROM citus_stat_statements) AS matches_calls
+FROM citus_stat_statements_histograms
+WHERE metric <> 'planning_time'
+GROUP BY metric
+ORDER BY metric;
+
+SELECT sum(count) = (SELECT sum(plans) FROM citus_stat_statements) AS matches_plans
+FROM citus_stat_statements_histograms
+WHERE metric = 'planning_time';
+
+SELECT bool_and(lower_bound < upper_bound) AS valid_buckets
+FROM citus_stat_statements_histograms;
+
+-- queries that create intermediate results show up in citus_stat_intermediate_results
+WITH top_users AS MATERIALIZED (SELECT user_id FROM stat_test_bigint ORDER BY user_id LIMIT 2)
+SELECT count(*) FROM stat_test_bigint JOIN top_users USING (user_id);
+
+SELECT sum(intermediate_results) >= 1 AS has_results, bool_and(bytes_written > 0) AS written,
+       bool_and(bytes_broadcast > 0) AS broadcast, bool_and(receiving_nodes > 0) AS received,
+       bool_and(total_time >= 0) AS timed
+FROM citus_stat_intermediate_results;
+
+-- citus_stat_statements_reset() also resets the histograms
+SELECT citus_stat_statements_reset();
+SELECT count(*) FROM citus_stat_statements_histograms;
+SELECT count(*) FROM citus_stat_intermediate_results;
+
 -- non-stats role should only see its own entries, even when calling citus_query_stats directly
 CREATE USER nostats;
 GRANT SELECT ON TABLE lineitem_hash_part TO nostats;
@@ -0,0 +1,71 @@
+--
+-- subplan_result_reuse.sql
+--
+-- Test reusing the intermediate results of subplans across the statements
+-- of a transaction.
+--
+
+CREATE SCHEMA subplan_result_reuse;
+SET search_path TO subplan_result_reuse;
+SET citus.next_shard_id TO 1936000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE dist_table(a int, b int);
+SELECT create_distributed_table('dist_table', 'a');
+CREATE TABLE other_table(a int, b int);
+SELECT create_distributed_table('other_table', 'a');
+
+INSERT INTO dist_table SELECT i, i % 10 FROM generate_series(1, 1000) i;
+INSERT INTO other_table SELECT i, i % 5 FROM generate_series(1, 100) i;
+
+SET citus.enable_subplan_result_reuse TO on;
+
+BEGIN ISOLATION LEVEL REPEATABLE READ;
+SET LOCAL client_min_messages TO DEBUG1;
+WITH threes AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT max(threes.m), count(*) FROM other_table, threes WHERE other_table.a < threes.m;
+
+-- a later statement with the same CTE reuses its result
+WITH threes AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT max(threes.m), sum(other_table.b) FROM other_table, threes WHERE other_table.a < threes.m;
+
+-- modifying a table that the CTE does not read keeps the result
+UPDATE other_table SET b = b + 1 WHERE a = 1;
+WITH threes AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT max(threes.m), sum(other_table.b) FROM other_table, threes WHERE other_table.a < threes.m;
+
+-- modifying a table that the CTE reads invalidates the result
+INSERT INTO dist_table VALUES (2003, 3);
+WITH threes AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT max(threes.m), sum(other_table.b) FROM other_table, threes WHERE other_table.a < threes.m;
+WITH threes AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT max(threes.m), sum(other_table.b) FROM other_table, threes WHERE other_table.a < threes.m;
+COMMIT;
+
+-- results are not reused in read committed transactions
+BEGIN;
+SET LOCAL client_min_messages TO DEBUG1;
+WITH threes AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT max(threes.m), count(*) FROM other_table, threes WHERE other_table.a < threes.m;
+WITH threes AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT max(threes.m), count(*) FROM other_table, threes WHERE other_table.a < threes.m;
+COMMIT;
+
+-- results are forgotten when a subtransaction rolls back
+BEGIN ISOLATION LEVEL REPEATABLE READ;
+SAVEPOINT s1;
+INSERT INTO dist_table VALUES (3003, 3);
+WITH threes AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT max(threes.m), count(*) FROM other_table, threes WHERE other_table.a < threes.m;
+ROLLBACK TO SAVEPOINT s1;
+SET LOCAL client_min_messages TO DEBUG1;
+WITH threes AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT max(threes.m), count(*) FROM other_table, threes WHERE other_table.a < threes.m;
+WITH threes AS MATERIALIZED (SELECT max(a) AS m FROM dist_table WHERE b = 3)
+SELECT max(threes.m), count(*) FROM other_table, threes WHERE other_table.a < threes.m;
+COMMIT;
+
+RESET citus.enable_subplan_result_reuse;
+SET client_min_messages TO WARNING;
+DROP SCHEMA subplan_result_reuse CASCADE;
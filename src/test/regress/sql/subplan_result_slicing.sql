@@ -0,0 +1,51 @@
+--
+-- subplan_result_slicing.sql
+--
+-- Test sending each node only the rows of a subplan result that hash to the
+-- shards of the table that its tasks join the result with.
+--
+
+CREATE SCHEMA subplan_result_slicing;
+SET search_path TO subplan_result_slicing;
+SET citus.next_shard_id TO 1938000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE dist_table(a int, b int);
+SELECT create_distributed_table('dist_table', 'a');
+CREATE TABLE other_table(a int, b int);
+SELECT create_distributed_table('other_table', 'a');
+
+INSERT INTO dist_table SELECT i, i % 10 FROM generate_series(1, 1000) i;
+INSERT INTO other_table SELECT i, i % 5 FROM generate_series(1, 100) i;
+
+SET citus.enable_subplan_result_slicing TO on;
+
+SET client_min_messages TO DEBUG1;
+
+-- joins on the distribution column slice the result
+WITH picked AS MATERIALIZED (SELECT a, b FROM other_table WHERE b = 1)
+SELECT count(*), sum(dist_table.b) FROM dist_table JOIN picked ON (dist_table.a = picked.a);
+
+-- so do IN filters on the distribution column
+SELECT count(*), sum(b) FROM dist_table
+WHERE a IN (SELECT a FROM other_table WHERE b = 2 ORDER BY a LIMIT 5);
+
+RESET client_min_messages;
+
+-- the result is not sliced when the distributed table is on the nullable side
+WITH picked AS MATERIALIZED (SELECT a, b FROM other_table WHERE b = 1)
+SELECT count(*), count(dist_table.a) FROM picked LEFT JOIN dist_table ON (dist_table.a = picked.b);
+
+-- or when the query also uses the result in other ways
+WITH picked AS MATERIALIZED (SELECT a, b FROM other_table WHERE b = 1)
+SELECT count(*) FROM dist_table JOIN picked ON (dist_table.a = picked.a)
+WHERE dist_table.b < (SELECT count(*) FROM picked);
+
+-- NULLs in the result never match
+WITH picked AS MATERIALIZED (SELECT NULL::int AS a UNION ALL SELECT a FROM other_table WHERE b = 3)
+SELECT count(*) FROM dist_table JOIN picked USING (a);
+
+RESET citus.enable_subplan_result_slicing;
+SET client_min_messages TO WARNING;
+DROP SCHEMA subplan_result_slicing CASCADE;
@@ -0,0 +1,85 @@
+--
+-- subplan_task_pruning.sql
+--
+-- Test skipping the tasks on shards that cannot match the result of a
+-- recursively planned IN subquery on the distribution column.
+--
+CREATE SCHEMA subplan_task_pruning;
+SET search_path TO subplan_task_pruning;
+
+SET citus.next_shard_id TO 1903000;
+SET citus.shard_replication_factor TO 1;
+SET citus.shard_count TO 4;
+
+CREATE TABLE dist_table(key int, value int);
+SELECT create_distributed_table('dist_table', 'key');
+INSERT INTO dist_table SELECT i, i FROM generate_series(1, 100) i;
+
+CREATE TABLE other_table(key int, value int);
+SELECT create_distributed_table('other_table', 'key');
+INSERT INTO other_table SELECT i, i FROM generate_series(1, 100) i;
+
+-- renames the shards of dist_table that key 1 does not hash to, such that
+-- queries fail if they access those shards
+CREATE FUNCTION rename_other_shards(suffix_from text, suffix_to text)
+RETURNS bool LANGUAGE sql AS $$
+  SELECT bool_and(success) FROM (
+    SELECT (run_command_on_workers(format(
+              'ALTER TABLE IF EXISTS subplan_task_pruning.%I RENAME TO %I',
+              'dist_table_' || shardid || suffix_from,
+              'dist_table_' || shardid || suffix_to))).success
+    FROM pg_dist_shard
+    WHERE logicalrelid = 'dist_table'::regclass AND
+          shardid <> get_shard_id_for_distribution_column('dist_table', 1)) results;
+$$;
+
+CREATE FUNCTION query_succeeds(query text)
+RETURNS bool LANGUAGE plpgsql AS $$
+BEGIN
+  EXECUTE query;
+  RETURN true;
+EXCEPTION WHEN OTHERS THEN
+  RETURN false;
+END;
+$$;
+
+SELECT count(*), sum(value) FROM dist_table
+WHERE key IN (SELECT key FROM other_table ORDER BY key LIMIT 1);
+
+SET client_min_messages TO WARNING;
+SELECT rename_other_shards('', '_hidden');
+RESET client_min_messages;
+
+-- disabled by default, all shards are accessed
+SELECT query_succeeds('SELECT count(*) FROM dist_table WHERE key IN (SELECT key FROM other_table ORDER BY key LIMIT 1)');
+
+SET citus.enable_subplan_task_pruning TO on;
+
+SELECT query_succeeds('SELECT count(*) FROM dist_table WHERE key IN (SELECT key FROM other_table ORDER BY key LIMIT 1)');
+SELECT count(*), sum(value) FROM dist_table
+WHERE key IN (SELECT key FROM other_table ORDER BY key LIMIT 1);
+SELECT key, value FROM dist_table
+WHERE value > 0 AND key IN (SELECT key FROM other_table ORDER BY key LIMIT 1);
+
+-- the result hashes to other shards as well
+SELECT query_succeeds('SELECT count(*) FROM dist_table WHERE key IN (SELECT key FROM other_table ORDER BY key LIMIT 10)');
+
+-- filters that do not restrict the distribution column to the result
+SELECT query_succeeds('SELECT count(*) FROM dist_table WHERE key NOT IN (SELECT key FROM other_table ORDER BY key LIMIT 1)');
+SELECT query_succeeds('SELECT count(*) FROM dist_table WHERE key IN (SELECT key FROM other_table ORDER BY key LIMIT 1) OR value = 5');
+SELECT query_succeeds('SELECT count(*) FROM dist_table WHERE value IN (SELECT key FROM other_table ORDER BY key LIMIT 1)');
+
+SET client_min_messages TO WARNING;
+SELECT rename_other_shards('_hidden', '');
+RESET client_min_messages;
+
+-- when no shards match, a single task still returns the aggregate
+SELECT count(*), sum(value) FROM dist_table
+WHERE key IN (SELECT key FROM other_table WHERE value < 0 ORDER BY key LIMIT 1);
+SELECT count(*), sum(value) FROM dist_table
+WHERE key IN (SELECT key FROM other_table ORDER BY key LIMIT 10);
+
+RESET citus.enable_subplan_task_pruning;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA subplan_task_pruning CASCADE;
@@ -0,0 +1,50 @@
+--
+-- task_stealing.sql
+--
+-- Test letting idle connections take over the tasks of reads on replicated
+-- shards that wait for a connection to another node.
+--
+
+CREATE SCHEMA task_stealing;
+SET search_path TO task_stealing;
+SET citus.next_shard_id TO 1916000;
+SET citus.shard_replication_factor TO 2;
+SET citus.shard_count TO 8;
+
+CREATE TABLE replicated_table(a int, b int);
+SELECT create_distributed_table('replicated_table', 'a');
+
+CREATE TABLE ref_table(b int, name text);
+SELECT create_reference_table('ref_table');
+
+INSERT INTO replicated_table SELECT i, i % 10 FROM generate_series(1, 1000) i;
+INSERT INTO ref_table SELECT i, 'name ' || i FROM generate_series(0, 9) i;
+
+SET citus.enable_task_stealing TO on;
+
+SELECT count(*), sum(a), sum(b) FROM replicated_table;
+SELECT b, count(*) FROM replicated_table GROUP BY b ORDER BY b LIMIT 3;
+SELECT name, count(*) FROM replicated_table JOIN ref_table USING (b)
+GROUP BY name ORDER BY name LIMIT 3;
+
+-- with each of the task assignment policies
+SET citus.task_assignment_policy TO 'round-robin';
+SELECT count(*), sum(a), sum(b) FROM replicated_table;
+SET citus.task_assignment_policy TO 'first-replica';
+SELECT count(*), sum(a), sum(b) FROM replicated_table;
+RESET citus.task_assignment_policy;
+
+-- with one connection per task
+SET citus.force_max_query_parallelization TO on;
+SELECT count(*), sum(a), sum(b) FROM replicated_table;
+RESET citus.force_max_query_parallelization;
+
+-- in a transaction block that modified some of the placements
+BEGIN;
+UPDATE replicated_table SET b = b + 1 WHERE a = 1;
+SELECT count(*), sum(a), sum(b) FROM replicated_table;
+ROLLBACK;
+
+RESET citus.enable_task_stealing;
+SET client_min_messages TO WARNING;
+DROP SCHEMA task_stealing CASCADE;
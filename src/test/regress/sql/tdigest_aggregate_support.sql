@@ -191,5 +191,19 @@ SELECT tdigest_percentile(tdigest, ARRAY[0.99, 0.95]) FROM latencies_rollup;
 SELECT tdigest_percentile_of(tdigest, 9000) FROM latencies_rollup;
 SELECT tdigest_percentile_of(tdigest, ARRAY[9000, 9500]) FROM latencies_rollup;
 
+-- merge the partial tdigests of the shards on each node on the node
+CREATE TABLE uncombined_percentiles AS
+SELECT b, tdigest_percentile(latency, 100, 0.5) AS latency FROM latencies GROUP BY b;
+
+SET citus.enable_tdigest_combine_per_node TO on;
+SET client_min_messages TO DEBUG1;
+CREATE TABLE combined_percentiles AS
+SELECT b, tdigest_percentile(latency, 100, 0.5) AS latency FROM latencies GROUP BY b;
+RESET client_min_messages;
+RESET citus.enable_tdigest_combine_per_node;
+
+SELECT count(*), count(*) FILTER (WHERE abs(c.latency - u.latency) < 250)
+FROM combined_percentiles c JOIN uncombined_percentiles u USING (b);
+
 SET client_min_messages TO WARNING; -- suppress cascade messages
 DROP SCHEMA tdigest_aggregate_support CASCADE;
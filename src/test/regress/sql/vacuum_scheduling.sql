@@ -0,0 +1,49 @@
+--
+-- vacuum_scheduling.sql
+--
+-- Test VACUUM of Citus tables over a bounded number of connections per node
+-- and in the order of the dead tuples of the shards.
+--
+
+CREATE SCHEMA vacuum_scheduling;
+SET search_path TO vacuum_scheduling;
+SET citus.next_shard_id TO 1946000;
+SET citus.shard_count TO 8;
+SET citus.shard_replication_factor TO 1;
+
+CREATE TABLE events (a int, b int);
+SELECT create_distributed_table('events', 'a');
+CREATE TABLE sessions (a int, b int);
+SELECT create_distributed_table('sessions', 'a');
+CREATE TABLE countries (a int, b text);
+SELECT create_reference_table('countries');
+
+INSERT INTO events SELECT i, i FROM generate_series(1, 1000) i;
+INSERT INTO sessions SELECT i, i FROM generate_series(1, 1000) i;
+INSERT INTO countries VALUES (1, 'nl'), (2, 'tr');
+DELETE FROM events WHERE a % 3 = 0;
+DELETE FROM sessions WHERE a < 100;
+
+SET citus.vacuum_processes_per_node TO 1;
+VACUUM events, sessions, countries;
+VACUUM (ANALYZE) events;
+
+SET citus.vacuum_shards_by_dead_tuples TO on;
+VACUUM events, sessions, countries;
+VACUUM (ANALYZE, SKIP_LOCKED) events, sessions;
+VACUUM sessions (b);
+
+-- ANALYZE alone does not read the dead tuples
+ANALYZE events, sessions;
+
+SET citus.vacuum_processes_per_node TO 0;
+VACUUM events, sessions;
+
+SELECT count(*) FROM events;
+SELECT count(*) FROM sessions;
+SELECT count(*) FROM countries;
+
+RESET citus.vacuum_shards_by_dead_tuples;
+RESET citus.vacuum_processes_per_node;
+SET client_min_messages TO WARNING;
+DROP SCHEMA vacuum_scheduling CASCADE;